@@ -17,6 +17,8 @@
 #ifndef __AUDIO_DEFINES__H
 #define __AUDIO_DEFINES__H
 
+#include <stdint.h>
+
 #include <retro_common_api.h>
 
 RETRO_BEGIN_DECLS
@@ -81,8 +83,27 @@ typedef struct audio_statistics
    float close_to_underrun;
    float close_to_blocking;
    unsigned samples;
+   /* Resampling ratio adjustment of rate control, in percent. */
+   float ratio_adjust_avg;
+   float ratio_adjust_min;
+   float ratio_adjust_max;
+   /* Counters of the driver, if it reports them. */
+   unsigned underruns;
+   unsigned overruns;
 } audio_statistics_t;
 
+/* Filled in by audio drivers that implement get_stats. */
+typedef struct audio_driver_stats
+{
+   /* Times the device ran out of audio to play. */
+   unsigned underruns;
+   /* Times audio was dropped because the buffer was full. */
+   unsigned overruns;
+   /* Time until audio written now gets played, in usec,
+    * or -1 if unknown. */
+   int64_t latency;
+} audio_driver_stats_t;
+
 RETRO_END_DECLS
 
 #endif
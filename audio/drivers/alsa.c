@@ -18,21 +18,36 @@
 
 #include <lists/string_list.h>
 #include <string/stdstring.h>
+#include <retro_timers.h>
 
 #include <alsa/asoundlib.h>
 
+#include "../../configuration.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 
+/* Smallest period the low-latency mode will ask for. */
+#define ALSA_MIN_PERIOD_FRAMES 64
+
+typedef snd_pcm_sframes_t (*alsa_writei_t)(snd_pcm_t *pcm,
+      const void *buffer, snd_pcm_uframes_t size);
+
 typedef struct alsa
 {
    snd_pcm_t *pcm;
+   alsa_writei_t writei;
    size_t buffer_size;
+   snd_pcm_uframes_t period_frames;
+   unsigned rate;
    bool nonblock;
    unsigned int frame_bits;
    bool has_float;
    bool can_pause;
    bool is_paused;
+   bool low_latency;
+   bool period_wakeup;
+   unsigned underruns;
+   unsigned overruns;
 } alsa_t;
 
 static bool alsa_use_float(void *data)
@@ -55,6 +70,73 @@ static bool find_float_format(snd_pcm_t *pcm, void *data)
    return false;
 }
 
+/* Frames of audio the core produces per video frame. */
+static snd_pcm_uframes_t alsa_frame_chunk(unsigned rate)
+{
+   struct retro_system_av_info *av_info = video_viewport_get_system_av_info();
+   double fps                           = 60.0;
+
+   if (av_info && av_info->timing.fps > 0.0)
+      fps = av_info->timing.fps;
+
+   return (snd_pcm_uframes_t)(rate / fps + 0.5);
+}
+
+/* Periods of the core's frame chunk, halved until three of
+ * them fit in the requested latency, with no fewer than two
+ * periods in the buffer. */
+static int alsa_set_low_latency_params(alsa_t *alsa,
+      snd_pcm_hw_params_t *params, unsigned rate, unsigned latency)
+{
+   snd_pcm_uframes_t period_frames = alsa_frame_chunk(rate);
+   snd_pcm_uframes_t buffer_frames = (snd_pcm_uframes_t)rate * latency / 1000;
+
+   while (period_frames > ALSA_MIN_PERIOD_FRAMES
+         && period_frames * 3 > buffer_frames)
+      period_frames /= 2;
+
+   if (buffer_frames < period_frames * 2)
+      buffer_frames = period_frames * 2;
+
+   if (snd_pcm_hw_params_set_period_size_near(
+            alsa->pcm, params, &period_frames, NULL) < 0)
+      return -1;
+
+   if (snd_pcm_hw_params_set_buffer_size_near(
+            alsa->pcm, params, &buffer_frames) < 0)
+      return -1;
+
+   /* The write side polls the hardware pointer instead,
+    * so the codec doesn't need to interrupt every period. */
+   if (     alsa->writei == snd_pcm_mmap_writei
+         && snd_pcm_hw_params_can_disable_period_wakeup(params)
+         && snd_pcm_hw_params_set_period_wakeup(alsa->pcm, params, 0) == 0)
+      alsa->period_wakeup = false;
+
+   return 0;
+}
+
+/* Blocks until the device has room for a period. Without
+ * period interrupts snd_pcm_wait() would never return, so
+ * sleep for as long as the hardware needs to free one. */
+static int alsa_wait(alsa_t *alsa)
+{
+   snd_pcm_sframes_t avail;
+
+   if (alsa->period_wakeup)
+      return snd_pcm_wait(alsa->pcm, -1);
+
+   avail = snd_pcm_avail(alsa->pcm);
+   if (avail < 0)
+      return (int)avail;
+
+   if ((snd_pcm_uframes_t)avail < alsa->period_frames)
+      retro_sleep((unsigned)(((alsa->period_frames - avail) * 1000
+                  + alsa->rate - 1) / alsa->rate));
+
+   return 1;
+}
+
 static void *alsa_init(const char *device, unsigned rate, unsigned latency,
       unsigned block_frames,
       unsigned *new_rate)
@@ -68,11 +150,16 @@ static void *alsa_init(const char *device, unsigned rate, unsigned latency,
    unsigned periods               = 4;
    unsigned orig_rate             = rate;
    const char *alsa_dev           = "default";
+   settings_t *settings           = config_get_ptr();
    alsa_t *alsa                   = (alsa_t*)calloc(1, sizeof(alsa_t));
 
    if (!alsa)
       return NULL;
 
+   alsa->writei        = snd_pcm_writei;
+   alsa->period_wakeup = true;
+   alsa->low_latency   = settings->bools.audio_alsa_low_latency;
+
    if (device)
       alsa_dev = device;
 
@@ -89,7 +176,11 @@ static void *alsa_init(const char *device, unsigned rate, unsigned latency,
    if (snd_pcm_hw_params_any(alsa->pcm, params) < 0)
       goto error;
 
-   if (snd_pcm_hw_params_set_access(
+   if (     alsa->low_latency
+         && snd_pcm_hw_params_set_access(
+            alsa->pcm, params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0)
+      alsa->writei = snd_pcm_mmap_writei;
+   else if (snd_pcm_hw_params_set_access(
             alsa->pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED) < 0)
       goto error;
 
@@ -110,13 +201,21 @@ static void *alsa_init(const char *device, unsigned rate, unsigned latency,
    if (rate != orig_rate)
       *new_rate = rate;
 
-   if (snd_pcm_hw_params_set_buffer_time_near(
-            alsa->pcm, params, &latency_usec, NULL) < 0)
-      goto error;
+   if (alsa->low_latency)
+   {
+      if (alsa_set_low_latency_params(alsa, params, rate, latency) < 0)
+         goto error;
+   }
+   else
+   {
+      if (snd_pcm_hw_params_set_buffer_time_near(
+               alsa->pcm, params, &latency_usec, NULL) < 0)
+         goto error;
 
-   if (snd_pcm_hw_params_set_periods_near(
-            alsa->pcm, params, &periods, NULL) < 0)
-      goto error;
+      if (snd_pcm_hw_params_set_periods_near(
+               alsa->pcm, params, &periods, NULL) < 0)
+         goto error;
+   }
 
    if (snd_pcm_hw_params(alsa->pcm, params) < 0)
       goto error;
@@ -127,6 +226,8 @@ static void *alsa_init(const char *device, unsigned rate, unsigned latency,
       snd_pcm_hw_params_get_period_size_min(params, &buffer_size, NULL);
 
    RARCH_LOG("[ALSA]: Period size: %d frames\n", (int)buffer_size);
+   alsa->period_frames = buffer_size;
+   alsa->rate          = rate;
 
    if (snd_pcm_hw_params_get_buffer_size(params, &buffer_size))
       snd_pcm_hw_params_get_buffer_size_max(params, &buffer_size);
@@ -138,6 +239,11 @@ static void *alsa_init(const char *device, unsigned rate, unsigned latency,
 
    RARCH_LOG("[ALSA]: Can pause: %s.\n", alsa->can_pause ? "yes" : "no");
 
+   if (alsa->low_latency)
+      RARCH_LOG("[ALSA]: Low latency mode, %s access, period interrupts %s.\n",
+            alsa->writei == snd_pcm_mmap_writei ? "mmap" : "read/write",
+            alsa->period_wakeup ? "on" : "off");
+
    if (snd_pcm_sw_params_malloc(&sw_params) < 0)
       goto error;
 
@@ -199,17 +305,22 @@ static ssize_t alsa_write(void *data, const void *buf_, size_t size_)
    {
       while (size)
       {
-         snd_pcm_sframes_t frames = snd_pcm_writei(alsa->pcm, buf, size);
+         snd_pcm_sframes_t frames = alsa->writei(alsa->pcm, buf, size);
 
          if (frames == -EPIPE || frames == -EINTR || frames == -ESTRPIPE)
          {
+            if (frames == -EPIPE)
+               alsa->underruns++;
             if (snd_pcm_recover(alsa->pcm, frames, 1) < 0)
                return -1;
 
             break;
          }
          else if (frames == -EAGAIN)
+         {
+            alsa->overruns++;
             break;
+         }
          else if (frames < 0)
             return -1;
 
@@ -225,19 +336,23 @@ static ssize_t alsa_write(void *data, const void *buf_, size_t size_)
       while (size)
       {
          snd_pcm_sframes_t frames;
-         int rc = snd_pcm_wait(alsa->pcm, -1);
+         int rc = alsa_wait(alsa);
 
          if (rc == -EPIPE || rc == -ESTRPIPE || rc == -EINTR)
          {
+            if (rc == -EPIPE)
+               alsa->underruns++;
             if (snd_pcm_recover(alsa->pcm, rc, 1) < 0)
                return -1;
             continue;
          }
 
-         frames = snd_pcm_writei(alsa->pcm, buf, size);
+         frames = alsa->writei(alsa->pcm, buf, size);
 
          if (frames == -EPIPE || frames == -EINTR || frames == -ESTRPIPE)
          {
+            if (frames == -EPIPE)
+               alsa->underruns++;
             if (snd_pcm_recover(alsa->pcm, frames, 1) < 0)
                return -1;
 
@@ -342,7 +457,26 @@ static void alsa_free(void *data)
 static size_t alsa_write_avail(void *data)
 {
    alsa_t *alsa            = (alsa_t*)data;
-   snd_pcm_sframes_t avail = snd_pcm_avail(alsa->pcm);
+   snd_pcm_sframes_t avail;
+
+   /* The delay includes what is queued past the hardware
+    * pointer, so rate control follows what is actually
+    * left to play rather than the fill of the buffer. */
+   if (alsa->low_latency)
+   {
+      snd_pcm_sframes_t delay = 0;
+      size_t delay_bytes;
+
+      if (snd_pcm_delay(alsa->pcm, &delay) < 0)
+         return alsa->buffer_size;
+
+      delay_bytes = FRAMES_TO_BYTES(delay > 0 ? delay : 0, alsa->frame_bits);
+      if (delay_bytes > alsa->buffer_size)
+         return 0;
+      return alsa->buffer_size - delay_bytes;
+   }
+
+   avail = snd_pcm_avail(alsa->pcm);
 
    if (avail < 0)
       return alsa->buffer_size;
@@ -356,6 +490,21 @@ static size_t alsa_buffer_size(void *data)
    return alsa->buffer_size;
 }
 
+static bool alsa_get_stats(void *data, audio_driver_stats_t *stats)
+{
+   alsa_t *alsa            = (alsa_t*)data;
+   snd_pcm_sframes_t delay = 0;
+
+   stats->underruns = alsa->underruns;
+   stats->overruns  = alsa->overruns;
+   stats->latency   = -1;
+
+   if (snd_pcm_delay(alsa->pcm, &delay) == 0)
+      stats->latency = (int64_t)(delay > 0 ? delay : 0) * 1000000 / alsa->rate;
+
+   return true;
+}
+
 static void *alsa_device_list_new(void *data)
 {
    void **hints, **n;
@@ -428,4 +577,5 @@ audio_driver_t audio_alsa = {
    alsa_device_list_free,
    alsa_write_avail,
    alsa_buffer_size,
+   alsa_get_stats,
 };
@@ -15,13 +15,17 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include <lists/string_list.h>
 
 #include <alsa/asoundlib.h>
 
+#include <retro_math.h>
 #include <rthreads/rthreads.h>
-#include <queues/fifo_queue.h>
 #include <string/stdstring.h>
 
 #include "../../retroarch.h"
@@ -30,71 +34,229 @@
 #define TRY_ALSA(x) if (x < 0) \
                   goto error;
 
+/* The ring is single producer (alsa_thread_write), single
+ * consumer (the worker), so the emulation thread never
+ * takes a lock unless it has to block on a full buffer. */
+#define ALSA_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define ALSA_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+/* Upper bound for how long the worker sleeps on the PCM,
+ * so that it notices shutdown. */
+#define ALSA_THREAD_WAIT_MS         100
+#define ALSA_THREAD_RT_PRIORITY     50
+
 typedef struct alsa_thread
 {
    snd_pcm_t *pcm;
    bool nonblock;
    bool is_paused;
    bool has_float;
+   bool use_mmap;
    volatile bool thread_dead;
 
    size_t buffer_size;
    size_t period_size;
    snd_pcm_uframes_t period_frames;
+   unsigned rate;
+   unsigned frame_size;
+
+   uint8_t *ring;
+   size_t ring_mask;
+   /* Free-running byte counters, each written by one side only. */
+   size_t ring_read;
+   size_t ring_write;
+
+   /* Updated by the worker, read by the writer. */
+   unsigned underruns;
+   unsigned overruns;
+   snd_pcm_sframes_t delay;
+   bool starved;
 
-   fifo_buffer_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
    scond_t *cond;
    slock_t *cond_lock;
 } alsa_thread_t;
 
+static size_t alsa_thread_ring_write_avail(alsa_thread_t *alsa)
+{
+   return alsa->buffer_size -
+      (alsa->ring_write - ALSA_ATOMIC_LOAD(&alsa->ring_read));
+}
+
+static size_t alsa_thread_ring_write(alsa_thread_t *alsa,
+      const uint8_t *buf, size_t size)
+{
+   size_t pos   = alsa->ring_write & alsa->ring_mask;
+   size_t first = 0;
+
+   size         = MIN(size, alsa_thread_ring_write_avail(alsa));
+   first        = MIN(size, alsa->ring_mask + 1 - pos);
+
+   memcpy(alsa->ring + pos, buf, first);
+   memcpy(alsa->ring, buf + first, size - first);
+
+   ALSA_ATOMIC_STORE(&alsa->ring_write, alsa->ring_write + size);
+   return size;
+}
+
+/* Fills size bytes of buf, padding with silence on underrun. */
+static void alsa_thread_ring_read(alsa_thread_t *alsa,
+      uint8_t *buf, size_t size)
+{
+   size_t pos   = alsa->ring_read & alsa->ring_mask;
+   size_t avail = ALSA_ATOMIC_LOAD(&alsa->ring_write) - alsa->ring_read;
+   size_t read  = MIN(size, avail);
+   size_t first = MIN(read, alsa->ring_mask + 1 - pos);
+
+   memcpy(buf, alsa->ring + pos, first);
+   memcpy(buf + first, alsa->ring, read - first);
+   memset(buf + read, 0, size - read);
+
+   /* Count each time playback runs dry, not every period
+    * of silence that follows. */
+   if (read < size)
+   {
+      if (!alsa->starved && !alsa->is_paused)
+         ALSA_ATOMIC_STORE(&alsa->underruns, alsa->underruns + 1);
+      alsa->starved = true;
+   }
+   else
+      alsa->starved = false;
+
+   if (!read)
+      return;
+
+   ALSA_ATOMIC_STORE(&alsa->ring_read, alsa->ring_read + read);
+
+   /* Wake up a blocking writer. */
+   slock_lock(alsa->cond_lock);
+   scond_signal(alsa->cond);
+   slock_unlock(alsa->cond_lock);
+}
+
+static bool alsa_thread_recover(alsa_thread_t *alsa, int err)
+{
+   if (err == -EPIPE || err == -EINTR || err == -ESTRPIPE)
+   {
+      if (err == -EPIPE)
+         ALSA_ATOMIC_STORE(&alsa->underruns, alsa->underruns + 1);
+      if (snd_pcm_recover(alsa->pcm, err, 1) >= 0)
+         return true;
+
+      RARCH_ERR("[ALSA]: (#2) Failed to recover from error (%s)\n",
+            snd_strerror(err));
+      return false;
+   }
+
+   RARCH_ERR("[ALSA]: Unknown error occurred (%s).\n",
+         snd_strerror(err));
+   return false;
+}
+
+/* Copies one period from the ring straight into the
+ * DMA buffer once the device has room for it. */
+static bool alsa_thread_write_period_mmap(alsa_thread_t *alsa)
+{
+   snd_pcm_uframes_t remaining = alsa->period_frames;
+   snd_pcm_sframes_t avail     = snd_pcm_avail_update(alsa->pcm);
+
+   if (avail < 0)
+      return alsa_thread_recover(alsa, (int)avail);
+
+   if ((snd_pcm_uframes_t)avail < alsa->period_frames)
+   {
+      int err = snd_pcm_wait(alsa->pcm, ALSA_THREAD_WAIT_MS);
+      if (err < 0)
+         return alsa_thread_recover(alsa, err);
+      return true;
+   }
+
+   while (remaining)
+   {
+      const snd_pcm_channel_area_t *areas;
+      snd_pcm_sframes_t committed;
+      snd_pcm_uframes_t offset;
+      snd_pcm_uframes_t frames = remaining;
+      int err                  = snd_pcm_mmap_begin(
+            alsa->pcm, &areas, &offset, &frames);
+
+      if (err < 0)
+         return alsa_thread_recover(alsa, err);
+
+      alsa_thread_ring_read(alsa, (uint8_t*)areas[0].addr +
+            (areas[0].first + offset * areas[0].step) / 8,
+            snd_pcm_frames_to_bytes(alsa->pcm, frames));
+
+      committed = snd_pcm_mmap_commit(alsa->pcm, offset, frames);
+      if (committed < 0)
+         return alsa_thread_recover(alsa, (int)committed);
+      if ((snd_pcm_uframes_t)committed != frames)
+         return alsa_thread_recover(alsa, -EPIPE);
+
+      remaining -= frames;
+   }
+
+   return true;
+}
+
+static bool alsa_thread_write_period(alsa_thread_t *alsa, uint8_t *buf)
+{
+   snd_pcm_sframes_t frames;
+
+   alsa_thread_ring_read(alsa, buf, alsa->period_size);
+
+   frames = snd_pcm_writei(alsa->pcm, buf, alsa->period_frames);
+   if (frames < 0)
+      return alsa_thread_recover(alsa, (int)frames);
+   return true;
+}
+
+static void alsa_thread_set_realtime(void)
+{
+   struct sched_param sp;
+   int max_priority  = sched_get_priority_max(SCHED_FIFO);
+
+   memset(&sp, 0, sizeof(sp));
+   sp.sched_priority = MIN(ALSA_THREAD_RT_PRIORITY, max_priority);
+
+   /* Needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance. */
+   if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0)
+      RARCH_LOG("[ALSA]: Worker thread runs with SCHED_FIFO priority %d.\n",
+            sp.sched_priority);
+   else
+      RARCH_WARN("[ALSA]: Not permitted to use SCHED_FIFO for the worker thread.\n");
+}
+
 static void alsa_worker_thread(void *data)
 {
    alsa_thread_t *alsa = (alsa_thread_t*)data;
-   uint8_t        *buf = (uint8_t *)calloc(1, alsa->period_size);
+   uint8_t        *buf = NULL;
 
-   if (!buf)
+   if (!alsa->use_mmap)
    {
-      RARCH_ERR("failed to allocate audio buffer");
-      goto end;
+      buf = (uint8_t *)calloc(1, alsa->period_size);
+      if (!buf)
+      {
+         RARCH_ERR("failed to allocate audio buffer");
+         goto end;
+      }
    }
 
+   alsa_thread_set_realtime();
+   sthread_set_role(STHREAD_ROLE_AUDIO);
+
    while (!alsa->thread_dead)
    {
-      size_t avail;
-      size_t fifo_size;
-      snd_pcm_sframes_t frames;
-      slock_lock(alsa->fifo_lock);
-      avail = fifo_read_avail(alsa->buffer);
-      fifo_size = MIN(alsa->period_size, avail);
-      fifo_read(alsa->buffer, buf, fifo_size);
-      scond_signal(alsa->cond);
-      slock_unlock(alsa->fifo_lock);
-
-      /* If underrun, fill rest with silence. */
-      memset(buf + fifo_size, 0, alsa->period_size - fifo_size);
-
-      frames = snd_pcm_writei(alsa->pcm, buf, alsa->period_frames);
-
-      if (frames == -EPIPE || frames == -EINTR ||
-            frames == -ESTRPIPE)
-      {
-         if (snd_pcm_recover(alsa->pcm, frames, 1) < 0)
-         {
-            RARCH_ERR("[ALSA]: (#2) Failed to recover from error (%s)\n",
-                  snd_strerror(frames));
-            break;
-         }
+      snd_pcm_sframes_t delay = 0;
+      bool ok                 = alsa->use_mmap
+         ? alsa_thread_write_period_mmap(alsa)
+         : alsa_thread_write_period(alsa, buf);
 
-         continue;
-      }
-      else if (frames < 0)
-      {
-         RARCH_ERR("[ALSA]: Unknown error occurred (%s).\n",
-               snd_strerror(frames));
+      if (!ok)
          break;
-      }
+
+      if (snd_pcm_delay(alsa->pcm, &delay) == 0)
+         ALSA_ATOMIC_STORE(&alsa->delay, delay > 0 ? delay : 0);
    }
 
 end:
@@ -102,6 +264,7 @@ end:
    alsa->thread_dead = true;
    scond_signal(alsa->cond);
    slock_unlock(alsa->cond_lock);
+   sthread_set_role(STHREAD_ROLE_NONE);
    free(buf);
 }
 
@@ -136,12 +299,10 @@ static void alsa_thread_free(void *data)
          slock_unlock(alsa->cond_lock);
          sthread_join(alsa->worker_thread);
       }
-      if (alsa->buffer)
-         fifo_free(alsa->buffer);
+      if (alsa->ring)
+         free(alsa->ring);
       if (alsa->cond)
          scond_free(alsa->cond);
-      if (alsa->fifo_lock)
-         slock_free(alsa->fifo_lock);
       if (alsa->cond_lock)
          slock_free(alsa->cond_lock);
       if (alsa->pcm)
@@ -179,8 +340,16 @@ static void *alsa_thread_init(const char *device,
    format = alsa->has_float ? SND_PCM_FORMAT_FLOAT : SND_PCM_FORMAT_S16;
 
    TRY_ALSA(snd_pcm_hw_params_any(alsa->pcm, params));
-   TRY_ALSA(snd_pcm_hw_params_set_access(
-            alsa->pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED));
+
+   /* mmap skips a copy and lets the worker fill the DMA buffer
+    * period by period. Not every plugin supports it. */
+   alsa->use_mmap = snd_pcm_hw_params_set_access(alsa->pcm, params,
+         SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+   if (!alsa->use_mmap)
+      TRY_ALSA(snd_pcm_hw_params_set_access(
+               alsa->pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED));
+   RARCH_LOG("ALSA: Using %s access.\n",
+         alsa->use_mmap ? "mmap" : "read/write");
    TRY_ALSA(snd_pcm_hw_params_set_format(alsa->pcm, params, format));
    TRY_ALSA(snd_pcm_hw_params_set_channels(alsa->pcm, params, channels));
    TRY_ALSA(snd_pcm_hw_params_set_rate(alsa->pcm, params, rate, 0));
@@ -204,6 +373,9 @@ static void *alsa_thread_init(const char *device,
 
    alsa->buffer_size = snd_pcm_frames_to_bytes(alsa->pcm, buffer_size);
    alsa->period_size = snd_pcm_frames_to_bytes(alsa->pcm, alsa->period_frames);
+   alsa->frame_size  = snd_pcm_frames_to_bytes(alsa->pcm, 1);
+   alsa->rate        = rate;
+   alsa->starved     = true;
 
    TRY_ALSA(snd_pcm_sw_params_malloc(&sw_params));
    TRY_ALSA(snd_pcm_sw_params_current(alsa->pcm, sw_params));
@@ -214,11 +386,11 @@ static void *alsa_thread_init(const char *device,
    snd_pcm_hw_params_free(params);
    snd_pcm_sw_params_free(sw_params);
 
-   alsa->fifo_lock = slock_new();
+   alsa->ring_mask = next_pow2(alsa->buffer_size) - 1;
+   alsa->ring      = (uint8_t*)malloc(alsa->ring_mask + 1);
    alsa->cond_lock = slock_new();
-   alsa->cond = scond_new();
-   alsa->buffer = fifo_new(alsa->buffer_size);
-   if (!alsa->fifo_lock || !alsa->cond_lock || !alsa->cond || !alsa->buffer)
+   alsa->cond      = scond_new();
+   if (!alsa->cond_lock || !alsa->cond || !alsa->ring)
       goto error;
 
    alsa->worker_thread = sthread_create(alsa_worker_thread, alsa);
@@ -252,43 +424,31 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
 
    if (alsa->nonblock)
    {
-      size_t avail;
-      size_t write_amt;
-
-      slock_lock(alsa->fifo_lock);
-      avail           = fifo_write_avail(alsa->buffer);
-      write_amt       = MIN(avail, size);
-
-      fifo_write(alsa->buffer, buf, write_amt);
-      slock_unlock(alsa->fifo_lock);
-
-      return write_amt;
+      size_t written = alsa_thread_ring_write(alsa,
+            (const uint8_t*)buf, size);
+      if (written < size)
+         alsa->overruns++;
+      return written;
    }
    else
    {
       size_t written = 0;
       while (written < size && !alsa->thread_dead)
       {
-         size_t avail;
-         slock_lock(alsa->fifo_lock);
-         avail = fifo_write_avail(alsa->buffer);
+         size_t write_amt = alsa_thread_ring_write(alsa,
+               (const uint8_t*)buf + written, size - written);
 
-         if (avail == 0)
-         {
-            slock_unlock(alsa->fifo_lock);
-            slock_lock(alsa->cond_lock);
-            if (!alsa->thread_dead)
-               scond_wait(alsa->cond, alsa->cond_lock);
-            slock_unlock(alsa->cond_lock);
-         }
-         else
+         if (write_amt)
          {
-            size_t write_amt = MIN(size - written, avail);
-            fifo_write(alsa->buffer,
-                  (const char*)buf + written, write_amt);
-            slock_unlock(alsa->fifo_lock);
             written += write_amt;
+            continue;
          }
+
+         /* Recheck under the lock so a wakeup can't be missed. */
+         slock_lock(alsa->cond_lock);
+         if (!alsa->thread_dead && !alsa_thread_ring_write_avail(alsa))
+            scond_wait(alsa->cond, alsa->cond_lock);
+         slock_unlock(alsa->cond_lock);
       }
       return written;
    }
@@ -329,14 +489,10 @@ static bool alsa_thread_start(void *data, bool is_shutdown)
 static size_t alsa_thread_write_avail(void *data)
 {
    alsa_thread_t *alsa = (alsa_thread_t*)data;
-   size_t val;
 
    if (alsa->thread_dead)
       return 0;
-   slock_lock(alsa->fifo_lock);
-   val = fifo_write_avail(alsa->buffer);
-   slock_unlock(alsa->fifo_lock);
-   return val;
+   return alsa_thread_ring_write_avail(alsa);
 }
 
 static size_t alsa_thread_buffer_size(void *data)
@@ -345,6 +501,21 @@ static size_t alsa_thread_buffer_size(void *data)
    return alsa->buffer_size;
 }
 
+static bool alsa_thread_get_stats(void *data, audio_driver_stats_t *stats)
+{
+   alsa_thread_t *alsa = (alsa_thread_t*)data;
+   /* Audio in the ring plays after what the device holds. */
+   size_t queued       = alsa->ring_write - ALSA_ATOMIC_LOAD(&alsa->ring_read);
+   int64_t frames      = queued / alsa->frame_size +
+      ALSA_ATOMIC_LOAD(&alsa->delay);
+
+   stats->underruns    = ALSA_ATOMIC_LOAD(&alsa->underruns);
+   stats->overruns     = alsa->overruns;
+   stats->latency      = frames * 1000000 / alsa->rate;
+
+   return true;
+}
+
 static void *alsa_thread_device_list_new(void *data)
 {
    void **hints, **n;
@@ -417,4 +588,5 @@ audio_driver_t audio_alsathread = {
    alsa_thread_device_list_free,
    alsa_thread_write_avail,
    alsa_thread_buffer_size,
+   alsa_thread_get_stats,
 };
@@ -0,0 +1,645 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <lists/string_list.h>
+#include <string/stdstring.h>
+#include <streams/file_stream.h>
+#include <queues/task_queue.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "benchmark.h"
+
+#include "configuration.h"
+#include "performance_counters.h"
+#include "verbosity.h"
+#include "version.h"
+
+#ifdef HAVE_MENU
+#include "menu/menu_animation.h"
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#define BENCHMARK_IDLE_TIMEOUT 30
+/* Frames in a row, so one frame without work in between
+ * two doesn't count */
+#define BENCHMARK_IDLE_FRAMES  2
+
+enum benchmark_action_type
+{
+   BENCHMARK_ACTION_STEP = 0,
+   BENCHMARK_ACTION_PRESS,
+   BENCHMARK_ACTION_HOLD,
+   BENCHMARK_ACTION_WAIT,
+   BENCHMARK_ACTION_RUN,
+   BENCHMARK_ACTION_IDLE,
+   BENCHMARK_ACTION_QUIT
+};
+
+typedef struct benchmark_action
+{
+   enum benchmark_action_type type;
+   /* Of the button */
+   unsigned id;
+   /* Presses, frames or seconds */
+   unsigned count;
+   /* Of the step */
+   char *name;
+} benchmark_action_t;
+
+typedef struct benchmark_step
+{
+   char *name;
+   retro_time_t begin;
+   retro_time_t end;
+   unsigned frames;
+   bool timed_out;
+   rarch_histogram_t frame_time;
+   rarch_histogram_t core_run;
+} benchmark_step_t;
+
+typedef struct benchmark
+{
+   benchmark_action_t *actions;
+   size_t actions_size;
+   size_t pos;
+   /* Into the current action */
+   unsigned frame;
+   unsigned idle_frames;
+   retro_time_t idle_begin;
+
+   benchmark_step_t *steps;
+   size_t steps_size;
+   size_t steps_cap;
+
+   retro_time_t last_frame;
+   char out[PATH_MAX_LENGTH];
+} benchmark_t;
+
+static const struct
+{
+   const char *name;
+   unsigned id;
+} benchmark_buttons[] = {
+   { "up",           RETRO_DEVICE_ID_JOYPAD_UP },
+   { "down",         RETRO_DEVICE_ID_JOYPAD_DOWN },
+   { "left",         RETRO_DEVICE_ID_JOYPAD_LEFT },
+   { "right",        RETRO_DEVICE_ID_JOYPAD_RIGHT },
+   { "a",            RETRO_DEVICE_ID_JOYPAD_A },
+   { "b",            RETRO_DEVICE_ID_JOYPAD_B },
+   { "x",            RETRO_DEVICE_ID_JOYPAD_X },
+   { "y",            RETRO_DEVICE_ID_JOYPAD_Y },
+   { "l",            RETRO_DEVICE_ID_JOYPAD_L },
+   { "r",            RETRO_DEVICE_ID_JOYPAD_R },
+   { "l2",           RETRO_DEVICE_ID_JOYPAD_L2 },
+   { "r2",           RETRO_DEVICE_ID_JOYPAD_R2 },
+   { "l3",           RETRO_DEVICE_ID_JOYPAD_L3 },
+   { "r3",           RETRO_DEVICE_ID_JOYPAD_R3 },
+   { "start",        RETRO_DEVICE_ID_JOYPAD_START },
+   { "select",       RETRO_DEVICE_ID_JOYPAD_SELECT },
+   { "menu",         RARCH_MENU_TOGGLE },
+   { "pause",        RARCH_PAUSE_TOGGLE },
+   { "fast_forward", RARCH_FAST_FORWARD_KEY },
+};
+
+static benchmark_t *benchmark_st = NULL;
+
+static bool benchmark_find_button(const char *name, unsigned *id)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(benchmark_buttons); i++)
+   {
+      if (string_is_equal(benchmark_buttons[i].name, name))
+      {
+         *id = benchmark_buttons[i].id;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static bool benchmark_add_action(benchmark_t *bench,
+      const benchmark_action_t *action)
+{
+   benchmark_action_t *actions = (benchmark_action_t*)realloc(
+         bench->actions, (bench->actions_size + 1) * sizeof(*actions));
+
+   if (!actions)
+      return false;
+
+   bench->actions                        = actions;
+   bench->actions[bench->actions_size++] = *action;
+   return true;
+}
+
+static bool benchmark_parse_line(benchmark_t *bench,
+      const struct string_list *tokens)
+{
+   benchmark_action_t action;
+   const char *cmd = tokens->elems[0].data;
+   const char *arg = tokens->size > 1 ? tokens->elems[1].data : NULL;
+
+   action.id       = 0;
+   action.count    = 1;
+   action.name     = NULL;
+
+   if (string_is_equal(cmd, "step"))
+   {
+      /* Written out as is */
+      if (!arg || strchr(arg, '"') || strchr(arg, '\\'))
+         return false;
+      action.type = BENCHMARK_ACTION_STEP;
+      action.name = strdup(arg);
+   }
+   else if (string_is_equal(cmd, "press") || string_is_equal(cmd, "hold"))
+   {
+      if (!arg || !benchmark_find_button(arg, &action.id))
+         return false;
+      action.type = string_is_equal(cmd, "press")
+         ? BENCHMARK_ACTION_PRESS : BENCHMARK_ACTION_HOLD;
+      if (tokens->size > 2)
+         action.count = (unsigned)strtoul(tokens->elems[2].data, NULL, 10);
+      else if (action.type == BENCHMARK_ACTION_HOLD)
+         return false;
+   }
+   else if (string_is_equal(cmd, "wait") || string_is_equal(cmd, "run"))
+   {
+      if (!arg)
+         return false;
+      action.type  = string_is_equal(cmd, "wait")
+         ? BENCHMARK_ACTION_WAIT : BENCHMARK_ACTION_RUN;
+      action.count = (unsigned)strtoul(arg, NULL, 10);
+   }
+   else if (string_is_equal(cmd, "idle"))
+   {
+      action.type  = BENCHMARK_ACTION_IDLE;
+      action.count = arg
+         ? (unsigned)strtoul(arg, NULL, 10) : BENCHMARK_IDLE_TIMEOUT;
+   }
+   else if (string_is_equal(cmd, "quit"))
+      action.type  = BENCHMARK_ACTION_QUIT;
+   else
+      return false;
+
+   if (!benchmark_add_action(bench, &action))
+   {
+      free(action.name);
+      return false;
+   }
+
+   return true;
+}
+
+static bool benchmark_load_script(benchmark_t *bench, const char *path)
+{
+   size_t i;
+   void *buf                = NULL;
+   int64_t len              = 0;
+   struct string_list *lines = NULL;
+   bool ret                 = true;
+
+   if (!filestream_read_file(path, &buf, &len))
+   {
+      RARCH_ERR("[Benchmark]: Could not read \"%s\".\n", path);
+      return false;
+   }
+
+   lines = string_split((const char*)buf, "\r\n");
+   free(buf);
+
+   if (!lines)
+      return false;
+
+   for (i = 0; i < lines->size && ret; i++)
+   {
+      struct string_list *tokens = NULL;
+      const char *line           = lines->elems[i].data;
+
+      if (line[0] == '#')
+         continue;
+
+      if (!(tokens = string_split(line, " \t")))
+         continue;
+
+      if (tokens->size && !benchmark_parse_line(bench, tokens))
+      {
+         RARCH_ERR("[Benchmark]: \"%s\", line %u: bad action \"%s\".\n",
+               path, (unsigned)(i + 1), line);
+         ret = false;
+      }
+
+      string_list_free(tokens);
+   }
+
+   string_list_free(lines);
+
+   return ret;
+}
+
+static benchmark_step_t *benchmark_step_begin(benchmark_t *bench,
+      const char *name, retro_time_t now)
+{
+   benchmark_step_t *step = NULL;
+
+   if (bench->steps_size == bench->steps_cap)
+   {
+      size_t cap              = bench->steps_cap ? bench->steps_cap * 2 : 8;
+      benchmark_step_t *steps = (benchmark_step_t*)realloc(
+            bench->steps, cap * sizeof(*steps));
+
+      if (!steps)
+         return NULL;
+
+      bench->steps     = steps;
+      bench->steps_cap = cap;
+   }
+
+   step = &bench->steps[bench->steps_size++];
+   memset(step, 0, sizeof(*step));
+   step->name  = strdup(name);
+   step->begin = now;
+   rarch_histogram_reset(&step->frame_time);
+   rarch_histogram_reset(&step->core_run);
+
+   return step;
+}
+
+static benchmark_step_t *benchmark_step_current(benchmark_t *bench)
+{
+   if (!bench->steps_size)
+      return NULL;
+   return &bench->steps[bench->steps_size - 1];
+}
+
+static void benchmark_step_end(benchmark_t *bench, retro_time_t now)
+{
+   benchmark_step_t *step = benchmark_step_current(bench);
+
+   if (step && !step->end)
+      step->end = now;
+}
+
+static bool benchmark_task_finder(retro_task_t *task, void *data)
+{
+   return true;
+}
+
+static bool benchmark_is_idle(void)
+{
+   task_finder_data_t find_data;
+
+   find_data.func     = benchmark_task_finder;
+   find_data.userdata = NULL;
+
+   if (task_queue_find(&find_data))
+      return false;
+
+#ifdef HAVE_MENU
+   if (menu_animation_is_tweening())
+      return false;
+#endif
+
+   return true;
+}
+
+static void benchmark_write_counters(RFILE *file,
+      struct retro_perf_counter **counters, unsigned num, bool *first)
+{
+   unsigned i;
+
+   for (i = 0; i < num; i++)
+   {
+      if (!counters[i] || !counters[i]->call_cnt)
+         continue;
+
+      filestream_printf(file,
+            "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"ticks\": %llu}",
+            *first ? "" : ",",
+            counters[i]->ident,
+            (unsigned long long)counters[i]->call_cnt,
+            (unsigned long long)counters[i]->total);
+      *first = false;
+   }
+}
+
+/* Returns false if @hist has no samples, and writes nothing */
+static bool benchmark_write_histogram(RFILE *file, const char *sep,
+      const char *name, const rarch_histogram_t *hist, const char *indent)
+{
+   rarch_histogram_stats_t stats;
+
+   if (!rarch_histogram_get_stats(hist, &stats))
+      return false;
+
+   filestream_printf(file,
+         "%s\n%s\"%s\": {\"min\": %.3f, \"avg\": %.3f,"
+         " \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f,"
+         " \"max\": %.3f, \"samples\": %u}",
+         sep, indent, name,
+         stats.min / 1000.0, stats.avg / 1000.0,
+         stats.p50 / 1000.0, stats.p95 / 1000.0,
+         stats.p99 / 1000.0, stats.max / 1000.0,
+         stats.samples);
+   return true;
+}
+
+/* Returns the most memory ever in use, in bytes, or 0 */
+static uint64_t benchmark_peak_rss(void)
+{
+#ifdef __linux__
+   struct rusage usage;
+
+   /* In kB on Linux */
+   if (getrusage(RUSAGE_SELF, &usage) == 0)
+      return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+   return 0;
+}
+
+static bool benchmark_write(const benchmark_t *bench)
+{
+   size_t i;
+   bool first           = true;
+   settings_t *settings = config_get_ptr();
+   RFILE *file          = filestream_open(bench->out,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   filestream_printf(file, "{\n  \"version\": \"%s\",\n", PACKAGE_VERSION);
+   filestream_printf(file, "  \"video_driver\": \"%s\",\n",
+         settings->arrays.video_driver);
+#ifdef HAVE_MENU
+   filestream_printf(file, "  \"menu_driver\": \"%s\",\n",
+         settings->arrays.menu_driver);
+   filestream_printf(file, "  \"menu_thumbnails\": %u,\n",
+         settings->uints.menu_thumbnails);
+   filestream_printf(file, "  \"menu_left_thumbnails\": %u,\n",
+         settings->uints.menu_left_thumbnails);
+#endif
+   filestream_printf(file, "  \"steps\": [");
+
+   for (i = 0; i < bench->steps_size; i++)
+   {
+      const benchmark_step_t *step = &bench->steps[i];
+      retro_time_t duration        = step->end - step->begin;
+
+      filestream_printf(file,
+            "%s\n    {\"name\": \"%s\", \"latency_ms\": %.3f,"
+            " \"frames\": %u, \"fps\": %.2f, \"timed_out\": %s",
+            i ? "," : "",
+            step->name,
+            duration / 1000.0,
+            step->frames,
+            duration > 0 ? step->frames * 1000000.0 / duration : 0.0,
+            step->timed_out ? "true" : "false");
+
+      /* Of the last HISTOGRAM_SAMPLES frames */
+      benchmark_write_histogram(file, ",", "frame_time_ms",
+            &step->frame_time, "     ");
+      benchmark_write_histogram(file, ",", "core_run_ms",
+            &step->core_run, "     ");
+
+      filestream_printf(file, "}");
+   }
+
+   /* Of the whole run, the frontend's share of a frame */
+   filestream_printf(file, "\n  ],\n  \"stages\": {");
+   {
+      unsigned count            = 0;
+      bool first                = true;
+      rarch_histogram_t **hists = rarch_histogram_get_list(&count);
+
+      for (i = 0; i < count; i++)
+         if (benchmark_write_histogram(file, first ? "" : ",",
+                  hists[i]->ident, hists[i], "    "))
+            first = false;
+   }
+   filestream_printf(file, "\n  },\n  \"peak_rss\": %llu,",
+         (unsigned long long)benchmark_peak_rss());
+
+   filestream_printf(file, "\n  \"counters\": [");
+   benchmark_write_counters(file, retro_get_perf_counter_rarch(),
+         retro_get_perf_count_rarch(), &first);
+   benchmark_write_counters(file, retro_get_perf_counter_libretro(),
+         retro_get_perf_count_libretro(), &first);
+   filestream_printf(file, "\n  ]\n}\n");
+
+   filestream_close(file);
+
+   RARCH_LOG("[Benchmark]: Wrote %u steps to \"%s\".\n",
+         (unsigned)bench->steps_size, bench->out);
+   return true;
+}
+
+/* Without a script: boots, then runs the content */
+static bool benchmark_load_run(benchmark_t *bench, unsigned frames)
+{
+   benchmark_action_t action;
+
+   action.id    = 0;
+   action.count = 1;
+   action.type  = BENCHMARK_ACTION_STEP;
+   action.name  = strdup("run");
+
+   if (!benchmark_add_action(bench, &action))
+   {
+      free(action.name);
+      return false;
+   }
+
+   action.name  = NULL;
+   action.type  = BENCHMARK_ACTION_RUN;
+   action.count = frames;
+
+   if (!benchmark_add_action(bench, &action))
+      return false;
+
+   action.type  = BENCHMARK_ACTION_QUIT;
+   return benchmark_add_action(bench, &action);
+}
+
+bool benchmark_init(const char *script, unsigned frames, const char *out)
+{
+   bool loaded        = false;
+   benchmark_t *bench = NULL;
+
+   benchmark_deinit();
+
+   if (!(bench = (benchmark_t*)calloc(1, sizeof(*bench))))
+      return false;
+
+   strlcpy(bench->out, out, sizeof(bench->out));
+
+   loaded = !string_is_empty(script)
+      ? benchmark_load_script(bench, script)
+      : benchmark_load_run(bench, frames);
+
+   if (     !loaded
+         || !benchmark_step_begin(bench, "boot", cpu_features_get_time_usec()))
+   {
+      benchmark_st = bench;
+      benchmark_deinit();
+      return false;
+   }
+
+   if (!string_is_empty(script))
+      RARCH_LOG("[Benchmark]: Running \"%s\", %u actions.\n",
+            script, (unsigned)bench->actions_size);
+   else
+      RARCH_LOG("[Benchmark]: Running content for %u frames.\n", frames);
+
+   benchmark_st = bench;
+   return true;
+}
+
+void benchmark_deinit(void)
+{
+   size_t i;
+   benchmark_t *bench = benchmark_st;
+
+   if (!bench)
+      return;
+
+   for (i = 0; i < bench->actions_size; i++)
+      free(bench->actions[i].name);
+   for (i = 0; i < bench->steps_size; i++)
+      free(bench->steps[i].name);
+
+   free(bench->actions);
+   free(bench->steps);
+   free(bench);
+
+   benchmark_st = NULL;
+}
+
+bool benchmark_is_active(void)
+{
+   return benchmark_st != NULL;
+}
+
+bool benchmark_frame(input_bits_t *bits)
+{
+   benchmark_t *bench     = benchmark_st;
+   retro_time_t now       = cpu_features_get_time_usec();
+   benchmark_step_t *step = NULL;
+
+   if (!bench)
+      return true;
+
+   step = benchmark_step_current(bench);
+
+   if (bench->last_frame && step)
+      rarch_histogram_add(&step->frame_time, now - bench->last_frame);
+   if (step)
+      step->frames++;
+   bench->last_frame = now;
+
+   while (bench->pos < bench->actions_size)
+   {
+      const benchmark_action_t *action = &bench->actions[bench->pos];
+
+      switch (action->type)
+      {
+         case BENCHMARK_ACTION_STEP:
+            benchmark_step_end(bench, now);
+            benchmark_step_begin(bench, action->name, now);
+            bench->pos++;
+            continue;
+         case BENCHMARK_ACTION_PRESS:
+            /* Released every other frame, to be seen as presses */
+            if (!(bench->frame & 1))
+               BIT256_SET_PTR(bits, action->id);
+            if (++bench->frame >= action->count * 2)
+               break;
+            return true;
+         case BENCHMARK_ACTION_HOLD:
+            BIT256_SET_PTR(bits, action->id);
+            if (++bench->frame >= action->count)
+               break;
+            return true;
+         case BENCHMARK_ACTION_WAIT:
+            if (++bench->frame >= action->count)
+               break;
+            return true;
+         case BENCHMARK_ACTION_RUN:
+            /* Unthrottled when fastforward_ratio is 0 */
+            BIT256_SET_PTR(bits, RARCH_FAST_FORWARD_HOLD_KEY);
+            if (++bench->frame >= action->count)
+               break;
+            return true;
+         case BENCHMARK_ACTION_IDLE:
+            if (!bench->frame++)
+            {
+               bench->idle_begin  = now;
+               bench->idle_frames = 0;
+            }
+
+            if (benchmark_is_idle())
+            {
+               if (++bench->idle_frames >= BENCHMARK_IDLE_FRAMES)
+                  break;
+            }
+            else
+               bench->idle_frames = 0;
+
+            if (now - bench->idle_begin
+                  >= (retro_time_t)action->count * 1000000)
+            {
+               if ((step = benchmark_step_current(bench)))
+                  step->timed_out = true;
+               RARCH_WARN("[Benchmark]: Timed out waiting for idle.\n");
+               break;
+            }
+            return true;
+         case BENCHMARK_ACTION_QUIT:
+            bench->pos = bench->actions_size;
+            continue;
+      }
+
+      bench->pos++;
+      bench->frame = 0;
+   }
+
+   benchmark_step_end(bench, now);
+   benchmark_write(bench);
+   benchmark_deinit();
+
+   return false;
+}
+
+void benchmark_core_run(retro_time_t usec)
+{
+   benchmark_step_t *step = NULL;
+
+   if (!benchmark_st || !(step = benchmark_step_current(benchmark_st)))
+      return;
+
+   rarch_histogram_add(&step->core_run, usec);
+}
@@ -0,0 +1,82 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <features/features_cpu.h>
+
+#include "input/input_types.h"
+
+RETRO_BEGIN_DECLS
+
+/* Benchmark mode: replays a script of button presses, one action
+ * per line, timing the steps it's split into:
+ *
+ *    # comment
+ *    step <name>             ends the current step, starts another
+ *    press <button> [count]  presses and releases, one frame each
+ *    hold <button> <frames>
+ *    wait <frames>
+ *    run <frames>            as fast as the content goes, with the
+ *                            fast forward key held
+ *    idle [seconds]          until no task runs and nothing in the
+ *                            menu moves, 30 seconds at most
+ *    quit
+ *
+ * Buttons are up, down, left, right, a, b, x, y, l, r, l2, r2,
+ * l3, r3, start, select, menu (toggle), pause and fast_forward.
+ * Everything until the first step is the "boot" step, timed from
+ * benchmark_init(). When the script ends, how long each step took,
+ * its frame rate, frame and core run times are written out as JSON,
+ * along with the stage timings, performance counters and peak
+ * memory use. */
+
+/**
+ * benchmark_init:
+ * @script             : Path of the script, NULL to only run
+ *                       the content.
+ * @frames             : Without a script, frames to run the
+ *                       content for.
+ * @out                : Path of the JSON report.
+ *
+ * Returns: true if the script was read.
+ **/
+bool benchmark_init(const char *script, unsigned frames, const char *out);
+
+void benchmark_deinit(void);
+
+bool benchmark_is_active(void);
+
+/**
+ * benchmark_frame:
+ * @bits               : Buttons of this frame, the script's are
+ *                       added.
+ *
+ * Once per frame, with the input.
+ *
+ * Returns: false once the script is done and the report
+ * written.
+ **/
+bool benchmark_frame(input_bits_t *bits);
+
+/* Time a frame of the core took, without waiting for vsync */
+void benchmark_core_run(retro_time_t usec);
+
+RETRO_END_DECLS
+
+#endif
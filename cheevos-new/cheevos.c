@@ -26,6 +26,7 @@
 #include <rhash.h>
 #include <retro_miscellaneous.h>
 #include <retro_math.h>
+#include <retro_timers.h>
 #include <net/net_http.h>
 #include <libretro.h>
 
@@ -45,6 +46,11 @@
 #include <rthreads/rthreads.h>
 #endif
 
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#include <sys/mman.h>
+#define CHEEVOS_MUNMAP
+#endif
+
 #include "badges.h"
 #include "cheevos.h"
 #include "fixup.h"
@@ -103,6 +109,9 @@ typedef struct
    const rcheevos_racheevo_t* info;
    int active;
    int last;
+   /* Memrefs changed on the last frame, or are read through AddAddress */
+   int changed;
+   int indirect;
 } rcheevos_cheevo_t;
 
 typedef struct
@@ -119,6 +128,10 @@ typedef struct
    retro_task_t* task;
 #ifdef HAVE_THREADS
    slock_t* task_lock;
+   /* Loads on a thread of its own rather than in a task, so that
+    * hashing doesn't take turns with the other tasks */
+   sthread_t* thread;
+   volatile bool thread_cancel;
 #endif
 
    bool core_supports;
@@ -157,6 +170,8 @@ static rcheevos_locals_t rcheevos_locals =
    NULL, /* task */
 #ifdef HAVE_THREADS
    NULL, /* task_lock */
+   NULL, /* thread */
+   false,/* thread_cancel */
 #endif
    true, /* core_supports */
    false,/* invalid_peek_address */
@@ -370,6 +385,34 @@ static const char* rcheevos_rc_error(int ret)
    }
 }
 
+static int rcheevos_has_indirect_memref(const rc_memref_value_t* memrefs)
+{
+   const rc_memref_value_t* memref = memrefs;
+   while (memref != NULL)
+   {
+      if (memref->memref.is_indirect)
+         return 1;
+
+      memref = memref->next;
+   }
+
+   return 0;
+}
+
+/* Resolves the addresses when loading, rather than on the first frame
+ * they're read. AddAddress ones are only known when evaluating. */
+static void rcheevos_resolve_memrefs(const rc_memref_value_t* memref)
+{
+   while (memref != NULL)
+   {
+      if (!memref->memref.is_indirect)
+         rcheevos_fixup_find(&rcheevos_locals.fixups,
+            memref->memref.address, rcheevos_locals.patchdata.console_id);
+
+      memref = memref->next;
+   }
+}
+
 static int rcheevos_parse(const char* json)
 {
    char buffer[256];
@@ -381,6 +424,7 @@ static int rcheevos_parse(const char* json)
    rcheevos_cheevo_t* cheevo = NULL;
    rcheevos_lboard_t* lboard = NULL;
    rcheevos_racheevo_t* rac  = NULL;
+   bool resolve              = true;
 
    rcheevos_fixup_init(&rcheevos_locals.fixups);
 
@@ -425,6 +469,7 @@ static int rcheevos_parse(const char* json)
          core_get_memory(&meminfo);
 
          delay_judgment |= (meminfo.size > 0);
+         resolve = false;
       }
       else
       {
@@ -512,6 +557,11 @@ static int rcheevos_parse(const char* json)
          rc_parse_trigger(cheevo->trigger, cheevo->info->memaddr, NULL, 0);
          cheevo->active = RCHEEVOS_ACTIVE_SOFTCORE | RCHEEVOS_ACTIVE_HARDCORE;
          cheevo->last = 1;
+         cheevo->changed = 1;
+         cheevo->indirect = rcheevos_has_indirect_memref(cheevo->trigger->memrefs);
+
+         if (resolve)
+            rcheevos_resolve_memrefs(cheevo->trigger->memrefs);
       }
    }
 
@@ -549,6 +599,9 @@ static int rcheevos_parse(const char* json)
       lboard->active = false;
       lboard->last_value = 0;
       lboard->format = rc_parse_format(lboard->info->format);
+
+      if (resolve)
+         rcheevos_resolve_memrefs(lboard->lboard->memrefs);
    }
 
    return 0;
@@ -711,20 +764,6 @@ static unsigned rcheevos_peek(unsigned address, unsigned num_bytes, void* ud)
    return value;
 }
 
-static int rcheevos_has_indirect_memref(const rc_memref_value_t* memrefs)
-{
-   const rc_memref_value_t* memref = memrefs;
-   while (memref != NULL)
-   {
-      if (memref->memref.is_indirect)
-         return 1;
-
-      memref = memref->next;
-   }
-
-   return 0;
-}
-
 static void rcheevos_test_cheevo_set(bool official)
 {
    settings_t *settings = config_get_ptr();
@@ -753,7 +792,17 @@ static void rcheevos_test_cheevo_set(bool official)
       /* Check if the achievement is active for the current mode. */
       if (cheevo->active & mode)
       {
-         int valid = rc_test_trigger(cheevo->trigger, rcheevos_peek, NULL, NULL);
+         int valid;
+         int changed = rc_update_trigger_memrefs(cheevo->trigger, rcheevos_peek, NULL);
+
+         /* with the same memory as the last two frames and no hits, the
+          * outcome can't change: it's still false, skip evaluating it */
+         if (     !changed && !cheevo->changed && !cheevo->last
+               && !cheevo->indirect && !cheevo->trigger->has_hits)
+            continue;
+
+         cheevo->changed = changed;
+         valid = rc_test_trigger_updated(cheevo->trigger, rcheevos_peek, NULL, NULL);
 
          /* trigger must be false for at least one frame before it can trigger. if last is true, the trigger hasn't yet been false. */
          if (cheevo->last)
@@ -1103,6 +1152,16 @@ bool rcheevos_unload(void)
    bool running = false;
    unsigned i = 0, count = 0;
 
+#ifdef HAVE_THREADS
+   if (rcheevos_locals.thread)
+   {
+      CHEEVOS_LOG(RCHEEVOS_TAG "Asked the load thread to terminate\n");
+      rcheevos_locals.thread_cancel = true;
+      sthread_join(rcheevos_locals.thread);
+      rcheevos_locals.thread = NULL;
+   }
+#endif
+
    CHEEVOS_LOCK(rcheevos_locals.task_lock);
    running = rcheevos_locals.task != NULL;
    CHEEVOS_UNLOCK(rcheevos_locals.task_lock);
@@ -1327,6 +1386,12 @@ typedef struct
    cdfs_track_t *track;
    cdfs_file_t cdfp;
 
+   /* the content as loaded for the core, handed over rather than copied */
+   bool data_mapped;
+   size_t data_size;
+   /* running on its own thread, nothing else to yield to */
+   bool threaded;
+
    /* co-routine required fields */
    CORO_FIELDS
 } rcheevos_coro_t;
@@ -1355,6 +1420,19 @@ enum
    RCHEEVOS_BUFFER_FILE  = -19
 };
 
+static void rcheevos_free_data(rcheevos_coro_t* coro)
+{
+#ifdef CHEEVOS_MUNMAP
+   if (coro->data_mapped)
+      munmap(coro->data, coro->data_size);
+   else
+#endif
+      free(coro->data);
+
+   coro->data        = NULL;
+   coro->data_mapped = false;
+}
+
 static int rcheevos_prepare_hash_psx(rcheevos_coro_t* coro)
 {
    char exe_name_buffer[64];
@@ -1448,7 +1526,7 @@ static int rcheevos_prepare_hash_psx(rcheevos_coro_t* coro)
           * standard way. include the boot executable name in the hash */
          coro->count += exe_name_size;
 
-         free(coro->data);
+         rcheevos_free_data(coro);
          coro->data = (uint8_t*)malloc(coro->count);
          memcpy(coro->data, exe_name_buffer, exe_name_size);
          coro->len = exe_name_size;
@@ -1483,9 +1561,12 @@ static int rcheevos_prepare_hash_nintendo_ds(rcheevos_coro_t* coro)
 {
   intfstream_t* stream;
   unsigned char header[512];
-  int success = 0;
 
-  stream = intfstream_open_file(coro->path, RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+  if (coro->data)
+     stream = intfstream_open_memory(coro->data, RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE, coro->len);
+  else
+     stream = intfstream_open_file(coro->path, RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
   if (stream)
   {
      if (intfstream_read(stream, header, sizeof(header)) == 512)
@@ -1515,19 +1596,18 @@ static int rcheevos_prepare_hash_nintendo_ds(rcheevos_coro_t* coro)
         }
         else
         {
-           if (coro->data)
-              free(coro->data);
-
-           coro->data = malloc(hash_size);
-           if (!coro->data)
+           /* the stream could be reading from coro->data */
+           uint8_t* hash_data = (uint8_t*)malloc(hash_size);
+           if (!hash_data)
            {
               CHEEVOS_LOG(RCHEEVOS_TAG "failed to allocate %u bytes", hash_size);
               intfstream_close(stream);
+              CHEEVOS_FREE(stream);
               CORO_STOP();
            }
            else
            {
-              uint8_t* hash_ptr = (uint8_t*)coro->data;
+              uint8_t* hash_ptr = hash_data;
 
               memcpy(hash_ptr, header, 0x160);
               hash_ptr += 0x160;
@@ -1543,16 +1623,22 @@ static int rcheevos_prepare_hash_nintendo_ds(rcheevos_coro_t* coro)
               intfstream_seek(stream, icon_addr + offset, RETRO_VFS_SEEK_POSITION_START);
               intfstream_read(stream, hash_ptr, 0xA00);
 
+              intfstream_close(stream);
+              CHEEVOS_FREE(stream);
+
+              rcheevos_free_data(coro);
+              coro->data = hash_data;
               coro->len = hash_size;
-              success = 1;
+              return 1;
            }
         }
      }
 
      intfstream_close(stream);
+     CHEEVOS_FREE(stream);
   }
 
-  return success;
+  return 0;
 }
 
 static int rcheevos_iterate(rcheevos_coro_t* coro)
@@ -1890,7 +1976,7 @@ found:
          for (;;)
          {
             ptr      = (uint8_t*)coro->data + coro->len;
-            to_read  = 8192;
+            to_read  = coro->threaded ? CHEEVOS_MB(1) : 8192;
 
             if (to_read > coro->count)
                to_read = coro->count;
@@ -2038,7 +2124,7 @@ found:
          if (cdfs_open_file(&coro->cdfp, coro->track, NULL))
          {
             coro->count = 512;
-            free(coro->data);
+            rcheevos_free_data(coro);
             coro->data = (uint8_t*)malloc(coro->count);
             cdfs_read_file(&coro->cdfp, coro->data, coro->count);
             coro->len = coro->count;
@@ -2105,7 +2191,7 @@ found:
             }
 
             coro->count = to_read + 22;
-            free(coro->data);
+            rcheevos_free_data(coro);
             coro->data = (uint8_t*)malloc(coro->count);
             memcpy(coro->data, &buffer[106], 22);
 
@@ -2515,6 +2601,9 @@ found:
 
          do
          {
+            if (coro->threaded)
+               retro_sleep(10);
+
             CORO_YIELD();
             t1 = cpu_features_get_time_usec();
          }while ((t1 - coro->t0) < 3000000);
@@ -2698,23 +2787,44 @@ static void rcheevos_task_handler(retro_task_t *task)
          CHEEVOS_LOG(RCHEEVOS_TAG "Load task finished\n");
       }
 
-      CHEEVOS_FREE(coro->data);
+      rcheevos_free_data(coro);
       CHEEVOS_FREE(coro->path);
       CHEEVOS_FREE(coro);
    }
 }
 
-bool rcheevos_load(const void *data)
+#ifdef HAVE_THREADS
+static void rcheevos_load_thread(void *data)
 {
-   retro_task_t *task;
-   const struct retro_game_info *info = NULL;
-   rcheevos_coro_t *coro              = NULL;
+   rcheevos_coro_t *coro = (rcheevos_coro_t*)data;
+
+   while (!rcheevos_locals.thread_cancel && rcheevos_iterate(coro)) {}
+
+   if (rcheevos_locals.thread_cancel)
+   {
+      CHEEVOS_LOG(RCHEEVOS_TAG "Load thread cancelled\n");
+   }
+   else
+   {
+      CHEEVOS_LOG(RCHEEVOS_TAG "Load thread finished\n");
+   }
+
+   rcheevos_free_data(coro);
+   CHEEVOS_FREE(coro->path);
+   CHEEVOS_FREE(coro);
+}
+#endif
+
+bool rcheevos_load(struct retro_game_info *info, bool *mapped)
+{
+   retro_task_t *task            = NULL;
+   rcheevos_coro_t *coro         = NULL;
    char buffer[32];
 
    rcheevos_loaded = false;
    rcheevos_hardcore_paused = false;
 
-   if (!rcheevos_locals.core_supports || !data)
+   if (!rcheevos_locals.core_supports || !info)
    {
       rcheevos_hardcore_paused = true;
       return false;
@@ -2725,6 +2835,17 @@ bool rcheevos_load(const void *data)
    if (!coro)
       return false;
 
+#ifdef HAVE_THREADS
+   /* a load still going would be for the last content */
+   if (rcheevos_locals.thread)
+   {
+      rcheevos_locals.thread_cancel = true;
+      sthread_join(rcheevos_locals.thread);
+      rcheevos_locals.thread = NULL;
+   }
+
+   coro->threaded = true;
+#else
    task = task_init();
 
    if (!task)
@@ -2732,31 +2853,28 @@ bool rcheevos_load(const void *data)
       CHEEVOS_FREE(coro);
       return false;
    }
+#endif
 
    CORO_SETUP();
 
-   info = (const struct retro_game_info*)data;
    strlcpy(buffer, path_get_extension(info->path), sizeof(buffer));
 
    if (info->data)
    {
-      coro->len = info->size;
+      /* The core is done with it, take it over rather than copying it */
+      coro->data        = (void*)info->data;
+      coro->data_size   = info->size;
+      coro->data_mapped = mapped && *mapped;
+      coro->len         = info->size;
+      coro->path        = NULL;
+
+      info->data        = NULL;
+      if (mapped)
+         *mapped        = false;
 
       /* size limit */
       if (coro->len > CHEEVOS_MB(64))
          coro->len = CHEEVOS_MB(64);
-
-      coro->data = malloc(coro->len);
-
-      if (!coro->data)
-      {
-         CHEEVOS_FREE(task);
-         CHEEVOS_FREE(coro);
-         return false;
-      }
-
-      memcpy(coro->data, info->data, coro->len);
-      coro->path       = NULL;
    }
    else
    {
@@ -2801,6 +2919,26 @@ bool rcheevos_load(const void *data)
    coro->ext_hash = rcheevos_djb2(buffer, strlen(buffer));
    CHEEVOS_LOG(RCHEEVOS_TAG "ext_hash %08x ('%s')\n", coro->ext_hash, buffer);
 
+#ifdef HAVE_THREADS
+   rcheevos_locals.thread_cancel = false;
+   rcheevos_locals.thread        = sthread_create(rcheevos_load_thread, coro);
+
+   if (rcheevos_locals.thread)
+      return true;
+
+   /* no thread, fall back to the task */
+   coro->threaded = false;
+   task           = task_init();
+
+   if (!task)
+   {
+      rcheevos_free_data(coro);
+      CHEEVOS_FREE(coro->path);
+      CHEEVOS_FREE(coro);
+      return false;
+   }
+#endif
+
    task->handler   = rcheevos_task_handler;
    task->state     = (void*)coro;
    task->mute      = true;
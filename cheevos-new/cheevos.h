@@ -20,6 +20,7 @@
 #include <stdlib.h>
 
 #include <boolean.h>
+#include <libretro.h>
 
 #include "../verbosity.h"
 
@@ -40,7 +41,10 @@ enum
    RCHEEVOS_ACTIVE_HARDCORE = 1 << 1
 };
 
-bool rcheevos_load(const void *data);
+/* Identifies the content and loads its achievements in the background.
+ * Content loaded in memory is taken over for hashing, info->data is
+ * cleared and *mapped too (it's unmapped rather than freed then). */
+bool rcheevos_load(struct retro_game_info *info, bool *mapped);
 
 void rcheevos_reset_game(void);
 
@@ -22,23 +22,46 @@
 
 #include "../deps/rcheevos/include/rcheevos.h"
 
-static int rcheevos_cmpaddr(const void* e1, const void* e2)
+static unsigned rcheevos_fixup_hash(unsigned address, unsigned mask)
 {
-   const rcheevos_fixup_t* f1 = (const rcheevos_fixup_t*)e1;
-   const rcheevos_fixup_t* f2 = (const rcheevos_fixup_t*)e2;
+   return ((address ^ (address >> 16)) * 0x45d9f3bU) & mask;
+}
 
-   if (f1->address < f2->address)
-   {
-      return -1;
-   }
-   else if (f1->address > f2->address)
+static rcheevos_fixup_t* rcheevos_fixup_slot(rcheevos_fixup_t* elements,
+      unsigned capacity, unsigned address)
+{
+   unsigned mask = capacity - 1;
+   unsigned i    = rcheevos_fixup_hash(address, mask);
+
+   while (elements[i].used && elements[i].address != address)
+      i = (i + 1) & mask;
+
+   return &elements[i];
+}
+
+static bool rcheevos_fixup_grow(rcheevos_fixups_t* fixups)
+{
+   unsigned i;
+   unsigned new_capacity = fixups->capacity == 0 ? 64 : fixups->capacity * 2;
+   rcheevos_fixup_t* new_elements = (rcheevos_fixup_t*)
+      calloc(new_capacity, sizeof(rcheevos_fixup_t));
+
+   if (new_elements == NULL)
    {
-      return 1;
+      return false;
    }
-   else
+
+   for (i = 0; i < fixups->capacity; i++)
    {
-      return 0;
+      if (fixups->elements[i].used)
+         *rcheevos_fixup_slot(new_elements, new_capacity,
+               fixups->elements[i].address) = fixups->elements[i];
    }
+
+   CHEEVOS_FREE(fixups->elements);
+   fixups->elements = new_elements;
+   fixups->capacity = new_capacity;
+   return true;
 }
 
 static size_t rcheevos_var_reduce(size_t addr, size_t mask)
@@ -68,7 +91,6 @@ void rcheevos_fixup_init(rcheevos_fixups_t* fixups)
 {
    fixups->elements = NULL;
    fixups->capacity = fixups->count = 0;
-   fixups->dirty = false;
 }
 
 void rcheevos_fixup_destroy(rcheevos_fixups_t* fixups)
@@ -79,45 +101,34 @@ void rcheevos_fixup_destroy(rcheevos_fixups_t* fixups)
 
 const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address, int console)
 {
-   rcheevos_fixup_t key;
    rcheevos_fixup_t* found;
-   const uint8_t* location;
 
-   if (fixups->dirty)
+   if (fixups->capacity != 0)
    {
-      qsort(fixups->elements, fixups->count, sizeof(rcheevos_fixup_t), rcheevos_cmpaddr);
-      fixups->dirty = false;
-   }
-
-   key.address = address;
-   found = (rcheevos_fixup_t*)bsearch(&key, fixups->elements, fixups->count, sizeof(rcheevos_fixup_t), rcheevos_cmpaddr);
+      found = rcheevos_fixup_slot(fixups->elements, fixups->capacity, address);
 
-   if (found != NULL)
-   {
-      return found->location;
+      if (found->used)
+      {
+         return found->location;
+      }
    }
 
-   if (fixups->count == fixups->capacity)
+   /* Kept under half full so that probes stay short */
+   if ((fixups->count + 1) * 2 > fixups->capacity)
    {
-      unsigned new_capacity = fixups->capacity == 0 ? 16 : fixups->capacity * 2;
-      rcheevos_fixup_t* new_elements = (rcheevos_fixup_t*)
-         realloc(fixups->elements, new_capacity * sizeof(rcheevos_fixup_t));
-
-      if (new_elements == NULL)
+      if (!rcheevos_fixup_grow(fixups))
       {
          return NULL;
       }
-
-      fixups->elements = new_elements;
-      fixups->capacity = new_capacity;
    }
 
-   fixups->elements[fixups->count].address = address;
-   fixups->elements[fixups->count++].location = location =
-      rcheevos_patch_address(address, console);
-   fixups->dirty = true;
+   found = rcheevos_fixup_slot(fixups->elements, fixups->capacity, address);
+   found->address  = address;
+   found->location = rcheevos_patch_address(address, console);
+   found->used     = true;
+   fixups->count++;
 
-   return location;
+   return found->location;
 }
 
 const uint8_t* rcheevos_patch_address(unsigned address, int console)
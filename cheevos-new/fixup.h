@@ -27,13 +27,14 @@ typedef struct
 {
    unsigned address;
    const uint8_t* location;
+   bool used;
 } rcheevos_fixup_t;
 
+/* Open addressing on the address, capacity is a power of two */
 typedef struct
 {
    rcheevos_fixup_t* elements;
    unsigned capacity, count;
-   bool dirty;
 } rcheevos_fixups_t;
 
 void rcheevos_fixup_init(rcheevos_fixups_t* fixups);
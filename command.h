@@ -202,6 +202,8 @@ enum event_command
    CMD_EVENT_DISCORD_UPDATE,
    CMD_EVENT_OSK_TOGGLE,
    CMD_EVENT_RECORDING_TOGGLE,
+   /* Measures Run-Ahead costs when content resumes. */
+   CMD_EVENT_RUNAHEAD_BENCHMARK,
    CMD_EVENT_STREAMING_TOGGLE,
    CMD_EVENT_AI_SERVICE_TOGGLE,
    CMD_EVENT_BSV_RECORDING_TOGGLE,
@@ -253,6 +253,21 @@
 #endif
 #define DEFAULT_CHECK_FIRMWARE_BEFORE_LOADING false
 
+/* Map content files for cores to read instead of reading
+ * them into memory first. */
+#define DEFAULT_CONTENT_MMAP_ENABLE true
+
+/* Read ahead of files cores read sequentially through the VFS. */
+#define DEFAULT_VFS_PREFETCH_ENABLE true
+
+/* Leave the last core loaded when it's unloaded, for loading it
+ * again to be quicker. Not all cores can be started again so. */
+#define DEFAULT_CORE_WARM_START false
+
+/* Read the content of the playlist entry selected in the menu,
+ * and its core, ahead of it being launched. */
+#define DEFAULT_CONTENT_PRELOAD false
+
 /* Forcibly disable composition.
  * Only valid on Windows Vista/7/8 for now. */
 #define DEFAULT_DISABLE_COMPOSITION false
@@ -280,6 +295,30 @@
  */
 #define DEFAULT_FRAME_DELAY 0
 
+/* Tunes the frame delay every frame from the measured core
+ * and present times. Only supported by the KMS context,
+ * other contexts keep using the fixed frame delay.
+ */
+#define DEFAULT_FRAME_DELAY_AUTO false
+
+/* Drops the video output of frames while the audio buffer is
+ * filled below video_frameskip_auto_threshold percent (or while
+ * frames take longer than the refresh period, without audio rate
+ * control), so cores too slow for the CPU keep their speed and
+ * audio. Cores told of the buffer through
+ * RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK skip frames
+ * themselves instead.
+ */
+#define DEFAULT_FRAMESKIP_AUTO false
+
+#define DEFAULT_FRAMESKIP_AUTO_THRESHOLD 33
+
+/* Compares each software frame with the previous one and
+ * handles identical frames like frames duped by the core,
+ * skipping their upload and softfilter pass.
+ */
+#define DEFAULT_FRAME_DUPE_DETECT false
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -315,6 +354,15 @@
 /* Set to true if HW render cores should get their private context. */
 #define DEFAULT_VIDEO_SHARED_CONTEXT false
 
+/* KMS context: render pre-rotated into a native orientation
+ * surface instead of letting the RGA rotate every frame. */
+#define DEFAULT_VIDEO_KMS_PREROTATE false
+
+/* KMS context: color depth of the render target.
+ * 16 or 32. 0 picks 16 for software cores outputting
+ * RGB565, and 32 otherwise. */
+#define DEFAULT_VIDEO_KMS_COLOR_DEPTH 0
+
 /* Sets GC/Wii screen width. */
 #define DEFAULT_VIDEO_VI_WIDTH 640
 
@@ -347,6 +395,10 @@
 
 #define DEFAULT_SHADER_DELAY 0
 
+/* Lower shader preset FBO formats and pass scale when the
+ * GPU can't keep up, and restore them when it can again. */
+#define DEFAULT_SHADER_ADAPTIVE false
+
 /* Only scale in integer steps.
  * The base size depends on system-reported geometry and aspect ratio.
  * If video_force_aspect is not set, X/Y will be integer scaled independently.
@@ -564,6 +616,17 @@ static const float menu_header_opacity = 1.000;
 #define DEFAULT_MENU_SHADER_PIPELINE 2
 #endif
 
+/* Size the XMB background effects are drawn at, in percent of
+ * the output size, scaled up from there */
+#define DEFAULT_MENU_SHADER_PIPELINE_SCALE 50
+
+/* Rate the XMB background effects are drawn at while nothing
+ * in the menu moves, 0 for every frame */
+#define DEFAULT_MENU_SHADER_PIPELINE_IDLE_FPS 20
+
+/* Draw the XMB background effects once and keep them still */
+#define DEFAULT_MENU_SHADER_PIPELINE_FREEZE false
+
 #define DEFAULT_SHOW_ADVANCED_SETTINGS false
 
 #define DEFAULT_RGUI_COLOR_THEME RGUI_THEME_CLASSIC_GREEN
@@ -640,6 +703,14 @@ static const unsigned input_backtouch_toggle       = false;
 
 #define DEFAULT_LOG_TO_FILE_TIMESTAMP false
 
+/* Record a timeline of every frame and write it to
+ * retroarch_trace.json in the log directory on exit. */
+#define DEFAULT_TRACE_ENABLE false
+
+/* Follow button presses to the screen and log how long
+ * each stage took. */
+#define DEFAULT_LATENCY_TEST_ENABLE false
+
 /* Crop overscanned frames. */
 #define DEFAULT_CROP_OVERSCAN true
 
@@ -682,9 +753,24 @@ static const float message_bgcolor_opacity = 1.0f;
 /* Record post-shaded GPU output instead of raw game footage if available. */
 #define DEFAULT_GPU_RECORD false
 
+/* Record H.264 with the SoC's encoder when FFmpeg has one for it,
+ * falling back to libx264 */
+#define DEFAULT_VIDEO_RECORD_HW_ENCODER true
+
+/* Tune local and custom streams for latency: intra refresh instead
+ * of keyframes, no B-frames, slices, and a bit rate that backs off
+ * when the encoder or the network can't keep up */
+#define DEFAULT_VIDEO_STREAM_LOW_LATENCY false
+
 /* OSD-messages. */
 #define DEFAULT_FONT_ENABLE true
 
+/* Draw text from one distance field atlas per font, shared
+ * by all its sizes, rather than one atlas per size.
+ * Only supported by the gl video driver with GLSL shaders,
+ * when it isn't threaded. */
+#define DEFAULT_FONT_SDF false
+
 /* The accurate refresh rate of your monitor (Hz).
  * This is used to calculate audio input rate with the formula:
  * audio_input_rate = game_input_rate * display_refresh_rate /
@@ -765,10 +851,22 @@ static const bool audio_enable_menu_bgm    = false;
 #define DEFAULT_RATE_CONTROL false
 #endif
 
+/* Resample and output audio in 16-bit integer when
+ * neither a DSP filter nor the audio mixer is in use. */
+#define DEFAULT_AUDIO_FIXED_POINT false
+
+/* Run the DSP filter, resampler and mixer on a worker
+ * thread instead of in the core's audio callbacks. */
+#define DEFAULT_AUDIO_WORKER_THREAD false
+
 /* Rate control delta. Defines how much rate_control
  * is allowed to adjust input rate. */
 #define DEFAULT_RATE_CONTROL_DELTA  0.005
 
+/* Time rate control keeps queued in the audio driver, in
+ * milliseconds. 0 is half of the driver's buffer. */
+#define DEFAULT_RATE_CONTROL_TARGET 0
+
 /* Maximum timing skew. Defines how much adjust_system_rates
  * is allowed to adjust input rate. */
 #define DEFAULT_MAX_TIMING_SKEW  0.05
@@ -787,6 +885,12 @@ static const bool audio_enable_menu_bgm    = false;
 #define DEFAULT_WASAPI_SH_BUFFER_LENGTH -16
 #endif
 
+#ifdef HAVE_ALSA
+/* Use mmap access, periods of a frame's worth of audio
+ * and no period interrupts where the device allows it. */
+#define DEFAULT_ALSA_LOW_LATENCY false
+#endif
+
 /* MISC */
 
 /* Enables displaying the current frames per second. */
@@ -808,6 +912,10 @@ static const bool audio_enable_menu_bgm    = false;
  * depending on the save state buffer. */
 #define DEFAULT_REWIND_ENABLE false
 
+/* Compresses rewind states on a worker thread, leaving
+ * only the serialization of the core on the main thread. */
+#define DEFAULT_REWIND_WORKER_THREAD false
+
 /* When set, any time a cheat is toggled it is immediately applied. */
 #define DEFAULT_APPLY_CHEATS_AFTER_TOGGLE false
 
@@ -824,6 +932,12 @@ static const bool audio_enable_menu_bgm    = false;
 /* How many frames to rewind at a time. */
 #define DEFAULT_REWIND_GRANULARITY 1
 
+/* Levels of rewind history, splitting the buffer between them.
+ * Every level past the first keeps every DEFAULT_REWIND_LEVEL_STRIDE-th
+ * state of the one before, so older history is kept coarser. */
+#define DEFAULT_REWIND_LEVELS 1
+#define DEFAULT_REWIND_LEVEL_STRIDE 30
+
 /* Pause gameplay when gameplay loses focus. */
 #ifdef EMSCRIPTEN
 #define DEFAULT_PAUSE_NONACTIVE false
@@ -862,6 +976,18 @@ static const bool netplay_client_swap_input = true;
 
 static const bool netplay_nat_traversal = false;
 
+/* Also send input over UDP, repeating that of previous
+ * frames, so that lost packets don't delay it. */
+static const bool netplay_udp_input = false;
+
+/* When hosting, send to spectators from a thread of
+ * its own instead of the emulation thread. */
+static const bool netplay_spectator_relay = false;
+
+/* Record the input of netplay sessions, to find desyncs
+ * by running them again later. */
+static const bool netplay_record_inputs = false;
+
 static const unsigned netplay_delay_frames = 16;
 
 static const int netplay_check_frames = 600;
@@ -880,6 +1006,10 @@ static const unsigned netplay_share_analog = RARCH_NETPLAY_SHARE_ANALOG_NO_PREFE
  * This could potentially lead to buggy games. */
 #define DEFAULT_BLOCK_SRAM_OVERWRITE false
 
+/* Autosave into a memory mapped save file, synced to disk
+ * through a journal. */
+#define DEFAULT_AUTOSAVE_MMAP false
+
 /* When saving savestates, state index is automatically
  * incremented before saving.
  * When the content is loaded, state index will be set
@@ -895,12 +1025,25 @@ static const bool savestate_auto_load = false;
 
 static const bool savestate_thumbnail_enable = false;
 
+/* Compress savestate files, which makes them several times
+ * smaller and faster to write to slow storage. States are
+ * detected as compressed or not when loading either way. */
+#define DEFAULT_SAVESTATE_FILE_COMPRESSION true
+
+/* Save only what changed since the last save of a state,
+ * to a patch file next to it. */
+#define DEFAULT_SAVESTATE_FILE_INCREMENTAL false
+
 /* Slowmotion ratio. */
 #define DEFAULT_SLOWMOTION_RATIO 3.0
 
 /* Maximum fast forward ratio. */
 #define DEFAULT_FASTFORWARD_RATIO 0.0
 
+/* Fast forward shows frames at most at the refresh rate,
+ * the ones in between aren't drawn. */
+#define DEFAULT_FASTFORWARD_FRAMESKIP true
+
 /* Enable runloop for variable refresh rate screens. Force x1 speed while handling fast forward too. */
 #define DEFAULT_VRR_RUNLOOP_ENABLE false
 
@@ -913,6 +1056,11 @@ static const bool savestate_thumbnail_enable = false;
 /* Hide warning messages when using the Run Ahead feature. */
 #define DEFAULT_RUN_AHEAD_HIDE_WARNINGS false
 
+/* When using the Run Ahead feature without a secondary instance,
+ * keep the core ahead and only redo the frames run ahead when the
+ * input changes. */
+#define DEFAULT_RUN_AHEAD_REUSE_FRAMES true
+
 /* Enable stdin/network command interface. */
 static const bool network_cmd_enable = false;
 static const uint16_t network_cmd_port = 55355;
@@ -964,6 +1112,30 @@ static const unsigned playlist_entry_remove_enable = PLAYLIST_ENTRY_REMOVE_ENABL
 
 #define DEFAULT_PLAYLIST_FUZZY_ARCHIVE_MATCH false
 
+/* Keep binary copies of the playlists in the cache directory,
+ * read instead of the JSON while it's unchanged */
+#define DEFAULT_PLAYLIST_BINARY_CACHE false
+
+/* Append history pushes and playlist updates to a journal next to
+ * the playlist instead of writing all of it each time */
+#define DEFAULT_PLAYLIST_JOURNAL false
+
+/* Keep a binary copy of the core info list in the cache directory,
+ * read instead of the .info files while they are unchanged */
+#define DEFAULT_CORE_INFO_CACHE false
+
+/* Keep decoded copies of menu thumbnails in the cache directory,
+ * read instead of decoding the images while they are unchanged */
+#define DEFAULT_MENU_THUMBNAIL_CACHE false
+
+/* Leave the last frame of XMB and Ozone on screen
+ * instead of drawing frames where nothing changed */
+#define DEFAULT_MENU_SKIP_IDLE_FRAMES true
+
+/* Draw menu widgets into a layer of their own, drawn again
+ * only when they change */
+#define DEFAULT_MENU_WIDGETS_LAYER true
+
 /* Show Menu start-up screen on boot. */
 #define DEFAULT_MENU_SHOW_START_SCREEN true
 
@@ -1005,6 +1177,10 @@ static const unsigned turbo_default_btn   = RETRO_DEVICE_ID_JOYPAD_B;
  * gamepads, plug-and-play style. */
 static const bool input_autodetect_enable = true;
 
+/* Read joypad events from a thread of their own as they
+ * arrive, instead of only when polling (udev only). */
+static const bool input_joypad_thread = false;
+
 /* Show the input descriptors set by the core instead
  * of the default ones. */
 static const bool input_descriptor_label_show = true;
@@ -1061,6 +1237,11 @@ static const bool ui_companion_toggle = false;
  * for over time (ignores core) */
 #define DEFAULT_CONTENT_RUNTIME_LOG_AGGREGATE false
 
+/* Measure how each core+content performs, keep it in its
+ * runtime log and cap frame delay and run-ahead from it
+ * the next time it is loaded */
+#define DEFAULT_CONTENT_PERF_PROFILE false
+
 #define DEFAULT_UI_MENUBAR_ENABLE true
 
 #if defined(__QNX__) || defined(_XBOX1) || defined(_XBOX360) || defined(__CELLOS_LV2__) || (defined(__MACH__) && defined(IOS)) || defined(ANDROID) || defined(WIIU) || defined(HAVE_NEON) || defined(GEKKO) || defined(__ARM_NEON__)
@@ -1081,6 +1262,26 @@ static const unsigned midi_volume = 100;
 /* Only applies to Android 7.0 (API 24) and up */
 static const bool sustained_performance_mode = false;
 
+/* Linux: keep the emulation thread on a core of its own, with
+ * the video, audio and task threads on the other cores. Off by
+ * default, threads a core creates itself inherit the one core. */
+#define DEFAULT_THREAD_AFFINITY_ENABLE false
+
+/* Core for the emulation thread, the last one if out of range */
+#define DEFAULT_THREAD_AFFINITY_MAIN_CPU 3
+
+/* Linux: set CPU and GPU clocks from frame timing, to the lowest
+ * that keeps up. Needs write access to cpufreq and devfreq. */
+#define DEFAULT_FREQUENCY_GOVERNOR_ENABLE false
+
+/* Back rewind, run-ahead and audio buffers, and the memory cores
+ * ask for as hot, with transparent huge pages */
+#define DEFAULT_MEMORY_HUGEPAGES true
+
+/* Lock the same buffers into RAM, so they never swap out. Needs
+ * CAP_IPC_LOCK or a big enough RLIMIT_MEMLOCK. */
+#define DEFAULT_MEMORY_LOCK false
+
 static const bool vibrate_on_keypress        = false;
 static const bool enable_device_vibration    = false;
 
@@ -27,6 +27,7 @@
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
+#include <memmap.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -1322,6 +1323,7 @@ static struct config_path_setting *populate_settings_path(settings_t *settings,
       }
    }
 
+   SETTING_PATH("latency_test_sensor", settings->paths.latency_test_sensor, false, NULL, true);
    SETTING_ARRAY("log_dir", settings->paths.log_dir, true, NULL, true);
 
    *size = count;
@@ -1337,6 +1339,7 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("accessibility_enable", &settings->bools.accessibility_enable, true, DEFAULT_ACCESSIBILITY_ENABLE, false);
    SETTING_BOOL("driver_switch_enable", &settings->bools.driver_switch_enable, true, DEFAULT_DRIVER_SWITCH_ENABLE, false);
    SETTING_BOOL("frame_time_counter_reset_after_fastforwarding", &settings->bools.frame_time_counter_reset_after_fastforwarding, true, false, false);
+   SETTING_BOOL("fastforward_frameskip", &settings->bools.fastforward_frameskip, true, DEFAULT_FASTFORWARD_FRAMESKIP, false);
    SETTING_BOOL("frame_time_counter_reset_after_load_state", &settings->bools.frame_time_counter_reset_after_load_state, true, false, false);
    SETTING_BOOL("frame_time_counter_reset_after_save_state", &settings->bools.frame_time_counter_reset_after_save_state, true, false, false);
    SETTING_BOOL("crt_switch_resolution_use_custom_refresh_rate", &settings->bools.crt_switch_custom_refresh_enable, true, false, false);
@@ -1345,6 +1348,8 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("ui_companion_toggle",           &settings->bools.ui_companion_toggle, false, ui_companion_toggle, false);
    SETTING_BOOL("desktop_menu_enable",           &settings->bools.desktop_menu_enable, true, DEFAULT_DESKTOP_MENU_ENABLE, false);
    SETTING_BOOL("video_gpu_record",              &settings->bools.video_gpu_record, true, DEFAULT_GPU_RECORD, false);
+   SETTING_BOOL("video_record_hw_encoder",       &settings->bools.video_record_hw_encoder, true, DEFAULT_VIDEO_RECORD_HW_ENCODER, false);
+   SETTING_BOOL("video_stream_low_latency",      &settings->bools.video_stream_low_latency, true, DEFAULT_VIDEO_STREAM_LOW_LATENCY, false);
    SETTING_BOOL("input_remap_binds_enable",      &settings->bools.input_remap_binds_enable, true, true, false);
    SETTING_BOOL("all_users_control_menu",        &settings->bools.input_all_users_control_menu, true, DEFAULT_ALL_USERS_CONTROL_MENU, false);
    SETTING_BOOL("menu_swap_ok_cancel_buttons",   &settings->bools.input_menu_swap_ok_cancel_buttons, true, DEFAULT_MENU_SWAP_OK_CANCEL_BUTTONS, false);
@@ -1356,6 +1361,9 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("netplay_stateless_mode",        &settings->bools.netplay_stateless_mode, true, netplay_stateless_mode, false);
    SETTING_OVERRIDE(RARCH_OVERRIDE_SETTING_NETPLAY_STATELESS_MODE);
    SETTING_BOOL("netplay_use_mitm_server",       &settings->bools.netplay_use_mitm_server, true, netplay_use_mitm_server, false);
+   SETTING_BOOL("netplay_udp_input",             &settings->bools.netplay_udp_input, true, netplay_udp_input, false);
+   SETTING_BOOL("netplay_spectator_relay",       &settings->bools.netplay_spectator_relay, true, netplay_spectator_relay, false);
+   SETTING_BOOL("netplay_record_inputs",         &settings->bools.netplay_record_inputs, true, netplay_record_inputs, false);
    SETTING_BOOL("netplay_request_device_p1",     &settings->bools.netplay_request_devices[0], true, false, false);
    SETTING_BOOL("netplay_request_device_p2",     &settings->bools.netplay_request_devices[1], true, false, false);
    SETTING_BOOL("netplay_request_device_p3",     &settings->bools.netplay_request_devices[2], true, false, false);
@@ -1378,6 +1386,15 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("input_descriptor_hide_unbound", &settings->bools.input_descriptor_hide_unbound, true, input_descriptor_hide_unbound, false);
    SETTING_BOOL("load_dummy_on_core_shutdown",   &settings->bools.load_dummy_on_core_shutdown, true, DEFAULT_LOAD_DUMMY_ON_CORE_SHUTDOWN, false);
    SETTING_BOOL("check_firmware_before_loading", &settings->bools.check_firmware_before_loading, true, DEFAULT_CHECK_FIRMWARE_BEFORE_LOADING, false);
+   SETTING_BOOL("core_info_cache",               &settings->bools.core_info_cache, true, DEFAULT_CORE_INFO_CACHE, false);
+   SETTING_BOOL("menu_thumbnail_cache",          &settings->bools.menu_thumbnail_cache, true, DEFAULT_MENU_THUMBNAIL_CACHE, false);
+   SETTING_BOOL("menu_skip_idle_frames",         &settings->bools.menu_skip_idle_frames, true, DEFAULT_MENU_SKIP_IDLE_FRAMES, false);
+   SETTING_BOOL("menu_widgets_layer",            &settings->bools.menu_widgets_layer, true, DEFAULT_MENU_WIDGETS_LAYER, false);
+   SETTING_BOOL("menu_shader_pipeline_freeze",   &settings->bools.menu_xmb_shader_pipeline_freeze, true, DEFAULT_MENU_SHADER_PIPELINE_FREEZE, false);
+   SETTING_BOOL("content_mmap_enable", &settings->bools.content_mmap_enable, true, DEFAULT_CONTENT_MMAP_ENABLE, false);
+   SETTING_BOOL("vfs_prefetch_enable", &settings->bools.vfs_prefetch_enable, true, DEFAULT_VFS_PREFETCH_ENABLE, false);
+   SETTING_BOOL("core_warm_start", &settings->bools.core_warm_start, true, DEFAULT_CORE_WARM_START, false);
+   SETTING_BOOL("content_preload", &settings->bools.content_preload, true, DEFAULT_CONTENT_PRELOAD, false);
    SETTING_BOOL("builtin_mediaplayer_enable",    &settings->bools.multimedia_builtin_mediaplayer_enable, false, false /* TODO */, false);
    SETTING_BOOL("builtin_imageviewer_enable",    &settings->bools.multimedia_builtin_imageviewer_enable, true, true, false);
    SETTING_BOOL("fps_show",                      &settings->bools.video_fps_show, true, DEFAULT_FPS_SHOW, false);
@@ -1387,14 +1404,17 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("ui_menubar_enable",             &settings->bools.ui_menubar_enable, true, DEFAULT_UI_MENUBAR_ENABLE, false);
    SETTING_BOOL("suspend_screensaver_enable",    &settings->bools.ui_suspend_screensaver_enable, true, true, false);
    SETTING_BOOL("rewind_enable",                 &settings->bools.rewind_enable, true, DEFAULT_REWIND_ENABLE, false);
+   SETTING_BOOL("rewind_worker_thread",          &settings->bools.rewind_worker_thread, true, DEFAULT_REWIND_WORKER_THREAD, false);
    SETTING_BOOL("vrr_runloop_enable",            &settings->bools.vrr_runloop_enable, true, DEFAULT_VRR_RUNLOOP_ENABLE, false);
    SETTING_BOOL("apply_cheats_after_toggle",     &settings->bools.apply_cheats_after_toggle, true, DEFAULT_APPLY_CHEATS_AFTER_TOGGLE, false);
    SETTING_BOOL("apply_cheats_after_load",       &settings->bools.apply_cheats_after_load, true, DEFAULT_APPLY_CHEATS_AFTER_LOAD, false);
    SETTING_BOOL("run_ahead_enabled",             &settings->bools.run_ahead_enabled, true, false, false);
    SETTING_BOOL("run_ahead_secondary_instance",  &settings->bools.run_ahead_secondary_instance, true, DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE, false);
    SETTING_BOOL("run_ahead_hide_warnings",       &settings->bools.run_ahead_hide_warnings, true, DEFAULT_RUN_AHEAD_HIDE_WARNINGS, false);
+   SETTING_BOOL("run_ahead_reuse_frames",        &settings->bools.run_ahead_reuse_frames, true, DEFAULT_RUN_AHEAD_REUSE_FRAMES, false);
    SETTING_BOOL("audio_sync",                    &settings->bools.audio_sync, true, DEFAULT_AUDIO_SYNC, false);
    SETTING_BOOL("video_shader_enable",           &settings->bools.video_shader_enable, true, DEFAULT_SHADER_ENABLE, false);
+   SETTING_BOOL("video_shader_adaptive",         &settings->bools.video_shader_adaptive, true, DEFAULT_SHADER_ADAPTIVE, false);
    SETTING_BOOL("video_shader_watch_files",      &settings->bools.video_shader_watch_files, true, DEFAULT_VIDEO_SHADER_WATCH_FILES, false);
 
    /* Let implementation decide if automatic, or 1:1 PAR. */
@@ -1408,6 +1428,10 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("video_force_aspect",            &settings->bools.video_force_aspect, true, DEFAULT_FORCE_ASPECT, false);
    SETTING_BOOL("video_threaded",                video_driver_get_threaded(), true, DEFAULT_VIDEO_THREADED, false);
    SETTING_BOOL("video_shared_context",          &settings->bools.video_shared_context, true, DEFAULT_VIDEO_SHARED_CONTEXT, false);
+   SETTING_BOOL("video_kms_prerotate",           &settings->bools.video_kms_prerotate, true, DEFAULT_VIDEO_KMS_PREROTATE, false);
+   SETTING_BOOL("video_frame_delay_auto",        &settings->bools.video_frame_delay_auto, true, DEFAULT_FRAME_DELAY_AUTO, false);
+   SETTING_BOOL("video_frameskip_auto",          &settings->bools.video_frameskip_auto, true, DEFAULT_FRAMESKIP_AUTO, false);
+   SETTING_BOOL("video_frame_dupe_detect",       &settings->bools.video_frame_dupe_detect, true, DEFAULT_FRAME_DUPE_DETECT, false);
    SETTING_BOOL("auto_screenshot_filename",      &settings->bools.auto_screenshot_filename, true, DEFAULT_AUTO_SCREENSHOT_FILENAME, false);
    SETTING_BOOL("video_force_srgb_disable",      &settings->bools.video_force_srgb_disable, true, false, false);
    SETTING_BOOL("video_fullscreen",              &settings->bools.video_fullscreen, true, DEFAULT_FULLSCREEN, false);
@@ -1435,6 +1459,7 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
 #endif
    SETTING_BOOL("location_allow",                &settings->bools.location_allow, true, false, false);
    SETTING_BOOL("video_font_enable",             &settings->bools.video_font_enable, true, DEFAULT_FONT_ENABLE, false);
+   SETTING_BOOL("video_font_sdf",                &settings->bools.video_font_sdf, true, DEFAULT_FONT_SDF, false);
    SETTING_BOOL("core_updater_auto_extract_archive", &settings->bools.network_buildbot_auto_extract_archive, true, true, false);
    SETTING_BOOL("camera_allow",                  &settings->bools.camera_allow, true, false, false);
    SETTING_BOOL("discord_allow",                  &settings->bools.discord_enable, true, false, false);
@@ -1610,10 +1635,13 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("netplay_nat_traversal",        &settings->bools.netplay_nat_traversal, true, true, false);
 #endif
    SETTING_BOOL("block_sram_overwrite",         &settings->bools.block_sram_overwrite, true, DEFAULT_BLOCK_SRAM_OVERWRITE, false);
+   SETTING_BOOL("autosave_mmap",                &settings->bools.autosave_mmap, true, DEFAULT_AUTOSAVE_MMAP, false);
    SETTING_BOOL("savestate_auto_index",         &settings->bools.savestate_auto_index, true, savestate_auto_index, false);
    SETTING_BOOL("savestate_auto_save",          &settings->bools.savestate_auto_save, true, savestate_auto_save, false);
    SETTING_BOOL("savestate_auto_load",          &settings->bools.savestate_auto_load, true, savestate_auto_load, false);
    SETTING_BOOL("savestate_thumbnail_enable",   &settings->bools.savestate_thumbnail_enable, true, savestate_thumbnail_enable, false);
+   SETTING_BOOL("savestate_file_compression",   &settings->bools.savestate_file_compression, true, DEFAULT_SAVESTATE_FILE_COMPRESSION, false);
+   SETTING_BOOL("savestate_file_incremental",   &settings->bools.savestate_file_incremental, true, DEFAULT_SAVESTATE_FILE_INCREMENTAL, false);
    SETTING_BOOL("history_list_enable",          &settings->bools.history_list_enable, true, DEFAULT_HISTORY_LIST_ENABLE, false);
    SETTING_BOOL("playlist_entry_rename",        &settings->bools.playlist_entry_rename, true, DEFAULT_PLAYLIST_ENTRY_RENAME, false);
    SETTING_BOOL("game_specific_options",        &settings->bools.game_specific_options, true, default_game_specific_options, false);
@@ -1627,11 +1655,17 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("config_save_on_exit",          &settings->bools.config_save_on_exit, true, DEFAULT_CONFIG_SAVE_ON_EXIT, false);
    SETTING_BOOL("show_hidden_files",            &settings->bools.show_hidden_files, true, DEFAULT_SHOW_HIDDEN_FILES, false);
    SETTING_BOOL("input_autodetect_enable",      &settings->bools.input_autodetect_enable, true, input_autodetect_enable, false);
+   SETTING_BOOL("input_joypad_thread",          &settings->bools.input_joypad_thread, true, input_joypad_thread, false);
    SETTING_BOOL("audio_rate_control",           &settings->bools.audio_rate_control, true, DEFAULT_RATE_CONTROL, false);
+   SETTING_BOOL("audio_fixed_point",            &settings->bools.audio_fixed_point, true, DEFAULT_AUDIO_FIXED_POINT, false);
+   SETTING_BOOL("audio_worker_thread",          &settings->bools.audio_worker_thread, true, DEFAULT_AUDIO_WORKER_THREAD, false);
 #ifdef HAVE_WASAPI
    SETTING_BOOL("audio_wasapi_exclusive_mode",  &settings->bools.audio_wasapi_exclusive_mode, true, DEFAULT_WASAPI_EXCLUSIVE_MODE, false);
    SETTING_BOOL("audio_wasapi_float_format",    &settings->bools.audio_wasapi_float_format, true, DEFAULT_WASAPI_FLOAT_FORMAT, false);
 #endif
+#ifdef HAVE_ALSA
+   SETTING_BOOL("audio_alsa_low_latency",       &settings->bools.audio_alsa_low_latency, true, DEFAULT_ALSA_LOW_LATENCY, false);
+#endif
 
    SETTING_BOOL("savestates_in_content_dir",     &settings->bools.savestates_in_content_dir, true, default_savestates_in_content_dir, false);
    SETTING_BOOL("savefiles_in_content_dir",      &settings->bools.savefiles_in_content_dir, true, default_savefiles_in_content_dir, false);
@@ -1643,6 +1677,10 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("video_window_save_positions", &settings->bools.video_window_save_positions, true, false, false);
 
    SETTING_BOOL("sustained_performance_mode",    &settings->bools.sustained_performance_mode, true, sustained_performance_mode, false);
+   SETTING_BOOL("thread_affinity_enable",        &settings->bools.thread_affinity_enable, true, DEFAULT_THREAD_AFFINITY_ENABLE, false);
+   SETTING_BOOL("frequency_governor_enable",     &settings->bools.frequency_governor_enable, true, DEFAULT_FREQUENCY_GOVERNOR_ENABLE, false);
+   SETTING_BOOL("memory_hugepages",              &settings->bools.memory_hugepages, true, DEFAULT_MEMORY_HUGEPAGES, false);
+   SETTING_BOOL("memory_lock",                   &settings->bools.memory_lock, true, DEFAULT_MEMORY_LOCK, false);
 
 #ifdef _3DS
    SETTING_BOOL("video_3ds_lcd_bottom",          &settings->bools.video_3ds_lcd_bottom, true, video_3ds_lcd_bottom, false);
@@ -1651,9 +1689,12 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("playlist_use_old_format",       &settings->bools.playlist_use_old_format, true, playlist_use_old_format, false);
    SETTING_BOOL("content_runtime_log",           &settings->bools.content_runtime_log, true, DEFAULT_CONTENT_RUNTIME_LOG, false);
    SETTING_BOOL("content_runtime_log_aggregate", &settings->bools.content_runtime_log_aggregate, true, DEFAULT_CONTENT_RUNTIME_LOG_AGGREGATE, false);
+   SETTING_BOOL("content_perf_profile",          &settings->bools.content_perf_profile, true, DEFAULT_CONTENT_PERF_PROFILE, false);
    SETTING_BOOL("playlist_show_sublabels",       &settings->bools.playlist_show_sublabels, true, DEFAULT_PLAYLIST_SHOW_SUBLABELS, false);
    SETTING_BOOL("playlist_sort_alphabetical",    &settings->bools.playlist_sort_alphabetical, true, playlist_sort_alphabetical, false);
    SETTING_BOOL("playlist_fuzzy_archive_match",  &settings->bools.playlist_fuzzy_archive_match, true, DEFAULT_PLAYLIST_FUZZY_ARCHIVE_MATCH, false);
+   SETTING_BOOL("playlist_binary_cache",         &settings->bools.playlist_binary_cache, true, DEFAULT_PLAYLIST_BINARY_CACHE, false);
+   SETTING_BOOL("playlist_journal",              &settings->bools.playlist_journal, true, DEFAULT_PLAYLIST_JOURNAL, false);
 
    SETTING_BOOL("quit_press_twice", &settings->bools.quit_press_twice, true, DEFAULT_QUIT_PRESS_TWICE, false);
    SETTING_BOOL("vibrate_on_keypress", &settings->bools.vibrate_on_keypress, true, vibrate_on_keypress, false);
@@ -1667,6 +1708,8 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("log_to_file", &settings->bools.log_to_file, true, DEFAULT_LOG_TO_FILE, false);
    SETTING_OVERRIDE(RARCH_OVERRIDE_SETTING_LOG_TO_FILE);
    SETTING_BOOL("log_to_file_timestamp", &settings->bools.log_to_file_timestamp, true, DEFAULT_LOG_TO_FILE_TIMESTAMP, false);
+   SETTING_BOOL("trace_enable", &settings->bools.trace_enable, true, DEFAULT_TRACE_ENABLE, false);
+   SETTING_BOOL("latency_test_enable", &settings->bools.latency_test_enable, true, DEFAULT_LATENCY_TEST_ENABLE, false);
    SETTING_BOOL("ai_service_enable", &settings->bools.ai_service_enable, DEFAULT_AI_SERVICE_ENABLE, false, false);
    SETTING_BOOL("ai_service_pause",      &settings->bools.ai_service_pause, true, DEFAULT_AI_SERVICE_PAUSE, false);
 
@@ -1749,10 +1792,13 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
    SETTING_UINT("audio_latency",                &settings->uints.audio_latency, false, 0 /* TODO */, false);
    SETTING_UINT("audio_resampler_quality",      &settings->uints.audio_resampler_quality, true, audio_resampler_quality_level, false);
    SETTING_UINT("audio_block_frames",           &settings->uints.audio_block_frames, true, 0, false);
+   SETTING_UINT("audio_rate_control_target",    &settings->uints.audio_rate_control_target, true, DEFAULT_RATE_CONTROL_TARGET, false);
 #ifdef ANDROID
    SETTING_UINT("input_block_timeout",           &settings->uints.input_block_timeout, true, 1, false);
 #endif
    SETTING_UINT("rewind_granularity",           &settings->uints.rewind_granularity, true, DEFAULT_REWIND_GRANULARITY, false);
+   SETTING_UINT("rewind_levels",                &settings->uints.rewind_levels, true, DEFAULT_REWIND_LEVELS, false);
+   SETTING_UINT("rewind_level_stride",          &settings->uints.rewind_level_stride, true, DEFAULT_REWIND_LEVEL_STRIDE, false);
    SETTING_UINT("rewind_buffer_size_step",      &settings->uints.rewind_buffer_size_step, true, DEFAULT_REWIND_BUFFER_SIZE_STEP, false);
    SETTING_UINT("autosave_interval",            &settings->uints.autosave_interval,  true, DEFAULT_AUTOSAVE_INTERVAL, false);
    SETTING_UINT("frontend_log_level",           &settings->uints.frontend_log_level, true, DEFAULT_FRONTEND_LOG_LEVEL, false);
@@ -1822,6 +1868,8 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
    SETTING_UINT("materialui_thumbnail_view_landscape", &settings->uints.menu_materialui_thumbnail_view_landscape, true, DEFAULT_MATERIALUI_THUMBNAIL_VIEW_LANDSCAPE, false);
    SETTING_UINT("materialui_landscape_layout_optimization", &settings->uints.menu_materialui_landscape_layout_optimization, true, DEFAULT_MATERIALUI_LANDSCAPE_LAYOUT_OPTIMIZATION, false);
    SETTING_UINT("menu_shader_pipeline",         &settings->uints.menu_xmb_shader_pipeline, true, DEFAULT_MENU_SHADER_PIPELINE, false);
+   SETTING_UINT("menu_shader_pipeline_scale",   &settings->uints.menu_xmb_shader_pipeline_scale, true, DEFAULT_MENU_SHADER_PIPELINE_SCALE, false);
+   SETTING_UINT("menu_shader_pipeline_idle_fps", &settings->uints.menu_xmb_shader_pipeline_idle_fps, true, DEFAULT_MENU_SHADER_PIPELINE_IDLE_FPS, false);
 #ifdef HAVE_OZONE
    SETTING_UINT("ozone_menu_color_theme",       &settings->uints.menu_ozone_color_theme, true, 1, false);
 #endif
@@ -1835,7 +1883,9 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
    SETTING_UINT("content_history_size",         &settings->uints.content_history_size,   true, default_content_history_size, false);
    SETTING_UINT("video_hard_sync_frames",       &settings->uints.video_hard_sync_frames, true, DEFAULT_HARD_SYNC_FRAMES, false);
    SETTING_UINT("video_frame_delay",            &settings->uints.video_frame_delay,      true, DEFAULT_FRAME_DELAY, false);
+   SETTING_UINT("video_frameskip_auto_threshold", &settings->uints.video_frameskip_auto_threshold, true, DEFAULT_FRAMESKIP_AUTO_THRESHOLD, false);
    SETTING_UINT("video_max_swapchain_images",   &settings->uints.video_max_swapchain_images, true, DEFAULT_MAX_SWAPCHAIN_IMAGES, false);
+   SETTING_UINT("video_kms_color_depth",        &settings->uints.video_kms_color_depth, true, DEFAULT_VIDEO_KMS_COLOR_DEPTH, false);
    SETTING_UINT("video_swap_interval",          &settings->uints.video_swap_interval, true, DEFAULT_SWAP_INTERVAL, false);
    SETTING_UINT("video_rotation",               &settings->uints.video_rotation, true, ORIENTATION_NORMAL, false);
    SETTING_UINT("screen_orientation",           &settings->uints.screen_orientation, true, ORIENTATION_NORMAL, false);
@@ -1880,6 +1930,7 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
    SETTING_UINT("ai_service_source_lang",            &settings->uints.ai_service_source_lang,    0, 0, false);
 
    SETTING_UINT("video_record_threads",            &settings->uints.video_record_threads,    true, DEFAULT_VIDEO_RECORD_THREADS, false);
+   SETTING_UINT("thread_affinity_main_cpu",        &settings->uints.thread_affinity_main_cpu, true, DEFAULT_THREAD_AFFINITY_MAIN_CPU, false);
 
 #ifdef HAVE_LIBNX
    SETTING_UINT("libnx_overclock",  &settings->uints.libnx_overclock, true, SWITCH_DEFAULT_CPU_PROFILE, false);
@@ -2740,6 +2791,8 @@ static bool config_load_file(global_t *global,
    struct config_path_setting *path_settings       = populate_settings_path  (settings, &path_settings_size);
    config_file_t *conf                             = path ? config_file_new_from_path_to_string(path) : open_default_config_file();
 
+   video_driver_info_invalidate();
+
    tmp_str[0] = '\0';
 
    if (!conf)
@@ -3190,6 +3243,9 @@ static bool config_load_file(global_t *global,
 #endif
 
    frontend_driver_set_sustained_performance_mode(settings->bools.sustained_performance_mode);
+   memmap_set_hot_flags(
+           (settings->bools.memory_hugepages ? MEMMAP_HOT_HUGEPAGE : 0)
+         | (settings->bools.memory_lock      ? MEMMAP_HOT_LOCK     : 0));
    recording_driver_update_streaming_url();
 
    if (!config_entry_exists(conf, "user_language"))
@@ -90,12 +90,16 @@ typedef struct settings
       bool video_aspect_ratio_auto;
       bool video_scale_integer;
       bool video_shader_enable;
+      bool video_shader_adaptive;
       bool video_shader_watch_files;
       bool video_threaded;
       bool video_font_enable;
+      bool video_font_sdf;
       bool video_disable_composition;
       bool video_post_filter_record;
       bool video_gpu_record;
+      bool video_record_hw_encoder;
+      bool video_stream_low_latency;
       bool video_gpu_screenshot;
       bool video_allow_rotate;
       bool video_shared_context;
@@ -106,6 +110,10 @@ typedef struct settings
       bool video_memory_show;
       bool video_msg_bgcolor_enable;
       bool video_3ds_lcd_bottom;
+      bool video_kms_prerotate;
+      bool video_frame_delay_auto;
+      bool video_frameskip_auto;
+      bool video_frame_dupe_detect;
 #ifdef HAVE_VIDEO_LAYOUT
       bool video_layout_enable;
 #endif
@@ -122,12 +130,16 @@ typedef struct settings
       bool audio_enable_menu_bgm;
       bool audio_sync;
       bool audio_rate_control;
+      bool audio_fixed_point;
+      bool audio_worker_thread;
       bool audio_wasapi_exclusive_mode;
       bool audio_wasapi_float_format;
+      bool audio_alsa_low_latency;
 
       /* Input */
       bool input_remap_binds_enable;
       bool input_autodetect_enable;
+      bool input_joypad_thread;
       bool input_overlay_enable;
       bool input_overlay_enable_autopreferred;
       bool input_overlay_hide_in_menu;
@@ -145,6 +157,7 @@ typedef struct settings
 
       /* Frame time counter */
       bool frame_time_counter_reset_after_fastforwarding;
+      bool fastforward_frameskip;
       bool frame_time_counter_reset_after_load_state;
       bool frame_time_counter_reset_after_save_state;
 
@@ -202,6 +215,7 @@ typedef struct settings
       bool menu_rgui_swap_thumbnails;
       bool menu_rgui_extended_ascii;
       bool menu_xmb_shadows_enable;
+      bool menu_xmb_shader_pipeline_freeze;
       bool menu_xmb_vertical_thumbnails;
       bool menu_content_show_settings;
       bool menu_content_show_favorites;
@@ -269,6 +283,9 @@ typedef struct settings
       bool netplay_require_slaves;
       bool netplay_stateless_mode;
       bool netplay_nat_traversal;
+      bool netplay_udp_input;
+      bool netplay_spectator_relay;
+      bool netplay_record_inputs;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
 
@@ -321,18 +338,23 @@ typedef struct settings
       bool history_list_enable;
       bool playlist_entry_rename;
       bool rewind_enable;
+      bool rewind_worker_thread;
       bool vrr_runloop_enable;
       bool apply_cheats_after_toggle;
       bool apply_cheats_after_load;
       bool run_ahead_enabled;
       bool run_ahead_secondary_instance;
       bool run_ahead_hide_warnings;
+      bool run_ahead_reuse_frames;
       bool pause_nonactive;
       bool block_sram_overwrite;
+      bool autosave_mmap;
       bool savestate_auto_index;
       bool savestate_auto_save;
       bool savestate_auto_load;
       bool savestate_thumbnail_enable;
+      bool savestate_file_compression;
+      bool savestate_file_incremental;
       bool network_cmd_enable;
       bool stdin_cmd_enable;
       bool keymapper_enable;
@@ -340,6 +362,14 @@ typedef struct settings
       bool network_remote_enable_user[MAX_USERS];
       bool load_dummy_on_core_shutdown;
       bool check_firmware_before_loading;
+      bool core_info_cache;
+      bool menu_thumbnail_cache;
+      bool menu_skip_idle_frames;
+      bool menu_widgets_layer;
+      bool content_mmap_enable;
+      bool vfs_prefetch_enable;
+      bool core_warm_start;
+      bool content_preload;
 
       bool game_specific_options;
       bool auto_overrides_enable;
@@ -365,13 +395,20 @@ typedef struct settings
       bool video_window_save_positions;
 
       bool sustained_performance_mode;
+      bool thread_affinity_enable;
+      bool frequency_governor_enable;
+      bool memory_hugepages;
+      bool memory_lock;
       bool playlist_use_old_format;
       bool content_runtime_log;
       bool content_runtime_log_aggregate;
+      bool content_perf_profile;
 
       bool playlist_sort_alphabetical;
       bool playlist_show_sublabels;
       bool playlist_fuzzy_archive_match;
+      bool playlist_binary_cache;
+      bool playlist_journal;
 
       bool quit_press_twice;
       bool vibrate_on_keypress;
@@ -382,6 +419,8 @@ typedef struct settings
 
       bool log_to_file;
       bool log_to_file_timestamp;
+      bool trace_enable;
+      bool latency_test_enable;
 
       bool scan_without_core_match;
 
@@ -455,6 +494,7 @@ typedef struct settings
       unsigned audio_out_rate;
       unsigned audio_block_frames;
       unsigned audio_latency;
+      unsigned audio_rate_control_target;
 
       unsigned fps_update_interval;
 
@@ -486,6 +526,8 @@ typedef struct settings
       unsigned frontend_log_level;
       unsigned libretro_log_level;
       unsigned rewind_granularity;
+      unsigned rewind_levels;
+      unsigned rewind_level_stride;
       unsigned rewind_buffer_size_step;
       unsigned autosave_interval;
       unsigned network_cmd_port;
@@ -498,9 +540,11 @@ typedef struct settings
       unsigned video_fullscreen_x;
       unsigned video_fullscreen_y;
       unsigned video_max_swapchain_images;
+      unsigned video_kms_color_depth;
       unsigned video_swap_interval;
       unsigned video_hard_sync_frames;
       unsigned video_frame_delay;
+      unsigned video_frameskip_auto_threshold;
       unsigned video_viwidth;
       unsigned video_aspect_ratio_idx;
       unsigned video_rotation;
@@ -538,6 +582,8 @@ typedef struct settings
       unsigned menu_xmb_animation_move_up_down;
       unsigned menu_xmb_layout;
       unsigned menu_xmb_shader_pipeline;
+      unsigned menu_xmb_shader_pipeline_scale;
+      unsigned menu_xmb_shader_pipeline_idle_fps;
       unsigned menu_xmb_alpha_factor;
       unsigned menu_xmb_theme;
       unsigned menu_xmb_color_theme;
@@ -593,6 +639,7 @@ typedef struct settings
       unsigned window_position_height;
 
       unsigned video_record_threads;
+      unsigned thread_affinity_main_cpu;
 
       unsigned libnx_overclock;
       unsigned ai_service_mode;
@@ -714,6 +761,7 @@ typedef struct settings
       char directory_menu_content[PATH_MAX_LENGTH];
       char streaming_title[PATH_MAX_LENGTH];
 
+      char latency_test_sensor[PATH_MAX_LENGTH];
       char log_dir[PATH_MAX_LENGTH];
    } paths;
 
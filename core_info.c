@@ -17,10 +17,13 @@
 
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <string/string_pool.h>
 #include <file/config_file.h>
 #include <file/file_path.h>
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
+#include <streams/file_stream.h>
+#include <encodings/crc32.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -30,11 +33,18 @@
 
 #include "core_info.h"
 #include "file_path_special.h"
+#include "verbosity.h"
 
 #if defined(__WINRT__) || defined(WINAPI_FAMILY) && WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP
 #include "uwp/uwp_func.h"
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_CORE_INFO_CACHE
+#endif
+
 #ifdef HAVE_COMPRESSION
 static const struct string_list *core_info_tmp_list = NULL;
 #endif
@@ -52,6 +62,22 @@ enum compare_op
    COMPARE_OP_GREATER_EQUAL
 };
 
+/* Copies the value of @key into the strings of the list */
+static char *core_info_get_string(core_info_list_t *core_info_list,
+      config_file_t *conf, const char *key, bool intern)
+{
+   char *tmp = NULL;
+   char *str = NULL;
+
+   if (config_get_string(conf, key, &tmp) && !string_is_empty(tmp))
+      str = intern
+         ? string_pool_intern(core_info_list->strings, tmp)
+         : string_pool_strdup(core_info_list->strings, tmp);
+
+   free(tmp);
+   return str;
+}
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -92,64 +118,48 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+static void core_info_resolve_firmware(
+      core_info_list_t *core_info_list,
+      core_info_t *info, config_file_t *config)
 {
-   size_t i;
    unsigned c;
+   unsigned count                  = 0;
+   core_info_firmware_t *firmware  = NULL;
 
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
-
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
+   if (!config_get_uint(config, "firmware_count", &count) || !count)
+      return;
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+   firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
 
-      if (!firmware)
-         continue;
+   if (!firmware)
+      return;
 
-      info->firmware = firmware;
+   info->firmware       = firmware;
+   info->firmware_count = count;
 
-      for (c = 0; c < count; c++)
-      {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
-         tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
-      }
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      bool tmp_bool     = false;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      /* Shared between cores of the same system */
+      info->firmware[c].path = core_info_get_string(core_info_list,
+            config, path_key, true);
+      info->firmware[c].desc = core_info_get_string(core_info_list,
+            config, desc_key, true);
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
    }
 }
 
-static void core_info_list_free(core_info_list_t *core_info_list)
+void core_info_list_free(core_info_list_t *core_info_list)
 {
    size_t i, j;
 
@@ -160,21 +170,7 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    {
       core_info_t *info = (core_info_t*)&core_info_list->list[i];
 
-      free(info->path);
-      free(info->core_name);
-      free(info->systemname);
-      free(info->system_id);
-      free(info->system_manufacturer);
-      free(info->display_name);
-      free(info->display_version);
-      free(info->supported_extensions);
-      free(info->authors);
-      free(info->permissions);
-      free(info->licenses);
-      free(info->categories);
-      free(info->databases);
-      free(info->notes);
-      free(info->required_hw_api);
+      /* The strings are all in core_info_list->strings */
       string_list_free(info->supported_extensions_list);
       string_list_free(info->authors_list);
       string_list_free(info->note_list);
@@ -183,40 +179,26 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
       string_list_free(info->required_hw_api_list);
-      config_file_free((config_file_t*)info->config_data);
-
-      for (j = 0; j < info->firmware_count; j++)
-      {
-         free(info->firmware[j].path);
-         free(info->firmware[j].desc);
-      }
       free(info->firmware);
    }
 
+   string_pool_free(core_info_list->strings);
+   free(core_info_list->cache);
    free(core_info_list->all_ext);
    free(core_info_list->list);
    free(core_info_list);
 }
 
-static config_file_t *core_info_list_iterate(
-      const char *current_path,
-      const char *path_basedir)
+static void core_info_get_info_path(const char *core_path,
+      const char *path_basedir, char *info_path, size_t len)
 {
-   size_t info_path_base_size = PATH_MAX_LENGTH * sizeof(char);
-   char *info_path_base       = NULL;
-   char *info_path            = NULL;
-   config_file_t *conf        = NULL;
-
-   if (!current_path)
-      return NULL;
-
-   info_path_base             = (char*)malloc(info_path_base_size);
+   char info_path_base[PATH_MAX_LENGTH];
 
    info_path_base[0] = '\0';
 
    fill_pathname_base_noext(info_path_base,
-         current_path,
-         info_path_base_size);
+         core_path,
+         sizeof(info_path_base));
 
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA) && !defined(PS2) && !defined(HW_WUP))
    {
@@ -226,21 +208,461 @@ static config_file_t *core_info_list_iterate(
    }
 #endif
 
-   strlcat(info_path_base, ".info", info_path_base_size);
+   strlcat(info_path_base, ".info", sizeof(info_path_base));
 
-   info_path = (char*)malloc(info_path_base_size);
    fill_pathname_join(info_path,
          path_basedir,
-         info_path_base, info_path_base_size);
-   free(info_path_base);
-   info_path_base = NULL;
+         info_path_base, len);
+}
+
+static config_file_t *core_info_list_iterate(
+      const char *current_path,
+      const char *path_basedir)
+{
+   char info_path[PATH_MAX_LENGTH];
+
+   if (!current_path)
+      return NULL;
+
+   info_path[0] = '\0';
+
+   core_info_get_info_path(current_path, path_basedir,
+         info_path, sizeof(info_path));
+
+   if (!path_is_valid(info_path))
+      return NULL;
+
+   return config_file_new_from_path_to_string(info_path);
+}
+
+static void core_info_split_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list     = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list    = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list  = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list   = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list        = string_split(info->notes, "|");
+   if (info->required_hw_api)
+      info->required_hw_api_list =
+         string_split(info->required_hw_api, "|");
+}
+
+#ifdef HAVE_CORE_INFO_CACHE
+/* Binary copy of what was read from the .info files of the cores in a
+ * directory, read instead of parsing them again while the cores in the
+ * directory and their .info files are unchanged.
+ *
+ * In host byte order, strings are offsets into the file, 0 for none,
+ * all of them end before the end of the file:
+ *    core_info_cache_header_t,
+ *    core_info_cache_entry_t for each core, in directory order,
+ *    core_info_cache_firmware_t for the firmware of all the cores,
+ *    the strings. */
+
+#define CORE_INFO_CACHE_MAGIC   0x52414349 /* "RACI" */
+#define CORE_INFO_CACHE_VERSION 1
+#define CORE_INFO_CACHE_STRINGS 14
+
+#define CORE_INFO_CACHE_HAS_INFO             (1 << 0)
+#define CORE_INFO_CACHE_SUPPORTS_NO_GAME     (1 << 1)
+#define CORE_INFO_CACHE_MATCH_ARCHIVE_MEMBER (1 << 2)
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint64_t size;
+   uint32_t count;
+   uint32_t num_firmware;
+   /* Of the .info directory and core extensions it was made for */
+   uint32_t key;
+   uint32_t padding;
+} core_info_cache_header_t;
+
+typedef struct
+{
+   /* Of the .info file, -1 if there's none */
+   int64_t info_size;
+   int64_t info_mtime;
+   uint32_t path;
+   uint32_t flags;
+   uint32_t strs[CORE_INFO_CACHE_STRINGS];
+   uint32_t first_firmware;
+   uint32_t firmware_count;
+} core_info_cache_entry_t;
+
+typedef struct
+{
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+   uint32_t padding;
+} core_info_cache_firmware_t;
+
+typedef struct
+{
+   int64_t size;
+   int64_t mtime;
+} core_info_cache_stat_t;
+
+typedef struct
+{
+   char *buf;
+   size_t size;
+   size_t cap;
+   bool error;
+} core_info_cache_pool_t;
+
+/* Where the copy of the core info list is kept, none if empty */
+static char core_info_cache_dir[PATH_MAX_LENGTH] = {0};
+
+static void core_info_cache_get_fields(core_info_t *info,
+      char **fields[CORE_INFO_CACHE_STRINGS])
+{
+   fields[0]  = &info->display_name;
+   fields[1]  = &info->display_version;
+   fields[2]  = &info->core_name;
+   fields[3]  = &info->systemname;
+   fields[4]  = &info->system_id;
+   fields[5]  = &info->system_manufacturer;
+   fields[6]  = &info->supported_extensions;
+   fields[7]  = &info->authors;
+   fields[8]  = &info->permissions;
+   fields[9]  = &info->licenses;
+   fields[10] = &info->categories;
+   fields[11] = &info->databases;
+   fields[12] = &info->notes;
+   fields[13] = &info->required_hw_api;
+}
+
+static void core_info_cache_stat(const char *core_path,
+      const char *path_basedir, core_info_cache_stat_t *info_stat)
+{
+   char info_path[PATH_MAX_LENGTH];
+   struct stat st;
+
+   info_path[0]     = '\0';
+   info_stat->size  = -1;
+   info_stat->mtime = -1;
+
+   core_info_get_info_path(core_path, path_basedir,
+         info_path, sizeof(info_path));
+
+   if (stat(info_path, &st) != 0)
+      return;
+
+   info_stat->size  = (int64_t)st.st_size;
+   info_stat->mtime = (int64_t)st.st_mtime;
+}
+
+static uint32_t core_info_cache_key(const char *path_basedir,
+      const char *exts)
+{
+   uint32_t key = encoding_crc32(0, (const uint8_t*)path_basedir,
+         strlen(path_basedir));
+   if (exts)
+      key = encoding_crc32(key, (const uint8_t*)exts, strlen(exts));
+   return key;
+}
+
+static bool core_info_cache_get_path(char *cache_path, size_t len)
+{
+   if (string_is_empty(core_info_cache_dir))
+      return false;
+
+   fill_pathname_join(cache_path, core_info_cache_dir,
+         "core_info.idx", len);
+   return true;
+}
+
+static const char *core_info_cache_str(const char *buf, uint64_t size,
+      uint32_t offset, bool *ok)
+{
+   if (!offset)
+      return NULL;
+   if (offset >= size)
+   {
+      *ok = false;
+      return NULL;
+   }
+   return buf + offset;
+}
+
+/* Returns false if there's no copy to read, or it's out of date */
+static bool core_info_cache_read(core_info_list_t *core_info_list,
+      const struct string_list *contents, const char *path_basedir,
+      const char *exts)
+{
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   const core_info_cache_header_t *header     = NULL;
+   const core_info_cache_entry_t *entries     = NULL;
+   const core_info_cache_firmware_t *firmware = NULL;
+   void *data                                 = NULL;
+   const char *buf                            = NULL;
+   int64_t len                                = 0;
+   bool ok                                    = true;
+
+   if (     !core_info_cache_get_path(cache_path, sizeof(cache_path))
+         || !path_is_valid(cache_path)
+         || !filestream_read_file(cache_path, &data, &len))
+      return false;
+
+   buf    = (const char*)data;
+   header = (const core_info_cache_header_t*)data;
+
+   if (     len < (int64_t)sizeof(*header)
+         || header->magic   != CORE_INFO_CACHE_MAGIC
+         || header->version != CORE_INFO_CACHE_VERSION
+         || header->size    != (uint64_t)len
+         || header->count   != contents->size
+         || header->key     != core_info_cache_key(path_basedir, exts)
+         || (uint64_t)header->count * sizeof(*entries)
+            + (uint64_t)header->num_firmware * sizeof(*firmware)
+            + sizeof(*header) > header->size
+         || buf[len - 1] != '\0')
+      goto error;
+
+   entries  = (const core_info_cache_entry_t*)(buf + sizeof(*header));
+   firmware = (const core_info_cache_firmware_t*)(entries + header->count);
+
+   /* Everything is checked before anything is used, so that the
+    * .info files can still be read on a mismatch */
+   for (i = 0; ok && i < header->count; i++)
+   {
+      size_t j;
+      core_info_cache_stat_t info_stat;
+      const core_info_cache_entry_t *entry = &entries[i];
+      const char *path = core_info_cache_str(buf, header->size,
+            entry->path, &ok);
+
+      if (!path || !string_is_equal(path, contents->elems[i].data))
+         goto error;
+
+      if (     entry->first_firmware > header->num_firmware
+            || entry->firmware_count
+               > header->num_firmware - entry->first_firmware)
+         goto error;
+
+      core_info_cache_stat(path, path_basedir, &info_stat);
+      if (     info_stat.size  != entry->info_size
+            || info_stat.mtime != entry->info_mtime)
+         goto error;
+
+      for (j = 0; j < CORE_INFO_CACHE_STRINGS; j++)
+         core_info_cache_str(buf, header->size, entry->strs[j], &ok);
+   }
+
+   for (i = 0; ok && i < header->num_firmware; i++)
+   {
+      core_info_cache_str(buf, header->size, firmware[i].path, &ok);
+      core_info_cache_str(buf, header->size, firmware[i].desc, &ok);
+   }
+
+   if (!ok)
+      goto error;
+
+   for (i = 0; i < header->count; i++)
+   {
+      size_t j;
+      char **fields[CORE_INFO_CACHE_STRINGS];
+      const core_info_cache_entry_t *entry = &entries[i];
+      core_info_t *info                    = &core_info_list->list[i];
+
+      core_info_cache_get_fields(info, fields);
+      for (j = 0; j < CORE_INFO_CACHE_STRINGS; j++)
+         *fields[j] = (char*)core_info_cache_str(buf, header->size,
+               entry->strs[j], &ok);
+
+      info->path     = (char*)buf + entry->path;
+      info->has_info = (entry->flags & CORE_INFO_CACHE_HAS_INFO) != 0;
+      info->supports_no_game                =
+         (entry->flags & CORE_INFO_CACHE_SUPPORTS_NO_GAME) != 0;
+      info->database_match_archive_member   =
+         (entry->flags & CORE_INFO_CACHE_MATCH_ARCHIVE_MEMBER) != 0;
+      info->firmware_count                  = entry->firmware_count;
+
+      if (entry->firmware_count)
+      {
+         info->firmware = (core_info_firmware_t*)calloc(
+               entry->firmware_count, sizeof(*info->firmware));
+         if (!info->firmware)
+            info->firmware_count = 0;
+      }
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         const core_info_cache_firmware_t *src =
+            &firmware[entry->first_firmware + j];
+
+         info->firmware[j].path     = (char*)core_info_cache_str(
+               buf, header->size, src->path, &ok);
+         info->firmware[j].desc     = (char*)core_info_cache_str(
+               buf, header->size, src->desc, &ok);
+         info->firmware[j].optional = src->optional != 0;
+      }
+
+      core_info_split_lists(info);
+   }
+
+   core_info_list->cache = (char*)data;
+   return true;
+
+error:
+   free(data);
+   return false;
+}
+
+static uint32_t core_info_cache_pool_add(core_info_cache_pool_t *pool,
+      const char *str)
+{
+   size_t len;
+   size_t offset = pool->size;
 
-   if (path_is_valid(info_path))
-      conf = config_file_new_from_path_to_string(info_path);
-   free(info_path);
+   if (!str || pool->error)
+      return 0;
+
+   len = strlen(str) + 1;
+   if (pool->size + len > pool->cap)
+   {
+      size_t cap = pool->cap * 2;
+      char *buf  = NULL;
+
+      while (pool->size + len > cap)
+         cap *= 2;
+
+      if (!(buf = (char*)realloc(pool->buf, cap)))
+      {
+         pool->error = true;
+         return 0;
+      }
+
+      pool->buf = buf;
+      pool->cap = cap;
+   }
+
+   memcpy(pool->buf + pool->size, str, len);
+   pool->size += len;
+   return (uint32_t)offset;
+}
+
+static void core_info_cache_write(core_info_list_t *core_info_list,
+      const core_info_cache_stat_t *info_stats, const char *path_basedir,
+      const char *exts)
+{
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   core_info_cache_pool_t pool;
+   core_info_cache_header_t *header = NULL;
+   size_t num_firmware              = 0;
+   size_t tables_size               = 0;
+   uint32_t first_firmware          = 0;
+
+   if (!core_info_cache_get_path(cache_path, sizeof(cache_path)))
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+      if (core_info_list->list[i].firmware)
+         num_firmware += core_info_list->list[i].firmware_count;
+
+   /* Strings go after the rest, which is written in place once the
+    * pool stops moving */
+   tables_size = sizeof(*header)
+      + core_info_list->count * sizeof(core_info_cache_entry_t)
+      + num_firmware * sizeof(core_info_cache_firmware_t);
+   pool.size   = tables_size;
+   pool.cap    = tables_size + 64 * 1024;
+   pool.buf    = (char*)calloc(1, pool.cap);
+   pool.error  = false;
+   if (!pool.buf)
+      return;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      size_t j;
+      char **fields[CORE_INFO_CACHE_STRINGS];
+      core_info_cache_entry_t entry;
+      core_info_t *info = &core_info_list->list[i];
+
+      core_info_cache_get_fields(info, fields);
+
+      memset(&entry, 0, sizeof(entry));
+      entry.info_size      = info_stats[i].size;
+      entry.info_mtime     = info_stats[i].mtime;
+      entry.path           = core_info_cache_pool_add(&pool, info->path);
+      entry.flags          =
+           (info->has_info ? CORE_INFO_CACHE_HAS_INFO : 0)
+         | (info->supports_no_game ? CORE_INFO_CACHE_SUPPORTS_NO_GAME : 0)
+         | (info->database_match_archive_member
+               ? CORE_INFO_CACHE_MATCH_ARCHIVE_MEMBER : 0);
+      for (j = 0; j < CORE_INFO_CACHE_STRINGS; j++)
+         entry.strs[j]     = core_info_cache_pool_add(&pool, *fields[j]);
+      entry.first_firmware = first_firmware;
+      entry.firmware_count = info->firmware
+         ? (uint32_t)info->firmware_count : 0;
+
+      for (j = 0; j < entry.firmware_count; j++)
+      {
+         core_info_cache_firmware_t src;
+
+         src.path     = core_info_cache_pool_add(&pool,
+               info->firmware[j].path);
+         src.desc     = core_info_cache_pool_add(&pool,
+               info->firmware[j].desc);
+         src.optional = info->firmware[j].optional ? 1 : 0;
+         src.padding  = 0;
+
+         if (!pool.error)
+            memcpy(pool.buf + sizeof(*header)
+                  + core_info_list->count * sizeof(entry)
+                  + (first_firmware + j) * sizeof(src),
+                  &src, sizeof(src));
+      }
+      first_firmware += entry.firmware_count;
+
+      if (!pool.error)
+         memcpy(pool.buf + sizeof(*header) + i * sizeof(entry),
+               &entry, sizeof(entry));
+   }
+
+   /* An empty list needs the NUL the reader checks for */
+   if (!pool.error && pool.size == tables_size)
+      core_info_cache_pool_add(&pool, "");
+
+   if (pool.error || pool.size > UINT32_MAX)
+   {
+      free(pool.buf);
+      return;
+   }
+
+   header               = (core_info_cache_header_t*)pool.buf;
+   header->magic        = CORE_INFO_CACHE_MAGIC;
+   header->version      = CORE_INFO_CACHE_VERSION;
+   header->size         = pool.size;
+   header->count        = (uint32_t)core_info_list->count;
+   header->num_firmware = (uint32_t)num_firmware;
+   header->key          = core_info_cache_key(path_basedir, exts);
+   header->padding      = 0;
 
-   return conf;
+   if (!filestream_write_file(cache_path, pool.buf, pool.size))
+   {
+      RARCH_WARN("Failed to write core info cache: %s\n", cache_path);
+      filestream_delete(cache_path);
+   }
+
+   free(pool.buf);
 }
+#endif
 
 static core_info_list_t *core_info_list_new(const char *path,
       const char *libretro_info_dir,
@@ -251,6 +673,9 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
    const char       *path_basedir   = libretro_info_dir;
+#ifdef HAVE_CORE_INFO_CACHE
+   core_info_cache_stat_t *info_stats = NULL;
+#endif
    struct string_list *contents     = string_list_new();
    bool                          ok = dir_list_append(contents, path, exts,
          false, dir_show_hidden_files, false, false);
@@ -282,6 +707,14 @@ static core_info_list_t *core_info_list_new(const char *path,
       return NULL;
    }
 
+   core_info_list->strings = string_pool_new();
+   if (!core_info_list->strings)
+   {
+      core_info_list_free(core_info_list);
+      string_list_free(contents);
+      return NULL;
+   }
+
    core_info = (core_info_t*)calloc(contents->size, sizeof(*core_info));
    if (!core_info)
    {
@@ -293,6 +726,26 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->list  = core_info;
    core_info_list->count = contents->size;
 
+#ifdef HAVE_CORE_INFO_CACHE
+   if (core_info_cache_read(core_info_list, contents, path_basedir, exts))
+   {
+      core_info_list_resolve_all_extensions(core_info_list);
+      string_list_free(contents);
+      return core_info_list;
+   }
+
+   /* Taken before the .info files are read, a change while they are
+    * only makes the copy out of date */
+   if (!string_is_empty(core_info_cache_dir))
+   {
+      info_stats = (core_info_cache_stat_t*)calloc(contents->size,
+            sizeof(*info_stats));
+      for (i = 0; info_stats && i < contents->size; i++)
+         core_info_cache_stat(contents->elems[i].data, path_basedir,
+               &info_stats[i]);
+   }
+#endif
+
    for (i = 0; i < contents->size; i++)
    {
       const char *base_path = contents->elems[i].data;
@@ -301,177 +754,69 @@ static core_info_list_t *core_info_list_new(const char *path,
 
       if (conf)
       {
-         char *tmp           = NULL;
-
-         if (config_get_string(conf, "display_name", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "display_version", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_version = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "corename", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].core_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemname", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].systemname = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemid", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_id = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "manufacturer", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_manufacturer = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         {
-            unsigned count      = 0;
-            config_get_uint(conf, "firmware_count", &count);
-            core_info[i].firmware_count = count;
-         }
-
-         if (config_get_string(conf, "supported_extensions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].supported_extensions      = strdup(tmp);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "authors", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].authors      = strdup(tmp);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "permissions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].permissions      = strdup(tmp);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "license", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].licenses      = strdup(tmp);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "categories", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].categories      = strdup(tmp);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "database", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].databases      = strdup(tmp);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "notes", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].notes     = strdup(tmp);
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "required_hw_api", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].required_hw_api = strdup(tmp);
-            core_info[i].required_hw_api_list = string_split(core_info[i].required_hw_api, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (tmp)
-            free(tmp);
-         tmp    = NULL;
-
-         {
-            bool tmp_bool       = false;
-            if (config_get_bool(conf, "supports_no_game",
-                     &tmp_bool))
-               core_info[i].supports_no_game = tmp_bool;
-
-            if (config_get_bool(conf, "database_match_archive_member",
-                     &tmp_bool))
-               core_info[i].database_match_archive_member = tmp_bool;
-         }
-
-         core_info[i].config_data = conf;
+         bool tmp_bool                    = false;
+
+         core_info[i].display_name        =
+            core_info_get_string(core_info_list, conf, "display_name", false);
+         core_info[i].display_version     =
+            core_info_get_string(core_info_list, conf, "display_version", false);
+         core_info[i].core_name           =
+            core_info_get_string(core_info_list, conf, "corename", false);
+         core_info[i].systemname          =
+            core_info_get_string(core_info_list, conf, "systemname", true);
+         core_info[i].system_id           =
+            core_info_get_string(core_info_list, conf, "systemid", true);
+         core_info[i].system_manufacturer =
+            core_info_get_string(core_info_list, conf, "manufacturer", true);
+         core_info[i].supported_extensions =
+            core_info_get_string(core_info_list, conf, "supported_extensions", false);
+         core_info[i].authors             =
+            core_info_get_string(core_info_list, conf, "authors", true);
+         core_info[i].permissions         =
+            core_info_get_string(core_info_list, conf, "permissions", true);
+         core_info[i].licenses            =
+            core_info_get_string(core_info_list, conf, "license", true);
+         core_info[i].categories          =
+            core_info_get_string(core_info_list, conf, "categories", true);
+         core_info[i].databases           =
+            core_info_get_string(core_info_list, conf, "database", true);
+         core_info[i].notes               =
+            core_info_get_string(core_info_list, conf, "notes", false);
+         core_info[i].required_hw_api     =
+            core_info_get_string(core_info_list, conf, "required_hw_api", true);
+
+         if (config_get_bool(conf, "supports_no_game",
+                  &tmp_bool))
+            core_info[i].supports_no_game = tmp_bool;
+
+         if (config_get_bool(conf, "database_match_archive_member",
+                  &tmp_bool))
+            core_info[i].database_match_archive_member = tmp_bool;
+
+         core_info_resolve_firmware(core_info_list, &core_info[i], conf);
+         core_info_split_lists(&core_info[i]);
+
+         /* Everything needed was copied out of it */
+         core_info[i].has_info = true;
+         config_file_free(conf);
       }
 
       if (!string_is_empty(base_path))
-         core_info[i].path = strdup(base_path);
+         core_info[i].path = string_pool_strdup(core_info_list->strings,
+               base_path);
 
-      if (!core_info[i].display_name)
-         core_info[i].display_name =
-            strdup(path_basename(core_info[i].path));
+      if (!core_info[i].display_name && core_info[i].path)
+         core_info[i].display_name = string_pool_strdup(
+               core_info_list->strings, path_basename(core_info[i].path));
    }
 
-   if (core_info_list)
-   {
-      core_info_list_resolve_all_extensions(core_info_list);
-      core_info_list_resolve_all_firmware(core_info_list);
-   }
+   core_info_list_resolve_all_extensions(core_info_list);
+
+#ifdef HAVE_CORE_INFO_CACHE
+   if (info_stats)
+      core_info_cache_write(core_info_list, info_stats, path_basedir, exts);
+   free(info_stats);
+#endif
 
    string_list_free(contents);
    return core_info_list;
@@ -645,17 +990,40 @@ void core_info_deinit_list(void)
    core_info_curr_list = NULL;
 }
 
+void core_info_set_cache_dir(const char *dir)
+{
+#ifdef HAVE_CORE_INFO_CACHE
+   if (string_is_empty(dir))
+      core_info_cache_dir[0] = '\0';
+   else
+      strlcpy(core_info_cache_dir, dir, sizeof(core_info_cache_dir));
+#endif
+}
+
 bool core_info_init_list(const char *path_info, const char *dir_cores,
       const char *exts, bool dir_show_hidden_files)
 {
-   if (!(core_info_curr_list = core_info_list_new(dir_cores,
-               !string_is_empty(path_info) ? path_info : dir_cores,
-               exts,
-               dir_show_hidden_files)))
+   if (!(core_info_curr_list = core_info_list_load(path_info, dir_cores,
+               exts, dir_show_hidden_files)))
       return false;
    return true;
 }
 
+core_info_list_t *core_info_list_load(const char *path_info,
+      const char *dir_cores, const char *exts, bool dir_show_hidden_files)
+{
+   return core_info_list_new(dir_cores,
+         !string_is_empty(path_info) ? path_info : dir_cores,
+         exts,
+         dir_show_hidden_files);
+}
+
+void core_info_set_list(core_info_list_t *list)
+{
+   core_info_deinit_list();
+   core_info_curr_list = list;
+}
+
 bool core_info_get_list(core_info_list_t **core)
 {
    if (!core)
@@ -823,11 +1191,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
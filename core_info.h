@@ -39,9 +39,10 @@ typedef struct
 {
    bool supports_no_game;
    bool database_match_archive_member;
+   /* Whether there's a .info file for the core */
+   bool has_info;
    size_t firmware_count;
    char *path;
-   void *config_data;
    char *display_name;
    char *display_version;
    char *core_name;
@@ -73,6 +74,10 @@ typedef struct
    core_info_t *list;
    size_t count;
    char *all_ext;
+   /* Where the strings of the list are, or the copy
+    * they were read from */
+   struct string_pool *strings;
+   char *cache;
 } core_info_list_t;
 
 typedef struct core_info_ctx_firmware
@@ -124,9 +129,24 @@ bool core_info_get_current_core(core_info_t **core);
 
 void core_info_deinit_list(void);
 
+/* Directory to keep a binary copy of the core info list in, to read
+ * instead of the .info files while they and the cores are unchanged.
+ * NULL or empty not to. */
+void core_info_set_cache_dir(const char *dir);
+
 bool core_info_init_list(const char *path_info, const char *dir_cores,
       const char *exts, bool show_hidden_files);
 
+/* As core_info_init_list(), but only returns the list, so it can
+ * be read on another thread and set later. */
+core_info_list_t *core_info_list_load(const char *path_info,
+      const char *dir_cores, const char *exts, bool show_hidden_files);
+
+/* Makes @list the current list, freeing the previous one */
+void core_info_set_list(core_info_list_t *list);
+
+void core_info_list_free(core_info_list_t *list);
+
 bool core_info_get_list(core_info_list_t **core);
 
 bool core_info_list_update_missing_firmware(core_info_ctx_firmware_t *info,
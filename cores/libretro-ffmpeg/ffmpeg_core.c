@@ -51,6 +51,7 @@ extern "C" {
 #include <queues/fifo_queue.h>
 #include <string/stdstring.h>
 #include "packet_buffer.h"
+#include "packet_queue.h"
 #include "video_buffer.h"
 
 #include <libretro.h>
@@ -105,6 +106,30 @@ static enum AVHWDeviceType hw_decoder;
 static bool hw_decoding_enabled;
 static enum AVPixelFormat pix_fmt;
 static bool force_sw_decoder;
+static AVCodec *video_codec;
+#endif
+
+/* DRM PRIME frames, as the Rockchip MPP and V4L2 M2M decoders
+ * output them, are imported as EGL images and sampled as they
+ * are, instead of being copied back and converted on the CPU. */
+#if ENABLE_HW_ACCEL && defined(HAVE_OPENGLES) && defined(HAVE_EGL) && defined(__linux__)
+#define HAVE_FFMPEG_DRM_PRIME
+#endif
+
+#ifdef HAVE_FFMPEG_DRM_PRIME
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <libavutil/hwcontext_drm.h>
+
+#ifndef GL_TEXTURE_EXTERNAL_OES
+#define GL_TEXTURE_EXTERNAL_OES 0x8D65
+#endif
+
+/* Set once the context can import DMA-BUFs */
+static volatile bool drm_prime_direct;
+static EGLDisplay drm_prime_display;
+static PFNEGLCREATEIMAGEKHRPROC drm_prime_create_image;
+static PFNEGLDESTROYIMAGEKHRPROC drm_prime_destroy_image;
 #endif
 
 #define MAX_STREAMS 8
@@ -158,6 +183,14 @@ static sthread_t *decode_thread_handle;
 static double decode_last_audio_time;
 static bool main_sleeping;
 
+/* Audio packets, from the decode thread to the audio thread */
+static packet_queue_t *audio_packet_queue;
+/* Bumped by every seek, under fifo_lock. Audio from
+ * before that is dropped. */
+static int audio_serial;
+/* Set once the decode thread won't push any more packets */
+static bool audio_packets_done;
+
 static uint32_t *video_frame_temp_buffer;
 
 /* Seeking. */
@@ -172,6 +205,12 @@ struct frame
 #if !defined(HAVE_OPENGLES)
    GLuint pbo;
 #endif
+#endif
+#ifdef HAVE_FFMPEG_DRM_PRIME
+   /* The decoded frame, kept until it's no longer drawn */
+   AVFrame *drm_frame;
+   EGLImageKHR image;
+   GLuint tex_external;
 #endif
    double pts;
 };
@@ -187,6 +226,94 @@ static GLuint vbo;
 static GLint vertex_loc;
 static GLint tex_loc;
 static GLint mix_loc;
+#ifdef HAVE_FFMPEG_DRM_PRIME
+static GLuint prog_external;
+static GLint mix_loc_external;
+#endif
+#endif
+
+#ifdef HAVE_FFMPEG_DRM_PRIME
+static void drm_prime_release(struct frame *f)
+{
+   if (f->image != EGL_NO_IMAGE_KHR)
+   {
+      drm_prime_destroy_image(drm_prime_display, f->image);
+      f->image = EGL_NO_IMAGE_KHR;
+   }
+
+   if (f->drm_frame)
+      av_frame_free(&f->drm_frame);
+}
+
+/* Takes over the reference of @src; only frames with all
+ * their planes in a single layer (NV12 and the like) can be
+ * imported. */
+static bool drm_prime_import(struct frame *f, AVFrame *src)
+{
+   static const EGLint plane_attribs[3][3] = {
+      { EGL_DMA_BUF_PLANE0_FD_EXT,
+        EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+        EGL_DMA_BUF_PLANE0_PITCH_EXT },
+      { EGL_DMA_BUF_PLANE1_FD_EXT,
+        EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+        EGL_DMA_BUF_PLANE1_PITCH_EXT },
+      { EGL_DMA_BUF_PLANE2_FD_EXT,
+        EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+        EGL_DMA_BUF_PLANE2_PITCH_EXT },
+   };
+   EGLint attribs[6 + 6 * 3 + 1];
+   unsigned n = 0;
+   int i;
+   const AVDRMFrameDescriptor *desc = NULL;
+   const AVDRMLayerDescriptor *layer = NULL;
+
+   drm_prime_release(f);
+
+   if (!(f->drm_frame = av_frame_alloc()))
+      return false;
+
+   av_frame_move_ref(f->drm_frame, src);
+
+   desc  = (const AVDRMFrameDescriptor*)f->drm_frame->data[0];
+   layer = &desc->layers[0];
+
+   if (desc->nb_layers != 1 || layer->nb_planes > 3)
+      return false;
+
+   attribs[n++] = EGL_WIDTH;
+   attribs[n++] = f->drm_frame->width;
+   attribs[n++] = EGL_HEIGHT;
+   attribs[n++] = f->drm_frame->height;
+   attribs[n++] = EGL_LINUX_DRM_FOURCC_EXT;
+   attribs[n++] = layer->format;
+
+   for (i = 0; i < layer->nb_planes; i++)
+   {
+      const AVDRMPlaneDescriptor *plane = &layer->planes[i];
+
+      attribs[n++] = plane_attribs[i][0];
+      attribs[n++] = desc->objects[plane->object_index].fd;
+      attribs[n++] = plane_attribs[i][1];
+      attribs[n++] = (EGLint)plane->offset;
+      attribs[n++] = plane_attribs[i][2];
+      attribs[n++] = (EGLint)plane->pitch;
+   }
+
+   attribs[n]   = EGL_NONE;
+
+   f->image     = drm_prime_create_image(drm_prime_display, EGL_NO_CONTEXT,
+         EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)NULL, attribs);
+
+   if (f->image == EGL_NO_IMAGE_KHR)
+      return false;
+
+   glBindTexture(GL_TEXTURE_EXTERNAL_OES, f->tex_external);
+   glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES,
+         (GLeglImageOES)f->image);
+   glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+
+   return true;
+}
 #endif
 
 static struct
@@ -483,6 +610,7 @@ static void seek_frame(int seek_frames)
    slock_lock(fifo_lock);
    do_seek        = true;
    seek_time      = frame_cnt / media.interpolate_fps;
+   audio_serial++;
 
    snprintf(msg, sizeof(msg), "Seek: %u s.", (unsigned)seek_time);
    msg_obj.msg    = msg;
@@ -707,9 +835,24 @@ void CORE_PREFIX(retro_run)(void)
             video_buffer_get_finished_slot(video_buffer, &ctx);
             pts = ctx->pts;
 
+#ifdef HAVE_FFMPEG_DRM_PRIME
+            if (use_gl && ctx->source->format == AV_PIX_FMT_DRM_PRIME)
+            {
+               if (!drm_prime_import(&frames[1], ctx->source))
+               {
+                  log_cb(RETRO_LOG_WARN, "[FFMPEG] Failed to import DRM PRIME frame, copying frames from now on.\n");
+                  drm_prime_direct = false;
+                  drm_prime_release(&frames[1]);
+               }
+            }
+            else
+#endif
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
             if (use_gl)
             {
+#ifdef HAVE_FFMPEG_DRM_PRIME
+               drm_prime_release(&frames[1]);
+#endif
 #ifndef HAVE_OPENGLES
                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[1].pbo);
 #ifdef __MACH__
@@ -771,13 +914,33 @@ void CORE_PREFIX(retro_run)(void)
          glClearColor(0, 0, 0, 1);
          glClear(GL_COLOR_BUFFER_BIT);
          glViewport(0, 0, media.width, media.height);
-         glUseProgram(prog);
 
-         glUniform1f(mix_loc, mix_factor);
-         glActiveTexture(GL_TEXTURE1);
-         glBindTexture(GL_TEXTURE_2D, frames[1].tex);
-         glActiveTexture(GL_TEXTURE0);
-         glBindTexture(GL_TEXTURE_2D, frames[0].tex);
+#ifdef HAVE_FFMPEG_DRM_PRIME
+         if (frames[1].image != EGL_NO_IMAGE_KHR)
+         {
+            /* The older frame may still be a copied one */
+            GLuint tex0 = frames[0].image != EGL_NO_IMAGE_KHR
+               ? frames[0].tex_external : frames[1].tex_external;
+
+            glUseProgram(prog_external);
+
+            glUniform1f(mix_loc_external, mix_factor);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_EXTERNAL_OES, frames[1].tex_external);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_EXTERNAL_OES, tex0);
+         }
+         else
+#endif
+         {
+            glUseProgram(prog);
+
+            glUniform1f(mix_loc, mix_factor);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, frames[1].tex);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, frames[0].tex);
+         }
 
          glBindBuffer(GL_ARRAY_BUFFER, vbo);
          glVertexAttribPointer(vertex_loc, 2, GL_FLOAT, GL_FALSE,
@@ -795,8 +958,14 @@ void CORE_PREFIX(retro_run)(void)
          glUseProgram(0);
          glActiveTexture(GL_TEXTURE1);
          glBindTexture(GL_TEXTURE_2D, 0);
+#ifdef HAVE_FFMPEG_DRM_PRIME
+         glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+#endif
          glActiveTexture(GL_TEXTURE0);
          glBindTexture(GL_TEXTURE_2D, 0);
+#ifdef HAVE_FFMPEG_DRM_PRIME
+         glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+#endif
 
          CORE_PREFIX(video_cb)(RETRO_HW_FRAME_BUFFER_VALID,
                media.width, media.height, media.width * sizeof(uint32_t));
@@ -850,7 +1019,7 @@ static enum AVPixelFormat init_hw_decoder(struct AVCodecContext *ctx,
 {
    int ret = 0;
    enum AVPixelFormat decoder_pix_fmt = AV_PIX_FMT_NONE;
-   struct AVCodec *codec = avcodec_find_decoder(fctx->streams[video_stream_index]->codec->codec_id);
+   struct AVCodec *codec = video_codec;
 
    for (int i = 0;; i++)
    {
@@ -990,6 +1159,37 @@ static enum AVPixelFormat get_format(AVCodecContext *ctx,
 }
 #endif
 
+#ifdef HAVE_FFMPEG_DRM_PRIME
+/* The stateful hardware decoders are decoders of their own,
+ * named after the codec, which output DRM PRIME frames. */
+static AVCodec *find_drm_prime_decoder(AVCodec *codec)
+{
+   static const char *suffixes[] = { "_rkmpp", "_v4l2m2m" };
+   unsigned i;
+
+   if (force_sw_decoder
+         || (hw_decoder != AV_HWDEVICE_TYPE_NONE
+            && hw_decoder != AV_HWDEVICE_TYPE_DRM))
+      return codec;
+
+   for (i = 0; i < ARRAY_SIZE(suffixes); i++)
+   {
+      char name[64];
+      AVCodec *hw_codec = NULL;
+
+      snprintf(name, sizeof(name), "%s%s", codec->name, suffixes[i]);
+
+      if ((hw_codec = avcodec_find_decoder_by_name(name)))
+      {
+         log_cb(RETRO_LOG_INFO, "[FFMPEG] Using decoder %s.\n", name);
+         return hw_codec;
+      }
+   }
+
+   return codec;
+}
+#endif
+
 static bool open_codec(AVCodecContext **ctx, enum AVMediaType type, unsigned index)
 {
    int ret = 0;
@@ -1007,7 +1207,12 @@ static bool open_codec(AVCodecContext **ctx, enum AVMediaType type, unsigned ind
    {
       video_stream_index = index;
 
+#ifdef HAVE_FFMPEG_DRM_PRIME
+      codec = find_drm_prime_decoder(codec);
+#endif
+
 #if ENABLE_HW_ACCEL
+      video_codec       = codec;
       vctx->get_format  = get_format;
       pix_fmt = select_decoder((*ctx), NULL);
 #else
@@ -1354,8 +1559,10 @@ static void decode_video(AVCodecContext *ctx, AVPacket *pkt, size_t frame_size)
    int ret = 0;
    video_decoder_context_t *decoder_ctx = NULL;
 
-   /* Stop decoding thread until video_buffer is not full again */
-   while (!decode_thread_dead && !video_buffer_has_open_slot(video_buffer))
+   /* Stop decoding thread until video_buffer is not full again,
+    * looking out for the main thread every millisecond */
+   while (!decode_thread_dead
+         && !video_buffer_wait_for_open_slot_timeout(video_buffer, 1000))
    {
       if (main_sleeping)
       {
@@ -1397,6 +1604,22 @@ static void decode_video(AVCodecContext *ctx, AVPacket *pkt, size_t frame_size)
          goto end;
       }
 
+#ifdef HAVE_FFMPEG_DRM_PRIME
+      /* Handed to the main thread as it is. Subtitles are drawn
+       * on the converted frames, so those still get copied */
+      if (     drm_prime_direct
+            && decoder_ctx->source->format == AV_PIX_FMT_DRM_PRIME
+#ifdef HAVE_SSA
+            && !ass_track_active
+#endif
+         )
+      {
+         decoder_ctx->pts = decoder_ctx->source->best_effort_timestamp;
+         video_buffer_finish_slot(video_buffer, decoder_ctx);
+         continue;
+      }
+#endif
+
 #if ENABLE_HW_ACCEL
       if (hw_decoding_enabled)
          /* Copy data from VRAM to RAM */
@@ -1430,11 +1653,12 @@ static void decode_video(AVCodecContext *ctx, AVPacket *pkt, size_t frame_size)
 
 static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
       AVFrame *frame, int16_t *buffer, size_t *buffer_cap,
-      SwrContext *swr)
+      SwrContext *swr, int serial)
 {
    int ret = 0;
    int64_t pts = 0;
    size_t required_buffer = 0;
+   double timebase = av_q2d(fctx->streams[pkt->stream_index]->time_base);
 
    if ((ret = avcodec_send_packet(ctx, pkt)) < 0)
    {
@@ -1477,7 +1701,9 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
       pts = frame->best_effort_timestamp;
       slock_lock(fifo_lock);
 
-      while (!decode_thread_dead && fifo_write_avail(audio_decode_fifo) < required_buffer)
+      /* Stop waiting for room once a seek made this stale */
+      while (!decode_thread_dead && serial == audio_serial
+            && fifo_write_avail(audio_decode_fifo) < required_buffer)
       {
          if (!main_sleeping)
             scond_wait(fifo_decode_cond, fifo_lock);
@@ -1489,11 +1715,11 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
          }
       }
 
-      decode_last_audio_time = pts * av_q2d(
-            fctx->streams[audio_streams[audio_streams_ptr]]->time_base);
-
-      if (!decode_thread_dead)
+      if (!decode_thread_dead && serial == audio_serial)
+      {
+         decode_last_audio_time = pts * timebase;
          fifo_write(audio_decode_fifo, buffer, required_buffer);
+      }
 
       scond_signal(fifo_cond);
       slock_unlock(fifo_lock);
@@ -1510,8 +1736,6 @@ static void decode_thread_seek(double time)
    if (seek_to < 0)
       seek_to = 0;
 
-   decode_last_audio_time = time;
-
    if(avformat_seek_file(fctx, -1, INT64_MIN, seek_to, INT64_MAX, 0) < 0)
       log_cb(RETRO_LOG_ERROR, "[FFMPEG] av_seek_frame() failed.\n");
 
@@ -1521,8 +1745,6 @@ static void decode_thread_seek(double time)
       video_buffer_clear(video_buffer);
    }
 
-   if (actx[audio_streams_ptr])
-      avcodec_flush_buffers(actx[audio_streams_ptr]);
    if (vctx)
       avcodec_flush_buffers(vctx);
    if (sctx[subtitle_streams_ptr])
@@ -1545,18 +1767,17 @@ static bool earlier_or_close_enough(double p1, double p2)
    return (p1 <= p2 || (p1-p2) < (1.0 / media.interpolate_fps) );
 }
 
-static void decode_thread(void *data)
+/* Owns the audio decoders, turns the packets the decode thread
+ * hands over into samples for the fifo. */
+static void audio_thread(void *data)
 {
    unsigned i;
-   bool eof                = false;
-   struct SwrContext *swr[audio_streams_num];
-   AVFrame *aud_frame      = NULL;
-   size_t frame_size       = 0;
+   int last_serial         = -1;
+   struct SwrContext *swr[MAX_STREAMS];
+   AVPacket *pkt           = av_packet_alloc();
+   AVFrame *aud_frame      = av_frame_alloc();
    int16_t *audio_buffer   = NULL;
    size_t audio_buffer_cap = 0;
-   packet_buffer_t *audio_packet_buffer;
-   packet_buffer_t *video_packet_buffer;
-   double last_audio_end  = 0;
 
    (void)data;
 
@@ -1573,10 +1794,82 @@ static void decode_thread(void *data)
       swr_init(swr[i]);
    }
 
-   aud_frame = av_frame_alloc();
+   while (!decode_thread_dead)
+   {
+      bool done;
+      int serial, current_serial;
+      int ptr;
+
+      slock_lock(fifo_lock);
+      done           = audio_packets_done;
+      current_serial = audio_serial;
+      slock_unlock(fifo_lock);
+
+      if (!packet_queue_pop(audio_packet_queue, pkt, &serial))
+      {
+         /* Done was read first, so nothing got pushed since */
+         if (done)
+            break;
+         packet_queue_wait_readable(audio_packet_queue, 10000);
+         continue;
+      }
+
+      /* Read before a seek */
+      if (serial != current_serial)
+      {
+         av_packet_unref(pkt);
+         continue;
+      }
+
+      for (ptr = 0; ptr < audio_streams_num; ptr++)
+         if (audio_streams[ptr] == pkt->stream_index)
+            break;
+
+      if (ptr < audio_streams_num && actx[ptr])
+      {
+         /* First packet since a seek */
+         if (serial != last_serial)
+            avcodec_flush_buffers(actx[ptr]);
+         last_serial  = serial;
+
+         audio_buffer = decode_audio(actx[ptr], pkt, aud_frame,
+               audio_buffer, &audio_buffer_cap, swr[ptr], serial);
+      }
+
+      av_packet_unref(pkt);
+   }
+
+   for (i = 0; (int)i < audio_streams_num; i++)
+      swr_free(&swr[i]);
+
+   av_packet_free(&pkt);
+   av_frame_free(&aud_frame);
+   av_freep(&audio_buffer);
+}
+
+static void decode_thread(void *data)
+{
+   unsigned i;
+   bool eof                       = false;
+   size_t frame_size              = 0;
+   sthread_t *audio_thread_handle = NULL;
+   packet_buffer_t *audio_packet_buffer;
+   packet_buffer_t *video_packet_buffer;
+
+   (void)data;
+
    audio_packet_buffer = packet_buffer_create();
    video_packet_buffer = packet_buffer_create();
 
+   if (audio_streams_num > 0)
+   {
+      /* A second or so of audio for most codecs */
+      audio_packet_queue = packet_queue_create(64);
+      audio_packets_done = false;
+      if (audio_packet_queue)
+         audio_thread_handle = sthread_create(audio_thread, NULL);
+   }
+
    if (video_stream_index >= 0)
    {
       frame_size = avpicture_get_size(PIX_FMT_RGB32, media.width, media.height);
@@ -1588,14 +1881,15 @@ static void decode_thread(void *data)
    while (!decode_thread_dead)
    {
       bool seek;
+      int serial;
       int subtitle_stream;
       double seek_time_thread;
-      int audio_stream_index, audio_stream_ptr;
+      double audio_time;
+      int audio_stream_index;
 
-      double audio_timebase   = 0.0;
+      bool audio_full         = false;
       double video_timebase   = 0.0;
       double next_video_end   = 0.0;
-      double next_audio_start = 0.0;
 
       AVPacket *pkt = av_packet_alloc();
       AVCodecContext *actx_active = NULL;
@@ -1608,6 +1902,8 @@ static void decode_thread(void *data)
       slock_lock(fifo_lock);
       seek             = do_seek;
       seek_time_thread = seek_time;
+      serial           = audio_serial;
+      audio_time       = decode_last_audio_time;
       slock_unlock(fifo_lock);
 
       if (seek)
@@ -1618,9 +1914,10 @@ static void decode_thread(void *data)
          do_seek          = false;
          eof              = false;
          seek_time        = 0.0;
-         next_video_end   = 0.0;
-         next_audio_start = 0.0;
-         last_audio_end   = 0.0;
+         audio_time       = seek_time_thread;
+         /* The audio thread drops what it still has, it
+          * only writes once packets with the new serial come */
+         decode_last_audio_time = seek_time_thread;
 
          if (audio_decode_fifo)
             fifo_clear(audio_decode_fifo);
@@ -1628,62 +1925,48 @@ static void decode_thread(void *data)
          packet_buffer_clear(&audio_packet_buffer);
          packet_buffer_clear(&video_packet_buffer);
 
+         scond_signal(fifo_decode_cond);
          scond_signal(fifo_cond);
          slock_unlock(fifo_lock);
       }
 
       slock_lock(decode_thread_lock);
       audio_stream_index          = audio_streams[audio_streams_ptr];
-      audio_stream_ptr            = audio_streams_ptr;
       subtitle_stream             = subtitle_streams[subtitle_streams_ptr];
-      actx_active                 = actx[audio_streams_ptr];
+      if (audio_thread_handle)
+         actx_active              = actx[audio_streams_ptr];
       sctx_active                 = sctx[subtitle_streams_ptr];
 #ifdef HAVE_SSA
       ass_track_active            = ass_track[subtitle_streams_ptr];
 #endif
-      audio_timebase = av_q2d(fctx->streams[audio_stream_index]->time_base);
       if (video_stream_index >= 0)
          video_timebase = av_q2d(fctx->streams[video_stream_index]->time_base);
       slock_unlock(decode_thread_lock);
 
-      if (!packet_buffer_empty(audio_packet_buffer))
-         next_audio_start = audio_timebase * packet_buffer_peek_start_pts(audio_packet_buffer);
-
-      if (!packet_buffer_empty(video_packet_buffer))
-         next_video_end = video_timebase * packet_buffer_peek_end_pts(video_packet_buffer);
-
-      /* 
-       * Decode audio packet if:
-       *  1. it's the start of file or it's audio only media
-       *  2. there is a video packet for in the buffer
-       *  3. EOF
-       **/
-      if (!packet_buffer_empty(audio_packet_buffer) &&
-            (
-               next_video_end == 0.0 ||
-               (!eof && earlier_or_close_enough(next_audio_start, next_video_end)) ||
-               eof
-            )
-         )
+      /* Hand the staged audio packets over, as far as there's room */
+      while (!packet_buffer_empty(audio_packet_buffer)
+            && !packet_queue_full(audio_packet_queue))
       {
          packet_buffer_get_packet(audio_packet_buffer, pkt);
-         last_audio_end = audio_timebase * (pkt->pts + pkt->duration);
-         audio_buffer = decode_audio(actx_active, pkt, aud_frame,
-                                    audio_buffer, &audio_buffer_cap,
-                                    swr[audio_stream_ptr]);
-         av_packet_unref(pkt);
+         packet_queue_push(audio_packet_queue, pkt, serial);
       }
+      audio_full = !packet_buffer_empty(audio_packet_buffer);
+
+      if (!packet_buffer_empty(video_packet_buffer))
+         next_video_end = video_timebase * packet_buffer_peek_end_pts(video_packet_buffer);
 
       /* 
        * Decode video packet if:
-       *  1. we already decoded an audio packet
+       *  1. the audio thread got that far
        *  2. there is no audio stream to play
-       *  3. EOF
+       *  3. the audio thread has plenty to do anyway
+       *  4. EOF
        **/
       if (!packet_buffer_empty(video_packet_buffer) &&
             (
-               (!eof && earlier_or_close_enough(next_video_end, last_audio_end)) ||
+               earlier_or_close_enough(next_video_end, audio_time) ||
                !actx_active ||
+               audio_full ||
                eof
             )
          )
@@ -1704,6 +1987,22 @@ static void decode_thread(void *data)
          av_packet_free(&pkt);
          break;
       }
+
+      /* Don't read further ahead while the audio queue is full,
+       * other than to find the next video packet */
+      if (audio_full &&
+            (
+               eof ||
+               video_stream_index < 0 ||
+               !packet_buffer_empty(video_packet_buffer)
+            )
+         )
+      {
+         if (packet_buffer_empty(video_packet_buffer))
+            packet_queue_wait_writable(audio_packet_queue, 10000);
+         av_packet_free(&pkt);
+         continue;
+      }
    
       // Read the next frame and stage it in case of audio or video frame.
       if (av_read_frame(fctx, pkt) < 0)
@@ -1748,8 +2047,19 @@ static void decode_thread(void *data)
       av_packet_free(&pkt);
    }
 
-   for (i = 0; (int)i < audio_streams_num; i++)
-      swr_free(&swr[i]);
+   if (audio_thread_handle)
+   {
+      /* Let the audio thread decode what it has left */
+      slock_lock(fifo_lock);
+      audio_packets_done = true;
+      slock_unlock(fifo_lock);
+
+      packet_queue_wake(audio_packet_queue);
+      sthread_join(audio_thread_handle);
+   }
+
+   packet_queue_destroy(audio_packet_queue);
+   audio_packet_queue = NULL;
 
 #if ENABLE_HW_ACCEL
    if (vctx && vctx->hw_device_ctx)
@@ -1759,9 +2069,6 @@ static void decode_thread(void *data)
    packet_buffer_destroy(audio_packet_buffer);
    packet_buffer_destroy(video_packet_buffer);
 
-   av_frame_free(&aud_frame);
-   av_freep(&audio_buffer);
-
    slock_lock(fifo_lock);
    decode_thread_dead = true;
    scond_signal(fifo_cond);
@@ -1771,6 +2078,12 @@ static void decode_thread(void *data)
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
 static void context_destroy(void)
 {
+#ifdef HAVE_FFMPEG_DRM_PRIME
+   /* Frames decoded meanwhile are copied */
+   drm_prime_direct = false;
+   drm_prime_release(&frames[0]);
+   drm_prime_release(&frames[1]);
+#endif
 #ifdef HAVE_GL_FFT
    if (fft)
    {
@@ -1791,6 +2104,81 @@ static void context_destroy(void)
 #include "gl_shaders/ffmpeg.glsl.frag.h"
 #endif
 
+#ifdef HAVE_FFMPEG_DRM_PRIME
+#include "gl_shaders/ffmpeg_external_es.glsl.frag.h"
+
+static void drm_prime_init(void)
+{
+   GLuint vert, frag;
+   unsigned i;
+   const char *egl_extensions = NULL;
+   const char *gl_extensions  = (const char*)glGetString(GL_EXTENSIONS);
+
+   drm_prime_direct           = false;
+   drm_prime_display          = eglGetCurrentDisplay();
+
+   if (drm_prime_display == EGL_NO_DISPLAY)
+      return;
+
+   egl_extensions = eglQueryString(drm_prime_display, EGL_EXTENSIONS);
+
+   if (     !egl_extensions
+         || !strstr(egl_extensions, "EGL_EXT_image_dma_buf_import")
+         || !gl_extensions
+         || !strstr(gl_extensions, "GL_OES_EGL_image_external"))
+      return;
+
+   drm_prime_create_image  = (PFNEGLCREATEIMAGEKHRPROC)
+      eglGetProcAddress("eglCreateImageKHR");
+   drm_prime_destroy_image = (PFNEGLDESTROYIMAGEKHRPROC)
+      eglGetProcAddress("eglDestroyImageKHR");
+
+   if (     !drm_prime_create_image
+         || !drm_prime_destroy_image
+         || !glEGLImageTargetTexture2DOES)
+      return;
+
+   prog_external = glCreateProgram();
+   vert          = glCreateShader(GL_VERTEX_SHADER);
+   frag          = glCreateShader(GL_FRAGMENT_SHADER);
+
+   glShaderSource(vert, 1, &vertex_source, NULL);
+   glShaderSource(frag, 1, &fragment_source_external, NULL);
+   glCompileShader(vert);
+   glCompileShader(frag);
+   glAttachShader(prog_external, vert);
+   glAttachShader(prog_external, frag);
+   /* Drawn from the same vertex buffer setup as prog */
+   glBindAttribLocation(prog_external, vertex_loc, "aVertex");
+   glBindAttribLocation(prog_external, tex_loc, "aTexCoord");
+   glLinkProgram(prog_external);
+
+   glUseProgram(prog_external);
+
+   glUniform1i(glGetUniformLocation(prog_external, "sTex0"), 0);
+   glUniform1i(glGetUniformLocation(prog_external, "sTex1"), 1);
+   mix_loc_external = glGetUniformLocation(prog_external, "uMix");
+
+   glUseProgram(0);
+
+   for (i = 0; i < 2; i++)
+   {
+      glGenTextures(1, &frames[i].tex_external);
+
+      glBindTexture(GL_TEXTURE_EXTERNAL_OES, frames[i].tex_external);
+      glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   }
+
+   glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+
+   log_cb(RETRO_LOG_INFO, "[FFMPEG] Importing DRM PRIME frames.\n");
+   drm_prime_direct = true;
+}
+#endif
+
 static void context_reset(void)
 {
    static const GLfloat vertex_data[] = {
@@ -1863,6 +2251,10 @@ static void context_reset(void)
 
    glBindBuffer(GL_ARRAY_BUFFER, 0);
    glBindTexture(GL_TEXTURE_2D, 0);
+
+#ifdef HAVE_FFMPEG_DRM_PRIME
+   drm_prime_init();
+#endif
 }
 #endif
 
@@ -1912,6 +2304,11 @@ void CORE_PREFIX(retro_unload_game)(void)
    decode_last_audio_time = 0.0;
 
    frames[0].pts = frames[1].pts = 0.0;
+#ifdef HAVE_FFMPEG_DRM_PRIME
+   /* Before the decoder they came from is closed */
+   drm_prime_release(&frames[0]);
+   drm_prime_release(&frames[1]);
+#endif
    pts_bias = 0.0;
    frame_cnt = 0;
    audio_frames = 0;
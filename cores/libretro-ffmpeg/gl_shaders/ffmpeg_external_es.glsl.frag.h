@@ -0,0 +1,13 @@
+/* Samples frames imported as EGL images, which the driver
+ * converts from YUV. The extension has to be enabled on the
+ * first line, which the GLSL() macro can't stringify. */
+static const char *fragment_source_external =
+      "#extension GL_OES_EGL_image_external : require\n"
+      "precision mediump float;\n"
+      "varying vec2 vTex;\n"
+      "uniform samplerExternalOES sTex0;\n"
+      "uniform samplerExternalOES sTex1;\n"
+      "uniform float uMix;\n"
+      "void main() {\n"
+      "   gl_FragColor = vec4(pow(mix(pow(texture2D(sTex0, vTex).rgb, vec3(2.2)), pow(texture2D(sTex1, vTex).rgb, vec3(2.2)), uMix), vec3(1.0 / 2.2)), 1.0);\n"
+      "}\n";
@@ -11,9 +11,31 @@ struct packet_buffer
 {
    AVPacketNode_t *head;
    AVPacketNode_t *tail;
+   /* Nodes taken out, with their packets, to be reused */
+   AVPacketNode_t *free_nodes;
    size_t size;
 };
 
+static void packet_buffer_free_nodes(AVPacketNode_t *node)
+{
+   while (node)
+   {
+      AVPacketNode_t *next = node->next;
+      av_packet_free(&node->data);
+      free(node);
+      node = next;
+   }
+}
+
+static void packet_buffer_recycle_node(packet_buffer_t *packet_buffer,
+      AVPacketNode_t *node)
+{
+   av_packet_unref(node->data);
+   node->previous            = NULL;
+   node->next                = packet_buffer->free_nodes;
+   packet_buffer->free_nodes = node;
+}
+
 packet_buffer_t *packet_buffer_create()
 {
    packet_buffer_t *b = (packet_buffer_t*)malloc(sizeof(packet_buffer_t));
@@ -27,33 +49,33 @@ packet_buffer_t *packet_buffer_create()
 
 void packet_buffer_destroy(packet_buffer_t *packet_buffer)
 {
-   AVPacketNode_t *node;
-
    if (!packet_buffer)
       return;
 
-   if (packet_buffer->head)
-   {
-      node = packet_buffer->head;
-      while (node)
-      {
-         AVPacketNode_t *next = node->next;
-         av_packet_free(&node->data);
-         free(node);
-         node = next;
-      }
-   }
+   packet_buffer_free_nodes(packet_buffer->head);
+   packet_buffer_free_nodes(packet_buffer->free_nodes);
 
    free(packet_buffer);
 }
 
 void packet_buffer_clear(packet_buffer_t **packet_buffer)
 {
-   if (!packet_buffer)
+   AVPacketNode_t *node;
+
+   if (!packet_buffer || !*packet_buffer)
       return;
 
-   packet_buffer_destroy(*packet_buffer);
-   *packet_buffer = packet_buffer_create();
+   node = (*packet_buffer)->head;
+   while (node)
+   {
+      AVPacketNode_t *next = node->next;
+      packet_buffer_recycle_node(*packet_buffer, node);
+      node = next;
+   }
+
+   (*packet_buffer)->head = NULL;
+   (*packet_buffer)->tail = NULL;
+   (*packet_buffer)->size = 0;
 }
 
 bool packet_buffer_empty(packet_buffer_t *packet_buffer)
@@ -74,8 +96,21 @@ size_t packet_buffer_size(packet_buffer_t *packet_buffer)
 
 void packet_buffer_add_packet(packet_buffer_t *packet_buffer, AVPacket *pkt)
 {
-   AVPacketNode_t *new_head = (AVPacketNode_t *) malloc(sizeof(AVPacketNode_t));
-   new_head->data = av_packet_alloc();
+   AVPacketNode_t *new_head = packet_buffer->free_nodes;
+
+   if (new_head)
+      packet_buffer->free_nodes = new_head->next;
+   else
+   {
+      new_head = (AVPacketNode_t *) malloc(sizeof(AVPacketNode_t));
+      if (!new_head)
+         return;
+      if (!(new_head->data = av_packet_alloc()))
+      {
+         free(new_head);
+         return;
+      }
+   }
 
    av_packet_move_ref(new_head->data, pkt);
 
@@ -111,8 +146,7 @@ void packet_buffer_get_packet(packet_buffer_t *packet_buffer, AVPacket *pkt)
    else
       packet_buffer->head = NULL;
 
-   av_packet_free(&packet_buffer->tail->data);
-   free(packet_buffer->tail);
+   packet_buffer_recycle_node(packet_buffer, packet_buffer->tail);
 
    packet_buffer->tail = new_tail;
    packet_buffer->size--;
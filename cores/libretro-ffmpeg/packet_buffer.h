@@ -43,7 +43,7 @@ void packet_buffer_destroy(packet_buffer_t *packet_buffer);
  * packet_buffer_clear:
  * @packet_buffer      : packet buffer
  *
- * Clears a packet buffer by re-creating it.
+ * Clears a packet buffer, keeping its nodes for reuse.
  *
  **/
 void packet_buffer_clear(packet_buffer_t **packet_buffer);
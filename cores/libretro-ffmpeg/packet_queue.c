@@ -0,0 +1,173 @@
+#include <stdlib.h>
+
+#include <rthreads/rthreads.h>
+
+#include "packet_queue.h"
+
+/* The producer only moves the head and the consumer only moves
+ * the tail, so pushing and popping need no lock. The lock is
+ * only taken to sleep on and signal the conditions.
+ * Without GCC atomics, this relies on volatile accesses being
+ * ordered, as they are with MSVC on x86. */
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define PACKET_QUEUE_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define PACKET_QUEUE_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#else
+#define PACKET_QUEUE_LOAD(ptr)       (*(ptr))
+#define PACKET_QUEUE_STORE(ptr, val) (*(ptr) = (val))
+#endif
+
+struct packet_queue
+{
+   AVPacket **packets;
+   int *serials;
+   size_t mask;
+   slock_t *lock;
+   scond_t *readable_cond;
+   scond_t *writable_cond;
+   /* Count of packets pushed, written by the producer only */
+   volatile size_t head;
+   /* Count of packets popped, written by the consumer only */
+   volatile size_t tail;
+};
+
+/* Wakes up the other thread, in case it waits for us. */
+static void packet_queue_signal(packet_queue_t *packet_queue,
+      scond_t *cond)
+{
+   /* Under the lock, so that a waiter that just found the
+    * queue empty or full is asleep by now */
+   slock_lock(packet_queue->lock);
+   scond_signal(cond);
+   slock_unlock(packet_queue->lock);
+}
+
+packet_queue_t *packet_queue_create(size_t capacity)
+{
+   size_t i;
+   size_t size       = 1;
+   packet_queue_t *q = (packet_queue_t*)calloc(1, sizeof(packet_queue_t));
+   if (!q)
+      return NULL;
+
+   while (size < capacity)
+      size <<= 1;
+   q->mask          = size - 1;
+
+   q->lock          = slock_new();
+   q->readable_cond = scond_new();
+   q->writable_cond = scond_new();
+   q->packets       = (AVPacket**)calloc(size, sizeof(AVPacket*));
+   q->serials       = (int*)calloc(size, sizeof(int));
+   if (     !q->lock
+         || !q->readable_cond
+         || !q->writable_cond
+         || !q->packets
+         || !q->serials)
+      goto fail;
+
+   for (i = 0; i < size; i++)
+      if (!(q->packets[i] = av_packet_alloc()))
+         goto fail;
+
+   return q;
+
+fail:
+   packet_queue_destroy(q);
+   return NULL;
+}
+
+void packet_queue_destroy(packet_queue_t *packet_queue)
+{
+   size_t i;
+
+   if (!packet_queue)
+      return;
+
+   if (packet_queue->packets)
+      for (i = 0; i <= packet_queue->mask; i++)
+         av_packet_free(&packet_queue->packets[i]);
+
+   if (packet_queue->lock)
+      slock_free(packet_queue->lock);
+   if (packet_queue->readable_cond)
+      scond_free(packet_queue->readable_cond);
+   if (packet_queue->writable_cond)
+      scond_free(packet_queue->writable_cond);
+   free(packet_queue->packets);
+   free(packet_queue->serials);
+   free(packet_queue);
+}
+
+bool packet_queue_full(packet_queue_t *packet_queue)
+{
+   return packet_queue->head - PACKET_QUEUE_LOAD(&packet_queue->tail)
+      > packet_queue->mask;
+}
+
+bool packet_queue_push(packet_queue_t *packet_queue,
+      AVPacket *pkt, int serial)
+{
+   size_t head = packet_queue->head;
+   size_t slot = head & packet_queue->mask;
+
+   if (packet_queue_full(packet_queue))
+      return false;
+
+   av_packet_move_ref(packet_queue->packets[slot], pkt);
+   packet_queue->serials[slot] = serial;
+   PACKET_QUEUE_STORE(&packet_queue->head, head + 1);
+
+   packet_queue_signal(packet_queue, packet_queue->readable_cond);
+   return true;
+}
+
+bool packet_queue_pop(packet_queue_t *packet_queue,
+      AVPacket *pkt, int *serial)
+{
+   size_t tail = packet_queue->tail;
+   size_t slot = tail & packet_queue->mask;
+
+   if (PACKET_QUEUE_LOAD(&packet_queue->head) == tail)
+      return false;
+
+   av_packet_move_ref(pkt, packet_queue->packets[slot]);
+   *serial = packet_queue->serials[slot];
+   PACKET_QUEUE_STORE(&packet_queue->tail, tail + 1);
+
+   packet_queue_signal(packet_queue, packet_queue->writable_cond);
+   return true;
+}
+
+bool packet_queue_wait_readable(packet_queue_t *packet_queue,
+      int64_t timeout_us)
+{
+   slock_lock(packet_queue->lock);
+   if (PACKET_QUEUE_LOAD(&packet_queue->head) == packet_queue->tail)
+      scond_wait_timeout(packet_queue->readable_cond,
+            packet_queue->lock, timeout_us);
+   slock_unlock(packet_queue->lock);
+
+   return PACKET_QUEUE_LOAD(&packet_queue->head) != packet_queue->tail;
+}
+
+bool packet_queue_wait_writable(packet_queue_t *packet_queue,
+      int64_t timeout_us)
+{
+   slock_lock(packet_queue->lock);
+   if (packet_queue_full(packet_queue))
+      scond_wait_timeout(packet_queue->writable_cond,
+            packet_queue->lock, timeout_us);
+   slock_unlock(packet_queue->lock);
+
+   return !packet_queue_full(packet_queue);
+}
+
+void packet_queue_wake(packet_queue_t *packet_queue)
+{
+   slock_lock(packet_queue->lock);
+   scond_signal(packet_queue->readable_cond);
+   scond_signal(packet_queue->writable_cond);
+   slock_unlock(packet_queue->lock);
+}
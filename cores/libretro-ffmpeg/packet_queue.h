@@ -0,0 +1,121 @@
+#ifndef __LIBRETRO_SDK_PACKETQUEUE_H__
+#define __LIBRETRO_SDK_PACKETQUEUE_H__
+
+#include <retro_common_api.h>
+
+#include <boolean.h>
+#include <stdint.h>
+
+#include <libavcodec/avcodec.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * packet_queue
+ *
+ * A fixed size ring of AVPackets, passed from exactly one
+ * producer thread to exactly one consumer thread without
+ * locking. Every packet carries a serial, so the consumer
+ * can tell which ones are from before a seek.
+ *
+ */
+struct packet_queue;
+typedef struct packet_queue packet_queue_t;
+
+/**
+ * packet_queue_create:
+ * @capacity           : How many packets the queue holds,
+ *                       rounded up to a power of two.
+ *
+ * Create a packet_queue.
+ *
+ * Returns: A packet queue, or NULL on failure.
+ */
+packet_queue_t *packet_queue_create(size_t capacity);
+
+/**
+ * packet_queue_destroy:
+ * @packet_queue       : packet queue
+ *
+ * Destroys a packet queue, and the packets still in it.
+ * Neither thread may use it anymore.
+ *
+ **/
+void packet_queue_destroy(packet_queue_t *packet_queue);
+
+/**
+ * packet_queue_full:
+ * @packet_queue       : packet queue
+ *
+ * Producer only.
+ *
+ * Returns: true if there is no room to push.
+ **/
+bool packet_queue_full(packet_queue_t *packet_queue);
+
+/**
+ * packet_queue_push:
+ * @packet_queue       : packet queue
+ * @pkt                : packet
+ * @serial             : serial to hand along with it
+ *
+ * Moves the given packet into the queue. Producer only.
+ *
+ * Returns: false if the queue is full, in which case
+ * @pkt is left untouched.
+ **/
+bool packet_queue_push(packet_queue_t *packet_queue,
+      AVPacket *pkt, int serial);
+
+/**
+ * packet_queue_pop:
+ * @packet_queue       : packet queue
+ * @pkt                : packet
+ * @serial             : serial it was pushed with
+ *
+ * Moves the oldest packet out of the queue. Consumer only.
+ * User needs to unref the packet with av_packet_unref().
+ *
+ * Returns: false if the queue is empty.
+ **/
+bool packet_queue_pop(packet_queue_t *packet_queue,
+      AVPacket *pkt, int *serial);
+
+/**
+ * packet_queue_wait_readable:
+ * @packet_queue       : packet queue
+ * @timeout_us         : Longest time to wait, in microseconds.
+ *
+ * Sleeps until there is a packet to pop, the timeout
+ * runs out or packet_queue_wake() is called. Consumer only.
+ *
+ * Returns: true if there is a packet to pop.
+ **/
+bool packet_queue_wait_readable(packet_queue_t *packet_queue,
+      int64_t timeout_us);
+
+/**
+ * packet_queue_wait_writable:
+ * @packet_queue       : packet queue
+ * @timeout_us         : Longest time to wait, in microseconds.
+ *
+ * Sleeps until there is room to push, the timeout runs out
+ * or packet_queue_wake() is called. Producer only.
+ *
+ * Returns: true if there is room to push.
+ **/
+bool packet_queue_wait_writable(packet_queue_t *packet_queue,
+      int64_t timeout_us);
+
+/**
+ * packet_queue_wake:
+ * @packet_queue       : packet queue
+ *
+ * Wakes up both threads, if they are waiting.
+ *
+ **/
+void packet_queue_wake(packet_queue_t *packet_queue);
+
+RETRO_END_DECLS
+
+#endif
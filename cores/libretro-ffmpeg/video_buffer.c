@@ -4,6 +4,21 @@
 
 #include "video_buffer.h"
 
+/* The status of a slot is the only state shared between the
+ * decode thread (head), the sws workers and the main thread
+ * (tail), so checking and moving slots needs no lock. The lock
+ * is only taken to sleep on and signal the conditions.
+ * Without GCC atomics, this relies on volatile accesses being
+ * ordered, as they are with MSVC on x86. */
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define VIDEO_BUFFER_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define VIDEO_BUFFER_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#else
+#define VIDEO_BUFFER_LOAD(ptr)       (*(ptr))
+#define VIDEO_BUFFER_STORE(ptr, val) (*(ptr) = (val))
+#endif
+
 enum kbStatus
 {
   KB_OPEN,
@@ -14,7 +29,7 @@ enum kbStatus
 struct video_buffer
 {
    video_decoder_context_t *buffer;
-   enum kbStatus *status;
+   volatile int *status;
    size_t capacity;
    slock_t *lock;
    scond_t *open_cond;
@@ -23,6 +38,20 @@ struct video_buffer
    int64_t tail;
 };
 
+/* Moves a slot from one status to another, wakes up whoever
+ * waits for it. */
+static void video_buffer_set_status(video_buffer_t *video_buffer,
+      int index, int status, scond_t *cond)
+{
+   VIDEO_BUFFER_STORE(&video_buffer->status[index], status);
+
+   /* Under the lock, so that a waiter that just found the
+    * slot busy is asleep by now */
+   slock_lock(video_buffer->lock);
+   scond_signal(cond);
+   slock_unlock(video_buffer->lock);
+}
+
 video_buffer_t *video_buffer_create(size_t capacity, int frame_size, int width, int height)
 {
    video_buffer_t *b = (video_buffer_t*)malloc(sizeof(video_buffer_t));
@@ -32,7 +61,7 @@ video_buffer_t *video_buffer_create(size_t capacity, int frame_size, int width,
    memset(b, 0, sizeof(video_buffer_t));
    b->capacity = capacity;
 
-   b->status = (enum kbStatus*)malloc(sizeof(enum kbStatus) * capacity);
+   b->status = (volatile int*)malloc(sizeof(int) * capacity);
    if (!b->status)
       goto fail;
    for (int i = 0; i < capacity; i++)
@@ -87,7 +116,7 @@ void video_buffer_destroy(video_buffer_t *video_buffer)
    slock_free(video_buffer->lock);
    scond_free(video_buffer->open_cond);
    scond_free(video_buffer->finished_cond);
-   free(video_buffer->status);
+   free((void*)video_buffer->status);
    if (video_buffer->buffer)
       for (int i = 0; i < video_buffer->capacity; i++)
       {
@@ -116,83 +145,65 @@ void video_buffer_clear(video_buffer_t *video_buffer)
    video_buffer->head = 0;
    video_buffer->tail = 0;
    for (int i = 0; i < video_buffer->capacity; i++)
-      video_buffer->status[i] = KB_OPEN;
+      VIDEO_BUFFER_STORE(&video_buffer->status[i], KB_OPEN);
 
    slock_unlock(video_buffer->lock);
 }
 
 void video_buffer_get_open_slot(video_buffer_t *video_buffer, video_decoder_context_t **context)
 {
-   slock_lock(video_buffer->lock);
-
-   if (video_buffer->status[video_buffer->head] == KB_OPEN)
+   if (VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->head]) == KB_OPEN)
    {
       *context = &video_buffer->buffer[video_buffer->head];
-      video_buffer->status[video_buffer->head] = KB_IN_PROGRESS;
+      VIDEO_BUFFER_STORE(&video_buffer->status[video_buffer->head], KB_IN_PROGRESS);
       video_buffer->head++;
       video_buffer->head %= video_buffer->capacity;
    }
-
-   slock_unlock(video_buffer->lock);
 }
 
 void video_buffer_return_open_slot(video_buffer_t *video_buffer, video_decoder_context_t *context)
 {
-   slock_lock(video_buffer->lock);
-
-   if (video_buffer->status[context->index] == KB_IN_PROGRESS)
+   if (VIDEO_BUFFER_LOAD(&video_buffer->status[context->index]) == KB_IN_PROGRESS)
    {
-      video_buffer->status[context->index] = KB_OPEN;
-      video_buffer->head--;
+      video_buffer->head += video_buffer->capacity - 1;
       video_buffer->head %= video_buffer->capacity;
+      video_buffer_set_status(video_buffer, context->index, KB_OPEN,
+            video_buffer->open_cond);
    }
-
-   slock_unlock(video_buffer->lock);
 }
 
 void video_buffer_open_slot(video_buffer_t *video_buffer, video_decoder_context_t *context)
 {
-   slock_lock(video_buffer->lock);
-
-   if (video_buffer->status[context->index] == KB_FINISHED)
+   if (VIDEO_BUFFER_LOAD(&video_buffer->status[context->index]) == KB_FINISHED)
    {
-      video_buffer->status[context->index] = KB_OPEN;
       video_buffer->tail++;
       video_buffer->tail %= (video_buffer->capacity);
-      scond_signal(video_buffer->open_cond);
+      video_buffer_set_status(video_buffer, context->index, KB_OPEN,
+            video_buffer->open_cond);
    }
-
-   slock_unlock(video_buffer->lock);
 }
 
 void video_buffer_get_finished_slot(video_buffer_t *video_buffer, video_decoder_context_t **context)
 {
-   slock_lock(video_buffer->lock);
-
-   if (video_buffer->status[video_buffer->tail] == KB_FINISHED)
+   if (VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->tail]) == KB_FINISHED)
       *context = &video_buffer->buffer[video_buffer->tail];
-
-   slock_unlock(video_buffer->lock);
 }
 
 void video_buffer_finish_slot(video_buffer_t *video_buffer, video_decoder_context_t *context)
 {
-   slock_lock(video_buffer->lock);
-
-   if (video_buffer->status[context->index] == KB_IN_PROGRESS)
-   {
-      video_buffer->status[context->index] = KB_FINISHED;
-      scond_signal(video_buffer->finished_cond);
-   }
-
-   slock_unlock(video_buffer->lock);
+   if (VIDEO_BUFFER_LOAD(&video_buffer->status[context->index]) == KB_IN_PROGRESS)
+      video_buffer_set_status(video_buffer, context->index, KB_FINISHED,
+            video_buffer->finished_cond);
 }
 
 bool video_buffer_wait_for_open_slot(video_buffer_t *video_buffer)
 {
+   if (video_buffer_has_open_slot(video_buffer))
+      return true;
+
    slock_lock(video_buffer->lock);
 
-   while (video_buffer->status[video_buffer->head] != KB_OPEN)
+   while (VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->head]) != KB_OPEN)
       scond_wait(video_buffer->open_cond, video_buffer->lock);
 
    slock_unlock(video_buffer->lock);
@@ -200,42 +211,43 @@ bool video_buffer_wait_for_open_slot(video_buffer_t *video_buffer)
    return true;
 }
 
-bool video_buffer_wait_for_finished_slot(video_buffer_t *video_buffer)
+bool video_buffer_wait_for_open_slot_timeout(video_buffer_t *video_buffer,
+      int64_t timeout_us)
 {
+   if (video_buffer_has_open_slot(video_buffer))
+      return true;
+
    slock_lock(video_buffer->lock);
 
-   while (video_buffer->status[video_buffer->tail] != KB_FINISHED)
-      scond_wait(video_buffer->finished_cond, video_buffer->lock);
+   if (VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->head]) != KB_OPEN)
+      scond_wait_timeout(video_buffer->open_cond, video_buffer->lock, timeout_us);
 
    slock_unlock(video_buffer->lock);
 
-   return true;
+   return video_buffer_has_open_slot(video_buffer);
 }
 
-bool video_buffer_has_open_slot(video_buffer_t *video_buffer)
+bool video_buffer_wait_for_finished_slot(video_buffer_t *video_buffer)
 {
-   bool ret = false;
+   if (video_buffer_has_finished_slot(video_buffer))
+      return true;
 
    slock_lock(video_buffer->lock);
 
-   if (video_buffer->status[video_buffer->head] == KB_OPEN)
-      ret = true;
+   while (VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->tail]) != KB_FINISHED)
+      scond_wait(video_buffer->finished_cond, video_buffer->lock);
 
    slock_unlock(video_buffer->lock);
 
-   return ret;
+   return true;
 }
 
-bool video_buffer_has_finished_slot(video_buffer_t *video_buffer)
+bool video_buffer_has_open_slot(video_buffer_t *video_buffer)
 {
-   bool ret = false;
-
-   slock_lock(video_buffer->lock);
-
-   if (video_buffer->status[video_buffer->tail] == KB_FINISHED)
-      ret = true;
-
-   slock_unlock(video_buffer->lock);
+   return VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->head]) == KB_OPEN;
+}
 
-   return ret;
+bool video_buffer_has_finished_slot(video_buffer_t *video_buffer)
+{
+   return VIDEO_BUFFER_LOAD(&video_buffer->status[video_buffer->tail]) == KB_FINISHED;
 }
@@ -54,6 +54,9 @@ typedef struct video_decoder_context video_decoder_context_t;
  * with one work coordinator, that allocates work slots for
  * workers threads to work on and later collect the work
  * product in the same order, as the slots were allocated.
+ *
+ * The slots and their frames are allocated once and reused;
+ * handing them around takes no lock, only waiting does.
  * 
  */
 struct video_buffer;
@@ -161,6 +164,18 @@ void video_buffer_finish_slot(video_buffer_t *video_buffer, video_decoder_contex
  */
 bool video_buffer_wait_for_open_slot(video_buffer_t *video_buffer);
 
+/**
+ * video_buffer_wait_for_open_slot_timeout:
+ * @video_buffer      : video buffer.
+ * @timeout_us        : Longest time to wait, in microseconds.
+ *
+ * Blocks until open slot is available, or for @timeout_us.
+ *
+ * Returns true if the buffer has a open slot available.
+ */
+bool video_buffer_wait_for_open_slot_timeout(video_buffer_t *video_buffer,
+      int64_t timeout_us);
+
 /**
  * video_buffer_wait_for_finished_slot:
  * @video_buffer      : video buffer.
@@ -20,6 +20,7 @@
 
 #include <compat/strl.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
 #include <file/file_path.h>
 #include <lists/string_list.h>
 #include <lists/dir_list.h>
@@ -140,30 +141,24 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
    return ret;
 }
 
-static int database_cursor_iterate(libretrodb_cursor_t *cur,
+/* Fills @db_info from @item */
+static int database_info_read_item(const struct rmsgpack_dom_value *item,
       database_info_t *db_info)
 {
    unsigned i;
-   struct rmsgpack_dom_value item;
    const char* str                = NULL;
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
-      return -1;
-
-   if (item.type != RDT_MAP)
-   {
-      rmsgpack_dom_value_free(&item);
+   if (item->type != RDT_MAP)
       return 1;
-   }
 
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   for (i = 0; i < item->val.map.len; i++)
    {
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
+      struct rmsgpack_dom_value *key = &item->val.map.items[i].key;
+      struct rmsgpack_dom_value *val = &item->val.map.items[i].value;
       const char *val_string         = NULL;
 
       if (!key || !val)
@@ -285,11 +280,20 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
                (uint8_t*)val->val.binary.buff, val->val.binary.len);
    }
 
-   rmsgpack_dom_value_free(&item);
-
    return 0;
 }
 
+static int database_cursor_iterate(libretrodb_cursor_t *cur,
+      database_info_t *db_info)
+{
+   struct rmsgpack_dom_value item;
+
+   if (libretrodb_cursor_read_item(cur, &item) != 0)
+      return -1;
+
+   return database_info_read_item(&item, db_info);
+}
+
 static int database_cursor_open(libretrodb_t *db,
       libretrodb_cursor_t *cur, const char *path, const char *query)
 {
@@ -526,6 +530,157 @@ end:
    return database_info_list;
 }
 
+struct database_info_index
+{
+   libretrodb_t *db;
+   struct
+   {
+      char *name;
+      libretrodb_hash_t *hash;
+   } fields[4];
+   unsigned count;
+};
+
+/**
+ * database_info_index_new:
+ * @rdb_path             : database to look up entries in.
+ *
+ * Opens a database to look up entries by their binary fields, like
+ * "crc" or "serial". Each field is indexed the first time an entry
+ * is looked up by it, reading the whole database just that once.
+ * Only the entries found are read after that.
+ *
+ * Returns: the index, or NULL if the database couldn't be opened.
+ **/
+database_info_index_t *database_info_index_new(const char *rdb_path)
+{
+   database_info_index_t *index = (database_info_index_t*)
+      calloc(1, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   index->db = libretrodb_new();
+   if (!index->db || libretrodb_open(rdb_path, index->db) != 0)
+   {
+      libretrodb_free(index->db);
+      free(index);
+      return NULL;
+   }
+
+   return index;
+}
+
+void database_info_index_free(database_info_index_t *index)
+{
+   unsigned i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i < index->count; i++)
+   {
+      free(index->fields[i].name);
+      libretrodb_hash_free(index->fields[i].hash);
+   }
+
+   libretrodb_close(index->db);
+   libretrodb_free(index->db);
+   free(index);
+}
+
+static libretrodb_hash_t *database_info_index_get_hash(
+      database_info_index_t *index, const char *field)
+{
+   unsigned i;
+   libretrodb_hash_t *hash = NULL;
+
+   for (i = 0; i < index->count; i++)
+      if (string_is_equal(index->fields[i].name, field))
+         return index->fields[i].hash;
+
+   if (index->count >= ARRAY_SIZE(index->fields))
+      return NULL;
+
+   /* Failures are kept too, not to read the database again */
+   hash = libretrodb_hash_new(index->db, field);
+   index->fields[index->count].name = strdup(field);
+   index->fields[index->count].hash = hash;
+   index->count++;
+
+   return hash;
+}
+
+/**
+ * database_info_index_find:
+ * @index                : database to look up entries in.
+ * @field                : binary field to look up entries by.
+ * @keys                 : values of @field, one after the other.
+ * @num_keys             : number of values in @keys.
+ * @key_len              : size of each value.
+ *
+ * Looks up the entries with @field set to any of @keys, those with
+ * the first key first.
+ *
+ * Returns: the entries found, to be freed, or NULL if the field
+ * couldn't be indexed.
+ **/
+database_info_list_t *database_info_index_find(database_info_index_t *index,
+      const char *field, const void *keys, unsigned num_keys,
+      uint32_t key_len)
+{
+   unsigned i;
+   database_info_list_t *list = NULL;
+   libretrodb_hash_t *hash    = database_info_index_get_hash(index, field);
+
+   if (!hash)
+      return NULL;
+
+   list = (database_info_list_t*)calloc(1, sizeof(*list));
+   if (!list)
+      return NULL;
+
+   for (i = 0; i < num_keys; i++)
+   {
+      struct rmsgpack_dom_value item;
+      size_t iter     = 0;
+      const void *key = (const uint8_t*)keys + i * key_len;
+
+      while (libretrodb_hash_find(index->db, hash,
+               key, key_len, &iter, &item) == 0)
+      {
+         database_info_t db_info  = {0};
+         database_info_t *new_ptr = NULL;
+         int rv                   = database_info_read_item(&item, &db_info);
+
+         rmsgpack_dom_value_free(&item);
+
+         if (rv != 0)
+            continue;
+
+         new_ptr = (database_info_t*)realloc(list->list,
+               (list->count + 1) * sizeof(*new_ptr));
+
+         if (!new_ptr)
+         {
+            database_info_list_t entry;
+
+            entry.count = 1;
+            entry.list  = (database_info_t*)malloc(sizeof(db_info));
+            if (entry.list)
+               memcpy(entry.list, &db_info, sizeof(db_info));
+            database_info_list_free(&entry);
+            break;
+         }
+
+         list->list = new_ptr;
+         memcpy(&list->list[list->count++], &db_info, sizeof(db_info));
+      }
+   }
+
+   return list;
+}
+
 void database_info_list_free(database_info_list_t *database_info_list)
 {
    size_t i;
@@ -120,9 +120,20 @@ typedef struct
    database_info_t *list;
 } database_info_list_t;
 
+/* Database with entries looked up by index, see database_info_index_new */
+typedef struct database_info_index database_info_index_t;
+
 database_info_list_t *database_info_list_new(const char *rdb_path,
       const char *query);
 
+database_info_index_t *database_info_index_new(const char *rdb_path);
+
+void database_info_index_free(database_info_index_t *index);
+
+database_info_list_t *database_info_index_find(database_info_index_t *index,
+      const char *field, const void *keys, unsigned num_keys,
+      uint32_t key_len);
+
 void database_info_list_free(database_info_list_t *list);
 
 database_info_handle_t *database_info_dir_init(const char *dir,
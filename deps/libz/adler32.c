@@ -45,16 +45,169 @@
 #  define MOD(a) a %= BASE
 #endif
 
-/* ========================================================================= */
-uint32_t adler32(uint32_t adler, const uint8_t *buf, size_t len)
+/* ADLER32_SIMD: 32 bytes at a time, with the sums of each column of bytes
+   kept apart and weighted at the end. Within NMAX bytes, the same bound as
+   the scalar loop keeps every partial sum within 32 bits. */
+#ifdef ADLER32_SIMD
+#  if defined(__SSE2__) || defined(_M_X64) || \
+      (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define ADLER32_SIMD_SSE2
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+#    include <arm_neon.h>
+#    define ADLER32_SIMD_NEON
+#  endif
+#endif
+
+#define BLOCK_SIZE 32
+
+#if defined(ADLER32_SIMD_SSE2)
+static uint32_t sum_epi32(__m128i v)
+{
+   v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+   v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+   return (uint32_t)_mm_cvtsi128_si32(v);
+}
+
+/* len is a multiple of BLOCK_SIZE */
+static uint32_t adler32_simd(uint32_t adler, const uint8_t *buf, size_t len)
 {
    uint32_t s1 = adler & 0xffff;
    uint32_t s2 = (adler >> 16) & 0xffff;
+   size_t blocks = len / BLOCK_SIZE;
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i w1 = _mm_setr_epi16(32, 31, 30, 29, 28, 27, 26, 25);
+   const __m128i w2 = _mm_setr_epi16(24, 23, 22, 21, 20, 19, 18, 17);
+   const __m128i w3 = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+   const __m128i w4 = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+
+   while (blocks) {
+      size_t n = blocks < NMAX / BLOCK_SIZE ? blocks : NMAX / BLOCK_SIZE;
+      /* s1 before each block, added BLOCK_SIZE times to s2 */
+      __m128i v_ps = _mm_setr_epi32((int)(s1 * n), 0, 0, 0);
+      __m128i v_s1 = zero;
+      __m128i v_s2 = zero;
+
+      blocks -= n;
+
+      do {
+         const __m128i a = _mm_loadu_si128((const __m128i*)buf);
+         const __m128i b = _mm_loadu_si128((const __m128i*)(buf + 16));
+
+         v_ps = _mm_add_epi32(v_ps, v_s1);
+         v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(a, zero));
+         v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b, zero));
+         v_s2 = _mm_add_epi32(v_s2,
+               _mm_madd_epi16(_mm_unpacklo_epi8(a, zero), w1));
+         v_s2 = _mm_add_epi32(v_s2,
+               _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), w2));
+         v_s2 = _mm_add_epi32(v_s2,
+               _mm_madd_epi16(_mm_unpacklo_epi8(b, zero), w3));
+         v_s2 = _mm_add_epi32(v_s2,
+               _mm_madd_epi16(_mm_unpackhi_epi8(b, zero), w4));
+
+         buf += BLOCK_SIZE;
+      } while (--n);
+
+      v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+      s1 += sum_epi32(v_s1);
+      s2 += sum_epi32(v_s2);
+      MOD(s1);
+      MOD(s2);
+   }
+
+   return (s2 << 16) | s1;
+}
+#elif defined(ADLER32_SIMD_NEON)
+static uint32_t sum_u32(uint32x4_t v)
+{
+   uint32x2_t sum = vpadd_u32(vget_low_u32(v), vget_high_u32(v));
+   sum = vpadd_u32(sum, sum);
+   return vget_lane_u32(sum, 0);
+}
+
+/* len is a multiple of BLOCK_SIZE */
+static uint32_t adler32_simd(uint32_t adler, const uint8_t *buf, size_t len)
+{
+   static const uint16_t weights[BLOCK_SIZE] = {
+      32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+      16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1
+   };
+   uint32_t s1 = adler & 0xffff;
+   uint32_t s2 = (adler >> 16) & 0xffff;
+   size_t blocks = len / BLOCK_SIZE;
+
+   while (blocks) {
+      size_t n = blocks < NMAX / BLOCK_SIZE ? blocks : NMAX / BLOCK_SIZE;
+      /* s1 before each block, added BLOCK_SIZE times to s2 */
+      uint32x4_t v_s2 = vsetq_lane_u32((uint32_t)(s1 * n),
+            vdupq_n_u32(0), 0);
+      uint32x4_t v_s1 = vdupq_n_u32(0);
+      /* At most 255 * NMAX / BLOCK_SIZE, within 16 bits */
+      uint16x8_t col1 = vdupq_n_u16(0);
+      uint16x8_t col2 = vdupq_n_u16(0);
+      uint16x8_t col3 = vdupq_n_u16(0);
+      uint16x8_t col4 = vdupq_n_u16(0);
+
+      blocks -= n;
+
+      do {
+         const uint8x16_t a = vld1q_u8(buf);
+         const uint8x16_t b = vld1q_u8(buf + 16);
+
+         v_s2 = vaddq_u32(v_s2, v_s1);
+         v_s1 = vpadalq_u16(v_s1, vpadalq_u8(vpaddlq_u8(a), b));
+         col1 = vaddw_u8(col1, vget_low_u8(a));
+         col2 = vaddw_u8(col2, vget_high_u8(a));
+         col3 = vaddw_u8(col3, vget_low_u8(b));
+         col4 = vaddw_u8(col4, vget_high_u8(b));
+
+         buf += BLOCK_SIZE;
+      } while (--n);
+
+      v_s2 = vshlq_n_u32(v_s2, 5);
+      v_s2 = vmlal_u16(v_s2, vget_low_u16(col1),  vld1_u16(weights));
+      v_s2 = vmlal_u16(v_s2, vget_high_u16(col1), vld1_u16(weights + 4));
+      v_s2 = vmlal_u16(v_s2, vget_low_u16(col2),  vld1_u16(weights + 8));
+      v_s2 = vmlal_u16(v_s2, vget_high_u16(col2), vld1_u16(weights + 12));
+      v_s2 = vmlal_u16(v_s2, vget_low_u16(col3),  vld1_u16(weights + 16));
+      v_s2 = vmlal_u16(v_s2, vget_high_u16(col3), vld1_u16(weights + 20));
+      v_s2 = vmlal_u16(v_s2, vget_low_u16(col4),  vld1_u16(weights + 24));
+      v_s2 = vmlal_u16(v_s2, vget_high_u16(col4), vld1_u16(weights + 28));
+
+      s1 += sum_u32(v_s1);
+      s2 += sum_u32(v_s2);
+      MOD(s1);
+      MOD(s2);
+   }
+
+   return (s2 << 16) | s1;
+}
+#endif
+
+/* ========================================================================= */
+uint32_t adler32(uint32_t adler, const uint8_t *buf, size_t len)
+{
+   uint32_t s1;
+   uint32_t s2;
    int k;
 
    if (buf == NULL)
       return 1L;
 
+#if defined(ADLER32_SIMD_SSE2) || defined(ADLER32_SIMD_NEON)
+   if (len >= BLOCK_SIZE * 2) {
+      size_t simd_len = len - len % BLOCK_SIZE;
+      adler = adler32_simd(adler, buf, simd_len);
+      buf += simd_len;
+      len -= simd_len;
+   }
+#endif
+
+   s1 = adler & 0xffff;
+   s2 = (adler >> 16) & 0xffff;
+
    while (len > 0) {
       k = len < NMAX ? (int)len : NMAX;
       len -= k;
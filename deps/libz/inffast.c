@@ -10,6 +10,253 @@
 
 #ifndef ASMINF
 
+#ifdef INFLATE_CHUNK
+
+#include <stdint.h>
+#include <string.h>
+
+/* Eight bytes of input, the first one in the low bits */
+local uint64_t inflate_load64(const unsigned char FAR *in)
+{
+   uint64_t val;
+#ifdef MSB_FIRST
+   unsigned i;
+   val = 0;
+   for (i = 8; i-- > 0;)
+      val = (val << 8) | in[i];
+#else
+   memcpy(&val, in, sizeof(val));
+#endif
+   return val;
+}
+
+/* Copies a match of len bytes dist bytes back in the output, 8 bytes at
+   a time when the source is far enough behind not to overlap a chunk.
+   Up to 7 bytes past the match are written over. */
+local unsigned char FAR *inflate_chunk_copy(unsigned char FAR *out,
+      unsigned dist, unsigned len)
+{
+   const unsigned char FAR *from = out - dist;
+   unsigned char FAR *end = out + len;
+
+   if (dist >= 8) {
+      do {
+         memcpy(out, from, 8);
+         out += 8;
+         from += 8;
+      } while (out < end);
+      return end;
+   }
+   if (dist == 1) {
+      memset(out, out[-1], len);
+      return end;
+   }
+   while (out < end)
+      *out++ = *from++;
+   return end;
+}
+
+/*
+   Same as the inflate_fast() below, except:
+
+   - the bit buffer is 64 bits wide and filled up to at least 56 bits once
+     per code, which is enough for a whole length/distance pair (48 bits),
+     so there are no other input checks in the loop
+   - matches are copied with memcpy() and inflate_chunk_copy()
+
+   Entry assumptions:
+
+   state->mode == LEN
+   strm->avail_in >= INFLATE_FAST_MIN_INPUT
+   strm->avail_out >= INFLATE_FAST_MIN_OUTPUT
+   start >= strm->avail_out
+   state->bits < 8
+*/
+void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start)
+{
+   struct inflate_state FAR *state;
+   unsigned char FAR *in;      /* local strm->next_in */
+   unsigned char FAR *last;    /* have enough input while in < last */
+   unsigned char FAR *out;     /* local strm->next_out */
+   unsigned char FAR *beg;     /* inflate()'s initial strm->next_out */
+   unsigned char FAR *end;     /* while out < end, enough space available */
+#ifdef INFLATE_STRICT
+   unsigned dmax;              /* maximum distance from zlib header */
+#endif
+   unsigned wsize;             /* window size or zero if not using window */
+   unsigned whave;             /* valid bytes in the window */
+   unsigned wnext;             /* window write index */
+   unsigned char FAR *window;  /* allocated sliding window, if wsize != 0 */
+   uint64_t hold;              /* local strm->hold */
+   unsigned bits;              /* local strm->bits */
+   code const FAR *lcode;      /* local strm->lencode */
+   code const FAR *dcode;      /* local strm->distcode */
+   unsigned lmask;             /* mask for first level of length codes */
+   unsigned dmask;             /* mask for first level of distance codes */
+   code here;                  /* retrieved table entry */
+   unsigned op;                /* code bits, operation, extra bits, or */
+   /*  window position, window bytes to copy */
+   unsigned len;               /* match length, unused bytes */
+   unsigned dist;              /* match distance */
+   unsigned char FAR *from;    /* where to copy match from */
+
+   /* copy state to local variables */
+   state = (struct inflate_state FAR *)strm->state;
+   in = strm->next_in;
+   last = in + (strm->avail_in - (INFLATE_FAST_MIN_INPUT - 1));
+   out = strm->next_out;
+   beg = out - (start - strm->avail_out);
+   end = out + (strm->avail_out - (INFLATE_FAST_MIN_OUTPUT - 1));
+#ifdef INFLATE_STRICT
+   dmax = state->dmax;
+#endif
+   wsize = state->wsize;
+   whave = state->whave;
+   wnext = state->wnext;
+   window = state->window;
+   hold = state->hold;
+   bits = state->bits;
+   lcode = state->lencode;
+   dcode = state->distcode;
+   lmask = (1U << state->lenbits) - 1;
+   dmask = (1U << state->distbits) - 1;
+
+   /* decode literals and length/distances until end-of-block or not enough
+      input data or output space */
+   do {
+      if (bits < 48) {
+         /* Whole bytes only; the bits of the next byte loaded above them
+            are loaded again, to the same place, next time */
+         hold |= inflate_load64(in) << bits;
+         in += (63 - bits) >> 3;
+         bits |= 56;
+      }
+      here = lcode[hold & lmask];
+dolen:
+      op = (unsigned)(here.bits);
+      hold >>= op;
+      bits -= op;
+      op = (unsigned)(here.op);
+      if (op == 0) {                          /* literal */
+         Tracevv((stderr, here.val >= 0x20 && here.val < 0x7f ?
+                  "inflate:         literal '%c'\n" :
+                  "inflate:         literal 0x%02x\n", here.val));
+         *out++ = (unsigned char)(here.val);
+      }
+      else if (op & 16) {                     /* length base */
+         len = (unsigned)(here.val);
+         op &= 15;                           /* number of extra bits */
+         if (op) {
+            len += (unsigned)hold & ((1U << op) - 1);
+            hold >>= op;
+            bits -= op;
+         }
+         Tracevv((stderr, "inflate:         length %u\n", len));
+         here = dcode[hold & dmask];
+dodist:
+         op = (unsigned)(here.bits);
+         hold >>= op;
+         bits -= op;
+         op = (unsigned)(here.op);
+         if (op & 16) {                      /* distance base */
+            dist = (unsigned)(here.val);
+            op &= 15;                       /* number of extra bits */
+            dist += (unsigned)hold & ((1U << op) - 1);
+#ifdef INFLATE_STRICT
+            if (dist > dmax) {
+               strm->msg = (char *)"invalid distance too far back";
+               state->mode = BAD;
+               break;
+            }
+#endif
+            hold >>= op;
+            bits -= op;
+            Tracevv((stderr, "inflate:         distance %u\n", dist));
+            op = (unsigned)(out - beg);     /* max distance in output */
+            if (dist > op) {                /* see if copy from window */
+               op = dist - op;             /* distance back in window */
+               if (op > whave && state->sane) {
+                  strm->msg = (char *)"invalid distance too far back";
+                  state->mode = BAD;
+                  break;
+               }
+               from = window;
+               if (wnext == 0)             /* very common case */
+                  from += wsize - op;
+               else if (wnext < op) {      /* wrap around window */
+                  from += wsize + wnext - op;
+                  op -= wnext;
+                  if (op < len) {         /* some from end of window */
+                     memcpy(out, from, op);
+                     out += op;
+                     len -= op;
+                     from = window;      /* then from start of window */
+                     op = wnext;
+                  }
+               }
+               else                        /* contiguous in window */
+                  from += wnext - op;
+               if (op < len) {             /* some from window */
+                  memcpy(out, from, op);
+                  out += op;
+                  out = inflate_chunk_copy(out, dist, len - op);
+               }
+               else {
+                  memcpy(out, from, len);
+                  out += len;
+               }
+            }
+            else                            /* copy direct from output */
+               out = inflate_chunk_copy(out, dist, len);
+         }
+         else if ((op & 64) == 0) {          /* 2nd level distance code */
+            here = dcode[here.val + (hold & ((1U << op) - 1))];
+            goto dodist;
+         }
+         else {
+            strm->msg = (char *)"invalid distance code";
+            state->mode = BAD;
+            break;
+         }
+      }
+      else if ((op & 64) == 0) {              /* 2nd level length code */
+         here = lcode[here.val + (hold & ((1U << op) - 1))];
+         goto dolen;
+      }
+      else if (op & 32) {                     /* end-of-block */
+         Tracevv((stderr, "inflate:         end of block\n"));
+         state->mode = TYPE;
+         break;
+      }
+      else {
+         strm->msg = (char *)"invalid literal/length code";
+         state->mode = BAD;
+         break;
+      }
+   } while (in < last && out < end);
+
+   /* return unused bytes */
+   len = bits >> 3;
+   in -= len;
+   bits -= len << 3;
+   hold &= ((uint64_t)1 << bits) - 1;
+
+   /* update state and return */
+   strm->next_in = in;
+   strm->next_out = out;
+   strm->avail_in = (unsigned)(in < last ?
+         (INFLATE_FAST_MIN_INPUT - 1) + (last - in) :
+         (INFLATE_FAST_MIN_INPUT - 1) - (in - last));
+   strm->avail_out = (unsigned)(out < end ?
+         (INFLATE_FAST_MIN_OUTPUT - 1) + (end - out) :
+         (INFLATE_FAST_MIN_OUTPUT - 1) - (out - end));
+   state->hold = (unsigned long)hold;
+   state->bits = bits;
+   return;
+}
+
+#else
+
 /* Allow machine dependent optimization for post-increment or pre-increment.
    Based on testing to date,
    Pre-increment preferred for:
@@ -335,4 +582,5 @@ dodist:
    - Moving len -= 3 statement into middle of loop
    */
 
+#endif /* INFLATE_CHUNK */
 #endif /* !ASMINF */
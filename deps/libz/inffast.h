@@ -10,6 +10,17 @@
 #ifndef _INFFAST_H
 #define _INFFAST_H
 
+/* With INFLATE_CHUNK, inflate_fast() reads the input 8 bytes at a time
+   and copies matches 8 bytes at a time, writing up to 7 bytes past them.
+   It needs that much more room to run. */
+#ifdef INFLATE_CHUNK
+#  define INFLATE_FAST_MIN_INPUT 8
+#  define INFLATE_FAST_MIN_OUTPUT 266
+#else
+#  define INFLATE_FAST_MIN_INPUT 6
+#  define INFLATE_FAST_MIN_OUTPUT 258
+#endif
+
 void ZLIB_INTERNAL inflate_fast OF((z_streamp strm, unsigned start));
 
 #endif
@@ -1013,7 +1013,8 @@ int inflate(z_streamp strm, int flush)
          case LEN_:
                   state->mode = LEN;
          case LEN:
-                  if (have >= 6 && left >= 258) {
+                  if (have >= INFLATE_FAST_MIN_INPUT &&
+                        left >= INFLATE_FAST_MIN_OUTPUT) {
                      RESTORE();
                      inflate_fast(strm, out);
                      LOAD();
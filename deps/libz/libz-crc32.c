@@ -3,6 +3,12 @@
 
 #include <stdint.h>
 
+/* CRC32_SHARED: the frontend's encoding_crc32() is slicing-by-8, or
+ * the CRC32 instructions of ARMv8, and computes the same thing */
+#ifdef CRC32_SHARED
+#include <encodings/crc32.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -70,6 +76,9 @@ extern "C" {
    unsigned long crc32(unsigned long crc, const unsigned char *buf, unsigned int len)
    {
       if (buf == 0) return 0L;
+#ifdef CRC32_SHARED
+      return encoding_crc32((uint32_t)crc, buf, len);
+#else
       crc = crc ^ 0xffffffffL;
       while (len >= 8)
       {
@@ -80,6 +89,7 @@ extern "C" {
          DO1_CRC32(buf);
       } while (--len);
       return crc ^ 0xffffffffL;
+#endif
    }
 
    const uint32_t *get_crc_table(void)
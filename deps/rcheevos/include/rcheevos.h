@@ -287,6 +287,9 @@ int rc_trigger_size(const char* memaddr);
 rc_trigger_t* rc_parse_trigger(void* buffer, const char* memaddr, lua_State* L, int funcs_ndx);
 int rc_evaluate_trigger(rc_trigger_t* trigger, rc_peek_t peek, void* ud, lua_State* L);
 int rc_test_trigger(rc_trigger_t* trigger, rc_peek_t peek, void* ud, lua_State* L);
+/* Updates the memrefs ahead of rc_test_trigger_updated, returns non-zero if any value changed */
+int rc_update_trigger_memrefs(rc_trigger_t* trigger, rc_peek_t peek, void* ud);
+int rc_test_trigger_updated(rc_trigger_t* trigger, rc_peek_t peek, void* ud, lua_State* L);
 void rc_reset_trigger(rc_trigger_t* self);
 
 /*****************************************************************************\
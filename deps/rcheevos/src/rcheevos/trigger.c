@@ -87,18 +87,12 @@ static void rc_reset_trigger_hitcounts(rc_trigger_t* self) {
   }
 }
 
-int rc_evaluate_trigger(rc_trigger_t* self, rc_peek_t peek, void* ud, lua_State* L) {
+static int rc_evaluate_trigger_internal(rc_trigger_t* self, rc_peek_t peek, void* ud, lua_State* L) {
   rc_eval_state_t eval_state;
   rc_condset_t* condset;
   int ret;
   char is_paused;
 
-  /* previously triggered, do nothing - return INACTIVE so caller doesn't report a repeated trigger */
-  if (self->state == RC_TRIGGER_STATE_TRIGGERED)
-      return RC_TRIGGER_STATE_INACTIVE;
-
-  rc_update_memref_values(self->memrefs, peek, ud);
-
   /* not yet active, only update the memrefs - so deltas are corrent when it becomes active */
   if (self->state == RC_TRIGGER_STATE_INACTIVE)
     return RC_TRIGGER_STATE_INACTIVE;
@@ -173,6 +167,35 @@ int rc_evaluate_trigger(rc_trigger_t* self, rc_peek_t peek, void* ud, lua_State*
   return self->state;
 }
 
+int rc_evaluate_trigger(rc_trigger_t* self, rc_peek_t peek, void* ud, lua_State* L) {
+  /* previously triggered, do nothing - return INACTIVE so caller doesn't report a repeated trigger */
+  if (self->state == RC_TRIGGER_STATE_TRIGGERED)
+      return RC_TRIGGER_STATE_INACTIVE;
+
+  rc_update_memref_values(self->memrefs, peek, ud);
+
+  return rc_evaluate_trigger_internal(self, peek, ud, L);
+}
+
+int rc_update_trigger_memrefs(rc_trigger_t* self, rc_peek_t peek, void* ud) {
+  rc_memref_value_t* memref;
+  int changed = 0;
+
+  rc_update_memref_values(self->memrefs, peek, ud);
+
+  for (memref = self->memrefs; memref != 0; memref = memref->next)
+    changed |= (memref->value != memref->previous);
+
+  return changed;
+}
+
+int rc_test_trigger_updated(rc_trigger_t* self, rc_peek_t peek, void* ud, lua_State* L) {
+  /* same as rc_test_trigger, the caller has already called rc_update_memref_values this frame */
+  self->state = RC_TRIGGER_STATE_ACTIVE;
+
+  return (rc_evaluate_trigger_internal(self, peek, ud, L) == RC_TRIGGER_STATE_TRIGGERED);
+}
+
 int rc_test_trigger(rc_trigger_t* self, rc_peek_t peek, void* ud, lua_State* L) {
   /* for backwards compatibilty, rc_test_trigger always assumes the achievement is active */
   self->state = RC_TRIGGER_STATE_ACTIVE;
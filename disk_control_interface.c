@@ -20,14 +20,18 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
+#include <streams/file_stream.h>
 
 #include "paths.h"
 #include "retroarch.h"
 #include "verbosity.h"
 #include "msg_hash.h"
 
+#include "tasks/tasks_internal.h"
+
 #include "disk_control_interface.h"
 
 /*****************/
@@ -401,6 +405,10 @@ bool disk_control_set_index(
                MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
    }
 
+   /* Get the disk after this one ready */
+   if (!error)
+      disk_control_preload_next(disk_control);
+
    /* If operation was successful, update disk
     * index record (if enabled) */
    if (!error && disk_control->record_enabled)
@@ -808,3 +816,96 @@ bool disk_control_save_image_index(disk_control_interface_t *disk_control)
    /* Save record */
    return disk_index_file_save(&disk_control->index_record);
 }
+
+/**************/
+/* Preloading */
+/**************/
+
+/* Fetches the path of disk image @index from the
+ * M3U file the content was loaded from, for cores
+ * that don't provide get_image_path */
+static bool disk_control_get_m3u_image_path(
+      unsigned index, char *path, size_t len)
+{
+   const char *m3u_path = path_get(RARCH_PATH_CONTENT);
+   void *buf            = NULL;
+   int64_t buf_len      = 0;
+   char *line           = NULL;
+   char *save           = NULL;
+   unsigned entry       = 0;
+   bool found           = false;
+
+   if (string_is_empty(m3u_path) ||
+       !string_is_equal_noncase(path_get_extension(m3u_path), "m3u"))
+      return false;
+
+   if (!filestream_read_file(m3u_path, &buf, &buf_len) || !buf)
+      return false;
+
+   for (line = strtok_r((char*)buf, "\r\n", &save); line;
+         line = strtok_r(NULL, "\r\n", &save))
+   {
+      char *label = NULL;
+
+      /* Skip comments/directives and empty lines */
+      if (string_is_empty(line) || *line == '#')
+         continue;
+
+      if (entry++ != index)
+         continue;
+
+      /* Some cores take an image label after a '|' */
+      if ((label = strchr(line, '|')))
+         *label = '\0';
+
+      fill_pathname_resolve_relative(path, m3u_path, line, len);
+      found = !string_is_empty(path);
+      break;
+   }
+
+   free(buf);
+   return found;
+}
+
+/* Starts reading the disk image after the current
+ * one in the background, so swapping to it doesn't
+ * wait for the storage. Images are taken from the
+ * core if it provides get_image_path, else from the
+ * M3U file the content was loaded from */
+void disk_control_preload_next(disk_control_interface_t *disk_control)
+{
+   unsigned num_images = 0;
+   unsigned next_index = 0;
+   char image_path[PATH_MAX_LENGTH];
+
+   image_path[0] = '\0';
+
+   if (!disk_control)
+      return;
+
+   if (!disk_control->cb.get_num_images ||
+       !disk_control->cb.get_image_index)
+      return;
+
+   num_images = disk_control->cb.get_num_images();
+   next_index = disk_control->cb.get_image_index() + 1;
+
+   /* Nothing after the last disk, or no disk at all */
+   if (num_images < 2 || num_images == UINT_MAX ||
+       next_index >= num_images)
+      return;
+
+   if (disk_control->cb.get_image_path)
+   {
+      if (!disk_control->cb.get_image_path(
+            next_index, image_path, sizeof(image_path)))
+         image_path[0] = '\0';
+   }
+
+   if (string_is_empty(image_path) &&
+       !disk_control_get_m3u_image_path(
+            next_index, image_path, sizeof(image_path)))
+      return;
+
+   task_push_disk_preload(image_path);
+}
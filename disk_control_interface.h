@@ -173,6 +173,12 @@ bool disk_control_verify_initial_index(disk_control_interface_t *disk_control);
  * by current core */
 bool disk_control_save_image_index(disk_control_interface_t *disk_control);
 
+/* Preloading */
+
+/* Reads the disk image after the current one into
+ * the page cache in the background, if there is one */
+void disk_control_preload_next(disk_control_interface_t *disk_control);
+
 RETRO_END_DECLS
 
 #endif
@@ -69,6 +69,9 @@
 #include <queues/task_queue.h>
 #include <retro_timers.h>
 #include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../frontend.h"
 #include "../frontend_driver.h"
@@ -76,6 +79,7 @@
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 #include "../../paths.h"
+#include "../../configuration.h"
 #include "platform_unix.h"
 
 #ifdef HAVE_MENU
@@ -1829,8 +1833,381 @@ static void android_app_destroy(struct android_app *android_app)
 }
 #endif
 
+#if defined(__linux__) && !defined(ANDROID)
+/* Frame timing governor. Each domain runs the performance governor
+ * with its maximum capped to one of its frequencies, so it sits at
+ * exactly that level: no ramp up to wait for on a heavy frame. */
+#define UNIX_GOVERNOR_LEVELS      32
+#define UNIX_GOVERNOR_WINDOW_USEC 1000000
+/* The busiest frame of a window must stay under this, in percent
+ * of the frame time, at the frequency being stepped down to */
+#define UNIX_GOVERNOR_MARGIN      80
+/* Windows without a missed frame before the GPU steps down */
+#define UNIX_GOVERNOR_GPU_CALM    5
+
+typedef struct unix_freq_domain
+{
+   const char *freqs_file;
+   const char *governor_file;
+   const char *max_file;
+   char dir[PATH_MAX_LENGTH];
+   char governor[32];
+   char max_freq[32];
+   unsigned freqs[UNIX_GOVERNOR_LEVELS]; /* ascending */
+   unsigned count;
+   unsigned level;
+   unsigned floor;    /* a step below missed frames */
+   bool stepped_down; /* in the last window */
+} unix_freq_domain_t;
+
+static struct
+{
+   unix_freq_domain_t cpu;
+   unix_freq_domain_t gpu;
+   retro_time_t window_start;
+   retro_time_t work_peak;
+   unsigned misses;
+   unsigned gpu_calm;
+   bool work_known;
+   bool idle;
+   bool active;
+   bool probed;
+} unix_governor;
+
+static bool unix_sysfs_read(const char *dir, const char *file,
+      char *s, size_t len)
+{
+   char path[PATH_MAX_LENGTH];
+   char *buf      = NULL;
+   int64_t length = 0;
+
+   fill_pathname_join(path, dir, file, sizeof(path));
+   if (filestream_read_file(path, (void**)&buf, &length) != 1)
+      return false;
+
+   strlcpy(s, buf, len);
+   string_trim_whitespace(s);
+   free(buf);
+   return true;
+}
+
+static bool unix_sysfs_write(const char *dir, const char *file,
+      const char *value)
+{
+   char path[PATH_MAX_LENGTH];
+
+   fill_pathname_join(path, dir, file, sizeof(path));
+   return filestream_write_file(path, value, strlen(value));
+}
+
+static bool unix_freq_domain_probe(unix_freq_domain_t *domain)
+{
+   char list[1024];
+   char *tok  = NULL;
+   char *save = NULL;
+
+   domain->count = 0;
+
+   if (     !unix_sysfs_read(domain->dir, domain->freqs_file,
+            list, sizeof(list))
+         || !unix_sysfs_read(domain->dir, domain->governor_file,
+            domain->governor, sizeof(domain->governor))
+         || !unix_sysfs_read(domain->dir, domain->max_file,
+            domain->max_freq, sizeof(domain->max_freq)))
+      return false;
+
+   for (tok = strtok_r(list, " ", &save); tok && domain->count
+         < UNIX_GOVERNOR_LEVELS; tok = strtok_r(NULL, " ", &save))
+   {
+      unsigned freq = (unsigned)strtoul(tok, NULL, 10);
+      unsigned i    = domain->count++;
+
+      /* Not every driver lists them in order */
+      for (; i > 0 && domain->freqs[i - 1] > freq; i--)
+         domain->freqs[i] = domain->freqs[i - 1];
+      domain->freqs[i] = freq;
+   }
+
+   if (domain->count < 2)
+      return false;
+
+   domain->level        = domain->count - 1;
+   domain->floor        = 0;
+   domain->stepped_down = false;
+   return true;
+}
+
+static void unix_freq_domain_apply(unix_freq_domain_t *domain,
+      unsigned level)
+{
+   char value[16];
+
+   if (!domain->count)
+      return;
+
+   snprintf(value, sizeof(value), "%u", domain->freqs[level]);
+   unix_sysfs_write(domain->dir, domain->max_file, value);
+}
+
+static void unix_freq_domain_set(unix_freq_domain_t *domain,
+      unsigned level)
+{
+   if (!domain->count || level == domain->level)
+      return;
+
+   domain->stepped_down = level < domain->level;
+   domain->level        = level;
+   unix_freq_domain_apply(domain, level);
+}
+
+static void unix_freq_domain_restore(unix_freq_domain_t *domain)
+{
+   if (!domain->count)
+      return;
+
+   unix_sysfs_write(domain->dir, domain->max_file, domain->max_freq);
+   unix_sysfs_write(domain->dir, domain->governor_file, domain->governor);
+}
+
+static void unix_governor_find_gpu(unix_freq_domain_t *domain)
+{
+   const char *devfreq = "/sys/class/devfreq";
+   struct RDIR *dir    = retro_opendir(devfreq);
+
+   if (!dir)
+      return;
+
+   while (retro_readdir(dir))
+   {
+      const char *name = retro_dirent_get_name(dir);
+
+      if (strstr(name, "gpu"))
+      {
+         fill_pathname_join(domain->dir, devfreq, name, sizeof(domain->dir));
+         break;
+      }
+   }
+
+   retro_closedir(dir);
+}
+
+static bool unix_governor_start(void)
+{
+   unix_freq_domain_t *cpu = &unix_governor.cpu;
+   unix_freq_domain_t *gpu = &unix_governor.gpu;
+
+   if (unix_governor.probed)
+      return false;
+   unix_governor.probed = true;
+
+   cpu->freqs_file    = "scaling_available_frequencies";
+   cpu->governor_file = "scaling_governor";
+   cpu->max_file      = "scaling_max_freq";
+   strlcpy(cpu->dir, "/sys/devices/system/cpu/cpufreq/policy0",
+         sizeof(cpu->dir));
+   if (!unix_freq_domain_probe(cpu)
+         || !unix_sysfs_write(cpu->dir, cpu->governor_file, "performance"))
+      cpu->count = 0;
+
+   gpu->freqs_file    = "available_frequencies";
+   gpu->governor_file = "governor";
+   gpu->max_file      = "max_freq";
+   unix_governor_find_gpu(gpu);
+   if (string_is_empty(gpu->dir) || !unix_freq_domain_probe(gpu)
+         || !unix_sysfs_write(gpu->dir, gpu->governor_file, "performance"))
+      gpu->count = 0;
+
+   if (!cpu->count && !gpu->count)
+   {
+      RARCH_WARN("[Governor]: No CPU or GPU frequencies to control.\n");
+      return false;
+   }
+
+   RARCH_LOG("[Governor]: Controlling %u CPU and %u GPU frequencies.\n",
+         cpu->count, gpu->count);
+
+   unix_freq_domain_apply(cpu, cpu->level);
+   unix_freq_domain_apply(gpu, gpu->level);
+
+   unix_governor.window_start = 0;
+   unix_governor.idle         = false;
+   unix_governor.active       = true;
+   return true;
+}
+
+static void unix_governor_stop(void)
+{
+   if (!unix_governor.active)
+      return;
+
+   unix_freq_domain_restore(&unix_governor.cpu);
+   unix_freq_domain_restore(&unix_governor.gpu);
+   memset(&unix_governor, 0, sizeof(unix_governor));
+}
+
+/* Called once a window: the CPU goes by the work measured, misses
+ * with the CPU in budget are put down to the GPU. A level missing
+ * frames right after stepping down becomes the floor for the
+ * content, so it doesn't keep trying. */
+static void unix_governor_decide(retro_time_t deadline)
+{
+   unix_freq_domain_t *cpu = &unix_governor.cpu;
+   unix_freq_domain_t *gpu = &unix_governor.gpu;
+   retro_time_t budget     = deadline * UNIX_GOVERNOR_MARGIN / 100;
+   bool cpu_bound          = !unix_governor.work_known
+      || unix_governor.work_peak > budget;
+
+   if (unix_governor.misses)
+   {
+      unix_freq_domain_t *domain = (cpu_bound || !gpu->count) ? cpu : gpu;
+
+      if (domain->stepped_down)
+         domain->floor = domain->level + 1;
+
+      if (domain == cpu)
+         unix_freq_domain_set(cpu, cpu->count - 1);
+      else if (gpu->level + 1 < gpu->count)
+         unix_freq_domain_set(gpu, gpu->level + 1);
+
+      unix_governor.gpu_calm = 0;
+      return;
+   }
+
+   cpu->stepped_down = false;
+   gpu->stepped_down = false;
+
+   if (cpu->count)
+   {
+      if (cpu_bound && unix_governor.work_known)
+      {
+         if (cpu->level + 1 < cpu->count)
+            unix_freq_domain_set(cpu, cpu->level + 1);
+      }
+      else if (unix_governor.work_known && cpu->level > cpu->floor)
+      {
+         /* Work scales with the clock well enough for a step */
+         retro_time_t predicted = unix_governor.work_peak
+            * cpu->freqs[cpu->level] / cpu->freqs[cpu->level - 1];
+
+         if (predicted < budget)
+            unix_freq_domain_set(cpu, cpu->level - 1);
+      }
+   }
+
+   if (     gpu->count
+         && ++unix_governor.gpu_calm >= UNIX_GOVERNOR_GPU_CALM
+         && gpu->level > gpu->floor)
+   {
+      unix_freq_domain_set(gpu, gpu->level - 1);
+      unix_governor.gpu_calm = 0;
+   }
+}
+
+static void frontend_unix_update_frame_timing(retro_time_t work,
+      retro_time_t interval, retro_time_t deadline, bool idle)
+{
+   settings_t *settings = config_get_ptr();
+   retro_time_t now;
+
+   if (!settings || !settings->bools.frequency_governor_enable)
+   {
+      unix_governor_stop();
+      return;
+   }
+
+   if (!unix_governor.active && !unix_governor_start())
+      return;
+
+   /* Lowest clocks while nothing runs, back where it was after */
+   if (idle != unix_governor.idle)
+   {
+      unix_governor.idle         = idle;
+      unix_governor.window_start = 0;
+      unix_freq_domain_apply(&unix_governor.cpu,
+            idle ? 0 : unix_governor.cpu.level);
+      unix_freq_domain_apply(&unix_governor.gpu,
+            idle ? 0 : unix_governor.gpu.level);
+   }
+
+   if (idle || deadline <= 0)
+      return;
+
+   now = cpu_features_get_time_usec();
+
+   if (!unix_governor.window_start)
+   {
+      unix_governor.window_start = now;
+      unix_governor.work_peak    = 0;
+      unix_governor.work_known   = true;
+      unix_governor.misses       = 0;
+      return;
+   }
+
+   if (interval > deadline + deadline / 2)
+      unix_governor.misses++;
+   if (work < 0)
+      unix_governor.work_known = false;
+   else if (work > unix_governor.work_peak)
+      unix_governor.work_peak  = work;
+
+   if (now - unix_governor.window_start < UNIX_GOVERNOR_WINDOW_USEC)
+      return;
+
+   unix_governor_decide(deadline);
+   unix_governor.window_start = 0;
+}
+
+static void unix_governor_content_loaded(void)
+{
+   /* Floors found for the last content don't apply, and
+    * domains that couldn't be controlled get another try */
+   unix_governor.cpu.floor = 0;
+   unix_governor.gpu.floor = 0;
+   unix_governor.probed    = unix_governor.active;
+}
+
+static int unix_sysfs_read_int(const char *dir, const char *file)
+{
+   char value[32];
+
+   if (string_is_empty(dir) || !unix_sysfs_read(dir, file,
+            value, sizeof(value)))
+      return -1;
+   return (int)strtol(value, NULL, 10);
+}
+
+static bool frontend_unix_get_sensors(frontend_sensors_t *sensors)
+{
+   static unix_freq_domain_t gpu;
+   static bool gpu_probed = false;
+   int gpu_freq;
+
+   if (!gpu_probed)
+   {
+      unix_governor_find_gpu(&gpu);
+      gpu_probed = true;
+   }
+
+   sensors->cpu_freq    = unix_sysfs_read_int(
+         "/sys/devices/system/cpu/cpufreq/policy0", "scaling_cur_freq");
+   sensors->temperature = unix_sysfs_read_int(
+         "/sys/class/thermal/thermal_zone0", "temp");
+
+   /* devfreq goes by Hz */
+   gpu_freq             = unix_sysfs_read_int(gpu.dir, "cur_freq");
+   sensors->gpu_freq    = gpu_freq > 0 ? gpu_freq / 1000 : -1;
+
+   return sensors->cpu_freq    >= 0
+       || sensors->gpu_freq    >= 0
+       || sensors->temperature >= 0;
+}
+#endif
+
 static void frontend_unix_deinit(void *data)
 {
+#if defined(__linux__) && !defined(ANDROID)
+   unix_governor_stop();
+#endif
 #ifdef ANDROID
    struct android_app *android_app = (struct android_app*)data;
 
@@ -1915,6 +2292,64 @@ static void frontend_unix_init(void *data)
          "getStringExtra", "(Ljava/lang/String;)Ljava/lang/String;");
 #endif
 
+#ifdef HAVE_THREADS
+   sthread_set_role(STHREAD_ROLE_MAIN);
+#endif
+}
+
+/* Applied once the content and its overrides are loaded. The
+ * emulation thread gets a core to itself, everything else shares
+ * the others: audio at a real-time priority when allowed, tasks
+ * below the rest. */
+static void frontend_unix_set_thread_policy(void)
+{
+#if defined(HAVE_THREADS) && defined(__linux__)
+   settings_t *settings          = config_get_ptr();
+   unsigned cpus                 = cpu_features_get_core_amount();
+   sthread_role_policy_t emu     = {0};
+   sthread_role_policy_t others  = {0};
+   sthread_role_policy_t audio   = {0};
+   sthread_role_policy_t task    = {0};
+   unsigned main_cpu;
+
+   if (!settings || !settings->bools.thread_affinity_enable
+         || cpus < 2 || cpus > 64)
+   {
+      /* Back to any core, for an override turning it off */
+      sthread_set_role_policy(STHREAD_ROLE_MAIN,   &emu);
+      sthread_set_role_policy(STHREAD_ROLE_VIDEO,  &emu);
+      sthread_set_role_policy(STHREAD_ROLE_FILTER, &emu);
+      sthread_set_role_policy(STHREAD_ROLE_AUDIO,  &emu);
+      sthread_set_role_policy(STHREAD_ROLE_TASK,   &emu);
+      return;
+   }
+
+   main_cpu          = MIN(settings->uints.thread_affinity_main_cpu, cpus - 1);
+   emu.cpu_mask      = UINT64_C(1) << main_cpu;
+   others.cpu_mask   = ((cpus == 64) ? ~UINT64_C(0)
+         : ((UINT64_C(1) << cpus) - 1)) & ~emu.cpu_mask;
+   audio.cpu_mask    = others.cpu_mask;
+   audio.rt_priority = 50;
+   task.cpu_mask     = others.cpu_mask;
+   task.nice         = 10;
+
+   sthread_set_role_policy(STHREAD_ROLE_MAIN,   &emu);
+   sthread_set_role_policy(STHREAD_ROLE_VIDEO,  &others);
+   sthread_set_role_policy(STHREAD_ROLE_FILTER, &others);
+   sthread_set_role_policy(STHREAD_ROLE_AUDIO,  &audio);
+   sthread_set_role_policy(STHREAD_ROLE_TASK,   &task);
+
+   RARCH_LOG("[Threads]: Emulation on core %u, other threads on the remaining %u.\n",
+         main_cpu, cpus - 1);
+#endif
+}
+
+static void frontend_unix_content_loaded(void)
+{
+   frontend_unix_set_thread_policy();
+#if defined(__linux__) && !defined(ANDROID)
+   unix_governor_content_loaded();
+#endif
 }
 
 static int frontend_unix_parse_drive_list(void *data, bool load_content)
@@ -2457,7 +2892,7 @@ frontend_ctx_driver_t frontend_ctx_unix = {
 #endif
    frontend_unix_get_os,
    frontend_unix_get_rating,    /* get_rating */
-   NULL,                         /* load_content */
+   frontend_unix_content_loaded, /* content_loaded */
    frontend_unix_get_architecture,
    frontend_unix_get_powerstate,
    frontend_unix_parse_drive_list,
@@ -2478,8 +2913,16 @@ frontend_ctx_driver_t frontend_ctx_unix = {
    frontend_unix_get_cpu_model_name,
    frontend_unix_get_user_language,
 #ifdef ANDROID
-   "android"
+   "android",
+#else
+   "unix",
+#endif
+   NULL,                         /* get_video_driver */
+#if defined(__linux__) && !defined(ANDROID)
+   frontend_unix_update_frame_timing,
+   frontend_unix_get_sensors,
 #else
-   "unix"
+   NULL,                         /* update_frame_timing */
+   NULL,                         /* get_sensors */
 #endif
 };
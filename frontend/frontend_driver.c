@@ -538,6 +538,28 @@ void frontend_driver_set_sustained_performance_mode(bool on)
    frontend->set_sustained_performance_mode(on);
 }
 
+void frontend_driver_update_frame_timing(retro_time_t work,
+      retro_time_t interval, retro_time_t deadline, bool idle)
+{
+   frontend_ctx_driver_t *frontend = frontend_get_ptr();
+   if (!frontend || !frontend->update_frame_timing)
+      return;
+   frontend->update_frame_timing(work, interval, deadline, idle);
+}
+
+bool frontend_driver_get_sensors(frontend_sensors_t *sensors)
+{
+   frontend_ctx_driver_t *frontend = frontend_get_ptr();
+
+   sensors->cpu_freq    = -1;
+   sensors->gpu_freq    = -1;
+   sensors->temperature = -1;
+
+   if (!frontend || !frontend->get_sensors)
+      return false;
+   return frontend->get_sensors(sensors);
+}
+
 const char* frontend_driver_get_cpu_model_name(void)
 {
    frontend_ctx_driver_t *frontend = frontend_get_ptr();
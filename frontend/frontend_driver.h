@@ -72,6 +72,15 @@ typedef struct path_change_data
    void *data;
 } path_change_data_t;
 
+/* Clocks in kHz and temperature in millidegrees Celsius,
+ * -1 where unknown */
+typedef struct frontend_sensors
+{
+   int cpu_freq;
+   int gpu_freq;
+   int temperature;
+} frontend_sensors_t;
+
 typedef void (*environment_get_t)(int *argc, char *argv[], void *args,
    void *params_data);
 typedef void (*process_args_t)(int *argc, char *argv[]);
@@ -114,6 +123,16 @@ typedef struct frontend_ctx_driver
    const char *ident;
 
    const struct video_driver *(*get_video_driver)(void);
+
+   /* Each runloop iteration: time the core spent working on the
+    * frame (-1 if unknown), time since the last frame and the time
+    * a frame has, or idle when in the menu or paused. */
+   void (*update_frame_timing)(retro_time_t work, retro_time_t interval,
+         retro_time_t deadline, bool idle);
+
+   /* Current clocks and temperature. Returns false
+    * if none of them can be read. */
+   bool (*get_sensors)(frontend_sensors_t *sensors);
 } frontend_ctx_driver_t;
 
 extern frontend_ctx_driver_t frontend_ctx_gx;
@@ -217,6 +236,11 @@ bool frontend_driver_check_for_path_changes(path_change_data_t *change_data);
 
 void frontend_driver_set_sustained_performance_mode(bool on);
 
+void frontend_driver_update_frame_timing(retro_time_t work,
+      retro_time_t interval, retro_time_t deadline, bool idle);
+
+bool frontend_driver_get_sensors(frontend_sensors_t *sensors);
+
 const char* frontend_driver_get_cpu_model_name(void);
 
 enum retro_language frontend_driver_get_user_language(void);
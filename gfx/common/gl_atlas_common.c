@@ -0,0 +1,331 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <gfx/gl_capabilities.h>
+
+#include "gl_common.h"
+#include "gl_atlas_common.h"
+#include "../../retroarch.h"
+#include "../../verbosity.h"
+
+#define GL_ATLAS_PAGE_SIZE 1024
+#define GL_ATLAS_MIN_CELL  32
+#define GL_ATLAS_MAX_CELL  256
+#define GL_ATLAS_MAX_CELLS ((GL_ATLAS_PAGE_SIZE / GL_ATLAS_MIN_CELL) \
+      * (GL_ATLAS_PAGE_SIZE / GL_ATLAS_MIN_CELL))
+
+/* A full mipmapped page takes a little over 5 MB. */
+#define GL_ATLAS_MAX_PAGES 8
+
+#define GL_ATLAS_HANDLE(page, cell) (GL_ATLAS_HANDLE_FLAG \
+      | ((uintptr_t)(page) << 16) | (uintptr_t)(cell))
+#define GL_ATLAS_HANDLE_PAGE(id) (((id) >> 16) & 0xff)
+#define GL_ATLAS_HANDLE_CELL(id) ((id) & 0xffff)
+
+typedef struct gl_atlas_entry
+{
+   unsigned width;
+   unsigned height;
+   bool used;
+} gl_atlas_entry_t;
+
+typedef struct gl_atlas_page
+{
+   gl_atlas_entry_t entries[GL_ATLAS_MAX_CELLS];
+   uint64_t last_used;
+   GLuint tex;
+   unsigned cell_size;
+   unsigned used_count;
+   /* Set when cells were uploaded since the mipmaps were built. */
+   bool dirty;
+} gl_atlas_page_t;
+
+struct gl_atlas
+{
+   gl_atlas_page_t pages[GL_ATLAS_MAX_PAGES];
+   uint32_t cell_data[GL_ATLAS_MAX_CELL * GL_ATLAS_MAX_CELL];
+   uint64_t stamp;
+   bool have_mipmap;
+   bool use_rgba;
+};
+
+gl_atlas_t *gl_atlas_new(void)
+{
+   gl_atlas_t *atlas = (gl_atlas_t*)calloc(1, sizeof(*atlas));
+
+   if (!atlas)
+      return NULL;
+
+   atlas->have_mipmap = gl_check_capability(GL_CAPS_MIPMAP);
+   atlas->use_rgba    = video_driver_supports_rgba();
+
+   return atlas;
+}
+
+static void gl_atlas_page_release(gl_atlas_page_t *page)
+{
+   if (page->tex)
+      glDeleteTextures(1, &page->tex);
+   page->tex        = 0;
+   page->cell_size  = 0;
+   page->used_count = 0;
+   page->dirty      = false;
+}
+
+void gl_atlas_free(gl_atlas_t *atlas)
+{
+   unsigned i;
+
+   if (!atlas)
+      return;
+
+   for (i = 0; i < GL_ATLAS_MAX_PAGES; i++)
+      gl_atlas_page_release(&atlas->pages[i]);
+
+   free(atlas);
+}
+
+static bool gl_atlas_page_init(gl_atlas_t *atlas,
+      gl_atlas_page_t *page, unsigned cell_size)
+{
+   if (!page->tex)
+   {
+      glGenTextures(1, &page->tex);
+      gl_bind_texture(page->tex, GL_CLAMP_TO_EDGE, GL_LINEAR,
+            atlas->have_mipmap ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+      glTexImage2D(GL_TEXTURE_2D, 0,
+            atlas->use_rgba ? GL_RGBA : RARCH_GL_INTERNAL_FORMAT32,
+            GL_ATLAS_PAGE_SIZE, GL_ATLAS_PAGE_SIZE, 0,
+            atlas->use_rgba ? GL_RGBA : RARCH_GL_TEXTURE_TYPE32,
+            RARCH_GL_FORMAT32, NULL);
+
+      if (glGetError() != GL_NO_ERROR)
+      {
+         RARCH_WARN("[GL]: Failed to allocate texture atlas page.\n");
+         gl_atlas_page_release(page);
+         return false;
+      }
+   }
+
+   memset(page->entries, 0, sizeof(page->entries));
+   page->cell_size  = cell_size;
+   page->used_count = 0;
+   page->dirty      = true;
+
+   return true;
+}
+
+/* Finds a page with a free cell of the given size, claiming
+ * an unused or the least recently used empty page if needed. */
+static int gl_atlas_find_page(gl_atlas_t *atlas, unsigned cell_size)
+{
+   unsigned i;
+   unsigned cells  = (GL_ATLAS_PAGE_SIZE / cell_size)
+      * (GL_ATLAS_PAGE_SIZE / cell_size);
+   int unused      = -1;
+   int empty       = -1;
+
+   for (i = 0; i < GL_ATLAS_MAX_PAGES; i++)
+   {
+      gl_atlas_page_t *page = &atlas->pages[i];
+
+      if (!page->tex)
+      {
+         if (unused < 0)
+            unused = i;
+         continue;
+      }
+
+      if (page->cell_size == cell_size && page->used_count < cells)
+         return i;
+
+      if (!page->used_count && (empty < 0
+               || page->last_used < atlas->pages[empty].last_used))
+         empty = i;
+   }
+
+   if (empty >= 0)
+      i = empty;
+   else if (unused >= 0)
+      i = unused;
+   else
+      return -1;
+
+   if (!gl_atlas_page_init(atlas, &atlas->pages[i], cell_size))
+      return -1;
+
+   return i;
+}
+
+/* Copies the image into the cell, repeating its last column
+ * and row so that filtering and mipmaps don't pick up
+ * stale contents of the padding. */
+static void gl_atlas_fill_cell(uint32_t *dst, unsigned cell_size,
+      const uint32_t *src, unsigned width, unsigned height)
+{
+   unsigned x, y;
+
+   for (y = 0; y < cell_size; y++)
+   {
+      const uint32_t *row = src + (y < height ? y : height - 1) * width;
+      uint32_t       *out = dst + y * cell_size;
+
+      memcpy(out, row, width * sizeof(uint32_t));
+      for (x = width; x < cell_size; x++)
+         out[x] = row[width - 1];
+   }
+}
+
+bool gl_atlas_add(gl_atlas_t *atlas, const struct texture_image *ti,
+      enum texture_filter_type filter_type, uintptr_t *id)
+{
+   unsigned i, cells_x;
+   int page_index         = -1;
+   unsigned cell_size     = GL_ATLAS_MIN_CELL;
+   gl_atlas_page_t *page  = NULL;
+
+   if (!atlas || !ti || !ti->pixels || !ti->width || !ti->height)
+      return false;
+
+   /* Nearest filtered textures stay on their own. */
+   if (     filter_type != TEXTURE_FILTER_LINEAR
+         && filter_type != TEXTURE_FILTER_MIPMAP_LINEAR)
+      return false;
+
+   if (ti->width > GL_ATLAS_MAX_CELL || ti->height > GL_ATLAS_MAX_CELL)
+      return false;
+
+   while (cell_size < ti->width || cell_size < ti->height)
+      cell_size <<= 1;
+
+   page_index = gl_atlas_find_page(atlas, cell_size);
+   if (page_index < 0)
+      return false;
+
+   page    = &atlas->pages[page_index];
+   cells_x = GL_ATLAS_PAGE_SIZE / cell_size;
+
+   for (i = 0; i < cells_x * cells_x; i++)
+      if (!page->entries[i].used)
+         break;
+
+   gl_atlas_fill_cell(atlas->cell_data, cell_size,
+         ti->pixels, ti->width, ti->height);
+
+   glBindTexture(GL_TEXTURE_2D, page->tex);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+   glTexSubImage2D(GL_TEXTURE_2D, 0,
+         (i % cells_x) * cell_size, (i / cells_x) * cell_size,
+         cell_size, cell_size,
+         atlas->use_rgba ? GL_RGBA : RARCH_GL_TEXTURE_TYPE32,
+         RARCH_GL_FORMAT32, atlas->cell_data);
+
+   page->entries[i].width  = ti->width;
+   page->entries[i].height = ti->height;
+   page->entries[i].used   = true;
+   page->used_count++;
+   page->dirty             = true;
+   page->last_used         = ++atlas->stamp;
+
+   *id                     = GL_ATLAS_HANDLE(page_index, i);
+
+   return true;
+}
+
+void gl_atlas_remove(gl_atlas_t *atlas, uintptr_t id)
+{
+   unsigned i;
+   gl_atlas_page_t *page  = NULL;
+   unsigned page_index    = GL_ATLAS_HANDLE_PAGE(id);
+   unsigned cell          = GL_ATLAS_HANDLE_CELL(id);
+
+   if (!atlas || page_index >= GL_ATLAS_MAX_PAGES)
+      return;
+
+   page = &atlas->pages[page_index];
+
+   if (!page->tex || cell >= GL_ATLAS_MAX_CELLS
+         || !page->entries[cell].used)
+      return;
+
+   page->entries[cell].used = false;
+   if (--page->used_count)
+      return;
+
+   /* Keep a single empty page around for the next
+    * batch of uploads, releasing the older one. */
+   for (i = 0; i < GL_ATLAS_MAX_PAGES; i++)
+   {
+      gl_atlas_page_t *other = &atlas->pages[i];
+
+      if (other == page || !other->tex || other->used_count)
+         continue;
+
+      gl_atlas_page_release(other->last_used < page->last_used
+            ? other : page);
+      break;
+   }
+}
+
+bool gl_atlas_resolve(gl_atlas_t *atlas, uintptr_t id,
+      unsigned *texture, float *rect)
+{
+   unsigned cells_x;
+   const gl_atlas_entry_t *entry = NULL;
+   gl_atlas_page_t *page         = NULL;
+   unsigned page_index           = GL_ATLAS_HANDLE_PAGE(id);
+   unsigned cell                 = GL_ATLAS_HANDLE_CELL(id);
+
+   if (!atlas || page_index >= GL_ATLAS_MAX_PAGES)
+      return false;
+
+   page = &atlas->pages[page_index];
+
+   if (!page->tex || cell >= GL_ATLAS_MAX_CELLS
+         || !page->entries[cell].used)
+      return false;
+
+   if (page->dirty)
+   {
+      if (atlas->have_mipmap)
+      {
+         glBindTexture(GL_TEXTURE_2D, page->tex);
+         glGenerateMipmap(GL_TEXTURE_2D);
+      }
+      page->dirty = false;
+   }
+
+   entry           = &page->entries[cell];
+   cells_x         = GL_ATLAS_PAGE_SIZE / page->cell_size;
+   page->last_used = ++atlas->stamp;
+
+   /* Inset by half a texel so that bilinear filtering
+    * stays within the image. */
+   rect[0]  = ((cell % cells_x) * page->cell_size + 0.5f)
+      / GL_ATLAS_PAGE_SIZE;
+   rect[1]  = ((cell / cells_x) * page->cell_size + 0.5f)
+      / GL_ATLAS_PAGE_SIZE;
+   rect[2]  = (entry->width  - 1.0f) / GL_ATLAS_PAGE_SIZE;
+   rect[3]  = (entry->height - 1.0f) / GL_ATLAS_PAGE_SIZE;
+   *texture = page->tex;
+
+   return true;
+}
@@ -0,0 +1,61 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GL_ATLAS_COMMON_H
+#define __GL_ATLAS_COMMON_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <formats/image.h>
+
+#include "../video_defines.h"
+
+RETRO_BEGIN_DECLS
+
+/* Texture handles pointing into the atlas have this bit set,
+ * which no GL texture name gets anywhere near. */
+#define GL_ATLAS_HANDLE_FLAG  ((uintptr_t)1 << 30)
+#define GL_ATLAS_IS_HANDLE(id) (((uintptr_t)(id) & GL_ATLAS_HANDLE_FLAG) != 0)
+
+/* Packs small menu textures (icons, thumbnails) into a few
+ * large pages, so that they can be drawn without rebinding
+ * and merged by the draw batch. Each page is split into
+ * square cells of a single power of two size, which keeps
+ * mipmaps of neighbouring cells apart. Pages which are no
+ * longer used are released least recently used first once
+ * the page budget is exceeded. */
+typedef struct gl_atlas gl_atlas_t;
+
+gl_atlas_t *gl_atlas_new(void);
+
+void gl_atlas_free(gl_atlas_t *atlas);
+
+/* Uploads the image into a free cell. Returns false if the
+ * image doesn't fit, in which case the caller has to create
+ * a texture of its own. */
+bool gl_atlas_add(gl_atlas_t *atlas, const struct texture_image *ti,
+      enum texture_filter_type filter_type, uintptr_t *id);
+
+void gl_atlas_remove(gl_atlas_t *atlas, uintptr_t id);
+
+/* Returns the page texture of a handle and the region of it
+ * the image occupies as { u, v, width, height }. */
+bool gl_atlas_resolve(gl_atlas_t *atlas, uintptr_t id,
+      unsigned *texture, float *rect);
+
+RETRO_END_DECLS
+
+#endif
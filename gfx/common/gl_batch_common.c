@@ -0,0 +1,168 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include "gl_common.h"
+#include "gl_batch_common.h"
+
+/* Six vertices per quad, since strips can't be merged. */
+#define GL_BATCH_MAX_QUADS    256
+#define GL_BATCH_MAX_VERTICES (GL_BATCH_MAX_QUADS * 6)
+
+struct gl_batch
+{
+   GLfloat vertex[GL_BATCH_MAX_VERTICES * 2];
+   GLfloat tex_coord[GL_BATCH_MAX_VERTICES * 2];
+   GLfloat color[GL_BATCH_MAX_VERTICES * 4];
+   math_matrix_4x4 identity;
+   unsigned texture;
+   unsigned count;
+};
+
+static const unsigned gl_batch_strip_to_triangles[6] = {
+   0, 1, 2,
+   2, 1, 3
+};
+
+static const GLfloat gl_batch_white[16] = {
+   1.0f, 1.0f, 1.0f, 1.0f,
+   1.0f, 1.0f, 1.0f, 1.0f,
+   1.0f, 1.0f, 1.0f, 1.0f,
+   1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+gl_batch_t *gl_batch_new(void)
+{
+   gl_batch_t *batch = (gl_batch_t*)calloc(1, sizeof(*batch));
+
+   if (!batch)
+      return NULL;
+
+   matrix_4x4_identity(batch->identity);
+
+   return batch;
+}
+
+void gl_batch_free(gl_batch_t *batch)
+{
+   free(batch);
+}
+
+bool gl_batch_add_quad(gl_t *gl,
+      int x, int y, unsigned width, unsigned height,
+      const math_matrix_4x4 *mvp, unsigned texture,
+      const struct video_coords *coords)
+{
+   unsigned i;
+   GLfloat pos[8];
+   int full_x            = 0;
+   int full_y            = 0;
+   unsigned full_width   = 0;
+   unsigned full_height  = 0;
+   const GLfloat *color  = NULL;
+   gl_batch_t *batch     = gl ? gl->batch : NULL;
+
+   if (!batch || !mvp || !coords || coords->vertices != 4
+         || coords->index || !width || !height)
+      return false;
+
+   /* The vertex shader would divide by w otherwise. */
+   if (     MAT_ELEM_4X4(*mvp, 3, 0) != 0.0f
+         || MAT_ELEM_4X4(*mvp, 3, 1) != 0.0f
+         || MAT_ELEM_4X4(*mvp, 3, 3) != 1.0f)
+      return false;
+
+   full_width  = gl->video_width;
+   full_height = gl->video_height;
+
+   if (gl->surface_rotation)
+   {
+      gl2_surface_rect(gl, &x, &y, &width, &height);
+      gl2_surface_rect(gl, &full_x, &full_y, &full_width, &full_height);
+   }
+
+   for (i = 0; i < 4; i++)
+   {
+      GLfloat vx = coords->vertex[i * 2 + 0];
+      GLfloat vy = coords->vertex[i * 2 + 1];
+      GLfloat cx = MAT_ELEM_4X4(*mvp, 0, 0) * vx
+         + MAT_ELEM_4X4(*mvp, 0, 1) * vy + MAT_ELEM_4X4(*mvp, 0, 3);
+      GLfloat cy = MAT_ELEM_4X4(*mvp, 1, 0) * vx
+         + MAT_ELEM_4X4(*mvp, 1, 1) * vy + MAT_ELEM_4X4(*mvp, 1, 3);
+
+      /* Parts outside of its own viewport would have been
+       * clipped away, which a merged draw can't do. */
+      if (cx < -1.0f || cx > 1.0f || cy < -1.0f || cy > 1.0f)
+         return false;
+
+      pos[i * 2 + 0] = (2.0f * x + (cx + 1.0f) * width)  / full_width  - 1.0f;
+      pos[i * 2 + 1] = (2.0f * y + (cy + 1.0f) * height) / full_height - 1.0f;
+   }
+
+   if (batch->count && (batch->texture != texture
+            || batch->count + 6 > GL_BATCH_MAX_VERTICES))
+      gl_batch_flush(gl);
+
+   color          = coords->color ? coords->color : gl_batch_white;
+   batch->texture = texture;
+
+   for (i = 0; i < 6; i++)
+   {
+      unsigned src = gl_batch_strip_to_triangles[i];
+      unsigned dst = batch->count + i;
+
+      batch->vertex[dst * 2 + 0]    = pos[src * 2 + 0];
+      batch->vertex[dst * 2 + 1]    = pos[src * 2 + 1];
+      batch->tex_coord[dst * 2 + 0] = coords->tex_coord[src * 2 + 0];
+      batch->tex_coord[dst * 2 + 1] = coords->tex_coord[src * 2 + 1];
+      memcpy(&batch->color[dst * 4], &color[src * 4], 4 * sizeof(GLfloat));
+   }
+
+   batch->count += 6;
+
+   return true;
+}
+
+void gl_batch_flush(gl_t *gl)
+{
+   struct video_coords coords;
+   gl_batch_t *batch = gl ? gl->batch : NULL;
+
+   if (!batch || !batch->count)
+      return;
+
+   coords.vertex        = batch->vertex;
+   coords.color         = batch->color;
+   coords.tex_coord     = batch->tex_coord;
+   coords.lut_tex_coord = batch->tex_coord;
+   coords.vertices      = batch->count;
+   coords.index         = NULL;
+   coords.indexes       = 0;
+
+   batch->count         = 0;
+
+   gl2_viewport(gl, 0, 0, gl->video_width, gl->video_height);
+   glBindTexture(GL_TEXTURE_2D, (GLuint)batch->texture);
+
+   gl->shader->set_coords(gl->shader_data, &coords);
+   gl->shader->set_mvp(gl->shader_data, &batch->identity);
+
+   glDrawArrays(GL_TRIANGLES, 0, coords.vertices);
+}
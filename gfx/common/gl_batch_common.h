@@ -0,0 +1,54 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GL_BATCH_COMMON_H
+#define __GL_BATCH_COMMON_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <gfx/math/matrix_4x4.h>
+
+#include "../video_coord_array.h"
+
+RETRO_BEGIN_DECLS
+
+struct gl;
+
+/* Merges consecutive textured quads drawn with the same
+ * texture and GL state into a single draw call. Quads are
+ * transformed on the CPU into the clip space of the full
+ * backbuffer, so each can keep its own viewport and MVP.
+ *
+ * Anything which changes GL state or draws directly must
+ * call gl_batch_flush() first. */
+typedef struct gl_batch gl_batch_t;
+
+gl_batch_t *gl_batch_new(void);
+
+void gl_batch_free(gl_batch_t *batch);
+
+/* Queues a four vertex triangle strip drawn with the given
+ * viewport, MVP and texture. Returns false if the quad can't
+ * be batched, in which case the caller has to draw it. */
+bool gl_batch_add_quad(struct gl *gl,
+      int x, int y, unsigned width, unsigned height,
+      const math_matrix_4x4 *mvp, unsigned texture,
+      const struct video_coords *coords);
+
+/* Draws all queued quads. */
+void gl_batch_flush(struct gl *gl);
+
+RETRO_END_DECLS
+
+#endif
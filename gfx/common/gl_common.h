@@ -33,7 +33,13 @@
 #include <formats/image.h>
 
 #include "../video_coord_array.h"
+#ifdef HAVE_VIDEO_LAYOUT
+#include "../video_layout/types.h"
+#endif
 #include "../../retroarch.h"
+#include "gl_atlas_common.h"
+#include "gl_batch_common.h"
+#include "gl_timer_common.h"
 
 RETRO_BEGIN_DECLS
 
@@ -184,6 +190,9 @@ struct gl
 
    bool overlay_enable;
    bool overlay_full_screen;
+   /* The geometry or alpha of an overlay image changed since
+    * the draw list was built */
+   bool overlay_dirty;
    bool menu_texture_enable;
    bool menu_texture_full_screen;
    bool have_sync;
@@ -206,8 +215,9 @@ struct gl
 
 #ifdef HAVE_VIDEO_LAYOUT
    bool   video_layout_resize;
-   GLuint video_layout_fbo;
-   GLuint video_layout_fbo_texture;
+   /* Each layer as last drawn */
+   GLuint video_layout_fbo[VIDEO_LAYOUT_MAX_LAYERS];
+   GLuint video_layout_fbo_texture[VIDEO_LAYOUT_MAX_LAYERS];
    GLuint video_layout_white_texture;
 #endif
 
@@ -216,14 +226,24 @@ struct gl
 
    unsigned tex_index; /* For use with PREV. */
    unsigned textures;
+   /* Frames of history the shaders sample (Prev, Prev1...),
+    * the newest at prev_info[prev_index] */
+   unsigned prev_depth;
+   unsigned prev_index;
    unsigned fbo_feedback_pass;
    unsigned rotation;
+   /* Rotation (in degrees) of the physical surface
+    * relative to the logical video size. Set when the
+    * context driver wants us to render pre-rotated. */
+   unsigned surface_rotation;
    unsigned vp_out_width;
    unsigned vp_out_height;
    unsigned tex_w;
    unsigned tex_h;
    unsigned base_size; /* 2 or 4 */
    unsigned overlays;
+   unsigned overlay_draw_vertices;
+   unsigned overlay_draw_runs;
    unsigned pbo_readback_index;
    unsigned last_width[GFX_MAX_TEXTURES];
    unsigned last_height[GFX_MAX_TEXTURES];
@@ -238,6 +258,17 @@ struct gl
    float *overlay_vertex_coord;
    float *overlay_tex_coord;
    float *overlay_color_coord;
+   /* Overlay images packed in the atlas, 0 for those with a
+    * texture of their own */
+   uintptr_t *overlay_atlas_id;
+   /* Visible overlay images as triangles, atlas coordinates
+    * resolved, drawn with one call per run of quads sharing
+    * a texture */
+   float *overlay_draw_vertex;
+   float *overlay_draw_tex;
+   float *overlay_draw_color;
+   GLuint *overlay_draw_run_tex;
+   unsigned *overlay_draw_run_vertices;
 
    struct video_tex_info tex_info;
    struct scaler_ctx pbo_readback_scaler;
@@ -246,7 +277,9 @@ struct gl
    struct video_coords coords;
    struct scaler_ctx scaler;
    video_info_t video_info;
-   struct video_tex_info prev_info[GFX_MAX_TEXTURES];
+   /* Ring of prev_depth frames, stored twice over so the
+    * history is always contiguous from prev_index on */
+   struct video_tex_info prev_info[2 * GFX_MAX_TEXTURES];
    struct video_fbo_rect fbo_rect[GFX_MAX_SHADERS];
 
    const shader_backend_t *shader;
@@ -254,6 +287,46 @@ struct gl
    void *renderchain_data;
    void *ctx_data;
    const gfx_ctx_driver_t *ctx_driver;
+
+   gl_atlas_t *atlas;
+   gl_batch_t *batch;
+   gl_timer_t *timer;
+
+   /* Widgets drawn once, blended in every frame until they change */
+   bool layer_active;
+   GLuint layer_fbo;
+   GLuint layer_texture;
+   unsigned layer_width;
+   unsigned layer_height;
+
+   /* The UI on the context's own plane, as last drawn there */
+   bool ui_layer_valid;
+   bool ui_layer_visible;
+   /* Set while drawing into the plane, which is scanned out
+    * top row first */
+   bool surface_flip_y;
+   uint32_t ui_layer_widgets_hash;
+   char ui_layer_msg[256];
+
+   /* Menu background effect, drawn into pipeline_fbo at a fraction
+    * of the output size and scaled up, redrawn only when due */
+   GLuint pipeline_fbo;
+   GLuint pipeline_texture;
+   unsigned pipeline_width;
+   unsigned pipeline_height;
+   /* Effect in the texture, 0 if none yet */
+   unsigned pipeline_id;
+   retro_time_t pipeline_time;
+
+   /* GPU recording as NV12, packed into record_fbo from a copy
+    * of the surface, then read back through the PBO ring */
+   GLuint record_texture;
+   GLuint record_fbo;
+   GLuint record_fbo_texture;
+   unsigned record_width;
+   unsigned record_height;
+   unsigned record_src_width;
+   unsigned record_src_height;
 };
 
 static INLINE void gl_bind_texture(GLuint id, GLint wrap_mode, GLint mag_filter,
@@ -266,12 +339,101 @@ static INLINE void gl_bind_texture(GLuint id, GLint wrap_mode, GLint mag_filter,
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
 }
 
+/* Maps a rectangle given in logical (unrotated) backbuffer
+ * coordinates onto the physical surface. */
+static INLINE void gl2_surface_rect(const gl_t *gl,
+      int *x, int *y, unsigned *width, unsigned *height)
+{
+   int      rect_x      = *x;
+   int      rect_y      = *y;
+   unsigned rect_width  = *width;
+   unsigned rect_height = *height;
+
+   switch (gl->surface_rotation)
+   {
+      case 90:
+         *x      = (int)gl->video_height - rect_y - (int)rect_height;
+         *y      = rect_x;
+         *width  = rect_height;
+         *height = rect_width;
+         break;
+      case 180:
+         *x      = (int)gl->video_width  - rect_x - (int)rect_width;
+         *y      = (int)gl->video_height - rect_y - (int)rect_height;
+         break;
+      case 270:
+         *x      = rect_y;
+         *y      = (int)gl->video_width - rect_x - (int)rect_width;
+         *width  = rect_height;
+         *height = rect_width;
+         break;
+      default:
+         break;
+   }
+
+   if (gl->surface_flip_y)
+   {
+      int surface_height = (gl->surface_rotation % 180)
+         ? (int)gl->video_width : (int)gl->video_height;
+      *y = surface_height - *y - (int)*height;
+   }
+}
+
+static INLINE void gl2_viewport(const gl_t *gl,
+      int x, int y, unsigned width, unsigned height)
+{
+   if (gl->surface_rotation || gl->surface_flip_y)
+      gl2_surface_rect(gl, &x, &y, &width, &height);
+   glViewport(x, y, width, height);
+}
+
+/* SRC_ALPHA, ONE_MINUS_SRC_ALPHA blending. Into a layer, the alpha
+ * is accumulated as coverage, for the layer to be blended in
+ * premultiplied the same as if it had been drawn directly. */
+static INLINE void gl2_blend_func_alpha(const gl_t *gl)
+{
+#ifndef HAVE_PSGL
+   if (gl->layer_active)
+   {
+      glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+            GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+      return;
+   }
+#endif
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+static INLINE void gl2_scissor(const gl_t *gl,
+      int x, int y, unsigned width, unsigned height)
+{
+   if (gl->surface_rotation || gl->surface_flip_y)
+      gl2_surface_rect(gl, &x, &y, &width, &height);
+   glScissor(x, y, width, height);
+}
+
 bool gl_query_core_context_in_use(void);
 
 bool gl_load_luts(
       const void *shader_data,
       GLuint *textures_lut);
 
+bool gl2_layer_begin(gl_t *gl);
+
+void gl2_layer_end(gl_t *gl);
+
+bool gl2_layer_draw(gl_t *gl);
+
+void gl2_layer_free(gl_t *gl);
+
+bool gl2_pipeline_begin(gl_t *gl, unsigned width, unsigned height);
+
+void gl2_pipeline_end(gl_t *gl);
+
+void gl2_pipeline_draw(gl_t *gl, int x, int y,
+      unsigned width, unsigned height);
+
+void gl2_pipeline_free(gl_t *gl);
+
 RETRO_END_DECLS
 
 #endif
@@ -35,6 +35,7 @@
 #include "../video_coord_array.h"
 #include "../../retroarch.h"
 #include "../drivers_shader/shader_gl_core.h"
+#include "gl_timer_common.h"
 
 RETRO_BEGIN_DECLS
 
@@ -42,11 +43,29 @@ RETRO_BEGIN_DECLS
 #define GL_CORE_NUM_PBOS 4
 #define GL_CORE_NUM_VBOS 256
 #define GL_CORE_NUM_FENCES 8
+/* Textures of other sizes kept around, for cores switching
+ * between a few resolutions */
+#define GL_CORE_NUM_POOLED_TEXTURES 8
 struct gl_core_streamed_texture
 {
    GLuint tex;
    unsigned width;
    unsigned height;
+
+   /* Upload buffer, uploads from it are fenced when it stays
+    * mapped */
+   GLuint pbo;
+   void *pbo_map;
+   size_t pbo_size;
+   GLsync pbo_fence;
+};
+
+struct gl_core_pooled_texture
+{
+   GLuint tex;
+   unsigned width;
+   unsigned height;
+   uint64_t last_used;
 };
 
 typedef struct gl_core
@@ -79,6 +98,11 @@ typedef struct gl_core
    GLuint vao;
    struct gl_core_streamed_texture textures[GL_CORE_NUM_TEXTURES];
    unsigned textures_index;
+   struct gl_core_pooled_texture texture_pool[GL_CORE_NUM_POOLED_TEXTURES];
+   uint64_t texture_pool_frame;
+   /* Upload buffers stay mapped (ARB_buffer_storage), else they
+    * are orphaned and mapped each frame */
+   bool pbo_persistent;
 
    GLuint menu_texture;
    float menu_texture_alpha;
@@ -129,6 +153,8 @@ typedef struct gl_core
    GLsync fences[GL_CORE_NUM_FENCES];
    unsigned fence_count;
 
+   gl_timer_t *timer;
+
    void *readback_buffer_screenshot;
    struct scaler_ctx pbo_readback_scaler;
    bool pbo_readback_enable;
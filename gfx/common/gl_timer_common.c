@@ -0,0 +1,343 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <glsym/glsym.h>
+#include <gfx/gl_capabilities.h>
+
+#include "gl_timer_common.h"
+#include "../../performance_counters.h"
+#include "../../verbosity.h"
+
+#if !defined(HAVE_PSGL)
+#define HAVE_GL_TIMER
+#endif
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+/* GLES2 only has the 32-bit result query, which
+ * is still good for over four seconds. */
+#if defined(HAVE_OPENGLES2)
+typedef GLuint gl_timer_result_t;
+#define gl_timer_gen_queries       glGenQueriesEXT
+#define gl_timer_delete_queries    glDeleteQueriesEXT
+#define gl_timer_begin_query       glBeginQueryEXT
+#define gl_timer_end_query         glEndQueryEXT
+#define gl_timer_get_query_uiv     glGetQueryObjectuivEXT
+#define gl_timer_get_query_result  glGetQueryObjectuivEXT
+#elif defined(HAVE_OPENGLES)
+typedef GLuint64 gl_timer_result_t;
+#define gl_timer_gen_queries       glGenQueries
+#define gl_timer_delete_queries    glDeleteQueries
+#define gl_timer_begin_query       glBeginQuery
+#define gl_timer_end_query         glEndQuery
+#define gl_timer_get_query_uiv     glGetQueryObjectuiv
+#define gl_timer_get_query_result  glGetQueryObjectui64vEXT
+#else
+typedef GLuint64 gl_timer_result_t;
+#define gl_timer_gen_queries       glGenQueries
+#define gl_timer_delete_queries    glDeleteQueries
+#define gl_timer_begin_query       glBeginQuery
+#define gl_timer_end_query         glEndQuery
+#define gl_timer_get_query_uiv     glGetQueryObjectuiv
+#define gl_timer_get_query_result  glGetQueryObjectui64v
+#endif
+
+/* Results lag a couple of frames behind, so keep a few in flight. */
+#define GL_TIMER_FRAMES      4
+#define GL_TIMER_MAX_QUERIES 16
+
+typedef struct gl_timer_frame
+{
+   GLuint queries[GL_TIMER_MAX_QUERIES];
+   unsigned stages[GL_TIMER_MAX_QUERIES];
+   unsigned count;
+   bool pending;
+} gl_timer_frame_t;
+
+struct gl_timer
+{
+   gl_timer_frame_t frames[GL_TIMER_FRAMES];
+   retro_time_t times[GL_TIMER_STAGE_LAST];
+   unsigned index;
+   int active;
+   bool measuring;
+};
+
+static rarch_histogram_t gl_timer_histograms[GL_TIMER_STAGE_LAST];
+
+static const char *gl_timer_stage_names[GL_TIMER_STAGE_LAST] = {
+   "GPU pass #0",
+   "GPU pass #1",
+   "GPU pass #2",
+   "GPU pass #3",
+   "GPU pass #4",
+   "GPU pass #5",
+   "GPU pass #6",
+   "GPU pass #7+",
+   "GPU menu",
+   "GPU overlay",
+   "GPU font",
+};
+
+gl_timer_t *gl_timer_new(void)
+{
+#ifdef HAVE_GL_TIMER
+   unsigned i;
+   gl_timer_t *timer = NULL;
+#ifdef HAVE_OPENGLES
+   bool supported    = gl_query_extension("GL_EXT_disjoint_timer_query");
+#else
+   bool supported    = gl_query_extension("timer_query");
+#endif
+
+   if (!supported)
+   {
+      RARCH_WARN("[GL]: GPU timer queries are not supported.\n");
+      return NULL;
+   }
+
+   timer = (gl_timer_t*)calloc(1, sizeof(*timer));
+   if (!timer)
+      return NULL;
+
+   for (i = 0; i < GL_TIMER_FRAMES; i++)
+      gl_timer_gen_queries(GL_TIMER_MAX_QUERIES, timer->frames[i].queries);
+
+   for (i = 0; i < GL_TIMER_STAGE_LAST; i++)
+   {
+      timer->times[i] = -1;
+      rarch_histogram_register(&gl_timer_histograms[i],
+            gl_timer_stage_names[i]);
+   }
+
+   timer->active = -1;
+   gl_timer_reset(timer);
+
+   return timer;
+#else
+   return NULL;
+#endif
+}
+
+void gl_timer_free(gl_timer_t *timer)
+{
+#ifdef HAVE_GL_TIMER
+   unsigned i;
+
+   if (!timer)
+      return;
+
+   if (timer->active >= 0)
+      gl_timer_end_query(GL_TIME_ELAPSED);
+
+   for (i = 0; i < GL_TIMER_FRAMES; i++)
+      gl_timer_delete_queries(GL_TIMER_MAX_QUERIES, timer->frames[i].queries);
+
+   free(timer);
+#endif
+}
+
+void gl_timer_reset(gl_timer_t *timer)
+{
+   unsigned i;
+
+   if (!timer)
+      return;
+
+   for (i = 0; i < GL_TIMER_STAGE_LAST; i++)
+      rarch_histogram_reset(&gl_timer_histograms[i]);
+}
+
+#ifdef HAVE_GL_TIMER
+static bool gl_timer_poll(gl_timer_t *timer)
+{
+   unsigned i, j;
+   bool completed = false;
+   GLint disjoint = 0;
+
+#ifdef HAVE_OPENGLES
+   /* Results overlapping a disjoint operation
+    * (e.g. a GPU frequency change) are meaningless. */
+   glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+#endif
+
+   /* The slot about to be reused is the oldest one. */
+   for (i = 0; i < GL_TIMER_FRAMES; i++)
+   {
+      retro_time_t times[GL_TIMER_STAGE_LAST];
+      GLuint available         = 0;
+      gl_timer_frame_t *frame  = &timer->frames[
+         (timer->index + i) % GL_TIMER_FRAMES];
+
+      if (!frame->pending)
+         continue;
+
+      gl_timer_get_query_uiv(frame->queries[frame->count - 1],
+            GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+         break;
+
+      for (j = 0; j < GL_TIMER_STAGE_LAST; j++)
+         times[j] = -1;
+
+      for (j = 0; j < frame->count; j++)
+      {
+         gl_timer_result_t result = 0;
+         unsigned stage           = frame->stages[j];
+
+         gl_timer_get_query_result(frame->queries[j],
+               GL_QUERY_RESULT, &result);
+
+         if (times[stage] < 0)
+            times[stage] = 0;
+         times[stage] += result / 1000;
+      }
+
+      frame->pending = false;
+      frame->count   = 0;
+
+      if (disjoint)
+         continue;
+
+      for (j = 0; j < GL_TIMER_STAGE_LAST; j++)
+      {
+         if (times[j] >= 0)
+            rarch_histogram_add(&gl_timer_histograms[j], times[j]);
+         timer->times[j] = times[j];
+      }
+
+      completed = true;
+   }
+
+   return completed;
+}
+#endif
+
+bool gl_timer_begin_frame(gl_timer_t *timer, bool enable)
+{
+#ifdef HAVE_GL_TIMER
+   bool completed = false;
+
+   if (!timer)
+      return false;
+
+   completed        = gl_timer_poll(timer);
+
+   /* Skip timing this frame if the slot is still in flight. */
+   timer->measuring = enable && !timer->frames[timer->index].pending;
+   timer->active    = -1;
+
+   return completed;
+#else
+   return false;
+#endif
+}
+
+void gl_timer_stage(gl_timer_t *timer, unsigned stage)
+{
+#ifdef HAVE_GL_TIMER
+   gl_timer_frame_t *frame = NULL;
+
+   if (!timer || !timer->measuring || timer->active == (int)stage)
+      return;
+
+   frame = &timer->frames[timer->index];
+
+   if (timer->active >= 0)
+      gl_timer_end_query(GL_TIME_ELAPSED);
+
+   if (frame->count >= GL_TIMER_MAX_QUERIES)
+   {
+      timer->active    = -1;
+      timer->measuring = false;
+      return;
+   }
+
+   gl_timer_begin_query(GL_TIME_ELAPSED, frame->queries[frame->count]);
+   frame->stages[frame->count++] = stage;
+   timer->active                 = stage;
+#endif
+}
+
+void gl_timer_pass(gl_timer_t *timer, unsigned pass)
+{
+   gl_timer_stage(timer, GL_TIMER_STAGE_PASS +
+         (pass < GL_TIMER_MAX_PASSES ? pass : GL_TIMER_MAX_PASSES - 1));
+}
+
+void gl_timer_end_frame(gl_timer_t *timer)
+{
+#ifdef HAVE_GL_TIMER
+   gl_timer_frame_t *frame = NULL;
+
+   if (!timer)
+      return;
+
+   frame = &timer->frames[timer->index];
+
+   if (timer->active >= 0)
+      gl_timer_end_query(GL_TIME_ELAPSED);
+
+   timer->active    = -1;
+   timer->measuring = false;
+
+   if (!frame->count)
+      return;
+
+   frame->pending   = true;
+   timer->index     = (timer->index + 1) % GL_TIMER_FRAMES;
+#endif
+}
+
+retro_time_t gl_timer_get_time(const gl_timer_t *timer,
+      unsigned first, unsigned last)
+{
+   unsigned i;
+   retro_time_t total = -1;
+
+   if (!timer)
+      return -1;
+
+   for (i = first; i < last && i < GL_TIMER_STAGE_LAST; i++)
+   {
+      if (timer->times[i] < 0)
+         continue;
+      if (total < 0)
+         total = 0;
+      total += timer->times[i];
+   }
+
+   return total;
+}
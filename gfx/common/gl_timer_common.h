@@ -0,0 +1,72 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GL_TIMER_COMMON_H
+#define __GL_TIMER_COMMON_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Shader passes past the last one are accounted to it. */
+#define GL_TIMER_MAX_PASSES 8
+
+enum gl_timer_stage
+{
+   GL_TIMER_STAGE_PASS = 0,
+   GL_TIMER_STAGE_MENU = GL_TIMER_MAX_PASSES,
+   GL_TIMER_STAGE_OVERLAY,
+   GL_TIMER_STAGE_FONT,
+   GL_TIMER_STAGE_LAST
+};
+
+/* Measures the GPU time of the stages of a frame with
+ * GL_TIME_ELAPSED queries. Results are read back a few
+ * frames later without stalling, and are reported as
+ * histograms through the performance counters. */
+typedef struct gl_timer gl_timer_t;
+
+/* Returns NULL if the current context has no timer queries. */
+gl_timer_t *gl_timer_new(void);
+
+void gl_timer_free(gl_timer_t *timer);
+
+/* Drops the samples gathered so far, e.g. after a shader change. */
+void gl_timer_reset(gl_timer_t *timer);
+
+/* Collects the results of previous frames and sets up timing
+ * of this one if enable is true. Returns true if the results
+ * of a new frame became available. */
+bool gl_timer_begin_frame(gl_timer_t *timer, bool enable);
+
+/* Ends the current stage and starts timing the given one.
+ * Stages may be entered multiple times in a frame. */
+void gl_timer_stage(gl_timer_t *timer, unsigned stage);
+
+/* Starts timing the stage of the given shader pass. */
+void gl_timer_pass(gl_timer_t *timer, unsigned pass);
+
+/* Must be called before swapping buffers. */
+void gl_timer_end_frame(gl_timer_t *timer);
+
+/* Returns the GPU time, in usec, spent in stages [first, last)
+ * of the latest completed frame, or -1 if none were timed. */
+retro_time_t gl_timer_get_time(const gl_timer_t *timer,
+      unsigned first, unsigned last);
+
+RETRO_END_DECLS
+
+#endif
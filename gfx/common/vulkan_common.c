@@ -974,6 +974,7 @@ void vulkan_transition_texture(vk_t *vk, VkCommandBuffer cmd, struct vk_texture
 static void vulkan_check_dynamic_state(vk_t *vk)
 {
    VkRect2D sci;
+   VkViewport vp = vk->vk_vp;
 
    if (vk->tracker.use_scissor)
       sci = vk->tracker.scissor;
@@ -986,7 +987,14 @@ static void vulkan_check_dynamic_state(vk_t *vk)
       sci.extent.height = vk->vp.height;
    }
 
-   vkCmdSetViewport(vk->cmd, 0, 1, &vk->vk_vp);
+   if (vk->surface_rotation)
+   {
+      vulkan_surface_viewport(vk, &vp);
+      vulkan_surface_rect(vk, &sci.offset.x, &sci.offset.y,
+            &sci.extent.width, &sci.extent.height);
+   }
+
+   vkCmdSetViewport(vk->cmd, 0, 1, &vp);
    vkCmdSetScissor (vk->cmd, 0, 1, &sci);
 
    vk->tracker.dirty &= ~VULKAN_DIRTY_DYNAMIC_BIT;
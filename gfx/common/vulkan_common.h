@@ -330,6 +330,9 @@ typedef struct vk
    unsigned tex_w, tex_h;
    unsigned vp_out_width, vp_out_height;
    unsigned rotation;
+   /* Of the physical surface relative to the video size,
+    * baked into every projection (in degrees) */
+   unsigned surface_rotation;
    unsigned num_swapchain_images;
    unsigned last_valid_index;
 
@@ -516,6 +519,75 @@ static INLINE unsigned vulkan_format_to_bpp(VkFormat format)
    }
 }
 
+/* Size of the surface as the video driver sees it,
+ * i.e. before the surface rotation */
+static INLINE void vulkan_logical_size(const vk_t *vk,
+      unsigned *width, unsigned *height)
+{
+   *width  = vk->context->swapchain_width;
+   *height = vk->context->swapchain_height;
+
+   if (vk->surface_rotation == 90 || vk->surface_rotation == 270)
+   {
+      *width  = vk->context->swapchain_height;
+      *height = vk->context->swapchain_width;
+   }
+}
+
+/* Maps a rectangle given in logical (unrotated) top-left
+ * coordinates onto the physical surface. */
+static INLINE void vulkan_surface_rect(const vk_t *vk,
+      int32_t *x, int32_t *y, uint32_t *width, uint32_t *height)
+{
+   unsigned logical_width, logical_height;
+   int32_t  rect_x      = *x;
+   int32_t  rect_y      = *y;
+   uint32_t rect_width  = *width;
+   uint32_t rect_height = *height;
+
+   vulkan_logical_size(vk, &logical_width, &logical_height);
+
+   switch (vk->surface_rotation)
+   {
+      case 90:
+         *x      = rect_y;
+         *y      = (int32_t)logical_width - rect_x - (int32_t)rect_width;
+         *width  = rect_height;
+         *height = rect_width;
+         break;
+      case 180:
+         *x      = (int32_t)logical_width  - rect_x - (int32_t)rect_width;
+         *y      = (int32_t)logical_height - rect_y - (int32_t)rect_height;
+         break;
+      case 270:
+         *x      = (int32_t)logical_height - rect_y - (int32_t)rect_height;
+         *y      = rect_x;
+         *width  = rect_height;
+         *height = rect_width;
+         break;
+      default:
+         break;
+   }
+}
+
+static INLINE void vulkan_surface_viewport(const vk_t *vk,
+      VkViewport *vp)
+{
+   int32_t  x      = (int32_t)vp->x;
+   int32_t  y      = (int32_t)vp->y;
+   uint32_t width  = (uint32_t)vp->width;
+   uint32_t height = (uint32_t)vp->height;
+
+   if (!vk->surface_rotation)
+      return;
+
+   vulkan_surface_rect(vk, &x, &y, &width, &height);
+   vp->x      = (float)x;
+   vp->y      = (float)y;
+   vp->width  = (float)width;
+   vp->height = (float)height;
+}
+
 static INLINE void vulkan_write_quad_vbo(struct vk_vertex *pv,
       float x, float y, float width, float height,
       float tex_x, float tex_y, float tex_width, float tex_height,
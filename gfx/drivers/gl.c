@@ -39,6 +39,7 @@
 #endif
 
 #include <compat/strl.h>
+#include <copy_rows.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/math/matrix_4x4.h>
 #include <formats/image.h>
@@ -54,6 +55,8 @@
 
 #include "../../configuration.h"
 #include "../../dynamic.h"
+#include "../../memory_usage.h"
+#include "../../performance_counters.h"
 
 #include "../../retroarch.h"
 #include "../../verbosity.h"
@@ -160,6 +163,36 @@ typedef struct __GLsync *GLsync;
 #endif
 #endif
 
+#if defined(HAVE_OPENGLES3) && defined(HAVE_GL_SYNC)
+#ifdef GL_PIXEL_UNPACK_BUFFER
+#define HAVE_GL_UPLOAD_PBO
+#endif
+#endif
+
+#if (!defined(HAVE_OPENGLES) || defined(HAVE_OPENGLES3))
+#ifdef GL_PIXEL_PACK_BUFFER
+#define HAVE_GL_ASYNC_READBACK
+#endif
+#endif
+
+/* Number of streaming upload buffers for software frames. */
+#define UPLOAD_PBO_COUNT 3
+
+/* Software frames are compared with the last uploaded one
+ * in bands of rows, split into cacheline sized blocks. */
+#define DIRTY_BAND_ROWS        16
+#define DIRTY_BLOCK_BYTES      64
+#define DIRTY_MAX_RECTS        16
+/* Upload the whole frame once this much of it changed. */
+#define DIRTY_FULL_PERCENT     50
+
+/* Adaptive shader quality levels: the preset as written,
+ * UNORM instead of float/sRGB FBOs, 75% and 50% pass scale. */
+#define ADAPTIVE_LEVELS        4
+#define ADAPTIVE_LEVEL_UNORM   1
+#define ADAPTIVE_FRAMES_OVER   30
+#define ADAPTIVE_FRAMES_UNDER  300
+
 typedef struct gl2_renderchain_data
 {
    bool egl_images;
@@ -181,15 +214,49 @@ typedef struct gl2_renderchain_data
    GLsync fences[MAX_FENCES];
 #endif
 
-   struct gfx_fbo_scale fbo_scale[GFX_MAX_SHADERS];
-} gl2_renderchain_data_t;
+#ifdef HAVE_GL_UPLOAD_PBO
+   /* Software frames are streamed through a ring of
+    * pixel unpack buffers, so the texture upload is an
+    * asynchronous DMA instead of a synchronous copy out
+    * of client memory. */
+   bool upload_pbo;
+   unsigned upload_index;
+   size_t upload_size;
+   GLuint upload_buffers[UPLOAD_PBO_COUNT];
+   GLsync upload_fences[UPLOAD_PBO_COUNT];
+#endif
 
-#if (!defined(HAVE_OPENGLES) || defined(HAVE_OPENGLES3))
-#ifdef GL_PIXEL_PACK_BUFFER
-#define HAVE_GL_ASYNC_READBACK
+#if defined(HAVE_OPENGLES) && !defined(HAVE_PSGL)
+   /* Which frame the texture holds, as numbered by
+    * video_driver_get_prev_frame, so only the regions
+    * which changed since have to be uploaded. */
+   uint64_t dirty_serial;
 #endif
+
+#if defined(HAVE_GL_ASYNC_READBACK) && defined(HAVE_GL_SYNC)
+   /* Signalled once the readback into the matching
+    * pixel pack buffer has landed. */
+   GLsync readback_fences[4];
 #endif
 
+   /* Adaptive quality for shader presets that are too
+    * heavy for the GPU. GPU time is in usec. */
+   unsigned adaptive_level;
+   unsigned adaptive_frames_over;
+   unsigned adaptive_frames_under;
+   float adaptive_gpu_time;
+
+   /* When the core dupes a frame, passes which only depend
+    * on their input keep their FBO contents from last frame. */
+   bool passes_valid;
+   unsigned passes_vp_width;
+   unsigned passes_vp_height;
+   unsigned num_parameters;
+   float parameters[GFX_MAX_PARAMETERS];
+
+   struct gfx_fbo_scale fbo_scale[GFX_MAX_SHADERS];
+} gl2_renderchain_data_t;
+
 #define set_texture_coords(coords, xamt, yamt) \
    coords[2] = xamt; \
    coords[6] = xamt; \
@@ -374,6 +441,23 @@ static void gl2_set_projection(gl_t *gl,
    matrix_4x4_ortho(gl->mvp_no_rot, ortho->left, ortho->right,
          ortho->bottom, ortho->top, ortho->znear, ortho->zfar);
 
+   /* Bake the surface rotation into every backbuffer
+    * projection, so the context can skip rotating the
+    * final image itself. */
+   if (gl->surface_rotation)
+   {
+      math_matrix_4x4 proj = gl->mvp_no_rot;
+      matrix_4x4_rotate_z(rot, M_PI * gl->surface_rotation / 180.0f);
+      matrix_4x4_multiply(gl->mvp_no_rot, rot, proj);
+   }
+
+   if (gl->surface_flip_y)
+   {
+      math_matrix_4x4 proj = gl->mvp_no_rot;
+      matrix_4x4_scale(rot, 1.0f, -1.0f, 1.0f);
+      matrix_4x4_multiply(gl->mvp_no_rot, rot, proj);
+   }
+
    if (!allow_rotate)
    {
       gl->mvp = gl->mvp_no_rot;
@@ -467,7 +551,7 @@ static void gl2_set_viewport(gl_t *gl,
       gl->vp.y *= 2;
 #endif
 
-   glViewport(gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+   gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
    gl2_set_projection(gl, &default_ortho, allow_rotate);
 
    /* Set last backbuffer viewport. */
@@ -482,11 +566,87 @@ static void gl2_set_viewport(gl_t *gl,
 #endif
 }
 
+/* Sets up viewport and projection for rendering
+ * into an FBO, which never needs surface rotation. */
+static void gl2_set_fbo_viewport(gl_t *gl,
+      unsigned viewport_width, unsigned viewport_height)
+{
+   gl->vp.x      = 0;
+   gl->vp.y      = 0;
+   gl->vp.width  = viewport_width;
+   gl->vp.height = viewport_height;
+
+   glViewport(0, 0, viewport_width, viewport_height);
+   matrix_4x4_ortho(gl->mvp, default_ortho.left, default_ortho.right,
+         default_ortho.bottom, default_ortho.top,
+         default_ortho.znear, default_ortho.zfar);
+}
+
+/* Returns true if a shader parameter changed since last
+ * frame, which invalidates every cached pass. */
+static bool gl2_renderchain_parameters_changed(gl_t *gl,
+      gl2_renderchain_data_t *chain)
+{
+   unsigned i;
+   bool changed                = false;
+   struct video_shader *shader = gl->shader->get_current_shader(
+         gl->shader_data);
+
+   if (!shader)
+      return false;
+
+   if (shader->num_parameters != chain->num_parameters)
+      changed = true;
+
+   chain->num_parameters = shader->num_parameters;
+
+   for (i = 0; i < shader->num_parameters; i++)
+   {
+      if (chain->parameters[i] != shader->parameters[i].current)
+         changed = true;
+      chain->parameters[i] = shader->parameters[i].current;
+   }
+
+   return changed;
+}
+
+/* Returns the shader index of the first pass that has to be
+ * rendered this frame. On a duped frame, every pass before the
+ * first time dependent one would produce the same output. */
+static unsigned gl2_renderchain_first_dirty_pass(gl_t *gl,
+      gl2_renderchain_data_t *chain,
+      const void *frame)
+{
+   unsigned i;
+   bool vp_changed = gl->vp_out_width  != chain->passes_vp_width
+                  || gl->vp_out_height != chain->passes_vp_height;
+   bool params_changed = gl2_renderchain_parameters_changed(gl, chain);
+
+   chain->passes_vp_width  = gl->vp_out_width;
+   chain->passes_vp_height = gl->vp_out_height;
+
+   if (     frame
+         || !chain->passes_valid
+         || vp_changed
+         || params_changed
+         || gl->should_resize
+         || gl->hw_render_use
+         || gl->fbo_feedback_enable)
+      return 1;
+
+   for (i = 1; i <= (unsigned)chain->fbo_pass; i++)
+      if (gl->shader->is_time_dependent(gl->shader_data, i))
+         return i;
+
+   return chain->fbo_pass + 1;
+}
+
 static void gl2_renderchain_render(
       gl_t *gl,
       gl2_renderchain_data_t *chain,
       video_frame_info_t *video_info,
       uint64_t frame_count,
+      unsigned first_dirty_pass,
       const struct video_tex_info *tex_info,
       const struct video_tex_info *feedback_info)
 {
@@ -528,6 +688,12 @@ static void gl2_renderchain_render(
       memcpy(fbo_info->coord, fbo_tex_coords, sizeof(fbo_tex_coords));
       fbo_tex_info_cnt++;
 
+      /* Output is still in the FBO from last frame. */
+      if ((unsigned)i + 1 < first_dirty_pass)
+         continue;
+
+      gl_timer_pass(gl->timer, i);
+
       gl2_bind_fb(chain->fbo[i]);
 
       gl->shader->use(gl, gl->shader_data,
@@ -544,8 +710,7 @@ static void gl2_renderchain_render(
       glClear(GL_COLOR_BUFFER_BIT);
 
       /* Render to FBO with certain size. */
-      gl2_set_viewport(gl, video_info,
-            rect->img_width, rect->img_height, true, false);
+      gl2_set_fbo_viewport(gl, rect->img_width, rect->img_height);
 
       params.data          = gl;
       params.width         = prev_rect->img_width;
@@ -556,7 +721,7 @@ static void gl2_renderchain_render(
       params.out_height    = gl->vp.height;
       params.frame_counter = (unsigned int)frame_count;
       params.info          = tex_info;
-      params.prev_info     = gl->prev_info;
+      params.prev_info     = gl->prev_info + gl->prev_index;
       params.feedback_info = feedback_info;
       params.fbo_info      = fbo_tex_info;
       params.fbo_info_cnt  = fbo_tex_info_cnt;
@@ -595,6 +760,8 @@ static void gl2_renderchain_render(
    fbo_tex_info_cnt++;
 
    /* Render our FBO texture to back buffer. */
+   gl_timer_pass(gl->timer, chain->fbo_pass);
+
    gl2_renderchain_bind_backbuffer();
 
    gl->shader->use(gl, gl->shader_data,
@@ -622,7 +789,7 @@ static void gl2_renderchain_render(
    params.out_height    = gl->vp.height;
    params.frame_counter = (unsigned int)frame_count;
    params.info          = tex_info;
-   params.prev_info     = gl->prev_info;
+   params.prev_info     = gl->prev_info + gl->prev_index;
    params.feedback_info = feedback_info;
    params.fbo_info      = fbo_tex_info;
    params.fbo_info_cnt  = fbo_tex_info_cnt;
@@ -639,11 +806,38 @@ static void gl2_renderchain_render(
    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
    gl->coords.tex_coord = gl->tex_info.coord;
+
+   chain->passes_valid  = true;
+}
+
+/* Memory of the FBO textures, as allocated: floating-point
+ * passes take 16 bytes a pixel, the others 4. */
+static void gl2_renderchain_account_fbo(gl_t *gl,
+      gl2_renderchain_data_t *chain)
+{
+   int i;
+   uint64_t bytes = 0;
+
+   for (i = 0; i < chain->fbo_pass; i++)
+   {
+      uint64_t size = (uint64_t)gl->fbo_rect[i].width
+         * gl->fbo_rect[i].height
+         * (chain->fbo_scale[i].fp_fbo && chain->has_fp_fbo ? 16 : 4);
+
+      bytes += size;
+      if (gl->fbo_feedback_enable && (unsigned)i == gl->fbo_feedback_pass)
+         bytes += size;
+   }
+
+   memory_usage_set(MEMORY_USAGE_SHADERS, bytes);
 }
 
 static void gl2_renderchain_deinit_fbo(gl_t *gl,
       gl2_renderchain_data_t *chain)
 {
+   if (chain)
+      chain->passes_valid = false;
+
    if (gl)
    {
       if (gl->fbo_feedback)
@@ -668,6 +862,8 @@ static void gl2_renderchain_deinit_fbo(gl_t *gl,
 
       chain->fbo_pass          = 0;
    }
+
+   memory_usage_set(MEMORY_USAGE_SHADERS, 0);
 }
 
 static void gl2_renderchain_deinit_hw_render(
@@ -808,7 +1004,8 @@ static void gl2_create_fbo_texture(gl_t *gl,
 
    gl_bind_texture(texture, wrap_enum, mag_filter, min_filter);
 
-   fp_fbo   = chain->fbo_scale[i].fp_fbo;
+   fp_fbo   = chain->fbo_scale[i].fp_fbo
+      && chain->adaptive_level < ADAPTIVE_LEVEL_UNORM;
 
    if (fp_fbo)
    {
@@ -828,7 +1025,8 @@ static void gl2_create_fbo_texture(gl_t *gl,
 #endif
    {
 #ifndef HAVE_OPENGLES
-      bool srgb_fbo = chain->fbo_scale[i].srgb_fbo;
+      bool srgb_fbo = chain->fbo_scale[i].srgb_fbo
+         && chain->adaptive_level < ADAPTIVE_LEVEL_UNORM;
 
       if (!fp_fbo && srgb_fbo)
       {
@@ -877,6 +1075,111 @@ static void gl2_create_fbo_texture(gl_t *gl,
    }
 }
 
+/* Recreates the FBO textures whose format depends on
+ * the adaptive level. The feedback pass is left alone,
+ * since its texture is swapped with the feedback FBO. */
+static void gl2_renderchain_recreate_fbo_formats(gl_t *gl,
+      gl2_renderchain_data_t *chain)
+{
+   int i;
+
+   for (i = 0; i < chain->fbo_pass; i++)
+   {
+      if (!chain->fbo_scale[i].fp_fbo && !chain->fbo_scale[i].srgb_fbo)
+         continue;
+      if (gl->fbo_feedback_enable && (unsigned)i == gl->fbo_feedback_pass)
+         continue;
+
+      glDeleteTextures(1, &chain->fbo_texture[i]);
+      glGenTextures(1, &chain->fbo_texture[i]);
+      gl2_create_fbo_texture(gl, chain, i, chain->fbo_texture[i]);
+
+      gl2_bind_fb(chain->fbo[i]);
+      gl2_fb_texture_2d(RARCH_GL_FRAMEBUFFER,
+            RARCH_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+            chain->fbo_texture[i], 0);
+   }
+
+   glBindTexture(GL_TEXTURE_2D, 0);
+   gl2_renderchain_bind_backbuffer();
+}
+
+/* Moves the adaptive level up when the chain overruns the
+ * frame budget for a while, and back down when there has
+ * been plenty of headroom for a lot longer. */
+static void gl2_renderchain_adapt(gl_t *gl,
+      gl2_renderchain_data_t *chain,
+      video_frame_info_t *video_info)
+{
+   unsigned i;
+   float budget;
+   unsigned level        = chain->adaptive_level;
+   bool has_formats      = false;
+   retro_time_t gpu_time = gl_timer_get_time(gl->timer,
+         GL_TIMER_STAGE_PASS, GL_TIMER_STAGE_PASS + GL_TIMER_MAX_PASSES);
+
+   if (gpu_time < 0 || video_info->refresh_rate <= 0.0f)
+      return;
+
+   /* Leave room for UI rendering and the present. */
+   budget = 0.8f * 1000000.0f / video_info->refresh_rate;
+
+   chain->adaptive_gpu_time = chain->adaptive_gpu_time > 0.0f
+      ? chain->adaptive_gpu_time * 0.9f + gpu_time * 0.1f
+      : gpu_time;
+
+   if (chain->adaptive_gpu_time > budget)
+   {
+      chain->adaptive_frames_under = 0;
+      if (++chain->adaptive_frames_over >= ADAPTIVE_FRAMES_OVER
+            && level + 1 < ADAPTIVE_LEVELS)
+         level++;
+   }
+   else if (chain->adaptive_gpu_time < budget * 0.5f)
+   {
+      chain->adaptive_frames_over = 0;
+      if (++chain->adaptive_frames_under >= ADAPTIVE_FRAMES_UNDER
+            && level > 0)
+         level--;
+   }
+   else
+   {
+      chain->adaptive_frames_over  = 0;
+      chain->adaptive_frames_under = 0;
+   }
+
+   for (i = 0; i < (unsigned)chain->fbo_pass; i++)
+      if (chain->fbo_scale[i].fp_fbo || chain->fbo_scale[i].srgb_fbo)
+         has_formats = true;
+
+   /* Nothing to gain from the format level. */
+   if (!has_formats && level == ADAPTIVE_LEVEL_UNORM)
+      level = level > chain->adaptive_level ? level + 1 : 0;
+
+   if (level == chain->adaptive_level)
+      return;
+
+   RARCH_LOG("[GL]: Shader GPU time %.2f ms (budget %.2f ms), "
+         "adaptive quality level %u -> %u.\n",
+         chain->adaptive_gpu_time / 1000.0f, budget / 1000.0f,
+         chain->adaptive_level, level);
+
+   chain->adaptive_frames_over  = 0;
+   chain->adaptive_frames_under = 0;
+   chain->adaptive_gpu_time     = 0.0f;
+
+   if ((level >= ADAPTIVE_LEVEL_UNORM)
+         != (chain->adaptive_level >= ADAPTIVE_LEVEL_UNORM))
+   {
+      chain->adaptive_level = level;
+      if (has_formats)
+         gl2_renderchain_recreate_fbo_formats(gl, chain);
+   }
+
+   chain->adaptive_level = level;
+   chain->passes_valid   = false;
+}
+
 static void gl2_create_fbo_textures(gl_t *gl,
       gl2_renderchain_data_t *chain)
 {
@@ -1006,6 +1309,25 @@ static void gl2_renderchain_recompute_pass_sizes(
       last_max_width  = fbo_rect->max_img_width;
       last_max_height = fbo_rect->max_img_height;
    }
+
+   /* Done after the fact, so a pass scaled relative
+    * to a downscaled pass isn't downscaled twice. */
+   if (chain->adaptive_level > ADAPTIVE_LEVEL_UNORM)
+   {
+      float scale = chain->adaptive_level > ADAPTIVE_LEVEL_UNORM + 1
+         ? 0.5f : 0.75f;
+
+      for (i = 0; i < (unsigned)chain->fbo_pass; i++)
+      {
+         struct video_fbo_rect  *fbo_rect   = &gl->fbo_rect[i];
+         struct gfx_fbo_scale *fbo_scale    = &chain->fbo_scale[i];
+
+         if (fbo_scale->type_x != RARCH_SCALE_ABSOLUTE)
+            fbo_rect->img_width  = MAX(1, fbo_rect->img_width  * scale);
+         if (fbo_scale->type_y != RARCH_SCALE_ABSOLUTE)
+            fbo_rect->img_height = MAX(1, fbo_rect->img_height * scale);
+      }
+   }
 }
 
 static void gl2_renderchain_start_render(
@@ -1025,9 +1347,8 @@ static void gl2_renderchain_start_render(
    glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
    gl2_bind_fb(chain->fbo[0]);
 
-   gl2_set_viewport(gl,
-         video_info, gl->fbo_rect[0].img_width,
-         gl->fbo_rect[0].img_height, true, false);
+   gl2_set_fbo_viewport(gl,
+         gl->fbo_rect[0].img_width, gl->fbo_rect[0].img_height);
 
    /* Need to preserve the "flipped" state when in FBO
     * as well to have consistent texture coordinates.
@@ -1126,6 +1447,8 @@ static void gl2_renderchain_init(
    gl->fbo_feedback_enable = gl->shader->get_feedback_pass(gl->shader_data,
          &gl->fbo_feedback_pass);
 
+   chain->passes_valid     = false;
+
    if (gl->fbo_feedback_enable && gl->fbo_feedback_pass
          < (unsigned)chain->fbo_pass)
    {
@@ -1149,6 +1472,7 @@ static void gl2_renderchain_init(
    }
 
    gl->fbo_inited = true;
+   gl2_renderchain_account_fbo(gl, chain);
 }
 
 static bool gl2_renderchain_init_hw_render(
@@ -1257,10 +1581,14 @@ static void gl2_renderchain_bind_prev_texture(
       gl2_renderchain_data_t *chain,
       const struct video_tex_info *tex_info)
 {
-   memmove(gl->prev_info + 1, gl->prev_info,
-         sizeof(*tex_info) * (gl->textures - 1));
-   memcpy(&gl->prev_info[0], tex_info,
-         sizeof(*tex_info));
+   /* One entry per frame, none if no shader samples Prev */
+   if (gl->prev_depth)
+   {
+      gl->prev_index = (gl->prev_index + gl->prev_depth - 1)
+         % gl->prev_depth;
+      gl->prev_info[gl->prev_index]                  = *tex_info;
+      gl->prev_info[gl->prev_index + gl->prev_depth] = *tex_info;
+   }
 
    /* Implement feedback by swapping out FBO/textures
     * for FBO pass #N and feedbacks. */
@@ -1275,6 +1603,101 @@ static void gl2_renderchain_bind_prev_texture(
    }
 }
 
+/* Rotates pixels read back from a pre-rotated surface
+ * into the logical orientation of the viewport. */
+static void gl2_unrotate_pixels(gl_t *gl,
+      uint8_t *dst, size_t dst_pitch,
+      const uint8_t *src, size_t src_pitch,
+      unsigned bpp)
+{
+   unsigned x, y;
+   unsigned width     = gl->vp.width;
+   unsigned height    = gl->vp.height;
+
+   for (y = 0; y < height; y++)
+   {
+      uint8_t *dst_row = dst + y * dst_pitch;
+
+      for (x = 0; x < width; x++)
+      {
+         unsigned src_x, src_y;
+
+         switch (gl->surface_rotation)
+         {
+            case 90:
+               src_x = height - 1 - y;
+               src_y = x;
+               break;
+            case 180:
+               src_x = width  - 1 - x;
+               src_y = height - 1 - y;
+               break;
+            case 270:
+            default:
+               src_x = y;
+               src_y = width - 1 - x;
+               break;
+         }
+
+         memcpy(dst_row + x * bpp,
+               src + src_y * src_pitch + src_x * bpp, bpp);
+      }
+   }
+}
+
+#ifdef HAVE_GL_ASYNC_READBACK
+/* Maps the oldest buffer of the readback ring, left bound until
+ * it's unmapped. NULL if we haven't buffered up enough frames yet,
+ * or are in menu mode, come back later. */
+static const uint8_t *gl2_pbo_readback_map(gl_t *gl, size_t size)
+{
+   const uint8_t *ptr = NULL;
+
+   if (!gl->pbo_readback_valid[gl->pbo_readback_index])
+      return NULL;
+
+   gl->pbo_readback_valid[gl->pbo_readback_index] = false;
+
+#ifdef HAVE_GL_SYNC
+   if (gl->have_sync)
+   {
+      gl2_renderchain_data_t *chain = (gl2_renderchain_data_t*)
+         gl->renderchain_data;
+      GLsync fence = chain->readback_fences[gl->pbo_readback_index];
+
+      /* The readback was issued frames ago, so this
+       * normally returns right away. Mapping the buffer
+       * would wait for it just the same otherwise. */
+      if (fence)
+      {
+         glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+         glDeleteSync(fence);
+         chain->readback_fences[gl->pbo_readback_index] = NULL;
+      }
+   }
+#endif
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER,
+         gl->pbo_readback[gl->pbo_readback_index]);
+
+#ifdef HAVE_OPENGLES3
+   ptr = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+         0, size, GL_MAP_READ_BIT);
+#else
+   ptr = (const uint8_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER,
+         GL_READ_ONLY);
+#endif
+
+   if (!ptr)
+   {
+      RARCH_ERR("[GL]: Failed to map pixel unpack buffer.\n");
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+   }
+
+   return ptr;
+}
+#endif
+
 static bool gl2_renderchain_read_viewport(
       gl_t *gl,
       uint8_t *buffer, bool is_idle)
@@ -1288,50 +1711,53 @@ static bool gl2_renderchain_read_viewport(
 #ifdef HAVE_GL_ASYNC_READBACK
    if (gl->pbo_readback_enable)
    {
-      const uint8_t *ptr  = NULL;
+      const uint8_t *ptr  = gl2_pbo_readback_map(gl,
+            num_pixels * sizeof(uint32_t));
 
-      /* Don't readback if we're in menu mode.
-       * We haven't buffered up enough frames yet, come back later. */
-      if (!gl->pbo_readback_valid[gl->pbo_readback_index])
+      if (!ptr)
          goto error;
 
-      gl->pbo_readback_valid[gl->pbo_readback_index] = false;
-      glBindBuffer(GL_PIXEL_PACK_BUFFER,
-            gl->pbo_readback[gl->pbo_readback_index]);
-
-#ifdef HAVE_OPENGLES3
-      /* Slower path, but should work on all implementations at least. */
-      ptr        = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
-            0, num_pixels * sizeof(uint32_t), GL_MAP_READ_BIT);
-
-      if (ptr)
+      /* Pre-rotated surfaces are read back as they are,
+       * rotate the frame back while it's mapped. */
+      if (gl->surface_rotation)
       {
-         unsigned y;
-         for (y = 0; y < gl->vp.height; y++)
+         uint8_t *tmp = (uint8_t*)malloc(num_pixels * sizeof(uint32_t));
+
+         if (tmp)
          {
-            video_frame_convert_rgba_to_bgr(
-                  (const void*)ptr,
-                  buffer,
-                  gl->vp.width);
+            unsigned src_width = (gl->surface_rotation == 180)
+               ? gl->vp.width : gl->vp.height;
+
+            gl2_unrotate_pixels(gl, tmp,
+                  gl->vp.width * sizeof(uint32_t),
+                  ptr, src_width * sizeof(uint32_t), sizeof(uint32_t));
          }
+
+         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+         ptr = tmp;
       }
-#else
-      ptr = (const uint8_t*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
       if (ptr)
       {
+#ifdef HAVE_OPENGLES3
+         video_frame_convert_rgba_to_bgr(
+               (const void*)ptr,
+               buffer,
+               num_pixels);
+#else
          struct scaler_ctx *ctx = &gl->pbo_readback_scaler;
          scaler_ctx_scale_direct(ctx, buffer, ptr);
-      }
 #endif
-
-      if (!ptr)
-      {
-         RARCH_ERR("[GL]: Failed to map pixel unpack buffer.\n");
-         goto error;
       }
 
-      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      if (gl->surface_rotation)
+         free((void*)ptr);
+      else
+         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
       glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+      if (!ptr)
+         goto error;
    }
    else
 #endif
@@ -1388,63 +1814,304 @@ error:
    glDisable(GL_DITHER)
 #endif
 
-static void gl2_renderchain_copy_frame(
-      gl_t *gl,
+#ifdef HAVE_GL_UPLOAD_PBO
+static void gl2_renderchain_upload_pbo_free(gl2_renderchain_data_t *chain)
+{
+   unsigned i;
+
+   if (!chain->upload_size)
+      return;
+
+   for (i = 0; i < UPLOAD_PBO_COUNT; i++)
+   {
+      if (chain->upload_fences[i])
+         glDeleteSync(chain->upload_fences[i]);
+      chain->upload_fences[i] = NULL;
+   }
+
+   glDeleteBuffers(UPLOAD_PBO_COUNT, chain->upload_buffers);
+   memset(chain->upload_buffers, 0, sizeof(chain->upload_buffers));
+   chain->upload_size  = 0;
+   chain->upload_index = 0;
+}
+
+static bool gl2_renderchain_upload_pbo(gl_t *gl,
       gl2_renderchain_data_t *chain,
-      video_frame_info_t *video_info,
       const void *frame,
       unsigned width, unsigned height, unsigned pitch)
 {
-#if defined(HAVE_PSGL)
+   unsigned h;
+   uint8_t *dst;
+   const uint8_t *src        = (const uint8_t*)frame;
+   unsigned index            = chain->upload_index;
+   const unsigned line_bytes = width * gl->base_size;
+   size_t size               = line_bytes * height;
+
+   if (!chain->upload_size)
    {
-      unsigned h;
-      size_t buffer_addr        = gl->tex_w * gl->tex_h *
-         gl->tex_index * gl->base_size;
-      size_t buffer_stride      = gl->tex_w * gl->base_size;
-      const uint8_t *frame_copy = frame;
-      size_t frame_copy_size    = width * gl->base_size;
-      uint8_t           *buffer = (uint8_t*)glMapBuffer(
-            GL_TEXTURE_REFERENCE_BUFFER_SCE, GL_READ_WRITE) + buffer_addr;
-      for (h = 0; h < height; h++, buffer += buffer_stride, frame_copy += pitch)
-         memcpy(buffer, frame_copy, frame_copy_size);
+      unsigned i;
+      chain->upload_size = gl->tex_w * gl->tex_h * sizeof(uint32_t);
 
-      glUnmapBuffer(GL_TEXTURE_REFERENCE_BUFFER_SCE);
+      glGenBuffers(UPLOAD_PBO_COUNT, chain->upload_buffers);
+      for (i = 0; i < UPLOAD_PBO_COUNT; i++)
+      {
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, chain->upload_buffers[i]);
+         glBufferData(GL_PIXEL_UNPACK_BUFFER,
+               chain->upload_size, NULL, GL_STREAM_DRAW);
+      }
    }
-#elif defined(HAVE_OPENGLES)
-#if defined(HAVE_EGL)
-   if (chain->egl_images)
-   {
-      gfx_ctx_image_t img_info;
-      bool new_egl    = false;
-      EGLImageKHR img = 0;
 
-      img_info.frame  = frame;
-      img_info.width  = width;
-      img_info.height = height;
-      img_info.pitch  = pitch;
-      img_info.index  = gl->tex_index;
-      img_info.rgb32  = (gl->base_size == 4);
-      img_info.handle = &img;
+   if (size > chain->upload_size)
+      return false;
 
-      new_egl         =
-         video_context_driver_write_to_image_buffer(&img_info);
+   /* The buffer is mapped unsynchronized, so make sure
+    * the upload issued from it last time around is done. */
+   if (chain->upload_fences[index])
+   {
+      glClientWaitSync(chain->upload_fences[index],
+            GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      glDeleteSync(chain->upload_fences[index]);
+      chain->upload_fences[index] = NULL;
+   }
 
-      if (img == EGL_NO_IMAGE_KHR)
-      {
-         RARCH_ERR("[GL]: Failed to create EGL image.\n");
-         return;
-      }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, chain->upload_buffers[index]);
 
-      if (new_egl)
-         glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, (GLeglImageOES)img);
+   dst = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+         | GL_MAP_UNSYNCHRONIZED_BIT);
+
+   if (!dst)
+   {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return false;
    }
+
+   /* Pack the rows while copying, which also takes care
+    * of the missing GL_UNPACK_ROW_LENGTH on GLES2 drivers. */
+   if (pitch == line_bytes)
+      memcpy(dst, src, size);
    else
-#endif
-   {
-      glPixelStorei(GL_UNPACK_ALIGNMENT,
-            video_pixel_get_alignment(width * gl->base_size));
+      for (h = 0; h < height; h++, src += pitch, dst += line_bytes)
+         memcpy(dst, src, line_bytes);
 
-      /* Fallback for GLES devices without GL_BGRA_EXT. */
+   glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+   glTexSubImage2D(GL_TEXTURE_2D,
+         0, 0, 0, width, height, gl->texture_type,
+         gl->texture_fmt, NULL);
+
+   chain->upload_fences[index] =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   chain->upload_index = (index + 1) % UPLOAD_PBO_COUNT;
+   return true;
+}
+#endif
+
+#if defined(HAVE_OPENGLES) && !defined(HAVE_PSGL)
+typedef struct gl2_dirty_rect
+{
+   unsigned x, y, width, height;
+} gl2_dirty_rect_t;
+
+/* Compares the frame with the previous one, which the
+ * frontend keeps a packed copy of and the texture holds.
+ * Returns the amount of rects that changed, or -1 if the
+ * whole frame has to be uploaded. */
+static int gl2_renderchain_dirty_rects(gl_t *gl,
+      gl2_renderchain_data_t *chain,
+      const void *frame, unsigned width, unsigned height, unsigned pitch,
+      gl2_dirty_rect_t *rects)
+{
+   unsigned y, band;
+   int count                 = 0;
+   bool full                 = false;
+   size_t dirty_pixels       = 0;
+   const uint8_t *src        = (const uint8_t*)frame;
+   const unsigned row        = width * gl->base_size;
+   const unsigned blocks     = (row + DIRTY_BLOCK_BYTES - 1) / DIRTY_BLOCK_BYTES;
+   const uint8_t *dst        = (const uint8_t*)
+      video_driver_get_prev_frame(width, height, &chain->dirty_serial);
+
+   if (!dst)
+      return -1;
+
+   for (band = 0; band < height; band += DIRTY_BAND_ROWS)
+   {
+      unsigned first_block = blocks;
+      unsigned last_block  = 0;
+      unsigned band_end    = MIN(band + DIRTY_BAND_ROWS, height);
+
+      for (y = band; y < band_end; y++, src += pitch, dst += row)
+      {
+         unsigned b;
+
+         if (!memcmp(dst, src, row))
+            continue;
+
+         if (!full)
+         {
+            /* Only blocks outside of what is already
+             * known to be dirty have to be looked at. */
+            for (b = 0; b < first_block; b++)
+               if (memcmp(dst + b * DIRTY_BLOCK_BYTES,
+                        src + b * DIRTY_BLOCK_BYTES,
+                        MIN(DIRTY_BLOCK_BYTES, row - b * DIRTY_BLOCK_BYTES)))
+                  break;
+            first_block = b;
+
+            for (b = blocks; b > last_block && b > first_block; b--)
+               if (memcmp(dst + (b - 1) * DIRTY_BLOCK_BYTES,
+                        src + (b - 1) * DIRTY_BLOCK_BYTES,
+                        MIN(DIRTY_BLOCK_BYTES, row - (b - 1) * DIRTY_BLOCK_BYTES)))
+                  break;
+            last_block = MAX(last_block, b);
+         }
+      }
+
+      if (full || first_block >= last_block)
+         continue;
+
+      {
+         unsigned x0 = first_block * DIRTY_BLOCK_BYTES / gl->base_size;
+         unsigned x1 = MIN(width,
+               last_block * DIRTY_BLOCK_BYTES / gl->base_size);
+         gl2_dirty_rect_t *prev = count ? &rects[count - 1] : NULL;
+
+         /* Grow the rect of the band right above instead
+          * of starting a new one. */
+         if (prev && prev->y + prev->height == band)
+         {
+            unsigned px1    = prev->x + prev->width;
+            dirty_pixels   -= prev->width * prev->height;
+            prev->x         = MIN(prev->x, x0);
+            prev->width     = MAX(px1, x1) - prev->x;
+            prev->height    = band_end - prev->y;
+            dirty_pixels   += prev->width * prev->height;
+         }
+         else if (count < DIRTY_MAX_RECTS)
+         {
+            rects[count].x      = x0;
+            rects[count].y      = band;
+            rects[count].width  = x1 - x0;
+            rects[count].height = band_end - band;
+            dirty_pixels       += rects[count].width * rects[count].height;
+            count++;
+         }
+         else
+            full = true;
+      }
+   }
+
+   if (full || dirty_pixels * 100 > (size_t)width * height * DIRTY_FULL_PERCENT)
+      return -1;
+
+   return count;
+}
+#endif
+
+static void gl2_renderchain_copy_frame(
+      gl_t *gl,
+      gl2_renderchain_data_t *chain,
+      video_frame_info_t *video_info,
+      const void *frame,
+      unsigned width, unsigned height, unsigned pitch)
+{
+#if defined(HAVE_PSGL)
+   {
+      unsigned h;
+      size_t buffer_addr        = gl->tex_w * gl->tex_h *
+         gl->tex_index * gl->base_size;
+      size_t buffer_stride      = gl->tex_w * gl->base_size;
+      const uint8_t *frame_copy = frame;
+      size_t frame_copy_size    = width * gl->base_size;
+      uint8_t           *buffer = (uint8_t*)glMapBuffer(
+            GL_TEXTURE_REFERENCE_BUFFER_SCE, GL_READ_WRITE) + buffer_addr;
+      for (h = 0; h < height; h++, buffer += buffer_stride, frame_copy += pitch)
+         memcpy(buffer, frame_copy, frame_copy_size);
+
+      glUnmapBuffer(GL_TEXTURE_REFERENCE_BUFFER_SCE);
+   }
+#elif defined(HAVE_OPENGLES)
+#if defined(HAVE_EGL)
+   if (chain->egl_images)
+   {
+      gfx_ctx_image_t img_info;
+      bool new_egl    = false;
+      EGLImageKHR img = 0;
+
+      img_info.frame  = frame;
+      img_info.width  = width;
+      img_info.height = height;
+      img_info.pitch  = pitch;
+      img_info.index  = gl->tex_index;
+      img_info.rgb32  = (gl->base_size == 4);
+      img_info.handle = &img;
+
+      new_egl         =
+         video_context_driver_write_to_image_buffer(&img_info);
+
+      if (img == EGL_NO_IMAGE_KHR)
+      {
+         RARCH_ERR("[GL]: Failed to create EGL image.\n");
+         return;
+      }
+
+      if (new_egl)
+         glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, (GLeglImageOES)img);
+   }
+   else
+#endif
+   {
+      /* Partial uploads need the texture to still hold the
+       * previous frame, so not while cycling through several. */
+      bool dirty_rects = gl->textures == 1
+         && gl->support_unpack_row_length
+         && !(gl->base_size == 4 && video_info->use_rgba);
+
+      if (dirty_rects)
+      {
+         gl2_dirty_rect_t rects[DIRTY_MAX_RECTS];
+         int count = gl2_renderchain_dirty_rects(gl, chain,
+               frame, width, height, pitch, rects);
+
+         if (count >= 0)
+         {
+            int i;
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT,
+                  video_pixel_get_alignment(pitch));
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / gl->base_size);
+
+            for (i = 0; i < count; i++)
+               glTexSubImage2D(GL_TEXTURE_2D,
+                     0, rects[i].x, rects[i].y,
+                     rects[i].width, rects[i].height,
+                     gl->texture_type, gl->texture_fmt,
+                     (const uint8_t*)frame + rects[i].y * pitch
+                     + rects[i].x * gl->base_size);
+
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            return;
+         }
+      }
+      else
+         chain->dirty_serial = 0;
+
+      glPixelStorei(GL_UNPACK_ALIGNMENT,
+            video_pixel_get_alignment(width * gl->base_size));
+
+#ifdef HAVE_GL_UPLOAD_PBO
+      if (     chain->upload_pbo
+            && !(gl->base_size == 4 && video_info->use_rgba)
+            && gl2_renderchain_upload_pbo(gl, chain,
+               frame, width, height, pitch))
+         return;
+#endif
+
+      /* Fallback for GLES devices without GL_BGRA_EXT. */
       if (gl->base_size == 4 && video_info->use_rgba)
       {
          video_frame_convert_argb8888_to_abgr8888(
@@ -1476,13 +2143,10 @@ static void gl2_renderchain_copy_frame(
             /* Slow path - conv_buffer is preallocated
              * just in case we hit this path. */
 
-            unsigned h;
             const unsigned line_bytes = width * gl->base_size;
-            uint8_t *dst              = (uint8_t*)gl->conv_buffer;
-            const uint8_t *src        = (const uint8_t*)frame;
 
-            for (h = 0; h < height; h++, src += pitch, dst += line_bytes)
-               memcpy(dst, src, line_bytes);
+            copy_rows(gl->conv_buffer, line_bytes, frame, pitch,
+                  line_bytes, height);
 
             data_buf                  = gl->conv_buffer;
          }
@@ -1535,6 +2199,40 @@ static void gl2_renderchain_copy_frame(
 #define gl2_renderchain_init_pbo(size, data)
 #endif
 
+/* Reads back the viewport from a pre-rotated surface
+ * and rotates it back into logical orientation. */
+static void gl2_renderchain_readback_rotated(
+      gl_t *gl,
+      unsigned alignment,
+      unsigned fmt, unsigned type,
+      void *src)
+{
+   int vp_x           = gl->vp.x;
+   int vp_y           = gl->vp.y;
+   unsigned vp_width  = gl->vp.width;
+   unsigned vp_height = gl->vp.height;
+   unsigned bpp       = (fmt == GL_RGB) ? 3 : 4;
+   size_t dst_pitch   = (vp_width * bpp + alignment - 1) & ~(alignment - 1);
+   size_t src_pitch   = 0;
+   uint8_t *tmp       = NULL;
+
+   gl2_surface_rect(gl, &vp_x, &vp_y, &vp_width, &vp_height);
+
+   src_pitch          = (vp_width * bpp + alignment - 1) & ~(alignment - 1);
+   tmp                = (uint8_t*)malloc(src_pitch * vp_height);
+
+   if (!tmp)
+      return;
+
+   glReadPixels(vp_x, vp_y, vp_width, vp_height,
+         (GLenum)fmt, (GLenum)type, (GLvoid*)tmp);
+
+   gl2_unrotate_pixels(gl, (uint8_t*)src, dst_pitch,
+         tmp, src_pitch, bpp);
+
+   free(tmp);
+}
+
 static void gl2_renderchain_readback(
       gl_t *gl,
       void *chain_data,
@@ -1548,6 +2246,12 @@ static void gl2_renderchain_readback(
    glReadBuffer(GL_BACK);
 #endif
 
+   if (gl->surface_rotation)
+   {
+      gl2_renderchain_readback_rotated(gl, alignment, fmt, type, src);
+      return;
+   }
+
    glReadPixels(gl->vp.x, gl->vp.y,
          gl->vp.width, gl->vp.height,
          (GLenum)fmt, (GLenum)type, (GLvoid*)src);
@@ -1645,6 +2349,12 @@ static void gl2_renderchain_resolve_extensions(gl_t *gl,
       && gl_check_capability(GL_CAPS_EGLIMAGE) 
       && gl->ctx_driver->image_buffer_init
       && gl->ctx_driver->image_buffer_init(gl->ctx_data, video);
+
+#ifdef HAVE_GL_UPLOAD_PBO
+   chain->upload_pbo                = !gl->hw_render_use
+      && !chain->egl_images
+      && gl_check_capability(GL_CAPS_GLES3_SUPPORTED);
+#endif
 }
 
 static void gl_load_texture_data(
@@ -1794,17 +2504,40 @@ bool gl_load_luts(
 #ifdef HAVE_OVERLAY
 static void gl2_free_overlay(gl_t *gl)
 {
-   glDeleteTextures(gl->overlays, gl->overlay_tex);
+   unsigned i;
+
+   if (gl->overlay_atlas_id)
+      for (i = 0; i < gl->overlays; i++)
+         if (gl->overlay_atlas_id[i])
+            gl_atlas_remove(gl->atlas, gl->overlay_atlas_id[i]);
+
+   /* Zero for the images in the atlas, which GL ignores */
+   if (gl->overlay_tex)
+      glDeleteTextures(gl->overlays, gl->overlay_tex);
 
    free(gl->overlay_tex);
    free(gl->overlay_vertex_coord);
    free(gl->overlay_tex_coord);
    free(gl->overlay_color_coord);
-   gl->overlay_tex          = NULL;
-   gl->overlay_vertex_coord = NULL;
-   gl->overlay_tex_coord    = NULL;
-   gl->overlay_color_coord  = NULL;
-   gl->overlays             = 0;
+   free(gl->overlay_atlas_id);
+   free(gl->overlay_draw_vertex);
+   free(gl->overlay_draw_tex);
+   free(gl->overlay_draw_color);
+   free(gl->overlay_draw_run_tex);
+   free(gl->overlay_draw_run_vertices);
+   gl->overlay_tex               = NULL;
+   gl->overlay_vertex_coord      = NULL;
+   gl->overlay_tex_coord         = NULL;
+   gl->overlay_color_coord       = NULL;
+   gl->overlay_atlas_id          = NULL;
+   gl->overlay_draw_vertex       = NULL;
+   gl->overlay_draw_tex          = NULL;
+   gl->overlay_draw_color        = NULL;
+   gl->overlay_draw_run_tex      = NULL;
+   gl->overlay_draw_run_vertices = NULL;
+   gl->overlay_draw_vertices     = 0;
+   gl->overlay_draw_runs         = 0;
+   gl->overlays                  = 0;
 }
 
 static void gl2_overlay_vertex_geom(void *data,
@@ -1818,7 +2551,7 @@ static void gl2_overlay_vertex_geom(void *data,
    if (!gl)
       return;
 
-   if (image > gl->overlays)
+   if (image >= gl->overlays)
    {
       RARCH_ERR("[GL]: Invalid overlay id: %u\n", image);
       return;
@@ -1830,6 +2563,12 @@ static void gl2_overlay_vertex_geom(void *data,
    y               = 1.0f - y;
    h               = -h;
 
+   if (     vertex[0] == x     && vertex[1] == y
+         && vertex[6] == x + w && vertex[7] == y + h)
+      return;
+
+   gl->overlay_dirty = true;
+
    vertex[0]       = x;
    vertex[1]       = y;
    vertex[2]       = x + w;
@@ -1853,6 +2592,12 @@ static void gl2_overlay_tex_geom(void *data,
 
    tex          = (GLfloat*)&gl->overlay_tex_coord[image * 8];
 
+   if (     tex[0] == x     && tex[1] == y
+         && tex[6] == x + w && tex[7] == y + h)
+      return;
+
+   gl->overlay_dirty = true;
+
    tex[0]       = x;
    tex[1]       = y;
    tex[2]       = x + w;
@@ -1863,33 +2608,108 @@ static void gl2_overlay_tex_geom(void *data,
    tex[7]       = y + h;
 }
 
+/* Rebuilds the draw list: images faded out entirely are left
+ * out, those in the atlas get their region of the page. */
+static void gl2_overlay_build(gl_t *gl)
+{
+   /* A triangle strip as two triangles */
+   static const unsigned strip[6] = { 0, 1, 2, 2, 1, 3 };
+   unsigned i, j;
+   unsigned vertices = 0;
+   unsigned runs     = 0;
+
+   for (i = 0; i < gl->overlays; i++)
+   {
+      float rect[4];
+      GLuint tex                = gl->overlay_tex[i];
+      const GLfloat *vertex     = &gl->overlay_vertex_coord[i * 8];
+      const GLfloat *tex_coord  = &gl->overlay_tex_coord[i * 8];
+      const GLfloat *color      = &gl->overlay_color_coord[i * 16];
+
+      if (color[3] <= 0.0f)
+         continue;
+
+      rect[0] = 0.0f;
+      rect[1] = 0.0f;
+      rect[2] = 1.0f;
+      rect[3] = 1.0f;
+
+      if (gl->overlay_atlas_id[i])
+      {
+         unsigned page;
+         if (!gl_atlas_resolve(gl->atlas, gl->overlay_atlas_id[i],
+                  &page, rect))
+            continue;
+         tex = page;
+      }
+
+      for (j = 0; j < 6; j++)
+      {
+         unsigned v = strip[j];
+         float *out_vertex = &gl->overlay_draw_vertex[(vertices + j) * 2];
+         float *out_tex    = &gl->overlay_draw_tex[(vertices + j) * 2];
+
+         out_vertex[0] = vertex[v * 2 + 0];
+         out_vertex[1] = vertex[v * 2 + 1];
+         out_tex[0]    = rect[0] + tex_coord[v * 2 + 0] * rect[2];
+         out_tex[1]    = rect[1] + tex_coord[v * 2 + 1] * rect[3];
+         memcpy(&gl->overlay_draw_color[(vertices + j) * 4],
+               &color[v * 4], 4 * sizeof(float));
+      }
+
+      vertices += 6;
+
+      if (runs && gl->overlay_draw_run_tex[runs - 1] == tex)
+         gl->overlay_draw_run_vertices[runs - 1] += 6;
+      else
+      {
+         gl->overlay_draw_run_tex[runs]      = tex;
+         gl->overlay_draw_run_vertices[runs] = 6;
+         runs++;
+      }
+   }
+
+   gl->overlay_draw_vertices = vertices;
+   gl->overlay_draw_runs     = runs;
+   gl->overlay_dirty         = false;
+}
+
 static void gl2_render_overlay(gl_t *gl, video_frame_info_t *video_info)
 {
    unsigned i;
+   unsigned first                      = 0;
    unsigned width                      = video_info->width;
    unsigned height                     = video_info->height;
 
+   if (gl->overlay_dirty)
+      gl2_overlay_build(gl);
+
+   if (!gl->overlay_draw_vertices)
+      return;
+
    glEnable(GL_BLEND);
+   gl2_blend_func_alpha(gl);
 
    if (gl->overlay_full_screen)
-      glViewport(0, 0, width, height);
+      gl2_viewport(gl, 0, 0, width, height);
 
    /* Ensure that we reset the attrib array. */
    gl->shader->use(gl, gl->shader_data,
          VIDEO_SHADER_STOCK_BLEND, true);
 
-   gl->coords.vertex    = gl->overlay_vertex_coord;
-   gl->coords.tex_coord = gl->overlay_tex_coord;
-   gl->coords.color     = gl->overlay_color_coord;
-   gl->coords.vertices  = 4 * gl->overlays;
+   gl->coords.vertex    = gl->overlay_draw_vertex;
+   gl->coords.tex_coord = gl->overlay_draw_tex;
+   gl->coords.color     = gl->overlay_draw_color;
+   gl->coords.vertices  = gl->overlay_draw_vertices;
 
    gl->shader->set_coords(gl->shader_data, &gl->coords);
    gl->shader->set_mvp(gl->shader_data, &gl->mvp_no_rot);
 
-   for (i = 0; i < gl->overlays; i++)
+   for (i = 0; i < gl->overlay_draw_runs; i++)
    {
-      glBindTexture(GL_TEXTURE_2D, gl->overlay_tex[i]);
-      glDrawArrays(GL_TRIANGLE_STRIP, 4 * i, 4);
+      glBindTexture(GL_TEXTURE_2D, gl->overlay_draw_run_tex[i]);
+      glDrawArrays(GL_TRIANGLES, first, gl->overlay_draw_run_vertices[i]);
+      first += gl->overlay_draw_run_vertices[i];
    }
 
    glDisable(GL_BLEND);
@@ -1898,7 +2718,7 @@ static void gl2_render_overlay(gl_t *gl, video_frame_info_t *video_info)
    gl->coords.color     = gl->white_color_ptr;
    gl->coords.vertices  = 4;
    if (gl->overlay_full_screen)
-      glViewport(gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+      gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
 }
 #endif
 
@@ -2171,7 +2991,9 @@ static void gl2_init_textures_data(gl_t *gl)
       gl->last_height[i] = gl->tex_h;
    }
 
-   for (i = 0; i < gl->textures; i++)
+   gl->prev_index = 0;
+
+   for (i = 0; i < 2 * GFX_MAX_TEXTURES; i++)
    {
       gl->prev_info[i].tex           = gl->texture[0];
       gl->prev_info[i].input_size[0] = gl->tex_w;
@@ -2223,6 +3045,12 @@ static void gl2_init_textures(gl_t *gl, const video_info_t *video)
 
    glGenTextures(gl->textures, gl->texture);
 
+#if defined(HAVE_OPENGLES) && !defined(HAVE_PSGL)
+   /* The new textures don't hold the last frame anymore. */
+   if (gl->renderchain_data)
+      ((gl2_renderchain_data_t*)gl->renderchain_data)->dirty_serial = 0;
+#endif
+
    for (i = 0; i < gl->textures; i++)
    {
       gl_bind_texture(gl->texture[i], gl->wrap_mode, gl->tex_mag_filter,
@@ -2365,7 +3193,7 @@ static void gl2_render_osd_background(
    gl->shader->set_coords(gl->shader_data, &coords);
 
    glEnable(GL_BLEND);
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   gl2_blend_func_alpha(gl);
    glBlendEquation(GL_FUNC_ADD);
 
    gl->shader->set_mvp(gl->shader_data, &gl->mvp_no_rot);
@@ -2467,9 +3295,9 @@ static INLINE void gl2_draw_texture(gl_t *gl, video_frame_info_t *video_info)
 
    if (gl->menu_texture_full_screen)
    {
-      glViewport(0, 0, width, height);
+      gl2_viewport(gl, 0, 0, width, height);
       glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-      glViewport(gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+      gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
    }
    else
       glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -2482,6 +3310,277 @@ static INLINE void gl2_draw_texture(gl_t *gl, video_frame_info_t *video_info)
 }
 #endif
 
+#ifdef HAVE_MENU_WIDGETS
+/* Size of the physical surface, which the layer covers as is */
+static void gl2_layer_size(const gl_t *gl,
+      unsigned *width, unsigned *height)
+{
+   *width  = gl->video_width;
+   *height = gl->video_height;
+
+   if (gl->surface_rotation == 90 || gl->surface_rotation == 270)
+   {
+      *width  = gl->video_height;
+      *height = gl->video_width;
+   }
+}
+
+void gl2_layer_free(gl_t *gl)
+{
+   if (gl->layer_fbo)
+      gl2_delete_fb(1, &gl->layer_fbo);
+   if (gl->layer_texture)
+      glDeleteTextures(1, &gl->layer_texture);
+
+   gl->layer_fbo     = 0;
+   gl->layer_texture = 0;
+   gl->layer_width   = 0;
+   gl->layer_height  = 0;
+}
+
+static bool gl2_layer_init(gl_t *gl, unsigned width, unsigned height)
+{
+   glGenTextures(1, &gl->layer_texture);
+   gl_bind_texture(gl->layer_texture, GL_CLAMP_TO_EDGE,
+         GL_NEAREST, GL_NEAREST);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   gl2_gen_fb(1, &gl->layer_fbo);
+   gl2_bind_fb(gl->layer_fbo);
+   gl2_fb_texture_2d(RARCH_GL_FRAMEBUFFER, RARCH_GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, gl->layer_texture, 0);
+
+   if (gl2_check_fb_status(RARCH_GL_FRAMEBUFFER) !=
+         RARCH_GL_FRAMEBUFFER_COMPLETE)
+   {
+      RARCH_WARN("[GL]: Unable to create FBO for the widgets layer.\n");
+      gl2_renderchain_bind_backbuffer();
+      gl2_layer_free(gl);
+      return false;
+   }
+
+   gl->layer_width  = width;
+   gl->layer_height = height;
+   return true;
+}
+
+/* Draws go to the layer until gl2_layer_end, with alpha blended
+ * so that the layer can be blended in premultiplied. */
+bool gl2_layer_begin(gl_t *gl)
+{
+   unsigned width, height;
+
+   /* Already drawing into it, see gl2_ui_layer_draw */
+   if (!gl->has_fbo || gl->layer_active)
+      return false;
+
+   gl_batch_flush(gl);
+   gl2_layer_size(gl, &width, &height);
+
+   if (gl->layer_width != width || gl->layer_height != height)
+   {
+      gl2_layer_free(gl);
+      if (!gl2_layer_init(gl, width, height))
+         return false;
+   }
+   else
+      gl2_bind_fb(gl->layer_fbo);
+
+   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+
+   gl->layer_active = true;
+   return true;
+}
+
+void gl2_layer_end(gl_t *gl)
+{
+   gl_batch_flush(gl);
+   gl2_renderchain_bind_backbuffer();
+   gl->layer_active = false;
+}
+
+bool gl2_layer_draw(gl_t *gl)
+{
+   math_matrix_4x4 mvp;
+
+   if (!gl->layer_fbo || gl->layer_active)
+      return false;
+
+   gl_batch_flush(gl);
+
+   matrix_4x4_ortho(mvp, 0, 1, 0, 1, -1, 1);
+
+   gl->coords.vertex    = vertexes;
+   gl->coords.tex_coord = tex_coords;
+   gl->coords.color     = white_color;
+   gl->coords.vertices  = 4;
+
+   glBindTexture(GL_TEXTURE_2D, gl->layer_texture);
+
+   gl->shader->use(gl, gl->shader_data, VIDEO_SHADER_STOCK_BLEND, true);
+   gl->shader->set_coords(gl->shader_data, &gl->coords);
+   gl->shader->set_mvp(gl->shader_data, &mvp);
+
+   glViewport(0, 0, gl->layer_width, gl->layer_height);
+
+   glEnable(GL_BLEND);
+   glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   glDisable(GL_BLEND);
+
+   gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+
+   gl->coords.vertex    = gl->vertex_ptr;
+   gl->coords.tex_coord = gl->tex_info.coord;
+   gl->coords.color     = gl->white_color_ptr;
+   return true;
+}
+#endif
+
+#ifdef HAVE_SHADERPIPELINE
+void gl2_pipeline_free(gl_t *gl)
+{
+   if (gl->pipeline_fbo)
+      gl2_delete_fb(1, &gl->pipeline_fbo);
+   if (gl->pipeline_texture)
+      glDeleteTextures(1, &gl->pipeline_texture);
+
+   gl->pipeline_fbo     = 0;
+   gl->pipeline_texture = 0;
+   gl->pipeline_width   = 0;
+   gl->pipeline_height  = 0;
+   gl->pipeline_id      = 0;
+}
+
+static bool gl2_pipeline_init(gl_t *gl, unsigned width, unsigned height)
+{
+   glGenTextures(1, &gl->pipeline_texture);
+   gl_bind_texture(gl->pipeline_texture, GL_CLAMP_TO_EDGE,
+         GL_LINEAR, GL_LINEAR);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   gl2_gen_fb(1, &gl->pipeline_fbo);
+   gl2_bind_fb(gl->pipeline_fbo);
+   gl2_fb_texture_2d(RARCH_GL_FRAMEBUFFER, RARCH_GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, gl->pipeline_texture, 0);
+
+   if (gl2_check_fb_status(RARCH_GL_FRAMEBUFFER) !=
+         RARCH_GL_FRAMEBUFFER_COMPLETE)
+   {
+      RARCH_WARN("[GL]: Unable to create FBO for the menu background.\n");
+      gl2_renderchain_bind_backbuffer();
+      gl2_pipeline_free(gl);
+      return false;
+   }
+
+   gl->pipeline_width  = width;
+   gl->pipeline_height = height;
+   return true;
+}
+
+/* Draws go to the menu background texture, of width x height,
+ * until gl2_pipeline_end */
+bool gl2_pipeline_begin(gl_t *gl, unsigned width, unsigned height)
+{
+   if (!gl->has_fbo)
+      return false;
+
+   gl_batch_flush(gl);
+
+   if (gl->pipeline_width != width || gl->pipeline_height != height)
+   {
+      gl2_pipeline_free(gl);
+      if (!gl2_pipeline_init(gl, width, height))
+         return false;
+   }
+   else
+      gl2_bind_fb(gl->pipeline_fbo);
+
+   glViewport(0, 0, width, height);
+   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+   return true;
+}
+
+void gl2_pipeline_end(gl_t *gl)
+{
+   gl2_renderchain_bind_backbuffer();
+}
+
+/* Scales the menu background up to the rectangle, with the
+ * blending set by the caller */
+void gl2_pipeline_draw(gl_t *gl, int x, int y,
+      unsigned width, unsigned height)
+{
+   math_matrix_4x4 mvp;
+
+   matrix_4x4_ortho(mvp, 0, 1, 0, 1, -1, 1);
+
+   gl->coords.vertex    = vertexes;
+   gl->coords.tex_coord = tex_coords;
+   gl->coords.color     = white_color;
+   gl->coords.vertices  = 4;
+
+   glBindTexture(GL_TEXTURE_2D, gl->pipeline_texture);
+
+   gl->shader->use(gl, gl->shader_data, VIDEO_SHADER_STOCK_BLEND, true);
+   gl->shader->set_coords(gl->shader_data, &gl->coords);
+   gl->shader->set_mvp(gl->shader_data, &mvp);
+
+   gl2_viewport(gl, x, y, width, height);
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+   gl->coords.vertex    = gl->vertex_ptr;
+   gl->coords.tex_coord = gl->tex_info.coord;
+   gl->coords.color     = gl->white_color_ptr;
+}
+#endif
+
+/* Reads the rectangle of the bound framebuffer
+ * into the next buffer of the readback ring. */
+static void gl2_pbo_async_readback_rect(gl_t *gl,
+      int x, int y, unsigned width, unsigned height,
+      GLenum fmt, GLenum type)
+{
+#if defined(HAVE_GL_ASYNC_READBACK) && defined(HAVE_GL_SYNC)
+   gl2_renderchain_data_t *chain = (gl2_renderchain_data_t*)
+      gl->renderchain_data;
+   unsigned index     = gl->pbo_readback_index;
+#endif
+
+   gl2_renderchain_bind_pbo(
+         gl->pbo_readback[gl->pbo_readback_index++]);
+   gl->pbo_readback_index &= 3;
+
+   /* 4 frames back, we can readback. */
+   gl->pbo_readback_valid[gl->pbo_readback_index] = true;
+
+   glPixelStorei(GL_PACK_ALIGNMENT,
+         video_pixel_get_alignment(width * sizeof(uint32_t)));
+#ifndef HAVE_OPENGLES
+   glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+#endif
+   glReadPixels(x, y, width, height, fmt, type, NULL);
+
+#if defined(HAVE_GL_ASYNC_READBACK) && defined(HAVE_GL_SYNC)
+   if (gl->have_sync)
+   {
+      if (chain->readback_fences[index])
+         glDeleteSync(chain->readback_fences[index]);
+      chain->readback_fences[index] =
+         glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   }
+#endif
+
+   gl2_renderchain_unbind_pbo();
+}
+
 static void gl2_pbo_async_readback(gl_t *gl)
 {
 #ifdef HAVE_OPENGLES
@@ -2492,19 +3591,233 @@ static void gl2_pbo_async_readback(gl_t *gl)
    GLenum type = GL_UNSIGNED_INT_8_8_8_8_REV;
 #endif
 
-   gl2_renderchain_bind_pbo(
-         gl->pbo_readback[gl->pbo_readback_index++]);
-   gl->pbo_readback_index &= 3;
+   int vp_x           = gl->vp.x;
+   int vp_y           = gl->vp.y;
+   unsigned vp_width  = gl->vp.width;
+   unsigned vp_height = gl->vp.height;
 
-   /* 4 frames back, we can readback. */
-   gl->pbo_readback_valid[gl->pbo_readback_index] = true;
+   /* The surface is read back as it is, since the pixels
+    * land in the buffer. gl2_renderchain_read_viewport()
+    * undoes any pre-rotation once they are mapped. */
+   gl2_surface_rect(gl, &vp_x, &vp_y, &vp_width, &vp_height);
 
-   gl2_renderchain_readback(gl, gl->renderchain_data,
-         video_pixel_get_alignment(gl->vp.width * sizeof(uint32_t)),
-         fmt, type, NULL);
-   gl2_renderchain_unbind_pbo();
+#ifndef HAVE_OPENGLES
+   glReadBuffer(GL_BACK);
+#endif
+   gl2_pbo_async_readback_rect(gl, vp_x, vp_y, vp_width, vp_height,
+         fmt, type);
+}
+
+#ifdef HAVE_GL_ASYNC_READBACK
+static void gl2_record_nv12_free(gl_t *gl)
+{
+   if (gl->record_fbo)
+      gl2_delete_fb(1, &gl->record_fbo);
+   if (gl->record_fbo_texture)
+      glDeleteTextures(1, &gl->record_fbo_texture);
+   if (gl->record_texture)
+      glDeleteTextures(1, &gl->record_texture);
+
+   gl->record_fbo         = 0;
+   gl->record_fbo_texture = 0;
+   gl->record_texture     = 0;
+   gl->record_width       = 0;
+   gl->record_height      = 0;
+}
+
+static bool gl2_record_nv12_init(gl_t *gl, unsigned width, unsigned height)
+{
+   uint32_t flags     = 0;
+   int vp_x           = gl->vp.x;
+   int vp_y           = gl->vp.y;
+   unsigned vp_width  = gl->vp.width;
+   unsigned vp_height = gl->vp.height;
+
+   /* Packed four bytes to a pixel, read back through the ring
+    * of PBOs sized for the viewport */
+   if (     !gl->pbo_readback_enable
+         || !gl->has_fbo
+         || gl->core_context_in_use
+         || !gl->shader
+         || !gl->shader->get_flags
+         || width  % 4 || height % 2
+         || width  > gl->vp.width
+         || height > gl->vp.height)
+      return false;
+
+   gl->shader->get_flags(&flags);
+   if (!BIT32_GET(flags, GFX_CTX_FLAGS_RECORD_NV12))
+      return false;
+
+   gl2_surface_rect(gl, &vp_x, &vp_y, &vp_width, &vp_height);
+
+   /* Copy of the surface, filtered as it's scaled down */
+   glGenTextures(1, &gl->record_texture);
+   gl_bind_texture(gl->record_texture, GL_CLAMP_TO_EDGE,
+         GL_LINEAR, GL_LINEAR);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, vp_width, vp_height, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+   glGenTextures(1, &gl->record_fbo_texture);
+   gl_bind_texture(gl->record_fbo_texture, GL_CLAMP_TO_EDGE,
+         GL_NEAREST, GL_NEAREST);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width / 4, height * 3 / 2, 0,
+         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   gl2_gen_fb(1, &gl->record_fbo);
+   gl2_bind_fb(gl->record_fbo);
+   gl2_fb_texture_2d(RARCH_GL_FRAMEBUFFER, RARCH_GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, gl->record_fbo_texture, 0);
+
+   if (gl2_check_fb_status(RARCH_GL_FRAMEBUFFER) !=
+         RARCH_GL_FRAMEBUFFER_COMPLETE)
+   {
+      RARCH_WARN("[GL]: Unable to create FBO for NV12 recording.\n");
+      gl2_renderchain_bind_backbuffer();
+      gl2_record_nv12_free(gl);
+      return false;
+   }
+
+   gl2_renderchain_bind_backbuffer();
+
+   gl->record_width      = width;
+   gl->record_height     = height;
+   gl->record_src_width  = vp_width;
+   gl->record_src_height = vp_height;
+   return true;
+}
+
+/* Where the corners of the image, top down, are in the copy of the
+ * surface, and the step of one pixel to the right in it. */
+static void gl2_record_nv12_coords(const gl_t *gl,
+      GLfloat *tex_coord, GLfloat *step)
+{
+   unsigned i;
+   GLfloat du = 1.0f / gl->record_width;
+
+   for (i = 0; i < 4; i++)
+   {
+      GLfloat u = vertexes[i * 2 + 0];
+      GLfloat v = 1.0f - vertexes[i * 2 + 1];
+
+      switch (gl->surface_rotation)
+      {
+         case 90:
+            tex_coord[i * 2 + 0] = 1.0f - v;
+            tex_coord[i * 2 + 1] = u;
+            break;
+         case 180:
+            tex_coord[i * 2 + 0] = 1.0f - u;
+            tex_coord[i * 2 + 1] = 1.0f - v;
+            break;
+         case 270:
+            tex_coord[i * 2 + 0] = v;
+            tex_coord[i * 2 + 1] = 1.0f - u;
+            break;
+         default:
+            tex_coord[i * 2 + 0] = u;
+            tex_coord[i * 2 + 1] = v;
+            break;
+      }
+   }
+
+   step[0] = step[1] = 0.0f;
+   switch (gl->surface_rotation)
+   {
+      case 90:
+         step[1] = du;
+         break;
+      case 180:
+         step[0] = -du;
+         break;
+      case 270:
+         step[1] = -du;
+         break;
+      default:
+         step[0] = du;
+         break;
+   }
 }
 
+/* Scales and converts the surface to NV12 in record_fbo, luma in
+ * the bottom two thirds, so that it's read back top down. */
+static void gl2_record_nv12_readback(gl_t *gl)
+{
+   unsigned i;
+   math_matrix_4x4 mvp;
+   GLfloat tex_coord[8];
+   GLfloat step[2];
+   GLfloat vertex[2][8];
+   GLfloat color[2][16];
+   int vp_x           = gl->vp.x;
+   int vp_y           = gl->vp.y;
+   unsigned vp_width  = gl->vp.width;
+   unsigned vp_height = gl->vp.height;
+   unsigned width     = gl->record_width  / 4;
+   unsigned height    = gl->record_height * 3 / 2;
+
+   gl_batch_flush(gl);
+
+   gl2_surface_rect(gl, &vp_x, &vp_y, &vp_width, &vp_height);
+
+   glBindTexture(GL_TEXTURE_2D, gl->record_texture);
+   glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, vp_x, vp_y,
+         MIN(vp_width,  gl->record_src_width),
+         MIN(vp_height, gl->record_src_height));
+
+   gl2_record_nv12_coords(gl, tex_coord, step);
+
+   for (i = 0; i < 2; i++)
+   {
+      unsigned j;
+      GLfloat bottom = i ? 2.0f / 3.0f : 0.0f;
+      GLfloat top    = i ? 1.0f        : 2.0f / 3.0f;
+
+      for (j = 0; j < 4; j++)
+      {
+         vertex[i][j * 2 + 0] = vertexes[j * 2 + 0];
+         vertex[i][j * 2 + 1] = vertexes[j * 2 + 1] ? top : bottom;
+
+         color[i][j * 4 + 0]  = step[0];
+         color[i][j * 4 + 1]  = step[1];
+         color[i][j * 4 + 2]  = 0.0f;
+         color[i][j * 4 + 3]  = i ? 0.0f : 1.0f;
+      }
+   }
+
+   gl2_bind_fb(gl->record_fbo);
+   glViewport(0, 0, width, height);
+   glDisable(GL_BLEND);
+
+   matrix_4x4_ortho(mvp, 0, 1, 0, 1, -1, 1);
+
+   gl->shader->use(gl, gl->shader_data, VIDEO_SHADER_RECORD_NV12, true);
+   gl->shader->set_mvp(gl->shader_data, &mvp);
+
+   gl->coords.tex_coord = tex_coord;
+   gl->coords.vertices  = 4;
+
+   for (i = 0; i < 2; i++)
+   {
+      gl->coords.vertex = vertex[i];
+      gl->coords.color  = color[i];
+      gl->shader->set_coords(gl->shader_data, &gl->coords);
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   }
+
+   gl2_pbo_async_readback_rect(gl, 0, 0, width, height,
+         GL_RGBA, GL_UNSIGNED_BYTE);
+
+   gl2_renderchain_bind_backbuffer();
+   gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+
+   gl->coords.vertex    = gl->vertex_ptr;
+   gl->coords.tex_coord = gl->tex_info.coord;
+   gl->coords.color     = gl->white_color_ptr;
+}
+#endif
+
 #ifdef HAVE_VIDEO_LAYOUT
 
 static float video_layout_layer_tex_coord[] = {
@@ -2514,19 +3827,20 @@ static float video_layout_layer_tex_coord[] = {
    1.0f, 0.0f,
 };
 
-static void gl2_video_layout_fbo_init(gl_t *gl, unsigned width, unsigned height)
+static void gl2_video_layout_fbo_init(gl_t *gl, int index,
+      unsigned width, unsigned height)
 {
-   glGenTextures(1, &gl->video_layout_fbo_texture);
-   glBindTexture(GL_TEXTURE_2D, gl->video_layout_fbo_texture);
+   glGenTextures(1, &gl->video_layout_fbo_texture[index]);
+   glBindTexture(GL_TEXTURE_2D, gl->video_layout_fbo_texture[index]);
 
    gl2_load_texture_image(GL_TEXTURE_2D, 0, RARCH_GL_INTERNAL_FORMAT32,
       width, height, 0, GL_RGBA, GL_FLOAT, NULL);
 
-   gl2_gen_fb(1, &gl->video_layout_fbo);
-   gl2_bind_fb(gl->video_layout_fbo);
+   gl2_gen_fb(1, &gl->video_layout_fbo[index]);
+   gl2_bind_fb(gl->video_layout_fbo[index]);
 
    gl2_fb_texture_2d(RARCH_GL_FRAMEBUFFER, RARCH_GL_COLOR_ATTACHMENT0,
-      GL_TEXTURE_2D, gl->video_layout_fbo_texture, 0);
+      GL_TEXTURE_2D, gl->video_layout_fbo_texture[index], 0);
 
    if (gl2_check_fb_status(RARCH_GL_FRAMEBUFFER) != 
          RARCH_GL_FRAMEBUFFER_COMPLETE)
@@ -2537,16 +3851,21 @@ static void gl2_video_layout_fbo_init(gl_t *gl, unsigned width, unsigned height)
 
 static void gl2_video_layout_fbo_free(gl_t *gl)
 {
-   if (gl->video_layout_fbo)
-   {
-      gl2_delete_fb(1, &gl->video_layout_fbo);
-      gl->video_layout_fbo = 0;
-   }
+   int i;
 
-   if (gl->video_layout_fbo_texture)
+   for (i = 0; i < VIDEO_LAYOUT_MAX_LAYERS; ++i)
    {
-      glDeleteTextures(1, &gl->video_layout_fbo_texture);
-      gl->video_layout_fbo_texture = 0;
+      if (gl->video_layout_fbo[i])
+      {
+         gl2_delete_fb(1, &gl->video_layout_fbo[i]);
+         gl->video_layout_fbo[i] = 0;
+      }
+
+      if (gl->video_layout_fbo_texture[i])
+      {
+         glDeleteTextures(1, &gl->video_layout_fbo_texture[i]);
+         gl->video_layout_fbo_texture[i] = 0;
+      }
    }
 }
 
@@ -2557,10 +3876,8 @@ static void gl2_video_layout_viewport(gl_t *gl, video_frame_info_t *video_info)
 
    if (gl->video_layout_resize)
    {
-      if (gl->video_layout_fbo)
-         gl2_video_layout_fbo_free(gl);
-
-      gl2_video_layout_fbo_init(gl, video_info->width, video_info->height);
+      /* Created again at the new size as layers are drawn */
+      gl2_video_layout_fbo_free(gl);
 
       video_layout_view_change();
 
@@ -2596,7 +3913,7 @@ static void gl2_video_layout_render(gl_t *gl, video_frame_info_t *video_info)
    if (!video_layout_valid())
       return;
 
-   glViewport(0, 0, video_info->width, video_info->height);
+   gl2_viewport(gl, 0, 0, video_info->width, video_info->height);
    glEnable(GL_BLEND);
 
    for (i = 0; i < video_layout_layer_count(); ++i)
@@ -2657,20 +3974,36 @@ static void gl2_video_layout_free_image(void *video_driver_data, void *image)
    glDeleteTextures(1, &tex);
 }
 
-static void gl2_video_layout_layer_begin(const video_layout_render_info_t *info)
+static bool gl2_video_layout_layer_begin(const video_layout_render_info_t *info,
+      int layer_index, bool dirty)
 {
    gl_t *gl;
+   video_frame_info_t *video_info;
+
    gl = (gl_t*)info->video_driver_data;
+   video_info = (video_frame_info_t*)info->video_driver_frame_data;
+
+   gl->shader->use(gl, gl->shader_data,
+      VIDEO_SHADER_STOCK_BLEND, true);
+
+   if (!gl->video_layout_fbo[layer_index])
+   {
+      gl2_video_layout_fbo_init(gl, layer_index,
+            video_info->width, video_info->height);
+      dirty = true;
+   }
+
+   if (!dirty)
+      return false;
 
-   gl2_bind_fb(gl->video_layout_fbo);
+   gl2_bind_fb(gl->video_layout_fbo[layer_index]);
 
    glClearColor(0, 0, 0, 0);
    glClear(GL_COLOR_BUFFER_BIT);
 
-   gl->shader->use(gl, gl->shader_data,
-      VIDEO_SHADER_STOCK_BLEND, true);
-
    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+   return true;
 }
 
 static void gl2_video_layout_image(const video_layout_render_info_t *info, void *image_handle, void *alpha_handle)
@@ -2761,7 +4094,8 @@ static void gl2_video_layout_led_seg(const video_layout_render_info_t *info, vid
    /* TODO */
 }
 
-static void gl2_video_layout_layer_end(const video_layout_render_info_t *info, video_layout_blend_t blend_type)
+static void gl2_video_layout_layer_end(const video_layout_render_info_t *info,
+      int layer_index, video_layout_blend_t blend_type)
 {
    gl_t *gl;
    gl = (gl_t*)info->video_driver_data;
@@ -2789,7 +4123,7 @@ static void gl2_video_layout_layer_end(const video_layout_render_info_t *info, v
    gl->shader->set_coords(gl->shader_data, &gl->coords);
    gl->shader->set_mvp(gl->shader_data, &gl->mvp_no_rot);
 
-   glBindTexture(GL_TEXTURE_2D, gl->video_layout_fbo_texture);
+   glBindTexture(GL_TEXTURE_2D, gl->video_layout_fbo_texture[layer_index]);
    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
    gl->coords.tex_coord = gl->tex_info.coord;
@@ -2818,6 +4152,137 @@ static const video_layout_render_interface_t *gl2_get_video_layout_render_interf
 
 #endif /* HAVE_VIDEO_LAYOUT */
 
+/* Overlay, widgets and OSD message, over the frame */
+static void gl2_render_ui(gl_t *gl, video_frame_info_t *video_info,
+      const char *msg)
+{
+#ifdef HAVE_OVERLAY
+   if (gl->overlay_enable)
+   {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_OVERLAY);
+      gl2_render_overlay(gl, video_info);
+   }
+#endif
+
+#ifdef HAVE_MENU_WIDGETS
+   if (video_info->widgets_inited)
+   {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_MENU);
+      menu_widgets_frame(video_info);
+      gl_batch_flush(gl);
+   }
+#endif
+
+   if (!string_is_empty(msg))
+   {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_FONT);
+      if (video_info->msg_bgcolor_enable)
+         gl2_render_osd_background(gl, video_info, msg);
+      font_driver_render_msg(gl, video_info, msg, NULL, NULL);
+   }
+}
+
+#ifdef HAVE_MENU_WIDGETS
+static void gl2_ui_layer_hide(gl_t *gl)
+{
+   if (gl->ui_layer_visible)
+      gl->ctx_driver->ui_layer_end(gl->ctx_data, false);
+
+   gl->ui_layer_visible = false;
+   gl->ui_layer_valid   = false;
+}
+
+/* Draws the UI straight into the plane bound by ui_layer_begin,
+ * upside down, with the alpha accumulated as in a layer. */
+static void gl2_ui_layer_draw(gl_t *gl, video_frame_info_t *video_info,
+      const char *msg)
+{
+   math_matrix_4x4 mvp        = gl->mvp;
+   math_matrix_4x4 mvp_no_rot = gl->mvp_no_rot;
+
+   gl->surface_flip_y = true;
+   gl->layer_active   = true;
+   gl2_set_projection(gl, &default_ortho, true);
+   gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+
+   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+
+   gl2_render_ui(gl, video_info, msg);
+   gl_batch_flush(gl);
+
+   gl->surface_flip_y = false;
+   gl->layer_active   = false;
+   gl->mvp            = mvp;
+   gl->mvp_no_rot     = mvp_no_rot;
+   gl2_viewport(gl, gl->vp.x, gl->vp.y, gl->vp.width, gl->vp.height);
+}
+
+/* Puts the UI on the context's own plane, if it has one, where
+ * it stays until something in it changes instead of being drawn
+ * every frame. Returns false if it has to be drawn over the
+ * frame instead. */
+static bool gl2_render_ui_layer(gl_t *gl, video_frame_info_t *video_info,
+      const char *msg)
+{
+   uint32_t widgets_hash = 0;
+   bool visible          = !string_is_empty(msg);
+   bool overlay_dirty    = false;
+
+   if (!gl->ctx_driver->ui_layer_begin || !gl->ctx_driver->ui_layer_end)
+      return false;
+
+#ifdef HAVE_MENU
+   /* Drawn over the menu, which covers the frame anyway */
+   if (gl->menu_texture_enable)
+   {
+      gl2_ui_layer_hide(gl);
+      return false;
+   }
+#endif
+
+#ifdef HAVE_OVERLAY
+   visible       = visible || gl->overlay_enable;
+   overlay_dirty = gl->overlay_enable && gl->overlay_dirty;
+#endif
+
+   if (     video_info->widgets_inited
+         && menu_widgets_get_state(video_info, &widgets_hash))
+      visible = true;
+
+   if (!visible)
+   {
+      gl2_ui_layer_hide(gl);
+      return true;
+   }
+
+   if (     gl->ui_layer_valid
+         && !overlay_dirty
+         && widgets_hash == gl->ui_layer_widgets_hash
+         && string_is_equal(msg ? msg : "", gl->ui_layer_msg))
+      return true;
+
+   gl_batch_flush(gl);
+
+   if (!gl->ctx_driver->ui_layer_begin(gl->ctx_data))
+   {
+      gl->ui_layer_visible = false;
+      gl->ui_layer_valid   = false;
+      return false;
+   }
+
+   gl2_ui_layer_draw(gl, video_info, msg);
+   gl->ctx_driver->ui_layer_end(gl->ctx_data, true);
+   gl2_renderchain_bind_backbuffer();
+
+   gl->ui_layer_visible      = true;
+   gl->ui_layer_valid        = true;
+   gl->ui_layer_widgets_hash = widgets_hash;
+   strlcpy(gl->ui_layer_msg, msg ? msg : "", sizeof(gl->ui_layer_msg));
+   return true;
+}
+#endif
+
 static bool gl2_frame(void *data, const void *frame,
       unsigned frame_width, unsigned frame_height,
       uint64_t frame_count,
@@ -2830,12 +4295,23 @@ static bool gl2_frame(void *data, const void *frame,
    gl2_renderchain_data_t       *chain = (gl2_renderchain_data_t*)gl->renderchain_data;
    unsigned width                      = video_info->width;
    unsigned height                     = video_info->height;
+   unsigned first_dirty_pass           = 1;
+   bool shader_adaptive                = gl && gl->fbo_inited
+      && video_info->shader_adaptive;
+   bool timing                         = false;
+   retro_time_t trace_start            = 0;
 
    if (!gl)
       return false;
 
    gl2_context_bind_hw_render(gl, false);
 
+   timing = shader_adaptive || video_info->statistics_show
+      || video_info->is_perfcnt_enable;
+
+   if (gl_timer_begin_frame(gl->timer, timing) && shader_adaptive)
+      gl2_renderchain_adapt(gl, chain, video_info);
+
 #ifndef HAVE_OPENGLES
    if (gl->core_context_in_use)
       glBindVertexArray(chain->vao);
@@ -2851,6 +4327,14 @@ static bool gl2_frame(void *data, const void *frame,
    /* Render to texture in first pass. */
    if (gl->fbo_inited)
    {
+      if (!shader_adaptive && chain->adaptive_level)
+      {
+         chain->adaptive_level = 0;
+         gl2_renderchain_recreate_fbo_formats(gl, chain);
+      }
+
+      first_dirty_pass = gl2_renderchain_first_dirty_pass(gl, chain, frame);
+
       gl2_renderchain_recompute_pass_sizes(
             gl, chain,
             frame_width, frame_height,
@@ -2915,6 +4399,8 @@ static bool gl2_frame(void *data, const void *frame,
             }
          }
 
+         gl2_renderchain_account_fbo(gl, chain);
+
          /* Go back to what we're supposed to do,
           * render to FBO #0. */
          gl2_renderchain_start_render(gl, chain, video_info);
@@ -2941,10 +4427,14 @@ static bool gl2_frame(void *data, const void *frame,
    {
       if (!gl->hw_render_fbo_init)
       {
+         retro_time_t trace_start = rarch_trace_begin();
+
          gl2_update_input_size(gl, frame_width, frame_height, pitch, true);
 
          gl2_renderchain_copy_frame(gl, chain,
                video_info, frame, frame_width, frame_height, pitch);
+
+         rarch_trace_end("GL upload", trace_start);
       }
 
       /* No point regenerating mipmaps
@@ -2997,36 +4487,46 @@ static bool gl2_frame(void *data, const void *frame,
       set_texture_coords(feedback_info.coord, xamt, yamt);
    }
 
-   glClear(GL_COLOR_BUFFER_BIT);
+   trace_start = rarch_trace_begin();
 
-   params.data          = gl;
-   params.width         = frame_width;
-   params.height        = frame_height;
-   params.tex_width     = gl->tex_w;
-   params.tex_height    = gl->tex_h;
-   params.out_width     = gl->vp.width;
-   params.out_height    = gl->vp.height;
-   params.frame_counter = (unsigned int)frame_count;
-   params.info          = &gl->tex_info;
-   params.prev_info     = gl->prev_info;
-   params.feedback_info = &feedback_info;
-   params.fbo_info      = NULL;
-   params.fbo_info_cnt  = 0;
+   if (first_dirty_pass <= 1)
+   {
+      gl_timer_pass(gl->timer, 0);
 
-   gl->shader->set_params(&params, gl->shader_data);
+      glClear(GL_COLOR_BUFFER_BIT);
 
-   gl->coords.vertices  = 4;
+      params.data          = gl;
+      params.width         = frame_width;
+      params.height        = frame_height;
+      params.tex_width     = gl->tex_w;
+      params.tex_height    = gl->tex_h;
+      params.out_width     = gl->vp.width;
+      params.out_height    = gl->vp.height;
+      params.frame_counter = (unsigned int)frame_count;
+      params.info          = &gl->tex_info;
+      params.prev_info     = gl->prev_info + gl->prev_index;
+      params.feedback_info = &feedback_info;
+      params.fbo_info      = NULL;
+      params.fbo_info_cnt  = 0;
 
-   gl->shader->set_coords(gl->shader_data, &gl->coords);
-   gl->shader->set_mvp(gl->shader_data, &gl->mvp);
+      gl->shader->set_params(&params, gl->shader_data);
 
-   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+      gl->coords.vertices  = 4;
+
+      gl->shader->set_coords(gl->shader_data, &gl->coords);
+      gl->shader->set_mvp(gl->shader_data, &gl->mvp);
+
+      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+   }
 
    if (gl->fbo_inited)
       gl2_renderchain_render(gl,
             chain,
             video_info,
-            frame_count, &gl->tex_info, &feedback_info);
+            frame_count, first_dirty_pass,
+            &gl->tex_info, &feedback_info);
+
+   rarch_trace_end("GL passes", trace_start);
 
    /* Set prev textures. */
    gl2_renderchain_bind_prev_texture(gl,
@@ -3039,7 +4539,10 @@ static bool gl2_frame(void *data, const void *frame,
 #if defined(HAVE_MENU)
    if (gl->menu_texture_enable)
    {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_MENU);
+
       menu_driver_frame(video_info);
+      gl_batch_flush(gl);
 
       if (gl->menu_texture)
          gl2_draw_texture(gl, video_info);
@@ -3049,28 +4552,18 @@ static bool gl2_frame(void *data, const void *frame,
       struct font_params *osd_params = (struct font_params*)
          &video_info->osd_stat_params;
 
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_FONT);
+
       if (osd_params)
          font_driver_render_msg(gl, video_info, video_info->stat_text,
                (const struct font_params*)&video_info->osd_stat_params, NULL);
    }
 #endif
 
-#ifdef HAVE_OVERLAY
-   if (gl->overlay_enable)
-      gl2_render_overlay(gl, video_info);
-#endif
-
 #ifdef HAVE_MENU_WIDGETS
-   if (video_info->widgets_inited)
-      menu_widgets_frame(video_info);
+   if (!gl2_render_ui_layer(gl, video_info, msg))
 #endif
-
-   if (!string_is_empty(msg))
-   {
-      if (video_info->msg_bgcolor_enable)
-         gl2_render_osd_background(gl, video_info, msg);
-      font_driver_render_msg(gl, video_info, msg, NULL, NULL);
-   }
+      gl2_render_ui(gl, video_info, msg);
 
    if (video_info->cb_update_window_title)
       video_info->cb_update_window_title(
@@ -3083,6 +4576,8 @@ static bool gl2_frame(void *data, const void *frame,
       glBindTexture(GL_TEXTURE_2D, 0);
    }
 
+   gl_timer_end_frame(gl->timer);
+
    /* Screenshots. */
    if (gl->readback_buffer_screenshot)
       gl2_renderchain_readback(gl,
@@ -3096,7 +4591,14 @@ static bool gl2_frame(void *data, const void *frame,
          /* Don't readback if we're in menu mode. */
          if (!gl->menu_texture_enable)
 #endif
-            gl2_pbo_async_readback(gl);
+         {
+#ifdef HAVE_GL_ASYNC_READBACK
+            if (gl->record_fbo)
+               gl2_record_nv12_readback(gl);
+            else
+#endif
+               gl2_pbo_async_readback(gl);
+         }
 
    /* emscripten has to do black frame insertion in its main loop */
 #ifndef EMSCRIPTEN
@@ -3113,7 +4615,9 @@ static bool gl2_frame(void *data, const void *frame,
    }
 #endif
 
+   trace_start = rarch_trace_begin();
    video_info->cb_swap_buffers(video_info->context_data, video_info);
+   rarch_trace_end("GL swap", trace_start);
 
    /* check if we are fast forwarding or in menu, if we are ignore hard sync */
    if (  gl->have_sync
@@ -3121,10 +4625,14 @@ static bool gl2_frame(void *data, const void *frame,
          && !video_info->input_driver_nonblock_state
          && !gl->menu_texture_enable)
    {
+      trace_start = rarch_trace_begin();
+
       glClear(GL_COLOR_BUFFER_BIT);
 
       gl2_renderchain_fence_iterate(gl, chain,
             video_info->hard_sync_frames);
+
+      rarch_trace_end("GL hard sync", trace_start);
    }
 
 #ifndef HAVE_OPENGLES
@@ -3171,6 +4679,18 @@ static void gl2_free(void *data)
    gl2_video_layout_free(gl);
 #endif
 
+#ifdef HAVE_MENU_WIDGETS
+   gl2_layer_free(gl);
+#endif
+
+#ifdef HAVE_SHADERPIPELINE
+   gl2_pipeline_free(gl);
+#endif
+
+#ifdef HAVE_GL_ASYNC_READBACK
+   gl2_record_nv12_free(gl);
+#endif
+
    gl2_context_bind_hw_render(gl, false);
 
    if (gl->have_sync)
@@ -3178,6 +4698,20 @@ static void gl2_free(void *data)
             (gl2_renderchain_data_t*)
             gl->renderchain_data);
 
+#ifdef HAVE_GL_UPLOAD_PBO
+   gl2_renderchain_upload_pbo_free(
+         (gl2_renderchain_data_t*)gl->renderchain_data);
+#endif
+
+   gl_timer_free(gl->timer);
+   gl->timer = NULL;
+
+   gl_batch_free(gl->batch);
+   gl->batch = NULL;
+
+   gl_atlas_free(gl->atlas);
+   gl->atlas = NULL;
+
    font_driver_free_osd();
 
    gl->shader->deinit(gl->shader_data);
@@ -3202,6 +4736,18 @@ static void gl2_free(void *data)
 
    if (gl->pbo_readback_enable)
    {
+#if defined(HAVE_GL_ASYNC_READBACK) && defined(HAVE_GL_SYNC)
+      unsigned i;
+      gl2_renderchain_data_t *chain = (gl2_renderchain_data_t*)
+         gl->renderchain_data;
+
+      for (i = 0; i < 4; i++)
+      {
+         if (chain->readback_fences[i])
+            glDeleteSync(chain->readback_fences[i]);
+         chain->readback_fences[i] = NULL;
+      }
+#endif
       glDeleteBuffers(4, gl->pbo_readback);
       scaler_ctx_gen_reset(&gl->pbo_readback_scaler);
    }
@@ -3765,6 +5311,10 @@ static void *gl2_init(const video_info_t *video,
    if (!gl2_resolve_extensions(gl, ctx_driver->ident, video))
       goto error;
 
+   gl->timer = gl_timer_new();
+   gl->batch = gl_batch_new();
+   gl->atlas = gl_atlas_new();
+
 #ifdef GL_DEBUG
    gl2_begin_debug(gl);
 #endif
@@ -3794,6 +5344,7 @@ static void *gl2_init(const video_info_t *video,
    video_driver_get_size(&temp_width, &temp_height);
    gl->video_width       = temp_width;
    gl->video_height      = temp_height;
+   gl->surface_rotation  = video_driver_get_surface_rotation();
 
    RARCH_LOG("[GL]: Using resolution %ux%u\n", temp_width, temp_height);
 
@@ -3840,6 +5391,7 @@ static void *gl2_init(const video_info_t *video,
       unsigned texture_info_id = gl->shader->get_prev_textures(gl->shader_data);
       unsigned minimum         = texture_info_id;
       gl->textures             = MAX(minimum + 1, gl->textures);
+      gl->prev_depth           = texture_info_id;
    }
 
    if (!gl2_shader_info(gl, &shader_info))
@@ -4109,6 +5661,8 @@ static bool gl2_set_shader(void *data,
    {
       unsigned texture_info_id = gl->shader->get_prev_textures(gl->shader_data);
       textures                 = texture_info_id + 1;
+      gl->prev_depth           = texture_info_id;
+      gl->prev_index           = 0;
    }
 
    if (textures > gl->textures) /* Have to reinit a bit. */
@@ -4138,6 +5692,8 @@ static bool gl2_set_shader(void *data,
          (gl2_renderchain_data_t*)gl->renderchain_data,
          gl->tex_w, gl->tex_h);
 
+   gl_timer_reset(gl->timer);
+
    /* Apparently need to set viewport for passes when we aren't using FBOs. */
    gl2_set_shader_viewports(gl);
    gl2_context_bind_hw_render(gl, true);
@@ -4150,6 +5706,38 @@ error:
    return false;
 }
 
+static bool gl2_reinit_shader_fbo(void *data)
+{
+#if defined(HAVE_GLSL) || defined(HAVE_CG)
+   gl_t *gl = (gl_t*)data;
+
+   if (!gl || !gl->renderchain_data)
+      return false;
+
+   gl2_update_tex_filter_frame(gl);
+   gl2_context_bind_hw_render(gl, false);
+
+   if (gl->fbo_inited)
+   {
+      gl2_renderchain_deinit_fbo(gl,
+            (gl2_renderchain_data_t*)gl->renderchain_data);
+
+      glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+   }
+
+   gl2_renderchain_init(gl,
+         (gl2_renderchain_data_t*)gl->renderchain_data,
+         gl->tex_w, gl->tex_h);
+
+   gl2_set_shader_viewports(gl);
+   gl2_context_bind_hw_render(gl, true);
+
+   return true;
+#else
+   return false;
+#endif
+}
+
 static void gl2_viewport_info(void *data, struct video_viewport *vp)
 {
    unsigned top_y, top_dist;
@@ -4167,6 +5755,61 @@ static void gl2_viewport_info(void *data, struct video_viewport *vp)
    vp->y           = top_dist;
 }
 
+static bool gl2_set_record_nv12(void *data,
+      unsigned width, unsigned height)
+{
+#ifdef HAVE_GL_ASYNC_READBACK
+   gl_t *gl = (gl_t*)data;
+   bool ret = true;
+
+   if (!gl)
+      return false;
+
+   gl2_context_bind_hw_render(gl, false);
+   gl2_record_nv12_free(gl);
+
+   if (width && height)
+      ret = gl2_record_nv12_init(gl, width, height);
+
+   /* What's in the ring was read back as it was before */
+   memset(gl->pbo_readback_valid, 0, sizeof(gl->pbo_readback_valid));
+
+   gl2_context_bind_hw_render(gl, true);
+   return ret;
+#else
+   return !width || !height;
+#endif
+}
+
+static bool gl2_read_viewport_nv12(void *data, uint8_t *buffer)
+{
+#ifdef HAVE_GL_ASYNC_READBACK
+   const uint8_t *ptr = NULL;
+   gl_t *gl           = (gl_t*)data;
+   size_t size;
+
+   if (!gl || !gl->record_fbo)
+      return false;
+
+   size = gl->record_width * gl->record_height * 3 / 2;
+
+   gl2_context_bind_hw_render(gl, false);
+
+   ptr  = gl2_pbo_readback_map(gl, size);
+   if (ptr)
+   {
+      memcpy(buffer, ptr, size);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+   }
+
+   gl2_context_bind_hw_render(gl, true);
+   return ptr != NULL;
+#else
+   return false;
+#endif
+}
+
 static bool gl2_read_viewport(void *data, uint8_t *buffer, bool is_idle)
 {
    gl_t *gl             = (gl_t*)data;
@@ -4247,7 +5890,8 @@ static bool gl2_overlay_load(void *data,
    gl2_context_bind_hw_render(gl, false);
 
    gl2_free_overlay(gl);
-   gl->overlay_tex = (GLuint*)
+   gl->ui_layer_valid = false;
+   gl->overlay_tex    = (GLuint*)
       calloc(num_images, sizeof(*gl->overlay_tex));
 
    if (!gl->overlay_tex)
@@ -4262,25 +5906,55 @@ static bool gl2_overlay_load(void *data,
       calloc(2 * 4 * num_images, sizeof(GLfloat));
    gl->overlay_color_coord  = (GLfloat*)
       calloc(4 * 4 * num_images, sizeof(GLfloat));
+   gl->overlay_atlas_id     = (uintptr_t*)
+      calloc(num_images, sizeof(*gl->overlay_atlas_id));
+   gl->overlay_draw_vertex  = (GLfloat*)
+      calloc(2 * 6 * num_images, sizeof(GLfloat));
+   gl->overlay_draw_tex     = (GLfloat*)
+      calloc(2 * 6 * num_images, sizeof(GLfloat));
+   gl->overlay_draw_color   = (GLfloat*)
+      calloc(4 * 6 * num_images, sizeof(GLfloat));
+   gl->overlay_draw_run_tex = (GLuint*)
+      calloc(num_images, sizeof(*gl->overlay_draw_run_tex));
+   gl->overlay_draw_run_vertices = (unsigned*)
+      calloc(num_images, sizeof(*gl->overlay_draw_run_vertices));
 
    if (     !gl->overlay_vertex_coord
          || !gl->overlay_tex_coord
-         || !gl->overlay_color_coord)
+         || !gl->overlay_color_coord
+         || !gl->overlay_atlas_id
+         || !gl->overlay_draw_vertex
+         || !gl->overlay_draw_tex
+         || !gl->overlay_draw_color
+         || !gl->overlay_draw_run_tex
+         || !gl->overlay_draw_run_vertices)
+   {
+      gl2_free_overlay(gl);
+      gl2_context_bind_hw_render(gl, true);
       return false;
+   }
 
-   gl->overlays = num_images;
-   glGenTextures(num_images, gl->overlay_tex);
+   gl->overlays      = num_images;
+   gl->overlay_dirty = true;
 
    for (i = 0; i < num_images; i++)
    {
       unsigned alignment = video_pixel_get_alignment(images[i].width
             * sizeof(uint32_t));
 
-      gl_load_texture_data(gl->overlay_tex[i],
-            RARCH_WRAP_EDGE, TEXTURE_FILTER_LINEAR,
-            alignment,
-            images[i].width, images[i].height, images[i].pixels,
-            sizeof(uint32_t));
+      /* Buttons and other small images share the pages of the
+       * atlas, so that the overlay takes few texture binds */
+      if (!gl_atlas_add(gl->atlas, &images[i], TEXTURE_FILTER_LINEAR,
+               &gl->overlay_atlas_id[i]))
+      {
+         gl->overlay_atlas_id[i] = 0;
+         glGenTextures(1, &gl->overlay_tex[i]);
+         gl_load_texture_data(gl->overlay_tex[i],
+               RARCH_WRAP_EDGE, TEXTURE_FILTER_LINEAR,
+               alignment,
+               images[i].width, images[i].height, images[i].pixels,
+               sizeof(uint32_t));
+      }
 
       /* Default. Stretch to whole screen. */
       gl2_overlay_tex_geom(gl, i, 0, 0, 1, 1);
@@ -4302,6 +5976,7 @@ static void gl2_overlay_enable(void *data, bool state)
       return;
 
    gl->overlay_enable = state;
+   gl->ui_layer_valid = false;
 
    if (gl->fullscreen && gl->ctx_driver->show_mouse)
       gl->ctx_driver->show_mouse(gl->ctx_data, state);
@@ -4311,8 +5986,11 @@ static void gl2_overlay_full_screen(void *data, bool enable)
 {
    gl_t *gl = (gl_t*)data;
 
-   if (gl)
-      gl->overlay_full_screen = enable;
+   if (!gl)
+      return;
+
+   gl->overlay_full_screen = enable;
+   gl->ui_layer_valid      = false;
 }
 
 static void gl2_overlay_set_alpha(void *data, unsigned image, float mod)
@@ -4325,6 +6003,12 @@ static void gl2_overlay_set_alpha(void *data, unsigned image, float mod)
 
    color = (GLfloat*)&gl->overlay_color_coord[image * 16];
 
+   /* Set every frame, mostly to the same */
+   if (color[3] == mod)
+      return;
+
+   gl->overlay_dirty = true;
+
    color[ 0 + 3] = mod;
    color[ 4 + 3] = mod;
    color[ 8 + 3] = mod;
@@ -4458,6 +6142,13 @@ static uintptr_t gl2_load_texture(void *video_data, void *data,
    }
 #endif
 
+   /* Small menu textures share the pages of the atlas.
+    * This is only done without the video thread, since
+    * the atlas isn't safe to modify while it draws. */
+   if (video_data && gl_atlas_add(((gl_t*)video_data)->atlas,
+            (const struct texture_image*)data, filter_type, &id))
+      return id;
+
    video_texture_load_gl2((struct texture_image*)data, filter_type, &id);
    return id;
 }
@@ -4468,6 +6159,13 @@ static void gl2_unload_texture(void *data, uintptr_t id)
    if (!id)
       return;
 
+   if (GL_ATLAS_IS_HANDLE(id))
+   {
+      if (data)
+         gl_atlas_remove(((gl_t*)data)->atlas, id);
+      return;
+   }
+
    glid = (GLuint)id;
    glDeleteTextures(1, &glid);
 }
@@ -4513,7 +6211,10 @@ static const video_poke_interface_t gl2_poke_interface = {
    NULL,
    gl2_get_current_shader,
    NULL,                      /* get_current_software_framebuffer */
-   NULL                       /* get_hw_render_interface */
+   NULL,                      /* get_hw_render_interface */
+   gl2_set_record_nv12,
+   gl2_read_viewport_nv12,
+   gl2_reinit_shader_fbo
 };
 
 static void gl2_get_poke_interface(void *data,
@@ -545,6 +545,55 @@ static void gl_core_deinit_hw_render(gl_core_t *gl)
    gl->hw_render_enable = false;
 }
 
+static void gl_core_deinit_stream_buffers(gl_core_t *gl)
+{
+   unsigned i;
+
+   for (i = 0; i < GL_CORE_NUM_TEXTURES; i++)
+   {
+      struct gl_core_streamed_texture *streamed = &gl->textures[i];
+
+      if (streamed->pbo_fence)
+         glDeleteSync(streamed->pbo_fence);
+      if (streamed->pbo != 0)
+      {
+         if (streamed->pbo_map)
+         {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamed->pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+         }
+         glDeleteBuffers(1, &streamed->pbo);
+      }
+
+      streamed->pbo       = 0;
+      streamed->pbo_map   = NULL;
+      streamed->pbo_size  = 0;
+      streamed->pbo_fence = NULL;
+   }
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+static void gl_core_deinit_stream_textures(gl_core_t *gl)
+{
+   unsigned i;
+
+   gl_core_deinit_stream_buffers(gl);
+
+   for (i = 0; i < GL_CORE_NUM_TEXTURES; i++)
+   {
+      if (gl->textures[i].tex != 0)
+         glDeleteTextures(1, &gl->textures[i].tex);
+   }
+   memset(gl->textures, 0, sizeof(gl->textures));
+
+   for (i = 0; i < GL_CORE_NUM_POOLED_TEXTURES; i++)
+   {
+      if (gl->texture_pool[i].tex != 0)
+         glDeleteTextures(1, &gl->texture_pool[i].tex);
+   }
+   memset(gl->texture_pool, 0, sizeof(gl->texture_pool));
+}
+
 static void gl_core_destroy_resources(gl_core_t *gl)
 {
    unsigned i;
@@ -557,16 +606,14 @@ static void gl_core_destroy_resources(gl_core_t *gl)
       gl_core_filter_chain_free(gl->filter_chain);
    gl->filter_chain = NULL;
 
+   gl_timer_free(gl->timer);
+   gl->timer = NULL;
+
    glBindVertexArray(0);
    if (gl->vao != 0)
       glDeleteVertexArrays(1, &gl->vao);
 
-   for (i = 0; i < GL_CORE_NUM_TEXTURES; i++)
-   {
-      if (gl->textures[i].tex != 0)
-         glDeleteTextures(1, &gl->textures[i].tex);
-   }
-   memset(gl->textures, 0, sizeof(gl->textures));
+   gl_core_deinit_stream_textures(gl);
 
    if (gl->menu_texture != 0)
       glDeleteTextures(1, &gl->menu_texture);
@@ -1259,6 +1306,14 @@ static void *gl_core_init(const video_info_t *video,
    if (!string_is_empty(version))
       sscanf(version, "%u.%u", &gl->version_major, &gl->version_minor);
 
+#ifndef HAVE_OPENGLES
+   gl->pbo_persistent = gl->version_major > 4
+      || (gl->version_major == 4 && gl->version_minor >= 4)
+      || gl_query_extension("GL_ARB_buffer_storage");
+#endif
+   RARCH_LOG("[GLCore]: Streaming frames through %s buffers.\n",
+         gl->pbo_persistent ? "persistently mapped" : "orphaned");
+
    {
       char device_str[128];
 
@@ -1320,6 +1375,8 @@ static void *gl_core_init(const video_info_t *video,
       goto error;
    }
 
+   gl->timer = gl_timer_new();
+
    if (video->font_enable)
    {
       font_driver_init_osd(gl, false,
@@ -1623,6 +1680,8 @@ static bool gl_core_set_shader(void *data,
       gl_core_filter_chain_free(gl->filter_chain);
    gl->filter_chain = NULL;
 
+   gl_timer_reset(gl->timer);
+
    if (!string_is_empty(path) && type != RARCH_SHADER_SLANG)
    {
       RARCH_WARN("[GLCore]: Only Slang shaders are supported. Falling back to stock.\n");
@@ -1745,44 +1804,193 @@ error:
    return false;
 }
 
+static GLuint gl_core_create_stream_texture(gl_core_t *gl,
+      unsigned width, unsigned height)
+{
+   GLuint tex = 0;
+
+   glGenTextures(1, &tex);
+   glBindTexture(GL_TEXTURE_2D, tex);
+   glTexStorage2D(GL_TEXTURE_2D, 1, gl->video_info.rgb32 ? GL_RGBA8 : GL_RGB565,
+                  width, height);
+
+   if (gl->video_info.rgb32)
+   {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+   }
+
+   return tex;
+}
+
+/* Swaps the texture of @streamed for one of the new size,
+ * from the pool if there's one. The old one goes to the pool,
+ * in place of the one unused the longest. */
+static void gl_core_resize_stream_texture(gl_core_t *gl,
+      struct gl_core_streamed_texture *streamed,
+      unsigned width, unsigned height)
+{
+   unsigned i;
+   GLuint tex                          = 0;
+   struct gl_core_pooled_texture *slot = NULL;
+
+   for (i = 0; i < GL_CORE_NUM_POOLED_TEXTURES; i++)
+   {
+      struct gl_core_pooled_texture *pooled = &gl->texture_pool[i];
+
+      if (pooled->tex && pooled->width == width && pooled->height == height)
+      {
+         tex         = pooled->tex;
+         pooled->tex = 0;
+         break;
+      }
+   }
+
+   if (streamed->tex != 0)
+   {
+      for (i = 0; i < GL_CORE_NUM_POOLED_TEXTURES; i++)
+      {
+         struct gl_core_pooled_texture *pooled = &gl->texture_pool[i];
+
+         if (!pooled->tex)
+         {
+            slot = pooled;
+            break;
+         }
+         if (!slot || pooled->last_used < slot->last_used)
+            slot = pooled;
+      }
+
+      if (slot->tex != 0)
+         glDeleteTextures(1, &slot->tex);
+
+      slot->tex       = streamed->tex;
+      slot->width     = streamed->width;
+      slot->height    = streamed->height;
+      slot->last_used = gl->texture_pool_frame;
+   }
+
+   streamed->tex    = tex ? tex
+      : gl_core_create_stream_texture(gl, width, height);
+   streamed->width  = width;
+   streamed->height = height;
+}
+
+/* Returns where to write @size bytes of the frame, with the
+ * upload buffer bound, or NULL to upload straight from the
+ * core's pointer. */
+static void *gl_core_map_stream_buffer(gl_core_t *gl,
+      struct gl_core_streamed_texture *streamed, size_t size)
+{
+   void *map = NULL;
+
+   /* Still being read from, by the upload of a few frames ago */
+   if (streamed->pbo_fence)
+   {
+      glClientWaitSync(streamed->pbo_fence,
+            GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      glDeleteSync(streamed->pbo_fence);
+      streamed->pbo_fence = NULL;
+   }
+
+   if (streamed->pbo == 0)
+      glGenBuffers(1, &streamed->pbo);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamed->pbo);
+
+#ifndef HAVE_OPENGLES
+   if (gl->pbo_persistent)
+   {
+      const GLbitfield flags = GL_MAP_WRITE_BIT
+         | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+      /* Storage is immutable, a bigger frame needs a new buffer */
+      if (size > streamed->pbo_size)
+      {
+         if (streamed->pbo_map)
+         {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glDeleteBuffers(1, &streamed->pbo);
+            glGenBuffers(1, &streamed->pbo);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamed->pbo);
+         }
+
+         glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+         streamed->pbo_map  = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+               0, size, flags);
+         streamed->pbo_size = streamed->pbo_map ? size : 0;
+      }
+
+      if (streamed->pbo_map)
+         return streamed->pbo_map;
+
+      /* Orphaned buffers from now on, this frame goes straight */
+      RARCH_WARN("[GLCore]: Failed to map a persistent buffer.\n");
+      gl_core_deinit_stream_buffers(gl);
+      gl->pbo_persistent = false;
+      return NULL;
+   }
+#endif
+
+   /* Orphaned, so the driver hands out fresh storage instead
+    * of waiting for the last upload */
+   glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+   streamed->pbo_size = size;
+
+   if (!(map = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)))
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   return map;
+}
+
 static void gl_core_update_cpu_texture(gl_core_t *gl,
                                        struct gl_core_streamed_texture *streamed,
                                        const void *frame, unsigned width, unsigned height, unsigned pitch)
 {
+   unsigned bpp       = gl->video_info.rgb32 ? 4 : 2;
+   /* The last line needn't be padded to the pitch */
+   size_t size        = (size_t)pitch * (height - 1) + width * bpp;
+   const void *pixels = frame;
+   void *map          = NULL;
+
+   gl->texture_pool_frame++;
+
    if (width != streamed->width || height != streamed->height)
-   {
-      if (streamed->tex != 0)
-         glDeleteTextures(1, &streamed->tex);
-      glGenTextures(1, &streamed->tex);
-      glBindTexture(GL_TEXTURE_2D, streamed->tex);
-      glTexStorage2D(GL_TEXTURE_2D, 1, gl->video_info.rgb32 ? GL_RGBA8 : GL_RGB565,
-                     width, height);
-      streamed->width = width;
-      streamed->height = height;
+      gl_core_resize_stream_texture(gl, streamed, width, height);
 
-      if (gl->video_info.rgb32)
-      {
-         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
-      }
+   if ((map = gl_core_map_stream_buffer(gl, streamed, size)))
+   {
+      memcpy(map, frame, size);
+      if (!gl->pbo_persistent)
+         glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      /* An offset into the bound buffer */
+      pixels = NULL;
    }
    else
-      glBindTexture(GL_TEXTURE_2D, streamed->tex);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+   glBindTexture(GL_TEXTURE_2D, streamed->tex);
 
-   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
    if (gl->video_info.rgb32)
    {
       glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch >> 2);
       glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
       glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-                      width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame);
+                      width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
    }
    else
    {
       glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch >> 1);
       glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
       glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-                      width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, frame);
+                      width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, pixels);
+   }
+
+   if (map)
+   {
+      if (gl->pbo_persistent)
+         streamed->pbo_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
    }
 }
 
@@ -1846,6 +2054,9 @@ static bool gl_core_frame(void *data, const void *frame,
    gl_core_context_bind_hw_render(gl, false);
    glBindVertexArray(gl->vao);
 
+   gl_timer_begin_frame(gl->timer, video_info->statistics_show
+         || video_info->is_perfcnt_enable);
+
    if (frame)
       gl->textures_index = (gl->textures_index + 1) & (GL_CORE_NUM_TEXTURES - 1);
 
@@ -1897,6 +2108,7 @@ static bool gl_core_frame(void *data, const void *frame,
    gl_core_filter_chain_set_frame_count(gl->filter_chain, frame_count);
    gl_core_filter_chain_set_frame_direction(gl->filter_chain, state_manager_frame_is_reversed() ? -1 : 1);
    gl_core_filter_chain_set_input_texture(gl->filter_chain, &texture);
+   gl_core_filter_chain_set_timer(gl->filter_chain, gl->timer);
    gl_core_filter_chain_build_offscreen_passes(gl->filter_chain, &gl->filter_chain_vp);
 
    glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -1909,6 +2121,7 @@ static bool gl_core_frame(void *data, const void *frame,
 #if defined(HAVE_MENU)
    if (gl->menu_texture_enable)
    {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_MENU);
       menu_driver_frame(video_info);
       if (gl->menu_texture_enable && gl->menu_texture)
          gl_core_draw_menu_texture(gl, video_info);
@@ -1918,6 +2131,8 @@ static bool gl_core_frame(void *data, const void *frame,
       struct font_params *osd_params = (struct font_params*)
          &video_info->osd_stat_params;
 
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_FONT);
+
       if (osd_params)
          font_driver_render_msg(gl, video_info, video_info->stat_text,
                (const struct font_params*)&video_info->osd_stat_params, NULL);
@@ -1926,16 +2141,23 @@ static bool gl_core_frame(void *data, const void *frame,
 
 #ifdef HAVE_OVERLAY
    if (gl->overlay_enable)
+   {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_OVERLAY);
       gl_core_render_overlay(gl, video_info);
+   }
 #endif
 
 #ifdef HAVE_MENU_WIDGETS
    if (video_info->widgets_inited)
+   {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_MENU);
       menu_widgets_frame(video_info);
+   }
 #endif
 
    if (!string_is_empty(msg))
    {
+      gl_timer_stage(gl->timer, GL_TIMER_STAGE_FONT);
 #if 0
       if (video_info->msg_bgcolor_enable)
          gl_core_render_osd_background(gl, video_info, msg);
@@ -1946,6 +2168,8 @@ static bool gl_core_frame(void *data, const void *frame,
    video_info->cb_update_window_title(
          video_info->context_data, video_info);
 
+   gl_timer_end_frame(gl->timer);
+
    if (gl->readback_buffer_screenshot)
    {
       /* For screenshots, just do the regular slow readback. */
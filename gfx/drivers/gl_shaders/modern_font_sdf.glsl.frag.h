@@ -0,0 +1,15 @@
+#include "shaders_common.h"
+
+/* Distance field glyphs: 0.5 is on the outline, the edge is
+ * smoothed over about a pixel, whatever size they are drawn at. */
+static const char *stock_fragment_font_sdf = GLSL(
+   uniform sampler2D Texture;
+   varying vec2 tex_coord;
+   varying vec4 color;
+   void main() {
+      float dist  = texture2D(Texture, tex_coord).a;
+      float width = 0.7 * fwidth(dist);
+      float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+      gl_FragColor = vec4(color.rgb, color.a * alpha);
+   }
+);
@@ -0,0 +1,33 @@
+#include "shaders_common.h"
+
+/* Packs the output as NV12 for GPU recording, four bytes to a
+ * pixel: color.xy steps one output pixel in the texture, color.w
+ * is 1 on the luma rows, 0 on the interleaved chroma rows below.
+ * BT.601, limited range. */
+static const char *stock_fragment_record_nv12 = GLSL(
+   uniform sampler2D Texture;
+   varying vec2 tex_coord;
+   varying vec4 color;
+   void main() {
+      vec2 dx = color.xy;
+      if (color.w > 0.5)
+      {
+         vec3 y = vec3(0.257, 0.504, 0.098);
+         gl_FragColor = vec4(
+               dot(texture2D(Texture, tex_coord - 1.5 * dx).rgb, y),
+               dot(texture2D(Texture, tex_coord - 0.5 * dx).rgb, y),
+               dot(texture2D(Texture, tex_coord + 0.5 * dx).rgb, y),
+               dot(texture2D(Texture, tex_coord + 1.5 * dx).rgb, y))
+            + 16.0 / 255.0;
+      }
+      else
+      {
+         vec3 u  = vec3(-0.148, -0.291,  0.439);
+         vec3 v  = vec3( 0.439, -0.368, -0.071);
+         vec3 c0 = texture2D(Texture, tex_coord - dx).rgb;
+         vec3 c1 = texture2D(Texture, tex_coord + dx).rgb;
+         gl_FragColor = vec4(dot(c0, u), dot(c0, v), dot(c1, u), dot(c1, v))
+            + 128.0 / 255.0;
+      }
+   }
+);
@@ -0,0 +1,554 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Software video driver for the go2 display.
+ * Core frames are copied once (or rendered directly, through
+ * GET_CURRENT_SOFTWARE_FRAMEBUFFER) into DMA-BUF backed go2 surfaces,
+ * which the RGA scales, rotates and color converts in a single
+ * go2_presenter_post call. The GPU is not used at all. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <go2/display.h>
+#include <drm/drm_fourcc.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#ifdef HAVE_MENU
+#include "../../menu/menu_driver.h"
+#endif
+
+#include "../font_driver.h"
+
+#include "../../frontend/frontend_driver.h"
+#include "../../latency_test.h"
+#include "../../retroarch.h"
+#include "../../verbosity.h"
+
+/* Number of surfaces the core frame is cycled through.
+ * go2_presenter_post blits synchronously, so two are enough
+ * for a core to render into one while the other is posted. */
+#define GO2_GFX_NUM_SURFACES 2
+
+typedef struct go2_gfx_surface
+{
+   go2_surface_t *surface;
+   uint8_t *map;
+   int stride;
+} go2_gfx_surface_t;
+
+typedef struct go2_gfx
+{
+   go2_display_t *display;
+   go2_presenter_t *presenter;
+
+   go2_gfx_surface_t frames[GO2_GFX_NUM_SURFACES];
+   go2_gfx_surface_t menu;
+
+   unsigned frame_index;
+   unsigned frame_width;
+   unsigned frame_height;
+   uint32_t frame_format;
+
+   unsigned menu_width;
+   unsigned menu_height;
+
+   /* Size of the panel in landscape orientation. */
+   unsigned width;
+   unsigned height;
+
+   struct video_viewport vp;
+
+   bool rgb32;
+   bool keep_aspect;
+   bool menu_active;
+   bool last_frame_valid;
+} go2_gfx_t;
+
+static void go2_gfx_surface_free(go2_gfx_surface_t *surf)
+{
+   if (!surf->surface)
+      return;
+
+   if (surf->map)
+      go2_surface_unmap(surf->surface);
+   go2_surface_destroy(surf->surface);
+
+   surf->surface = NULL;
+   surf->map     = NULL;
+   surf->stride  = 0;
+}
+
+static bool go2_gfx_surface_init(go2_gfx_t *vid, go2_gfx_surface_t *surf,
+      unsigned width, unsigned height, uint32_t format)
+{
+   go2_gfx_surface_free(surf);
+
+   surf->surface = go2_surface_create(vid->display, width, height, format);
+   if (!surf->surface)
+      return false;
+
+   surf->map     = (uint8_t*)go2_surface_map(surf->surface);
+   surf->stride  = go2_surface_stride_get(surf->surface);
+
+   if (!surf->map)
+   {
+      go2_gfx_surface_free(surf);
+      return false;
+   }
+
+   return true;
+}
+
+static bool go2_gfx_frames_init(go2_gfx_t *vid,
+      unsigned width, unsigned height)
+{
+   unsigned i;
+
+   for (i = 0; i < GO2_GFX_NUM_SURFACES; i++)
+   {
+      if (!go2_gfx_surface_init(vid, &vid->frames[i],
+               width, height, vid->frame_format))
+      {
+         RARCH_ERR("[go2]: Failed to create %ux%u frame surface.\n",
+               width, height);
+         vid->frame_width  = 0;
+         vid->frame_height = 0;
+         return false;
+      }
+   }
+
+   vid->frame_index      = 0;
+   vid->frame_width      = width;
+   vid->frame_height     = height;
+   vid->last_frame_valid = false;
+
+   return true;
+}
+
+static void go2_gfx_update_viewport(go2_gfx_t *vid,
+      video_frame_info_t *video_info)
+{
+   float device_aspect = (float)vid->width / vid->height;
+   float desired_aspect;
+
+   vid->vp.full_width  = vid->width;
+   vid->vp.full_height = vid->height;
+   vid->vp.x           = 0;
+   vid->vp.y           = 0;
+   vid->vp.width       = vid->width;
+   vid->vp.height      = vid->height;
+
+   if (video_info->scale_integer)
+   {
+      video_viewport_get_scaled_integer(&vid->vp,
+            vid->width, vid->height,
+            video_driver_get_aspect_ratio(), vid->keep_aspect);
+      return;
+   }
+
+   if (!vid->keep_aspect)
+      return;
+
+   desired_aspect = video_driver_get_aspect_ratio();
+
+   if (device_aspect > desired_aspect)
+   {
+      vid->vp.width = (unsigned)(vid->height * desired_aspect + 0.5f);
+      vid->vp.x     = (vid->width - vid->vp.width) / 2;
+   }
+   else if (device_aspect < desired_aspect)
+   {
+      vid->vp.height = (unsigned)(vid->width / desired_aspect + 0.5f);
+      vid->vp.y      = (vid->height - vid->vp.height) / 2;
+   }
+}
+
+/* The panel is mounted in portrait orientation, so the
+ * landscape viewport is mapped onto it rotated by 270°. */
+static void go2_gfx_present(go2_gfx_t *vid, go2_surface_t *surface,
+      unsigned width, unsigned height,
+      const struct video_viewport *vp)
+{
+   go2_presenter_post(vid->presenter,
+         surface,
+         0, 0, width, height,
+         vp->y, vid->width - vp->x - vp->width,
+         vp->height, vp->width,
+         GO2_ROTATION_DEGREES_270);
+   latency_test_presented();
+}
+
+static void *go2_gfx_init(const video_info_t *video,
+      input_driver_t **input, void **input_data)
+{
+   go2_gfx_t *vid = (go2_gfx_t*)calloc(1, sizeof(*vid));
+
+   if (!vid)
+      return NULL;
+
+   frontend_driver_install_signal_handler();
+
+   vid->display = go2_display_create();
+   if (!vid->display)
+      goto error;
+
+   vid->presenter = go2_presenter_create(vid->display,
+         DRM_FORMAT_RGB565, 0xff080808);
+   if (!vid->presenter)
+      goto error;
+
+   /* go2_display reports the native portrait size. */
+   vid->width        = go2_display_height_get(vid->display);
+   vid->height       = go2_display_width_get(vid->display);
+   vid->rgb32        = video->rgb32;
+   vid->keep_aspect  = video->force_aspect;
+   vid->frame_format = vid->rgb32 ? DRM_FORMAT_XRGB8888 : DRM_FORMAT_RGB565;
+
+   video_driver_set_size(vid->width, vid->height);
+
+   RARCH_LOG("[go2]: Presenting %ux%u %s frames through the RGA.\n",
+         vid->width, vid->height, vid->rgb32 ? "XRGB8888" : "RGB565");
+
+   if (input)
+      *input      = NULL;
+   if (input_data)
+      *input_data = NULL;
+
+   return vid;
+
+error:
+   RARCH_ERR("[go2]: Failed to initialize the go2 display.\n");
+   if (vid->display)
+      go2_display_destroy(vid->display);
+   free(vid);
+   return NULL;
+}
+
+static bool go2_gfx_frame(void *data, const void *frame, unsigned width,
+      unsigned height, uint64_t frame_count,
+      unsigned pitch, const char *msg, video_frame_info_t *video_info)
+{
+   go2_gfx_t *vid              = (go2_gfx_t*)data;
+   go2_gfx_surface_t *surf     = NULL;
+   unsigned bpp                = vid->rgb32 ? 4 : 2;
+
+#ifdef HAVE_MENU
+   menu_driver_frame(video_info);
+#endif
+
+   go2_gfx_update_viewport(vid, video_info);
+
+   if (vid->menu_active && vid->menu.surface)
+   {
+      struct video_viewport full;
+
+      full.x      = 0;
+      full.y      = 0;
+      full.width  = vid->width;
+      full.height = vid->height;
+
+      go2_gfx_present(vid, vid->menu.surface,
+            vid->menu_width, vid->menu_height, &full);
+      return true;
+   }
+
+   /* Dupe frame, present the previous one again. */
+   if (!frame || width == 0 || height == 0)
+   {
+      if (vid->last_frame_valid)
+      {
+         unsigned last = (vid->frame_index + GO2_GFX_NUM_SURFACES - 1)
+            % GO2_GFX_NUM_SURFACES;
+         go2_gfx_present(vid, vid->frames[last].surface,
+               vid->frame_width, vid->frame_height, &vid->vp);
+      }
+      return true;
+   }
+
+   if (width != vid->frame_width || height != vid->frame_height)
+   {
+      if (!go2_gfx_frames_init(vid, width, height))
+         return false;
+   }
+
+   surf = &vid->frames[vid->frame_index];
+
+   /* The core rendered straight into our surface:
+    * nothing to copy. */
+   if ((const uint8_t*)frame != surf->map)
+   {
+      unsigned y;
+      const uint8_t *src = (const uint8_t*)frame;
+      uint8_t       *dst = surf->map;
+      size_t    row_size = width * bpp;
+
+      if (pitch == (unsigned)surf->stride)
+         memcpy(dst, src, pitch * height);
+      else
+      {
+         for (y = 0; y < height; y++)
+         {
+            memcpy(dst, src, row_size);
+            src += pitch;
+            dst += surf->stride;
+         }
+      }
+   }
+
+   go2_gfx_present(vid, surf->surface, width, height, &vid->vp);
+
+   vid->frame_index      = (vid->frame_index + 1) % GO2_GFX_NUM_SURFACES;
+   vid->last_frame_valid = true;
+
+   return true;
+}
+
+static void go2_gfx_set_nonblock_state(void *data, bool toggle)
+{
+   (void)data;
+   (void)toggle;
+}
+
+static bool go2_gfx_alive(void *data)
+{
+   (void)data;
+   return !frontend_driver_get_signal_handler_state();
+}
+
+static bool go2_gfx_focus(void *data)
+{
+   (void)data;
+   return true;
+}
+
+static bool go2_gfx_suppress_screensaver(void *data, bool enable)
+{
+   (void)data;
+   (void)enable;
+   return false;
+}
+
+static bool go2_gfx_set_shader(void *data,
+      enum rarch_shader_type type, const char *path)
+{
+   (void)data;
+   (void)type;
+   (void)path;
+
+   return false;
+}
+
+static void go2_gfx_free(void *data)
+{
+   unsigned i;
+   go2_gfx_t *vid = (go2_gfx_t*)data;
+
+   if (!vid)
+      return;
+
+   for (i = 0; i < GO2_GFX_NUM_SURFACES; i++)
+      go2_gfx_surface_free(&vid->frames[i]);
+   go2_gfx_surface_free(&vid->menu);
+
+   if (vid->presenter)
+      go2_presenter_destroy(vid->presenter);
+   if (vid->display)
+      go2_display_destroy(vid->display);
+
+   free(vid);
+}
+
+static void go2_gfx_viewport_info(void *data, struct video_viewport *vp)
+{
+   go2_gfx_t *vid = (go2_gfx_t*)data;
+
+   if (!vid || !vp)
+      return;
+
+   *vp = vid->vp;
+}
+
+static void go2_set_aspect_ratio(void *data, unsigned aspect_ratio_idx)
+{
+   go2_gfx_t *vid = (go2_gfx_t*)data;
+
+   (void)aspect_ratio_idx;
+
+   if (vid)
+      vid->keep_aspect = true;
+}
+
+static void go2_set_texture_enable(void *data, bool state, bool full_screen)
+{
+   go2_gfx_t *vid = (go2_gfx_t*)data;
+
+   (void)full_screen;
+
+   if (vid)
+      vid->menu_active = state;
+}
+
+/* RGUI hands us RGBA4444, which is converted to RGB565
+ * on the way into the menu surface. */
+static void go2_set_texture_frame(void *data, const void *frame, bool rgb32,
+      unsigned width, unsigned height, float alpha)
+{
+   unsigned x, y;
+   go2_gfx_t *vid = (go2_gfx_t*)data;
+
+   (void)alpha;
+
+   if (!vid || !frame || !width || !height)
+      return;
+
+   if (   !vid->menu.surface
+       || vid->menu_width  != width
+       || vid->menu_height != height)
+   {
+      if (!go2_gfx_surface_init(vid, &vid->menu,
+               width, height, DRM_FORMAT_RGB565))
+         return;
+
+      vid->menu_width  = width;
+      vid->menu_height = height;
+   }
+
+   for (y = 0; y < height; y++)
+   {
+      uint16_t *dst = (uint16_t*)(vid->menu.map + y * vid->menu.stride);
+
+      if (rgb32)
+      {
+         const uint32_t *src = (const uint32_t*)frame + y * width;
+
+         for (x = 0; x < width; x++)
+         {
+            uint32_t col = src[x];
+            dst[x]       = ((col >> 8) & 0xf800)
+                         | ((col >> 5) & 0x07e0)
+                         | ((col >> 3) & 0x001f);
+         }
+      }
+      else
+      {
+         const uint16_t *src = (const uint16_t*)frame + y * width;
+
+         for (x = 0; x < width; x++)
+         {
+            uint16_t col = src[x];
+            unsigned r   = (col >> 12) & 0xf;
+            unsigned g   = (col >>  8) & 0xf;
+            unsigned b   = (col >>  4) & 0xf;
+            dst[x]       = (uint16_t)(((r << 1 | r >> 3) << 11)
+                         | ((g << 2 | g >> 2) << 5)
+                         |  (b << 1 | b >> 3));
+         }
+      }
+   }
+}
+
+/* Hands out the next frame surface, so software cores can
+ * render straight into DMA-BUF memory the RGA reads from. */
+static bool go2_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   go2_gfx_t *vid          = (go2_gfx_t*)data;
+   go2_gfx_surface_t *surf = NULL;
+
+   if (!vid || !framebuffer || vid->menu_active)
+      return false;
+
+   /* The surfaces are not cached, reading back
+    * from them would be slower than a plain copy. */
+   if (framebuffer->access_flags & RETRO_MEMORY_ACCESS_READ)
+      return false;
+
+   if (   framebuffer->width  != vid->frame_width
+       || framebuffer->height != vid->frame_height)
+   {
+      if (!go2_gfx_frames_init(vid,
+               framebuffer->width, framebuffer->height))
+         return false;
+   }
+
+   surf                       = &vid->frames[vid->frame_index];
+
+   framebuffer->data          = surf->map;
+   framebuffer->pitch         = surf->stride;
+   framebuffer->format        = vid->rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   framebuffer->memory_flags  = 0;
+
+   return true;
+}
+
+static const video_poke_interface_t go2_poke_interface = {
+   NULL, /* get_flags */
+   NULL, /* load_texture */
+   NULL, /* unload_texture */
+   NULL, /* set_video_mode */
+   NULL, /* get_refresh_rate */
+   NULL, /* set_filtering */
+   NULL, /* get_video_output_size */
+   NULL, /* get_video_output_prev */
+   NULL, /* get_video_output_next */
+   NULL, /* get_current_framebuffer */
+   NULL, /* get_proc_address */
+   go2_set_aspect_ratio,
+   NULL, /* apply_state_changes */
+   go2_set_texture_frame,
+   go2_set_texture_enable,
+   NULL, /* set_osd_msg */
+   NULL, /* show_mouse */
+   NULL, /* grab_mouse_toggle */
+   NULL, /* get_current_shader */
+   go2_get_current_software_framebuffer,
+   NULL  /* get_hw_render_interface */
+};
+
+static void go2_gfx_get_poke_interface(void *data,
+      const video_poke_interface_t **iface)
+{
+   (void)data;
+   *iface = &go2_poke_interface;
+}
+
+video_driver_t video_go2 = {
+   go2_gfx_init,
+   go2_gfx_frame,
+   go2_gfx_set_nonblock_state,
+   go2_gfx_alive,
+   go2_gfx_focus,
+   go2_gfx_suppress_screensaver,
+   NULL, /* has_windowed */
+   go2_gfx_set_shader,
+   go2_gfx_free,
+   "go2",
+   NULL, /* set_viewport */
+   NULL, /* set_rotation */
+   go2_gfx_viewport_info,
+   NULL, /* read_viewport */
+   NULL, /* read_frame_raw */
+#ifdef HAVE_OVERLAY
+   NULL, /* overlay_interface */
+#endif
+#ifdef HAVE_VIDEO_LAYOUT
+   NULL,
+#endif
+   go2_gfx_get_poke_interface
+};
@@ -1229,6 +1229,7 @@ static void *vulkan_init(const video_info_t *video,
    video_driver_get_size(&temp_width, &temp_height);
    vk->video_width       = temp_width;
    vk->video_height      = temp_height;
+   vk->surface_rotation  = video_driver_get_surface_rotation();
 
    RARCH_LOG("[Vulkan]: Using resolution %ux%u\n", temp_width, temp_height);
 
@@ -1417,6 +1418,17 @@ static void vulkan_set_projection(vk_t *vk,
    matrix_4x4_ortho(vk->mvp_no_rot, ortho->left, ortho->right,
          ortho->bottom, ortho->top, ortho->znear, ortho->zfar);
 
+   /* Bake the surface rotation into every backbuffer
+    * projection. Y points down here, hence the opposite
+    * angle of the GL driver's. */
+   if (vk->surface_rotation)
+   {
+      math_matrix_4x4 proj = vk->mvp_no_rot;
+      matrix_4x4_rotate_z(rot,
+            M_PI * (360 - vk->surface_rotation) / 180.0f);
+      matrix_4x4_multiply(vk->mvp_no_rot, rot, proj);
+   }
+
    if (!allow_rotate)
    {
       vk->mvp = vk->mvp_no_rot;
@@ -1583,10 +1595,17 @@ static void vulkan_readback(vk_t *vk)
    region.imageExtent.height          = vp.height;
    region.imageExtent.depth           = 1;
 
+   /* Pre-rotated surfaces are read back as they are,
+    * vulkan_read_viewport() rotates the frame back */
+   if (vk->surface_rotation)
+      vulkan_surface_rect(vk,
+            &region.imageOffset.x, &region.imageOffset.y,
+            &region.imageExtent.width, &region.imageExtent.height);
+
    staging  = &vk->readback.staging[vk->context->current_swapchain_index];
    *staging = vulkan_create_texture(vk,
          staging->memory != VK_NULL_HANDLE ? staging : NULL,
-         vk->vp.width, vk->vp.height,
+         region.imageExtent.width, region.imageExtent.height,
          VK_FORMAT_B8G8R8A8_UNORM, /* Formats don't matter for readback since it's a raw copy. */
          NULL, NULL, VULKAN_TEXTURE_READBACK);
 
@@ -1910,6 +1929,14 @@ static bool vulkan_frame(void *data, const void *frame,
       /* Begin render pass and set up viewport */
       vkCmdBeginRenderPass(vk->cmd, &rp_info, VK_SUBPASS_CONTENTS_INLINE);
 
+      if (vk->surface_rotation)
+      {
+         VkViewport surface_vp = vk->vk_vp;
+         vulkan_surface_viewport(vk, &surface_vp);
+         vulkan_filter_chain_set_surface_viewport(
+               (vulkan_filter_chain_t*)vk->filter_chain, &surface_vp);
+      }
+
       vulkan_filter_chain_build_viewport_pass(
             (vulkan_filter_chain_t*)vk->filter_chain, vk->cmd,
             &vk->vk_vp, vk->mvp.data);
@@ -2464,6 +2491,50 @@ static void vulkan_viewport_info(void *data, struct video_viewport *vp)
    vp->full_height = height;
 }
 
+/* Converts a readback of a pre-rotated surface to bottom-up BGR24,
+ * rotating it back to the viewport's orientation */
+static void vulkan_read_viewport_rotated(vk_t *vk, uint8_t *buffer,
+      const uint8_t *src, size_t src_stride, bool swap_rb)
+{
+   unsigned x, y;
+   unsigned width  = vk->vp.width;
+   unsigned height = vk->vp.height;
+
+   buffer += 3 * (height - 1) * width;
+
+   for (y = 0; y < height; y++, buffer -= 3 * width)
+   {
+      for (x = 0; x < width; x++)
+      {
+         const uint8_t *pixel;
+         unsigned src_x, src_y;
+
+         switch (vk->surface_rotation)
+         {
+            case 90:
+               src_x = y;
+               src_y = width - 1 - x;
+               break;
+            case 180:
+               src_x = width  - 1 - x;
+               src_y = height - 1 - y;
+               break;
+            case 270:
+            default:
+               src_x = height - 1 - y;
+               src_y = x;
+               break;
+         }
+
+         pixel = src + src_y * src_stride + 4 * src_x;
+
+         buffer[3 * x + 0] = pixel[swap_rb ? 2 : 0];
+         buffer[3 * x + 1] = pixel[1];
+         buffer[3 * x + 2] = pixel[swap_rb ? 0 : 2];
+      }
+   }
+}
+
 static bool vulkan_read_viewport(void *data, uint8_t *buffer, bool is_idle)
 {
    struct vk_texture *staging       = NULL;
@@ -2500,15 +2571,21 @@ static bool vulkan_read_viewport(void *data, uint8_t *buffer, bool is_idle)
          if (staging->memory == VK_NULL_HANDLE)
             return false;
 
-         buffer += 3 * (vk->vp.height - 1) * vk->vp.width;
          vkMapMemory(vk->context->device, staging->memory,
                staging->offset, staging->size, 0, (void**)&src);
 
          vulkan_sync_texture_to_cpu(vk, staging);
 
-         ctx->in_stride  = staging->stride;
-         ctx->out_stride = -(int)vk->vp.width * 3;
-         scaler_ctx_scale_direct(ctx, buffer, src);
+         if (vk->surface_rotation)
+            vulkan_read_viewport_rotated(vk, buffer, src, staging->stride,
+                  ctx == &vk->readback.scaler_rgb);
+         else
+         {
+            buffer += 3 * (vk->vp.height - 1) * vk->vp.width;
+            ctx->in_stride  = staging->stride;
+            ctx->out_stride = -(int)vk->vp.width * 3;
+            scaler_ctx_scale_direct(ctx, buffer, src);
+         }
 
          vkUnmapMemory(vk->context->device, staging->memory);
       }
@@ -2540,6 +2617,25 @@ static bool vulkan_read_viewport(void *data, uint8_t *buffer, bool is_idle)
 
       vulkan_sync_texture_to_cpu(vk, staging);
 
+      if (vk->surface_rotation)
+      {
+         switch (vk->context->swapchain_format)
+         {
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+               vulkan_read_viewport_rotated(vk, buffer,
+                     (const uint8_t*)staging->mapped, staging->stride,
+                     vk->context->swapchain_format
+                     != VK_FORMAT_B8G8R8A8_UNORM);
+               break;
+
+            default:
+               RARCH_ERR("[Vulkan]: Unexpected swapchain format.\n");
+               break;
+         }
+      }
+      else
       {
          unsigned x, y;
          const uint8_t *src = (const uint8_t*)staging->mapped;
@@ -679,5 +679,7 @@ const gfx_ctx_driver_t gfx_ctx_android = {
 #else
    NULL,
 #endif
+   NULL,
+   NULL,
    NULL
 };
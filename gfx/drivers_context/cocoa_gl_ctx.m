@@ -946,5 +946,7 @@ const gfx_ctx_driver_t gfx_ctx_cocoagl = {
 #else
    NULL, /* get_context_data */
 #endif
-   NULL  /* make_current */
+   NULL, /* make_current */
+   NULL,
+   NULL
 };
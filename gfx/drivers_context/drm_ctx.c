@@ -19,6 +19,7 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
@@ -32,12 +33,22 @@
 #include <poll.h>
 
 #include <libdrm/drm.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
 #include <gbm.h>
 
+#include <features/features_cpu.h>
+#include <file/file_path.h>
 #include <lists/dir_list.h>
 #include <string/stdstring.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../../configuration.h"
+#include "../../driver.h"
+#include "../../latency_test.h"
+#include "../../performance_counters.h"
 #include "../../verbosity.h"
 #include "../../frontend/frontend_driver.h"
 #include "../common/drm_common.h"
@@ -69,8 +80,75 @@
 #define EGL_PLATFORM_GBM_KHR 0x31D7
 #endif
 
+/* Number of EGLImage textures the gl driver may cycle through. */
+#define DRM_MAX_IMAGES 8
+
+/* Upper bound on frames the GPU may have in flight,
+ * tracked with EGL_KHR_fence_sync. */
+#define DRM_MAX_FENCES 4
+
 static enum gfx_ctx_api drm_api           = GFX_CTX_NONE;
 
+/* Per-stage present timings, shown in the statistics overlay. */
+static rarch_histogram_t drm_hist_swap;
+static rarch_histogram_t drm_hist_lock;
+static rarch_histogram_t drm_hist_queue;
+static rarch_histogram_t drm_hist_post;
+static rarch_histogram_t drm_hist_frame;
+
+/* Maximum number of locked go2 surfaces that can be
+ * queued for presentation at any time. */
+#define DRM_PRESENT_QUEUE_SIZE 3
+
+enum drm_present_state
+{
+   DRM_PRESENT_FREE = 0,
+   DRM_PRESENT_QUEUED,
+   DRM_PRESENT_POSTED
+};
+
+/* Buffers the UI plane flips between. */
+#define DRM_UI_BUFFERS 2
+
+enum drm_ui_layer_state
+{
+   DRM_UI_LAYER_UNTRIED = 0,
+   DRM_UI_LAYER_READY,
+   DRM_UI_LAYER_FAILED
+};
+
+/* Number of page flips the refresh rate is measured over. */
+#define DRM_REFRESH_SAMPLES 128
+
+/* Fallback until enough page flips have been measured. */
+#define DRM_DEFAULT_REFRESH_RATE 60.0f
+
+typedef struct drm_present_slot
+{
+   go2_surface_t *surface;
+   enum drm_present_state state;
+} drm_present_slot_t;
+
+typedef struct drm_image
+{
+   go2_surface_t *surface;
+   uint8_t *map;
+#ifdef HAVE_EGL
+   EGLImageKHR image;
+#endif
+   uint32_t format;
+} drm_image_t;
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+typedef struct drm_ui_buffer
+{
+   go2_surface_t *surface;
+   EGLImageKHR image;
+   GLuint tex;
+   GLuint fbo;
+   uint32_t fb_id;
+} drm_ui_buffer_t;
+#endif
 
 typedef struct gfx_ctx_drm_data
 {
@@ -80,13 +158,1121 @@ typedef struct gfx_ctx_drm_data
    go2_display_t* display;
    go2_presenter_t* presenter;
    go2_context_t* context;
+   retro_time_t frame_last_time;
    int interval;
    unsigned fb_width;
    unsigned fb_height;
+   /* Panel size, in landscape orientation. */
+   unsigned panel_width;
+   unsigned panel_height;
+
+   /* The video driver renders straight into a surface
+    * in panel orientation, so presenting is a plain copy. */
+   bool prerotated;
+
+   /* go2_presenter_post blocks on the page flip queue, so
+    * the time between posts is the actual scanout period.
+    * Only touched by whoever presents (see present_thread). */
+   retro_time_t flip_last_time;
+   retro_time_t flip_intervals[DRM_REFRESH_SAMPLES];
+   unsigned flip_count;
+   float measured_refresh_rate;
+   bool refresh_rate_applied;
+
+#ifdef HAVE_THREADS
+   /* Pipelined presentation: the main thread hands
+    * locked surfaces over to present_thread, which does
+    * the RGA rotate/blit and page flip. Posted surfaces
+    * are unlocked again by the main thread, since the
+    * GBM surface is owned by the GL context. */
+   sthread_t *present_thread;
+   slock_t *present_lock;
+   scond_t *present_cond;
+   drm_present_slot_t present_slots[DRM_PRESENT_QUEUE_SIZE];
+   unsigned present_write;
+   unsigned present_read;
+   unsigned present_max_locked;
+   bool present_quit;
+#endif
+
+#if defined(HAVE_EGL) && defined(EGL_KHR_fence_sync)
+   /* Bounds how far the Mali driver may queue ahead
+    * of the display, without a full glFinish stall. */
+   EGLDisplay fence_display;
+   PFNEGLCREATESYNCKHRPROC fence_create;
+   PFNEGLCLIENTWAITSYNCKHRPROC fence_wait;
+   PFNEGLDESTROYSYNCKHRPROC fence_destroy;
+   EGLSyncKHR fences[DRM_MAX_FENCES];
+   unsigned fence_count;
+#endif
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import)
+   /* Software frames are written once into DMA-BUF
+    * surfaces the GPU samples from directly, instead of
+    * going through glTexSubImage2D. */
+   PFNEGLCREATEIMAGEKHRPROC image_create;
+   PFNEGLDESTROYIMAGEKHRPROC image_destroy;
+   drm_image_t images[DRM_MAX_IMAGES];
+   unsigned image_size;
+#endif
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+   /* The UI is drawn into buffers shown on an overlay plane
+    * of their own, so it's only drawn again when it changes
+    * instead of every frame. go2_presenter only knows the
+    * primary plane, so this one is driven through a DRM fd
+    * of our own. */
+   enum drm_ui_layer_state ui_state;
+   drm_ui_buffer_t ui_buffers[DRM_UI_BUFFERS];
+   unsigned ui_back;
+   unsigned ui_width;
+   unsigned ui_height;
+   PFNEGLDESTROYIMAGEKHRPROC ui_image_destroy;
+   int ui_fd;
+   uint32_t ui_crtc_id;
+   uint32_t ui_plane_id;
+   /* As last requested by the video driver */
+   bool ui_visible;
+#ifdef HAVE_THREADS
+   /* The plane update present_thread is to do next, in
+    * between page flips. Fence and all are handed over,
+    * a framebuffer of 0 hides the plane. */
+   bool ui_pending;
+   bool ui_busy;
+   uint32_t ui_pending_fb;
+   EGLSyncKHR ui_pending_fence;
+#endif
+#endif
 
    bool core_hw_context_enable;
+#ifdef HAVE_EGL
+   /* drm->egl holds go2's display, surface and context
+    * plus our shared one, see gfx_ctx_drm_hw_context_init */
+   bool hw_ctx_bound;
+#endif
 } gfx_ctx_drm_data_t;
 
+static void gfx_ctx_drm_measure_flip(gfx_ctx_drm_data_t *drm)
+{
+   unsigned i;
+   double mean     = 0.0;
+   double variance = 0.0;
+   retro_time_t now = cpu_features_get_time_usec();
+
+   if (drm->flip_last_time)
+      drm->flip_intervals[drm->flip_count++ % DRM_REFRESH_SAMPLES] =
+         now - drm->flip_last_time;
+   drm->flip_last_time = now;
+
+   if (drm->flip_count < DRM_REFRESH_SAMPLES
+         || drm->flip_count % DRM_REFRESH_SAMPLES)
+      return;
+
+   for (i = 0; i < DRM_REFRESH_SAMPLES; i++)
+      mean += drm->flip_intervals[i];
+   mean /= DRM_REFRESH_SAMPLES;
+
+   for (i = 0; i < DRM_REFRESH_SAMPLES; i++)
+   {
+      double diff = drm->flip_intervals[i] - mean;
+      variance   += diff * diff;
+   }
+   variance /= DRM_REFRESH_SAMPLES;
+
+   /* Only trust windows where we were actually
+    * bound by the page flips, not by the core. */
+   if (mean > 0.0 && sqrt(variance) < mean * 0.02)
+      drm->measured_refresh_rate = (float)(1000000.0 / mean);
+}
+
+static void gfx_ctx_drm_present_surface(gfx_ctx_drm_data_t *drm,
+      go2_surface_t *surface)
+{
+   int i;
+   int flips = drm->interval > 1 ? drm->interval : 1;
+
+   /* Every post queues one page flip, so swap intervals
+    * above 1 are honored by reposting the same surface. */
+   for (i = 0; i < flips; i++)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+
+      if (drm->prerotated)
+         go2_presenter_post(drm->presenter,
+               surface,
+               0, 0, drm->fb_height, drm->fb_width,
+               0, 0, drm->panel_height, drm->panel_width,
+               GO2_ROTATION_DEGREES_0);
+      else
+         go2_presenter_post(drm->presenter,
+               surface,
+               0, 0, drm->fb_width, drm->fb_height,
+               0, 0, drm->panel_height, drm->panel_width,
+               GO2_ROTATION_DEGREES_270);
+
+      rarch_histogram_add(&drm_hist_post,
+            cpu_features_get_time_usec() - start);
+      rarch_trace_end("KMS present", start);
+      latency_test_presented();
+      gfx_ctx_drm_measure_flip(drm);
+   }
+}
+
+/* Applies the measured refresh rate once, the same way
+ * 'Set Display-Reported Refresh Rate' does, so audio rate
+ * control works against the real panel timing. */
+static void gfx_ctx_drm_apply_refresh_rate(gfx_ctx_drm_data_t *drm)
+{
+   float hz;
+   settings_t *settings = config_get_ptr();
+
+   if (drm->refresh_rate_applied || drm->measured_refresh_rate <= 0.0f)
+      return;
+
+   drm->refresh_rate_applied = true;
+   hz                        = drm->measured_refresh_rate;
+
+   RARCH_LOG("[KMS]: Measured refresh rate: %.3f Hz.\n", hz);
+
+   /* Rates can only be adjusted from the main thread. */
+   if (video_driver_is_threaded())
+      return;
+
+   if (fabs(hz - settings->floats.video_refresh_rate) > 0.05f)
+      driver_ctl(RARCH_DRIVER_CTL_SET_REFRESH_RATE, &hz);
+}
+
+static float gfx_ctx_drm_get_refresh_rate(void *data)
+{
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+
+   if (drm && drm->measured_refresh_rate > 0.0f)
+      return drm->measured_refresh_rate;
+
+   return DRM_DEFAULT_REFRESH_RATE;
+}
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+/* Shows @fb_id on the UI plane once the GPU is done with
+ * @fence, or hides the plane if it's 0. Done by whoever does
+ * the page flips, so that the two never race on the CRTC. */
+static bool gfx_ctx_drm_ui_commit(gfx_ctx_drm_data_t *drm,
+      uint32_t fb_id, EGLSyncKHR fence)
+{
+   int ret;
+
+   if (fence != EGL_NO_SYNC_KHR)
+   {
+      drm->fence_wait(drm->fence_display, fence,
+            EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 1000000000);
+      drm->fence_destroy(drm->fence_display, fence);
+   }
+
+   if (fb_id)
+      ret = drmModeSetPlane(drm->ui_fd, drm->ui_plane_id, drm->ui_crtc_id,
+            fb_id, 0,
+            0, 0, drm->panel_height, drm->panel_width,
+            0, 0, drm->ui_width << 16, drm->ui_height << 16);
+   else
+      ret = drmModeSetPlane(drm->ui_fd, drm->ui_plane_id, drm->ui_crtc_id,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+   if (ret == 0)
+      return true;
+
+   RARCH_WARN("[KMS]: Failed to update the UI plane, "
+         "drawing the UI over the frame.\n");
+   return false;
+}
+#endif
+
+#ifdef HAVE_THREADS
+static void gfx_ctx_drm_present_thread(void *data)
+{
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+
+   slock_lock(drm->present_lock);
+
+   for (;;)
+   {
+      drm_present_slot_t *slot = NULL;
+
+      while (!drm->present_quit &&
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+            !drm->ui_pending &&
+#endif
+            drm->present_slots[drm->present_read].state
+            != DRM_PRESENT_QUEUED)
+         scond_wait(drm->present_cond, drm->present_lock);
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+      if (drm->ui_pending)
+      {
+         bool shown;
+         uint32_t fb_id   = drm->ui_pending_fb;
+         EGLSyncKHR fence = drm->ui_pending_fence;
+
+         drm->ui_pending  = false;
+         drm->ui_busy     = true;
+
+         slock_unlock(drm->present_lock);
+         shown = gfx_ctx_drm_ui_commit(drm, fb_id, fence);
+         slock_lock(drm->present_lock);
+
+         if (!shown)
+            drm->ui_state = DRM_UI_LAYER_FAILED;
+         drm->ui_busy     = false;
+         scond_broadcast(drm->present_cond);
+         continue;
+      }
+#endif
+
+      slot = &drm->present_slots[drm->present_read];
+
+      /* Drain whatever is still queued before quitting,
+       * so that every locked surface is accounted for. */
+      if (slot->state != DRM_PRESENT_QUEUED)
+         break;
+
+      slock_unlock(drm->present_lock);
+      gfx_ctx_drm_present_surface(drm, slot->surface);
+      slock_lock(drm->present_lock);
+
+      slot->state        = DRM_PRESENT_POSTED;
+      drm->present_read  = (drm->present_read + 1) % DRM_PRESENT_QUEUE_SIZE;
+      scond_broadcast(drm->present_cond);
+   }
+
+   slock_unlock(drm->present_lock);
+}
+
+/* Unlocks all surfaces the present thread is done with.
+ * Must be called with present_lock held. Returns the
+ * number of surfaces which are still locked. */
+static unsigned gfx_ctx_drm_present_reclaim(gfx_ctx_drm_data_t *drm)
+{
+   unsigned i;
+   unsigned locked = 0;
+
+   for (i = 0; i < DRM_PRESENT_QUEUE_SIZE; i++)
+   {
+      drm_present_slot_t *slot = &drm->present_slots[i];
+
+      if (slot->state == DRM_PRESENT_POSTED)
+      {
+         go2_context_surface_unlock(drm->context, slot->surface);
+         slot->surface = NULL;
+         slot->state   = DRM_PRESENT_FREE;
+      }
+      else if (slot->state == DRM_PRESENT_QUEUED)
+         locked++;
+   }
+
+   return locked;
+}
+
+static void gfx_ctx_drm_present_queue(gfx_ctx_drm_data_t *drm,
+      go2_surface_t *surface)
+{
+   drm_present_slot_t *slot = NULL;
+   retro_time_t start       = cpu_features_get_time_usec();
+
+   slock_lock(drm->present_lock);
+
+   /* Apply back-pressure: block until the amount of
+    * surfaces in flight drops below the limit. */
+   while (gfx_ctx_drm_present_reclaim(drm) >= drm->present_max_locked)
+      scond_wait(drm->present_cond, drm->present_lock);
+
+   rarch_histogram_add(&drm_hist_queue,
+         cpu_features_get_time_usec() - start);
+
+   slot          = &drm->present_slots[drm->present_write];
+   slot->surface = surface;
+   slot->state   = DRM_PRESENT_QUEUED;
+
+   drm->present_write = (drm->present_write + 1) % DRM_PRESENT_QUEUE_SIZE;
+
+   scond_broadcast(drm->present_cond);
+   slock_unlock(drm->present_lock);
+}
+
+static void gfx_ctx_drm_present_init(gfx_ctx_drm_data_t *drm,
+      unsigned swapchain_images)
+{
+   /* One image is always owned by GL as the render target,
+    * the rest can be locked by the presentation queue.
+    * With two or fewer images there is nothing to gain
+    * from pipelining, so present synchronously. */
+   if (swapchain_images < 3 || drm->present_thread)
+      return;
+
+   drm->present_max_locked = swapchain_images - 2;
+   if (drm->present_max_locked > DRM_PRESENT_QUEUE_SIZE - 1)
+      drm->present_max_locked = DRM_PRESENT_QUEUE_SIZE - 1;
+
+   drm->present_lock   = slock_new();
+   drm->present_cond   = scond_new();
+   drm->present_quit   = false;
+   drm->present_write  = 0;
+   drm->present_read   = 0;
+   memset(drm->present_slots, 0, sizeof(drm->present_slots));
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+   drm->ui_pending     = false;
+   drm->ui_busy        = false;
+#endif
+
+   if (drm->present_lock && drm->present_cond)
+      drm->present_thread = sthread_create(
+            gfx_ctx_drm_present_thread, drm);
+
+   if (!drm->present_thread)
+   {
+      RARCH_WARN("[KMS]: Failed to create present thread, presenting synchronously.\n");
+      if (drm->present_cond)
+         scond_free(drm->present_cond);
+      if (drm->present_lock)
+         slock_free(drm->present_lock);
+      drm->present_cond = NULL;
+      drm->present_lock = NULL;
+      return;
+   }
+
+   RARCH_LOG("[KMS]: Pipelined presentation enabled (%u frame(s) in flight).\n",
+         drm->present_max_locked);
+}
+
+static void gfx_ctx_drm_present_deinit(gfx_ctx_drm_data_t *drm)
+{
+   if (!drm->present_thread)
+      return;
+
+   slock_lock(drm->present_lock);
+   drm->present_quit = true;
+   scond_broadcast(drm->present_cond);
+   slock_unlock(drm->present_lock);
+
+   sthread_join(drm->present_thread);
+   drm->present_thread = NULL;
+
+   /* The thread drained the queue, so every remaining
+    * surface has been posted and can be released. */
+   gfx_ctx_drm_present_reclaim(drm);
+
+   scond_free(drm->present_cond);
+   slock_free(drm->present_lock);
+   drm->present_cond = NULL;
+   drm->present_lock = NULL;
+}
+#endif
+
+
+#if defined(HAVE_EGL) && defined(EGL_KHR_fence_sync)
+static void gfx_ctx_drm_fence_init(gfx_ctx_drm_data_t *drm)
+{
+   const char *extensions = NULL;
+
+   drm->fence_display = (EGLDisplay)
+      go2_context_egldisplay_get(drm->context);
+   drm->fence_count   = 0;
+   drm->fence_create  = NULL;
+   drm->fence_wait    = NULL;
+   drm->fence_destroy = NULL;
+
+   extensions = eglQueryString(drm->fence_display, EGL_EXTENSIONS);
+
+   if (!extensions || !strstr(extensions, "EGL_KHR_fence_sync"))
+   {
+      RARCH_WARN("[KMS]: EGL_KHR_fence_sync not supported, "
+            "frames in flight are not limited.\n");
+      return;
+   }
+
+   drm->fence_create  = (PFNEGLCREATESYNCKHRPROC)
+      eglGetProcAddress("eglCreateSyncKHR");
+   drm->fence_wait    = (PFNEGLCLIENTWAITSYNCKHRPROC)
+      eglGetProcAddress("eglClientWaitSyncKHR");
+   drm->fence_destroy = (PFNEGLDESTROYSYNCKHRPROC)
+      eglGetProcAddress("eglDestroySyncKHR");
+
+   if (!drm->fence_create || !drm->fence_wait || !drm->fence_destroy)
+      drm->fence_create = NULL;
+}
+
+static void gfx_ctx_drm_fence_iterate(gfx_ctx_drm_data_t *drm,
+      unsigned max_frames)
+{
+   EGLSyncKHR fence;
+
+   if (!drm->fence_create)
+      return;
+
+   if (max_frames > DRM_MAX_FENCES - 1)
+      max_frames = DRM_MAX_FENCES - 1;
+
+   fence = drm->fence_create(drm->fence_display,
+         EGL_SYNC_FENCE_KHR, NULL);
+
+   if (fence != EGL_NO_SYNC_KHR)
+      drm->fences[drm->fence_count++] = fence;
+
+   while (drm->fence_count > max_frames)
+   {
+      drm->fence_wait(drm->fence_display, drm->fences[0],
+            EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 1000000000);
+      drm->fence_destroy(drm->fence_display, drm->fences[0]);
+
+      drm->fence_count--;
+      memmove(drm->fences, drm->fences + 1,
+            drm->fence_count * sizeof(EGLSyncKHR));
+   }
+}
+
+static void gfx_ctx_drm_fence_free(gfx_ctx_drm_data_t *drm)
+{
+   unsigned i;
+
+   if (!drm->fence_create)
+      return;
+
+   for (i = 0; i < drm->fence_count; i++)
+   {
+      drm->fence_wait(drm->fence_display, drm->fences[i],
+            EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 1000000000);
+      drm->fence_destroy(drm->fence_display, drm->fences[i]);
+   }
+   drm->fence_count = 0;
+}
+#endif
+
+#ifdef HAVE_EGL
+/* libgo2 creates the EGL context itself, so the frontend's
+ * context is taken over from it and the context for hardware
+ * rendered cores is created to share objects with it. The
+ * core then renders straight into the gl driver's FBO. */
+static bool gfx_ctx_drm_hw_context_init(gfx_ctx_drm_data_t *drm)
+{
+   EGLint config_id      = 0;
+   EGLint client_version = 0;
+   EGLint num_configs    = 0;
+   EGLint config_attribs[3];
+   EGLint context_attribs[3];
+   egl_ctx_data_t *egl   = &drm->egl;
+
+   egl->dpy    = (EGLDisplay)go2_context_egldisplay_get(drm->context);
+   egl->ctx    = eglGetCurrentContext();
+   egl->surf   = eglGetCurrentSurface(EGL_DRAW);
+   egl->hw_ctx = EGL_NO_CONTEXT;
+
+   if (     !eglQueryContext(egl->dpy, egl->ctx, EGL_CONFIG_ID, &config_id)
+         || !eglQueryContext(egl->dpy, egl->ctx,
+            EGL_CONTEXT_CLIENT_VERSION, &client_version))
+      return false;
+
+   config_attribs[0]  = EGL_CONFIG_ID;
+   config_attribs[1]  = config_id;
+   config_attribs[2]  = EGL_NONE;
+
+   if (     !eglChooseConfig(egl->dpy, config_attribs,
+            &egl->config, 1, &num_configs)
+         || num_configs < 1)
+      return false;
+
+   context_attribs[0] = EGL_CONTEXT_CLIENT_VERSION;
+   context_attribs[1] = client_version;
+   context_attribs[2] = EGL_NONE;
+
+   egl->hw_ctx = eglCreateContext(egl->dpy, egl->config, egl->ctx,
+         context_attribs);
+
+   if (egl->hw_ctx == EGL_NO_CONTEXT)
+      return false;
+
+   RARCH_LOG("[KMS]: Created shared context: %p.\n", (void*)egl->hw_ctx);
+
+   drm->hw_ctx_bound = false;
+   return true;
+}
+
+/* Leaves go2's own context current; it's destroyed by libgo2 */
+static void gfx_ctx_drm_hw_context_free(gfx_ctx_drm_data_t *drm)
+{
+   egl_ctx_data_t *egl = &drm->egl;
+
+   if (egl->hw_ctx != EGL_NO_CONTEXT)
+   {
+      eglMakeCurrent(egl->dpy, egl->surf, egl->surf, egl->ctx);
+      eglDestroyContext(egl->dpy, egl->hw_ctx);
+   }
+
+   egl->hw_ctx       = EGL_NO_CONTEXT;
+   egl->ctx          = EGL_NO_CONTEXT;
+   egl->surf         = EGL_NO_SURFACE;
+   egl->dpy          = EGL_NO_DISPLAY;
+   drm->hw_ctx_bound = false;
+}
+#endif
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import)
+static void gfx_ctx_drm_image_free(gfx_ctx_drm_data_t *drm,
+      drm_image_t *img)
+{
+   EGLDisplay dpy = (EGLDisplay)go2_context_egldisplay_get(drm->context);
+
+   if (img->image != EGL_NO_IMAGE_KHR)
+      drm->image_destroy(dpy, img->image);
+   if (img->map)
+      go2_surface_unmap(img->surface);
+   if (img->surface)
+      go2_surface_destroy(img->surface);
+
+   img->image   = EGL_NO_IMAGE_KHR;
+   img->map     = NULL;
+   img->surface = NULL;
+   img->format  = 0;
+}
+
+static void gfx_ctx_drm_image_buffer_deinit(gfx_ctx_drm_data_t *drm)
+{
+   unsigned i;
+
+   if (!drm->image_create)
+      return;
+
+   for (i = 0; i < DRM_MAX_IMAGES; i++)
+      gfx_ctx_drm_image_free(drm, &drm->images[i]);
+
+   drm->image_create  = NULL;
+   drm->image_destroy = NULL;
+}
+
+static bool gfx_ctx_drm_image_alloc(gfx_ctx_drm_data_t *drm,
+      drm_image_t *img, uint32_t format)
+{
+   int fd;
+   EGLint attribs[13];
+   EGLDisplay dpy  = (EGLDisplay)go2_context_egldisplay_get(drm->context);
+
+   gfx_ctx_drm_image_free(drm, img);
+
+   img->surface    = go2_surface_create(drm->display,
+         drm->image_size, drm->image_size, format);
+   if (!img->surface)
+      return false;
+
+   img->map        = (uint8_t*)go2_surface_map(img->surface);
+   fd              = go2_surface_prime_fd(img->surface);
+
+   if (!img->map || fd < 0)
+      goto error;
+
+   attribs[0]      = EGL_WIDTH;
+   attribs[1]      = drm->image_size;
+   attribs[2]      = EGL_HEIGHT;
+   attribs[3]      = drm->image_size;
+   attribs[4]      = EGL_LINUX_DRM_FOURCC_EXT;
+   attribs[5]      = format;
+   attribs[6]      = EGL_DMA_BUF_PLANE0_FD_EXT;
+   attribs[7]      = fd;
+   attribs[8]      = EGL_DMA_BUF_PLANE0_OFFSET_EXT;
+   attribs[9]      = 0;
+   attribs[10]     = EGL_DMA_BUF_PLANE0_PITCH_EXT;
+   attribs[11]     = go2_surface_stride_get(img->surface);
+   attribs[12]     = EGL_NONE;
+
+   img->image      = drm->image_create(dpy, EGL_NO_CONTEXT,
+         EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)NULL, attribs);
+
+   /* The EGLImage holds its own reference to the buffer. */
+   close(fd);
+
+   if (img->image == EGL_NO_IMAGE_KHR)
+      goto error;
+
+   img->format     = format;
+   return true;
+
+error:
+   gfx_ctx_drm_image_free(drm, img);
+   return false;
+}
+
+static bool gfx_ctx_drm_image_buffer_init(void *data,
+      const video_info_t *video)
+{
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+   const char *extensions  = NULL;
+
+   if (!drm || !drm->context)
+      return false;
+
+   gfx_ctx_drm_image_buffer_deinit(drm);
+
+   extensions = eglQueryString((EGLDisplay)
+         go2_context_egldisplay_get(drm->context), EGL_EXTENSIONS);
+
+   if (!extensions || !strstr(extensions, "EGL_EXT_image_dma_buf_import"))
+      return false;
+
+   drm->image_create  = (PFNEGLCREATEIMAGEKHRPROC)
+      eglGetProcAddress("eglCreateImageKHR");
+   drm->image_destroy = (PFNEGLDESTROYIMAGEKHRPROC)
+      eglGetProcAddress("eglDestroyImageKHR");
+
+   if (!drm->image_create || !drm->image_destroy)
+   {
+      drm->image_create = NULL;
+      return false;
+   }
+
+   /* Matches the texture size the gl driver allocates. */
+   drm->image_size = video->input_scale * RARCH_SCALE_BASE;
+
+   RARCH_LOG("[KMS]: Uploading frames through %ux%u DMA-BUF EGLImages.\n",
+         drm->image_size, drm->image_size);
+   return true;
+}
+
+static bool gfx_ctx_drm_image_buffer_write(void *data, const void *frame,
+      unsigned width, unsigned height, unsigned pitch, bool rgb32,
+      unsigned index, void **image_handle)
+{
+   unsigned h;
+   unsigned stride;
+   uint8_t *dst;
+   const uint8_t *src;
+   bool ret                = false;
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+   uint32_t format         = rgb32
+      ? DRM_FORMAT_XRGB8888 : DRM_FORMAT_RGB565;
+   drm_image_t *img;
+
+   if (!drm || !drm->image_create || index >= DRM_MAX_IMAGES)
+      goto error;
+
+   img = &drm->images[index];
+
+   if (!img->surface || img->format != format)
+   {
+      if (!gfx_ctx_drm_image_alloc(drm, img, format))
+      {
+         RARCH_ERR("[KMS]: Failed to create DMA-BUF EGLImage.\n");
+         goto error;
+      }
+      ret = true;
+   }
+
+   if (width > drm->image_size)
+      width  = drm->image_size;
+   if (height > drm->image_size)
+      height = drm->image_size;
+
+   /* The gl driver cycles through its textures, and the
+    * frame fences bound how far the GPU lags behind, so
+    * this image is no longer being sampled from. */
+   stride = go2_surface_stride_get(img->surface);
+   dst    = img->map;
+   src    = (const uint8_t*)frame;
+
+   for (h = 0; h < height; h++, dst += stride, src += pitch)
+      memcpy(dst, src, width * (rgb32 ? 4 : 2));
+
+   *image_handle = img->image;
+   return ret;
+
+error:
+   *image_handle = NULL;
+   return false;
+}
+
+#endif
+
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+/* libgo2 keeps its DRM fd to itself, so the UI plane gets a
+ * card of its own, found the same way the other KMS drivers
+ * find theirs. Returns the fd, with g_crtc_id set to the CRTC
+ * of the connector in use. */
+static int gfx_ctx_drm_ui_open(video_frame_info_t *video_info)
+{
+   unsigned i;
+   int fd                    = -1;
+   struct string_list *cards = dir_list_new("/dev/dri", NULL,
+         false, true, false, false);
+
+   if (!cards)
+      return -1;
+
+   for (i = 0; i < cards->size && fd < 0; i++)
+   {
+      const char *path = cards->elems[i].data;
+
+      /* Render nodes can't do modesetting */
+      if (strncmp(path_basename(path), "card", STRLEN_CONST("card")))
+         continue;
+
+      fd = open(path, O_RDWR | O_CLOEXEC);
+      if (fd < 0)
+         continue;
+
+      if (     drm_get_resources(fd)
+            && drm_get_connector(fd, video_info)
+            && drm_get_encoder(fd))
+      {
+         drm_setup(fd);
+
+         /* libgo2 drives the CRTC, there's nothing to restore */
+         if (g_orig_crtc)
+            drmModeFreeCrtc(g_orig_crtc);
+         g_orig_crtc = NULL;
+      }
+      else
+      {
+         close(fd);
+         fd = -1;
+      }
+
+      drm_free();
+   }
+
+   dir_list_free(cards);
+   return fd;
+}
+
+static uint64_t gfx_ctx_drm_plane_type(int fd, uint32_t plane_id)
+{
+   unsigned i;
+   uint64_t type                   = DRM_PLANE_TYPE_OVERLAY + 1;
+   drmModeObjectProperties *props  = drmModeObjectGetProperties(fd,
+         plane_id, DRM_MODE_OBJECT_PLANE);
+
+   if (!props)
+      return type;
+
+   for (i = 0; i < props->count_props; i++)
+   {
+      drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
+
+      if (!prop)
+         continue;
+      if (string_is_equal(prop->name, "type"))
+         type = props->prop_values[i];
+      drmModeFreeProperty(prop);
+   }
+
+   drmModeFreeObjectProperties(props);
+   return type;
+}
+
+/* An unused overlay plane that can show ARGB8888
+ * on the CRTC libgo2 presents on. */
+static bool gfx_ctx_drm_ui_find_plane(gfx_ctx_drm_data_t *drm)
+{
+   unsigned i, j;
+   int crtc_index           = -1;
+   drmModePlaneRes *planes  = NULL;
+   drmModeRes *res          = drmModeGetResources(drm->ui_fd);
+
+   if (!res)
+      return false;
+
+   for (i = 0; i < (unsigned)res->count_crtcs; i++)
+   {
+      if (res->crtcs[i] == drm->ui_crtc_id)
+      {
+         crtc_index = i;
+         break;
+      }
+   }
+
+   drmModeFreeResources(res);
+
+   if (crtc_index < 0)
+      return false;
+
+   planes = drmModeGetPlaneResources(drm->ui_fd);
+   if (!planes)
+      return false;
+
+   for (i = 0; i < planes->count_planes && !drm->ui_plane_id; i++)
+   {
+      drmModePlane *plane = drmModeGetPlane(drm->ui_fd, planes->planes[i]);
+
+      if (!plane)
+         continue;
+
+      if (     (plane->possible_crtcs & (1u << crtc_index))
+            && !plane->crtc_id && !plane->fb_id
+            && gfx_ctx_drm_plane_type(drm->ui_fd, plane->plane_id)
+            == DRM_PLANE_TYPE_OVERLAY)
+      {
+         for (j = 0; j < plane->count_formats; j++)
+         {
+            if (plane->formats[j] == DRM_FORMAT_ARGB8888)
+            {
+               drm->ui_plane_id = plane->plane_id;
+               break;
+            }
+         }
+      }
+      drmModeFreePlane(plane);
+   }
+
+   drmModeFreePlaneResources(planes);
+   return drm->ui_plane_id != 0;
+}
+
+/* Only called while present_thread has no plane update
+ * pending or in progress. */
+static void gfx_ctx_drm_ui_free(gfx_ctx_drm_data_t *drm)
+{
+   unsigned i;
+   EGLDisplay dpy = (EGLDisplay)go2_context_egldisplay_get(drm->context);
+
+   if (drm->ui_visible)
+      drmModeSetPlane(drm->ui_fd, drm->ui_plane_id, drm->ui_crtc_id,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+   for (i = 0; i < DRM_UI_BUFFERS; i++)
+   {
+      drm_ui_buffer_t *buf = &drm->ui_buffers[i];
+
+      if (buf->fbo)
+         glDeleteFramebuffers(1, &buf->fbo);
+      if (buf->tex)
+         glDeleteTextures(1, &buf->tex);
+      if (buf->fb_id)
+         drmModeRmFB(drm->ui_fd, buf->fb_id);
+      if (buf->image != EGL_NO_IMAGE_KHR)
+         drm->ui_image_destroy(dpy, buf->image);
+      if (buf->surface)
+         go2_surface_destroy(buf->surface);
+
+      memset(buf, 0, sizeof(*buf));
+      buf->image = EGL_NO_IMAGE_KHR;
+   }
+
+   if (drm->ui_fd >= 0)
+      close(drm->ui_fd);
+
+   drm->ui_fd       = -1;
+   drm->ui_plane_id = 0;
+   drm->ui_visible  = false;
+   drm->ui_state    = DRM_UI_LAYER_FAILED;
+}
+
+static bool gfx_ctx_drm_ui_buffer_init(gfx_ctx_drm_data_t *drm,
+      drm_ui_buffer_t *buf, PFNEGLCREATEIMAGEKHRPROC image_create)
+{
+   EGLint attribs[13];
+   uint32_t handles[4] = {0};
+   uint32_t pitches[4] = {0};
+   uint32_t offsets[4] = {0};
+   uint32_t handle     = 0;
+   EGLDisplay dpy      = (EGLDisplay)go2_context_egldisplay_get(drm->context);
+   int fd;
+
+   buf->image   = EGL_NO_IMAGE_KHR;
+   buf->surface = go2_surface_create(drm->display,
+         drm->ui_width, drm->ui_height, DRM_FORMAT_ARGB8888);
+   if (!buf->surface)
+      return false;
+
+   fd = go2_surface_prime_fd(buf->surface);
+   if (fd < 0)
+      return false;
+
+   /* A handle on our own fd, released when it's closed */
+   handles[0] = drmPrimeFDToHandle(drm->ui_fd, fd, &handle) == 0
+      ? handle : 0;
+   pitches[0] = go2_surface_stride_get(buf->surface);
+
+   attribs[0]  = EGL_WIDTH;
+   attribs[1]  = drm->ui_width;
+   attribs[2]  = EGL_HEIGHT;
+   attribs[3]  = drm->ui_height;
+   attribs[4]  = EGL_LINUX_DRM_FOURCC_EXT;
+   attribs[5]  = DRM_FORMAT_ARGB8888;
+   attribs[6]  = EGL_DMA_BUF_PLANE0_FD_EXT;
+   attribs[7]  = fd;
+   attribs[8]  = EGL_DMA_BUF_PLANE0_OFFSET_EXT;
+   attribs[9]  = 0;
+   attribs[10] = EGL_DMA_BUF_PLANE0_PITCH_EXT;
+   attribs[11] = pitches[0];
+   attribs[12] = EGL_NONE;
+
+   buf->image  = image_create(dpy, EGL_NO_CONTEXT,
+         EGL_LINUX_DMA_BUF_EXT, (EGLClientBuffer)NULL, attribs);
+   close(fd);
+
+   if (     !handles[0]
+         || buf->image == EGL_NO_IMAGE_KHR
+         || drmModeAddFB2(drm->ui_fd, drm->ui_width, drm->ui_height,
+            DRM_FORMAT_ARGB8888, handles, pitches, offsets,
+            &buf->fb_id, 0) != 0)
+      return false;
+
+   glGenTextures(1, &buf->tex);
+   glBindTexture(GL_TEXTURE_2D, buf->tex);
+   glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, (GLeglImageOES)buf->image);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   glGenFramebuffers(1, &buf->fbo);
+   glBindFramebuffer(GL_FRAMEBUFFER, buf->fbo);
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+         GL_TEXTURE_2D, buf->tex, 0);
+
+   return glCheckFramebufferStatus(GL_FRAMEBUFFER)
+      == GL_FRAMEBUFFER_COMPLETE;
+}
+
+/* Only pre-rotated rendering has a surface in panel
+ * orientation, otherwise the RGA rotates it on the way
+ * to the primary plane, which a plane above can't follow. */
+static bool gfx_ctx_drm_ui_init(gfx_ctx_drm_data_t *drm,
+      video_frame_info_t *video_info)
+{
+   unsigned i;
+   PFNEGLCREATEIMAGEKHRPROC image_create;
+   const char *extensions = eglQueryString((EGLDisplay)
+         go2_context_egldisplay_get(drm->context), EGL_EXTENSIONS);
+
+   drm->ui_fd = -1;
+
+   /* Fenced, so that the plane isn't scanned out half drawn */
+   if (!drm->fence_create)
+      return false;
+
+   if (!extensions || !strstr(extensions, "EGL_EXT_image_dma_buf_import"))
+      return false;
+
+   image_create          = (PFNEGLCREATEIMAGEKHRPROC)
+      eglGetProcAddress("eglCreateImageKHR");
+   drm->ui_image_destroy = (PFNEGLDESTROYIMAGEKHRPROC)
+      eglGetProcAddress("eglDestroyImageKHR");
+
+   if (!image_create || !drm->ui_image_destroy)
+      return false;
+
+   drm->ui_fd = gfx_ctx_drm_ui_open(video_info);
+   if (drm->ui_fd < 0)
+      return false;
+   drm->ui_crtc_id = g_crtc_id;
+
+   if (drmSetClientCap(drm->ui_fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0
+         || !gfx_ctx_drm_ui_find_plane(drm))
+      return false;
+
+   /* Setting planes takes DRM master, which is libgo2's if
+    * it got the card first. Hiding the unused plane tells. */
+   if (drmModeSetPlane(drm->ui_fd, drm->ui_plane_id, drm->ui_crtc_id,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0) != 0)
+   {
+      RARCH_WARN("[KMS]: Not allowed to set overlay plane %u.\n",
+            drm->ui_plane_id);
+      return false;
+   }
+
+   drm->ui_width  = drm->fb_height;
+   drm->ui_height = drm->fb_width;
+   drm->ui_back   = 0;
+
+   for (i = 0; i < DRM_UI_BUFFERS; i++)
+      if (!gfx_ctx_drm_ui_buffer_init(drm, &drm->ui_buffers[i],
+               image_create))
+         return false;
+
+   RARCH_LOG("[KMS]: Drawing the UI on overlay plane %u.\n",
+         drm->ui_plane_id);
+   return true;
+}
+
+static bool gfx_ctx_drm_ui_layer_begin(void *data)
+{
+   bool ready              = false;
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+
+   if (!drm || drm->ui_state != DRM_UI_LAYER_READY)
+      return false;
+
+#ifdef HAVE_THREADS
+   /* The back buffer may be on screen until the update
+    * that shows the other one is through. */
+   if (drm->present_thread)
+   {
+      slock_lock(drm->present_lock);
+      while (drm->ui_pending || drm->ui_busy)
+         scond_wait(drm->present_cond, drm->present_lock);
+      ready = drm->ui_state == DRM_UI_LAYER_READY;
+      slock_unlock(drm->present_lock);
+   }
+   else
+#endif
+      ready = true;
+
+   /* The last update failed */
+   if (!ready)
+   {
+      drm->ui_visible = false;
+      gfx_ctx_drm_ui_free(drm);
+      return false;
+   }
+
+   glBindFramebuffer(GL_FRAMEBUFFER, drm->ui_buffers[drm->ui_back].fbo);
+   return true;
+}
+
+static void gfx_ctx_drm_ui_layer_end(void *data, bool visible)
+{
+   uint32_t fb_id          = 0;
+   EGLSyncKHR fence        = EGL_NO_SYNC_KHR;
+   gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
+
+   if (!drm || drm->ui_state != DRM_UI_LAYER_READY)
+      return;
+
+   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+   if (visible)
+   {
+      fb_id = drm->ui_buffers[drm->ui_back].fb_id;
+      fence = drm->fence_create(drm->fence_display,
+            EGL_SYNC_FENCE_KHR, NULL);
+      if (fence == EGL_NO_SYNC_KHR)
+         glFinish();
+
+      drm->ui_back = (drm->ui_back + 1) % DRM_UI_BUFFERS;
+   }
+   else if (!drm->ui_visible)
+      return;
+
+   drm->ui_visible = visible;
+
+#ifdef HAVE_THREADS
+   if (drm->present_thread)
+   {
+      slock_lock(drm->present_lock);
+
+      /* A hide doesn't wait in ui_layer_begin, it replaces
+       * a show that's still pending */
+      if (drm->ui_pending && drm->ui_pending_fence != EGL_NO_SYNC_KHR)
+         drm->fence_destroy(drm->fence_display, drm->ui_pending_fence);
+
+      drm->ui_pending       = true;
+      drm->ui_pending_fb    = fb_id;
+      drm->ui_pending_fence = fence;
+      scond_broadcast(drm->present_cond);
+      slock_unlock(drm->present_lock);
+      return;
+   }
+#endif
+
+   if (!gfx_ctx_drm_ui_commit(drm, fb_id, fence))
+   {
+      drm->ui_visible = false;
+      gfx_ctx_drm_ui_free(drm);
+   }
+}
+#endif
 
 static void gfx_ctx_drm_input_driver(void *data,
       const char *joypad_name,
@@ -158,6 +1344,17 @@ static void *gfx_ctx_drm_init(video_frame_info_t *video_info, void *video_driver
    drm->display = go2_display_create();
    drm->presenter = go2_presenter_create(drm->display, DRM_FORMAT_RGB565, 0xff080808);
 
+   rarch_histogram_register(&drm_hist_swap,  "KMS swap");
+   rarch_histogram_register(&drm_hist_lock,  "KMS lock");
+   rarch_histogram_register(&drm_hist_queue, "KMS queue wait");
+   rarch_histogram_register(&drm_hist_post,  "KMS post");
+   rarch_histogram_register(&drm_hist_frame, "KMS frame");
+   rarch_histogram_reset(&drm_hist_swap);
+   rarch_histogram_reset(&drm_hist_lock);
+   rarch_histogram_reset(&drm_hist_queue);
+   rarch_histogram_reset(&drm_hist_post);
+   rarch_histogram_reset(&drm_hist_frame);
+
    return drm;
 }
 
@@ -166,8 +1363,29 @@ static void gfx_ctx_drm_destroy(void *data)
    gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
    if (!drm) return;
 
+#ifdef HAVE_THREADS
+   gfx_ctx_drm_present_deinit(drm);
+#endif
+
+   RARCH_LOG("[KMS]: Present timings:\n");
+   rarch_histogram_log();
+
    if (drm->context)
    {
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+      /* After present_thread, which may still have shown it */
+      if (drm->ui_state == DRM_UI_LAYER_READY)
+         gfx_ctx_drm_ui_free(drm);
+#endif
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import)
+      gfx_ctx_drm_image_buffer_deinit(drm);
+#endif
+#if defined(HAVE_EGL) && defined(EGL_KHR_fence_sync)
+      gfx_ctx_drm_fence_free(drm);
+#endif
+#ifdef HAVE_EGL
+      gfx_ctx_drm_hw_context_free(drm);
+#endif
       go2_context_destroy(drm->context);
       drm->context = NULL;
    }
@@ -177,6 +1395,9 @@ static void gfx_ctx_drm_destroy(void *data)
 
    go2_display_destroy(drm->display);
    drm->display = NULL;
+
+   video_driver_set_surface_rotation(0);
+   video_driver_set_present_wait(-1);
 }
 
 static enum gfx_ctx_api gfx_ctx_drm_get_api(void *data)
@@ -235,9 +1456,27 @@ static void gfx_ctx_drm_swap_interval(void *data, int interval)
 {
    gfx_ctx_drm_data_t *drm = (gfx_ctx_drm_data_t*)data;
    drm->interval           = interval;
+}
+
+/* Picks the color depth of the render target. In auto mode,
+ * software cores which output RGB565 get a 16-bit buffer,
+ * halving framebuffer bandwidth. */
+static unsigned gfx_ctx_drm_get_color_depth(settings_t *settings)
+{
+   switch (settings->uints.video_kms_color_depth)
+   {
+      case 16:
+      case 32:
+         return settings->uints.video_kms_color_depth;
+      default:
+         break;
+   }
+
+   if (  !video_driver_is_hw_context() &&
+         video_driver_get_pixel_format() != RETRO_PIXEL_FORMAT_XRGB8888)
+      return 16;
 
-   if (interval > 1)
-      RARCH_WARN("[KMS]: Swap intervals > 1 currently not supported. Will use swap interval of 1.\n");
+   return 32;
 }
 
 static bool gfx_ctx_drm_set_video_mode(void *data,
@@ -246,34 +1485,113 @@ static bool gfx_ctx_drm_set_video_mode(void *data,
       bool fullscreen)
 {
    gfx_ctx_drm_data_t *drm     = (gfx_ctx_drm_data_t*)data;
+   settings_t *settings        = config_get_ptr();
 
    if (!drm)
       return false;
 
    frontend_driver_install_signal_handler();
 
-   drm->fb_width    = 480;
-   drm->fb_height   = 320;
+   /* The panel is mounted in portrait orientation. */
+   drm->panel_width  = go2_display_height_get(drm->display);
+   drm->panel_height = go2_display_width_get(drm->display);
 
    if (!drm->context)
    {
+      unsigned surface_width, surface_height;
+      unsigned color_depth = gfx_ctx_drm_get_color_depth(settings);
       go2_context_attributes_t attr;
-      attr.major = 3;
-      attr.minor = 2;
-      attr.red_bits = 8;
-      attr.green_bits = 8;
-      attr.blue_bits = 8;
-      attr.alpha_bits = 8;
-      attr.depth_bits = 0;
+
+      /* Rendering below panel resolution is cheap to
+       * upscale, since the RGA scales in the same pass
+       * it rotates in. */
+      drm->fb_width    = width  ? width  : drm->panel_width;
+      drm->fb_height   = height ? height : drm->panel_height;
+
+      if (drm->fb_width > drm->panel_width)
+         drm->fb_width  = drm->panel_width;
+      if (drm->fb_height > drm->panel_height)
+         drm->fb_height = drm->panel_height;
+
+      surface_width     = drm->fb_width;
+      surface_height    = drm->fb_height;
+
+      attr.major        = 3;
+      attr.minor        = 2;
+      attr.red_bits     = color_depth == 16 ? 5 : 8;
+      attr.green_bits   = color_depth == 16 ? 6 : 8;
+      attr.blue_bits    = color_depth == 16 ? 5 : 8;
+      attr.alpha_bits   = color_depth == 16 ? 0 : 8;
+      attr.depth_bits   = 0;
       attr.stencil_bits = 0;
 
-      drm->context = go2_context_create(drm->display, 480, 320, &attr);
+      RARCH_LOG("[KMS]: Rendering at %ux%u, %u bpp.\n",
+            drm->fb_width, drm->fb_height, color_depth);
+
+      /* Pre-rotation is implemented by the gl driver only. */
+      drm->prerotated = settings->bools.video_kms_prerotate &&
+         string_is_equal(video_driver_get_ident(), "gl");
+
+      if (drm->prerotated)
+      {
+         surface_width  = drm->fb_height;
+         surface_height = drm->fb_width;
+         RARCH_LOG("[KMS]: Rendering pre-rotated into a %ux%u surface.\n",
+               surface_width, surface_height);
+      }
+
+      video_driver_set_surface_rotation(drm->prerotated ? 270 : 0);
+
+      drm->context = go2_context_create(drm->display,
+            surface_width, surface_height, &attr);
+
+      go2_context_make_current(drm->context);
+
+#ifdef HAVE_EGL
+      /* Set by bind_hw_render before the video mode is */
+      if (drm->egl.use_hw_ctx && !gfx_ctx_drm_hw_context_init(drm))
+      {
+         RARCH_ERR("[KMS]: Failed to create shared context.\n");
+         gfx_ctx_drm_hw_context_free(drm);
+         return false;
+      }
+#endif
    }
+   else
+   {
+      go2_context_make_current(drm->context);
+#ifdef HAVE_EGL
+      drm->hw_ctx_bound = false;
+#endif
+   }
+
+#if defined(HAVE_EGL) && defined(EGL_KHR_fence_sync)
+   gfx_ctx_drm_fence_free(drm);
+   gfx_ctx_drm_fence_init(drm);
+#endif
 
-   go2_context_make_current(drm->context);
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+   /* Set up once, the video driver only draws into it */
+   if (drm->prerotated && drm->ui_state == DRM_UI_LAYER_UNTRIED)
+   {
+      if (gfx_ctx_drm_ui_init(drm, video_info))
+         drm->ui_state = DRM_UI_LAYER_READY;
+      else
+      {
+         RARCH_WARN("[KMS]: No overlay plane for the UI, "
+               "drawing it over the frame.\n");
+         gfx_ctx_drm_ui_free(drm);
+      }
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+   }
+#endif
 
    glClear(GL_COLOR_BUFFER_BIT);
 
+#ifdef HAVE_THREADS
+   gfx_ctx_drm_present_init(drm, video_info->max_swapchain_images);
+#endif
+
    return true;
 }
 
@@ -323,16 +1641,70 @@ static void gfx_ctx_drm_swap_buffers(void *data, void *data2)
       case GFX_CTX_OPENGL_ES_API:
       case GFX_CTX_OPENVG_API:
 #ifdef HAVE_EGL
-         //egl_swap_buffers(&drm->egl);
-         go2_context_swap_buffers(drm->context);
+         {
+            static struct retro_perf_counter drm_swap_buffers = {0};
+            static struct retro_perf_counter drm_surface_lock = {0};
+            go2_surface_t *surface = NULL;
+            retro_time_t start     = cpu_features_get_time_usec();
+            retro_time_t swapped;
+
+            if (drm->frame_last_time)
+               rarch_histogram_add(&drm_hist_frame,
+                     start - drm->frame_last_time);
+            drm->frame_last_time = start;
+
+            performance_counter_init(drm_swap_buffers, "kms_swap_buffers");
+            performance_counter_init(drm_surface_lock, "kms_surface_lock");
+
+#if defined(HAVE_EGL) && defined(EGL_KHR_fence_sync)
+            /* Hard sync takes precedence; otherwise, allow one
+             * frame in flight per swapchain image past the one
+             * being scanned out. */
+            gfx_ctx_drm_fence_iterate(drm, video_info->hard_sync
+                  ? video_info->hard_sync_frames
+                  : video_info->max_swapchain_images - 1);
+#endif
 
-         go2_surface_t* surface = go2_context_surface_lock(drm->context);
-         go2_presenter_post(drm->presenter,
-                     surface,
-                     0, 0, 480, 320,
-                     0, 0, 320, 480,
-                     GO2_ROTATION_DEGREES_270);
-         go2_context_surface_unlock(drm->context, surface);
+            performance_counter_start_plus(video_info->is_perfcnt_enable,
+                  drm_swap_buffers);
+            go2_context_swap_buffers(drm->context);
+            performance_counter_stop_plus(video_info->is_perfcnt_enable,
+                  drm_swap_buffers);
+
+            swapped = cpu_features_get_time_usec();
+            rarch_histogram_add(&drm_hist_swap, swapped - start);
+            rarch_trace_end("KMS swap", start);
+
+            performance_counter_start_plus(video_info->is_perfcnt_enable,
+                  drm_surface_lock);
+            surface = go2_context_surface_lock(drm->context);
+            performance_counter_stop_plus(video_info->is_perfcnt_enable,
+                  drm_surface_lock);
+
+            rarch_histogram_add(&drm_hist_lock,
+                  cpu_features_get_time_usec() - swapped);
+            rarch_trace_end("KMS surface lock", swapped);
+
+            gfx_ctx_drm_apply_refresh_rate(drm);
+
+            /* Both present paths block until a page flip. */
+            start = cpu_features_get_time_usec();
+
+#ifdef HAVE_THREADS
+            if (drm->present_thread)
+            {
+               gfx_ctx_drm_present_queue(drm, surface);
+               video_driver_set_present_wait(
+                     cpu_features_get_time_usec() - start);
+               rarch_trace_end("KMS present queue", start);
+               break;
+            }
+#endif
+            gfx_ctx_drm_present_surface(drm, surface);
+            go2_context_surface_unlock(drm->context, surface);
+            video_driver_set_present_wait(
+                  cpu_features_get_time_usec() - start);
+         }
 #endif
          break;
       default:
@@ -380,7 +1752,15 @@ static void gfx_ctx_drm_bind_hw_render(void *data, bool enable)
       case GFX_CTX_OPENGL_ES_API:
       case GFX_CTX_OPENVG_API:
 #ifdef HAVE_EGL
-         egl_bind_hw_render(&drm->egl, enable);
+         /* The gl driver binds around every piece of frontend
+          * work, only actual switches go to the driver */
+         if (drm->egl.hw_ctx == EGL_NO_CONTEXT)
+            drm->egl.use_hw_ctx = enable;
+         else if (drm->hw_ctx_bound != enable)
+         {
+            egl_bind_hw_render(&drm->egl, enable);
+            drm->hw_ctx_bound = enable;
+         }
 #endif
          break;
       case GFX_CTX_NONE:
@@ -397,7 +1777,7 @@ const gfx_ctx_driver_t gfx_ctx_drm = {
    gfx_ctx_drm_swap_interval,
    gfx_ctx_drm_set_video_mode,
    gfx_ctx_drm_get_video_size,
-   drm_get_refresh_rate,
+   gfx_ctx_drm_get_refresh_rate,
    NULL, /* get_video_output_size */
    NULL, /* get_video_output_prev */
    NULL, /* get_video_output_next */
@@ -412,13 +1792,25 @@ const gfx_ctx_driver_t gfx_ctx_drm = {
    gfx_ctx_drm_swap_buffers,
    gfx_ctx_drm_input_driver,
    gfx_ctx_drm_get_proc_address,
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import)
+   gfx_ctx_drm_image_buffer_init,
+   gfx_ctx_drm_image_buffer_write,
+#else
    NULL,
    NULL,
+#endif
    NULL,
    "kms",
    gfx_ctx_drm_get_flags,
    gfx_ctx_drm_set_flags,
    gfx_ctx_drm_bind_hw_render,
+   NULL,
+   NULL,
+#if defined(HAVE_EGL) && defined(EGL_EXT_image_dma_buf_import) && defined(EGL_KHR_fence_sync)
+   gfx_ctx_drm_ui_layer_begin,
+   gfx_ctx_drm_ui_layer_end
+#else
    NULL,
    NULL
+#endif
 };
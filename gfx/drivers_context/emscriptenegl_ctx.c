@@ -395,5 +395,7 @@ const gfx_ctx_driver_t gfx_ctx_emscripten = {
    gfx_ctx_emscripten_set_flags,
    gfx_ctx_emscripten_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
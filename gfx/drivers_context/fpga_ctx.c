@@ -193,6 +193,8 @@ const gfx_ctx_driver_t gfx_ctx_fpga = {
    gfx_ctx_fpga_set_flags,
    NULL,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
 
@@ -294,5 +294,7 @@ const gfx_ctx_driver_t gfx_ctx_gdi = {
    gfx_ctx_gdi_set_flags,
    NULL,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
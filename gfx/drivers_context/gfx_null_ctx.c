@@ -168,5 +168,7 @@ const gfx_ctx_driver_t gfx_ctx_null = {
    gfx_ctx_null_set_flags,
    gfx_ctx_null_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
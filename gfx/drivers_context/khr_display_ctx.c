@@ -29,8 +29,11 @@ typedef struct
 {
    gfx_ctx_vulkan_data_t vk;
    int swap_interval;
+   /* Of the video driver, swapped if rotated */
    unsigned width;
    unsigned height;
+   /* Portrait panel rendered to pre-rotated */
+   bool rotated;
 } khr_display_ctx_data_t;
 
 static enum gfx_ctx_api khr_api = GFX_CTX_NONE;
@@ -41,6 +44,9 @@ static void gfx_ctx_khr_display_destroy(void *data)
    if (!khr)
       return;
 
+   if (khr->rotated)
+      video_driver_set_surface_rotation(0);
+
    vulkan_context_destroy(&khr->vk, true);
 #ifdef HAVE_THREADS
    if (khr->vk.context.queue_lock)
@@ -105,7 +111,9 @@ static bool gfx_ctx_khr_display_set_resize(void *data,
 
    khr->width = width;
    khr->height = height;
-   if (!vulkan_create_swapchain(&khr->vk, khr->width, khr->height,
+   if (!vulkan_create_swapchain(&khr->vk,
+            khr->rotated ? khr->height : khr->width,
+            khr->rotated ? khr->width  : khr->height,
             khr->swap_interval))
    {
       RARCH_ERR("[Vulkan]: Failed to update swapchain.\n");
@@ -148,6 +156,20 @@ static bool gfx_ctx_khr_display_set_video_mode(void *data,
    khr->width = khr->vk.context.swapchain_width;
    khr->height = khr->vk.context.swapchain_height;
 
+   /* Panels mounted sideways (go2) report a portrait mode.
+    * Without a 2D blitter to rotate the scanout, the video
+    * driver renders pre-rotated to a landscape viewport. */
+   if (     config_get_ptr()->bools.video_kms_prerotate
+         && khr->height > khr->width)
+   {
+      khr->rotated = true;
+      khr->width   = khr->vk.context.swapchain_height;
+      khr->height  = khr->vk.context.swapchain_width;
+      video_driver_set_surface_rotation(270);
+      RARCH_LOG("[Vulkan]: Rendering pre-rotated to %ux%u.\n",
+            khr->width, khr->height);
+   }
+
    return true;
 
 error:
@@ -307,5 +329,7 @@ const gfx_ctx_driver_t gfx_ctx_khr_display = {
    gfx_ctx_khr_display_set_flags,
    NULL,
    gfx_ctx_khr_display_get_context_data,
+   NULL,
+   NULL,
    NULL
 };
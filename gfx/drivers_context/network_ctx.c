@@ -187,5 +187,7 @@ const gfx_ctx_driver_t gfx_ctx_network = {
    gfx_ctx_network_set_flags,
    NULL,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
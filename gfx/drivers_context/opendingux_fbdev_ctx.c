@@ -295,5 +295,7 @@ const gfx_ctx_driver_t gfx_ctx_opendingux_fbdev = {
    gfx_ctx_opendingux_set_flags,
    gfx_ctx_opendingux_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
@@ -416,5 +416,7 @@ const gfx_ctx_driver_t gfx_ctx_osmesa =
    osmesa_ctx_set_flags,
    NULL, /* bind_hw_render */
    NULL,
+   NULL,
+   NULL,
    NULL
 };
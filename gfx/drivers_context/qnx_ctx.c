@@ -488,5 +488,7 @@ const gfx_ctx_driver_t gfx_ctx_qnx = {
    gfx_ctx_qnx_set_flags,
    gfx_ctx_qnx_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
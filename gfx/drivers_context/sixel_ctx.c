@@ -183,5 +183,7 @@ const gfx_ctx_driver_t gfx_ctx_sixel = {
    gfx_ctx_sixel_set_flags,
    NULL,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
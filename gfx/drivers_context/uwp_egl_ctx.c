@@ -354,5 +354,7 @@ const gfx_ctx_driver_t gfx_ctx_uwp = {
    NULL, /* set flags */
    gfx_ctx_uwp_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
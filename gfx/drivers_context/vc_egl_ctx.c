@@ -742,5 +742,7 @@ const gfx_ctx_driver_t gfx_ctx_videocore = {
    gfx_ctx_vc_set_flags,
    gfx_ctx_vc_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
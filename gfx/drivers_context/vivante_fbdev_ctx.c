@@ -298,5 +298,7 @@ const gfx_ctx_driver_t gfx_ctx_vivante_fbdev = {
    gfx_ctx_vivante_set_flags,
    gfx_ctx_vivante_bind_hw_render,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
@@ -1993,4 +1993,6 @@ const gfx_ctx_driver_t gfx_ctx_wayland = {
    NULL,
 #endif
    NULL,
+   NULL,
+   NULL
 };
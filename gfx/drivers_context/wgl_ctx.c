@@ -1012,5 +1012,7 @@ const gfx_ctx_driver_t gfx_ctx_wgl = {
 #else
    NULL,
 #endif
+   NULL,
+   NULL,
    NULL
 };
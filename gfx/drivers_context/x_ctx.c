@@ -1391,5 +1391,7 @@ const gfx_ctx_driver_t gfx_ctx_x = {
 #else
    NULL,
 #endif
-   gfx_ctx_x_make_current
+   gfx_ctx_x_make_current,
+   NULL,
+   NULL
 };
@@ -16,6 +16,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <encodings/utf.h>
 #include <string/stdstring.h>
@@ -23,14 +24,15 @@
 
 #include "../common/gl_common.h"
 #include "../font_driver.h"
+#include "../../configuration.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 
 /* TODO: Move viewport side effects to the caller: it's a source of bugs. */
 
 #define gl_raster_font_emit(c, vx, vy) do { \
-   font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width) * scale) * inv_win_width; \
-   font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height) * scale) * inv_win_height; \
+   font_vertex[     2 * (6 * i + c) + 0] = (x + (delta_x + off_x + vx * width * glyph_scale) * scale) * inv_win_width; \
+   font_vertex[     2 * (6 * i + c) + 1] = (y + (delta_y - off_y - vy * height * glyph_scale) * scale) * inv_win_height; \
    font_tex_coords[ 2 * (6 * i + c) + 0] = (tex_x + vx * width) * inv_tex_size_x; \
    font_tex_coords[ 2 * (6 * i + c) + 1] = (tex_y + vy * height) * inv_tex_size_y; \
    font_color[      4 * (6 * i + c) + 0] = color[0]; \
@@ -43,16 +45,58 @@
 
 #define MAX_MSG_LEN_CHUNK 64
 
+/* Lines drawn last, with their glyphs already looked up
+ * and placed at scale 1. The menus draw the same labels
+ * every frame. A line is built again after the atlas has
+ * replaced any of its glyphs. */
+#define GL_RASTER_FONT_LINE_CACHE_SIZE 32
+#define GL_RASTER_FONT_LINE_MAX_LEN    96
+
+typedef struct
+{
+   int16_t x, y;
+   int16_t width, height;
+   int16_t tex_x, tex_y;
+} gl_raster_quad_t;
+
+typedef struct
+{
+   gl_raster_quad_t quads[GL_RASTER_FONT_LINE_MAX_LEN];
+   char msg[GL_RASTER_FONT_LINE_MAX_LEN];
+   uint32_t hash;
+   unsigned generation;
+   unsigned len;
+   unsigned count;
+   int advance;
+} gl_raster_line_t;
+
+/* Distance field atlases are shared by all the sizes of a
+ * face, so are their textures */
+typedef struct gl_raster_texture
+{
+   const uint8_t *buffer;
+   GLuint tex;
+   unsigned refcount;
+   struct gl_raster_texture *next;
+} gl_raster_texture_t;
+
+static gl_raster_texture_t *gl_raster_textures = NULL;
+
 typedef struct
 {
    gl_t *gl;
    GLuint tex;
    unsigned tex_width, tex_height;
+   /* Pixels an atlas pixel is drawn over at scale 1 */
+   float glyph_scale;
+   gl_raster_texture_t *shared_tex;
 
    const font_renderer_driver_t *font_driver;
    void *font_data;
    struct font_atlas *atlas;
 
+   gl_raster_line_t *lines;
+
    video_font_raster_block_t *block;
 } gl_raster_t;
 
@@ -75,12 +119,31 @@ static void gl_raster_font_free_font(void *data,
          font->gl->ctx_driver->make_current(true);
    }
 
-   if (font->tex)
+   if (font->shared_tex)
+   {
+      gl_raster_texture_t **link = &gl_raster_textures;
+
+      if (!--font->shared_tex->refcount)
+      {
+         while (*link && *link != font->shared_tex)
+            link = &(*link)->next;
+         if (*link)
+            *link = font->shared_tex->next;
+
+         glDeleteTextures(1, &font->shared_tex->tex);
+         free(font->shared_tex);
+      }
+
+      font->shared_tex = NULL;
+      font->tex        = 0;
+   }
+   else if (font->tex)
    {
       glDeleteTextures(1, &font->tex);
       font->tex = 0;
    }
 
+   free(font->lines);
    free(font);
 }
 
@@ -178,10 +241,67 @@ static bool gl_raster_font_upload_atlas(gl_raster_t *font)
    return true;
 }
 
+/* Distance fields need their shader, and the face to be
+ * only used from the one thread */
+static bool gl_raster_font_use_distance_field(gl_t *gl, bool is_threaded)
+{
+   uint32_t flags       = 0;
+   settings_t *settings = config_get_ptr();
+
+   if (     !settings->bools.video_font_sdf
+         || is_threaded
+         || gl->core_context_in_use
+         || !gl->shader
+         || !gl->shader->get_flags)
+      return false;
+
+   gl->shader->get_flags(&flags);
+
+   return BIT32_GET(flags, GFX_CTX_FLAGS_FONT_DISTANCE_FIELD);
+}
+
+/* Binds the texture of the atlas, shared with the other
+ * fonts drawn from it. Returns true if it's a new one. */
+static bool gl_raster_font_bind_shared_texture(gl_raster_t *font)
+{
+   gl_raster_texture_t *shared = gl_raster_textures;
+
+   for (; shared; shared = shared->next)
+   {
+      if (shared->buffer == font->atlas->buffer)
+      {
+         shared->refcount++;
+         font->shared_tex = shared;
+         font->tex        = shared->tex;
+         glBindTexture(GL_TEXTURE_2D, font->tex);
+         return false;
+      }
+   }
+
+   shared = (gl_raster_texture_t*)calloc(1, sizeof(*shared));
+   if (shared)
+   {
+      glGenTextures(1, &shared->tex);
+      shared->buffer      = font->atlas->buffer;
+      shared->refcount    = 1;
+      shared->next        = gl_raster_textures;
+      gl_raster_textures  = shared;
+
+      font->shared_tex    = shared;
+      font->tex           = shared->tex;
+   }
+   else
+      glGenTextures(1, &font->tex);
+
+   gl_bind_texture(font->tex, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
+   return true;
+}
+
 static void *gl_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
 {
+   bool upload          = true;
    gl_raster_t   *font  = (gl_raster_t*)calloc(1, sizeof(*font));
 
    if (!font)
@@ -189,7 +309,11 @@ static void *gl_raster_font_init_font(void *data,
 
    font->gl = (gl_t*)data;
 
-   if (!font_renderer_create_default(
+   if (     !(gl_raster_font_use_distance_field(font->gl, is_threaded)
+            && font_renderer_create_distance_field(
+               &font->font_driver,
+               &font->font_data, font_path, font_size))
+         && !font_renderer_create_default(
             &font->font_driver,
             &font->font_data, font_path, font_size))
    {
@@ -205,15 +329,24 @@ static void *gl_raster_font_init_font(void *data,
             font->gl->ctx_driver->make_current)
          font->gl->ctx_driver->make_current(false);
 
-   glGenTextures(1, &font->tex);
+   font->atlas       = font->font_driver->get_atlas(font->font_data);
+   font->tex_width   = next_pow2(font->atlas->width);
+   font->tex_height  = next_pow2(font->atlas->height);
+   font->glyph_scale = 1.0f;
 
-   gl_bind_texture(font->tex, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
-
-   font->atlas      = font->font_driver->get_atlas(font->font_data);
-   font->tex_width  = next_pow2(font->atlas->width);
-   font->tex_height = next_pow2(font->atlas->height);
+   if (font->atlas->distance_spread)
+   {
+      font->glyph_scale = font->atlas->glyph_scale;
+      upload            = gl_raster_font_bind_shared_texture(font)
+         || font->atlas->dirty;
+   }
+   else
+   {
+      glGenTextures(1, &font->tex);
+      gl_bind_texture(font->tex, GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR);
+   }
 
-   if (!gl_raster_font_upload_atlas(font))
+   if (upload && !gl_raster_font_upload_atlas(font))
       goto error;
 
    font->atlas->dirty = false;
@@ -276,6 +409,162 @@ static void gl_raster_font_draw_vertices(gl_raster_t *font,
    glDrawArrays(GL_TRIANGLES, 0, coords->vertices);
 }
 
+#define GL_RASTER_FONT_FITS(v) ((v) >= INT16_MIN && (v) <= INT16_MAX)
+
+/* Returns the cached layout of a line, building it
+ * if needed, or NULL if it can't be cached. */
+static const gl_raster_line_t *gl_raster_font_get_line(
+      gl_raster_t *font, const char *msg, unsigned msg_len)
+{
+   unsigned i;
+   uint32_t hash;
+   gl_raster_line_t *line = NULL;
+   const char *msg_end    = msg + msg_len;
+   int delta_x            = 0;
+   int delta_y            = 0;
+
+   if (msg_len > GL_RASTER_FONT_LINE_MAX_LEN)
+      return NULL;
+
+   if (!font->lines)
+   {
+      font->lines = (gl_raster_line_t*)calloc(
+            GL_RASTER_FONT_LINE_CACHE_SIZE, sizeof(*font->lines));
+      if (!font->lines)
+         return NULL;
+   }
+
+   /* FNV-1a */
+   hash = 2166136261u;
+   for (i = 0; i < msg_len; i++)
+      hash = (hash ^ (uint8_t)msg[i]) * 16777619u;
+
+   line = &font->lines[hash & (GL_RASTER_FONT_LINE_CACHE_SIZE - 1)];
+
+   if (     line->len        == msg_len
+         && line->hash       == hash
+         && line->generation == font->atlas->generation
+         && !memcmp(line->msg, msg, msg_len))
+      return line;
+
+   /* Looking glyphs up may replace ones looked up before,
+    * the line is then built again next time */
+   line->generation = font->atlas->generation;
+   line->len        = 0;
+   line->count      = 0;
+
+   while (msg < msg_end)
+   {
+      gl_raster_quad_t *quad         = &line->quads[line->count];
+      unsigned code                  = utf8_walk(&msg);
+      const struct font_glyph *glyph = font->font_driver->get_glyph(
+            font->font_data, code);
+      int x, y;
+
+      if (!glyph) /* Do something smarter here ... */
+         glyph = font->font_driver->get_glyph(font->font_data, '?');
+
+      if (!glyph)
+         continue;
+
+      x = delta_x + glyph->draw_offset_x;
+      y = delta_y - glyph->draw_offset_y;
+
+      if (     !GL_RASTER_FONT_FITS(x)
+            || !GL_RASTER_FONT_FITS(y)
+            || glyph->width          > INT16_MAX
+            || glyph->height         > INT16_MAX
+            || glyph->atlas_offset_x > INT16_MAX
+            || glyph->atlas_offset_y > INT16_MAX)
+         return NULL;
+
+      quad->x      = x;
+      quad->y      = y;
+      quad->width  = glyph->width;
+      quad->height = glyph->height;
+      quad->tex_x  = glyph->atlas_offset_x;
+      quad->tex_y  = glyph->atlas_offset_y;
+      line->count++;
+
+      delta_x += glyph->advance_x;
+      delta_y -= glyph->advance_y;
+   }
+
+   line->hash       = hash;
+   line->len        = msg_len;
+   line->advance    = delta_x;
+   memcpy(line->msg, msg, msg_len);
+
+   return line;
+}
+
+static void gl_raster_font_render_cached_line(
+      gl_raster_t *font, const gl_raster_line_t *line,
+      GLfloat scale, const GLfloat color[4], GLfloat pos_x,
+      GLfloat pos_y, unsigned text_align,
+      video_frame_info_t *video_info)
+{
+   unsigned i, j;
+   struct video_coords coords;
+   GLfloat font_tex_coords[2 * 6 * MAX_MSG_LEN_CHUNK];
+   GLfloat font_vertex[2 * 6 * MAX_MSG_LEN_CHUNK];
+   GLfloat font_color[4 * 6 * MAX_MSG_LEN_CHUNK];
+   GLfloat font_lut_tex_coord[2 * 6 * MAX_MSG_LEN_CHUNK];
+   gl_t      *gl        = font->gl;
+   int x                = roundf(pos_x * gl->vp.width);
+   int y                = roundf(pos_y * gl->vp.height);
+   int delta_x          = 0;
+   int delta_y          = 0;
+   float inv_tex_size_x = 1.0f / font->tex_width;
+   float inv_tex_size_y = 1.0f / font->tex_height;
+   float inv_win_width  = 1.0f / font->gl->vp.width;
+   float inv_win_height = 1.0f / font->gl->vp.height;
+   float glyph_scale    = font->glyph_scale;
+
+   switch (text_align)
+   {
+      case TEXT_ALIGN_RIGHT:
+         x -= (int)(line->advance * scale);
+         break;
+      case TEXT_ALIGN_CENTER:
+         x -= (int)(line->advance * scale) / 2.0;
+         break;
+   }
+
+   for (j = 0; j < line->count; )
+   {
+      for (i = 0; i < MAX_MSG_LEN_CHUNK && j < line->count; i++, j++)
+      {
+         const gl_raster_quad_t *quad = &line->quads[j];
+         int off_x                    = quad->x;
+         int off_y                    = -quad->y;
+         int tex_x                    = quad->tex_x;
+         int tex_y                    = quad->tex_y;
+         int width                    = quad->width;
+         int height                   = quad->height;
+
+         gl_raster_font_emit(0, 0, 1); /* Bottom-left */
+         gl_raster_font_emit(1, 1, 1); /* Bottom-right */
+         gl_raster_font_emit(2, 0, 0); /* Top-left */
+
+         gl_raster_font_emit(3, 1, 0); /* Top-right */
+         gl_raster_font_emit(4, 0, 0); /* Top-left */
+         gl_raster_font_emit(5, 1, 1); /* Bottom-right */
+      }
+
+      coords.tex_coord     = font_tex_coords;
+      coords.vertex        = font_vertex;
+      coords.color         = font_color;
+      coords.vertices      = i * 6;
+      coords.lut_tex_coord = font_lut_tex_coord;
+
+      if (font->block)
+         video_coord_array_append(&font->block->carr, &coords, coords.vertices);
+      else
+         gl_raster_font_draw_vertices(font, &coords, video_info);
+   }
+}
+
 static void gl_raster_font_render_line(
       gl_raster_t *font, const char *msg, unsigned msg_len,
       GLfloat scale, const GLfloat color[4], GLfloat pos_x,
@@ -298,6 +587,15 @@ static void gl_raster_font_render_line(
    float inv_tex_size_y = 1.0f / font->tex_height;
    float inv_win_width  = 1.0f / font->gl->vp.width;
    float inv_win_height = 1.0f / font->gl->vp.height;
+   float glyph_scale    = font->glyph_scale;
+   const gl_raster_line_t *line = gl_raster_font_get_line(font, msg, msg_len);
+
+   if (line)
+   {
+      gl_raster_font_render_cached_line(font, line, scale, color,
+            pos_x, pos_y, text_align, video_info);
+      return;
+   }
 
    switch (text_align)
    {
@@ -404,17 +702,21 @@ static void gl_raster_font_render_message(
 static void gl_raster_font_setup_viewport(unsigned width, unsigned height,
       gl_raster_t *font, bool full_screen)
 {
+   /* Menu quads queued so far go underneath the text. */
+   gl_batch_flush(font->gl);
+
    video_driver_set_viewport(width, height, full_screen, false);
 
    glEnable(GL_BLEND);
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   gl2_blend_func_alpha(font->gl);
    glBlendEquation(GL_FUNC_ADD);
 
    glBindTexture(GL_TEXTURE_2D, font->tex);
 
    if (font->gl->shader && font->gl->shader->use)
       font->gl->shader->use(font->gl,
-            font->gl->shader_data, VIDEO_SHADER_STOCK_BLEND, true);
+            font->gl->shader_data, font->atlas->distance_spread
+            ? VIDEO_SHADER_FONT_SDF : VIDEO_SHADER_STOCK_BLEND, true);
 }
 
 static void gl_raster_font_render_msg(
@@ -434,6 +736,10 @@ static void gl_raster_font_render_msg(
    if (!font || string_is_empty(msg))
       return;
 
+   /* Picks up what other sizes of a shared face changed */
+   if (font->font_driver && font->font_data)
+      font->atlas = font->font_driver->get_atlas(font->font_data);
+
    if (params)
    {
       x           = params->x;
@@ -54,6 +54,7 @@ typedef struct freetype_renderer
    freetype_atlas_slot_t atlas_slots[FT_ATLAS_SIZE];
    freetype_atlas_slot_t* uc_map[0x100];
    unsigned usage_counter;
+   unsigned slots_used;
 } ft_font_renderer_t;
 
 static struct font_atlas *font_renderer_ft_get_atlas(void *data)
@@ -84,6 +85,10 @@ static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
    int i, map_id;
    unsigned oldest = 0;
 
+   /* Slots are used in order until they have all been */
+   if (handle->slots_used < FT_ATLAS_SIZE)
+      return &handle->atlas_slots[handle->slots_used++];
+
    for (i = 1; i < FT_ATLAS_SIZE; i++)
       if ((handle->usage_counter - handle->atlas_slots[i].last_used) >
          (handle->usage_counter - handle->atlas_slots[oldest].last_used))
@@ -101,6 +106,8 @@ static freetype_atlas_slot_t* font_renderer_get_slot(ft_font_renderer_t *handle)
       ptr->next = handle->atlas_slots[oldest].next;
    }
 
+   handle->atlas.generation++;
+
    return &handle->atlas_slots[oldest];
 }
 
@@ -0,0 +1,508 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <retro_miscellaneous.h>
+
+#include "../font_driver.h"
+#include "../../verbosity.h"
+
+#ifndef STB_TRUETYPE_IMPLEMENTATION
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBTT_STATIC
+#define STBRP_STATIC
+#define STATIC static INLINE
+#include "../../deps/stb/stb_rect_pack.h"
+#include "../../deps/stb/stb_truetype.h"
+#undef STATIC
+#endif
+
+/* Glyphs are kept as distance fields, in one atlas per face
+ * shared by all the sizes it is opened at. Each glyph gets a
+ * cell, its outline drawn STB_SDF_GLYPH_SIZE pixels high with
+ * STB_SDF_SPREAD pixels of distance around it. 0.5 is on the
+ * outline, 1.0 is STB_SDF_SPREAD pixels inside of it. */
+#define STB_SDF_ATLAS_ROWS 16
+#define STB_SDF_ATLAS_COLS 16
+#define STB_SDF_ATLAS_SIZE (STB_SDF_ATLAS_ROWS * STB_SDF_ATLAS_COLS)
+#define STB_SDF_CELL_SIZE  32
+#define STB_SDF_SPREAD     4
+#define STB_SDF_GLYPH_SIZE (STB_SDF_CELL_SIZE - 2 * STB_SDF_SPREAD)
+#define STB_SDF_INF        1e20
+
+typedef struct stb_sdf_atlas_slot
+{
+   unsigned atlas_offset_x;
+   unsigned atlas_offset_y;
+   /* Font units */
+   int advance_width;
+   /* Top left of the cell from the origin, in atlas pixels */
+   int offset_x;
+   int offset_y;
+   unsigned charcode;
+   unsigned last_used;
+   struct stb_sdf_atlas_slot *next;
+} stb_sdf_atlas_slot_t;
+
+typedef struct stb_sdf_face
+{
+   uint8_t *font_data;
+   uint8_t *buffer;
+   stbtt_fontinfo info;
+
+   int ascent;
+   int descent;
+   /* Font units to atlas pixels */
+   float scale_factor;
+
+   /* Bumped when a glyph is drawn, or replaced by another */
+   unsigned revision;
+   unsigned generation;
+
+   stb_sdf_atlas_slot_t atlas_slots[STB_SDF_ATLAS_SIZE];
+   stb_sdf_atlas_slot_t *uc_map[0x100];
+   unsigned usage_counter;
+   unsigned slots_used;
+
+   unsigned refcount;
+   struct stb_sdf_face *next;
+
+   /* Scratch space for drawing a glyph */
+   uint8_t coverage[STB_SDF_CELL_SIZE * STB_SDF_CELL_SIZE];
+   float outer[STB_SDF_CELL_SIZE * STB_SDF_CELL_SIZE];
+   float inner[STB_SDF_CELL_SIZE * STB_SDF_CELL_SIZE];
+
+   char path[PATH_MAX_LENGTH];
+} stb_sdf_face_t;
+
+typedef struct
+{
+   stb_sdf_face_t *face;
+
+   int line_height;
+   /* Font units to pixels, at the size opened */
+   float scale_factor;
+   unsigned revision;
+
+   struct font_atlas atlas;
+   struct font_glyph glyphs[STB_SDF_ATLAS_SIZE];
+} stb_sdf_font_renderer_t;
+
+static stb_sdf_face_t *stb_sdf_faces = NULL;
+
+static int INLINE stb_sdf_round_away_from_zero(float f)
+{
+   double round = (f < 0.0) ? floor((double)f) : ceil((double)f);
+   return (int)round;
+}
+
+/* Squared distance transform of one row or column,
+ * see Felzenszwalb and Huttenlocher, "Distance Transforms
+ * of Sampled Functions". */
+static void stb_sdf_edt_1d(float *grid, unsigned offset, unsigned stride)
+{
+   double f[STB_SDF_CELL_SIZE];
+   double z[STB_SDF_CELL_SIZE + 1];
+   int v[STB_SDF_CELL_SIZE];
+   int q;
+   int k = 0;
+
+   for (q = 0; q < STB_SDF_CELL_SIZE; q++)
+      f[q] = grid[offset + q * stride];
+
+   v[0] = 0;
+   z[0] = -STB_SDF_INF;
+   z[1] = STB_SDF_INF;
+
+   for (q = 1; q < STB_SDF_CELL_SIZE; q++)
+   {
+      double s;
+
+      do
+      {
+         int r = v[k];
+         s     = (f[q] - f[r] + q * q - r * r) / (2 * (q - r));
+      } while (s <= z[k] && --k >= 0);
+
+      k++;
+      v[k]     = q;
+      z[k]     = s;
+      z[k + 1] = STB_SDF_INF;
+   }
+
+   for (q = 0, k = 0; q < STB_SDF_CELL_SIZE; q++)
+   {
+      int r;
+
+      while (z[k + 1] < q)
+         k++;
+
+      r = v[k];
+      grid[offset + q * stride] = f[r] + (q - r) * (q - r);
+   }
+}
+
+static void stb_sdf_edt(float *grid)
+{
+   unsigned i;
+
+   for (i = 0; i < STB_SDF_CELL_SIZE; i++)
+      stb_sdf_edt_1d(grid, i, STB_SDF_CELL_SIZE);
+   for (i = 0; i < STB_SDF_CELL_SIZE; i++)
+      stb_sdf_edt_1d(grid, i * STB_SDF_CELL_SIZE, 1);
+}
+
+static void stb_sdf_draw_glyph(stb_sdf_face_t *face,
+      stb_sdf_atlas_slot_t *slot, int glyph_index)
+{
+   unsigned x, y;
+   int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+   uint8_t *dst = face->buffer + slot->atlas_offset_x
+      + slot->atlas_offset_y * STB_SDF_ATLAS_COLS * STB_SDF_CELL_SIZE;
+
+   memset(face->coverage, 0, sizeof(face->coverage));
+
+   if (stbtt_GetGlyphBox(&face->info, glyph_index, NULL, NULL, NULL, NULL))
+   {
+      int width, height;
+
+      stbtt_GetGlyphBitmapBox(&face->info, glyph_index,
+            face->scale_factor, face->scale_factor, &x0, &y0, &x1, &y1);
+
+      /* Whatever doesn't fit in the cell is cut off */
+      width  = MIN(x1 - x0, STB_SDF_GLYPH_SIZE);
+      height = MIN(y1 - y0, STB_SDF_GLYPH_SIZE);
+
+      if (width > 0 && height > 0)
+         stbtt_MakeGlyphBitmap(&face->info,
+               face->coverage + STB_SDF_SPREAD * STB_SDF_CELL_SIZE
+               + STB_SDF_SPREAD, width, height, STB_SDF_CELL_SIZE,
+               face->scale_factor, face->scale_factor, glyph_index);
+   }
+
+   /* The edges are placed inside partly covered pixels, see
+    * the TinySDF approach by Mapbox */
+   for (x = 0; x < STB_SDF_CELL_SIZE * STB_SDF_CELL_SIZE; x++)
+   {
+      float a = face->coverage[x] / 255.0f;
+
+      if (a >= 1.0f)
+      {
+         face->outer[x] = 0;
+         face->inner[x] = STB_SDF_INF;
+      }
+      else if (a <= 0.0f)
+      {
+         face->outer[x] = STB_SDF_INF;
+         face->inner[x] = 0;
+      }
+      else
+      {
+         float d        = 0.5f - a;
+         face->outer[x] = d > 0 ? d * d : 0;
+         face->inner[x] = d < 0 ? d * d : 0;
+      }
+   }
+
+   stb_sdf_edt(face->outer);
+   stb_sdf_edt(face->inner);
+
+   for (y = 0; y < STB_SDF_CELL_SIZE; y++)
+   {
+      for (x = 0; x < STB_SDF_CELL_SIZE; x++)
+      {
+         unsigned i = x + y * STB_SDF_CELL_SIZE;
+         float d    = sqrtf(face->outer[i]) - sqrtf(face->inner[i]);
+         float v    = 0.5f - d / (2 * STB_SDF_SPREAD);
+
+         dst[x] = v <= 0.0f ? 0 : v >= 1.0f ? 255 : (uint8_t)(v * 255.0f + 0.5f);
+      }
+      dst += STB_SDF_ATLAS_COLS * STB_SDF_CELL_SIZE;
+   }
+
+   slot->offset_x  = x0 - STB_SDF_SPREAD;
+   slot->offset_y  = y0 - STB_SDF_SPREAD;
+   face->revision++;
+}
+
+static stb_sdf_atlas_slot_t *stb_sdf_get_slot(stb_sdf_face_t *face)
+{
+   unsigned i, map_id;
+   unsigned oldest = 0;
+
+   /* Slots are used in order until they have all been */
+   if (face->slots_used < STB_SDF_ATLAS_SIZE)
+      return &face->atlas_slots[face->slots_used++];
+
+   for (i = 1; i < STB_SDF_ATLAS_SIZE; i++)
+      if ((face->usage_counter - face->atlas_slots[i].last_used) >
+            (face->usage_counter - face->atlas_slots[oldest].last_used))
+         oldest = i;
+
+   /* remove from map */
+   map_id = face->atlas_slots[oldest].charcode & 0xFF;
+   if (face->uc_map[map_id] == &face->atlas_slots[oldest])
+      face->uc_map[map_id] = face->atlas_slots[oldest].next;
+   else if (face->uc_map[map_id])
+   {
+      stb_sdf_atlas_slot_t *ptr = face->uc_map[map_id];
+      while (ptr->next && ptr->next != &face->atlas_slots[oldest])
+         ptr = ptr->next;
+      ptr->next = face->atlas_slots[oldest].next;
+   }
+
+   face->generation++;
+
+   return &face->atlas_slots[oldest];
+}
+
+static stb_sdf_atlas_slot_t *stb_sdf_face_get_glyph(
+      stb_sdf_face_t *face, uint32_t charcode)
+{
+   int glyph_index, left_side_bearing;
+   unsigned map_id              = charcode & 0xFF;
+   stb_sdf_atlas_slot_t *slot   = face->uc_map[map_id];
+
+   while (slot)
+   {
+      if (slot->charcode == charcode)
+      {
+         slot->last_used = face->usage_counter++;
+         return slot;
+      }
+      slot = slot->next;
+   }
+
+   slot                 = stb_sdf_get_slot(face);
+   slot->charcode       = charcode;
+   slot->next           = face->uc_map[map_id];
+   face->uc_map[map_id] = slot;
+
+   glyph_index          = stbtt_FindGlyphIndex(&face->info, charcode);
+   stbtt_GetGlyphHMetrics(&face->info, glyph_index,
+         &slot->advance_width, &left_side_bearing);
+   stb_sdf_draw_glyph(face, slot, glyph_index);
+
+   slot->last_used      = face->usage_counter++;
+   return slot;
+}
+
+static void stb_sdf_face_unref(stb_sdf_face_t *face)
+{
+   stb_sdf_face_t **link = &stb_sdf_faces;
+
+   if (!face || --face->refcount)
+      return;
+
+   while (*link && *link != face)
+      link = &(*link)->next;
+   if (*link)
+      *link = face->next;
+
+   free(face->buffer);
+   free(face->font_data);
+   free(face);
+}
+
+static stb_sdf_face_t *stb_sdf_face_ref(const char *font_path)
+{
+   unsigned i, x, y;
+   stb_sdf_face_t *face = stb_sdf_faces;
+
+   for (; face; face = face->next)
+   {
+      if (string_is_equal(face->path, font_path))
+      {
+         face->refcount++;
+         return face;
+      }
+   }
+
+   face = (stb_sdf_face_t*)calloc(1, sizeof(*face));
+   if (!face)
+      return NULL;
+
+   face->refcount = 1;
+
+   if (     !path_is_valid(font_path)
+         || !filestream_read_file(font_path, (void**)&face->font_data, NULL))
+      goto error;
+
+   if (!stbtt_InitFont(&face->info, face->font_data,
+            stbtt_GetFontOffsetForIndex(face->font_data, 0)))
+      goto error;
+
+   face->buffer = (uint8_t*)calloc(
+         STB_SDF_ATLAS_ROWS * STB_SDF_CELL_SIZE,
+         STB_SDF_ATLAS_COLS * STB_SDF_CELL_SIZE);
+   if (!face->buffer)
+      goto error;
+
+   stbtt_GetFontVMetrics(&face->info, &face->ascent, &face->descent, NULL);
+   face->scale_factor = stbtt_ScaleForPixelHeight(&face->info,
+         STB_SDF_GLYPH_SIZE);
+
+   for (y = 0, i = 0; y < STB_SDF_ATLAS_ROWS; y++)
+   {
+      for (x = 0; x < STB_SDF_ATLAS_COLS; x++, i++)
+      {
+         face->atlas_slots[i].atlas_offset_x = x * STB_SDF_CELL_SIZE;
+         face->atlas_slots[i].atlas_offset_y = y * STB_SDF_CELL_SIZE;
+      }
+   }
+
+   /* What menus are mostly made of, the rest is drawn when asked */
+   for (i = ' '; i < 0x7f; i++)
+      stb_sdf_face_get_glyph(face, i);
+
+   strlcpy(face->path, font_path, sizeof(face->path));
+   face->next    = stb_sdf_faces;
+   stb_sdf_faces = face;
+
+   return face;
+
+error:
+   free(face->font_data);
+   free(face);
+   return NULL;
+}
+
+/* Passes on what the face changed since the last call */
+static void stb_sdf_sync(stb_sdf_font_renderer_t *self)
+{
+   self->atlas.generation = self->face->generation;
+
+   if (self->revision != self->face->revision)
+   {
+      self->revision    = self->face->revision;
+      self->atlas.dirty = true;
+   }
+}
+
+static struct font_atlas *font_renderer_stb_sdf_get_atlas(void *data)
+{
+   stb_sdf_font_renderer_t *self = (stb_sdf_font_renderer_t*)data;
+
+   stb_sdf_sync(self);
+   return &self->atlas;
+}
+
+static const struct font_glyph *font_renderer_stb_sdf_get_glyph(
+      void *data, uint32_t charcode)
+{
+   stb_sdf_atlas_slot_t *slot    = NULL;
+   struct font_glyph *glyph      = NULL;
+   stb_sdf_font_renderer_t *self = (stb_sdf_font_renderer_t*)data;
+
+   if (!self)
+      return NULL;
+
+   slot  = stb_sdf_face_get_glyph(self->face, charcode);
+   glyph = &self->glyphs[slot - self->face->atlas_slots];
+
+   glyph->atlas_offset_x = slot->atlas_offset_x;
+   glyph->atlas_offset_y = slot->atlas_offset_y;
+   glyph->width          = STB_SDF_CELL_SIZE;
+   glyph->height         = STB_SDF_CELL_SIZE;
+   glyph->advance_x      = stb_sdf_round_away_from_zero(
+         (float)slot->advance_width * self->scale_factor);
+   glyph->advance_y      = 0;
+   glyph->draw_offset_x  = stb_sdf_round_away_from_zero(
+         slot->offset_x * self->atlas.glyph_scale);
+   glyph->draw_offset_y  = stb_sdf_round_away_from_zero(
+         slot->offset_y * self->atlas.glyph_scale);
+
+   stb_sdf_sync(self);
+   return glyph;
+}
+
+static void font_renderer_stb_sdf_free(void *data)
+{
+   stb_sdf_font_renderer_t *self = (stb_sdf_font_renderer_t*)data;
+
+   if (!self)
+      return;
+
+   stb_sdf_face_unref(self->face);
+   free(self);
+}
+
+static void *font_renderer_stb_sdf_init(const char *font_path, float font_size)
+{
+   stb_sdf_face_t *face          = NULL;
+   stb_sdf_font_renderer_t *self = NULL;
+
+   if (font_size < 1.0)
+      return NULL;
+
+   face = stb_sdf_face_ref(font_path);
+   if (!face)
+      return NULL;
+
+   self = (stb_sdf_font_renderer_t*)calloc(1, sizeof(*self));
+   if (!self)
+   {
+      stb_sdf_face_unref(face);
+      return NULL;
+   }
+
+   self->face                   = face;
+
+   /* Sized as stb-unicode does, see
+    * https://github.com/nothings/stb/blob/master/stb_truetype.h#L539 */
+   self->scale_factor           = stbtt_ScaleForMappingEmToPixels(
+         &face->info, font_size);
+   self->line_height            = (face->ascent - face->descent)
+      * self->scale_factor;
+
+   self->atlas.buffer           = face->buffer;
+   self->atlas.width            = STB_SDF_ATLAS_COLS * STB_SDF_CELL_SIZE;
+   self->atlas.height           = STB_SDF_ATLAS_ROWS * STB_SDF_CELL_SIZE;
+   self->atlas.glyph_scale      = self->scale_factor / face->scale_factor;
+   self->atlas.distance_spread  = STB_SDF_SPREAD;
+   self->revision               = face->revision;
+   self->atlas.generation       = face->generation;
+   self->atlas.dirty            = true;
+
+   return self;
+}
+
+static const char *font_renderer_stb_sdf_get_default_font(void)
+{
+   return stb_unicode_font_renderer.get_default_font();
+}
+
+static int font_renderer_stb_sdf_get_line_height(void *data)
+{
+   stb_sdf_font_renderer_t *self = (stb_sdf_font_renderer_t*)data;
+   return self->line_height;
+}
+
+font_renderer_driver_t stb_sdf_font_renderer = {
+   font_renderer_stb_sdf_init,
+   font_renderer_stb_sdf_get_atlas,
+   font_renderer_stb_sdf_get_glyph,
+   font_renderer_stb_sdf_free,
+   font_renderer_stb_sdf_get_default_font,
+   "stb-sdf",
+   font_renderer_stb_sdf_get_line_height,
+};
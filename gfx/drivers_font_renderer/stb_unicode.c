@@ -64,6 +64,7 @@ typedef struct
    stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
    stb_unicode_atlas_slot_t* uc_map[0x100];
    unsigned usage_counter;
+   unsigned slots_used;
 } stb_unicode_font_renderer_t;
 
 /* Ugly little thing... */
@@ -93,6 +94,10 @@ static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_
    int i, map_id;
    unsigned oldest = 0;
 
+   /* Slots are used in order until they have all been */
+   if (handle->slots_used < STB_UNICODE_ATLAS_SIZE)
+      return &handle->atlas_slots[handle->slots_used++];
+
    for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
       if((handle->usage_counter - handle->atlas_slots[i].last_used) >
          (handle->usage_counter - handle->atlas_slots[oldest].last_used))
@@ -110,6 +115,8 @@ static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_
       ptr->next = handle->atlas_slots[oldest].next;
    }
 
+   handle->atlas.generation++;
+
    return &handle->atlas_slots[oldest];
 }
 
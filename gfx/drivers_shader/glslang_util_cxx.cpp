@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include <retro_miscellaneous.h>
+#include <encodings/crc32.h>
 #include <file/file_path.h>
 #include <file/config_file.h>
 #include <streams/file_stream.h>
@@ -34,8 +35,16 @@
 #if defined(HAVE_GLSLANG)
 #include <glslang.hpp>
 #endif
+#include "../../configuration.h"
 #include "../../verbosity.h"
 
+/* Bump when the layout of anything stored in
+ * the cache, or the vendored compilers, change. */
+#define GLSLANG_CACHE_VERSION 1
+
+/* "SLCA" */
+#define GLSLANG_CACHE_MAGIC 0x41434c53
+
 static std::string build_stage_source(
       const struct string_list *lines, const char *stage)
 {
@@ -207,9 +216,157 @@ bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta)
    return true;
 }
 
+static bool glslang_cache_path(const char *kind, const std::string &key,
+      char *s, size_t len)
+{
+   char dir[PATH_MAX_LENGTH];
+   char name[64];
+   settings_t *settings = config_get_ptr();
+
+   if (!settings || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   fill_pathname_join(dir, settings->paths.directory_cache,
+         "shaders", sizeof(dir));
+
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return false;
+
+   snprintf(name, sizeof(name), "%s_%s.bin", kind, key.c_str());
+   fill_pathname_join(s, dir, name, len);
+   return true;
+}
+
+std::string glslang_cache_hash(const std::string &data)
+{
+   /* CRC32 and FNV-1a together, to make
+    * collisions across a shader library unlikely. */
+   char key[32];
+   size_t i;
+   uint32_t fnv = 2166136261u;
+   uint32_t crc = encoding_crc32(0,
+         (const uint8_t*)data.data(), data.size());
+
+   for (i = 0; i < data.size(); i++)
+      fnv = (fnv ^ (uint8_t)data[i]) * 16777619u;
+
+   snprintf(key, sizeof(key), "%08x%08x%02x",
+         (unsigned)crc, (unsigned)fnv, GLSLANG_CACHE_VERSION);
+   return key;
+}
+
+bool glslang_cache_read(const char *kind, const std::string &key,
+      std::vector<uint8_t> *blob)
+{
+   char path[PATH_MAX_LENGTH];
+   void *buf       = NULL;
+   int64_t len     = 0;
+   uint32_t header[2];
+
+   if (!glslang_cache_path(kind, key, path, sizeof(path))
+         || !path_is_valid(path))
+      return false;
+
+   if (filestream_read_file(path, &buf, &len) <= 0)
+      return false;
+
+   if (len < (int64_t)sizeof(header))
+   {
+      free(buf);
+      return false;
+   }
+
+   memcpy(header, buf, sizeof(header));
+
+   if (     header[0] != GLSLANG_CACHE_MAGIC
+         || header[1] != (uint32_t)(len - sizeof(header)))
+   {
+      free(buf);
+      return false;
+   }
+
+   blob->assign((const uint8_t*)buf + sizeof(header),
+         (const uint8_t*)buf + len);
+   free(buf);
+   return true;
+}
+
+void glslang_cache_write(const char *kind, const std::string &key,
+      const std::vector<uint8_t> &blob)
+{
+   char path[PATH_MAX_LENGTH];
+   uint32_t header[2];
+   std::vector<uint8_t> data(sizeof(header) + blob.size());
+
+   if (!glslang_cache_path(kind, key, path, sizeof(path)))
+      return;
+
+   header[0] = GLSLANG_CACHE_MAGIC;
+   header[1] = (uint32_t)blob.size();
+
+   memcpy(data.data(), header, sizeof(header));
+   if (!blob.empty())
+      memcpy(data.data() + sizeof(header), blob.data(), blob.size());
+
+   if (!filestream_write_file(path, data.data(), data.size()))
+      RARCH_WARN("[slang]: Failed to write shader cache %s.\n", path);
+}
+
+#if defined(HAVE_GLSLANG)
+/* SPIR-V blobs: vertex word count, then vertex and fragment words. */
+static bool glslang_spirv_cache_read(const std::string &key,
+      glslang_output *output)
+{
+   uint32_t vertex_words = 0;
+   size_t words;
+   std::vector<uint8_t> blob;
+
+   if (!glslang_cache_read("spirv", key, &blob)
+         || blob.size() < sizeof(uint32_t)
+         || blob.size() % sizeof(uint32_t))
+      return false;
+
+   memcpy(&vertex_words, blob.data(), sizeof(vertex_words));
+   words = blob.size() / sizeof(uint32_t) - 1;
+
+   if (vertex_words > words)
+      return false;
+
+   output->vertex.resize(vertex_words);
+   output->fragment.resize(words - vertex_words);
+
+   memcpy(output->vertex.data(), blob.data() + sizeof(uint32_t),
+         vertex_words * sizeof(uint32_t));
+   memcpy(output->fragment.data(),
+         blob.data() + (vertex_words + 1) * sizeof(uint32_t),
+         output->fragment.size() * sizeof(uint32_t));
+   return true;
+}
+
+static void glslang_spirv_cache_write(const std::string &key,
+      const glslang_output *output)
+{
+   uint32_t vertex_words = (uint32_t)output->vertex.size();
+   std::vector<uint8_t> blob((1 + output->vertex.size()
+            + output->fragment.size()) * sizeof(uint32_t));
+
+   memcpy(blob.data(), &vertex_words, sizeof(vertex_words));
+   memcpy(blob.data() + sizeof(uint32_t), output->vertex.data(),
+         output->vertex.size() * sizeof(uint32_t));
+   memcpy(blob.data() + (output->vertex.size() + 1) * sizeof(uint32_t),
+         output->fragment.data(),
+         output->fragment.size() * sizeof(uint32_t));
+
+   glslang_cache_write("spirv", key, blob);
+}
+#endif
+
 bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
 #if defined(HAVE_GLSLANG)
+   std::string vertex_source;
+   std::string fragment_source;
+   std::string key;
    struct string_list *lines = string_list_new();
 
    if (!lines)
@@ -223,20 +380,37 @@ bool glslang_compile_shader(const char *shader_path, glslang_output *output)
    if (!glslang_parse_meta(lines, &output->meta))
       goto error;
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "vertex"),
+   vertex_source   = build_stage_source(lines, "vertex");
+   fragment_source = build_stage_source(lines, "fragment");
+
+   /* Includes are already resolved, so the stage
+    * sources are all the compiler gets to see. */
+   key             = glslang_cache_hash(
+         vertex_source + '\0' + fragment_source);
+
+   if (glslang_spirv_cache_read(key, output))
+   {
+      RARCH_LOG("[slang]: Loaded SPIR-V from cache.\n");
+      string_list_free(lines);
+      return true;
+   }
+
+   if (    !glslang::compile_spirv(vertex_source,
             glslang::StageVertex, &output->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       goto error;
    }
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "fragment"),
+   if (    !glslang::compile_spirv(fragment_source,
             glslang::StageFragment, &output->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
       goto error;
    }
 
+   glslang_spirv_cache_write(key, output);
+
    string_list_free(lines);
 
    return true;
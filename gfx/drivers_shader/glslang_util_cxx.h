@@ -55,6 +55,17 @@ struct glslang_output
 
 bool glslang_compile_shader(const char *shader_path, glslang_output *output);
 
+/* Persistent cache for shader build artifacts (SPIR-V,
+ * cross-compiled GLSL), stored in <cache_directory>/shaders.
+ * 'key' is a content hash from glslang_cache_hash. */
+std::string glslang_cache_hash(const std::string &data);
+
+bool glslang_cache_read(const char *kind, const std::string &key,
+      std::vector<uint8_t> *blob);
+
+void glslang_cache_write(const char *kind, const std::string &key,
+      const std::vector<uint8_t> &blob);
+
 /* Helpers for internal use. */
 bool glslang_parse_meta(const struct string_list *lines, glslang_meta *meta);
 
@@ -1112,6 +1112,12 @@ static bool gl_cg_mipmap_input(void *data, unsigned idx)
    return false;
 }
 
+static bool gl_cg_is_time_dependent(void *data, unsigned idx)
+{
+   /* Not tracked, Cg passes always get re-rendered. */
+   return true;
+}
+
 static struct video_shader *gl_cg_get_current_shader(void *data)
 {
    cg_shader_data_t *cg = (cg_shader_data_t*)data;
@@ -1142,6 +1148,7 @@ const shader_backend_t gl_cg_backend = {
    gl_cg_get_prev_textures,
    gl_cg_get_feedback_pass,
    gl_cg_mipmap_input,
+   gl_cg_is_time_dependent,
    gl_cg_get_current_shader,
    gl_cg_get_flags,
 
@@ -56,124 +56,252 @@ static bool gl_core_shader_set_unique_map(unordered_map<string, P> &m,
    return true;
 }
 
-GLuint gl_core_cross_compile_program(
+/* Everything the GLSL program is built from, which only
+ * depends on the SPIR-V and the cross-compiler options. */
+struct gl_core_cross_output
+{
+   std::string vertex_source;
+   std::string fragment_source;
+   std::vector<uint32_t> attrib_locations;
+   std::vector<uint32_t> texture_bindings;
+};
+
+static bool gl_core_cross_compile_sources(
       const uint32_t *vertex, size_t vertex_size,
       const uint32_t *fragment, size_t fragment_size,
-      gl_core_buffer_locations *loc, bool flatten)
+      bool flatten, gl_core_cross_output *out)
 {
-   GLuint program = 0;
-   try
-   {
-      spirv_cross::ShaderResources vertex_resources;
-      spirv_cross::ShaderResources fragment_resources;
-      spirv_cross::CompilerGLSL vertex_compiler(vertex, vertex_size / 4);
-      spirv_cross::CompilerGLSL fragment_compiler(fragment, fragment_size / 4);
-      spirv_cross::CompilerGLSL::Options opts;
+   spirv_cross::ShaderResources vertex_resources;
+   spirv_cross::ShaderResources fragment_resources;
+   spirv_cross::CompilerGLSL vertex_compiler(vertex, vertex_size / 4);
+   spirv_cross::CompilerGLSL fragment_compiler(fragment, fragment_size / 4);
+   spirv_cross::CompilerGLSL::Options opts;
 #ifdef HAVE_OPENGLES3
-      opts.es                               = true;
+   opts.es                               = true;
 #else
-      opts.es                               = false;
+   opts.es                               = false;
 #endif
-      opts.version                          = gl_core_get_cross_compiler_target_version();
-      opts.fragment.default_float_precision = spirv_cross::CompilerGLSL::Options::Precision::Highp;
-      opts.fragment.default_int_precision   = spirv_cross::CompilerGLSL::Options::Precision::Highp;
-      opts.enable_420pack_extension         = false;
+   opts.version                          = gl_core_get_cross_compiler_target_version();
+   opts.fragment.default_float_precision = spirv_cross::CompilerGLSL::Options::Precision::Highp;
+   opts.fragment.default_int_precision   = spirv_cross::CompilerGLSL::Options::Precision::Highp;
+   opts.enable_420pack_extension         = false;
 
-      vertex_compiler.set_common_options(opts);
-      fragment_compiler.set_common_options(opts);
+   vertex_compiler.set_common_options(opts);
+   fragment_compiler.set_common_options(opts);
 
-      vertex_resources                      = vertex_compiler.get_shader_resources();
-      fragment_resources                    = fragment_compiler.get_shader_resources();
+   vertex_resources                      = vertex_compiler.get_shader_resources();
+   fragment_resources                    = fragment_compiler.get_shader_resources();
 
-      for (auto &res : vertex_resources.stage_inputs)
-      {
-         uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
-         vertex_compiler.set_name(res.id, string("RARCH_ATTRIBUTE_") + to_string(location));
-         vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
-      }
+   for (auto &res : vertex_resources.stage_inputs)
+   {
+      uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
+      vertex_compiler.set_name(res.id, string("RARCH_ATTRIBUTE_") + to_string(location));
+      vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
+   }
 
-      for (auto &res : vertex_resources.stage_outputs)
-      {
-         uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
-         vertex_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
-         vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
-      }
+   for (auto &res : vertex_resources.stage_outputs)
+   {
+      uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
+      vertex_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
+      vertex_compiler.unset_decoration(res.id, spv::DecorationLocation);
+   }
 
-      for (auto &res : fragment_resources.stage_inputs)
-      {
-         uint32_t location = fragment_compiler.get_decoration(res.id, spv::DecorationLocation);
-         fragment_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
-         fragment_compiler.unset_decoration(res.id, spv::DecorationLocation);
-      }
+   for (auto &res : fragment_resources.stage_inputs)
+   {
+      uint32_t location = fragment_compiler.get_decoration(res.id, spv::DecorationLocation);
+      fragment_compiler.set_name(res.id, string("RARCH_VARYING_") + to_string(location));
+      fragment_compiler.unset_decoration(res.id, spv::DecorationLocation);
+   }
 
-      if (vertex_resources.push_constant_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one push constant buffer.\n");
-         return 0;
-      }
+   if (vertex_resources.push_constant_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one push constant buffer.\n");
+      return false;
+   }
 
-      for (auto &res : vertex_resources.push_constant_buffers)
-      {
-         vertex_compiler.set_name(res.id, "RARCH_PUSH_VERTEX_INSTANCE");
-         vertex_compiler.set_name(res.base_type_id, "RARCH_PUSH_VERTEX");
-      }
+   for (auto &res : vertex_resources.push_constant_buffers)
+   {
+      vertex_compiler.set_name(res.id, "RARCH_PUSH_VERTEX_INSTANCE");
+      vertex_compiler.set_name(res.base_type_id, "RARCH_PUSH_VERTEX");
+   }
 
-      if (vertex_resources.uniform_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
-         return 0;
-      }
+   if (vertex_resources.uniform_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
+      return false;
+   }
 
-      for (auto &res : vertex_resources.uniform_buffers)
-      {
-         if (flatten)
-            vertex_compiler.flatten_buffer_block(res.id);
-         vertex_compiler.set_name(res.id, "RARCH_UBO_VERTEX_INSTANCE");
-         vertex_compiler.set_name(res.base_type_id, "RARCH_UBO_VERTEX");
-         vertex_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
-         vertex_compiler.unset_decoration(res.id, spv::DecorationBinding);
-      }
+   for (auto &res : vertex_resources.uniform_buffers)
+   {
+      if (flatten)
+         vertex_compiler.flatten_buffer_block(res.id);
+      vertex_compiler.set_name(res.id, "RARCH_UBO_VERTEX_INSTANCE");
+      vertex_compiler.set_name(res.base_type_id, "RARCH_UBO_VERTEX");
+      vertex_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
+      vertex_compiler.unset_decoration(res.id, spv::DecorationBinding);
+   }
 
-      if (fragment_resources.push_constant_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one push constant block.\n");
-         return 0;
-      }
+   if (fragment_resources.push_constant_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one push constant block.\n");
+      return false;
+   }
 
-      for (auto &res : fragment_resources.push_constant_buffers)
-      {
-         fragment_compiler.set_name(res.id, "RARCH_PUSH_FRAGMENT_INSTANCE");
-         fragment_compiler.set_name(res.base_type_id, "RARCH_PUSH_FRAGMENT");
-      }
+   for (auto &res : fragment_resources.push_constant_buffers)
+   {
+      fragment_compiler.set_name(res.id, "RARCH_PUSH_FRAGMENT_INSTANCE");
+      fragment_compiler.set_name(res.base_type_id, "RARCH_PUSH_FRAGMENT");
+   }
 
-      if (fragment_resources.uniform_buffers.size() > 1)
-      {
-         RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
-         return 0;
-      }
+   if (fragment_resources.uniform_buffers.size() > 1)
+   {
+      RARCH_ERR("[GLCore]: Cannot have more than one uniform buffer.\n");
+      return false;
+   }
+
+   for (auto &res : fragment_resources.uniform_buffers)
+   {
+      if (flatten)
+         fragment_compiler.flatten_buffer_block(res.id);
+      fragment_compiler.set_name(res.id, "RARCH_UBO_FRAGMENT_INSTANCE");
+      fragment_compiler.set_name(res.base_type_id, "RARCH_UBO_FRAGMENT");
+      fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
+      fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
+   }
+
+   for (auto &res : fragment_resources.sampled_images)
+   {
+      uint32_t binding = fragment_compiler.get_decoration(res.id, spv::DecorationBinding);
+      fragment_compiler.set_name(res.id, string("RARCH_TEXTURE_") + to_string(binding));
+      fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
+      fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
+      out->texture_bindings.push_back(binding);
+   }
+
+   for (auto &res : vertex_resources.stage_inputs)
+      out->attrib_locations.push_back(
+            vertex_compiler.get_decoration(res.id, spv::DecorationLocation));
+
+   out->vertex_source   = vertex_compiler.compile();
+   out->fragment_source = fragment_compiler.compile();
+   return true;
+}
+
+static void gl_core_cross_cache_push_words(std::vector<uint8_t> &blob,
+      const std::vector<uint32_t> &words)
+{
+   uint32_t count = (uint32_t)words.size();
+   const uint8_t *count_ptr = (const uint8_t*)&count;
+   const uint8_t *words_ptr = (const uint8_t*)words.data();
+
+   blob.insert(blob.end(), count_ptr, count_ptr + sizeof(count));
+   blob.insert(blob.end(), words_ptr, words_ptr + count * sizeof(uint32_t));
+}
+
+static bool gl_core_cross_cache_pop_words(const std::vector<uint8_t> &blob,
+      size_t *offset, std::vector<uint32_t> *words)
+{
+   uint32_t count = 0;
+
+   if (*offset + sizeof(count) > blob.size())
+      return false;
+   memcpy(&count, blob.data() + *offset, sizeof(count));
+   *offset += sizeof(count);
+
+   if (count > (blob.size() - *offset) / sizeof(uint32_t))
+      return false;
+
+   words->resize(count);
+   memcpy(words->data(), blob.data() + *offset, count * sizeof(uint32_t));
+   *offset += count * sizeof(uint32_t);
+   return true;
+}
+
+/* Cached as: attribute locations, texture bindings,
+ * then both sources NUL terminated. */
+static bool gl_core_cross_cache_read(const std::string &key,
+      gl_core_cross_output *out)
+{
+   size_t offset = 0;
+   size_t vertex_len;
+   std::vector<uint8_t> blob;
+   const char *sources;
+
+   if (!glslang_cache_read("glcore", key, &blob))
+      return false;
+
+   if (!gl_core_cross_cache_pop_words(blob, &offset, &out->attrib_locations)
+         || !gl_core_cross_cache_pop_words(blob, &offset, &out->texture_bindings)
+         || offset >= blob.size()
+         || blob.back() != '\0')
+      return false;
+
+   sources    = (const char*)blob.data() + offset;
+   vertex_len = strlen(sources);
+
+   if (offset + vertex_len + 1 >= blob.size())
+      return false;
+
+   out->vertex_source   = sources;
+   out->fragment_source = sources + vertex_len + 1;
+   return true;
+}
+
+static void gl_core_cross_cache_write(const std::string &key,
+      const gl_core_cross_output *out)
+{
+   std::vector<uint8_t> blob;
+
+   gl_core_cross_cache_push_words(blob, out->attrib_locations);
+   gl_core_cross_cache_push_words(blob, out->texture_bindings);
+   blob.insert(blob.end(), out->vertex_source.begin(), out->vertex_source.end());
+   blob.push_back('\0');
+   blob.insert(blob.end(), out->fragment_source.begin(), out->fragment_source.end());
+   blob.push_back('\0');
+
+   glslang_cache_write("glcore", key, blob);
+}
+
+GLuint gl_core_cross_compile_program(
+      const uint32_t *vertex, size_t vertex_size,
+      const uint32_t *fragment, size_t fragment_size,
+      gl_core_buffer_locations *loc, bool flatten)
+{
+   GLuint program = 0;
+   try
+   {
+      gl_core_cross_output cross;
+      std::string key;
 
-      for (auto &res : fragment_resources.uniform_buffers)
       {
-         if (flatten)
-            fragment_compiler.flatten_buffer_block(res.id);
-         fragment_compiler.set_name(res.id, "RARCH_UBO_FRAGMENT_INSTANCE");
-         fragment_compiler.set_name(res.base_type_id, "RARCH_UBO_FRAGMENT");
-         fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
-         fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
+         std::string spirv((const char*)vertex, vertex_size);
+         char options[64];
+
+         snprintf(options, sizeof(options), "%u %d %d",
+               gl_core_get_cross_compiler_target_version(),
+#ifdef HAVE_OPENGLES3
+               1,
+#else
+               0,
+#endif
+               flatten ? 1 : 0);
+
+         spirv.append((const char*)fragment, fragment_size);
+         spirv.append(options);
+         key = glslang_cache_hash(spirv);
       }
 
-      std::vector<uint32_t> texture_binding_fixups;
-      for (auto &res : fragment_resources.sampled_images)
+      if (!gl_core_cross_cache_read(key, &cross))
       {
-         uint32_t binding = fragment_compiler.get_decoration(res.id, spv::DecorationBinding);
-         fragment_compiler.set_name(res.id, string("RARCH_TEXTURE_") + to_string(binding));
-         fragment_compiler.unset_decoration(res.id, spv::DecorationDescriptorSet);
-         fragment_compiler.unset_decoration(res.id, spv::DecorationBinding);
-         texture_binding_fixups.push_back(binding);
+         cross = gl_core_cross_output();
+         if (!gl_core_cross_compile_sources(vertex, vertex_size,
+                  fragment, fragment_size, flatten, &cross))
+            return 0;
+         gl_core_cross_cache_write(key, &cross);
       }
 
-      auto vertex_source = vertex_compiler.compile();
-      auto fragment_source = fragment_compiler.compile();
+      const string &vertex_source   = cross.vertex_source;
+      const string &fragment_source = cross.fragment_source;
       GLuint vertex_shader = gl_core_compile_shader(GL_VERTEX_SHADER, vertex_source.c_str());
       GLuint fragment_shader = gl_core_compile_shader(GL_FRAGMENT_SHADER, fragment_source.c_str());
 
@@ -195,11 +323,8 @@ GLuint gl_core_cross_compile_program(
       program = glCreateProgram();
       glAttachShader(program, vertex_shader);
       glAttachShader(program, fragment_shader);
-      for (auto &res : vertex_resources.stage_inputs)
-      {
-         uint32_t location = vertex_compiler.get_decoration(res.id, spv::DecorationLocation);
+      for (auto &location : cross.attrib_locations)
          glBindAttribLocation(program, location, (string("RARCH_ATTRIBUTE_") + to_string(location)).c_str());
-      }
       glLinkProgram(program);
       glDeleteShader(vertex_shader);
       glDeleteShader(fragment_shader);
@@ -251,7 +376,7 @@ GLuint gl_core_cross_compile_program(
       }
 
       /* Force proper bindings for textures. */
-      for (auto &binding : texture_binding_fixups)
+      for (auto &binding : cross.texture_bindings)
       {
          GLint location = glGetUniformLocation(program, (string("RARCH_TEXTURE_") + to_string(binding)).c_str());
          if (location >= 0)
@@ -1617,6 +1742,7 @@ public:
    void set_frame_count_period(unsigned pass, unsigned period);
    void set_frame_direction(int32_t direction);
    void set_pass_name(unsigned pass, const char *name);
+   void set_timer(gl_timer_t *timer);
 
    void add_static_texture(unique_ptr<gl_core_shader::StaticTexture> texture);
    void add_parameter(unsigned pass, unsigned parameter_index, const std::string &id);
@@ -1630,6 +1756,7 @@ private:
    gl_core_shader::CommonResources common;
 
    gl_core_filter_chain_texture input_texture = {};
+   gl_timer_t *timer = nullptr;
 
    bool init_history();
    bool init_feedback();
@@ -1714,6 +1841,7 @@ void gl_core_filter_chain::build_offscreen_passes(const gl_core_viewport &vp)
 
    for (i = 0; i < passes.size() - 1; i++)
    {
+      gl_timer_pass(timer, i);
       passes[i]->build_commands(original, source, vp, nullptr);
 
       const gl_core_shader::Framebuffer &fb   = passes[i]->get_framebuffer();
@@ -1804,6 +1932,7 @@ void gl_core_filter_chain::build_viewport_pass(
       source.address                 = passes.back()->get_address_mode();
    }
 
+   gl_timer_pass(timer, passes.size() - 1);
    passes.back()->build_commands(original, source, vp, mvp);
 
    /* For feedback FBOs, swap current and previous. */
@@ -2087,6 +2216,11 @@ void gl_core_filter_chain::set_pass_name(unsigned pass, const char *name)
    passes[pass]->set_name(name);
 }
 
+void gl_core_filter_chain::set_timer(gl_timer_t *timer)
+{
+   this->timer = timer;
+}
+
 static unique_ptr<gl_core_shader::StaticTexture> gl_core_filter_chain_load_lut(
       gl_core_filter_chain *chain,
       const video_shader_lut *shader)
@@ -2526,6 +2660,13 @@ void gl_core_filter_chain_set_pass_name(
    chain->set_pass_name(pass, name);
 }
 
+void gl_core_filter_chain_set_timer(
+      gl_core_filter_chain_t *chain,
+      struct gl_timer *timer)
+{
+   chain->set_timer(timer);
+}
+
 void gl_core_filter_chain_build_offscreen_passes(
       gl_core_filter_chain_t *chain,
       const gl_core_viewport *vp)
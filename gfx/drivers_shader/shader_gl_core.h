@@ -26,6 +26,7 @@
 RETRO_BEGIN_DECLS
 
 typedef struct gl_core_filter_chain gl_core_filter_chain_t;
+struct gl_timer;
 
 enum gl_core_filter_chain_filter
 {
@@ -124,6 +125,10 @@ void gl_core_filter_chain_set_pass_name(gl_core_filter_chain_t *chain,
                                         unsigned pass,
                                         const char *name);
 
+/* Times each pass on the GPU. Timer may be NULL. */
+void gl_core_filter_chain_set_timer(gl_core_filter_chain_t *chain,
+                                    struct gl_timer *timer);
+
 void gl_core_filter_chain_build_offscreen_passes(gl_core_filter_chain_t *chain,
                                                  const struct gl_core_viewport *vp);
 void gl_core_filter_chain_build_viewport_pass(gl_core_filter_chain_t *chain,
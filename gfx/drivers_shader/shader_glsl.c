@@ -19,6 +19,7 @@
 
 #include <compat/strl.h>
 #include <compat/posix_string.h>
+#include <encodings/crc32.h>
 #include <file/file_path.h>
 #include <retro_assert.h>
 #include <streams/file_stream.h>
@@ -34,12 +35,44 @@
 #endif
 
 #include "shader_glsl.h"
+#include "../../configuration.h"
 #include "../../managers/state_manager.h"
 #include "../../core.h"
 #include "../../verbosity.h"
 
 #define PREV_TEXTURES (GFX_MAX_TEXTURES - 1)
 
+#if defined(HAVE_OPENGLES2)
+#define HAVE_GLSL_PROGRAM_BINARY
+#define glsl_get_program_binary glGetProgramBinaryOES
+#define glsl_program_binary     glProgramBinaryOES
+#elif defined(HAVE_OPENGLES3) || !defined(HAVE_OPENGLES)
+#define HAVE_GLSL_PROGRAM_BINARY
+#define glsl_get_program_binary glGetProgramBinary
+#define glsl_program_binary     glProgramBinary
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+/* "GLSB" */
+#define GLSL_BINARY_MAGIC 0x42534c47
+
+/* Header of a cached program binary. 'hash' and 'length'
+ * are taken over everything that went into compiling it. */
+struct glsl_binary_header
+{
+   uint32_t magic;
+   uint32_t hash;
+   uint32_t length;
+   uint32_t format;
+};
+
 /* Cache the VBO. */
 struct cache_vbo
 {
@@ -92,14 +125,43 @@ struct shader_uniforms
    int frame_direction;
 
    int lut_texture[GFX_MAX_TEXTURES];
+   int parameters[GFX_MAX_PARAMETERS];
    unsigned frame_count_mod;
 
+   /* Index of the values last set on the program, in
+    * uniform_values; the same for uniforms of shared programs */
+   unsigned values;
+
    struct shader_uniforms_frame orig;
    struct shader_uniforms_frame feedback;
    struct shader_uniforms_frame pass[GFX_MAX_SHADERS];
    struct shader_uniforms_frame prev[PREV_TEXTURES];
 };
 
+/* Uniforms at locations below this are only set when their
+ * value changes; uniforms are state of the program, kept
+ * across frames. */
+#define GLSL_UNIFORM_VALUES 64
+/* Locations of uniforms looked up by name */
+#define GLSL_UNIFORM_LOOKUPS 16
+
+struct glsl_uniform_value
+{
+   bool set;
+   union
+   {
+      GLint i;
+      GLfloat f[2];
+   } v;
+};
+
+struct glsl_uniform_lookup
+{
+   unsigned idx;
+   const char *ident;
+   GLint location;
+};
+
 static const char *glsl_prefixes[] = {
    "",
    "ruby",
@@ -115,6 +177,8 @@ static const char *glsl_prefixes[] = {
 #include "../drivers/gl_shaders/modern_alpha_blend.glsl.frag.h"
 #include "../drivers/gl_shaders/core_alpha_blend.glsl.vert.h"
 #include "../drivers/gl_shaders/core_alpha_blend.glsl.frag.h"
+#include "../drivers/gl_shaders/modern_font_sdf.glsl.frag.h"
+#include "../drivers/gl_shaders/modern_record_nv12.glsl.frag.h"
 
 #ifdef HAVE_SHADERPIPELINE
 #include "../drivers/gl_shaders/core_pipeline_snow.glsl.frag.h"
@@ -149,12 +213,22 @@ typedef struct glsl_shader_data
    float  current_mat_data[GFX_MAX_SHADERS];
    float* current_mat_data_pointer[GFX_MAX_SHADERS];
    struct shader_uniforms uniforms[GFX_MAX_SHADERS];
+   struct glsl_uniform_value uniform_values[GFX_MAX_SHADERS][GLSL_UNIFORM_VALUES];
+   struct glsl_uniform_lookup lookups[GLSL_UNIFORM_LOOKUPS];
+   unsigned num_lookups;
    struct cache_vbo vbo[GFX_MAX_SHADERS];
    struct shader_program_glsl_data prg[GFX_MAX_SHADERS];
    struct video_shader *shader;
+   /* Directory linked programs are cached in, empty if
+    * program binaries are not supported. */
+   char program_cache_dir[PATH_MAX_LENGTH];
 } glsl_shader_data_t;
 
 static bool glsl_core;
+/* VIDEO_SHADER_FONT_SDF was compiled */
+static bool glsl_font_sdf;
+/* VIDEO_SHADER_RECORD_NV12 was compiled */
+static bool glsl_record_nv12;
 static unsigned glsl_major;
 static unsigned glsl_minor;
 
@@ -339,6 +413,131 @@ static bool gl_glsl_link_program(GLuint prog)
    return true;
 }
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+static void gl_glsl_init_program_cache(glsl_shader_data_t *glsl)
+{
+   GLint formats        = 0;
+   settings_t *settings = config_get_ptr();
+
+   glsl->program_cache_dir[0] = '\0';
+
+   if (!settings || string_is_empty(settings->paths.directory_cache))
+      return;
+
+   glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+   if (formats <= 0)
+      return;
+
+   fill_pathname_join(glsl->program_cache_dir,
+         settings->paths.directory_cache, "shaders",
+         sizeof(glsl->program_cache_dir));
+
+   if (!path_is_directory(glsl->program_cache_dir)
+         && !path_mkdir(glsl->program_cache_dir))
+      glsl->program_cache_dir[0] = '\0';
+}
+
+static uint32_t gl_glsl_hash_string(uint32_t hash,
+      uint32_t *length, const char *str)
+{
+   /* Include the terminator, so concatenations
+    * of different strings hash differently. */
+   size_t len = str ? strlen(str) + 1 : 0;
+   *length   += (uint32_t)len;
+   return len ? encoding_crc32(hash, (const uint8_t*)str, len) : hash;
+}
+
+static uint32_t gl_glsl_program_hash(glsl_shader_data_t *glsl,
+      const struct shader_program_info *program_info,
+      uint32_t *length)
+{
+   char version[64];
+   uint32_t hash = 0;
+
+   snprintf(version, sizeof(version), "%d %u %u",
+         glsl_core ? 1 : 0, glsl_major, glsl_minor);
+
+   *length = 0;
+   hash    = gl_glsl_hash_string(hash, length,
+         (const char*)glGetString(GL_VENDOR));
+   hash    = gl_glsl_hash_string(hash, length,
+         (const char*)glGetString(GL_RENDERER));
+   hash    = gl_glsl_hash_string(hash, length,
+         (const char*)glGetString(GL_VERSION));
+   hash    = gl_glsl_hash_string(hash, length, version);
+   hash    = gl_glsl_hash_string(hash, length, glsl->alias_define);
+   hash    = gl_glsl_hash_string(hash, length, program_info->vertex);
+   hash    = gl_glsl_hash_string(hash, length, program_info->fragment);
+
+   return hash;
+}
+
+static bool gl_glsl_load_program_binary(GLuint prog,
+      const char *path, uint32_t hash, uint32_t length)
+{
+   GLint status                    = GL_FALSE;
+   void *buf                       = NULL;
+   int64_t len                     = 0;
+   const struct glsl_binary_header *header;
+
+   if (!path_is_valid(path))
+      return false;
+
+   if (filestream_read_file(path, &buf, &len) <= 0)
+      return false;
+
+   header = (const struct glsl_binary_header*)buf;
+
+   if (     len > (int64_t)sizeof(*header)
+         && header->magic  == GLSL_BINARY_MAGIC
+         && header->hash   == hash
+         && header->length == length)
+   {
+      glsl_program_binary(prog, header->format, header + 1,
+            (GLsizei)(len - sizeof(*header)));
+      glGetProgramiv(prog, GL_LINK_STATUS, &status);
+   }
+
+   free(buf);
+
+   /* Stale binaries (e.g. after a driver update) fail to
+    * load, and just get recompiled and overwritten. */
+   return status == GL_TRUE;
+}
+
+static void gl_glsl_save_program_binary(GLuint prog,
+      const char *path, uint32_t hash, uint32_t length)
+{
+   GLint size                         = 0;
+   GLsizei written                    = 0;
+   GLenum format                      = 0;
+   struct glsl_binary_header *header  = NULL;
+
+   glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &size);
+   if (size <= 0)
+      return;
+
+   header = (struct glsl_binary_header*)malloc(sizeof(*header) + size);
+   if (!header)
+      return;
+
+   glsl_get_program_binary(prog, size, &written, &format, header + 1);
+
+   if (written > 0)
+   {
+      header->magic  = GLSL_BINARY_MAGIC;
+      header->hash   = hash;
+      header->length = length;
+      header->format = format;
+
+      if (!filestream_write_file(path, header, sizeof(*header) + written))
+         RARCH_WARN("[GLSL]: Failed to write program binary %s.\n", path);
+   }
+
+   free(header);
+}
+#endif
+
 static bool gl_glsl_compile_program(
       void *data,
       unsigned idx,
@@ -348,6 +547,13 @@ static bool gl_glsl_compile_program(
    glsl_shader_data_t *glsl = (glsl_shader_data_t*)data;
    struct shader_program_glsl_data *program = (struct shader_program_glsl_data*)program_data;
    GLuint prog = glCreateProgram();
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+   char binary_path[PATH_MAX_LENGTH];
+   uint32_t binary_hash   = 0;
+   uint32_t binary_length = 0;
+
+   binary_path[0]         = '\0';
+#endif
 
    if (!program)
       program = &glsl->prg[idx];
@@ -355,6 +561,34 @@ static bool gl_glsl_compile_program(
    if (!prog)
       goto error;
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+   if (     !string_is_empty(glsl->program_cache_dir)
+         && (program_info->vertex || program_info->fragment))
+   {
+      char name[32];
+      uint32_t length = 0;
+      uint32_t hash   = gl_glsl_program_hash(glsl, program_info, &length);
+
+      snprintf(name, sizeof(name), "glsl_%08x.bin", (unsigned)hash);
+      fill_pathname_join(binary_path, glsl->program_cache_dir, name,
+            sizeof(binary_path));
+
+      if (gl_glsl_load_program_binary(prog, binary_path, hash, length))
+      {
+         RARCH_LOG("[GLSL]: Loaded program #%u from cache.\n", idx);
+         glUseProgram(prog);
+         glUniform1i(gl_glsl_get_uniform(glsl, prog, "Texture"), 0);
+         glUseProgram(0);
+
+         program->id = prog;
+         return true;
+      }
+
+      binary_hash   = hash;
+      binary_length = length;
+   }
+#endif
+
    if (program_info->vertex)
    {
       RARCH_LOG("[GLSL]: Found GLSL vertex shader.\n");
@@ -402,6 +636,12 @@ static bool gl_glsl_compile_program(
       program->vprg = 0;
       program->fprg = 0;
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+      if (!string_is_empty(binary_path))
+         gl_glsl_save_program_binary(prog, binary_path,
+               binary_hash, binary_length);
+#endif
+
       glUseProgram(prog);
       glUniform1i(gl_glsl_get_uniform(glsl, prog, "Texture"), 0);
       glUseProgram(0);
@@ -519,7 +759,7 @@ static void gl_glsl_set_vbo(GLfloat **buffer, size_t *buffer_elems,
 
    memcpy(*buffer, data, elems * sizeof(GLfloat));
    glBufferData(GL_ARRAY_BUFFER, elems * sizeof(GLfloat),
-         data, GL_STATIC_DRAW);
+         data, GL_STREAM_DRAW);
    *buffer_elems = elems;
 }
 
@@ -555,6 +795,66 @@ static INLINE void gl_glsl_set_attribs(glsl_shader_data_t *glsl,
    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+static struct glsl_uniform_value *gl_glsl_uniform_value(
+      glsl_shader_data_t *glsl, const struct shader_uniforms *uni,
+      GLint loc)
+{
+   if (loc < 0 || loc >= GLSL_UNIFORM_VALUES)
+      return NULL;
+   return &glsl->uniform_values[uni->values][loc];
+}
+
+static void gl_glsl_uniform1i(glsl_shader_data_t *glsl,
+      const struct shader_uniforms *uni, GLint loc, GLint i)
+{
+   struct glsl_uniform_value *value = gl_glsl_uniform_value(glsl, uni, loc);
+
+   if (value)
+   {
+      if (value->set && value->v.i == i)
+         return;
+      value->set = true;
+      value->v.i = i;
+   }
+
+   glUniform1i(loc, i);
+}
+
+static void gl_glsl_uniform1f(glsl_shader_data_t *glsl,
+      const struct shader_uniforms *uni, GLint loc, GLfloat f)
+{
+   struct glsl_uniform_value *value = gl_glsl_uniform_value(glsl, uni, loc);
+
+   if (value)
+   {
+      if (value->set && value->v.f[0] == f)
+         return;
+      value->set    = true;
+      value->v.f[0] = f;
+   }
+
+   glUniform1f(loc, f);
+}
+
+static void gl_glsl_uniform2fv(glsl_shader_data_t *glsl,
+      const struct shader_uniforms *uni, GLint loc, const GLfloat *f)
+{
+   struct glsl_uniform_value *value = gl_glsl_uniform_value(glsl, uni, loc);
+
+   if (value)
+   {
+      if (     value->set
+            && value->v.f[0] == f[0]
+            && value->v.f[1] == f[1])
+         return;
+      value->set    = true;
+      value->v.f[0] = f[0];
+      value->v.f[1] = f[1];
+   }
+
+   glUniform2fv(loc, 1, f);
+}
+
 static void gl_glsl_clear_uniforms_frame(struct shader_uniforms_frame *frame)
 {
    frame->texture      = -1;
@@ -620,6 +920,15 @@ static void gl_glsl_find_uniforms(glsl_shader_data_t *glsl,
    for (i = 0; i < glsl->shader->luts; i++)
       uni->lut_texture[i] = glGetUniformLocation(prog, glsl->shader->lut[i].id);
 
+   for (i = 0; i < glsl->shader->num_parameters; i++)
+      uni->parameters[i] = glGetUniformLocation(prog,
+            glsl->shader->parameters[i].id);
+
+   /* Freshly linked, nothing set yet */
+   uni->values = (unsigned)(uni - glsl->uniforms);
+   memset(glsl->uniform_values[uni->values], 0,
+         sizeof(glsl->uniform_values[uni->values]));
+
    gl_glsl_clear_uniforms_frame(&uni->orig);
    gl_glsl_find_uniforms_frame(glsl, prog, &uni->orig, "Orig");
    gl_glsl_clear_uniforms_frame(&uni->feedback);
@@ -852,6 +1161,7 @@ static void *gl_glsl_init(void *data, const char *path)
    unsigned i;
    struct shader_program_info shader_prog_info;
    bool shader_support        = false;
+   settings_t *settings       = config_get_ptr();
 #ifdef GLSL_DEBUG
    char *error_string         = NULL;
 #endif
@@ -892,6 +1202,10 @@ static void *gl_glsl_init(void *data, const char *path)
    if (!glsl->shader)
       goto error;
 
+#ifdef HAVE_GLSL_PROGRAM_BINARY
+   gl_glsl_init_program_cache(glsl);
+#endif
+
    {
       bool is_preset;
       enum rarch_shader_type type =
@@ -1053,6 +1367,50 @@ static void *gl_glsl_init(void *data, const char *path)
       glsl->uniforms[VIDEO_SHADER_STOCK_BLEND] = glsl->uniforms[0];
    }
 
+   /* Needs fwidth(), the core profile is left to the core driver */
+   glsl_font_sdf = false;
+#ifdef HAVE_OPENGLES
+   if (!glsl_core && gl_query_extension("GL_OES_standard_derivatives"))
+#else
+   if (!glsl_core)
+#endif
+   {
+      shader_prog_info.vertex   = stock_vertex_modern_blend;
+      shader_prog_info.fragment = stock_fragment_font_sdf;
+      shader_prog_info.is_file  = false;
+
+      RARCH_LOG("[GLSL]: Compiling distance field font shader..\n");
+      glsl_font_sdf = gl_glsl_compile_program(
+            glsl,
+            VIDEO_SHADER_FONT_SDF,
+            &glsl->prg[VIDEO_SHADER_FONT_SDF],
+            &shader_prog_info);
+
+      if (glsl_font_sdf)
+         gl_glsl_find_uniforms(glsl, 0, glsl->prg[VIDEO_SHADER_FONT_SDF].id,
+               &glsl->uniforms[VIDEO_SHADER_FONT_SDF]);
+   }
+
+   /* Only needed for GPU recording, which goes through the PBOs */
+   glsl_record_nv12 = false;
+   if (!glsl_core && settings->bools.video_gpu_record)
+   {
+      shader_prog_info.vertex   = stock_vertex_modern_blend;
+      shader_prog_info.fragment = stock_fragment_record_nv12;
+      shader_prog_info.is_file  = false;
+
+      RARCH_LOG("[GLSL]: Compiling NV12 recording shader..\n");
+      glsl_record_nv12 = gl_glsl_compile_program(
+            glsl,
+            VIDEO_SHADER_RECORD_NV12,
+            &glsl->prg[VIDEO_SHADER_RECORD_NV12],
+            &shader_prog_info);
+
+      if (glsl_record_nv12)
+         gl_glsl_find_uniforms(glsl, 0, glsl->prg[VIDEO_SHADER_RECORD_NV12].id,
+               &glsl->uniforms[VIDEO_SHADER_RECORD_NV12]);
+   }
+
    gl_glsl_reset_attrib(glsl);
 
    for (i = 0; i < GFX_MAX_SHADERS; i++)
@@ -1079,16 +1437,56 @@ static void gl_glsl_set_uniform_parameter(
       struct uniform_info *param,
       void *uniform_data)
 {
-   GLint            location = 0;
-   glsl_shader_data_t  *glsl = (glsl_shader_data_t*)data;
+   GLint                   location = 0;
+   struct glsl_uniform_value  *value = NULL;
+   glsl_shader_data_t         *glsl  = (glsl_shader_data_t*)data;
 
    if (!glsl || !param)
       return;
 
    if (param->lookup.enable)
-      location = glGetUniformLocation(glsl->prg[param->lookup.idx].id, param->lookup.ident);
+   {
+      unsigned i;
+      unsigned idx = param->lookup.idx;
+
+      location     = -1;
+
+      for (i = 0; i < glsl->num_lookups; i++)
+      {
+         if (     glsl->lookups[i].idx == idx
+               && string_is_equal(glsl->lookups[i].ident, param->lookup.ident))
+         {
+            location = glsl->lookups[i].location;
+            break;
+         }
+      }
+
+      if (i == glsl->num_lookups)
+      {
+         location = glGetUniformLocation(glsl->prg[idx].id, param->lookup.ident);
+
+         /* The names are literals, kept as long as the driver */
+         if (glsl->num_lookups < GLSL_UNIFORM_LOOKUPS)
+         {
+            glsl->lookups[i].idx      = idx;
+            glsl->lookups[i].ident    = param->lookup.ident;
+            glsl->lookups[i].location = location;
+            glsl->num_lookups++;
+         }
+      }
+
+      value = gl_glsl_uniform_value(glsl, &glsl->uniforms[idx], location);
+   }
    else
+   {
       location = param->location;
+      value    = gl_glsl_uniform_value(glsl,
+            &glsl->uniforms[glsl->active_idx], location);
+   }
+
+   /* Set behind the back of the values kept */
+   if (value)
+      value->set = false;
 
    switch (param->type)
    {
@@ -1172,13 +1570,13 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
    texture_size[1] = (float)tex_height;
 
    if (uni->input_size >= 0)
-      glUniform2fv(uni->input_size, 1, input_size);
+      gl_glsl_uniform2fv(glsl, uni, uni->input_size, input_size);
 
    if (uni->output_size >= 0)
-      glUniform2fv(uni->output_size, 1, output_size);
+      gl_glsl_uniform2fv(glsl, uni, uni->output_size, output_size);
 
    if (uni->texture_size >= 0)
-      glUniform2fv(uni->texture_size, 1, texture_size);
+      gl_glsl_uniform2fv(glsl, uni, uni->texture_size, texture_size);
 
    if (uni->frame_count >= 0 && glsl->active_idx)
    {
@@ -1187,11 +1585,11 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
       if (modulo)
          frame_count %= modulo;
 
-      glUniform1i(uni->frame_count, frame_count);
+      gl_glsl_uniform1i(glsl, uni, uni->frame_count, frame_count);
    }
 
    if (uni->frame_direction >= 0)
-      glUniform1i(uni->frame_direction, state_manager_frame_is_reversed() ? -1 : 1);
+      gl_glsl_uniform1i(glsl, uni, uni->frame_direction, state_manager_frame_is_reversed() ? -1 : 1);
 
    /* Set lookup textures. */
    for (i = 0; i < glsl->shader->luts; i++)
@@ -1202,7 +1600,7 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
       /* Have to rebind as HW render could override this. */
       glActiveTexture(GL_TEXTURE0 + texunit);
       glBindTexture(GL_TEXTURE_2D, glsl->lut_textures[i]);
-      glUniform1i(uni->lut_texture[i], texunit);
+      gl_glsl_uniform1i(glsl, uni, uni->lut_texture[i], texunit);
       texunit++;
    }
 
@@ -1213,16 +1611,16 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
       {
          /* Bind original texture. */
          glActiveTexture(GL_TEXTURE0 + texunit);
-         glUniform1i(uni->orig.texture, texunit);
+         gl_glsl_uniform1i(glsl, uni, uni->orig.texture, texunit);
          glBindTexture(GL_TEXTURE_2D, info->tex);
          texunit++;
       }
 
       if (uni->orig.texture_size >= 0)
-         glUniform2fv(uni->orig.texture_size, 1, info->tex_size);
+         gl_glsl_uniform2fv(glsl, uni, uni->orig.texture_size, info->tex_size);
 
       if (uni->orig.input_size >= 0)
-         glUniform2fv(uni->orig.input_size, 1, info->input_size);
+         gl_glsl_uniform2fv(glsl, uni, uni->orig.input_size, info->input_size);
 
       /* Pass texture coordinates. */
       if (uni->orig.tex_coord >= 0)
@@ -1249,16 +1647,16 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
       {
          /* Bind original texture. */
          glActiveTexture(GL_TEXTURE0 + texunit);
-         glUniform1i(uni->feedback.texture, texunit);
+         gl_glsl_uniform1i(glsl, uni, uni->feedback.texture, texunit);
          glBindTexture(GL_TEXTURE_2D, feedback_info->tex);
          texunit++;
       }
 
       if (uni->feedback.texture_size >= 0)
-         glUniform2fv(uni->feedback.texture_size, 1, feedback_info->tex_size);
+         gl_glsl_uniform2fv(glsl, uni, uni->feedback.texture_size, feedback_info->tex_size);
 
       if (uni->feedback.input_size >= 0)
-         glUniform2fv(uni->feedback.input_size, 1, feedback_info->input_size);
+         gl_glsl_uniform2fv(glsl, uni, uni->feedback.input_size, feedback_info->input_size);
 
       /* Pass texture coordinates. */
       if (uni->feedback.tex_coord >= 0)
@@ -1283,19 +1681,19 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
       /* Bind FBO textures. */
       for (i = 0; i < fbo_info_cnt; i++)
       {
-         if (uni->pass[i].texture)
+         if (uni->pass[i].texture >= 0)
          {
             glActiveTexture(GL_TEXTURE0 + texunit);
             glBindTexture(GL_TEXTURE_2D, fbo_info[i].tex);
-            glUniform1i(uni->pass[i].texture, texunit);
+            gl_glsl_uniform1i(glsl, uni, uni->pass[i].texture, texunit);
             texunit++;
          }
 
           if (uni->pass[i].texture_size >= 0)
-            glUniform2fv(uni->pass[i].texture_size, 1, fbo_info[i].tex_size);
+            gl_glsl_uniform2fv(glsl, uni, uni->pass[i].texture_size, fbo_info[i].tex_size);
 
          if (uni->pass[i].input_size >= 0)
-            glUniform2fv(uni->pass[i].input_size, 1, fbo_info[i].input_size);
+            gl_glsl_uniform2fv(glsl, uni, uni->pass[i].input_size, fbo_info[i].input_size);
 
          if (uni->pass[i].tex_coord >= 0)
          {
@@ -1325,15 +1723,15 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
       {
          glActiveTexture(GL_TEXTURE0 + texunit);
          glBindTexture(GL_TEXTURE_2D, prev_info[i].tex);
-         glUniform1i(uni->prev[i].texture, texunit);
+         gl_glsl_uniform1i(glsl, uni, uni->prev[i].texture, texunit);
          texunit++;
       }
 
       if (uni->prev[i].texture_size >= 0)
-         glUniform2fv(uni->prev[i].texture_size, 1, prev_info[i].tex_size);
+         gl_glsl_uniform2fv(glsl, uni, uni->prev[i].texture_size, prev_info[i].tex_size);
 
       if (uni->prev[i].input_size >= 0)
-         glUniform2fv(uni->prev[i].input_size, 1, prev_info[i].input_size);
+         gl_glsl_uniform2fv(glsl, uni, uni->prev[i].input_size, prev_info[i].input_size);
 
       /* Pass texture coordinates. */
       if (uni->prev[i].tex_coord >= 0)
@@ -1367,11 +1765,9 @@ static void gl_glsl_set_params(void *dat, void *shader_data)
    /* #pragma parameters. */
    for (i = 0; i < glsl->shader->num_parameters; i++)
    {
-
-      int location = glGetUniformLocation(
-            glsl->prg[glsl->active_idx].id,
-            glsl->shader->parameters[i].id);
-      glUniform1f(location, glsl->shader->parameters[i].current);
+      if (uni->parameters[i] >= 0)
+         gl_glsl_uniform1f(glsl, uni, uni->parameters[i],
+               glsl->shader->parameters[i].current);
    }
 }
 
@@ -1573,6 +1969,30 @@ static bool gl_glsl_mipmap_input(void *data, unsigned idx)
    return false;
 }
 
+static bool gl_glsl_is_time_dependent(void *data, unsigned idx)
+{
+   unsigned i;
+   const struct shader_uniforms *uni = NULL;
+   glsl_shader_data_t *glsl          = (glsl_shader_data_t*)data;
+
+   if (!glsl || !idx || idx > glsl->shader->passes)
+      return true;
+
+   uni = &glsl->uniforms[idx];
+
+   /* FrameCount modulo 1 is always 0. */
+   if (uni->frame_count >= 0 && glsl->shader->pass[idx - 1].frame_count_mod != 1)
+      return true;
+   if (uni->frame_direction >= 0 || uni->feedback.texture >= 0)
+      return true;
+
+   for (i = 0; i < PREV_TEXTURES; i++)
+      if (uni->prev[i].texture >= 0)
+         return true;
+
+   return false;
+}
+
 static bool gl_glsl_get_feedback_pass(void *data, unsigned *index)
 {
    glsl_shader_data_t *glsl = (glsl_shader_data_t*)data;
@@ -1607,6 +2027,10 @@ void gl_glsl_set_context_type(bool core_profile,
 static void gl_glsl_get_flags(uint32_t *flags)
 {
    BIT32_SET(*flags, GFX_CTX_FLAGS_SHADERS_GLSL);
+   if (glsl_font_sdf)
+      BIT32_SET(*flags, GFX_CTX_FLAGS_FONT_DISTANCE_FIELD);
+   if (glsl_record_nv12)
+      BIT32_SET(*flags, GFX_CTX_FLAGS_RECORD_NV12);
 }
 
 const shader_backend_t gl_glsl_backend = {
@@ -1626,6 +2050,7 @@ const shader_backend_t gl_glsl_backend = {
    gl_glsl_get_prev_textures,
    gl_glsl_get_feedback_pass,
    gl_glsl_mipmap_input,
+   gl_glsl_is_time_dependent,
    gl_glsl_get_current_shader,
    gl_glsl_get_flags,
 
@@ -353,6 +353,13 @@ class Pass
          frame_direction = direction;
       }
 
+      void set_surface_viewport(const VkViewport *vp)
+      {
+         use_surface_viewport = vp != nullptr;
+         if (vp)
+            surface_viewport = *vp;
+      }
+
       void set_name(const char *name)
       {
          pass_name = name;
@@ -419,6 +426,9 @@ class Pass
 
       Size2D current_framebuffer_size;
       VkViewport current_viewport;
+      /* Where the final pass lands, if not current_viewport */
+      VkViewport surface_viewport;
+      bool use_surface_viewport = false;
       vulkan_filter_chain_pass_info pass_info;
 
       vector<uint32_t> vertex_shader;
@@ -513,6 +523,7 @@ struct vulkan_filter_chain
       void build_offscreen_passes(VkCommandBuffer cmd, const VkViewport &vp);
       void build_viewport_pass(VkCommandBuffer cmd,
             const VkViewport &vp, const float *mvp);
+      void set_surface_viewport(const VkViewport *vp);
       void end_frame(VkCommandBuffer cmd);
 
       void set_frame_count(uint64_t count);
@@ -1133,6 +1144,11 @@ void vulkan_filter_chain::set_frame_direction(int32_t direction)
       passes[i]->set_frame_direction(direction);
 }
 
+void vulkan_filter_chain::set_surface_viewport(const VkViewport *vp)
+{
+   passes.back()->set_surface_viewport(vp);
+}
+
 void vulkan_filter_chain::set_pass_name(unsigned pass, const char *name)
 {
    passes[pass]->set_name(name);
@@ -2300,17 +2316,19 @@ void Pass::build_commands(
 
    if (final_pass)
    {
+      const VkViewport &_vp = use_surface_viewport
+         ? surface_viewport : current_viewport;
       const VkRect2D sci = {
          {
-            int32_t(current_viewport.x),
-            int32_t(current_viewport.y)
+            int32_t(_vp.x),
+            int32_t(_vp.y)
          },
          {
-            uint32_t(current_viewport.width),
-            uint32_t(current_viewport.height)
+            uint32_t(_vp.width),
+            uint32_t(_vp.height)
          },
       };
-      vkCmdSetViewport(cmd, 0, 1, &current_viewport);
+      vkCmdSetViewport(cmd, 0, 1, &_vp);
       vkCmdSetScissor(cmd, 0, 1, &sci);
    }
    else
@@ -2985,6 +3003,12 @@ void vulkan_filter_chain_build_viewport_pass(
    chain->build_viewport_pass(cmd, *vp, mvp);
 }
 
+void vulkan_filter_chain_set_surface_viewport(
+      vulkan_filter_chain_t *chain, const VkViewport *vp)
+{
+   chain->set_surface_viewport(vp);
+}
+
 void vulkan_filter_chain_end_frame(
       vulkan_filter_chain_t *chain,
       VkCommandBuffer cmd)
@@ -173,6 +173,10 @@ void vulkan_filter_chain_build_offscreen_passes(vulkan_filter_chain_t *chain,
       VkCommandBuffer cmd, const VkViewport *vp);
 void vulkan_filter_chain_build_viewport_pass(vulkan_filter_chain_t *chain,
       VkCommandBuffer cmd, const VkViewport *vp, const float *mvp);
+/* Where the viewport pass lands on a pre-rotated surface,
+ * NULL if that's the viewport it's built for. */
+void vulkan_filter_chain_set_surface_viewport(vulkan_filter_chain_t *chain,
+      const VkViewport *vp);
 void vulkan_filter_chain_end_frame(vulkan_filter_chain_t *chain,
       VkCommandBuffer cmd);
 
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #ifdef HAVE_CONFIG_H
@@ -48,6 +49,21 @@ static const font_renderer_driver_t *font_backends[] = {
 
 static void *video_font_driver = NULL;
 
+/* Widths of the short strings measured last, per font.
+ * The menus measure the same labels, and each character
+ * of their tickers, every frame. */
+#define FONT_WIDTH_CACHE_SIZE    256
+#define FONT_WIDTH_CACHE_MAX_LEN 47
+
+struct font_width_cache_entry
+{
+   float scale;
+   uint32_t hash;
+   int width;
+   uint8_t len;
+   char msg[FONT_WIDTH_CACHE_MAX_LEN];
+};
+
 int font_renderer_create_default(
       const font_renderer_driver_t **drv,
       void **handle,
@@ -83,6 +99,36 @@ int font_renderer_create_default(
    return 0;
 }
 
+int font_renderer_create_distance_field(
+      const font_renderer_driver_t **drv,
+      void **handle,
+      const char *font_path, unsigned font_size)
+{
+#ifdef HAVE_STB_FONT
+   const char *path = font_path;
+
+   if (!path)
+      path = stb_sdf_font_renderer.get_default_font();
+
+   if (path)
+   {
+      *handle = stb_sdf_font_renderer.init(path, font_size);
+      if (*handle)
+      {
+         RARCH_LOG("[Font]: Using font rendering backend: %s.\n",
+               stb_sdf_font_renderer.ident);
+         *drv = &stb_sdf_font_renderer;
+         return 1;
+      }
+   }
+#endif
+
+   *drv    = NULL;
+   *handle = NULL;
+
+   return 0;
+}
+
 #ifdef HAVE_D3D8
 static const font_renderer_t *d3d8_font_backends[] = {
 #if defined(_XBOX1)
@@ -1076,12 +1122,49 @@ void font_driver_flush(unsigned width, unsigned height, void *font_data,
 int font_driver_get_message_width(void *font_data,
       const char *msg, unsigned len, float scale)
 {
+   unsigned i;
+   uint32_t hash;
+   struct font_width_cache_entry *entry = NULL;
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
    if (len == 0 && msg)
       len = (unsigned)strlen(msg);
-   if (font && font->renderer && font->renderer->get_message_width)
+   if (!font || !font->renderer || !font->renderer->get_message_width)
+      return -1;
+
+   /* Fonts are used from the video thread as well
+    * when there is one */
+   if (!msg || len > FONT_WIDTH_CACHE_MAX_LEN || video_driver_is_threaded())
       return font->renderer->get_message_width(font->renderer_data, msg, len, scale);
-   return -1;
+
+   if (!font->width_cache)
+   {
+      font->width_cache = (struct font_width_cache_entry*)calloc(
+            FONT_WIDTH_CACHE_SIZE, sizeof(*font->width_cache));
+      if (!font->width_cache)
+         return font->renderer->get_message_width(font->renderer_data, msg, len, scale);
+   }
+
+   /* FNV-1a */
+   hash = 2166136261u;
+   for (i = 0; i < len; i++)
+      hash = (hash ^ (uint8_t)msg[i]) * 16777619u;
+
+   entry = &font->width_cache[hash & (FONT_WIDTH_CACHE_SIZE - 1)];
+
+   if (     entry->len   == len
+         && entry->hash  == hash
+         && entry->scale == scale
+         && !memcmp(entry->msg, msg, len))
+      return entry->width;
+
+   entry->width = font->renderer->get_message_width(
+         font->renderer_data, msg, len, scale);
+   entry->scale = scale;
+   entry->hash  = hash;
+   entry->len   = len;
+   memcpy(entry->msg, msg, len);
+
+   return entry->width;
 }
 
 int font_driver_get_line_height(void *font_data, float scale)
@@ -1116,6 +1199,7 @@ void font_driver_free(void *font_data)
       font->renderer      = NULL;
       font->renderer_data = NULL;
 
+      free(font->width_cache);
       free(font);
    }
 }
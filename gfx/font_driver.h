@@ -58,6 +58,15 @@ struct font_atlas
    uint8_t *buffer; /* Alpha channel. */
    unsigned width;
    unsigned height;
+   /* Bumped whenever a glyph is replaced by another,
+    * so that cached layouts know to be built again. */
+   unsigned generation;
+   /* Non-zero if the atlas holds distance fields rather than
+    * coverage: this many atlas pixels of distance are kept
+    * around each outline, 0.5 being on it. Each atlas pixel is
+    * then drawn glyph_scale pixels wide. */
+   unsigned distance_spread;
+   float glyph_scale;
    bool dirty;
 };
 
@@ -117,10 +126,13 @@ typedef struct font_renderer_driver
    int (*get_line_height)(void* data);
 } font_renderer_driver_t;
 
+struct font_width_cache_entry;
+
 typedef struct
 {
    const font_renderer_t *renderer;
    void *renderer_data;
+   struct font_width_cache_entry *width_cache;
    float size;
 } font_data_t;
 
@@ -130,6 +142,13 @@ int font_renderer_create_default(
       void **handle,
       const char *font_path, unsigned font_size);
 
+/* Same as font_renderer_create_default(), with a renderer whose
+ * atlas holds distance fields. Returns 0 if there's none. */
+int font_renderer_create_distance_field(
+      const font_renderer_driver_t **drv,
+      void **handle,
+      const char *font_path, unsigned font_size);
+
 void font_driver_render_msg(void *data,
       video_frame_info_t *video_info,
       const char *msg, const void *params, void *font_data);
@@ -183,6 +202,7 @@ extern font_renderer_t switch_font;
 
 extern font_renderer_driver_t stb_font_renderer;
 extern font_renderer_driver_t stb_unicode_font_renderer;
+extern font_renderer_driver_t stb_sdf_font_renderer;
 extern font_renderer_driver_t freetype_font_renderer;
 extern font_renderer_driver_t coretext_font_renderer;
 extern font_renderer_driver_t bitmap_font_renderer;
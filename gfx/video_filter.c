@@ -14,6 +14,7 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <file/file_path.h>
@@ -35,6 +36,14 @@
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
 
+/* Work packets requested from the filter per worker thread. */
+#define SOFTFILTER_PACKETS_PER_THREAD 4
+
+/* Time spent filtering each frame, shown in the statistics
+ * and logged when the filter is unloaded. */
+static rarch_histogram_t softfilter_histogram;
+static char softfilter_histogram_ident[64];
+
 struct rarch_soft_plug
 {
 #ifdef HAVE_DYLIB
@@ -44,42 +53,28 @@ struct rarch_soft_plug
 };
 
 #ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
-struct filter_thread_data
+#include <rthreads/tpool.h>
+
+/* Work packets are handed out one at a time to whichever
+ * worker is free, so the filter can split a frame into more
+ * packets than there are workers and uneven packets still
+ * balance out. The thread calling rarch_softfilter_process
+ * takes packets too. */
+struct filter_pool_frame
 {
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
+   const struct softfilter_work_packet *packets;
    void *userdata;
-   bool die;
-   bool done;
 };
 
-static void filter_thread_loop(void *data)
+static void filter_pool_run_packets(void *data, size_t begin, size_t end)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   struct filter_pool_frame *frame = (struct filter_pool_frame*)data;
 
-   for (;;)
+   for (; begin < end; begin++)
    {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
-
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
-
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
+      const struct softfilter_work_packet *packet = &frame->packets[begin];
+      if (packet->work)
+         packet->work(frame->userdata, packet->thread_data);
    }
 }
 #endif
@@ -101,7 +96,7 @@ struct rarch_softfilter
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   tpool_t *pool;
 #endif
 };
 
@@ -207,29 +202,42 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_width = max_width;
    filt->max_height = max_height;
 
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+      threads = cpu_features_get_core_amount();
+   if (!threads)
+      threads = 1;
+
+   /* Ask for several packets per worker; filters that can
+    * only run as one packet just ignore the request. */
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
+         threads > 1 ? threads * SOFTFILTER_PACKETS_PER_THREAD : 1,
+         cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
       return false;
    }
 
-   threads = filt->impl->query_num_threads(filt->impl_data);
-   if (!threads)
+   snprintf(softfilter_histogram_ident, sizeof(softfilter_histogram_ident),
+         "Softfilter %s", filt->impl->short_ident);
+   rarch_histogram_register(&softfilter_histogram, softfilter_histogram_ident);
+   rarch_histogram_reset(&softfilter_histogram);
+
+   filt->threads = filt->impl->query_num_threads(filt->impl_data);
+   if (!filt->threads)
    {
       RARCH_ERR("Invalid number of threads.\n");
       return false;
    }
 
-   filt->threads = threads;
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
+   if (threads > filt->threads)
+      threads = filt->threads;
+   RARCH_LOG("Using %u threads and %u work packets for softfilter.\n",
+         threads, filt->threads);
 
    filt->packets = (struct softfilter_work_packet*)
-      calloc(threads, sizeof(*filt->packets));
+      calloc(filt->threads, sizeof(*filt->packets));
    if (!filt->packets)
    {
       RARCH_ERR("Failed to allocate softfilter packets.\n");
@@ -237,27 +245,15 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
 #ifdef HAVE_THREADS
-   if(filt->threads>1){
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
-         return false;
-
-      for (i = 0; i < threads; i++)
+   /* The calling thread works on packets as well. */
+   if (threads > 1)
+   {
+      filt->pool = tpool_create_with_role(threads - 1,
+            STHREAD_ROLE_FILTER);
+      if (!filt->pool)
       {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done = true;
-
-         filt->thread_data[i].lock = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
+         RARCH_ERR("Failed to create softfilter worker threads.\n");
+         return false;
       }
    }
 #endif
@@ -457,12 +453,22 @@ error:
 
 void rarch_softfilter_free(rarch_softfilter_t *filt)
 {
+   rarch_histogram_stats_t stats;
    unsigned i = 0;
    (void)i;
 
    if (!filt)
       return;
 
+   if (filt->impl_data && rarch_histogram_get_stats(
+            &softfilter_histogram, &stats))
+      RARCH_LOG("[SoftFilter]: %s: %.2f ms/frame avg, %.2f ms p99, "
+            "%.2f ms max over %u frames.\n",
+            filt->impl->ident,
+            stats.avg / 1000.0, stats.p99 / 1000.0, stats.max / 1000.0,
+            stats.samples);
+   rarch_histogram_reset(&softfilter_histogram);
+
    free(filt->packets);
    if (filt->impl && filt->impl_data)
       filt->impl->destroy(filt->impl_data);
@@ -477,21 +483,7 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
 #endif
 
 #ifdef HAVE_THREADS
-   if(filt->threads>1){
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
+   tpool_destroy(filt->pool);
 #endif
 
    if (filt->conf)
@@ -528,46 +520,36 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       size_t input_stride)
 {
    unsigned i;
+   retro_time_t start;
 
    if (!filt)
       return;
 
+   start = cpu_features_get_time_usec();
+
    if (filt->impl && filt->impl->get_work_packets)
       filt->impl->get_work_packets(filt->impl_data, filt->packets,
             output, output_stride, input, width, height, input_stride);
 
 #ifdef HAVE_THREADS
-   if(filt->threads>1){
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+   if (filt->pool)
+   {
+      struct filter_pool_frame frame;
 
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
+      frame.packets  = filt->packets;
+      frame.userdata = filt->impl_data;
+
+      tpool_parallel_for(filt->pool, filt->threads, 1,
+            filter_pool_run_packets, &frame);
+   }
+   else
 #endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-   } else {
+   {
       for (i = 0; i < filt->threads; i++)
          filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
    }
-#else
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
-#endif
+
+   rarch_histogram_add(&softfilter_histogram,
+         cpu_features_get_time_usec() - start);
+   rarch_trace_end("Softfilter", start);
 }
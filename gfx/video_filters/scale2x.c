@@ -108,6 +108,123 @@ static void scale2x_generic_xrgb8888(unsigned width, unsigned height,
          src, src_stride, dst, dst_stride, out0, out1);
 }
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SCALE2X_NEON
+#include <arm_neon.h>
+
+/* Handles a single pixel at column x, for the borders
+ * and leftovers of the vector loops. */
+#define SCALE2X_PIXEL(typename_t, src, x, width, prevline, nextline, out0, out1) \
+   { \
+      const typename_t A = *(src + (x) - prevline); \
+      const typename_t B = ((x) > 0) ? *(src + (x) - 1) : *(src + (x)); \
+      const typename_t C = *(src + (x)); \
+      const typename_t D = ((x) < (width) - 1) ? *(src + (x) + 1) : *(src + (x)); \
+      const typename_t E = *(src + (x) + nextline); \
+      \
+      if (A != E && B != D) \
+      { \
+         out0[2 * (x) + 0] = (A == B ? A : C); \
+         out0[2 * (x) + 1] = (A == D ? A : C); \
+         out1[2 * (x) + 0] = (E == B ? E : C); \
+         out1[2 * (x) + 1] = (E == D ? E : C); \
+      } \
+      else \
+      { \
+         out0[2 * (x) + 0] = C; \
+         out0[2 * (x) + 1] = C; \
+         out1[2 * (x) + 0] = C; \
+         out1[2 * (x) + 1] = C; \
+      } \
+   }
+
+static void scale2x_neon_rgb565(unsigned width, unsigned height,
+      int first, int last,
+      const uint16_t *src, unsigned src_stride,
+      uint16_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++, src += src_stride,
+         dst += dst_stride * SCALE2X_SCALE)
+   {
+      const int prevline = ((y == 0) && first) ? 0 : src_stride;
+      const int nextline = ((y == height - 1) && last) ? 0 : src_stride;
+      uint16_t *out0     = dst;
+      uint16_t *out1     = dst + dst_stride;
+
+      SCALE2X_PIXEL(uint16_t, src, 0, width, prevline, nextline, out0, out1);
+
+      for (x = 1; x + 8 < width; x += 8)
+      {
+         uint16x8x2_t top, bottom;
+         const uint16x8_t A = vld1q_u16(src + x - prevline);
+         const uint16x8_t B = vld1q_u16(src + x - 1);
+         const uint16x8_t C = vld1q_u16(src + x);
+         const uint16x8_t D = vld1q_u16(src + x + 1);
+         const uint16x8_t E = vld1q_u16(src + x + nextline);
+         /* A != E && B != D */
+         const uint16x8_t edge = vbicq_u16(
+               vmvnq_u16(vceqq_u16(A, E)), vceqq_u16(B, D));
+
+         top.val[0]    = vbslq_u16(vandq_u16(edge, vceqq_u16(A, B)), A, C);
+         top.val[1]    = vbslq_u16(vandq_u16(edge, vceqq_u16(A, D)), A, C);
+         bottom.val[0] = vbslq_u16(vandq_u16(edge, vceqq_u16(E, B)), E, C);
+         bottom.val[1] = vbslq_u16(vandq_u16(edge, vceqq_u16(E, D)), E, C);
+
+         vst2q_u16(out0 + 2 * x, top);
+         vst2q_u16(out1 + 2 * x, bottom);
+      }
+
+      for (; x < width; x++)
+         SCALE2X_PIXEL(uint16_t, src, x, width, prevline, nextline, out0, out1);
+   }
+}
+
+static void scale2x_neon_xrgb8888(unsigned width, unsigned height,
+      int first, int last,
+      const uint32_t *src, unsigned src_stride,
+      uint32_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++, src += src_stride,
+         dst += dst_stride * SCALE2X_SCALE)
+   {
+      const int prevline = ((y == 0) && first) ? 0 : src_stride;
+      const int nextline = ((y == height - 1) && last) ? 0 : src_stride;
+      uint32_t *out0     = dst;
+      uint32_t *out1     = dst + dst_stride;
+
+      SCALE2X_PIXEL(uint32_t, src, 0, width, prevline, nextline, out0, out1);
+
+      for (x = 1; x + 4 < width; x += 4)
+      {
+         uint32x4x2_t top, bottom;
+         const uint32x4_t A = vld1q_u32(src + x - prevline);
+         const uint32x4_t B = vld1q_u32(src + x - 1);
+         const uint32x4_t C = vld1q_u32(src + x);
+         const uint32x4_t D = vld1q_u32(src + x + 1);
+         const uint32x4_t E = vld1q_u32(src + x + nextline);
+         /* A != E && B != D */
+         const uint32x4_t edge = vbicq_u32(
+               vmvnq_u32(vceqq_u32(A, E)), vceqq_u32(B, D));
+
+         top.val[0]    = vbslq_u32(vandq_u32(edge, vceqq_u32(A, B)), A, C);
+         top.val[1]    = vbslq_u32(vandq_u32(edge, vceqq_u32(A, D)), A, C);
+         bottom.val[0] = vbslq_u32(vandq_u32(edge, vceqq_u32(E, B)), E, C);
+         bottom.val[1] = vbslq_u32(vandq_u32(edge, vceqq_u32(E, D)), E, C);
+
+         vst2q_u32(out0 + 2 * x, top);
+         vst2q_u32(out1 + 2 * x, bottom);
+      }
+
+      for (; x < width; x++)
+         SCALE2X_PIXEL(uint32_t, src, x, width, prevline, nextline, out0, out1);
+   }
+}
+#endif
+
 static unsigned scale2x_generic_input_fmts(void)
 {
    return SOFTFILTER_FMT_XRGB8888 | SOFTFILTER_FMT_RGB565;
@@ -137,7 +254,7 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
    {
@@ -166,42 +283,34 @@ static void scale2x_generic_destroy(void *data)
    free(filt);
 }
 
-static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
-{
-   struct softfilter_thread_data *thr =
-      (struct softfilter_thread_data*)thread_data;
-   const uint32_t *input = (const uint32_t*)thr->in_data;
-   uint32_t *output = (uint32_t*)thr->out_data;
-   unsigned width = thr->width;
-   unsigned height = thr->height;
-
-   scale2x_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
-         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
-         output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
+#define SCALE2X_WORK_CB(name, func, typename_t, bpp) \
+static void name(void *data, void *thread_data) \
+{ \
+   struct softfilter_thread_data *thr = \
+      (struct softfilter_thread_data*)thread_data; \
+   func(thr->width, thr->height, \
+         thr->first, thr->last, (const typename_t*)thr->in_data, \
+         (unsigned)(thr->in_pitch / bpp), \
+         (typename_t*)thr->out_data, \
+         (unsigned)(thr->out_pitch / bpp)); \
 }
 
-static void scale2x_work_cb_rgb565(void *data, void *thread_data)
-{
-   struct softfilter_thread_data *thr =
-      (struct softfilter_thread_data*)thread_data;
-   const uint16_t *input = (const uint16_t*)thr->in_data;
-   uint16_t *output = (uint16_t*)thr->out_data;
-   unsigned width = thr->width;
-   unsigned height = thr->height;
-
-   scale2x_generic_rgb565(width, height,
-         thr->first, thr->last, input,
-         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
-         output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
-}
+SCALE2X_WORK_CB(scale2x_work_cb_xrgb8888, scale2x_generic_xrgb8888,
+      uint32_t, SOFTFILTER_BPP_XRGB8888)
+SCALE2X_WORK_CB(scale2x_work_cb_rgb565, scale2x_generic_rgb565,
+      uint16_t, SOFTFILTER_BPP_RGB565)
+#ifdef SCALE2X_NEON
+SCALE2X_WORK_CB(scale2x_neon_work_cb_xrgb8888, scale2x_neon_xrgb8888,
+      uint32_t, SOFTFILTER_BPP_XRGB8888)
+SCALE2X_WORK_CB(scale2x_neon_work_cb_rgb565, scale2x_neon_rgb565,
+      uint16_t, SOFTFILTER_BPP_RGB565)
+#endif
 
-static void scale2x_generic_packets(void *data,
+static void scale2x_packets(void *data,
       struct softfilter_work_packet *packets,
       void *output, size_t output_stride,
-      const void *input, unsigned width, unsigned height, size_t input_stride)
+      const void *input, unsigned width, unsigned height, size_t input_stride,
+      softfilter_work_t work_xrgb8888, softfilter_work_t work_rgb565)
 {
    struct filter_data *filt = (struct filter_data*)data;
    unsigned i;
@@ -222,17 +331,39 @@ static void scale2x_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
-         packets[i].work = scale2x_work_cb_xrgb8888;
+         packets[i].work = work_xrgb8888;
       else if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
-         packets[i].work = scale2x_work_cb_rgb565;
+         packets[i].work = work_rgb565;
       packets[i].thread_data = thr;
    }
 }
 
+static void scale2x_generic_packets(void *data,
+      struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   scale2x_packets(data, packets, output, output_stride,
+         input, width, height, input_stride,
+         scale2x_work_cb_xrgb8888, scale2x_work_cb_rgb565);
+}
+
+#ifdef SCALE2X_NEON
+static void scale2x_neon_packets(void *data,
+      struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   scale2x_packets(data, packets, output, output_stride,
+         input, width, height, input_stride,
+         scale2x_neon_work_cb_xrgb8888, scale2x_neon_work_cb_rgb565);
+}
+#endif
+
 static const struct softfilter_implementation scale2x_generic = {
    scale2x_generic_input_fmts,
    scale2x_generic_output_fmts,
@@ -248,9 +379,30 @@ static const struct softfilter_implementation scale2x_generic = {
    "scale2x",
 };
 
+#ifdef SCALE2X_NEON
+static const struct softfilter_implementation scale2x_neon = {
+   scale2x_generic_input_fmts,
+   scale2x_generic_output_fmts,
+
+   scale2x_generic_create,
+   scale2x_generic_destroy,
+
+   scale2x_generic_threads,
+   scale2x_generic_output,
+   scale2x_neon_packets,
+   SOFTFILTER_API_VERSION,
+   "Scale2x",
+   "scale2x",
+};
+#endif
+
 const struct softfilter_implementation *softfilter_get_implementation(
       softfilter_simd_mask_t simd)
 {
+#ifdef SCALE2X_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+      return &scale2x_neon;
+#endif
    (void)simd;
    return &scale2x_generic;
 }
@@ -20,6 +20,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SCANLINE2X_NEON
+#include <arm_neon.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation scanline2x_get_implementation
 #define softfilter_thread_data scanline2x_softfilter_thread_data
@@ -194,10 +199,114 @@ static void scanline2x_work_cb_rgb565(void *data, void *thread_data)
    }
 }
 
-static void scanline2x_generic_packets(void *data,
+#ifdef SCANLINE2X_NEON
+static void scanline2x_neon_work_cb_xrgb8888(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint32_t *input = (const uint32_t*)thr->in_data;
+   uint32_t *output = (uint32_t*)thr->out_data;
+   unsigned in_stride = (unsigned)(thr->in_pitch >> 2);
+   unsigned out_stride = (unsigned)(thr->out_pitch >> 2);
+   unsigned x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      for (x = 0; x + 4 <= thr->width; x += 4)
+      {
+         uint32x4x2_t color, scanline_color;
+         uint8x16_t c        = vld1q_u8((const uint8_t*)(input + x));
+         /* Each channel, padding included, at 3/4 intensity */
+         uint32x4_t scanline = vreinterpretq_u32_u8(
+               vaddq_u8(vshrq_n_u8(c, 1), vshrq_n_u8(c, 2)));
+
+         color.val[0]          = vreinterpretq_u32_u8(c);
+         color.val[1]          = color.val[0];
+         scanline_color.val[0] = scanline;
+         scanline_color.val[1] = scanline;
+
+         vst2q_u32(output + 2 * x, color);
+         vst2q_u32(output + 2 * x + out_stride, scanline_color);
+      }
+
+      for (; x < thr->width; ++x)
+      {
+         uint32_t color          = *(input + x);
+         uint32_t scanline_color = ((color >> 1) & 0x7f7f7f7f) +
+               ((color >> 2) & 0x3f3f3f3f);
+
+         output[2 * x]                  = color;
+         output[2 * x + 1]              = color;
+         output[2 * x + out_stride]     = scanline_color;
+         output[2 * x + out_stride + 1] = scanline_color;
+      }
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+
+static void scanline2x_neon_work_cb_rgb565(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint16_t *input = (const uint16_t*)thr->in_data;
+   uint16_t *output = (uint16_t*)thr->out_data;
+   unsigned in_stride = (unsigned)(thr->in_pitch >> 1);
+   unsigned out_stride = (unsigned)(thr->out_pitch >> 1);
+   const uint16x8_t mask = vdupq_n_u16(0x1F);
+   unsigned x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      for (x = 0; x + 8 <= thr->width; x += 8)
+      {
+         uint16x8x2_t color, scanline_color;
+         uint16x8_t c = vld1q_u16(input + x);
+         uint16x8_t r = vshrq_n_u16(c, 11);
+         uint16x8_t g = vandq_u16(vshrq_n_u16(c, 6), mask);
+         uint16x8_t b = vandq_u16(c, mask);
+
+         r = vaddq_u16(vshrq_n_u16(r, 1), vshrq_n_u16(r, 2));
+         g = vaddq_u16(vshrq_n_u16(g, 1), vshrq_n_u16(g, 2));
+         b = vaddq_u16(vshrq_n_u16(b, 1), vshrq_n_u16(b, 2));
+
+         color.val[0]          = c;
+         color.val[1]          = c;
+         scanline_color.val[0] = vorrq_u16(vshlq_n_u16(r, 11),
+               vorrq_u16(vshlq_n_u16(g, 6), b));
+         scanline_color.val[1] = scanline_color.val[0];
+
+         vst2q_u16(output + 2 * x, color);
+         vst2q_u16(output + 2 * x + out_stride, scanline_color);
+      }
+
+      for (; x < thr->width; ++x)
+      {
+         uint16_t color          = *(input + x);
+         uint8_t  r              = (color >> 11 & 0x1F);
+         uint8_t  g              = (color >>  6 & 0x1F);
+         uint8_t  b              = (color       & 0x1F);
+         uint16_t scanline_color =
+               (((r >> 1) + (r >> 2)) << 11) |
+               (((g >> 1) + (g >> 2)) <<  6) |
+               (((b >> 1) + (b >> 2))      );
+
+         output[2 * x]                  = color;
+         output[2 * x + 1]              = color;
+         output[2 * x + out_stride]     = scanline_color;
+         output[2 * x + out_stride + 1] = scanline_color;
+      }
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+#endif
+
+static void scanline2x_packets(void *data,
       struct softfilter_work_packet *packets,
       void *output, size_t output_stride,
-      const void *input, unsigned width, unsigned height, size_t input_stride)
+      const void *input, unsigned width, unsigned height, size_t input_stride,
+      softfilter_work_t work_xrgb8888, softfilter_work_t work_rgb565)
 {
    /* We are guaranteed single threaded operation
     * (filt->threads = 1) so we don't need to loop
@@ -215,13 +324,35 @@ static void scanline2x_generic_packets(void *data,
    thr->height = height;
 
    if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = scanline2x_work_cb_xrgb8888;
+      packets[0].work = work_xrgb8888;
    } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = scanline2x_work_cb_rgb565;
+      packets[0].work = work_rgb565;
    }
    packets[0].thread_data = thr;
 }
 
+static void scanline2x_generic_packets(void *data,
+      struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   scanline2x_packets(data, packets, output, output_stride,
+         input, width, height, input_stride,
+         scanline2x_work_cb_xrgb8888, scanline2x_work_cb_rgb565);
+}
+
+#ifdef SCANLINE2X_NEON
+static void scanline2x_neon_packets(void *data,
+      struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   scanline2x_packets(data, packets, output, output_stride,
+         input, width, height, input_stride,
+         scanline2x_neon_work_cb_xrgb8888, scanline2x_neon_work_cb_rgb565);
+}
+#endif
+
 static const struct softfilter_implementation scanline2x_generic = {
    scanline2x_generic_input_fmts,
    scanline2x_generic_output_fmts,
@@ -238,9 +369,31 @@ static const struct softfilter_implementation scanline2x_generic = {
    "scanline2x",
 };
 
+#ifdef SCANLINE2X_NEON
+static const struct softfilter_implementation scanline2x_neon = {
+   scanline2x_generic_input_fmts,
+   scanline2x_generic_output_fmts,
+
+   scanline2x_generic_create,
+   scanline2x_generic_destroy,
+
+   scanline2x_generic_threads,
+   scanline2x_generic_output,
+   scanline2x_neon_packets,
+
+   SOFTFILTER_API_VERSION,
+   "Scanline2x",
+   "scanline2x",
+};
+#endif
+
 const struct softfilter_implementation *softfilter_get_implementation(
       softfilter_simd_mask_t simd)
 {
+#ifdef SCANLINE2X_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+      return &scanline2x_neon;
+#endif
    (void)simd;
    return &scanline2x_generic;
 }
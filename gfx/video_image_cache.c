@@ -0,0 +1,385 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <encodings/crc32.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_IMAGE_CACHE_STAT
+#endif
+
+#include "video_image_cache.h"
+
+#include "../memory_usage.h"
+
+/* Of 10 ms, for video_image_cache_load() */
+#define VIDEO_IMAGE_CACHE_WAIT_TRIES 20
+
+typedef struct video_image_cache_key
+{
+   char *path;
+   uint32_t hash;
+   unsigned variant;
+   bool supports_rgba;
+   /* Of the file */
+   int64_t size;
+   int64_t mtime;
+} video_image_cache_key_t;
+
+typedef struct video_image_cache_entry
+{
+   video_image_cache_key_t key;
+   /* Being decoded by whoever missed it, no pixels yet */
+   bool pending;
+   unsigned width;
+   unsigned height;
+   uint32_t *pixels;
+   struct video_image_cache_entry *next;
+} video_image_cache_entry_t;
+
+/* Most recently used first, pending entries included */
+static video_image_cache_entry_t *video_image_cache_list = NULL;
+static size_t video_image_cache_size                     = 0;
+#ifdef HAVE_THREADS
+static slock_t *video_image_cache_lock                   = NULL;
+static scond_t *video_image_cache_cond                   = NULL;
+#endif
+
+static void video_image_cache_lock_acquire(void)
+{
+#ifdef HAVE_THREADS
+   if (video_image_cache_lock)
+      slock_lock(video_image_cache_lock);
+#endif
+}
+
+static void video_image_cache_lock_release(void)
+{
+#ifdef HAVE_THREADS
+   if (video_image_cache_lock)
+      slock_unlock(video_image_cache_lock);
+#endif
+}
+
+static bool video_image_cache_key_init(video_image_cache_key_t *key,
+      const char *path, bool supports_rgba, unsigned variant)
+{
+#ifdef HAVE_IMAGE_CACHE_STAT
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   key->size  = (int64_t)st.st_size;
+   key->mtime = (int64_t)st.st_mtime;
+#else
+   int32_t size = path_get_size(path);
+
+   if (size < 0)
+      return false;
+
+   key->size  = size;
+   key->mtime = 0;
+#endif
+   key->path          = (char*)path;
+   key->hash          = encoding_crc32(0, (const uint8_t*)path, strlen(path));
+   key->variant       = variant;
+   key->supports_rgba = supports_rgba;
+
+   return true;
+}
+
+static bool video_image_cache_key_equal(const video_image_cache_key_t *a,
+      const video_image_cache_key_t *b)
+{
+   return a->hash          == b->hash
+       && a->variant       == b->variant
+       && a->supports_rgba == b->supports_rgba
+       && string_is_equal(a->path, b->path);
+}
+
+static size_t video_image_cache_entry_size(
+      const video_image_cache_entry_t *entry)
+{
+   return (size_t)entry->width * entry->height * sizeof(uint32_t);
+}
+
+static void video_image_cache_entry_free(video_image_cache_entry_t *entry)
+{
+   free(entry->key.path);
+   memory_usage_free(MEMORY_USAGE_IMAGES, entry->pixels);
+   free(entry);
+}
+
+/* Unlinks the entry for @key, if any */
+static video_image_cache_entry_t *video_image_cache_take(
+      const video_image_cache_key_t *key)
+{
+   video_image_cache_entry_t **link = &video_image_cache_list;
+
+   while (*link)
+   {
+      video_image_cache_entry_t *entry = *link;
+
+      if (video_image_cache_key_equal(&entry->key, key))
+      {
+         *link       = entry->next;
+         entry->next = NULL;
+         if (!entry->pending)
+            video_image_cache_size -= video_image_cache_entry_size(entry);
+         return entry;
+      }
+
+      link = &entry->next;
+   }
+
+   return NULL;
+}
+
+static void video_image_cache_push(video_image_cache_entry_t *entry)
+{
+   entry->next             = video_image_cache_list;
+   video_image_cache_list  = entry;
+   if (!entry->pending)
+      video_image_cache_size += video_image_cache_entry_size(entry);
+}
+
+/* Drops the least recently used images beyond the budget */
+static void video_image_cache_trim(void)
+{
+   while (video_image_cache_size > VIDEO_IMAGE_CACHE_MAX_SIZE)
+   {
+      video_image_cache_entry_t **link = &video_image_cache_list;
+      video_image_cache_entry_t **last = NULL;
+
+      for (; *link; link = &(*link)->next)
+         if (!(*link)->pending)
+            last = link;
+
+      if (!last)
+         break;
+
+      {
+         video_image_cache_entry_t *entry = *last;
+         *last                            = entry->next;
+         video_image_cache_size          -= video_image_cache_entry_size(entry);
+         video_image_cache_entry_free(entry);
+      }
+   }
+}
+
+enum video_image_cache_status video_image_cache_begin(
+      struct texture_image *img, const char *path, unsigned variant)
+{
+   video_image_cache_key_t key;
+   video_image_cache_entry_t *entry     = NULL;
+   enum video_image_cache_status status = VIDEO_IMAGE_CACHE_MISS;
+
+   if (string_is_empty(path) ||
+         !video_image_cache_key_init(&key, path, img->supports_rgba, variant))
+      return VIDEO_IMAGE_CACHE_MISS;
+
+   video_image_cache_lock_acquire();
+
+   entry = video_image_cache_take(&key);
+
+   if (entry)
+   {
+      if (entry->pending)
+         status = VIDEO_IMAGE_CACHE_BUSY;
+      else if (entry->key.size != key.size || entry->key.mtime != key.mtime)
+      {
+         /* The file changed */
+         video_image_cache_entry_free(entry);
+         entry = NULL;
+      }
+      else
+      {
+         size_t size = video_image_cache_entry_size(entry);
+
+         img->pixels = (uint32_t*)malloc(size);
+
+         if (img->pixels)
+         {
+            memcpy(img->pixels, entry->pixels, size);
+            img->width  = entry->width;
+            img->height = entry->height;
+            status      = VIDEO_IMAGE_CACHE_HIT;
+         }
+         else
+         {
+            /* Missed; the caller decodes it again */
+            video_image_cache_entry_free(entry);
+            entry = NULL;
+         }
+      }
+   }
+
+   if (!entry)
+   {
+      entry = (video_image_cache_entry_t*)calloc(1, sizeof(*entry));
+
+      if (entry)
+      {
+         entry->key      = key;
+         entry->key.path = strdup(path);
+         entry->pending  = true;
+
+         if (!entry->key.path)
+         {
+            free(entry);
+            entry = NULL;
+         }
+      }
+   }
+
+   if (entry)
+      video_image_cache_push(entry);
+
+   video_image_cache_lock_release();
+
+   return status;
+}
+
+void video_image_cache_end(const struct texture_image *img,
+      const char *path, bool supports_rgba, unsigned variant)
+{
+   video_image_cache_key_t key;
+   video_image_cache_entry_t *entry = NULL;
+
+   if (string_is_empty(path))
+      return;
+
+   key.path          = (char*)path;
+   key.hash          = encoding_crc32(0, (const uint8_t*)path, strlen(path));
+   key.variant       = variant;
+   key.supports_rgba = supports_rgba;
+
+   video_image_cache_lock_acquire();
+
+   entry = video_image_cache_take(&key);
+
+   if (entry && entry->pending)
+   {
+      size_t size = img
+         ? (size_t)img->width * img->height * sizeof(uint32_t) : 0;
+
+      entry->pending = false;
+
+      if (     size
+            && img->pixels
+            && size <= VIDEO_IMAGE_CACHE_MAX_SIZE / 4
+            && (entry->pixels = (uint32_t*)memory_usage_malloc(
+                  MEMORY_USAGE_IMAGES, size)))
+      {
+         memcpy(entry->pixels, img->pixels, size);
+         entry->width  = img->width;
+         entry->height = img->height;
+         video_image_cache_push(entry);
+         video_image_cache_trim();
+      }
+      else
+         video_image_cache_entry_free(entry);
+   }
+   else if (entry)
+      video_image_cache_push(entry);
+
+#ifdef HAVE_THREADS
+   if (video_image_cache_cond)
+      scond_broadcast(video_image_cache_cond);
+#endif
+
+   video_image_cache_lock_release();
+}
+
+bool video_image_cache_load(struct texture_image *img, const char *path)
+{
+   bool ret;
+   unsigned tries                       = 0;
+   bool supports_rgba                   = img->supports_rgba;
+   enum video_image_cache_status status = VIDEO_IMAGE_CACHE_MISS;
+
+   for (;;)
+   {
+      status = video_image_cache_begin(img, path, 0);
+
+      if (status == VIDEO_IMAGE_CACHE_HIT)
+         return true;
+      if (status == VIDEO_IMAGE_CACHE_MISS)
+         break;
+
+#ifdef HAVE_THREADS
+      /* Woken when any decode ends, then asks again. Gives up
+       * after a while and decodes itself: whoever is decoding
+       * may be a task waiting for this very thread */
+      if (     video_image_cache_lock
+            && video_image_cache_cond
+            && tries++ < VIDEO_IMAGE_CACHE_WAIT_TRIES)
+      {
+         slock_lock(video_image_cache_lock);
+         scond_wait_timeout(video_image_cache_cond,
+               video_image_cache_lock, 10000);
+         slock_unlock(video_image_cache_lock);
+         continue;
+      }
+#endif
+      break;
+   }
+
+   ret = image_texture_load(img, path);
+
+   /* Only kept by whoever missed it */
+   if (status == VIDEO_IMAGE_CACHE_MISS)
+      video_image_cache_end(ret ? img : NULL, path, supports_rgba, 0);
+
+   return ret;
+}
+
+void video_image_cache_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!video_image_cache_lock)
+      video_image_cache_lock = slock_new();
+   if (!video_image_cache_cond)
+      video_image_cache_cond = scond_new();
+#endif
+}
+
+void video_image_cache_deinit(void)
+{
+   video_image_cache_lock_acquire();
+
+   while (video_image_cache_list)
+   {
+      video_image_cache_entry_t *entry = video_image_cache_list;
+      video_image_cache_list           = entry->next;
+      video_image_cache_entry_free(entry);
+   }
+
+   video_image_cache_size = 0;
+
+   video_image_cache_lock_release();
+}
@@ -0,0 +1,94 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_IMAGE_CACHE_H__
+#define __VIDEO_IMAGE_CACHE_H__
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include <formats/image.h>
+
+RETRO_BEGIN_DECLS
+
+/* Decoded images, shared by everything that loads images from
+ * files: the image task, menu icons and badges, overlays and
+ * video layouts. The least recently used images are dropped
+ * beyond VIDEO_IMAGE_CACHE_MAX_SIZE bytes of pixels.
+ *
+ * An image is known by its path, the pixel format it was
+ * decoded to (supports_rgba) and a variant, e.g. the upscale
+ * threshold of the image task. Copies of files that changed
+ * since are not used. */
+#define VIDEO_IMAGE_CACHE_MAX_SIZE (24 * 1024 * 1024)
+
+enum video_image_cache_status
+{
+   /* The caller has to decode the image, then
+    * call video_image_cache_end() */
+   VIDEO_IMAGE_CACHE_MISS = 0,
+   /* The image was copied to the caller */
+   VIDEO_IMAGE_CACHE_HIT,
+   /* Someone else is decoding the image; ask again later */
+   VIDEO_IMAGE_CACHE_BUSY
+};
+
+/**
+ * video_image_cache_begin:
+ * @img                : supports_rgba selects the pixel format,
+ *                       gets the image on a hit.
+ * @path               : Path of the image file.
+ * @variant            : Told apart like the pixel format.
+ *
+ * Looks an image up. On a miss the caller is in charge of
+ * decoding it, and callers asking for the same image meanwhile
+ * are told VIDEO_IMAGE_CACHE_BUSY.
+ **/
+enum video_image_cache_status video_image_cache_begin(
+      struct texture_image *img, const char *path, unsigned variant);
+
+/**
+ * video_image_cache_end:
+ * @img                : Decoded image, copied; NULL if decoding
+ *                       failed.
+ * @path               : As given to video_image_cache_begin().
+ * @supports_rgba      : As given to video_image_cache_begin().
+ * @variant            : As given to video_image_cache_begin().
+ *
+ * Ends the decoding started by a miss.
+ **/
+void video_image_cache_end(const struct texture_image *img,
+      const char *path, bool supports_rgba, unsigned variant);
+
+/**
+ * video_image_cache_load:
+ * @img                : supports_rgba selects the pixel format.
+ * @path               : Path of the image file.
+ *
+ * Drop-in for image_texture_load(): copies the image if it's
+ * kept, waits if it's being decoded elsewhere, else decodes and
+ * keeps it. Free @img with image_texture_free().
+ *
+ * Returns: true if @img was loaded.
+ **/
+bool video_image_cache_load(struct texture_image *img, const char *path);
+
+void video_image_cache_init(void);
+
+void video_image_cache_deinit(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -5,6 +5,7 @@
 
 #include "video_layout.h"
 #include "video_layout/view.h"
+#include "video_image_cache.h"
 
 #include "../retroarch.h"
 #include "../verbosity.h"
@@ -227,7 +228,7 @@ static int video_layout_load_image(const char *path)
       strlcpy(respath, video_layout_state->base_path, sizeof(respath));
       strlcat(respath, path, sizeof(respath));
 
-      if (!image_texture_load(&image, respath))
+      if (!video_image_cache_load(&image, respath))
       {
          RARCH_LOG("video_layout: failed to load image: %s\n", respath);
          return 0;
@@ -321,11 +322,22 @@ void video_layout_view_fit_bounds(video_layout_bounds_t bounds)
       layer_t *layer;
       layer = &view->layers[i];
 
+      /* Redrawn at the new size, rebuilding the list of
+       * elements checked every frame */
+      layer->dirty         = true;
+      layer->dynamic_count = 0;
+
       for (j = 0; j < layer->elements_count; ++j)
       {
          element_t *elem;
          elem = &layer->elements[j];
 
+         if (elem->o_bind != -1)
+         {
+            vec_size((void**)&layer->dynamic, sizeof(int), ++layer->dynamic_count);
+            layer->dynamic[layer->dynamic_count - 1] = j;
+         }
+
          elem->render_bounds.x = elem->bounds.x * view->render_bounds.w + view->render_bounds.x;
          elem->render_bounds.y = elem->bounds.y * view->render_bounds.h + view->render_bounds.y;
          elem->render_bounds.w = elem->bounds.w * view->render_bounds.w;
@@ -366,16 +378,36 @@ void video_layout_layer_render(void *video_driver_frame_data, int index)
 
    info->video_driver_frame_data = video_driver_frame_data;
 
-   r->layer_begin(info);
+   for (i = 0; i < layer->dynamic_count; ++i)
+   {
+      element_t *elem;
+      int state;
+
+      elem  = &layer->elements[layer->dynamic[i]];
+      state = video_layout_state->io[elem->o_bind].value;
+
+      if (elem->state != state)
+      {
+         elem->state  = state;
+         layer->dirty = true;
+      }
+   }
+
+   /* The driver keeps what was drawn last, unless told
+    * otherwise or it lost it */
+   if (!r->layer_begin(info, index, layer->dirty))
+   {
+      r->layer_end(info, index, layer->blend);
+      return;
+   }
+
+   layer->dirty = false;
 
    for (i = 0; i < layer->elements_count; ++i)
    {
       element_t *elem;
       elem = &layer->elements[i];
 
-      if (elem->o_bind != -1)
-         elem->state = video_layout_state->io[elem->o_bind].value;
-
       for (j = 0; j < elem->components_count; ++j)
       {
          component_t *comp;
@@ -456,7 +488,7 @@ void video_layout_layer_render(void *video_driver_frame_data, int index)
       }
    }
 
-   r->layer_end(info, layer->blend);
+   r->layer_end(info, index, layer->blend);
 }
 
 const video_layout_bounds_t *video_layout_screen(int index)
@@ -31,7 +31,9 @@ typedef struct video_layout_render_interface
    void *(*take_image)  (void *video_driver_data, struct texture_image image);
    void  (*free_image)  (void *video_driver_data, void *image);
 
-   void  (*layer_begin) (const video_layout_render_info_t *info);
+   /* Returns true if the layer has to be drawn, false to reuse
+    * what was drawn last time; always true if dirty */
+   bool  (*layer_begin) (const video_layout_render_info_t *info, int layer_index, bool dirty);
 
    void  (*screen)      (const video_layout_render_info_t *info, int screen_index);
    void  (*image)       (const video_layout_render_info_t *info, void *image_handle, void *alpha_handle);
@@ -42,7 +44,7 @@ typedef struct video_layout_render_interface
    void  (*led_dot)     (const video_layout_render_info_t *info, int dot_count, int dot_mask);
    void  (*led_seg)     (const video_layout_render_info_t *info, video_layout_led_t seg_layout, int seg_mask);
 
-   void  (*layer_end)   (const video_layout_render_info_t *info, video_layout_blend_t blend_type);
+   void  (*layer_end)   (const video_layout_render_info_t *info, int layer_index, video_layout_blend_t blend_type);
 }
 video_layout_render_interface_t;
 
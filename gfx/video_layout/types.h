@@ -14,6 +14,9 @@ typedef uint8_t video_layout_orientation_t;
 #define VIDEO_LAYOUT_ROT180  VIDEO_LAYOUT_FLIP_X  | VIDEO_LAYOUT_FLIP_Y
 #define VIDEO_LAYOUT_ROT270  VIDEO_LAYOUT_SWAP_XY | VIDEO_LAYOUT_FLIP_Y
 
+/* screen, overlay, backdrop, bezel, cpanel and marquee */
+#define VIDEO_LAYOUT_MAX_LAYERS 6
+
 typedef enum video_layout_blend
 {
    VIDEO_LAYOUT_BLEND_ALPHA = 0,
@@ -9,6 +9,9 @@ void layer_init(layer_t *layer, const char *name)
    layer->blend = VIDEO_LAYOUT_BLEND_ALPHA;
    layer->elements = NULL;
    layer->elements_count = 0;
+   layer->dynamic = NULL;
+   layer->dynamic_count = 0;
+   layer->dirty = true;
 }
 
 void layer_deinit(layer_t *layer)
@@ -19,6 +22,7 @@ void layer_deinit(layer_t *layer)
       element_deinit(&layer->elements[i]);
 
    free(layer->elements);
+   free(layer->dynamic);
    free(layer->name);
 }
 
@@ -89,7 +93,7 @@ layer_t *view_emplace_layer(view_t *view, const char *name)
 
 void view_sort_layers(view_t *view)
 {
-   layer_t sorted[6];
+   layer_t sorted[VIDEO_LAYOUT_MAX_LAYERS];
    layer_t *layer;
    int i = 0;
 
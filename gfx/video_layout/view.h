@@ -11,6 +11,13 @@ typedef struct layer
 
    element_t            *elements;
    int                   elements_count;
+
+   /* Elements bound to an output, whose state may change
+    * from frame to frame; the rest are drawn only when the
+    * layer is dirty */
+   int                  *dynamic;
+   int                   dynamic_count;
+   bool                  dirty;
 } layer_t;
 
 typedef struct view
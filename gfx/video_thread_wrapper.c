@@ -20,6 +20,7 @@
 #include <math.h>
 
 #include <compat/strl.h>
+#include <copy_rows.h>
 #include <features/features_cpu.h>
 #include <rthreads/rthreads.h>
 #include <string/stdstring.h>
@@ -30,6 +31,27 @@
 #include "../retroarch.h"
 #include "../verbosity.h"
 
+/* Frames are handed over through a ring of buffers: the
+ * driver thread reads the published one while the main
+ * thread (or the core, through
+ * GET_CURRENT_SOFTWARE_FRAMEBUFFER) fills the next. */
+#define THREAD_FRAME_SLOTS 2
+
+/* Commands which don't need a reply are queued in a
+ * single producer, single consumer ring instead of
+ * waiting for the driver thread. The driver thread
+ * drains it whenever it wakes up, i.e. before the next
+ * frame or command, which batches state changes per
+ * frame. Without atomics, they are sent synchronously. */
+#define THREAD_CMD_RING_SIZE 64
+
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define HAVE_THREAD_CMD_RING
+#define THREAD_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define THREAD_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#endif
+
 enum thread_cmd
 {
    CMD_VIDEO_NONE = 0,
@@ -199,13 +221,23 @@ struct thread_video
    enum thread_cmd reply_cmd;
    thread_packet_t cmd_data;
 
+#ifdef HAVE_THREAD_CMD_RING
+   thread_packet_t cmd_ring[THREAD_CMD_RING_SIZE];
+   unsigned cmd_ring_head; /* Written by the main thread. */
+   unsigned cmd_ring_tail; /* Written by the driver thread. */
+   bool cmd_ring_draining;
+#endif
+
    struct video_viewport vp;
    struct video_viewport read_vp; /* Last viewport reported to caller. */
 
    struct
    {
       slock_t *lock;
-      uint8_t *buffer;
+      uint8_t *buffer; /* Published slot, read by the driver thread. */
+      uint8_t *slots[THREAD_FRAME_SLOTS];
+      unsigned slot;   /* Slot owned by the main thread. */
+      unsigned slot_dim;
       unsigned width;
       unsigned height;
       unsigned pitch;
@@ -233,6 +265,12 @@ static void *video_thread_init_never_call(const video_info_t *video,
 /* thread -> user */
 static void video_thread_reply(thread_video_t *thr, const thread_packet_t *pkt)
 {
+#ifdef HAVE_THREAD_CMD_RING
+   /* Queued commands have nobody waiting for them. */
+   if (thr->cmd_ring_draining)
+      return;
+#endif
+
    slock_lock(thr->lock);
 
    thr->cmd_data  = *pkt;
@@ -281,6 +319,27 @@ static void video_thread_send_and_wait_user_to_thread(thread_video_t *thr, threa
    video_thread_wait_reply(thr, pkt);
 }
 
+/* user -> thread
+ * Queues a command which doesn't need a reply, falling
+ * back to a synchronous send if the ring is full. */
+static void video_thread_send_async(thread_video_t *thr,
+      thread_packet_t *pkt)
+{
+#ifdef HAVE_THREAD_CMD_RING
+   unsigned head = thr->cmd_ring_head;
+   unsigned tail = THREAD_ATOMIC_LOAD(&thr->cmd_ring_tail);
+
+   if (head - tail < THREAD_CMD_RING_SIZE)
+   {
+      thr->cmd_ring[head & (THREAD_CMD_RING_SIZE - 1)] = *pkt;
+      THREAD_ATOMIC_STORE(&thr->cmd_ring_head, head + 1);
+      return;
+   }
+#endif
+
+   video_thread_send_and_wait_user_to_thread(thr, pkt);
+}
+
 static void thread_update_driver_state(thread_video_t *thr)
 {
 #if defined(HAVE_MENU)
@@ -555,10 +614,31 @@ static bool video_thread_handle_packet(
    return false;
 }
 
+#ifdef HAVE_THREAD_CMD_RING
+static void video_thread_drain_packets(thread_video_t *thr)
+{
+   unsigned tail = thr->cmd_ring_tail;
+   unsigned head = THREAD_ATOMIC_LOAD(&thr->cmd_ring_head);
+
+   thr->cmd_ring_draining = true;
+
+   while (tail != head)
+   {
+      video_thread_handle_packet(thr,
+            &thr->cmd_ring[tail & (THREAD_CMD_RING_SIZE - 1)]);
+      THREAD_ATOMIC_STORE(&thr->cmd_ring_tail, ++tail);
+   }
+
+   thr->cmd_ring_draining = false;
+}
+#endif
+
 static void video_thread_loop(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
 
+   sthread_set_role(STHREAD_ROLE_VIDEO);
+
    for (;;)
    {
       thread_packet_t pkt;
@@ -576,8 +656,17 @@ static void video_thread_loop(void *data)
 
       slock_unlock(thr->lock);
 
+#ifdef HAVE_THREAD_CMD_RING
+      /* Apply queued commands first, so they take effect
+       * in the order they were issued. */
+      video_thread_drain_packets(thr);
+#endif
+
       if (video_thread_handle_packet(thr, &pkt))
+      {
+         sthread_set_role(STHREAD_ROLE_NONE);
          return;
+      }
 
       if (updated)
       {
@@ -697,6 +786,7 @@ static bool video_thread_frame(void *data, const void *frame_,
       unsigned pitch, const char *msg, video_frame_info_t *video_info)
 {
    unsigned copy_stride;
+   bool zero_copy                      = false;
    const uint8_t *src                  = NULL;
    uint8_t *dst                        = NULL;
    thread_video_t *thr                 = (thread_video_t*)data;
@@ -717,7 +807,11 @@ static bool video_thread_frame(void *data, const void *frame_,
          ? sizeof(uint32_t) : sizeof(uint16_t));
 
    src = (const uint8_t*)frame_;
-   dst = thr->frame.buffer;
+   dst = thr->frame.slots[thr->frame.slot];
+
+   /* The core rendered straight into the slot we handed out. */
+   if (src && src == dst)
+      zero_copy = true;
 
    slock_lock(thr->lock);
 
@@ -748,16 +842,31 @@ static bool video_thread_frame(void *data, const void *frame_,
    {
       if (src)
       {
-         unsigned h;
-         for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
-            memcpy(dst, src, copy_stride);
+         if (zero_copy)
+            thr->frame.pitch = pitch;
+         else
+         {
+            /* The driver thread is idle and never reads the
+             * slot owned by this thread, so don't hold the
+             * lock while copying. */
+            slock_unlock(thr->lock);
+            copy_rows_stream(dst, copy_stride, src, pitch,
+                  copy_stride, height);
+            slock_lock(thr->lock);
+
+            thr->frame.pitch = copy_stride;
+         }
+
+         thr->frame.buffer = dst;
+         thr->frame.slot   = (thr->frame.slot + 1) % THREAD_FRAME_SLOTS;
       }
+      else if (!thr->frame.pitch)
+         thr->frame.pitch  = copy_stride;
 
       thr->frame.updated = true;
       thr->frame.width  = width;
       thr->frame.height = height;
       thr->frame.count  = frame_count;
-      thr->frame.pitch  = copy_stride;
 
       if (msg)
          strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
@@ -795,6 +904,7 @@ static bool video_thread_init(thread_video_t *thr,
       const video_info_t info,
       input_driver_t **input, void **input_data)
 {
+   unsigned i;
    size_t max_size;
    thread_packet_t pkt = {CMD_INIT};
 
@@ -811,15 +921,23 @@ static bool video_thread_init(thread_video_t *thr,
    thr->has_windowed         = true;
    thr->suppress_screensaver = true;
 
-   max_size                  = info.input_scale * RARCH_SCALE_BASE;
+   thr->frame.slot_dim       = info.input_scale * RARCH_SCALE_BASE;
+   max_size                  = thr->frame.slot_dim;
    max_size                 *= max_size;
    max_size                 *= info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer         = (uint8_t*)malloc(max_size);
 
-   if (!thr->frame.buffer)
-      return false;
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+   {
+      thr->frame.slots[i]    = (uint8_t*)malloc(max_size);
+
+      if (!thr->frame.slots[i])
+         return false;
+
+      memset(thr->frame.slots[i], 0x80, max_size);
+   }
 
-   memset(thr->frame.buffer, 0x80, max_size);
+   thr->frame.buffer         = thr->frame.slots[0];
+   thr->frame.slot           = 1;
 
    thr->last_time            = cpu_features_get_time_usec();
    thr->thread               = sthread_create(video_thread_loop, thr);
@@ -875,7 +993,7 @@ static void video_thread_set_rotation(void *data, unsigned rotation)
 
    pkt.data.i = rotation;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 /* This value is set async as stalling on the video driver for
@@ -916,6 +1034,7 @@ static bool video_thread_read_viewport(void *data, uint8_t *buffer, bool is_idle
 
 static void video_thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
    thread_packet_t pkt = { CMD_FREE };
 
@@ -929,7 +1048,8 @@ static void video_thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+      free(thr->frame.slots[i]);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
@@ -955,7 +1075,7 @@ static void thread_overlay_enable(void *data, bool state)
 
    pkt.data.b = state;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static bool thread_overlay_load(void *data,
@@ -991,7 +1111,7 @@ static void thread_overlay_tex_geom(void *data,
    pkt.data.rect.w = w;
    pkt.data.rect.h = h;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_overlay_vertex_geom(void *data,
@@ -1009,7 +1129,7 @@ static void thread_overlay_vertex_geom(void *data,
    pkt.data.rect.w = w;
    pkt.data.rect.h = h;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_overlay_full_screen(void *data, bool enable)
@@ -1019,7 +1139,7 @@ static void thread_overlay_full_screen(void *data, bool enable)
 
    pkt.data.b = enable;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 /* We cannot wait for this to complete. Totally blocks the main thread. */
@@ -1082,7 +1202,7 @@ static void thread_set_filtering(void *data, unsigned idx, bool smooth)
    pkt.data.filtering.index  = idx;
    pkt.data.filtering.smooth = smooth;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_get_video_output_size(void *data,
@@ -1130,7 +1250,7 @@ static void thread_set_aspect_ratio(void *data, unsigned aspectratio_idx)
       return;
    pkt.data.i = aspectratio_idx;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_set_texture_frame(void *data, const void *frame,
@@ -1222,6 +1342,38 @@ static void thread_apply_state_changes(void *data)
    slock_unlock(thr->frame.lock);
 }
 
+/* Hands out the slot owned by the main thread, so software
+ * cores render into it and the frame is published without
+ * copying it. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+   enum retro_pixel_format format;
+
+   if (!thr || !framebuffer)
+      return false;
+
+   format = thr->info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+
+   /* 0RGB1555 frames are converted before they reach us. */
+   if (video_driver_get_pixel_format() != format)
+      return false;
+
+   if (     framebuffer->width  > thr->frame.slot_dim
+         || framebuffer->height > thr->frame.slot_dim)
+      return false;
+
+   framebuffer->data         = thr->frame.slots[thr->frame.slot];
+   framebuffer->pitch        = framebuffer->width * (thr->info.rgb32
+         ? sizeof(uint32_t) : sizeof(uint16_t));
+   framebuffer->format       = format;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+   return true;
+}
+
 /* This is read-only state which should not
  * have any kind of race condition. */
 static struct video_shader *thread_get_current_shader(void *data)
@@ -1262,7 +1414,7 @@ static const video_poke_interface_t thread_poke = {
    NULL,
 
    thread_get_current_shader,
-   NULL,                      /* get_current_software_framebuffer */
+   thread_get_current_software_framebuffer,
    NULL                       /* get_hw_render_interface */
 };
 
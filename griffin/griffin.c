@@ -77,6 +77,8 @@ COMPATIBILITY
 #include "../libretro-common/compat/compat_fnmatch.c"
 #include "../libretro-common/compat/fopen_utf8.c"
 #include "../libretro-common/memmap/memalign.c"
+#include "../libretro-common/memmap/copy_rows.c"
+#include "../libretro-common/memmap/memmap.c"
 
 /*============================================================
 CONSOLE EXTENSIONS
@@ -130,6 +132,14 @@ COMPRESSION
 #include "../libretro-common/streams/trans_stream_zlib.c"
 #endif
 
+#ifdef HAVE_ZSTD
+#include "../libretro-common/streams/trans_stream_zstd.c"
+#endif
+
+#ifdef HAVE_LZ4
+#include "../libretro-common/streams/trans_stream_lz4.c"
+#endif
+
 /*============================================================
 ENCODINGS
 ============================================================ */
@@ -142,6 +152,9 @@ PERFORMANCE
 ============================================================ */
 #include "../libretro-common/features/features_cpu.c"
 #include "../performance_counters.c"
+#include "../benchmark.c"
+#include "../latency_test.c"
+#include "../memory_usage.c"
 
 /*============================================================
 CONFIG FILE
@@ -446,6 +459,10 @@ VIDEO DRIVER
 #include "../gfx/drivers/drm_gfx.c"
 #endif
 
+#if defined(HAVE_KMS)
+#include "../gfx/drivers/go2_gfx.c"
+#endif
+
 #ifdef HAVE_OPENGL1
 #include "../gfx/drivers/gl1.c"
 #endif
@@ -456,10 +473,13 @@ VIDEO DRIVER
 
 #ifdef HAVE_OPENGL
 #include "../gfx/drivers/gl.c"
+#include "../gfx/common/gl_atlas_common.c"
+#include "../gfx/common/gl_batch_common.c"
 #endif
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGL_CORE)
 #include "../libretro-common/gfx/gl_capabilities.c"
+#include "../gfx/common/gl_timer_common.c"
 
 #ifndef HAVE_PSGL
 #include "../libretro-common/glsym/rglgen.c"
@@ -530,6 +550,7 @@ FONTS
 
 #if defined(HAVE_STB_FONT)
 #include "../gfx/drivers_font_renderer/stb_unicode.c"
+#include "../gfx/drivers_font_renderer/stb_sdf.c"
 #include "../gfx/drivers_font_renderer/stb.c"
 #endif
 
@@ -773,6 +794,7 @@ FIFO BUFFER
 AUDIO RESAMPLER
 ============================================================ */
 #include "../libretro-common/audio/resampler/audio_resampler.c"
+#include "../libretro-common/audio/resampler/audio_resampler_s16.c"
 #include "../libretro-common/audio/resampler/drivers/sinc_resampler.c"
 #include "../libretro-common/audio/resampler/drivers/nearest_resampler.c"
 #ifdef HAVE_CC_RESAMPLER
@@ -905,6 +927,7 @@ DRIVERS
 #include "../gfx/video_crt_switch.c"
 #include "../gfx/video_display_server.c"
 #include "../gfx/video_coord_array.c"
+#include "../gfx/video_image_cache.c"
 #ifdef HAVE_AUDIOMIXER
 #include "../libretro-common/audio/audio_mixer.c"
 #endif
@@ -993,9 +1016,13 @@ FILE
 #endif
 
 #include "../libretro-common/string/stdstring.c"
+#include "../libretro-common/string/string_pool.c"
 #include "../libretro-common/file/nbio/nbio_stdio.c"
 #if defined(__linux__)
 #include "../libretro-common/file/nbio/nbio_linux.c"
+#if defined(HAVE_IO_URING)
+#include "../libretro-common/file/nbio/nbio_io_uring.c"
+#endif
 #endif
 #if defined(HAVE_MMAP) && defined(BSD)
 #include "../libretro-common/file/nbio/nbio_unixmmap.c"
@@ -1022,6 +1049,7 @@ CONFIGURATION
 STATE MANAGER
 ============================================================ */
 #include "../managers/state_manager.c"
+#include "../managers/state_pool.c"
 
 /*============================================================
 FRONTEND
@@ -1169,6 +1197,7 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #endif
@@ -1189,6 +1218,9 @@ NETPLAY
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
+#include "../network/netplay/netplay_udp.c"
+#include "../network/netplay/netplay_relay.c"
+#include "../network/netplay/netplay_record.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
@@ -1208,12 +1240,18 @@ NETPLAY
 DATA RUNLOOP
 ============================================================ */
 #include "../tasks/task_powerstate.c"
+#include "../tasks/task_startup.c"
 #include "../tasks/task_content.c"
+#include "../tasks/task_content_preload.c"
+#include "../tasks/task_dir_list.c"
 #include "../tasks/task_patch.c"
 #include "../tasks/task_save.c"
 #include "../tasks/task_image.c"
 #include "../tasks/task_file_transfer.c"
 #include "../tasks/task_playlist_manager.c"
+#ifdef HAVE_THREADS
+#include "../tasks/task_read_ahead.c"
+#endif
 #include "../tasks/task_manual_content_scan.c"
 #ifdef HAVE_ZLIB
 #include "../tasks/task_decompress.c"
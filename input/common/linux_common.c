@@ -15,20 +15,46 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 
 #include <signal.h>
 
 #include <linux/input.h>
 #include <linux/kd.h>
+#include <sys/epoll.h>
 #include <termios.h>
 #include <unistd.h>
 
+#include <retro_miscellaneous.h>
+#include <queues/task_queue.h>
+
 #include "linux_common.h"
 
+#include "../../verbosity.h"
+
+/* Enough for every keyboard, mouse and pad plus hotplug */
+#define LINUX_INPUT_MAX_WATCHES 64
+
+struct linux_input_watch
+{
+   int fd;
+   linux_input_read_t read_cb; /* NULL if the slot is free */
+   void *data;
+};
+
 static struct termios oldTerm, newTerm;
 static long oldKbmd                = 0xffff;
 static bool linux_stdin_claimed    = false;
 
+/* One epoll set for the fds of every Linux input driver, so that
+ * a poll is a single epoll_wait whatever the number of devices,
+ * and only the fds with something to read are read. */
+static struct linux_input_watch linux_input_watches[LINUX_INPUT_MAX_WATCHES];
+static unsigned linux_input_watch_count = 0;
+static int linux_input_epoll            = -1;
+static bool linux_input_tasks_watched   = false;
+
 void linux_terminal_flush(void)
 {
    tcsetattr(0, TCSAFLUSH, &oldTerm);
@@ -126,3 +152,171 @@ bool linux_terminal_disable_input(void)
 
    return true;
 }
+
+/**
+ * linux_input_watch:
+ * @fd                   : fd to watch, must be non-blocking.
+ * @read_cb              : called by linux_input_poll when @fd is readable.
+ * @data                 : passed to @read_cb.
+ *
+ * Adds @fd to the fds linux_input_poll waits on. @read_cb must read
+ * everything there is, as it is called again on every poll until
+ * then. @fd must be unwatched before it is closed.
+ *
+ * Returns: true if @fd is watched, else it has to be read on
+ * every poll by the caller.
+ **/
+bool linux_input_watch(int fd, linux_input_read_t read_cb, void *data)
+{
+   struct epoll_event ev;
+   struct linux_input_watch *watch = NULL;
+   unsigned i;
+
+   if (fd < 0)
+      return false;
+
+   for (i = 0; i < LINUX_INPUT_MAX_WATCHES; i++)
+   {
+      if (!linux_input_watches[i].read_cb)
+      {
+         watch = &linux_input_watches[i];
+         break;
+      }
+   }
+
+   if (!watch)
+   {
+      RARCH_WARN("[Input]: Too many input fds to watch.\n");
+      return false;
+   }
+
+   if (linux_input_epoll < 0)
+   {
+      linux_input_epoll = epoll_create1(EPOLL_CLOEXEC);
+      if (linux_input_epoll < 0)
+         return false;
+   }
+
+   memset(&ev, 0, sizeof(ev));
+   ev.events   = EPOLLIN;
+   ev.data.ptr = watch;
+
+   if (epoll_ctl(linux_input_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+   {
+      RARCH_ERR("[Input]: Failed to add FD (%d) to epoll list (%s).\n",
+            fd, strerror(errno));
+
+      if (!linux_input_watch_count)
+      {
+         close(linux_input_epoll);
+         linux_input_epoll = -1;
+      }
+      return false;
+   }
+
+   watch->fd      = fd;
+   watch->read_cb = read_cb;
+   watch->data    = data;
+   linux_input_watch_count++;
+
+   return true;
+}
+
+/**
+ * linux_input_unwatch:
+ * @fd                   : fd given to linux_input_watch.
+ *
+ * Stops watching @fd. Safe from a read callback, events
+ * already waited for @fd are dropped.
+ **/
+void linux_input_unwatch(int fd)
+{
+   unsigned i;
+
+   if (fd < 0)
+      return;
+
+   for (i = 0; i < LINUX_INPUT_MAX_WATCHES; i++)
+   {
+      struct linux_input_watch *watch = &linux_input_watches[i];
+
+      if (!watch->read_cb || watch->fd != fd)
+         continue;
+
+      epoll_ctl(linux_input_epoll, EPOLL_CTL_DEL, fd, NULL);
+      watch->fd      = -1;
+      watch->read_cb = NULL;
+      watch->data    = NULL;
+
+      if (--linux_input_watch_count == 0)
+      {
+         close(linux_input_epoll);
+         linux_input_epoll = -1;
+      }
+      return;
+   }
+}
+
+/**
+ * linux_input_poll:
+ *
+ * Calls the read callback of every watched fd with something
+ * to read. Every driver calls it from its poll, the drivers
+ * polled after the first one usually find nothing left.
+ **/
+void linux_input_poll(void)
+{
+   int i, ret;
+   struct epoll_event events[LINUX_INPUT_MAX_WATCHES];
+
+   if (linux_input_epoll < 0)
+      return;
+
+   do
+   {
+      ret = epoll_wait(linux_input_epoll, events, ARRAY_SIZE(events), 0);
+   } while (ret < 0 && errno == EINTR);
+
+   for (i = 0; i < ret; i++)
+   {
+      struct linux_input_watch *watch =
+         (struct linux_input_watch*)events[i].data.ptr;
+
+      /* Unwatched by an earlier callback of this poll. A slot taken
+       * again meanwhile only gets a read with nothing to read. */
+      if (watch->read_cb)
+         watch->read_cb(watch->data);
+   }
+}
+
+/* Left readable, task_queue_check drains it after the wait */
+static void linux_input_task_done(void *data)
+{
+   (void)data;
+}
+
+/**
+ * linux_input_wait:
+ * @timeout_ms           : longest wait in milliseconds.
+ *
+ * Waits until a watched fd has something to read, which is left
+ * for the next linux_input_poll, or until a task finished.
+ *
+ * Returns: false if no fd is watched, so nothing could be waited on.
+ **/
+bool linux_input_wait(int timeout_ms)
+{
+   struct epoll_event ev;
+
+   if (linux_input_epoll < 0)
+      return false;
+
+   /* Wake up for finished tasks as well */
+   if (!linux_input_tasks_watched && task_queue_wakeup_fd() >= 0)
+      linux_input_tasks_watched = linux_input_watch(
+            task_queue_wakeup_fd(), linux_input_task_done, NULL);
+
+   /* A signal only ends the wait early */
+   epoll_wait(linux_input_epoll, &ev, 1, timeout_ms);
+   return true;
+}
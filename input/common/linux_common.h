@@ -31,4 +31,14 @@ bool linux_terminal_grab_stdin(void *data);
 
 bool linux_terminal_disable_input(void);
 
+typedef void (*linux_input_read_t)(void *data);
+
+bool linux_input_watch(int fd, linux_input_read_t read_cb, void *data);
+
+void linux_input_unwatch(int fd);
+
+void linux_input_poll(void);
+
+bool linux_input_wait(int timeout_ms);
+
 #endif
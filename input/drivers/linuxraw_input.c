@@ -24,6 +24,7 @@
 #include <signal.h>
 
 #include <boolean.h>
+#include <string/stdstring.h>
 
 #include "../../verbosity.h"
 
@@ -39,8 +40,34 @@ typedef struct linuxraw_input
 {
    const input_device_driver_t *joypad;
    bool state[0x80];
+   /* Else stdin is read on every poll */
+   bool stdin_watched;
 } linuxraw_input_t;
 
+static void linuxraw_input_read_stdin(void *data)
+{
+   uint8_t c;
+   linuxraw_input_t *linuxraw = (linuxraw_input_t*)data;
+
+   while (read(STDIN_FILENO, &c, 1) > 0)
+   {
+      bool pressed;
+      uint16_t t;
+
+      if (c == KEY_C && (linuxraw->state[KEY_LEFTCTRL] || linuxraw->state[KEY_RIGHTCTRL]))
+         kill(getpid(), SIGINT);
+
+      pressed = !(c & 0x80);
+      c &= ~0x80;
+
+      /* ignore extended scancodes */
+      if (!c)
+         read(STDIN_FILENO, &t, 2);
+      else
+         linuxraw->state[c] = pressed;
+   }
+}
+
 static void *linuxraw_input_init(const char *joypad_driver)
 {
    linuxraw_input_t *linuxraw  = NULL;
@@ -66,7 +93,9 @@ static void *linuxraw_input_init(const char *joypad_driver)
       return NULL;
    }
 
-   linuxraw->joypad = input_joypad_init_driver(joypad_driver, linuxraw);
+   linuxraw->stdin_watched = linux_input_watch(STDIN_FILENO,
+         linuxraw_input_read_stdin, linuxraw);
+   linuxraw->joypad        = input_joypad_init_driver(joypad_driver, linuxraw);
    input_keymaps_init_keyboard_lut(rarch_key_map_linux);
 
    linux_terminal_claim_stdin();
@@ -192,6 +221,9 @@ static void linuxraw_input_free(void *data)
    if (linuxraw->joypad)
       linuxraw->joypad->destroy();
 
+   if (linuxraw->stdin_watched)
+      linux_input_unwatch(STDIN_FILENO);
+
    linux_terminal_restore_input();
    free(data);
 }
@@ -215,26 +247,12 @@ static const input_device_driver_t *linuxraw_get_joypad_driver(void *data)
 
 static void linuxraw_input_poll(void *data)
 {
-   uint8_t c;
    linuxraw_input_t *linuxraw = (linuxraw_input_t*)data;
 
-   while (read(STDIN_FILENO, &c, 1) > 0)
-   {
-      bool pressed;
-      uint16_t t;
-
-      if (c == KEY_C && (linuxraw->state[KEY_LEFTCTRL] || linuxraw->state[KEY_RIGHTCTRL]))
-         kill(getpid(), SIGINT);
-
-      pressed = !(c & 0x80);
-      c &= ~0x80;
-
-      /* ignore extended scancodes */
-      if (!c)
-         read(STDIN_FILENO, &t, 2);
-      else
-         linuxraw->state[c] = pressed;
-   }
+   if (linuxraw->stdin_watched)
+      linux_input_poll();
+   else
+      linuxraw_input_read_stdin(linuxraw);
 
    if (linuxraw->joypad)
       linuxraw->joypad->poll();
@@ -258,6 +276,22 @@ static void linuxraw_grab_mouse(void *data, bool state)
    (void)state;
 }
 
+static bool linuxraw_input_wait(void *data, int timeout_ms)
+{
+   linuxraw_input_t *linuxraw = (linuxraw_input_t*)data;
+
+   if (!linuxraw->stdin_watched)
+      return false;
+
+   /* Only the linux joypad drivers are watched with stdin */
+   if (     linuxraw->joypad
+         && !string_is_equal(linuxraw->joypad->ident, "udev")
+         && !string_is_equal(linuxraw->joypad->ident, "linuxraw"))
+      return false;
+
+   return linux_input_wait(timeout_ms);
+}
+
 input_driver_t input_linuxraw = {
    linuxraw_input_init,
    linuxraw_input_poll,
@@ -272,5 +306,6 @@ input_driver_t input_linuxraw = {
    linuxraw_set_rumble,
    linuxraw_get_joypad_driver,
    NULL,
-   false
+   false,
+   linuxraw_input_wait
 };
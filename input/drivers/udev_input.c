@@ -14,20 +14,6 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
-/* TODO/FIXME - set this once the kqueue codepath is implemented and working properly,
- * also remove libepoll-shim from the Makefile when that happens. */
-#if 1
-#define HAVE_EPOLL
-#else
-#ifdef __linux__
-#define HAVE_EPOLL 1
-#endif
-
-#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined (__NetBSD__)
-#define HAVE_KQUEUE 1
-#endif
-#endif
-
 #include <stdint.h>
 #include <string.h>
 
@@ -39,12 +25,6 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
-#if defined(HAVE_EPOLL)
-#include <sys/epoll.h>
-#elif defined(HAVE_KQUEUE)
-#include <sys/event.h>
-#endif
-#include <poll.h>
 
 #include <libudev.h>
 #ifdef __linux__
@@ -115,6 +95,7 @@ typedef struct
 struct udev_input_device
 {
    int fd;
+   udev_input_t *udev;
    dev_t dev;
    void (*handle_cb)(void *data,
          const struct input_event *event, udev_input_device_t *dev);
@@ -134,7 +115,6 @@ struct udev_input
 
    const input_device_driver_t *joypad;
 
-   int fd;
    udev_input_device_t **devices;
    unsigned num_devices;
 
@@ -472,16 +452,25 @@ static void udev_handle_mouse(void *data,
    }
 }
 
+static void udev_input_read_device(void *data)
+{
+   int i, len;
+   struct input_event events[32];
+   udev_input_device_t *device = (udev_input_device_t*)data;
+
+   while ((len = read(device->fd, events, sizeof(events))) > 0)
+   {
+      len /= sizeof(*events);
+      for (i = 0; i < len; i++)
+         device->handle_cb(device->udev, &events[i], device);
+   }
+}
+
 static bool udev_input_add_device(udev_input_t *udev,
       enum udev_input_dev_type type, const char *devnode, device_handle_cb cb)
 {
    int fd;
    struct stat st;
-#if defined(HAVE_EPOLL)
-   struct epoll_event event;
-#elif defined(HAVE_KQUEUE)
-   struct kevent event;
-#endif
    struct input_absinfo absinfo;
    udev_input_device_t **tmp;
    udev_input_device_t *device = NULL;
@@ -500,6 +489,7 @@ static bool udev_input_add_device(udev_input_t *udev,
       goto error;
 
    device->fd        = fd;
+   device->udev      = udev;
    device->dev       = st.st_dev;
    device->handle_cb = cb;
    device->type      = type;
@@ -547,24 +537,7 @@ static bool udev_input_add_device(udev_input_t *udev,
    tmp[udev->num_devices++] = device;
    udev->devices            = tmp;
 
-#if defined(HAVE_EPOLL)
-   event.events             = EPOLLIN;
-   event.data.ptr           = device;
-
-   /* Shouldn't happen, but just check it. */
-   if (epoll_ctl(udev->fd, EPOLL_CTL_ADD, fd, &event) < 0)
-   {
-      RARCH_ERR("Failed to add FD (%d) to epoll list (%s).\n",
-            fd, strerror(errno));
-   }
-#elif defined(HAVE_KQUEUE)
-   EV_SET(&event, fd, EVFILT_READ, EV_ADD, 0, 0, LISTENSOCKET);
-   if (kevent(udev->fd, &event, 1, NULL, 0, NULL) == -1)
-   {
-      RARCH_ERR("Failed to add FD (%d) to kqueue list (%s).\n",
-            fd, strerror(errno));
-   }
-#endif
+   linux_input_watch(fd, udev_input_read_device, device);
 
    return true;
 
@@ -585,6 +558,7 @@ static void udev_input_remove_device(udev_input_t *udev, const char *devnode)
       if (!string_is_equal(devnode, udev->devices[i]->devnode))
          continue;
 
+      linux_input_unwatch(udev->devices[i]->fd);
       close(udev->devices[i]->fd);
       free(udev->devices[i]);
       memmove(udev->devices + i, udev->devices + i + 1,
@@ -593,7 +567,7 @@ static void udev_input_remove_device(udev_input_t *udev, const char *devnode)
    }
 }
 
-static void udev_input_handle_hotplug(udev_input_t *udev)
+static bool udev_input_handle_hotplug(udev_input_t *udev)
 {
    device_handle_cb cb;
    enum udev_input_dev_type dev_type = UDEV_INPUT_KEYBOARD;
@@ -606,7 +580,7 @@ static void udev_input_handle_hotplug(udev_input_t *udev)
          udev->monitor);
 
    if (!dev)
-      return;
+      return false;
 
    val_key       = udev_device_get_property_value(dev, "ID_INPUT_KEY");
    val_mouse     = udev_device_get_property_value(dev, "ID_INPUT_MOUSE");
@@ -648,6 +622,14 @@ static void udev_input_handle_hotplug(udev_input_t *udev)
 
 end:
    udev_device_unref(dev);
+   return true;
+}
+
+static void udev_input_read_hotplug(void *data)
+{
+   udev_input_t *udev = (udev_input_t*)data;
+
+   while (udev_input_handle_hotplug(udev));
 }
 
 #ifdef HAVE_X11
@@ -702,25 +684,9 @@ static void udev_input_adopt_rel_pointer_position_from_mouse(
 }
 #endif
 
-static bool udev_input_poll_hotplug_available(struct udev_monitor *dev)
-{
-   struct pollfd fds;
-
-   fds.fd      = udev_monitor_get_fd(dev);
-   fds.events  = POLLIN;
-   fds.revents = 0;
-
-   return (poll(&fds, 1, 0) == 1) && (fds.revents & POLLIN);
-}
-
 static void udev_input_poll(void *data)
 {
-   int i, ret;
-#if defined(HAVE_EPOLL)
-   struct epoll_event events[32];
-#elif defined(HAVE_KQUEUE)
-   struct kevent events[32];
-#endif
+   int i;
    udev_input_mouse_t *mouse = NULL;
    udev_input_t *udev        = (udev_input_t*)data;
 
@@ -747,43 +713,8 @@ static void udev_input_poll(void *data)
       mouse->whd   = false;
    }
 
-   while (udev->monitor && udev_input_poll_hotplug_available(udev->monitor))
-      udev_input_handle_hotplug(udev);
-
-#if defined(HAVE_EPOLL)
-   ret = epoll_wait(udev->fd, events, ARRAY_SIZE(events), 0);
-#elif defined(HAVE_KQUEUE)
-   {
-      struct timespec timeoutspec;
-      timeoutspec.tv_sec  = timeout;
-      timeoutspec.tv_nsec = 0;
-      ret                 = kevent(udev->fd, NULL, 0, events,
-            ARRAY_SIZE(events), &timeoutspec);
-   }
-#endif
-
-   for (i = 0; i < ret; i++)
-   {
-      /* TODO/FIXME - add HAVE_EPOLL/HAVE_KQUEUE codepaths here */
-      if (events[i].events & EPOLLIN)
-      {
-         int j, len;
-         struct input_event input_events[32];
-#if defined(HAVE_EPOLL)
-         udev_input_device_t *device = (udev_input_device_t*)events[i].data.ptr;
-#elif defined(HAVE_KQUEUE)
-         udev_input_device_t *device = (udev_input_device_t*)events[i].udata;
-#endif
-
-         while ((len = read(device->fd,
-                     input_events, sizeof(input_events))) > 0)
-         {
-            len /= sizeof(*input_events);
-            for (j = 0; j < len; j++)
-               device->handle_cb(udev, &input_events[j], device);
-         }
-      }
-   }
+   /* Hotplug and every device, joypads too if udev or linuxraw */
+   linux_input_poll();
 
    if (udev->joypad)
       udev->joypad->poll();
@@ -1125,20 +1056,19 @@ static void udev_input_free(void *data)
    if (udev->joypad)
       udev->joypad->destroy();
 
-   if (udev->fd >= 0)
-      close(udev->fd);
-
-   udev->fd = -1;
-
    for (i = 0; i < udev->num_devices; i++)
    {
+      linux_input_unwatch(udev->devices[i]->fd);
       close(udev->devices[i]->fd);
       free(udev->devices[i]);
    }
    free(udev->devices);
 
    if (udev->monitor)
+   {
+      linux_input_unwatch(udev_monitor_get_fd(udev->monitor));
       udev_monitor_unref(udev->monitor);
+   }
    if (udev->udev)
       udev_unref(udev->udev);
 
@@ -1198,7 +1128,6 @@ static bool open_devices(udev_input_t *udev,
 
 static void *udev_input_init(const char *joypad_driver)
 {
-   int fd;
 #ifdef UDEV_XKB_HANDLING
    gfx_ctx_ident_t ctx_ident;
 #endif
@@ -1219,6 +1148,8 @@ static void *udev_input_init(const char *joypad_driver)
    {
       udev_monitor_filter_add_match_subsystem_devtype(udev->monitor, "input", NULL);
       udev_monitor_enable_receiving(udev->monitor);
+      linux_input_watch(udev_monitor_get_fd(udev->monitor),
+            udev_input_read_hotplug, udev);
    }
 
 #ifdef UDEV_XKB_HANDLING
@@ -1229,24 +1160,6 @@ static void *udev_input_init(const char *joypad_driver)
    udev->xkb_handling = string_is_equal(ctx_ident.ident, "kms");
 #endif
 
-#if defined(HAVE_EPOLL)
-   fd = epoll_create(32);
-   if (fd < 0)
-   {
-      RARCH_ERR("Failed to create poll file descriptor.\n");
-      goto error;
-   }
-#elif defined(HAVE_KQUEUE)
-   fd = kqueue();
-   if (fd == -1)
-   {
-      RARCH_ERR("Failed to create poll file descriptor.\n");
-      goto error;
-   }
-#endif
-
-   udev->fd  = fd;
-
    if (!open_devices(udev, UDEV_INPUT_KEYBOARD, udev_handle_keyboard))
    {
       RARCH_ERR("Failed to open keyboard.\n");
@@ -1344,6 +1257,19 @@ static const input_device_driver_t *udev_input_get_joypad_driver(void *data)
    return udev->joypad;
 }
 
+static bool udev_input_wait(void *data, int timeout_ms)
+{
+   udev_input_t *udev = (udev_input_t*)data;
+
+   /* Only the linux joypad drivers are watched with the devices */
+   if (     udev->joypad
+         && !string_is_equal(udev->joypad->ident, "udev")
+         && !string_is_equal(udev->joypad->ident, "linuxraw"))
+      return false;
+
+   return linux_input_wait(timeout_ms);
+}
+
 input_driver_t input_udev = {
    udev_input_init,
    udev_input_poll,
@@ -1362,5 +1288,6 @@ input_driver_t input_udev = {
    udev_input_set_rumble,
    udev_input_get_joypad_driver,
    NULL,
-   false
+   false,
+   udev_input_wait
 };
@@ -26,12 +26,12 @@
 #include <linux/joystick.h>
 
 #include <fcntl.h>
-#include <sys/epoll.h>
 
 #include <compat/strl.h>
 #include <string/stdstring.h>
 
 #include "../input_driver.h"
+#include "../common/linux_common.h"
 
 #include "../../verbosity.h"
 #include "../../tasks/tasks_internal.h"
@@ -49,13 +49,13 @@ struct linuxraw_joypad
 };
 
 static struct linuxraw_joypad linuxraw_pads[MAX_USERS];
-static int linuxraw_epoll                              = 0;
 static int linuxraw_inotify                            = 0;
 static bool linuxraw_hotplug                           = false;
 
-static void linuxraw_poll_pad(struct linuxraw_joypad *pad)
+static void linuxraw_poll_pad(void *data)
 {
    struct js_event event;
+   struct linuxraw_joypad *pad = (struct linuxraw_joypad*)data;
 
    while (read(pad->fd, &event, sizeof(event)) == (ssize_t)sizeof(event))
    {
@@ -96,8 +96,6 @@ static bool linuxraw_joypad_init_pad(const char *path,
 
    if (pad->fd >= 0)
    {
-      struct epoll_event event;
-
       if (ioctl(pad->fd,
                JSIOCGNAME(sizeof(input_device_names[0])), pad->ident) >= 0)
       {
@@ -106,15 +104,7 @@ static bool linuxraw_joypad_init_pad(const char *path,
       else
          RARCH_ERR("[Device]: Didn't find ident of %s.\n", path);
 
-      event.events             = EPOLLIN;
-      event.data.ptr           = pad;
-
-      if (epoll_ctl(linuxraw_epoll, EPOLL_CTL_ADD, pad->fd, &event) < 0)
-      {
-         RARCH_ERR("Failed to add FD (%d) to epoll list (%s).\n",
-               pad->fd, strerror(errno));
-      }
-      else
+      if (linux_input_watch(pad->fd, linuxraw_poll_pad, pad))
          return true;
    }
 
@@ -131,112 +121,93 @@ static const char *linuxraw_joypad_name(unsigned pad)
    return linuxraw_pads[pad].ident;
 }
 
-static void linuxraw_joypad_poll(void)
+/* Handles plugged and unplugged pads */
+static void linuxraw_joypad_read_inotify(void *data)
 {
-   int i, ret;
-   struct epoll_event events[MAX_USERS + 1];
-
-retry:
-   ret = epoll_wait(linuxraw_epoll, events, MAX_USERS + 1, 0);
-   if (ret < 0 && errno == EINTR)
-      goto retry;
+   int j, rc;
+   size_t event_size  = sizeof(struct inotify_event) + NAME_MAX + 1;
+   uint8_t *event_buf = (uint8_t*)calloc(1, event_size);
 
-   for (i = 0; i < ret; i++)
+   while ((rc = read(linuxraw_inotify, event_buf, event_size)) >= 0)
    {
-      struct linuxraw_joypad *ptr = (struct linuxraw_joypad*)
-         events[i].data.ptr;
+      struct inotify_event *event = (struct inotify_event*)&event_buf[0];
 
-      if (ptr)
-         linuxraw_poll_pad(ptr);
-      else
+      event_buf[rc-1] = '\0';
+
+      /* Can read multiple events in one read() call. */
+
+      for (j = 0; j < rc; j += event->len + sizeof(struct inotify_event))
       {
-         /* handle plugged pad */
-         int j, rc;
-         size_t event_size  = sizeof(struct inotify_event) + NAME_MAX + 1;
-         uint8_t *event_buf = (uint8_t*)calloc(1, event_size);
+         unsigned idx;
 
-         while ((rc = read(linuxraw_inotify, event_buf, event_size)) >= 0)
-         {
-            struct inotify_event *event = (struct inotify_event*)&event_buf[0];
+         event = (struct inotify_event*)&event_buf[j];
 
-            event_buf[rc-1] = '\0';
+         if (strstr(event->name, "js") != event->name)
+            continue;
 
-            /* Can read multiple events in one read() call. */
+         idx = strtoul(event->name + 2, NULL, 0);
+         if (idx >= MAX_USERS)
+            continue;
 
-            for (j = 0; j < rc; j += event->len + sizeof(struct inotify_event))
+         if (event->mask & IN_DELETE)
+         {
+            if (linuxraw_pads[idx].fd >= 0)
             {
-               unsigned idx;
-
-               event = (struct inotify_event*)&event_buf[j];
-
-               if (strstr(event->name, "js") != event->name)
-                  continue;
-
-               idx = strtoul(event->name + 2, NULL, 0);
-               if (idx >= MAX_USERS)
-                  continue;
-
-               if (event->mask & IN_DELETE)
-               {
-                  if (linuxraw_pads[idx].fd >= 0)
-                  {
-                     if (linuxraw_hotplug)
-                        input_autoconfigure_disconnect(idx,
-                              linuxraw_pads[idx].ident);
-
-                     close(linuxraw_pads[idx].fd);
-                     linuxraw_pads[idx].buttons = 0;
-                     memset(linuxraw_pads[idx].axes, 0,
-                           sizeof(linuxraw_pads[idx].axes));
-                     linuxraw_pads[idx].fd = -1;
-                     *linuxraw_pads[idx].ident = '\0';
-
-                     input_autoconfigure_connect(
-                           NULL,
-                           NULL,
-                           linuxraw_joypad_name(idx),
-                           idx,
-                           0,
-                           0);
-                  }
-               }
-               /* Sometimes, device will be created before
-                * access to it is established. */
-               else if (event->mask & (IN_CREATE | IN_ATTRIB))
-               {
-                  char path[PATH_MAX_LENGTH];
-
-                  path[0] = '\0';
-
-                  snprintf(path, sizeof(path), "/dev/input/%s", event->name);
-
-                  if (     !string_is_empty(linuxraw_pads[idx].ident)
-                        && linuxraw_joypad_init_pad(path, &linuxraw_pads[idx]))
-                     input_autoconfigure_connect(
-                           linuxraw_pads[idx].ident,
-                           NULL,
-                           linuxraw_joypad.ident,
-                           idx,
-                           0,
-                           0);
-               }
+               if (linuxraw_hotplug)
+                  input_autoconfigure_disconnect(idx,
+                        linuxraw_pads[idx].ident);
+
+               linux_input_unwatch(linuxraw_pads[idx].fd);
+               close(linuxraw_pads[idx].fd);
+               linuxraw_pads[idx].buttons = 0;
+               memset(linuxraw_pads[idx].axes, 0,
+                     sizeof(linuxraw_pads[idx].axes));
+               linuxraw_pads[idx].fd = -1;
+               *linuxraw_pads[idx].ident = '\0';
+
+               input_autoconfigure_connect(
+                     NULL,
+                     NULL,
+                     linuxraw_joypad_name(idx),
+                     idx,
+                     0,
+                     0);
             }
          }
+         /* Sometimes, device will be created before
+          * access to it is established. */
+         else if (event->mask & (IN_CREATE | IN_ATTRIB))
+         {
+            char path[PATH_MAX_LENGTH];
 
-         free(event_buf);
+            path[0] = '\0';
+
+            snprintf(path, sizeof(path), "/dev/input/%s", event->name);
+
+            if (     !string_is_empty(linuxraw_pads[idx].ident)
+                  && linuxraw_joypad_init_pad(path, &linuxraw_pads[idx]))
+               input_autoconfigure_connect(
+                     linuxraw_pads[idx].ident,
+                     NULL,
+                     linuxraw_joypad.ident,
+                     idx,
+                     0,
+                     0);
+         }
       }
    }
+
+   free(event_buf);
+}
+
+static void linuxraw_joypad_poll(void)
+{
+   linux_input_poll();
 }
 
 static bool linuxraw_joypad_init(void *data)
 {
    unsigned i;
-   int fd = epoll_create(32);
-
-   if (fd < 0)
-      return false;
-
-   linuxraw_epoll = fd;
 
    for (i = 0; i < MAX_USERS; i++)
    {
@@ -266,20 +237,11 @@ static bool linuxraw_joypad_init(void *data)
 
    if (linuxraw_inotify >= 0)
    {
-      struct epoll_event event;
-
       fcntl(linuxraw_inotify, F_SETFL, fcntl(linuxraw_inotify, F_GETFL) | O_NONBLOCK);
       inotify_add_watch(linuxraw_inotify, "/dev/input", IN_DELETE | IN_CREATE | IN_ATTRIB);
 
-      event.events             = EPOLLIN;
-      event.data.ptr           = NULL;
-
-      /* Shouldn't happen, but just check it. */
-      if (epoll_ctl(linuxraw_epoll, EPOLL_CTL_ADD, linuxraw_inotify, &event) < 0)
-      {
-         RARCH_ERR("Failed to add FD (%d) to epoll list (%s).\n",
-               linuxraw_inotify, strerror(errno));
-      }
+      linux_input_watch(linuxraw_inotify,
+            linuxraw_joypad_read_inotify, NULL);
    }
 
    linuxraw_hotplug = true;
@@ -294,7 +256,10 @@ static void linuxraw_joypad_destroy(void)
    for (i = 0; i < MAX_USERS; i++)
    {
       if (linuxraw_pads[i].fd >= 0)
+      {
+         linux_input_unwatch(linuxraw_pads[i].fd);
          close(linuxraw_pads[i].fd);
+      }
    }
 
    memset(linuxraw_pads, 0, sizeof(linuxraw_pads));
@@ -303,13 +268,12 @@ static void linuxraw_joypad_destroy(void)
       linuxraw_pads[i].fd = -1;
 
    if (linuxraw_inotify >= 0)
+   {
+      linux_input_unwatch(linuxraw_inotify);
       close(linuxraw_inotify);
+   }
    linuxraw_inotify = -1;
 
-   if (linuxraw_epoll >= 0)
-      close(linuxraw_epoll);
-   linuxraw_epoll = -1;
-
    linuxraw_hotplug = false;
 }
 
@@ -23,7 +23,6 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <poll.h>
 #include <libudev.h>
 #ifdef __linux__
 #include <linux/types.h>
@@ -33,9 +32,23 @@
 #include <retro_inline.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
+
+#include <time.h>
+
+#if defined(HAVE_THREADS) && defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <rthreads/rthreads.h>
+#define HAVE_UDEV_JOYPAD_THREAD
+#endif
 
 #include "../input_driver.h"
+#include "../common/linux_common.h"
 
+#include "../../configuration.h"
+#include "../../latency_test.h"
+#include "../../performance_counters.h"
 #include "../../tasks/tasks_internal.h"
 
 #include "../../verbosity.h"
@@ -56,10 +69,25 @@
 #define NUM_HATS 4
 #endif
 
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+/* Events read by the reader thread and not polled yet, per pad.
+ * Must be a power of two. */
+#define UDEV_EVENT_RING_SIZE 256
+
+/* The rings are single producer (the reader thread), single
+ * consumer (udev_joypad_poll), so neither side takes a lock. */
+#define UDEV_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define UDEV_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#endif
+
 #define test_bit(nr, addr) \
    (((1UL << ((nr) % (sizeof(long) * CHAR_BIT))) & ((addr)[(nr) / (sizeof(long) * CHAR_BIT)])) != 0)
 #define NBITS(x) ((((x) - 1) / (sizeof(long) * CHAR_BIT)) + 1)
 
+/* Timestamp of an event, in usec of the clock set by EVIOCSCLOCKID */
+#define UDEV_EVENT_TIME(ev) \
+   ((retro_time_t)(ev)->time.tv_sec * 1000000 + (ev)->time.tv_usec)
+
 struct udev_joypad
 {
    int fd;
@@ -89,6 +117,17 @@ struct udev_joypad
    bool neg_trigger[NUM_AXES];
 };
 
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+struct udev_joypad_ring
+{
+   struct input_event events[UDEV_EVENT_RING_SIZE];
+   unsigned head; /* Written by the reader thread */
+   unsigned tail; /* Written by udev_joypad_poll */
+   /* Events were dropped, the state must be read again */
+   bool overflow;
+};
+#endif
+
 struct joypad_udev_entry
 {
    const char *devnode;
@@ -99,6 +138,24 @@ static struct udev *udev_joypad_fd             = NULL;
 static struct udev_monitor *udev_joypad_mon    = NULL;
 static struct udev_joypad udev_pads[MAX_USERS];
 
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+/* Reads the pads as soon as they have events, so that their
+ * kernel timestamps can be kept and polling makes no system
+ * calls. The lock keeps pads from being closed under it. */
+static struct udev_joypad_ring udev_rings[MAX_USERS];
+static sthread_t *udev_joypad_thread        = NULL;
+static slock_t *udev_joypad_thread_lock     = NULL;
+static int udev_joypad_epoll                = -1;
+static int udev_joypad_wake                 = -1;
+/* Readable once events are in the rings, so that an idle
+ * runloop waiting on linux_input_wait sees them */
+static int udev_joypad_ready                = -1;
+static bool udev_joypad_thread_quit         = false;
+
+/* How long events waited before being polled, in usec. */
+static rarch_histogram_t udev_joypad_event_histogram;
+#endif
+
 static INLINE int16_t udev_compute_axis(const struct input_absinfo *info, int value)
 {
    int range = info->maximum - info->minimum;
@@ -127,6 +184,9 @@ static int udev_open_joystick(const char *path)
    unsigned long keybit[NBITS(KEY_MAX)] = {0};
    unsigned long absbit[NBITS(ABS_MAX)] = {0};
    int fd = open(path, O_RDWR | O_NONBLOCK);
+#ifdef EVIOCSCLOCKID
+   int clock_id = CLOCK_MONOTONIC;
+#endif
 
    if (fd < 0)
       return fd;
@@ -140,6 +200,11 @@ static int udev_open_joystick(const char *path)
    if (!test_bit(EV_KEY, evbit))
       goto error;
 
+#ifdef EVIOCSCLOCKID
+   /* Timestamp events with the clock frame times are taken from. */
+   ioctl(fd, EVIOCSCLOCKID, &clock_id);
+#endif
+
    return fd;
 
 error:
@@ -147,6 +212,73 @@ error:
    return -1;
 }
 
+static void udev_joypad_handle_event(struct udev_joypad *pad,
+      uint16_t type, uint16_t code, int32_t value)
+{
+   switch (type)
+   {
+      case EV_KEY:
+         if (code > 0 && code < KEY_MAX)
+         {
+            if (value)
+               BIT64_SET(pad->buttons, pad->button_bind[code]);
+            else
+               BIT64_CLEAR(pad->buttons, pad->button_bind[code]);
+         }
+         break;
+
+      case EV_ABS:
+         if (code >= ABS_MISC)
+            break;
+
+         switch (code)
+         {
+            case ABS_HAT0X:
+            case ABS_HAT0Y:
+            case ABS_HAT1X:
+            case ABS_HAT1Y:
+            case ABS_HAT2X:
+            case ABS_HAT2Y:
+            case ABS_HAT3X:
+            case ABS_HAT3Y:
+               code                           -= ABS_HAT0X;
+               pad->hats[code >> 1][code & 1]  = value;
+               break;
+            default:
+               {
+                  unsigned axis   = pad->axes_bind[code];
+                  pad->axes[axis] = udev_compute_axis(
+                        &pad->absinfo[axis], value);
+                  break;
+               }
+         }
+         break;
+
+      default:
+         break;
+   }
+}
+
+static void udev_joypad_read_pad(void *data)
+{
+   int i, len;
+   struct input_event events[32];
+   struct udev_joypad *pad = (struct udev_joypad*)data;
+
+   while ((len = read(pad->fd, events, sizeof(events))) > 0)
+   {
+      len /= sizeof(*events);
+      for (i = 0; i < len; i++)
+      {
+         udev_joypad_handle_event(pad,
+               events[i].type, events[i].code, events[i].value);
+
+         if (events[i].type == EV_KEY && events[i].value == 1)
+            latency_test_input_event(UDEV_EVENT_TIME(&events[i]));
+      }
+   }
+}
+
 static int udev_add_pad(struct udev_device *dev, unsigned p, int fd, const char *path)
 {
    int i;
@@ -240,6 +372,21 @@ static int udev_add_pad(struct udev_device *dev, unsigned p, int fd, const char
    pad->fd     = fd;
    pad->path   = strdup(path);
 
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   if (udev_joypad_thread)
+   {
+      struct epoll_event ev = {0};
+
+      ev.events   = EPOLLIN;
+      ev.data.u32 = p;
+      if (epoll_ctl(udev_joypad_epoll, EPOLL_CTL_ADD, fd, &ev) < 0)
+         RARCH_WARN("[udev]: Failed to watch pad #%u from the reader thread.\n", p);
+   }
+   else
+#endif
+   if (!linux_input_watch(fd, udev_joypad_read_pad, pad))
+      RARCH_WARN("[udev]: Failed to watch pad #%u.\n", p);
+
    if (!string_is_empty(pad->ident))
    {
       input_autoconfigure_connect(
@@ -317,8 +464,24 @@ static void udev_check_device(struct udev_device *dev, const char *path)
 
 static void udev_free_pad(unsigned pad)
 {
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   if (udev_joypad_thread_lock)
+      slock_lock(udev_joypad_thread_lock);
+
+   if (udev_joypad_thread && udev_pads[pad].fd >= 0)
+      epoll_ctl(udev_joypad_epoll, EPOLL_CTL_DEL, udev_pads[pad].fd, NULL);
+
+   /* Nothing writes to it while the lock is held */
+   udev_rings[pad].head     = 0;
+   udev_rings[pad].tail     = 0;
+   udev_rings[pad].overflow = false;
+#endif
+
    if (udev_pads[pad].fd >= 0)
+   {
+      linux_input_unwatch(udev_pads[pad].fd);
       close(udev_pads[pad].fd);
+   }
 
    if (udev_pads[pad].path)
       free(udev_pads[pad].path);
@@ -329,6 +492,11 @@ static void udev_free_pad(unsigned pad)
    memset(&udev_pads[pad], 0, sizeof(udev_pads[pad]));
 
    udev_pads[pad].fd    = -1;
+
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   if (udev_joypad_thread_lock)
+      slock_unlock(udev_joypad_thread_lock);
+#endif
 }
 
 static void udev_joypad_remove_device(const char *path)
@@ -347,15 +515,248 @@ static void udev_joypad_remove_device(const char *path)
    }
 }
 
+
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+/* Reads every event of a pad into its ring. Called with
+ * the lock held. */
+static void udev_joypad_read(unsigned p)
+{
+   int i, len;
+   struct input_event events[32];
+   struct udev_joypad *pad       = &udev_pads[p];
+   struct udev_joypad_ring *ring = &udev_rings[p];
+
+   if (pad->fd < 0)
+      return;
+
+   while ((len = read(pad->fd, events, sizeof(events))) > 0)
+   {
+      unsigned head = ring->head;
+      unsigned tail = UDEV_ATOMIC_LOAD(&ring->tail);
+
+      len /= sizeof(*events);
+      for (i = 0; i < len; i++)
+      {
+         /* The kernel dropped some itself */
+         if (events[i].type == EV_SYN && events[i].code == SYN_DROPPED)
+            UDEV_ATOMIC_STORE(&ring->overflow, true);
+
+         if (events[i].type != EV_KEY && events[i].type != EV_ABS)
+            continue;
+
+         /* Nobody polled for a while. Rather than block, the
+          * state is read again once somebody does. */
+         if (head - tail >= UDEV_EVENT_RING_SIZE)
+         {
+            UDEV_ATOMIC_STORE(&ring->overflow, true);
+            break;
+         }
+
+         ring->events[head & (UDEV_EVENT_RING_SIZE - 1)] = events[i];
+         head++;
+      }
+
+      UDEV_ATOMIC_STORE(&ring->head, head);
+   }
+}
+
+static void udev_joypad_reader(void *data)
+{
+   struct epoll_event events[MAX_USERS + 1];
+
+   (void)data;
+
+   for (;;)
+   {
+      int i;
+      int count = epoll_wait(udev_joypad_epoll, events,
+            ARRAY_SIZE(events), -1);
+
+      if (count < 0 && errno != EINTR)
+         break;
+
+      slock_lock(udev_joypad_thread_lock);
+
+      if (udev_joypad_thread_quit)
+      {
+         slock_unlock(udev_joypad_thread_lock);
+         break;
+      }
+
+      for (i = 0; i < count; i++)
+         if (events[i].data.u32 < MAX_USERS)
+            udev_joypad_read(events[i].data.u32);
+
+      slock_unlock(udev_joypad_thread_lock);
+
+      if (count > 0)
+      {
+         uint64_t one = 1;
+         if (write(udev_joypad_ready, &one, sizeof(one)) != sizeof(one))
+            RARCH_WARN("[udev]: Failed to signal joypad events.\n");
+      }
+   }
+}
+
+static void udev_joypad_drain_ready(void *data)
+{
+   uint64_t count;
+
+   (void)data;
+
+   while (read(udev_joypad_ready, &count, sizeof(count)) > 0);
+}
+
+/* Reads the whole state of a pad again, after its ring
+ * overflowed. */
+static void udev_joypad_resync(unsigned p)
+{
+   unsigned i;
+   unsigned long keystate[NBITS(KEY_MAX)] = {0};
+   struct udev_joypad *pad                = &udev_pads[p];
+   struct udev_joypad_ring *ring          = &udev_rings[p];
+
+   /* Whatever the ring has is older than what is read now */
+   UDEV_ATOMIC_STORE(&ring->overflow, false);
+   UDEV_ATOMIC_STORE(&ring->tail, UDEV_ATOMIC_LOAD(&ring->head));
+
+   /* Keys the pad doesn't have share button 0, but are
+    * never pressed */
+   if (ioctl(pad->fd, EVIOCGKEY(sizeof(keystate)), keystate) >= 0)
+   {
+      pad->buttons = 0;
+      for (i = 1; i < KEY_MAX; i++)
+         if (test_bit(i, keystate))
+            BIT64_SET(pad->buttons, pad->button_bind[i]);
+   }
+
+   for (i = 0; i < ABS_MISC; i++)
+   {
+      struct input_absinfo abs = {0};
+      if (ioctl(pad->fd, EVIOCGABS(i), &abs) >= 0 &&
+            abs.maximum > abs.minimum)
+         udev_joypad_handle_event(pad, EV_ABS, i, abs.value);
+   }
+}
+
+/* Takes in what the reader thread read since the last poll. */
+static void udev_joypad_poll_ring(unsigned p)
+{
+   struct udev_joypad *pad       = &udev_pads[p];
+   struct udev_joypad_ring *ring = &udev_rings[p];
+   unsigned tail                 = ring->tail;
+   unsigned head                 = UDEV_ATOMIC_LOAD(&ring->head);
+   retro_time_t now              = cpu_features_get_time_usec();
+
+   if (UDEV_ATOMIC_LOAD(&ring->overflow))
+   {
+      udev_joypad_resync(p);
+      return;
+   }
+
+   for (; tail != head; tail++)
+   {
+      const struct input_event *ev =
+         &ring->events[tail & (UDEV_EVENT_RING_SIZE - 1)];
+      retro_time_t time            = UDEV_EVENT_TIME(ev);
+      retro_time_t age             = now - time;
+
+      udev_joypad_handle_event(pad, ev->type, ev->code, ev->value);
+
+      if (ev->type == EV_KEY && ev->value == 1)
+         latency_test_input_event(time);
+
+      /* Meaningless if the clock couldn't be set */
+      if (age >= 0 && age < 1000000)
+         rarch_histogram_add(&udev_joypad_event_histogram, age);
+   }
+
+   UDEV_ATOMIC_STORE(&ring->tail, tail);
+}
+
+static bool udev_joypad_thread_init(void)
+{
+   struct epoll_event ev = {0};
+
+   udev_joypad_thread_quit = false;
+   udev_joypad_epoll       = epoll_create1(EPOLL_CLOEXEC);
+   udev_joypad_wake        = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+   udev_joypad_ready       = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+   udev_joypad_thread_lock = slock_new();
+
+   if (udev_joypad_epoll < 0 || udev_joypad_wake < 0 ||
+         udev_joypad_ready < 0 || !udev_joypad_thread_lock)
+      return false;
+
+   ev.events   = EPOLLIN;
+   ev.data.u32 = MAX_USERS;
+   if (epoll_ctl(udev_joypad_epoll, EPOLL_CTL_ADD,
+            udev_joypad_wake, &ev) < 0)
+      return false;
+
+   udev_joypad_thread = sthread_create(udev_joypad_reader, NULL);
+   if (!udev_joypad_thread)
+      return false;
+
+   linux_input_watch(udev_joypad_ready, udev_joypad_drain_ready, NULL);
+
+   rarch_histogram_register(&udev_joypad_event_histogram,
+         "Joypad event age");
+   RARCH_LOG("[udev]: Reading joypads from a thread.\n");
+   return true;
+}
+
+static void udev_joypad_thread_deinit(void)
+{
+   if (udev_joypad_thread)
+   {
+      uint64_t one = 1;
+
+      slock_lock(udev_joypad_thread_lock);
+      udev_joypad_thread_quit = true;
+      slock_unlock(udev_joypad_thread_lock);
+
+      if (write(udev_joypad_wake, &one, sizeof(one)) != sizeof(one))
+         RARCH_WARN("[udev]: Failed to wake the reader thread.\n");
+      sthread_join(udev_joypad_thread);
+   }
+
+   if (udev_joypad_thread_lock)
+      slock_free(udev_joypad_thread_lock);
+   if (udev_joypad_wake >= 0)
+      close(udev_joypad_wake);
+   if (udev_joypad_ready >= 0)
+   {
+      linux_input_unwatch(udev_joypad_ready);
+      close(udev_joypad_ready);
+   }
+   if (udev_joypad_epoll >= 0)
+      close(udev_joypad_epoll);
+
+   udev_joypad_thread      = NULL;
+   udev_joypad_thread_lock = NULL;
+   udev_joypad_wake        = -1;
+   udev_joypad_ready       = -1;
+   udev_joypad_epoll       = -1;
+}
+#endif
+
 static void udev_joypad_destroy(void)
 {
    unsigned i;
 
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   udev_joypad_thread_deinit();
+#endif
+
    for (i = 0; i < MAX_USERS; i++)
       udev_free_pad(i);
 
    if (udev_joypad_mon)
+   {
+      linux_input_unwatch(udev_monitor_get_fd(udev_joypad_mon));
       udev_monitor_unref(udev_joypad_mon);
+   }
 
    if (udev_joypad_fd)
       udev_unref(udev_joypad_fd);
@@ -434,112 +835,53 @@ static bool udev_set_rumble(unsigned i,
    return true;
 }
 
-static bool udev_joypad_poll_hotplug_available(struct udev_monitor *dev)
-{
-   struct pollfd fds;
-
-   fds.fd      = udev_monitor_get_fd(dev);
-   fds.events  = POLLIN;
-   fds.revents = 0;
-
-   return (poll(&fds, 1, 0) == 1) && (fds.revents & POLLIN);
-}
-
-static void udev_joypad_poll(void)
+static void udev_joypad_read_hotplug(void *data)
 {
-   unsigned p;
+   struct udev_device *dev;
 
-   while (udev_joypad_mon && udev_joypad_poll_hotplug_available(udev_joypad_mon))
+   while ((dev = udev_monitor_receive_device(udev_joypad_mon)))
    {
-      struct udev_device *dev = udev_monitor_receive_device(udev_joypad_mon);
+      const char *val     = udev_device_get_property_value(dev, "ID_INPUT_JOYSTICK");
+      const char *action  = udev_device_get_action(dev);
+      const char *devnode = udev_device_get_devnode(dev);
 
-      if (dev)
+      if (val && string_is_equal(val, "1") && devnode)
       {
-         const char *val     = udev_device_get_property_value(dev, "ID_INPUT_JOYSTICK");
-         const char *action  = udev_device_get_action(dev);
-         const char *devnode = udev_device_get_devnode(dev);
-
-         if (val && string_is_equal(val, "1") && devnode)
+         if (string_is_equal(action, "add"))
          {
-            if (string_is_equal(action, "add"))
-            {
-               RARCH_LOG("[udev]: Hotplug add: %s.\n", devnode);
-               udev_check_device(dev, devnode);
-            }
-            else if (string_is_equal(action, "remove"))
-            {
-               RARCH_LOG("[udev]: Hotplug remove: %s.\n", devnode);
-               udev_joypad_remove_device(devnode);
-            }
+            RARCH_LOG("[udev]: Hotplug add: %s.\n", devnode);
+            udev_check_device(dev, devnode);
+         }
+         else if (string_is_equal(action, "remove"))
+         {
+            RARCH_LOG("[udev]: Hotplug remove: %s.\n", devnode);
+            udev_joypad_remove_device(devnode);
          }
-
-         udev_device_unref(dev);
       }
-   }
 
-   for (p = 0; p < MAX_USERS; p++)
-   {
-      int i, len;
-      struct input_event events[32];
-      struct udev_joypad *pad = &udev_pads[p];
+      udev_device_unref(dev);
+   }
+}
 
-      if (pad->fd < 0)
-         continue;
+static void udev_joypad_poll(void)
+{
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   unsigned p;
+#endif
 
-      while ((len = read(pad->fd, events, sizeof(events))) > 0)
-      {
-         len /= sizeof(*events);
-         for (i = 0; i < len; i++)
-         {
-            uint16_t type = events[i].type;
-            uint16_t code = events[i].code;
-            int32_t value = events[i].value;
-
-            switch (type)
-            {
-               case EV_KEY:
-                  if (code > 0 && code < KEY_MAX)
-                  {
-                     if (value)
-                        BIT64_SET(pad->buttons, pad->button_bind[code]);
-                     else
-                        BIT64_CLEAR(pad->buttons, pad->button_bind[code]);
-                  }
-                  break;
+   /* Hotplug, and the pads unless the reader thread reads them */
+   linux_input_poll();
 
-               case EV_ABS:
-                  if (code >= ABS_MISC)
-                     break;
-
-                  switch (code)
-                  {
-                     case ABS_HAT0X:
-                     case ABS_HAT0Y:
-                     case ABS_HAT1X:
-                     case ABS_HAT1Y:
-                     case ABS_HAT2X:
-                     case ABS_HAT2Y:
-                     case ABS_HAT3X:
-                     case ABS_HAT3Y:
-                        code                           -= ABS_HAT0X;
-                        pad->hats[code >> 1][code & 1]  = value;
-                        break;
-                     default:
-                        {
-                           unsigned axis   = pad->axes_bind[code];
-                           pad->axes[axis] = udev_compute_axis(
-                                 &pad->absinfo[axis], value);
-                           break;
-                        }
-                  }
-                  break;
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   if (!udev_joypad_thread)
+      return;
 
-               default:
-                  break;
-            }
-         }
-      }
+   for (p = 0; p < MAX_USERS; p++)
+   {
+      if (udev_pads[p].fd >= 0)
+         udev_joypad_poll_ring(p);
    }
+#endif
 }
 
 static bool udev_joypad_init(void *data)
@@ -566,7 +908,19 @@ static bool udev_joypad_init(void *data)
       udev_monitor_filter_add_match_subsystem_devtype(
             udev_joypad_mon, "input", NULL);
       udev_monitor_enable_receiving(udev_joypad_mon);
+      linux_input_watch(udev_monitor_get_fd(udev_joypad_mon),
+            udev_joypad_read_hotplug, NULL);
+   }
+
+#ifdef HAVE_UDEV_JOYPAD_THREAD
+   /* Before any pads are added, so they are all watched */
+   if (config_get_ptr()->bools.input_joypad_thread &&
+         !udev_joypad_thread_init())
+   {
+      RARCH_WARN("[udev]: Failed to start the reader thread, polling instead.\n");
+      udev_joypad_thread_deinit();
    }
+#endif
 
    enumerate = udev_enumerate_new(udev_joypad_fd);
    if (!enumerate)
@@ -185,6 +185,10 @@ struct input_driver
    const input_device_driver_t *(*get_joypad_driver)(void *data);
    const input_device_driver_t *(*get_sec_joypad_driver)(void *data);
    bool keyboard_mapping_blocked;
+
+   /* Blocks until there is input or timeout_ms passed. Returns
+    * false if the driver can't tell, for the caller to sleep. */
+   bool (*wait)(void *data, int timeout_ms);
 };
 
 struct rarch_joypad_driver
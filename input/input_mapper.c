@@ -42,6 +42,76 @@
 
 #include "../configuration.h"
 
+static void input_mapper_compile(input_mapper_port_t *port,
+      unsigned device,
+      const unsigned *keymapper_ids,
+      const unsigned *remap_ids)
+{
+   unsigned j;
+
+   port->count = 0;
+
+   switch (device)
+   {
+      case RETRO_DEVICE_KEYBOARD:
+         for (j = 0; j < RARCH_CUSTOM_BIND_LIST_END; j++)
+         {
+            if (keymapper_ids[j] == RETROK_UNKNOWN)
+               continue;
+            port->from[port->count]  = j;
+            port->to[port->count++]  = keymapper_ids[j];
+         }
+         break;
+      case RETRO_DEVICE_JOYPAD:
+      case RETRO_DEVICE_ANALOG:
+         /* Buttons, then the 8 axes */
+         for (j = 0; j < RARCH_FIRST_CUSTOM_BIND + 8; j++)
+         {
+            if (remap_ids[j] == j || remap_ids[j] == RARCH_UNMAPPED)
+               continue;
+            port->from[port->count]  = j;
+            port->to[port->count++]  = remap_ids[j];
+         }
+         break;
+      default:
+         break;
+   }
+}
+
+void input_mapper_update(input_mapper_t *handle,
+      void *settings_data,
+      unsigned max_users)
+{
+   unsigned i;
+   settings_t *settings = (settings_t*)settings_data;
+
+   for (i = 0; i < max_users; i++)
+   {
+      unsigned device  = settings->uints.input_libretro_device[i]
+         & RETRO_DEVICE_MASK;
+
+      if (     device == handle->devices[i]
+            && !memcmp(handle->keymapper_ids[i],
+               settings->uints.input_keymapper_ids[i],
+               sizeof(handle->keymapper_ids[i]))
+            && !memcmp(handle->remap_ids[i],
+               settings->uints.input_remap_ids[i],
+               sizeof(handle->remap_ids[i])))
+         continue;
+
+      handle->devices[i] = device;
+      memcpy(handle->keymapper_ids[i],
+            settings->uints.input_keymapper_ids[i],
+            sizeof(handle->keymapper_ids[i]));
+      memcpy(handle->remap_ids[i],
+            settings->uints.input_remap_ids[i],
+            sizeof(handle->remap_ids[i]));
+
+      input_mapper_compile(&handle->ports[i], device,
+            handle->keymapper_ids[i], handle->remap_ids[i]);
+   }
+}
+
 void input_mapper_poll(input_mapper_t *handle,
       void *ol_pointer,
       void *settings_data,
@@ -53,85 +123,83 @@ void input_mapper_poll(input_mapper_t *handle,
 #ifdef HAVE_OVERLAY
    input_overlay_t *overlay_pointer           = (input_overlay_t*)ol_pointer;
 #endif
-   settings_t *settings                       = (settings_t*)settings_data;
    input_bits_t *current_inputs               = (input_bits_t*)input_data;
+   float axis_threshold                       =
+      *input_driver_get_float(INPUT_ACTION_AXIS_THRESHOLD) * 32767;
 
    memset(handle->keys, 0, sizeof(handle->keys));
 
-   for (i = 0; i < max_users; i++)
+   for (i = 0; i < max_users; i++, current_inputs++)
    {
-      unsigned device  = settings->uints.input_libretro_device[i] 
-         & RETRO_DEVICE_MASK;
-      input_bits_t current_input = *current_inputs++;
+      const input_mapper_port_t *port = &handle->ports[i];
+      const input_bits_t *current_input = current_inputs;
+
+      BIT256_CLEAR_ALL(handle->buttons[i]);
+
+      for (j = 0; j < 8; j++)
+         handle->analog_value[i][j] = 0;
 
-      switch (device)
+      /* Nothing remapped, not even read */
+      if (!port->count)
+         continue;
+
+      switch (handle->devices[i])
       {
          /* keyboard to gamepad remapping */
          case RETRO_DEVICE_KEYBOARD:
-            for (j = 0; j < RARCH_CUSTOM_BIND_LIST_END; j++)
+            for (j = 0; j < port->count; j++)
             {
-               unsigned remap_button         =
-                  settings->uints.input_keymapper_ids[i][j];
-               bool remap_valid              = remap_button != RETROK_UNKNOWN;
-
-               if (remap_valid)
-               {
-                  unsigned current_button_value = BIT256_GET(current_input, j);
+               unsigned button               = port->from[j];
+               unsigned remap_button         = port->to[j];
+               unsigned current_button_value = BIT256_GET_PTR(current_input, button);
 #ifdef HAVE_OVERLAY
-                  if (poll_overlay && i == 0)
-                     current_button_value |= input_overlay_key_pressed(overlay_pointer, j);
+               if (poll_overlay && i == 0)
+                  current_button_value |= input_overlay_key_pressed(overlay_pointer, button);
 #endif
-                  if ((current_button_value == 1) && (j != remap_button))
-                  {
-                     MAPPER_SET_KEY (handle,
-                           remap_button);
-                     input_keyboard_event(true,
-                           remap_button,
-                           0, 0, RETRO_DEVICE_KEYBOARD);
-                     continue;
-                  }
-
-                  /* Release keyboard event*/
-                  input_keyboard_event(false,
+               if ((current_button_value == 1) && (button != remap_button))
+               {
+                  MAPPER_SET_KEY (handle,
+                        remap_button);
+                  input_keyboard_event(true,
                         remap_button,
                         0, 0, RETRO_DEVICE_KEYBOARD);
+                  continue;
                }
+
+               /* Release keyboard event*/
+               input_keyboard_event(false,
+                     remap_button,
+                     0, 0, RETRO_DEVICE_KEYBOARD);
             }
             break;
 
             /* gamepad remapping */
          case RETRO_DEVICE_JOYPAD:
          case RETRO_DEVICE_ANALOG:
-            /* this loop iterates on all users and all buttons,
-             * and checks if a pressed button is assigned to any
-             * other button than the default one, then it sets
-             * the bit on the mapper input bitmap, later on the
+            /* this loop iterates on the buttons and axes assigned
+             * to any other than the default one, and if pressed
+             * sets the bit on the mapper input bitmap, later on the
              * original input is cleared in input_state */
-            BIT256_CLEAR_ALL(handle->buttons[i]);
-
-            for (j = 0; j < 8; j++)
-               handle->analog_value[i][j] = 0;
-
-            for (j = 0; j < RARCH_FIRST_CUSTOM_BIND; j++)
+            for (j = 0; j < port->count; j++)
             {
-               bool remap_valid;
-               unsigned remap_button         =
-                  settings->uints.input_remap_ids[i][j];
-               unsigned current_button_value = BIT256_GET(current_input, j);
+               unsigned button = port->from[j];
+
+               if (button < RARCH_FIRST_CUSTOM_BIND)
+               {
+                  unsigned remap_button         = port->to[j];
+                  unsigned current_button_value = BIT256_GET_PTR(current_input, button);
 #ifdef HAVE_OVERLAY
-               if (poll_overlay && i == 0)
-                  current_button_value |= input_overlay_key_pressed(overlay_pointer, j);
+                  if (poll_overlay && i == 0)
+                     current_button_value |= input_overlay_key_pressed(overlay_pointer, button);
 #endif
-               remap_valid                   = (current_button_value == 1) &&
-                  (j != remap_button) && (remap_button != RARCH_UNMAPPED);
+                  if (current_button_value != 1)
+                     continue;
 
-               if (remap_valid)
-               {
                   if (remap_button < RARCH_FIRST_CUSTOM_BIND)
                   {
                      BIT256_SET(handle->buttons[i], remap_button);
                   }
-                  else if (remap_button >= RARCH_FIRST_CUSTOM_BIND)
+                  else
                   {
                      int invert = 1;
 
@@ -140,26 +208,20 @@ void input_mapper_poll(input_mapper_t *handle,
 
                      handle->analog_value[i][
                         remap_button - RARCH_FIRST_CUSTOM_BIND] =
-                           (current_input.analog_buttons[j] ? current_input.analog_buttons[j] : 32767) * invert;
+                           (current_input->analog_buttons[button] ? current_input->analog_buttons[button] : 32767) * invert;
                   }
                }
-            }
-
-            for (j = 0; j < 8; j++)
-            {
-               unsigned k                 = j + RARCH_FIRST_CUSTOM_BIND;
-               int16_t current_axis_value = current_input.analogs[j];
-               unsigned remap_axis        =
-                  settings->uints.input_remap_ids[i][k];
-
-               if (
-                     (abs(current_axis_value) > 0 &&
-                      (k != remap_axis)            &&
-                      (remap_axis != RARCH_UNMAPPED)
-                     ))
+               else
                {
+                  unsigned k                 = button;
+                  int16_t current_axis_value = current_input->analogs[k - RARCH_FIRST_CUSTOM_BIND];
+                  unsigned remap_axis        = port->to[j];
+
+                  if (!current_axis_value)
+                     continue;
+
                   if (remap_axis < RARCH_FIRST_CUSTOM_BIND &&
-                        abs(current_axis_value) > *input_driver_get_float(INPUT_ACTION_AXIS_THRESHOLD) * 32767)
+                        abs(current_axis_value) > axis_threshold)
                   {
                      BIT256_SET(handle->buttons[i], remap_axis);
                   }
@@ -181,7 +243,6 @@ void input_mapper_poll(input_mapper_t *handle,
                      }
                   }
                }
-
             }
             break;
          default:
@@ -32,6 +32,16 @@
 
 RETRO_BEGIN_DECLS
 
+/* The remaps of a port that do something, compiled from the
+ * settings so the mapper only has to look at those. */
+typedef struct input_mapper_port
+{
+   unsigned count;
+   /* Bind remapped, and the bind or key it is remapped to */
+   uint16_t from[RARCH_CUSTOM_BIND_LIST_END];
+   uint16_t to[RARCH_CUSTOM_BIND_LIST_END];
+} input_mapper_port_t;
+
 typedef struct input_mapper
 {
    /* Left X, Left Y, Right X, Right Y */
@@ -40,8 +50,23 @@ typedef struct input_mapper
    uint32_t keys[RETROK_LAST / 32 + 1];
    /* This is a bitmask of (1 << key_bind_id). */
    input_bits_t buttons[MAX_USERS];
+
+   input_mapper_port_t ports[MAX_USERS];
+   /* The settings ports[] were compiled from */
+   unsigned devices[MAX_USERS];
+   unsigned keymapper_ids[MAX_USERS][RARCH_CUSTOM_BIND_LIST_END];
+   unsigned remap_ids[MAX_USERS][RARCH_CUSTOM_BIND_LIST_END];
 } input_mapper_t;
 
+/* Compiles the remaps of the ports again if they changed in the
+ * settings. Ports left with no remaps don't need their input read
+ * for input_mapper_poll. */
+void input_mapper_update(input_mapper_t *handle,
+      void *settings_data,
+      unsigned max_users);
+
+#define input_mapper_port_remapped(handle, port) ((handle)->ports[(port)].count != 0)
+
 void input_mapper_poll(input_mapper_t *handle,
       void *overlay_pointer,
       void *settings_data,
@@ -89,6 +89,11 @@ enum overlay_image_transfer_status
    OVERLAY_IMAGE_TRANSFER_ERROR
 };
 
+/* Cells per side of the grid descs are looked up in */
+#define OVERLAY_GRID_SIZE 8
+
+#define OVERLAY_GRID_CELL(v) ((v) <= 0.0f ? 0 : (v) >= 1.0f ? OVERLAY_GRID_SIZE - 1 : (unsigned)((v) * OVERLAY_GRID_SIZE))
+
 enum overlay_visibility
 {
    OVERLAY_VISIBILITY_DEFAULT = 0,
@@ -123,6 +128,12 @@ struct overlay
    struct overlay_desc *descs;
    struct texture_image *load_images;
 
+   /* Indices of the descs that can be hit in each cell of a grid
+    * over the overlay, in desc order. Cell c holds the ones from
+    * grid_offsets[c] to grid_offsets[c + 1]. */
+   unsigned *grid;
+   unsigned grid_offsets[OVERLAY_GRID_SIZE * OVERLAY_GRID_SIZE + 1];
+
    struct texture_image image;
 
    char name[64];
@@ -167,6 +178,8 @@ struct overlay_desc
 
    bool updated;
    bool movable;
+   /* Drawn away from its place at the last vertex_geom */
+   bool moved;
 
    unsigned next_index;
    unsigned image_index;
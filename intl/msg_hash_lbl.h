@@ -1248,6 +1248,8 @@ MSG_HASH(MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS,
       "run_ahead_hide_warnings")
 MSG_HASH(MENU_ENUM_LABEL_RUN_AHEAD_FRAMES,
       "run_ahead_frames")
+MSG_HASH(MENU_ENUM_LABEL_RUN_AHEAD_BENCHMARK,
+      "run_ahead_benchmark")
 MSG_HASH(MENU_ENUM_LABEL_SORT_SAVEFILES_ENABLE,
       "sort_savefiles_enable")
 MSG_HASH(MENU_ENUM_LABEL_SORT_SAVESTATES_ENABLE,
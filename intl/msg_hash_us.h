@@ -3059,6 +3059,10 @@ MSG_HASH(
     MENU_ENUM_LABEL_VALUE_RUN_AHEAD_FRAMES,
     "Number of Frames to Run Ahead"
     )
+MSG_HASH(
+    MENU_ENUM_LABEL_VALUE_RUN_AHEAD_BENCHMARK,
+    "RunAhead Benchmark"
+    )
 MSG_HASH(
     MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_INSTANCE,
     "RunAhead Use Second Instance"
@@ -6136,6 +6140,10 @@ MSG_HASH(
     MENU_ENUM_SUBLABEL_RUN_AHEAD_FRAMES,
     "The number of frames to run ahead. Causes gameplay issues such as jitter if you exceed the number of lag frames internal to the game."
     )
+MSG_HASH(
+    MENU_ENUM_SUBLABEL_RUN_AHEAD_BENCHMARK,
+    "Measures how long the core takes to run a frame and to save and load a state, and shows how many frames it can run ahead at full speed. Runs when the content is resumed."
+    )
 MSG_HASH(
     MENU_ENUM_SUBLABEL_INPUT_BLOCK_TIMEOUT,
     "The number of milliseconds to wait to get a complete input sample, use it if you have issues with simultaneous button presses (Android only)."
@@ -7590,6 +7598,10 @@ MSG_HASH(
     MSG_RUNAHEAD_FAILED_TO_CREATE_SECONDARY_INSTANCE,
     "Failed to create second instance.  RunAhead will now use only one instance."
     )
+MSG_HASH(
+    MSG_RUNAHEAD_BENCHMARK_RESULT,
+    "RunAhead can run up to %d frames ahead (%d reusing frames, %d with a second instance)."
+    )
 MSG_HASH(
     MSG_SCANNING_OF_FILE_FINISHED,
     "Scanning of file finished"
@@ -0,0 +1,399 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(HAVE_THREADS) && defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#define HAVE_LATENCY_TEST_SENSOR
+#endif
+
+#include "latency_test.h"
+#include "performance_counters.h"
+#include "verbosity.h"
+
+/* Gives up on the photon of a press after this long, in usec */
+#define LATENCY_TEST_PHOTON_TIMEOUT 1000000
+
+enum latency_test_stage
+{
+   LATENCY_TEST_IDLE = 0,
+   LATENCY_TEST_PRESSED,
+   LATENCY_TEST_POLLED,
+   LATENCY_TEST_RUN,
+   LATENCY_TEST_FLASHED,
+   LATENCY_TEST_RENDERED,
+   LATENCY_TEST_PRESENTED
+};
+
+typedef struct latency_test
+{
+   enum latency_test_stage stage;
+   bool active;
+
+   retro_time_t pressed;
+   retro_time_t polled;
+   retro_time_t run;
+   retro_time_t rendered;
+   retro_time_t presented;
+
+   void *flash;
+   size_t flash_size;
+
+   rarch_histogram_t hist_present;
+   rarch_histogram_t hist_photon;
+
+#ifdef HAVE_THREADS
+   /* Presentation and the sensor can be on threads of their own */
+   slock_t *lock;
+#endif
+#ifdef HAVE_LATENCY_TEST_SENSOR
+   sthread_t *sensor_thread;
+   int sensor_fd;
+   bool sensor_quit;
+#endif
+} latency_test_t;
+
+static latency_test_t latency_test;
+
+#ifdef HAVE_THREADS
+#define latency_test_lock()   slock_lock(latency_test.lock)
+#define latency_test_unlock() slock_unlock(latency_test.lock)
+#else
+#define latency_test_lock()
+#define latency_test_unlock()
+#endif
+
+#define LATENCY_TEST_SINCE(t) ((t) ? (unsigned)((t) - latency_test.pressed) : 0)
+
+static bool latency_test_has_sensor(void)
+{
+#ifdef HAVE_LATENCY_TEST_SENSOR
+   return latency_test.sensor_thread != NULL;
+#else
+   return false;
+#endif
+}
+
+/* Logs the press followed and gets ready for the next one.
+ * Must be called with the lock held. */
+static void latency_test_report(retro_time_t photon)
+{
+   RARCH_LOG("[Latency]: Press to poll %u, run %u, render %u, present %u, photon %u usec.\n",
+         LATENCY_TEST_SINCE(latency_test.polled),
+         LATENCY_TEST_SINCE(latency_test.run),
+         LATENCY_TEST_SINCE(latency_test.rendered),
+         LATENCY_TEST_SINCE(latency_test.presented),
+         LATENCY_TEST_SINCE(photon));
+
+   if (latency_test.presented)
+      rarch_histogram_add(&latency_test.hist_present,
+            latency_test.presented - latency_test.pressed);
+   if (photon)
+      rarch_histogram_add(&latency_test.hist_photon,
+            photon - latency_test.pressed);
+
+   latency_test.stage = LATENCY_TEST_IDLE;
+}
+
+#ifdef HAVE_LATENCY_TEST_SENSOR
+static void latency_test_sensor_thread(void *data)
+{
+   struct pollfd pfd;
+
+   pfd.fd     = latency_test.sensor_fd;
+   pfd.events = POLLPRI | POLLERR;
+
+   for (;;)
+   {
+      char value         = '0';
+      retro_time_t now;
+      int ret            = poll(&pfd, 1, 100);
+
+      now                = cpu_features_get_time_usec();
+
+      latency_test_lock();
+      if (latency_test.sensor_quit)
+      {
+         latency_test_unlock();
+         break;
+      }
+      latency_test_unlock();
+
+      if (ret <= 0)
+         continue;
+
+      /* sysfs wants the value read again from the start */
+      if (lseek(pfd.fd, 0, SEEK_SET) < 0 || read(pfd.fd, &value, 1) != 1
+            || value != '1')
+         continue;
+
+      latency_test_lock();
+      if (latency_test.stage == LATENCY_TEST_PRESENTED)
+         latency_test_report(now);
+      latency_test_unlock();
+   }
+}
+
+static bool latency_test_sensor_init(const char *path)
+{
+   char edge[PATH_MAX_LENGTH];
+   char value;
+   int fd;
+
+   /* Best effort, the edge may already be set or not be writable */
+   fill_pathname_basedir(edge, path, sizeof(edge));
+   strlcat(edge, "edge", sizeof(edge));
+   fd = open(edge, O_WRONLY);
+   if (fd >= 0)
+   {
+      if (write(fd, "rising", 6) != 6)
+         RARCH_WARN("[Latency]: Failed to set the edge of \"%s\".\n", path);
+      close(fd);
+   }
+
+   latency_test.sensor_fd = open(path, O_RDONLY);
+   if (latency_test.sensor_fd < 0)
+      return false;
+
+   /* Reading it once clears what poll would report right away */
+   if (read(latency_test.sensor_fd, &value, 1) < 0)
+      RARCH_WARN("[Latency]: Failed to read \"%s\".\n", path);
+
+   latency_test.sensor_quit   = false;
+   latency_test.sensor_thread = sthread_create(
+         latency_test_sensor_thread, NULL);
+
+   return latency_test.sensor_thread != NULL;
+}
+
+static void latency_test_sensor_deinit(void)
+{
+   if (latency_test.sensor_thread)
+   {
+      latency_test_lock();
+      latency_test.sensor_quit = true;
+      latency_test_unlock();
+
+      sthread_join(latency_test.sensor_thread);
+      latency_test.sensor_thread = NULL;
+   }
+
+   if (latency_test.sensor_fd >= 0)
+      close(latency_test.sensor_fd);
+   latency_test.sensor_fd = -1;
+}
+#endif
+
+/**
+ * latency_test_init:
+ * @sensor_path          : sysfs value of the light sensor GPIO, or NULL.
+ *
+ * Starts following button presses.
+ *
+ * Returns: true if the test could be started.
+ **/
+bool latency_test_init(const char *sensor_path)
+{
+   latency_test_deinit();
+
+#ifdef HAVE_THREADS
+   latency_test.lock = slock_new();
+   if (!latency_test.lock)
+      return false;
+#endif
+
+   rarch_histogram_register(&latency_test.hist_present,
+         "Latency: press to present");
+
+#ifdef HAVE_LATENCY_TEST_SENSOR
+   latency_test.sensor_fd = -1;
+   if (!string_is_empty(sensor_path))
+   {
+      if (latency_test_sensor_init(sensor_path))
+         rarch_histogram_register(&latency_test.hist_photon,
+               "Latency: press to photon");
+      else
+      {
+         RARCH_WARN("[Latency]: Failed to watch the sensor at \"%s\".\n",
+               sensor_path);
+         latency_test_sensor_deinit();
+      }
+   }
+#endif
+
+   latency_test.stage  = LATENCY_TEST_IDLE;
+   latency_test.active = true;
+
+   RARCH_LOG("[Latency]: Following button presses%s.\n",
+         latency_test_has_sensor() ? ", with a light sensor" : "");
+   return true;
+}
+
+void latency_test_deinit(void)
+{
+   if (!latency_test.active)
+      return;
+
+   latency_test.active = false;
+
+#ifdef HAVE_LATENCY_TEST_SENSOR
+   latency_test_sensor_deinit();
+#endif
+
+#ifdef HAVE_THREADS
+   if (latency_test.lock)
+      slock_free(latency_test.lock);
+   latency_test.lock = NULL;
+#endif
+
+   free(latency_test.flash);
+   latency_test.flash      = NULL;
+   latency_test.flash_size = 0;
+}
+
+void latency_test_input_event(retro_time_t time)
+{
+   if (!latency_test.active)
+      return;
+
+   latency_test_lock();
+   if (latency_test.stage == LATENCY_TEST_IDLE)
+   {
+      latency_test.stage     = LATENCY_TEST_PRESSED;
+      latency_test.pressed   = time;
+      latency_test.polled    = 0;
+      latency_test.run       = 0;
+      latency_test.rendered  = 0;
+      latency_test.presented = 0;
+   }
+   latency_test_unlock();
+}
+
+void latency_test_poll(void)
+{
+   retro_time_t now;
+
+   if (!latency_test.active)
+      return;
+
+   now = cpu_features_get_time_usec();
+
+   latency_test_lock();
+   if (latency_test.stage == LATENCY_TEST_PRESSED)
+   {
+      latency_test.stage  = LATENCY_TEST_POLLED;
+      latency_test.polled = now;
+   }
+   else if (latency_test.stage == LATENCY_TEST_PRESENTED
+         && now - latency_test.presented > LATENCY_TEST_PHOTON_TIMEOUT)
+      latency_test_report(0);
+   latency_test_unlock();
+}
+
+void latency_test_core_run(void)
+{
+   if (!latency_test.active)
+      return;
+
+   latency_test_lock();
+   if (latency_test.stage == LATENCY_TEST_POLLED)
+   {
+      latency_test.stage = LATENCY_TEST_RUN;
+      latency_test.run   = cpu_features_get_time_usec();
+   }
+   latency_test_unlock();
+}
+
+const void *latency_test_flash_frame(unsigned width, unsigned height,
+      size_t *pitch, unsigned bytes_per_pixel)
+{
+   size_t size;
+   bool flash = false;
+
+   if (!latency_test.active)
+      return NULL;
+
+   latency_test_lock();
+   if (latency_test.stage == LATENCY_TEST_RUN)
+   {
+      latency_test.stage = LATENCY_TEST_FLASHED;
+      flash              = true;
+   }
+   latency_test_unlock();
+
+   if (!flash)
+      return NULL;
+
+   /* All ones is white in every pixel format */
+   size = (size_t)width * bytes_per_pixel * height;
+   if (size > latency_test.flash_size)
+   {
+      void *buf = realloc(latency_test.flash, size);
+      if (!buf)
+         return NULL;
+      memset(buf, 0xff, size);
+      latency_test.flash      = buf;
+      latency_test.flash_size = size;
+   }
+
+   *pitch = (size_t)width * bytes_per_pixel;
+   return latency_test.flash;
+}
+
+void latency_test_rendered(void)
+{
+   if (!latency_test.active)
+      return;
+
+   latency_test_lock();
+   if (latency_test.stage == LATENCY_TEST_FLASHED)
+   {
+      latency_test.stage    = LATENCY_TEST_RENDERED;
+      latency_test.rendered = cpu_features_get_time_usec();
+   }
+   latency_test_unlock();
+}
+
+/* With a present thread, this is the first frame presented after
+ * the flashed one was rendered, which is the flashed one itself
+ * since they are presented in order. */
+void latency_test_presented(void)
+{
+   if (!latency_test.active)
+      return;
+
+   latency_test_lock();
+   if (latency_test.stage == LATENCY_TEST_RENDERED)
+   {
+      latency_test.stage     = LATENCY_TEST_PRESENTED;
+      latency_test.presented = cpu_features_get_time_usec();
+
+      if (!latency_test_has_sensor())
+         latency_test_report(0);
+   }
+   latency_test_unlock();
+}
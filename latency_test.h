@@ -0,0 +1,65 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LATENCY_TEST_H
+#define __LATENCY_TEST_H
+
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Input-to-photon latency test. A button press is followed through
+ * polling, the core run, rendering and presentation, and the frame
+ * it first shows up in is flashed white. Each press is logged with
+ * the time every stage was reached after the press, and the times to
+ * presentation and photon are kept as histograms.
+ *
+ * Photon times need a light sensor on a GPIO, given as the sysfs
+ * path of its value, whose edge is set to rising. Only one press is
+ * followed at a time, the ones in between are ignored.
+ *
+ * All times are cpu_features_get_time_usec() times. Everything is
+ * a no-op unless the test was started. */
+
+bool latency_test_init(const char *sensor_path);
+
+void latency_test_deinit(void);
+
+/* A button was pressed at the given time, e.g. its evdev timestamp */
+void latency_test_input_event(retro_time_t time);
+
+/* Input was polled. */
+void latency_test_poll(void);
+
+/* The core finished running a frame. */
+void latency_test_core_run(void);
+
+/* Returns the white frame to show instead of the core's one if this
+ * frame is where the press first shows up, else NULL. */
+const void *latency_test_flash_frame(unsigned width, unsigned height,
+      size_t *pitch, unsigned bytes_per_pixel);
+
+/* The video driver is done with a frame. */
+void latency_test_rendered(void);
+
+/* A frame was handed to the display. */
+void latency_test_presented(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -26,6 +26,9 @@
 #include <formats/rwav.h>
 #include <memalign.h>
 
+#include <retro_inline.h>
+#include <retro_math.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,6 +38,28 @@
 #include "../../config.h"
 #endif
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Streamed formats are decoded ahead of time on a thread pool,
+ * so that audio_mixer_mix only has to copy samples out of each
+ * voice's ring, and has the pool top the ring up again after.
+ * Without it they are decoded on demand. */
+#if defined(HAVE_THREADS) && defined(__GNUC__)
+#define AUDIO_MIXER_DECODE_THREAD
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#define AUDIO_MIXER_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define AUDIO_MIXER_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#define AUDIO_MIXER_ATOMIC_XCHG(ptr, val)  __atomic_exchange_n(ptr, val, __ATOMIC_ACQ_REL)
+#else
+#define AUDIO_MIXER_ATOMIC_LOAD(ptr)       (*(ptr))
+#define AUDIO_MIXER_ATOMIC_STORE(ptr, val) (*(ptr) = (val))
+#endif
+
 #ifdef HAVE_STB_VORBIS
 #define STB_VORBIS_NO_PUSHDATA_API
 #define STB_VORBIS_NO_STDIO
@@ -131,8 +156,6 @@ struct audio_mixer_voice
 #ifdef HAVE_STB_VORBIS
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -145,8 +168,6 @@ struct audio_mixer_voice
 #ifdef HAVE_DR_FLAC
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -159,8 +180,6 @@ struct audio_mixer_voice
 #ifdef HAVE_DR_MP3
       struct
       {
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float*      buffer;
          float       ratio;
@@ -173,20 +192,118 @@ struct audio_mixer_voice
 #ifdef HAVE_IBXM
       struct
       {
-         unsigned          position;
-         unsigned          samples;
          unsigned          buf_samples;
          int*              buffer;
+         float*            fbuffer;
          struct replay*    stream;
          struct module*    module;
       } mod;
 #endif
    } types;
+
+   /* Decoded samples of streamed formats. The decoder only
+    * advances write, repeats and eof, the mixer only read. */
+   struct
+   {
+      float    *ring;
+      size_t   mask;
+      size_t   read;
+      size_t   write;
+      unsigned chunk;
+      unsigned repeats;
+      unsigned repeats_seen;
+      bool     eof;
+   } stream;
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   /* Held while the decoder works on the voice. */
+   slock_t *lock;
+   /* Set while a decode of the voice is on the pool */
+   unsigned decode_queued;
+#endif
 };
 
 static struct audio_mixer_voice s_voices[AUDIO_MIXER_MAX_VOICES] = {{0}};
 static unsigned s_rate = 0;
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+static tpool_t *s_decode_pool = NULL;
+
+static void audio_mixer_decode_queue(audio_mixer_voice_t* voice);
+
+#define audio_mixer_voice_lock(voice)   slock_lock((voice)->lock)
+#define audio_mixer_voice_unlock(voice) slock_unlock((voice)->lock)
+#else
+#define audio_mixer_voice_lock(voice)
+#define audio_mixer_voice_unlock(voice)
+#endif
+
+static bool audio_mixer_stream_fill(audio_mixer_voice_t* voice);
+static bool audio_mixer_stream_reset(audio_mixer_voice_t* voice);
+
+/* buffer[i] += src[i] * volume */
+static void audio_mixer_mac(float *buffer, const float *src,
+      size_t samples, float volume)
+{
+   size_t i = 0;
+
+#if defined(__SSE__)
+   __m128 vol = _mm_set1_ps(volume);
+
+   for (; i + 8 <= samples; i += 8)
+   {
+      __m128 a = _mm_add_ps(_mm_loadu_ps(buffer + i),
+            _mm_mul_ps(_mm_loadu_ps(src + i), vol));
+      __m128 b = _mm_add_ps(_mm_loadu_ps(buffer + i + 4),
+            _mm_mul_ps(_mm_loadu_ps(src + i + 4), vol));
+      _mm_storeu_ps(buffer + i,     a);
+      _mm_storeu_ps(buffer + i + 4, b);
+   }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   for (; i + 8 <= samples; i += 8)
+   {
+      float32x4_t a = vmlaq_n_f32(vld1q_f32(buffer + i),
+            vld1q_f32(src + i), volume);
+      float32x4_t b = vmlaq_n_f32(vld1q_f32(buffer + i + 4),
+            vld1q_f32(src + i + 4), volume);
+      vst1q_f32(buffer + i,     a);
+      vst1q_f32(buffer + i + 4, b);
+   }
+#endif
+
+   for (; i < samples; i++)
+      buffer[i] += src[i] * volume;
+}
+
+static void audio_mixer_clamp(float *buffer, size_t samples)
+{
+   size_t i = 0;
+
+#if defined(__SSE__)
+   __m128 lo = _mm_set1_ps(-1.0f);
+   __m128 hi = _mm_set1_ps(1.0f);
+
+   for (; i + 4 <= samples; i += 4)
+      _mm_storeu_ps(buffer + i,
+            _mm_min_ps(_mm_max_ps(_mm_loadu_ps(buffer + i), lo), hi));
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   float32x4_t lo = vdupq_n_f32(-1.0f);
+   float32x4_t hi = vdupq_n_f32(1.0f);
+
+   for (; i + 4 <= samples; i += 4)
+      vst1q_f32(buffer + i,
+            vminq_f32(vmaxq_f32(vld1q_f32(buffer + i), lo), hi));
+#endif
+
+   for (; i < samples; i++)
+   {
+      if (buffer[i] < -1.0f)
+         buffer[i] = -1.0f;
+      else if (buffer[i] > 1.0f)
+         buffer[i] = 1.0f;
+   }
+}
+
 static bool wav2float(const rwav_t* wav, float** pcm, size_t samples_out)
 {
    size_t i;
@@ -308,14 +425,43 @@ void audio_mixer_init(unsigned rate)
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   if (s_decode_pool)
+      return;
+
+   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
+      if (!s_voices[i].lock)
+         s_voices[i].lock = slock_new();
+      if (!s_voices[i].lock)
+         return;
+      s_voices[i].decode_queued = 0;
+   }
+
+   /* Without a pool, streams are decoded on demand. */
+   s_decode_pool = tpool_create_with_role(1, STHREAD_ROLE_AUDIO);
+#endif
 }
 
 void audio_mixer_done(void)
 {
    unsigned i;
 
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   /* Waits for a decode in progress */
+   tpool_destroy(s_decode_pool);
+   s_decode_pool = NULL;
+#endif
+
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+
+      if (s_voices[i].stream.ring)
+         memalign_free(s_voices[i].stream.ring);
+      s_voices[i].stream.ring = NULL;
+   }
 }
 
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size)
@@ -551,9 +697,8 @@ static bool audio_mixer_play_ogg(
    voice->types.ogg.buffer         = (float*)ogg_buffer;
    voice->types.ogg.buf_samples    = samples;
    voice->types.ogg.ratio          = ratio;
+   voice->stream.chunk             = samples;
    voice->types.ogg.stream         = stb_vorbis;
-   voice->types.ogg.position       = 0;
-   voice->types.ogg.samples        = 0;
 
    return true;
 
@@ -575,6 +720,7 @@ static bool audio_mixer_play_mod(
    int buf_samples               = 0;
    int samples                   = 0;
    void *mod_buffer              = NULL;
+   void *mod_fbuffer             = NULL;
    struct module* module         = NULL;
    struct replay* replay         = NULL;
 
@@ -603,8 +749,9 @@ static bool audio_mixer_play_mod(
 
    buf_samples = calculate_mix_buf_len(s_rate);
    mod_buffer  = memalign_alloc(16, ((buf_samples + 15) & ~15) * sizeof(int));
+   mod_fbuffer = memalign_alloc(16, ((buf_samples + 15) & ~15) * sizeof(float));
 
-   if (!mod_buffer)
+   if (!mod_buffer || !mod_fbuffer)
    {
       printf("audio_mixer_play_mod cannot allocate mod_buffer !\n");
       goto error;
@@ -623,18 +770,22 @@ static bool audio_mixer_play_mod(
       dispose_replay(voice->types.mod.stream);
    if (voice->types.mod.buffer)
       memalign_free(voice->types.mod.buffer);
+   if (voice->types.mod.fbuffer)
+      memalign_free(voice->types.mod.fbuffer);
 
    voice->types.mod.buffer         = (int*)mod_buffer;
+   voice->types.mod.fbuffer        = (float*)mod_fbuffer;
+   voice->stream.chunk             = buf_samples;
    voice->types.mod.buf_samples    = buf_samples;
    voice->types.mod.stream         = replay;
-   voice->types.mod.position       = 0;
-   voice->types.mod.samples        = 0; /* samples; */
 
    return true;
 
 error:
    if (mod_buffer)
       memalign_free(mod_buffer);
+   if (mod_fbuffer)
+      memalign_free(mod_fbuffer);
    if (module)
       dispose_module(module);
    return false;
@@ -691,9 +842,8 @@ static bool audio_mixer_play_flac(
    voice->types.flac.buffer         = (float*)flac_buffer;
    voice->types.flac.buf_samples    = samples;
    voice->types.flac.ratio          = ratio;
+   voice->stream.chunk             = samples;
    voice->types.flac.stream         = dr_flac;
-   voice->types.flac.position       = 0;
-   voice->types.flac.samples        = 0;
 
    return true;
 
@@ -760,8 +910,7 @@ static bool audio_mixer_play_mp3(
    voice->types.mp3.buffer         = (float*)mp3_buffer;
    voice->types.mp3.buf_samples    = samples;
    voice->types.mp3.ratio          = ratio;
-   voice->types.mp3.position       = 0;
-   voice->types.mp3.samples        = 0;
+   voice->stream.chunk             = samples;
 
    return true;
 
@@ -786,6 +935,8 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       if (voice->type != AUDIO_MIXER_TYPE_NONE)
          continue;
 
+      audio_mixer_voice_lock(voice);
+
       switch (sound->type)
       {
          case AUDIO_MIXER_TYPE_WAV:
@@ -815,19 +966,33 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
             break;
       }
 
+      if (res && sound->type != AUDIO_MIXER_TYPE_WAV)
+         res = audio_mixer_stream_reset(voice);
+
+      if (res)
+      {
+         voice->type     = sound->type;
+         voice->repeat   = repeat;
+         voice->volume   = volume;
+         voice->sound    = sound;
+         voice->stop_cb  = stop_cb;
+
+         /* Have the start of the stream ready for the next mix. */
+         if (sound->type != AUDIO_MIXER_TYPE_WAV)
+            audio_mixer_stream_fill(voice);
+      }
+
+      audio_mixer_voice_unlock(voice);
       break;
    }
 
-   if (res)
-   {
-      voice->type     = sound->type;
-      voice->repeat   = repeat;
-      voice->volume   = volume;
-      voice->sound    = sound;
-      voice->stop_cb  = stop_cb;
-   }
-   else
-      voice = NULL;
+   if (!res)
+      return NULL;
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   if (sound->type != AUDIO_MIXER_TYPE_WAV)
+      audio_mixer_decode_queue(voice);
+#endif
 
    return voice;
 }
@@ -842,7 +1007,9 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       stop_cb = voice->stop_cb;
       sound   = voice->sound;
 
+      audio_mixer_voice_lock(voice);
       voice->type = AUDIO_MIXER_TYPE_NONE;
+      audio_mixer_voice_unlock(voice);
 
       if (stop_cb)
          stop_cb(sound, AUDIO_MIXER_SOUND_STOPPED);
@@ -853,7 +1020,6 @@ static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
    unsigned buf_free                = (unsigned)(num_frames * 2);
    const audio_mixer_sound_t* sound = voice->sound;
    unsigned pcm_available           = sound->types.wav.frames
@@ -864,8 +1030,8 @@ static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
 again:
    if (pcm_available < buf_free)
    {
-      for (i = pcm_available; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      audio_mixer_mac(buffer, pcm, pcm_available, volume);
+      buffer += pcm_available;
 
       if (voice->repeat)
       {
@@ -886,317 +1052,393 @@ again:
    }
    else
    {
-      for (i = buf_free; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      audio_mixer_mac(buffer, pcm, buf_free, volume);
 
       voice->types.wav.position += buf_free;
    }
 }
 
+/* The decoders below produce the next chunk of a stream into the
+ * voice's staging buffer, starting over when a repeating stream
+ * ends. They return a sample count of 0 at the end of the stream. */
+
 #ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
+static unsigned audio_mixer_decode_ogg(audio_mixer_voice_t* voice,
+      const float **pcm)
 {
-   int i;
    struct resampler_data info = { 0 };
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
    unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
+   bool rewound                     = false;
 
-   if (voice->types.ogg.position == voice->types.ogg.samples)
-   {
 again:
-      temp_samples = stb_vorbis_get_samples_float_interleaved(
-            voice->types.ogg.stream, 2, temp_buffer,
-            AUDIO_MIXER_TEMP_BUFFER) * 2;
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   temp_samples = stb_vorbis_get_samples_float_interleaved(
+         voice->types.ogg.stream, 2, temp_buffer,
+         AUDIO_MIXER_TEMP_BUFFER) * 2;
 
-            stb_vorbis_seek_start(voice->types.ogg.stream);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
-      }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.ogg.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.ogg.ratio;
-
-      if (voice->types.ogg.resampler)
-      {
-        voice->types.ogg.resampler->process(voice->types.ogg.resampler_data, &info);
-      }
-      else
-        memcpy(voice->types.ogg.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
+   if (temp_samples == 0)
+   {
+      /* A stream that is still empty after rewinding can't repeat. */
+      if (!voice->repeat || rewound)
+         return 0;
+
+      rewound = true;
+      AUDIO_MIXER_ATOMIC_STORE(&voice->stream.repeats,
+            voice->stream.repeats + 1);
+      stb_vorbis_seek_start(voice->types.ogg.stream);
+      goto again;
    }
 
-   pcm = voice->types.ogg.buffer + voice->types.ogg.position;
+   *pcm = voice->types.ogg.buffer;
 
-   if (voice->types.ogg.samples < buf_free)
+   if (!voice->types.ogg.resampler)
    {
-      for (i = voice->types.ogg.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.ogg.samples;
-      goto again;
+      memcpy(voice->types.ogg.buffer, temp_buffer, temp_samples * sizeof(float));
+      return temp_samples;
    }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
 
-      voice->types.ogg.position += buf_free;
-      voice->types.ogg.samples  -= buf_free;
-   }
+   info.data_in              = temp_buffer;
+   info.data_out             = voice->types.ogg.buffer;
+   info.input_frames         = temp_samples / 2;
+   info.output_frames        = 0;
+   info.ratio                = voice->types.ogg.ratio;
+
+   voice->types.ogg.resampler->process(voice->types.ogg.resampler_data, &info);
+
+   return MIN((unsigned)info.output_frames * 2, voice->types.ogg.buf_samples);
 }
 #endif
 
 #ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
+static unsigned audio_mixer_decode_mod(audio_mixer_voice_t* voice,
+      const float **pcm)
 {
-   int i;
-   float samplef                    = 0.0f;
-   int samplei                      = 0;
+   unsigned i;
    unsigned temp_samples            = 0;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   int* pcm                         = NULL;
+   bool rewound                     = false;
 
-   if (voice->types.mod.position == voice->types.mod.samples)
-   {
 again:
-      temp_samples = replay_get_audio(
-            voice->types.mod.stream, voice->types.mod.buffer );
+   temp_samples = replay_get_audio(
+         voice->types.mod.stream, voice->types.mod.buffer );
 
-      temp_samples *= 2; /* stereo */
+   temp_samples *= 2; /* stereo */
 
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   if (temp_samples == 0)
+   {
+      /* A stream that is still empty after rewinding can't repeat. */
+      if (!voice->repeat || rewound)
+         return 0;
+
+      rewound = true;
+      AUDIO_MIXER_ATOMIC_STORE(&voice->stream.repeats,
+            voice->stream.repeats + 1);
+      replay_seek( voice->types.mod.stream, 0);
+      goto again;
+   }
 
-            replay_seek( voice->types.mod.stream, 0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+   for (i = 0; i < temp_samples; i++)
+   {
+      float samplef = (float)(voice->types.mod.buffer[i] + 32768) / 65535.0f;
+      voice->types.mod.fbuffer[i] = samplef * 2.0f - 1.0f;
+   }
 
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
-      }
+   *pcm = voice->types.mod.fbuffer;
+   return temp_samples;
+}
+#endif
 
-      voice->types.mod.position = 0;
-      voice->types.mod.samples  = temp_samples;
-   }
-   pcm = voice->types.mod.buffer + voice->types.mod.position;
+#ifdef HAVE_DR_FLAC
+static unsigned audio_mixer_decode_flac(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   struct resampler_data info = { 0 };
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
+   unsigned temp_samples            = 0;
+   bool rewound                     = false;
 
-   if (voice->types.mod.samples < buf_free)
-   {
-      for (i = voice->types.mod.samples; i != 0; i--)
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
-      }
+again:
+   temp_samples = (unsigned)drflac_read_f32( voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
 
-      buf_free -= voice->types.mod.samples;
+   if (temp_samples == 0)
+   {
+      /* A stream that is still empty after rewinding can't repeat. */
+      if (!voice->repeat || rewound)
+         return 0;
+
+      rewound = true;
+      AUDIO_MIXER_ATOMIC_STORE(&voice->stream.repeats,
+            voice->stream.repeats + 1);
+      drflac_seek_to_sample(voice->types.flac.stream,0);
       goto again;
    }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
-      }
 
-      voice->types.mod.position += buf_free;
-      voice->types.mod.samples  -= buf_free;
+   *pcm = voice->types.flac.buffer;
+
+   if (!voice->types.flac.resampler)
+   {
+      memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
+      return temp_samples;
    }
+
+   info.data_in              = temp_buffer;
+   info.data_out             = voice->types.flac.buffer;
+   info.input_frames         = temp_samples / 2;
+   info.output_frames        = 0;
+   info.ratio                = voice->types.flac.ratio;
+
+   voice->types.flac.resampler->process(voice->types.flac.resampler_data, &info);
+
+   return MIN((unsigned)info.output_frames * 2, voice->types.flac.buf_samples);
 }
 #endif
 
-#ifdef HAVE_DR_FLAC
-static void audio_mixer_mix_flac(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
+#ifdef HAVE_DR_MP3
+static unsigned audio_mixer_decode_mp3(audio_mixer_voice_t* voice,
+      const float **pcm)
 {
-   int i;
    struct resampler_data info = { 0 };
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
+   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER];
    unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
+   bool rewound                     = false;
 
-   if (voice->types.flac.position == voice->types.flac.samples)
-   {
 again:
-      temp_samples = (unsigned)drflac_read_f32( voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+   temp_samples = (unsigned)drmp3_read_f32(&voice->types.mp3.stream, AUDIO_MIXER_TEMP_BUFFER/2, temp_buffer) * 2;
 
-            drflac_seek_to_sample(voice->types.flac.stream,0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
-            return;
-         }
-      }
+   if (temp_samples == 0)
+   {
+      /* A stream that is still empty after rewinding can't repeat. */
+      if (!voice->repeat || rewound)
+         return 0;
+
+      rewound = true;
+      AUDIO_MIXER_ATOMIC_STORE(&voice->stream.repeats,
+            voice->stream.repeats + 1);
+      drmp3_seek_to_frame(&voice->types.mp3.stream,0);
+      goto again;
+   }
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.flac.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.flac.ratio;
+   *pcm = voice->types.mp3.buffer;
 
-      if (voice->types.flac.resampler)
-      {
-        voice->types.flac.resampler->process(voice->types.flac.resampler_data, &info);
-      }
-      else
-        memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.flac.position = 0;
-      voice->types.flac.samples  = voice->types.flac.buf_samples;
+   if (!voice->types.mp3.resampler)
+   {
+      memcpy(voice->types.mp3.buffer, temp_buffer, temp_samples * sizeof(float));
+      return temp_samples;
    }
 
-   pcm = voice->types.flac.buffer + voice->types.flac.position;
+   info.data_in              = temp_buffer;
+   info.data_out             = voice->types.mp3.buffer;
+   info.input_frames         = temp_samples / 2;
+   info.output_frames        = 0;
+   info.ratio                = voice->types.mp3.ratio;
 
-   if (voice->types.flac.samples < buf_free)
+   voice->types.mp3.resampler->process(voice->types.mp3.resampler_data, &info);
+
+   return MIN((unsigned)info.output_frames * 2, voice->types.mp3.buf_samples);
+}
+#endif
+
+static unsigned audio_mixer_decode(audio_mixer_voice_t* voice,
+      const float **pcm)
+{
+   switch (voice->type)
    {
-      for (i = voice->types.flac.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         return audio_mixer_decode_ogg(voice, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         return audio_mixer_decode_mod(voice, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         return audio_mixer_decode_flac(voice, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         return audio_mixer_decode_mp3(voice, pcm);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_WAV:
+      case AUDIO_MIXER_TYPE_NONE:
+         break;
+   }
 
-      buf_free -= voice->types.flac.samples;
-      goto again;
+   return 0;
+}
+
+/* Decodes one chunk into the ring of the voice if there is room
+ * for it. Returns false if nothing was added. */
+static bool audio_mixer_stream_fill(audio_mixer_voice_t* voice)
+{
+   size_t pos, first;
+   unsigned samples;
+   const float *pcm = NULL;
+   size_t used      = voice->stream.write -
+      AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.read);
+
+   if (     voice->stream.eof
+         || used + voice->stream.chunk > voice->stream.mask + 1)
+      return false;
+
+   samples = audio_mixer_decode(voice, &pcm);
+
+   if (!samples)
+   {
+      AUDIO_MIXER_ATOMIC_STORE(&voice->stream.eof, true);
+      return false;
    }
-   else
+
+   pos   = voice->stream.write & voice->stream.mask;
+   first = MIN(samples, voice->stream.mask + 1 - pos);
+
+   memcpy(voice->stream.ring + pos, pcm, first * sizeof(float));
+   memcpy(voice->stream.ring, pcm + first, (samples - first) * sizeof(float));
+
+   AUDIO_MIXER_ATOMIC_STORE(&voice->stream.write,
+         voice->stream.write + samples);
+   return true;
+}
+
+/* Sizes the ring for the chunk the voice's decoder produces
+ * and empties it. */
+static bool audio_mixer_stream_reset(audio_mixer_voice_t* voice)
+{
+   size_t size = next_pow2(voice->stream.chunk * 2);
+
+   if (!voice->stream.ring || voice->stream.mask + 1 < size)
    {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
+      float *ring = (float*)memalign_alloc(16, size * sizeof(float));
+
+      if (!ring)
+         return false;
 
-      voice->types.flac.position += buf_free;
-      voice->types.flac.samples  -= buf_free;
+      if (voice->stream.ring)
+         memalign_free(voice->stream.ring);
+
+      voice->stream.ring = ring;
+      voice->stream.mask = size - 1;
    }
+
+   voice->stream.read         = 0;
+   voice->stream.write        = 0;
+   voice->stream.repeats      = 0;
+   voice->stream.repeats_seen = 0;
+   voice->stream.eof          = false;
+   return true;
 }
-#endif
 
-#ifdef HAVE_DR_MP3
-static void audio_mixer_mix_mp3(float* buffer, size_t num_frames,
+static void audio_mixer_voice_finish(audio_mixer_voice_t* voice)
+{
+   audio_mixer_voice_lock(voice);
+   voice->type = AUDIO_MIXER_TYPE_NONE;
+   audio_mixer_voice_unlock(voice);
+
+   if (voice->stop_cb)
+      voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
+}
+
+static void audio_mixer_mix_stream(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
-   struct resampler_data info = { 0 };
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
+   size_t buf_free = num_frames * 2;
+   size_t read     = voice->stream.read;
 
-   if (voice->types.mp3.position == voice->types.mp3.samples)
+   while (buf_free)
    {
-again:
-      temp_samples = (unsigned)drmp3_read_f32(&voice->types.mp3.stream, AUDIO_MIXER_TEMP_BUFFER/2, temp_buffer) * 2;
+      size_t pos, first, samples;
+      size_t avail  = AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.write) - read;
 
-      if (temp_samples == 0)
+      if (!avail)
       {
-         if (voice->repeat)
+#ifdef AUDIO_MIXER_DECODE_THREAD
+         /* Either the stream is over, or the decoder fell behind
+          * and the rest of this batch stays silent. */
+         if (s_decode_pool)
          {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            drmp3_seek_to_frame(&voice->types.mp3.stream,0);
-            goto again;
-         }
-         else
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-            voice->type = AUDIO_MIXER_TYPE_NONE;
+            if (AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.eof))
+               break;
+            audio_mixer_decode_queue(voice);
             return;
          }
+#endif
+         if (audio_mixer_stream_fill(voice))
+            continue;
+         break;
       }
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.mp3.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.mp3.ratio;
-
-      if (voice->types.mp3.resampler)
-        voice->types.mp3.resampler->process(voice->types.mp3.resampler_data, &info);
-      else
-        memcpy(voice->types.mp3.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.mp3.position = 0;
-      voice->types.mp3.samples  = voice->types.mp3.buf_samples;
+      pos      = read & voice->stream.mask;
+      samples  = MIN(avail, buf_free);
+      first    = MIN(samples, voice->stream.mask + 1 - pos);
+
+      audio_mixer_mac(buffer, voice->stream.ring + pos, first, volume);
+      audio_mixer_mac(buffer + first, voice->stream.ring,
+            samples - first, volume);
+
+      buffer   += samples;
+      buf_free -= samples;
+      read     += samples;
+      AUDIO_MIXER_ATOMIC_STORE(&voice->stream.read, read);
    }
 
-   pcm = voice->types.mp3.buffer + voice->types.mp3.position;
+#ifdef AUDIO_MIXER_DECODE_THREAD
+   /* Tops the ring up for the next mix */
+   if (s_decode_pool && !AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.eof))
+      audio_mixer_decode_queue(voice);
+#endif
 
-   if (voice->types.mp3.samples < buf_free)
+   if (voice->stop_cb)
    {
-      for (i = voice->types.mp3.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      unsigned repeats = AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.repeats);
 
-      buf_free -= voice->types.mp3.samples;
-      goto again;
+      for (; voice->stream.repeats_seen != repeats;
+            voice->stream.repeats_seen++)
+         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
    }
-   else
-   {
-      int i;
-      for (i = buf_free; i != 0; --i )
-         *buffer++ += *pcm++ * volume;
 
-      voice->types.mp3.position += buf_free;
-      voice->types.mp3.samples  -= buf_free;
+   if (     buf_free
+         && AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.eof)
+         && read == AUDIO_MIXER_ATOMIC_LOAD(&voice->stream.write))
+      audio_mixer_voice_finish(voice);
+}
+
+#ifdef AUDIO_MIXER_DECODE_THREAD
+static void audio_mixer_decode_voice(void *data)
+{
+   audio_mixer_voice_t* voice = (audio_mixer_voice_t*)data;
+
+   /* Whatever is mixed from here on asks again */
+   AUDIO_MIXER_ATOMIC_STORE(&voice->decode_queued, 0);
+
+   audio_mixer_voice_lock(voice);
+   if (     voice->type != AUDIO_MIXER_TYPE_NONE
+         && voice->type != AUDIO_MIXER_TYPE_WAV)
+   {
+      while (audio_mixer_stream_fill(voice))
+         continue;
    }
+   audio_mixer_voice_unlock(voice);
+}
+
+/* Has the pool fill the voice's ring, unless that's already
+ * on its way */
+static void audio_mixer_decode_queue(audio_mixer_voice_t* voice)
+{
+   if (!s_decode_pool || AUDIO_MIXER_ATOMIC_XCHG(&voice->decode_queued, 1))
+      return;
+
+   if (!tpool_add_work(s_decode_pool, audio_mixer_decode_voice, voice))
+      AUDIO_MIXER_ATOMIC_STORE(&voice->decode_queued, 0);
 }
 #endif
 
 void audio_mixer_mix(float* buffer, size_t num_frames, float volume_override, bool override)
 {
    unsigned i;
-   size_t j                   = 0;
-   float* sample              = NULL;
    audio_mixer_voice_t* voice = s_voices;
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
@@ -1209,37 +1451,17 @@ void audio_mixer_mix(float* buffer, size_t num_frames, float volume_override, bo
             audio_mixer_mix_wav(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_FLAC:
-#ifdef HAVE_DR_FLAC
-            audio_mixer_mix_flac(buffer, num_frames, voice, volume);
-#endif
-            break;
-            case AUDIO_MIXER_TYPE_MP3:
-#ifdef HAVE_DR_MP3
-            audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
-#endif
+         case AUDIO_MIXER_TYPE_MP3:
+            audio_mixer_mix_stream(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_NONE:
             break;
       }
    }
 
-   for (j = 0, sample = buffer; j < num_frames; j++, sample++)
-   {
-      if (*sample < -1.0f)
-         *sample = -1.0f;
-      else if (*sample > 1.0f)
-         *sample = 1.0f;
-   }
+   audio_mixer_clamp(buffer, num_frames * 2);
 }
 
 float audio_mixer_voice_get_volume(audio_mixer_voice_t *voice)
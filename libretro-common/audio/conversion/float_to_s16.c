@@ -31,7 +31,13 @@
 #include <features/features_cpu.h>
 #include <audio/conversion/float_to_s16.h>
 
-#if defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+/* The assembly is ARMv7 only, AArch64 gets intrinsics. */
+#if defined(__aarch64__) && defined(__ARM_NEON) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define FLOAT_TO_S16_NEON_INTRINSICS
+static bool float_to_s16_neon_enabled = false;
+#elif defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define FLOAT_TO_S16_NEON_ASM
 static bool float_to_s16_neon_enabled = false;
 void convert_float_s16_asm(int16_t *out, const float *in, size_t samples);
 #endif
@@ -91,7 +97,24 @@ void convert_float_to_s16(int16_t *out,
 
    samples = samples_in;
    i       = 0;
-#elif defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#elif defined(FLOAT_TO_S16_NEON_INTRINSICS)
+   if (float_to_s16_neon_enabled)
+   {
+      float32x4_t factor = vdupq_n_f32((float)0x8000);
+
+      /* Truncates and saturates just like the C loop. */
+      for (i = 0; i + 8 <= samples; i += 8, in += 8, out += 8)
+      {
+         int32x4_t ints_l = vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + 0), factor));
+         int32x4_t ints_r = vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + 4), factor));
+
+         vst1q_s16(out, vcombine_s16(vqmovn_s32(ints_l), vqmovn_s32(ints_r)));
+      }
+
+      samples = samples - i;
+      i       = 0;
+   }
+#elif defined(FLOAT_TO_S16_NEON_ASM)
    if (float_to_s16_neon_enabled)
    {
       size_t aligned_samples = samples & ~7;
@@ -151,7 +174,7 @@ void convert_float_to_s16(int16_t *out,
  **/
 void convert_float_to_s16_init_simd(void)
 {
-#if defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#if defined(FLOAT_TO_S16_NEON_INTRINSICS) || defined(FLOAT_TO_S16_NEON_ASM)
    unsigned cpu = cpu_features_get();
 
    if (cpu & RETRO_SIMD_NEON)
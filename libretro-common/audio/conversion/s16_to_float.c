@@ -29,7 +29,13 @@
 #include <features/features_cpu.h>
 #include <audio/conversion/s16_to_float.h>
 
-#if defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+/* The assembly is ARMv7 only, AArch64 gets intrinsics. */
+#if defined(__aarch64__) && defined(__ARM_NEON) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define S16_TO_FLOAT_NEON_INTRINSICS
+static bool s16_to_float_neon_enabled = false;
+#elif defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define S16_TO_FLOAT_NEON_ASM
 static bool s16_to_float_neon_enabled = false;
 
 /* Avoid potential hard-float/soft-float ABI issues. */
@@ -99,7 +105,25 @@ void convert_s16_to_float(float *out,
    samples = samples_in;
    i       = 0;
 
-#elif defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#elif defined(S16_TO_FLOAT_NEON_INTRINSICS)
+   if (s16_to_float_neon_enabled)
+   {
+      float32x4_t factor = vdupq_n_f32(gain / 0x8000);
+
+      for (i = 0; i + 8 <= samples; i += 8, in += 8, out += 8)
+      {
+         int16x8_t input      = vld1q_s16(in);
+         float32x4_t input_l  = vcvtq_f32_s32(vmovl_s16(vget_low_s16(input)));
+         float32x4_t input_r  = vcvtq_f32_s32(vmovl_s16(vget_high_s16(input)));
+
+         vst1q_f32(out + 0, vmulq_f32(input_l, factor));
+         vst1q_f32(out + 4, vmulq_f32(input_r, factor));
+      }
+
+      samples = samples - i;
+      i       = 0;
+   }
+#elif defined(S16_TO_FLOAT_NEON_ASM)
    if (s16_to_float_neon_enabled)
    {
       size_t aligned_samples = samples & ~7;
@@ -182,7 +206,7 @@ void convert_s16_to_float(float *out,
  **/
 void convert_s16_to_float_init_simd(void)
 {
-#if defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#if defined(S16_TO_FLOAT_NEON_INTRINSICS) || defined(S16_TO_FLOAT_NEON_ASM)
    unsigned cpu = cpu_features_get();
 
    if (cpu & RETRO_SIMD_NEON)
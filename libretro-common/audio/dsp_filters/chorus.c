@@ -24,17 +24,32 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CHORUS_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define CHORUS_SSE
+#endif
+
 #define CHORUS_MAX_DELAY 4096
 #define CHORUS_DELAY_MASK (CHORUS_MAX_DELAY - 1)
 
 struct chorus_data
 {
-   float old[2][CHORUS_MAX_DELAY];
+   /* Interleaved like the frames. */
+   float old[CHORUS_MAX_DELAY][2];
    unsigned old_ptr;
 
+   /* The LFO is a rotating phasor, restarted every
+    * period to keep rounding errors from piling up. */
+   double lfo_cos, lfo_sin;
+   double lfo_step_cos, lfo_step_sin;
+
    float delay;
    float depth;
    float input_rate;
@@ -50,6 +65,35 @@ static void chorus_free(void *data)
       free(data);
 }
 
+/* Returns the delay of the current frame, in frames,
+ * and advances the LFO. */
+static INLINE void chorus_next_delay(struct chorus_data *ch,
+      float *delay_frac, unsigned *delay_int)
+{
+   double lfo_cos;
+   float delay = (ch->delay + ch->depth * ch->lfo_sin) * ch->input_rate;
+
+   if (++ch->lfo_ptr >= ch->lfo_period)
+   {
+      ch->lfo_ptr = 0;
+      ch->lfo_cos = 1.0;
+      ch->lfo_sin = 0.0;
+   }
+   else
+   {
+      lfo_cos     = ch->lfo_cos;
+      ch->lfo_cos = lfo_cos * ch->lfo_step_cos - ch->lfo_sin * ch->lfo_step_sin;
+      ch->lfo_sin = lfo_cos * ch->lfo_step_sin + ch->lfo_sin * ch->lfo_step_cos;
+   }
+
+   *delay_int = (unsigned)delay;
+
+   if (*delay_int >= CHORUS_MAX_DELAY - 1)
+      *delay_int = CHORUS_MAX_DELAY - 2;
+
+   *delay_frac = delay - *delay_int;
+}
+
 static void chorus_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
@@ -67,26 +111,19 @@ static void chorus_process(void *data, struct dspfilter_output *output,
       float delay_frac, l_a, l_b, r_a, r_b;
       float chorus_l, chorus_r;
       float in[2] = { out[0], out[1] };
-      float delay = ch->delay + ch->depth * sin((2.0 * M_PI * ch->lfo_ptr++) / ch->lfo_period);
-
-      delay *= ch->input_rate;
-      if (ch->lfo_ptr >= ch->lfo_period)
-         ch->lfo_ptr = 0;
-
-      delay_int = (unsigned)delay;
+      const float *a, *b;
 
-      if (delay_int >= CHORUS_MAX_DELAY - 1)
-         delay_int = CHORUS_MAX_DELAY - 2;
+      chorus_next_delay(ch, &delay_frac, &delay_int);
 
-      delay_frac = delay - delay_int;
+      ch->old[ch->old_ptr][0] = in[0];
+      ch->old[ch->old_ptr][1] = in[1];
 
-      ch->old[0][ch->old_ptr] = in[0];
-      ch->old[1][ch->old_ptr] = in[1];
-
-      l_a         = ch->old[0][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      l_b         = ch->old[0][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
-      r_a         = ch->old[1][(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
-      r_b         = ch->old[1][(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
+      a           = ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK];
+      b           = ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK];
+      l_a         = a[0];
+      l_b         = b[0];
+      r_a         = a[1];
+      r_b         = b[1];
 
       /* Lerp introduces aliasing of the chorus component,
        * but doing full polyphase here is probably overkill. */
@@ -100,6 +137,80 @@ static void chorus_process(void *data, struct dspfilter_output *output,
    }
 }
 
+#if defined(CHORUS_NEON)
+static void chorus_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float *out             = NULL;
+   struct chorus_data *ch = (struct chorus_data*)data;
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+   out                    = output->samples;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      unsigned delay_int;
+      float delay_frac;
+      float32x2_t a, b, chorus;
+      float32x2_t in = vld1_f32(out);
+
+      chorus_next_delay(ch, &delay_frac, &delay_int);
+
+      vst1_f32(ch->old[ch->old_ptr], in);
+
+      a           = vld1_f32(ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK]);
+      b           = vld1_f32(ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK]);
+
+      chorus      = vmla_n_f32(vmul_n_f32(a, 1.0f - delay_frac), b, delay_frac);
+
+      vst1_f32(out, vmla_n_f32(vmul_n_f32(in, ch->mix_dry), chorus, ch->mix_wet));
+
+      ch->old_ptr = (ch->old_ptr + 1) & CHORUS_DELAY_MASK;
+   }
+}
+#elif defined(CHORUS_SSE)
+static void chorus_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float *out             = NULL;
+   struct chorus_data *ch = (struct chorus_data*)data;
+   __m128 mix_dry         = _mm_set1_ps(ch->mix_dry);
+   __m128 mix_wet         = _mm_set1_ps(ch->mix_wet);
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+   out                    = output->samples;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      unsigned delay_int;
+      float delay_frac;
+      __m128 a, b, frac, chorus;
+      __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+
+      chorus_next_delay(ch, &delay_frac, &delay_int);
+
+      _mm_storel_pi((__m64*)ch->old[ch->old_ptr], in);
+
+      a           = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)
+            ch->old[(ch->old_ptr - delay_int - 0) & CHORUS_DELAY_MASK]);
+      b           = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)
+            ch->old[(ch->old_ptr - delay_int - 1) & CHORUS_DELAY_MASK]);
+
+      frac        = _mm_set1_ps(delay_frac);
+      chorus      = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), frac));
+
+      _mm_storel_pi((__m64*)out, _mm_add_ps(_mm_mul_ps(in, mix_dry),
+               _mm_mul_ps(chorus, mix_wet)));
+
+      ch->old_ptr = (ch->old_ptr + 1) & CHORUS_DELAY_MASK;
+   }
+}
+#endif
+
 static void *chorus_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -133,6 +244,11 @@ static void *chorus_init(const struct dspfilter_info *info,
    ch->input_rate = info->input_rate;
    if (!ch->lfo_period)
       ch->lfo_period = 1;
+
+   ch->lfo_cos      = 1.0;
+   ch->lfo_sin      = 0.0;
+   ch->lfo_step_cos = cos(2.0 * M_PI / ch->lfo_period);
+   ch->lfo_step_sin = sin(2.0 * M_PI / ch->lfo_period);
    return ch;
 }
 
@@ -146,6 +262,28 @@ static const struct dspfilter_implementation chorus_plug = {
    "chorus",
 };
 
+#if defined(CHORUS_NEON)
+static const struct dspfilter_implementation chorus_plug_neon = {
+   chorus_init,
+   chorus_process_neon,
+   chorus_free,
+
+   DSPFILTER_API_VERSION,
+   "Chorus",
+   "chorus",
+};
+#elif defined(CHORUS_SSE)
+static const struct dspfilter_implementation chorus_plug_sse = {
+   chorus_init,
+   chorus_process_sse,
+   chorus_free,
+
+   DSPFILTER_API_VERSION,
+   "Chorus",
+   "chorus",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation chorus_dspfilter_get_implementation
 #endif
@@ -153,7 +291,13 @@ static const struct dspfilter_implementation chorus_plug = {
 const struct dspfilter_implementation *
 dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#if defined(CHORUS_NEON)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &chorus_plug_neon;
+#elif defined(CHORUS_SSE)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &chorus_plug_sse;
+#endif
    return &chorus_plug;
 }
 
@@ -25,6 +25,14 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ECHO_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define ECHO_SSE
+#endif
+
 struct echo_channel
 {
    float *buffer;
@@ -89,7 +97,8 @@ static void echo_process(void *data, struct dspfilter_output *output,
          echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0] = feedback_left;
          echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1] = feedback_right;
 
-         echo->channels[c].ptr = (echo->channels[c].ptr + 1) % echo->channels[c].frames;
+         if (++echo->channels[c].ptr >= echo->channels[c].frames)
+            echo->channels[c].ptr = 0;
       }
 
       out[0] = left;
@@ -97,6 +106,89 @@ static void echo_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* The buffers of the echoes are interleaved like the frames,
+ * so both channels of a frame are handled as one vector. */
+#if defined(ECHO_NEON)
+static void echo_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i, c;
+   float *out             = NULL;
+   struct echo_data *echo = (struct echo_data*)data;
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+
+   out                    = output->samples;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      float32x2_t in     = vld1_f32(out);
+      float32x2_t echoed = vdup_n_f32(0.0f);
+
+      for (c = 0; c < echo->num_channels; c++)
+         echoed = vadd_f32(echoed, vld1_f32(echo->channels[c].buffer
+                  + (echo->channels[c].ptr << 1)));
+
+      echoed = vmul_n_f32(echoed, echo->amp);
+
+      for (c = 0; c < echo->num_channels; c++)
+      {
+         struct echo_channel *channel = &echo->channels[c];
+
+         vst1_f32(channel->buffer + (channel->ptr << 1),
+               vmla_n_f32(in, echoed, channel->feedback));
+
+         if (++channel->ptr >= channel->frames)
+            channel->ptr = 0;
+      }
+
+      vst1_f32(out, vadd_f32(in, echoed));
+   }
+}
+#elif defined(ECHO_SSE)
+static void echo_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i, c;
+   float *out             = NULL;
+   struct echo_data *echo = (struct echo_data*)data;
+   __m128 amp             = _mm_set1_ps(echo->amp);
+
+   output->samples        = input->samples;
+   output->frames         = input->frames;
+
+   out                    = output->samples;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      __m128 in     = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      __m128 echoed = _mm_setzero_ps();
+
+      for (c = 0; c < echo->num_channels; c++)
+         echoed = _mm_add_ps(echoed, _mm_loadl_pi(_mm_setzero_ps(),
+                  (const __m64*)(echo->channels[c].buffer
+                     + (echo->channels[c].ptr << 1))));
+
+      echoed = _mm_mul_ps(echoed, amp);
+
+      for (c = 0; c < echo->num_channels; c++)
+      {
+         struct echo_channel *channel = &echo->channels[c];
+
+         _mm_storel_pi((__m64*)(channel->buffer + (channel->ptr << 1)),
+               _mm_add_ps(in, _mm_mul_ps(echoed,
+                     _mm_set1_ps(channel->feedback))));
+
+         if (++channel->ptr >= channel->frames)
+            channel->ptr = 0;
+      }
+
+      _mm_storel_pi((__m64*)out, _mm_add_ps(in, echoed));
+   }
+}
+#endif
+
 static void *echo_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -167,13 +259,41 @@ static const struct dspfilter_implementation echo_plug = {
    "echo",
 };
 
+#if defined(ECHO_NEON)
+static const struct dspfilter_implementation echo_plug_neon = {
+   echo_init,
+   echo_process_neon,
+   echo_free,
+
+   DSPFILTER_API_VERSION,
+   "Multi-Echo",
+   "echo",
+};
+#elif defined(ECHO_SSE)
+static const struct dspfilter_implementation echo_plug_sse = {
+   echo_init,
+   echo_process_sse,
+   echo_free,
+
+   DSPFILTER_API_VERSION,
+   "Multi-Echo",
+   "echo",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation echo_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#if defined(ECHO_NEON)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &echo_plug_neon;
+#elif defined(ECHO_SSE)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &echo_plug_sse;
+#endif
    return &echo_plug;
 }
 
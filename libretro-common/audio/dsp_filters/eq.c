@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <boolean.h>
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <filters.h>
@@ -31,6 +32,14 @@
 
 #include "fft/fft.c"
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EQ_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define EQ_SSE
+#endif
+
 struct eq_data
 {
    fft_t *fft;
@@ -64,13 +73,89 @@ static void eq_free(void *data)
    free(eq);
 }
 
-static void eq_process(void *data, struct dspfilter_output *output,
-      const struct dspfilter_input *input)
+static void eq_filter(fft_complex_t *block,
+      const fft_complex_t *filter, unsigned samples)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++)
+      block[i] = fft_complex_mul(block[i], filter[i]);
+}
+
+static void eq_overlap_add(float *out, const float *save, unsigned samples)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++)
+      out[i] += save[i];
+}
+
+#if defined(EQ_NEON)
+static void eq_filter_simd(fft_complex_t *block,
+      const fft_complex_t *filter, unsigned samples)
+{
+   unsigned i;
+   for (i = 0; i < samples; i += 4)
+   {
+      float32x4x2_t a = vld2q_f32((const float*)(block + i));
+      float32x4x2_t b = vld2q_f32((const float*)(filter + i));
+      float32x4x2_t m;
+
+      m.val[0] = vmlsq_f32(vmulq_f32(a.val[0], b.val[0]), a.val[1], b.val[1]);
+      m.val[1] = vmlaq_f32(vmulq_f32(a.val[1], b.val[0]), a.val[0], b.val[1]);
+      vst2q_f32((float*)(block + i), m);
+   }
+}
+
+static void eq_overlap_add_simd(float *out, const float *save, unsigned samples)
+{
+   unsigned i;
+   for (i = 0; i < samples; i += 4)
+      vst1q_f32(out + i, vaddq_f32(vld1q_f32(out + i), vld1q_f32(save + i)));
+}
+#elif defined(EQ_SSE)
+static void eq_filter_simd(fft_complex_t *block,
+      const fft_complex_t *filter, unsigned samples)
+{
+   unsigned i;
+   for (i = 0; i < samples; i += 4)
+   {
+      float *a_ptr       = (float*)(block + i);
+      const float *b_ptr = (const float*)(filter + i);
+      __m128 a0          = _mm_loadu_ps(a_ptr);
+      __m128 a1          = _mm_loadu_ps(a_ptr + 4);
+      __m128 b0          = _mm_loadu_ps(b_ptr);
+      __m128 b1          = _mm_loadu_ps(b_ptr + 4);
+      __m128 a_re        = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 a_im        = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 b_re        = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 b_im        = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+      __m128 m_re        = _mm_sub_ps(_mm_mul_ps(a_re, b_re), _mm_mul_ps(a_im, b_im));
+      __m128 m_im        = _mm_add_ps(_mm_mul_ps(a_im, b_re), _mm_mul_ps(a_re, b_im));
+
+      _mm_storeu_ps(a_ptr,     _mm_unpacklo_ps(m_re, m_im));
+      _mm_storeu_ps(a_ptr + 4, _mm_unpackhi_ps(m_re, m_im));
+   }
+}
+
+static void eq_overlap_add_simd(float *out, const float *save, unsigned samples)
+{
+   unsigned i;
+   for (i = 0; i < samples; i += 4)
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i),
+               _mm_loadu_ps(save + i)));
+}
+#endif
+
+/* The stereo frames make up a complex signal with the left
+ * channel as real and the right one as imaginary part. As the
+ * filter is real in the time domain, one transform each way
+ * filters both channels. */
+static INLINE void eq_process_frames(struct eq_data *eq,
+      struct dspfilter_output *output,
+      const struct dspfilter_input *input, bool simd)
 {
    float *out;
    const float *in;
    unsigned input_frames;
-   struct eq_data *eq = (struct eq_data*)data;
 
    output->samples    = eq->buffer;
    output->frames     = 0;
@@ -92,24 +177,31 @@ static void eq_process(void *data, struct dspfilter_output *output,
       input_frames -= write_avail;
       eq->block_ptr += write_avail;
 
-      // Convolve a new block.
+      /* Convolve a new block. */
       if (eq->block_ptr == eq->block_size)
       {
-         unsigned i, c;
+         fft_process_forward_complex(eq->fft, eq->fftblock,
+               (const fft_complex_t*)eq->block, 1);
 
-         for (c = 0; c < 2; c++)
-         {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
-         }
+#if defined(EQ_NEON) || defined(EQ_SSE)
+         if (simd)
+            eq_filter_simd(eq->fftblock, eq->filter, 2 * eq->block_size);
+         else
+#endif
+            eq_filter(eq->fftblock, eq->filter, 2 * eq->block_size);
+
+         fft_process_inverse_complex(eq->fft, (fft_complex_t*)out,
+               eq->fftblock, 1);
 
-         // Overlap add method, so add in saved block now.
-         for (i = 0; i < 2 * eq->block_size; i++)
-            out[i] += eq->save[i];
+         /* Overlap add method, so add in saved block now. */
+#if defined(EQ_NEON) || defined(EQ_SSE)
+         if (simd)
+            eq_overlap_add_simd(out, eq->save, 2 * eq->block_size);
+         else
+#endif
+            eq_overlap_add(out, eq->save, 2 * eq->block_size);
 
-         // Save block for later.
+         /* Save block for later. */
          memcpy(eq->save, out + 2 * eq->block_size, 2 * eq->block_size * sizeof(float));
 
          out += eq->block_size * 2;
@@ -119,6 +211,22 @@ static void eq_process(void *data, struct dspfilter_output *output,
    }
 }
 
+static void eq_process(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   eq_process_frames((struct eq_data*)data, output, input, false);
+}
+
+#if defined(EQ_NEON) || defined(EQ_SSE)
+static void eq_process_simd(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   struct eq_data *eq = (struct eq_data*)data;
+   /* The kernels work on whole vectors. */
+   eq_process_frames(eq, output, input, eq->block_size >= 4);
+}
+#endif
+
 static int gains_cmp(const void *a_, const void *b_)
 {
    const struct eq_gain *a = (const struct eq_gain*)a_;
@@ -337,13 +445,31 @@ static const struct dspfilter_implementation eq_plug = {
    "eq",
 };
 
+#if defined(EQ_NEON) || defined(EQ_SSE)
+static const struct dspfilter_implementation eq_plug_simd = {
+   eq_init,
+   eq_process_simd,
+   eq_free,
+
+   DSPFILTER_API_VERSION,
+   "Linear-Phase FFT Equalizer",
+   "eq",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation eq_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#if defined(EQ_NEON)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &eq_plug_simd;
+#elif defined(EQ_SSE)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &eq_plug_simd;
+#endif
    return &eq_plug;
 }
 
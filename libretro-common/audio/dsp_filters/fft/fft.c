@@ -27,10 +27,23 @@
 
 #include <retro_miscellaneous.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FFT_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define FFT_SSE
+#endif
+
 struct fft
 {
    fft_complex_t *interleave_buffer;
    fft_complex_t *phase_lut;
+   /* Forward twiddles of each pass, split in real and
+    * imaginary parts for SIMD. The pass with butterflies
+    * step_size apart uses step_size entries at step_size - 1. */
+   float *twiddle_real;
+   float *twiddle_imag;
    unsigned *bitinverse_buffer;
    unsigned size;
 };
@@ -96,6 +109,31 @@ static void resolve_float(float *out, const fft_complex_t *in, unsigned samples,
       *out = gain * in->real;
 }
 
+static void resolve_complex(fft_complex_t *out, const fft_complex_t *in,
+      unsigned samples, float gain, unsigned step)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++, in++, out += step)
+   {
+      out->real = gain * in->real;
+      out->imag = gain * in->imag;
+   }
+}
+
+static void build_twiddles(float *real, float *imag, unsigned size)
+{
+   unsigned step_size, i;
+   for (step_size = 1; step_size < size; step_size <<= 1)
+   {
+      for (i = 0; i < step_size; i++)
+      {
+         double phase = -M_PI * i / step_size;
+         real[step_size - 1 + i] = cos(phase);
+         imag[step_size - 1 + i] = sin(phase);
+      }
+   }
+}
+
 fft_t *fft_new(unsigned block_size_log2)
 {
    unsigned size;
@@ -107,14 +145,18 @@ fft_t *fft_new(unsigned block_size_log2)
    fft->interleave_buffer = (fft_complex_t*)calloc(size, sizeof(*fft->interleave_buffer));
    fft->bitinverse_buffer = (unsigned*)calloc(size, sizeof(*fft->bitinverse_buffer));
    fft->phase_lut         = (fft_complex_t*)calloc(2 * size + 1, sizeof(*fft->phase_lut));
+   fft->twiddle_real      = (float*)calloc(size, sizeof(*fft->twiddle_real));
+   fft->twiddle_imag      = (float*)calloc(size, sizeof(*fft->twiddle_imag));
 
-   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->phase_lut)
+   if (     !fft->interleave_buffer || !fft->bitinverse_buffer
+         || !fft->phase_lut || !fft->twiddle_real || !fft->twiddle_imag)
       goto error;
 
    fft->size = size;
 
    build_bitinverse(fft->bitinverse_buffer, block_size_log2);
    build_phase_lut(fft->phase_lut, size);
+   build_twiddles(fft->twiddle_real, fft->twiddle_imag, size);
    return fft;
 
 error:
@@ -130,6 +172,8 @@ void fft_free(fft_t *fft)
    free(fft->interleave_buffer);
    free(fft->bitinverse_buffer);
    free(fft->phase_lut);
+   free(fft->twiddle_real);
+   free(fft->twiddle_imag);
    free(fft);
 }
 
@@ -154,51 +198,138 @@ static void butterflies(fft_complex_t *butterfly_buf,
    }
 }
 
-void fft_process_forward_complex(fft_t *fft,
-      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+/* Four butterflies at a time for the passes where
+ * they are at least four apart. */
+#if defined(FFT_NEON)
+static void butterflies_simd(fft_complex_t *butterfly_buf,
+      const float *twiddle_real, const float *twiddle_imag,
+      int phase_dir, unsigned step_size, unsigned samples)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   unsigned i, j;
+   for (i = 0; i < samples; i += step_size << 1)
+   {
+      for (j = 0; j < step_size; j += 4)
+      {
+         float *a_ptr     = (float*)(butterfly_buf + i + j);
+         float *b_ptr     = (float*)(butterfly_buf + i + j + step_size);
+         float32x4x2_t a  = vld2q_f32(a_ptr);
+         float32x4x2_t b  = vld2q_f32(b_ptr);
+         float32x4_t w_re = vld1q_f32(twiddle_real + j);
+         float32x4_t w_im = vld1q_f32(twiddle_imag + j);
+         float32x4_t m_re, m_im;
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+         if (phase_dir > 0)
+            w_im          = vnegq_f32(w_im);
+
+         m_re             = vmlsq_f32(vmulq_f32(b.val[0], w_re), b.val[1], w_im);
+         m_im             = vmlaq_f32(vmulq_f32(b.val[0], w_im), b.val[1], w_re);
+
+         b.val[0]         = vsubq_f32(a.val[0], m_re);
+         b.val[1]         = vsubq_f32(a.val[1], m_im);
+         a.val[0]         = vaddq_f32(a.val[0], m_re);
+         a.val[1]         = vaddq_f32(a.val[1], m_im);
+
+         vst2q_f32(a_ptr, a);
+         vst2q_f32(b_ptr, b);
+      }
+   }
+}
+#elif defined(FFT_SSE)
+static void butterflies_simd(fft_complex_t *butterfly_buf,
+      const float *twiddle_real, const float *twiddle_imag,
+      int phase_dir, unsigned step_size, unsigned samples)
+{
+   unsigned i, j;
+   __m128 sign = _mm_set1_ps(phase_dir > 0 ? -1.0f : 1.0f);
+
+   for (i = 0; i < samples; i += step_size << 1)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+      for (j = 0; j < step_size; j += 4)
+      {
+         float *a_ptr = (float*)(butterfly_buf + i + j);
+         float *b_ptr = (float*)(butterfly_buf + i + j + step_size);
+         __m128 a0    = _mm_loadu_ps(a_ptr);
+         __m128 a1    = _mm_loadu_ps(a_ptr + 4);
+         __m128 b0    = _mm_loadu_ps(b_ptr);
+         __m128 b1    = _mm_loadu_ps(b_ptr + 4);
+         __m128 a_re  = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+         __m128 a_im  = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+         __m128 b_re  = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+         __m128 b_im  = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+         __m128 w_re  = _mm_loadu_ps(twiddle_real + j);
+         __m128 w_im  = _mm_mul_ps(_mm_loadu_ps(twiddle_imag + j), sign);
+         __m128 m_re  = _mm_sub_ps(_mm_mul_ps(b_re, w_re), _mm_mul_ps(b_im, w_im));
+         __m128 m_im  = _mm_add_ps(_mm_mul_ps(b_re, w_im), _mm_mul_ps(b_im, w_re));
+
+         b_re         = _mm_sub_ps(a_re, m_re);
+         b_im         = _mm_sub_ps(a_im, m_im);
+         a_re         = _mm_add_ps(a_re, m_re);
+         a_im         = _mm_add_ps(a_im, m_im);
+
+         _mm_storeu_ps(a_ptr,     _mm_unpacklo_ps(a_re, a_im));
+         _mm_storeu_ps(a_ptr + 4, _mm_unpackhi_ps(a_re, a_im));
+         _mm_storeu_ps(b_ptr,     _mm_unpacklo_ps(b_re, b_im));
+         _mm_storeu_ps(b_ptr + 4, _mm_unpackhi_ps(b_re, b_im));
+      }
    }
 }
+#endif
 
-void fft_process_forward(fft_t *fft,
-      fft_complex_t *out, const float *in, unsigned step)
+static void fft_passes(fft_t *fft, fft_complex_t *buf, int phase_dir)
 {
    unsigned step_size;
    unsigned samples = fft->size;
-   interleave_float(fft->bitinverse_buffer, out, in, samples, step);
 
-   for (step_size = 1; step_size < fft->size; step_size <<= 1)
+   for (step_size = 1; step_size < samples; step_size <<= 1)
    {
-      butterflies(out,
+#if defined(FFT_NEON) || defined(FFT_SSE)
+      if (step_size >= 4)
+      {
+         butterflies_simd(buf,
+               fft->twiddle_real + step_size - 1,
+               fft->twiddle_imag + step_size - 1,
+               phase_dir, step_size, samples);
+         continue;
+      }
+#endif
+      butterflies(buf,
             fft->phase_lut + samples,
-            -1, step_size, samples);
+            phase_dir, step_size, samples);
    }
 }
 
+void fft_process_forward_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   interleave_complex(fft->bitinverse_buffer, out, in, fft->size, step);
+   fft_passes(fft, out, -1);
+}
+
+void fft_process_forward(fft_t *fft,
+      fft_complex_t *out, const float *in, unsigned step)
+{
+   interleave_float(fft->bitinverse_buffer, out, in, fft->size, step);
+   fft_passes(fft, out, -1);
+}
+
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
 
    interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
          in, samples, 1);
+   fft_passes(fft, fft->interleave_buffer, 1);
+   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
-   {
-      butterflies(fft->interleave_buffer,
-            fft->phase_lut + samples,
-            1, step_size, samples);
-   }
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned samples = fft->size;
 
-   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
+         in, samples, 1);
+   fft_passes(fft, fft->interleave_buffer, 1);
+   resolve_complex(out, fft->interleave_buffer, samples, 1.0f / samples, step);
 }
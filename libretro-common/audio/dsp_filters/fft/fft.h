@@ -41,4 +41,10 @@ void fft_process_forward(fft_t *fft,
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step);
 
+/* Like fft_process_inverse, but keeps the imaginary part.
+ * Two real signals packed as one complex signal can be
+ * filtered with a single transform each way. */
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step);
+
 #endif
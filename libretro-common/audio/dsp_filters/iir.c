@@ -28,6 +28,14 @@
 #include <libretro_dspfilter.h>
 #include <string/stdstring.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IIR_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define IIR_SSE
+#endif
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -47,16 +55,15 @@ enum IIRFilter
    RIAA_CD     /* CD de-emphasis */
 };
 
+/* Coefficients are normalized, i.e. a0 is always 1. */
 struct iir_data
 {
    float b0, b1, b2;
    float a0, a1, a2;
 
-   struct
-   {
-      float xn1, xn2;
-      float yn1, yn2;
-   } l, r;
+   /* Filter state, interleaved like the frames. */
+   float xn1[2], xn2[2];
+   float yn1[2], yn2[2];
 };
 
 static void iir_free(void *data)
@@ -74,19 +81,18 @@ static void iir_process(void *data, struct dspfilter_output *output,
    float b0             = iir->b0;
    float b1             = iir->b1;
    float b2             = iir->b2;
-   float a0             = iir->a0;
    float a1             = iir->a1;
    float a2             = iir->a2;
 
-   float xn1_l          = iir->l.xn1;
-   float xn2_l          = iir->l.xn2;
-   float yn1_l          = iir->l.yn1;
-   float yn2_l          = iir->l.yn2;
+   float xn1_l          = iir->xn1[0];
+   float xn2_l          = iir->xn2[0];
+   float yn1_l          = iir->yn1[0];
+   float yn2_l          = iir->yn2[0];
 
-   float xn1_r          = iir->r.xn1;
-   float xn2_r          = iir->r.xn2;
-   float yn1_r          = iir->r.yn1;
-   float yn2_r          = iir->r.yn2;
+   float xn1_r          = iir->xn1[1];
+   float xn2_r          = iir->xn2[1];
+   float yn1_r          = iir->yn1[1];
+   float yn2_r          = iir->yn2[1];
 
    output->samples      = input->samples;
    output->frames       = input->frames;
@@ -96,8 +102,8 @@ static void iir_process(void *data, struct dspfilter_output *output,
       float in_l = out[0];
       float in_r = out[1];
 
-      float l    = (b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l) / a0;
-      float r    = (b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r) / a0;
+      float l    = b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l;
+      float r    = b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r;
 
       xn2_l      = xn1_l;
       xn1_l      = in_l;
@@ -113,16 +119,101 @@ static void iir_process(void *data, struct dspfilter_output *output,
       out[1]     = r;
    }
 
-   iir->l.xn1 = xn1_l;
-   iir->l.xn2 = xn2_l;
-   iir->l.yn1 = yn1_l;
-   iir->l.yn2 = yn2_l;
+   iir->xn1[0] = xn1_l;
+   iir->xn2[0] = xn2_l;
+   iir->yn1[0] = yn1_l;
+   iir->yn2[0] = yn2_l;
+
+   iir->xn1[1] = xn1_r;
+   iir->xn2[1] = xn2_r;
+   iir->yn1[1] = yn1_r;
+   iir->yn2[1] = yn2_r;
+}
+
+/* Both channels of a frame go through the filter
+ * at once, as the two lanes of a vector. */
+#if defined(IIR_NEON)
+static void iir_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   struct iir_data *iir = (struct iir_data*)data;
+   float *out           = output->samples;
+   float32x2_t xn1      = vld1_f32(iir->xn1);
+   float32x2_t xn2      = vld1_f32(iir->xn2);
+   float32x2_t yn1      = vld1_f32(iir->yn1);
+   float32x2_t yn2      = vld1_f32(iir->yn2);
+
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      float32x2_t in = vld1_f32(out);
+      float32x2_t y  = vmul_n_f32(in, iir->b0);
+
+      y              = vmla_n_f32(y, xn1, iir->b1);
+      y              = vmla_n_f32(y, xn2, iir->b2);
+      y              = vmls_n_f32(y, yn1, iir->a1);
+      y              = vmls_n_f32(y, yn2, iir->a2);
+
+      xn2            = xn1;
+      xn1            = in;
+      yn2            = yn1;
+      yn1            = y;
+
+      vst1_f32(out, y);
+   }
+
+   vst1_f32(iir->xn1, xn1);
+   vst1_f32(iir->xn2, xn2);
+   vst1_f32(iir->yn1, yn1);
+   vst1_f32(iir->yn2, yn2);
+}
+#elif defined(IIR_SSE)
+static void iir_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   struct iir_data *iir = (struct iir_data*)data;
+   float *out           = output->samples;
+   __m128 b0            = _mm_set1_ps(iir->b0);
+   __m128 b1            = _mm_set1_ps(iir->b1);
+   __m128 b2            = _mm_set1_ps(iir->b2);
+   __m128 a1            = _mm_set1_ps(iir->a1);
+   __m128 a2            = _mm_set1_ps(iir->a2);
+   __m128 xn1           = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)iir->xn1);
+   __m128 xn2           = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)iir->xn2);
+   __m128 yn1           = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)iir->yn1);
+   __m128 yn2           = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)iir->yn2);
+
+   output->samples      = input->samples;
+   output->frames       = input->frames;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+   {
+      __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      __m128 y  = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(b0, in), _mm_mul_ps(b1, xn1)),
+            _mm_mul_ps(b2, xn2));
+
+      y         = _mm_sub_ps(y,
+            _mm_add_ps(_mm_mul_ps(a1, yn1), _mm_mul_ps(a2, yn2)));
 
-   iir->r.xn1 = xn1_r;
-   iir->r.xn2 = xn2_r;
-   iir->r.yn1 = yn1_r;
-   iir->r.yn2 = yn2_r;
+      xn2       = xn1;
+      xn1       = in;
+      yn2       = yn1;
+      yn1       = y;
+
+      _mm_storel_pi((__m64*)out, y);
+   }
+
+   _mm_storel_pi((__m64*)iir->xn1, xn1);
+   _mm_storel_pi((__m64*)iir->xn2, xn2);
+   _mm_storel_pi((__m64*)iir->yn1, yn1);
+   _mm_storel_pi((__m64*)iir->yn2, yn2);
 }
+#endif
 
 #define CHECK(x) if (string_is_equal(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
@@ -316,12 +407,12 @@ static void iir_filter_init(struct iir_data *iir,
          break;
    }
 
-   iir->b0 = b0;
-   iir->b1 = b1;
-   iir->b2 = b2;
-   iir->a0 = a0;
-   iir->a1 = a1;
-   iir->a2 = a2;
+   iir->b0 = b0 / a0;
+   iir->b1 = b1 / a0;
+   iir->b2 = b2 / a0;
+   iir->a0 = 1.0f;
+   iir->a1 = a1 / a0;
+   iir->a2 = a2 / a0;
 }
 
 static void *iir_init(const struct dspfilter_info *info,
@@ -357,13 +448,41 @@ static const struct dspfilter_implementation iir_plug = {
    "iir",
 };
 
+#if defined(IIR_NEON)
+static const struct dspfilter_implementation iir_plug_neon = {
+   iir_init,
+   iir_process_neon,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR",
+   "iir",
+};
+#elif defined(IIR_SSE)
+static const struct dspfilter_implementation iir_plug_sse = {
+   iir_init,
+   iir_process_sse,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR",
+   "iir",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation iir_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#if defined(IIR_NEON)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &iir_plug_neon;
+#elif defined(IIR_SSE)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &iir_plug_sse;
+#endif
    return &iir_plug;
 }
 
@@ -24,9 +24,21 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <boolean.h>
 #include <retro_inline.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define REVERB_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define REVERB_SSE
+#endif
+
+/* Both channels use the same delay lengths and settings, so
+ * the buffers hold them interleaved like the frames, and a
+ * frame goes through the network as one stereo pair. */
 struct comb
 {
    float *buffer;
@@ -34,7 +46,7 @@ struct comb
    unsigned bufidx;
 
    float feedback;
-   float filterstore;
+   float filterstore[2];
    float damp1, damp2;
 };
 
@@ -46,31 +58,39 @@ struct allpass
    unsigned bufidx;
 };
 
-static INLINE float comb_process(struct comb *c, float input)
+static INLINE void comb_process(struct comb *c,
+      const float *input, float *output)
 {
-   float output         = c->buffer[c->bufidx];
-   c->filterstore       = (output * c->damp2) + (c->filterstore * c->damp1);
+   unsigned i;
+   float *buf = c->buffer + (c->bufidx << 1);
 
-   c->buffer[c->bufidx] = input + (c->filterstore * c->feedback);
+   for (i = 0; i < 2; i++)
+   {
+      output[i]         += buf[i];
+      c->filterstore[i]  = (buf[i] * c->damp2) + (c->filterstore[i] * c->damp1);
+      buf[i]             = input[i] + (c->filterstore[i] * c->feedback);
+   }
 
    c->bufidx++;
    if (c->bufidx >= c->bufsize)
       c->bufidx = 0;
-
-   return output;
 }
 
-static INLINE float allpass_process(struct allpass *a, float input)
+static INLINE void allpass_process(struct allpass *a, float *data)
 {
-   float bufout         = a->buffer[a->bufidx];
-   float output         = -input + bufout;
-   a->buffer[a->bufidx] = input + bufout * a->feedback;
+   unsigned i;
+   float *buf = a->buffer + (a->bufidx << 1);
+
+   for (i = 0; i < 2; i++)
+   {
+      float bufout = buf[i];
+      buf[i]       = data[i] + bufout * a->feedback;
+      data[i]      = -data[i] + bufout;
+   }
 
    a->bufidx++;
    if (a->bufidx >= a->bufsize)
       a->bufidx = 0;
-
-   return output;
 }
 
 #define numcombs 8
@@ -92,8 +112,8 @@ static const float freezemode = 0.5f;
 
 struct revmodel
 {
-   struct comb combL[numcombs];
-   struct allpass allpassL[numallpasses];
+   struct comb comb[numcombs];
+   struct allpass allpass[numallpasses];
 
    float *bufcomb[numcombs];
    float *bufallpass[numallpasses];
@@ -107,22 +127,108 @@ struct revmodel
    float mode;
 };
 
-static float revmodel_process(struct revmodel *rev, float in)
+static void revmodel_process(struct revmodel *rev, float *frame)
 {
    int i;
-   float mono_out = 0.0f;
-   float mono_in  = in;
-   float input    = mono_in * rev->gain;
+   float out[2]   = { 0.0f, 0.0f };
+   float input[2] = { frame[0] * rev->gain, frame[1] * rev->gain };
 
    for (i = 0; i < numcombs; i++)
-      mono_out += comb_process(&rev->combL[i], input);
+      comb_process(&rev->comb[i], input, out);
 
    for (i = 0; i < numallpasses; i++)
-      mono_out = allpass_process(&rev->allpassL[i], mono_out);
+      allpass_process(&rev->allpass[i], out);
 
-   return mono_in * rev->dry + mono_out * rev->wet1;
+   frame[0] = frame[0] * rev->dry + out[0] * rev->wet1;
+   frame[1] = frame[1] * rev->dry + out[1] * rev->wet1;
 }
 
+#if defined(REVERB_NEON)
+static void revmodel_process_neon(struct revmodel *rev, float *frame)
+{
+   int i;
+   float32x2_t in    = vld1_f32(frame);
+   float32x2_t input = vmul_n_f32(in, rev->gain);
+   float32x2_t out   = vdup_n_f32(0.0f);
+
+   for (i = 0; i < numcombs; i++)
+   {
+      struct comb *c    = &rev->comb[i];
+      float *buf        = c->buffer + (c->bufidx << 1);
+      float32x2_t old   = vld1_f32(buf);
+      float32x2_t store = vmla_n_f32(vmul_n_f32(old, c->damp2),
+            vld1_f32(c->filterstore), c->damp1);
+
+      out               = vadd_f32(out, old);
+      vst1_f32(c->filterstore, store);
+      vst1_f32(buf, vmla_n_f32(input, store, c->feedback));
+
+      if (++c->bufidx >= c->bufsize)
+         c->bufidx = 0;
+   }
+
+   for (i = 0; i < numallpasses; i++)
+   {
+      struct allpass *a   = &rev->allpass[i];
+      float *buf          = a->buffer + (a->bufidx << 1);
+      float32x2_t bufout  = vld1_f32(buf);
+
+      vst1_f32(buf, vmla_n_f32(out, bufout, a->feedback));
+      out                 = vsub_f32(bufout, out);
+
+      if (++a->bufidx >= a->bufsize)
+         a->bufidx = 0;
+   }
+
+   vst1_f32(frame, vmla_n_f32(vmul_n_f32(in, rev->dry), out, rev->wet1));
+}
+#elif defined(REVERB_SSE)
+static void revmodel_process_sse(struct revmodel *rev, float *frame)
+{
+   int i;
+   __m128 in    = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)frame);
+   __m128 input = _mm_mul_ps(in, _mm_set1_ps(rev->gain));
+   __m128 out   = _mm_setzero_ps();
+
+   for (i = 0; i < numcombs; i++)
+   {
+      struct comb *c = &rev->comb[i];
+      float *buf     = c->buffer + (c->bufidx << 1);
+      __m128 old     = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)buf);
+      __m128 store   = _mm_add_ps(
+            _mm_mul_ps(old, _mm_set1_ps(c->damp2)),
+            _mm_mul_ps(_mm_loadl_pi(_mm_setzero_ps(),
+                  (const __m64*)c->filterstore), _mm_set1_ps(c->damp1)));
+
+      out            = _mm_add_ps(out, old);
+      _mm_storel_pi((__m64*)c->filterstore, store);
+      _mm_storel_pi((__m64*)buf, _mm_add_ps(input,
+               _mm_mul_ps(store, _mm_set1_ps(c->feedback))));
+
+      if (++c->bufidx >= c->bufsize)
+         c->bufidx = 0;
+   }
+
+   for (i = 0; i < numallpasses; i++)
+   {
+      struct allpass *a = &rev->allpass[i];
+      float *buf        = a->buffer + (a->bufidx << 1);
+      __m128 bufout     = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)buf);
+
+      _mm_storel_pi((__m64*)buf, _mm_add_ps(out,
+               _mm_mul_ps(bufout, _mm_set1_ps(a->feedback))));
+      out               = _mm_sub_ps(bufout, out);
+
+      if (++a->bufidx >= a->bufsize)
+         a->bufidx = 0;
+   }
+
+   _mm_storel_pi((__m64*)frame, _mm_add_ps(
+            _mm_mul_ps(in, _mm_set1_ps(rev->dry)),
+            _mm_mul_ps(out, _mm_set1_ps(rev->wet1))));
+}
+#endif
+
 static void revmodel_update(struct revmodel *rev)
 {
    int i;
@@ -143,9 +249,9 @@ static void revmodel_update(struct revmodel *rev)
 
    for (i = 0; i < numcombs; i++)
    {
-      rev->combL[i].feedback = rev->roomsize1;
-      rev->combL[i].damp1 = rev->damp1;
-      rev->combL[i].damp2 = 1.0f - rev->damp1;
+      rev->comb[i].feedback = rev->roomsize1;
+      rev->comb[i].damp1 = rev->damp1;
+      rev->comb[i].damp2 = 1.0f - rev->damp1;
    }
 }
 
@@ -185,30 +291,35 @@ static void revmodel_setmode(struct revmodel *rev, float value)
    revmodel_update(rev);
 }
 
-static void revmodel_init(struct revmodel *rev,int srate)
+static bool revmodel_init(struct revmodel *rev,int srate)
 {
-
-  static const int comb_lengths[8] = { 1116,1188,1277,1356,1422,1491,1557,1617 };
-  static const int allpass_lengths[4] = { 225,341,441,556 };
-  double r = srate * (1 / 44100.0);
-  unsigned c;
+   static const int comb_lengths[8] = { 1116,1188,1277,1356,1422,1491,1557,1617 };
+   static const int allpass_lengths[4] = { 225,341,441,556 };
+   double r = srate * (1 / 44100.0);
+   unsigned c;
 
    for (c = 0; c < numcombs; ++c)
    {
-	   rev->bufcomb[c] = malloc(r*comb_lengths[c]*sizeof(float));
-	   rev->combL[c].buffer  =  rev->bufcomb[c];
-         memset(rev->combL[c].buffer,0,r*comb_lengths[c]*sizeof(float));
-         rev->combL[c].bufsize=r*comb_lengths[c];
-  }
+      unsigned size          = (unsigned)(r * comb_lengths[c]);
+
+      rev->bufcomb[c]        = (float*)calloc(size, 2 * sizeof(float));
+      if (!rev->bufcomb[c])
+         return false;
+      rev->comb[c].buffer    = rev->bufcomb[c];
+      rev->comb[c].bufsize   = size;
+   }
 
    for (c = 0; c < numallpasses; ++c)
    {
-	   rev->bufallpass[c] = malloc(r*allpass_lengths[c]*sizeof(float));
-	   rev->allpassL[c].buffer  =  rev->bufallpass[c];
-         memset(rev->allpassL[c].buffer,0,r*allpass_lengths[c]*sizeof(float));
-         rev->allpassL[c].bufsize=r*allpass_lengths[c];
-         rev->allpassL[c].feedback = 0.5f;
-  }
+      unsigned size          = (unsigned)(r * allpass_lengths[c]);
+
+      rev->bufallpass[c]     = (float*)calloc(size, 2 * sizeof(float));
+      if (!rev->bufallpass[c])
+         return false;
+      rev->allpass[c].buffer   = rev->bufallpass[c];
+      rev->allpass[c].bufsize  = size;
+      rev->allpass[c].feedback = 0.5f;
+   }
 
    revmodel_setwet(rev, initialwet);
    revmodel_setroomsize(rev, initialroom);
@@ -216,11 +327,12 @@ static void revmodel_init(struct revmodel *rev,int srate)
    revmodel_setdamp(rev, initialdamp);
    revmodel_setwidth(rev, initialwidth);
    revmodel_setmode(rev, initialmode);
+   return true;
 }
 
 struct reverb_data
 {
-   struct revmodel left, right;
+   struct revmodel rev;
 };
 
 static void reverb_free(void *data)
@@ -228,15 +340,11 @@ static void reverb_free(void *data)
    struct reverb_data *rev = (struct reverb_data*)data;
    unsigned i;
 
-   for (i = 0; i < numcombs; i++) {
-   free(rev->left.bufcomb[i]);
-   free(rev->right.bufcomb[i]);
-   }
+   for (i = 0; i < numcombs; i++)
+      free(rev->rev.bufcomb[i]);
 
-   for (i = 0; i < numallpasses; i++) {
-   free(rev->left.bufallpass[i]);
-   free(rev->right.bufallpass[i]);
-   }
+   for (i = 0; i < numallpasses; i++)
+      free(rev->rev.bufallpass[i]);
    free(data);
 }
 
@@ -252,13 +360,40 @@ static void reverb_process(void *data, struct dspfilter_output *output,
    out                     = output->samples;
 
    for (i = 0; i < input->frames; i++, out += 2)
-   {
-      float in[2] = { out[0], out[1] };
+      revmodel_process(&rev->rev, out);
+}
 
-      out[0] = revmodel_process(&rev->left, in[0]);
-      out[1] = revmodel_process(&rev->right, in[1]);
-   }
+#if defined(REVERB_NEON)
+static void reverb_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float *out;
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   output->samples         = input->samples;
+   output->frames          = input->frames;
+   out                     = output->samples;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+      revmodel_process_neon(&rev->rev, out);
+}
+#elif defined(REVERB_SSE)
+static void reverb_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   float *out;
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   output->samples         = input->samples;
+   output->frames          = input->frames;
+   out                     = output->samples;
+
+   for (i = 0; i < input->frames; i++, out += 2)
+      revmodel_process_sse(&rev->rev, out);
 }
+#endif
 
 static void *reverb_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
@@ -275,20 +410,17 @@ static void *reverb_init(const struct dspfilter_info *info,
    config->get_float(userdata, "roomwidth", &roomwidth, 0.56f);
    config->get_float(userdata, "roomsize", &roomsize, 0.56f);
 
-   revmodel_init(&rev->left,info->input_rate);
-   revmodel_init(&rev->right,info->input_rate);
-
-   revmodel_setdamp(&rev->left, damping);
-   revmodel_setdry(&rev->left, drytime);
-   revmodel_setwet(&rev->left, wettime);
-   revmodel_setwidth(&rev->left, roomwidth);
-   revmodel_setroomsize(&rev->left, roomsize);
+   if (!revmodel_init(&rev->rev, info->input_rate))
+   {
+      reverb_free(rev);
+      return NULL;
+   }
 
-   revmodel_setdamp(&rev->right, damping);
-   revmodel_setdry(&rev->right, drytime);
-   revmodel_setwet(&rev->right, wettime);
-   revmodel_setwidth(&rev->right, roomwidth);
-   revmodel_setroomsize(&rev->right, roomsize);
+   revmodel_setdamp(&rev->rev, damping);
+   revmodel_setdry(&rev->rev, drytime);
+   revmodel_setwet(&rev->rev, wettime);
+   revmodel_setwidth(&rev->rev, roomwidth);
+   revmodel_setroomsize(&rev->rev, roomsize);
 
    return rev;
 }
@@ -303,13 +435,41 @@ static const struct dspfilter_implementation reverb_plug = {
    "reverb",
 };
 
+#if defined(REVERB_NEON)
+static const struct dspfilter_implementation reverb_plug_neon = {
+   reverb_init,
+   reverb_process_neon,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb",
+   "reverb",
+};
+#elif defined(REVERB_SSE)
+static const struct dspfilter_implementation reverb_plug_sse = {
+   reverb_init,
+   reverb_process_sse,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb",
+   "reverb",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation reverb_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#if defined(REVERB_NEON)
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &reverb_plug_neon;
+#elif defined(REVERB_SSE)
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &reverb_plug_sse;
+#endif
    return &reverb_plug;
 }
 
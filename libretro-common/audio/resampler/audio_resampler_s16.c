@@ -0,0 +1,232 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (audio_resampler_s16.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Lanczos windowed SINC in Q15, roughly the LOWER quality
+ * of the float sinc resampler. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <filters.h>
+
+#include <audio/audio_resampler_s16.h>
+
+/* 1024 phases keep the timing error below 1/2048 of a
+ * sample, which is under the noise floor of 16-bit
+ * output for most content. */
+#define S16_PHASE_BITS    10
+#define S16_SUBPHASE_BITS 14
+#define S16_PHASES        (1 << S16_PHASE_BITS)
+#define S16_TIME_ONE      (1u << (S16_PHASE_BITS + S16_SUBPHASE_BITS))
+
+#define S16_SIDELOBES     4
+#define S16_CUTOFF        0.90
+
+struct audio_resampler_s16
+{
+   int16_t *phase_table;
+   int16_t *buffer_l;
+   int16_t *buffer_r;
+   unsigned taps;
+   unsigned ptr;
+   uint32_t time;
+};
+
+static INLINE int16_t s16_saturate(int32_t val)
+{
+   if (val > 0x7fff)
+      return 0x7fff;
+   if (val < -0x8000)
+      return -0x8000;
+   return (int16_t)val;
+}
+
+/* Each phase is normalized to unity DC gain before
+ * quantization, so silence and DC survive exactly. */
+static void s16_init_table(int16_t *phase_table,
+      unsigned taps, double cutoff)
+{
+   unsigned i, j;
+   double window_mod = lanzcos_window_function(0.0);
+   double half_taps  = taps / 2.0;
+   double *row       = (double*)malloc(taps * sizeof(double));
+
+   if (!row)
+      return;
+
+   for (i = 0; i < S16_PHASES; i++)
+   {
+      double sum  = 0.0;
+      double frac = (double)i / S16_PHASES;
+
+      for (j = 0; j < taps; j++)
+      {
+         /* Distance from the output position, which lies frac
+          * past the sample in the middle of the window. */
+         double t = (double)j - (half_taps - 1.0) - frac;
+
+         row[j]   = cutoff * sinc(M_PI * t * cutoff) *
+            lanzcos_window_function(t / half_taps) / window_mod;
+         sum     += row[j];
+      }
+
+      for (j = 0; j < taps; j++)
+         phase_table[i * taps + j] = s16_saturate(
+               (int32_t)floor(row[j] / sum * 0x8000 + 0.5));
+   }
+
+   free(row);
+}
+
+audio_resampler_s16_t *audio_resampler_s16_new(double bandwidth_mod)
+{
+   double cutoff              = S16_CUTOFF;
+   unsigned taps              = S16_SIDELOBES * 2;
+   audio_resampler_s16_t *re  = (audio_resampler_s16_t*)
+      calloc(1, sizeof(*re));
+
+   if (!re)
+      return NULL;
+
+   /* Downsampling, so lower the cutoff and widen the
+    * window to keep the same stopband attenuation. */
+   if (bandwidth_mod < 1.0)
+   {
+      cutoff *= bandwidth_mod;
+      taps    = (unsigned)ceil(taps / bandwidth_mod);
+   }
+
+   /* Keep the inner loop vectorizable. */
+   taps             = (taps + 3) & ~3;
+   re->taps         = taps;
+   re->phase_table  = (int16_t*)malloc(
+         S16_PHASES * taps * sizeof(int16_t));
+   re->buffer_l     = (int16_t*)calloc(4 * taps, sizeof(int16_t));
+
+   if (!re->phase_table || !re->buffer_l)
+   {
+      audio_resampler_s16_free(re);
+      return NULL;
+   }
+
+   re->buffer_r     = re->buffer_l + 2 * taps;
+   /* Start with a full window of silence. */
+   re->time         = S16_TIME_ONE;
+
+   s16_init_table(re->phase_table, taps, cutoff);
+
+   return re;
+}
+
+void audio_resampler_s16_free(audio_resampler_s16_t *re)
+{
+   if (!re)
+      return;
+   free(re->phase_table);
+   free(re->buffer_l);
+   free(re);
+}
+
+size_t audio_resampler_s16_process(audio_resampler_s16_t *re,
+      int16_t *out, const int16_t *in, size_t in_frames,
+      double ratio)
+{
+   unsigned taps     = re->taps;
+   uint32_t step     = (uint32_t)(S16_TIME_ONE / ratio + 0.5);
+   int16_t *out_base = out;
+
+   while (in_frames)
+   {
+      while (in_frames && re->time >= S16_TIME_ONE)
+      {
+         /* Both halves of the ring hold the same samples, so
+          * buffer + ptr is always a contiguous window going
+          * from the oldest sample to the newest one. */
+         re->buffer_l[re->ptr]        = in[0];
+         re->buffer_l[re->ptr + taps] = in[0];
+         re->buffer_r[re->ptr]        = in[1];
+         re->buffer_r[re->ptr + taps] = in[1];
+
+         if (++re->ptr == taps)
+            re->ptr = 0;
+
+         in        += 2;
+         re->time  -= S16_TIME_ONE;
+         in_frames--;
+      }
+
+      while (re->time < S16_TIME_ONE)
+      {
+         unsigned i;
+         int32_t sum_l          = 0;
+         int32_t sum_r          = 0;
+         const int16_t *buf_l   = re->buffer_l + re->ptr;
+         const int16_t *buf_r   = re->buffer_r + re->ptr;
+         const int16_t *phase   = re->phase_table +
+            (re->time >> S16_SUBPHASE_BITS) * taps;
+
+         /* Each phase sums to a gain of one, so the worst case
+          * stays well inside 32-bit for the tap counts in use. */
+         for (i = 0; i < taps; i++)
+         {
+            sum_l += buf_l[i] * phase[i];
+            sum_r += buf_r[i] * phase[i];
+         }
+
+         out[0]    = s16_saturate((sum_l + 0x4000) >> 15);
+         out[1]    = s16_saturate((sum_r + 0x4000) >> 15);
+         out      += 2;
+
+         re->time += step;
+      }
+   }
+
+   return (size_t)(out - out_base) >> 1;
+}
+
+void audio_resampler_s16_gain(int16_t *samples, size_t count,
+      float gain)
+{
+   size_t i;
+   int32_t gain_q14;
+
+   if (gain > AUDIO_RESAMPLER_S16_MAX_GAIN)
+      gain = AUDIO_RESAMPLER_S16_MAX_GAIN;
+
+   /* Q14 is as far as a +12 dB gain fits in 32-bit. */
+   gain_q14 = (int32_t)(gain * 0x4000 + 0.5f);
+
+   if (gain_q14 == 0x4000)
+      return;
+
+   if (gain_q14 == 0)
+   {
+      memset(samples, 0, count * sizeof(int16_t));
+      return;
+   }
+
+   for (i = 0; i < count; i++)
+      samples[i] = s16_saturate((samples[i] * gain_q14 + 0x2000) >> 14);
+}
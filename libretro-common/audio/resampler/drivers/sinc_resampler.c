@@ -94,6 +94,13 @@ typedef struct rarch_sinc_resampler
 #endif
 #endif
 
+/* The assembly above is ARMv7 only and lacks the Kaiser
+ * window, intrinsics cover the rest, including AArch64. */
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define WANT_NEON_INTRINSICS
+#include <arm_neon.h>
+#endif
+
 #ifdef WANT_NEON
 /* Assumes that taps >= 8, and that taps is a multiple of 8. */
 void process_sinc_neon_asm(float *out, const float *left,
@@ -469,6 +476,137 @@ static void resampler_sinc_process_sse(void *re_, struct resampler_data *data)
 }
 #endif
 
+#if defined(WANT_NEON_INTRINSICS)
+static void resampler_sinc_process_neon_intrinsics(void *re_,
+      struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+
+   if (resamp->window_type == SINC_WINDOW_KAISER)
+   {
+      while (frames)
+      {
+         while (frames && resamp->time >= phases)
+         {
+            /* Push in reverse to make filter more obvious. */
+            if (!resamp->ptr)
+               resamp->ptr = resamp->taps;
+            resamp->ptr--;
+
+            resamp->buffer_l[resamp->ptr + resamp->taps] =
+               resamp->buffer_l[resamp->ptr]                = *input++;
+
+            resamp->buffer_r[resamp->ptr + resamp->taps] =
+               resamp->buffer_r[resamp->ptr]                = *input++;
+
+            resamp->time                                -= phases;
+            frames--;
+         }
+
+         while (resamp->time < phases)
+         {
+            unsigned i;
+            float32x2_t sum;
+            const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+            const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+            unsigned taps            = resamp->taps;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps * 2;
+            const float *delta_table = phase_table + taps;
+            float32x4_t delta        = vdupq_n_f32((float)
+                  (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
+
+            float32x4_t sum_l        = vdupq_n_f32(0.0f);
+            float32x4_t sum_r        = vdupq_n_f32(0.0f);
+
+            for (i = 0; i < taps; i += 4)
+            {
+               float32x4_t buf_l  = vld1q_f32(buffer_l + i);
+               float32x4_t buf_r  = vld1q_f32(buffer_r + i);
+               float32x4_t _sinc  = vmlaq_f32(vld1q_f32(phase_table + i),
+                     vld1q_f32(delta_table + i), delta);
+               sum_l              = vmlaq_f32(sum_l, buf_l, _sinc);
+               sum_r              = vmlaq_f32(sum_r, buf_r, _sinc);
+            }
+
+            /* { l0 + l2, l1 + l3 }, { r0 + r2, r1 + r3 } -> { L, R } */
+            sum = vpadd_f32(
+                  vadd_f32(vget_low_f32(sum_l), vget_high_f32(sum_l)),
+                  vadd_f32(vget_low_f32(sum_r), vget_high_f32(sum_r)));
+            vst1_f32(output, sum);
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+   else
+   {
+      while (frames)
+      {
+         while (frames && resamp->time >= phases)
+         {
+            /* Push in reverse to make filter more obvious. */
+            if (!resamp->ptr)
+               resamp->ptr = resamp->taps;
+            resamp->ptr--;
+
+            resamp->buffer_l[resamp->ptr + resamp->taps] =
+               resamp->buffer_l[resamp->ptr]                = *input++;
+
+            resamp->buffer_r[resamp->ptr + resamp->taps] =
+               resamp->buffer_r[resamp->ptr]                = *input++;
+
+            resamp->time                                -= phases;
+            frames--;
+         }
+
+         while (resamp->time < phases)
+         {
+            unsigned i;
+            float32x2_t sum;
+            const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+            const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+            unsigned taps            = resamp->taps;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps;
+
+            float32x4_t sum_l        = vdupq_n_f32(0.0f);
+            float32x4_t sum_r        = vdupq_n_f32(0.0f);
+
+            for (i = 0; i < taps; i += 4)
+            {
+               float32x4_t buf_l  = vld1q_f32(buffer_l + i);
+               float32x4_t buf_r  = vld1q_f32(buffer_r + i);
+               float32x4_t _sinc  = vld1q_f32(phase_table + i);
+               sum_l              = vmlaq_f32(sum_l, buf_l, _sinc);
+               sum_r              = vmlaq_f32(sum_r, buf_r, _sinc);
+            }
+
+            sum = vpadd_f32(
+                  vadd_f32(vget_low_f32(sum_l), vget_high_f32(sum_l)),
+                  vadd_f32(vget_low_f32(sum_r), vget_high_f32(sum_r)));
+            vst1_f32(output, sum);
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
 static void resampler_sinc_process_c(void *re_, struct resampler_data *data)
 {
    rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
@@ -843,11 +981,18 @@ static void *resampler_sinc_new(const struct resampler_config *config,
       sinc_resampler.process = resampler_sinc_process_sse;
 #endif
    }
-   else if (mask & RESAMPLER_SIMD_NEON && re->window_type != SINC_WINDOW_KAISER)
+   else if (mask & RESAMPLER_SIMD_NEON)
    {
 #if defined(WANT_NEON)
-      sinc_resampler.process = resampler_sinc_process_neon;
+      if (re->window_type != SINC_WINDOW_KAISER)
+         sinc_resampler.process = resampler_sinc_process_neon;
+      else
 #endif
+      {
+#if defined(WANT_NEON_INTRINSICS)
+         sinc_resampler.process = resampler_sinc_process_neon_intrinsics;
+#endif
+      }
    }
 
    return re;
@@ -867,3 +1012,4 @@ retro_resampler_t sinc_resampler = {
 };
 
 #undef WANT_NEON
+#undef WANT_NEON_INTRINSICS
@@ -22,10 +22,25 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include <encodings/crc32.h>
 #include <streams/file_stream.h>
 #include <stdlib.h>
+#include <retro_endianness.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
+#endif
+
+/* ARMv8 has instructions for this very polynomial */
+#if defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_acle.h>
+#define HAVE_CRC32_ARM
+#endif
+
+#ifndef HAVE_CRC32_ARM
 static const uint32_t crc32_table[256] = {
   0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL, 0x076dc419L,
   0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0x0edb8832L, 0x79dcb8a4L,
@@ -81,16 +96,385 @@ static const uint32_t crc32_table[256] = {
   0x2d02ef8dL
 };
 
+/* The table for each of the bytes after the first one of 8 hashed
+ * at once, made from the one above on first use */
+static uint32_t crc32_slice_table[7][256];
+static bool crc32_slice_table_ready = false;
+
+static void crc32_init_slice_table(void)
+{
+   unsigned i, j;
+
+   for (i = 0; i < 256; i++)
+   {
+      uint32_t crc = crc32_table[i];
+      for (j = 0; j < 7; j++)
+      {
+         crc = crc32_table[crc & 0xff] ^ (crc >> 8);
+         crc32_slice_table[j][i] = crc;
+      }
+   }
+
+   /* Writes the same every time, so racing threads don't matter */
+   crc32_slice_table_ready = true;
+}
+#endif
+
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len)
 {
    crc = crc ^ 0xffffffff;
 
+#ifdef HAVE_CRC32_ARM
+   while (len && ((uintptr_t)buf & 7))
+   {
+      crc = __crc32b(crc, *buf++);
+      len--;
+   }
+
+#if defined(__aarch64__)
+   for (; len >= 8; buf += 8, len -= 8)
+   {
+      uint64_t data;
+      memcpy(&data, buf, sizeof(data));
+      crc = __crc32d(crc, data);
+   }
+#else
+   for (; len >= 4; buf += 4, len -= 4)
+   {
+      uint32_t data;
+      memcpy(&data, buf, sizeof(data));
+      crc = __crc32w(crc, data);
+   }
+#endif
+
    while (len--)
+      crc = __crc32b(crc, *buf++);
+#else
+   if (len >= 16 && !crc32_slice_table_ready)
+      crc32_init_slice_table();
+
+   while (len && ((uintptr_t)buf & 3))
+   {
       crc = crc32_table[(crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
+      len--;
+   }
+
+   /* Slicing-by-8: 8 table lookups per 8 bytes, independent of
+    * each other, instead of a chain of 8 */
+   for (; len >= 8; buf += 8, len -= 8)
+   {
+      uint32_t lo, hi;
+      memcpy(&lo, buf,     sizeof(lo));
+      memcpy(&hi, buf + 4, sizeof(hi));
+      lo   = swap_if_big32(lo) ^ crc;
+      hi   = swap_if_big32(hi);
+      crc  = crc32_slice_table[6][ lo        & 0xff]
+           ^ crc32_slice_table[5][(lo >>  8) & 0xff]
+           ^ crc32_slice_table[4][(lo >> 16) & 0xff]
+           ^ crc32_slice_table[3][ lo >> 24        ]
+           ^ crc32_slice_table[2][ hi        & 0xff]
+           ^ crc32_slice_table[1][(hi >>  8) & 0xff]
+           ^ crc32_slice_table[0][(hi >> 16) & 0xff]
+           ^ crc32_table         [ hi >> 24        ];
+   }
+
+   while (len--)
+      crc = crc32_table[(crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
+#endif
 
    return crc ^ 0xffffffff;
 }
 
+static uint32_t crc32_gf2_times(const uint32_t *mat, uint32_t vec)
+{
+   uint32_t sum = 0;
+
+   for (; vec; vec >>= 1, mat++)
+      if (vec & 1)
+         sum ^= *mat;
+
+   return sum;
+}
+
+static void crc32_gf2_square(uint32_t *square, const uint32_t *mat)
+{
+   unsigned n;
+
+   for (n = 0; n < 32; n++)
+      square[n] = crc32_gf2_times(mat, mat[n]);
+}
+
+/**
+ * encoding_crc32_combine:
+ * @crc1                 : CRC32 of the first block.
+ * @crc2                 : CRC32 of the second block.
+ * @len2                 : Length of the second block.
+ *
+ * Same as zlib's crc32_combine, so that blocks can be hashed apart.
+ *
+ * Returns: the CRC32 of both blocks one after the other.
+ **/
+uint32_t encoding_crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+   unsigned n;
+   uint32_t row;
+   uint32_t even[32]; /* operator for an even number of zero bits */
+   uint32_t odd[32];  /* operator for an odd number of zero bits */
+
+   if (!len2)
+      return crc1;
+
+   /* Operator for one zero bit */
+   odd[0] = 0xedb88320UL;
+   row    = 1;
+   for (n = 1; n < 32; n++)
+   {
+      odd[n] = row;
+      row  <<= 1;
+   }
+
+   /* Two zero bits, then four */
+   crc32_gf2_square(even, odd);
+   crc32_gf2_square(odd, even);
+
+   /* Apply len2 zero bytes to crc1, the first squaring of the loop
+    * giving the operator for a zero byte */
+   do
+   {
+      crc32_gf2_square(even, odd);
+      if (len2 & 1)
+         crc1 = crc32_gf2_times(even, crc1);
+      len2 >>= 1;
+
+      if (!len2)
+         break;
+
+      crc32_gf2_square(odd, even);
+      if (len2 & 1)
+         crc1 = crc32_gf2_times(odd, crc1);
+      len2 >>= 1;
+   } while (len2);
+
+   return crc1 ^ crc2;
+}
+
+/* Reads are done in chunks of this size, each hashed on its own */
+#define CRC32_CHUNK_SIZE (256 * 1024)
+
+#ifdef HAVE_THREADS
+/* Chunks read ahead of the hashing, at most */
+#define CRC32_CHUNKS 6
+/* Hashing threads, at most */
+#define CRC32_MAX_WORKERS 3
+
+enum crc32_chunk_state
+{
+   CRC32_CHUNK_EMPTY = 0,
+   CRC32_CHUNK_READ,
+   CRC32_CHUNK_HASHED
+};
+
+struct crc32_pipe;
+
+typedef struct crc32_chunk
+{
+   struct crc32_pipe *pipe;
+   uint8_t *buf;
+   size_t len;
+   uint32_t crc;
+   enum crc32_chunk_state state;
+} crc32_chunk_t;
+
+typedef struct crc32_pipe
+{
+   slock_t *lock;
+   scond_t *cond;
+   crc32_chunk_t chunks[CRC32_CHUNKS];
+} crc32_pipe_t;
+
+static void crc32_hash_chunk(void *data)
+{
+   crc32_chunk_t *chunk = (crc32_chunk_t*)data;
+   crc32_pipe_t *pipe   = chunk->pipe;
+
+   /* Nothing else touches a chunk being hashed */
+   chunk->crc = encoding_crc32(0, chunk->buf, chunk->len);
+
+   slock_lock(pipe->lock);
+   chunk->state = CRC32_CHUNK_HASHED;
+   scond_broadcast(pipe->cond);
+   slock_unlock(pipe->lock);
+}
+
+/* Waits for the chunk to be hashed and adds it to the CRC so far.
+ * Must be called with the lock held. */
+static uint32_t crc32_pipe_collect(crc32_pipe_t *pipe,
+      crc32_chunk_t *chunk, uint32_t crc)
+{
+   if (chunk->state == CRC32_CHUNK_EMPTY)
+      return crc;
+
+   while (chunk->state != CRC32_CHUNK_HASHED)
+      scond_wait(pipe->cond, pipe->lock);
+
+   chunk->state = CRC32_CHUNK_EMPTY;
+   return encoding_crc32_combine(crc, chunk->crc, chunk->len);
+}
+
+/* Reads chunks while the ones read before are hashed on a thread
+ * pool, the CRC of each combined in order.
+ * Returns false if the pool couldn't be started. */
+static bool crc32_read_threaded(uint32_t *crc, encoding_crc32_read_t read,
+      void *data, uint64_t max_len, bool *error)
+{
+   unsigned i;
+   crc32_pipe_t pipe;
+   tpool_t *pool        = NULL;
+   unsigned num_workers = cpu_features_get_core_amount();
+   unsigned next        = 0;
+   bool started         = false;
+   uint64_t total       = 0;
+
+   /* One core is left for reading */
+   num_workers = num_workers > 1 ? num_workers - 1 : 1;
+   if (num_workers > CRC32_MAX_WORKERS)
+      num_workers = CRC32_MAX_WORKERS;
+
+   memset(&pipe, 0, sizeof(pipe));
+
+   pipe.lock = slock_new();
+   pipe.cond = scond_new();
+   if (!pipe.lock || !pipe.cond)
+      goto end;
+
+   for (i = 0; i < CRC32_CHUNKS; i++)
+   {
+      pipe.chunks[i].pipe = &pipe;
+      pipe.chunks[i].buf  = (uint8_t*)malloc(CRC32_CHUNK_SIZE);
+      if (!pipe.chunks[i].buf)
+         goto end;
+   }
+
+   if (!(pool = tpool_create_with_role(num_workers, STHREAD_ROLE_TASK)))
+      goto end;
+
+   started = true;
+
+   while (total < max_len)
+   {
+      int64_t nread;
+      crc32_chunk_t *chunk = &pipe.chunks[next];
+      size_t len           = CRC32_CHUNK_SIZE;
+
+      if (len > max_len - total)
+         len = (size_t)(max_len - total);
+
+      /* This one's turn to be added comes before the ones after it */
+      slock_lock(pipe.lock);
+      *crc = crc32_pipe_collect(&pipe, chunk, *crc);
+      slock_unlock(pipe.lock);
+
+      nread = read(data, chunk->buf, len);
+      if (nread <= 0)
+      {
+         if (nread < 0)
+            *error = true;
+         break;
+      }
+
+      chunk->len   = (size_t)nread;
+      chunk->state = CRC32_CHUNK_READ;
+      if (!tpool_add_work(pool, crc32_hash_chunk, chunk))
+      {
+         /* Hashed here then */
+         chunk->crc   = encoding_crc32(0, chunk->buf, chunk->len);
+         chunk->state = CRC32_CHUNK_HASHED;
+      }
+
+      total += nread;
+      next   = (next + 1) % CRC32_CHUNKS;
+
+      if ((size_t)nread < len)
+         break;
+   }
+
+   /* The rest, oldest first */
+   slock_lock(pipe.lock);
+   for (i = 0; i < CRC32_CHUNKS; i++)
+      *crc = crc32_pipe_collect(&pipe,
+            &pipe.chunks[(next + i) % CRC32_CHUNKS], *crc);
+   slock_unlock(pipe.lock);
+
+end:
+   tpool_destroy(pool);
+   for (i = 0; i < CRC32_CHUNKS; i++)
+      free(pipe.chunks[i].buf);
+   if (pipe.cond)
+      scond_free(pipe.cond);
+   if (pipe.lock)
+      slock_free(pipe.lock);
+
+   return started;
+}
+#endif
+
+/**
+ * encoding_crc32_read:
+ * @crc                  : CRC32 to continue from, updated with the one
+ *                         of what was read.
+ * @read                 : Reads into a buffer from what is hashed.
+ * @data                 : Passed to @read.
+ * @max_len              : Hashes no more than this many bytes.
+ *
+ * Hashes everything read up to the end or @max_len. With threads,
+ * big inputs are hashed while they are read, a chunk on each core.
+ *
+ * Returns: false if a read failed.
+ **/
+bool encoding_crc32_read(uint32_t *crc, encoding_crc32_read_t read,
+      void *data, uint64_t max_len)
+{
+   int64_t nread;
+   uint8_t *buf   = (uint8_t*)malloc(CRC32_CHUNK_SIZE);
+   bool error     = false;
+   uint64_t total = 0;
+
+   if (!buf)
+      return false;
+
+   for (;;)
+   {
+      size_t len = CRC32_CHUNK_SIZE;
+
+      if (len > max_len - total)
+         len = (size_t)(max_len - total);
+      if (!len)
+         break;
+
+      nread = read(data, buf, len);
+      if (nread <= 0)
+      {
+         error = nread < 0;
+         break;
+      }
+
+      *crc   = encoding_crc32(*crc, buf, (size_t)nread);
+      total += nread;
+
+      if ((size_t)nread < len)
+         break;
+
+#ifdef HAVE_THREADS
+      /* More than a chunk, worth the threads */
+      if (crc32_read_threaded(crc, read, data, max_len - total, &error))
+         break;
+#endif
+   }
+
+   free(buf);
+   return !error;
+}
+
 #define CRC32_BUFFER_SIZE 1048576
 #define CRC32_MAX_MB 64
 
@@ -101,40 +485,26 @@ uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len)
  *
  * Returns: the crc32, or 0 if there was an error.
  */
+static int64_t file_crc32_read(void *data, void *buf, uint64_t len)
+{
+   return filestream_read((RFILE*)data, buf, len);
+}
+
 uint32_t file_crc32(uint32_t crc, const char *path)
 {
-   unsigned i;
    RFILE *file        = NULL;
-   unsigned char *buf = NULL;
+   bool ok;
+
    if (!path)
       return 0;
 
    file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ, 0);
    if (!file)
-      goto error;
-
-   buf = (unsigned char*)malloc(CRC32_BUFFER_SIZE);
-   if (!buf)
-      goto error;
-
-   for(i = 0; i < CRC32_MAX_MB; i++)
-   {
-      int64_t nread = filestream_read(file, buf, CRC32_BUFFER_SIZE);
-      if (nread < 0)		
-         goto error;
+      return 0;
 
-      crc = encoding_crc32(crc, buf, (size_t)nread);
-      if (filestream_eof(file))
-         break;
-   }
-   free(buf);
+   ok = encoding_crc32_read(&crc, file_crc32_read, file,
+         (uint64_t)CRC32_BUFFER_SIZE * CRC32_MAX_MB);
    filestream_close(file);
-   return crc;
-
-error:
-   if (buf)
-      free(buf);
-   if (file)
-      filestream_close(file);
-   return 0;
+
+   return ok ? crc : 0;
 }
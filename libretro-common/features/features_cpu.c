@@ -760,6 +760,9 @@ uint64_t cpu_features_get(void)
 #ifdef __ARM_NEON__
       cpu |= RETRO_SIMD_NEON;
       arm_enable_runfast_mode();
+#elif defined(__aarch64__)
+      /* AdvSIMD is what NEON is called on AArch64. */
+      cpu |= RETRO_SIMD_NEON;
 #endif
    }
 
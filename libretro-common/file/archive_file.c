@@ -883,3 +883,24 @@ uint32_t file_archive_get_file_crc32(const char *path)
 
    return 0;
 }
+
+void file_archive_cache_init(void)
+{
+#ifdef HAVE_7ZIP
+   sevenzip_cache_init();
+#endif
+}
+
+void file_archive_cache_trim(void)
+{
+#ifdef HAVE_7ZIP
+   sevenzip_cache_trim();
+#endif
+}
+
+void file_archive_cache_deinit(void)
+{
+#ifdef HAVE_7ZIP
+   sevenzip_cache_deinit();
+#endif
+}
@@ -36,6 +36,10 @@
 #include <7zip/7zCrc.h>
 #include <7zip/7zFile.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define SEVENZIP_MAGIC "7z\xBC\xAF\x27\x1C"
 #define SEVENZIP_MAGIC_LEN 6
 
@@ -46,20 +50,44 @@
 #endif
 #endif
 
-struct sevenzip_context_t {
+/* Solid blocks decoded bigger than this aren't kept around */
+#define SEVENZIP_CACHE_MAX_BLOCK (64 * 1024 * 1024)
+
+/* An open archive with its header parsed, and the last solid block
+ * decoded from it */
+typedef struct sevenzip_archive
+{
    CFileInStream archiveStream;
    CLookToRead lookStream;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
    CSzArEx db;
-   size_t temp_size;
+   uint8_t *output;
+   size_t output_size;
    uint32_t block_index;
+   int32_t size;
+   char path[PATH_MAX_LENGTH];
+} sevenzip_archive_t;
+
+struct sevenzip_context_t {
+   sevenzip_archive_t *archive;
    uint32_t index;
    uint32_t packIndex;
-   uint8_t *output;
    file_archive_file_handle_t *handle;
 };
 
+/* The last archive done with stays open, so that browsing it or
+ * reading another file from the same solid block doesn't start
+ * over. Whoever uses it takes it out of the cache meanwhile. */
+static sevenzip_archive_t *sevenzip_cache = NULL;
+static bool sevenzip_cache_enable         = false;
+#ifdef HAVE_THREADS
+static slock_t *sevenzip_cache_lock       = NULL;
+#define sevenzip_cache_lock()   slock_lock(sevenzip_cache_lock)
+#define sevenzip_cache_unlock() slock_unlock(sevenzip_cache_lock)
+#else
+#define sevenzip_cache_lock()
+#define sevenzip_cache_unlock()
+#endif
+
 static void *sevenzip_stream_alloc_impl(void *p, size_t size)
 {
    if (size == 0)
@@ -83,66 +111,32 @@ static void *sevenzip_stream_alloc_tmp_impl(void *p, size_t size)
    return malloc(size);
 }
 
-static void* sevenzip_stream_new(void)
-{
-   struct sevenzip_context_t *sevenzip_context =
-         (struct sevenzip_context_t*)calloc(1, sizeof(struct sevenzip_context_t));
-
-   /* These are the allocation routines - currently using
-    * the non-standard 7zip choices. */
-   sevenzip_context->allocImp.Alloc     = sevenzip_stream_alloc_impl;
-   sevenzip_context->allocImp.Free      = sevenzip_stream_free_impl;
-   sevenzip_context->allocTempImp.Alloc = sevenzip_stream_alloc_tmp_impl;
-   sevenzip_context->allocTempImp.Free  = sevenzip_stream_free_impl;
-   sevenzip_context->block_index        = 0xFFFFFFFF;
-   sevenzip_context->output             = NULL;
-   sevenzip_context->handle             = NULL;
+/* These are the allocation routines - currently using
+ * the non-standard 7zip choices. */
+static ISzAlloc sevenzip_alloc_imp      = {
+   sevenzip_stream_alloc_impl, sevenzip_stream_free_impl };
+static ISzAlloc sevenzip_alloc_temp_imp = {
+   sevenzip_stream_alloc_tmp_impl, sevenzip_stream_free_impl };
 
-   return sevenzip_context;
-}
-
-static void sevenzip_stream_free(void *data)
+static void sevenzip_archive_close(sevenzip_archive_t *archive)
 {
-   struct sevenzip_context_t *sevenzip_context = (struct sevenzip_context_t*)data;
-
-   if (!sevenzip_context)
+   if (!archive)
       return;
 
-   if (sevenzip_context->output)
-   {
-      IAlloc_Free(&sevenzip_context->allocImp, sevenzip_context->output);
-      sevenzip_context->output       = NULL;
-      sevenzip_context->handle->data = NULL;
-   }
-
-   SzArEx_Free(&sevenzip_context->db, &sevenzip_context->allocImp);
-   File_Close(&sevenzip_context->archiveStream.file);
+   if (archive->output)
+      IAlloc_Free(&sevenzip_alloc_imp, archive->output);
+   SzArEx_Free(&archive->db, &sevenzip_alloc_imp);
+   File_Close(&archive->archiveStream.file);
+   free(archive);
 }
 
-/* Extract the relative path (needle) from a 7z archive
- * (path) and allocate a buf for it to write it in.
- * If optional_outfile is set, extract to that instead
- * and don't allocate buffer.
- */
-static int sevenzip_file_read(
-      const char *path,
-      const char *needle, void **buf,
-      const char *optional_outfile)
+static sevenzip_archive_t *sevenzip_archive_open(const char *path)
 {
-   CFileInStream archiveStream;
-   CLookToRead lookStream;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
-   CSzArEx db;
-   uint8_t *output      = 0;
-   long outsize         = -1;
+   sevenzip_archive_t *archive = (sevenzip_archive_t*)
+      calloc(1, sizeof(*archive));
 
-   /*These are the allocation routines.
-    * Currently using the non-standard 7zip choices. */
-   allocImp.Alloc       = sevenzip_stream_alloc_impl;
-   allocImp.Free        = sevenzip_stream_free_impl;
-   allocTempImp.Alloc   = sevenzip_stream_alloc_tmp_impl;
-   allocTempImp.Free    = sevenzip_stream_free_impl;
+   if (!archive)
+      return NULL;
 
 #if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
    if (!string_is_empty(path))
@@ -152,10 +146,11 @@ static int sevenzip_file_read(
       if (pathW)
       {
          /* Could not open 7zip archive? */
-         if (InFile_OpenW(&archiveStream.file, pathW))
+         if (InFile_OpenW(&archive->archiveStream.file, pathW))
          {
             free(pathW);
-            return -1;
+            free(archive);
+            return NULL;
          }
 
          free(pathW);
@@ -163,142 +158,279 @@ static int sevenzip_file_read(
    }
 #else
    /* Could not open 7zip archive? */
-   if (InFile_Open(&archiveStream.file, path))
-      return -1;
+   if (InFile_Open(&archive->archiveStream.file, path))
+   {
+      free(archive);
+      return NULL;
+   }
 #endif
 
-   FileInStream_CreateVTable(&archiveStream);
-   LookToRead_CreateVTable(&lookStream, false);
-   lookStream.realStream = &archiveStream.s;
-   LookToRead_Init(&lookStream);
+   FileInStream_CreateVTable(&archive->archiveStream);
+   LookToRead_CreateVTable(&archive->lookStream, false);
+   archive->lookStream.realStream = &archive->archiveStream.s;
+   LookToRead_Init(&archive->lookStream);
    CrcGenerateTable();
+   SzArEx_Init(&archive->db);
 
-   db.db.PackSizes               = NULL;
-   db.db.PackCRCsDefined         = NULL;
-   db.db.PackCRCs                = NULL;
-   db.db.Folders                 = NULL;
-   db.db.Files                   = NULL;
-   db.db.NumPackStreams          = 0;
-   db.db.NumFolders              = 0;
-   db.db.NumFiles                = 0;
-   db.startPosAfterHeader        = 0;
-   db.dataPos                    = 0;
-   db.FolderStartPackStreamIndex = NULL;
-   db.PackStreamStartPositions   = NULL;
-   db.FolderStartFileIndex       = NULL;
-   db.FileIndexToFolderIndexMap  = NULL;
-   db.FileNameOffsets            = NULL;
-   db.FileNames.data             = NULL;
-   db.FileNames.size             = 0;
-
-   SzArEx_Init(&db);
-
-   if (SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp) == SZ_OK)
+   if (SzArEx_Open(&archive->db, &archive->lookStream.s,
+         &sevenzip_alloc_imp, &sevenzip_alloc_temp_imp) != SZ_OK)
    {
-      uint32_t i;
-      bool file_found      = false;
-      uint16_t *temp       = NULL;
-      size_t temp_size     = 0;
-      uint32_t block_index = 0xFFFFFFFF;
-      SRes res             = SZ_OK;
-
-      for (i = 0; i < db.db.NumFiles; i++)
-      {
-         size_t len;
-         char infile[PATH_MAX_LENGTH];
-         size_t offset                = 0;
-         size_t outSizeProcessed      = 0;
-         const CSzFileItem    *f      = db.db.Files + i;
+      sevenzip_archive_close(archive);
+      return NULL;
+   }
 
-         /* We skip over everything which is not a directory.
-          * FIXME: Why continue then if f->IsDir is true?*/
-         if (f->IsDir)
-            continue;
+   archive->block_index = 0xFFFFFFFF;
+   archive->size        = path_get_size(path);
+   strlcpy(archive->path, path, sizeof(archive->path));
 
-         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
+   return archive;
+}
 
-         if (len > temp_size)
-         {
-            if (temp)
-               free(temp);
-            temp_size = len;
-            temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]));
+/* Returns the cached archive if it's this one and hasn't changed
+ * since, or opens it. */
+static sevenzip_archive_t *sevenzip_archive_acquire(const char *path)
+{
+   sevenzip_archive_t *archive = NULL;
 
-            if (temp == 0)
-            {
-               res = SZ_ERROR_MEM;
-               break;
-            }
-         }
+   sevenzip_cache_lock();
+   if (sevenzip_cache && string_is_equal(sevenzip_cache->path, path))
+   {
+      archive        = sevenzip_cache;
+      sevenzip_cache = NULL;
+   }
+   sevenzip_cache_unlock();
 
-         SzArEx_GetFileNameUtf16(&db, i, temp);
-         res       = SZ_ERROR_FAIL;
-         infile[0] = '\0';
+   if (archive && archive->size == path_get_size(path))
+      return archive;
 
-         if (temp)
-            res = utf16_to_char_string(temp, infile, sizeof(infile))
-               ? SZ_OK : SZ_ERROR_FAIL;
+   sevenzip_archive_close(archive);
+   return sevenzip_archive_open(path);
+}
 
-         if (string_is_equal(infile, needle))
-         {
-            size_t output_size   = 0;
+/* Puts the archive in the cache, in place of the one there */
+static void sevenzip_archive_release(sevenzip_archive_t *archive)
+{
+   sevenzip_archive_t *old = archive;
 
-            /* C LZMA SDK does not support chunked extraction - see here:
-             * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
-             * */
-            file_found = true;
-            res = SzArEx_Extract(&db, &lookStream.s, i, &block_index,
-                  &output, &output_size, &offset, &outSizeProcessed,
-                  &allocImp, &allocTempImp);
+   if (!archive)
+      return;
 
-            if (res != SZ_OK)
-               break; /* This goes to the error section. */
+   if (archive->output_size > SEVENZIP_CACHE_MAX_BLOCK)
+   {
+      IAlloc_Free(&sevenzip_alloc_imp, archive->output);
+      archive->output      = NULL;
+      archive->output_size = 0;
+      archive->block_index = 0xFFFFFFFF;
+   }
 
-            outsize = outSizeProcessed;
+   sevenzip_cache_lock();
+   if (sevenzip_cache_enable)
+   {
+      old            = sevenzip_cache;
+      sevenzip_cache = archive;
+   }
+   sevenzip_cache_unlock();
 
-            if (optional_outfile)
-            {
-               const void *ptr = (const void*)(output + offset);
-
-               if (!filestream_write_file(optional_outfile, ptr, outsize))
-               {
-                  res        = SZ_OK;
-                  file_found = true;
-                  outsize    = -1;
-               }
-            }
-            else
-            {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc(outsize + 1);
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf,output + offset,outsize);
-            }
+   sevenzip_archive_close(old);
+}
+
+/**
+ * sevenzip_cache_init:
+ *
+ * Keeps the last archive open from now on.
+ **/
+void sevenzip_cache_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!sevenzip_cache_lock)
+      sevenzip_cache_lock = slock_new();
+   if (!sevenzip_cache_lock)
+      return;
+#endif
+   sevenzip_cache_enable = true;
+}
+
+/**
+ * sevenzip_cache_trim:
+ *
+ * Frees the solid block kept decoded, the header stays parsed.
+ **/
+void sevenzip_cache_trim(void)
+{
+   if (!sevenzip_cache_enable)
+      return;
+
+   sevenzip_cache_lock();
+   if (sevenzip_cache && sevenzip_cache->output)
+   {
+      IAlloc_Free(&sevenzip_alloc_imp, sevenzip_cache->output);
+      sevenzip_cache->output      = NULL;
+      sevenzip_cache->output_size = 0;
+      sevenzip_cache->block_index = 0xFFFFFFFF;
+   }
+   sevenzip_cache_unlock();
+}
+
+void sevenzip_cache_deinit(void)
+{
+   sevenzip_archive_t *archive;
+
+   if (!sevenzip_cache_enable)
+      return;
+
+   sevenzip_cache_lock();
+   archive               = sevenzip_cache;
+   sevenzip_cache        = NULL;
+   sevenzip_cache_enable = false;
+   sevenzip_cache_unlock();
+
+   sevenzip_archive_close(archive);
+#ifdef HAVE_THREADS
+   slock_free(sevenzip_cache_lock);
+   sevenzip_cache_lock = NULL;
+#endif
+}
+
+static void* sevenzip_stream_new(void)
+{
+   struct sevenzip_context_t *sevenzip_context =
+         (struct sevenzip_context_t*)calloc(1, sizeof(struct sevenzip_context_t));
+
+   return sevenzip_context;
+}
+
+static void sevenzip_stream_free(void *data)
+{
+   struct sevenzip_context_t *sevenzip_context = (struct sevenzip_context_t*)data;
+
+   if (!sevenzip_context)
+      return;
+
+   sevenzip_archive_release(sevenzip_context->archive);
+   sevenzip_context->archive = NULL;
+}
+
+/* Extract the relative path (needle) from a 7z archive
+ * (path) and allocate a buf for it to write it in.
+ * If optional_outfile is set, extract to that instead
+ * and don't allocate buffer.
+ */
+static int sevenzip_file_read(
+      const char *path,
+      const char *needle, void **buf,
+      const char *optional_outfile)
+{
+   uint32_t i;
+   sevenzip_archive_t *archive = sevenzip_archive_acquire(path);
+   bool file_found             = false;
+   uint16_t *temp              = NULL;
+   size_t temp_size            = 0;
+   SRes res                    = SZ_OK;
+   long outsize                = -1;
+
+   if (!archive)
+      return -1;
+
+   for (i = 0; i < archive->db.db.NumFiles; i++)
+   {
+      size_t len;
+      char infile[PATH_MAX_LENGTH];
+      size_t offset                = 0;
+      size_t outSizeProcessed      = 0;
+      const CSzFileItem    *f      = archive->db.db.Files + i;
+
+      /* We skip over everything which is not a directory.
+       * FIXME: Why continue then if f->IsDir is true?*/
+      if (f->IsDir)
+         continue;
+
+      len = SzArEx_GetFileNameUtf16(&archive->db, i, NULL);
+
+      if (len > temp_size)
+      {
+         if (temp)
+            free(temp);
+         temp_size = len;
+         temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]));
+
+         if (temp == 0)
+         {
+            res = SZ_ERROR_MEM;
             break;
          }
       }
 
+      SzArEx_GetFileNameUtf16(&archive->db, i, temp);
+      res       = SZ_ERROR_FAIL;
+      infile[0] = '\0';
+
       if (temp)
-         free(temp);
-      IAlloc_Free(&allocImp, output);
+         res = utf16_to_char_string(temp, infile, sizeof(infile))
+            ? SZ_OK : SZ_ERROR_FAIL;
 
-      if (!(file_found && res == SZ_OK))
+      if (string_is_equal(infile, needle))
       {
-         /* Error handling
+         /* C LZMA SDK does not support chunked extraction - see here:
+          * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
           *
-          * Failed to open compressed file inside 7zip archive.
-          */
+          * The whole solid block is decoded, and kept for the other
+          * files in it.
+          * */
+         file_found = true;
+         res = SzArEx_Extract(&archive->db, &archive->lookStream.s, i,
+               &archive->block_index, &archive->output,
+               &archive->output_size, &offset, &outSizeProcessed,
+               &sevenzip_alloc_imp, &sevenzip_alloc_temp_imp);
 
-         outsize    = -1;
+         if (res != SZ_OK)
+         {
+            /* Don't trust what's left decoded */
+            archive->block_index = 0xFFFFFFFF;
+            break; /* This goes to the error section. */
+         }
+
+         outsize = outSizeProcessed;
+
+         if (optional_outfile)
+         {
+            const void *ptr = (const void*)(archive->output + offset);
+
+            if (!filestream_write_file(optional_outfile, ptr, outsize))
+            {
+               res        = SZ_OK;
+               file_found = true;
+               outsize    = -1;
+            }
+         }
+         else
+         {
+            /*We could either use the 7Zip allocated buffer,
+             * or create our own and use it.
+             * We would however need to realloc anyways, because RetroArch
+             * expects a \0 at the end, therefore we allocate new,
+             * copy and free the old one. */
+            *buf = malloc(outsize + 1);
+            ((char*)(*buf))[outsize] = '\0';
+            memcpy(*buf, archive->output + offset, outsize);
+         }
+         break;
       }
    }
 
-   SzArEx_Free(&db, &allocImp);
-   File_Close(&archiveStream.file);
+   if (temp)
+      free(temp);
+
+   if (!(file_found && res == SZ_OK))
+   {
+      /* Error handling
+       *
+       * Failed to open compressed file inside 7zip archive.
+       */
+
+      outsize    = -1;
+   }
+
+   sevenzip_archive_release(archive);
 
    return (int)outsize;
 }
@@ -323,22 +455,25 @@ static int sevenzip_stream_decompress_data_to_file_iterate(void *data)
    struct sevenzip_context_t *sevenzip_context =
          (struct sevenzip_context_t*)data;
 
-   SRes res                = SZ_ERROR_FAIL;
-   size_t output_size      = 0;
-   size_t offset           = 0;
-   size_t outSizeProcessed = 0;
+   sevenzip_archive_t *archive = sevenzip_context->archive;
+   SRes res                    = SZ_ERROR_FAIL;
+   size_t offset               = 0;
+   size_t outSizeProcessed     = 0;
 
-   res = SzArEx_Extract(&sevenzip_context->db,
-         &sevenzip_context->lookStream.s, sevenzip_context->index,
-         &sevenzip_context->block_index, &sevenzip_context->output,
-         &output_size, &offset, &outSizeProcessed,
-         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp);
+   res = SzArEx_Extract(&archive->db,
+         &archive->lookStream.s, sevenzip_context->index,
+         &archive->block_index, &archive->output,
+         &archive->output_size, &offset, &outSizeProcessed,
+         &sevenzip_alloc_imp, &sevenzip_alloc_temp_imp);
 
    if (res != SZ_OK)
+   {
+      archive->block_index = 0xFFFFFFFF;
       return 0;
+   }
 
    if (sevenzip_context->handle)
-      sevenzip_context->handle->data = sevenzip_context->output + offset;
+      sevenzip_context->handle->data = archive->output + offset;
 
    return 1;
 }
@@ -346,57 +481,29 @@ static int sevenzip_stream_decompress_data_to_file_iterate(void *data)
 static int sevenzip_parse_file_init(file_archive_transfer_t *state,
       const char *file)
 {
-   struct sevenzip_context_t *sevenzip_context =
-         (struct sevenzip_context_t*)sevenzip_stream_new();
+   struct sevenzip_context_t *sevenzip_context = NULL;
 
    if (state->archive_size < SEVENZIP_MAGIC_LEN)
-      goto error;
+      return -1;
 
    if (string_is_not_equal_fast(state->data, SEVENZIP_MAGIC, SEVENZIP_MAGIC_LEN))
-      goto error;
+      return -1;
 
-   state->stream = sevenzip_context;
+   sevenzip_context = (struct sevenzip_context_t*)sevenzip_stream_new();
+   if (!sevenzip_context)
+      return -1;
 
-#if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
-   if (!string_is_empty(file))
+   /* Browsing it again doesn't parse the header again */
+   sevenzip_context->archive = sevenzip_archive_acquire(file);
+   if (!sevenzip_context->archive)
    {
-      wchar_t *fileW = utf8_to_utf16_string_alloc(file);
-
-      if (fileW)
-      {
-         /* could not open 7zip archive? */
-         if (InFile_OpenW(&sevenzip_context->archiveStream.file, fileW))
-         {
-            free(fileW);
-            goto error;
-         }
-
-         free(fileW);
-      }
+      free(sevenzip_context);
+      return -1;
    }
-#else
-   /* could not open 7zip archive? */
-   if (InFile_Open(&sevenzip_context->archiveStream.file, file))
-      goto error;
-#endif
-
-   FileInStream_CreateVTable(&sevenzip_context->archiveStream);
-   LookToRead_CreateVTable(&sevenzip_context->lookStream, false);
-   sevenzip_context->lookStream.realStream = &sevenzip_context->archiveStream.s;
-   LookToRead_Init(&sevenzip_context->lookStream);
-   CrcGenerateTable();
-   SzArEx_Init(&sevenzip_context->db);
 
-   if (SzArEx_Open(&sevenzip_context->db, &sevenzip_context->lookStream.s,
-         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp) != SZ_OK)
-      goto error;
+   state->stream = sevenzip_context;
 
    return 0;
-
-error:
-   if (sevenzip_context)
-      sevenzip_stream_free(sevenzip_context);
-   return -1;
 }
 
 static int sevenzip_parse_file_iterate_step_internal(
@@ -406,17 +513,18 @@ static int sevenzip_parse_file_iterate_step_internal(
       unsigned *payback, struct archive_extract_userdata *userdata)
 {
    struct sevenzip_context_t *sevenzip_context = (struct sevenzip_context_t*)state->stream;
-   const CSzFileItem *file = sevenzip_context->db.db.Files + sevenzip_context->index;
+   CSzArEx *db             = &sevenzip_context->archive->db;
+   const CSzFileItem *file = db->db.Files + sevenzip_context->index;
 
-   if (sevenzip_context->index < sevenzip_context->db.db.NumFiles)
+   if (sevenzip_context->index < db->db.NumFiles)
    {
-      size_t len = SzArEx_GetFileNameUtf16(&sevenzip_context->db,
+      size_t len = SzArEx_GetFileNameUtf16(db,
             sevenzip_context->index, NULL);
       uint64_t compressed_size = 0;
 
-      if (sevenzip_context->packIndex < sevenzip_context->db.db.NumPackStreams)
+      if (sevenzip_context->packIndex < db->db.NumPackStreams)
       {
-         compressed_size = sevenzip_context->db.db.PackSizes[sevenzip_context->packIndex];
+         compressed_size = db->db.PackSizes[sevenzip_context->packIndex];
          sevenzip_context->packIndex++;
       }
 
@@ -431,8 +539,7 @@ static int sevenzip_parse_file_iterate_step_internal(
 
          infile[0] = '\0';
 
-         SzArEx_GetFileNameUtf16(&sevenzip_context->db, sevenzip_context->index,
-               temp);
+         SzArEx_GetFileNameUtf16(db, sevenzip_context->index, temp);
 
          if (temp)
          {
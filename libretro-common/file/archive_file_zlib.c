@@ -125,48 +125,97 @@ static uint32_t zlib_stream_crc32_calculate(uint32_t crc,
    return encoding_crc32(crc, data, length);
 }
 
-static bool zip_file_decompressed_handle(
-      file_archive_file_handle_t *handle,
-      const uint8_t *cdata, uint32_t csize,
-      uint32_t size, uint32_t crc32)
+/* Members are inflated this much at a time, so that each piece
+ * is checksummed (and written out) while still in the cache. */
+#define ZIP_CHUNK_SIZE (256 * 1024)
+
+/* Inflates (or copies, if stored) a member in one pass, either
+ * straight into buf, which holds size bytes, or through buf,
+ * which holds ZIP_CHUNK_SIZE bytes, into file. The CRC32 of the
+ * data is computed along the way. */
+static bool zip_file_inflate(const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size, uint8_t *buf, RFILE *file,
+      uint32_t *crc)
 {
-   int ret   = 0;
+   void *stream  = NULL;
+   uint32_t done = 0;
+   bool ret      = true;
+
+   *crc          = 0;
+
+   if (cmode == ARCHIVE_MODE_COMPRESSED)
+   {
+      stream = zlib_inflate_backend.stream_new();
+      if (!stream)
+         return false;
 
-   handle->backend = &zlib_backend;
+      if (zlib_inflate_backend.define)
+         zlib_inflate_backend.define(stream, "window_bits", (uint32_t)-MAX_WBITS);
 
-   if (!handle->backend->stream_decompress_data_to_file_init(
-            handle, cdata, csize, size))
+      zlib_inflate_backend.set_in(stream, cdata, csize);
+   }
+   else if (cmode != ARCHIVE_MODE_UNCOMPRESSED || csize != size)
       return false;
 
-   do
+   while (done < size)
    {
-      ret = handle->backend->stream_decompress_data_to_file_iterate(
-            handle->stream);
-   }while(ret == 0);
+      const uint8_t *chunk = NULL;
+      uint32_t len         = MIN(size - done, ZIP_CHUNK_SIZE);
+      uint8_t *out         = file ? buf : buf + done;
 
-#if 0
-   handle->real_checksum = handle->backend->stream_crc_calculate(0,
-         handle->data, size);
+      if (stream)
+      {
+         uint32_t filled = 0;
 
-   if (handle->real_checksum != crc32)
-      goto error;
-#endif
+         zlib_inflate_backend.set_out(stream, out, len);
 
-   if (handle->stream)
-      free(handle->stream);
+         while (filled < len)
+         {
+            uint32_t rd = 0, wn = 0;
+            enum trans_stream_error terror;
 
-   return true;
-#if 0
-error:
-   if (handle->stream)
-      free(handle->stream);
-   if (handle->data)
-      free(handle->data);
+            if (!zlib_inflate_backend.trans(stream, false, &rd, &wn, &terror)
+                  && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+               break;
 
-   handle->stream = NULL;
-   handle->data   = NULL;
-   return false;
-#endif
+            filled += wn;
+
+            /* Ended early, or truncated */
+            if (terror == TRANS_STREAM_ERROR_NONE || (!rd && !wn))
+               break;
+         }
+
+         if (filled != len)
+         {
+            ret = false;
+            break;
+         }
+
+         chunk = out;
+      }
+      else if (file)
+         chunk = cdata + done;
+      else
+      {
+         memcpy(out, cdata + done, len);
+         chunk = out;
+      }
+
+      *crc = encoding_crc32(*crc, chunk, len);
+
+      if (file && filestream_write(file, chunk, len) != len)
+      {
+         ret = false;
+         break;
+      }
+
+      done += len;
+   }
+
+   if (stream)
+      zlib_inflate_backend.stream_free(stream);
+
+   return ret;
 }
 
 /* Extract the relative path (needle) from a
@@ -189,48 +238,57 @@ static int zip_file_decompressed(
 
    if (strstr(name, userdata->decomp_state.needle))
    {
-      bool goto_error = false;
-      file_archive_file_handle_t handle = {0};
+      uint32_t real_crc32 = 0;
+      bool ok             = false;
 
-      userdata->decomp_state.found = true;
-
-      if (zip_file_decompressed_handle(&handle,
-               cdata, csize, size, crc32))
+      if (userdata->decomp_state.opt_file != 0)
       {
-         if (userdata->decomp_state.opt_file != 0)
-         {
-            /* Called in case core has need_fullpath enabled. */
-            char *buf       = (char*)malloc(size);
-
-            if (buf)
-            {
-               memcpy(buf, handle.data, size);
-
-               if (!filestream_write_file(userdata->decomp_state.opt_file, buf, size))
-                  goto_error = true;
-            }
+         /* Called in case core has need_fullpath enabled.
+          * Streamed to the file without holding all of it. */
+         uint8_t *chunk = (uint8_t*)malloc(ZIP_CHUNK_SIZE);
+         RFILE *file    = filestream_open(userdata->decomp_state.opt_file,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+         if (chunk && file)
+            ok = zip_file_inflate(cdata, cmode, csize, size,
+                  chunk, file, &real_crc32);
+
+         if (file && filestream_close(file) != 0)
+            ok = false;
+         free(chunk);
+
+         userdata->decomp_state.size = 0;
+      }
+      else
+      {
+         /* Called in case core has need_fullpath disabled.
+          * Inflated directly into RetroArch's ROM buffer. */
+         uint8_t *buf = (uint8_t*)malloc(size ? size : 1);
 
-            free(buf);
+         if (buf)
+            ok = zip_file_inflate(cdata, cmode, csize, size,
+                  buf, NULL, &real_crc32);
 
-            userdata->decomp_state.size = 0;
-         }
-         else
+         if (ok && real_crc32 == crc32)
          {
-            /* Called in case core has need_fullpath disabled.
-             * Will copy decompressed content directly into
-             * RetroArch's ROM buffer. */
-            *userdata->decomp_state.buf = malloc(size);
-            memcpy(*userdata->decomp_state.buf, handle.data, size);
-
+            *userdata->decomp_state.buf = buf;
             userdata->decomp_state.size = size;
          }
+         else
+            free(buf);
       }
 
-      if (handle.data)
-         free(handle.data);
-
-      if (goto_error)
+      /* Corrupt or unsupported, read as not found */
+      if (!ok || real_crc32 != crc32)
+      {
+         if (userdata->decomp_state.opt_file)
+            filestream_delete(userdata->decomp_state.opt_file);
+         userdata->decomp_state.found = false;
          return 0;
+      }
+
+      userdata->decomp_state.found = true;
    }
 
    return 1;
@@ -51,6 +51,9 @@
 
 #define MAX_INCLUDE_DEPTH 16
 
+/* Smallest size of the map of the keys of a config file */
+#define CONFIG_MAP_MIN_SIZE 64
+
 struct config_entry_list
 {
    /* If we got this from an #include,
@@ -71,10 +74,133 @@ struct config_include_list
 static config_file_t *config_file_new_internal(
       const char *path, unsigned depth, config_file_cb_t *cb);
 
+/* Keys are looked up in an open addressed map of the entry found for
+ * each of them, the first one in the list. It's made on the first
+ * lookup and kept up to date as entries are added, or dropped to be
+ * made again when the order of the list changes. */
+
+static uint32_t config_map_hash(const char *key)
+{
+   uint32_t hash = 5381;
+
+   while (*key)
+      hash = (hash << 5) + hash + (uint8_t)*key++;
+
+   return hash;
+}
+
+static void config_map_free(config_file_t *conf)
+{
+   free(conf->map);
+   conf->map       = NULL;
+   conf->map_size  = 0;
+   conf->map_count = 0;
+}
+
+/* Slot of @key, or the empty one where it would go */
+static struct config_entry_list **config_map_slot(
+      const config_file_t *conf, const char *key)
+{
+   size_t mask = conf->map_size - 1;
+   size_t i    = config_map_hash(key) & mask;
+
+   while (conf->map[i] && !string_is_equal(conf->map[i]->key, key))
+      i = (i + 1) & mask;
+
+   return &conf->map[i];
+}
+
+static bool config_map_resize(config_file_t *conf, size_t size)
+{
+   size_t i;
+   struct config_entry_list **old = conf->map;
+   size_t old_size                = conf->map_size;
+   struct config_entry_list **map = (struct config_entry_list**)
+      calloc(size, sizeof(*map));
+
+   if (!map)
+      return false;
+
+   conf->map      = map;
+   conf->map_size = size;
+
+   for (i = 0; i < old_size; i++)
+      if (old[i])
+         *config_map_slot(conf, old[i]->key) = old[i];
+
+   free(old);
+   return true;
+}
+
+/* Makes @entry the one found for its key, unless there's one already
+ * and it goes after it in the list */
+static void config_map_add(config_file_t *conf,
+      struct config_entry_list *entry, bool in_front)
+{
+   struct config_entry_list **slot = NULL;
+
+   if (!conf->map || !entry->key)
+      return;
+
+   /* Kept at most three quarters full */
+   if (     (conf->map_count + 1) * 4 > conf->map_size * 3
+         && !config_map_resize(conf, conf->map_size * 2))
+   {
+      /* Made again on the next lookup */
+      config_map_free(conf);
+      return;
+   }
+
+   slot = config_map_slot(conf, entry->key);
+   if (!*slot)
+   {
+      *slot = entry;
+      conf->map_count++;
+   }
+   else if (in_front)
+      *slot = entry;
+}
+
+static void config_map_build(config_file_t *conf)
+{
+   struct config_entry_list *entry = NULL;
+   size_t count                    = 0;
+   size_t size                     = CONFIG_MAP_MIN_SIZE;
+
+   config_map_free(conf);
+
+   for (entry = conf->entries; entry; entry = entry->next)
+      count++;
+   while ((count + 1) * 4 > size * 3)
+      size *= 2;
+
+   conf->map = (struct config_entry_list**)calloc(size, sizeof(*conf->map));
+   if (!conf->map)
+      return;
+   conf->map_size = size;
+
+   for (entry = conf->entries; entry; entry = entry->next)
+      config_map_add(conf, entry, false);
+}
+
+/* Puts @entry at the end of the list */
+static void config_append_entry(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   if (conf->tail)
+      conf->tail->next = entry;
+   else
+      conf->entries    = entry;
+
+   conf->tail          = entry;
+   config_map_add(conf, entry, false);
+}
+
 static int config_sort_compare_func(struct config_entry_list *a,
       struct config_entry_list *b)
 {
-   return (a && b) ? strcasecmp(a->key, b->key) : 0;
+   /* Unset entries have no key */
+   return (a && b && a->key && b->key) ? strcasecmp(a->key, b->key) : 0;
 }
 
 /* https://stackoverflow.com/questions/7685/merge-sort-a-linked-list */
@@ -227,45 +353,20 @@ static char *extract_value(char *line, bool is_value)
 static void add_child_list(config_file_t *parent, config_file_t *child)
 {
    struct config_entry_list *list = child->entries;
-   if (parent->entries)
-   {
-      struct config_entry_list *head = parent->entries;
-      while (head->next)
-         head = head->next;
 
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      head->next        = child->entries;
-   }
-   else
+   /* set list readonly */
+   while (list)
    {
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      parent->entries   = child->entries;
+      struct config_entry_list *next = list->next;
+
+      list->readonly = true;
+      list->next     = NULL;
+      config_append_entry(parent, list);
+      list           = next;
    }
 
    child->entries = NULL;
-
-   /* Rebase tail. */
-   if (parent->entries)
-   {
-      struct config_entry_list *head =
-         (struct config_entry_list*)parent->entries;
-
-      while (head->next)
-         head = head->next;
-      parent->tail = head;
-   }
-   else
-      parent->tail = NULL;
+   child->tail    = NULL;
 }
 
 static void add_sub_conf(config_file_t *conf, char *path, config_file_cb_t *cb)
@@ -328,9 +429,7 @@ static bool parse_line(config_file_t *conf,
       struct config_entry_list *list, char *line, config_file_cb_t *cb)
 {
    char *key       = NULL;
-   char *key_tmp   = NULL;
-   size_t cur_size = 8;
-   size_t idx      = 0;
+   size_t key_len  = 0;
    char *comment   = strip_comment(line);
 
    /* Starting line with #include includes config files. */
@@ -357,36 +456,71 @@ static bool parse_line(config_file_t *conf,
    while (isspace((int)*line))
       line++;
 
-   key             = (char*)malloc(9);
+   while (isgraph((int)line[key_len]))
+      key_len++;
 
-   while (isgraph((int)*line))
+   key             = (char*)malloc(key_len + 1);
+   if (!key)
+      return false;
+
+   memcpy(key, line, key_len);
+   key[key_len]    = '\0';
+   line           += key_len;
+
+   list->value     = extract_value(line, true);
+
+   if (!list->value)
    {
-      if (idx == cur_size)
+      free(key);
+      return false;
+   }
+
+   list->key       = key;
+   return true;
+}
+
+/* Parses the lines of @buf, NUL terminated at @len, where they are.
+ * The key and value of each entry are the only copies made. */
+static bool config_file_parse_buffer(config_file_t *conf,
+      char *buf, size_t len, config_file_cb_t *cb)
+{
+   char *line      = buf;
+   char *buf_end   = buf + len;
+
+   while (line < buf_end)
+   {
+      struct config_entry_list entry;
+      char *line_end = (char*)memchr(line, '\n', buf_end - line);
+
+      if (!line_end)
+         line_end    = buf_end;
+      *line_end      = '\0';
+
+      entry.readonly = false;
+      entry.key      = NULL;
+      entry.value    = NULL;
+      entry.next     = NULL;
+
+      if (*line && parse_line(conf, &entry, line, cb))
       {
-         cur_size *= 2;
-         key_tmp   = (char*)realloc(key, cur_size + 1);
+         struct config_entry_list *list = (struct config_entry_list*)
+            malloc(sizeof(*list));
 
-         if (!key_tmp)
+         if (!list)
          {
-            free(key);
+            free(entry.key);
+            free(entry.value);
             return false;
          }
 
-         key = key_tmp;
-      }
-
-      key[idx++] = *line++;
-   }
-   key[idx]      = '\0';
-   list->key     = key;
+         *list = entry;
+         config_append_entry(conf, list);
 
-   list->value   = extract_value(line, true);
+         if (cb)
+            cb->config_file_new_entry_cb(list->key, list->value);
+      }
 
-   if (!list->value)
-   {
-      list->key = NULL;
-      free(key);
-      return false;
+      line = line_end + 1;
    }
 
    return true;
@@ -395,73 +529,38 @@ static bool parse_line(config_file_t *conf,
 static config_file_t *config_file_new_internal(
       const char *path, unsigned depth, config_file_cb_t *cb)
 {
-   RFILE              *file = NULL;
+   int64_t length           = 0;
+   void *buf                = NULL;
+   bool ok                  = false;
    struct config_file *conf = config_file_new_alloc();
 
    if (!path || !*path)
       return conf;
+   if (!conf)
+      return NULL;
    conf->path          = strdup(path);
    if (!conf->path)
       goto error;
 
    conf->include_depth = depth;
-   file                = filestream_open(path,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-   if (!file)
+   /* Read once, then parsed where it is */
+   if (!filestream_read_file(path, &buf, &length) || length < 0)
    {
+      free(buf);
       free(conf->path);
       goto error;
    }
 
-   while (!filestream_eof(file))
-   {
-      char *line                     = NULL;
-      struct config_entry_list *list = (struct config_entry_list*)
-         malloc(sizeof(*list));
-
-      if (!list)
-      {
-         config_file_free(conf);
-         filestream_close(file);
-         return NULL;
-      }
-
-      list->readonly  = false;
-      list->key       = NULL;
-      list->value     = NULL;
-      list->next      = NULL;
-
-      line            = filestream_getline(file);
-
-      if (!line)
-      {
-         free(list);
-         continue;
-      }
+   ok = config_file_parse_buffer(conf, (char*)buf, (size_t)length, cb);
+   free(buf);
 
-      if (*line && parse_line(conf, list, line, cb))
-      {
-         if (conf->entries)
-            conf->tail->next = list;
-         else
-            conf->entries    = list;
-
-         conf->tail = list;
-
-         if (cb && list->key && list->value)
-            cb->config_file_new_entry_cb(list->key, list->value) ;
-      }
-
-      free(line);
-
-      if (list != conf->tail)
-         free(list);
+   if (!ok)
+   {
+      config_file_free(conf);
+      return NULL;
    }
 
-   filestream_close(file);
-
    return conf;
 
 error:
@@ -510,6 +609,7 @@ void config_file_free(config_file_t *conf)
 
    if (conf->path)
       free(conf->path);
+   config_map_free(conf);
    free(conf);
 }
 
@@ -522,8 +622,14 @@ bool config_append_file(config_file_t *conf, const char *path)
    if (new_conf->tail)
    {
       new_conf->tail->next = conf->entries;
+      if (!conf->entries)
+         conf->tail        = new_conf->tail;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+      new_conf->tail       = NULL;
+
+      /* The new entries come first now */
+      config_map_free(conf);
    }
 
    config_file_free(new_conf);
@@ -533,67 +639,29 @@ bool config_append_file(config_file_t *conf, const char *path)
 config_file_t *config_file_new_from_string(const char *from_string,
       const char *path)
 {
-   size_t i;
-   struct string_list *lines = NULL;
-   struct config_file *conf  = (struct config_file*)malloc(sizeof(*conf));
+   char *buf                = NULL;
+   struct config_file *conf = config_file_new_alloc();
    if (!conf)
       return NULL;
 
    if (!from_string)
       return conf;
 
-   conf->path                     = NULL;
-   conf->entries                  = NULL;
-   conf->tail                     = NULL;
-   conf->last                     = NULL;
-   conf->includes                 = NULL;
-   conf->include_depth            = 0;
-   conf->guaranteed_no_duplicates = false ;
-
    if (!string_is_empty(path))
       conf->path                  = strdup(path);
 
-   lines                          = string_split(from_string, "\n");
-   if (!lines)
+   buf = strdup(from_string);
+   if (!buf)
       return conf;
 
-   for (i = 0; i < lines->size; i++)
+   if (!config_file_parse_buffer(conf, buf, strlen(buf), NULL))
    {
-      struct config_entry_list *list = (struct config_entry_list*)
-         malloc(sizeof(*list));
-      char                    *line  = lines->elems[i].data;
-
-      if (!list)
-      {
-         string_list_free(lines);
-         config_file_free(conf);
-         return NULL;
-      }
-
-      list->readonly  = false;
-      list->key       = NULL;
-      list->value     = NULL;
-      list->next      = NULL;
-
-      if (line && conf)
-      {
-         if (*line && parse_line(conf, list, line, NULL))
-         {
-            if (conf->entries)
-               conf->tail->next = list;
-            else
-               conf->entries    = list;
-
-            conf->tail          = list;
-         }
-      }
-
-      if (list != conf->tail)
-         free(list);
+      free(buf);
+      config_file_free(conf);
+      return NULL;
    }
 
-   string_list_free(lines);
-
+   free(buf);
    return conf;
 }
 
@@ -607,8 +675,19 @@ config_file_t *config_file_new_from_path_to_string(const char *path)
    {
       if (filestream_read_file(path, (void**)&ret_buf, &length))
       {
-         if (length >= 0)
-            conf = config_file_new_from_string((const char*)ret_buf, path);
+         /* Parsed right where it was read */
+         if (length >= 0 && (conf = config_file_new_alloc()))
+         {
+            if (!string_is_empty(path))
+               conf->path = strdup(path);
+
+            if (!config_file_parse_buffer(conf, (char*)ret_buf,
+                     (size_t)length, NULL))
+            {
+               config_file_free(conf);
+               conf = NULL;
+            }
+         }
          if ((void*)ret_buf)
             free((void*)ret_buf);
       }
@@ -637,7 +716,9 @@ config_file_t *config_file_new_alloc(void)
    conf->path                     = NULL;
    conf->entries                  = NULL;
    conf->tail                     = NULL;
-   conf->last                     = NULL;
+   conf->map                      = NULL;
+   conf->map_size                 = 0;
+   conf->map_count                = 0;
    conf->includes                 = NULL;
    conf->include_depth            = 0;
    conf->guaranteed_no_duplicates = false ;
@@ -646,29 +727,30 @@ config_file_t *config_file_new_alloc(void)
 }
 
 static struct config_entry_list *config_get_entry(
-      const config_file_t *conf,
-      const char *key, struct config_entry_list **prev)
+      config_file_t *conf, const char *key)
 {
-   struct config_entry_list *entry    = NULL;
-   struct config_entry_list *previous = prev ? *prev : NULL;
+   struct config_entry_list *entry = NULL;
+
+   if (!key)
+      return NULL;
+
+   if (!conf->map)
+      config_map_build(conf);
+
+   if (conf->map)
+      return *config_map_slot(conf, key);
 
+   /* Out of memory for the map */
    for (entry = conf->entries; entry; entry = entry->next)
-   {
       if (string_is_equal(key, entry->key))
          return entry;
 
-      previous = entry;
-   }
-
-   if (prev)
-      *prev = previous;
-
    return NULL;
 }
 
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return false;
@@ -679,7 +761,7 @@ bool config_get_double(config_file_t *conf, const char *key, double *in)
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return false;
@@ -691,7 +773,7 @@ bool config_get_float(config_file_t *conf, const char *key, float *in)
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -710,7 +792,7 @@ bool config_get_int(config_file_t *conf, const char *key, int *in)
 
 bool config_get_size_t(config_file_t *conf, const char *key, size_t *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -729,7 +811,7 @@ bool config_get_size_t(config_file_t *conf, const char *key, size_t *in)
 #if defined(__STDC_VERSION__) && __STDC_VERSION__>=199901L
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -748,7 +830,7 @@ bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -767,7 +849,7 @@ bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -786,7 +868,7 @@ bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -802,7 +884,7 @@ bool config_get_char(config_file_t *conf, const char *key, char *in)
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return false;
@@ -821,7 +903,7 @@ bool config_get_config_path(config_file_t *conf, char *s, size_t len)
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       return strlcpy(buf, entry->value, size) < size;
@@ -835,7 +917,7 @@ bool config_get_path(config_file_t *conf, const char *key,
    if (config_get_array(conf, key, buf, size))
       return true;
 #else
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -848,7 +930,7 @@ bool config_get_path(config_file_t *conf, const char *key,
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -869,8 +951,8 @@ bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *last  = (conf->guaranteed_no_duplicates && conf->last) ? conf->last : conf->entries;
-   struct config_entry_list *entry = conf->guaranteed_no_duplicates?NULL:config_get_entry(conf, key, &last);
+   struct config_entry_list *entry = conf->guaranteed_no_duplicates
+      ? NULL : config_get_entry(conf, key);
 
    if (entry && !entry->readonly)
    {
@@ -892,26 +974,23 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
    entry->value     = strdup(val);
    entry->next      = NULL;
 
-   if (last)
-      last->next    = entry;
-   else
-      conf->entries = entry;
-
-   conf->last       = entry;
+   config_append_entry(conf, entry);
 }
 
 void config_unset(config_file_t *conf, const char *key)
 {
-   struct config_entry_list *last  = conf->entries;
-   struct config_entry_list *entry = config_get_entry(conf, key, &last);
+   struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return;
 
-   entry->key   = NULL;
-   entry->value = NULL;
    free(entry->key);
    free(entry->value);
+   entry->key   = NULL;
+   entry->value = NULL;
+
+   /* A later entry of the same key may be the one found now */
+   config_map_free(conf);
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -1001,6 +1080,19 @@ void config_set_bool(config_file_t *conf, const char *key, bool val)
    config_set_string(conf, key, val ? "true" : "false");
 }
 
+/* For the list in another order */
+static void config_set_entries(config_file_t *conf,
+      struct config_entry_list *list)
+{
+   conf->entries = list;
+   conf->tail    = list;
+   while (conf->tail && conf->tail->next)
+      conf->tail = conf->tail->next;
+
+   /* The first entry of a key may not be the same */
+   config_map_free(conf);
+}
+
 bool config_file_write(config_file_t *conf, const char *path, bool sort)
 {
    if (!string_is_empty(path))
@@ -1051,7 +1143,7 @@ void config_file_dump_orbis(config_file_t *conf, int fd)
    }
 
    list = merge_sort_linked_list((struct config_entry_list*)conf->entries, config_sort_compare_func);
-   conf->entries = list;
+   config_set_entries(conf, list);
 
    while (list)
    {
@@ -1078,13 +1170,14 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
    }
 
    if (sort)
+   {
       list = merge_sort_linked_list((struct config_entry_list*)
             conf->entries, config_sort_compare_func);
+      config_set_entries(conf, list);
+   }
    else
       list = (struct config_entry_list*)conf->entries;
 
-   conf->entries = list;
-
    while (list)
    {
       if (!list->readonly && list->key)
@@ -1095,16 +1188,7 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (string_is_equal(entry, list->key))
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_get_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
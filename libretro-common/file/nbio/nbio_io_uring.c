@@ -0,0 +1,530 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_io_uring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <file/nbio.h>
+
+#if defined(__linux__) && defined(HAVE_IO_URING)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#ifdef HAVE_THREADS
+#include <pthread.h>
+#endif
+
+/* One ring is shared by every handle, so that the reads of all the
+ * files being loaded at once are submitted to the kernel together,
+ * with a single system call, the next time any of them is iterated.
+ * Completions are reaped the same way, whoever they are for. */
+
+#define NBIO_IO_URING_ENTRIES 64
+
+struct nbio_io_uring_t
+{
+   int fd;
+   /* What's left of the read or write, readv and writev being what
+    * every kernel with io_uring has */
+   struct iovec iov;
+   void* ptr;
+   size_t len;
+   size_t progress;
+   /*
+    * possible values:
+    * NBIO_READ, NBIO_WRITE - in progress
+    * -1 - currently doing nothing
+    */
+   signed char op;
+   signed char mode;
+   /* Waiting for room in the submission queue */
+   bool waiting;
+   /* Has a request in the ring */
+   bool inflight;
+};
+
+typedef struct nbio_io_uring_ring
+{
+   int fd;
+
+   unsigned *sq_head;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned sq_entries;
+   struct io_uring_sqe *sqes;
+
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   struct io_uring_cqe *cqes;
+} nbio_io_uring_ring_t;
+
+static nbio_io_uring_ring_t nbio_ring = { -1 };
+
+#ifdef HAVE_THREADS
+static pthread_once_t nbio_ring_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t nbio_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+#define nbio_io_uring_lock()   pthread_mutex_lock(&nbio_ring_lock)
+#define nbio_io_uring_unlock() pthread_mutex_unlock(&nbio_ring_lock)
+#else
+static bool nbio_ring_probed = false;
+#define nbio_io_uring_lock()
+#define nbio_io_uring_unlock()
+#endif
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+   return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit,
+      unsigned min_complete, unsigned flags)
+{
+   return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+         min_complete, flags, NULL, 0);
+}
+
+static void nbio_io_uring_init(void)
+{
+   struct io_uring_params p;
+   size_t sq_size, cq_size, sqes_size;
+   uint8_t *sq_ptr            = (uint8_t*)MAP_FAILED;
+   uint8_t *cq_ptr            = (uint8_t*)MAP_FAILED;
+   struct io_uring_sqe *sqes  = (struct io_uring_sqe*)MAP_FAILED;
+   int fd;
+
+   memset(&p, 0, sizeof(p));
+
+   /* Fails with ENOSYS on kernels before 5.1, and where it's
+    * been turned off */
+   fd = io_uring_setup(NBIO_IO_URING_ENTRIES, &p);
+   if (fd < 0)
+      return;
+
+   sq_size   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   cq_size   = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+   sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (cq_size > sq_size)
+         sq_size = cq_size;
+      cq_size = sq_size;
+   }
+
+   sq_ptr = (uint8_t*)mmap(NULL, sq_size, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+   if (sq_ptr == MAP_FAILED)
+      goto error;
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+      cq_ptr = sq_ptr;
+   else
+   {
+      cq_ptr = (uint8_t*)mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      if (cq_ptr == MAP_FAILED)
+         goto error;
+   }
+
+   sqes = (struct io_uring_sqe*)mmap(NULL, sqes_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         fd, IORING_OFF_SQES);
+   if (sqes == MAP_FAILED)
+      goto error;
+
+   nbio_ring.sqes       = sqes;
+   nbio_ring.sq_head    = (unsigned*)(sq_ptr + p.sq_off.head);
+   nbio_ring.sq_tail    = (unsigned*)(sq_ptr + p.sq_off.tail);
+   nbio_ring.sq_mask    = (unsigned*)(sq_ptr + p.sq_off.ring_mask);
+   nbio_ring.sq_array   = (unsigned*)(sq_ptr + p.sq_off.array);
+   nbio_ring.sq_entries = p.sq_entries;
+
+   nbio_ring.cq_head    = (unsigned*)(cq_ptr + p.cq_off.head);
+   nbio_ring.cq_tail    = (unsigned*)(cq_ptr + p.cq_off.tail);
+   nbio_ring.cq_mask    = (unsigned*)(cq_ptr + p.cq_off.ring_mask);
+   nbio_ring.cqes       = (struct io_uring_cqe*)(cq_ptr + p.cq_off.cqes);
+
+   /* The ring stays around for later loads, like the file
+    * descriptors nbio_stdio keeps in libc */
+   nbio_ring.fd         = fd;
+   return;
+
+error:
+   if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+      munmap(cq_ptr, cq_size);
+   if (sq_ptr != MAP_FAILED)
+      munmap(sq_ptr, sq_size);
+   close(fd);
+}
+
+/**
+ * nbio_io_uring_available:
+ *
+ * Returns: true if the kernel has io_uring, set up on the first call.
+ **/
+bool nbio_io_uring_available(void)
+{
+#ifdef HAVE_THREADS
+   pthread_once(&nbio_ring_once, nbio_io_uring_init);
+#else
+   if (!nbio_ring_probed)
+   {
+      nbio_ring_probed = true;
+      nbio_io_uring_init();
+   }
+#endif
+   return nbio_ring.fd >= 0;
+}
+
+/* Requests the kernel didn't take yet.
+ * Must be called with the lock held. */
+static unsigned nbio_io_uring_unsubmitted(void)
+{
+   return *nbio_ring.sq_tail -
+      __atomic_load_n(nbio_ring.sq_head, __ATOMIC_ACQUIRE);
+}
+
+/* Must be called with the lock held */
+static bool nbio_io_uring_queue(struct nbio_io_uring_t *handle)
+{
+   struct io_uring_sqe *sqe;
+   unsigned tail = *nbio_ring.sq_tail;
+
+   if (nbio_io_uring_unsubmitted() >= nbio_ring.sq_entries)
+   {
+      /* Hand what's there to the kernel to make room */
+      io_uring_enter(nbio_ring.fd, nbio_ring.sq_entries, 0, 0);
+      if (nbio_io_uring_unsubmitted() >= nbio_ring.sq_entries)
+      {
+         handle->waiting = true;
+         return false;
+      }
+   }
+
+   sqe = &nbio_ring.sqes[tail & *nbio_ring.sq_mask];
+   memset(sqe, 0, sizeof(*sqe));
+
+   handle->iov.iov_base = (uint8_t*)handle->ptr + handle->progress;
+   handle->iov.iov_len  = handle->len - handle->progress;
+
+   sqe->opcode          = (handle->op == NBIO_WRITE)
+      ? IORING_OP_WRITEV : IORING_OP_READV;
+   sqe->fd              = handle->fd;
+   sqe->off             = handle->progress;
+   sqe->addr            = (uint64_t)(uintptr_t)&handle->iov;
+   sqe->len             = 1;
+   sqe->user_data       = (uint64_t)(uintptr_t)handle;
+
+   nbio_ring.sq_array[tail & *nbio_ring.sq_mask] =
+      tail & *nbio_ring.sq_mask;
+   __atomic_store_n(nbio_ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+   handle->waiting  = false;
+   handle->inflight = true;
+   return true;
+}
+
+/* Must be called with the lock held */
+static void nbio_io_uring_complete(struct nbio_io_uring_t *handle, int res)
+{
+   handle->inflight = false;
+
+   /* Cancelled */
+   if (handle->op < 0)
+      return;
+
+   if (res == -EINTR || res == -EAGAIN)
+      res = 0;
+   else if (res <= 0)
+   {
+      /* Failed, or the file got shorter, nbio_stdio doesn't
+       * report this either */
+      handle->op = -1;
+      return;
+   }
+
+   handle->progress += res;
+
+   if (handle->progress >= handle->len)
+      handle->op = -1;
+   else
+      nbio_io_uring_queue(handle);
+}
+
+/* Submits everything queued and reaps whatever completed, waiting
+ * for at least one completion if asked to.
+ * Must be called with the lock held. */
+static void nbio_io_uring_poll(bool wait)
+{
+   unsigned head;
+   unsigned to_submit = nbio_io_uring_unsubmitted();
+
+   if (to_submit || wait)
+      io_uring_enter(nbio_ring.fd, to_submit,
+            wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+
+   head = *nbio_ring.cq_head;
+
+   while (head != __atomic_load_n(nbio_ring.cq_tail, __ATOMIC_ACQUIRE))
+   {
+      struct io_uring_cqe *cqe = &nbio_ring.cqes[head & *nbio_ring.cq_mask];
+      struct nbio_io_uring_t *handle =
+         (struct nbio_io_uring_t*)(uintptr_t)cqe->user_data;
+      int res = cqe->res;
+
+      __atomic_store_n(nbio_ring.cq_head, ++head, __ATOMIC_RELEASE);
+
+      nbio_io_uring_complete(handle, res);
+      head = *nbio_ring.cq_head;
+   }
+}
+
+/* Waits until the handle has nothing in the ring anymore.
+ * Must be called with the lock held. */
+static void nbio_io_uring_drain(struct nbio_io_uring_t *handle)
+{
+   while (handle->inflight)
+      nbio_io_uring_poll(true);
+}
+
+static void *nbio_io_uring_open(const char * filename, unsigned mode)
+{
+   static const int o_flags[]     = { O_RDONLY, O_RDWR|O_CREAT|O_TRUNC, O_RDWR, O_RDONLY, O_RDWR|O_CREAT|O_TRUNC };
+   struct nbio_io_uring_t *handle = NULL;
+   off_t len                      = 0;
+   int fd;
+
+   if (!nbio_io_uring_available())
+      return NULL;
+
+   fd = open(filename, o_flags[mode]|O_CLOEXEC, 0644);
+   if (fd < 0)
+      return NULL;
+
+   switch (mode)
+   {
+      case NBIO_WRITE:
+      case BIO_WRITE:
+         break;
+      default:
+         len = lseek(fd, 0, SEEK_END);
+         if (len < 0)
+            goto error;
+         break;
+   }
+
+   handle = (struct nbio_io_uring_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      goto error;
+
+   handle->fd   = fd;
+   handle->len  = (size_t)len;
+   handle->op   = -1;
+   handle->mode = mode;
+
+   if (len)
+   {
+      handle->ptr = malloc(handle->len);
+      if (!handle->ptr)
+         goto error;
+   }
+
+   return handle;
+
+error:
+   free(handle);
+   close(fd);
+   return NULL;
+}
+
+static void nbio_io_uring_begin_op(struct nbio_io_uring_t *handle,
+      signed char op)
+{
+   if (handle->op >= 0)
+      abort();
+
+   handle->progress = 0;
+
+   if (!handle->len)
+      return;
+
+   handle->op = op;
+
+   /* Not submitted yet, that's batched with the ones of the other
+    * handles when one of them is iterated */
+   nbio_io_uring_lock();
+   nbio_io_uring_queue(handle);
+   nbio_io_uring_unlock();
+}
+
+static void nbio_io_uring_begin_read(void *data)
+{
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+   if (handle)
+      nbio_io_uring_begin_op(handle, NBIO_READ);
+}
+
+static void nbio_io_uring_begin_write(void *data)
+{
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+   if (handle)
+      nbio_io_uring_begin_op(handle, NBIO_WRITE);
+}
+
+static bool nbio_io_uring_iterate(void *data)
+{
+   bool done;
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+
+   if (!handle)
+      return false;
+
+   nbio_io_uring_lock();
+
+   if (handle->op >= 0)
+   {
+      /* Blocking modes are done before they return */
+      bool wait = handle->mode == BIO_READ || handle->mode == BIO_WRITE;
+
+      do
+      {
+         if (handle->waiting)
+            nbio_io_uring_queue(handle);
+         nbio_io_uring_poll(wait && handle->inflight);
+      } while (wait && handle->op >= 0);
+   }
+
+   done = handle->op < 0;
+
+   nbio_io_uring_unlock();
+
+   return done;
+}
+
+static void nbio_io_uring_resize(void *data, size_t len)
+{
+   void *new_data                 = NULL;
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->op >= 0)
+      abort();
+   if (len < handle->len)
+      abort();
+
+   if (ftruncate(handle->fd, len) != 0)
+      abort(); /* same as nbio_linux, there's no way to report it */
+
+   new_data = realloc(handle->ptr, len);
+   if (!new_data)
+      abort();
+
+   handle->ptr      = new_data;
+   handle->len      = len;
+   handle->progress = len;
+}
+
+static void *nbio_io_uring_get_ptr(void *data, size_t* len)
+{
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+   if (!handle)
+      return NULL;
+   if (len)
+      *len = handle->len;
+   if (handle->op < 0)
+      return handle->ptr;
+   return NULL;
+}
+
+static void nbio_io_uring_cancel(void *data)
+{
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+   if (!handle)
+      return;
+
+   nbio_io_uring_lock();
+   /* The buffer belongs to the kernel until the request completes,
+    * which doesn't take long for a single read */
+   handle->op      = -1;
+   handle->waiting = false;
+   nbio_io_uring_drain(handle);
+   nbio_io_uring_unlock();
+}
+
+static void nbio_io_uring_free(void *data)
+{
+   struct nbio_io_uring_t *handle = (struct nbio_io_uring_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->op >= 0)
+      abort();
+
+   close(handle->fd);
+   free(handle->ptr);
+   free(handle);
+}
+
+nbio_intf_t nbio_io_uring = {
+   nbio_io_uring_open,
+   nbio_io_uring_begin_read,
+   nbio_io_uring_begin_write,
+   nbio_io_uring_iterate,
+   nbio_io_uring_resize,
+   nbio_io_uring_get_ptr,
+   nbio_io_uring_cancel,
+   nbio_io_uring_free,
+   "nbio_io_uring",
+};
+#else
+bool nbio_io_uring_available(void)
+{
+   return false;
+}
+
+nbio_intf_t nbio_io_uring = {
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   "nbio_io_uring",
+};
+
+#endif
@@ -2391,6 +2391,99 @@ static JSON_Status JSON_Parser_ProcessUnknownByte(JSON_Parser parser, byte b)
    return JSON_Success;
 }
 
+/* Fast paths for UTF-8 input, for the bytes that make up most of a
+   document and that the lexer would only count or copy one by one:
+   whitespace between tokens and plain ASCII inside strings. */
+
+#define SWAR_ONES  ((uint64_t)0x0101010101010101ULL)
+#define SWAR_HIGHS ((uint64_t)0x8080808080808080ULL)
+#define SWAR_HAS_ZERO(v)       (((v) - SWAR_ONES) & ~(v) & SWAR_HIGHS)
+#define SWAR_HAS_LESS(v, n)    (((v) - SWAR_ONES * (n)) & ~(v) & SWAR_HIGHS)
+
+/* Returns how many of the leading bytes are printable ASCII
+   other than '"' and '\\', 8 bytes at a time. */
+static size_t CountPlainStringBytes(const byte* pBytes, size_t length)
+{
+   size_t i = 0;
+   for (; i + 8 <= length; i += 8)
+   {
+      uint64_t v;
+      memcpy(&v, pBytes + i, sizeof(v));
+      if ((v & SWAR_HIGHS) || SWAR_HAS_LESS(v, 0x20) ||
+            SWAR_HAS_ZERO(v ^ (SWAR_ONES * '"')) ||
+            SWAR_HAS_ZERO(v ^ (SWAR_ONES * '\\')))
+         break;
+   }
+   for (; i < length; i++)
+   {
+      byte b = pBytes[i];
+      if (b < 0x20 || b >= 0x80 || b == '"' || b == '\\')
+         break;
+   }
+   return i;
+}
+
+/* Returns how many bytes of pBytes were consumed. */
+static size_t JSON_Parser_ProcessPlainBytes(JSON_Parser parser, const byte* pBytes, size_t length)
+{
+   size_t count = 0;
+
+   if (parser->inputEncoding != JSON_UTF8 ||
+         Decoder_SequencePending(&parser->decoderData) ||
+         GET_FLAGS(parser->state, PARSER_AFTER_CARRIAGE_RETURN))
+      return 0;
+
+   if (parser->lexerState == LEXING_WHITESPACE)
+   {
+      for (; count < length; count++)
+      {
+         byte b = pBytes[count];
+         if (b == ' ' || b == '\t')
+            parser->codepointLocationColumn++;
+         else if (b == '\n')
+         {
+            parser->codepointLocationLine++;
+            parser->codepointLocationColumn = 0;
+         }
+         else
+            break;
+      }
+      parser->codepointLocationByte += count;
+   }
+   else if (parser->lexerState == LEXING_STRING &&
+         parser->stringEncoding == JSON_UTF8)
+   {
+      size_t needed;
+
+      count = CountPlainStringBytes(pBytes, length);
+      if (!count)
+         return 0;
+
+      /* Leave the rest to the slow path, which reports the error */
+      if (parser->tokenBytesUsed + count > parser->maxStringLength)
+         return 0;
+
+      /* Keep LONGEST_ENCODING_SEQUENCE bytes available, as
+         recordCodepointAndAdvance does. */
+      needed = parser->tokenBytesUsed + count + LONGEST_ENCODING_SEQUENCE;
+      while (parser->tokenBytesLength < needed)
+      {
+         byte* pBiggerBuffer = DoubleBuffer(&parser->memorySuite, parser->defaultTokenBytes, parser->pTokenBytes, parser->tokenBytesLength);
+         if (!pBiggerBuffer)
+            return 0;
+         parser->pTokenBytes = pBiggerBuffer;
+         parser->tokenBytesLength *= 2;
+      }
+
+      memcpy(parser->pTokenBytes + parser->tokenBytesUsed, pBytes, count);
+      parser->tokenBytesUsed          += count;
+      parser->codepointLocationByte   += count;
+      parser->codepointLocationColumn += count;
+   }
+
+   return count;
+}
+
 JSON_Status JSON_Parser_ProcessInputBytes(JSON_Parser parser, const byte* pBytes, size_t length)
 {
    /* Note that if length is 0, pBytes is allowed to be NULL. */
@@ -2403,9 +2496,16 @@ JSON_Status JSON_Parser_ProcessInputBytes(JSON_Parser parser, const byte* pBytes
    }
    while (i < length)
    {
-      DecoderOutput output     = Decoder_ProcessByte(
+      DecoderOutput output;
+      DecoderResultCode result;
+
+      i += JSON_Parser_ProcessPlainBytes(parser, pBytes + i, length - i);
+      if (i >= length)
+         break;
+
+      output = Decoder_ProcessByte(
             &parser->decoderData, parser->inputEncoding, pBytes[i]);
-      DecoderResultCode result = DECODER_RESULT_CODE(output);
+      result = DECODER_RESULT_CODE(output);
       switch (result)
       {
          case SEQUENCE_PENDING:
@@ -20,6 +20,8 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+
 #include <file/file_path.h>
 #include <string/stdstring.h>
 #include <formats/rxml.h>
@@ -31,8 +33,21 @@ struct logiqx_dat
 {
    rxml_document_t *data;
    rxml_node_t *current_node;
+   /* Open addressed map of the game nodes by name,
+    * made once when the file is loaded */
+   struct logiqx_dat_index_slot *index;
+   size_t index_size;
+};
+
+struct logiqx_dat_index_slot
+{
+   const char *name;
+   rxml_node_t *node;
 };
 
+static void logiqx_dat_index_build(
+      logiqx_dat_t *dat_file, rxml_node_t *root_node);
+
 /* List of HTML formatting codes that must
  * be replaced when parsing XML data */
 const char *logiqx_dat_html_code_list[][2] = { 
@@ -139,6 +154,9 @@ logiqx_dat_t *logiqx_dat_init(const char *path)
    if (!dat_file->current_node)
       goto error;
 
+   /* Searching without the index only takes longer */
+   logiqx_dat_index_build(dat_file, root_node);
+
    /* All is well - return logiqx_dat_t object */
    return dat_file;
 
@@ -155,6 +173,10 @@ void logiqx_dat_free(logiqx_dat_t *dat_file)
 
    dat_file->current_node = NULL;
 
+   free(dat_file->index);
+   dat_file->index      = NULL;
+   dat_file->index_size = 0;
+
    if (dat_file->data)
    {
       rxml_free_document(dat_file->data);
@@ -210,6 +232,81 @@ static bool logiqx_dat_game_node_matches_name(
    return string_is_equal(node_game_name, game_name);
 }
 
+/* Game node index */
+
+static uint32_t logiqx_dat_index_hash(const char *name)
+{
+   uint32_t hash = 5381;
+
+   while (*name)
+      hash = (hash << 5) + hash + (uint8_t)*name++;
+
+   return hash;
+}
+
+/* Slot of the game called @name, or the empty one where it would go */
+static struct logiqx_dat_index_slot *logiqx_dat_index_slot(
+      const logiqx_dat_t *dat_file, const char *name)
+{
+   size_t mask = dat_file->index_size - 1;
+   size_t i    = logiqx_dat_index_hash(name) & mask;
+
+   while (dat_file->index[i].name &&
+          !string_is_equal(dat_file->index[i].name, name))
+      i = (i + 1) & mask;
+
+   return &dat_file->index[i];
+}
+
+/* MAME lists have tens of thousands of games, and a scan
+ * looks up every archive found. Games listed twice are
+ * found as the first one, like a walk through the file. */
+static void logiqx_dat_index_build(
+      logiqx_dat_t *dat_file, rxml_node_t *root_node)
+{
+   rxml_node_t *node = NULL;
+   size_t count      = 0;
+   size_t size       = 16;
+
+   for (node = root_node->children; node; node = node->next)
+      if (logiqx_dat_is_game_node(node))
+         count++;
+
+   /* Kept at most half full */
+   while (count * 2 > size)
+      size *= 2;
+
+   dat_file->index = (struct logiqx_dat_index_slot*)
+         calloc(size, sizeof(*dat_file->index));
+
+   if (!dat_file->index)
+      return;
+
+   dat_file->index_size = size;
+
+   for (node = root_node->children; node; node = node->next)
+   {
+      struct logiqx_dat_index_slot *slot = NULL;
+      const char *name                   = NULL;
+
+      if (!logiqx_dat_is_game_node(node))
+         continue;
+
+      name = rxml_node_attrib(node, "name");
+
+      if (string_is_empty(name))
+         continue;
+
+      slot = logiqx_dat_index_slot(dat_file, name);
+
+      if (!slot->name)
+      {
+         slot->name = name;
+         slot->node = node;
+      }
+   }
+}
+
 /* The XML element data strings returned from
  * DAT files are very 'messy'. This function
  * removes all cruft, replaces formatting strings
@@ -423,7 +520,9 @@ bool logiqx_dat_get_next(
 
 /* Fetches information for the specified game.
  * Returns false if game does not exist, or arguments
- * are invalid. */
+ * are invalid.
+ * Only reads the DAT file, so it can be searched from
+ * several threads at once. */
 bool logiqx_dat_search(
       logiqx_dat_t *dat_file, const char *game_name,
       logiqx_dat_game_info_t *game_info)
@@ -437,6 +536,16 @@ bool logiqx_dat_search(
    if (!dat_file->data)
       return false;
 
+   if (dat_file->index)
+   {
+      game_node = logiqx_dat_index_slot(dat_file, game_name)->node;
+
+      if (!game_node)
+         return false;
+
+      return logiqx_dat_parse_game_node(game_node, game_info);
+   }
+
    /* Get root node */
    root_node = rxml_root_node(dat_file->data);
 
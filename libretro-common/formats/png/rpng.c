@@ -37,6 +37,18 @@
 
 #include "rpng_internal.h"
 
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define RPNG_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RPNG_SSE2
+#endif
+
+/* Non-interlaced images are inflated a few rows at a time, right
+ * before they are unfiltered, in a window of about this many bytes */
+#define RPNG_STREAM_WINDOW (32 * 1024)
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -78,6 +90,7 @@ struct idat_buffer
 {
    uint8_t *data;
    size_t size;
+   size_t capacity;
 };
 
 struct png_chunk
@@ -110,6 +123,10 @@ struct rpng_process
    unsigned pass_width;
    unsigned pass_height;
    unsigned pass_pos;
+   /* Rows the window holds when streaming, 0 when the
+    * image is inflated whole */
+   unsigned stream_rows;
+   unsigned stream_left;
    uint32_t *data;
    uint32_t *palette;
    void *stream;
@@ -151,9 +168,10 @@ static enum png_chunk_type png_chunk_type(const struct png_chunk *chunk)
       { "tRNS", PNG_CHUNK_tRNS },
    };
 
+   /* The type isn't terminated */
    for (i = 0; i < ARRAY_SIZE(chunk_map); i++)
    {
-      if (string_is_equal(chunk->type, chunk_map[i].id))
+      if (!memcmp(chunk->type, chunk_map[i].id, sizeof(chunk->type)))
          return chunk_map[i].type;
    }
 
@@ -232,11 +250,29 @@ end:
 static void png_reverse_filter_copy_line_rgb(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
+
+#ifdef RPNG_NEON
+   if (bpp == 8)
+   {
+      /* Stored as B, G, R, A bytes */
+      for (; i + 16 <= width; i += 16, decoded += 48)
+      {
+         uint8x16x3_t rgb = vld3q_u8(decoded);
+         uint8x16x4_t argb;
+
+         argb.val[0] = rgb.val[2];
+         argb.val[1] = rgb.val[1];
+         argb.val[2] = rgb.val[0];
+         argb.val[3] = vdupq_n_u8(0xff);
+         vst4q_u8((uint8_t*)(data + i), argb);
+      }
+   }
+#endif
 
    bpp /= 8;
 
-   for (i = 0; i < width; i++)
+   for (; i < width; i++)
    {
       uint32_t r, g, b;
 
@@ -253,11 +289,46 @@ static void png_reverse_filter_copy_line_rgb(uint32_t *data,
 static void png_reverse_filter_copy_line_rgba(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
+
+#if defined(RPNG_NEON)
+   if (bpp == 8)
+   {
+      /* Stored as B, G, R, A bytes */
+      for (; i + 16 <= width; i += 16, decoded += 64)
+      {
+         uint8x16x4_t rgba = vld4q_u8(decoded);
+         uint8x16x4_t argb;
+
+         argb.val[0] = rgba.val[2];
+         argb.val[1] = rgba.val[1];
+         argb.val[2] = rgba.val[0];
+         argb.val[3] = rgba.val[3];
+         vst4q_u8((uint8_t*)(data + i), argb);
+      }
+   }
+#elif defined(RPNG_SSE2)
+   if (bpp == 8)
+   {
+      const __m128i mask_ag = _mm_set1_epi32((int)0xff00ff00);
+      const __m128i mask_rb = _mm_set1_epi32(0x00ff00ff);
+
+      /* Read as ABGR words, only R and B are swapped */
+      for (; i + 4 <= width; i += 4, decoded += 16)
+      {
+         __m128i px = _mm_loadu_si128((const __m128i*)decoded);
+         __m128i rb = _mm_and_si128(px, mask_rb);
+
+         rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+         _mm_storeu_si128((__m128i*)(data + i),
+               _mm_or_si128(_mm_and_si128(px, mask_ag), rb));
+      }
+   }
+#endif
 
    bpp /= 8;
 
-   for (i = 0; i < width; i++)
+   for (; i < width; i++)
    {
       uint32_t r, g, b, a;
       r        = *decoded;
@@ -559,7 +630,8 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    png_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
-   if (pngp->total_out < pass_size)
+   /* Streamed rows are checked as they are inflated */
+   if (!pngp->stream_rows && pngp->total_out < pass_size)
       return -1;
 
    pngp->restore_buf_size      = 0;
@@ -580,50 +652,161 @@ error:
    return -1;
 }
 
-static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
-      struct rpng_process *pngp, unsigned filter)
+#ifdef RPNG_NEON
+/* Four byte pixels are unfiltered four at a time. Each one depends
+ * on the one before it, so only the low four lanes of each vector
+ * are a pixel. */
+
+#define RPNG_NEON_SPLIT(q, p) do { \
+   p[0] = vget_low_u8(q); \
+   p[1] = vext_u8(p[0], p[0], 4); \
+   p[2] = vget_high_u8(q); \
+   p[3] = vext_u8(p[2], p[2], 4); \
+} while (0)
+
+static INLINE void png_neon_store4(uint8_t *out, const uint8x8_t *p)
 {
-   unsigned i;
+   uint32x2_t lo = vzip_u32(vreinterpret_u32_u8(p[0]),
+         vreinterpret_u32_u8(p[1])).val[0];
+   uint32x2_t hi = vzip_u32(vreinterpret_u32_u8(p[2]),
+         vreinterpret_u32_u8(p[3])).val[0];
+
+   vst1q_u8(out, vreinterpretq_u8_u32(vcombine_u32(lo, hi)));
+}
+
+static INLINE uint8x8_t png_neon_paeth(uint8x8_t a, uint8x8_t b, uint8x8_t c)
+{
+   uint16x8_t p  = vaddl_u8(a, b);
+   uint16x8_t pc = vaddl_u8(c, c);
+   uint16x8_t pa = vabdl_u8(b, c);
+   uint16x8_t pb = vabdl_u8(a, c);
+   uint8x8_t use_a, use_b;
+
+   pc    = vabdq_u16(p, pc);
+   use_a = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+   use_b = vmovn_u16(vcleq_u16(pb, pc));
+
+   return vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+}
+
+/* Returns how many bytes were unfiltered */
+static unsigned png_unfilter_neon4(unsigned filter, uint8_t *out,
+      const uint8_t *in, const uint8_t *prev, unsigned pitch)
+{
+   unsigned i, j;
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t c = vdup_n_u8(0);
+
+   for (i = 0; i + 16 <= pitch; i += 16)
+   {
+      uint8x8_t x[4], b[4], p[4];
+
+      RPNG_NEON_SPLIT(vld1q_u8(in + i), x);
+
+      if (filter != PNG_FILTER_SUB)
+         RPNG_NEON_SPLIT(vld1q_u8(prev + i), b);
+
+      for (j = 0; j < 4; j++)
+      {
+         switch (filter)
+         {
+            case PNG_FILTER_SUB:
+               p[j] = vadd_u8(x[j], a);
+               break;
+            case PNG_FILTER_AVERAGE:
+               p[j] = vadd_u8(x[j], vhadd_u8(a, b[j]));
+               break;
+            default:
+               p[j] = vadd_u8(x[j], png_neon_paeth(a, b[j], c));
+               c    = b[j];
+               break;
+         }
+         a = p[j];
+      }
+
+      png_neon_store4(out + i, p);
+   }
+
+   return i;
+}
+#endif
+
+/* Undoes the filter of a scanline into 'out', 'prev' being the
+ * scanline above it, unfiltered (all zero for the first one) */
+static bool png_reverse_filter_line(unsigned filter, uint8_t *out,
+      const uint8_t *in, const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
 
    switch (filter)
    {
       case PNG_FILTER_NONE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
+         memcpy(out, in, pitch);
          break;
       case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
+#ifdef RPNG_NEON
+         if (bpp == 4)
+            i = png_unfilter_neon4(filter, out, in, prev, pitch);
+#endif
+         for (; i < bpp && i < pitch; i++)
+            out[i] = in[i];
+         for (; i < pitch; i++)
+            out[i] = out[i - bpp] + in[i];
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+#if defined(RPNG_NEON)
+         for (; i + 16 <= pitch; i += 16)
+            vst1q_u8(out + i, vaddq_u8(vld1q_u8(in + i), vld1q_u8(prev + i)));
+#elif defined(RPNG_SSE2)
+         for (; i + 16 <= pitch; i += 16)
+            _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+                  _mm_loadu_si128((const __m128i*)(in + i)),
+                  _mm_loadu_si128((const __m128i*)(prev + i))));
+#endif
+         for (; i < pitch; i++)
+            out[i] = prev[i] + in[i];
          break;
       case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
+#ifdef RPNG_NEON
+         if (bpp == 4)
+            i = png_unfilter_neon4(filter, out, in, prev, pitch);
+#endif
+         for (; i < bpp && i < pitch; i++)
+            out[i] = (prev[i] >> 1) + in[i];
+         for (; i < pitch; i++)
+            out[i] = ((out[i - bpp] + prev[i]) >> 1) + in[i];
          break;
       case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
+#ifdef RPNG_NEON
+         if (bpp == 4)
+            i = png_unfilter_neon4(filter, out, in, prev, pitch);
+#endif
+         for (; i < bpp && i < pitch; i++)
+            out[i] = paeth(0, prev[i], 0) + in[i];
+         for (; i < pitch; i++)
+            out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
          break;
-
       default:
-         return IMAGE_PROCESS_ERROR_END;
+         return false;
    }
 
+   return true;
+}
+
+static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
+      struct rpng_process *pngp, unsigned filter)
+{
+   /* decoded_scanline is the line decoded last, the one
+    * before it can be written over */
+   uint8_t *decoded = pngp->prev_scanline;
+
+   if (!png_reverse_filter_line(filter, decoded, pngp->inflate_buf,
+            pngp->decoded_scanline, pngp->pitch, pngp->bpp))
+      return IMAGE_PROCESS_ERROR_END;
+
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = decoded;
+
    switch (ihdr->color_type)
    {
       case PNG_IHDR_COLOR_GRAY:
@@ -645,11 +828,46 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
-
    return IMAGE_PROCESS_NEXT;
 }
 
+/* Inflates the next rows of a streamed image into the
+ * window, once the rows in it are used up */
+static bool png_reverse_filter_stream(const struct png_ihdr *ihdr,
+      struct rpng_process *pngp)
+{
+   uint32_t rd, wn;
+   size_t size;
+   enum trans_stream_error terror = TRANS_STREAM_ERROR_NONE;
+   unsigned rows                  = pngp->stream_rows;
+
+   if (pngp->stream_left)
+      return true;
+
+   if (rows > ihdr->height - pngp->h)
+      rows = ihdr->height - pngp->h;
+
+   pngp->inflate_buf     -= pngp->restore_buf_size;
+   pngp->restore_buf_size = 0;
+   size                   = (size_t)rows * (pngp->pitch + 1);
+
+   pngp->stream_backend->set_out(pngp->stream,
+         pngp->inflate_buf, (uint32_t)size);
+
+   /* The window is full before all of the input is read */
+   if (     !pngp->stream_backend->trans(pngp->stream, false,
+               &rd, &wn, &terror)
+         && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+      return false;
+
+   if (wn != size)
+      return false;
+
+   pngp->total_out  += wn;
+   pngp->stream_left = rows;
+   return true;
+}
+
 static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp)
 {
@@ -657,10 +875,15 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
 
    if (pngp->h < ihdr->height)
    {
-      unsigned filter = *pngp->inflate_buf++;
-      pngp->restore_buf_size += 1;
-      ret = png_reverse_filter_copy_line(*data,
-            ihdr, pngp, filter);
+      if (pngp->stream_rows && !png_reverse_filter_stream(ihdr, pngp))
+         ret = IMAGE_PROCESS_ERROR_END;
+      else
+      {
+         unsigned filter = *pngp->inflate_buf++;
+         pngp->restore_buf_size += 1;
+         ret = png_reverse_filter_copy_line(*data,
+               ihdr, pngp, filter);
+      }
    }
 
    if (ret == IMAGE_PROCESS_END || ret == IMAGE_PROCESS_ERROR_END)
@@ -669,6 +892,8 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
    pngp->h++;
    pngp->inflate_buf           += pngp->pitch;
    pngp->restore_buf_size      += pngp->pitch;
+   if (pngp->stream_rows)
+      pngp->stream_left--;
 
    *data                       += ihdr->width;
    pngp->data_restore_buf_size += ihdr->width;
@@ -780,7 +1005,8 @@ static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng, uint32_t **da
    enum trans_stream_error terror;
    uint32_t rd, wn;
    struct rpng_process *process = (struct rpng_process*)rpng->process;
-   bool to_continue        = (process->avail_in > 0
+   bool to_continue        = (!process->stream_rows
+         && process->avail_in > 0
          && process->avail_out > 0);
 
    if (!to_continue)
@@ -799,8 +1025,12 @@ static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng, uint32_t **da
       return 0;
 
 end:
-   process->stream_backend->stream_free(process->stream);
-   process->stream = NULL;
+   /* Streamed images are inflated as they are unfiltered */
+   if (!process->stream_rows)
+   {
+      process->stream_backend->stream_free(process->stream);
+      process->stream = NULL;
+   }
 
 #ifdef GEKKO
    /* we often use these in textures, make sure they're 32-byte aligned */
@@ -858,17 +1088,30 @@ static bool png_read_trns(uint8_t *buf, uint32_t *palette, unsigned entries)
 
 bool png_realloc_idat(const struct png_chunk *chunk, struct idat_buffer *buf)
 {
-   uint8_t *new_buffer = (uint8_t*)realloc(buf->data, buf->size + chunk->size);
+   uint8_t *new_buffer = NULL;
+   size_t needed       = buf->size + chunk->size;
+   /* Images are split in many small chunks */
+   size_t capacity     = buf->capacity * 2;
+
+   if (needed <= buf->capacity)
+      return true;
+
+   if (capacity < needed)
+      capacity = needed;
+
+   new_buffer = (uint8_t*)realloc(buf->data, capacity);
 
    if (!new_buffer)
       return false;
 
-   buf->data  = new_buffer;
+   buf->data     = new_buffer;
+   buf->capacity = capacity;
    return true;
 }
 
 static struct rpng_process *rpng_process_init(rpng_t *rpng)
 {
+   unsigned pitch               = 0;
    uint8_t *inflate_buf         = NULL;
    struct rpng_process *process = (struct rpng_process*)calloc(1, sizeof(*process));
 
@@ -878,9 +1121,19 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng)
    process->stream_backend = trans_stream_get_zlib_inflate_backend();
 
    png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
-         rpng->ihdr.height, NULL, NULL, &process->inflate_buf_size);
+         rpng->ihdr.height, NULL, &pitch, &process->inflate_buf_size);
    if (rpng->ihdr.interlace == 1) /* To be sure. */
       process->inflate_buf_size *= 2;
+   else
+   {
+      /* Only a few rows are held at a time */
+      process->stream_rows = RPNG_STREAM_WINDOW / (pitch + 1);
+      if (process->stream_rows < 1)
+         process->stream_rows = 1;
+      if (process->stream_rows > rpng->ihdr.height)
+         process->stream_rows = rpng->ihdr.height;
+      process->inflate_buf_size = (size_t)process->stream_rows * (pitch + 1);
+   }
 
    process->stream = process->stream_backend->stream_new();
 
@@ -976,7 +1229,6 @@ static bool png_parse_ihdr(uint8_t *buf,
 
 bool rpng_iterate_image(rpng_t *rpng)
 {
-   unsigned i;
    struct png_chunk chunk;
    uint8_t *buf           = (uint8_t*)rpng->buff_data;
 
@@ -991,13 +1243,6 @@ bool rpng_iterate_image(rpng_t *rpng)
    if (!read_chunk_header(buf, rpng->buff_end, &chunk))
       goto error;
 
-#if 0
-   for (i = 0; i < 4; i++)
-   {
-      fprintf(stderr, "chunktype: %c\n", chunk.type[i]);
-   }
-#endif
-
    switch (png_chunk_type(&chunk))
    {
       case PNG_CHUNK_NOOP:
@@ -1074,8 +1319,7 @@ bool rpng_iterate_image(rpng_t *rpng)
 
          buf += 8;
 
-         for (i = 0; i < chunk.size; i++)
-            rpng->idat_buf.data[i + rpng->idat_buf.size] = buf[i];
+         memcpy(rpng->idat_buf.data + rpng->idat_buf.size, buf, chunk.size);
 
          rpng->idat_buf.size += chunk.size;
 
@@ -1140,6 +1384,7 @@ error:
       if (rpng->process->stream)
          rpng->process->stream_backend->stream_free(rpng->process->stream);
       free(rpng->process);
+      rpng->process = NULL;
    }
    return IMAGE_PROCESS_ERROR;
 }
@@ -29,6 +29,11 @@
 #include <streams/interface_stream.h>
 #include <streams/trans_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
 #include "rpng_internal.h"
 
 #undef GOTO_END_ERROR
@@ -203,67 +208,105 @@ static unsigned filter_paeth(uint8_t *target,
    return count_sad(target, width);
 }
 
-bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
-      unsigned width, unsigned height, signed pitch, unsigned bpp)
-{
-   unsigned h;
-   struct png_ihdr ihdr = {0};
-   bool ret = true;
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
-   
-   if (!intf_s)
-      GOTO_END_ERROR();
-
-   stream_backend = trans_stream_get_zlib_deflate_backend();
-
-   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
+/* Rows are filtered in bands, so filtering can run on worker
+ * threads while the caller deflates the bands already done. */
+#define RPNG_ENCODE_BAND_ROWS   16
+#define RPNG_ENCODE_MAX_THREADS 4
 
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr_string(intf_s, &ihdr))
-      GOTO_END_ERROR();
+struct rpng_filter_scratch
+{
+   uint8_t *rgba_line;
+   uint8_t *prev_encoded;
+   uint8_t *up_filtered;
+   uint8_t *sub_filtered;
+   uint8_t *avg_filtered;
+   uint8_t *paeth_filtered;
+};
+
+struct rpng_encode_job
+{
+   const uint8_t *data;
+   uint8_t *encode_buf;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+#endif
+   uint8_t *band_done;
+   signed pitch;
+   unsigned width;
+   unsigned height;
+   unsigned bpp;
+   unsigned num_bands;
+   unsigned next_band;
+};
+
+struct rpng_encode_worker
+{
+   struct rpng_encode_job *job;
+   struct rpng_filter_scratch scratch;
+};
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf      = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+static bool rpng_filter_scratch_init(struct rpng_filter_scratch *s,
+      size_t line_size)
+{
+   s->rgba_line      = (uint8_t*)malloc(line_size);
+   s->prev_encoded   = (uint8_t*)malloc(line_size);
+   s->up_filtered    = (uint8_t*)malloc(line_size);
+   s->sub_filtered   = (uint8_t*)malloc(line_size);
+   s->avg_filtered   = (uint8_t*)malloc(line_size);
+   s->paeth_filtered = (uint8_t*)malloc(line_size);
+
+   return s->rgba_line && s->prev_encoded && s->up_filtered
+      && s->sub_filtered && s->avg_filtered && s->paeth_filtered;
+}
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+static void rpng_filter_scratch_free(struct rpng_filter_scratch *s)
+{
+   free(s->rgba_line);
+   free(s->prev_encoded);
+   free(s->up_filtered);
+   free(s->sub_filtered);
+   free(s->avg_filtered);
+   free(s->paeth_filtered);
+}
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+static void rpng_copy_line(uint8_t *dst, const uint8_t *src,
+      unsigned width, unsigned bpp)
+{
+   if (bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, width);
+   else
+      copy_bgr24_line(dst, src, width);
+}
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+static void rpng_filter_band(const struct rpng_encode_job *job,
+      struct rpng_filter_scratch *s, unsigned band)
+{
+   unsigned h;
+   unsigned bpp           = job->bpp;
+   unsigned width         = job->width;
+   unsigned line_size     = width * bpp;
+   unsigned first         = band * RPNG_ENCODE_BAND_ROWS;
+   unsigned last          = first + RPNG_ENCODE_BAND_ROWS;
+   const uint8_t *data    = job->data + (int)first * job->pitch;
+   uint8_t *encode_target = job->encode_buf + first * (line_size + 1);
+
+   if (last > job->height)
+      last = job->height;
+
+   /* The filters of the first row of a band refer to
+    * the last row of the previous one. */
+   if (first == 0)
+      memset(s->prev_encoded, 0, line_size);
+   else
+      rpng_copy_line(s->prev_encoded, data - job->pitch, width, bpp);
+
+   for (h = first; h < last;
+         h++, encode_target += line_size, data += job->pitch)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      uint8_t *tmp = NULL;
+
+      rpng_copy_line(s->rgba_line, data, width, bpp);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -272,70 +315,246 @@ bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
        * simple to implement.
        */
       {
-         unsigned none_score  = count_sad(rgba_line, width * bpp);
-         unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
-         unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
+         unsigned none_score  = count_sad(s->rgba_line, line_size);
+         unsigned up_score    = filter_up(s->up_filtered, s->rgba_line, s->prev_encoded, width, bpp);
+         unsigned sub_score   = filter_sub(s->sub_filtered, s->rgba_line, width, bpp);
+         unsigned avg_score   = filter_avg(s->avg_filtered, s->rgba_line, s->prev_encoded, width, bpp);
+         unsigned paeth_score = filter_paeth(s->paeth_filtered, s->rgba_line, s->prev_encoded, width, bpp);
 
          uint8_t filter       = 0;
          unsigned min_sad     = none_score;
-         const uint8_t *chosen_filtered = rgba_line;
+         const uint8_t *chosen_filtered = s->rgba_line;
 
          if (sub_score < min_sad)
          {
             filter = 1;
-            chosen_filtered = sub_filtered;
+            chosen_filtered = s->sub_filtered;
             min_sad = sub_score;
          }
 
          if (up_score < min_sad)
          {
             filter = 2;
-            chosen_filtered = up_filtered;
+            chosen_filtered = s->up_filtered;
             min_sad = up_score;
          }
 
          if (avg_score < min_sad)
          {
             filter = 3;
-            chosen_filtered = avg_filtered;
+            chosen_filtered = s->avg_filtered;
             min_sad = avg_score;
          }
 
          if (paeth_score < min_sad)
          {
             filter = 4;
-            chosen_filtered = paeth_filtered;
+            chosen_filtered = s->paeth_filtered;
          }
 
          *encode_target++ = filter;
-         memcpy(encode_target, chosen_filtered, width * bpp);
+         memcpy(encode_target, chosen_filtered, line_size);
+      }
+
+      tmp             = s->prev_encoded;
+      s->prev_encoded = s->rgba_line;
+      s->rgba_line    = tmp;
+   }
+}
+
+#ifdef HAVE_THREADS
+static void rpng_encode_thread_loop(void *data)
+{
+   struct rpng_encode_worker *worker = (struct rpng_encode_worker*)data;
+   struct rpng_encode_job *job       = worker->job;
+
+   for (;;)
+   {
+      unsigned band;
 
-         memcpy(prev_encoded, rgba_line, width * bpp);
+      slock_lock(job->lock);
+      band = job->next_band;
+      if (band < job->num_bands)
+         job->next_band++;
+      slock_unlock(job->lock);
+
+      if (band >= job->num_bands)
+         break;
+
+      rpng_filter_band(job, &worker->scratch, band);
+
+      slock_lock(job->lock);
+      job->band_done[band] = 1;
+      scond_signal(job->cond);
+      slock_unlock(job->lock);
+   }
+}
+#endif
+
+/* Makes sure the given band is filtered, doing it on the
+ * calling thread if no worker has picked it up yet. */
+static void rpng_encode_wait_band(struct rpng_encode_job *job,
+      struct rpng_filter_scratch *scratch, unsigned band)
+{
+   bool claimed = true;
+
+#ifdef HAVE_THREADS
+   if (job->lock)
+   {
+      slock_lock(job->lock);
+      claimed = job->next_band == band;
+      if (claimed)
+         job->next_band++;
+      else
+      {
+         while (!job->band_done[band])
+            scond_wait(job->cond, job->lock);
       }
+      slock_unlock(job->lock);
    }
+   else
+#endif
+      job->next_band++;
+
+   if (claimed)
+      rpng_filter_band(job, scratch, band);
+}
+
+static bool rpng_save_image_stream_ex(const uint8_t *data,
+      intfstream_t* intf_s, unsigned width, unsigned height,
+      signed pitch, unsigned bpp, int level, unsigned num_threads)
+{
+   unsigned i;
+   struct png_ihdr ihdr = {0};
+   bool ret = true;
+   const struct trans_stream_backend *stream_backend = NULL;
+   struct rpng_encode_job job;
+   struct rpng_encode_worker workers[RPNG_ENCODE_MAX_THREADS + 1];
+#ifdef HAVE_THREADS
+   tpool_t *pool           = NULL;
+#endif
+   size_t line_size        = width * bpp;
+   size_t encode_buf_size  = 0;
+   uint8_t *encode_buf     = NULL;
+   uint8_t *deflate_buf    = NULL;
+   void *stream            = NULL;
+   uint32_t total_out      = 0;
+
+   memset(&job, 0, sizeof(job));
+   memset(workers, 0, sizeof(workers));
+
+   if (!intf_s)
+      GOTO_END_ERROR();
+
+   stream_backend = trans_stream_get_zlib_deflate_backend();
+
+   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
+      GOTO_END_ERROR();
+
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr_string(intf_s, &ihdr))
+      GOTO_END_ERROR();
+
+   encode_buf_size = (line_size + 1) * height;
+   encode_buf      = (uint8_t*)malloc(encode_buf_size);
+   if (!encode_buf)
+      GOTO_END_ERROR();
 
    deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
    if (!deflate_buf)
       GOTO_END_ERROR();
 
+   job.data       = data;
+   job.encode_buf = encode_buf;
+   job.pitch      = pitch;
+   job.width      = width;
+   job.height     = height;
+   job.bpp        = bpp;
+   job.num_bands  = (height + RPNG_ENCODE_BAND_ROWS - 1)
+      / RPNG_ENCODE_BAND_ROWS;
+   job.band_done  = (uint8_t*)calloc(job.num_bands + 1, 1);
+   if (!job.band_done)
+      GOTO_END_ERROR();
+
+   /* The first one is used by the calling thread. */
+   if (!rpng_filter_scratch_init(&workers[0].scratch, line_size))
+      GOTO_END_ERROR();
+
+#ifdef HAVE_THREADS
+   if (num_threads > RPNG_ENCODE_MAX_THREADS)
+      num_threads = RPNG_ENCODE_MAX_THREADS;
+   if (num_threads > job.num_bands)
+      num_threads = job.num_bands;
+
+   if (num_threads)
+   {
+      job.lock = slock_new();
+      job.cond = scond_new();
+      if (!job.lock || !job.cond)
+         GOTO_END_ERROR();
+      pool     = tpool_create(num_threads);
+   }
+
+   /* Falls back to filtering on the calling thread
+    * for whatever workers can't be started. */
+   for (i = 1; pool && i <= num_threads; i++)
+   {
+      workers[i].job = &job;
+      if (!rpng_filter_scratch_init(&workers[i].scratch, line_size))
+         break;
+      if (!tpool_add_work(pool, rpng_encode_thread_loop, &workers[i]))
+         break;
+   }
+#endif
+
    stream = stream_backend->stream_new();
 
    if (!stream)
       GOTO_END_ERROR();
 
-   stream_backend->set_in(
-         stream,
-         encode_buf,
-         (unsigned)encode_buf_size);
+   if (stream_backend->define)
+      stream_backend->define(stream, "level", (uint32_t)level);
+
    stream_backend->set_out(
          stream,
          deflate_buf + 8,
          (unsigned)(encode_buf_size * 2));
 
-   if (!stream_backend->trans(stream, true, &total_in, &total_out, NULL))
-      GOTO_END_ERROR();
+   /* Deflate the bands in order as they get filtered. */
+   for (i = 0; i < job.num_bands; i++)
+   {
+      uint32_t rd       = 0;
+      uint32_t wn       = 0;
+      unsigned first    = i * RPNG_ENCODE_BAND_ROWS;
+      unsigned rows     = height - first;
+
+      if (rows > RPNG_ENCODE_BAND_ROWS)
+         rows = RPNG_ENCODE_BAND_ROWS;
+
+      rpng_encode_wait_band(&job, &workers[0].scratch, i);
+
+      stream_backend->set_in(
+            stream,
+            encode_buf + first * (line_size + 1),
+            (unsigned)(rows * (line_size + 1)));
+
+      if (!stream_backend->trans(stream, false, &rd, &wn, NULL))
+         GOTO_END_ERROR();
+      total_out += wn;
+   }
+
+   {
+      uint32_t rd = 0;
+      uint32_t wn = 0;
+
+      stream_backend->set_in(stream, encode_buf, 0);
+      if (!stream_backend->trans(stream, true, &rd, &wn, NULL))
+         GOTO_END_ERROR();
+      total_out += wn;
+   }
 
    memcpy(deflate_buf + 4, "IDAT", 4);
    dword_write_be(deflate_buf + 0,        ((uint32_t)total_out));
@@ -345,14 +564,29 @@ bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
    if (!png_write_iend_string(intf_s))
       GOTO_END_ERROR();
 end:
+#ifdef HAVE_THREADS
+   /* Have the workers stop at the next band on errors. */
+   if (job.lock)
+   {
+      slock_lock(job.lock);
+      job.next_band = job.num_bands;
+      slock_unlock(job.lock);
+   }
+
+   /* Waits for the workers that started */
+   tpool_destroy(pool);
+
+   if (job.lock)
+      slock_free(job.lock);
+   if (job.cond)
+      scond_free(job.cond);
+#endif
+   for (i = 0; i <= RPNG_ENCODE_MAX_THREADS; i++)
+      rpng_filter_scratch_free(&workers[i].scratch);
+
+   free(job.band_done);
    free(encode_buf);
    free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
 
    if (stream_backend)
    {
@@ -365,6 +599,13 @@ end:
    return ret;
 }
 
+bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
+      unsigned width, unsigned height, signed pitch, unsigned bpp)
+{
+   return rpng_save_image_stream_ex(data, intf_s, width, height,
+         pitch, bpp, 9, 0);
+}
+
 bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
@@ -399,6 +640,23 @@ bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
    return ret;
 }
 
+bool rpng_save_image_bgr24_ex(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, signed pitch,
+      int level, unsigned num_threads)
+{
+   bool ret                      = false;
+   intfstream_t* intf_s          = NULL;
+
+   intf_s = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   ret = rpng_save_image_stream_ex(data, intf_s, width, height,
+                                pitch, 3, level, num_threads);
+   intfstream_close(intf_s);
+   free(intf_s);
+   return ret;
+}
+
 
 uint8_t* rpng_save_image_bgr24_string(const uint8_t *data,
       unsigned width, unsigned height, signed pitch, uint64_t* bytes)
@@ -37,10 +37,46 @@
 #undef __SSE2__
 #endif
 
+#if !defined(SCALER_NO_SIMD) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define SCALER_NEON
+#endif
+
 #if defined(__SSE2__)
 #include <emmintrin.h>
 #elif defined(__MMX__)
 #include <mmintrin.h>
+#elif defined(SCALER_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(SCALER_NEON)
+/* Expands eight 16-bit pixels to 8-bit B, G and R planes,
+ * replicating the top bits into the bottom ones. */
+static INLINE uint8x8x3_t conv_rgb565_unpack_neon(uint16x8_t in)
+{
+   uint8x8x3_t res;
+   uint8x8_t r = vand_u8(vshrn_n_u16(in, 8), vdup_n_u8(0xf8));
+   uint8x8_t g = vand_u8(vshrn_n_u16(in, 3), vdup_n_u8(0xfc));
+   uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+
+   res.val[0]  = vsri_n_u8(b, b, 5);
+   res.val[1]  = vsri_n_u8(g, g, 6);
+   res.val[2]  = vsri_n_u8(r, r, 5);
+   return res;
+}
+
+static INLINE uint8x8x3_t conv_0rgb1555_unpack_neon(uint16x8_t in)
+{
+   uint8x8x3_t res;
+   uint8x8_t r = vand_u8(vshrn_n_u16(in, 7), vdup_n_u8(0xf8));
+   uint8x8_t g = vand_u8(vshrn_n_u16(in, 2), vdup_n_u8(0xf8));
+   uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+
+   res.val[0]  = vsri_n_u8(b, b, 5);
+   res.val[1]  = vsri_n_u8(g, g, 5);
+   res.val[2]  = vsri_n_u8(r, r, 5);
+   return res;
+}
 #endif
 
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
@@ -96,6 +132,12 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          (int16_t)((0x1f << 11) | (0x1f << 6)));
    const __m128i lo_mask   = _mm_set1_epi16(0x1f);
    const __m128i glow_mask = _mm_set1_epi16(1 << 5);
+#elif defined(SCALER_NEON)
+   int max_width              = width - 7;
+
+   const uint16x8_t hi_mask   = vdupq_n_u16((0x1f << 11) | (0x1f << 6));
+   const uint16x8_t lo_mask   = vdupq_n_u16(0x1f);
+   const uint16x8_t glow_mask = vdupq_n_u16(1 << 5);
 #endif
 
    for (h = 0; h < height;
@@ -112,6 +154,15 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w),
                _mm_or_si128(rg, _mm_or_si128(b, glow)));
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t rg       = vandq_u16(vshlq_n_u16(in, 1), hi_mask);
+         uint16x8_t b        = vandq_u16(in, lo_mask);
+         uint16x8_t glow     = vandq_u16(vshrq_n_u16(in, 4), glow_mask);
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
 #endif
 
       for (; w < width; w++)
@@ -140,6 +191,8 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
    const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
    const __m128i a           = _mm_set1_epi16(0x00ff);
 
+   int max_width = width - 7;
+#elif defined(SCALER_NEON)
    int max_width = width - 7;
 #endif
 
@@ -175,6 +228,17 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint8x8x3_t bgr = conv_0rgb1555_unpack_neon(vld1q_u16(input + w));
+         res.val[0]      = bgr.val[0];
+         res.val[1]      = bgr.val[1];
+         res.val[2]      = bgr.val[2];
+         res.val[3]      = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -220,6 +284,8 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
    const __m64 a          = _mm_set1_pi16(0x00ff);
 
    int max_width            = width - 3;
+#elif defined(SCALER_NEON)
+   int max_width            = width - 7;
 #endif
 
    for (h = 0; h < height;
@@ -282,6 +348,17 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
       }
 
       _mm_empty();
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint8x8x3_t bgr = conv_rgb565_unpack_neon(vld1q_u16(input + w));
+         res.val[0]      = bgr.val[0];
+         res.val[1]      = bgr.val[1];
+         res.val[2]      = bgr.val[2];
+         res.val[3]      = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -315,6 +392,8 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
    const __m128i mul16_b    = _mm_set1_epi16(0x4200);
    const __m128i a          = _mm_set1_epi16(0x00ff);
     int max_width            = width - 7;
+#elif defined(SCALER_NEON)
+   int max_width            = width - 7;
 #endif
     for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 1)
@@ -343,6 +422,17 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
          _mm_storeu_si128((__m128i*)(output + w + 0), res_lo);
          _mm_storeu_si128((__m128i*)(output + w + 4), res_hi);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint8x8x3_t bgr = conv_rgb565_unpack_neon(vld1q_u16(input + w));
+         res.val[0]      = bgr.val[2];
+         res.val[1]      = bgr.val[1];
+         res.val[2]      = bgr.val[0];
+         res.val[3]      = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
 #endif
        for (; w < width; w++)
       {
@@ -544,6 +634,8 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
    const __m128i a           = _mm_set1_epi16(0x00ff);
 
    int max_width             = width - 15;
+#elif defined(SCALER_NEON)
+   int max_width             = width - 7;
 #endif
 
    for (h = 0; h < height;
@@ -595,6 +687,9 @@ void conv_0rgb1555_bgr24(void *output_, const void *input_,
          /* Non-POT pixel sizes for the loss */
          store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8, out += 24)
+         vst3_u8(out, conv_0rgb1555_unpack_neon(vld1q_u16(input + w)));
 #endif
 
       for (; w < width; w++)
@@ -632,6 +727,8 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
    const __m128i a          = _mm_set1_epi16(0x00ff);
 
    int max_width            = width - 15;
+#elif defined(SCALER_NEON)
+   int max_width            = width - 7;
 #endif
 
    for (h = 0; h < height; h++, output += out_stride, input += in_stride >> 1)
@@ -680,6 +777,9 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
 
          store_bgr24_sse2(out, res_lo0, res_hi0, res_lo1, res_hi1);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 8, out += 24)
+         vst3_u8(out, conv_rgb565_unpack_neon(vld1q_u16(input + w)));
 #endif
 
       for (; w < width; w++)
@@ -773,7 +873,7 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
 
-#if defined(__SSE2__)
+#if defined(__SSE2__) || defined(SCALER_NEON)
    int max_width = width - 15;
 #endif
 
@@ -791,6 +891,16 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
          __m128i l3 = _mm_loadu_si128((const __m128i*)(input + w + 12));
          store_bgr24_sse2(out, l0, l1, l2, l3);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 16, out += 48)
+      {
+         uint8x16x3_t res;
+         uint8x16x4_t in = vld4q_u8((const uint8_t*)(input + w));
+         res.val[0]      = in.val[0];
+         res.val[1]      = in.val[1];
+         res.val[2]      = in.val[2];
+         vst3q_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -826,7 +936,7 @@ void conv_abgr8888_bgr24(void *output_, const void *input_,
    const uint32_t *input = (const uint32_t*)input_;
    uint8_t *output       = (uint8_t*)output_;
 
-#if defined(__SSE2__)
+#if defined(__SSE2__) || defined(SCALER_NEON)
    int max_width = width - 15;
 #endif
 
@@ -848,6 +958,16 @@ void conv_abgr8888_bgr24(void *output_, const void *input_,
          d = conv_shuffle_rb_epi32(d);
          store_bgr24_sse2(out, a, b, c, d);
       }
+#elif defined(SCALER_NEON)
+      for (; w < max_width; w += 16, out += 48)
+      {
+         uint8x16x3_t res;
+         uint8x16x4_t in = vld4q_u8((const uint8_t*)(input + w));
+         res.val[0]      = in.val[2];
+         res.val[1]      = in.val[1];
+         res.val[2]      = in.val[0];
+         vst3q_u8(out, res);
+      }
 #endif
 
       for (; w < width; w++)
@@ -864,14 +984,29 @@ void conv_argb8888_abgr8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
 {
-   int h, w;
+   int h;
    const uint32_t *input = (const uint32_t*)input_;
    uint32_t *output      = (uint32_t*)output_;
+#if defined(SCALER_NEON)
+   int max_width         = width - 15;
+#endif
 
    for (h = 0; h < height;
          h++, output += out_stride >> 2, input += in_stride >> 2)
    {
-      for (w = 0; w < width; w++)
+      int w = 0;
+#if defined(SCALER_NEON)
+      for (; w < max_width; w += 16)
+      {
+         uint8x16x4_t px = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16_t tmp  = px.val[0];
+         px.val[0]       = px.val[2];
+         px.val[2]       = tmp;
+         vst4q_u8((uint8_t*)(output + w), px);
+      }
+#endif
+
+      for (; w < width; w++)
       {
          uint32_t col = input[w];
          output[w]    = ((col << 16) & 0xff0000) |
@@ -0,0 +1,61 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (audio_resampler_s16.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_AUDIO_RESAMPLER_S16_H
+#define __LIBRETRO_SDK_AUDIO_RESAMPLER_S16_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Fixed-point windowed sinc resampler for interleaved
+ * stereo int16 samples. Coefficients are Q15 and the
+ * stream position is kept as an integer, so no sample
+ * ever goes through float. */
+typedef struct audio_resampler_s16 audio_resampler_s16_t;
+
+/* The filter cutoff is derived from bandwidth_mod
+ * (output rate / input rate) once, at creation time. */
+audio_resampler_s16_t *audio_resampler_s16_new(double bandwidth_mod);
+
+void audio_resampler_s16_free(audio_resampler_s16_t *re);
+
+/* Resamples in_frames stereo frames by ratio and returns
+ * the amount of frames written to out, which must hold
+ * at least in_frames * ratio + 1 frames. */
+size_t audio_resampler_s16_process(audio_resampler_s16_t *re,
+      int16_t *out, const int16_t *in, size_t in_frames,
+      double ratio);
+
+/* Scales samples by gain, saturating. gain
+ * is clamped to AUDIO_RESAMPLER_S16_MAX_GAIN. */
+#define AUDIO_RESAMPLER_S16_MAX_GAIN 4.0f
+
+void audio_resampler_s16_gain(int16_t *samples, size_t count,
+      float gain);
+
+RETRO_END_DECLS
+
+#endif
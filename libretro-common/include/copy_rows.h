@@ -0,0 +1,61 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (copy_rows.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIBRETRO_COPY_ROWS_H
+#define _LIBRETRO_COPY_ROWS_H
+
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * copy_rows:
+ * @dst                : Destination of the first row.
+ * @dst_pitch          : Bytes from a destination row to the next.
+ * @src                : Source of the first row.
+ * @src_pitch          : Bytes from a source row to the next.
+ * @width              : Bytes to copy from each row.
+ * @height             : Number of rows.
+ *
+ * Copies a block of rows, as one copy when both sides are
+ * contiguous. The buffers must not overlap.
+ **/
+void copy_rows(void *dst, size_t dst_pitch,
+      const void *src, size_t src_pitch,
+      size_t width, size_t height);
+
+/**
+ * copy_rows_stream:
+ *
+ * As copy_rows(), for destinations that won't be read again
+ * soon, e.g. a frame handed to another thread or a saved
+ * state. Bypasses the cache where the CPU can.
+ **/
+void copy_rows_stream(void *dst, size_t dst_pitch,
+      const void *src, size_t src_pitch,
+      size_t width, size_t height);
+
+RETRO_END_DECLS
+
+#endif
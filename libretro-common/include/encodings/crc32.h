@@ -27,10 +27,17 @@
 #include <stddef.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
+/* Reads up to len bytes into buf, returns how many or -1 on error */
+typedef int64_t (*encoding_crc32_read_t)(void *data, void *buf, uint64_t len);
+
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
+uint32_t encoding_crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+bool encoding_crc32_read(uint32_t *crc, encoding_crc32_read_t read,
+      void *data, uint64_t max_len);
 uint32_t file_crc32(uint32_t crc, const char *path);
 
 RETRO_END_DECLS
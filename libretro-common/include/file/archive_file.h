@@ -208,6 +208,24 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path);
 
+/**
+ * file_archive_cache_init:
+ *
+ * Keeps the last archive read from open, with its index parsed
+ * and, for 7z, its last solid block decoded, for the next read from
+ * it to start from there. It's reopened if it changed on disk.
+ **/
+void file_archive_cache_init(void);
+
+/* Frees what's kept decoded, e.g. once content is loaded. */
+void file_archive_cache_trim(void);
+
+void file_archive_cache_deinit(void);
+
+void sevenzip_cache_init(void);
+void sevenzip_cache_trim(void);
+void sevenzip_cache_deinit(void);
+
 extern const struct file_archive_file_backend zlib_backend;
 extern const struct file_archive_file_backend sevenzip_backend;
 
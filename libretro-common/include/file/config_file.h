@@ -56,7 +56,10 @@ struct config_file
    char *path;
    struct config_entry_list *entries;
    struct config_entry_list *tail;
-   struct config_entry_list *last;
+   /* Of the keys to the first entry of each */
+   struct config_entry_list **map;
+   size_t map_size;
+   size_t map_count;
    unsigned include_depth;
    bool guaranteed_no_duplicates;
 
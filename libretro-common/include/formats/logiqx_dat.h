@@ -97,7 +97,9 @@ bool logiqx_dat_get_next(
 
 /* Fetches information for the specified game.
  * Returns false if game does not exist, or arguments
- * are invalid. */
+ * are invalid.
+ * Only reads the DAT file, so it can be searched from
+ * several threads at once. */
 bool logiqx_dat_search(
       logiqx_dat_t *dat_file, const char *game_name,
       logiqx_dat_game_info_t *game_info);
@@ -56,6 +56,13 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
 
+/* Same as rpng_save_image_bgr24(), but deflates with the given
+ * zlib level and runs the row filters on up to num_threads
+ * worker threads, next to the calling one. */
+bool rpng_save_image_bgr24_ex(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, signed pitch,
+      int level, unsigned num_threads);
+
 uint8_t* rpng_save_image_bgr24_string(const uint8_t *data,
       unsigned width, unsigned height, signed pitch, uint64_t *bytes);
 
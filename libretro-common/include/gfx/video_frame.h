@@ -28,6 +28,7 @@
 #include <retro_inline.h>
 
 #include <gfx/scaler/scaler.h>
+#include <gfx/scaler/pixconv.h>
 
 #include <libretro.h>
 
@@ -185,6 +186,7 @@ static INLINE void video_frame_convert_rgba_to_bgr(
       void *dst_data,
       unsigned width)
 {
+#ifdef MSB_FIRST
    unsigned x;
    uint8_t      *dst  = (uint8_t*)dst_data;
    const uint8_t *src = (const uint8_t*)src_data;
@@ -195,6 +197,12 @@ static INLINE void video_frame_convert_rgba_to_bgr(
       dst[1] = src[1];
       dst[2] = src[0];
    }
+#else
+   /* RGBA bytes are ABGR8888 words on little-endian,
+    * which has SIMD paths. */
+   conv_abgr8888_bgr24(dst_data, src_data, width, 1,
+         width * 3, width * 4);
+#endif
 }
 
 static INLINE bool video_pixel_frame_scale(
@@ -1287,6 +1287,15 @@ enum retro_mod
                                             * based systems).
                                             */
 
+#define RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK 62
+                                           /* const struct retro_audio_buffer_status_callback * --
+                                            * Lets the core know how full the frontend's audio
+                                            * buffer is, once per frame before retro_run(). Cores
+                                            * can use it to skip rendering frames when audio is
+                                            * about to run dry, keeping emulation at full speed.
+                                            * A NULL callback unregisters it.
+                                            */
+
 /* VFS functionality */
 
 /* File paths:
@@ -1484,6 +1493,30 @@ struct retro_led_interface
     retro_set_led_state_t set_led_state;
 };
 
+/* Notifies a libretro core of the current occupancy
+ * level of the frontend audio buffer.
+ *
+ * - active: 'true' if audio buffer is currently
+ *           in use. Will be 'false' if audio is
+ *           disabled in the frontend
+ *
+ * - occupancy: Given as a value in the range [0,100],
+ *              corresponding to the occupancy percentage
+ *              of the audio buffer
+ *
+ * - underrun_likely: 'true' if the frontend expects an
+ *                    audio buffer underrun during the
+ *                    next frame (indicates that a core
+ *                    should attempt frame skipping)
+ *
+ * It will be called right before retro_run() every frame. */
+typedef void (RETRO_CALLCONV *retro_audio_buffer_status_callback_t)(
+      bool active, unsigned occupancy, bool underrun_likely);
+struct retro_audio_buffer_status_callback
+{
+   retro_audio_buffer_status_callback_t callback;
+};
+
 /* Retrieves the current state of the MIDI input.
  * Returns true if it's enabled, false otherwise. */
 typedef bool (RETRO_CALLCONV *retro_midi_input_enabled_t)(void);
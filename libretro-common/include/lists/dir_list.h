@@ -82,6 +82,50 @@ void dir_list_sort(struct string_list *list, bool dir_first);
  **/
 void dir_list_free(struct string_list *list);
 
+/* Lists a directory a few entries at a time, non-recursively */
+struct dir_list_reader;
+
+/**
+ * dir_list_reader_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ *
+ * Opens a directory to be listed a few entries at a time,
+ * with dir_list_reader_read.
+ *
+ * Returns: the reader, or NULL if the directory couldn't be opened.
+ **/
+struct dir_list_reader *dir_list_reader_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed);
+
+/**
+ * dir_list_reader_read:
+ * @reader             : the reader.
+ * @max                : number of entries to read at most.
+ *
+ * Reads the next entries of the directory.
+ *
+ * Returns: 1 if there are entries left, 0 when the whole directory
+ * was read, -1 on error.
+ **/
+int dir_list_reader_read(struct dir_list_reader *reader, size_t max);
+
+/**
+ * dir_list_reader_take:
+ * @reader             : the reader.
+ *
+ * Frees the reader, keeping what it listed.
+ *
+ * Returns: the listing, has to be freed manually.
+ **/
+struct string_list *dir_list_reader_take(struct dir_list_reader *reader);
+
+void dir_list_reader_free(struct dir_list_reader *reader);
+
 RETRO_END_DECLS
 
 #endif
@@ -49,4 +49,20 @@ int memsync(void *start, void *end);
 
 int memprotect(void *addr, size_t len);
 
+/* Flags for memmap_set_hot_flags */
+#define MEMMAP_HOT_HUGEPAGE (1 << 0) /* Transparent huge pages, Linux */
+#define MEMMAP_HOT_LOCK     (1 << 1) /* Kept out of swap */
+
+/* Sets how memmap_alloc_hot backs what it allocates from now on,
+ * MEMMAP_HOT_HUGEPAGE by default. */
+void memmap_set_hot_flags(unsigned flags);
+
+/* Zeroed, page aligned memory for big buffers used every frame.
+ * With MEMMAP_HOT_HUGEPAGE, those of 2 MB and up are aligned to
+ * and advised for huge pages. Falls back to the heap without mmap.
+ * Freed with memmap_free_hot, given the same size. */
+void *memmap_alloc_hot(size_t size);
+
+void memmap_free_hot(void *ptr, size_t size);
+
 #endif
@@ -42,6 +42,19 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/* Order in which the threaded queue hands tasks
+ * to its workers, most urgent first. */
+enum task_priority
+{
+   /* loads the user is waiting on (thumbnails, backgrounds) */
+   TASK_PRIORITY_INTERACTIVE = 0,
+   TASK_PRIORITY_SAVE,
+   TASK_PRIORITY_NORMAL,
+   TASK_PRIORITY_SCAN,
+   TASK_PRIORITY_DOWNLOAD,
+   TASK_PRIORITY_LAST
+};
+
 typedef struct retro_task retro_task_t;
 typedef void (*retro_task_callback_t)(retro_task_t *task,
       void *task_data,
@@ -123,7 +136,17 @@ struct retro_task
    task progress display */
    bool alternative_look;
 
+   /* set by task_init to TASK_PRIORITY_NORMAL */
+   enum task_priority priority;
+
+   /* tasks with the same affinity never run at the
+    * same time. NULL means the handler, so tasks of
+    * one kind run one at a time unless the handler is
+    * reentrant and sets this to the task itself. */
+   void *affinity;
+
    /* don't touch this. */
+   bool busy;
    retro_task_t *next;
 };
 
@@ -192,6 +215,15 @@ void task_queue_unset_threaded(void);
 
 bool task_queue_is_threaded(void);
 
+struct tpool;
+
+/* Returns the thread pool that tasks can hand work of their own
+ * to, from the task they run or the main thread. It goes away
+ * when the task queue stops being threaded, after finishing all
+ * the work it was handed, so ask for it again each time.
+ * NULL if the task queue isn't threaded. */
+struct tpool *task_queue_get_pool(void);
+
 /**
  * Calls func for every running task
  * until it returns true.
@@ -219,6 +251,12 @@ void task_queue_check(void);
  * and the task will be ignored. */
 bool task_queue_push(retro_task_t *task);
 
+/* Returns a file descriptor that is readable while finished
+ * tasks wait for task_queue_check, for an idle main loop to
+ * sleep on. It stays the same for the lifetime of the process.
+ * -1 if the platform or the current task system has none. */
+int task_queue_wakeup_fd(void);
+
 /* Blocks until all tasks have finished
  * will return early if cond is not NULL
  * and cond(data) returns false.
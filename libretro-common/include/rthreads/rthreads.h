@@ -103,6 +103,46 @@ void sthread_join(sthread_t *thread);
  */
 bool sthread_isself(sthread_t *thread);
 
+/* What a thread does, for the frontend to place it */
+enum sthread_role
+{
+   STHREAD_ROLE_NONE = 0,
+   STHREAD_ROLE_MAIN,
+   STHREAD_ROLE_VIDEO,
+   STHREAD_ROLE_AUDIO,
+   STHREAD_ROLE_TASK,
+   STHREAD_ROLE_FILTER,
+   STHREAD_ROLE_LAST
+};
+
+typedef struct sthread_role_policy
+{
+   uint64_t cpu_mask; /* bit n for core n, 0 for any core */
+   int nice;          /* -20 to 19, for the default scheduler */
+   int rt_priority;   /* SCHED_FIFO from [1-99], 0 for the default scheduler */
+} sthread_role_policy_t;
+
+/**
+ * sthread_set_role:
+ * @role                    : what the calling thread does,
+ *                            STHREAD_ROLE_NONE before it exits.
+ *
+ * Registers the calling thread for the policy of @role, applying
+ * it now and whenever it changes. Only does something on Linux.
+ */
+void sthread_set_role(enum sthread_role role);
+
+/**
+ * sthread_set_role_policy:
+ * @role                    : threads to apply it to.
+ * @policy                  : cores and priority for them.
+ *
+ * Sets the policy of @role and applies it to the threads
+ * registered for it.
+ */
+void sthread_set_role_policy(enum sthread_role role,
+      const sthread_role_policy_t *policy);
+
 /**
  * slock_new:
  *
@@ -35,6 +35,8 @@
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 
+#include <rthreads/rthreads.h>
+
 RETRO_BEGIN_DECLS
 
 struct tpool;
@@ -48,6 +50,25 @@ typedef struct tpool tpool_t;
  **/
 typedef void (*thread_func_t)(void *arg);
 
+/**
+ * (*tpool_range_func_t):
+ * @arg           : Argument.
+ * @begin         : First index of the range.
+ * @end           : One past the last index of the range.
+ *
+ * Callback function for tpool_parallel_for.
+ **/
+typedef void (*tpool_range_func_t)(void *arg, size_t begin, size_t end);
+
+/* Counts the work added with tpool_add_work_group that has not
+ * completed yet. Lives wherever the caller wants (the stack is
+ * fine), initialize it with tpool_waitgroup_init. Only touched
+ * with the pool lock held. */
+typedef struct tpool_waitgroup
+{
+   size_t count;
+} tpool_waitgroup_t;
+
 /**
  * tpool_create:
  * @num           : Number of threads the pool should have.
@@ -59,6 +80,18 @@ typedef void (*thread_func_t)(void *arg);
  */
 tpool_t *tpool_create(size_t num);
 
+/**
+ * tpool_create_with_role:
+ * @num           : Number of threads the pool should have.
+ *                  If 0 defaults to 2.
+ * @role          : What the threads do, see sthread_set_role.
+ *
+ * Create a thread pool whose threads are placed by @role.
+ *
+ * Returns: pool.
+ */
+tpool_t *tpool_create_with_role(size_t num, enum sthread_role role);
+
 /** 
  * tpool_destroy:
  * @tp            : Thread pool.
@@ -91,6 +124,54 @@ bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg);
  */
 void tpool_wait(tpool_t *tp);
 
+/**
+ * tpool_waitgroup_init:
+ * @wg            : Wait group.
+ *
+ * Sets up an empty wait group.
+ */
+void tpool_waitgroup_init(tpool_waitgroup_t *wg);
+
+/**
+ * tpool_add_work_group:
+ * @tp         : Thread pool.
+ * @wg         : Wait group the work counts towards.
+ * @func       : Function the pool should call.
+ * @arg        : Argument to pass to func.
+ *
+ * Add work to a thread pool as part of @wg.
+ *
+ * Returns: true if work was added, otherwise false.
+ **/
+bool tpool_add_work_group(tpool_t *tp, tpool_waitgroup_t *wg,
+      thread_func_t func, void *arg);
+
+/**
+ * tpool_wait_group:
+ * @tp         : Thread pool.
+ * @wg         : Wait group.
+ *
+ * Wait for the work of @wg to be completed. The calling thread
+ * runs queued work of the pool in the meantime, so this can be
+ * called from work running on the pool.
+ */
+void tpool_wait_group(tpool_t *tp, tpool_waitgroup_t *wg);
+
+/**
+ * tpool_parallel_for:
+ * @tp         : Thread pool, NULL to run on the calling thread.
+ * @count      : Number of indices.
+ * @grain      : Smallest range worth a work item,
+ *               0 splits in four per thread.
+ * @func       : Function called for each range.
+ * @arg        : Argument to pass to func.
+ *
+ * Calls @func over ranges covering [0, @count) on the pool and
+ * the calling thread, and returns when all of them are done.
+ */
+void tpool_parallel_for(tpool_t *tp, size_t count, size_t grain,
+      tpool_range_func_t func, void *arg);
+
 RETRO_END_DECLS
 
 #endif
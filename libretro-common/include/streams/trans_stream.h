@@ -72,6 +72,10 @@ struct trans_stream_backend
    /* Perform a transcoding, flushing/finalizing if asked to. Writes out how
     * many bytes were read and written. Error target optional. */
    bool  (*trans)(void *, bool, uint32_t *, uint32_t *, enum trans_stream_error *);
+
+   /* (Optional) Prime with a dictionary, e.g. a savestate of the same
+    * core; both ends need the same one. Before the first transcoding. */
+   bool  (*set_dict)(void *, const uint8_t *, uint32_t);
 };
 
 /**
@@ -93,12 +97,34 @@ bool trans_stream_trans_full(
     uint8_t *out, uint32_t out_size,
     enum trans_stream_error *error);
 
+/**
+ * trans_stream_get_decoder:
+ * @data                        : start of the compressed data
+ * @size                        : bytes at @data
+ *
+ * Tells zstd and LZ4 frames and zlib streams apart by their first bytes.
+ *
+ * Returns: the backend to decompress @data with, NULL if it's none of
+ * those or the backend isn't built in.
+ */
+const struct trans_stream_backend* trans_stream_get_decoder(
+    const uint8_t *data, uint32_t size);
+
+/* These return NULL when the backend isn't built in */
 const struct trans_stream_backend* trans_stream_get_zlib_deflate_backend(void);
 const struct trans_stream_backend* trans_stream_get_zlib_inflate_backend(void);
+const struct trans_stream_backend* trans_stream_get_zstd_compress_backend(void);
+const struct trans_stream_backend* trans_stream_get_zstd_decompress_backend(void);
+const struct trans_stream_backend* trans_stream_get_lz4_compress_backend(void);
+const struct trans_stream_backend* trans_stream_get_lz4_decompress_backend(void);
 const struct trans_stream_backend* trans_stream_get_pipe_backend(void);
 
 extern const struct trans_stream_backend zlib_deflate_backend;
 extern const struct trans_stream_backend zlib_inflate_backend;
+extern const struct trans_stream_backend zstd_compress_backend;
+extern const struct trans_stream_backend zstd_decompress_backend;
+extern const struct trans_stream_backend lz4_compress_backend;
+extern const struct trans_stream_backend lz4_decompress_backend;
 extern const struct trans_stream_backend pipe_backend;
 
 RETRO_END_DECLS
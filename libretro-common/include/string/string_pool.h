@@ -0,0 +1,69 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (string_pool.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_STRING_POOL_H
+#define __LIBRETRO_SDK_STRING_POOL_H
+
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Strings allocated together in a few large blocks and freed all at
+ * once with the pool, for the many small strings of a list that live
+ * as long as it does. None can be freed on its own. */
+typedef struct string_pool string_pool_t;
+
+string_pool_t *string_pool_new(void);
+
+void string_pool_free(string_pool_t *pool);
+
+/**
+ * string_pool_strdup:
+ * @pool               : pool to copy @str into.
+ * @str                : string to copy, can be NULL.
+ *
+ * Returns: the copy, or NULL if @str is NULL or out of memory.
+ **/
+char *string_pool_strdup(string_pool_t *pool, const char *str);
+
+/**
+ * string_pool_intern:
+ * @pool               : pool to copy @str into.
+ * @str                : string to copy, can be NULL.
+ *
+ * Like string_pool_strdup(), but equal strings are only copied once,
+ * for values repeated a lot. The copy is shared, and mustn't be
+ * changed.
+ *
+ * Returns: the copy, or NULL if @str is NULL or out of memory.
+ **/
+char *string_pool_intern(string_pool_t *pool, const char *str);
+
+/* Whether @str was allocated from @pool */
+bool string_pool_owns(const string_pool_t *pool, const char *str);
+
+RETRO_END_DECLS
+
+#endif
@@ -81,6 +81,12 @@ struct libretro_vfs_implementation_file
    uint64_t mappos;
    uint64_t mapsize;
    uint8_t *mapped;
+   /* Where the last read ended, how many reads in a row started
+    * there and how far the kernel was asked to read ahead */
+   uint64_t prefetch_pos;
+   uint64_t prefetch_end;
+   unsigned prefetch_hits;
+   bool prefetch;
    enum vfs_scheme scheme;
 #ifdef HAVE_CDROM
    vfs_cdrom_t cdrom;
@@ -31,6 +31,10 @@
 
 RETRO_BEGIN_DECLS
 
+/* Have files opened for reading from now on read ahead of sequential
+ * reads, where the platform supports it */
+void retro_vfs_file_set_prefetch(bool enable);
+
 libretro_vfs_implementation_file *retro_vfs_file_open_impl(const char *path, unsigned mode, unsigned hints);
 
 int retro_vfs_file_close_impl(libretro_vfs_implementation_file *stream);
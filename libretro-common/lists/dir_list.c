@@ -86,6 +86,73 @@ void dir_list_free(struct string_list *list)
    string_list_free(list);
 }
 
+static int dir_list_read(const char *dir,
+      struct string_list *list, struct string_list *ext_list,
+      bool include_dirs, bool include_hidden,
+      bool include_compressed, bool recursive);
+
+/* Adds the entry read last, returns -1 if it couldn't be added */
+static int dir_list_read_entry(struct RDIR *entry, const char *dir,
+      struct string_list *list, struct string_list *ext_list,
+      bool include_dirs, bool include_hidden,
+      bool include_compressed, bool recursive)
+{
+   union string_list_elem_attr attr;
+   char file_path[PATH_MAX_LENGTH];
+   const char *name                = retro_dirent_get_name(entry);
+
+   if (!include_hidden && *name == '.')
+      return 0;
+   if (!strcmp(name, ".") || !strcmp(name, ".."))
+      return 0;
+
+   file_path[0] = '\0';
+   fill_pathname_join(file_path, dir, name, sizeof(file_path));
+
+   if (retro_dirent_is_dir(entry, NULL))
+   {
+      if (recursive)
+         dir_list_read(file_path, list, ext_list, include_dirs,
+               include_hidden, include_compressed, recursive);
+
+      if (!include_dirs)
+         return 0;
+      attr.i = RARCH_DIRECTORY;
+   }
+   else
+   {
+      const char *file_ext    = path_get_extension(name);
+
+      attr.i                  = RARCH_FILETYPE_UNSET;
+
+      /*
+       * If the file format is explicitly supported by the libretro-core, we
+       * need to immediately load it and not designate it as a compressed file.
+       *
+       * Example: .zip could be supported as a image by the core and as a
+       * compressed_file. In that case, we have to interpret it as a image.
+       *
+       * */
+      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
+         attr.i            = RARCH_PLAIN_FILE;
+      else
+      {
+         bool is_compressed_file;
+         if ((is_compressed_file = path_is_compressed_file(file_path)))
+            attr.i               = RARCH_COMPRESSED_ARCHIVE;
+
+         if (ext_list &&
+               (!is_compressed_file || !include_compressed))
+            return 0;
+      }
+   }
+
+   if (!string_list_append(list, file_path, attr))
+      return -1;
+
+   return 0;
+}
+
 /**
  * dir_list_read:
  * @dir                : directory path.
@@ -112,57 +179,8 @@ static int dir_list_read(const char *dir,
 
    while (retro_readdir(entry))
    {
-      union string_list_elem_attr attr;
-      char file_path[PATH_MAX_LENGTH];
-      const char *name                = retro_dirent_get_name(entry);
-
-      if (!include_hidden && *name == '.')
-         continue;
-      if (!strcmp(name, ".") || !strcmp(name, ".."))
-         continue;
-
-      file_path[0] = '\0';
-      fill_pathname_join(file_path, dir, name, sizeof(file_path));
-
-      if (retro_dirent_is_dir(entry, NULL))
-      {
-         if (recursive)
-            dir_list_read(file_path, list, ext_list, include_dirs,
-                  include_hidden, include_compressed, recursive);
-
-         if (!include_dirs)
-            continue;
-         attr.i = RARCH_DIRECTORY;
-      }
-      else
-      {
-         const char *file_ext    = path_get_extension(name);
-
-         attr.i                  = RARCH_FILETYPE_UNSET;
-
-         /*
-          * If the file format is explicitly supported by the libretro-core, we
-          * need to immediately load it and not designate it as a compressed file.
-          *
-          * Example: .zip could be supported as a image by the core and as a
-          * compressed_file. In that case, we have to interpret it as a image.
-          *
-          * */
-         if (string_list_find_elem_prefix(ext_list, ".", file_ext))
-            attr.i            = RARCH_PLAIN_FILE;
-         else
-         {
-            bool is_compressed_file;
-            if ((is_compressed_file = path_is_compressed_file(file_path)))
-               attr.i               = RARCH_COMPRESSED_ARCHIVE;
-
-            if (ext_list &&
-                  (!is_compressed_file || !include_compressed))
-               continue;
-         }
-      }
-
-      if (!string_list_append(list, file_path, attr))
+      if (dir_list_read_entry(entry, dir, list, ext_list, include_dirs,
+               include_hidden, include_compressed, recursive) == -1)
          goto error;
    }
 
@@ -238,3 +256,121 @@ struct string_list *dir_list_new(const char *dir,
 
    return list;
 }
+
+struct dir_list_reader
+{
+   struct RDIR *entry;
+   struct string_list *list;
+   struct string_list *ext_list;
+   bool include_dirs;
+   bool include_hidden;
+   bool include_compressed;
+   char dir[PATH_MAX_LENGTH];
+};
+
+/**
+ * dir_list_reader_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ *
+ * Opens a directory to be listed a few entries at a time,
+ * with dir_list_reader_read.
+ *
+ * Returns: the reader, or NULL if the directory couldn't be opened.
+ **/
+struct dir_list_reader *dir_list_reader_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed)
+{
+   struct dir_list_reader *reader = (struct dir_list_reader*)
+      calloc(1, sizeof(*reader));
+
+   if (!reader)
+      return NULL;
+
+   reader->entry              = retro_opendir_include_hidden(dir,
+         include_hidden);
+   reader->list               = string_list_new();
+   reader->ext_list           = ext ? string_split(ext, "|") : NULL;
+   reader->include_dirs       = include_dirs;
+   reader->include_hidden     = include_hidden;
+   reader->include_compressed = include_compressed;
+   strlcpy(reader->dir, dir, sizeof(reader->dir));
+
+   if (  !reader->entry
+       || retro_dirent_error(reader->entry)
+       || !reader->list)
+   {
+      dir_list_reader_free(reader);
+      return NULL;
+   }
+
+   return reader;
+}
+
+/**
+ * dir_list_reader_read:
+ * @reader             : the reader.
+ * @max                : number of entries to read at most.
+ *
+ * Reads the next entries of the directory.
+ *
+ * Returns: 1 if there are entries left, 0 when the whole directory
+ * was read, -1 on error.
+ **/
+int dir_list_reader_read(struct dir_list_reader *reader, size_t max)
+{
+   if (!reader->entry)
+      return 0;
+
+   while (max--)
+   {
+      if (!retro_readdir(reader->entry))
+      {
+         retro_closedir(reader->entry);
+         reader->entry = NULL;
+         return 0;
+      }
+
+      if (dir_list_read_entry(reader->entry, reader->dir, reader->list,
+               reader->ext_list, reader->include_dirs,
+               reader->include_hidden, reader->include_compressed,
+               false) == -1)
+         return -1;
+   }
+
+   return 1;
+}
+
+/**
+ * dir_list_reader_take:
+ * @reader             : the reader.
+ *
+ * Frees the reader, keeping what it listed.
+ *
+ * Returns: the listing, has to be freed manually.
+ **/
+struct string_list *dir_list_reader_take(struct dir_list_reader *reader)
+{
+   struct string_list *list = reader->list;
+
+   reader->list = NULL;
+   dir_list_reader_free(reader);
+
+   return list;
+}
+
+void dir_list_reader_free(struct dir_list_reader *reader)
+{
+   if (!reader)
+      return;
+
+   if (reader->entry)
+      retro_closedir(reader->entry);
+   string_list_free(reader->list);
+   string_list_free(reader->ext_list);
+   free(reader);
+}
@@ -20,6 +20,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -286,9 +287,94 @@ static int file_list_type_cmp(const void *a_, const void *b_)
    return 1;
 }
 
+/* Sorting on alt is done on these rather than on the entries, the
+ * first characters folded into a number settle most comparisons
+ * without going through strcasecmp. */
+struct file_list_sort_key
+{
+   uint64_t prefix;
+   const char *str;
+   size_t idx;
+};
+
+static uint64_t file_list_sort_prefix(const char *str)
+{
+   uint64_t prefix = 0;
+   unsigned i;
+
+   /* Big-endian, so that numbers compare like the strings.
+    * The terminator pads shorter strings with zeros. */
+   for (i = 0; i < 8; i++)
+   {
+      unsigned char c = (unsigned char)*str;
+      if (c >= 'A' && c <= 'Z')
+         c += 'a' - 'A';
+      prefix = (prefix << 8) | c;
+      if (*str)
+         str++;
+   }
+
+   return prefix;
+}
+
+static int file_list_sort_key_cmp(const void *a_, const void *b_)
+{
+   const struct file_list_sort_key *a = (const struct file_list_sort_key*)a_;
+   const struct file_list_sort_key *b = (const struct file_list_sort_key*)b_;
+   int ret;
+
+   if (a->prefix != b->prefix)
+      return a->prefix < b->prefix ? -1 : 1;
+
+   ret = strcasecmp(a->str, b->str);
+   if (ret)
+      return ret;
+
+   /* Equal names keep the order they were listed in */
+   return a->idx < b->idx ? -1 : (a->idx > b->idx);
+}
+
 void file_list_sort_on_alt(file_list_t *list)
 {
-   qsort(list->list, list->size, sizeof(list->list[0]), file_list_alt_cmp);
+   struct file_list_sort_key *keys = NULL;
+   struct item_file *sorted        = NULL;
+   size_t i;
+
+   if (!list || list->size < 2)
+      return;
+
+   keys   = (struct file_list_sort_key*)malloc(list->size * sizeof(*keys));
+   sorted = (struct item_file*)malloc(list->size * sizeof(*sorted));
+
+   if (!keys || !sorted)
+   {
+      free(keys);
+      free(sorted);
+      qsort(list->list, list->size, sizeof(list->list[0]), file_list_alt_cmp);
+      return;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      const struct item_file *item = &list->list[i];
+      const char *str              = item->alt ? item->alt : item->path;
+
+      if (!str)
+         str = "";
+
+      keys[i].prefix = file_list_sort_prefix(str);
+      keys[i].str    = str;
+      keys[i].idx    = i;
+   }
+
+   qsort(keys, list->size, sizeof(*keys), file_list_sort_key_cmp);
+
+   for (i = 0; i < list->size; i++)
+      sorted[i] = list->list[keys[i].idx];
+   memcpy(list->list, sorted, list->size * sizeof(*sorted));
+
+   free(sorted);
+   free(keys);
 }
 
 void file_list_sort_on_type(file_list_t *list)
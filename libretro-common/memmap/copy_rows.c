@@ -0,0 +1,138 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (copy_rows.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <copy_rows.h>
+
+/* AdvSIMD is part of every AArch64 CPU, no need to ask */
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_COPY_ROWS_ASIMD
+#endif
+
+#ifdef HAVE_COPY_ROWS_ASIMD
+/* 64 bytes per iteration through q0-q3, the tail with memcpy() */
+static void copy_line_asimd(uint8_t *dst, const uint8_t *src, size_t len)
+{
+   size_t blocks = len >> 6;
+
+   if (blocks)
+      __asm__ __volatile__(
+            "1:\n"
+            "prfm pldl1strm, [%[src], #256]\n"
+            "ldp q0, q1, [%[src]], #32\n"
+            "ldp q2, q3, [%[src]], #32\n"
+            "subs %[blocks], %[blocks], #1\n"
+            "stp q0, q1, [%[dst]], #32\n"
+            "stp q2, q3, [%[dst]], #32\n"
+            "b.ne 1b\n"
+            : [dst] "+r" (dst), [src] "+r" (src), [blocks] "+r" (blocks)
+            :
+            : "v0", "v1", "v2", "v3", "cc", "memory");
+
+   if (len & 63)
+      memcpy(dst, src, len & 63);
+}
+
+/* As above with non-temporal stores, which leave the
+ * destination out of the cache */
+static void copy_line_asimd_stream(uint8_t *dst, const uint8_t *src,
+      size_t len)
+{
+   size_t blocks = len >> 6;
+
+   if (blocks)
+      __asm__ __volatile__(
+            "1:\n"
+            "prfm pldl1strm, [%[src], #256]\n"
+            "ldp q0, q1, [%[src]]\n"
+            "ldp q2, q3, [%[src], #32]\n"
+            "add %[src], %[src], #64\n"
+            "subs %[blocks], %[blocks], #1\n"
+            "stnp q0, q1, [%[dst]]\n"
+            "stnp q2, q3, [%[dst], #32]\n"
+            "add %[dst], %[dst], #64\n"
+            "b.ne 1b\n"
+            : [dst] "+r" (dst), [src] "+r" (src), [blocks] "+r" (blocks)
+            :
+            : "v0", "v1", "v2", "v3", "cc", "memory");
+
+   if (len & 63)
+      memcpy(dst, src, len & 63);
+}
+#endif
+
+static void copy_line(uint8_t *dst, const uint8_t *src, size_t len,
+      bool stream)
+{
+#ifdef HAVE_COPY_ROWS_ASIMD
+   /* Short lines aren't worth leaving memcpy() for */
+   if (len >= 256)
+   {
+      if (stream)
+         copy_line_asimd_stream(dst, src, len);
+      else
+         copy_line_asimd(dst, src, len);
+      return;
+   }
+#endif
+   memcpy(dst, src, len);
+}
+
+static void copy_rows_internal(void *dst, size_t dst_pitch,
+      const void *src, size_t src_pitch,
+      size_t width, size_t height, bool stream)
+{
+   uint8_t *out      = (uint8_t*)dst;
+   const uint8_t *in = (const uint8_t*)src;
+
+   if (!width || !height)
+      return;
+
+   /* Rows that follow each other on both sides are one line */
+   if (dst_pitch == width && src_pitch == width)
+   {
+      copy_line(out, in, width * height, stream);
+      return;
+   }
+
+   for (; height; height--, out += dst_pitch, in += src_pitch)
+      copy_line(out, in, width, stream);
+}
+
+void copy_rows(void *dst, size_t dst_pitch,
+      const void *src, size_t src_pitch,
+      size_t width, size_t height)
+{
+   copy_rows_internal(dst, dst_pitch, src, src_pitch,
+         width, height, false);
+}
+
+void copy_rows_stream(void *dst, size_t dst_pitch,
+      const void *src, size_t src_pitch,
+      size_t width, size_t height)
+{
+   copy_rows_internal(dst, dst_pitch, src, src_pitch,
+         width, height, true);
+}
@@ -21,7 +21,10 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <memmap.h>
+#include <memalign.h>
 
 #ifndef PROT_READ
 #define PROT_READ         0x1  /* Page can be read */
@@ -161,3 +164,86 @@ int memprotect(void *addr, size_t len)
 {
    return mprotect(addr, len, PROT_READ | PROT_WRITE | PROT_EXEC);
 }
+
+#define MEMMAP_HOT_PAGE_SIZE      4096
+#define MEMMAP_HOT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static unsigned memmap_hot_flags = MEMMAP_HOT_HUGEPAGE;
+
+void memmap_set_hot_flags(unsigned flags)
+{
+   memmap_hot_flags = flags;
+}
+
+void *memmap_alloc_hot(size_t size)
+{
+   size_t len     = (size + MEMMAP_HOT_PAGE_SIZE - 1)
+      & ~((size_t)MEMMAP_HOT_PAGE_SIZE - 1);
+#if defined(HAVE_MMAN)
+   unsigned flags = memmap_hot_flags;
+   size_t align   = 0;
+   uint8_t *map   = NULL;
+   uint8_t *data  = NULL;
+
+#ifdef MADV_HUGEPAGE
+   if ((flags & MEMMAP_HOT_HUGEPAGE) && len >= MEMMAP_HOT_HUGE_PAGE_SIZE)
+      align = MEMMAP_HOT_HUGE_PAGE_SIZE;
+#endif
+
+   if (!size)
+      return NULL;
+
+   map = (uint8_t*)mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+#ifdef MAP_ANONYMOUS
+         MAP_PRIVATE | MAP_ANONYMOUS,
+#else
+         MAP_PRIVATE | MAP_ANON,
+#endif
+         -1, 0);
+   if ((void*)map == MAP_FAILED)
+      return NULL;
+
+   data = map;
+
+#ifdef MADV_HUGEPAGE
+   if (align)
+   {
+      /* Mapped one huge page over, to trim to a boundary */
+      data = (uint8_t*)(((uintptr_t)map + align - 1)
+            & ~((uintptr_t)align - 1));
+      if (data > map)
+         munmap(map, data - map);
+      if (map + align > data)
+         munmap(data + len, map + align - data);
+      madvise(data, len, MADV_HUGEPAGE);
+   }
+#endif
+
+   /* Needs CAP_IPC_LOCK or a big enough RLIMIT_MEMLOCK, the
+    * memory is still usable without */
+   if (flags & MEMMAP_HOT_LOCK)
+      mlock(data, len);
+
+   return data;
+#else
+   void *data     = size ? memalign_alloc(MEMMAP_HOT_PAGE_SIZE, len) : NULL;
+
+   if (data)
+      memset(data, 0, len);
+   return data;
+#endif
+}
+
+void memmap_free_hot(void *ptr, size_t size)
+{
+   if (!ptr)
+      return;
+
+#if defined(HAVE_MMAN)
+   munmap(ptr, (size + MEMMAP_HOT_PAGE_SIZE - 1)
+         & ~((size_t)MEMMAP_HOT_PAGE_SIZE - 1));
+#else
+   (void)size;
+   memalign_free(ptr);
+#endif
+}
@@ -35,6 +35,26 @@
 #include <string.h>
 #include <retro_common_api.h>
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#define SLOCK_LOCK(x) slock_lock(x)
+#define SLOCK_UNLOCK(x) slock_unlock(x)
+#else
+#define SLOCK_LOCK(x)
+#define SLOCK_UNLOCK(x)
+#endif
+
+/* Connections kept open after a response, for the next
+ * request to the same server. Servers usually drop idle
+ * connections after 5 to 15 seconds. */
+#define NET_HTTP_POOL_SIZE         4
+#define NET_HTTP_POOL_TIMEOUT_USEC 5000000
+
+/* Times a GET that lost its connection in the body
+ * asks for the rest with a Range request. */
+#define NET_HTTP_MAX_RESUMES       3
 
 enum
 {
@@ -67,12 +87,36 @@ struct http_t
    char part;
    char bodytype;
    bool error;
+   bool keepalive; /* the server keeps the connection open */
+   bool reused;    /* the connection came from the pool */
 
    size_t pos;
    size_t len;
    size_t buflen;
    char *data;
    struct http_socket_state_t sock_state;
+
+   /* To send the request again on a new connection */
+   char *request;
+   char *domain;
+   int port;
+   bool resumable;
+   unsigned resumes;
+
+   /* Body received before the connection was lost,
+    * while the headers of the Range request come in */
+   char *body;
+   size_t body_buflen;
+   size_t body_len;
+   size_t resume_from;
+};
+
+struct http_idle_connection
+{
+   char *domain;
+   int port;
+   retro_time_t since;
+   struct http_socket_state_t sock_state;
 };
 
 struct http_connection_t
@@ -92,6 +136,11 @@ struct http_connection_t
 static char urlencode_lut[256];
 static bool urlencode_lut_inited = false;
 
+static struct http_idle_connection net_http_pool[NET_HTTP_POOL_SIZE];
+#ifdef HAVE_THREADS
+static slock_t *net_http_pool_lock = NULL;
+#endif
+
 void urlencode_lut_init(void)
 {
    unsigned i;
@@ -175,16 +224,17 @@ void net_http_urlencode_full(char *dest,
    free (tmp);
 }
 
-static int net_http_new_socket(struct http_connection_t *conn)
+static int net_http_new_socket(struct http_socket_state_t *sock_state,
+      const char *domain, int port)
 {
    int ret;
    struct addrinfo *addr = NULL, *next_addr = NULL;
    int fd                = socket_init(
-         (void**)&addr, conn->port, conn->domain, SOCKET_TYPE_STREAM);
+         (void**)&addr, port, domain, SOCKET_TYPE_STREAM);
 #ifdef HAVE_SSL
-   if (conn->sock_state.ssl)
+   if (sock_state->ssl)
    {
-      if (!(conn->sock_state.ssl_ctx = ssl_socket_init(fd, conn->domain)))
+      if (!(sock_state->ssl_ctx = ssl_socket_init(fd, domain)))
          return -1;
    }
 #endif
@@ -194,15 +244,15 @@ static int net_http_new_socket(struct http_connection_t *conn)
    while (fd >= 0)
    {
 #ifdef HAVE_SSL
-      if (conn->sock_state.ssl)
+      if (sock_state->ssl)
       {
-         ret = ssl_socket_connect(conn->sock_state.ssl_ctx,
+         ret = ssl_socket_connect(sock_state->ssl_ctx,
                (void*)next_addr, true, true);
 
          if (ret >= 0)
             break;
 
-         ssl_socket_close(conn->sock_state.ssl_ctx);
+         ssl_socket_close(sock_state->ssl_ctx);
       }
       else
 #endif
@@ -221,11 +271,98 @@ static int net_http_new_socket(struct http_connection_t *conn)
    if (addr)
       freeaddrinfo_retro(addr);
 
-   conn->sock_state.fd = fd;
+   sock_state->fd = fd;
 
    return fd;
 }
 
+static void net_http_close_socket(struct http_socket_state_t *sock_state)
+{
+   if (sock_state->fd < 0)
+      return;
+
+   socket_close(sock_state->fd);
+#ifdef HAVE_SSL
+   if (sock_state->ssl && sock_state->ssl_ctx)
+   {
+      ssl_socket_free(sock_state->ssl_ctx);
+      sock_state->ssl_ctx = NULL;
+   }
+#endif
+   sock_state->fd = -1;
+}
+
+/* Takes an idle connection to the server out of the pool,
+ * dropping the ones that waited too long on the way. */
+static bool net_http_pool_take(struct http_socket_state_t *sock_state,
+      const char *domain, int port)
+{
+   unsigned i;
+   bool found       = false;
+   retro_time_t now = cpu_features_get_time_usec();
+
+   SLOCK_LOCK(net_http_pool_lock);
+   for (i = 0; i < NET_HTTP_POOL_SIZE; i++)
+   {
+      struct http_idle_connection *idle = &net_http_pool[i];
+
+      if (!idle->domain)
+         continue;
+
+      if (now - idle->since > NET_HTTP_POOL_TIMEOUT_USEC)
+         net_http_close_socket(&idle->sock_state);
+      else if (!found
+            && idle->port           == port
+            && idle->sock_state.ssl == sock_state->ssl
+            && string_is_equal(idle->domain, domain))
+      {
+         *sock_state = idle->sock_state;
+         found       = true;
+      }
+      else
+         continue;
+
+      free(idle->domain);
+      idle->domain = NULL;
+   }
+   SLOCK_UNLOCK(net_http_pool_lock);
+
+   return found;
+}
+
+/* Keeps the connection for the next request, in place
+ * of the one that waited the longest if the pool is full. */
+static void net_http_pool_put(struct http_socket_state_t *sock_state,
+      const char *domain, int port)
+{
+   unsigned i;
+   struct http_idle_connection *slot = &net_http_pool[0];
+
+   SLOCK_LOCK(net_http_pool_lock);
+   for (i = 0; i < NET_HTTP_POOL_SIZE; i++)
+   {
+      if (!net_http_pool[i].domain)
+      {
+         slot = &net_http_pool[i];
+         break;
+      }
+      if (net_http_pool[i].since < slot->since)
+         slot = &net_http_pool[i];
+   }
+
+   if (slot->domain)
+   {
+      net_http_close_socket(&slot->sock_state);
+      free(slot->domain);
+   }
+
+   slot->domain     = strdup(domain);
+   slot->port       = port;
+   slot->since      = cpu_features_get_time_usec();
+   slot->sock_state = *sock_state;
+   SLOCK_UNLOCK(net_http_pool_lock);
+}
+
 static void net_http_send_str(
       struct http_socket_state_t *sock_state, bool *error, const char *text)
 {
@@ -252,8 +389,16 @@ static void net_http_send_str(
 struct http_connection_t *net_http_connection_new(const char *url,
       const char *method, const char *data)
 {
-   struct http_connection_t *conn = (struct http_connection_t*)calloc(1,
-         sizeof(*conn));
+   struct http_connection_t *conn = NULL;
+
+#ifdef HAVE_THREADS
+   /* Connections are made on the thread starting the
+    * first transfer, before any transfer uses the pool */
+   if (!net_http_pool_lock)
+      net_http_pool_lock = slock_new();
+#endif
+
+   conn = (struct http_connection_t*)calloc(1, sizeof(*conn));
 
    if (!conn)
       return NULL;
@@ -436,117 +581,140 @@ const char *net_http_connection_url(struct http_connection_t *conn)
    return conn->urlcopy;
 }
 
-struct http_t *net_http_new(struct http_connection_t *conn)
+/* Sends the request of @state on its connection, asking
+ * for the body from @resume_from on when it isn't 0. */
+static bool net_http_send_request(struct http_t *state, size_t resume_from)
 {
-   bool error            = false;
-   int fd                = -1;
-   struct http_t *state  = NULL;
+   bool error = false;
 
-   if (!conn)
-      goto error;
-
-   fd = net_http_new_socket(conn);
+   if (resume_from)
+   {
+      char range[64];
+      /* The request ends with an empty line, the range goes before it */
+      size_t len = strlen(state->request) - STRLEN_CONST("\r\n");
+      char *head = (char*)malloc(len + 1);
 
-   if (fd < 0)
-      goto error;
+      if (!head)
+         return false;
 
-   error = false;
+      memcpy(head, state->request, len);
+      head[len] = '\0';
+      snprintf(range, sizeof(range), "Range: bytes=%llu-\r\n\r\n",
+            (unsigned long long)resume_from);
 
-   /* This is a bit lazy, but it works. */
-   if (conn->methodcopy)
-   {
-      net_http_send_str(&conn->sock_state, &error, conn->methodcopy);
-      net_http_send_str(&conn->sock_state, &error, " /");
+      net_http_send_str(&state->sock_state, &error, head);
+      net_http_send_str(&state->sock_state, &error, range);
+      free(head);
    }
    else
-   {
-      net_http_send_str(&conn->sock_state, &error, "GET /");
-   }
+      net_http_send_str(&state->sock_state, &error, state->request);
 
-   net_http_send_str(&conn->sock_state, &error, conn->location);
-   net_http_send_str(&conn->sock_state, &error, " HTTP/1.1\r\n");
+   return !error;
+}
 
-   net_http_send_str(&conn->sock_state, &error, "Host: ");
-   net_http_send_str(&conn->sock_state, &error, conn->domain);
+/* Sends the request of @state on a new connection. */
+static bool net_http_reconnect(struct http_t *state, size_t resume_from)
+{
+   net_http_close_socket(&state->sock_state);
 
-   if (!conn->port)
-   {
-      char portstr[16];
+   state->reused = false;
+   state->error  = false;
 
-      portstr[0] = '\0';
+   if (net_http_new_socket(&state->sock_state,
+            state->domain, state->port) < 0)
+      return false;
 
-      snprintf(portstr, sizeof(portstr), ":%i", conn->port);
-      net_http_send_str(&conn->sock_state, &error, portstr);
-   }
+   return net_http_send_request(state, resume_from);
+}
 
-   net_http_send_str(&conn->sock_state, &error, "\r\n");
+/* The whole request in one string, so that it goes out in one
+ * send and can be sent again on another connection. */
+static char *net_http_build_request(struct http_connection_t *conn)
+{
+   char *request;
+   char len_str[32];
+   size_t len            = 0;
+   const char *method    = conn->methodcopy ? conn->methodcopy : "GET";
+   const char *type      = conn->contenttypecopy;
+   const char *agent     = conn->useragentcopy ? conn->useragentcopy : "libretro";
+   bool post             = string_is_equal(method, "POST");
 
-   /* This is not being set anywhere yet */
-   if (conn->contenttypecopy)
-   {
-      net_http_send_str(&conn->sock_state, &error, "Content-Type: ");
-      net_http_send_str(&conn->sock_state, &error, conn->contenttypecopy);
-      net_http_send_str(&conn->sock_state, &error, "\r\n");
-   }
+   len_str[0]            = '\0';
 
-   if (conn->methodcopy && (string_is_equal(conn->methodcopy, "POST")))
+   if (post)
    {
-      size_t post_len, len;
-      char *len_str        = NULL;
-
       if (!conn->postdatacopy)
-         goto error;
+         return NULL;
+      if (!type)
+         type = "application/x-www-form-urlencoded";
+      snprintf(len_str, sizeof(len_str), "%llu",
+            (unsigned long long)strlen(conn->postdatacopy));
+   }
 
-      if (!conn->contenttypecopy)
-         net_http_send_str(&conn->sock_state, &error,
-               "Content-Type: application/x-www-form-urlencoded\r\n");
+   len = strlen(method) + strlen(conn->location) + strlen(conn->domain)
+      + strlen(agent) + strlen(len_str) + (type ? strlen(type) : 0)
+      + (post ? strlen(conn->postdatacopy) : 0) + 256;
 
-      net_http_send_str(&conn->sock_state, &error, "Content-Length: ");
+   request = (char*)malloc(len);
+   if (!request)
+      return NULL;
 
-      post_len = strlen(conn->postdatacopy);
-#ifdef _WIN32
-      len     = snprintf(NULL, 0, "%" PRIuPTR, post_len);
-      len_str = (char*)malloc(len + 1);
-      snprintf(len_str, len + 1, "%" PRIuPTR, post_len);
-#else
-      len     = snprintf(NULL, 0, "%llu", (long long unsigned)post_len);
-      len_str = (char*)malloc(len + 1);
-      snprintf(len_str, len + 1, "%llu", (long long unsigned)post_len);
-#endif
+   /* This is a bit lazy, but it works. */
+   snprintf(request, len,
+         "%s /%s HTTP/1.1\r\n"
+         "Host: %s\r\n"
+         "%s%s%s"
+         "%s%s%s"
+         "User-Agent: %s\r\n"
+         "Connection: keep-alive\r\n"
+         "\r\n"
+         "%s",
+         method, conn->location,
+         conn->domain,
+         type ? "Content-Type: " : "", type ? type : "", type ? "\r\n" : "",
+         post ? "Content-Length: " : "", len_str, post ? "\r\n" : "",
+         agent,
+         post ? conn->postdatacopy : "");
+
+   return request;
+}
 
-      len_str[len] = '\0';
+struct http_t *net_http_new(struct http_connection_t *conn)
+{
+   struct http_t *state  = NULL;
 
-      net_http_send_str(&conn->sock_state, &error, len_str);
-      net_http_send_str(&conn->sock_state, &error, "\r\n");
+   if (!conn)
+      return NULL;
 
-      free(len_str);
-   }
+   state                 = (struct http_t*)calloc(1, sizeof(struct http_t));
+   if (!state)
+      return NULL;
 
-   net_http_send_str(&conn->sock_state, &error, "User-Agent: ");
-   if (conn->useragentcopy)
-      net_http_send_str(&conn->sock_state, &error, conn->useragentcopy);
-   else
-      net_http_send_str(&conn->sock_state, &error, "libretro");
-   net_http_send_str(&conn->sock_state, &error, "\r\n");
+   state->sock_state     = conn->sock_state;
+   state->sock_state.fd  = -1;
+   state->port           = conn->port;
+   state->domain         = strdup(conn->domain);
+   state->request        = net_http_build_request(conn);
+   state->resumable      = !conn->methodcopy
+      || string_is_equal(conn->methodcopy, "GET");
 
-   net_http_send_str(&conn->sock_state, &error, "Connection: close\r\n");
-   net_http_send_str(&conn->sock_state, &error, "\r\n");
+   if (!state->domain || !state->request)
+      goto error;
 
-   if (conn->methodcopy && (string_is_equal(conn->methodcopy, "POST")))
-      net_http_send_str(&conn->sock_state, &error, conn->postdatacopy);
+   state->reused         = net_http_pool_take(&state->sock_state,
+         state->domain, state->port);
 
-   if (error)
-      goto error;
+   if (!state->reused || !net_http_send_request(state, 0))
+   {
+      /* A pooled connection the server closed fails here
+       * or on the first read, see net_http_update */
+      if (!net_http_reconnect(state, 0))
+         goto error;
+   }
 
-   state             = (struct http_t*)malloc(sizeof(struct http_t));
-   state->sock_state = conn->sock_state;
    state->status     = -1;
-   state->data       = NULL;
    state->part       = P_HEADER_TOP;
    state->bodytype   = T_FULL;
-   state->error      = false;
-   state->pos        = 0;
-   state->len        = 0;
    state->buflen     = 512;
    state->data       = (char*)malloc(state->buflen);
 
@@ -556,32 +724,65 @@ struct http_t *net_http_new(struct http_connection_t *conn)
    return state;
 
 error:
-   if (conn)
-   {
-      if (conn->methodcopy)
-         free(conn->methodcopy);
-      if (conn->contenttypecopy)
-         free(conn->contenttypecopy);
-      conn->methodcopy = NULL;
-      conn->contenttypecopy = NULL;
-      conn->postdatacopy = NULL;
-   }
-#ifdef HAVE_SSL
-   if (conn && conn->sock_state.ssl && conn->sock_state.ssl_ctx && fd >= 0)
-   {
-      ssl_socket_close(conn->sock_state.ssl_ctx);
-      ssl_socket_free(conn->sock_state.ssl_ctx);
-      conn->sock_state.ssl_ctx = NULL;
-   }
-#else
-   if (fd >= 0)
-      socket_close(fd);
-#endif
-   if (state)
-      free(state);
+   net_http_delete(state);
    return NULL;
 }
 
+/* The connection broke in the body of a GET with a known length:
+ * keeps what came in and asks for the rest on a new connection. */
+static bool net_http_resume(struct http_t *state)
+{
+   if (     !state->resumable
+         || state->bodytype != T_LEN
+         || state->part     != P_BODY
+         || state->pos      == 0
+         || state->resumes  >= NET_HTTP_MAX_RESUMES)
+      return false;
+
+   state->resumes++;
+   state->body        = state->data;
+   state->body_buflen = state->buflen;
+   state->body_len    = state->len;
+   state->resume_from = state->pos;
+   state->len         = 0;
+   state->buflen      = 512;
+   state->data        = (char*)malloc(state->buflen);
+   state->pos         = 0;
+   state->part        = P_HEADER_TOP;
+   state->bodytype    = T_FULL;
+   state->status      = -1;
+
+   if (!state->data)
+      return false;
+
+   return net_http_reconnect(state, state->resume_from);
+}
+
+/* Headers of the Range request are in: the body continues where
+ * it stopped, after the @leftover bytes that came with them. */
+static bool net_http_resumed(struct http_t *state, size_t leftover)
+{
+   /* Content-Length is what is left */
+   if (     state->status   != 206
+         || state->bodytype != T_LEN
+         || state->len      != state->body_len - state->resume_from
+         || leftover         > state->len)
+      return false;
+
+   memcpy(state->body + state->resume_from, state->data, leftover);
+   free(state->data);
+
+   state->data        = state->body;
+   state->buflen      = state->body_buflen;
+   state->body        = NULL;
+   state->pos         = state->resume_from;
+   state->len         = state->body_len;
+   state->resume_from = 0;
+   state->status      = 200;
+
+   return true;
+}
+
 int net_http_fd(struct http_t *state)
 {
    if (!state)
@@ -615,7 +816,15 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
       }
 
       if (newlen < 0)
+      {
+         /* The server closed the pooled connection meanwhile */
+         if (     state->reused
+               && state->part == P_HEADER_TOP
+               && state->pos  == 0
+               && net_http_reconnect(state, state->resume_from))
+            return false;
          goto fail;
+      }
 
       if (state->pos + newlen >= state->buflen - 64)
       {
@@ -641,9 +850,11 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
          {
             if (strncmp(state->data, "HTTP/1.", STRLEN_CONST("HTTP/1."))!=0)
                goto fail;
-            state->status = (int)strtoul(state->data 
+            state->status    = (int)strtoul(state->data 
                   + STRLEN_CONST("HTTP/1.1 "), NULL, 10);
-            state->part   = P_HEADER;
+            /* HTTP/1.1 keeps connections open unless told otherwise */
+            state->keepalive = state->data[STRLEN_CONST("HTTP/1.")] == '1';
+            state->part      = P_HEADER;
          }
          else
          {
@@ -656,6 +867,8 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
             }
             if (string_is_equal(state->data, "Transfer-Encoding: chunked"))
                state->bodytype = T_CHUNK;
+            if (string_is_equal_case_insensitive(state->data, "Connection: close"))
+               state->keepalive = false;
 
             /* TODO: save headers somewhere */
             if (state->data[0]=='\0')
@@ -673,6 +886,22 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
       {
          newlen = state->pos;
          state->pos = 0;
+
+         if (state->body)
+         {
+            if (!net_http_resumed(state, newlen))
+               goto fail;
+         }
+         else if (state->bodytype == T_LEN
+               && state->buflen < state->len + 64)
+         {
+            /* The whole body at once, no reallocating on the way */
+            char *data = (char*)realloc(state->data, state->len + 64);
+            if (!data)
+               goto fail;
+            state->data   = data;
+            state->buflen = state->len + 64;
+         }
       }
    }
 
@@ -707,6 +936,14 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
                state->part = P_DONE;
                state->data = (char*)realloc(state->data, state->len);
             }
+            else if (net_http_resume(state))
+            {
+               if (progress)
+                  *progress = state->resume_from;
+               if (total)
+                  *total    = state->body_len;
+               return false;
+            }
             else
                goto fail;
             newlen=0;
@@ -851,15 +1088,23 @@ void net_http_delete(struct http_t *state)
 
    if (state->sock_state.fd >= 0)
    {
-      socket_close(state->sock_state.fd);
-#ifdef HAVE_SSL
-      if (state->sock_state.ssl && state->sock_state.ssl_ctx)
-      {
-         ssl_socket_free(state->sock_state.ssl_ctx);
-         state->sock_state.ssl_ctx = NULL;
-      }
-#endif
+      /* Only a body of known length is sure to be read
+       * to its end, with nothing left for the next response */
+      if (     state->part     == P_DONE
+            && state->bodytype == T_LEN
+            && state->keepalive
+            && !state->error)
+         net_http_pool_put(&state->sock_state, state->domain, state->port);
+      else
+         net_http_close_socket(&state->sock_state);
    }
+
+   if (state->body)
+      free(state->body);
+   if (state->request)
+      free(state->request);
+   if (state->domain)
+      free(state->domain);
    free(state);
 }
 
@@ -28,6 +28,8 @@
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
 #define SLOCK_LOCK(x) slock_lock(x)
 #define SLOCK_UNLOCK(x) slock_unlock(x)
 #else
@@ -35,6 +37,24 @@
 #define SLOCK_UNLOCK(x)
 #endif
 
+/* Workers hand finished tasks to the main thread through a
+ * lock-free stack, which the main thread takes whole, and a
+ * count of the tasks not gathered yet lets task_queue_check
+ * return right away when there are none. Without atomics the
+ * finished queue is locked and every check walks the queues. */
+#if defined(HAVE_THREADS) && (defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#define HAVE_TASK_ATOMICS
+#endif
+
+/* Readable while finished tasks wait for the main thread,
+ * so that an idle main loop can sleep on it. */
+#if defined(HAVE_TASK_ATOMICS) && defined(__linux__)
+#define HAVE_TASK_WAKEUP_FD
+#include <unistd.h>
+#include <sys/eventfd.h>
+#endif
+
 typedef struct
 {
    retro_task_t *front;
@@ -64,6 +84,19 @@ static bool task_threaded_enable            = false;
 
 static uint32_t task_count                  = 0;
 
+#ifdef HAVE_TASK_ATOMICS
+/* pushed and not gathered yet */
+static unsigned tasks_active                = 0;
+/* finished by workers, newest first */
+static retro_task_t *tasks_done             = NULL;
+#endif
+
+#ifdef HAVE_TASK_WAKEUP_FD
+/* Created once and kept for the lifetime of the process,
+ * so whoever waits on it never has to watch another one */
+static int task_wakeup_fd                   = -1;
+#endif
+
 static void task_queue_msg_push(retro_task_t *task,
       unsigned prio, unsigned duration,
       bool flush, const char *fmt, ...)
@@ -132,6 +165,65 @@ static retro_task_t *task_queue_get(task_queue_t *queue)
    return task;
 }
 
+#ifdef HAVE_TASK_ATOMICS
+static void task_queue_push_done(retro_task_t *task)
+{
+   retro_task_t *head = __atomic_load_n(&tasks_done, __ATOMIC_RELAXED);
+
+   do
+   {
+      task->next = head;
+   } while (!__atomic_compare_exchange_n(&tasks_done, &head, task,
+            true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+#ifdef HAVE_TASK_WAKEUP_FD
+   /* Only the first one wakes the main thread */
+   if (!head && task_wakeup_fd >= 0)
+   {
+      uint64_t one = 1;
+      ssize_t ret  = write(task_wakeup_fd, &one, sizeof(one));
+      (void)ret;
+   }
+#endif
+}
+
+/* Moves what the workers finished to tasks_finished,
+ * in the order they finished. Main thread only. */
+static void task_queue_take_done(void)
+{
+   retro_task_t *task = NULL;
+   retro_task_t *list = NULL;
+
+   if (!__atomic_load_n(&tasks_done, __ATOMIC_RELAXED))
+      return;
+
+#ifdef HAVE_TASK_WAKEUP_FD
+   if (task_wakeup_fd >= 0)
+   {
+      uint64_t count;
+      ssize_t ret = read(task_wakeup_fd, &count, sizeof(count));
+      (void)ret;
+   }
+#endif
+
+   task = __atomic_exchange_n(&tasks_done, NULL, __ATOMIC_ACQUIRE);
+
+   while (task)
+   {
+      retro_task_t *next = task->next;
+      task->next         = list;
+      list               = task;
+      task               = next;
+   }
+
+   while ((task = list))
+   {
+      list = task->next;
+      task_queue_put(&tasks_finished, task);
+   }
+}
+#endif
+
 static void retro_task_internal_gather(void)
 {
    retro_task_t *task = NULL;
@@ -152,6 +244,10 @@ static void retro_task_internal_gather(void)
          free(task->title);
 
       free(task);
+
+#ifdef HAVE_TASK_ATOMICS
+      __atomic_sub_fetch(&tasks_active, 1, __ATOMIC_RELAXED);
+#endif
    }
 }
 
@@ -172,6 +268,11 @@ static void retro_task_regular_gather(void)
    retro_task_t *queue = NULL;
    retro_task_t *next  = NULL;
 
+#ifdef HAVE_TASK_ATOMICS
+   /* Left over by the threaded queue */
+   task_queue_take_done();
+#endif
+
    while ((task = task_queue_get(&tasks_running)))
    {
       task->next = queue;
@@ -282,50 +383,94 @@ static struct retro_task_impl impl_regular = {
 };
 
 #ifdef HAVE_THREADS
+#define TASK_QUEUE_MAX_WORKERS 4
+
 static slock_t *running_lock    = NULL;
 static slock_t *finished_lock   = NULL;
 static slock_t *property_lock   = NULL;
 static slock_t *queue_lock      = NULL;
 static scond_t *worker_cond     = NULL;
-static sthread_t *worker_thread = NULL;
+static sthread_t *worker_threads[TASK_QUEUE_MAX_WORKERS] = {NULL};
+static unsigned worker_count    = 0;
 static bool worker_continue     = true; /* use running_lock when touching it */
+/* For the work tasks hand out of their own */
+static tpool_t *task_pool       = NULL;
 
+/* Must be called with running_lock held,
+ * queue_lock is taken for the update. */
 static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
 {
-   retro_task_t     *t = NULL;
-   retro_task_t *front = NULL;
+   retro_task_t *t = NULL;
 
    slock_lock(queue_lock);
-   front = queue->front;
-   slock_unlock(queue_lock);
 
    /* Remove first element if needed */
-   if (task == front)
+   if (task == queue->front)
    {
-      slock_lock(queue_lock);
       queue->front = task->next;
-      slock_unlock(queue_lock);
       task->next   = NULL;
-
+      slock_unlock(queue_lock);
       return;
    }
 
    /* Parse queue */
-   t = front;
-
-   while (t && t->next)
+   for (t = queue->front; t && t->next; t = t->next)
    {
       /* Remove task and update queue */
       if (t->next == task)
       {
          t->next    = task->next;
+         if (queue->back == task)
+            queue->back = t;
          task->next = NULL;
          break;
       }
+   }
+
+   slock_unlock(queue_lock);
+}
+
+static bool task_queue_same_affinity(retro_task_t *a, retro_task_t *b)
+{
+   if (a->affinity || b->affinity)
+      return a->affinity == b->affinity;
+   return a->handler == b->handler;
+}
+
+/* Picks the most urgent task that no worker is running
+ * and whose affinity is free. Tasks of the same priority
+ * go in queue order, which is round robin since a task
+ * goes to the back after each step.
+ * Must be called with running_lock held. */
+static retro_task_t *task_queue_next_ready(void)
+{
+   retro_task_t *busy[TASK_QUEUE_MAX_WORKERS];
+   retro_task_t *best = NULL;
+   retro_task_t *task = NULL;
+   unsigned num_busy  = 0;
+
+   for (task = tasks_running.front; task; task = task->next)
+      if (task->busy && num_busy < TASK_QUEUE_MAX_WORKERS)
+         busy[num_busy++] = task;
 
-      /* Update iterator */
-      t = t->next;
+   for (task = tasks_running.front; task; task = task->next)
+   {
+      unsigned i;
+
+      if (task->busy)
+         continue;
+      if (best && task->priority >= best->priority)
+         continue;
+
+      for (i = 0; i < num_busy; i++)
+         if (task_queue_same_affinity(task, busy[i]))
+            break;
+
+      if (i == num_busy)
+         best = task;
    }
+
+   return best;
 }
 
 static void retro_task_threaded_push_running(retro_task_t *task)
@@ -360,6 +505,11 @@ static void retro_task_threaded_gather(void)
 {
    retro_task_t *task = NULL;
 
+#ifdef HAVE_TASK_ATOMICS
+   if (!__atomic_load_n(&tasks_active, __ATOMIC_ACQUIRE))
+      return;
+#endif
+
    slock_lock(property_lock);
    slock_lock(running_lock);
    for (task = tasks_running.front; task; task = task->next)
@@ -367,9 +517,14 @@ static void retro_task_threaded_gather(void)
 
    slock_unlock(running_lock);
 
+#ifdef HAVE_TASK_ATOMICS
+   task_queue_take_done();
+   retro_task_internal_gather();
+#else
    slock_lock(finished_lock);
    retro_task_internal_gather();
    slock_unlock(finished_lock);
+#endif
    slock_unlock(property_lock);
 }
 
@@ -434,25 +589,28 @@ static void threaded_worker(void *userdata)
 {
    (void)userdata;
 
+   sthread_set_role(STHREAD_ROLE_TASK);
+
    for (;;)
    {
       retro_task_t *task  = NULL;
       bool       finished = false;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
-
       slock_lock(running_lock);
 
-      /* Get first task to run */
-      task = tasks_running.front;
+      while (worker_continue && !(task = task_queue_next_ready()))
+         scond_wait(worker_cond, running_lock);
+
+      /* should we keep running until all tasks finished? */
       if (!task)
       {
-         scond_wait(worker_cond, running_lock);
          slock_unlock(running_lock);
-         continue;
+         break;
       }
 
+      /* Claim it, no other worker will pick it
+       * (or anything with the same affinity) */
+      task->busy = true;
       slock_unlock(running_lock);
 
       task->handler(task);
@@ -463,47 +621,87 @@ static void threaded_worker(void *userdata)
 
       slock_lock(running_lock);
       task_queue_remove(&tasks_running, task);
-      slock_unlock(running_lock);
+      task->busy = false;
 
-      /* Update queue */
-      if (!finished)
-      {
-         /* Re-add task to running queue */
-         retro_task_threaded_push_running(task);
-      }
-      else
+      if (finished)
       {
          /* Add task to finished queue */
+#ifdef HAVE_TASK_ATOMICS
+         task_queue_push_done(task);
+#else
          slock_lock(finished_lock);
          task_queue_put(&tasks_finished, task);
          slock_unlock(finished_lock);
+#endif
       }
+      else
+      {
+         /* Back of the running queue */
+         slock_lock(queue_lock);
+         task_queue_put(&tasks_running, task);
+         slock_unlock(queue_lock);
+      }
+
+      /* Its affinity is free again */
+      scond_signal(worker_cond);
+      slock_unlock(running_lock);
    }
+
+   sthread_set_role(STHREAD_ROLE_NONE);
 }
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+   unsigned cores = cpu_features_get_core_amount();
+
    running_lock  = slock_new();
    finished_lock = slock_new();
    property_lock = slock_new();
    queue_lock    = slock_new();
    worker_cond   = scond_new();
 
+#ifdef HAVE_TASK_WAKEUP_FD
+   if (task_wakeup_fd < 0)
+      task_wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+
    slock_lock(running_lock);
    worker_continue = true;
    slock_unlock(running_lock);
 
-   worker_thread = sthread_create(threaded_worker, NULL);
+   /* Leave one core to the main thread */
+   worker_count = (cores > 1) ? cores - 1 : 1;
+   if (worker_count > TASK_QUEUE_MAX_WORKERS)
+      worker_count = TASK_QUEUE_MAX_WORKERS;
+
+   for (i = 0; i < worker_count; i++)
+      worker_threads[i] = sthread_create(threaded_worker, NULL);
+
+   task_pool = tpool_create_with_role(worker_count, STHREAD_ROLE_TASK);
 }
 
 static void retro_task_threaded_deinit(void)
 {
+   unsigned i;
+
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < worker_count; i++)
+   {
+      if (worker_threads[i])
+         sthread_join(worker_threads[i]);
+      worker_threads[i] = NULL;
+   }
+
+   /* What the tasks handed out still gets done, a task carried
+    * over to the regular queue finds its work finished */
+   tpool_wait(task_pool);
+   tpool_destroy(task_pool);
+   task_pool = NULL;
 
    scond_free(worker_cond);
    slock_free(running_lock);
@@ -511,7 +709,7 @@ static void retro_task_threaded_deinit(void)
    slock_free(property_lock);
    slock_free(queue_lock);
 
-   worker_thread = NULL;
+   worker_count  = 0;
    worker_cond   = NULL;
    running_lock  = NULL;
    finished_lock = NULL;
@@ -577,6 +775,15 @@ bool task_queue_is_threaded(void)
    return task_threaded_enable;
 }
 
+struct tpool *task_queue_get_pool(void)
+{
+#ifdef HAVE_THREADS
+   return task_pool;
+#else
+   return NULL;
+#endif
+}
+
 bool task_queue_find(task_finder_data_t *find_data)
 {
    if (!impl_current->find(find_data->func, find_data->userdata))
@@ -632,6 +839,10 @@ bool task_queue_push(retro_task_t *task)
          return false;
    }
 
+#ifdef HAVE_TASK_ATOMICS
+   __atomic_add_fetch(&tasks_active, 1, __ATOMIC_RELEASE);
+#endif
+
    /* The lack of NULL checks in the following functions
     * is proposital to ensure correct control flow by the users. */
    impl_current->push_running(task);
@@ -639,6 +850,15 @@ bool task_queue_push(retro_task_t *task)
    return true;
 }
 
+int task_queue_wakeup_fd(void)
+{
+#ifdef HAVE_TASK_WAKEUP_FD
+   return task_wakeup_fd;
+#else
+   return -1;
+#endif
+}
+
 void task_queue_wait(retro_task_condition_fn_t cond, void* data)
 {
    impl_current->wait(cond, data);
@@ -825,6 +1045,7 @@ retro_task_t *task_init(void)
    retro_task_t *task      = (retro_task_t*)calloc(1, sizeof(*task));
 
    task->ident             = task_count++;
+   task->priority          = TASK_PRIORITY_NORMAL;
 
    return task;
 }
@@ -67,6 +67,14 @@
 #include <mach/mach.h>
 #endif
 
+#if defined(__linux__) && defined(_GNU_SOURCE) && !defined(USE_WIN32_THREADS)
+#define HAVE_THREAD_ROLES
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
 struct thread_data
 {
    void (*func)(void*);
@@ -958,3 +966,130 @@ uintptr_t sthread_get_current_thread_id(void)
    return (uintptr_t)pthread_self();
 #endif
 }
+
+#ifdef HAVE_THREAD_ROLES
+#define STHREAD_ROLE_THREADS 32
+
+struct sthread_role_thread
+{
+   pthread_t id;
+   pid_t tid;
+   enum sthread_role role;
+   bool realtime; /* SCHED_FIFO set by us, to be undone */
+};
+
+static pthread_mutex_t sthread_role_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct sthread_role_thread sthread_role_threads[STHREAD_ROLE_THREADS];
+static sthread_role_policy_t sthread_role_policies[STHREAD_ROLE_LAST];
+static bool sthread_role_has_policy[STHREAD_ROLE_LAST];
+
+/* Failures are left alone, a thread without the permission
+ * for a priority still runs where it is. */
+static void sthread_apply_role(struct sthread_role_thread *thread)
+{
+   const sthread_role_policy_t *policy = &sthread_role_policies[thread->role];
+   cpu_set_t set;
+   unsigned i;
+
+   if (!sthread_role_has_policy[thread->role])
+      return;
+
+   CPU_ZERO(&set);
+   for (i = 0; i < 64 && i < CPU_SETSIZE; i++)
+      if (!policy->cpu_mask || (policy->cpu_mask & (UINT64_C(1) << i)))
+         CPU_SET(i, &set);
+   sched_setaffinity(thread->tid, sizeof(set), &set);
+
+   if (policy->rt_priority > 0)
+   {
+      struct sched_param sp;
+      memset(&sp, 0, sizeof(sp));
+      sp.sched_priority = policy->rt_priority;
+      if (pthread_setschedparam(thread->id, SCHED_FIFO, &sp) == 0)
+         thread->realtime = true;
+   }
+   else
+   {
+      if (thread->realtime)
+      {
+         struct sched_param sp;
+         memset(&sp, 0, sizeof(sp));
+         pthread_setschedparam(thread->id, SCHED_OTHER, &sp);
+         thread->realtime = false;
+      }
+      setpriority(PRIO_PROCESS, (id_t)thread->tid, policy->nice);
+   }
+}
+#endif
+
+void sthread_set_role(enum sthread_role role)
+{
+#ifdef HAVE_THREAD_ROLES
+   pthread_t self                     = pthread_self();
+   struct sthread_role_thread *slot   = NULL;
+   struct sthread_role_thread *unused = NULL;
+   unsigned i;
+
+   pthread_mutex_lock(&sthread_role_lock);
+
+   for (i = 0; i < STHREAD_ROLE_THREADS; i++)
+   {
+      struct sthread_role_thread *thread = &sthread_role_threads[i];
+
+      if (thread->role == STHREAD_ROLE_NONE)
+      {
+         if (!unused)
+            unused = thread;
+      }
+      else if (pthread_equal(thread->id, self))
+      {
+         slot = thread;
+         break;
+      }
+   }
+
+   if (!slot && role != STHREAD_ROLE_NONE)
+      slot = unused;
+
+   if (slot)
+   {
+      if (slot->role == STHREAD_ROLE_NONE)
+         slot->realtime = false;
+      slot->id   = self;
+      slot->tid  = (pid_t)syscall(SYS_gettid);
+      slot->role = role;
+      if (role != STHREAD_ROLE_NONE)
+         sthread_apply_role(slot);
+   }
+
+   pthread_mutex_unlock(&sthread_role_lock);
+#else
+   (void)role;
+#endif
+}
+
+void sthread_set_role_policy(enum sthread_role role,
+      const sthread_role_policy_t *policy)
+{
+#ifdef HAVE_THREAD_ROLES
+   unsigned i;
+
+   if (role <= STHREAD_ROLE_NONE || role >= STHREAD_ROLE_LAST)
+      return;
+
+   pthread_mutex_lock(&sthread_role_lock);
+
+   sthread_role_has_policy[role] = !!policy;
+   if (policy)
+      sthread_role_policies[role] = *policy;
+
+   for (i = 0; i < STHREAD_ROLE_THREADS; i++)
+      if (sthread_role_threads[i].role == role)
+         sthread_apply_role(&sthread_role_threads[i]);
+
+   pthread_mutex_unlock(&sthread_role_lock);
+#else
+   (void)role;
+   (void)policy;
+#endif
+}
@@ -31,238 +31,489 @@
 #include <rthreads/rthreads.h>
 #include <rthreads/tpool.h>
 
-/* Work object which will sit in a queue
+/* Work object which will sit in a deque
  * waiting for the pool to process it.
  *
- * It is a singly linked list acting as a FIFO queue. */
+ * Work objects are reused, next links the free ones. */
 struct tpool_work
 {
-   thread_func_t      func;  /* Function to be called. */
-   void              *arg;   /* Data to be passed to func. */
-   struct tpool_work *next;  /* Next work item in the queue. */
+   thread_func_t       func;   /* Function to be called. */
+   tpool_range_func_t  range;  /* Or range function to be called. */
+   void               *arg;    /* Data to be passed to func. */
+   size_t              begin;  /* Range for range. */
+   size_t              end;
+   tpool_waitgroup_t  *wg;     /* Wait group, if any. */
+   struct tpool_work  *next;   /* Next free work item. */
 };
 typedef struct tpool_work tpool_work_t;
 
+/* Each thread takes the work it added itself from the bottom
+ * of its own deque, newest first while it is still in cache.
+ * Threads without work steal from the top of the others,
+ * oldest first. Work added from outside the pool is spread
+ * over the deques. */
+struct tpool_deque
+{
+   slock_t         *lock;
+   tpool_work_t   **items;
+   size_t           cap;
+   size_t           head;
+   size_t           count;
+};
+
+struct tpool_thread
+{
+   tpool_t         *tp;
+   sthread_t       *thread;
+   size_t           index;
+};
+
 struct tpool
 {
-   tpool_work_t    *work_first;   /* First work item in the work queue. */
-   tpool_work_t    *work_last;    /* Last work item in the work queue. */
-   slock_t         *work_mutex;   /* Mutex protecting inserting and removing work from the work queue. */
-   scond_t         *work_cond;    /* Conditional to signal when there is work to process. */
-   scond_t         *working_cond; /* Conditional to signal when there is no work processing.
-                                       This will also signal when there are no threads running. */
-   size_t           working_cnt;  /* The number of threads processing work (Not waiting for work). */
-   size_t           thread_cnt;   /* Total number of threads within the pool. */
-   bool             stop;         /* Marker to tell the work threads to exit. */
+   struct tpool_deque  *deques;       /* One per thread. */
+   struct tpool_thread *threads;
+   tpool_work_t        *free_work;    /* Work items to reuse. */
+   slock_t             *work_mutex;   /* Protects everything below, and free_work. */
+   scond_t             *work_cond;    /* Conditional to signal when there is work to process. */
+   scond_t             *working_cond; /* Conditional to signal when work or a wait group completes. */
+   size_t               pending;      /* Work in the deques, an upper bound while it is taken. */
+   size_t               working_cnt;  /* Work added and not completed yet. */
+   size_t               thread_cnt;   /* Total number of threads within the pool. */
+   size_t               next_deque;   /* Where work from outside the pool goes. */
+   enum sthread_role    role;
+   bool                 stop;         /* Marker to tell the work threads to exit. */
 };
 
-static tpool_work_t *tpool_work_create(thread_func_t func, void *arg)
+static bool tpool_deque_push(struct tpool_deque *dq, tpool_work_t *work)
 {
-   tpool_work_t *work;
+   slock_lock(dq->lock);
 
-   if (!func)
-      return NULL;
+   if (dq->count == dq->cap)
+   {
+      size_t i;
+      size_t cap            = dq->cap ? dq->cap * 2 : 16;
+      tpool_work_t **items  = (tpool_work_t**)malloc(cap * sizeof(*items));
+
+      if (!items)
+      {
+         slock_unlock(dq->lock);
+         return false;
+      }
+
+      for (i = 0; i < dq->count; i++)
+         items[i] = dq->items[(dq->head + i) % dq->cap];
+
+      free(dq->items);
+      dq->items = items;
+      dq->cap   = cap;
+      dq->head  = 0;
+   }
+
+   dq->items[(dq->head + dq->count) % dq->cap] = work;
+   dq->count++;
+
+   slock_unlock(dq->lock);
+   return true;
+}
+
+static tpool_work_t *tpool_deque_pop(struct tpool_deque *dq)
+{
+   tpool_work_t *work = NULL;
+
+   slock_lock(dq->lock);
+   if (dq->count)
+   {
+      dq->count--;
+      work = dq->items[(dq->head + dq->count) % dq->cap];
+   }
+   slock_unlock(dq->lock);
+
+   return work;
+}
+
+static tpool_work_t *tpool_deque_steal(struct tpool_deque *dq)
+{
+   tpool_work_t *work = NULL;
+
+   slock_lock(dq->lock);
+   if (dq->count)
+   {
+      work     = dq->items[dq->head];
+      dq->head = (dq->head + 1) % dq->cap;
+      dq->count--;
+   }
+   slock_unlock(dq->lock);
 
-   work       = (tpool_work_t*)calloc(1, sizeof(*work));
-   work->func = func;
-   work->arg  = arg;
-   work->next = NULL;
    return work;
 }
 
-static void tpool_work_destroy(tpool_work_t *work)
+/* Index of the deque of the calling thread,
+ * thread_cnt when it isn't one of the pool. */
+static size_t tpool_self(tpool_t *tp)
 {
+   size_t i;
+
+   for (i = 0; i < tp->thread_cnt; i++)
+      if (tp->threads[i].thread && sthread_isself(tp->threads[i].thread))
+         return i;
+
+   return tp->thread_cnt;
+}
+
+/* Own deque first, then the others starting with the next one. */
+static tpool_work_t *tpool_work_take(tpool_t *tp, size_t self)
+{
+   size_t i;
+   tpool_work_t *work = NULL;
+
+   if (self < tp->thread_cnt)
+      work = tpool_deque_pop(&tp->deques[self]);
+
+   for (i = 1; !work && i <= tp->thread_cnt; i++)
+      work = tpool_deque_steal(&tp->deques[(self + i) % tp->thread_cnt]);
+
    if (work)
-      free(work);
+   {
+      slock_lock(tp->work_mutex);
+      tp->pending--;
+      slock_unlock(tp->work_mutex);
+   }
+
+   return work;
 }
 
-/* Pull the first work item out of the queue. */
-static tpool_work_t *tpool_work_get(tpool_t *tp)
+static bool tpool_work_put(tpool_t *tp, tpool_waitgroup_t *wg,
+      thread_func_t func, tpool_range_func_t range, void *arg,
+      size_t begin, size_t end)
 {
+   size_t        self;
    tpool_work_t *work;
 
-   if (!tp)
-      return NULL;
+   self = tpool_self(tp);
 
-   work = tp->work_first;
-   if (!work)
-      return NULL;
+   slock_lock(tp->work_mutex);
 
-   if (!work->next)
+   if (tp->stop)
    {
-      tp->work_first = NULL;
-      tp->work_last  = NULL;
+      slock_unlock(tp->work_mutex);
+      return false;
+   }
+
+   work = tp->free_work;
+   if (work)
+      tp->free_work = work->next;
+   else if (!(work = (tpool_work_t*)malloc(sizeof(*work))))
+   {
+      slock_unlock(tp->work_mutex);
+      return false;
+   }
+
+   work->func  = func;
+   work->range = range;
+   work->arg   = arg;
+   work->begin = begin;
+   work->end   = end;
+   work->wg    = wg;
+   work->next  = NULL;
+
+   if (self == tp->thread_cnt)
+      self = tp->next_deque++ % tp->thread_cnt;
+
+   if (!tpool_deque_push(&tp->deques[self], work))
+   {
+      work->next    = tp->free_work;
+      tp->free_work = work;
+      slock_unlock(tp->work_mutex);
+      return false;
    }
+
+   if (wg)
+      wg->count++;
+   tp->working_cnt++;
+   tp->pending++;
+   scond_signal(tp->work_cond);
+
+   slock_unlock(tp->work_mutex);
+
+   return true;
+}
+
+static void tpool_work_run(tpool_t *tp, tpool_work_t *work)
+{
+   if (work->range)
+      work->range(work->arg, work->begin, work->end);
    else
-      tp->work_first = work->next;
+      work->func(work->arg);
 
-   return work;
+   slock_lock(tp->work_mutex);
+
+   if (work->wg && --work->wg->count == 0)
+      scond_broadcast(tp->working_cond);
+   if (--tp->working_cnt == 0)
+      scond_broadcast(tp->working_cond);
+
+   work->next    = tp->free_work;
+   tp->free_work = work;
+
+   slock_unlock(tp->work_mutex);
 }
 
 static void tpool_worker(void *arg)
 {
-   tpool_work_t *work = NULL;
-   tpool_t      *tp   = (tpool_t*)arg;
+   struct tpool_thread *self = (struct tpool_thread*)arg;
+   tpool_t             *tp   = self->tp;
+
+   sthread_set_role(tp->role);
 
    for (;;)
    {
-      slock_lock(tp->work_mutex);
-      /* Keep running until told to stop. */
-      if (tp->stop)
-         break;
-
-      /* If there is no work in the queue wait in the conditional until
-       * there is work to take. */
-      if (!tp->work_first)
-         scond_wait(tp->work_cond, tp->work_mutex);
-
-      /* Try to pull work from the queue. */
-      work = tpool_work_get(tp);
-      tp->working_cnt++;
-      slock_unlock(tp->work_mutex);
+      tpool_work_t *work = tpool_work_take(tp, self->index);
 
-      /* Call the work function and let it process.
-       *
-       * work can legitimately be NULL. Since multiple threads from the pool
-       * will wake when there is work, a thread might not get any work. 1
-       * piece of work and 2 threads, both will wake but with 1 only work 1
-       * will get the work and the other won't.
-       *
-       * working_cnt has been increment and work could be NULL. While it's
-       * not true there is work processing the thread is considered working
-       * because it's not waiting in the conditional. Pedantic but...
-       */
       if (work)
       {
-         work->func(work->arg);
-         tpool_work_destroy(work);
+         tpool_work_run(tp, work);
+         continue;
       }
 
       slock_lock(tp->work_mutex);
-      tp->working_cnt--;
-      /* Since we're in a lock no work can be added or removed form the queue.
-       * Also, the working_cnt can't be changed (except the thread holding the lock).
-       * At this point if there isn't any work processing and if there is no work
-       * signal this is the case. */
-      if (!tp->stop && tp->working_cnt == 0 && !tp->work_first)
-         scond_signal(tp->working_cond);
+      /* If there is no work wait in the conditional until
+       * there is work to take. Keep running until told to stop. */
+      while (!tp->stop && tp->pending == 0)
+         scond_wait(tp->work_cond, tp->work_mutex);
+
+      if (tp->stop)
+      {
+         slock_unlock(tp->work_mutex);
+         break;
+      }
       slock_unlock(tp->work_mutex);
    }
 
-   tp->thread_cnt--;
-   if (tp->thread_cnt == 0)
-      scond_signal(tp->working_cond);
-   slock_unlock(tp->work_mutex);
+   sthread_set_role(STHREAD_ROLE_NONE);
 }
 
-tpool_t *tpool_create(size_t num)
+tpool_t *tpool_create_with_role(size_t num, enum sthread_role role)
 {
    tpool_t   *tp;
-   sthread_t *thread;
    size_t     i;
 
    if (num == 0)
       num = 2;
 
    tp               = (tpool_t*)calloc(1, sizeof(*tp));
+   if (!tp)
+      return NULL;
+
    tp->thread_cnt   = num;
+   tp->role         = role;
 
    tp->work_mutex   = slock_new();
    tp->work_cond    = scond_new();
    tp->working_cond = scond_new();
+   tp->deques       = (struct tpool_deque*)calloc(num, sizeof(*tp->deques));
+   tp->threads      = (struct tpool_thread*)calloc(num, sizeof(*tp->threads));
 
-   tp->work_first   = NULL;
-   tp->work_last    = NULL;
+   if (!tp->work_mutex || !tp->work_cond || !tp->working_cond
+         || !tp->deques || !tp->threads)
+      goto error;
 
-   /* Create the requested number of thread and detach them. */
    for (i = 0; i < num; i++)
    {
-      thread = sthread_create(tpool_worker, tp);
-      sthread_detach(thread);
+      tp->deques[i].lock    = slock_new();
+      tp->threads[i].tp     = tp;
+      tp->threads[i].index  = i;
+      if (!tp->deques[i].lock)
+         goto error;
    }
 
+   /* Create the requested number of threads, the pool
+    * works with fewer if some can't be created. */
+   for (i = 0; i < num; i++)
+      tp->threads[i].thread = sthread_create(tpool_worker, &tp->threads[i]);
+
    return tp;
+
+error:
+   tpool_destroy(tp);
+   return NULL;
+}
+
+tpool_t *tpool_create(size_t num)
+{
+   return tpool_create_with_role(num, STHREAD_ROLE_NONE);
 }
 
 void tpool_destroy(tpool_t *tp)
 {
+   size_t        i;
    tpool_work_t *work;
-   tpool_work_t *work2;
 
    if (!tp)
       return;
 
-   /* Take all work out of the queue and destroy it. */
-   slock_lock(tp->work_mutex);
-   work = tp->work_first;
-   while (work)
+   /* Take all work out of the deques and drop it. */
+   if (tp->work_mutex)
+   {
+      slock_lock(tp->work_mutex);
+
+      if (tp->deques)
+      {
+         for (i = 0; i < tp->thread_cnt; i++)
+         {
+            if (!tp->deques[i].lock)
+               continue;
+            while ((work = tpool_deque_steal(&tp->deques[i])))
+            {
+               if (work->wg)
+                  work->wg->count--;
+               work->next    = tp->free_work;
+               tp->free_work = work;
+               tp->working_cnt--;
+               tp->pending--;
+            }
+         }
+      }
+
+      /* Tell the worker threads to stop. */
+      tp->stop = true;
+      if (tp->work_cond)
+         scond_broadcast(tp->work_cond);
+      slock_unlock(tp->work_mutex);
+   }
+
+   /* Wait for all threads to stop, after the work
+    * they are processing. */
+   if (tp->threads)
    {
-      work2 = work->next;
-      tpool_work_destroy(work);
-      work = work2;
+      for (i = 0; i < tp->thread_cnt; i++)
+         if (tp->threads[i].thread)
+            sthread_join(tp->threads[i].thread);
+      free(tp->threads);
    }
 
-   /* Tell the worker threads to stop. */
-   tp->stop = true;
-   scond_broadcast(tp->work_cond);
-   slock_unlock(tp->work_mutex);
+   if (tp->deques)
+   {
+      for (i = 0; i < tp->thread_cnt; i++)
+      {
+         if (tp->deques[i].lock)
+            slock_free(tp->deques[i].lock);
+         free(tp->deques[i].items);
+      }
+      free(tp->deques);
+   }
 
-   /* Wait for all threads to stop. */
-   tpool_wait(tp);
+   while ((work = tp->free_work))
+   {
+      tp->free_work = work->next;
+      free(work);
+   }
 
-   slock_free(tp->work_mutex);
-   scond_free(tp->work_cond);
-   scond_free(tp->working_cond);
+   if (tp->work_mutex)
+      slock_free(tp->work_mutex);
+   if (tp->work_cond)
+      scond_free(tp->work_cond);
+   if (tp->working_cond)
+      scond_free(tp->working_cond);
 
    free(tp);
 }
 
 bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg)
 {
-   tpool_work_t *work;
-
-   if (!tp)
+   if (!tp || !func)
       return false;
+   return tpool_work_put(tp, NULL, func, NULL, arg, 0, 0);
+}
 
-   work = tpool_work_create(func, arg);
-   if (!work)
-      return false;
+void tpool_wait(tpool_t *tp)
+{
+   if (!tp)
+      return;
 
    slock_lock(tp->work_mutex);
-   if (!tp->work_first)
-   {
-      tp->work_first      = work;
-      tp->work_last       = tp->work_first;
-   }
-   else
-   {
-      tp->work_last->next = work;
-      tp->work_last       = work;
-   }
-
-   scond_broadcast(tp->work_cond);
+   while (tp->working_cnt != 0)
+      scond_wait(tp->working_cond, tp->work_mutex);
    slock_unlock(tp->work_mutex);
+}
 
-   return true;
+void tpool_waitgroup_init(tpool_waitgroup_t *wg)
+{
+   wg->count = 0;
 }
 
-void tpool_wait(tpool_t *tp)
+bool tpool_add_work_group(tpool_t *tp, tpool_waitgroup_t *wg,
+      thread_func_t func, void *arg)
 {
-   if (!tp)
+   if (!tp || !func)
+      return false;
+   return tpool_work_put(tp, wg, func, NULL, arg, 0, 0);
+}
+
+void tpool_wait_group(tpool_t *tp, tpool_waitgroup_t *wg)
+{
+   size_t self;
+
+   if (!tp || !wg)
       return;
 
-   slock_lock(tp->work_mutex);
+   self = tpool_self(tp);
 
    for (;;)
    {
-      /* working_cond is dual use. It signals when we're not stopping but the
-       * working_cnt is 0 indicating there isn't any work processing. If we
-       * are stopping it will trigger when there aren't any threads running. */
-      if ((!tp->stop && tp->working_cnt != 0) || (tp->stop && tp->thread_cnt != 0))
-         scond_wait(tp->working_cond, tp->work_mutex);
-      else
+      tpool_work_t *work = NULL;
+
+      slock_lock(tp->work_mutex);
+      if (wg->count == 0)
+      {
+         slock_unlock(tp->work_mutex);
          break;
+      }
+      /* The rest is running, nothing to help with */
+      if (tp->pending == 0)
+      {
+         scond_wait(tp->working_cond, tp->work_mutex);
+         slock_unlock(tp->work_mutex);
+         continue;
+      }
+      slock_unlock(tp->work_mutex);
+
+      if ((work = tpool_work_take(tp, self)))
+         tpool_work_run(tp, work);
    }
+}
 
-   slock_unlock(tp->work_mutex);
+void tpool_parallel_for(tpool_t *tp, size_t count, size_t grain,
+      tpool_range_func_t func, void *arg)
+{
+   size_t            begin;
+   tpool_waitgroup_t wg;
+
+   if (!count)
+      return;
+
+   if (!grain)
+   {
+      size_t chunks = tp ? (tp->thread_cnt + 1) * 4 : 1;
+      grain         = (count + chunks - 1) / chunks;
+   }
+
+   if (!tp || count <= grain)
+   {
+      func(arg, 0, count);
+      return;
+   }
+
+   tpool_waitgroup_init(&wg);
+
+   /* The first range is for the calling thread */
+   for (begin = grain; begin < count; begin += grain)
+   {
+      size_t end = (count - begin > grain) ? begin + grain : count;
+      if (!tpool_work_put(tp, &wg, NULL, func, arg, begin, end))
+         func(arg, begin, end);
+   }
+
+   func(arg, 0, grain);
+
+   tpool_wait_group(tp, &wg);
 }
@@ -0,0 +1,681 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Microbenchmarks of the hot kernels of libretro-common.
+ *
+ * Every benchmark runs on the same generated input each time, is
+ * calibrated to take at least BENCH_MIN_USEC per run and is run
+ * BENCH_RUNS times. Results are printed as one JSON object per
+ * line, for scripts to compare across builds and architectures:
+ *
+ *    {"name": ..., "variant": "simd" | "scalar", "arch": ...,
+ *     "bytes": bytes processed per iteration, "iterations": ...,
+ *     "best_ns": ..., "median_ns": ..., "mb_per_s": ...}
+ *
+ * best_ns and median_ns are per iteration. The Makefile builds
+ * "bench" with the SIMD paths and "bench_scalar" without them.
+ *
+ * Usage: bench [-r runs] [filter], filter being a substring
+ * of the names to run. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+#include <gfx/scaler/pixconv.h>
+#include <audio/conversion/float_to_s16.h>
+#include <audio/conversion/s16_to_float.h>
+#include <audio/audio_resampler.h>
+#include <audio/audio_mixer.h>
+#include <encodings/crc32.h>
+#include <file/config_file.h>
+#include <formats/image.h>
+#include <formats/rpng.h>
+#include <formats/jsonsax_full.h>
+
+#define BENCH_RUNS_DEFAULT 5
+#define BENCH_RUNS_MAX     64
+#define BENCH_MIN_USEC     20000
+
+#define BENCH_WIDTH        640
+#define BENCH_HEIGHT       480
+#define BENCH_FRAMES       4096
+#define BENCH_RATE         48000
+
+#ifdef BENCH_SCALAR
+#define BENCH_VARIANT "scalar"
+#else
+#define BENCH_VARIANT "simd"
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BENCH_ARCH "x86_64"
+#elif defined(__i386__) || defined(_M_IX86)
+#define BENCH_ARCH "x86"
+#elif defined(__aarch64__)
+#define BENCH_ARCH "aarch64"
+#elif defined(__arm__)
+#define BENCH_ARCH "arm"
+#elif defined(__powerpc__) || defined(__ppc__)
+#define BENCH_ARCH "ppc"
+#else
+#define BENCH_ARCH "unknown"
+#endif
+
+typedef void (*bench_func_t)(void *data);
+
+static unsigned bench_runs         = BENCH_RUNS_DEFAULT;
+static const char *bench_filter    = NULL;
+static uint32_t bench_seed         = 0x12345678;
+
+/* Keeps results alive so the compiler can't drop the work */
+static volatile uint32_t bench_sink;
+
+static uint32_t bench_rand(void)
+{
+   bench_seed = bench_seed * 1664525u + 1013904223u;
+   return bench_seed >> 8;
+}
+
+static void bench_fill(void *data, size_t size)
+{
+   size_t i;
+   uint8_t *bytes = (uint8_t*)data;
+
+   for (i = 0; i < size; i++)
+      bytes[i] = (uint8_t)bench_rand();
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+   double x = *(const double*)a;
+   double y = *(const double*)b;
+   return (x > y) - (x < y);
+}
+
+static void bench_run(const char *name, size_t bytes,
+      bench_func_t func, void *data)
+{
+   unsigned i;
+   double ns[BENCH_RUNS_MAX];
+   unsigned iterations = 1;
+
+   if (bench_filter && !strstr(name, bench_filter))
+      return;
+
+   /* Warm up, then find how many iterations fill a run */
+   func(data);
+
+   for (;;)
+   {
+      unsigned j;
+      retro_time_t start = cpu_features_get_time_usec();
+
+      for (j = 0; j < iterations; j++)
+         func(data);
+
+      if (cpu_features_get_time_usec() - start >= BENCH_MIN_USEC
+            || iterations >= (1u << 30))
+         break;
+
+      iterations *= 2;
+   }
+
+   for (i = 0; i < bench_runs; i++)
+   {
+      unsigned j;
+      retro_time_t start = cpu_features_get_time_usec();
+
+      for (j = 0; j < iterations; j++)
+         func(data);
+
+      ns[i] = (cpu_features_get_time_usec() - start) * 1000.0 / iterations;
+   }
+
+   qsort(ns, bench_runs, sizeof(*ns), bench_compare);
+
+   printf("{\"name\": \"%s\", \"variant\": \"%s\", \"arch\": \"%s\", "
+         "\"bytes\": %u, \"iterations\": %u, "
+         "\"best_ns\": %.1f, \"median_ns\": %.1f, \"mb_per_s\": %.1f}\n",
+         name, BENCH_VARIANT, BENCH_ARCH,
+         (unsigned)bytes, iterations,
+         ns[0], ns[bench_runs / 2],
+         ns[0] > 0.0 ? bytes * 1000.0 / ns[0] : 0.0);
+   fflush(stdout);
+}
+
+/* Pixel conversion */
+
+typedef void (*bench_conv_t)(void *output, const void *input,
+      int width, int height, int out_stride, int in_stride);
+
+struct bench_pixconv
+{
+   bench_conv_t conv;
+   void *input;
+   void *output;
+   int in_stride;
+   int out_stride;
+};
+
+static void bench_pixconv_func(void *data)
+{
+   struct bench_pixconv *b = (struct bench_pixconv*)data;
+
+   b->conv(b->output, b->input, BENCH_WIDTH, BENCH_HEIGHT,
+         b->out_stride, b->in_stride);
+}
+
+static void bench_pixconv(void)
+{
+   unsigned i;
+   static const struct
+   {
+      const char *name;
+      bench_conv_t conv;
+      unsigned in_bpp;
+      unsigned out_bpp;
+   } convs[] = {
+      { "pixconv/rgb565_argb8888",   conv_rgb565_argb8888,   2, 4 },
+      { "pixconv/0rgb1555_argb8888", conv_0rgb1555_argb8888, 2, 4 },
+      { "pixconv/rgb565_0rgb1555",   conv_rgb565_0rgb1555,   2, 2 },
+      { "pixconv/0rgb1555_rgb565",   conv_0rgb1555_rgb565,   2, 2 },
+      { "pixconv/rgb565_abgr8888",   conv_rgb565_abgr8888,   2, 4 },
+      { "pixconv/argb8888_bgr24",    conv_argb8888_bgr24,    4, 3 },
+      { "pixconv/argb8888_abgr8888", conv_argb8888_abgr8888, 4, 4 },
+      { "pixconv/rgb565_bgr24",      conv_rgb565_bgr24,      2, 3 },
+      { "pixconv/yuyv_argb8888",     conv_yuyv_argb8888,     2, 4 },
+   };
+   struct bench_pixconv b;
+   size_t pixels = BENCH_WIDTH * BENCH_HEIGHT;
+
+   b.input  = malloc(pixels * 4);
+   b.output = malloc(pixels * 4);
+
+   if (b.input && b.output)
+   {
+      bench_fill(b.input, pixels * 4);
+
+      for (i = 0; i < ARRAY_SIZE(convs); i++)
+      {
+         b.conv       = convs[i].conv;
+         b.in_stride  = BENCH_WIDTH * convs[i].in_bpp;
+         b.out_stride = BENCH_WIDTH * convs[i].out_bpp;
+         bench_run(convs[i].name, pixels * convs[i].in_bpp,
+               bench_pixconv_func, &b);
+      }
+   }
+
+   free(b.input);
+   free(b.output);
+}
+
+/* Sample conversion */
+
+struct bench_samples
+{
+   int16_t *s16;
+   float *f32;
+};
+
+static void bench_s16_to_float_func(void *data)
+{
+   struct bench_samples *b = (struct bench_samples*)data;
+   convert_s16_to_float(b->f32, b->s16, BENCH_FRAMES * 2, 1.0f);
+}
+
+static void bench_float_to_s16_func(void *data)
+{
+   struct bench_samples *b = (struct bench_samples*)data;
+   convert_float_to_s16(b->s16, b->f32, BENCH_FRAMES * 2);
+}
+
+static void bench_samples(void)
+{
+   unsigned i;
+   struct bench_samples b;
+
+#ifndef BENCH_SCALAR
+   convert_s16_to_float_init_simd();
+   convert_float_to_s16_init_simd();
+#endif
+
+   b.s16 = (int16_t*)malloc(BENCH_FRAMES * 2 * sizeof(int16_t));
+   b.f32 = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+
+   if (b.s16 && b.f32)
+   {
+      bench_fill(b.s16, BENCH_FRAMES * 2 * sizeof(int16_t));
+      for (i = 0; i < BENCH_FRAMES * 2; i++)
+         b.f32[i] = b.s16[i] / 32768.0f;
+
+      bench_run("audio/s16_to_float", BENCH_FRAMES * 2 * sizeof(int16_t),
+            bench_s16_to_float_func, &b);
+      bench_run("audio/float_to_s16", BENCH_FRAMES * 2 * sizeof(float),
+            bench_float_to_s16_func, &b);
+   }
+
+   free(b.s16);
+   free(b.f32);
+}
+
+/* Resampling */
+
+struct bench_resampler
+{
+   const retro_resampler_t *backend;
+   void *handle;
+   float *input;
+   float *output;
+   double ratio;
+};
+
+static void bench_resampler_func(void *data)
+{
+   struct resampler_data info;
+   struct bench_resampler *b = (struct bench_resampler*)data;
+
+   info.data_in       = b->input;
+   info.data_out      = b->output;
+   info.input_frames  = BENCH_FRAMES;
+   info.output_frames = 0;
+   info.ratio         = b->ratio;
+
+   b->backend->process(b->handle, &info);
+   bench_sink        += (uint32_t)info.output_frames;
+}
+
+static void bench_resamplers(void)
+{
+   unsigned i, j;
+   static const struct
+   {
+      const char *name;
+      const retro_resampler_t *backend;
+      enum resampler_quality quality;
+   } resamplers[] = {
+      { "resampler/sinc_lower",  &sinc_resampler,    RESAMPLER_QUALITY_LOWER  },
+      { "resampler/sinc_normal", &sinc_resampler,    RESAMPLER_QUALITY_NORMAL },
+      { "resampler/sinc_higher", &sinc_resampler,    RESAMPLER_QUALITY_HIGHER },
+      { "resampler/nearest",     &nearest_resampler, RESAMPLER_QUALITY_NORMAL },
+   };
+   /* 44.1 to 48 kHz, the usual case, and a bit of rate control */
+   static const double ratios[] = { 48000.0 / 44100.0, 1.005 };
+   struct bench_resampler b;
+#ifdef BENCH_SCALAR
+   resampler_simd_mask_t mask = 0;
+#else
+   resampler_simd_mask_t mask = (resampler_simd_mask_t)cpu_features_get();
+#endif
+
+   b.input  = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+   /* Plenty of room for the highest ratio */
+   b.output = (float*)malloc(BENCH_FRAMES * 2 * 2 * sizeof(float));
+
+   if (b.input && b.output)
+   {
+      for (i = 0; i < BENCH_FRAMES * 2; i++)
+         b.input[i] = ((int)(bench_rand() & 0xffff) - 0x8000) / 32768.0f;
+
+      for (i = 0; i < ARRAY_SIZE(resamplers); i++)
+      {
+         for (j = 0; j < ARRAY_SIZE(ratios); j++)
+         {
+            char name[64];
+
+            b.backend = resamplers[i].backend;
+            b.ratio   = ratios[j];
+            b.handle  = b.backend->init(NULL, b.ratio,
+                  resamplers[i].quality, mask);
+
+            if (!b.handle)
+               continue;
+
+            snprintf(name, sizeof(name), "%s@%.3f",
+                  resamplers[i].name, b.ratio);
+            bench_run(name, BENCH_FRAMES * 2 * sizeof(float),
+                  bench_resampler_func, &b);
+
+            b.backend->free(b.handle);
+         }
+      }
+   }
+
+   free(b.input);
+   free(b.output);
+}
+
+/* Mixing */
+
+static void bench_mixer_func(void *data)
+{
+   float *buffer = (float*)data;
+
+   memset(buffer, 0, BENCH_FRAMES * 2 * sizeof(float));
+   audio_mixer_mix(buffer, BENCH_FRAMES, 1.0f, false);
+}
+
+/* One second of 16-bit stereo noise as a WAV file */
+static void *bench_mixer_wav(size_t *size)
+{
+   unsigned i;
+   size_t data_size = BENCH_RATE * 2 * sizeof(int16_t);
+   uint8_t *wav     = (uint8_t*)malloc(44 + data_size);
+   static const uint8_t header[44] = {
+      'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+      'f', 'm', 't', ' ', 16, 0, 0, 0,
+      1, 0,                    /* PCM */
+      2, 0,                    /* Channels */
+      0x80, 0xbb, 0, 0,        /* 48000 Hz */
+      0x00, 0xee, 0x02, 0,     /* Bytes per second */
+      4, 0,                    /* Block align */
+      16, 0,                   /* Bits per sample */
+      'd', 'a', 't', 'a', 0, 0, 0, 0
+   };
+
+   if (!wav)
+      return NULL;
+
+   memcpy(wav, header, sizeof(header));
+
+   for (i = 0; i < 4; i++)
+   {
+      wav[4  + i] = (uint8_t)((36 + data_size) >> (8 * i));
+      wav[40 + i] = (uint8_t)(data_size >> (8 * i));
+   }
+
+   bench_fill(wav + 44, data_size);
+
+   *size = 44 + data_size;
+   return wav;
+}
+
+static void bench_mixer(void)
+{
+   unsigned i;
+   size_t size                = 0;
+   void *wav                  = NULL;
+   float *buffer              = NULL;
+   audio_mixer_sound_t *sound = NULL;
+
+   audio_mixer_init(BENCH_RATE);
+
+   wav    = bench_mixer_wav(&size);
+   buffer = (float*)malloc(BENCH_FRAMES * 2 * sizeof(float));
+
+   if (wav && buffer)
+      sound = audio_mixer_load_wav(wav, (int32_t)size);
+
+   if (sound)
+   {
+      /* Voices are added on top of each other */
+      for (i = 1; i <= 8; i++)
+      {
+         char name[64];
+
+         audio_mixer_play(sound, true, 0.1f, NULL);
+
+         if (i != 1 && i != 4 && i != 8)
+            continue;
+
+         snprintf(name, sizeof(name), "audio/mixer_mix@%u", i);
+         bench_run(name, BENCH_FRAMES * 2 * sizeof(float),
+               bench_mixer_func, buffer);
+      }
+
+      audio_mixer_destroy(sound);
+   }
+
+   audio_mixer_done();
+
+   free(buffer);
+   free(wav);
+}
+
+/* Checksums */
+
+struct bench_buffer
+{
+   uint8_t *data;
+   size_t size;
+};
+
+static void bench_crc32_func(void *data)
+{
+   struct bench_buffer *b = (struct bench_buffer*)data;
+   bench_sink += encoding_crc32(0, b->data, b->size);
+}
+
+static void bench_crc32(void)
+{
+   struct bench_buffer b;
+
+   b.size = 1024 * 1024;
+   b.data = (uint8_t*)malloc(b.size);
+
+   if (b.data)
+   {
+      bench_fill(b.data, b.size);
+      bench_run("encoding/crc32", b.size, bench_crc32_func, &b);
+   }
+
+   free(b.data);
+}
+
+/* PNG decoding */
+
+static void bench_rpng_func(void *data)
+{
+   int ret;
+   unsigned width, height;
+   uint32_t *pixels       = NULL;
+   struct bench_buffer *b = (struct bench_buffer*)data;
+   rpng_t *rpng           = rpng_alloc();
+
+   if (!rpng)
+      return;
+
+   if (     rpng_set_buf_ptr(rpng, b->data, b->size)
+         && rpng_start(rpng))
+   {
+      while (rpng_iterate_image(rpng));
+
+      if (rpng_is_valid(rpng))
+      {
+         do
+         {
+            ret = rpng_process_image(rpng, (void**)&pixels,
+                  b->size, &width, &height);
+         } while (ret == IMAGE_PROCESS_NEXT);
+
+         if (pixels)
+            bench_sink += pixels[0];
+      }
+   }
+
+   rpng_free(rpng);
+   free(pixels);
+}
+
+static void bench_rpng(void)
+{
+   unsigned x, y;
+   uint64_t size        = 0;
+   struct bench_buffer b;
+   uint8_t *image       = (uint8_t*)malloc(BENCH_WIDTH * BENCH_HEIGHT * 3);
+
+   b.data = NULL;
+
+   if (image)
+   {
+      /* Gradients with a bit of noise, which compress about
+       * like screenshots and thumbnails do */
+      for (y = 0; y < BENCH_HEIGHT; y++)
+      {
+         for (x = 0; x < BENCH_WIDTH; x++)
+         {
+            uint8_t *p = image + (y * BENCH_WIDTH + x) * 3;
+            p[0] = (uint8_t)(x + (bench_rand() & 7));
+            p[1] = (uint8_t)(y + (bench_rand() & 7));
+            p[2] = (uint8_t)((x ^ y) & 0xf0);
+         }
+      }
+
+      b.data = rpng_save_image_bgr24_string(image,
+            BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH * 3, &size);
+      b.size = (size_t)size;
+   }
+
+   if (b.data)
+      bench_run("formats/rpng_decode", BENCH_WIDTH * BENCH_HEIGHT * 4,
+            bench_rpng_func, &b);
+
+   free(image);
+   free(b.data);
+}
+
+/* Config file parsing */
+
+static void bench_config_file_func(void *data)
+{
+   config_file_t *conf = config_file_new_from_string((const char*)data, NULL);
+
+   if (conf)
+   {
+      bench_sink += (uint32_t)conf->map_count;
+      config_file_free(conf);
+   }
+}
+
+static void bench_config_file(void)
+{
+   unsigned i;
+   size_t len  = 0;
+   size_t size = 2000 * 64;
+   char *cfg   = (char*)malloc(size);
+
+   if (!cfg)
+      return;
+
+   /* About the size of a full retroarch.cfg */
+   for (i = 0; i < 2000; i++)
+      len += snprintf(cfg + len, size - len,
+            "setting_%u_%08x = \"%u\"\n", i, bench_rand(), bench_rand() & 0xffff);
+
+   bench_run("file/config_file_parse", len, bench_config_file_func, cfg);
+
+   free(cfg);
+}
+
+/* JSON parsing, of a playlist */
+
+static JSON_Parser_HandlerResult JSON_CALL bench_json_string(
+      JSON_Parser parser, char *value, size_t length,
+      JSON_StringAttributes attributes)
+{
+   bench_sink += (uint32_t)length;
+   return JSON_Parser_Continue;
+}
+
+static void bench_json_func(void *data)
+{
+   struct bench_buffer *b = (struct bench_buffer*)data;
+   JSON_Parser parser     = JSON_Parser_Create(NULL);
+
+   if (!parser)
+      return;
+
+   JSON_Parser_SetStringHandler(parser, &bench_json_string);
+   JSON_Parser_SetObjectMemberHandler(parser, &bench_json_string);
+   JSON_Parser_Parse(parser, (const char*)b->data, b->size, JSON_True);
+   JSON_Parser_Free(parser);
+}
+
+static void bench_json(void)
+{
+   unsigned i;
+   size_t len  = 0;
+   size_t size = 1000 * 512;
+   struct bench_buffer b;
+
+   b.data = (uint8_t*)malloc(size);
+
+   if (!b.data)
+      return;
+
+   /* Laid out like playlist.c writes playlists */
+   len += snprintf((char*)b.data + len, size - len,
+         "{\n  \"version\": \"1.2\",\n  \"items\": [\n");
+
+   for (i = 0; i < 1000; i++)
+      len += snprintf((char*)b.data + len, size - len,
+            "    {\n"
+            "      \"path\": \"/storage/roms/snes/Game %u (USA).zip#Game %u (USA).sfc\",\n"
+            "      \"label\": \"Game %u (USA)\",\n"
+            "      \"core_path\": \"DETECT\",\n"
+            "      \"core_name\": \"DETECT\",\n"
+            "      \"crc32\": \"%08X|crc\",\n"
+            "      \"db_name\": \"Nintendo - Super Nintendo Entertainment System.lpl\"\n"
+            "    }%s\n",
+            i, i, i, bench_rand(), i + 1 < 1000 ? "," : "");
+
+   len += snprintf((char*)b.data + len, size - len, "  ]\n}\n");
+   b.size = len;
+
+   bench_run("formats/json_playlist_parse", b.size, bench_json_func, &b);
+
+   free(b.data);
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp(argv[i], "-r") && i + 1 < argc)
+      {
+         bench_runs = (unsigned)strtoul(argv[++i], NULL, 10);
+         if (bench_runs < 1)
+            bench_runs = 1;
+         else if (bench_runs > BENCH_RUNS_MAX)
+            bench_runs = BENCH_RUNS_MAX;
+      }
+      else
+         bench_filter = argv[i];
+   }
+
+   bench_pixconv();
+   bench_samples();
+   bench_resamplers();
+   bench_mixer();
+   bench_crc32();
+   bench_rpng();
+   bench_config_file();
+   bench_json();
+
+   return 0;
+}
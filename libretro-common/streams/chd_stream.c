@@ -30,10 +30,47 @@
 #include <retro_endianness.h>
 #include <libchdr/chd.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define CHDSTREAM_NEON
+#include <arm_neon.h>
+#endif
+
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Decompressed hunks kept around, least recently used goes first */
+#define CHDSTREAM_CACHE_HUNKS 8
+/* Hunks past the one being read that are decompressed ahead of time */
+#define CHDSTREAM_READAHEAD 4
+/* Threads doing the read-ahead, on a pool, with a chd_file for each
+ * since libchdr can only decompress one hunk of a chd_file at a time */
+#define CHDSTREAM_WORKERS 2
+
+enum chdstream_hunk_state
+{
+   CHDSTREAM_HUNK_EMPTY = 0,
+   /* Waiting for a worker */
+   CHDSTREAM_HUNK_QUEUED,
+   /* Being decompressed, by a worker or the reader */
+   CHDSTREAM_HUNK_BUSY,
+   CHDSTREAM_HUNK_READY
+};
+
+typedef struct chdstream_hunk
+{
+   uint8_t *mem;
+   uint32_t hunknum;
+   /* Last time it was read from, for the LRU */
+   uint32_t stamp;
+   enum chdstream_hunk_state state;
+} chdstream_hunk_t;
+
 struct chdstream
 {
    chd_file *chd;
@@ -53,12 +90,30 @@ struct chdstream
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
-   int32_t hunknum;
-   /* Loaded hunk */
-   uint8_t *hunkmem;
+   /* Bumped on every hunk read from */
+   uint32_t clock;
+   chdstream_hunk_t hunks[CHDSTREAM_CACHE_HUNKS];
+#ifdef HAVE_THREADS
+   /* Guards the hunk states */
+   slock_t *lock;
+   /* Signalled when a worker is done with a hunk */
+   scond_t *done;
+   tpool_t *pool;
+   /* The ones no worker is using */
+   chd_file *worker_chd[CHDSTREAM_WORKERS];
+   unsigned num_free_chd;
+   unsigned num_workers;
+#endif
 };
 
+#ifdef HAVE_THREADS
+#define chdstream_lock(stream)   slock_lock((stream)->lock)
+#define chdstream_unlock(stream) slock_unlock((stream)->lock)
+#else
+#define chdstream_lock(stream)
+#define chdstream_unlock(stream)
+#endif
+
 typedef struct metadata {
    char type[64];
    char subtype[32];
@@ -199,9 +254,137 @@ chdstream_find_track(chd_file *fd, int32_t track, metadata_t *meta)
    return chdstream_find_track_number(fd, track, meta);
 }
 
+/* Audio tracks are stored big endian */
+static void chdstream_swab(uint8_t *mem, size_t bytes)
+{
+   size_t i = 0;
+   uint16_t *array;
+
+#ifdef CHDSTREAM_NEON
+   for (; i + 16 <= bytes; i += 16)
+      vst1q_u8(mem + i, vrev16q_u8(vld1q_u8(mem + i)));
+#endif
+
+   array = (uint16_t*)(mem + i);
+   for (; i + 2 <= bytes; i += 2, array++)
+      *array = SWAP16(*array);
+}
+
+static bool chdstream_decompress(chdstream_t *stream, chd_file *chd,
+      chdstream_hunk_t *hunk)
+{
+   if (chd_read(chd, hunk->hunknum, hunk->mem) != CHDERR_NONE)
+      return false;
+
+   if (stream->swab)
+      chdstream_swab(hunk->mem, chd_get_header(chd)->hunkbytes);
+
+   return true;
+}
+
+#ifdef HAVE_THREADS
+/* One is added to the pool for each hunk queued, and decompresses
+ * whichever hunk is still queued when it runs */
+static void chdstream_worker(void *data)
+{
+   bool ok;
+   unsigned i;
+   chdstream_t *stream    = (chdstream_t*)data;
+   chdstream_hunk_t *hunk = NULL;
+   chd_file *chd          = NULL;
+
+   slock_lock(stream->lock);
+
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+   {
+      if (stream->hunks[i].state == CHDSTREAM_HUNK_QUEUED)
+      {
+         hunk = &stream->hunks[i];
+         break;
+      }
+   }
+
+   /* The reader got to it first, or it's no longer wanted.
+    * There's a chd_file for each thread of the pool. */
+   if (!hunk || !stream->num_free_chd)
+   {
+      slock_unlock(stream->lock);
+      return;
+   }
+
+   chd         = stream->worker_chd[--stream->num_free_chd];
+   hunk->state = CHDSTREAM_HUNK_BUSY;
+   slock_unlock(stream->lock);
+
+   ok = chdstream_decompress(stream, chd, hunk);
+
+   slock_lock(stream->lock);
+   stream->worker_chd[stream->num_free_chd++] = chd;
+   /* The reader decompresses it itself if this failed */
+   hunk->state = ok ? CHDSTREAM_HUNK_READY : CHDSTREAM_HUNK_EMPTY;
+   scond_broadcast(stream->done);
+   slock_unlock(stream->lock);
+}
+
+static void chdstream_workers_init(chdstream_t *stream, const char *path)
+{
+   unsigned i;
+
+   stream->lock   = slock_new();
+   stream->done   = scond_new();
+   if (!stream->lock || !stream->done)
+      return;
+
+   for (i = 0; i < CHDSTREAM_WORKERS; i++)
+   {
+      chd_file *chd = NULL;
+
+      if (chd_open(path, CHD_OPEN_READ, NULL, &chd) != CHDERR_NONE)
+         break;
+
+      stream->worker_chd[stream->num_free_chd++] = chd;
+   }
+
+   if (stream->num_free_chd)
+      stream->pool = tpool_create(stream->num_free_chd);
+   if (stream->pool)
+      stream->num_workers = stream->num_free_chd;
+}
+
+static void chdstream_workers_deinit(chdstream_t *stream)
+{
+   unsigned i;
+
+   if (stream->lock)
+   {
+      slock_lock(stream->lock);
+      /* Nothing queued is wanted anymore */
+      for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+         if (stream->hunks[i].state == CHDSTREAM_HUNK_QUEUED)
+            stream->hunks[i].state = CHDSTREAM_HUNK_EMPTY;
+      slock_unlock(stream->lock);
+   }
+
+   /* Waits for the hunks being decompressed */
+   tpool_destroy(stream->pool);
+   stream->pool        = NULL;
+   stream->num_workers = 0;
+
+   for (i = 0; i < stream->num_free_chd; i++)
+      chd_close(stream->worker_chd[i]);
+   stream->num_free_chd = 0;
+
+   if (stream->done)
+      scond_free(stream->done);
+   if (stream->lock)
+      slock_free(stream->lock);
+}
+#endif
+
 chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
+   unsigned i;
    uint32_t pregap      = 0;
    const chd_header *hd = NULL;
    chdstream_t *stream  = NULL;
@@ -218,10 +401,13 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!stream)
       goto error;
 
-   hd              = chd_get_header(chd);
-   stream->hunkmem = (uint8_t*)malloc(hd->hunkbytes);
-   if (!stream->hunkmem)
-      goto error;
+   hd = chd_get_header(chd);
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+   {
+      stream->hunks[i].mem = (uint8_t*)malloc(hd->hunkbytes);
+      if (!stream->hunks[i].mem)
+         goto error;
+   }
 
    if (!strcmp(meta.type, "MODE1_RAW"))
    {
@@ -257,7 +443,11 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    stream->track_start     = (size_t)pregap * stream->frame_size;
    stream->track_end       = stream->track_start + (size_t)meta.frames * stream->frame_size;
    stream->offset          = 0;
-   stream->hunknum         = -1;
+
+#ifdef HAVE_THREADS
+   /* Without workers, hunks are only decompressed when read */
+   chdstream_workers_init(stream, path);
+#endif
 
    return stream;
 
@@ -273,41 +463,159 @@ error:
 
 void chdstream_close(chdstream_t *stream)
 {
-   if (stream)
+   unsigned i;
+
+   if (!stream)
+      return;
+
+#ifdef HAVE_THREADS
+   chdstream_workers_deinit(stream);
+#endif
+
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+      free(stream->hunks[i].mem);
+   if (stream->chd)
+      chd_close(stream->chd);
+   free(stream);
+}
+
+/* Must be called with the lock held */
+static chdstream_hunk_t *chdstream_find_hunk(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   unsigned i;
+
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
+      if (stream->hunks[i].state != CHDSTREAM_HUNK_EMPTY &&
+            stream->hunks[i].hunknum == hunknum)
+         return &stream->hunks[i];
+
+   return NULL;
+}
+
+/* Returns the least recently used hunk nobody is working on, leaving
+ * alone the one being read from and the ones read ahead of it.
+ * Must be called with the lock held. */
+static chdstream_hunk_t *chdstream_evict_hunk(chdstream_t *stream,
+      uint32_t keep_first, uint32_t keep_last)
+{
+   unsigned i;
+   chdstream_hunk_t *victim = NULL;
+
+   for (i = 0; i < CHDSTREAM_CACHE_HUNKS; i++)
    {
-      if (stream->hunkmem)
-         free(stream->hunkmem);
-      if (stream->chd)
-         chd_close(stream->chd);
-      free(stream);
+      chdstream_hunk_t *hunk = &stream->hunks[i];
+
+      if (hunk->state == CHDSTREAM_HUNK_EMPTY)
+         return hunk;
+
+      if (hunk->state != CHDSTREAM_HUNK_READY ||
+            (hunk->hunknum >= keep_first && hunk->hunknum <= keep_last))
+         continue;
+
+      if (!victim || (uint32_t)(stream->clock - hunk->stamp) >
+            (uint32_t)(stream->clock - victim->stamp))
+         victim = hunk;
    }
+
+   return victim;
 }
 
-static bool
+#ifdef HAVE_THREADS
+/* Queues the hunks after the one being read for the workers.
+ * Must be called with the lock held. */
+static void chdstream_read_ahead(chdstream_t *stream, uint32_t hunknum)
+{
+   uint32_t h;
+   uint32_t total   = chd_get_header(stream->chd)->totalhunks;
+   uint32_t last    = hunknum + CHDSTREAM_READAHEAD;
+
+   if (!stream->num_workers)
+      return;
+
+   if (last >= total)
+      last = total - 1;
+
+   for (h = hunknum + 1; h <= last; h++)
+   {
+      chdstream_hunk_t *hunk;
+
+      if (chdstream_find_hunk(stream, h))
+         continue;
+
+      hunk = chdstream_evict_hunk(stream, hunknum, last);
+      if (!hunk)
+         break;
+
+      if (!tpool_add_work(stream->pool, chdstream_worker, stream))
+         break;
+
+      hunk->hunknum = h;
+      hunk->stamp   = stream->clock;
+      hunk->state   = CHDSTREAM_HUNK_QUEUED;
+   }
+}
+#endif
+
+static const uint8_t *
 chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
 {
-   chd_error err;
-   uint16_t *array;
-   uint32_t i;
-   uint32_t count;
+   chdstream_hunk_t *hunk;
 
-   if (hunknum == stream->hunknum)
-      return true;
+   chdstream_lock(stream);
 
-   err = chd_read(stream->chd, hunknum, stream->hunkmem);
-   if (err != CHDERR_NONE)
-      return false;
+   for (;;)
+   {
+      hunk = chdstream_find_hunk(stream, hunknum);
+      if (!hunk || hunk->state != CHDSTREAM_HUNK_BUSY)
+         break;
+#ifdef HAVE_THREADS
+      /* A worker has it, that's sooner than starting over */
+      scond_wait(stream->done, stream->lock);
+#endif
+   }
 
-   if (stream->swab)
+   if (hunk && hunk->state == CHDSTREAM_HUNK_QUEUED)
+      /* Not started yet, quicker to do it here than to wait */
+      hunk->state = CHDSTREAM_HUNK_BUSY;
+   else if (!hunk)
    {
-      count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array = (uint16_t*) stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      hunk = chdstream_evict_hunk(stream, hunknum, hunknum);
+      if (!hunk)
+      {
+         /* Every hunk is busy, only happens with a tiny cache */
+         chdstream_unlock(stream);
+         return NULL;
+      }
+      hunk->hunknum = hunknum;
+      hunk->state   = CHDSTREAM_HUNK_BUSY;
    }
 
-   stream->hunknum = hunknum;
-   return true;
+   hunk->stamp = ++stream->clock;
+
+   if (hunk->state == CHDSTREAM_HUNK_BUSY)
+   {
+      bool ok;
+
+      chdstream_unlock(stream);
+      ok = chdstream_decompress(stream, stream->chd, hunk);
+      chdstream_lock(stream);
+
+      hunk->state = ok ? CHDSTREAM_HUNK_READY : CHDSTREAM_HUNK_EMPTY;
+      if (!ok)
+      {
+         chdstream_unlock(stream);
+         return NULL;
+      }
+   }
+
+#ifdef HAVE_THREADS
+   chdstream_read_ahead(stream, hunknum);
+#endif
+   chdstream_unlock(stream);
+
+   /* Only this thread evicts, so it stays valid until the next load */
+   return hunk->mem;
 }
 
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
@@ -318,6 +626,7 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
    uint32_t chd_frame;
    uint32_t hunk;
    uint32_t amount;
+   const uint8_t *hunkmem;
    size_t data_offset   = 0;
    const chd_header *hd = chd_get_header(stream->chd);
    uint8_t         *out = (uint8_t*)data;
@@ -343,12 +652,11 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
          hunk = chd_frame / stream->frames_per_hunk;
          hunk_offset = (chd_frame % stream->frames_per_hunk) * hd->unitbytes;
 
-         if (!chdstream_load_hunk(stream, hunk))
-         {
+         hunkmem = chdstream_load_hunk(stream, hunk);
+         if (!hunkmem)
             return -1;
-         }
          memcpy(out + data_offset,
-                stream->hunkmem + frame_offset
+                hunkmem + frame_offset
                 + hunk_offset + stream->frame_offset, amount);
       }
 
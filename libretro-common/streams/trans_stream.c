@@ -89,6 +89,69 @@ const struct trans_stream_backend* trans_stream_get_zlib_inflate_backend(void)
 #endif
 }
 
+const struct trans_stream_backend* trans_stream_get_zstd_compress_backend(void)
+{
+#if HAVE_ZSTD
+   return &zstd_compress_backend;
+#else
+   return NULL;
+#endif
+}
+
+const struct trans_stream_backend* trans_stream_get_zstd_decompress_backend(void)
+{
+#if HAVE_ZSTD
+   return &zstd_decompress_backend;
+#else
+   return NULL;
+#endif
+}
+
+const struct trans_stream_backend* trans_stream_get_lz4_compress_backend(void)
+{
+#if HAVE_LZ4
+   return &lz4_compress_backend;
+#else
+   return NULL;
+#endif
+}
+
+const struct trans_stream_backend* trans_stream_get_lz4_decompress_backend(void)
+{
+#if HAVE_LZ4
+   return &lz4_decompress_backend;
+#else
+   return NULL;
+#endif
+}
+
+const struct trans_stream_backend* trans_stream_get_decoder(
+    const uint8_t *data, uint32_t size)
+{
+   if (size >= 4)
+   {
+      uint32_t magic = data[0]
+         | ((uint32_t)data[1] << 8)
+         | ((uint32_t)data[2] << 16)
+         | ((uint32_t)data[3] << 24);
+
+      if (magic == 0xFD2FB528)
+         return trans_stream_get_zstd_decompress_backend();
+      if (magic == 0x184D2204)
+         return trans_stream_get_lz4_decompress_backend();
+   }
+
+   /* CMF and FLG: deflate with a window of 32K at most,
+    * and a check on the two */
+   if (     size >= 2
+         && (data[0] & 0x0f) == 8
+         && (data[0] >> 4)   <= 7
+         && (((unsigned)data[0] << 8) | data[1]) % 31 == 0)
+      return trans_stream_get_zlib_inflate_backend();
+
+   return NULL;
+}
+
 const struct trans_stream_backend* trans_stream_get_pipe_backend(void)
 {
    return &pipe_backend;
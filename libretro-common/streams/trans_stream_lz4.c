@@ -0,0 +1,286 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_stream_lz4.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <lz4frame.h>
+#include <string/stdstring.h>
+#include <streams/trans_stream.h>
+
+/* Input compressed by each LZ4F_compressUpdate() */
+#define LZ4_TRANS_CHUNK (64 * 1024)
+
+struct lz4_trans_stream
+{
+   LZ4F_cctx *cctx;
+   LZ4F_dctx *dctx;
+   LZ4F_preferences_t prefs;
+   const uint8_t *in;
+   uint8_t *out;
+   /* Compressed, not yet written out; LZ4F writes
+    * whole blocks only */
+   uint8_t *buf;
+   size_t buf_pos;
+   size_t buf_len;
+   uint32_t in_size;
+   uint32_t out_size;
+   bool inited; /* in the middle of a frame */
+   bool ended;  /* the frame's end is in buf */
+};
+
+static void *lz4_compress_stream_new(void)
+{
+   struct lz4_trans_stream *ret = (struct lz4_trans_stream*)
+      calloc(1, sizeof(struct lz4_trans_stream));
+   if (!ret)
+      return NULL;
+   if (LZ4F_isError(LZ4F_createCompressionContext(&ret->cctx, LZ4F_VERSION)))
+   {
+      free(ret);
+      return NULL;
+   }
+   if (!(ret->buf = (uint8_t*)malloc(
+               LZ4F_compressBound(LZ4_TRANS_CHUNK, NULL))))
+   {
+      LZ4F_freeCompressionContext(ret->cctx);
+      free(ret);
+      return NULL;
+   }
+   return (void *) ret;
+}
+
+static void *lz4_decompress_stream_new(void)
+{
+   struct lz4_trans_stream *ret = (struct lz4_trans_stream*)
+      calloc(1, sizeof(struct lz4_trans_stream));
+   if (!ret)
+      return NULL;
+   if (LZ4F_isError(LZ4F_createDecompressionContext(&ret->dctx, LZ4F_VERSION)))
+   {
+      free(ret);
+      return NULL;
+   }
+   return (void *) ret;
+}
+
+static void lz4_stream_free(void *data)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   if (!z)
+      return;
+   if (z->cctx)
+      LZ4F_freeCompressionContext(z->cctx);
+   if (z->dctx)
+      LZ4F_freeDecompressionContext(z->dctx);
+   free(z->buf);
+   free(z);
+}
+
+/* 0 is the fast compressor, 3 and up the high compression one */
+static bool lz4_compress_define(void *data, const char *prop, uint32_t val)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   if (string_is_equal(prop, "level"))
+   {
+      if (z)
+         z->prefs.compressionLevel = (int) val;
+      return true;
+   }
+   return false;
+}
+
+static void lz4_set_in(void *data, const uint8_t *in, uint32_t in_size)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+
+   if (!z)
+      return;
+
+   z->in      = in;
+   z->in_size = in_size;
+}
+
+static void lz4_set_out(void *data, uint8_t *out, uint32_t out_size)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+
+   if (!z)
+      return;
+
+   z->out      = out;
+   z->out_size = out_size;
+}
+
+static bool lz4_compress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   size_t cap                 = LZ4F_compressBound(LZ4_TRANS_CHUNK, NULL);
+
+   *rd = 0;
+   *wn = 0;
+
+   for (;;)
+   {
+      size_t len = z->buf_len - z->buf_pos;
+
+      if (len > z->out_size)
+         len = z->out_size;
+      if (len)
+      {
+         memcpy(z->out, z->buf + z->buf_pos, len);
+         z->out      += len;
+         z->out_size -= (uint32_t)len;
+         z->buf_pos  += len;
+         *wn         += (uint32_t)len;
+      }
+
+      if (z->buf_pos < z->buf_len)
+         break;
+
+      z->buf_pos = z->buf_len = 0;
+
+      if (!z->inited)
+      {
+         /* Doesn't change within a frame */
+         z->prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+         len = LZ4F_compressBegin(z->cctx, z->buf, cap, &z->prefs);
+         z->inited = true;
+         z->ended  = false;
+      }
+      else if (z->in_size)
+      {
+         uint32_t chunk = z->in_size < LZ4_TRANS_CHUNK
+            ? z->in_size : LZ4_TRANS_CHUNK;
+
+         len = LZ4F_compressUpdate(z->cctx, z->buf, cap,
+               z->in, chunk, NULL);
+         z->in      += chunk;
+         z->in_size -= chunk;
+         *rd        += chunk;
+      }
+      else if (flush && !z->ended)
+      {
+         len = LZ4F_compressEnd(z->cctx, z->buf, cap, NULL);
+         z->ended = true;
+      }
+      else
+         break;
+
+      if (LZ4F_isError(len))
+      {
+         z->inited = false;
+         if (error)
+            *error = TRANS_STREAM_ERROR_OTHER;
+         return false;
+      }
+
+      z->buf_len = len;
+   }
+
+   if (flush && z->ended && z->buf_pos == z->buf_len)
+   {
+      z->inited = false;
+      if (error)
+         *error = TRANS_STREAM_ERROR_NONE;
+      return true;
+   }
+
+   if (z->in_size)
+   {
+      if (error)
+         *error = TRANS_STREAM_ERROR_BUFFER_FULL;
+      return false;
+   }
+
+   if (error)
+      *error = TRANS_STREAM_ERROR_AGAIN;
+   return true;
+}
+
+static bool lz4_decompress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   size_t in_len              = z->in_size;
+   size_t out_len             = z->out_size;
+   size_t zret                = LZ4F_decompress(z->dctx,
+         z->out, &out_len, z->in, &in_len, NULL);
+
+   *rd          = (uint32_t)in_len;
+   *wn          = (uint32_t)out_len;
+   z->in       += in_len;
+   z->in_size  -= (uint32_t)in_len;
+   z->out      += out_len;
+   z->out_size -= (uint32_t)out_len;
+
+   if (LZ4F_isError(zret))
+   {
+      LZ4F_resetDecompressionContext(z->dctx);
+      if (error)
+         *error = TRANS_STREAM_ERROR_OTHER;
+      return false;
+   }
+
+   /* 0 once the frame is done */
+   if (error)
+      *error = zret ? TRANS_STREAM_ERROR_AGAIN : TRANS_STREAM_ERROR_NONE;
+
+   if (!z->out_size && z->in_size)
+   {
+      if (error)
+         *error = TRANS_STREAM_ERROR_BUFFER_FULL;
+      return false;
+   }
+
+   return true;
+}
+
+const struct trans_stream_backend lz4_compress_backend = {
+   "lz4_compress",
+   &lz4_decompress_backend,
+   lz4_compress_stream_new,
+   lz4_stream_free,
+   lz4_compress_define,
+   lz4_set_in,
+   lz4_set_out,
+   lz4_compress_trans,
+   NULL
+};
+
+const struct trans_stream_backend lz4_decompress_backend = {
+   "lz4_decompress",
+   &lz4_compress_backend,
+   lz4_decompress_stream_new,
+   lz4_stream_free,
+   NULL,
+   lz4_set_in,
+   lz4_set_out,
+   lz4_decompress_trans,
+   NULL
+};
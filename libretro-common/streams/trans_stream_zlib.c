@@ -275,7 +275,8 @@ const struct trans_stream_backend zlib_deflate_backend = {
    zlib_deflate_define,
    zlib_deflate_set_in,
    zlib_set_out,
-   zlib_deflate_trans
+   zlib_deflate_trans,
+   NULL
 };
 
 const struct trans_stream_backend zlib_inflate_backend = {
@@ -286,5 +287,6 @@ const struct trans_stream_backend zlib_inflate_backend = {
    zlib_inflate_define,
    zlib_inflate_set_in,
    zlib_set_out,
-   zlib_inflate_trans
+   zlib_inflate_trans,
+   NULL
 };
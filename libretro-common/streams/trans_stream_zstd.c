@@ -0,0 +1,242 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_stream_zstd.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+
+#include <zstd.h>
+#include <string/stdstring.h>
+#include <streams/trans_stream.h>
+
+struct zstd_trans_stream
+{
+   ZSTD_CCtx *cctx;
+   ZSTD_DCtx *dctx;
+   ZSTD_inBuffer in;
+   ZSTD_outBuffer out;
+   int level;
+   bool inited; /* in the middle of a frame */
+};
+
+static void *zstd_compress_stream_new(void)
+{
+   struct zstd_trans_stream *ret = (struct zstd_trans_stream*)
+      calloc(1, sizeof(struct zstd_trans_stream));
+   if (!ret)
+      return NULL;
+   if (!(ret->cctx = ZSTD_createCCtx()))
+   {
+      free(ret);
+      return NULL;
+   }
+   ret->level = ZSTD_CLEVEL_DEFAULT;
+   return (void *) ret;
+}
+
+static void *zstd_decompress_stream_new(void)
+{
+   struct zstd_trans_stream *ret = (struct zstd_trans_stream*)
+      calloc(1, sizeof(struct zstd_trans_stream));
+   if (!ret)
+      return NULL;
+   if (!(ret->dctx = ZSTD_createDCtx()))
+   {
+      free(ret);
+      return NULL;
+   }
+   return (void *) ret;
+}
+
+static void zstd_stream_free(void *data)
+{
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+   if (!z)
+      return;
+   if (z->cctx)
+      ZSTD_freeCCtx(z->cctx);
+   if (z->dctx)
+      ZSTD_freeDCtx(z->dctx);
+   free(z);
+}
+
+static bool zstd_compress_define(void *data, const char *prop, uint32_t val)
+{
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+   if (string_is_equal(prop, "level"))
+   {
+      if (z)
+         z->level = (int) val;
+      return true;
+   }
+   return false;
+}
+
+static void zstd_set_in(void *data, const uint8_t *in, uint32_t in_size)
+{
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+
+   if (!z)
+      return;
+
+   z->in.src  = in;
+   z->in.size = in_size;
+   z->in.pos  = 0;
+}
+
+static void zstd_set_out(void *data, uint8_t *out, uint32_t out_size)
+{
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+
+   if (!z)
+      return;
+
+   z->out.dst  = out;
+   z->out.size = out_size;
+   z->out.pos  = 0;
+}
+
+static bool zstd_compress_set_dict(void *data,
+      const uint8_t *dict, uint32_t dict_size)
+{
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+   /* Copied, and used for every frame from now on */
+   return z && !ZSTD_isError(ZSTD_CCtx_loadDictionary(z->cctx,
+            dict, dict_size));
+}
+
+static bool zstd_decompress_set_dict(void *data,
+      const uint8_t *dict, uint32_t dict_size)
+{
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+   return z && !ZSTD_isError(ZSTD_DCtx_loadDictionary(z->dctx,
+            dict, dict_size));
+}
+
+/* Same results as zlib_deflate_trans() and zlib_inflate_trans():
+ * the frame being done is TRANS_STREAM_ERROR_NONE, a full output
+ * buffer with input left TRANS_STREAM_ERROR_BUFFER_FULL */
+static bool zstd_trans_result(struct zstd_trans_stream *z,
+      size_t zret, size_t pre_in, size_t pre_out,
+      uint32_t *rd, uint32_t *wn, enum trans_stream_error *error)
+{
+   bool ret = true;
+
+   *rd = (uint32_t)(z->in.pos  - pre_in);
+   *wn = (uint32_t)(z->out.pos - pre_out);
+
+   if (ZSTD_isError(zret))
+   {
+      if (error)
+         *error = TRANS_STREAM_ERROR_OTHER;
+      z->inited = false;
+      return false;
+   }
+
+   if (error)
+      *error = zret ? TRANS_STREAM_ERROR_AGAIN : TRANS_STREAM_ERROR_NONE;
+
+   if (z->out.pos == z->out.size && z->in.pos != z->in.size)
+   {
+      ret = false;
+      if (error)
+         *error = TRANS_STREAM_ERROR_BUFFER_FULL;
+   }
+
+   return ret;
+}
+
+static bool zstd_compress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   size_t zret;
+   size_t pre_in;
+   size_t pre_out;
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+
+   if (!z->inited)
+   {
+      ZSTD_CCtx_setParameter(z->cctx, ZSTD_c_compressionLevel, z->level);
+      z->inited = true;
+   }
+
+   pre_in  = z->in.pos;
+   pre_out = z->out.pos;
+   zret    = ZSTD_compressStream2(z->cctx, &z->out, &z->in,
+         flush ? ZSTD_e_end : ZSTD_e_continue);
+
+   /* Without flushing, the frame isn't done whatever is left */
+   if (!flush && !ZSTD_isError(zret))
+      zret = 1;
+   else if (flush && !zret)
+      z->inited = false;
+
+   if (ZSTD_isError(zret))
+      ZSTD_CCtx_reset(z->cctx, ZSTD_reset_session_only);
+
+   return zstd_trans_result(z, zret, pre_in, pre_out, rd, wn, error);
+}
+
+static bool zstd_decompress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   size_t zret;
+   size_t pre_in;
+   size_t pre_out;
+   struct zstd_trans_stream *z = (struct zstd_trans_stream *) data;
+
+   pre_in  = z->in.pos;
+   pre_out = z->out.pos;
+   zret    = ZSTD_decompressStream(z->dctx, &z->out, &z->in);
+
+   if (ZSTD_isError(zret))
+      ZSTD_DCtx_reset(z->dctx, ZSTD_reset_session_only);
+
+   return zstd_trans_result(z, zret, pre_in, pre_out, rd, wn, error);
+}
+
+const struct trans_stream_backend zstd_compress_backend = {
+   "zstd_compress",
+   &zstd_decompress_backend,
+   zstd_compress_stream_new,
+   zstd_stream_free,
+   zstd_compress_define,
+   zstd_set_in,
+   zstd_set_out,
+   zstd_compress_trans,
+   zstd_compress_set_dict
+};
+
+const struct trans_stream_backend zstd_decompress_backend = {
+   "zstd_decompress",
+   &zstd_compress_backend,
+   zstd_decompress_stream_new,
+   zstd_stream_free,
+   NULL,
+   zstd_set_in,
+   zstd_set_out,
+   zstd_decompress_trans,
+   zstd_decompress_set_dict
+};
@@ -0,0 +1,217 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (string_pool.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string/string_pool.h>
+
+/* Blocks double in size up to the last one, so there are few
+ * of them to look through in string_pool_owns() */
+#define STRING_POOL_MIN_BLOCK (4 * 1024)
+#define STRING_POOL_MAX_BLOCK (256 * 1024)
+
+struct string_pool_block
+{
+   struct string_pool_block *next;
+   size_t size;
+   size_t used;
+   char data[1];
+};
+
+struct string_pool
+{
+   /* Newest first, it's the one being filled */
+   struct string_pool_block *blocks;
+   size_t next_size;
+
+   /* Interned strings, open addressing, at most half full */
+   char **table;
+   size_t table_size;
+   size_t table_count;
+};
+
+string_pool_t *string_pool_new(void)
+{
+   string_pool_t *pool = (string_pool_t*)calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->next_size = STRING_POOL_MIN_BLOCK;
+   return pool;
+}
+
+void string_pool_free(string_pool_t *pool)
+{
+   struct string_pool_block *block;
+
+   if (!pool)
+      return;
+
+   block = pool->blocks;
+   while (block)
+   {
+      struct string_pool_block *next = block->next;
+      free(block);
+      block = next;
+   }
+
+   free(pool->table);
+   free(pool);
+}
+
+static char *string_pool_alloc(string_pool_t *pool, size_t len)
+{
+   char *str;
+   struct string_pool_block *block = pool->blocks;
+
+   if (!block || block->size - block->used < len)
+   {
+      size_t size = pool->next_size;
+
+      /* Too big for a block of the usual size, it gets its own */
+      if (size < len)
+         size = len;
+
+      block = (struct string_pool_block*)malloc(
+            sizeof(*block) - 1 + size);
+      if (!block)
+         return NULL;
+
+      block->size = size;
+      block->used = 0;
+
+      /* What was left in the current one is lost, unless it's
+       * more than what the new one has */
+      if (pool->blocks && size - len < pool->blocks->size - pool->blocks->used)
+      {
+         block->next        = pool->blocks->next;
+         pool->blocks->next = block;
+      }
+      else
+      {
+         block->next        = pool->blocks;
+         pool->blocks       = block;
+      }
+
+      if (pool->next_size < STRING_POOL_MAX_BLOCK)
+         pool->next_size  <<= 1;
+   }
+
+   str          = block->data + block->used;
+   block->used += len;
+   return str;
+}
+
+char *string_pool_strdup(string_pool_t *pool, const char *str)
+{
+   char *copy;
+   size_t len;
+
+   if (!pool || !str)
+      return NULL;
+
+   len  = strlen(str) + 1;
+   copy = string_pool_alloc(pool, len);
+   if (copy)
+      memcpy(copy, str, len);
+   return copy;
+}
+
+static uint32_t string_pool_hash(const char *str)
+{
+   uint32_t hash = 5381;
+
+   while (*str)
+      hash = (hash << 5) + hash + (uint8_t)*str++;
+
+   return hash;
+}
+
+static bool string_pool_grow_table(string_pool_t *pool)
+{
+   size_t i;
+   size_t size  = pool->table_size ? pool->table_size * 2 : 64;
+   char **table = (char**)calloc(size, sizeof(*table));
+
+   if (!table)
+      return false;
+
+   for (i = 0; i < pool->table_size; i++)
+   {
+      size_t j;
+
+      if (!pool->table[i])
+         continue;
+
+      for (j = string_pool_hash(pool->table[i]) & (size - 1);
+            table[j]; j = (j + 1) & (size - 1));
+      table[j] = pool->table[i];
+   }
+
+   free(pool->table);
+   pool->table      = table;
+   pool->table_size = size;
+   return true;
+}
+
+char *string_pool_intern(string_pool_t *pool, const char *str)
+{
+   size_t i;
+   char *copy;
+
+   if (!pool || !str)
+      return NULL;
+
+   if (     (pool->table_count + 1) * 2 > pool->table_size
+         && !string_pool_grow_table(pool))
+      return string_pool_strdup(pool, str);
+
+   for (i = string_pool_hash(str) & (pool->table_size - 1);
+         pool->table[i]; i = (i + 1) & (pool->table_size - 1))
+      if (!strcmp(pool->table[i], str))
+         return pool->table[i];
+
+   copy = string_pool_strdup(pool, str);
+   if (copy)
+   {
+      pool->table[i] = copy;
+      pool->table_count++;
+   }
+   return copy;
+}
+
+bool string_pool_owns(const string_pool_t *pool, const char *str)
+{
+   const struct string_pool_block *block;
+
+   if (!pool || !str)
+      return false;
+
+   for (block = pool->blocks; block; block = block->next)
+      if (str >= block->data && str < block->data + block->used)
+         return true;
+
+   return false;
+}
@@ -191,6 +191,74 @@
 
 #define RFILE_HINT_UNBUFFERED (1 << 8)
 
+/* Asks the kernel to read ahead of handles read sequentially, which
+ * it does asynchronously into the page cache the reads are then
+ * served from. */
+#if defined(__linux__) && defined(POSIX_FADV_WILLNEED)
+#define HAVE_VFS_PREFETCH
+#endif
+
+/* Reads in a row starting where the last one ended before a handle
+ * is taken to be read sequentially */
+#define VFS_PREFETCH_SEQUENTIAL_READS 2
+/* How far past the read position is read ahead */
+#define VFS_PREFETCH_WINDOW (1024 * 1024)
+
+static bool vfs_prefetch_enable = false;
+
+void retro_vfs_file_set_prefetch(bool enable)
+{
+   vfs_prefetch_enable = enable;
+}
+
+#ifdef HAVE_VFS_PREFETCH
+static void retro_vfs_file_prefetch(libretro_vfs_implementation_file *stream,
+      int64_t pos, uint64_t len)
+{
+   uint64_t end;
+   int fd = (stream->hints & RFILE_HINT_UNBUFFERED) ?
+      stream->fd : fileno(stream->fp);
+
+   if (pos < 0)
+      return;
+
+   if ((uint64_t)pos != stream->prefetch_pos)
+   {
+      /* Seeked, what was read ahead may not be of use anymore */
+      if (stream->prefetch_hits >= VFS_PREFETCH_SEQUENTIAL_READS)
+         posix_fadvise(fd, 0, 0, POSIX_FADV_NORMAL);
+      stream->prefetch_hits = 0;
+      stream->prefetch_end  = 0;
+   }
+   else if (stream->prefetch_hits < VFS_PREFETCH_SEQUENTIAL_READS)
+   {
+      /* Also doubles the read-ahead of the kernel's own */
+      if (++stream->prefetch_hits == VFS_PREFETCH_SEQUENTIAL_READS)
+         posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+   }
+
+   /* Reads only come up short at the end of the file */
+   end = (uint64_t)pos + len;
+   if ((int64_t)end > stream->size)
+      end = (uint64_t)stream->size;
+   stream->prefetch_pos = end;
+
+   if (stream->prefetch_hits < VFS_PREFETCH_SEQUENTIAL_READS ||
+         (int64_t)end >= stream->size)
+      return;
+
+   /* Top the window up once half of it was read */
+   if (stream->prefetch_end < end + VFS_PREFETCH_WINDOW / 2)
+   {
+      uint64_t start = stream->prefetch_end > end ? stream->prefetch_end : end;
+
+      stream->prefetch_end = end + VFS_PREFETCH_WINDOW;
+      posix_fadvise(fd, (off_t)start,
+            (off_t)(stream->prefetch_end - start), POSIX_FADV_WILLNEED);
+   }
+}
+#endif
+
 int64_t retro_vfs_file_seek_internal(libretro_vfs_implementation_file *stream, int64_t offset, int whence)
 {
    if (!stream)
@@ -326,6 +394,9 @@ libretro_vfs_implementation_file *retro_vfs_file_open_impl(
 
    stream->hints           = hints;
    stream->orig_path       = strdup(path);
+   stream->prefetch        = vfs_prefetch_enable &&
+      mode == RETRO_VFS_FILE_ACCESS_READ &&
+      stream->scheme == VFS_SCHEME_NONE;
 
 #ifdef HAVE_MMAP
    if (stream->hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS && mode == RETRO_VFS_FILE_ACCESS_READ)
@@ -676,6 +747,14 @@ int64_t retro_vfs_file_read_impl(libretro_vfs_implementation_file *stream,
    if (!stream || !s)
       return -1;
 
+#ifdef HAVE_VFS_PREFETCH
+   /* Mapped files get read ahead of as their pages fault in */
+   if (stream->prefetch && !(stream->hints &
+            RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS))
+      retro_vfs_file_prefetch(stream,
+            retro_vfs_file_tell_impl(stream), len);
+#endif
+
    if ((stream->hints & RFILE_HINT_UNBUFFERED) == 0)
    {
 #ifdef HAVE_CDROM
@@ -33,6 +33,7 @@
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
+#include <rthreads/tpool.h>
 
 #include "libretrodb.h"
 
@@ -743,6 +744,72 @@ static int dat_converter_value_provider(
    return 0;
 }
 
+/* DAT files read and lexed at once, one per thread; parsing
+ * stays in file order */
+#define DAT_CONVERTER_MAX_THREADS 8
+
+typedef struct
+{
+   const char* path;
+   char* buffer;
+   dat_converter_list_t* lexer_list;
+} dat_converter_job_t;
+
+typedef struct
+{
+   dat_converter_job_t* jobs;
+   int count;
+} dat_converter_jobs_t;
+
+static void dat_converter_job_run(dat_converter_job_t* job)
+{
+   size_t dat_file_size;
+   FILE* dat_file = fopen(job->path, "r");
+
+   if (!dat_file)
+   {
+      printf("  could not open dat file '%s': %s\n",
+            job->path, strerror(errno));
+      dat_converter_exit(1);
+   }
+
+   fseek(dat_file, 0, SEEK_END);
+   dat_file_size = ftell(dat_file);
+   fseek(dat_file, 0, SEEK_SET);
+   job->buffer = (char*)malloc(dat_file_size + 1);
+   fread(job->buffer, 1, dat_file_size, dat_file);
+   fclose(dat_file);
+   job->buffer[dat_file_size] = '\0';
+
+   job->lexer_list = dat_converter_lexer(job->buffer, job->path);
+}
+
+static void dat_converter_jobs_range(void* data, size_t begin, size_t end)
+{
+   dat_converter_jobs_t* jobs = (dat_converter_jobs_t*)data;
+   size_t i;
+
+   for (i = begin; i < end; i++)
+      dat_converter_job_run(&jobs->jobs[i]);
+}
+
+static void dat_converter_jobs_run(dat_converter_jobs_t* jobs)
+{
+   tpool_t* pool    = NULL;
+   int thread_count = jobs->count < DAT_CONVERTER_MAX_THREADS
+      ? jobs->count - 1 : DAT_CONVERTER_MAX_THREADS - 1;
+
+   /* This thread takes its share too, and all of them
+    * if there's no pool */
+   if (thread_count > 0)
+      pool = tpool_create(thread_count);
+
+   tpool_parallel_for(pool, jobs->count, 1,
+         dat_converter_jobs_range, jobs);
+
+   tpool_destroy(pool);
+}
+
 int main(int argc, char** argv)
 {
    const char* rdb_path;
@@ -769,42 +836,28 @@ int main(int argc, char** argv)
    }
 
    int dat_count                         = argc;
-   char** dat_buffers                    = (char**)
-      malloc(dat_count * sizeof(*dat_buffers));
-   char** dat_buffer                     = dat_buffers;
+   int dat_index;
+   dat_converter_jobs_t dat_jobs;
    dat_converter_list_t* dat_parser_list = NULL;
 
-   while (argc)
-   {
-      size_t dat_file_size;
-      dat_converter_list_t* dat_lexer_list = NULL;
-      FILE* dat_file                       = fopen(*argv, "r");
+   dat_jobs.jobs  = (dat_converter_job_t*)
+      calloc(dat_count ? dat_count : 1, sizeof(*dat_jobs.jobs));
+   dat_jobs.count = dat_count;
 
-      if (!dat_file)
-      {
-         printf("  could not open dat file '%s': %s\n",
-               *argv, strerror(errno));
-         dat_converter_exit(1);
-      }
+   for (dat_index = 0; dat_index < dat_count; dat_index++)
+      dat_jobs.jobs[dat_index].path = argv[dat_index];
 
-      fseek(dat_file, 0, SEEK_END);
-      dat_file_size = ftell(dat_file);
-      fseek(dat_file, 0, SEEK_SET);
-      *dat_buffer = (char*)malloc(dat_file_size + 1);
-      fread(*dat_buffer, 1, dat_file_size, dat_file);
-      fclose(dat_file);
-      (*dat_buffer)[dat_file_size] = '\0';
+   dat_converter_jobs_run(&dat_jobs);
 
-      printf("  %s\n", *argv);
-      dat_lexer_list  = dat_converter_lexer(*dat_buffer, *argv);
-      dat_parser_list = dat_converter_parser(
-            dat_parser_list, dat_lexer_list, match_key);
+   for (dat_index = 0; dat_index < dat_count; dat_index++)
+   {
+      dat_converter_job_t* job = &dat_jobs.jobs[dat_index];
 
-      dat_converter_list_free(dat_lexer_list);
+      printf("  %s\n", job->path);
+      dat_parser_list = dat_converter_parser(
+            dat_parser_list, job->lexer_list, match_key);
 
-      argc--;
-      argv++;
-      dat_buffer++;
+      dat_converter_list_free(job->lexer_list);
    }
 
    rdb_file = filestream_open(rdb_path,
@@ -835,8 +888,8 @@ int main(int argc, char** argv)
    dat_converter_list_free(dat_parser_list);
 
    while (dat_count--)
-      free(dat_buffers[dat_count]);
-   free(dat_buffers);
+      free(dat_jobs.jobs[dat_count].buffer);
+   free(dat_jobs.jobs);
 
    dat_converter_match_key_free(match_key);
 
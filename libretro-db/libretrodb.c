@@ -40,18 +40,11 @@
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
-{
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
-
 struct libretrodb
 {
 	RFILE *fd;
@@ -79,6 +72,17 @@ typedef struct libretrodb_header
 	uint64_t metadata_offset;
 } libretrodb_header_t;
 
+/* Open addressing, at most half full */
+struct libretrodb_hash
+{
+   /* Where each item is, 0 for none, there's the header there */
+   uint64_t *offsets;
+   uint32_t *keys;
+   size_t size;
+   size_t count;
+   char field_name[50];
+};
+
 struct libretrodb_cursor
 {
 	int is_valid;
@@ -86,6 +90,8 @@ struct libretrodb_cursor
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+   /* Holds the last item read */
+   struct rmsgpack_dom_arena arena;
 };
 
 static struct rmsgpack_dom_value sentinal;
@@ -173,8 +179,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(
-            fd, 0, RETRO_VFS_SEEK_POSITION_CURRENT));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, RETRO_VFS_SEEK_POSITION_START);
@@ -238,7 +243,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -379,7 +384,9 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
+   rmsgpack_dom_arena_reset(&cursor->arena);
+
+   rv = rmsgpack_dom_read_arena(cursor->fd, out, &cursor->arena);
    if (rv < 0)
       return rv;
 
@@ -392,10 +399,7 @@ retry:
    if (cursor->query)
    {
       if (!libretrodb_query_filter(cursor->query, out))
-      {
-         rmsgpack_dom_value_free(out);
          goto retry;
-      }
    }
 
    return 0;
@@ -418,6 +422,8 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
+   rmsgpack_dom_arena_free(&cursor->arena);
+
    cursor->is_valid = 0;
    cursor->eof      = 1;
    cursor->fd       = NULL;
@@ -461,53 +467,80 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    return 0;
 }
 
-static int node_iter(void *value, void *ctx)
+/* Sorts @count records of @size bytes by their first @key_size
+ * bytes; a merge sort, as qsort() can't be told the key size.
+ * Returns the buffer the sorted records ended up in. */
+static uint8_t *libretrodb_sort_records(uint8_t *records, uint8_t *tmp,
+      size_t count, size_t size, size_t key_size)
 {
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+   size_t width;
 
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
-      return 0;
+   for (width = 1; width < count; width *= 2)
+   {
+      size_t start;
+      uint8_t *swap;
 
-   return -1;
-}
+      for (start = 0; start < count; start += 2 * width)
+      {
+         size_t i   = start;
+         size_t mid = start + width < count ? start + width : count;
+         size_t end = start + 2 * width < count ? start + 2 * width : count;
+         size_t j   = mid;
+         size_t k   = start;
+
+         while (i < mid && j < end)
+         {
+            if (memcmp(records + j * size, records + i * size, key_size) < 0)
+               memcpy(tmp + k++ * size, records + j++ * size, size);
+            else
+               memcpy(tmp + k++ * size, records + i++ * size, size);
+         }
+
+         memcpy(tmp + k * size, records + i * size, (mid - i) * size);
+         k += mid - i;
+         memcpy(tmp + k * size, records + j * size, (end - j) * size);
+      }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_tell(db->fd);
-}
+      swap    = records;
+      records = tmp;
+      tmp     = swap;
+   }
 
-static int node_compare(const void *a, const void *b, void *ctx)
-{
-   return memcmp(a, b, *(uint8_t *)ctx);
+   return records;
 }
 
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
    struct rmsgpack_dom_value key;
    libretrodb_index_t idx;
    struct rmsgpack_dom_value item;
    libretrodb_cursor_t cur          = {0};
    struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
+   /* Key, then where its item is */
+   uint8_t *records                 = NULL;
+   uint8_t *tmp                     = NULL;
+   uint8_t *sorted                  = NULL;
+   size_t record_size               = 0;
+   size_t count                     = 0;
+   size_t capacity                  = 0;
+   size_t i;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
 
-   item.type                        = RDT_NULL;
-
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
+   if (libretrodb_cursor_open(db, &cur, NULL) != 0)
       goto clean;
 
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
 
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   for (;;)
    {
+      uint64_t item_loc = filestream_tell(cur.fd);
+
+      if (libretrodb_cursor_read_item(&cur, &item) != 0)
+         break;
+
       if (item.type != RDT_MAP)
       {
          printf("Only map keys are supported\n");
@@ -535,33 +568,56 @@ int libretrodb_create_index(libretrodb_t *db,
       }
 
       if (field_size == 0)
-         field_size = field->val.binary.len;
+      {
+         field_size  = field->val.binary.len;
+         record_size = field_size + sizeof(uint64_t);
+      }
       else if (field->val.binary.len != field_size)
       {
          printf("field is not of correct size\n");
          goto clean;
       }
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
+      if (count == capacity)
+      {
+         size_t new_capacity = capacity ? capacity * 2 : 1024;
+         uint8_t *new_records = (uint8_t*)realloc(records,
+               new_capacity * record_size);
 
-      memcpy(buff, field->val.binary.buff, field_size);
+         if (!new_records)
+            goto clean;
 
-      buff_u64 = (uint64_t *)buff + field_size;
+         records  = new_records;
+         capacity = new_capacity;
+      }
+
+      memcpy(records + count * record_size,
+            field->val.binary.buff, field_size);
+      memcpy(records + count * record_size + field_size,
+            &item_loc, sizeof(uint64_t));
+      count++;
+   }
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   if (count && !(tmp = (uint8_t*)malloc(count * record_size)))
+      goto clean;
 
-      if (bintree_insert(tree, buff) != 0)
+   /* All at once, instead of one tree insert per item */
+   sorted = libretrodb_sort_records(records, tmp, count,
+         record_size, field_size);
+
+   for (i = 1; i < count; i++)
+   {
+      if (memcmp(sorted + (i - 1) * record_size,
+               sorted + i * record_size, field_size) == 0)
       {
+         uint8_t *dup = sorted + i * record_size;
+
          printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
+         for (; field_size; field_size--)
+            printf("%02X", *dup++);
          printf("\n");
          goto clean;
       }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
    }
 
    filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
@@ -570,22 +626,17 @@ int libretrodb_create_index(libretrodb_t *db,
 
    idx.name[49] = '\0';
    idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
+   idx.next     = count * record_size;
    libretrodb_write_index_header(db->fd, &idx);
 
-   nictx.db  = db;
-   nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   if (count)
+      filestream_write(db->fd, sorted, (int64_t)(count * record_size));
 
 clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
+   free(records);
+   free(tmp);
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
    return 0;
 }
 
@@ -625,3 +676,177 @@ void libretrodb_free(libretrodb_t *db)
 
    free(db);
 }
+
+static uint32_t libretrodb_hash_key(const void *key, uint32_t len)
+{
+   uint32_t hash      = 2166136261u;
+   const uint8_t *buf = (const uint8_t*)key;
+
+   while (len--)
+      hash = (hash ^ *buf++) * 16777619u;
+
+   return hash;
+}
+
+static void libretrodb_hash_insert(libretrodb_hash_t *hash,
+      uint32_t key, uint64_t offset)
+{
+   size_t i = key & (hash->size - 1);
+
+   while (hash->offsets[i])
+      i = (i + 1) & (hash->size - 1);
+
+   hash->offsets[i] = offset;
+   hash->keys[i]    = key;
+   hash->count++;
+}
+
+static int libretrodb_hash_resize(libretrodb_hash_t *hash, size_t size)
+{
+   size_t i;
+   size_t old_size      = hash->size;
+   uint64_t *old_offsets = hash->offsets;
+   uint32_t *old_keys    = hash->keys;
+
+   hash->offsets = (uint64_t*)calloc(size, sizeof(*hash->offsets));
+   hash->keys    = (uint32_t*)calloc(size, sizeof(*hash->keys));
+
+   if (!hash->offsets || !hash->keys)
+   {
+      free(hash->offsets);
+      free(hash->keys);
+      hash->offsets = old_offsets;
+      hash->keys    = old_keys;
+      return -ENOMEM;
+   }
+
+   hash->size  = size;
+   hash->count = 0;
+
+   for (i = 0; i < old_size; i++)
+      if (old_offsets && old_offsets[i])
+         libretrodb_hash_insert(hash, old_keys[i], old_offsets[i]);
+
+   free(old_offsets);
+   free(old_keys);
+   return 0;
+}
+
+libretrodb_hash_t *libretrodb_hash_new(libretrodb_t *db,
+      const char *field_name)
+{
+   struct rmsgpack_dom_value key;
+   struct rmsgpack_dom_value item;
+   libretrodb_cursor_t cur = {0};
+   size_t size             = 16;
+   libretrodb_hash_t *hash = (libretrodb_hash_t*)calloc(1, sizeof(*hash));
+
+   if (!hash)
+      return NULL;
+
+   strlcpy(hash->field_name, field_name, sizeof(hash->field_name));
+
+   while (size < db->count * 2 && size < (1 << 20))
+      size <<= 1;
+
+   if (     libretrodb_hash_resize(hash, size) != 0
+         || libretrodb_cursor_open(db, &cur, NULL) != 0)
+      goto error;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = (uint32_t)strlen(hash->field_name);
+   key.val.string.buff = hash->field_name;
+   item.type           = RDT_NULL;
+
+   for (;;)
+   {
+      struct rmsgpack_dom_value *field = NULL;
+      uint64_t offset                  = filestream_tell(cur.fd);
+
+      if (libretrodb_cursor_read_item(&cur, &item) != 0)
+         break;
+
+      if (item.type == RDT_MAP)
+         field = rmsgpack_dom_value_map_value(&item, &key);
+
+      if (field && field->type == RDT_BINARY)
+      {
+         /* The count in the metadata can't be trusted */
+         if (     (hash->count + 1) * 2 > hash->size
+               && libretrodb_hash_resize(hash, hash->size * 2) != 0)
+         {
+            libretrodb_cursor_close(&cur);
+            goto error;
+         }
+
+         libretrodb_hash_insert(hash, libretrodb_hash_key(
+                  field->val.binary.buff, field->val.binary.len), offset);
+      }
+   }
+
+   libretrodb_cursor_close(&cur);
+   return hash;
+
+error:
+   libretrodb_hash_free(hash);
+   return NULL;
+}
+
+void libretrodb_hash_free(libretrodb_hash_t *hash)
+{
+   if (!hash)
+      return;
+
+   free(hash->offsets);
+   free(hash->keys);
+   free(hash);
+}
+
+int libretrodb_hash_find(libretrodb_t *db, const libretrodb_hash_t *hash,
+      const void *key, uint32_t key_len, size_t *iter,
+      struct rmsgpack_dom_value *out)
+{
+   struct rmsgpack_dom_value name;
+   uint32_t hkey = libretrodb_hash_key(key, key_len);
+
+   name.type            = RDT_STRING;
+   name.val.string.len  = (uint32_t)strlen(hash->field_name);
+   name.val.string.buff = (char*)hash->field_name;
+
+   /* @iter is how far along the probe sequence the last one was */
+   for (; *iter < hash->size; (*iter)++)
+   {
+      struct rmsgpack_dom_value *field = NULL;
+      size_t i = (hkey + *iter) & (hash->size - 1);
+
+      if (!hash->offsets[i])
+         break;
+
+      if (hash->keys[i] != hkey)
+         continue;
+
+      if (filestream_seek(db->fd, (ssize_t)hash->offsets[i],
+               RETRO_VFS_SEEK_POSITION_START) < 0)
+         return -errno;
+
+      if (rmsgpack_dom_read(db->fd, out) < 0)
+         return -EINVAL;
+
+      if (out->type == RDT_MAP)
+         field = rmsgpack_dom_value_map_value(out, &name);
+
+      /* Same hash, different key */
+      if (     !field || field->type != RDT_BINARY
+            || field->val.binary.len != key_len
+            || memcmp(field->val.binary.buff, key, key_len) != 0)
+      {
+         rmsgpack_dom_value_free(out);
+         continue;
+      }
+
+      (*iter)++;
+      return 0;
+   }
+
+   return -1;
+}
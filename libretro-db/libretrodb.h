@@ -43,6 +43,8 @@ typedef struct libretrodb_cursor libretrodb_cursor_t;
 
 typedef struct libretrodb_index libretrodb_index_t;
 
+typedef struct libretrodb_hash libretrodb_hash_t;
+
 typedef int (*libretrodb_value_provider)(void *ctx, struct rmsgpack_dom_value *out);
 
 int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider, void *ctx);
@@ -102,9 +104,53 @@ void *libretrodb_query_compile(libretrodb_t *db, const char *query,
 
 void libretrodb_query_free(void *q);
 
+/**
+ * libretrodb_cursor_read_item:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Next item matching the query.
+ *
+ * @out belongs to @cursor and stays valid until the next read or
+ * until the cursor is closed; don't rmsgpack_dom_value_free() it.
+ *
+ * Returns: 0 if successful, EOF at the end, otherwise negative.
+ **/
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_hash_new:
+ * @db                  : Handle to database.
+ * @field_name          : Binary field to index by.
+ *
+ * Reads the whole database once to find where each item is
+ * by its @field_name. Items without it are left out. The index is
+ * kept in memory, @db must stay open while it's used.
+ *
+ * Returns: the index, or NULL on error.
+ **/
+libretrodb_hash_t *libretrodb_hash_new(libretrodb_t *db,
+      const char *field_name);
+
+void libretrodb_hash_free(libretrodb_hash_t *hash);
+
+/**
+ * libretrodb_hash_find:
+ * @db                  : Handle to database, as given to libretrodb_hash_new.
+ * @hash                : Index to find the item in.
+ * @key                 : Value of the field.
+ * @key_len             : Size of @key.
+ * @iter                : 0 to find the first item, then left as it's set
+ *                        to find the next one.
+ * @out                 : Item found, to be freed.
+ *
+ * Reads the next item with the field set to @key.
+ *
+ * Returns: 0 if an item was read, otherwise negative.
+ **/
+int libretrodb_hash_find(libretrodb_t *db, const libretrodb_hash_t *hash,
+      const void *key, uint32_t key_len, size_t *iter,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
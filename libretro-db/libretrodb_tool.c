@@ -80,7 +80,6 @@ int main(int argc, char ** argv)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
       }
    }
    else if (memcmp(command, "find", 4) == 0)
@@ -111,7 +110,6 @@ int main(int argc, char ** argv)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
       }
    }
    else if (memcmp(command, "get-names", 9) == 0)
@@ -152,8 +150,6 @@ int main(int argc, char ** argv)
                }
             }
          }
-
-         rmsgpack_dom_value_free(&item);
       }
    }
    else if (memcmp(command, "create-index", 12) == 0)
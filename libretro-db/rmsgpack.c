@@ -460,7 +460,22 @@ error:
    return -errno;
 }
 
-static int read_buff(RFILE *fd, size_t size, char **pbuff, uint64_t *len)
+static char *alloc_buff(struct rmsgpack_read_callbacks *callbacks,
+      size_t size, void *data)
+{
+   if (callbacks->alloc_buff)
+      return (char *)callbacks->alloc_buff(size, data);
+   return (char *)malloc(size);
+}
+
+static void free_buff(struct rmsgpack_read_callbacks *callbacks, char *buff)
+{
+   if (!callbacks->alloc_buff)
+      free(buff);
+}
+
+static int read_buff(RFILE *fd, size_t size, char **pbuff, uint64_t *len,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
 {
    uint64_t tmp_len = 0;
    ssize_t read_len = 0;
@@ -468,7 +483,9 @@ static int read_buff(RFILE *fd, size_t size, char **pbuff, uint64_t *len)
    if (read_uint(fd, &tmp_len, size) == -1)
       return -errno;
 
-   *pbuff = (char *)malloc((size_t)(tmp_len + 1) * sizeof(char));
+   *pbuff = alloc_buff(callbacks, (size_t)(tmp_len + 1) * sizeof(char), data);
+   if (!*pbuff)
+      return -ENOMEM;
 
    if ((read_len = filestream_read(fd, *pbuff, (size_t)tmp_len)) == -1)
       goto error;
@@ -481,7 +498,7 @@ static int read_buff(RFILE *fd, size_t size, char **pbuff, uint64_t *len)
    return 0;
 
 error:
-   free(*pbuff);
+   free_buff(callbacks, *pbuff);
    *pbuff = NULL;
    return -errno;
 }
@@ -559,18 +576,18 @@ int rmsgpack_read(RFILE *fd,
    {
       ssize_t read_len = 0;
       tmp_len = type - MPF_FIXSTR;
-      buff = (char *)malloc((size_t)(tmp_len + 1) * sizeof(char));
+      buff = alloc_buff(callbacks, (size_t)(tmp_len + 1) * sizeof(char), data);
       if (!buff)
          return -ENOMEM;
       if ((read_len = filestream_read(fd, buff, (ssize_t)tmp_len)) == -1)
       {
-         free(buff);
+         free_buff(callbacks, buff);
          goto error;
       }
       buff[read_len] = '\0';
       if (!callbacks->read_string)
       {
-         free(buff);
+         free_buff(callbacks, buff);
          return 0;
       }
       return callbacks->read_string(buff, (uint32_t)read_len, data);
@@ -600,7 +617,7 @@ int rmsgpack_read(RFILE *fd,
       case _MPF_BIN16:
       case _MPF_BIN32:
          if ((rv = read_buff(fd, (size_t)(1 << (type - _MPF_BIN8)),
-                     &buff, &tmp_len)) < 0)
+                     &buff, &tmp_len, callbacks, data)) < 0)
             return rv;
 
          if (callbacks->read_bin)
@@ -633,7 +650,8 @@ int rmsgpack_read(RFILE *fd,
       case _MPF_STR8:
       case _MPF_STR16:
       case _MPF_STR32:
-         if ((rv = read_buff(fd, (size_t)(1 << (type - _MPF_STR8)), &buff, &tmp_len)) < 0)
+         if ((rv = read_buff(fd, (size_t)(1 << (type - _MPF_STR8)),
+                     &buff, &tmp_len, callbacks, data)) < 0)
             return rv;
 
          if (callbacks->read_string)
@@ -652,7 +670,7 @@ int rmsgpack_read(RFILE *fd,
    }
 
    if (buff)
-      free(buff);
+      free_buff(callbacks, buff);
    return 0;
 
 error:
@@ -37,6 +37,9 @@ struct rmsgpack_read_callbacks
    int (*read_bin        )(void *, uint32_t, void *);
    int (*read_map_start  )(uint32_t, void *);
    int (*read_array_start)(uint32_t, void *);
+   /* Allocates the buffers handed to read_string and read_bin,
+    * which then belong to whoever set it. NULL for malloc(). */
+   void *(*alloc_buff    )(size_t, void *);
 };
 
 int rmsgpack_write_array_header(RFILE *fd, uint32_t size);
@@ -33,12 +33,95 @@
 
 #define MAX_DEPTH 128
 
+/* Most items of a database fit in one */
+#define ARENA_BLOCK_SIZE 4096
+
+struct rmsgpack_dom_arena_block
+{
+   struct rmsgpack_dom_arena_block *next;
+   size_t size;
+   size_t used;
+};
+
+/* Keeps the data of the blocks aligned for 64-bit values */
+#define ARENA_BLOCK_HEADER_SIZE \
+   ((sizeof(struct rmsgpack_dom_arena_block) + 7) & ~(size_t)7)
+
 struct dom_reader_state
 {
 	int i;
 	struct rmsgpack_dom_value *stack[MAX_DEPTH];
+	/* NULL to allocate from the heap */
+	struct rmsgpack_dom_arena *arena;
 };
 
+static void *rmsgpack_dom_arena_alloc(struct rmsgpack_dom_arena *arena,
+      size_t size)
+{
+   struct rmsgpack_dom_arena_block *block = NULL;
+
+   size = (size + 7) & ~(size_t)7;
+
+   for (block = arena->blocks; block; block = block->next)
+      if (block->size - block->used >= size)
+         break;
+
+   if (!block)
+   {
+      size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+
+      if (!(block = (struct rmsgpack_dom_arena_block*)malloc(
+                  ARENA_BLOCK_HEADER_SIZE + block_size)))
+         return NULL;
+
+      block->size   = block_size;
+      block->used   = 0;
+      block->next   = arena->blocks;
+      arena->blocks = block;
+   }
+
+   block->used += size;
+   return (char*)block + ARENA_BLOCK_HEADER_SIZE + block->used - size;
+}
+
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena)
+{
+   struct rmsgpack_dom_arena_block *block;
+
+   for (block = arena->blocks; block; block = block->next)
+      block->used = 0;
+}
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena)
+{
+   while (arena->blocks)
+   {
+      struct rmsgpack_dom_arena_block *next = arena->blocks->next;
+      free(arena->blocks);
+      arena->blocks = next;
+   }
+}
+
+static void *dom_alloc_items(struct dom_reader_state *s, size_t len,
+      size_t size)
+{
+   void *items;
+
+   if (!s->arena)
+      return calloc(len, size);
+
+   if ((items = rmsgpack_dom_arena_alloc(s->arena, len * size)))
+      memset(items, 0, len * size);
+
+   return items;
+}
+
+static void *dom_alloc_buff(size_t size, void *data)
+{
+   struct dom_reader_state *dom_state = (struct dom_reader_state *)data;
+   return rmsgpack_dom_arena_alloc(dom_state->arena, size);
+}
+
 static struct rmsgpack_dom_value *dom_reader_state_pop(struct dom_reader_state *s)
 {
 	struct rmsgpack_dom_value *v = s->stack[s->i];
@@ -132,7 +215,7 @@ static int dom_read_map_start(uint32_t len, void *data)
    v->val.map.len = len;
    v->val.map.items = NULL;
 
-   items = (struct rmsgpack_dom_pair *)calloc(len,
+   items = (struct rmsgpack_dom_pair *)dom_alloc_items(dom_state, len,
          sizeof(struct rmsgpack_dom_pair));
 
    if (!items)
@@ -162,7 +245,8 @@ static int dom_read_array_start(uint32_t len, void *data)
 	v->val.array.len = len;
 	v->val.array.items = NULL;
 
-	items = (struct rmsgpack_dom_value *)calloc(len, sizeof(*items));
+	items = (struct rmsgpack_dom_value *)dom_alloc_items(dom_state, len,
+         sizeof(*items));
 
 	if (!items)
 		return -ENOMEM;
@@ -186,7 +270,20 @@ static struct rmsgpack_read_callbacks dom_reader_callbacks = {
 	dom_read_string,
 	dom_read_bin,
 	dom_read_map_start,
-	dom_read_array_start
+	dom_read_array_start,
+	NULL
+};
+
+static struct rmsgpack_read_callbacks dom_arena_reader_callbacks = {
+	dom_read_nil,
+	dom_read_bool,
+	dom_read_int,
+	dom_read_uint,
+	dom_read_string,
+	dom_read_bin,
+	dom_read_map_start,
+	dom_read_array_start,
+	dom_alloc_buff
 };
 
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v)
@@ -409,6 +506,7 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
 
    s.i        = 0;
    s.stack[0] = out;
+   s.arena    = NULL;
 
    rv = rmsgpack_read(fd, &dom_reader_callbacks, &s);
 
@@ -418,6 +516,24 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+int rmsgpack_dom_read_arena(RFILE *fd, struct rmsgpack_dom_value *out,
+      struct rmsgpack_dom_arena *arena)
+{
+   struct dom_reader_state s;
+   int rv = 0;
+
+   s.i        = 0;
+   s.stack[0] = out;
+   s.arena    = arena;
+
+   /* A failed read leaves nothing to free, but @out may be half
+    * filled in */
+   if ((rv = rmsgpack_read(fd, &dom_arena_reader_callbacks, &s)) < 0)
+      out->type = RDT_NULL;
+
+   return rv;
+}
+
 int rmsgpack_dom_read_into(RFILE *fd, ...)
 {
    va_list ap;
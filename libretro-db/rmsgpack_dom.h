@@ -79,6 +79,17 @@ struct rmsgpack_dom_pair
 	struct rmsgpack_dom_value value;
 };
 
+struct rmsgpack_dom_arena_block;
+
+/* Backs the values read with rmsgpack_dom_read_arena(): their
+ * containers, strings and binaries are carved out of a few
+ * blocks, which are kept for the next value instead of being
+ * freed one by one. Zero it before use. */
+struct rmsgpack_dom_arena
+{
+   struct rmsgpack_dom_arena_block *blocks;
+};
+
 void rmsgpack_dom_value_print(struct rmsgpack_dom_value *obj);
 void rmsgpack_dom_value_free(struct rmsgpack_dom_value *v);
 
@@ -91,6 +102,16 @@ struct rmsgpack_dom_value *rmsgpack_dom_value_map_value(
 
 int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out);
 
+/* Like rmsgpack_dom_read(), but @out lives in @arena until it's
+ * reset or freed; don't rmsgpack_dom_value_free() it. */
+int rmsgpack_dom_read_arena(RFILE *fd, struct rmsgpack_dom_value *out,
+      struct rmsgpack_dom_arena *arena);
+
+/* Drops all the values read into @arena, keeping its memory */
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena);
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena);
+
 int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
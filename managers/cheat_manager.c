@@ -26,6 +26,7 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
+#include <retro_inline.h>
 #include <features/features_cpu.h>
 
 #ifdef HAVE_CONFIG_H
@@ -940,6 +941,139 @@ static void cheat_manager_setup_search_meta(unsigned int bitsize, unsigned int *
    }
 }
 
+/* Rules out the 8 bit items of @m whose values don't pass
+ * @cond, written in terms of cur[j] and prv[j]. Branchless,
+ * so that compilers vectorize it. */
+#define CHEAT_SEARCH_BYTES(cond) \
+   for (j = 0; j < len; j++) \
+   { \
+      uint8_t keep = (cond) ? 0xFF : 0x00; \
+      cleared     += (m[j] & ~keep) ? 1 : 0; \
+      m[j]        &= keep; \
+   }
+
+static unsigned cheat_manager_search_bytes(
+      enum cheat_search_type search_type,
+      const uint8_t *cur, const uint8_t *prv, uint8_t *m, unsigned len)
+{
+   unsigned j;
+   unsigned cleared = 0;
+   unsigned exact   = cheat_manager_state.search_exact_value;
+   unsigned plus    = cheat_manager_state.search_eqplus_value;
+   unsigned minus   = cheat_manager_state.search_eqminus_value;
+
+   switch (search_type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         CHEAT_SEARCH_BYTES(cur[j] == exact);
+         break;
+      case CHEAT_SEARCH_TYPE_LT:
+         CHEAT_SEARCH_BYTES(cur[j] < prv[j]);
+         break;
+      case CHEAT_SEARCH_TYPE_GT:
+         CHEAT_SEARCH_BYTES(cur[j] > prv[j]);
+         break;
+      case CHEAT_SEARCH_TYPE_LTE:
+         CHEAT_SEARCH_BYTES(cur[j] <= prv[j]);
+         break;
+      case CHEAT_SEARCH_TYPE_GTE:
+         CHEAT_SEARCH_BYTES(cur[j] >= prv[j]);
+         break;
+      case CHEAT_SEARCH_TYPE_EQ:
+         CHEAT_SEARCH_BYTES(cur[j] == prv[j]);
+         break;
+      case CHEAT_SEARCH_TYPE_NEQ:
+         CHEAT_SEARCH_BYTES(cur[j] != prv[j]);
+         break;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         CHEAT_SEARCH_BYTES((unsigned)cur[j] == (unsigned)prv[j] + plus);
+         break;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         CHEAT_SEARCH_BYTES((unsigned)cur[j] == (unsigned)prv[j] - minus);
+         break;
+   }
+
+   return cleared;
+}
+
+#undef CHEAT_SEARCH_BYTES
+
+static INLINE unsigned cheat_manager_read_value(const uint8_t *p,
+      unsigned bytes_per_item, bool big_endian)
+{
+   if (bytes_per_item == 2)
+      return big_endian
+         ? (p[0] << 8) | p[1]
+         : p[0] | (p[1] << 8);
+   return big_endian
+      ? ((unsigned)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+      : p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+/* As cheat_manager_search_bytes(), for 16 and 32 bit items */
+static unsigned cheat_manager_search_words(
+      enum cheat_search_type search_type,
+      const uint8_t *cur, const uint8_t *prv, uint8_t *m, unsigned len,
+      unsigned bytes_per_item)
+{
+   unsigned j;
+   unsigned cleared = 0;
+   bool big_endian  = cheat_manager_state.big_endian;
+
+   for (j = 0; j < len; j += bytes_per_item)
+   {
+      unsigned curr_val;
+      unsigned prev_val;
+      bool match = false;
+
+      /* Ruled out already */
+      if (!m[j])
+         continue;
+
+      curr_val = cheat_manager_read_value(cur + j, bytes_per_item, big_endian);
+      prev_val = cheat_manager_read_value(prv + j, bytes_per_item, big_endian);
+
+      switch (search_type)
+      {
+         case CHEAT_SEARCH_TYPE_EXACT:
+            match = (curr_val == cheat_manager_state.search_exact_value);
+            break;
+         case CHEAT_SEARCH_TYPE_LT:
+            match = (curr_val < prev_val);
+            break;
+         case CHEAT_SEARCH_TYPE_GT:
+            match = (curr_val > prev_val);
+            break;
+         case CHEAT_SEARCH_TYPE_LTE:
+            match = (curr_val <= prev_val);
+            break;
+         case CHEAT_SEARCH_TYPE_GTE:
+            match = (curr_val >= prev_val);
+            break;
+         case CHEAT_SEARCH_TYPE_EQ:
+            match = (curr_val == prev_val);
+            break;
+         case CHEAT_SEARCH_TYPE_NEQ:
+            match = (curr_val != prev_val);
+            break;
+         case CHEAT_SEARCH_TYPE_EQPLUS:
+            match = (curr_val == prev_val + cheat_manager_state.search_eqplus_value);
+            break;
+         case CHEAT_SEARCH_TYPE_EQMINUS:
+            match = (curr_val == prev_val - cheat_manager_state.search_eqminus_value);
+            break;
+      }
+
+      if (!match)
+      {
+         memset(m + j, 0, bytes_per_item);
+         cleared++;
+      }
+   }
+
+   return cleared;
+}
+
 static int cheat_manager_search(enum cheat_search_type search_type)
 {
    char msg[100];
@@ -963,92 +1097,133 @@ static int cheat_manager_search(enum cheat_search_type search_type)
 
    cheat_manager_setup_search_meta(cheat_manager_state.search_bit_size, &bytes_per_item, &mask, &bits);
 
-   /* little endian FF000000 = 256 */
-   for (idx = 0; idx < cheat_manager_state.total_memory_size; idx = idx + bytes_per_item)
+   /* Whole bytes and wider: one memory buffer at a time,
+    * rather than looking up the buffer of every item */
+   if (bits == 8)
    {
-      unsigned byte_part;
-
-      offset = translate_address(idx, &curr);
+      unsigned cleared = 0;
 
-      switch (bytes_per_item)
+      for (i = 0; i < cheat_manager_state.num_memory_buffers; i++)
       {
-         case 2:
-            curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            prev_val = cheat_manager_state.big_endian ?
-               (*(prev + idx) * 256) + *(prev + idx + 1) :
-               *(prev + idx) + (*(prev + idx + 1) * 256);
-            break;
-         case 4:
-            curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            prev_val = cheat_manager_state.big_endian ?
-               (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            prev_val = *(prev + idx);
-            break;
+         unsigned start = offset;
+         unsigned end   = offset + cheat_manager_state.memory_size_list[i];
+
+         /* Items are aligned from the start of the whole memory */
+         start = ((start + bytes_per_item - 1) / bytes_per_item) * bytes_per_item;
+         if (end > cheat_manager_state.total_memory_size)
+            end = cheat_manager_state.total_memory_size;
+
+         if (start < end)
+         {
+            const uint8_t *cur = cheat_manager_state.memory_buf_list[i]
+               + (start - offset);
+
+            if (bytes_per_item == 1)
+               cleared += cheat_manager_search_bytes(search_type,
+                     cur, prev + start,
+                     cheat_manager_state.matches + start, end - start);
+            else
+               cleared += cheat_manager_search_words(search_type,
+                     cur, prev + start,
+                     cheat_manager_state.matches + start, end - start,
+                     bytes_per_item);
+         }
+
+         offset += cheat_manager_state.memory_size_list[i];
       }
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+      cheat_manager_state.num_matches = (cleared < cheat_manager_state.num_matches)
+         ? cheat_manager_state.num_matches - cleared : 0;
+   }
+   else
+   {
+      /* little endian FF000000 = 256 */
+      for (idx = 0; idx < cheat_manager_state.total_memory_size; idx = idx + bytes_per_item)
       {
-         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
-         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
-         unsigned int prev_match;
+         unsigned byte_part;
 
-         if (bits < 8)
-            prev_match = *(cheat_manager_state.matches + idx) & (mask << (byte_part * bits));
-         else
-            prev_match = *(cheat_manager_state.matches + idx);
+         offset = translate_address(idx, &curr);
 
-         if (prev_match > 0)
+         switch (bytes_per_item)
          {
-            bool match = false;
-            switch (search_type)
-            {
-               case CHEAT_SEARCH_TYPE_EXACT:
-                  match = (curr_subval == cheat_manager_state.search_exact_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_LT:
-                  match = (curr_subval < prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GT:
-                  match = (curr_subval > prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_LTE:
-                  match = (curr_subval <= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GTE:
-                  match = (curr_subval >= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQ:
-                  match = (curr_subval == prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_NEQ:
-                  match = (curr_subval != prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQPLUS:
-                  match = (curr_subval == prev_subval + cheat_manager_state.search_eqplus_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQMINUS:
-                  match = (curr_subval == prev_subval - cheat_manager_state.search_eqminus_value);
-                  break;
-            }
+            case 2:
+               curr_val = cheat_manager_state.big_endian ?
+                  (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
+                  *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
+               prev_val = cheat_manager_state.big_endian ?
+                  (*(prev + idx) * 256) + *(prev + idx + 1) :
+                  *(prev + idx) + (*(prev + idx + 1) * 256);
+               break;
+            case 4:
+               curr_val = cheat_manager_state.big_endian ?
+                  (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
+                  *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
+               prev_val = cheat_manager_state.big_endian ?
+                  (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
+                  *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
+               break;
+            case 1:
+            default:
+               curr_val = *(curr - offset + idx);
+               prev_val = *(prev + idx);
+               break;
+         }
+
+         for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+         {
+            unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
+            unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
+            unsigned int prev_match;
+
+            if (bits < 8)
+               prev_match = *(cheat_manager_state.matches + idx) & (mask << (byte_part * bits));
+            else
+               prev_match = *(cheat_manager_state.matches + idx);
 
-            if (!match)
+            if (prev_match > 0)
             {
-               if (bits < 8)
-                  *(cheat_manager_state.matches + idx) = *(cheat_manager_state.matches + idx) &
-                     ((~(mask << (byte_part * bits))) & 0xFF);
-               else
-                  memset(cheat_manager_state.matches + idx, 0, bytes_per_item);
-               if (cheat_manager_state.num_matches > 0)
-                  cheat_manager_state.num_matches--;
+               bool match = false;
+               switch (search_type)
+               {
+                  case CHEAT_SEARCH_TYPE_EXACT:
+                     match = (curr_subval == cheat_manager_state.search_exact_value);
+                     break;
+                  case CHEAT_SEARCH_TYPE_LT:
+                     match = (curr_subval < prev_subval);
+                     break;
+                  case CHEAT_SEARCH_TYPE_GT:
+                     match = (curr_subval > prev_subval);
+                     break;
+                  case CHEAT_SEARCH_TYPE_LTE:
+                     match = (curr_subval <= prev_subval);
+                     break;
+                  case CHEAT_SEARCH_TYPE_GTE:
+                     match = (curr_subval >= prev_subval);
+                     break;
+                  case CHEAT_SEARCH_TYPE_EQ:
+                     match = (curr_subval == prev_subval);
+                     break;
+                  case CHEAT_SEARCH_TYPE_NEQ:
+                     match = (curr_subval != prev_subval);
+                     break;
+                  case CHEAT_SEARCH_TYPE_EQPLUS:
+                     match = (curr_subval == prev_subval + cheat_manager_state.search_eqplus_value);
+                     break;
+                  case CHEAT_SEARCH_TYPE_EQMINUS:
+                     match = (curr_subval == prev_subval - cheat_manager_state.search_eqminus_value);
+                     break;
+               }
+
+               if (!match)
+               {
+                  if (bits < 8)
+                     *(cheat_manager_state.matches + idx) = *(cheat_manager_state.matches + idx) &
+                        ((~(mask << (byte_part * bits))) & 0xFF);
+                  else
+                     memset(cheat_manager_state.matches + idx, 0, bytes_per_item);
+                  if (cheat_manager_state.num_matches > 0)
+                     cheat_manager_state.num_matches--;
+               }
             }
          }
       }
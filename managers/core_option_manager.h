@@ -18,6 +18,7 @@
 #define CORE_OPTION_MANAGER_H__
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <boolean.h>
 #include <retro_common_api.h>
@@ -32,6 +33,7 @@ struct core_option
    char *desc;
    char *info;
    char *key;
+   uint32_t key_hash;
    struct string_list *vals;
    struct string_list *val_labels;
    size_t default_index;
@@ -46,6 +48,10 @@ struct core_option_manager
 
    struct core_option *opts;
    size_t size;
+   /* Index of the options by key: open addressing, 1 + the
+    * index of an option per slot, 0 for empty ones */
+   size_t *map;
+   size_t map_size;
    bool updated;
 };
 
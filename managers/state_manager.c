@@ -24,10 +24,13 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <retro_miscellaneous.h>
 #include <compat/strl.h>
 #include <compat/intrinsics.h>
+#include <memmap.h>
 
 #include "state_manager.h"
+#include "state_pool.h"
 #include "../msg_hash.h"
 #include "../core.h"
 #include "../retroarch.h"
@@ -37,10 +40,30 @@
 #include "../network/netplay/netplay.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 /* This makes Valgrind throw errors if a core overflows its savestate size. */
 /* Keep it off unless you're chasing a core bug, it slows things down. */
 #define STRICT_BUF_SIZE 0
 
+/* The worker takes states serialized by the main thread through
+ * a single producer, single consumer queue and does the delta
+ * compression and ring buffer bookkeeping on its own. */
+#if defined(HAVE_THREADS) && !STRICT_BUF_SIZE && (defined(__clang__) || \
+      (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#define HAVE_REWIND_WORKER
+#define REWIND_WORKER_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define REWIND_WORKER_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+/* One state being compressed while the next one gets serialized. */
+#define REWIND_WORKER_SLOTS 2
+#endif
+
+/* The finest level plus up to two coarser ones. */
+#define REWIND_MAX_LEVELS 3
+
 #ifndef UINT16_MAX
 #define UINT16_MAX 0xffff
 #endif
@@ -49,6 +72,10 @@
 #define UINT32_MAX 0xffffffffu
 #endif
 
+#ifndef UINT64_MAX
+#define UINT64_MAX 0xffffffffffffffffull
+#endif
+
 #if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
 #define CPU_X86
 #endif
@@ -60,6 +87,9 @@
 
 #if __SSE2__
 #include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define STATE_MANAGER_NEON
 #endif
 
 /* There's no equivalent in libc, you'd think so ...
@@ -87,6 +117,31 @@ static size_t find_change(const uint16_t *a, const uint16_t *b)
       a128++;
       b128++;
    }
+#elif defined(STATE_MANAGER_NEON)
+   /* NEON loads don't need to be aligned. Like the SSE2
+    * path, this relies on the terminator that
+    * state_manager_raw_alloc puts at the end. */
+   const uint16_t *a_org = a;
+
+   for (;;)
+   {
+      uint16x8_t c  = vceqq_u16(vld1q_u16(a), vld1q_u16(b));
+      uint64x2_t c2 = vreinterpretq_u64_u16(c);
+
+      if ((vgetq_lane_u64(c2, 0) & vgetq_lane_u64(c2, 1)) != UINT64_MAX)
+         break;
+
+      a += 8;
+      b += 8;
+   }
+
+   while (*a == *b)
+   {
+      a++;
+      b++;
+   }
+
+   return a - a_org;
 #else
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -122,6 +177,35 @@ static size_t find_change(const uint16_t *a, const uint16_t *b)
 static size_t find_same(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
+#if defined(STATE_MANAGER_NEON)
+   /* Same as the scalar loop below as built for x86, which
+    * compares pairs of words regardless of alignment. */
+   for (;;)
+   {
+      uint32x4_t c  = vceqq_u32(
+            vreinterpretq_u32_u16(vld1q_u16(a)),
+            vreinterpretq_u32_u16(vld1q_u16(b)));
+      uint64x2_t c2 = vreinterpretq_u64_u32(c);
+
+      if (vgetq_lane_u64(c2, 0) | vgetq_lane_u64(c2, 1))
+         break;
+
+      a += 8;
+      b += 8;
+   }
+
+   while (a[0] != b[0] || a[1] != b[1])
+   {
+      a += 2;
+      b += 2;
+   }
+
+   if (a != a_org && a[-1] == b[-1])
+   {
+      a--;
+      b--;
+   }
+#else
 #ifdef NO_UNALIGNED_MEM
    if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
    {
@@ -156,6 +240,7 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
          b--;
       }
    }
+#endif
    return a - a_org;
 }
 
@@ -207,11 +292,54 @@ repeat {
 size thisstart;
 #endif
 
+#ifdef HAVE_REWIND_WORKER
+typedef struct state_manager_worker
+{
+   uint8_t *slots[REWIND_WORKER_SLOTS];
+   int64_t indices[REWIND_WORKER_SLOTS];
+   /* Free-running slot counters, each written by one side only. */
+   unsigned read;
+   unsigned write;
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool quit;
+} state_manager_worker_t;
+#endif
+
+/* Rewind history is kept at several resolutions. Every pushed
+ * state goes to the finest level, every stride-th one also to
+ * the next level and so on, each level with its own share of
+ * the buffer. Once the finest level runs out, rewinding goes
+ * on through the coarser ones, a whole stride per pop.
+ *
+ * A level is a delta chain running backwards from its newest
+ * state, so its oldest entries can be dropped at any time and
+ * there is never a chain to replay to reach the next state. */
+typedef struct state_manager_level
+{
+   state_manager_t *state;
+   /* Push count of the state the next pop would return. */
+   int64_t index;
+   int64_t stride;
+} state_manager_level_t;
+
 struct state_manager_rewind_state
 {
    /* Rewind support. */
    state_manager_t *state;
    size_t size;
+   /* Push count of the current state. */
+   int64_t index;
+   /* The finest level is 'state', with this as its index. */
+   int64_t state_index;
+   /* The state a failing pop leaves to return to. */
+   const void *oldest;
+   state_manager_level_t levels[REWIND_MAX_LEVELS - 1];
+   unsigned num_levels;
+#ifdef HAVE_REWIND_WORKER
+   state_manager_worker_t worker;
+#endif
 };
 
 static struct state_manager_rewind_state rewind_state;
@@ -233,12 +361,20 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
 
 /*
  * See state_manager_raw_compress for information about this.
- * When you're done with it, send it to free().
+ * When you're done with it, send it to state_pool_put().
  */
 static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
    size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
+   uint16_t *ret = (uint16_t*)state_pool_get_tagged(
+         len16 + sizeof(uint16_t) * 4 + 16, MEMORY_USAGE_REWIND);
+
+   if (!ret)
+      return NULL;
+
+   /* Only the padding needs to be cleared, the state
+    * gets written over before it is used. */
+   memset((uint8_t*)ret + len, 0, len16 - len + sizeof(uint16_t) * 4 + 16);
 
    /* Force in a different byte at the end, so we don't need to check
     * bounds in the innermost loop (it's expensive).
@@ -256,6 +392,18 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
    return ret;
 }
 
+#ifdef HAVE_REWIND_WORKER
+/* Sets the terminator of a block from state_manager_raw_alloc.
+ * Blocks passing through the worker swap places arbitrarily,
+ * so their terminators have to be set again before compressing. */
+static INLINE void state_manager_raw_set_uniq(void *block,
+      size_t len, uint16_t uniq)
+{
+   size_t len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   ((uint16_t*)block)[len16/sizeof(uint16_t) + 3] = uniq;
+}
+#endif
+
 /*
  * Takes two savestates and creates a patch that turns 'src' into 'dst'.
  * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
@@ -414,11 +562,14 @@ static void state_manager_free(state_manager_t *state)
       return;
 
    if (state->data)
-      free(state->data);
+   {
+      memmap_free_hot(state->data, state->capacity);
+      memory_usage_add(MEMORY_USAGE_REWIND, -(int64_t)state->capacity);
+   }
    if (state->thisblock)
-      free(state->thisblock);
+      state_pool_put(state->thisblock);
    if (state->nextblock)
-      free(state->nextblock);
+      state_pool_put(state->nextblock);
 #if STRICT_BUF_SIZE
    if (state->debugblock)
       free(state->debugblock);
@@ -444,11 +595,13 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 
    /* the compressed data is surrounded by pointers to the other side */
    max_comp_size      = state_manager_raw_maxsize(state_size) + sizeof(size_t) * 2;
-   state_data         = (uint8_t*)malloc(buffer_size);
+   state_data         = (uint8_t*)memmap_alloc_hot(buffer_size);
 
    if (!state_data)
       goto error;
 
+   memory_usage_add(MEMORY_USAGE_REWIND, (int64_t)buffer_size);
+
    this_block         = (uint8_t*)state_manager_raw_alloc(state_size, 0);
    next_block         = (uint8_t*)state_manager_raw_alloc(state_size, 1);
 
@@ -474,7 +627,10 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 
 error:
    if (state_data)
-      free(state_data);
+   {
+      memmap_free_hot(state_data, buffer_size);
+      memory_usage_add(MEMORY_USAGE_REWIND, -(int64_t)buffer_size);
+   }
    state_manager_free(state);
    free(state);
 
@@ -612,11 +768,242 @@ static void state_manager_capacity(state_manager_t *state,
 }
 #endif
 
-void state_manager_event_init(unsigned rewind_buffer_size)
+/* Adds a state pushed to the finest level to the
+ * coarser levels it belongs to. */
+static void state_manager_push_levels(const void *data, int64_t index)
+{
+   unsigned i;
+
+   for (i = 0; i < rewind_state.num_levels; i++)
+   {
+      void *dst                    = NULL;
+      const void *ignored          = NULL;
+      state_manager_level_t *level = &rewind_state.levels[i];
+
+      if (index % level->stride)
+         break;
+
+      /* Drop the states that were rewound past. */
+      while (level->index >= index
+            && state_manager_pop(level->state, &ignored))
+         level->index -= level->stride;
+
+      state_manager_push_where(level->state, &dst);
+      memcpy(dst, data, rewind_state.size);
+      state_manager_push_do(level->state);
+
+      level->index = index;
+   }
+}
+
+/* Pops the newest state older than the current one,
+ * from the finest level that still has one. */
+static bool state_manager_pop_levels(const void **data)
+{
+   unsigned i;
+
+   if (state_manager_pop(rewind_state.state, data))
+   {
+      rewind_state.index  = rewind_state.state_index--;
+      rewind_state.oldest = *data;
+      return true;
+   }
+
+   /* Movies are rewound a frame per pop. */
+   if (rarch_ctl(RARCH_CTL_BSV_MOVIE_IS_INITED, NULL))
+      return false;
+
+   for (i = 0; i < rewind_state.num_levels; i++)
+   {
+      const void *buf              = NULL;
+      state_manager_level_t *level = &rewind_state.levels[i];
+
+      /* The finer levels already went through these. */
+      while (level->index >= rewind_state.index
+            && state_manager_pop(level->state, &buf))
+         level->index -= level->stride;
+
+      if (level->index < rewind_state.index
+            && state_manager_pop(level->state, &buf))
+      {
+         *data               = buf;
+         rewind_state.index  = level->index;
+         rewind_state.oldest = buf;
+         level->index       -= level->stride;
+         return true;
+      }
+   }
+
+   if (rewind_state.oldest)
+      *data = rewind_state.oldest;
+   return false;
+}
+
+#ifdef HAVE_REWIND_WORKER
+static void state_manager_worker_thread(void *data)
+{
+   state_manager_worker_t *worker = (state_manager_worker_t*)data;
+
+   for (;;)
+   {
+      void *ignored;
+      uint8_t *swap;
+      const uint8_t *pushed;
+      unsigned idx;
+      state_manager_t *state = rewind_state.state;
+      unsigned read          = worker->read;
+
+      if (REWIND_WORKER_ATOMIC_LOAD(&worker->write) == read)
+      {
+         bool quit;
+
+         slock_lock(worker->lock);
+         while (!worker->quit
+               && REWIND_WORKER_ATOMIC_LOAD(&worker->write) == read)
+            scond_wait(worker->cond, worker->lock);
+         quit = worker->quit;
+         slock_unlock(worker->lock);
+
+         if (quit)
+            break;
+      }
+
+      /* Ensures an uncompressed copy of the previous state,
+       * then takes the queued state in place of nextblock. */
+      idx                = read & (REWIND_WORKER_SLOTS - 1);
+      state_manager_push_where(state, &ignored);
+
+      swap               = state->nextblock;
+      state->nextblock   = worker->slots[idx];
+      worker->slots[idx] = swap;
+
+      state_manager_raw_set_uniq(state->thisblock, state->blocksize, 0);
+      state_manager_raw_set_uniq(state->nextblock, state->blocksize, 1);
+
+      pushed             = state->nextblock;
+      state_manager_push_do(state);
+      rewind_state.state_index = worker->indices[idx];
+      state_manager_push_levels(pushed, worker->indices[idx]);
+
+      REWIND_WORKER_ATOMIC_STORE(&worker->read, read + 1);
+
+      slock_lock(worker->lock);
+      scond_signal(worker->cond);
+      slock_unlock(worker->lock);
+   }
+}
+
+static void state_manager_worker_deinit(void)
+{
+   unsigned i;
+   state_manager_worker_t *worker = &rewind_state.worker;
+
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      worker->quit = true;
+      scond_signal(worker->cond);
+      slock_unlock(worker->lock);
+
+      sthread_join(worker->thread);
+   }
+
+   if (worker->cond)
+      scond_free(worker->cond);
+   if (worker->lock)
+      slock_free(worker->lock);
+
+   for (i = 0; i < REWIND_WORKER_SLOTS; i++)
+      state_pool_put(worker->slots[i]);
+
+   memset(worker, 0, sizeof(*worker));
+}
+
+static bool state_manager_worker_init(void)
+{
+   unsigned i;
+   state_manager_worker_t *worker = &rewind_state.worker;
+
+   for (i = 0; i < REWIND_WORKER_SLOTS; i++)
+   {
+      worker->slots[i] = (uint8_t*)state_manager_raw_alloc(
+            rewind_state.size, 1);
+      if (!worker->slots[i])
+         goto error;
+   }
+
+   worker->lock   = slock_new();
+   worker->cond   = scond_new();
+   if (!worker->lock || !worker->cond)
+      goto error;
+
+   worker->thread = sthread_create(state_manager_worker_thread, worker);
+   if (!worker->thread)
+      goto error;
+
+   RARCH_LOG("[Rewind]: Compressing states on a worker thread.\n");
+   return true;
+
+error:
+   RARCH_WARN("[Rewind]: Failed to start the worker thread.\n");
+   state_manager_worker_deinit();
+   return false;
+}
+
+/* Waits until the worker has pushed every queued state. */
+static void state_manager_worker_sync(void)
+{
+   state_manager_worker_t *worker = &rewind_state.worker;
+
+   if (!worker->thread)
+      return;
+
+   slock_lock(worker->lock);
+   while (REWIND_WORKER_ATOMIC_LOAD(&worker->read) != worker->write)
+      scond_wait(worker->cond, worker->lock);
+   slock_unlock(worker->lock);
+}
+
+/* Serializes the core into a free slot and queues it. */
+static void state_manager_worker_push(void)
 {
+   retro_ctx_serialize_info_t serial_info;
+   state_manager_worker_t *worker = &rewind_state.worker;
+   unsigned write                 = worker->write;
+
+   if (write - REWIND_WORKER_ATOMIC_LOAD(&worker->read)
+         == REWIND_WORKER_SLOTS)
+   {
+      slock_lock(worker->lock);
+      while (write - REWIND_WORKER_ATOMIC_LOAD(&worker->read)
+            == REWIND_WORKER_SLOTS)
+         scond_wait(worker->cond, worker->lock);
+      slock_unlock(worker->lock);
+   }
+
+   serial_info.data = worker->slots[write & (REWIND_WORKER_SLOTS - 1)];
+   serial_info.size = rewind_state.size;
+
+   core_serialize(&serial_info);
+   worker->indices[write & (REWIND_WORKER_SLOTS - 1)] = ++rewind_state.index;
+   rewind_state.oldest = NULL;
+
+   REWIND_WORKER_ATOMIC_STORE(&worker->write, write + 1);
+
+   slock_lock(worker->lock);
+   scond_signal(worker->cond);
+   slock_unlock(worker->lock);
+}
+#endif
+
+void state_manager_event_init(unsigned rewind_buffer_size, bool threaded,
+      unsigned levels, unsigned level_stride)
+{
+   unsigned i;
    retro_ctx_serialize_info_t serial_info;
    retro_ctx_size_info_t info;
    void *state          = NULL;
+   int64_t stride       = 1;
 
    if (rewind_state.state)
       return;
@@ -642,6 +1029,34 @@ void state_manager_event_init(unsigned rewind_buffer_size)
          msg_hash_to_str(MSG_REWIND_INIT),
          (unsigned)(rewind_buffer_size / 1000000));
 
+   if (level_stride < 2)
+      levels              = 1;
+   levels                 = MAX(1, MIN(levels, REWIND_MAX_LEVELS));
+   rewind_buffer_size    /= levels;
+
+   rewind_state.index       = 0;
+   rewind_state.state_index = 0;
+   rewind_state.oldest      = NULL;
+   rewind_state.num_levels  = 0;
+
+   for (i = 0; i < levels - 1; i++)
+   {
+      state_manager_level_t *level = &rewind_state.levels[i];
+
+      stride       *= level_stride;
+      level->state  = state_manager_new(rewind_state.size,
+            rewind_buffer_size);
+      level->index  = -stride;
+      level->stride = stride;
+
+      if (!level->state)
+         break;
+
+      RARCH_LOG("[Rewind]: Level %u keeps every %u states.\n",
+            i + 2, (unsigned)stride);
+      rewind_state.num_levels++;
+   }
+
    rewind_state.state = state_manager_new(rewind_state.size,
          rewind_buffer_size);
 
@@ -656,6 +1071,12 @@ void state_manager_event_init(unsigned rewind_buffer_size)
    core_serialize(&serial_info);
 
    state_manager_push_do(rewind_state.state);
+   state_manager_push_levels(state, 0);
+
+#ifdef HAVE_REWIND_WORKER
+   if (threaded && rewind_state.state)
+      state_manager_worker_init();
+#endif
 }
 
 bool state_manager_frame_is_reversed(void)
@@ -665,13 +1086,27 @@ bool state_manager_frame_is_reversed(void)
 
 void state_manager_event_deinit(void)
 {
+   unsigned i;
+
+#ifdef HAVE_REWIND_WORKER
+   state_manager_worker_deinit();
+#endif
+
+   for (i = 0; i < rewind_state.num_levels; i++)
+   {
+      state_manager_free(rewind_state.levels[i].state);
+      free(rewind_state.levels[i].state);
+   }
+   rewind_state.num_levels = 0;
+
    if (rewind_state.state)
    {
       state_manager_free(rewind_state.state);
       free(rewind_state.state);
    }
-   rewind_state.state = NULL;
-   rewind_state.size  = 0;
+   rewind_state.state  = NULL;
+   rewind_state.size   = 0;
+   rewind_state.oldest = NULL;
 }
 
 /**
@@ -712,7 +1147,11 @@ bool state_manager_check_rewind(bool pressed,
    {
       const void *buf    = NULL;
 
-      if (state_manager_pop(rewind_state.state, &buf))
+#ifdef HAVE_REWIND_WORKER
+      state_manager_worker_sync();
+#endif
+
+      if (state_manager_pop_levels(&buf))
       {
          retro_ctx_serialize_info_t serial_info;
 
@@ -774,17 +1213,27 @@ bool state_manager_check_rewind(bool pressed,
 
       if ((cnt == 0) || rarch_ctl(RARCH_CTL_BSV_MOVIE_IS_INITED, NULL))
       {
-         retro_ctx_serialize_info_t serial_info;
-         void *state = NULL;
+#ifdef HAVE_REWIND_WORKER
+         if (rewind_state.worker.thread)
+            state_manager_worker_push();
+         else
+#endif
+         {
+            retro_ctx_serialize_info_t serial_info;
+            void *state = NULL;
 
-         state_manager_push_where(rewind_state.state, &state);
+            state_manager_push_where(rewind_state.state, &state);
 
-         serial_info.data = state;
-         serial_info.size = rewind_state.size;
+            serial_info.data = state;
+            serial_info.size = rewind_state.size;
 
-         core_serialize(&serial_info);
+            core_serialize(&serial_info);
 
-         state_manager_push_do(rewind_state.state);
+            state_manager_push_do(rewind_state.state);
+            rewind_state.state_index = ++rewind_state.index;
+            rewind_state.oldest      = NULL;
+            state_manager_push_levels(state, rewind_state.index);
+         }
       }
    }
 
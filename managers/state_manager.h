@@ -32,7 +32,12 @@ bool state_manager_frame_is_reversed(void);
 
 void state_manager_event_deinit(void);
 
-void state_manager_event_init(unsigned rewind_buffer_size);
+/* With threaded set, states get compressed on a worker
+ * thread if threads are supported. With levels above one,
+ * the buffer is split into levels, each keeping every
+ * level_stride-th state of the previous one. */
+void state_manager_event_init(unsigned rewind_buffer_size, bool threaded,
+      unsigned levels, unsigned level_stride);
 
 /**
  * check_rewind:
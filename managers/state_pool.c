@@ -0,0 +1,249 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#include <memmap.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "state_pool.h"
+#include "../verbosity.h"
+
+#define STATE_POOL_MAX_BUFFERS   32
+/* Idle buffers kept for reuse, the rest are released. */
+#define STATE_POOL_MAX_IDLE      4
+#define STATE_POOL_PAGE_SIZE     4096
+/* Room for the padding rewind puts after a state. */
+#define STATE_POOL_SLACK         64
+
+typedef struct state_pool_buffer
+{
+   void *data;
+   size_t capacity;
+   enum memory_usage_tag tag;
+   bool in_use;
+} state_pool_buffer_t;
+
+typedef struct state_pool
+{
+   state_pool_buffer_t buffers[STATE_POOL_MAX_BUFFERS];
+   size_t capacity;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} state_pool_t;
+
+static state_pool_t state_pool;
+
+#ifdef HAVE_THREADS
+#define state_pool_lock() \
+   if (state_pool.lock) \
+      slock_lock(state_pool.lock)
+#define state_pool_unlock() \
+   if (state_pool.lock) \
+      slock_unlock(state_pool.lock)
+#else
+#define state_pool_lock()
+#define state_pool_unlock()
+#endif
+
+static size_t state_pool_capacity(size_t size)
+{
+   return (size + STATE_POOL_SLACK + STATE_POOL_PAGE_SIZE - 1)
+      & ~((size_t)STATE_POOL_PAGE_SIZE - 1);
+}
+
+/* Mapped as hot memory, which goes straight back to the system
+ * when released instead of fragmenting the heap. */
+static void state_pool_release(state_pool_buffer_t *buffer)
+{
+   memory_usage_add(MEMORY_USAGE_STATES, -(int64_t)buffer->capacity);
+   memmap_free_hot(buffer->data, buffer->capacity);
+   buffer->data     = NULL;
+   buffer->capacity = 0;
+   buffer->in_use   = false;
+}
+
+/* Finds an idle buffer of at least size bytes, or allocates
+ * one into a free entry. Must be called with the lock held. */
+static state_pool_buffer_t *state_pool_acquire(size_t size)
+{
+   unsigned i;
+   size_t capacity            = 0;
+   state_pool_buffer_t *entry = NULL;
+
+   for (i = 0; i < STATE_POOL_MAX_BUFFERS; i++)
+   {
+      state_pool_buffer_t *buffer = &state_pool.buffers[i];
+
+      if (!buffer->data)
+      {
+         if (!entry)
+            entry = buffer;
+         continue;
+      }
+
+      if (!buffer->in_use && buffer->capacity >= size + STATE_POOL_SLACK)
+      {
+         buffer->in_use = true;
+         return buffer;
+      }
+   }
+
+   if (!entry)
+      return NULL;
+
+   /* Size new buffers for the core, so others can use them too. */
+   capacity = state_pool_capacity(
+         size > state_pool.capacity ? size : state_pool.capacity);
+
+   entry->data = memmap_alloc_hot(capacity);
+   if (!entry->data)
+      return NULL;
+
+   memory_usage_add(MEMORY_USAGE_STATES, (int64_t)capacity);
+
+   entry->capacity = capacity;
+   entry->tag      = MEMORY_USAGE_STATES;
+   entry->in_use   = true;
+   return entry;
+}
+
+void state_pool_set_size(size_t size)
+{
+   unsigned i;
+   state_pool_buffer_t *buffer = NULL;
+
+#ifdef HAVE_THREADS
+   /* Only the main thread sets the size, and nothing uses the
+    * pool from other threads before content is loaded. */
+   if (!state_pool.lock)
+      state_pool.lock = slock_new();
+#endif
+
+   state_pool_lock();
+
+   state_pool.capacity = size;
+
+   for (i = 0; i < STATE_POOL_MAX_BUFFERS; i++)
+   {
+      buffer = &state_pool.buffers[i];
+      if (buffer->data && !buffer->in_use &&
+            (!size || buffer->capacity != state_pool_capacity(size)))
+         state_pool_release(buffer);
+   }
+
+   if (size)
+   {
+      buffer = state_pool_acquire(size);
+      if (buffer)
+         buffer->in_use = false;
+      else
+         RARCH_WARN("[State Pool]: Failed to preallocate a %u byte buffer.\n",
+               (unsigned)size);
+   }
+
+   state_pool_unlock();
+}
+
+void state_pool_deinit(void)
+{
+   state_pool_set_size(0);
+
+#ifdef HAVE_THREADS
+   if (state_pool.lock)
+      slock_free(state_pool.lock);
+   state_pool.lock = NULL;
+#endif
+}
+
+void *state_pool_get(size_t size)
+{
+   return state_pool_get_tagged(size, MEMORY_USAGE_STATES);
+}
+
+void *state_pool_get_tagged(size_t size, enum memory_usage_tag tag)
+{
+   state_pool_buffer_t *buffer = NULL;
+
+   if (!size)
+      return NULL;
+
+   state_pool_lock();
+   buffer = state_pool_acquire(size);
+   if (buffer)
+   {
+      buffer->tag = tag;
+      memory_usage_add(MEMORY_USAGE_STATES, -(int64_t)buffer->capacity);
+      memory_usage_add(tag, (int64_t)buffer->capacity);
+   }
+   state_pool_unlock();
+
+   if (buffer)
+      return buffer->data;
+
+   /* Out of entries, state_pool_put will free() this. */
+   return malloc(size);
+}
+
+void state_pool_put(void *data)
+{
+   unsigned i;
+   unsigned idle = 0;
+   state_pool_buffer_t *entry = NULL;
+
+   if (!data)
+      return;
+
+   state_pool_lock();
+
+   for (i = 0; i < STATE_POOL_MAX_BUFFERS; i++)
+   {
+      state_pool_buffer_t *buffer = &state_pool.buffers[i];
+
+      if (buffer->data == data)
+         entry = buffer;
+      else if (buffer->data && !buffer->in_use)
+         idle++;
+   }
+
+   if (entry)
+   {
+      entry->in_use = false;
+      memory_usage_add(entry->tag, -(int64_t)entry->capacity);
+      memory_usage_add(MEMORY_USAGE_STATES, (int64_t)entry->capacity);
+      entry->tag    = MEMORY_USAGE_STATES;
+
+      /* Drop buffers of a previous core, and extra ones
+       * once enough are waiting. */
+      if (     idle >= STATE_POOL_MAX_IDLE
+            || !state_pool.capacity
+            || entry->capacity != state_pool_capacity(state_pool.capacity))
+         state_pool_release(entry);
+   }
+
+   state_pool_unlock();
+
+   if (!entry)
+      free(data);
+}
@@ -0,0 +1,57 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STATE_POOL_H
+#define __STATE_POOL_H
+
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include "../memory_usage.h"
+
+RETRO_BEGIN_DECLS
+
+/* Page aligned savestate sized buffers shared by run-ahead,
+ * rewind, netplay and the save tasks. Buffers handed back
+ * are kept around for the next user instead of being freed,
+ * so the same few blocks get reused for as long as the core
+ * is loaded. Safe to use from any thread. */
+
+/* Sets the savestate size of the loaded core, preallocating
+ * a buffer for it. Idle buffers that no longer fit are
+ * released, a size of 0 releases all of them. */
+void state_pool_set_size(size_t size);
+
+/* Releases every idle buffer. */
+void state_pool_deinit(void);
+
+/* Returns a buffer of at least size bytes. Its contents are
+ * undefined. */
+void *state_pool_get(size_t size);
+
+/* Same, with the buffer counted against @tag until it's handed
+ * back. Idle buffers and those of state_pool_get() count as
+ * MEMORY_USAGE_STATES. */
+void *state_pool_get_tagged(size_t size, enum memory_usage_tag tag);
+
+/* Hands a buffer back. Buffers that did not come from the pool
+ * are passed to free(), so this can replace it where ownership
+ * is mixed. */
+void state_pool_put(void *data);
+
+RETRO_END_DECLS
+
+#endif
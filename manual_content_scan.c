@@ -1072,54 +1072,56 @@ static bool manual_content_scan_get_playlist_content_label(
    return true;
 }
 
-/* Adds specified content to playlist, if not already
- * present */
-void manual_content_scan_add_content_to_playlist(
+/* Gets the playlist path and label of specified content.
+ * Only reads the content and the DAT file, so it can be
+ * called for several files at once from other threads.
+ * Returns false if specified content is invalid. */
+bool manual_content_scan_get_playlist_entry(
       manual_content_scan_task_config_t *task_config,
-      playlist_t *playlist, const char *content_path,
-      int content_type, logiqx_dat_t *dat_file,
-      bool fuzzy_archive_match)
+      const char *content_path, int content_type,
+      logiqx_dat_t *dat_file,
+      char *playlist_content_path, size_t path_len,
+      char *label, size_t label_len)
 {
-   char playlist_content_path[PATH_MAX_LENGTH];
-
-   playlist_content_path[0] = '\0';
-
-   /* Sanity check */
-   if (!task_config || !playlist)
-      return;
-
    /* Get 'actual' content path */
    if (!manual_content_scan_get_playlist_content_path(
          task_config, content_path, content_type,
-         playlist_content_path, sizeof(playlist_content_path)))
+         playlist_content_path, path_len))
+      return false;
+
+   /* Get entry label */
+   return manual_content_scan_get_playlist_content_label(
+         playlist_content_path, dat_file, label, label_len);
+}
+
+/* Adds content got from manual_content_scan_get_playlist_entry()
+ * to playlist, if not already present */
+void manual_content_scan_push_playlist_entry(
+      manual_content_scan_task_config_t *task_config,
+      playlist_t *playlist, const char *playlist_content_path,
+      const char *label, bool fuzzy_archive_match)
+{
+   struct playlist_entry entry = {0};
+
+   /* Sanity check */
+   if (!task_config || !playlist || string_is_empty(playlist_content_path))
       return;
 
    /* Check whether content is already included
     * in playlist */
-   if (!playlist_entry_exists(playlist, playlist_content_path, fuzzy_archive_match))
-   {
-      struct playlist_entry entry = {0};
-      char label[PATH_MAX_LENGTH];
-
-      label[0] = '\0';
-
-      /* Get entry label */
-      if (!manual_content_scan_get_playlist_content_label(
-            playlist_content_path, dat_file,
-            label, sizeof(label)))
-         return;
-
-      /* Configure playlist entry
-       * > The push function reads our entry as const,
-       *   so these casts are safe */
-      entry.path      = (char*)playlist_content_path;
-      entry.label     = label;
-      entry.core_path = (char*)"DETECT";
-      entry.core_name = (char*)"DETECT";
-      entry.crc32     = (char*)"00000000|crc";
-      entry.db_name   = task_config->database_name;
-
-      /* Add entry to playlist */
-      playlist_push(playlist, &entry, fuzzy_archive_match);
-   }
+   if (playlist_entry_exists(playlist, playlist_content_path, fuzzy_archive_match))
+      return;
+
+   /* Configure playlist entry
+    * > The push function reads our entry as const,
+    *   so these casts are safe */
+   entry.path      = (char*)playlist_content_path;
+   entry.label     = (char*)label;
+   entry.core_path = (char*)"DETECT";
+   entry.core_name = (char*)"DETECT";
+   entry.crc32     = (char*)"00000000|crc";
+   entry.db_name   = task_config->database_name;
+
+   /* Add entry to playlist */
+   playlist_push(playlist, &entry, fuzzy_archive_match);
 }
@@ -223,13 +223,23 @@ bool manual_content_scan_get_task_config(
  * > Returned string list must be free()'d */
 struct string_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config);
 
-/* Adds specified content to playlist, if not already
- * present */
-void manual_content_scan_add_content_to_playlist(
+/* Gets the playlist path and label of specified content.
+ * Only reads the content and the DAT file, so it can be
+ * called for several files at once from other threads.
+ * Returns false if specified content is invalid. */
+bool manual_content_scan_get_playlist_entry(
       manual_content_scan_task_config_t *task_config,
-      playlist_t *playlist, const char *content_path,
-      int content_type, logiqx_dat_t *dat_file,
-      bool fuzzy_archive_match);
+      const char *content_path, int content_type,
+      logiqx_dat_t *dat_file,
+      char *playlist_content_path, size_t path_len,
+      char *label, size_t label_len);
+
+/* Adds content got from manual_content_scan_get_playlist_entry()
+ * to playlist, if not already present */
+void manual_content_scan_push_playlist_entry(
+      manual_content_scan_task_config_t *task_config,
+      playlist_t *playlist, const char *playlist_content_path,
+      const char *label, bool fuzzy_archive_match);
 
 RETRO_END_DECLS
 
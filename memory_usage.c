@@ -0,0 +1,168 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "memory_usage.h"
+
+/* Keeps heap buffers aligned for SIMD */
+#define MEMORY_USAGE_HEADER 16
+
+/* Counters are size_t, which holds any amount of memory
+ * the process can have */
+#if defined(__GNUC__) || defined(__clang__)
+#define MEMORY_USAGE_ATOMIC_ADD(ptr, val) __sync_fetch_and_add(ptr, val)
+#define MEMORY_USAGE_ATOMIC_SUB(ptr, val) __sync_fetch_and_sub(ptr, val)
+#else
+#define MEMORY_USAGE_ATOMIC_ADD(ptr, val) (*(ptr) += (val))
+#define MEMORY_USAGE_ATOMIC_SUB(ptr, val) (*(ptr) -= (val))
+#endif
+
+static size_t memory_usage_bytes[MEMORY_USAGE_TAG_LAST];
+
+static void *memory_usage_track(enum memory_usage_tag tag,
+      uint8_t *block, size_t size)
+{
+   if (!block)
+      return NULL;
+
+   *(size_t*)block = size;
+   MEMORY_USAGE_ATOMIC_ADD(&memory_usage_bytes[tag], size);
+
+   return block + MEMORY_USAGE_HEADER;
+}
+
+void *memory_usage_malloc(enum memory_usage_tag tag, size_t size)
+{
+   return memory_usage_track(tag,
+         (uint8_t*)malloc(size + MEMORY_USAGE_HEADER), size);
+}
+
+void *memory_usage_calloc(enum memory_usage_tag tag,
+      size_t nmemb, size_t size)
+{
+   if (size && nmemb > ((size_t)-1 - MEMORY_USAGE_HEADER) / size)
+      return NULL;
+
+   return memory_usage_track(tag,
+         (uint8_t*)calloc(1, nmemb * size + MEMORY_USAGE_HEADER),
+         nmemb * size);
+}
+
+void *memory_usage_realloc(enum memory_usage_tag tag,
+      void *ptr, size_t size)
+{
+   uint8_t *block = NULL;
+   size_t old     = 0;
+
+   if (!ptr)
+      return memory_usage_malloc(tag, size);
+
+   block = (uint8_t*)ptr - MEMORY_USAGE_HEADER;
+   old   = *(size_t*)block;
+
+   /* The old block is kept on failure, and still counted */
+   if (!(block = (uint8_t*)realloc(block, size + MEMORY_USAGE_HEADER)))
+      return NULL;
+
+   MEMORY_USAGE_ATOMIC_SUB(&memory_usage_bytes[tag], old);
+
+   return memory_usage_track(tag, block, size);
+}
+
+void memory_usage_free(enum memory_usage_tag tag, void *ptr)
+{
+   uint8_t *block = NULL;
+
+   if (!ptr)
+      return;
+
+   block = (uint8_t*)ptr - MEMORY_USAGE_HEADER;
+   MEMORY_USAGE_ATOMIC_SUB(&memory_usage_bytes[tag], *(size_t*)block);
+   free(block);
+}
+
+void memory_usage_add(enum memory_usage_tag tag, int64_t bytes)
+{
+   if (bytes >= 0)
+      MEMORY_USAGE_ATOMIC_ADD(&memory_usage_bytes[tag], (size_t)bytes);
+   else
+      MEMORY_USAGE_ATOMIC_SUB(&memory_usage_bytes[tag], (size_t)-bytes);
+}
+
+void memory_usage_set(enum memory_usage_tag tag, uint64_t bytes)
+{
+   memory_usage_bytes[tag] = (size_t)bytes;
+}
+
+uint64_t memory_usage_get(enum memory_usage_tag tag)
+{
+   return memory_usage_bytes[tag];
+}
+
+const char *memory_usage_tag_name(enum memory_usage_tag tag)
+{
+   switch (tag)
+   {
+      case MEMORY_USAGE_REWIND:
+         return "Rewind";
+      case MEMORY_USAGE_RUNAHEAD:
+         return "Run-Ahead";
+      case MEMORY_USAGE_NETPLAY:
+         return "Netplay";
+      case MEMORY_USAGE_STATES:
+         return "Savestates";
+      case MEMORY_USAGE_IMAGES:
+         return "Images";
+      case MEMORY_USAGE_PLAYLISTS:
+         return "Playlists";
+      case MEMORY_USAGE_AUDIO:
+         return "Audio";
+      case MEMORY_USAGE_SHADERS:
+         return "Shaders";
+      case MEMORY_USAGE_CORE:
+         return "Core";
+      default:
+         break;
+   }
+
+   return "N/A";
+}
+
+size_t memory_usage_print(char *s, size_t len, const char *sep)
+{
+   unsigned i;
+   size_t pos = 0;
+
+   for (i = 0; i < MEMORY_USAGE_TAG_LAST && pos < len; i++)
+   {
+      int n = snprintf(s + pos, len - pos, "%s%s=%llu",
+            i ? sep : "",
+            memory_usage_tag_name((enum memory_usage_tag)i),
+            (unsigned long long)memory_usage_bytes[i]);
+
+      if (n < 0)
+         break;
+      pos += n;
+   }
+
+   return pos < len ? pos : len;
+}
@@ -0,0 +1,75 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MEMORY_USAGE_H
+#define __MEMORY_USAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Memory in use per subsystem. Heap buffers are allocated
+ * through the wrappers below, which keep their size. Memory
+ * that isn't on the heap (mapped, on the GPU, owned by the
+ * core) is reported with memory_usage_add/set(). Safe to use
+ * from any thread. */
+
+enum memory_usage_tag
+{
+   MEMORY_USAGE_REWIND = 0,
+   MEMORY_USAGE_RUNAHEAD,
+   MEMORY_USAGE_NETPLAY,
+   /* Idle savestate buffers, and those of the save tasks */
+   MEMORY_USAGE_STATES,
+   /* Decoded images, thumbnails included */
+   MEMORY_USAGE_IMAGES,
+   MEMORY_USAGE_PLAYLISTS,
+   MEMORY_USAGE_AUDIO,
+   MEMORY_USAGE_SHADERS,
+   MEMORY_USAGE_CORE,
+   MEMORY_USAGE_TAG_LAST
+};
+
+void *memory_usage_malloc(enum memory_usage_tag tag, size_t size);
+
+void *memory_usage_calloc(enum memory_usage_tag tag,
+      size_t nmemb, size_t size);
+
+void *memory_usage_realloc(enum memory_usage_tag tag,
+      void *ptr, size_t size);
+
+/* Only for memory from the wrappers above, with the same tag */
+void memory_usage_free(enum memory_usage_tag tag, void *ptr);
+
+/* Negative @bytes for memory released */
+void memory_usage_add(enum memory_usage_tag tag, int64_t bytes);
+
+void memory_usage_set(enum memory_usage_tag tag, uint64_t bytes);
+
+uint64_t memory_usage_get(enum memory_usage_tag tag);
+
+const char *memory_usage_tag_name(enum memory_usage_tag tag);
+
+/* Prints "name=bytes" for each tag into s, separated by @sep.
+ * Returns the amount of bytes written. */
+size_t memory_usage_print(char *s, size_t len, const char *sep);
+
+RETRO_END_DECLS
+
+#endif
@@ -4546,6 +4546,7 @@ default_action_ok_cmd_func(action_ok_save_new_config,          CMD_EVENT_MENU_SA
 default_action_ok_cmd_func(action_ok_resume_content,           CMD_EVENT_RESUME)
 default_action_ok_cmd_func(action_ok_restart_content,          CMD_EVENT_RESET)
 default_action_ok_cmd_func(action_ok_screenshot,               CMD_EVENT_TAKE_SCREENSHOT)
+default_action_ok_cmd_func(action_ok_run_ahead_benchmark,      CMD_EVENT_RUNAHEAD_BENCHMARK)
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
 default_action_ok_cmd_func(action_ok_shader_apply_changes,     CMD_EVENT_SHADERS_APPLY_CHANGES)
 #endif
@@ -6656,6 +6657,9 @@ static int menu_cbs_init_bind_ok_compare_label(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_TAKE_SCREENSHOT:
             BIND_ACTION_OK(cbs, action_ok_screenshot);
             break;
+         case MENU_ENUM_LABEL_RUN_AHEAD_BENCHMARK:
+            BIND_ACTION_OK(cbs, action_ok_run_ahead_benchmark);
+            break;
          case MENU_ENUM_LABEL_RENAME_ENTRY:
             BIND_ACTION_OK(cbs, action_ok_rename_entry);
             break;
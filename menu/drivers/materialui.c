@@ -2519,6 +2519,11 @@ static void materialui_render(void *data,
          break;
    }
 
+   /* Load the thumbnails nearest to the selection */
+   if ((mui->list_view_type != MUI_LIST_VIEW_DEFAULT) &&
+       (mui->list_view_type != MUI_LIST_VIEW_PLAYLIST))
+      menu_thumbnail_process_requests();
+
    menu_entries_ctl(MENU_ENTRIES_CTL_SET_START, &mui->first_onscreen_entry);
 }
 
@@ -7941,5 +7946,6 @@ menu_ctx_driver_t menu_ctx_mui = {
    materialui_pointer_down,
    materialui_pointer_up,
    NULL, /* get_load_content_animation_data */
-   materialui_menu_entry_action
+   materialui_menu_entry_action,
+   NULL  /* frame_is_static */
 };
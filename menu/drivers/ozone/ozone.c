@@ -2506,6 +2506,12 @@ static int ozone_menu_entry_action(
    return generic_menu_entry_action(userdata, entry, i, new_action);
 }
 
+/* Everything drawn only changes with input or animations */
+static bool ozone_frame_is_static(void *userdata)
+{
+   return true;
+}
+
 menu_ctx_driver_t menu_ctx_ozone = {
    NULL,                         /* set_texture */
    ozone_messagebox,
@@ -2556,5 +2562,6 @@ menu_ctx_driver_t menu_ctx_ozone = {
 #else
    NULL,
 #endif
-   ozone_menu_entry_action
+   ozone_menu_entry_action,
+   ozone_frame_is_static
 };
@@ -30,6 +30,7 @@
 #include "../../menu_animation.h"
 
 #include "../../../configuration.h"
+#include "../../../gfx/video_image_cache.h"
 
 enum msg_hash_enums ozone_system_tabs_value[OZONE_SYSTEM_TAB_LAST] = {
    MENU_ENUM_LABEL_VALUE_MAIN_MENU,
@@ -659,7 +660,7 @@ void ozone_context_reset_horizontal_list(ozone_handle_t *ozone)
          ti.pixels        = NULL;
          ti.supports_rgba = video_driver_supports_rgba();
 
-         if (image_texture_load(&ti, texturepath))
+         if (video_image_cache_load(&ti, texturepath))
          {
             if (ti.pixels)
             {
@@ -689,7 +690,7 @@ void ozone_context_reset_horizontal_list(ozone_handle_t *ozone)
                   PATH_MAX_LENGTH * sizeof(char));
          }
 
-         if (image_texture_load(&ti, content_texturepath))
+         if (video_image_cache_load(&ti, content_texturepath))
          {
             if (ti.pixels)
             {
@@ -64,6 +64,11 @@
 #include <gfx/scaler/scaler.h>
 #include <features/features_cpu.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define RGUI_NEON
+#include <arm_neon.h>
+#endif
+
 #if defined(GEKKO)
 /* Required for the Wii build, since we have
  * to query the hardware for the actual display
@@ -854,6 +859,21 @@ static frame_buf_t rgui_upscale_buf = {
    NULL
 };
 
+/* Copy of the framebuffer as last uploaded, so that
+ * unchanged frames aren't uploaded again and only the
+ * rows that changed are upscaled */
+static frame_buf_t rgui_upload_buf = {
+   0,
+   0,
+   NULL
+};
+
+/* Whether the video driver has what rgui_upload_buf
+ * holds, at this size */
+static bool rgui_upload_valid       = false;
+static unsigned rgui_upload_width   = 0;
+static unsigned rgui_upload_height  = 0;
+
 /* ==============================
  * pixel format conversion START
  * ============================== */
@@ -996,6 +1016,19 @@ static void rgui_set_pixel_format_function(void)
  * pixel format conversion END
  * ============================== */
 
+/* Sets @len pixels from @dst on to @color */
+static INLINE void rgui_fill_row(uint16_t *dst, unsigned len, uint16_t color)
+{
+#ifdef RGUI_NEON
+   uint16x8_t color_vec = vdupq_n_u16(color);
+
+   for (; len >= 8; len -= 8, dst += 8)
+      vst1q_u16(dst, color_vec);
+#endif
+   while (len--)
+      *dst++ = color;
+}
+
 static void rgui_fill_rect(
       uint16_t *data,
       unsigned fb_width, unsigned fb_height,
@@ -1034,8 +1067,7 @@ static void rgui_fill_rect(
       uint16_t *dst = data + x_start;
 
       /* Populate source array */
-      for (x_index = x_start; x_index < x_end; x_index++)
-         *(scanline_even + x_index) = dark_color;
+      rgui_fill_row(src, x_end - x_start, dark_color);
 
       /* Fill destination array */
       for (y_index = y_start; y_index < y_end; y_index++)
@@ -1144,7 +1176,7 @@ static void rgui_color_rect(
       unsigned width, unsigned height,
       uint16_t color)
 {
-   unsigned x_index, y_index;
+   unsigned y_index;
    unsigned x_start = x <= fb_width  ? x : fb_width;
    unsigned y_start = y <= fb_height ? y : fb_height;
    unsigned x_end   = x + width;
@@ -1153,12 +1185,12 @@ static void rgui_color_rect(
    x_end = x_end <= fb_width  ? x_end : fb_width;
    y_end = y_end <= fb_height ? y_end : fb_height;
 
+   if (x_end <= x_start)
+      return;
+
    for (y_index = y_start; y_index < y_end; y_index++)
-   {
-      uint16_t *data_ptr = data + (y_index * fb_width);
-      for (x_index = x_start; x_index < x_end; x_index++)
-         *(data_ptr + x_index) = color;
-   }
+      rgui_fill_row(data + (y_index * fb_width) + x_start,
+            x_end - x_start, color);
 }
 
 static void rgui_render_border(rgui_t *rgui, uint16_t *data,
@@ -1214,7 +1246,7 @@ static bool INLINE rgui_draw_particle(
       unsigned width, unsigned height,
       uint16_t color)
 {
-   unsigned x_index, y_index;
+   unsigned y_index;
    
    /* This great convoluted mess just saves us
     * having to perform comparisons on every
@@ -1233,14 +1265,14 @@ static bool INLINE rgui_draw_particle(
    y_end = y_end >  0         ? y_end : 0;
    y_end = y_end <= (int)fb_height ? y_end : fb_height;
    
+   if (x_end <= x_start)
+      return false;
+
    for (y_index = (unsigned)y_start; y_index < (unsigned)y_end; y_index++)
-   {
-      uint16_t *data_ptr = data + (y_index * fb_width);
-      for (x_index = (unsigned)x_start; x_index < (unsigned)x_end; x_index++)
-         *(data_ptr + x_index) = color;
-   }
+      rgui_fill_row(data + (y_index * fb_width) + x_start,
+            (unsigned)(x_end - x_start), color);
    
-   return (x_end > x_start) && (y_end > y_start);
+   return y_end > y_start;
 }
 
 static void rgui_init_particle_effect(rgui_t *rgui)
@@ -3878,6 +3910,14 @@ static void rgui_framebuffer_free(void)
    if (rgui_frame_buf.data)
       free(rgui_frame_buf.data);
    rgui_frame_buf.data = NULL;
+
+   rgui_upload_buf.width  = 0;
+   rgui_upload_buf.height = 0;
+
+   if (rgui_upload_buf.data)
+      free(rgui_upload_buf.data);
+   rgui_upload_buf.data   = NULL;
+   rgui_upload_valid      = false;
 }
 
 static void rgui_background_free(void)
@@ -4385,10 +4425,72 @@ static void rgui_free(void *data)
    }
 }
 
+/* Gets the rows that changed since the last upload,
+ * and remembers them as uploaded.
+ * Returns false if nothing changed. */
+static bool rgui_get_dirty_rows(unsigned fb_width, unsigned fb_height,
+      unsigned out_width, unsigned out_height,
+      unsigned *y_min, unsigned *y_max)
+{
+   size_t row_size = fb_width * sizeof(uint16_t);
+   unsigned y_start = 0;
+   unsigned y_end   = fb_height;
+
+   if ((rgui_upload_buf.width != fb_width) ||
+       (rgui_upload_buf.height != fb_height) ||
+       !rgui_upload_buf.data)
+   {
+      if (rgui_upload_buf.data)
+         free(rgui_upload_buf.data);
+
+      rgui_upload_buf.width  = fb_width;
+      rgui_upload_buf.height = fb_height;
+      rgui_upload_buf.data   = (uint16_t*)malloc(fb_height * row_size);
+      rgui_upload_valid      = false;
+   }
+
+   /* Without a copy, everything is always uploaded */
+   if (!rgui_upload_buf.data)
+   {
+      *y_min = 0;
+      *y_max = fb_height;
+      return true;
+   }
+
+   if (rgui_upload_valid &&
+       (rgui_upload_width  == out_width) &&
+       (rgui_upload_height == out_height))
+   {
+      while ((y_start < y_end) && !memcmp(
+               rgui_frame_buf.data  + (y_start * fb_width),
+               rgui_upload_buf.data + (y_start * fb_width), row_size))
+         y_start++;
+
+      while ((y_end > y_start) && !memcmp(
+               rgui_frame_buf.data  + ((y_end - 1) * fb_width),
+               rgui_upload_buf.data + ((y_end - 1) * fb_width), row_size))
+         y_end--;
+   }
+
+   if (y_start >= y_end)
+      return false;
+
+   memcpy(rgui_upload_buf.data  + (y_start * fb_width),
+          rgui_frame_buf.data   + (y_start * fb_width),
+          (y_end - y_start) * row_size);
+
+   *y_min = y_start;
+   *y_max = y_end;
+   return true;
+}
+
 static void rgui_set_texture(void)
 {
    size_t fb_pitch;
    unsigned fb_width, fb_height;
+   unsigned y_min, y_max;
+   unsigned out_width   = 0;
+   unsigned out_height  = 0;
    settings_t *settings = config_get_ptr();
 
    if (!menu_display_get_framebuffer_dirty_flag())
@@ -4399,32 +4501,22 @@ static void rgui_set_texture(void)
 
    menu_display_unset_framebuffer_dirty_flag();
 
-   if (settings->uints.menu_rgui_internal_upscale_level == RGUI_UPSCALE_NONE)
-   {
-      video_driver_set_texture_frame(rgui_frame_buf.data,
-         false, fb_width, fb_height, 1.0f);
-   }
-   else
+   if (!rgui_frame_buf.data)
+      return;
+
+   out_width  = fb_width;
+   out_height = fb_height;
+
+   if (settings->uints.menu_rgui_internal_upscale_level != RGUI_UPSCALE_NONE)
    {
       /* Get viewport dimensions */
       struct video_viewport vp;
       video_driver_get_viewport_info(&vp);
-      
+
       /* If viewport is currently the same size (or smaller)
        * than the menu framebuffer, no scaling is required */
-      if ((vp.width <= fb_width) && (vp.height <= fb_height))
-      {
-         video_driver_set_texture_frame(rgui_frame_buf.data,
-            false, fb_width, fb_height, 1.0f);
-      }
-      else
+      if ((vp.width > fb_width) || (vp.height > fb_height))
       {
-         unsigned out_width;
-         unsigned out_height;
-         uint32_t x_ratio, y_ratio;
-         unsigned x_src, y_src;
-         unsigned x_dst, y_dst;
-         
          /* Determine output size */
          if (settings->uints.menu_rgui_internal_upscale_level == RGUI_UPSCALE_AUTO)
          {
@@ -4436,52 +4528,95 @@ static void rgui_set_texture(void)
             out_width = settings->uints.menu_rgui_internal_upscale_level * fb_width;
             out_height = settings->uints.menu_rgui_internal_upscale_level * fb_height;
          }
-         
-         /* Allocate upscaling buffer, if required */
-         if ((rgui_upscale_buf.width != out_width) || (rgui_upscale_buf.height != out_height) || !rgui_upscale_buf.data)
+      }
+   }
+
+   /* The texture still shows the same thing: particle
+    * effects and tickers redraw the whole framebuffer
+    * every frame, mostly to change a few rows */
+   if (!rgui_get_dirty_rows(fb_width, fb_height,
+            out_width, out_height, &y_min, &y_max))
+      return;
+
+   rgui_upload_valid  = true;
+   rgui_upload_width  = out_width;
+   rgui_upload_height = out_height;
+
+   if ((out_width == fb_width) && (out_height == fb_height))
+   {
+      video_driver_set_texture_frame(rgui_frame_buf.data,
+         false, fb_width, fb_height, 1.0f);
+   }
+   else
+   {
+      uint32_t x_ratio, y_ratio;
+      unsigned x_src, y_src;
+      unsigned x_dst, y_dst;
+
+      /* Allocate upscaling buffer, if required */
+      if ((rgui_upscale_buf.width != out_width) || (rgui_upscale_buf.height != out_height) || !rgui_upscale_buf.data)
+      {
+         rgui_upscale_buf.width = out_width;
+         rgui_upscale_buf.height = out_height;
+
+         if (rgui_upscale_buf.data)
          {
-            rgui_upscale_buf.width = out_width;
-            rgui_upscale_buf.height = out_height;
-            
-            if (rgui_upscale_buf.data)
-            {
-               free(rgui_upscale_buf.data);
-               rgui_upscale_buf.data = NULL;
-            }
-            
-            rgui_upscale_buf.data = (uint16_t*)calloc(out_width * out_height, sizeof(uint16_t));
-            if (!rgui_upscale_buf.data)
-            {
-               /* Uh oh... This could mean we don't have enough
-                * memory, so disable upscaling and draw the usual
-                * framebuffer... */
-               settings->uints.menu_rgui_internal_upscale_level = RGUI_UPSCALE_NONE;
-               video_driver_set_texture_frame(rgui_frame_buf.data,
-                  false, fb_width, fb_height, 1.0f);
-               return;
-            }
+            free(rgui_upscale_buf.data);
+            rgui_upscale_buf.data = NULL;
          }
-         
-         /* Perform nearest neighbour upscaling
-          * NB: We're duplicating code here, but trying to handle
-          * this with a polymorphic function is too much of a drag... */
-         x_ratio = ((fb_width  << 16) / out_width);
-         y_ratio = ((fb_height << 16) / out_height);
 
-         for (y_dst = 0; y_dst < out_height; y_dst++)
+         rgui_upscale_buf.data = (uint16_t*)calloc(out_width * out_height, sizeof(uint16_t));
+         if (!rgui_upscale_buf.data)
          {
-            y_src = (y_dst * y_ratio) >> 16;
-            for (x_dst = 0; x_dst < out_width; x_dst++)
-            {
-               x_src = (x_dst * x_ratio) >> 16;
-               rgui_upscale_buf.data[(y_dst * out_width) + x_dst] = rgui_frame_buf.data[(y_src * fb_width) + x_src];
-            }
+            /* Uh oh... This could mean we don't have enough
+             * memory, so disable upscaling and draw the usual
+             * framebuffer... */
+            settings->uints.menu_rgui_internal_upscale_level = RGUI_UPSCALE_NONE;
+            rgui_upload_valid = false;
+            video_driver_set_texture_frame(rgui_frame_buf.data,
+               false, fb_width, fb_height, 1.0f);
+            return;
          }
-         
-         /* Draw upscaled texture */
-         video_driver_set_texture_frame(rgui_upscale_buf.data,
-            false, out_width, out_height, 1.0f);
+
+         /* All of it has to be scaled again */
+         y_min = 0;
+         y_max = fb_height;
       }
+
+      /* Perform nearest neighbour upscaling of the rows
+       * that changed; the others are still there */
+      x_ratio = ((fb_width  << 16) / out_width);
+      y_ratio = ((fb_height << 16) / out_height);
+
+      for (y_dst = 0; y_dst < out_height; y_dst++)
+      {
+         uint16_t *dst = rgui_upscale_buf.data + (y_dst * out_width);
+         uint16_t *src = NULL;
+
+         y_src = (y_dst * y_ratio) >> 16;
+
+         if ((y_src < y_min) || (y_src >= y_max))
+            continue;
+
+         /* Same source row as the one above */
+         if ((y_dst > 0) && ((((y_dst - 1) * y_ratio) >> 16) == y_src))
+         {
+            memcpy(dst, dst - out_width, out_width * sizeof(uint16_t));
+            continue;
+         }
+
+         src = rgui_frame_buf.data + (y_src * fb_width);
+
+         for (x_dst = 0; x_dst < out_width; x_dst++)
+         {
+            x_src = (x_dst * x_ratio) >> 16;
+            dst[x_dst] = src[x_src];
+         }
+      }
+
+      /* Draw upscaled texture */
+      video_driver_set_texture_frame(rgui_upscale_buf.data,
+         false, out_width, out_height, 1.0f);
    }
 }
 
@@ -5142,9 +5277,12 @@ static void rgui_toggle(void *userdata, bool menu_on)
       free(rgui_upscale_buf.data);
       rgui_upscale_buf.data = NULL;
    }
+
+   /* The video driver may have dropped the menu texture
+    * meanwhile */
+   rgui_upload_valid = false;
 }
 
-#if defined(HAVE_MENU_WIDGETS)
 static void rgui_context_reset(void *data, bool is_threaded)
 {
    rgui_t *rgui = (rgui_t*)data;
@@ -5152,11 +5290,18 @@ static void rgui_context_reset(void *data, bool is_threaded)
    if (!rgui)
       return;
 
+   /* New context, new menu texture */
+   rgui_upload_valid = false;
+
+#if defined(HAVE_MENU_WIDGETS)
    if (rgui->widgets_supported)
       menu_display_allocate_white_texture();
    video_driver_monitor_reset();
+#endif
 }
 
+#if defined(HAVE_MENU_WIDGETS)
+
 static void rgui_context_destroy(void *data)
 {
    rgui_t *rgui = (rgui_t*)data;
@@ -5177,12 +5322,11 @@ menu_ctx_driver_t menu_ctx_rgui = {
    rgui_frame,
    rgui_init,
    rgui_free,
-#if defined(HAVE_MENU_WIDGETS)
    rgui_context_reset,
+#if defined(HAVE_MENU_WIDGETS)
    rgui_context_destroy,
 #else
    NULL,
-   NULL,
 #endif
    rgui_populate_entries,
    rgui_toggle,
@@ -5220,5 +5364,6 @@ menu_ctx_driver_t menu_ctx_rgui = {
    NULL,                               /* pointer_down */
    rgui_pointer_up,
    NULL,                               /* get_load_content_animation_data */
-   generic_menu_entry_action
+   generic_menu_entry_action,
+   NULL                                /* frame_is_static */
 };
@@ -57,6 +57,7 @@
 #include "../../configuration.h"
 #include "../../playlist.h"
 #include "../../retroarch.h"
+#include "../../gfx/video_image_cache.h"
 
 #include "../../tasks/tasks_internal.h"
 
@@ -1937,7 +1938,7 @@ static void stripes_context_reset_horizontal_list(
          ti.pixels        = NULL;
          ti.supports_rgba = video_driver_supports_rgba();
 
-         if (image_texture_load(&ti, texturepath))
+         if (video_image_cache_load(&ti, texturepath))
          {
             if (ti.pixels)
             {
@@ -1954,7 +1955,7 @@ static void stripes_context_reset_horizontal_list(
                "content.png", '-',
                PATH_MAX_LENGTH * sizeof(char));
 
-         if (image_texture_load(&ti, content_texturepath))
+         if (video_image_cache_load(&ti, content_texturepath))
          {
             if (ti.pixels)
             {
@@ -4421,5 +4422,6 @@ menu_ctx_driver_t menu_ctx_stripes = {
    NULL,                                     /* pointer_down */
    stripes_pointer_up,                       /* pointer_up   */
    NULL,                                     /* get_load_content_animation_data   */
-   generic_menu_entry_action
+   generic_menu_entry_action,
+   NULL                                      /* frame_is_static */
 };
@@ -59,6 +59,7 @@
 #include "../../configuration.h"
 #include "../../playlist.h"
 #include "../../retroarch.h"
+#include "../../gfx/video_image_cache.h"
 
 #include "../../tasks/tasks_internal.h"
 
@@ -2049,7 +2050,7 @@ static void xmb_context_reset_horizontal_list(
          ti.pixels        = NULL;
          ti.supports_rgba = video_driver_supports_rgba();
 
-         if (image_texture_load(&ti, texturepath))
+         if (video_image_cache_load(&ti, texturepath))
          {
             if (ti.pixels)
             {
@@ -2076,7 +2077,7 @@ static void xmb_context_reset_horizontal_list(
                   PATH_MAX_LENGTH * sizeof(char));
          }
 
-         if (image_texture_load(&ti, content_texturepath))
+         if (video_image_cache_load(&ti, content_texturepath))
          {
             if (ti.pixels)
             {
@@ -6607,6 +6608,16 @@ static bool xmb_get_load_content_animation_data(void *userdata, menu_texture_ite
 }
 #endif
 
+/* The shader backgrounds move all the time, unless frozen */
+static bool xmb_frame_is_static(void *userdata)
+{
+   settings_t *settings = config_get_ptr();
+
+   return settings->uints.menu_xmb_shader_pipeline
+         <= XMB_SHADER_PIPELINE_WALLPAPER
+      || settings->bools.menu_xmb_shader_pipeline_freeze;
+}
+
 menu_ctx_driver_t menu_ctx_xmb = {
    NULL,
    xmb_messagebox,
@@ -6657,5 +6668,6 @@ menu_ctx_driver_t menu_ctx_xmb = {
 #else
    NULL,
 #endif
-   xmb_menu_entry_action
+   xmb_menu_entry_action,
+   xmb_frame_is_static
 };
@@ -733,5 +733,6 @@ menu_ctx_driver_t menu_ctx_xui = {
    NULL,          /* pointer_down */
    NULL,          /* pointer_up */
    NULL,          /* get_load_content_animation_data */
-   generic_menu_entry_action
+   generic_menu_entry_action,
+   NULL           /* frame_is_static */
 };
@@ -14,6 +14,7 @@
  */
 
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
@@ -24,6 +25,7 @@
 #include "../../gfx/common/gl_common.h"
 
 #include "../menu_driver.h"
+#include "../menu_animation.h"
 
 #if defined(__arm__) || defined(__aarch64__)
 static int scx0, scx1, scy0, scy1;
@@ -74,6 +76,9 @@ static const GLfloat gl_vertexes[] = {
    1, 1
 };
 
+/* Quads are only merged while the stock blend shader is bound. */
+static bool menu_display_gl_batch_enable = false;
+
 static const GLfloat gl_tex_coords[] = {
    0, 1,
    1, 1,
@@ -122,23 +127,32 @@ static void menu_display_gl_blend_begin(video_frame_info_t *video_info)
 {
    gl_t             *gl          = (gl_t*)video_info->userdata;
 
+   gl_batch_flush(gl);
+
    glEnable(GL_BLEND);
-   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   gl2_blend_func_alpha(gl);
 
    gl->shader->use(gl, gl->shader_data, VIDEO_SHADER_STOCK_BLEND,
          true);
+
+   menu_display_gl_batch_enable = true;
 }
 
 static void menu_display_gl_blend_end(video_frame_info_t *video_info)
 {
+   gl_batch_flush((gl_t*)video_info->userdata);
+   menu_display_gl_batch_enable = false;
+
    glDisable(GL_BLEND);
 }
 
 static void menu_display_gl_viewport(menu_display_ctx_draw_t *draw,
       video_frame_info_t *video_info)
 {
+   gl_t *gl = (gl_t*)video_info->userdata;
+
    if (draw)
-      glViewport(draw->x, draw->y, draw->width, draw->height);
+      gl2_viewport(gl, draw->x, draw->y, draw->width, draw->height);
 }
 
 #ifdef MALI_BUG
@@ -218,10 +232,147 @@ menu_display_gl_discard_draw_rectangle(menu_display_ctx_draw_t *draw,
 }
 #endif
 
+/* Maps texture coordinates of an atlas image to its region
+ * of the page, clamping them as a texture of its own would. */
+static void menu_display_gl_atlas_coords(GLfloat *dst,
+      const float *src, unsigned vertices, const float *rect)
+{
+   unsigned i;
+
+   for (i = 0; i < vertices; i++)
+   {
+      float u = src[i * 2 + 0];
+      float v = src[i * 2 + 1];
+
+      u              = u < 0.0f ? 0.0f : (u > 1.0f ? 1.0f : u);
+      v              = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+      dst[i * 2 + 0] = rect[0] + u * rect[2];
+      dst[i * 2 + 1] = rect[1] + v * rect[3];
+   }
+}
+
+#ifdef HAVE_SHADERPIPELINE
+static void menu_display_gl_pipeline_output_size(gl_t *gl,
+      unsigned id, float width, float height)
+{
+#ifndef HAVE_PSGL
+   struct uniform_info uniform_param;
+
+   switch (id)
+   {
+      case VIDEO_SHADER_MENU_3:
+      case VIDEO_SHADER_MENU_4:
+      case VIDEO_SHADER_MENU_5:
+      case VIDEO_SHADER_MENU_6:
+         uniform_param.type              = UNIFORM_2F;
+         uniform_param.enabled           = true;
+         uniform_param.location          = 0;
+         uniform_param.count             = 0;
+
+         uniform_param.lookup.type       = SHADER_PROGRAM_VERTEX;
+         uniform_param.lookup.ident      = "OutputSize";
+         uniform_param.lookup.idx        = id;
+         uniform_param.lookup.add_prefix = true;
+         uniform_param.lookup.enable     = true;
+
+         uniform_param.result.f.v0       = width;
+         uniform_param.result.f.v1       = height;
+
+         gl->shader->set_uniform_parameter(gl->shader_data,
+               &uniform_param, NULL);
+         break;
+   }
+#endif
+}
+
+/* Draws a background effect into a texture of a fraction of
+ * the output size, when it's due, then scales it up. Its
+ * shader and uniforms were set by menu_display_gl_draw_pipeline.
+ *
+ * Returns: false if it's to be drawn directly. */
+static bool menu_display_gl_draw_pipeline_cached(
+      menu_display_ctx_draw_t *draw,
+      video_frame_info_t *video_info,
+      const math_matrix_4x4 *mvp)
+{
+   unsigned width, height;
+   gl_t *gl                = (gl_t*)video_info->userdata;
+   unsigned scale          = video_info->menu_shader_pipeline_scale;
+   unsigned idle_fps       = video_info->menu_shader_pipeline_idle_fps;
+   bool freeze             = video_info->menu_shader_pipeline_freeze;
+   unsigned id             = draw->pipeline.id;
+   /* Additive, the others are drawn at once and blended in */
+   bool additive           = id == VIDEO_SHADER_MENU
+      || id == VIDEO_SHADER_MENU_2;
+   bool redraw             = true;
+   retro_time_t now        = cpu_features_get_time_usec();
+
+   if (id < VIDEO_SHADER_MENU_6 || id > VIDEO_SHADER_MENU)
+      return false;
+
+   if (scale == 0 || scale > 100)
+      scale = 100;
+
+   if (scale == 100 && idle_fps == 0 && !freeze)
+      return false;
+
+   width  = MAX(draw->width  * scale / 100, 1);
+   height = MAX(draw->height * scale / 100, 1);
+
+   if (     gl->pipeline_id     == id
+         && gl->pipeline_width  == width
+         && gl->pipeline_height == height)
+   {
+      if (freeze)
+         redraw = false;
+      else if (idle_fps && !menu_animation_is_active())
+         redraw = now - gl->pipeline_time >= 1000000 / idle_fps;
+   }
+
+   if (redraw)
+   {
+      if (!gl2_pipeline_begin(gl, width, height))
+         return false;
+
+      if (!additive)
+         glDisable(GL_BLEND);
+
+      menu_display_gl_pipeline_output_size(gl, id, width, height);
+
+      gl->shader->set_coords(gl->shader_data, draw->coords);
+      gl->shader->set_mvp(gl->shader_data, mvp);
+
+      glDrawArrays(menu_display_prim_to_gl_enum(
+               draw->prim_type), 0, draw->coords->vertices);
+
+      glEnable(GL_BLEND);
+      gl2_pipeline_end(gl);
+
+      gl->pipeline_id   = id;
+      gl->pipeline_time = now;
+   }
+
+   if (additive)
+      glBlendFunc(GL_ONE, GL_ONE);
+   else
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+   gl2_pipeline_draw(gl, draw->x, draw->y, draw->width, draw->height);
+   gl2_blend_func_alpha(gl);
+
+   return true;
+}
+#endif
+
 static void menu_display_gl_draw(menu_display_ctx_draw_t *draw,
       video_frame_info_t *video_info)
 {
+   GLfloat atlas_coords[16 * 2];
+   float atlas_rect[4];
+   const float *tex_coord        = NULL;
+   const math_matrix_4x4 *mvp    = NULL;
    gl_t             *gl          = (gl_t*)video_info->userdata;
+   unsigned texture              = 0;
 
    if (!gl || !draw)
       return;
@@ -242,19 +393,59 @@ static void menu_display_gl_draw(menu_display_ctx_draw_t *draw,
    if (!draw->coords->lut_tex_coord)
       draw->coords->lut_tex_coord = menu_display_gl_get_default_tex_coords();
 
+   mvp = draw->matrix_data ? (const math_matrix_4x4*)draw->matrix_data
+      : (const math_matrix_4x4*)menu_display_gl_get_default_mvp(video_info);
+
+   texture   = (unsigned)draw->texture;
+   tex_coord = draw->coords->tex_coord;
+
+   if (GL_ATLAS_IS_HANDLE(draw->texture))
+   {
+      if (     draw->coords->vertices > 16
+            || !gl_atlas_resolve(gl->atlas, draw->texture,
+               &texture, atlas_rect))
+         return;
+
+      menu_display_gl_atlas_coords(atlas_coords, tex_coord,
+            draw->coords->vertices, atlas_rect);
+      draw->coords->tex_coord = atlas_coords;
+   }
+
+   if (     menu_display_gl_batch_enable
+         && draw->prim_type == MENU_DISPLAY_PRIM_TRIANGLESTRIP
+         && gl_batch_add_quad(gl, draw->x, draw->y,
+            draw->width, draw->height, mvp,
+            texture, draw->coords))
+   {
+      draw->coords->tex_coord = tex_coord;
+      gl->coords.color        = gl->white_color_ptr;
+      return;
+   }
+
+   gl_batch_flush(gl);
+
+#ifdef HAVE_SHADERPIPELINE
+   if (     draw->pipeline.active
+         && menu_display_gl_draw_pipeline_cached(draw, video_info, mvp))
+   {
+      draw->coords->tex_coord = tex_coord;
+      gl->coords.color        = gl->white_color_ptr;
+      return;
+   }
+#endif
+
    menu_display_gl_viewport(draw, video_info);
-   glBindTexture(GL_TEXTURE_2D, (GLuint)draw->texture);
+   glBindTexture(GL_TEXTURE_2D, (GLuint)texture);
 
    gl->shader->set_coords(gl->shader_data, draw->coords);
-   gl->shader->set_mvp(gl->shader_data,
-         draw->matrix_data ? (math_matrix_4x4*)draw->matrix_data
-      : (math_matrix_4x4*)menu_display_gl_get_default_mvp(video_info));
+   gl->shader->set_mvp(gl->shader_data, mvp);
 
 
    glDrawArrays(menu_display_prim_to_gl_enum(
             draw->prim_type), 0, draw->coords->vertices);
 
-   gl->coords.color     = gl->white_color_ptr;
+   draw->coords->tex_coord = tex_coord;
+   gl->coords.color        = gl->white_color_ptr;
 }
 
 static void menu_display_gl_draw_pipeline(menu_display_ctx_draw_t *draw,
@@ -266,6 +457,9 @@ static void menu_display_gl_draw_pipeline(menu_display_ctx_draw_t *draw,
    static float t                   = 0;
    video_coord_array_t *ca          = menu_display_get_coords_array();
 
+   gl_batch_flush(gl);
+   menu_display_gl_batch_enable     = false;
+
    draw->x                          = 0;
    draw->y                          = 0;
    draw->coords                     = (struct video_coords*)(&ca->coords);
@@ -313,23 +507,8 @@ static void menu_display_gl_draw_pipeline(menu_display_ctx_draw_t *draw,
          break;
    }
 
-   switch (draw->pipeline.id)
-   {
-      case VIDEO_SHADER_MENU_3:
-      case VIDEO_SHADER_MENU_4:
-      case VIDEO_SHADER_MENU_5:
-      case VIDEO_SHADER_MENU_6:
-#ifndef HAVE_PSGL
-         uniform_param.type              = UNIFORM_2F;
-         uniform_param.lookup.ident      = "OutputSize";
-         uniform_param.result.f.v0       = draw->width;
-         uniform_param.result.f.v1       = draw->height;
-
-         gl->shader->set_uniform_parameter(gl->shader_data,
-               &uniform_param, NULL);
-#endif
-         break;
-   }
+   menu_display_gl_pipeline_output_size(gl, draw->pipeline.id,
+         draw->width, draw->height);
 #endif
 }
 
@@ -345,6 +524,8 @@ static void menu_display_gl_clear_color(
    if (!clearcolor)
       return;
 
+   gl_batch_flush((gl_t*)video_info->userdata);
+
    glClearColor(clearcolor->r,
          clearcolor->g, clearcolor->b, clearcolor->a);
    glClear(GL_COLOR_BUFFER_BIT);
@@ -368,7 +549,11 @@ static void menu_display_gl_scissor_begin(
       video_frame_info_t *video_info, int x, int y,
       unsigned width, unsigned height)
 {
-   glScissor(x, video_info->height - y - height, width, height);
+   gl_t *gl = (gl_t*)video_info->userdata;
+
+   gl_batch_flush(gl);
+
+   gl2_scissor(gl, x, video_info->height - y - height, width, height);
    glEnable(GL_SCISSOR_TEST);
 #ifdef MALI_BUG
    /* TODO/FIXME: If video width/height changes between
@@ -385,13 +570,34 @@ static void menu_display_gl_scissor_begin(
 
 static void menu_display_gl_scissor_end(video_frame_info_t *video_info)
 {
-   glScissor(0, 0, video_info->width, video_info->height);
+   gl_t *gl = (gl_t*)video_info->userdata;
+
+   gl_batch_flush(gl);
+
+   gl2_scissor(gl, 0, 0, video_info->width, video_info->height);
    glDisable(GL_SCISSOR_TEST);
 #ifdef MALI_BUG
    scissor_set_rectangle(0, video_info->width - 1, 0, video_info->height - 1, 0);
 #endif
 }
 
+#ifdef HAVE_MENU_WIDGETS
+static bool menu_display_gl_layer_begin(video_frame_info_t *video_info)
+{
+   return gl2_layer_begin((gl_t*)video_info->userdata);
+}
+
+static void menu_display_gl_layer_end(video_frame_info_t *video_info)
+{
+   gl2_layer_end((gl_t*)video_info->userdata);
+}
+
+static bool menu_display_gl_layer_draw(video_frame_info_t *video_info)
+{
+   return gl2_layer_draw((gl_t*)video_info->userdata);
+}
+#endif
+
 menu_display_ctx_driver_t menu_display_ctx_gl = {
    menu_display_gl_draw,
    menu_display_gl_draw_pipeline,
@@ -408,5 +614,14 @@ menu_display_ctx_driver_t menu_display_ctx_gl = {
    "gl",
    false,
    menu_display_gl_scissor_begin,
-   menu_display_gl_scissor_end
+   menu_display_gl_scissor_end,
+#ifdef HAVE_MENU_WIDGETS
+   menu_display_gl_layer_begin,
+   menu_display_gl_layer_end,
+   menu_display_gl_layer_draw
+#else
+   NULL,
+   NULL,
+   NULL
+#endif
 };
@@ -102,13 +102,16 @@ static unsigned to_menu_pipeline(
 static void menu_display_vk_viewport(menu_display_ctx_draw_t *draw,
       video_frame_info_t *video_info)
 {
+   unsigned width, height;
    vk_t *vk                      = (vk_t*)video_info->userdata;
 
    if (!vk || !draw)
       return;
 
+   vulkan_logical_size(vk, &width, &height);
+
    vk->vk_vp.x        = draw->x;
-   vk->vk_vp.y        = vk->context->swapchain_height - draw->y - draw->height;
+   vk->vk_vp.y        = height - draw->y - draw->height;
    vk->vk_vp.width    = draw->width;
    vk->vk_vp.height   = draw->height;
    vk->vk_vp.minDepth = 0.0f;
@@ -123,6 +126,7 @@ static void menu_display_vk_draw_pipeline(menu_display_ctx_draw_t *draw,
    static float t                   = 0.0f;
    float yflip                      = 0.0f;
    static struct video_coords blank_coords;
+   unsigned width, height;
    float output_size[2];
    video_coord_array_t *ca          = NULL;
    vk_t *vk                         = (vk_t*)video_info->userdata;
@@ -134,8 +138,10 @@ static void menu_display_vk_draw_pipeline(menu_display_ctx_draw_t *draw,
    draw->y                          = 0;
    draw->matrix_data                = NULL;
 
-   output_size[0]                   = (float)vk->context->swapchain_width;
-   output_size[1]                   = (float)vk->context->swapchain_height;
+   vulkan_logical_size(vk, &width, &height);
+
+   output_size[0]                   = (float)width;
+   output_size[1]                   = (float)height;
 
    switch (draw->pipeline.id)
    {
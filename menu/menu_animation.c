@@ -36,25 +36,61 @@
 #include "menu_driver.h"
 #include "../performance_counters.h"
 
+#if __SSE2__
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MENU_ANIMATION_NEON
+#endif
+
+/* A tween pushed while tweens are being updated,
+ * added to them after the update */
 struct tween
 {
    float       duration;
-   float       running_since;
    float       initial_value;
    float       target_value;
    float       *subject;
    uintptr_t   tag;
-   easing_cb   easing;
    tween_cb    cb;
    void        *userdata;
-   bool        deleted;
+   enum menu_animation_easing_type easing;
 };
 
 DA_TYPEDEF(struct tween, tween_array_t)
 
+/* What is only needed once the value of a tween is computed */
+struct tween_target
+{
+   float       *subject;
+   float       target_value;
+   uintptr_t   tag;
+   tween_cb    cb;
+   void        *userdata;
+   bool        deleted;
+};
+
+/* Tweens in the order they were pushed, each field needed
+ * to compute their values in an array of its own. Lists push
+ * their tweens together, with the same easing, so they are
+ * computed together. */
+typedef struct tween_store
+{
+   float               *running_since;
+   float               *duration;
+   float               *inv_duration;
+   float               *initial_value;
+   float               *delta_value;
+   float               *value;
+   uint8_t             *easing;
+   struct tween_target *targets;
+   size_t              count;
+   size_t              capacity;
+} tween_store_t;
+
 struct menu_animation
 {
-   tween_array_t list;
+   tween_store_t list;
    tween_array_t pending;
    bool initialized;
    bool pending_deletes;
@@ -82,6 +118,9 @@ static uint64_t ticker_pixel_idx = 0; /* updated every frame */
 static float delta_time          = 0.0f;
 static bool animation_is_active  = false;
 static bool ticker_is_active     = false;
+/* Set by tickers while a frame is drawn, kept for
+ * one update so the next frame knows to be drawn */
+static bool ticker_was_active    = false;
 
 /* from https://github.com/kikito/tween.lua/blob/master/tween.lua */
 
@@ -311,6 +350,229 @@ static float easing_out_in_bounce(float t, float b, float c, float d)
    return easing_in_bounce((t * 2) - d, b + c / 2, c / 2, d);
 }
 
+/* In the order of enum menu_animation_easing_type */
+static const easing_cb menu_animation_easings[EASING_LAST] = {
+   easing_linear,
+   easing_in_quad,
+   easing_out_quad,
+   easing_in_out_quad,
+   easing_out_in_quad,
+   easing_in_cubic,
+   easing_out_cubic,
+   easing_in_out_cubic,
+   easing_out_in_cubic,
+   easing_in_quart,
+   easing_out_quart,
+   easing_in_out_quart,
+   easing_out_in_quart,
+   easing_in_quint,
+   easing_out_quint,
+   easing_in_out_quint,
+   easing_out_in_quint,
+   easing_in_sine,
+   easing_out_sine,
+   easing_in_out_sine,
+   easing_out_in_sine,
+   easing_in_expo,
+   easing_out_expo,
+   easing_in_out_expo,
+   easing_out_in_expo,
+   easing_in_circ,
+   easing_out_circ,
+   easing_in_out_circ,
+   easing_out_in_circ,
+   easing_in_bounce,
+   easing_out_bounce,
+   easing_in_out_bounce,
+   easing_out_in_bounce
+};
+
+#define MENU_ANIMATION_STORE_GROW(field) do { \
+   void *tmp = realloc(store->field, capacity * sizeof(*store->field)); \
+   if (!tmp) \
+      return false; \
+   store->field = tmp; \
+} while (0)
+
+static bool menu_animation_store_reserve(tween_store_t *store,
+      size_t capacity)
+{
+   MENU_ANIMATION_STORE_GROW(running_since);
+   MENU_ANIMATION_STORE_GROW(duration);
+   MENU_ANIMATION_STORE_GROW(inv_duration);
+   MENU_ANIMATION_STORE_GROW(initial_value);
+   MENU_ANIMATION_STORE_GROW(delta_value);
+   MENU_ANIMATION_STORE_GROW(value);
+   MENU_ANIMATION_STORE_GROW(easing);
+   MENU_ANIMATION_STORE_GROW(targets);
+   store->capacity = capacity;
+   return true;
+}
+
+static bool menu_animation_store_add(tween_store_t *store,
+      const struct tween *t)
+{
+   size_t i = store->count;
+   struct tween_target *target;
+
+   if (     i == store->capacity
+         && !menu_animation_store_reserve(store,
+            store->capacity ? store->capacity * 2 : 64))
+      return false;
+
+   target                   = &store->targets[i];
+   store->running_since[i]  = 0.0f;
+   store->duration[i]       = t->duration;
+   store->inv_duration[i]   = 1.0f / t->duration;
+   store->initial_value[i]  = t->initial_value;
+   store->delta_value[i]    = t->target_value - t->initial_value;
+   store->value[i]          = t->initial_value;
+   store->easing[i]         = t->easing;
+   target->subject          = t->subject;
+   target->target_value     = t->target_value;
+   target->tag              = t->tag;
+   target->cb               = t->cb;
+   target->userdata         = t->userdata;
+   target->deleted          = false;
+   store->count++;
+
+   return true;
+}
+
+/* Drops deleted tweens, keeping the others in order */
+static void menu_animation_store_compact(tween_store_t *store)
+{
+   size_t i, j;
+
+   for (i = 0, j = 0; i < store->count; i++)
+   {
+      if (store->targets[i].deleted)
+         continue;
+
+      if (i != j)
+      {
+         store->running_since[j] = store->running_since[i];
+         store->duration[j]      = store->duration[i];
+         store->inv_duration[j]  = store->inv_duration[i];
+         store->initial_value[j] = store->initial_value[i];
+         store->delta_value[j]   = store->delta_value[i];
+         store->value[j]         = store->value[i];
+         store->easing[j]        = store->easing[i];
+         store->targets[j]       = store->targets[i];
+      }
+      j++;
+   }
+
+   store->count = j;
+}
+
+static void menu_animation_store_free(tween_store_t *store)
+{
+   free(store->running_since);
+   free(store->duration);
+   free(store->inv_duration);
+   free(store->initial_value);
+   free(store->delta_value);
+   free(store->value);
+   free(store->easing);
+   free(store->targets);
+   memset(store, 0, sizeof(*store));
+}
+
+/* c * t / d + b */
+static void menu_animation_compute_linear(tween_store_t *store,
+      size_t i, size_t end)
+{
+   const float *t = store->running_since;
+   const float *d = store->inv_duration;
+   const float *b = store->initial_value;
+   const float *c = store->delta_value;
+   float *value   = store->value;
+
+#if __SSE2__
+   for (; i + 4 <= end; i += 4)
+   {
+      __m128 x = _mm_mul_ps(_mm_loadu_ps(t + i), _mm_loadu_ps(d + i));
+      _mm_storeu_ps(value + i, _mm_add_ps(_mm_loadu_ps(b + i),
+               _mm_mul_ps(_mm_loadu_ps(c + i), x)));
+   }
+#elif defined(MENU_ANIMATION_NEON)
+   for (; i + 4 <= end; i += 4)
+   {
+      float32x4_t x = vmulq_f32(vld1q_f32(t + i), vld1q_f32(d + i));
+      vst1q_f32(value + i, vmlaq_f32(vld1q_f32(b + i),
+               vld1q_f32(c + i), x));
+   }
+#endif
+
+   for (; i < end; i++)
+      value[i] = b[i] + c[i] * (t[i] * d[i]);
+}
+
+/* -c * (t / d) * (t / d - 2) + b, what the menus mostly use */
+static void menu_animation_compute_out_quad(tween_store_t *store,
+      size_t i, size_t end)
+{
+   const float *t = store->running_since;
+   const float *d = store->inv_duration;
+   const float *b = store->initial_value;
+   const float *c = store->delta_value;
+   float *value   = store->value;
+
+#if __SSE2__
+   __m128 two     = _mm_set1_ps(2.0f);
+
+   for (; i + 4 <= end; i += 4)
+   {
+      __m128 x = _mm_mul_ps(_mm_loadu_ps(t + i), _mm_loadu_ps(d + i));
+      __m128 y = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(c + i), x),
+            _mm_sub_ps(x, two));
+      _mm_storeu_ps(value + i, _mm_sub_ps(_mm_loadu_ps(b + i), y));
+   }
+#elif defined(MENU_ANIMATION_NEON)
+   float32x4_t two = vdupq_n_f32(2.0f);
+
+   for (; i + 4 <= end; i += 4)
+   {
+      float32x4_t x = vmulq_f32(vld1q_f32(t + i), vld1q_f32(d + i));
+      vst1q_f32(value + i, vmlsq_f32(vld1q_f32(b + i),
+               vmulq_f32(vld1q_f32(c + i), x), vsubq_f32(x, two)));
+   }
+#endif
+
+   for (; i < end; i++)
+   {
+      float x  = t[i] * d[i];
+      value[i] = b[i] - c[i] * x * (x - 2.0f);
+   }
+}
+
+/* Values of the tweens from i to end, which all use the same easing */
+static void menu_animation_compute_values(tween_store_t *store,
+      size_t i, size_t end)
+{
+   easing_cb easing;
+
+   switch (store->easing[i])
+   {
+      case EASING_LINEAR:
+         menu_animation_compute_linear(store, i, end);
+         return;
+      case EASING_OUT_QUAD:
+         menu_animation_compute_out_quad(store, i, end);
+         return;
+      default:
+         break;
+   }
+
+   easing = menu_animation_easings[store->easing[i]];
+
+   for (; i < end; i++)
+      store->value[i] = easing(store->running_since[i],
+            store->initial_value[i], store->delta_value[i],
+            store->duration[i]);
+}
+
 static void menu_animation_ticker_generic(uint64_t idx,
       size_t max_width, size_t *offset, size_t *width)
 {
@@ -1043,144 +1305,33 @@ bool menu_animation_push(menu_animation_ctx_entry_t *entry)
    struct tween t;
 
    t.duration           = entry->duration;
-   t.running_since      = 0;
    t.initial_value      = *entry->subject;
    t.target_value       = entry->target_value;
    t.subject            = entry->subject;
    t.tag                = entry->tag;
    t.cb                 = entry->cb;
    t.userdata           = entry->userdata;
-   t.easing             = NULL;
-   t.deleted            = false;
-
-   switch (entry->easing_enum)
-   {
-      case EASING_LINEAR:
-         t.easing       = &easing_linear;
-         break;
-         /* Quad */
-      case EASING_IN_QUAD:
-         t.easing       = &easing_in_quad;
-         break;
-      case EASING_OUT_QUAD:
-         t.easing       = &easing_out_quad;
-         break;
-      case EASING_IN_OUT_QUAD:
-         t.easing       = &easing_in_out_quad;
-         break;
-      case EASING_OUT_IN_QUAD:
-         t.easing       = &easing_out_in_quad;
-         break;
-         /* Cubic */
-      case EASING_IN_CUBIC:
-         t.easing       = &easing_in_cubic;
-         break;
-      case EASING_OUT_CUBIC:
-         t.easing       = &easing_out_cubic;
-         break;
-      case EASING_IN_OUT_CUBIC:
-         t.easing       = &easing_in_out_cubic;
-         break;
-      case EASING_OUT_IN_CUBIC:
-         t.easing       = &easing_out_in_cubic;
-         break;
-         /* Quart */
-      case EASING_IN_QUART:
-         t.easing       = &easing_in_quart;
-         break;
-      case EASING_OUT_QUART:
-         t.easing       = &easing_out_quart;
-         break;
-      case EASING_IN_OUT_QUART:
-         t.easing       = &easing_in_out_quart;
-         break;
-      case EASING_OUT_IN_QUART:
-         t.easing       = &easing_out_in_quart;
-         break;
-         /* Quint */
-      case EASING_IN_QUINT:
-         t.easing       = &easing_in_quint;
-         break;
-      case EASING_OUT_QUINT:
-         t.easing       = &easing_out_quint;
-         break;
-      case EASING_IN_OUT_QUINT:
-         t.easing       = &easing_in_out_quint;
-         break;
-      case EASING_OUT_IN_QUINT:
-         t.easing       = &easing_out_in_quint;
-         break;
-         /* Sine */
-      case EASING_IN_SINE:
-         t.easing       = &easing_in_sine;
-         break;
-      case EASING_OUT_SINE:
-         t.easing       = &easing_out_sine;
-         break;
-      case EASING_IN_OUT_SINE:
-         t.easing       = &easing_in_out_sine;
-         break;
-      case EASING_OUT_IN_SINE:
-         t.easing       = &easing_out_in_sine;
-         break;
-         /* Expo */
-      case EASING_IN_EXPO:
-         t.easing       = &easing_in_expo;
-         break;
-      case EASING_OUT_EXPO:
-         t.easing       = &easing_out_expo;
-         break;
-      case EASING_IN_OUT_EXPO:
-         t.easing       = &easing_in_out_expo;
-         break;
-      case EASING_OUT_IN_EXPO:
-         t.easing       = &easing_out_in_expo;
-         break;
-         /* Circ */
-      case EASING_IN_CIRC:
-         t.easing       = &easing_in_circ;
-         break;
-      case EASING_OUT_CIRC:
-         t.easing       = &easing_out_circ;
-         break;
-      case EASING_IN_OUT_CIRC:
-         t.easing       = &easing_in_out_circ;
-         break;
-      case EASING_OUT_IN_CIRC:
-         t.easing       = &easing_out_in_circ;
-         break;
-         /* Bounce */
-      case EASING_IN_BOUNCE:
-         t.easing       = &easing_in_bounce;
-         break;
-      case EASING_OUT_BOUNCE:
-         t.easing       = &easing_out_bounce;
-         break;
-      case EASING_IN_OUT_BOUNCE:
-         t.easing       = &easing_in_out_bounce;
-         break;
-      case EASING_OUT_IN_BOUNCE:
-         t.easing       = &easing_out_in_bounce;
-         break;
-      default:
-         break;
-   }
+   t.easing             = entry->easing_enum;
 
    /* ignore born dead tweens */
-   if (!t.easing || t.duration == 0 || t.initial_value == t.target_value)
+   if (     (unsigned)t.easing >= EASING_LAST
+         || t.duration == 0
+         || t.initial_value == t.target_value)
       return false;
 
    if (!anim.initialized)
    {
-      da_init(anim.list);
       da_init(anim.pending);
       anim.initialized = true;
    }
 
    if (anim.in_update)
       da_push(anim.pending, t);
-   else
-      da_push(anim.list, t);
+   else if (!menu_animation_store_add(&anim.list, &t))
+      return false;
+
+   /* Something animates from now on, not only after the next update */
+   animation_is_active = true;
 
    return true;
 }
@@ -1221,7 +1372,10 @@ static void menu_animation_update_time(
       last_clock_update     = cur_time;
    }
 
-   if (ticker_is_active)
+   ticker_was_active = ticker_is_active;
+   ticker_is_active  = false;
+
+   if (ticker_was_active)
    {
       if (cur_time - last_ticker_update >= ticker_speed)
       {
@@ -1297,7 +1451,7 @@ bool menu_animation_update(
       unsigned video_width,
       unsigned video_height)
 {
-   unsigned i;
+   size_t i, end;
 
    menu_animation_update_time(
          menu_driver,
@@ -1308,57 +1462,53 @@ bool menu_animation_update(
    anim.in_update       = true;
    anim.pending_deletes = false;
 
-   for (i = 0; i < da_count(anim.list); i++)
+   for (i = 0; i < anim.list.count; i++)
+      anim.list.running_since[i] += delta_time;
+
+   for (i = 0; i < anim.list.count; i = end)
    {
-      struct tween *tween   = da_getptr(anim.list, i);
+      for (end = i + 1; end < anim.list.count
+            && anim.list.easing[end] == anim.list.easing[i]; end++);
 
-      if (!tween || tween->deleted)
-         continue;
+      menu_animation_compute_values(&anim.list, i, end);
+   }
 
-      tween->running_since += delta_time;
+   /* Applied in the order pushed: callbacks can kill the
+    * tweens after theirs, and the last tween pushed for
+    * a subject is the one it ends up with */
+   for (i = 0; i < anim.list.count; i++)
+   {
+      struct tween_target *target = &anim.list.targets[i];
 
-      *tween->subject       = tween->easing(
-            tween->running_since,
-            tween->initial_value,
-            tween->target_value - tween->initial_value,
-            tween->duration);
+      if (target->deleted)
+         continue;
 
-      if (tween->running_since >= tween->duration)
+      if (anim.list.running_since[i] >= anim.list.duration[i])
       {
-         *tween->subject = tween->target_value;
-
-         if (tween->cb)
-            tween->cb(tween->userdata);
+         *target->subject     = target->target_value;
+         target->deleted      = true;
+         anim.pending_deletes = true;
 
-         da_delete(anim.list, i);
-         i--;
+         if (target->cb)
+            target->cb(target->userdata);
       }
+      else
+         *target->subject     = anim.list.value[i];
    }
 
    if (anim.pending_deletes)
    {
-      for (i = 0; i < da_count(anim.list); i++)
-      {
-         struct tween *tween = da_getptr(anim.list, i);
-         if (!tween)
-            continue;
-         if (tween->deleted)
-         {
-            da_delete(anim.list, i);
-            i--;
-         }
-      }
+      menu_animation_store_compact(&anim.list);
       anim.pending_deletes = false;
    }
 
+   for (i = 0; i < da_count(anim.pending); i++)
+      menu_animation_store_add(&anim.list, da_getptr(anim.pending, i));
    if (da_count(anim.pending) > 0)
-   {
-      da_addn(anim.list, anim.pending.p, da_count(anim.pending));
       da_clear(anim.pending);
-   }
 
    anim.in_update      = false;
-   animation_is_active = da_count(anim.list) > 0;
+   animation_is_active = anim.list.count > 0;
 
    return animation_is_active;
 }
@@ -1672,8 +1822,10 @@ bool menu_animation_ticker_smooth(menu_animation_ctx_ticker_smooth_t *ticker)
    str_ptr = ticker->src_str;
    for (i = 0; i < src_str_len; i++)
    {
-      int glyph_width = font_driver_get_message_width(
-            ticker->font, str_ptr, 1, ticker->font_scale);
+      const char *next = utf8skip(str_ptr, 1);
+      int glyph_width  = font_driver_get_message_width(
+            ticker->font, str_ptr, (unsigned)(next - str_ptr),
+            ticker->font_scale);
 
       if (glyph_width < 0)
          goto end;
@@ -1681,7 +1833,7 @@ bool menu_animation_ticker_smooth(menu_animation_ctx_ticker_smooth_t *ticker)
       src_char_widths[i] = (unsigned)glyph_width;
       src_str_width += (unsigned)glyph_width;
 
-      str_ptr = utf8skip(str_ptr, 1);
+      str_ptr = next;
    }
 
    /* If total src string width is <= text field width, we
@@ -1763,8 +1915,10 @@ bool menu_animation_ticker_smooth(menu_animation_ctx_ticker_smooth_t *ticker)
    str_ptr = ticker->spacer;
    for (i = 0; i < spacer_len; i++)
    {
-      int glyph_width = font_driver_get_message_width(
-            ticker->font, str_ptr, 1, ticker->font_scale);
+      const char *next = utf8skip(str_ptr, 1);
+      int glyph_width  = font_driver_get_message_width(
+            ticker->font, str_ptr, (unsigned)(next - str_ptr),
+            ticker->font_scale);
 
       if (glyph_width < 0)
          goto end;
@@ -1772,7 +1926,7 @@ bool menu_animation_ticker_smooth(menu_animation_ctx_ticker_smooth_t *ticker)
       spacer_char_widths[i] = (unsigned)glyph_width;
       spacer_width += (unsigned)glyph_width;
 
-      str_ptr = utf8skip(str_ptr, 1);
+      str_ptr = next;
    }
 
    /* Determine animation type */
@@ -2182,32 +2336,39 @@ end:
 
 bool menu_animation_is_active(void)
 {
-   return animation_is_active || ticker_is_active;
+   return animation_is_active || ticker_is_active || ticker_was_active;
+}
+
+bool menu_animation_is_tweening(void)
+{
+   return animation_is_active;
 }
 
 bool menu_animation_kill_by_tag(menu_animation_ctx_tag *tag)
 {
-   unsigned i;
+   size_t i;
+   bool killed = false;
 
    if (!tag || *tag == (uintptr_t)-1)
       return false;
 
-   for (i = 0; i < da_count(anim.list); ++i)
+   for (i = 0; i < anim.list.count; ++i)
    {
-      struct tween *t = da_getptr(anim.list, i);
-      if (!t || t->tag != *tag)
+      struct tween_target *t = &anim.list.targets[i];
+      if (t->deleted || t->tag != *tag)
          continue;
 
+      t->deleted = true;
+      killed     = true;
+   }
+
+   /* Dropped during updates once they're done */
+   if (killed)
+   {
       if (anim.in_update)
-      {
-         t->deleted = true;
          anim.pending_deletes = true;
-      }
       else
-      {
-         da_delete(anim.list, i);
-         --i;
-      }
+         menu_animation_store_compact(&anim.list);
    }
 
    return true;
@@ -2215,13 +2376,14 @@ bool menu_animation_kill_by_tag(menu_animation_ctx_tag *tag)
 
 void menu_animation_kill_by_subject(menu_animation_ctx_subject_t *subject)
 {
-   unsigned i, j,  killed = 0;
-   float            **sub = (float**)subject->data;
+   size_t i;
+   unsigned j, killed = 0;
+   float       **sub  = (float**)subject->data;
 
-   for (i = 0; i < da_count(anim.list) && killed < subject->count; ++i)
+   for (i = 0; i < anim.list.count && killed < subject->count; ++i)
    {
-      struct tween *t = da_getptr(anim.list, i);
-      if (!t)
+      struct tween_target *t = &anim.list.targets[i];
+      if (t->deleted)
          continue;
 
       for (j = 0; j < subject->count; ++j)
@@ -2229,21 +2391,19 @@ void menu_animation_kill_by_subject(menu_animation_ctx_subject_t *subject)
          if (t->subject != sub[j])
             continue;
 
-         if (anim.in_update)
-         {
-            t->deleted = true;
-            anim.pending_deletes = true;
-         }
-         else
-         {
-            da_delete(anim.list, i);
-            --i;
-         }
-
+         t->deleted = true;
          killed++;
          break;
       }
    }
+
+   if (killed)
+   {
+      if (anim.in_update)
+         anim.pending_deletes = true;
+      else
+         menu_animation_store_compact(&anim.list);
+   }
 }
 
 float menu_animation_get_delta_time(void)
@@ -2257,19 +2417,7 @@ bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
    {
       case MENU_ANIMATION_CTL_DEINIT:
          {
-            size_t i;
-
-            for (i = 0; i < da_count(anim.list); i++)
-            {
-               struct tween *t = da_getptr(anim.list, i);
-               if (!t)
-                  continue;
-
-               if (t->subject)
-                  t->subject = NULL;
-            }
-
-            da_free(anim.list);
+            menu_animation_store_free(&anim.list);
             da_free(anim.pending);
 
             memset(&anim, 0, sizeof(menu_animation_t));
@@ -2281,6 +2429,7 @@ bool menu_animation_ctl(enum menu_animation_ctl_state state, void *data)
       case MENU_ANIMATION_CTL_CLEAR_ACTIVE:
          animation_is_active       = false;
          ticker_is_active          = false;
+         ticker_was_active         = false;
          break;
       case MENU_ANIMATION_CTL_SET_ACTIVE:
          animation_is_active       = true;
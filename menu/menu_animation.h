@@ -217,6 +217,9 @@ float menu_animation_get_delta_time(void);
 
 bool menu_animation_is_active(void);
 
+/* As menu_animation_is_active(), tickers aside */
+bool menu_animation_is_tweening(void);
+
 bool menu_animation_kill_by_tag(menu_animation_ctx_tag *tag);
 
 void menu_animation_kill_by_subject(menu_animation_ctx_subject_t *subject);
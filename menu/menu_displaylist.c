@@ -94,6 +94,7 @@
 #include "../version_git.h"
 #include "../list_special.h"
 #include "../performance_counters.h"
+#include "../memory_usage.h"
 #include "../core_info.h"
 #include "../wifi/wifi_driver.h"
 #include "../tasks/task_content.h"
@@ -134,7 +135,7 @@ static int menu_displaylist_parse_core_info(file_list_t *list)
 
    core_info_get_current_core(&core_info);
 
-   if (!core_info || !core_info->config_data)
+   if (!core_info || !core_info->has_info)
    {
       if (menu_entries_append_enum(list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE_INFORMATION_AVAILABLE),
@@ -619,6 +620,32 @@ static unsigned menu_displaylist_parse_system_info(file_list_t *list)
          }
       }
 
+      /* What each part of RetroArch takes of it */
+      {
+         unsigned i;
+         char tmp[128];
+
+         retroarch_memory_usage_update();
+
+         for (i = 0; i < MEMORY_USAGE_TAG_LAST; i++)
+         {
+            uint64_t bytes = memory_usage_get((enum memory_usage_tag)i);
+
+            if (!bytes)
+               continue;
+
+            snprintf(tmp, sizeof(tmp), "%s (%s): %.2f MB",
+                  msg_hash_to_str(MSG_MEMORY),
+                  memory_usage_tag_name((enum memory_usage_tag)i),
+                  bytes / (1024.0 * 1024.0));
+
+            if (menu_entries_append_enum(list, tmp, "",
+                  MENU_ENUM_LABEL_SYSTEM_INFO_ENTRY,
+                  MENU_SETTINGS_CORE_INFO_NONE, 0, 0))
+               count++;
+         }
+      }
+
       if (frontend->get_powerstate)
       {
          int seconds    = 0, percent = 0;
@@ -2291,7 +2318,7 @@ static unsigned menu_displaylist_parse_information_list(file_list_t *info_list)
           !string_is_equal(system->library_name,
              msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_CORE))
          )
-         && core_info && core_info->config_data
+         && core_info && core_info->has_info
       )
       if (menu_entries_append_enum(info_list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_CORE_INFORMATION),
@@ -6480,6 +6507,15 @@ unsigned menu_displaylist_build_list(file_list_t *list, enum menu_displaylist_ct
                         false) == 0)
                   count++;
             }
+
+            if (settings->bools.run_ahead_enabled &&
+                  !rarch_ctl(RARCH_CTL_IS_DUMMY_CORE, NULL))
+               if (menu_entries_append_enum(list,
+                     msg_hash_to_str(MENU_ENUM_LABEL_VALUE_RUN_AHEAD_BENCHMARK),
+                     msg_hash_to_str(MENU_ENUM_LABEL_RUN_AHEAD_BENCHMARK),
+                     MENU_ENUM_LABEL_RUN_AHEAD_BENCHMARK,
+                     MENU_SETTING_ACTION, 0, 0))
+                  count++;
          }
          break;
       case DISPLAYLIST_ONSCREEN_NOTIFICATIONS_SETTINGS_LIST:
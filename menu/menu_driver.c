@@ -15,6 +15,7 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <time.h>
 #include <locale.h>
@@ -64,11 +65,13 @@
 #include "../frontend/frontend.h"
 #include "../list_special.h"
 #include "../tasks/tasks_internal.h"
+#include "../gfx/video_image_cache.h"
 #include "../ui/ui_companion_driver.h"
 #include "../verbosity.h"
 #include "../tasks/task_powerstate.h"
 #ifdef HAVE_NETWORKING
 #include "../core_updater_list.h"
+#include "../playlist.h"
 #endif
 
 #define SCROLL_INDEX_SIZE          (2 * (26 + 2) + 1)
@@ -160,7 +163,8 @@ static menu_ctx_driver_t menu_ctx_null = {
   NULL,  /* pointer_down */
   NULL,  /* pointer_up   */
   NULL,  /* get_load_content_animation_data */
-  NULL   /* entry_action */
+  NULL,  /* entry_action */
+  NULL   /* frame_is_static */
 };
 
 /* Menu drivers */
@@ -335,6 +339,16 @@ static retro_time_t menu_driver_current_time_us         = 0;
 static retro_time_t menu_driver_powerstate_last_time_us = 0;
 static retro_time_t menu_driver_datetime_last_time_us   = 0;
 
+/* How long a playlist entry stays selected before its
+ * content is preloaded */
+#define MENU_PRELOAD_DELAY_US 500000
+
+/* Playlist entry selected, and since when */
+static file_list_t *menu_driver_preload_list            = NULL;
+static size_t menu_driver_preload_selection             = 0;
+static retro_time_t menu_driver_preload_time_us         = 0;
+static bool menu_driver_preload_done                    = false;
+
 /* Storage container for current menu datetime
  * representation string */
 static char menu_datetime_cache[255]                    = {0};
@@ -1331,6 +1345,60 @@ void menu_entries_append(file_list_t *list, const char *path, const char *label,
    menu_cbs_init(list, cbs, path, label, type, idx);
 }
 
+/* Last entry appended with menu_entries_append_enum. The callbacks
+ * bound depend on the label, type, enum and menu label only, so an
+ * entry appended right after one that shares them all takes its
+ * callbacks as they are instead of looking them up again. */
+static struct
+{
+   const file_list_t *list;
+   const menu_file_list_cbs_t *cbs;
+   size_t idx;
+   unsigned type;
+   enum msg_hash_enums enum_idx;
+   uint32_t menu_label_hash;
+} menu_entries_last_bind;
+
+static bool menu_entries_reuse_bind(file_list_t *list,
+      menu_file_list_cbs_t *cbs,
+      const char *label, const char *menu_label,
+      unsigned type, size_t idx)
+{
+   const menu_file_list_cbs_t *prev = menu_entries_last_bind.cbs;
+   uint32_t menu_label_hash         = menu_label
+      ? msg_hash_calculate(menu_label) : 0;
+   bool reuse                       =
+         prev
+      && idx > 0
+      && menu_entries_last_bind.list            == list
+      && menu_entries_last_bind.idx + 1         == idx
+      && list->list[idx - 1].actiondata         == prev
+      && menu_entries_last_bind.type            == type
+      && menu_entries_last_bind.enum_idx        == cbs->enum_idx
+      && menu_entries_last_bind.menu_label_hash == menu_label_hash
+      /* Playlist entries are labelled with their name, which
+       * isn't looked at when binding */
+      && (cbs->enum_idx == MENU_ENUM_LABEL_PLAYLIST_ENTRY
+            || string_is_equal(list->list[idx - 1].label, label));
+
+   if (reuse)
+   {
+      /* Everything from the enum on, the caches stay empty */
+      memcpy(&cbs->enum_idx, &prev->enum_idx,
+            sizeof(*cbs) - offsetof(menu_file_list_cbs_t, enum_idx));
+      cbs->checked = false;
+   }
+
+   menu_entries_last_bind.list            = list;
+   menu_entries_last_bind.cbs             = cbs;
+   menu_entries_last_bind.idx             = idx;
+   menu_entries_last_bind.type            = type;
+   menu_entries_last_bind.enum_idx        = cbs->enum_idx;
+   menu_entries_last_bind.menu_label_hash = menu_label_hash;
+
+   return reuse;
+}
+
 bool menu_entries_append_enum(file_list_t *list, const char *path,
       const char *label,
       enum msg_hash_enums enum_idx,
@@ -1339,13 +1407,14 @@ bool menu_entries_append_enum(file_list_t *list, const char *path,
    menu_ctx_list_t list_info;
    size_t idx;
    const char *menu_path           = NULL;
+   const char *menu_label          = NULL;
    menu_file_list_cbs_t *cbs       = NULL;
    if (!list || !label)
       return false;
 
    file_list_append(list, path, label, type, directory_ptr, entry_idx);
 
-   menu_entries_get_last_stack(&menu_path, NULL, NULL, NULL, NULL);
+   menu_entries_get_last_stack(&menu_path, &menu_label, NULL, NULL, NULL);
 
    idx                   = list->size - 1;
 
@@ -1368,10 +1437,16 @@ bool menu_entries_append_enum(file_list_t *list, const char *path,
    cbs = (menu_file_list_cbs_t*)
       calloc(1, sizeof(menu_file_list_cbs_t));
 
+   if (!cbs)
+      return false;
+
    file_list_set_actiondata(list, idx, cbs);
 
    cbs->enum_idx = enum_idx;
 
+   if (menu_entries_reuse_bind(list, cbs, label, menu_label, type, idx))
+      return true;
+
    if (   enum_idx != MENU_ENUM_LABEL_PLAYLIST_ENTRY
        && enum_idx != MENU_ENUM_LABEL_PLAYLIST_COLLECTION_ENTRY
        && enum_idx != MENU_ENUM_LABEL_RDB_ENTRY)
@@ -1396,6 +1471,9 @@ void menu_entries_prepend(file_list_t *list,
 
    file_list_prepend(list, path, label, type, directory_ptr, entry_idx);
 
+   /* The entries all moved down */
+   menu_entries_last_bind.cbs = NULL;
+
    menu_entries_get_last_stack(&menu_path, NULL, NULL, NULL, NULL);
 
    idx              = 0;
@@ -1563,6 +1641,9 @@ bool menu_entries_ctl(enum menu_entries_ctl_state state, void *data)
                file_list_free_actiondata(list, i);
 
             file_list_clear(list);
+
+            if (menu_entries_last_bind.list == list)
+               menu_entries_last_bind.cbs = NULL;
          }
          break;
       case MENU_ENTRIES_CTL_SHOW_BACK:
@@ -1895,6 +1976,30 @@ void menu_display_scissor_end(video_frame_info_t *video_info)
       menu_disp->scissor_end(video_info);
 }
 
+/* Returns false if draws can't go into a layer, they go to
+ * the screen as usual then */
+bool menu_display_layer_begin(video_frame_info_t *video_info)
+{
+   if (menu_disp && menu_disp->layer_begin && menu_disp->layer_end
+         && menu_disp->layer_draw)
+      return menu_disp->layer_begin(video_info);
+   return false;
+}
+
+void menu_display_layer_end(video_frame_info_t *video_info)
+{
+   if (menu_disp && menu_disp->layer_end)
+      menu_disp->layer_end(video_info);
+}
+
+/* Returns false if there is no layer to draw */
+bool menu_display_layer_draw(video_frame_info_t *video_info)
+{
+   if (menu_disp && menu_disp->layer_draw)
+      return menu_disp->layer_draw(video_info);
+   return false;
+}
+
 /* Teardown; deinitializes and frees all
  * fonts associated to the menu driver */
 void menu_display_font_free(font_data_t *font)
@@ -3161,7 +3266,7 @@ bool menu_display_reset_textures_list(
    if (!path_is_valid(texpath))
       return false;
 
-   if (!image_texture_load(&ti, texpath))
+   if (!video_image_cache_load(&ti, texpath))
       return false;
 
    if (width)
@@ -3362,6 +3467,15 @@ const char *menu_driver_ident(void)
   return menu_driver_ctx->ident;
 }
 
+bool menu_driver_frame_is_static(void)
+{
+   if (!menu_driver_is_alive())
+      return false;
+   if (!menu_driver_ctx || !menu_driver_ctx->frame_is_static)
+      return false;
+   return menu_driver_ctx->frame_is_static(menu_userdata);
+}
+
 void menu_driver_frame(video_frame_info_t *video_info)
 {
    if (video_info->menu_is_alive && menu_driver_ctx->frame)
@@ -3375,11 +3489,55 @@ bool menu_driver_get_load_content_animation_data(menu_texture_item *icon, char *
 }
 
 /* Iterate the menu driver for one frame. */
+static void menu_driver_preload_update(void)
+{
+   const struct playlist_entry *entry = NULL;
+   settings_t *settings               = config_get_ptr();
+   file_list_t *list                  = menu_entries_get_selection_buf_ptr_internal(0);
+   size_t selection                   = menu_navigation_get_selection();
+   playlist_t *playlist               = NULL;
+   size_t idx;
+
+   if (!settings->bools.content_preload || !list || selection >= list->size)
+      return;
+
+   if (     list      != menu_driver_preload_list
+         || selection != menu_driver_preload_selection)
+   {
+      menu_driver_preload_list      = list;
+      menu_driver_preload_selection = selection;
+      menu_driver_preload_time_us   = menu_driver_current_time_us;
+      menu_driver_preload_done      = false;
+      return;
+   }
+
+   /* Not while scrolling through */
+   if (menu_driver_preload_done || menu_driver_current_time_us
+         - menu_driver_preload_time_us < MENU_PRELOAD_DELAY_US)
+      return;
+
+   menu_driver_preload_done = true;
+
+   if (list->list[selection].type != FILE_TYPE_RPL_ENTRY)
+      return;
+
+   playlist = playlist_get_cached();
+   idx      = list->list[selection].entry_idx;
+   if (!playlist || idx >= playlist_size(playlist))
+      return;
+
+   playlist_get_index(playlist, idx, &entry);
+   if (entry)
+      task_push_content_preload(entry->path, entry->core_path);
+}
+
 bool menu_driver_iterate(menu_ctx_iterate_t *iterate)
 {
    /* Get current time */
    menu_driver_current_time_us = cpu_features_get_time_usec();
 
+   menu_driver_preload_update();
+
    if (menu_driver_pending_quick_menu)
    {
       /* If the user had requested that the Quick Menu
@@ -259,6 +259,11 @@ typedef struct menu_display_ctx_driver
    /* Enables and disables scissoring */
    void (*scissor_begin)(video_frame_info_t *video_info, int x, int y, unsigned width, unsigned height);
    void (*scissor_end)(video_frame_info_t *video_info);
+   /* Optional. Draws go into a layer kept until the next layer_begin,
+    * layer_draw blends it onto the screen. */
+   bool (*layer_begin)(video_frame_info_t *video_info);
+   void (*layer_end)(video_frame_info_t *video_info);
+   bool (*layer_draw)(video_frame_info_t *video_info);
 } menu_display_ctx_driver_t;
 
 typedef struct menu_ctx_driver
@@ -342,6 +347,10 @@ typedef struct menu_ctx_driver
    /* This will be invoked whenever a menu entry action
     * (menu_entry_action()) is performed */
    int (*entry_action)(void *userdata, menu_entry_t *entry, size_t i, enum menu_action action);
+   /* Returns true if what the driver draws only changes with
+    * input, animations, messages and the like, so an unchanged
+    * frame may be left on screen. NULL if it may always change */
+   bool (*frame_is_static)(void *userdata);
 } menu_ctx_driver_t;
 
 
@@ -526,6 +535,10 @@ const char* config_get_menu_driver_options(void);
 
 const char *menu_driver_ident(void);
 
+/* Whether the frame the menu driver draws only changes
+ * with input, animations and the like */
+bool menu_driver_frame_is_static(void);
+
 bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data);
 
 void menu_driver_frame(video_frame_info_t *video_info);
@@ -572,6 +585,10 @@ void menu_display_blend_end(video_frame_info_t *video_info);
 void menu_display_scissor_begin(video_frame_info_t *video_info, int x, int y, unsigned width, unsigned height);
 void menu_display_scissor_end(video_frame_info_t *video_info);
 
+bool menu_display_layer_begin(video_frame_info_t *video_info);
+void menu_display_layer_end(video_frame_info_t *video_info);
+bool menu_display_layer_draw(video_frame_info_t *video_info);
+
 void menu_display_font_free(font_data_t *font);
 
 void menu_display_coords_array_reset(void);
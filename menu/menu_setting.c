@@ -6358,6 +6358,8 @@ void general_write_handler(rarch_setting_t *setting)
    if (!setting)
       return;
 
+   video_driver_info_invalidate();
+
    if (setting->cmd_trigger.idx != CMD_EVENT_NONE)
    {
       uint64_t flags = setting->flags;
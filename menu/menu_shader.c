@@ -226,7 +226,7 @@ static bool menu_shader_manager_save_preset_internal(
       const struct video_shader *shader, const char *basename,
       const char *dir_video_shader,
       const char *dir_menu_config,
-      bool apply, bool save_reference)
+      bool apply, bool save_reference, bool live)
 {
    bool ret                       = false;
    enum rarch_shader_type type    = RARCH_SHADER_NONE;
@@ -327,7 +327,18 @@ static bool menu_shader_manager_save_preset_internal(
    }
 
    if (ret && apply)
-      menu_shader_manager_set_preset(NULL, type, preset_path, true);
+   {
+      /* Only parameters or framebuffer settings changed:
+       * the running shader is updated, not compiled again */
+      if (live && video_shader_driver_update_current(shader))
+      {
+         RARCH_LOG("Updated running shader from %s.\n", preset_path);
+         retroarch_set_shader_preset(preset_path);
+         menu_shader_set_modified(false);
+      }
+      else
+         menu_shader_manager_set_preset(NULL, type, preset_path, true);
+   }
 
    return ret;
 }
@@ -406,7 +417,7 @@ static bool menu_shader_manager_operate_auto_preset(
                shader, file,
                dir_video_shader,
                dir_menu_config,
-               apply, true);
+               apply, true, false);
       case AUTO_SHADER_OP_REMOVE:
          {
             /* remove all supported auto-shaders of given type */
@@ -500,7 +511,7 @@ bool menu_shader_manager_save_preset(const struct video_shader *shader,
          shader, basename,
          dir_video_shader,
          dir_menu_config,
-         apply, false);
+         apply, false, false);
 }
 
 /**
@@ -673,13 +684,16 @@ enum rarch_shader_type menu_shader_manager_get_type(
 
 /**
  * menu_shader_manager_apply_changes:
+ * @reload                   : Compile the shader again, as its
+ *                             files changed.
  *
  * Apply shader state changes.
  **/
 void menu_shader_manager_apply_changes(
       struct video_shader *shader,
       const char *dir_video_shader,
-      const char *dir_menu_config)
+      const char *dir_menu_config,
+      bool reload)
 {
    enum rarch_shader_type type = RARCH_SHADER_NONE;
 
@@ -690,8 +704,8 @@ void menu_shader_manager_apply_changes(
 
    if (shader->passes && type != RARCH_SHADER_NONE)
    {
-      menu_shader_manager_save_preset(shader, NULL,
-            dir_video_shader, dir_menu_config, true);
+      menu_shader_manager_save_preset_internal(shader, NULL,
+            dir_video_shader, dir_menu_config, true, false, !reload);
       return;
    }
 
@@ -104,13 +104,16 @@ enum rarch_shader_type menu_shader_manager_get_type(
 
 /**
  * menu_shader_manager_apply_changes:
+ * @reload                   : Compile the shader again, as its
+ *                             files changed.
  *
  * Apply shader state changes.
  **/
 void menu_shader_manager_apply_changes(
       struct video_shader *shader,
       const char *dir_video_shader,
-      const char *dir_menu_config);
+      const char *dir_menu_config,
+      bool reload);
 
 int menu_shader_manager_clear_num_passes(struct video_shader *shader);
 
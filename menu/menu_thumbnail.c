@@ -60,14 +60,65 @@ static float menu_thumbnail_fade_duration = DEFAULT_MENU_THUMBNAIL_FADE_DURATION
  * at the time when the load completes */
 static uint64_t menu_thumbnail_list_id = 0;
 
+/* Uploaded thumbnails are limited to a fixed amount of
+ * video memory. When a new image would exceed it, the
+ * least recently drawn thumbnails are released (and will
+ * be streamed back in when required). Thumbnails drawn
+ * within the last MENU_THUMBNAIL_EVICT_DELAY us are
+ * never released, so the budget may be exceeded when
+ * everything on screen doesn't fit */
+#define MENU_THUMBNAIL_VRAM_BUDGET   (32 * 1024 * 1024)
+#define MENU_THUMBNAIL_MAX_RESIDENT  256
+#define MENU_THUMBNAIL_EVICT_DELAY   500000
+static menu_thumbnail_t *menu_thumbnail_resident[MENU_THUMBNAIL_MAX_RESIDENT];
+static unsigned menu_thumbnail_resident_count = 0;
+static size_t menu_thumbnail_resident_size    = 0;
+
+/* Image loads share the time the task queue has, so
+ * the number in flight is capped to keep that time for
+ * the entries that matter. Streamed thumbnails that are
+ * ready to be loaded are queued each frame, and
+ * menu_thumbnail_process_requests() then loads the ones
+ * nearest to the selection, looking further ahead in the
+ * direction it moves. Loads of thumbnails that are reset
+ * before they finish (i.e. scrolled off screen) are
+ * cancelled, freeing their slot */
+#define MENU_THUMBNAIL_MAX_IN_FLIGHT 4
+#define MENU_THUMBNAIL_MAX_QUEUED    32
+
 /* Utility structure, sent as userdata when pushing
  * an image load */
-typedef struct
+typedef struct menu_thumbnail_tag
 {
    menu_thumbnail_t *thumbnail;
+   retro_task_t *task;
+   struct menu_thumbnail_tag *next;
    retro_time_t list_id;
 } menu_thumbnail_tag_t;
 
+/* Streamed thumbnail(s) of an entry, waiting for a
+ * free image load */
+typedef struct
+{
+   menu_thumbnail_path_data_t *path_data;
+   playlist_t *playlist;
+   menu_thumbnail_t *thumbnail;
+   menu_thumbnail_t *left_thumbnail;
+   size_t idx;
+   size_t distance;
+   enum menu_thumbnail_id thumbnail_id;
+   unsigned upscale_threshold;
+   bool network_on_demand_thumbnails;
+} menu_thumbnail_queued_t;
+
+static menu_thumbnail_tag_t *menu_thumbnail_in_flight = NULL;
+static unsigned menu_thumbnail_in_flight_count        = 0;
+
+static menu_thumbnail_queued_t menu_thumbnail_queue[MENU_THUMBNAIL_MAX_QUEUED];
+static unsigned menu_thumbnail_queue_count            = 0;
+static size_t menu_thumbnail_last_selection           = 0;
+static bool menu_thumbnail_moving_up                  = false;
+
 /* Setters */
 
 /* When streaming thumbnails, sets time in ms that an
@@ -101,8 +152,98 @@ float menu_thumbnail_get_fade_duration(void)
    return menu_thumbnail_fade_duration;
 }
 
+/* Residency */
+
+/* Estimated video memory used by a thumbnail,
+ * including its mipmaps */
+static size_t menu_thumbnail_get_size(const menu_thumbnail_t *thumbnail)
+{
+   return (size_t)thumbnail->width * thumbnail->height * sizeof(uint32_t)
+      * 4 / 3;
+}
+
+static void menu_thumbnail_resident_remove(menu_thumbnail_t *thumbnail)
+{
+   unsigned i;
+
+   for (i = 0; i < menu_thumbnail_resident_count; i++)
+   {
+      if (menu_thumbnail_resident[i] != thumbnail)
+         continue;
+
+      menu_thumbnail_resident_size -= menu_thumbnail_get_size(thumbnail);
+      menu_thumbnail_resident[i]    = menu_thumbnail_resident[
+         --menu_thumbnail_resident_count];
+      return;
+   }
+}
+
+/* Releases least recently drawn thumbnails until
+ * an image of the specified size can be uploaded */
+static void menu_thumbnail_resident_make_room(size_t size)
+{
+   retro_time_t min_time = cpu_features_get_time_usec()
+      - MENU_THUMBNAIL_EVICT_DELAY;
+
+   while (menu_thumbnail_resident_count &&
+         ((menu_thumbnail_resident_size + size > MENU_THUMBNAIL_VRAM_BUDGET) ||
+          (menu_thumbnail_resident_count >= MENU_THUMBNAIL_MAX_RESIDENT)))
+   {
+      unsigned i;
+      menu_thumbnail_t *oldest = NULL;
+
+      for (i = 0; i < menu_thumbnail_resident_count; i++)
+      {
+         menu_thumbnail_t *thumbnail = menu_thumbnail_resident[i];
+
+         if (thumbnail->last_drawn < min_time &&
+               (!oldest || thumbnail->last_drawn < oldest->last_drawn))
+            oldest = thumbnail;
+      }
+
+      if (!oldest)
+         break;
+
+      menu_thumbnail_reset(oldest);
+   }
+}
+
 /* Callbacks */
 
+/* Image loads in flight */
+
+static void menu_thumbnail_in_flight_remove(menu_thumbnail_tag_t *thumbnail_tag)
+{
+   menu_thumbnail_tag_t **tag = &menu_thumbnail_in_flight;
+
+   for (; *tag; tag = &(*tag)->next)
+   {
+      if (*tag == thumbnail_tag)
+      {
+         *tag = thumbnail_tag->next;
+         menu_thumbnail_in_flight_count--;
+         return;
+      }
+   }
+}
+
+/* Cancels the load of the specified thumbnail (or of all
+ * thumbnails if NULL). The task still runs its callback,
+ * which then finds the tag detached */
+static void menu_thumbnail_cancel_load(menu_thumbnail_t *thumbnail)
+{
+   menu_thumbnail_tag_t *tag = menu_thumbnail_in_flight;
+
+   for (; tag; tag = tag->next)
+   {
+      if (!tag->thumbnail || (thumbnail && tag->thumbnail != thumbnail))
+         continue;
+
+      task_set_cancelled(tag->task, true);
+      tag->thumbnail = NULL;
+   }
+}
+
 /* Used to process thumbnail data following completion
  * of image load task */
 static void menu_thumbnail_handle_upload(
@@ -116,6 +257,12 @@ static void menu_thumbnail_handle_upload(
    if (!thumbnail_tag)
       goto end;
 
+   menu_thumbnail_in_flight_remove(thumbnail_tag);
+
+   /* Load was cancelled */
+   if (!thumbnail_tag->thumbnail)
+      goto end;
+
    /* Ensure that we are operating on the correct
     * thumbnail... */
    if (thumbnail_tag->list_id != menu_thumbnail_list_id)
@@ -143,6 +290,10 @@ static void menu_thumbnail_handle_upload(
    if ((img->width < 1) || (img->height < 1))
       goto end;
 
+   /* Keep within video memory budget */
+   menu_thumbnail_resident_make_room(
+         (size_t)img->width * img->height * sizeof(uint32_t) * 4 / 3);
+
    /* Upload texture to GPU */
    if (!video_driver_texture_load(
             img, TEXTURE_FILTER_MIPMAP_LINEAR, &thumbnail_tag->thumbnail->texture))
@@ -152,6 +303,16 @@ static void menu_thumbnail_handle_upload(
    thumbnail_tag->thumbnail->width  = img->width;
    thumbnail_tag->thumbnail->height = img->height;
 
+   /* Track residency */
+   thumbnail_tag->thumbnail->last_drawn = cpu_features_get_time_usec();
+   if (menu_thumbnail_resident_count < MENU_THUMBNAIL_MAX_RESIDENT)
+   {
+      menu_thumbnail_resident[menu_thumbnail_resident_count++] =
+            thumbnail_tag->thumbnail;
+      menu_thumbnail_resident_size +=
+            menu_thumbnail_get_size(thumbnail_tag->thumbnail);
+   }
+
    /* Update thumbnail status */
    thumbnail_tag->thumbnail->status = MENU_THUMBNAIL_STATUS_AVAILABLE;
 
@@ -196,6 +357,46 @@ end:
 void menu_thumbnail_cancel_pending_requests(void)
 {
    menu_thumbnail_list_id++;
+
+   menu_thumbnail_cancel_load(NULL);
+   menu_thumbnail_queue_count = 0;
+
+   /* Thumbnails may be deleted from here on, so
+    * they can no longer be tracked */
+   menu_thumbnail_resident_count = 0;
+   menu_thumbnail_resident_size  = 0;
+}
+
+/* Pushes an image load for the specified thumbnail,
+ * tracking it until its callback runs */
+static bool menu_thumbnail_push_load(const char *path,
+      menu_thumbnail_t *thumbnail, unsigned menu_thumbnail_upscale_threshold)
+{
+   menu_thumbnail_tag_t *thumbnail_tag =
+         (menu_thumbnail_tag_t*)calloc(1, sizeof(menu_thumbnail_tag_t));
+
+   if (!thumbnail_tag)
+      return false;
+
+   /* Configure user data */
+   thumbnail_tag->thumbnail = thumbnail;
+   thumbnail_tag->list_id   = menu_thumbnail_list_id;
+   thumbnail_tag->task      = (retro_task_t*)task_push_image_load(
+         path, video_driver_supports_rgba(),
+         menu_thumbnail_upscale_threshold,
+         menu_thumbnail_handle_upload, thumbnail_tag);
+
+   if (!thumbnail_tag->task)
+   {
+      free(thumbnail_tag);
+      return false;
+   }
+
+   thumbnail_tag->next       = menu_thumbnail_in_flight;
+   menu_thumbnail_in_flight  = thumbnail_tag;
+   menu_thumbnail_in_flight_count++;
+
+   return true;
 }
 
 /* Requests loading of the specified thumbnail
@@ -238,22 +439,8 @@ void menu_thumbnail_request(
    {
       if (path_is_valid(thumbnail_path))
       {
-         menu_thumbnail_tag_t *thumbnail_tag =
-               (menu_thumbnail_tag_t*)calloc(1, sizeof(menu_thumbnail_tag_t));
-
-         if (!thumbnail_tag)
-            return;
-
-         /* Configure user data */
-         thumbnail_tag->thumbnail = thumbnail;
-         thumbnail_tag->list_id   = menu_thumbnail_list_id;
-
-         /* Would like to cancel any existing image load tasks
-          * here, but can't see how to do it... */
-         if (task_push_image_load(
-               thumbnail_path, video_driver_supports_rgba(),
-               menu_thumbnail_upscale_threshold,
-               menu_thumbnail_handle_upload, thumbnail_tag))
+         if (menu_thumbnail_push_load(thumbnail_path, thumbnail,
+               menu_thumbnail_upscale_threshold))
             thumbnail->status = MENU_THUMBNAIL_STATUS_PENDING;
       }
 #ifdef HAVE_NETWORKING
@@ -314,8 +501,6 @@ void menu_thumbnail_request_file(
       unsigned menu_thumbnail_upscale_threshold
       )
 {
-   menu_thumbnail_tag_t *thumbnail_tag = NULL;
-
    if (!thumbnail)
       return;
 
@@ -332,21 +517,8 @@ void menu_thumbnail_request_file(
       return;
 
    /* Load thumbnail */
-   thumbnail_tag = (menu_thumbnail_tag_t*)calloc(1, sizeof(menu_thumbnail_tag_t));
-
-   if (!thumbnail_tag)
-      return;
-
-   /* Configure user data */
-   thumbnail_tag->thumbnail = thumbnail;
-   thumbnail_tag->list_id   = menu_thumbnail_list_id;
-
-   /* Would like to cancel any existing image load tasks
-    * here, but can't see how to do it... */
-   if (task_push_image_load(
-         file_path, video_driver_supports_rgba(),
-         menu_thumbnail_upscale_threshold,
-         menu_thumbnail_handle_upload, thumbnail_tag))
+   if (menu_thumbnail_push_load(file_path, thumbnail,
+         menu_thumbnail_upscale_threshold))
       thumbnail->status = MENU_THUMBNAIL_STATUS_PENDING;
 }
 
@@ -357,10 +529,17 @@ void menu_thumbnail_reset(menu_thumbnail_t *thumbnail)
    if (!thumbnail)
       return;
 
+   /* Image is no longer wanted */
+   if (thumbnail->status == MENU_THUMBNAIL_STATUS_PENDING)
+      menu_thumbnail_cancel_load(thumbnail);
+
    if (thumbnail->texture)
    {
       menu_animation_ctx_tag tag = (uintptr_t)&thumbnail->alpha;
 
+      /* Stop tracking residency */
+      menu_thumbnail_resident_remove(thumbnail);
+
       /* Unload texture */
       video_driver_texture_unload(&thumbnail->texture);
 
@@ -375,17 +554,66 @@ void menu_thumbnail_reset(menu_thumbnail_t *thumbnail)
    thumbnail->height      = 0;
    thumbnail->alpha       = 0.0f;
    thumbnail->delay_timer = 0.0f;
+   thumbnail->last_drawn  = 0;
 }
 
 /* Stream processing */
 
+/* Queues the streamed thumbnail(s) of an entry for
+ * menu_thumbnail_process_requests(). When the queue is
+ * full, the farthest entry from the selection makes way */
+static void menu_thumbnail_queue_request(
+      menu_thumbnail_path_data_t *path_data,
+      playlist_t *playlist, size_t idx,
+      menu_thumbnail_t *thumbnail, enum menu_thumbnail_id thumbnail_id,
+      menu_thumbnail_t *left_thumbnail,
+      unsigned menu_thumbnail_upscale_threshold,
+      bool network_on_demand_thumbnails)
+{
+   menu_thumbnail_queued_t *queued = NULL;
+   size_t selection                = menu_navigation_get_selection();
+   size_t distance;
+   unsigned i;
+
+   /* Entries behind the selection as it moves
+    * count as twice as far */
+   if (idx > selection)
+      distance = (idx - selection) << (menu_thumbnail_moving_up ? 1 : 0);
+   else
+      distance = (selection - idx) << (menu_thumbnail_moving_up ? 0 : 1);
+
+   if (menu_thumbnail_queue_count < MENU_THUMBNAIL_MAX_QUEUED)
+      queued = &menu_thumbnail_queue[menu_thumbnail_queue_count++];
+   else
+   {
+      for (i = 0; i < MENU_THUMBNAIL_MAX_QUEUED; i++)
+         if (menu_thumbnail_queue[i].distance > distance
+               && (!queued || menu_thumbnail_queue[i].distance > queued->distance))
+            queued = &menu_thumbnail_queue[i];
+
+      if (!queued)
+         return;
+   }
+
+   queued->path_data                    = path_data;
+   queued->playlist                     = playlist;
+   queued->thumbnail                    = thumbnail;
+   queued->left_thumbnail               = left_thumbnail;
+   queued->idx                          = idx;
+   queued->distance                     = distance;
+   queued->thumbnail_id                 = thumbnail_id;
+   queued->upscale_threshold            = menu_thumbnail_upscale_threshold;
+   queued->network_on_demand_thumbnails = network_on_demand_thumbnails;
+}
+
 /* Handles streaming of the specified thumbnail as it moves
  * on/off screen
  * - Must be called each frame for every on-screen entry
  * - Must be called once for each entry as it moves off-screen
  *   (or can be called each frame - overheads are small)
  * NOTE 1: Must be called *after* menu_thumbnail_set_system()
- * NOTE 2: This function calls menu_thumbnail_set_content*()
+ * NOTE 2: Loads are requested by menu_thumbnail_process_requests(),
+ *         which calls menu_thumbnail_set_content*()
  * NOTE 3: This function is intended for use in situations
  *         where each menu entry has a *single* thumbnail.
  *         If each entry has two thumbnails, use
@@ -417,22 +645,11 @@ void menu_thumbnail_process_stream(
             if (!path_data || !playlist)
                return;
 
-            /* Update thumbnail content */
-            if (!menu_thumbnail_set_content_playlist(path_data, playlist, idx))
-            {
-               /* Content is invalid
-                * > Reset thumbnail and set missing status */
-               menu_thumbnail_reset(thumbnail);
-               thumbnail->status = MENU_THUMBNAIL_STATUS_MISSING;
-               return;
-            }
-
             /* Request image load */
-            menu_thumbnail_request(
-                  path_data, thumbnail_id, playlist, idx, thumbnail,
+            menu_thumbnail_queue_request(
+                  path_data, playlist, idx, thumbnail, thumbnail_id, NULL,
                   menu_thumbnail_upscale_threshold,
-                  network_on_demand_thumbnails
-                  );
+                  network_on_demand_thumbnails);
          }
       }
    }
@@ -456,7 +673,8 @@ void menu_thumbnail_process_stream(
  * - Must be called once for each entry as it moves off-screen
  *   (or can be called each frame - overheads are small)
  * NOTE 1: Must be called *after* menu_thumbnail_set_system()
- * NOTE 2: This function calls menu_thumbnail_set_content*()
+ * NOTE 2: Loads are requested by menu_thumbnail_process_requests(),
+ *         which calls menu_thumbnail_set_content*()
  * NOTE 3: This function is intended for use in situations
  *         where each menu entry has *two* thumbnails.
  *         If each entry only has a single thumbnail, use
@@ -510,38 +728,13 @@ void menu_thumbnail_process_streams(
             if (!path_data || !playlist)
                return;
 
-            /* Update thumbnail content */
-            if (!menu_thumbnail_set_content_playlist(path_data, playlist, idx))
-            {
-               /* Content is invalid
-                * > Reset thumbnail and set missing status */
-               if (request_right)
-               {
-                  menu_thumbnail_reset(right_thumbnail);
-                  right_thumbnail->status = MENU_THUMBNAIL_STATUS_MISSING;
-               }
-
-               if (request_left)
-               {
-                  menu_thumbnail_reset(left_thumbnail);
-                  left_thumbnail->status  = MENU_THUMBNAIL_STATUS_MISSING;
-               }
-
-               return;
-            }
-
-            /* Request image load */
-            if (request_right)
-               menu_thumbnail_request(
-                     path_data, MENU_THUMBNAIL_RIGHT, playlist, idx, right_thumbnail,
-                     menu_thumbnail_upscale_threshold,
-                     network_on_demand_thumbnails);
-
-            if (request_left)
-               menu_thumbnail_request(
-                     path_data, MENU_THUMBNAIL_LEFT, playlist, idx, left_thumbnail,
-                     menu_thumbnail_upscale_threshold,
-                     network_on_demand_thumbnails);
+            /* Request image load(s) */
+            menu_thumbnail_queue_request(
+                  path_data, playlist, idx,
+                  request_right ? right_thumbnail : NULL, MENU_THUMBNAIL_RIGHT,
+                  request_left  ? left_thumbnail  : NULL,
+                  menu_thumbnail_upscale_threshold,
+                  network_on_demand_thumbnails);
          }
       }
    }
@@ -564,6 +757,80 @@ void menu_thumbnail_process_streams(
    }
 }
 
+/* Loads the queued streamed thumbnails nearest to the
+ * selection, as far as image loads are free. The others
+ * are queued again on the next frame
+ * - Must be called each frame after the entries have been
+ *   processed by menu_thumbnail_process_stream*() */
+void menu_thumbnail_process_requests(void)
+{
+   size_t selection = menu_navigation_get_selection();
+   unsigned i, j;
+
+   if (selection != menu_thumbnail_last_selection)
+   {
+      menu_thumbnail_moving_up      = selection < menu_thumbnail_last_selection;
+      menu_thumbnail_last_selection = selection;
+   }
+
+   /* Nearest first */
+   for (i = 1; i < menu_thumbnail_queue_count; i++)
+   {
+      menu_thumbnail_queued_t queued = menu_thumbnail_queue[i];
+
+      for (j = i; j > 0 && menu_thumbnail_queue[j - 1].distance > queued.distance; j--)
+         menu_thumbnail_queue[j] = menu_thumbnail_queue[j - 1];
+      menu_thumbnail_queue[j] = queued;
+   }
+
+   for (i = 0; i < menu_thumbnail_queue_count; i++)
+   {
+      menu_thumbnail_queued_t *queued = &menu_thumbnail_queue[i];
+      menu_thumbnail_t *right         = queued->thumbnail;
+      menu_thumbnail_t *left          = queued->left_thumbnail;
+
+      if (menu_thumbnail_in_flight_count >= MENU_THUMBNAIL_MAX_IN_FLIGHT)
+         break;
+
+      /* Update thumbnail content */
+      if (!menu_thumbnail_set_content_playlist(
+               queued->path_data, queued->playlist, queued->idx))
+      {
+         /* Content is invalid
+          * > Reset thumbnail(s) and set missing status */
+         if (right)
+         {
+            menu_thumbnail_reset(right);
+            right->status = MENU_THUMBNAIL_STATUS_MISSING;
+         }
+
+         if (left)
+         {
+            menu_thumbnail_reset(left);
+            left->status  = MENU_THUMBNAIL_STATUS_MISSING;
+         }
+
+         continue;
+      }
+
+      if (right)
+         menu_thumbnail_request(
+               queued->path_data, queued->thumbnail_id,
+               queued->playlist, queued->idx, right,
+               queued->upscale_threshold,
+               queued->network_on_demand_thumbnails);
+
+      if (left)
+         menu_thumbnail_request(
+               queued->path_data, MENU_THUMBNAIL_LEFT,
+               queued->playlist, queued->idx, left,
+               queued->upscale_threshold,
+               queued->network_on_demand_thumbnails);
+   }
+
+   menu_thumbnail_queue_count = 0;
+}
+
 /* Thumbnail rendering */
 
 /* Determines the actual screen dimensions of a
@@ -657,6 +924,9 @@ void menu_thumbnail_draw(
          1.0f, 1.0f, 1.0f, 1.0f
       };
 
+      /* Mark as recently used */
+      thumbnail->last_drawn     = cpu_features_get_time_usec();
+
       /* Set thumbnail opacity */
       if (thumbnail_alpha <= 0.0f)
          return;
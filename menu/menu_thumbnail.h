@@ -72,6 +72,7 @@ typedef struct
    unsigned height;
    float alpha;
    float delay_timer;
+   retro_time_t last_drawn;
 } menu_thumbnail_t;
 
 /* Holds all configuration parameters associated
@@ -163,7 +164,8 @@ void menu_thumbnail_reset(menu_thumbnail_t *thumbnail);
  * - Must be called once for each entry as it moves off-screen
  *   (or can be called each frame - overheads are small)
  * NOTE 1: Must be called *after* menu_thumbnail_set_system()
- * NOTE 2: This function calls menu_thumbnail_set_content*()
+ * NOTE 2: Loads are requested by menu_thumbnail_process_requests(),
+ *         which calls menu_thumbnail_set_content*()
  * NOTE 3: This function is intended for use in situations
  *         where each menu entry has a *single* thumbnail.
  *         If each entry has two thumbnails, use
@@ -182,7 +184,8 @@ void menu_thumbnail_process_stream(
  * - Must be called once for each entry as it moves off-screen
  *   (or can be called each frame - overheads are small)
  * NOTE 1: Must be called *after* menu_thumbnail_set_system()
- * NOTE 2: This function calls menu_thumbnail_set_content*()
+ * NOTE 2: Loads are requested by menu_thumbnail_process_requests(),
+ *         which calls menu_thumbnail_set_content*()
  * NOTE 3: This function is intended for use in situations
  *         where each menu entry has *two* thumbnails.
  *         If each entry only has a single thumbnail, use
@@ -197,6 +200,13 @@ void menu_thumbnail_process_streams(
       bool network_on_demand_thumbnails
       );
 
+/* Loads the queued streamed thumbnails nearest to the
+ * selection, as far as image loads are free. The others
+ * are queued again on the next frame
+ * - Must be called each frame after the entries have been
+ *   processed by menu_thumbnail_process_stream*() */
+void menu_thumbnail_process_requests(void);
+
 /* Thumbnail rendering */
 
 /* Determines the actual screen dimensions of a
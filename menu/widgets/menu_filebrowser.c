@@ -14,7 +14,12 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
@@ -41,9 +46,226 @@
 #include "../../content.h"
 #include "../../verbosity.h"
 #include "../../dynamic.h"
+#include "../../tasks/tasks_internal.h"
+
+/* Directories opened last, listed and sorted, kept for as long as
+ * their mtime doesn't change */
+#define FILEBROWSER_LISTINGS       4
+/* A directory is read for this long, in usec, before a task is left
+ * to list the rest */
+#define FILEBROWSER_LIST_BUDGET    20000
+/* Entries read between time checks */
+#define FILEBROWSER_LIST_BATCH     64
+
+typedef struct filebrowser_listing
+{
+   struct string_list *list;   /* NULL if it couldn't be read */
+   char *exts;
+   int64_t mtime;
+   time_t listed;
+   unsigned id;
+   unsigned last_used;
+   bool show_hidden;
+   bool include_compressed;
+   bool pending;               /* A task is still listing it */
+   char path[PATH_MAX_LENGTH];
+} filebrowser_listing_t;
+
+static filebrowser_listing_t filebrowser_listings[FILEBROWSER_LISTINGS];
+static unsigned filebrowser_listing_count = 0;
 
 static enum filebrowser_enums filebrowser_types = FILEBROWSER_NONE;
 
+static bool filebrowser_dir_mtime(const char *path, int64_t *mtime)
+{
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   *mtime = (int64_t)st.st_mtime;
+   return true;
+}
+
+static void filebrowser_listing_free(filebrowser_listing_t *listing)
+{
+   string_list_free(listing->list);
+   free(listing->exts);
+   memset(listing, 0, sizeof(*listing));
+}
+
+static filebrowser_listing_t *filebrowser_listing_find(const char *path,
+      const char *exts, bool show_hidden, bool include_compressed)
+{
+   unsigned i;
+
+   for (i = 0; i < FILEBROWSER_LISTINGS; i++)
+   {
+      filebrowser_listing_t *listing = &filebrowser_listings[i];
+
+      if (     listing->id
+            && listing->show_hidden        == show_hidden
+            && listing->include_compressed == include_compressed
+            && string_is_equal(listing->path, path)
+            && string_is_equal(listing->exts ? listing->exts : "",
+               exts ? exts : ""))
+         return listing;
+   }
+
+   return NULL;
+}
+
+/* Takes the least recently used slot */
+static filebrowser_listing_t *filebrowser_listing_new(const char *path,
+      const char *exts, bool show_hidden, bool include_compressed,
+      int64_t mtime)
+{
+   filebrowser_listing_t *listing = &filebrowser_listings[0];
+   unsigned i;
+
+   for (i = 1; i < FILEBROWSER_LISTINGS; i++)
+      if (filebrowser_listings[i].last_used < listing->last_used)
+         listing = &filebrowser_listings[i];
+
+   filebrowser_listing_free(listing);
+
+   listing->id                 = ++filebrowser_listing_count;
+   listing->last_used          = listing->id;
+   listing->exts               = exts ? strdup(exts) : NULL;
+   listing->mtime              = mtime;
+   listing->listed             = time(NULL);
+   listing->show_hidden        = show_hidden;
+   listing->include_compressed = include_compressed;
+   strlcpy(listing->path, path, sizeof(listing->path));
+
+   return listing;
+}
+
+static void filebrowser_dir_list_cb(retro_task_t *task,
+      void *task_data, void *user_data, const char *error)
+{
+   struct string_list *list = (struct string_list*)task_data;
+   unsigned id              = (unsigned)(uintptr_t)user_data;
+   filebrowser_listing_t *listing = NULL;
+   const char *menu_path    = NULL;
+   unsigned i;
+
+   for (i = 0; i < FILEBROWSER_LISTINGS; i++)
+      if (filebrowser_listings[i].pending && filebrowser_listings[i].id == id)
+         listing = &filebrowser_listings[i];
+
+   if (!listing)
+   {
+      string_list_free(list);
+      return;
+   }
+
+   /* Stopped by another listing, read it again next time */
+   if (!list && !error)
+   {
+      filebrowser_listing_free(listing);
+      return;
+   }
+
+   if (list)
+      dir_list_sort(list, true);
+
+   listing->list    = list;
+   listing->pending = false;
+
+   /* Show it if the directory is still open */
+   menu_entries_get_last_stack(&menu_path, NULL, NULL, NULL, NULL);
+   if (string_is_equal(menu_path, listing->path))
+   {
+      bool refresh = false;
+      menu_entries_ctl(MENU_ENTRIES_CTL_SET_REFRESH, &refresh);
+   }
+}
+
+/* Returns the listing of a directory, sorted, which mustn't be freed.
+ * Directories too long to read right away are listed by a task,
+ * meanwhile NULL is returned with @pending set. */
+static struct string_list *filebrowser_dir_list(const char *path,
+      const char *exts, bool show_hidden, bool include_compressed,
+      bool *pending)
+{
+   filebrowser_listing_t *listing = NULL;
+   struct dir_list_reader *reader = NULL;
+   retro_time_t start             = cpu_features_get_time_usec();
+   int64_t mtime                  = 0;
+   int ret                        = 1;
+   bool has_mtime                 = filebrowser_dir_mtime(path, &mtime);
+
+   *pending = false;
+
+   listing = filebrowser_listing_find(path, exts,
+         show_hidden, include_compressed);
+
+   if (listing)
+   {
+      listing->last_used = ++filebrowser_listing_count;
+
+      if (listing->pending)
+      {
+         *pending = true;
+         return NULL;
+      }
+
+      /* FAT keeps mtimes to 2 seconds, a listing taken right after
+       * a change could have missed the next one */
+      if (     has_mtime
+            && listing->mtime == mtime
+            && (int64_t)listing->listed > mtime + 2)
+         return listing->list;
+   }
+
+   reader = dir_list_reader_new(path, exts, true,
+         show_hidden, include_compressed);
+   if (!reader)
+      return NULL;
+
+   while (ret == 1
+         && cpu_features_get_time_usec() - start < FILEBROWSER_LIST_BUDGET)
+      ret = dir_list_reader_read(reader, FILEBROWSER_LIST_BATCH);
+
+   if (ret == -1)
+   {
+      dir_list_reader_free(reader);
+      return NULL;
+   }
+
+   listing = filebrowser_listing_new(path, exts,
+         show_hidden, include_compressed, mtime);
+
+   if (ret == 0)
+   {
+      listing->list = dir_list_reader_take(reader);
+      dir_list_sort(listing->list, true);
+      return listing->list;
+   }
+
+   /* Only the last listing pushed carries on */
+   {
+      unsigned i;
+      for (i = 0; i < FILEBROWSER_LISTINGS; i++)
+         if (filebrowser_listings[i].pending)
+            filebrowser_listing_free(&filebrowser_listings[i]);
+   }
+
+   if (!task_push_dir_list(reader, path, filebrowser_dir_list_cb,
+            (void*)(uintptr_t)listing->id))
+   {
+      filebrowser_listing_free(listing);
+      return NULL;
+   }
+
+   RARCH_LOG("[Filebrowser]: Listing \"%s\" in the background.\n", path);
+
+   listing->pending = true;
+   *pending         = true;
+   return NULL;
+}
+
 enum filebrowser_enums filebrowser_get_type(void)
 {
    return filebrowser_types;
@@ -63,6 +285,8 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
 {
    size_t i, list_size;
    struct string_list *str_list         = NULL;
+   bool str_list_owned                  = true;
+   bool pending                         = false;
    unsigned items_found                 = 0;
    unsigned files_count                 = 0;
    unsigned dirs_count                  = 0;
@@ -104,20 +328,22 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
    {
       bool show_hidden_files = settings->bools.show_hidden_files;
 
+      str_list_owned         = false;
+
       if (filebrowser_types == FILEBROWSER_SELECT_FILE_SUBSYSTEM)
       {
          if (subsystem && subsystem_current_count > 0 && content_get_subsystem_rom_id() < subsystem->num_roms)
-            str_list = dir_list_new(path,
+            str_list = filebrowser_dir_list(path,
                   (filter_ext && info) ? subsystem->roms[content_get_subsystem_rom_id()].valid_extensions : NULL,
-                  true, show_hidden_files, true, false);
+                  show_hidden_files, true, &pending);
       }
       else if (info && ((info->type_default == FILE_TYPE_MANUAL_SCAN_DAT) || (info->type_default == FILE_TYPE_SIDELOAD_CORE)))
-         str_list = dir_list_new(path,
-               info->exts, true, show_hidden_files, false, false);
+         str_list = filebrowser_dir_list(path,
+               info->exts, show_hidden_files, false, &pending);
       else
-         str_list = dir_list_new(path,
+         str_list = filebrowser_dir_list(path,
                (filter_ext && info) ? info->exts : NULL,
-               true, show_hidden_files, true, false);
+               show_hidden_files, true, &pending);
    }
 
    switch (filebrowser_types)
@@ -152,6 +378,17 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
          break;
    }
 
+   if (pending)
+   {
+      if (info)
+         menu_entries_append_enum(info->list,
+               msg_hash_to_str(MSG_LOADING),
+               msg_hash_to_str(MENU_ENUM_LABEL_NO_ITEMS),
+               MENU_ENUM_LABEL_NO_ITEMS,
+               MENU_SETTING_NO_ITEM, 0, 0);
+      goto end;
+   }
+
    if (!str_list)
    {
       const char *str = path_is_compressed
@@ -164,16 +401,12 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
       goto end;
    }
 
-   dir_list_sort(str_list, true);
+   if (str_list_owned)
+      dir_list_sort(str_list, true);
 
    list_size = str_list->size;
 
-   if (list_size == 0)
-   {
-      string_list_free(str_list);
-      str_list = NULL;
-   }
-   else
+   if (list_size > 0)
    {
       for (i = 0; i < list_size; i++)
       {
@@ -311,7 +544,7 @@ void filebrowser_parse(menu_displaylist_info_t *info, unsigned type_data)
       }
    }
 
-   if (str_list && str_list->size > 0)
+   if (str_list_owned)
       string_list_free(str_list);
 
    if (items_found == 0)
@@ -60,6 +60,10 @@ static float msg_queue_task_progress_2[16] = COLOR_HEX_TO_FLOAT(0x317198, 1.0f);
 static float color_task_progress_bar[16] = COLOR_HEX_TO_FLOAT(0x22B14C, 1.0f);
 #endif
 
+/* Frame pacing graph */
+static float frame_pacing_on_time[16]    = COLOR_HEX_TO_FLOAT(0x22B14C, 0.8f);
+static float frame_pacing_missed[16]     = COLOR_HEX_TO_FLOAT(0xC23B22, 0.8f);
+
 static unsigned text_color_info        = 0xD8EEFFFF;
 #if 0
 static unsigned text_color_success     = 0x22B14CFF;
@@ -91,6 +95,10 @@ static float menu_widgets_pure_white[16] = {
 /* FPS */
 static char menu_widgets_fps_text[255] = {0};
 
+/* What the widgets layer was last drawn from */
+static uint32_t menu_widgets_layer_hash = 0;
+static bool menu_widgets_layer_valid    = false;
+
 /* Achievement notification */
 static char *cheevo_title              = NULL;
 static menu_texture_item cheevo_badge  = 0;
@@ -1351,9 +1359,224 @@ static void menu_widgets_draw_load_content_animation(video_frame_info_t *video_i
    menu_widgets_draw_backdrop(video_info, load_content_animation_final_fade_alpha);
 }
 
+static bool menu_widgets_visible(video_frame_info_t *video_info)
+{
+   return ai_service_overlay_state > 0
+      || libretro_message_alpha > 0.0f
+      || generic_message_alpha > 0.0f
+      || screenshot_loaded
+      || cheevo_title
+      || volume_alpha > 0.0f
+      || current_msgs->size > 0
+      || video_info->fps_show
+      || video_info->framecount_show
+      || video_info->memory_show
+      || video_info->widgets_is_paused
+      || video_info->widgets_is_fast_forwarding
+      || video_info->widgets_is_rewinding
+      || video_info->runloop_is_slowmotion
+      || screenshot_alpha > 0.0f
+      || load_content_animation_running;
+}
+
+#define MENU_WIDGETS_HASH(hash, value) \
+   hash = menu_widgets_hash_bytes(hash, &(value), sizeof(value))
+
+static uint32_t menu_widgets_hash_bytes(uint32_t hash,
+      const void *data, size_t len)
+{
+   const uint8_t *bytes = (const uint8_t*)data;
+   size_t i;
+
+   for (i = 0; i < len; i++)
+      hash = (hash ^ bytes[i]) * 16777619u;
+
+   return hash;
+}
+
+static uint32_t menu_widgets_hash_str(uint32_t hash, const char *str)
+{
+   if (str)
+      hash = menu_widgets_hash_bytes(hash, str, strlen(str) + 1);
+   return hash;
+}
+
+/* Everything the widgets are drawn from, for the layer to be drawn
+ * again only when one of them changed */
+static uint32_t menu_widgets_state_hash(video_frame_info_t *video_info,
+      float video_font_size)
+{
+   uint32_t hash = 2166136261u;
+   size_t i;
+
+   MENU_WIDGETS_HASH(hash, video_info->width);
+   MENU_WIDGETS_HASH(hash, video_info->height);
+   MENU_WIDGETS_HASH(hash, video_font_size);
+   MENU_WIDGETS_HASH(hash, video_info->fps_show);
+   MENU_WIDGETS_HASH(hash, video_info->framecount_show);
+   MENU_WIDGETS_HASH(hash, video_info->memory_show);
+   MENU_WIDGETS_HASH(hash, video_info->widgets_is_paused);
+   MENU_WIDGETS_HASH(hash, video_info->widgets_is_fast_forwarding);
+   MENU_WIDGETS_HASH(hash, video_info->widgets_is_rewinding);
+   MENU_WIDGETS_HASH(hash, video_info->runloop_is_slowmotion);
+   hash = menu_widgets_hash_str(hash, menu_widgets_fps_text);
+
+   MENU_WIDGETS_HASH(hash, ai_service_overlay_state);
+   MENU_WIDGETS_HASH(hash, ai_service_overlay_texture);
+
+   MENU_WIDGETS_HASH(hash, libretro_message_alpha);
+   MENU_WIDGETS_HASH(hash, libretro_message_width);
+   if (libretro_message_alpha > 0.0f)
+      hash = menu_widgets_hash_str(hash, libretro_message);
+
+   MENU_WIDGETS_HASH(hash, generic_message_alpha);
+   if (generic_message_alpha > 0.0f)
+      hash = menu_widgets_hash_str(hash, generic_message);
+
+   MENU_WIDGETS_HASH(hash, screenshot_loaded);
+   MENU_WIDGETS_HASH(hash, screenshot_alpha);
+   if (screenshot_loaded)
+   {
+      uint64_t ticker_idx = menu_animation_get_ticker_idx();
+
+      MENU_WIDGETS_HASH(hash, ticker_idx);
+      MENU_WIDGETS_HASH(hash, screenshot_y);
+      MENU_WIDGETS_HASH(hash, screenshot_texture);
+      hash = menu_widgets_hash_str(hash, screenshot_shotname);
+   }
+
+   hash = menu_widgets_hash_str(hash, cheevo_title);
+   MENU_WIDGETS_HASH(hash, cheevo_unfold);
+   MENU_WIDGETS_HASH(hash, cheevo_y);
+   MENU_WIDGETS_HASH(hash, cheevo_badge);
+
+   MENU_WIDGETS_HASH(hash, volume_alpha);
+   MENU_WIDGETS_HASH(hash, volume_text_alpha);
+   MENU_WIDGETS_HASH(hash, volume_percent);
+   MENU_WIDGETS_HASH(hash, volume_db);
+   MENU_WIDGETS_HASH(hash, volume_mute);
+
+   for (i = 0; i < current_msgs->size; i++)
+   {
+      menu_widget_msg_t *msg = (menu_widget_msg_t*)
+         file_list_get_userdata_at_offset(current_msgs, i);
+      bool is_task           = msg && msg->task_ptr;
+
+      if (!msg)
+         continue;
+
+      hash = menu_widgets_hash_str(hash, msg->msg);
+      hash = menu_widgets_hash_str(hash, msg->msg_new);
+      MENU_WIDGETS_HASH(hash, is_task);
+      MENU_WIDGETS_HASH(hash, msg->msg_transition_animation);
+      MENU_WIDGETS_HASH(hash, msg->text_height);
+      MENU_WIDGETS_HASH(hash, msg->offset_y);
+      MENU_WIDGETS_HASH(hash, msg->alpha);
+      MENU_WIDGETS_HASH(hash, msg->width);
+      MENU_WIDGETS_HASH(hash, msg->task_count);
+      MENU_WIDGETS_HASH(hash, msg->task_progress);
+      MENU_WIDGETS_HASH(hash, msg->task_finished);
+      MENU_WIDGETS_HASH(hash, msg->task_error);
+      MENU_WIDGETS_HASH(hash, msg->unfolded);
+      MENU_WIDGETS_HASH(hash, msg->unfolding);
+      MENU_WIDGETS_HASH(hash, msg->unfold);
+      MENU_WIDGETS_HASH(hash, msg->hourglass_rotation);
+   }
+
+   return hash;
+}
+
+/* Whether the widgets draw anything, and a hash of everything
+ * they are drawn from. Changes every frame while something
+ * is shown that the hash can't follow. */
+bool menu_widgets_get_state(void *data, uint32_t *hash)
+{
+   video_frame_info_t *video_info = (video_frame_info_t*)data;
+   settings_t *settings           = config_get_ptr();
+
+   if (video_info->statistics_show || load_content_animation_running)
+   {
+      *hash = (uint32_t)menu_widgets_frame_count;
+      return true;
+   }
+
+   if (!menu_widgets_visible(video_info))
+   {
+      *hash = 0;
+      return false;
+   }
+
+   *hash = menu_widgets_state_hash(video_info,
+         settings->floats.video_font_size);
+   return true;
+}
+
+/* Frame times of the last FRAME_PACING_SAMPLES frames, in the
+ * bottom right corner. The line is the deadline, frames that
+ * missed it are red. */
+static void menu_widgets_draw_frame_pacing(video_frame_info_t *video_info)
+{
+   unsigned i;
+   const frame_pacing_t *pacing = video_driver_get_frame_pacing();
+   unsigned bar_width           = MAX(video_info->width / 640, 1);
+   unsigned graph_width         = bar_width * FRAME_PACING_SAMPLES;
+   unsigned graph_height        = simple_widget_height * 2;
+   int x                        = video_info->width - graph_width
+      - simple_widget_padding;
+   int y                        = video_info->height - graph_height
+      - simple_widget_padding;
+   unsigned frames;
+
+   if (!pacing || !pacing->deadline || x < 0 || y < 0)
+      return;
+
+   frames = MIN(pacing->count, FRAME_PACING_SAMPLES);
+
+   menu_display_set_viewport(video_info->width, video_info->height);
+
+   menu_display_set_alpha(menu_widgets_backdrop_orig, DEFAULT_BACKDROP);
+   menu_display_draw_quad(video_info,
+      x, y, graph_width, graph_height,
+      video_info->width, video_info->height,
+      menu_widgets_backdrop_orig
+   );
+
+   /* Oldest on the left, twice the deadline is the top */
+   for (i = 0; i < frames; i++)
+   {
+      unsigned idx            = (pacing->count - frames + i)
+         & (FRAME_PACING_SAMPLES - 1);
+      retro_time_t frame_time = pacing->frame_time[idx];
+      unsigned bar_height     = (unsigned)MIN(frame_time * graph_height
+            / (2 * pacing->deadline), (retro_time_t)graph_height);
+
+      if (!bar_height)
+         continue;
+
+      menu_display_draw_quad(video_info,
+         x + i * bar_width, y + graph_height - bar_height,
+         bar_width, bar_height,
+         video_info->width, video_info->height,
+         pacing->culprit[idx] == FRAME_PACING_STAGE_LAST
+         ? frame_pacing_on_time : frame_pacing_missed
+      );
+   }
+
+   menu_display_set_alpha(menu_widgets_pure_white, 1.0f);
+   menu_display_draw_quad(video_info,
+      x, y + graph_height / 2, graph_width, 1,
+      video_info->width, video_info->height,
+      menu_widgets_pure_white
+   );
+
+   menu_display_unset_viewport(video_info->width, video_info->height);
+}
+
 void menu_widgets_frame(void *data)
 {
    size_t i;
+   uint32_t layer_hash            = 0;
+   bool layer                     = false;
    video_frame_info_t *video_info = (video_frame_info_t*)data;
    int top_right_x_advance        = video_info->width;
    int scissor_me_timbers         = 0;
@@ -1362,6 +1585,29 @@ void menu_widgets_frame(void *data)
 
    menu_widgets_frame_count++;
 
+   /* Changes every frame, so it's kept out of the layer */
+   if (video_info->statistics_show)
+      menu_widgets_draw_frame_pacing(video_info);
+
+   if (!menu_widgets_visible(video_info))
+      return;
+
+   /* The load content animation covers the screen,
+    * it's drawn straight to it */
+   if (settings->bools.menu_widgets_layer && !load_content_animation_running)
+   {
+      layer_hash = menu_widgets_state_hash(video_info, video_font_size);
+
+      if (     menu_widgets_layer_valid
+            && layer_hash == menu_widgets_layer_hash
+            && menu_display_layer_draw(video_info))
+         return;
+
+      layer = menu_display_layer_begin(video_info);
+   }
+
+   menu_widgets_layer_valid = false;
+
    menu_display_set_viewport(video_info->width, video_info->height);
 
    /* Font setup */
@@ -1838,6 +2084,13 @@ void menu_widgets_frame(void *data)
    }
 
    menu_display_unset_viewport(video_info->width, video_info->height);
+
+   if (layer)
+   {
+      menu_display_layer_end(video_info);
+      menu_widgets_layer_valid = menu_display_layer_draw(video_info);
+      menu_widgets_layer_hash  = layer_hash;
+   }
 }
 
 bool menu_widgets_init(bool video_is_threaded)
@@ -2006,6 +2259,8 @@ void menu_widgets_context_destroy(void)
 {
    int i;
 
+   menu_widgets_layer_valid = false;
+
    /* TODO: Dismiss onscreen notifications that have been freed */
 
    /* Textures */
@@ -94,6 +94,8 @@ void menu_widgets_set_libretro_message(const char *message, unsigned duration);
  * enable_menu_widgets to true for that driver */
 void menu_widgets_frame(void *data);
 
+bool menu_widgets_get_state(void *data, uint32_t *hash);
+
 bool menu_widgets_set_fps_text(const char *new_fps_text);
 
 #endif
@@ -455,6 +455,7 @@ enum msg_hash_enums
    MSG_RUNAHEAD_FAILED_TO_SAVE_STATE,
    MSG_RUNAHEAD_FAILED_TO_LOAD_STATE,
    MSG_RUNAHEAD_FAILED_TO_CREATE_SECONDARY_INSTANCE,
+   MSG_RUNAHEAD_BENCHMARK_RESULT,
    MSG_MISSING_ASSETS,
 #ifdef HAVE_LAKKA
    MSG_LOCALAP_SWITCHING_OFF,
@@ -1712,6 +1713,7 @@ enum msg_hash_enums
    MENU_LABEL(RUN_AHEAD_SECONDARY_INSTANCE),
    MENU_LABEL(RUN_AHEAD_HIDE_WARNINGS),
    MENU_LABEL(RUN_AHEAD_FRAMES),
+   MENU_LABEL(RUN_AHEAD_BENCHMARK),
    MENU_LABEL(INPUT_BLOCK_TIMEOUT),
    MENU_LABEL(TURBO),
 
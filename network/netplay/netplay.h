@@ -62,9 +62,51 @@ enum rarch_netplay_ctl_state
    RARCH_NETPLAY_CTL_DISCONNECT,
    RARCH_NETPLAY_CTL_FINISHED_NAT_TRAVERSAL,
    RARCH_NETPLAY_CTL_DESYNC_PUSH,
-   RARCH_NETPLAY_CTL_DESYNC_POP
+   RARCH_NETPLAY_CTL_DESYNC_POP,
+   RARCH_NETPLAY_CTL_GET_STATS
 };
 
+/* Rollbacks of 1 .. NETPLAY_STATS_DEPTHS - 1 frames are counted by depth,
+ * deeper ones together */
+#define NETPLAY_STATS_DEPTHS    8
+#define NETPLAY_STATS_MAX_PEERS 4
+
+typedef struct netplay_peer_stats
+{
+   char nick[32];
+
+   /* Round trip time and its jitter, in usec, or -1 if the peer is too old
+    * to answer pings */
+   int64_t rtt;
+   int64_t jitter;
+
+   uint64_t bytes_sent;
+   uint64_t bytes_received;
+} netplay_peer_stats_t;
+
+/* Filled in by RARCH_NETPLAY_CTL_GET_STATS */
+typedef struct netplay_stats
+{
+   int input_latency_frames;
+
+   unsigned rollbacks;
+   unsigned rollback_max;
+   unsigned rollback_depths[NETPLAY_STATS_DEPTHS];
+
+   /* Frames run again by rollbacks in the last second or so */
+   float replayed_per_second;
+
+   unsigned crc_mismatches;
+
+   /* Over every connection, UDP included */
+   uint64_t bytes_sent;
+   uint64_t bytes_received;
+
+   /* Connected peers; only the first NETPLAY_STATS_MAX_PEERS are listed */
+   unsigned peer_count;
+   netplay_peer_stats_t peers[NETPLAY_STATS_MAX_PEERS];
+} netplay_stats_t;
+
 /* Preferences for sharing digital devices */
 enum rarch_netplay_share_digital_preference
 {
@@ -20,6 +20,34 @@
 
 #include "netplay_private.h"
 
+#if (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || \
+      defined(__OpenBSD__) || defined(__NetBSD__)) && \
+      !defined(HAVE_SOCKET_LEGACY)
+#include <sys/uio.h>
+#define HAVE_NETPLAY_SENDMSG
+#endif
+
+/* Below this, copying into the buffer is cheaper than gathering */
+#define NETPLAY_GATHER_MIN 4096
+
+/* Most pieces netplay_send_gather takes */
+#define NETPLAY_GATHER_MAX 4
+
+/* Buffers of relayed connections are shared with the relay thread */
+#ifdef HAVE_THREADS
+#define buf_lock(sbuf) \
+   if ((sbuf)->lock) \
+      slock_lock((sbuf)->lock)
+#define buf_unlock(sbuf) \
+   if ((sbuf)->lock) \
+      slock_unlock((sbuf)->lock)
+#else
+#define buf_lock(sbuf)
+#define buf_unlock(sbuf)
+#endif
+
+static bool buf_flush(struct socket_buffer *sbuf, int sockfd, bool block);
+
 static size_t buf_used(struct socket_buffer *sbuf)
 {
    if (sbuf->end < sbuf->start)
@@ -51,6 +79,73 @@ static size_t buf_remaining(struct socket_buffer *sbuf)
    return sbuf->bufsz - buf_used(sbuf) - 1;
 }
 
+#ifdef HAVE_NETPLAY_SENDMSG
+/* Send what's queued, followed by the given pieces, in a single call without
+ * blocking. Returns how much was sent, or -1 on failure. */
+static ssize_t buf_sendmsg(struct socket_buffer *sbuf, int sockfd,
+      const void **bufs, const size_t *lens, size_t count)
+{
+   struct iovec iov[2 + NETPLAY_GATHER_MAX];
+   struct msghdr msg;
+   ssize_t sent;
+   size_t i;
+   size_t iovcnt = 0;
+
+   if (sbuf->end > sbuf->start)
+   {
+      iov[iovcnt].iov_base   = sbuf->data + sbuf->start;
+      iov[iovcnt++].iov_len  = sbuf->end - sbuf->start;
+   }
+   else if (sbuf->end < sbuf->start)
+   {
+      /* Both halves of a buffer that wraps */
+      iov[iovcnt].iov_base   = sbuf->data + sbuf->start;
+      iov[iovcnt++].iov_len  = sbuf->bufsz - sbuf->start;
+      if (sbuf->end)
+      {
+         iov[iovcnt].iov_base  = sbuf->data;
+         iov[iovcnt++].iov_len = sbuf->end;
+      }
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      if (!lens[i])
+         continue;
+      iov[iovcnt].iov_base   = (void*)bufs[i];
+      iov[iovcnt++].iov_len  = lens[i];
+   }
+
+   if (!iovcnt)
+      return 0;
+
+   memset(&msg, 0, sizeof(msg));
+   msg.msg_iov    = iov;
+   msg.msg_iovlen = iovcnt;
+
+   sent = sendmsg(sockfd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+   if (sent < 0)
+      return isagain((int)sent) ? 0 : -1;
+   return sent;
+}
+
+/* Drop what was sent from the front of the queue. Returns how much of it
+ * came after the queue. */
+static size_t buf_consume(struct socket_buffer *sbuf, size_t sent)
+{
+   size_t used = buf_used(sbuf);
+
+   if (sent >= used)
+   {
+      sbuf->start = sbuf->end = 0;
+      return sent - used;
+   }
+
+   sbuf->start = (sbuf->start + sent) % sbuf->bufsz;
+   return 0;
+}
+#endif
+
 /**
  * netplay_init_socket_buffer
  *
@@ -61,8 +156,11 @@ bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t size)
    sbuf->data = (unsigned char*)malloc(size);
    if (!sbuf->data)
       return false;
-   sbuf->bufsz = size;
-   sbuf->start = sbuf->read = sbuf->end = 0;
+   sbuf->bufsz   = size;
+   sbuf->start   = sbuf->read = sbuf->end = 0;
+   sbuf->relayed = false;
+   sbuf->failed  = false;
+   sbuf->bytes   = 0;
    return true;
 }
 
@@ -77,6 +175,8 @@ bool netplay_resize_socket_buffer(struct socket_buffer *sbuf, size_t newsize)
    if (!newdata)
       return false;
 
+    buf_lock(sbuf);
+
     /* Copy in the old data */
     if (sbuf->end < sbuf->start)
     {
@@ -100,6 +200,8 @@ bool netplay_resize_socket_buffer(struct socket_buffer *sbuf, size_t newsize)
     free(sbuf->data);
     sbuf->data = newdata;
     sbuf->bufsz = newsize;
+
+    buf_unlock(sbuf);
     return true;
 }
 
@@ -119,18 +221,23 @@ void netplay_clear_socket_buffer(struct socket_buffer *sbuf)
    sbuf->start = sbuf->read = sbuf->end = 0;
 }
 
-/**
- * netplay_send
- *
- * Queue the given data for sending.
- */
-bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
+static bool buf_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
    size_t len)
 {
+   if (sbuf->failed)
+      return false;
+
    if (buf_remaining(sbuf) < len)
    {
+      /* A relayed peer this far behind would hold up everyone else */
+      if (sbuf->relayed)
+      {
+         RARCH_WARN("[netplay] Relayed peer fell too far behind.\n");
+         return false;
+      }
+
       /* Need to force a blocking send */
-      if (!netplay_send_flush(sbuf, sockfd, true))
+      if (!buf_flush(sbuf, sockfd, true))
          return false;
    }
 
@@ -166,20 +273,105 @@ bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
 }
 
 /**
- * netplay_send_flush
+ * netplay_send
  *
- * Flush unsent data in the given socket buffer, blocking to do so if
- * requested.
+ * Queue the given data for sending.
+ */
+bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
+   size_t len)
+{
+   bool ret;
+
+   buf_lock(sbuf);
+   sbuf->bytes += len;
+   ret = buf_send(sbuf, sockfd, buf, len);
+   buf_unlock(sbuf);
+
+   return ret;
+}
+
+/**
+ * netplay_send_gather
  *
- * Returns false only on socket failures, true otherwise.
+ * Queue data made up of several pieces, such as a command header and its
+ * payload. Where possible, large data is sent straight from the pieces
+ * together with what is already queued, and only what the socket doesn't
+ * take is copied into the buffer.
  */
-bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
+bool netplay_send_gather(struct socket_buffer *sbuf, int sockfd,
+   const void **bufs, const size_t *lens, size_t count)
+{
+   size_t i;
+   size_t total = 0;
+   bool ret     = true;
+
+   for (i = 0; i < count; i++)
+      total += lens[i];
+
+   buf_lock(sbuf);
+   sbuf->bytes += total;
+
+#ifdef HAVE_NETPLAY_SENDMSG
+   /* Sending to relayed peers is left to the relay thread */
+   if (total >= NETPLAY_GATHER_MIN && count <= NETPLAY_GATHER_MAX &&
+         !sbuf->relayed && !sbuf->failed)
+   {
+      size_t done;
+      ssize_t sent = buf_sendmsg(sbuf, sockfd, bufs, lens, count);
+
+      if (sent < 0)
+         ret = false;
+      else
+      {
+         done = buf_consume(sbuf, (size_t)sent);
+
+         for (i = 0; i < count && ret; i++)
+         {
+            if (done >= lens[i])
+            {
+               done -= lens[i];
+               continue;
+            }
+            ret  = buf_send(sbuf, sockfd,
+                  (const unsigned char*)bufs[i] + done, lens[i] - done);
+            done = 0;
+         }
+      }
+
+      buf_unlock(sbuf);
+      return ret;
+   }
+#endif
+
+   for (i = 0; i < count && ret; i++)
+      ret = buf_send(sbuf, sockfd, bufs[i], lens[i]);
+
+   buf_unlock(sbuf);
+   return ret;
+}
+
+static bool buf_flush(struct socket_buffer *sbuf, int sockfd, bool block)
 {
    ssize_t sent;
 
+   if (sbuf->failed)
+      return false;
+
    if (buf_used(sbuf) == 0)
       return true;
 
+#ifdef HAVE_NETPLAY_SENDMSG
+   if (!block)
+   {
+      /* One call, even if the buffer wraps */
+      sent = buf_sendmsg(sbuf, sockfd, NULL, NULL, 0);
+      if (sent < 0)
+         return false;
+      buf_consume(sbuf, (size_t)sent);
+      return true;
+   }
+#endif
+
    if (sbuf->end > sbuf->start)
    {
       /* Usual case: Everything's in order */
@@ -212,7 +404,7 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
          if (!socket_send_all_blocking(sockfd, sbuf->data + sbuf->start, sbuf->bufsz - sbuf->start, true))
             return false;
          sbuf->start = 0;
-         return netplay_send_flush(sbuf, sockfd, true);
+         return buf_flush(sbuf, sockfd, true);
 
       }
       else
@@ -225,7 +417,7 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
          if (sbuf->start >= sbuf->bufsz)
          {
             sbuf->start = 0;
-            return netplay_send_flush(sbuf, sockfd, false);
+            return buf_flush(sbuf, sockfd, false);
 
          }
 
@@ -236,6 +428,42 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
    return true;
 }
 
+/**
+ * netplay_send_flush
+ *
+ * Flush unsent data in the given socket buffer, blocking to do so if
+ * requested. Non-blocking flushes of relayed buffers are left to the relay
+ * thread.
+ *
+ * Returns false only on socket failures, true otherwise.
+ */
+bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
+{
+   bool ret;
+
+   buf_lock(sbuf);
+   if (sbuf->relayed && !block)
+      ret = !sbuf->failed;
+   else
+      ret = buf_flush(sbuf, sockfd, block);
+   buf_unlock(sbuf);
+
+   return ret;
+}
+
+/**
+ * netplay_send_flush_relayed
+ *
+ * Flush a relayed buffer without blocking, from the relay thread, which
+ * holds the lock. A failure is remembered for the connection's owner to
+ * find.
+ */
+void netplay_send_flush_relayed(struct socket_buffer *sbuf, int sockfd)
+{
+   if (!sbuf->failed && !buf_flush(sbuf, sockfd, false))
+      sbuf->failed = true;
+}
+
 /**
  * netplay_recv
  *
@@ -258,7 +486,8 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
          ((sbuf->start == 0) ? 1 : 0));
       if (recvd < 0 || error)
          return -1;
-      sbuf->end += recvd;
+      sbuf->end   += recvd;
+      sbuf->bytes += recvd;
       if (sbuf->end >= sbuf->bufsz)
       {
          sbuf->end = 0;
@@ -266,7 +495,8 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
          recvd = socket_receive_all_nonblocking(sockfd, &error, sbuf->data, sbuf->start - 1);
          if (recvd < 0 || error)
             return -1;
-         sbuf->end += recvd;
+         sbuf->end   += recvd;
+         sbuf->bytes += recvd;
 
       }
 
@@ -277,7 +507,8 @@ ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd, void *buf,
       recvd = socket_receive_all_nonblocking(sockfd, &error, sbuf->data + sbuf->end, sbuf->start - sbuf->end - 1);
       if (recvd < 0 || error)
          return -1;
-      sbuf->end += recvd;
+      sbuf->end   += recvd;
+      sbuf->bytes += recvd;
 
    }
 
@@ -16,6 +16,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
@@ -23,6 +24,11 @@
 
 #include "netplay_private.h"
 
+#include "../../managers/state_pool.h"
+
+/* Granularity at which savestate deltas are taken */
+#define NETPLAY_DELTA_BLOCK_SIZE 256
+
 static void clear_input(netplay_input_state_t istate)
 {
    while (istate)
@@ -110,7 +116,7 @@ void netplay_delta_frame_free(struct delta_frame *delta)
 
    if (delta->state)
    {
-      free(delta->state);
+      state_pool_put(delta->state);
       delta->state = NULL;
    }
 
@@ -122,6 +128,151 @@ void netplay_delta_frame_free(struct delta_frame *delta)
    }
 }
 
+/**
+ * netplay_state_delta_set_base
+ *
+ * Make this savestate the one deltas are taken against.
+ *
+ * Returns: True if the delta base could be allocated.
+ */
+bool netplay_state_delta_set_base(netplay_t *netplay, const uint8_t *state)
+{
+   if (!netplay->delta_base)
+   {
+      /* Bigger deltas are hardly smaller than the savestate */
+      netplay->delta_buffer_size = netplay->state_size / 2 +
+         2 * sizeof(uint32_t);
+      netplay->delta_base        = (uint8_t*)malloc(netplay->state_size);
+      netplay->delta_buffer      = (uint8_t*)malloc(netplay->delta_buffer_size);
+
+      if (!netplay->delta_base || !netplay->delta_buffer)
+      {
+         free(netplay->delta_base);
+         free(netplay->delta_buffer);
+         netplay->delta_base        = NULL;
+         netplay->delta_buffer      = NULL;
+         netplay->delta_buffer_size = 0;
+         return false;
+      }
+   }
+
+   memcpy(netplay->delta_base, state, netplay->state_size);
+   netplay->delta_base_crc = encoding_crc32(0L, netplay->delta_base,
+         netplay->state_size);
+   return true;
+}
+
+/**
+ * netplay_state_delta_encode
+ *
+ * Write the blocks in which this savestate differs from the delta base into
+ * the delta buffer. The delta is a sequence of runs, each made of its
+ * offset and its length in network order followed by its data.
+ *
+ * Returns: True if the delta fits in the delta buffer and is worth sending.
+ */
+bool netplay_state_delta_encode(netplay_t *netplay, const uint8_t *state,
+      size_t *size)
+{
+   size_t offset      = 0;
+   size_t written     = 0;
+   size_t state_size  = netplay->state_size;
+   const uint8_t *base = netplay->delta_base;
+
+   if (!base)
+      return false;
+
+   while (offset < state_size)
+   {
+      uint32_t run[2];
+      size_t start;
+      size_t len = state_size - offset;
+
+      if (len > NETPLAY_DELTA_BLOCK_SIZE)
+         len = NETPLAY_DELTA_BLOCK_SIZE;
+
+      if (!memcmp(state + offset, base + offset, len))
+      {
+         offset += len;
+         continue;
+      }
+
+      /* Extend the run over every following changed block */
+      start = offset;
+      do
+      {
+         offset += len;
+         len     = state_size - offset;
+         if (len > NETPLAY_DELTA_BLOCK_SIZE)
+            len  = NETPLAY_DELTA_BLOCK_SIZE;
+      } while (offset < state_size &&
+            memcmp(state + offset, base + offset, len));
+
+      len = offset - start;
+      if (written + sizeof(run) + len > netplay->delta_buffer_size)
+         return false;
+
+      run[0] = htonl((uint32_t)start);
+      run[1] = htonl((uint32_t)len);
+      memcpy(netplay->delta_buffer + written, run, sizeof(run));
+      memcpy(netplay->delta_buffer + written + sizeof(run),
+            state + start, len);
+      written += sizeof(run) + len;
+   }
+
+   *size = written;
+   return true;
+}
+
+/**
+ * netplay_state_delta_apply
+ *
+ * Apply a delta of this size, as received into the delta buffer, to the
+ * delta base.
+ *
+ * Returns: True if the delta was valid, in which case it was applied.
+ */
+bool netplay_state_delta_apply(netplay_t *netplay, size_t size)
+{
+   unsigned pass;
+
+   if (!netplay->delta_base || size > netplay->delta_buffer_size)
+      return false;
+
+   /* Check every run before touching the delta base */
+   for (pass = 0; pass < 2; pass++)
+   {
+      size_t read = 0;
+
+      while (read < size)
+      {
+         uint32_t run[2];
+         size_t offset, len;
+
+         if (size - read < sizeof(run))
+            return false;
+
+         memcpy(run, netplay->delta_buffer + read, sizeof(run));
+         read  += sizeof(run);
+         offset = ntohl(run[0]);
+         len    = ntohl(run[1]);
+
+         if (len > size - read || offset > netplay->state_size ||
+               len > netplay->state_size - offset)
+            return false;
+
+         if (pass)
+            memcpy(netplay->delta_base + offset,
+                  netplay->delta_buffer + read, len);
+         read += len;
+      }
+   }
+
+   netplay->delta_base_crc = encoding_crc32(0L, netplay->delta_base,
+         netplay->state_size);
+   return true;
+}
+
 /**
  * netplay_input_state_for
  *
@@ -116,6 +116,36 @@ static bool netplay_can_poll(netplay_t *netplay)
    return netplay->can_poll;
 }
 
+/**
+ * netplay_ping
+ *
+ * Once every NETPLAY_PING_INTERVAL, measure the round trip time to our peers
+ * and how many frames were replayed since.
+ */
+static void netplay_ping(netplay_t *netplay)
+{
+   size_t i;
+   retro_time_t now     = cpu_features_get_time_usec();
+   retro_time_t elapsed = now - netplay->replayed_time;
+
+   if (elapsed < NETPLAY_PING_INTERVAL)
+      return;
+
+   if (netplay->replayed_time)
+      netplay->replayed_per_second = (float)
+         ((netplay->rollback_frames - netplay->replayed_frames) *
+          1000000.0 / elapsed);
+   netplay->replayed_time   = now;
+   netplay->replayed_frames = netplay->rollback_frames;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+         netplay_cmd_ping(netplay, connection);
+   }
+}
+
 /**
  * get_self_input_state:
  * @netplay              : pointer to netplay object
@@ -250,13 +280,17 @@ static bool get_self_input_state(netplay_t *netplay)
       netplay->read_frame_count[netplay->self_client_num] = netplay->self_frame_count + 1;
    }
 
+   netplay_ping(netplay);
+
    /* And send this input to our peers */
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
+      netplay_relay_update(netplay, connection);
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
          netplay_send_cur_input(netplay, &netplay->connections[i]);
    }
+   netplay_relay_wake(netplay);
 
    /* Handle any delayed state changes */
    if (netplay->is_server)
@@ -324,28 +358,41 @@ static bool netplay_poll(netplay_t *netplay)
 
    netplay_update_unread_ptr(netplay);
 
+   /* Replays may take this much of a frame, the rest is left to run it */
+   {
+      struct retro_system_av_info *av_info = video_viewport_get_system_av_info();
+      double fps                           = av_info->timing.fps > 0.0 ?
+         av_info->timing.fps : 60.0;
+
+      netplay->replay_budget = (retro_time_t)(1000000.0 / fps) *
+         NETPLAY_REPLAY_BUDGET / 100;
+   }
+
+   /* Remember how far ahead of the remote input we ran, so that jitter
+    * doesn't keep changing the latency */
+   netplay->rollback_depth[netplay->rollback_depth_ptr] =
+      (netplay->run_frame_count > netplay->unread_frame_count) ?
+      (netplay->run_frame_count - netplay->unread_frame_count) :
+      0;
+   netplay->rollback_depth_ptr = (netplay->rollback_depth_ptr + 1) %
+      NETPLAY_ROLLBACK_WINDOW;
+
    /* Figure out how many frames of input latency we should be using to hide
     * network latency */
    if (netplay->frame_run_time_avg || netplay->stateless_mode)
    {
-      /* FIXME: Using fixed 60fps for this calculation */
       unsigned frames_per_frame    = netplay->frame_run_time_avg ?
-         (16666 / netplay->frame_run_time_avg) :
-         0;
-      unsigned frames_ahead        = (netplay->run_frame_count > netplay->unread_frame_count) ?
-         (netplay->run_frame_count - netplay->unread_frame_count) :
+         (unsigned)(netplay->replay_budget / netplay->frame_run_time_avg) :
          0;
+      unsigned frames_ahead        = 0;
       settings_t *settings         = config_get_ptr();
       int input_latency_frames_min = settings->uints.netplay_input_latency_frames_min -
             (settings->bools.run_ahead_enabled ? settings->uints.run_ahead_frames : 0);
       int input_latency_frames_max = input_latency_frames_min + settings->uints.netplay_input_latency_frames_range;
 
-      /* Assume we need a couple frames worth of time to actually run the
-       * current frame */
-      if (frames_per_frame > 2)
-         frames_per_frame -= 2;
-      else
-         frames_per_frame = 0;
+      for (i = 0; i < NETPLAY_ROLLBACK_WINDOW; i++)
+         if (netplay->rollback_depth[i] > frames_ahead)
+            frames_ahead = netplay->rollback_depth[i];
 
       /* Shall we adjust our latency? */
       if (netplay->stateless_mode)
@@ -407,6 +454,10 @@ static bool netplay_poll(netplay_t *netplay)
          netplay->stall = NETPLAY_STALL_NONE;
          break;
 
+      case NETPLAY_STALL_REPLAY:
+         /* Cleared once the replay catches up */
+         break;
+
       case NETPLAY_STALL_SERVER_REQUESTED:
          /* See if the stall is done */
          if (netplay->connections[0].stall_frame == 0)
@@ -1077,6 +1128,7 @@ static void netplay_post_frame(netplay_t *netplay)
    retro_assert(netplay);
    netplay_update_unread_ptr(netplay);
    netplay_sync_post_frame(netplay, false);
+   netplay_record_frames(netplay);
 
    for (i = 0; i < netplay->connections_size; i++)
    {
@@ -1137,27 +1189,61 @@ static void netplay_force_future(netplay_t *netplay)
    }
 }
 
+/**
+ * netplay_savestate_recipient
+ * @connection           : connection to check
+ * @cx                   : compression type
+ * @delta                : whether the savestate is sent as a delta
+ *
+ * Whether this connection is to receive a savestate sent this way.
+ */
+static bool netplay_savestate_recipient(struct netplay_connection *connection,
+   uint32_t cx, bool delta)
+{
+   return connection->active &&
+      connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
+      connection->compression_supported == cx &&
+      connection->delta_base_valid == delta;
+}
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
  * @serial_info          : the savestate being loaded
  * @cx                   : compression type
  * @z                    : compression backend to use
+ * @delta_size           : size of the delta in the delta buffer, or 0 to
+ *                         send the whole savestate
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. Deltas go to the peers holding the delta base, the whole savestate
+ * to the others.
  */
 static void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
-   struct compression_transcoder *z)
+   struct compression_transcoder *z, bool delta, size_t delta_size)
 {
-   uint32_t header[4];
+   uint32_t header[5];
    uint32_t rd, wn;
+   const void *bufs[2];
+   size_t lens[2];
    size_t i;
+   size_t header_size = delta ? 5*sizeof(uint32_t) : 4*sizeof(uint32_t);
+
+   /* Don't bother compressing it if nobody gets it */
+   for (i = 0; i < netplay->connections_size; i++)
+      if (netplay_savestate_recipient(&netplay->connections[i], cx, delta))
+         break;
+   if (i == netplay->connections_size)
+      return;
 
    /* Compress it */
-   z->compression_backend->set_in(z->compression_stream,
-      (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
+   if (delta)
+      z->compression_backend->set_in(z->compression_stream,
+         netplay->delta_buffer, (uint32_t)delta_size);
+   else
+      z->compression_backend->set_in(z->compression_stream,
+         (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
    z->compression_backend->set_out(z->compression_stream,
       netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
    if (!z->compression_backend->trans(z->compression_stream, true, &rd,
@@ -1170,26 +1256,107 @@ static void netplay_send_savestate(netplay_t *netplay,
    }
 
    /* Send it to relevant peers */
-   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
-   header[1] = htonl(wn + 2*sizeof(uint32_t));
+   header[0] = htonl(delta ?
+         NETPLAY_CMD_LOAD_SAVESTATE_DELTA : NETPLAY_CMD_LOAD_SAVESTATE);
+   header[1] = htonl(wn + header_size - 2*sizeof(uint32_t));
    header[2] = htonl(netplay->run_frame_count);
    header[3] = htonl(serial_info->size);
+   header[4] = htonl(netplay->delta_base_crc);
+
+   bufs[0] = header;
+   lens[0] = header_size;
+   bufs[1] = netplay->zbuffer;
+   lens[1] = wn;
 
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (!connection->active ||
-          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+      if (!netplay_savestate_recipient(connection, cx, delta))
+         continue;
 
-      if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
-            sizeof(header)) ||
-          !netplay_send(&connection->send_packet_buffer, connection->fd,
-            netplay->zbuffer, wn))
+      if (!netplay_send_gather(&connection->send_packet_buffer,
+            connection->fd, bufs, lens, 2))
          netplay_hangup(netplay, connection);
    }
 }
 
+/**
+ * netplay_send_savestate_all
+ * @netplay              : pointer to netplay object
+ * @serial_info          : the savestate being loaded
+ *
+ * Send a loaded savestate to every peer. As the server, peers holding the
+ * last savestate sent get a delta against it, and it is replaced by this one.
+ */
+static void netplay_send_savestate_all(netplay_t *netplay,
+   retro_ctx_serialize_info_t *serial_info)
+{
+   size_t i;
+   size_t delta_size = 0;
+   bool delta        = false;
+   bool keep_base    = false;
+   bool whole        = serial_info->size == netplay->state_size;
+
+   if (netplay->is_server && whole)
+   {
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (connection->active && connection->delta_supported)
+            keep_base = true;
+         if (connection->active && connection->delta_base_valid)
+            delta     = true;
+      }
+
+      if (delta)
+         delta = netplay_state_delta_encode(netplay,
+               (const uint8_t*)serial_info->data_const, &delta_size);
+   }
+
+   /* Peers a delta doesn't pay off for get the whole savestate */
+   if (!delta)
+      for (i = 0; i < netplay->connections_size; i++)
+         netplay->connections[i].delta_base_valid = false;
+
+   if (netplay->compress_nil.compression_backend)
+   {
+      netplay_send_savestate(netplay, serial_info, 0,
+         &netplay->compress_nil, false, 0);
+      if (delta)
+         netplay_send_savestate(netplay, serial_info, 0,
+            &netplay->compress_nil, true, delta_size);
+   }
+   if (netplay->compress_zlib.compression_backend)
+   {
+      netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
+         &netplay->compress_zlib, false, 0);
+      if (delta)
+         netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
+            &netplay->compress_zlib, true, delta_size);
+   }
+   if (netplay->compress_zstd.compression_backend)
+   {
+      netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZSTD,
+         &netplay->compress_zstd, false, 0);
+      if (delta)
+         netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZSTD,
+            &netplay->compress_zstd, true, delta_size);
+   }
+
+   if (keep_base)
+      keep_base = netplay_state_delta_set_base(netplay,
+            (const uint8_t*)serial_info->data_const);
+
+   /* Whoever got it now holds the delta base */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      connection->delta_base_valid = keep_base && connection->active &&
+         connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
+         connection->delta_supported;
+   }
+}
+
 /**
  * netplay_load_savestate
  * @netplay              : pointer to netplay object
@@ -1234,6 +1401,10 @@ void netplay_load_savestate(netplay_t *netplay,
          return;
    }
 
+   if (save || !serial_info)
+      netplay_record_state(netplay, netplay->run_frame_count,
+            &netplay->buffer[netplay->run_ptr]);
+
    /* Don't send it if we're expected to be desynced */
    if (netplay->desync)
       return;
@@ -1245,11 +1416,7 @@ void netplay_load_savestate(netplay_t *netplay,
       return;
 
    /* Send this to every peer */
-   if (netplay->compress_nil.compression_backend)
-      netplay_send_savestate(netplay, serial_info, 0, &netplay->compress_nil);
-   if (netplay->compress_zlib.compression_backend)
-      netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
-         &netplay->compress_zlib);
+   netplay_send_savestate_all(netplay, serial_info);
 }
 
 /**
@@ -1265,6 +1432,7 @@ static void netplay_core_reset(netplay_t *netplay)
 
    /* Ignore past input */
    netplay_force_future(netplay);
+   netplay_record_state(netplay, netplay->self_frame_count, NULL);
 
    /* Request that our peers reset */
    cmd[0] = htonl(NETPLAY_CMD_RESET);
@@ -1466,6 +1634,8 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
          settings->ints.netplay_check_frames,
          &cbs,
          settings->bools.netplay_nat_traversal && !settings->bools.netplay_use_mitm_server,
+         settings->bools.netplay_udp_input && !settings->bools.netplay_use_mitm_server,
+         settings->bools.netplay_spectator_relay,
 #ifdef HAVE_DISCORD
          discord_get_own_username() ? discord_get_own_username() :
 #endif
@@ -1476,6 +1646,22 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
 
    if (netplay_data)
    {
+      if (settings->bools.netplay_record_inputs)
+      {
+         char name[PATH_MAX_LENGTH];
+         char path[PATH_MAX_LENGTH];
+         global_t *global = global_get_ptr();
+
+         /* Next to the savestates, dated so sessions don't overwrite each
+          * other */
+         fill_pathname_basedir(path, global->name.savestate, sizeof(path));
+         fill_str_dated_filename(name,
+               path_basename(path_get(RARCH_PATH_BASENAME)), "nprec",
+               sizeof(name));
+         fill_pathname_join(path, path, name, sizeof(path));
+         netplay_record_init(netplay_data, path);
+      }
+
       if (netplay_data->is_server && !settings->bools.netplay_start_as_spectator)
          netplay_toggle_play_spectate(netplay_data);
       return true;
@@ -1490,6 +1676,59 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
    return false;
 }
 
+/**
+ * netplay_get_stats
+ *
+ * Fill in the statistics of the session for RARCH_NETPLAY_CTL_GET_STATS.
+ */
+static void netplay_get_stats(netplay_t *netplay, netplay_stats_t *stats)
+{
+   size_t i;
+
+   memset(stats, 0, sizeof(*stats));
+
+   stats->input_latency_frames = netplay->input_latency_frames;
+   stats->rollbacks            = netplay->rollback_count;
+   stats->rollback_max         = netplay->rollback_max;
+   for (i = 0; i < NETPLAY_STATS_DEPTHS; i++)
+      stats->rollback_depths[i] = netplay->rollback_depths[i];
+   stats->replayed_per_second  = netplay->replayed_per_second;
+   stats->crc_mismatches       = netplay->crc_mismatches;
+   stats->bytes_sent           = netplay->udp_bytes_sent;
+   stats->bytes_received       = netplay->udp_bytes_received;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      if (!connection->active)
+         continue;
+
+      stats->bytes_sent     += connection->send_packet_buffer.bytes;
+      stats->bytes_received += connection->recv_packet_buffer.bytes;
+
+      if (connection->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      if (stats->peer_count < NETPLAY_STATS_MAX_PEERS)
+      {
+         netplay_peer_stats_t *peer = &stats->peers[stats->peer_count];
+
+         strlcpy(peer->nick, connection->nick, sizeof(peer->nick));
+         peer->rtt            = -1;
+         peer->jitter         = -1;
+         if (connection->ping_supported)
+         {
+            peer->rtt         = connection->rtt;
+            peer->jitter      = connection->jitter;
+         }
+         peer->bytes_sent     = connection->send_packet_buffer.bytes;
+         peer->bytes_received = connection->recv_packet_buffer.bytes;
+      }
+      stats->peer_count++;
+   }
+}
+
 /**
  * netplay_driver_ctl
  *
@@ -1536,6 +1775,7 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
 
          case RARCH_NETPLAY_CTL_IS_REPLAYING:
          case RARCH_NETPLAY_CTL_IS_DATA_INITED:
+         case RARCH_NETPLAY_CTL_GET_STATS:
             ret = false;
             goto done;
 
@@ -1613,6 +1853,9 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
                netplay_load_savestate(netplay, NULL, true);
          }
          break;
+      case RARCH_NETPLAY_CTL_GET_STATS:
+         netplay_get_stats(netplay, (netplay_stats_t*)data);
+         goto done;
       default:
       case RARCH_NETPLAY_CTL_NONE:
          ret = false;
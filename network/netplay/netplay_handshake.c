@@ -204,7 +204,8 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(netplay_magic);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED | NETPLAY_COMPRESSION_PING |
+         (netplay->udp_fd >= 0 ? NETPLAY_COMPRESSION_UDP_INPUT : 0));
    header[3] = 0;
    header[4] = htonl(NETPLAY_PROTOCOL_VERSION);
    header[5] = htonl(netplay_impl_magic());
@@ -367,9 +368,22 @@ bool netplay_handshake_init(netplay_t *netplay,
 
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
+   connection->udp_supported = netplay->udp_fd >= 0 &&
+      (compression & NETPLAY_COMPRESSION_UDP_INPUT);
+   connection->udp_active    = false;
+   connection->ping_supported = !!(compression & NETPLAY_COMPRESSION_PING);
+   connection->rtt            = connection->jitter = 0;
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
 
-   if (compression & NETPLAY_COMPRESSION_ZLIB)
+   if (compression & NETPLAY_COMPRESSION_ZSTD)
+   {
+      ctrans = &netplay->compress_zstd;
+      if (!ctrans->compression_backend)
+         ctrans->compression_backend =
+            trans_stream_get_zstd_compress_backend();
+      connection->compression_supported = NETPLAY_COMPRESSION_ZSTD;
+   }
+   else if (compression & NETPLAY_COMPRESSION_ZLIB)
    {
       ctrans = &netplay->compress_zlib;
       if (!ctrans->compression_backend)
@@ -392,6 +406,9 @@ bool netplay_handshake_init(netplay_t *netplay,
       connection->compression_supported = 0;
    }
 
+   connection->delta_supported  = (compression & NETPLAY_COMPRESSION_DELTA) != 0;
+   connection->delta_base_valid = false;
+
    if (!ctrans->decompression_backend)
       ctrans->decompression_backend = ctrans->compression_backend->reverse;
 
@@ -400,6 +417,10 @@ bool netplay_handshake_init(netplay_t *netplay,
    {
       ctrans->compression_stream   = ctrans->compression_backend->stream_new();
       ctrans->decompression_stream = ctrans->decompression_backend->stream_new();
+
+      if (ctrans->compression_stream && ctrans->compression_backend->define)
+         ctrans->compression_backend->define(ctrans->compression_stream,
+               "level", NETPLAY_COMPRESSION_LEVEL);
    }
    if (!ctrans->compression_stream || !ctrans->decompression_stream)
    {
@@ -550,6 +571,7 @@ static bool netplay_handshake_sync(netplay_t *netplay,
    int matchct;
    uint32_t cmd[4];
    retro_ctx_memory_info_t mem_info;
+   const void *sram           = NULL;
    uint32_t client_num        = 0;
    uint32_t device            = 0;
    size_t nicklen, nickmangle = 0;
@@ -563,6 +585,7 @@ static bool netplay_handshake_sync(netplay_t *netplay,
 #ifdef HAVE_THREADS
    autosave_unlock();
 #endif
+   sram = mem_info.data;
 
    /* Send basic sync info */
    cmd[0]     = htonl(NETPLAY_CMD_SYNC);
@@ -660,8 +683,8 @@ static bool netplay_handshake_sync(netplay_t *netplay,
 #ifdef HAVE_THREADS
    autosave_lock();
 #endif
-   if (!netplay_send(&connection->send_packet_buffer, connection->fd,
-            mem_info.data, mem_info.size) ||
+   if (!netplay_send_gather(&connection->send_packet_buffer, connection->fd,
+            &sram, &mem_info.size, 1) ||
          !netplay_send_flush(&connection->send_packet_buffer, connection->fd,
             false))
    {
@@ -674,6 +697,23 @@ static bool netplay_handshake_sync(netplay_t *netplay,
    autosave_unlock();
 #endif
 
+   /* Tell them what to put in their UDP datagrams */
+   if (connection->udp_supported)
+   {
+      uint32_t token;
+
+      do
+      {
+         connection->udp_token = simple_rand_uint32() ^
+            (uint32_t)cpu_features_get_time_usec();
+      } while (!connection->udp_token);
+
+      token = htonl(connection->udp_token);
+      if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP,
+               &token, sizeof(token)))
+         return false;
+   }
+
    /* Now we're ready! */
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
@@ -31,6 +32,7 @@
 #include "netplay_discovery.h"
 
 #include "../../autosave.h"
+#include "../../managers/state_pool.h"
 #include "../../retroarch.h"
 
 #if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY)
@@ -286,13 +288,16 @@ bool netplay_init_serialization(netplay_t *netplay)
 
    for (i = 0; i < netplay->buffer_size; i++)
    {
-      netplay->buffer[i].state = calloc(netplay->state_size, 1);
+      netplay->buffer[i].state = state_pool_get_tagged(netplay->state_size,
+            MEMORY_USAGE_NETPLAY);
 
       if (!netplay->buffer[i].state)
       {
          netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
          return false;
       }
+
+      memset(netplay->buffer[i].state, 0, netplay->state_size);
    }
 
    netplay->zbuffer_size = netplay->state_size * 2;
@@ -407,6 +412,8 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * @check_frames         : Frequency with which to check CRCs.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
+ * @udp_input            : If true, also send input over UDP.
+ * @spectator_relay      : If true, send to spectators from a thread.
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
  *
@@ -417,7 +424,8 @@ static bool netplay_init_buffers(netplay_t *netplay)
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    bool stateless_mode, int check_frames,
-   const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
+   const struct retro_callbacks *cb, bool nat_traversal, bool udp_input,
+   bool spectator_relay, const char *nick,
    const char *netplay_password,
    const char *netplay_spectate_password,
    uint64_t quirks)
@@ -427,6 +435,7 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->is_server            = (direct_host == NULL && server == NULL);
@@ -437,6 +446,7 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    netplay->crc_validity_checked = false;
    netplay->crcs_valid           = true;
    netplay->quirks               = quirks;
+   netplay->replay_budget        = 16666 * NETPLAY_REPLAY_BUDGET / 100;
    netplay->self_mode            = netplay->is_server ?
                                 NETPLAY_CONNECTION_SPECTATING :
                                 NETPLAY_CONNECTION_NONE;
@@ -463,6 +473,12 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
       return NULL;
    }
 
+   if (udp_input && !netplay_udp_init(netplay))
+      RARCH_WARN("[netplay] Failed to open a UDP socket, input will only go over TCP.\n");
+
+   if (spectator_relay && netplay->is_server && !netplay_relay_init(netplay))
+      RARCH_WARN("[netplay] Failed to start the spectator relay.\n");
+
    if (!netplay_init_buffers(netplay))
    {
       free(netplay);
@@ -516,6 +532,9 @@ error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_deinit(netplay);
+   netplay_relay_deinit(netplay);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -533,9 +552,19 @@ void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+   if (netplay->rollback_count)
+      RARCH_LOG("[netplay] Rollbacks: %u, frames replayed: %u, deepest: %u, "
+            "replays spread over frames: %u\n",
+            netplay->rollback_count, netplay->rollback_frames,
+            netplay->rollback_max, netplay->replay_stalls);
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_deinit(netplay);
+   netplay_relay_deinit(netplay);
+   netplay_record_deinit(netplay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -564,6 +593,12 @@ void netplay_free(netplay_t *netplay)
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
+   if (netplay->delta_base)
+      free(netplay->delta_base);
+
+   if (netplay->delta_buffer)
+      free(netplay->delta_buffer);
+
    if (netplay->compress_nil.compression_stream)
    {
       netplay->compress_nil.compression_backend->stream_free(netplay->compress_nil.compression_stream);
@@ -574,6 +609,11 @@ void netplay_free(netplay_t *netplay)
       netplay->compress_zlib.compression_backend->stream_free(netplay->compress_zlib.compression_stream);
       netplay->compress_zlib.decompression_backend->stream_free(netplay->compress_zlib.decompression_stream);
    }
+   if (netplay->compress_zstd.compression_stream)
+   {
+      netplay->compress_zstd.compression_backend->stream_free(netplay->compress_zstd.compression_stream);
+      netplay->compress_zstd.decompression_backend->stream_free(netplay->compress_zstd.decompression_stream);
+   }
 
    if (netplay->addr)
       freeaddrinfo_retro(netplay->addr);
@@ -58,6 +58,9 @@ static void print_state(netplay_t *netplay)
       if ((netplay->connected_players & (1<<client)))
          APPEND((M, " %u:%u", client, netplay->read_frame_count[client]));
    }
+   APPEND((M, " L:%d R:%u/%u C:%u", netplay->input_latency_frames,
+         netplay->rollback_count, netplay->rollback_frames,
+         netplay->crc_mismatches));
    msg[sizeof(msg)-1] = '\0';
 
    RARCH_LOG("[netplay] %s\n", msg);
@@ -134,8 +137,10 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
    RARCH_LOG("[netplay] %s\n", dmsg);
    runloop_msg_queue_push(dmsg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
+   netplay_relay_detach(netplay, connection);
    socket_close(connection->fd);
-   connection->active = false;
+   connection->active     = false;
+   connection->udp_active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
 
@@ -350,6 +355,9 @@ bool netplay_send_cur_input(netplay_t *netplay,
          return false;
    }
 
+   /* And the fast way, if they take it */
+   netplay_udp_send_input(netplay, connection);
+
    if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
          false))
       return false;
@@ -357,6 +365,67 @@ bool netplay_send_cur_input(netplay_t *netplay,
    return true;
 }
 
+/**
+ * netplay_recv_input_frame
+ *
+ * Take in a frame of input that arrived other than through NETPLAY_CMD_INPUT,
+ * in network byte order. It must be the next frame needed from this player.
+ *
+ * Returns true if the input was taken.
+ */
+bool netplay_recv_input_frame(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t client_num,
+   uint32_t frame_num, const uint32_t *data)
+{
+   uint32_t devices = netplay->client_devices[client_num];
+   uint32_t device;
+   struct delta_frame *dframe;
+
+   if (frame_num != netplay->read_frame_count[client_num])
+      return false;
+
+   dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+   if (!netplay_delta_frame_ready(netplay, dframe, frame_num))
+      return false;
+
+   /* Copy in the input, as NETPLAY_CMD_INPUT does */
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      uint32_t dsize, di;
+      if (!(devices & (1<<device)))
+         continue;
+
+      dsize = netplay_expected_input_size(netplay, 1 << device);
+      istate = netplay_input_state_for(&dframe->real_input[device],
+            client_num, dsize, false, false);
+      if (!istate)
+         return false;
+      for (di = 0; di < dsize; di++)
+         istate->data[di] = ntohl(*data++);
+   }
+   dframe->have_real[client_num] = true;
+
+   netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+   netplay->read_frame_count[client_num]++;
+
+   if (netplay->is_server)
+   {
+      /* Forward it on if it's past data */
+      if (dframe->frame <= netplay->self_frame_count)
+         send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+   }
+
+   /* If this was server data, advance our server pointer too */
+   if (!netplay->is_server && client_num == 0)
+   {
+      netplay->server_ptr = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
+
+   return true;
+}
+
 /**
  * netplay_send_raw_cmd
  *
@@ -460,6 +529,28 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    return success;
 }
 
+/**
+ * netplay_cmd_ping
+ *
+ * Send a ping to measure the round trip time to a connection, if it answers
+ * them.
+ */
+bool netplay_cmd_ping(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t payload[2];
+   retro_time_t now = cpu_features_get_time_usec();
+
+   if (!connection->ping_supported)
+      return true;
+
+   connection->ping_time = now;
+   payload[0] = htonl((uint32_t)((uint64_t)now >> 32));
+   payload[1] = htonl((uint32_t)now);
+   return netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_PING,
+         payload, sizeof(payload));
+}
+
 /**
  * netplay_cmd_request_savestate
  *
@@ -1545,7 +1636,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
 
                /* Problem! */
                if (buffer[1] != local_crc)
+               {
+                  netplay->crc_mismatches++;
                   netplay_cmd_request_savestate(netplay);
+               }
             }
             else
             {
@@ -1560,13 +1654,17 @@ static bool netplay_get_cmd(netplay_t *netplay,
          /* Delay until next frame so we don't send the savestate after the
           * input */
          netplay->force_send_savestate = true;
+         /* They might have lost track of the delta base */
+         connection->delta_base_valid  = false;
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
             uint32_t isize;
+            uint32_t base_crc;
             uint32_t rd, wn;
             uint32_t client;
             uint32_t load_frame_count;
@@ -1620,6 +1718,8 @@ static bool netplay_get_cmd(netplay_t *netplay,
             /* Check the payload size */
             if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
                  (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+                (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA &&
+                 (cmd_size < 3*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 3*sizeof(uint32_t))) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(uint32_t)))
             {
                RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -1657,8 +1757,11 @@ static bool netplay_get_cmd(netplay_t *netplay,
             }
 
             /* Now we switch based on whether we're loading a state or resetting */
-            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE ||
+                cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
             {
+               uint32_t header_size = 2*sizeof(uint32_t);
+
                RECV(&isize, sizeof(isize))
                {
                   RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive inflated size.\n");
@@ -1672,7 +1775,18 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   return netplay_cmd_nak(netplay, connection);
                }
 
-               RECV(netplay->zbuffer, cmd_size - 2*sizeof(uint32_t))
+               if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               {
+                  RECV(&base_crc, sizeof(base_crc))
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive delta base.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+                  base_crc     = ntohl(base_crc);
+                  header_size += sizeof(uint32_t);
+               }
+
+               RECV(netplay->zbuffer, cmd_size - header_size)
                {
                   RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive savestate.\n");
                   return netplay_cmd_nak(netplay, connection);
@@ -1684,16 +1798,55 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   case NETPLAY_COMPRESSION_ZLIB:
                      ctrans = &netplay->compress_zlib;
                      break;
+                  case NETPLAY_COMPRESSION_ZSTD:
+                     ctrans = &netplay->compress_zstd;
+                     break;
                   default:
                      ctrans = &netplay->compress_nil;
                }
-               ctrans->decompression_backend->set_in(ctrans->decompression_stream,
-                  netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
-               ctrans->decompression_backend->set_out(ctrans->decompression_stream,
-                  (uint8_t*)netplay->buffer[load_ptr].state,
-                  (unsigned)netplay->state_size);
-               ctrans->decompression_backend->trans(ctrans->decompression_stream,
-                  true, &rd, &wn, NULL);
+
+               if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               {
+                  /* A delta against a savestate we don't have is useless,
+                   * ask for the whole thing instead */
+                  if (!netplay->delta_base || netplay->is_server ||
+                      base_crc != netplay->delta_base_crc)
+                  {
+                     RARCH_WARN("CMD_LOAD_SAVESTATE_DELTA against an unknown savestate.\n");
+                     netplay_cmd_request_savestate(netplay);
+                     break;
+                  }
+
+                  ctrans->decompression_backend->set_in(ctrans->decompression_stream,
+                     netplay->zbuffer, cmd_size - header_size);
+                  ctrans->decompression_backend->set_out(ctrans->decompression_stream,
+                     netplay->delta_buffer, (unsigned)netplay->delta_buffer_size);
+                  if (!ctrans->decompression_backend->trans(ctrans->decompression_stream,
+                        true, &rd, &wn, NULL) ||
+                      !netplay_state_delta_apply(netplay, wn))
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE_DELTA received an invalid delta.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+
+                  memcpy(netplay->buffer[load_ptr].state, netplay->delta_base,
+                     netplay->state_size);
+               }
+               else
+               {
+                  ctrans->decompression_backend->set_in(ctrans->decompression_stream,
+                     netplay->zbuffer, cmd_size - header_size);
+                  ctrans->decompression_backend->set_out(ctrans->decompression_stream,
+                     (uint8_t*)netplay->buffer[load_ptr].state,
+                     (unsigned)netplay->state_size);
+                  ctrans->decompression_backend->trans(ctrans->decompression_stream,
+                     true, &rd, &wn, NULL);
+
+                  /* The server sends deltas against this one from now on */
+                  if (!netplay->is_server && connection->delta_supported)
+                     netplay_state_delta_set_base(netplay,
+                        (const uint8_t*)netplay->buffer[load_ptr].state);
+               }
 
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
@@ -1736,6 +1889,9 @@ static bool netplay_get_cmd(netplay_t *netplay,
                }
             }
 
+            netplay_record_state(netplay, load_frame_count,
+                  cmd == NETPLAY_CMD_RESET ? NULL : &netplay->buffer[load_ptr]);
+
             /* Make sure our states are correct */
             netplay->savestate_request_outstanding = false;
             netplay->other_ptr                     = load_ptr;
@@ -1797,6 +1953,34 @@ static bool netplay_get_cmd(netplay_t *netplay,
          remote_unpaused(netplay, connection);
          break;
 
+      case NETPLAY_CMD_UDP:
+         {
+            uint32_t token;
+
+            if (cmd_size != sizeof(uint32_t))
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&token, sizeof(token))
+            {
+               RARCH_ERR("Failed to receive NETPLAY_CMD_UDP payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (netplay->is_server || !connection->udp_supported)
+            {
+               RARCH_ERR("Unexpected NETPLAY_CMD_UDP.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            connection->udp_token  = ntohl(token);
+            connection->udp_active = true;
+            RARCH_LOG("[netplay] Sending input over UDP as well.\n");
+            break;
+         }
+
       case NETPLAY_CMD_STALL:
          {
             uint32_t frames;
@@ -1833,6 +2017,53 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_PING:
+      case NETPLAY_CMD_PONG:
+         {
+            uint32_t payload[2];
+
+            if (cmd_size != sizeof(payload))
+            {
+               RARCH_ERR("NETPLAY_CMD_PING with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+            {
+               RARCH_ERR("Failed to receive NETPLAY_CMD_PING payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd == NETPLAY_CMD_PING)
+            {
+               /* Just send it back */
+               netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_PONG,
+                     payload, sizeof(payload));
+               netplay_send_flush(&connection->send_packet_buffer,
+                     connection->fd, false);
+            }
+            else
+            {
+               retro_time_t sent = (retro_time_t)
+                  (((uint64_t)ntohl(payload[0]) << 32) | ntohl(payload[1]));
+               retro_time_t rtt  = cpu_features_get_time_usec() - sent;
+               retro_time_t diff;
+
+               /* Not one of ours */
+               if (sent != connection->ping_time || rtt < 0)
+                  break;
+
+               /* Jitter as in RFC 3550, a running average of the change */
+               diff = rtt - connection->rtt;
+               if (diff < 0)
+                  diff = -diff;
+               if (connection->rtt)
+                  connection->jitter += (diff - connection->jitter) / 16;
+               connection->rtt = rtt;
+            }
+            break;
+         }
+
       default:
          RARCH_ERR("%s.\n", msg_hash_to_str(MSG_UNKNOWN_NETPLAY_COMMAND_RECEIVED));
          return netplay_cmd_nak(netplay, connection);
@@ -1873,6 +2104,9 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
    if (max_fd == 0)
       return 0;
 
+   if (netplay->udp_fd >= max_fd)
+      max_fd = netplay->udp_fd + 1;
+
    netplay->timeout_cnt = 0;
 
    do
@@ -1881,6 +2115,9 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
 
       netplay->timeout_cnt++;
 
+      /* Input over UDP first, so its copy over TCP can be skipped */
+      netplay_udp_poll(netplay, &had_input);
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
@@ -1911,6 +2148,8 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
                if (connection->active)
                   FD_SET(connection->fd, &fds);
             }
+            if (netplay->udp_fd >= 0)
+               FD_SET(netplay->udp_fd, &fds);
 
             if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
                return -1;
@@ -25,6 +25,10 @@
 #include <features/features_cpu.h>
 #include <streams/trans_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "../../msg_hash.h"
 #include "../../verbosity.h"
 
@@ -54,6 +58,13 @@ typedef uint32_t client_bitmap_t;
 
 #define NETPLAY_MAX_STALL_FRAMES       60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
+
+/* Part of a frame, in percent, replaying may take up. What is left over is
+ * replayed in the next frame. */
+#define NETPLAY_REPLAY_BUDGET          50
+
+/* Frames over which the deepest rollback decides input latency */
+#define NETPLAY_ROLLBACK_WINDOW        60
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
@@ -89,11 +100,40 @@ typedef uint32_t client_bitmap_t;
 
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+/* Savestates may be sent as a delta against the previous one */
+#define NETPLAY_COMPRESSION_DELTA (1<<1)
+/* zstd, preferred to zlib when both peers have it */
+#define NETPLAY_COMPRESSION_ZSTD (1<<4)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED_ZLIB NETPLAY_COMPRESSION_ZLIB
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED_ZLIB 0
 #endif
+#if HAVE_ZSTD
+#define NETPLAY_COMPRESSION_SUPPORTED_ZSTD NETPLAY_COMPRESSION_ZSTD
+#else
+#define NETPLAY_COMPRESSION_SUPPORTED_ZSTD 0
+#endif
+#define NETPLAY_COMPRESSION_SUPPORTED (NETPLAY_COMPRESSION_SUPPORTED_ZLIB | \
+      NETPLAY_COMPRESSION_SUPPORTED_ZSTD | NETPLAY_COMPRESSION_DELTA)
+
+/* zlib and zstd level for savestates. They are sent while the game waits
+ * for them, so speed matters more than size. */
+#define NETPLAY_COMPRESSION_LEVEL 1
+
+/* Not a compression, but the header has no other room for it: input may
+ * also be sent over UDP */
+#define NETPLAY_COMPRESSION_UDP_INPUT (1<<2)
+
+/* Nor is this: the peer answers NETPLAY_CMD_PING */
+#define NETPLAY_COMPRESSION_PING (1<<3)
+
+/* How often to measure the round trip time, in usec */
+#define NETPLAY_PING_INTERVAL 1000000
+
+/* How many frames of input each UDP datagram carries, so that losing a few
+ * in a row costs nothing */
+#define NETPLAY_UDP_REDUNDANCY 8
 
 enum netplay_cmd
 {
@@ -140,6 +180,9 @@ enum netplay_cmd
    /* Report player mode refused */
    NETPLAY_CMD_MODE_REFUSED   = 0x0027,
 
+   /* Give the token to put in UDP datagrams */
+   NETPLAY_CMD_UDP            = 0x0028,
+
    /* Loading and synchronization */
 
    /* Send the CRC hash of a frame's state */
@@ -166,6 +209,17 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send a savestate for the client to load, as a delta against the last
+    * one it was sent */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
+   /* Asks to be sent the payload back with NETPLAY_CMD_PONG, payload is our
+    * time in usec as two words, high first */
+   NETPLAY_CMD_PING           = 0x0049,
+
+   /* Answer to NETPLAY_CMD_PING */
+   NETPLAY_CMD_PONG           = 0x004A,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -265,7 +319,10 @@ enum rarch_netplay_stall_reason
    NETPLAY_STALL_SERVER_REQUESTED,
 
    /* We have no connection and must have one to proceed */
-   NETPLAY_STALL_NO_CONNECTION
+   NETPLAY_STALL_NO_CONNECTION,
+
+   /* We ran out of time replaying and must finish before running on */
+   NETPLAY_STALL_REPLAY
 };
 
 /* Input state for a particular client-device pair */
@@ -322,6 +379,18 @@ struct socket_buffer
    size_t bufsz;
    size_t start, end;
    size_t read;
+
+#ifdef HAVE_THREADS
+   /* Held around any use, if the relay thread may share this buffer */
+   slock_t *lock;
+#endif
+
+   /* Is sending left to the relay thread, and did it fail there? */
+   bool relayed;
+   bool failed;
+
+   /* Bytes queued for sending or received, for the statistics */
+   uint64_t bytes;
 };
 
 /* Each connection gets a connection struct */
@@ -359,6 +428,25 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* Does this peer take savestate deltas, and (server only) does it hold
+    * the delta base? */
+   bool delta_supported;
+   bool delta_base_valid;
+
+   /* Does this peer take input over UDP, the token identifying its
+    * datagrams, and where to send them once known */
+   bool udp_supported;
+   bool udp_active;
+   uint32_t udp_token;
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_size;
+
+   /* Does this peer answer pings, when did we last send one, and the round
+    * trip time and its jitter, in usec (0 until measured) */
+   bool ping_supported;
+   retro_time_t ping_time;
+   retro_time_t rtt, jitter;
+
    /* Is this player paused? */
    bool paused;
 
@@ -444,6 +532,21 @@ struct netplay
    /* TCP port (only set if serving) */
    uint16_t tcp_port;
 
+   /* UDP socket for input, or -1 if input only goes over TCP */
+   int udp_fd;
+
+#ifdef HAVE_THREADS
+   /* Thread sending to spectators, so that fanning out to many of them
+    * doesn't cost frame time (server only) */
+   sthread_t *relay_thread;
+   slock_t *relay_lock;
+   scond_t *relay_cond;
+   bool relay_quit;
+#endif
+
+   /* Recording of the input, if enabled, see netplay_record.c */
+   struct netplay_record *record;
+
    /* NAT traversal info (if NAT traversal is used and serving) */
    bool nat_traversal, nat_traversal_task_oustanding;
    struct natt_status nat_traversal_state;
@@ -453,12 +556,20 @@ struct netplay
 
    /* Compression transcoder */
    struct compression_transcoder compress_nil,
-                                 compress_zlib;
+                                 compress_zlib,
+                                 compress_zstd;
 
    /* A buffer into which to compress frames for transfer */
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* The last savestate the server sent, which savestate deltas are taken
+    * against, and a buffer for the deltas */
+   uint8_t *delta_base;
+   uint32_t delta_base_crc;
+   uint8_t *delta_buffer;
+   size_t delta_buffer_size;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -541,6 +652,27 @@ struct netplay
    int frame_run_time_ptr;
    retro_time_t frame_run_time_sum, frame_run_time_avg;
 
+   /* How long replaying may take in a frame */
+   retro_time_t replay_budget;
+
+   /* How far ahead of the remote input we ran in recent frames. The
+    * deepest of these covers jitter as well as latency. */
+   uint32_t rollback_depth[NETPLAY_ROLLBACK_WINDOW];
+   int rollback_depth_ptr;
+
+   /* Rollback statistics of the session */
+   uint32_t rollback_count, rollback_frames, rollback_max, replay_stalls;
+   uint32_t rollback_depths[NETPLAY_STATS_DEPTHS];
+   uint32_t crc_mismatches;
+
+   /* Frames replayed per second, measured at every ping */
+   float replayed_per_second;
+   retro_time_t replayed_time;
+   uint32_t replayed_frames;
+
+   /* UDP traffic, which has no socket buffers to count it */
+   uint64_t udp_bytes_sent, udp_bytes_received;
+
    /* Latency frames; positive to hide network latency, negative to hide input latency */
    int input_latency_frames;
 
@@ -602,6 +734,17 @@ void netplay_deinit_socket_buffer(struct socket_buffer *sbuf);
 bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
    size_t len);
 
+/**
+ * netplay_send_gather
+ *
+ * Queue data made up of several pieces, such as a command header and its
+ * payload. Where possible, large data is sent straight from the pieces
+ * together with what is already queued, and only what the socket doesn't
+ * take is copied into the buffer.
+ */
+bool netplay_send_gather(struct socket_buffer *sbuf, int sockfd,
+   const void **bufs, const size_t *lens, size_t count);
+
 /**
  * netplay_send_flush
  *
@@ -612,6 +755,15 @@ bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
  */
 bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block);
 
+/**
+ * netplay_send_flush_relayed
+ *
+ * Flush a relayed buffer without blocking, from the relay thread, which
+ * holds the lock. A failure is remembered for the connection's owner to
+ * find.
+ */
+void netplay_send_flush_relayed(struct socket_buffer *sbuf, int sockfd);
+
 /**
  * netplay_recv
  *
@@ -668,6 +820,36 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
  */
 void netplay_delta_frame_free(struct delta_frame *delta);
 
+/**
+ * netplay_state_delta_set_base
+ *
+ * Make this savestate the one deltas are taken against.
+ *
+ * Returns: True if the delta base could be allocated.
+ */
+bool netplay_state_delta_set_base(netplay_t *netplay, const uint8_t *state);
+
+/**
+ * netplay_state_delta_encode
+ *
+ * Write the blocks in which this savestate differs from the delta base into
+ * the delta buffer.
+ *
+ * Returns: True if the delta fits in the delta buffer and is worth sending.
+ */
+bool netplay_state_delta_encode(netplay_t *netplay, const uint8_t *state,
+      size_t *size);
+
+/**
+ * netplay_state_delta_apply
+ *
+ * Apply a delta of this size, as received into the delta buffer, to the
+ * delta base.
+ *
+ * Returns: True if the delta was valid, in which case it was applied.
+ */
+bool netplay_state_delta_apply(netplay_t *netplay, size_t size);
+
 /**
  * netplay_input_state_for
  *
@@ -779,6 +961,8 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * @check_frames         : Frequency with which to check CRCs.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
+ * @udp_input            : If true, also send input over UDP.
+ * @spectator_relay      : If true, send to spectators from a thread.
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
  *
@@ -789,7 +973,8 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    bool stateless_mode, int check_frames,
-   const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
+   const struct retro_callbacks *cb, bool nat_traversal, bool udp_input,
+   bool spectator_relay, const char *nick,
    const char *netplay_password,
    const char *netplay_spectate_password,
    uint64_t quirks);
@@ -831,6 +1016,18 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_recv_input_frame
+ *
+ * Take in a frame of input that arrived other than through NETPLAY_CMD_INPUT,
+ * in network byte order. It must be the next frame needed from this player.
+ *
+ * Returns true if the input was taken.
+ */
+bool netplay_recv_input_frame(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t client_num,
+   uint32_t frame_num, const uint32_t *data);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -859,6 +1056,15 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
  */
 bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta);
 
+/**
+ * netplay_cmd_ping
+ *
+ * Send a ping to measure the round trip time to a connection, if it answers
+ * them.
+ */
+bool netplay_cmd_ping(netplay_t *netplay,
+   struct netplay_connection *connection);
+
 /**
  * netplay_cmd_request_savestate
  *
@@ -912,6 +1118,133 @@ void netplay_announce_nat_traversal(netplay_t *netplay);
  */
 void netplay_init_nat_traversal(netplay_t *netplay);
 
+/***************************************************************
+ * NETPLAY-RELAY.C
+ **************************************************************/
+
+/**
+ * netplay_relay_init
+ *
+ * Start the thread spectators are sent to from.
+ *
+ * Returns true if it could be started.
+ */
+bool netplay_relay_init(netplay_t *netplay);
+
+/**
+ * netplay_relay_deinit
+ *
+ * Stop the relay thread. Whatever it hadn't sent yet is left in the
+ * connections' buffers.
+ */
+void netplay_relay_deinit(netplay_t *netplay);
+
+/**
+ * netplay_relay_update
+ *
+ * Hand a connection over to the relay thread if it is spectating, or take it
+ * back if not.
+ */
+void netplay_relay_update(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_relay_detach
+ *
+ * Take a connection back from the relay thread, e.g. before closing it.
+ */
+void netplay_relay_detach(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_relay_lock
+ *
+ * Keep the relay thread away from the connections, e.g. while they're
+ * reallocated.
+ */
+void netplay_relay_lock(netplay_t *netplay);
+void netplay_relay_unlock(netplay_t *netplay);
+
+/**
+ * netplay_relay_wake
+ *
+ * Have the relay thread send what was queued this frame.
+ */
+void netplay_relay_wake(netplay_t *netplay);
+
+/***************************************************************
+ * NETPLAY-UDP.C
+ **************************************************************/
+
+/**
+ * netplay_udp_init
+ *
+ * Open the UDP socket input is also sent over. The server takes it on its TCP
+ * port, clients send to the port they are connected to.
+ *
+ * Returns true if the socket could be opened.
+ */
+bool netplay_udp_init(netplay_t *netplay);
+
+/**
+ * netplay_udp_deinit
+ *
+ * Close the UDP socket.
+ */
+void netplay_udp_deinit(netplay_t *netplay);
+
+/**
+ * netplay_udp_send_input
+ *
+ * Send our input of the current and previous frames to a connection over
+ * UDP, if it takes it.
+ */
+void netplay_udp_send_input(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_udp_poll
+ *
+ * Take in the input of every waiting UDP datagram.
+ */
+void netplay_udp_poll(netplay_t *netplay, bool *had_input);
+
+/***************************************************************
+ * NETPLAY-RECORD.C
+ **************************************************************/
+
+/**
+ * netplay_record_init
+ *
+ * Start recording the input of the session to the given file.
+ *
+ * Returns true if the file could be opened.
+ */
+bool netplay_record_init(netplay_t *netplay, const char *path);
+
+/**
+ * netplay_record_deinit
+ *
+ * Write out the rest of the recording and close it.
+ */
+void netplay_record_deinit(netplay_t *netplay);
+
+/**
+ * netplay_record_frames
+ *
+ * Record the frames whose input became final since the last call.
+ */
+void netplay_record_frames(netplay_t *netplay);
+
+/**
+ * netplay_record_state
+ *
+ * Note that a savestate was loaded, or the core reset if delta is NULL,
+ * before the given frame. Input of earlier frames is no longer recorded.
+ */
+void netplay_record_state(netplay_t *netplay, uint32_t frame,
+      struct delta_frame *delta);
+
 /***************************************************************
  * NETPLAY-KEYBOARD.C
  **************************************************************/
@@ -0,0 +1,433 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <streams/file_stream.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "netplay_private.h"
+
+#include "../../content.h"
+
+/* Input recording: every frame whose input is final, as it went to the core,
+ * with the CRCs the server checks the peers against and wherever a savestate
+ * was loaded. From the state of the first frame, which is only identified by
+ * its CRC, this is enough to run the session again without any peer and find
+ * where it went wrong.
+ *
+ * Everything is a word in network byte order. The header is:
+ *    magic, version, content CRC, savestate size, device count,
+ *    input words of each device, first frame, CRC of its state
+ * Followed by records, each a word of type << 24 | count, then:
+ *    INPUT: input of each device, for count frames in a row
+ *    CRC:   frame, CRC of the state before it
+ *    STATE: frame, CRC of the savestate loaded before it
+ *    RESET: frame the core was reset before
+ *    GAP:   frame recording resumes at, CRC of its state
+ */
+
+#define NETPLAY_RECORD_MAGIC     0x4E505243 /* "NPRC" */
+#define NETPLAY_RECORD_VERSION   1
+#define NETPLAY_RECORD_MAX_COUNT 0xFFFFFF
+
+/* A keyboard, the largest device, takes five words */
+#define NETPLAY_RECORD_DEVICE_WORDS 5
+
+/* Words collected before they are handed to the writer */
+#define NETPLAY_RECORD_CHUNK_WORDS 16384
+
+enum netplay_record_type
+{
+   NETPLAY_RECORD_INPUT = 1,
+   NETPLAY_RECORD_CRC,
+   NETPLAY_RECORD_STATE,
+   NETPLAY_RECORD_RESET,
+   NETPLAY_RECORD_GAP
+};
+
+struct netplay_record
+{
+   RFILE *file;
+
+   /* The next frame to record, once started */
+   bool started;
+   uint32_t frame_count;
+
+   /* Input words of each device and of a whole frame */
+   uint32_t input_size[MAX_INPUT_DEVICES];
+   size_t frame_size;
+
+   /* The input repeated by the current run, and for how many frames */
+   uint32_t run[MAX_INPUT_DEVICES * NETPLAY_RECORD_DEVICE_WORDS];
+   uint32_t input[MAX_INPUT_DEVICES * NETPLAY_RECORD_DEVICE_WORDS];
+   uint32_t run_count;
+
+   /* Words not handed to the writer yet */
+   uint32_t *chunk;
+   size_t chunk_used;
+
+#ifdef HAVE_THREADS
+   /* The writer, and the words it is writing or is yet to */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   uint32_t *pending;
+   size_t pending_used;
+   bool quit;
+#endif
+};
+
+static void netplay_record_write(struct netplay_record *record,
+      const uint32_t *words, size_t count)
+{
+   if (filestream_write(record->file, words,
+            count * sizeof(uint32_t)) != (int64_t)(count * sizeof(uint32_t)))
+      RARCH_WARN("[netplay] Failed to write the input recording.\n");
+}
+
+#ifdef HAVE_THREADS
+static void netplay_record_thread(void *data)
+{
+   struct netplay_record *record = (struct netplay_record*)data;
+
+   slock_lock(record->lock);
+
+   for (;;)
+   {
+      while (!record->pending_used && !record->quit)
+         scond_wait(record->cond, record->lock);
+
+      if (!record->pending_used)
+         break;
+
+      /* Let the next chunk fill up meanwhile */
+      slock_unlock(record->lock);
+      netplay_record_write(record, record->pending, record->pending_used);
+      slock_lock(record->lock);
+
+      record->pending_used = 0;
+      scond_signal(record->cond);
+   }
+
+   slock_unlock(record->lock);
+}
+#endif
+
+/* Hand what was collected to the writer, waiting for it only if it is still
+ * busy with the previous chunk */
+static void netplay_record_flush(struct netplay_record *record)
+{
+#ifdef HAVE_THREADS
+   if (record->thread)
+   {
+      uint32_t *tmp;
+
+      slock_lock(record->lock);
+      while (record->pending_used)
+         scond_wait(record->cond, record->lock);
+
+      tmp                  = record->pending;
+      record->pending      = record->chunk;
+      record->pending_used = record->chunk_used;
+      record->chunk        = tmp;
+      scond_signal(record->cond);
+      slock_unlock(record->lock);
+
+      record->chunk_used   = 0;
+      return;
+   }
+#endif
+
+   netplay_record_write(record, record->chunk, record->chunk_used);
+   record->chunk_used = 0;
+}
+
+static void netplay_record_words(struct netplay_record *record,
+      const uint32_t *words, size_t count)
+{
+   size_t i;
+
+   if (record->chunk_used + count > NETPLAY_RECORD_CHUNK_WORDS)
+      netplay_record_flush(record);
+
+   for (i = 0; i < count; i++)
+      record->chunk[record->chunk_used++] = htonl(words[i]);
+}
+
+/* End the current run of input */
+static void netplay_record_end_run(struct netplay_record *record)
+{
+   uint32_t type;
+
+   if (!record->run_count)
+      return;
+
+   type = (NETPLAY_RECORD_INPUT << 24) | record->run_count;
+   netplay_record_words(record, &type, 1);
+   netplay_record_words(record, record->run, record->frame_size);
+   record->run_count = 0;
+}
+
+static void netplay_record_event(struct netplay_record *record,
+      enum netplay_record_type type, uint32_t frame, uint32_t crc,
+      size_t words)
+{
+   uint32_t event[3];
+
+   netplay_record_end_run(record);
+
+   event[0] = (uint32_t)type << 24;
+   event[1] = frame;
+   event[2] = crc;
+   netplay_record_words(record, event, words);
+}
+
+static void netplay_record_start(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   size_t i;
+   uint32_t header[5];
+   struct netplay_record *record = netplay->record;
+
+   header[0] = NETPLAY_RECORD_MAGIC;
+   header[1] = NETPLAY_RECORD_VERSION;
+   header[2] = content_get_crc();
+   header[3] = (uint32_t)netplay->state_size;
+   header[4] = MAX_INPUT_DEVICES;
+   netplay_record_words(record, header, 5);
+
+   /* Clients only know the devices after the handshake */
+   record->frame_size = 0;
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+   {
+      record->input_size[i] = netplay_expected_input_size(netplay, 1 << i);
+      record->frame_size   += record->input_size[i];
+   }
+   netplay_record_words(record, record->input_size, MAX_INPUT_DEVICES);
+
+   header[0] = delta->frame;
+   header[1] = netplay_delta_frame_crc(netplay, delta);
+   netplay_record_words(record, header, 2);
+
+   record->started = true;
+}
+
+/* Give the resolved input of a frame, zeroes for devices without it */
+static void netplay_record_input(netplay_t *netplay, struct delta_frame *delta)
+{
+   size_t i;
+   struct netplay_record *record = netplay->record;
+   uint32_t *input               = record->input;
+
+   for (i = 0; i < MAX_INPUT_DEVICES; i++)
+   {
+      netplay_input_state_t istate = delta->resolved_input[i];
+      uint32_t size                = record->input_size[i];
+
+      if (istate && istate->used && istate->size == size)
+         memcpy(input, istate->data, size * sizeof(uint32_t));
+      else
+         memset(input, 0, size * sizeof(uint32_t));
+      input += size;
+   }
+
+   /* Most frames are the same as the one before */
+   if (record->run_count && record->run_count < NETPLAY_RECORD_MAX_COUNT &&
+         !memcmp(record->input, record->run,
+            record->frame_size * sizeof(uint32_t)))
+   {
+      record->run_count++;
+      return;
+   }
+
+   netplay_record_end_run(record);
+   memcpy(record->run, record->input, record->frame_size * sizeof(uint32_t));
+   record->run_count = 1;
+}
+
+/**
+ * netplay_record_init
+ *
+ * Start recording the input of the session to the given file.
+ *
+ * Returns true if the file could be opened.
+ */
+bool netplay_record_init(netplay_t *netplay, const char *path)
+{
+   struct netplay_record *record = (struct netplay_record*)
+      calloc(1, sizeof(*record));
+
+   if (!record)
+      return false;
+
+   record->file  = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   record->chunk = (uint32_t*)malloc(
+         NETPLAY_RECORD_CHUNK_WORDS * sizeof(uint32_t));
+   netplay->record = record;
+
+   if (!record->file || !record->chunk)
+   {
+      RARCH_ERR("[netplay] Could not record input to %s.\n", path);
+      netplay_record_deinit(netplay);
+      return false;
+   }
+
+#ifdef HAVE_THREADS
+   /* Without a writer, chunks are simply written from here */
+   record->pending = (uint32_t*)malloc(
+         NETPLAY_RECORD_CHUNK_WORDS * sizeof(uint32_t));
+   record->lock    = slock_new();
+   record->cond    = scond_new();
+   if (record->pending && record->lock && record->cond)
+      record->thread = sthread_create(netplay_record_thread, record);
+#endif
+
+   RARCH_LOG("[netplay] Recording input to %s.\n", path);
+   return true;
+}
+
+/**
+ * netplay_record_deinit
+ *
+ * Write out the rest of the recording and close it.
+ */
+void netplay_record_deinit(netplay_t *netplay)
+{
+   struct netplay_record *record = netplay->record;
+
+   if (!record)
+      return;
+
+   if (record->file)
+   {
+      netplay_record_end_run(record);
+      netplay_record_flush(record);
+   }
+
+#ifdef HAVE_THREADS
+   if (record->thread)
+   {
+      slock_lock(record->lock);
+      record->quit = true;
+      scond_signal(record->cond);
+      slock_unlock(record->lock);
+      sthread_join(record->thread);
+   }
+   if (record->cond)
+      scond_free(record->cond);
+   if (record->lock)
+      slock_free(record->lock);
+   free(record->pending);
+#endif
+
+   if (record->file)
+      filestream_close(record->file);
+   free(record->chunk);
+   free(record);
+   netplay->record = NULL;
+}
+
+/**
+ * netplay_record_frames
+ *
+ * Record the frames whose input became final since the last call.
+ */
+void netplay_record_frames(netplay_t *netplay)
+{
+   uint32_t behind;
+   size_t ptr;
+   struct netplay_record *record = netplay->record;
+
+   if (!record)
+      return;
+
+   if (record->started && record->frame_count >= netplay->other_frame_count)
+      return;
+
+   /* Find the first frame we haven't recorded, if it's still there */
+   behind = record->started ?
+      netplay->other_frame_count - record->frame_count : 1;
+   if (behind > netplay->other_frame_count)
+      return;
+
+   ptr = netplay->other_ptr;
+   if (behind < netplay->buffer_size)
+   {
+      uint32_t i;
+      for (i = 0; i < behind; i++)
+         ptr = PREV_PTR(ptr);
+   }
+
+   if (behind >= netplay->buffer_size || !netplay->buffer[ptr].used ||
+         netplay->buffer[ptr].frame != netplay->other_frame_count - behind)
+   {
+      /* Lost track, e.g. while nobody else was connected. Start over from
+       * the latest frame. */
+      ptr    = PREV_PTR(netplay->other_ptr);
+      behind = 1;
+      if (!netplay->buffer[ptr].used ||
+            netplay->buffer[ptr].frame != netplay->other_frame_count - 1)
+         return;
+      if (record->started)
+         netplay_record_event(record, NETPLAY_RECORD_GAP,
+               netplay->buffer[ptr].frame,
+               netplay_delta_frame_crc(netplay, &netplay->buffer[ptr]), 3);
+   }
+
+   if (!record->started)
+      netplay_record_start(netplay, &netplay->buffer[ptr]);
+
+   while (behind--)
+   {
+      struct delta_frame *delta = &netplay->buffer[ptr];
+
+      if (delta->crc)
+         netplay_record_event(record, NETPLAY_RECORD_CRC,
+               delta->frame, delta->crc, 3);
+      netplay_record_input(netplay, delta);
+      ptr = NEXT_PTR(ptr);
+   }
+
+   record->frame_count = netplay->other_frame_count;
+}
+
+/**
+ * netplay_record_state
+ *
+ * Note that a savestate was loaded, or the core reset if delta is NULL,
+ * before the given frame. Input of earlier frames is no longer recorded.
+ */
+void netplay_record_state(netplay_t *netplay, uint32_t frame,
+      struct delta_frame *delta)
+{
+   struct netplay_record *record = netplay->record;
+
+   if (!record || !record->started)
+      return;
+
+   if (delta)
+      netplay_record_event(record, NETPLAY_RECORD_STATE, frame,
+            netplay_delta_frame_crc(netplay, delta), 3);
+   else
+      netplay_record_event(record, NETPLAY_RECORD_RESET, frame, 0, 2);
+
+   record->frame_count = frame;
+}
@@ -0,0 +1,200 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include <boolean.h>
+
+#include "netplay_private.h"
+
+/* Spectator relay: the server still queues everything for spectators into
+ * their send buffers as usual, which is only a copy, but the sending itself
+ * is done by a thread of its own. The emulation thread then only makes
+ * system calls for the players' connections. A spectator whose buffer fills
+ * up is dropped rather than waited for. */
+
+/* How often the relay thread retries sends the sockets didn't take, in usec */
+#define NETPLAY_RELAY_RETRY_USEC 4000
+
+#ifdef HAVE_THREADS
+static void netplay_relay_thread(void *data)
+{
+   netplay_t *netplay = (netplay_t*)data;
+
+   slock_lock(netplay->relay_lock);
+
+   while (!netplay->relay_quit)
+   {
+      size_t i;
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+
+         if (connection->active && connection->send_packet_buffer.relayed)
+            netplay_send_flush_relayed(&connection->send_packet_buffer,
+                  connection->fd);
+      }
+
+      scond_wait_timeout(netplay->relay_cond, netplay->relay_lock,
+            NETPLAY_RELAY_RETRY_USEC);
+   }
+
+   slock_unlock(netplay->relay_lock);
+}
+#endif
+
+/**
+ * netplay_relay_init
+ *
+ * Start the thread spectators are sent to from.
+ *
+ * Returns true if it could be started.
+ */
+bool netplay_relay_init(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   netplay->relay_quit = false;
+   netplay->relay_lock = slock_new();
+   netplay->relay_cond = scond_new();
+
+   if (netplay->relay_lock && netplay->relay_cond)
+      netplay->relay_thread = sthread_create(netplay_relay_thread, netplay);
+
+   if (netplay->relay_thread)
+      return true;
+
+   netplay_relay_deinit(netplay);
+#endif
+   return false;
+}
+
+/**
+ * netplay_relay_deinit
+ *
+ * Stop the relay thread. Whatever it hadn't sent yet is left in the
+ * connections' buffers.
+ */
+void netplay_relay_deinit(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   size_t i;
+
+   if (netplay->relay_thread)
+   {
+      slock_lock(netplay->relay_lock);
+      netplay->relay_quit = true;
+      scond_signal(netplay->relay_cond);
+      slock_unlock(netplay->relay_lock);
+
+      sthread_join(netplay->relay_thread);
+      netplay->relay_thread = NULL;
+   }
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct socket_buffer *sbuf = &netplay->connections[i].send_packet_buffer;
+      sbuf->relayed = false;
+      sbuf->lock    = NULL;
+   }
+
+   if (netplay->relay_cond)
+      scond_free(netplay->relay_cond);
+   if (netplay->relay_lock)
+      slock_free(netplay->relay_lock);
+   netplay->relay_cond = NULL;
+   netplay->relay_lock = NULL;
+#endif
+}
+
+/**
+ * netplay_relay_update
+ *
+ * Hand a connection over to the relay thread if it is spectating, or take it
+ * back if not.
+ */
+void netplay_relay_update(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+#ifdef HAVE_THREADS
+   struct socket_buffer *sbuf = &connection->send_packet_buffer;
+   bool relayed               = netplay->relay_thread &&
+      connection->active &&
+      connection->mode == NETPLAY_CONNECTION_SPECTATING;
+
+   if (relayed == sbuf->relayed)
+      return;
+
+   sbuf->lock    = netplay->relay_lock;
+   slock_lock(netplay->relay_lock);
+   sbuf->relayed = relayed;
+   slock_unlock(netplay->relay_lock);
+#endif
+}
+
+/**
+ * netplay_relay_detach
+ *
+ * Take a connection back from the relay thread, e.g. before closing it.
+ */
+void netplay_relay_detach(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+#ifdef HAVE_THREADS
+   struct socket_buffer *sbuf = &connection->send_packet_buffer;
+
+   if (!sbuf->lock)
+      return;
+
+   slock_lock(sbuf->lock);
+   sbuf->relayed = false;
+   slock_unlock(sbuf->lock);
+   sbuf->lock    = NULL;
+#endif
+}
+
+/**
+ * netplay_relay_lock
+ *
+ * Keep the relay thread away from the connections, e.g. while they're
+ * reallocated.
+ */
+void netplay_relay_lock(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   if (netplay->relay_lock)
+      slock_lock(netplay->relay_lock);
+#endif
+}
+
+void netplay_relay_unlock(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   if (netplay->relay_lock)
+      slock_unlock(netplay->relay_lock);
+#endif
+}
+
+/**
+ * netplay_relay_wake
+ *
+ * Have the relay thread send what was queued this frame.
+ */
+void netplay_relay_wake(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   if (netplay->relay_thread)
+      scond_signal(netplay->relay_cond);
+#endif
+}
@@ -24,6 +24,7 @@
 #include "netplay_private.h"
 
 #include "../../autosave.h"
+#include "../../performance_counters.h"
 #include "../../driver.h"
 #include "../../input/input_driver.h"
 
@@ -538,6 +539,7 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
             }
             else
                netplay_cmd_request_savestate(netplay);
+            netplay->crc_mismatches++;
          }
       }
       else if (!netplay->crc_validity_checked)
@@ -674,6 +676,9 @@ bool netplay_sync_pre_frame(netplay_t *netplay,
                break;
          if (connection_num == netplay->connections_size)
          {
+            /* The relay thread goes through the connections */
+            netplay_relay_lock(netplay);
+
             if (connection_num == 0)
             {
                netplay->connections = (struct netplay_connection*)
@@ -681,6 +686,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay,
 
                if (!netplay->connections)
                {
+                  netplay_relay_unlock(netplay);
                   socket_close(new_fd);
                   goto process;
                }
@@ -698,6 +704,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay,
 
                if (!new_connections)
                {
+                  netplay_relay_unlock(netplay);
                   socket_close(new_fd);
                   goto process;
                }
@@ -708,6 +715,8 @@ bool netplay_sync_pre_frame(netplay_t *netplay,
                netplay->connections_size = new_connections_size;
 
             }
+
+            netplay_relay_unlock(netplay);
          }
          connection         = &netplay->connections[connection_num];
 
@@ -742,6 +751,8 @@ process:
    return (netplay->stall != NETPLAY_STALL_NO_CONNECTION);
 }
 
+static rarch_histogram_t netplay_replay_histogram;
+
 /**
  * netplay_sync_post_frame
  * @netplay              : pointer to netplay object
@@ -784,6 +795,10 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          input_driver_unset_nonblock_state();
          driver_set_nonblock_state();
       }
+
+      /* Nobody to stay in sync with */
+      if (netplay->stall == NETPLAY_STALL_REPLAY)
+         netplay->stall = NETPLAY_STALL_NONE;
       return;
    }
 
@@ -841,10 +856,24 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      retro_time_t replay_start = cpu_features_get_time_usec();
+      bool resumed              = netplay->stall == NETPLAY_STALL_REPLAY;
 
       /* Replay frames. */
       netplay->is_replay = true;
 
+      /* A replay put off from the last frame is the same rollback */
+      if (!resumed)
+      {
+         uint32_t depth = netplay->run_frame_count - netplay->replay_frame_count;
+
+         netplay->rollback_count++;
+         if (depth > netplay->rollback_max)
+            netplay->rollback_max = depth;
+         netplay->rollback_depths[(depth < NETPLAY_STATS_DEPTHS ?
+               depth : NETPLAY_STATS_DEPTHS) - 1]++;
+      }
+
       /* If we have a keyboard device, we replay the previous frame's input
        * just to assert that the keydown/keyup events work if the core
        * translates them in that way */
@@ -930,23 +959,71 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          netplay->frame_run_time_ptr++;
          if (netplay->frame_run_time_ptr >= NETPLAY_FRAME_RUN_TIME_WINDOW)
             netplay->frame_run_time_ptr = 0;
+         netplay->rollback_frames++;
+
+         /* Spread long replays over several frames rather than
+          * holding up this one */
+         if (start + tm - replay_start >= netplay->replay_budget)
+            break;
       }
 
       /* Average our time */
       netplay->frame_run_time_avg   = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
 
-      if (netplay->unread_frame_count < netplay->run_frame_count)
+      if (netplay->replay_frame_count < netplay->run_frame_count)
       {
-         netplay->other_ptr         = netplay->unread_ptr;
-         netplay->other_frame_count = netplay->unread_frame_count;
+         /* Out of time. Keep where we got to, and carry on from there
+          * before running another frame. The input of later frames
+          * might have been right, but not the states they started from,
+          * so they must not be skipped. */
+         serial_info.data        = netplay->buffer[netplay->replay_ptr].state;
+         serial_info.size        = netplay->state_size;
+         serial_info.data_const  = NULL;
+         memset(serial_info.data, 0, serial_info.size);
+         core_serialize(&serial_info);
+
+         if (netplay->unread_frame_count < netplay->replay_frame_count)
+         {
+            netplay->other_ptr         = netplay->unread_ptr;
+            netplay->other_frame_count = netplay->unread_frame_count;
+         }
+         else
+         {
+            netplay->other_ptr         = netplay->replay_ptr;
+            netplay->other_frame_count = netplay->replay_frame_count;
+         }
+         netplay->force_rewind         = true;
+
+         if (!resumed)
+            netplay->replay_stalls++;
+         if (netplay->stall != NETPLAY_STALL_NO_CONNECTION)
+         {
+            netplay->stall             = NETPLAY_STALL_REPLAY;
+            netplay->stall_time        = 0;
+         }
       }
       else
       {
-         netplay->other_ptr         = netplay->run_ptr;
-         netplay->other_frame_count = netplay->run_frame_count;
+         if (netplay->unread_frame_count < netplay->run_frame_count)
+         {
+            netplay->other_ptr         = netplay->unread_ptr;
+            netplay->other_frame_count = netplay->unread_frame_count;
+         }
+         else
+         {
+            netplay->other_ptr         = netplay->run_ptr;
+            netplay->other_frame_count = netplay->run_frame_count;
+         }
+         netplay->force_rewind         = false;
+
+         if (netplay->stall == NETPLAY_STALL_REPLAY)
+            netplay->stall             = NETPLAY_STALL_NONE;
       }
-      netplay->is_replay            = false;
-      netplay->force_rewind         = false;
+      netplay->is_replay               = false;
+
+      rarch_histogram_register(&netplay_replay_histogram, "Netplay replay");
+      rarch_histogram_add(&netplay_replay_histogram,
+            cpu_features_get_time_usec() - replay_start);
    }
 
    if (netplay->is_server)
@@ -0,0 +1,313 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <boolean.h>
+#include <net/net_socket.h>
+
+#include "netplay_private.h"
+
+/* Input is also sent as UDP datagrams, each repeating the input of the
+ * previous frames, so that a lost packet doesn't hold up every later input
+ * the way it does on TCP. TCP stays the reliable channel: commands,
+ * savestates and the input itself still go over it, and whichever copy of
+ * an input arrives first is used.
+ *
+ * A datagram is, in network byte order:
+ *    token, client number, first frame, frame count, input of each frame
+ * The token is given to the client by the server with NETPLAY_CMD_UDP and
+ * tells the server whose datagram it is and where to answer. */
+
+#if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY)
+#define HAVE_INET6 1
+#endif
+
+#define NETPLAY_UDP_HEADER_WORDS 4
+/* send_input_frame limits a frame of input to the same */
+#define NETPLAY_UDP_MAX_WORDS \
+   (NETPLAY_UDP_HEADER_WORDS + NETPLAY_UDP_REDUNDANCY * 16)
+
+/**
+ * netplay_udp_init
+ *
+ * Open the UDP socket input is also sent over. The server takes it on its TCP
+ * port, clients send to the port they are connected to.
+ *
+ * Returns true if the socket could be opened.
+ */
+bool netplay_udp_init(netplay_t *netplay)
+{
+   struct sockaddr_storage addr;
+   socklen_t addr_size = sizeof(addr);
+   int fd              = -1;
+
+   memset(&addr, 0, sizeof(addr));
+
+   if (netplay->is_server)
+   {
+      if (netplay->listen_fd < 0 ||
+            getsockname(netplay->listen_fd,
+               (struct sockaddr*)&addr, &addr_size) < 0)
+         return false;
+   }
+   else
+   {
+      struct netplay_connection *connection = &netplay->connections[0];
+
+      if (!connection->active ||
+            getpeername(connection->fd,
+               (struct sockaddr*)&addr, &addr_size) < 0)
+         return false;
+
+      connection->udp_addr      = addr;
+      connection->udp_addr_size = addr_size;
+   }
+
+   fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+      return false;
+
+#if defined(F_SETFD) && defined(FD_CLOEXEC)
+   /* Don't let any inherited processes keep open our port */
+   if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+      RARCH_WARN("Cannot set Netplay UDP port to close-on-exec.\n");
+#endif
+
+   if (netplay->is_server)
+   {
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+      /* Take datagrams from IPv4 clients too, like the listening socket */
+      int on = 0;
+      if (addr.ss_family == AF_INET6)
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on, sizeof(on));
+#endif
+      if (bind(fd, (struct sockaddr*)&addr, addr_size) < 0)
+      {
+         socket_close(fd);
+         return false;
+      }
+   }
+
+   if (!socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return false;
+   }
+
+   netplay->udp_fd = fd;
+   return true;
+}
+
+/**
+ * netplay_udp_deinit
+ *
+ * Close the UDP socket.
+ */
+void netplay_udp_deinit(netplay_t *netplay)
+{
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+   netplay->udp_fd = -1;
+}
+
+/**
+ * netplay_udp_send_input
+ *
+ * Send our input of the current and previous frames to a connection over
+ * UDP, if it takes it.
+ */
+void netplay_udp_send_input(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+   size_t ptrs[NETPLAY_UDP_REDUNDANCY];
+   uint32_t devices, device;
+   size_t i, j;
+   size_t bufused      = NETPLAY_UDP_HEADER_WORDS;
+   size_t ptr          = netplay->self_ptr;
+   uint32_t client_num = netplay->self_client_num;
+   uint32_t frame      = netplay->self_frame_count;
+   uint32_t count      = 0;
+
+   if (netplay->udp_fd < 0 || !connection->udp_active)
+      return;
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+   {
+      /* Go back over as many frames as we still have our input for */
+      while (count < NETPLAY_UDP_REDUNDANCY && count <= frame)
+      {
+         struct delta_frame *dframe = &netplay->buffer[ptr];
+         if (!dframe->used || dframe->frame != frame - count ||
+               !dframe->have_real[client_num])
+            break;
+         ptrs[count++] = ptr;
+         ptr           = PREV_PTR(ptr);
+      }
+   }
+
+   /* Clients send even without input, for the server to know where they
+    * are */
+   if (!count && netplay->is_server)
+      return;
+
+   devices = netplay->client_devices[client_num];
+
+   /* Oldest first */
+   for (i = count; i-- > 0; )
+   {
+      struct delta_frame *dframe = &netplay->buffer[ptrs[i]];
+
+      for (device = 0; device < MAX_INPUT_DEVICES; device++)
+      {
+         netplay_input_state_t istate;
+         if (!(devices & (1<<device)))
+            continue;
+         istate = dframe->real_input[device];
+         while (istate && (!istate->used || istate->client_num != client_num))
+            istate = istate->next;
+
+         /* The other side expects all of it, leave this to TCP */
+         if (!istate || bufused + istate->size > NETPLAY_UDP_MAX_WORDS)
+            return;
+
+         for (j = 0; j < istate->size; j++)
+            buffer[bufused + j] = htonl(istate->data[j]);
+         bufused += istate->size;
+      }
+   }
+
+   buffer[0] = htonl(connection->udp_token);
+   buffer[1] = htonl(client_num);
+   buffer[2] = htonl(frame + 1 - count);
+   buffer[3] = htonl(count);
+
+   /* Nothing to do about a lost datagram, TCP has it too */
+   if (sendto(netplay->udp_fd, (const char*)buffer,
+         (int)(bufused * sizeof(uint32_t)), 0,
+         (const struct sockaddr*)&connection->udp_addr,
+         connection->udp_addr_size) > 0)
+      netplay->udp_bytes_sent += bufused * sizeof(uint32_t);
+}
+
+static void netplay_udp_recv(netplay_t *netplay,
+      const uint32_t *buffer, size_t len,
+      const struct sockaddr_storage *addr, socklen_t addr_size,
+      bool *had_input)
+{
+   size_t i;
+   uint32_t token, client_num, frame, count, input_size;
+   struct netplay_connection *connection = NULL;
+
+   if (len < NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t) ||
+         len % sizeof(uint32_t))
+      return;
+
+   token      = ntohl(buffer[0]);
+   client_num = ntohl(buffer[1]);
+   frame      = ntohl(buffer[2]);
+   count      = ntohl(buffer[3]);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *candidate = &netplay->connections[i];
+
+      if (candidate->active &&
+            candidate->mode >= NETPLAY_CONNECTION_CONNECTED &&
+            candidate->udp_token == token &&
+            (netplay->is_server ?
+               candidate->udp_supported : candidate->udp_active))
+      {
+         connection = candidate;
+         break;
+      }
+   }
+
+   /* Stray, or from a connection gone since */
+   if (!connection)
+      return;
+
+   if (netplay->is_server)
+   {
+      /* Answer to wherever the client's NAT mapped it to */
+      connection->udp_addr      = *addr;
+      connection->udp_addr_size = addr_size;
+      connection->udp_active    = true;
+
+      /* Ignore the claimed client #, must be this client */
+      if (connection->mode != NETPLAY_CONNECTION_PLAYING)
+         return;
+      client_num = (uint32_t)(connection - netplay->connections + 1);
+   }
+   else if (client_num != 0)
+      return;
+
+   if (  !count
+         || count > NETPLAY_UDP_REDUNDANCY
+         || client_num >= MAX_CLIENTS
+         || !(netplay->connected_players & (1<<client_num)))
+      return;
+
+   input_size = netplay_expected_input_size(netplay,
+         netplay->client_devices[client_num]);
+   if (len != (NETPLAY_UDP_HEADER_WORDS + count * input_size)
+         * sizeof(uint32_t))
+      return;
+
+   buffer += NETPLAY_UDP_HEADER_WORDS;
+   for (i = 0; i < count; i++, frame++, buffer += input_size)
+   {
+      /* Already had this one */
+      if (frame < netplay->read_frame_count[client_num])
+         continue;
+
+      /* Anything after a frame we can't take yet has to wait too */
+      if (!netplay_recv_input_frame(netplay, connection, client_num,
+               frame, buffer))
+         break;
+
+      *had_input = true;
+   }
+}
+
+/**
+ * netplay_udp_poll
+ *
+ * Take in the input of every waiting UDP datagram.
+ */
+void netplay_udp_poll(netplay_t *netplay, bool *had_input)
+{
+   uint32_t buffer[NETPLAY_UDP_MAX_WORDS];
+
+   if (netplay->udp_fd < 0)
+      return;
+
+   for (;;)
+   {
+      struct sockaddr_storage addr;
+      socklen_t addr_size = sizeof(addr);
+      ssize_t len         = recvfrom(netplay->udp_fd, (char*)buffer,
+            sizeof(buffer), 0, (struct sockaddr*)&addr, &addr_size);
+
+      if (len < 0)
+         break;
+
+      netplay->udp_bytes_received += len;
+      netplay_udp_recv(netplay, buffer, (size_t)len,
+            &addr, addr_size, had_input);
+   }
+}
@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -25,6 +26,11 @@
 #endif
 
 #include <compat/strl.h>
+#include <streams/file_stream.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "performance_counters.h"
 
@@ -42,6 +48,42 @@ static struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 static unsigned perf_ptr_rarch;
 static unsigned perf_ptr_libretro;
 
+static rarch_histogram_t *perf_histograms[MAX_HISTOGRAMS];
+static unsigned perf_ptr_histograms;
+
+/* Cost of a counter in each of the last PERF_FRAMES frames */
+typedef struct rarch_perf_frames
+{
+   const struct retro_perf_counter *perf;
+   retro_perf_tick_t last_total;
+   uint64_t last_call_cnt;
+   retro_perf_tick_t ticks[PERF_FRAMES];
+   uint32_t calls[PERF_FRAMES];
+} rarch_perf_frames_t;
+
+static rarch_perf_frames_t perf_frames_rarch[MAX_COUNTERS];
+static rarch_perf_frames_t perf_frames_libretro[MAX_COUNTERS];
+static unsigned perf_frame_count;
+
+/* Threads are numbered in the order they show up in the trace. */
+#define TRACE_MAX_THREADS 16
+
+typedef struct rarch_trace_event
+{
+   const char *name;
+   retro_time_t start;
+   retro_time_t duration;
+   uintptr_t thread;
+} rarch_trace_event_t;
+
+static rarch_trace_event_t *trace_events;
+static unsigned trace_count;
+static uintptr_t trace_main_thread;
+static bool trace_enable;
+#ifdef HAVE_THREADS
+static slock_t *trace_lock;
+#endif
+
 struct retro_perf_counter **retro_get_perf_counter_rarch(void)
 {
    return perf_counters_rarch;
@@ -113,6 +155,7 @@ void rarch_perf_log(void)
 
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
    log_counters(perf_counters_rarch, perf_ptr_rarch);
+   rarch_histogram_log();
 }
 
 void retro_perf_log(void)
@@ -121,6 +164,378 @@ void retro_perf_log(void)
    log_counters(perf_counters_libretro, perf_ptr_libretro);
 }
 
+static void rarch_perf_frames_update(rarch_perf_frames_t *frames,
+      struct retro_perf_counter **counters, unsigned num, unsigned slot)
+{
+   unsigned i;
+
+   for (i = 0; i < num; i++)
+   {
+      rarch_perf_frames_t *f                = &frames[i];
+      const struct retro_perf_counter *perf = counters[i];
+
+      if (!perf)
+         continue;
+
+      /* Another counter in this place: starts over */
+      if (f->perf != perf)
+      {
+         memset(f, 0, sizeof(*f));
+         f->perf          = perf;
+         f->last_total    = perf->total;
+         f->last_call_cnt = perf->call_cnt;
+         continue;
+      }
+
+      /* Totals only go back when the counter was reset */
+      f->ticks[slot] = perf->total >= f->last_total
+         ? perf->total - f->last_total : perf->total;
+      f->calls[slot] = (uint32_t)(perf->call_cnt >= f->last_call_cnt
+         ? perf->call_cnt - f->last_call_cnt : perf->call_cnt);
+
+      f->last_total    = perf->total;
+      f->last_call_cnt = perf->call_cnt;
+   }
+}
+
+void rarch_perf_frame(void)
+{
+   unsigned slot = perf_frame_count++ & (PERF_FRAMES - 1);
+
+   rarch_perf_frames_update(perf_frames_rarch,
+         perf_counters_rarch, perf_ptr_rarch, slot);
+   rarch_perf_frames_update(perf_frames_libretro,
+         perf_counters_libretro, perf_ptr_libretro, slot);
+}
+
+static unsigned rarch_perf_add_top(rarch_perf_frame_stats_t *top,
+      unsigned count, unsigned n, const rarch_perf_frames_t *frames,
+      struct retro_perf_counter **counters, unsigned num, bool libretro)
+{
+   unsigned i, j;
+   unsigned window = perf_frame_count < PERF_FRAMES
+      ? perf_frame_count : PERF_FRAMES;
+
+   if (!window)
+      return count;
+
+   for (i = 0; i < num; i++)
+   {
+      rarch_perf_frame_stats_t stats;
+      retro_perf_tick_t ticks = 0;
+      uint64_t calls          = 0;
+
+      if (!counters[i] || frames[i].perf != counters[i])
+         continue;
+
+      for (j = 0; j < PERF_FRAMES; j++)
+      {
+         ticks += frames[i].ticks[j];
+         calls += frames[i].calls[j];
+      }
+
+      if (!ticks)
+         continue;
+
+      stats.ident    = counters[i]->ident;
+      stats.ticks    = ticks / window;
+      stats.calls    = (float)calls / window;
+      stats.libretro = libretro;
+
+      /* Kept sorted, the cheapest dropped when full */
+      if (count == n)
+      {
+         if (top[n - 1].ticks >= stats.ticks)
+            continue;
+         count--;
+      }
+
+      for (j = count; j > 0 && top[j - 1].ticks < stats.ticks; j--)
+         top[j] = top[j - 1];
+
+      top[j] = stats;
+      count++;
+   }
+
+   return count;
+}
+
+unsigned rarch_perf_get_top(rarch_perf_frame_stats_t *top, unsigned n)
+{
+   unsigned count = 0;
+
+   if (!n)
+      return 0;
+
+   count = rarch_perf_add_top(top, count, n, perf_frames_rarch,
+         perf_counters_rarch, perf_ptr_rarch, false);
+   count = rarch_perf_add_top(top, count, n, perf_frames_libretro,
+         perf_counters_libretro, perf_ptr_libretro, true);
+
+   return count;
+}
+
+void rarch_histogram_register(rarch_histogram_t *hist, const char *ident)
+{
+   hist->ident = ident;
+
+   if (hist->registered || perf_ptr_histograms >= MAX_HISTOGRAMS)
+      return;
+
+   perf_histograms[perf_ptr_histograms++] = hist;
+   hist->registered = true;
+}
+
+void rarch_histogram_add(rarch_histogram_t *hist, retro_time_t sample)
+{
+   hist->samples[hist->count++ & (HISTOGRAM_SAMPLES - 1)] = sample;
+}
+
+void rarch_histogram_reset(rarch_histogram_t *hist)
+{
+   hist->count = 0;
+}
+
+static int rarch_histogram_compare(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+bool rarch_histogram_get_stats(const rarch_histogram_t *hist,
+      rarch_histogram_stats_t *stats)
+{
+   unsigned i;
+   retro_time_t sorted[HISTOGRAM_SAMPLES];
+   retro_time_t accum = 0;
+   unsigned samples   = hist->count < HISTOGRAM_SAMPLES
+      ? hist->count : HISTOGRAM_SAMPLES;
+
+   if (!samples)
+      return false;
+
+   /* Samples may be added concurrently from another
+    * thread, so work on a snapshot. */
+   memcpy(sorted, hist->samples, samples * sizeof(*sorted));
+   qsort(sorted, samples, sizeof(*sorted), rarch_histogram_compare);
+
+   for (i = 0; i < samples; i++)
+      accum += sorted[i];
+
+   stats->min     = sorted[0];
+   stats->max     = sorted[samples - 1];
+   stats->avg     = accum / samples;
+   stats->p50     = sorted[samples / 2];
+   stats->p95     = sorted[(samples * 95) / 100];
+   stats->p99     = sorted[(samples * 99) / 100];
+   stats->samples = samples;
+
+   return true;
+}
+
+size_t rarch_histogram_print(char *s, size_t len)
+{
+   unsigned i;
+   size_t pos = 0;
+
+   for (i = 0; i < perf_ptr_histograms && pos < len; i++)
+   {
+      rarch_histogram_stats_t stats;
+
+      if (!rarch_histogram_get_stats(perf_histograms[i], &stats))
+         continue;
+
+      pos += snprintf(s + pos, len - pos,
+            " -%s: %.2f / %.2f / %.2f ms\n",
+            perf_histograms[i]->ident,
+            stats.min / 1000.0, stats.avg / 1000.0, stats.p99 / 1000.0);
+   }
+
+   return pos < len ? pos : len;
+}
+
+void rarch_histogram_log(void)
+{
+   unsigned i;
+
+   for (i = 0; i < perf_ptr_histograms; i++)
+   {
+      rarch_histogram_stats_t stats;
+
+      if (!rarch_histogram_get_stats(perf_histograms[i], &stats))
+         continue;
+
+      RARCH_LOG("[PERF]: %s: min %.3f ms, avg %.3f ms, p99 %.3f ms,"
+            " max %.3f ms (%u samples).\n",
+            perf_histograms[i]->ident,
+            stats.min / 1000.0, stats.avg / 1000.0,
+            stats.p99 / 1000.0, stats.max / 1000.0,
+            stats.samples);
+   }
+}
+
+rarch_histogram_t **rarch_histogram_get_list(unsigned *count)
+{
+   *count = perf_ptr_histograms;
+   return perf_histograms;
+}
+
+static uintptr_t rarch_trace_thread_id(void)
+{
+#ifdef HAVE_THREADS
+   return sthread_get_current_thread_id();
+#else
+   return 0;
+#endif
+}
+
+bool rarch_trace_init(void)
+{
+   if (trace_enable)
+      return true;
+
+   trace_events = (rarch_trace_event_t*)
+      calloc(TRACE_EVENTS, sizeof(*trace_events));
+   if (!trace_events)
+      return false;
+
+#ifdef HAVE_THREADS
+   /* Kept around afterwards, other threads
+    * may still be about to take it. */
+   if (!trace_lock)
+      trace_lock = slock_new();
+   if (!trace_lock)
+   {
+      free(trace_events);
+      trace_events = NULL;
+      return false;
+   }
+#endif
+
+   trace_count       = 0;
+   trace_main_thread = rarch_trace_thread_id();
+   trace_enable      = true;
+
+   RARCH_LOG("[PERF]: Recording timeline trace.\n");
+   return true;
+}
+
+static unsigned rarch_trace_thread_index(uintptr_t *threads,
+      unsigned *num_threads, uintptr_t thread)
+{
+   unsigned i;
+
+   for (i = 0; i < *num_threads; i++)
+   {
+      if (threads[i] == thread)
+         return i;
+   }
+
+   /* Lump the rest together rather than failing the dump. */
+   if (*num_threads >= TRACE_MAX_THREADS)
+      return TRACE_MAX_THREADS - 1;
+
+   threads[*num_threads] = thread;
+   return (*num_threads)++;
+}
+
+static bool rarch_trace_write(const char *path)
+{
+   unsigned i;
+   uintptr_t threads[TRACE_MAX_THREADS];
+   unsigned num_threads = 0;
+   unsigned first       = trace_count > TRACE_EVENTS
+      ? trace_count - TRACE_EVENTS : 0;
+   RFILE *file          = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   /* The main thread comes first, so it gets listed on top. */
+   rarch_trace_thread_index(threads, &num_threads, trace_main_thread);
+
+   filestream_printf(file, "{\"traceEvents\":[\n");
+   filestream_printf(file, "{\"name\":\"thread_name\",\"ph\":\"M\","
+         "\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Main\"}}");
+
+   for (i = first; i < trace_count; i++)
+   {
+      const rarch_trace_event_t *ev = &trace_events[i & (TRACE_EVENTS - 1)];
+
+      filestream_printf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\","
+            "\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u}",
+            ev->name,
+            (long long)ev->start, (long long)ev->duration,
+            rarch_trace_thread_index(threads, &num_threads, ev->thread));
+   }
+
+   filestream_printf(file, "\n]}\n");
+   filestream_close(file);
+
+   RARCH_LOG("[PERF]: Wrote %u trace spans to \"%s\".\n",
+         trace_count - first, path);
+   return true;
+}
+
+void rarch_trace_deinit(const char *path)
+{
+   if (!trace_enable)
+      return;
+
+#ifdef HAVE_THREADS
+   slock_lock(trace_lock);
+#endif
+   trace_enable = false;
+#ifdef HAVE_THREADS
+   slock_unlock(trace_lock);
+#endif
+
+   if (path && *path && !rarch_trace_write(path))
+      RARCH_ERR("[PERF]: Failed to write trace to \"%s\".\n", path);
+
+   free(trace_events);
+   trace_events = NULL;
+   trace_count  = 0;
+}
+
+retro_time_t rarch_trace_begin(void)
+{
+   if (!trace_enable)
+      return 0;
+   return cpu_features_get_time_usec();
+}
+
+void rarch_trace_end(const char *name, retro_time_t start)
+{
+   rarch_trace_event_t *ev = NULL;
+   retro_time_t now        = 0;
+
+   if (!trace_enable || !start)
+      return;
+
+   now = cpu_features_get_time_usec();
+
+#ifdef HAVE_THREADS
+   slock_lock(trace_lock);
+   if (!trace_enable)
+   {
+      slock_unlock(trace_lock);
+      return;
+   }
+#endif
+   ev           = &trace_events[trace_count++ & (TRACE_EVENTS - 1)];
+   ev->name     = name;
+   ev->start    = start;
+   ev->duration = now - start;
+   ev->thread   = rarch_trace_thread_id();
+#ifdef HAVE_THREADS
+   slock_unlock(trace_lock);
+#endif
+}
+
 void rarch_timer_tick(rarch_timer_t *timer)
 {
    if (!timer)
@@ -30,6 +30,52 @@ RETRO_BEGIN_DECLS
 #define MAX_COUNTERS 64
 #endif
 
+#ifndef MAX_HISTOGRAMS
+#define MAX_HISTOGRAMS 32
+#endif
+
+/* Number of samples a histogram keeps. Must be a power of two. */
+#define HISTOGRAM_SAMPLES 256
+
+/* Rolling window of timing samples (in microseconds),
+ * reported as min/avg/p99 in the statistics overlay. */
+typedef struct rarch_histogram
+{
+   const char *ident;
+   retro_time_t samples[HISTOGRAM_SAMPLES];
+   unsigned count;
+   bool registered;
+} rarch_histogram_t;
+
+typedef struct rarch_histogram_stats
+{
+   retro_time_t min;
+   retro_time_t avg;
+   retro_time_t p50;
+   retro_time_t p95;
+   retro_time_t p99;
+   retro_time_t max;
+   unsigned samples;
+} rarch_histogram_stats_t;
+
+/* Number of frames the per-frame cost of performance counters
+ * is kept for. Must be a power of two. */
+#define PERF_FRAMES 32
+
+/* Average cost of a performance counter per frame,
+ * over the last PERF_FRAMES frames. */
+typedef struct rarch_perf_frame_stats
+{
+   const char *ident;
+   retro_perf_tick_t ticks;
+   float calls;
+   /* Registered by the core */
+   bool libretro;
+} rarch_perf_frame_stats_t;
+
+/* Number of spans the timeline trace keeps. Must be a power of two. */
+#define TRACE_EVENTS (1 << 17)
+
 typedef struct rarch_timer
 {
    int64_t current;
@@ -57,6 +103,14 @@ void rarch_perf_log(void);
 
 void rarch_perf_register(struct retro_perf_counter *perf);
 
+/* Takes the cost of every counter, frontend and core, since
+ * the last call. Once per frame. */
+void rarch_perf_frame(void);
+
+/* Fills top with the n costliest counters per frame, most
+ * costly first. Returns how many there are. */
+unsigned rarch_perf_get_top(rarch_perf_frame_stats_t *top, unsigned n);
+
 #define performance_counter_init(perf, name) \
    perf.ident = name; \
    if (!perf.registered) \
@@ -89,6 +143,41 @@ void rarch_perf_register(struct retro_perf_counter *perf);
  **/
 #define performance_counter_stop_plus(is_perfcnt_enable, perf) performance_counter_stop_internal(is_perfcnt_enable, perf)
 
+void rarch_histogram_register(rarch_histogram_t *hist, const char *ident);
+
+void rarch_histogram_add(rarch_histogram_t *hist, retro_time_t sample);
+
+void rarch_histogram_reset(rarch_histogram_t *hist);
+
+bool rarch_histogram_get_stats(const rarch_histogram_t *hist,
+      rarch_histogram_stats_t *stats);
+
+/* Prints the stats of all registered histograms into s,
+ * one line per histogram. Returns the amount of bytes written. */
+size_t rarch_histogram_print(char *s, size_t len);
+
+void rarch_histogram_log(void);
+
+/* All registered histograms, @count of them */
+rarch_histogram_t **rarch_histogram_get_list(unsigned *count);
+
+/* Timeline tracing. Spans of the last TRACE_EVENTS begin/end
+ * pairs are kept in a ring buffer and get written out as Chrome
+ * trace event JSON, which chrome://tracing and ui.perfetto.dev
+ * open. Safe to use from any thread. */
+bool rarch_trace_init(void);
+
+/* Writes the trace to path, if any, and stops tracing. */
+void rarch_trace_deinit(const char *path);
+
+/* Returns the start time of a span, or 0 if tracing is off. */
+retro_time_t rarch_trace_begin(void);
+
+/* Records the span started at start, which may also be any
+ * other cpu_features_get_time_usec() timestamp. name must
+ * stay valid until the trace is written. */
+void rarch_trace_end(const char *name, retro_time_t start);
+
 void rarch_timer_tick(rarch_timer_t *timer);
 
 bool rarch_timer_is_running(rarch_timer_t *timer);
@@ -26,14 +26,24 @@
 #include <retro_miscellaneous.h>
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
+#include <string/string_pool.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 #include <file/file_path.h>
 #include <lists/string_list.h>
 #include <formats/jsonsax_full.h>
+#include <encodings/crc32.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_PLAYLIST_CACHE
+#define HAVE_PLAYLIST_JOURNAL
+#endif
 
 #include "playlist.h"
 #include "verbosity.h"
+#include "memory_usage.h"
 #include "file_path_special.h"
 
 #ifndef PLAYLIST_ENTRIES
@@ -54,6 +64,30 @@ struct content_playlist
    char *default_core_path;
    char *default_core_name;
    struct playlist_entry *entries;
+
+   /* Loaded cache, the strings of the entries read from it
+    * point into it */
+   char *pool;
+   size_t pool_size;
+
+   /* Strings of the entries that are only freed with the playlist,
+    * core paths and names are interned */
+   string_pool_t *strings;
+
+   /* Records in the journal, 0 if there's none */
+   unsigned journal_count;
+
+   /* Paths resolved by playlist_real_path(), open addressing */
+   struct playlist_real_path *real_paths;
+   size_t real_paths_cap;
+   size_t real_paths_count;
+};
+
+struct playlist_real_path
+{
+   const char *path;
+   const char *real_path;
+   uint32_t hash;
 };
 
 typedef struct
@@ -81,12 +115,21 @@ typedef struct
 
 static playlist_t *playlist_cached = NULL;
 
+#ifdef HAVE_PLAYLIST_CACHE
+/* Where binary copies of the playlists read are kept, none if empty */
+static char playlist_cache_dir[PATH_MAX_LENGTH] = {0};
+#endif
+
 typedef int (playlist_sort_fun_t)(
       const struct playlist_entry *a,
       const struct playlist_entry *b);
 
+static const char *playlist_real_path(playlist_t *playlist,
+      const char *path, char *s, size_t len);
+
 /**
  * playlist_path_equal:
+ * @playlist            : Playlist of the entry, NULL if none.
  * @real_path           : 'Real' search path, generated by path_resolve_realpath()
  * @entry_path          : Existing playlist entry 'path' value
  *
@@ -94,22 +137,21 @@ typedef int (playlist_sort_fun_t)(
  * (Taking into account relative paths, case insensitive
  * filesystems, 'incomplete' archive paths)
  **/
-static bool playlist_path_equal(const char *real_path,
+static bool playlist_path_equal(playlist_t *playlist, const char *real_path,
       const char *entry_path, bool fuzzy_archive_match)
 {
    bool real_path_is_compressed;
    bool entry_real_path_is_compressed;
-   char entry_real_path[PATH_MAX_LENGTH];
-
-   entry_real_path[0] = '\0';
+   char entry_real_path_buf[PATH_MAX_LENGTH];
+   const char *entry_real_path = NULL;
 
    /* Sanity check */
    if (string_is_empty(real_path) || string_is_empty(entry_path))
       return false;
 
    /* Get entry 'real' path */
-   strlcpy(entry_real_path, entry_path, sizeof(entry_real_path));
-   path_resolve_realpath(entry_real_path, sizeof(entry_real_path), true);
+   entry_real_path = playlist_real_path(playlist, entry_path,
+         entry_real_path_buf, sizeof(entry_real_path_buf));
 
    if (string_is_empty(entry_real_path))
       return false;
@@ -178,6 +220,7 @@ static bool playlist_path_equal(const char *real_path,
 
 /**
  * playlist_core_path_equal:
+ * @playlist            : Playlist of the entry, NULL if none.
  * @real_core_path      : 'Real' search path, generated by path_resolve_realpath()
  * @entry_core_path     : Existing playlist entry 'core path' value
  *
@@ -185,20 +228,20 @@ static bool playlist_path_equal(const char *real_path,
  * (Taking into account relative paths, case insensitive
  * filesystems)
  **/
-static bool playlist_core_path_equal(const char *real_core_path, const char *entry_core_path)
+static bool playlist_core_path_equal(playlist_t *playlist,
+      const char *real_core_path, const char *entry_core_path)
 {
-   char entry_real_core_path[PATH_MAX_LENGTH];
-
-   entry_real_core_path[0] = '\0';
+   char entry_real_core_path_buf[PATH_MAX_LENGTH];
+   const char *entry_real_core_path = entry_core_path;
 
    /* Sanity check */
    if (string_is_empty(real_core_path) || string_is_empty(entry_core_path))
       return false;
 
    /* Get entry 'real' core path */
-   strlcpy(entry_real_core_path, entry_core_path, sizeof(entry_real_core_path));
-   if (!string_is_equal(entry_real_core_path, "DETECT"))
-      path_resolve_realpath(entry_real_core_path, sizeof(entry_real_core_path), true);
+   if (!string_is_equal(entry_core_path, "DETECT"))
+      entry_real_core_path = playlist_real_path(playlist, entry_core_path,
+            entry_real_core_path_buf, sizeof(entry_real_core_path_buf));
 
    if (string_is_empty(entry_real_core_path))
       return false;
@@ -249,33 +292,173 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+/* Strings read from the cache are in its pool and the ones
+ * from playlist_intern() in the strings, not allocated */
+static void playlist_free_str(playlist_t *playlist, char *str)
+{
+   if (     playlist->pool
+         && str >= playlist->pool
+         && str <  playlist->pool + playlist->pool_size)
+      return;
+
+   if (string_pool_owns(playlist->strings, str))
+      return;
+
+   free(str);
+}
+
+/* For values many entries share, e.g. the core path and name */
+static char *playlist_intern(playlist_t *playlist, const char *str)
+{
+   char *interned = NULL;
+
+   if (!playlist->strings)
+      playlist->strings = string_pool_new();
+
+   if (playlist->strings)
+      interned = string_pool_intern(playlist->strings, str);
+
+   return interned ? interned : strdup(str);
+}
+
+/* For values read once that are kept until the playlist is freed */
+static char *playlist_pool_strdup(playlist_t *playlist, const char *str)
+{
+   char *copy = NULL;
+
+   if (!playlist->strings)
+      playlist->strings = string_pool_new();
+
+   if (playlist->strings)
+      copy = string_pool_strdup(playlist->strings, str);
+
+   return copy ? copy : strdup(str);
+}
+
+static uint32_t playlist_real_path_hash(const char *path)
+{
+   uint32_t hash = 5381;
+
+   while (*path)
+      hash = (hash << 5) + hash + (unsigned char)*path++;
+
+   return hash;
+}
+
+static bool playlist_real_paths_grow(playlist_t *playlist)
+{
+   size_t i;
+   size_t cap                       = playlist->real_paths_cap
+      ? playlist->real_paths_cap * 2 : 64;
+   struct playlist_real_path *paths = (struct playlist_real_path*)
+      calloc(cap, sizeof(*paths));
+
+   if (!paths)
+      return false;
+
+   for (i = 0; i < playlist->real_paths_cap; i++)
+   {
+      size_t j;
+      struct playlist_real_path *old = &playlist->real_paths[i];
+
+      if (!old->path)
+         continue;
+
+      for (j = old->hash & (cap - 1); paths[j].path; j = (j + 1) & (cap - 1));
+
+      paths[j] = *old;
+   }
+
+   free(playlist->real_paths);
+   playlist->real_paths     = paths;
+   playlist->real_paths_cap = cap;
+
+   return true;
+}
+
+/**
+ * playlist_real_path:
+ * @playlist            : Playlist the path is from, NULL if none.
+ * @path                : Path of an entry.
+ * @s                   : Buffer for when it isn't kept.
+ * @len                 : Size of @s.
+ *
+ * Resolves @path with path_resolve_realpath(), which asks the
+ * file system, once per path a playlist has; the lookups and
+ * pushes comparing against every entry would do it for each
+ * of them every time.
+ *
+ * Returns: the 'real' path, kept with @playlist or in @s.
+ **/
+static const char *playlist_real_path(playlist_t *playlist,
+      const char *path, char *s, size_t len)
+{
+   size_t i;
+   struct playlist_real_path *entry = NULL;
+   uint32_t hash                    = playlist_real_path_hash(path);
+
+   if (playlist && playlist->real_paths_cap)
+   {
+      size_t mask = playlist->real_paths_cap - 1;
+
+      for (i = hash & mask; playlist->real_paths[i].path; i = (i + 1) & mask)
+         if (     playlist->real_paths[i].hash == hash
+               && string_is_equal(playlist->real_paths[i].path, path))
+            return playlist->real_paths[i].real_path;
+   }
+
+   strlcpy(s, path, len);
+   path_resolve_realpath(s, len, true);
+
+   /* At most half full */
+   if (     !playlist
+         || (     (playlist->real_paths_count + 1) * 2 > playlist->real_paths_cap
+               && !playlist_real_paths_grow(playlist)))
+      return s;
+
+   for (i = hash & (playlist->real_paths_cap - 1);
+         playlist->real_paths[i].path;
+         i = (i + 1) & (playlist->real_paths_cap - 1));
+
+   entry            = &playlist->real_paths[i];
+   entry->path      = playlist_pool_strdup(playlist, path);
+   entry->real_path = string_is_equal(s, path)
+      ? entry->path : playlist_pool_strdup(playlist, s);
+   entry->hash      = hash;
+
+   playlist->real_paths_count++;
+
+   return entry->real_path;
+}
+
 /**
  * playlist_free_entry:
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
    if (entry->path != NULL)
-      free(entry->path);
+      playlist_free_str(playlist, entry->path);
    if (entry->label != NULL)
-      free(entry->label);
+      playlist_free_str(playlist, entry->label);
    if (entry->core_path != NULL)
-      free(entry->core_path);
+      playlist_free_str(playlist, entry->core_path);
    if (entry->core_name != NULL)
-      free(entry->core_name);
+      playlist_free_str(playlist, entry->core_name);
    if (entry->db_name != NULL)
-      free(entry->db_name);
+      playlist_free_str(playlist, entry->db_name);
    if (entry->crc32 != NULL)
-      free(entry->crc32);
+      playlist_free_str(playlist, entry->crc32);
    if (entry->subsystem_ident != NULL)
-      free(entry->subsystem_ident);
+      playlist_free_str(playlist, entry->subsystem_ident);
    if (entry->subsystem_name != NULL)
-      free(entry->subsystem_name);
+      playlist_free_str(playlist, entry->subsystem_name);
    if (entry->runtime_str != NULL)
       free(entry->runtime_str);
    if (entry->last_played_str != NULL)
@@ -329,7 +512,7 @@ void playlist_delete_index(playlist_t *playlist,
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
-      playlist_free_entry(entry_to_delete);
+      playlist_free_entry(playlist, entry_to_delete);
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -357,8 +540,8 @@ void playlist_get_index_by_path(playlist_t *playlist,
 
    for (i = 0; i < playlist->size; i++)
    {
-      if (!playlist_path_equal(real_search_path, playlist->entries[i].path,
-               fuzzy_archive_match))
+      if (!playlist_path_equal(playlist, real_search_path,
+               playlist->entries[i].path, fuzzy_archive_match))
          continue;
 
       *entry = &playlist->entries[i];
@@ -383,8 +566,8 @@ bool playlist_entry_exists(playlist_t *playlist,
    path_resolve_realpath(real_search_path, sizeof(real_search_path), true);
 
    for (i = 0; i < playlist->size; i++)
-      if (playlist_path_equal(real_search_path, playlist->entries[i].path,
-               fuzzy_archive_match))
+      if (playlist_path_equal(playlist, real_search_path,
+               playlist->entries[i].path, fuzzy_archive_match))
          return true;
 
    return false;
@@ -403,7 +586,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path != NULL)
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
       playlist->modified = true;
    }
@@ -411,7 +594,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->label && (update_entry->label != entry->label))
    {
       if (entry->label != NULL)
-         free(entry->label);
+         playlist_free_str(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
       playlist->modified = true;
    }
@@ -419,32 +602,32 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path != NULL)
-         free(entry->core_path);
+         playlist_free_str(playlist, entry->core_path);
       entry->core_path   = NULL;
-      entry->core_path   = strdup(update_entry->core_path);
+      entry->core_path   = playlist_intern(playlist, update_entry->core_path);
       playlist->modified = true;
    }
 
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
       if (entry->core_name != NULL)
-         free(entry->core_name);
-      entry->core_name   = strdup(update_entry->core_name);
+         playlist_free_str(playlist, entry->core_name);
+      entry->core_name   = playlist_intern(playlist, update_entry->core_name);
       playlist->modified = true;
    }
 
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
       if (entry->db_name != NULL)
-         free(entry->db_name);
-      entry->db_name     = strdup(update_entry->db_name);
+         playlist_free_str(playlist, entry->db_name);
+      entry->db_name     = playlist_intern(playlist, update_entry->db_name);
       playlist->modified = true;
    }
 
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
       if (entry->crc32 != NULL)
-         free(entry->crc32);
+         playlist_free_str(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
       playlist->modified = true;
    }
@@ -464,7 +647,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path != NULL)
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
       entry->path        = NULL;
       entry->path        = strdup(update_entry->path);
       playlist->modified = playlist->modified || register_update;
@@ -473,9 +656,9 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path != NULL)
-         free(entry->core_path);
+         playlist_free_str(playlist, entry->core_path);
       entry->core_path   = NULL;
-      entry->core_path   = strdup(update_entry->core_path);
+      entry->core_path   = playlist_intern(playlist, update_entry->core_path);
       playlist->modified = playlist->modified || register_update;
    }
 
@@ -602,14 +785,16 @@ bool playlist_push_runtime(playlist_t *playlist,
       const char *entry_path = playlist->entries[i].path;
       bool equal_path        =
          (string_is_empty(real_path) && string_is_empty(entry_path)) ||
-         playlist_path_equal(real_path, entry_path, fuzzy_archive_match);
+         playlist_path_equal(playlist, real_path, entry_path,
+               fuzzy_archive_match);
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
       if (!equal_path)
          continue;
 
-      if (!playlist_core_path_equal(real_core_path, playlist->entries[i].core_path))
+      if (!playlist_core_path_equal(playlist, real_core_path,
+               playlist->entries[i].core_path))
          continue;
 
       /* If top entry, we don't want to push a new entry since
@@ -631,7 +816,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       struct playlist_entry *last_entry = &playlist->entries[playlist->cap - 1];
 
       if (last_entry)
-         playlist_free_entry(last_entry);
+         playlist_free_entry(playlist, last_entry);
       playlist->size--;
    }
 
@@ -646,7 +831,8 @@ bool playlist_push_runtime(playlist_t *playlist,
       if (!string_is_empty(real_path))
          playlist->entries[0].path      = strdup(real_path);
       if (!string_is_empty(real_core_path))
-         playlist->entries[0].core_path = strdup(real_core_path);
+         playlist->entries[0].core_path = playlist_intern(playlist,
+               real_core_path);
 
       playlist->entries[0].runtime_status = entry->runtime_status;
       playlist->entries[0].runtime_hours = entry->runtime_hours;
@@ -785,14 +971,16 @@ bool playlist_push(playlist_t *playlist,
       const char *entry_path = playlist->entries[i].path;
       bool equal_path        =
          (string_is_empty(real_path) && string_is_empty(entry_path)) ||
-         playlist_path_equal(real_path, entry_path, fuzzy_archive_match);
+         playlist_path_equal(playlist, real_path, entry_path,
+               fuzzy_archive_match);
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
       if (!equal_path)
          continue;
 
-      if (!playlist_core_path_equal(real_core_path, playlist->entries[i].core_path))
+      if (!playlist_core_path_equal(playlist, real_core_path,
+               playlist->entries[i].core_path))
          continue;
 
       if (     !string_is_empty(entry->subsystem_ident)
@@ -842,8 +1030,8 @@ bool playlist_push(playlist_t *playlist,
                path_resolve_realpath(real_rom_path, sizeof(real_rom_path), true);
             }
 
-            if (!playlist_path_equal(real_rom_path, roms->elems[j].data,
-                     fuzzy_archive_match))
+            if (!playlist_path_equal(playlist, real_rom_path,
+                     roms->elems[j].data, fuzzy_archive_match))
             {
                unequal = true;
                break;
@@ -870,7 +1058,8 @@ bool playlist_push(playlist_t *playlist,
       }
       if (!playlist->entries[i].db_name && !string_is_empty(entry->db_name))
       {
-         playlist->entries[i].db_name = strdup(entry->db_name);
+         playlist->entries[i].db_name = playlist_intern(playlist,
+               entry->db_name);
          entry_updated                = true;
       }
 
@@ -899,7 +1088,7 @@ bool playlist_push(playlist_t *playlist,
          &playlist->entries[playlist->cap - 1];
 
       if (last_entry)
-         playlist_free_entry(last_entry);
+         playlist_free_entry(playlist, last_entry);
       playlist->size--;
    }
 
@@ -934,11 +1123,14 @@ bool playlist_push(playlist_t *playlist,
       if (!string_is_empty(entry->label))
          playlist->entries[0].label           = strdup(entry->label);
       if (!string_is_empty(real_core_path))
-         playlist->entries[0].core_path       = strdup(real_core_path);
+         playlist->entries[0].core_path       = playlist_intern(playlist,
+               real_core_path);
       if (!string_is_empty(core_name))
-         playlist->entries[0].core_name       = strdup(core_name);
+         playlist->entries[0].core_name       = playlist_intern(playlist,
+               core_name);
       if (!string_is_empty(entry->db_name))
-         playlist->entries[0].db_name         = strdup(entry->db_name);
+         playlist->entries[0].db_name         = playlist_intern(playlist,
+               entry->db_name);
       if (!string_is_empty(entry->crc32))
          playlist->entries[0].crc32           = strdup(entry->crc32);
       if (!string_is_empty(entry->subsystem_ident))
@@ -965,6 +1157,742 @@ success:
    return true;
 }
 
+#ifdef HAVE_PLAYLIST_CACHE
+/* Binary copy of a playlist, to read instead of parsing the JSON
+ * again while that's unchanged. Read in one go, the strings of the
+ * entries are used right where they are in it.
+ *
+ * In host byte order, strings are offsets into the file, 0 for
+ * none, all of them end before the end of the file:
+ *    playlist_cache_header_t,
+ *    playlist_cache_entry_t for each entry,
+ *    offsets of the subsystem ROMs of all the entries,
+ *    the strings. */
+
+#define PLAYLIST_CACHE_MAGIC   0x5241504C /* "RAPL" */
+#define PLAYLIST_CACHE_VERSION 1
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   /* Of the JSON it was made from */
+   int64_t json_size;
+   int64_t json_mtime;
+   uint64_t size;
+   uint32_t count;
+   uint32_t num_roms;
+   uint32_t label_display_mode;
+   uint32_t right_thumbnail_mode;
+   uint32_t left_thumbnail_mode;
+   uint32_t default_core_path;
+   uint32_t default_core_name;
+   uint32_t padding;
+} playlist_cache_header_t;
+
+typedef struct
+{
+   uint32_t path;
+   uint32_t label;
+   uint32_t core_path;
+   uint32_t core_name;
+   uint32_t db_name;
+   uint32_t crc32;
+   uint32_t subsystem_ident;
+   uint32_t subsystem_name;
+   uint32_t first_rom;
+   uint32_t num_roms;
+   uint32_t runtime_hours;
+   uint32_t runtime_minutes;
+   uint32_t runtime_seconds;
+   uint32_t last_played_year;
+   uint32_t last_played_month;
+   uint32_t last_played_day;
+   uint32_t last_played_hour;
+   uint32_t last_played_minute;
+   uint32_t last_played_second;
+} playlist_cache_entry_t;
+
+static bool playlist_cache_get_path(const char *path,
+      char *cache_path, size_t len)
+{
+   char name[PATH_MAX_LENGTH];
+
+   if (string_is_empty(playlist_cache_dir) || string_is_empty(path))
+      return false;
+
+   /* Playlists of the same name can be in different directories */
+   snprintf(name, sizeof(name), "%s.%08X.lplc", path_basename(path),
+         encoding_crc32(0, (const uint8_t*)path, strlen(path)));
+   fill_pathname_join(cache_path, playlist_cache_dir, name, len);
+   return true;
+}
+
+static bool playlist_cache_stat(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   *size  = (int64_t)st.st_size;
+   *mtime = (int64_t)st.st_mtime;
+   return true;
+}
+
+static const char *playlist_cache_str(const char *buf, uint64_t size,
+      uint32_t offset, bool *ok)
+{
+   if (!offset)
+      return NULL;
+   if (offset >= size)
+   {
+      *ok = false;
+      return NULL;
+   }
+   return buf + offset;
+}
+
+/* Returns false if there's no cache to read, or it's out of date */
+static bool playlist_cache_read(playlist_t *playlist, const char *path)
+{
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   int64_t json_size, json_mtime;
+   int64_t len                           = 0;
+   void *data                            = NULL;
+   char *buf                             = NULL;
+   const playlist_cache_header_t *header = NULL;
+   const playlist_cache_entry_t *entries = NULL;
+   const uint32_t *roms                  = NULL;
+   bool ok                               = true;
+
+   if (     !playlist_cache_get_path(path, cache_path, sizeof(cache_path))
+         || !playlist_cache_stat(path, &json_size, &json_mtime)
+         || !path_is_valid(cache_path))
+      return false;
+
+   if (!filestream_read_file(cache_path, &data, &len)
+         || len < (int64_t)sizeof(*header))
+   {
+      free(data);
+      return false;
+   }
+
+   buf    = (char*)data;
+   header = (const playlist_cache_header_t*)buf;
+
+   /* Ending with a NUL, every string in it is terminated */
+   if (     header->magic      != PLAYLIST_CACHE_MAGIC
+         || header->version    != PLAYLIST_CACHE_VERSION
+         || header->json_size  != json_size
+         || header->json_mtime != json_mtime
+         || header->size       != (uint64_t)len
+         || buf[len - 1]       != '\0'
+         || (uint64_t)header->count * sizeof(*entries)
+          + (uint64_t)header->num_roms * sizeof(*roms)
+          + sizeof(*header) > (uint64_t)len)
+   {
+      free(data);
+      return false;
+   }
+
+   entries = (const playlist_cache_entry_t*)(header + 1);
+   roms    = (const uint32_t*)(entries + header->count);
+
+   for (i = 0; ok && i < header->count && i < playlist->cap; i++)
+   {
+      unsigned j;
+      const playlist_cache_entry_t *src = &entries[i];
+      struct playlist_entry *entry      = &playlist->entries[i];
+
+      entry->path            = (char*)playlist_cache_str(buf, len, src->path, &ok);
+      entry->label           = (char*)playlist_cache_str(buf, len, src->label, &ok);
+      entry->core_path       = (char*)playlist_cache_str(buf, len, src->core_path, &ok);
+      entry->core_name       = (char*)playlist_cache_str(buf, len, src->core_name, &ok);
+      entry->db_name         = (char*)playlist_cache_str(buf, len, src->db_name, &ok);
+      entry->crc32           = (char*)playlist_cache_str(buf, len, src->crc32, &ok);
+      entry->subsystem_ident = (char*)playlist_cache_str(buf, len, src->subsystem_ident, &ok);
+      entry->subsystem_name  = (char*)playlist_cache_str(buf, len, src->subsystem_name, &ok);
+
+      entry->runtime_hours      = src->runtime_hours;
+      entry->runtime_minutes    = src->runtime_minutes;
+      entry->runtime_seconds    = src->runtime_seconds;
+      entry->last_played_year   = src->last_played_year;
+      entry->last_played_month  = src->last_played_month;
+      entry->last_played_day    = src->last_played_day;
+      entry->last_played_hour   = src->last_played_hour;
+      entry->last_played_minute = src->last_played_minute;
+      entry->last_played_second = src->last_played_second;
+
+      if (!src->num_roms)
+         continue;
+
+      if (     (uint64_t)src->first_rom + src->num_roms > header->num_roms
+            || !(entry->subsystem_roms = string_list_new()))
+      {
+         ok = false;
+         break;
+      }
+
+      for (j = 0; ok && j < src->num_roms; j++)
+      {
+         union string_list_elem_attr attr;
+         const char *rom = playlist_cache_str(buf, len,
+               roms[src->first_rom + j], &ok);
+
+         attr.i = 0;
+         if (rom)
+            string_list_append(entry->subsystem_roms, rom, attr);
+      }
+   }
+
+   playlist->size = i;
+
+   if (ok)
+   {
+      const char *core_path = playlist_cache_str(buf, len,
+            header->default_core_path, &ok);
+      const char *core_name = playlist_cache_str(buf, len,
+            header->default_core_name, &ok);
+
+      if (ok && core_path)
+         playlist->default_core_path = strdup(core_path);
+      if (ok && core_name)
+         playlist->default_core_name = strdup(core_name);
+
+      playlist->label_display_mode   =
+         (enum playlist_label_display_mode)header->label_display_mode;
+      playlist->right_thumbnail_mode =
+         (enum playlist_thumbnail_mode)header->right_thumbnail_mode;
+      playlist->left_thumbnail_mode  =
+         (enum playlist_thumbnail_mode)header->left_thumbnail_mode;
+   }
+
+   playlist->pool      = buf;
+   playlist->pool_size = (size_t)len;
+
+   if (!ok)
+   {
+      RARCH_WARN("Ignoring playlist cache: %s\n", cache_path);
+      playlist_clear(playlist);
+      free(playlist->default_core_path);
+      free(playlist->default_core_name);
+      playlist->default_core_path = NULL;
+      playlist->default_core_name = NULL;
+      playlist->pool              = NULL;
+      playlist->pool_size         = 0;
+      free(buf);
+      return false;
+   }
+
+   memory_usage_add(MEMORY_USAGE_PLAYLISTS, (int64_t)len);
+
+   return true;
+}
+
+typedef struct
+{
+   char *buf;
+   size_t size;
+   size_t cap;
+   bool error;
+} playlist_cache_pool_t;
+
+static uint32_t playlist_cache_pool_add(playlist_cache_pool_t *pool,
+      const char *str)
+{
+   size_t len;
+   size_t offset = pool->size;
+
+   if (!str)
+      return 0;
+
+   len = strlen(str) + 1;
+
+   if (pool->size + len > pool->cap)
+   {
+      size_t cap = pool->cap ? pool->cap : 64 * 1024;
+      char *buf  = NULL;
+
+      while (pool->size + len > cap)
+         cap <<= 1;
+
+      if (!(buf = (char*)realloc(pool->buf, cap)))
+      {
+         pool->error = true;
+         return 0;
+      }
+      pool->buf = buf;
+      pool->cap = cap;
+   }
+
+   memcpy(pool->buf + pool->size, str, len);
+   pool->size += len;
+   return (uint32_t)offset;
+}
+
+/* Writes the cache of the playlist as it is in @path now */
+static void playlist_cache_write(playlist_t *playlist, const char *path)
+{
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   int64_t json_size, json_mtime;
+   playlist_cache_pool_t pool;
+   playlist_cache_header_t *header = NULL;
+   playlist_cache_entry_t *entries = NULL;
+   uint32_t *roms                  = NULL;
+   size_t num_roms                 = 0;
+   size_t rom                      = 0;
+
+   if (     !playlist_cache_get_path(path, cache_path, sizeof(cache_path))
+         || !playlist_cache_stat(path, &json_size, &json_mtime))
+      return;
+
+   for (i = 0; i < playlist->size; i++)
+      if (playlist->entries[i].subsystem_roms)
+         num_roms += playlist->entries[i].subsystem_roms->size;
+
+   /* Strings go after the rest, everything is laid out in the pool */
+   pool.size  = sizeof(*header) + playlist->size * sizeof(*entries)
+      + num_roms * sizeof(*roms);
+   pool.cap   = pool.size + 64 * 1024;
+   pool.buf   = (char*)calloc(1, pool.cap);
+   pool.error = false;
+   if (!pool.buf)
+      return;
+
+   /* Offsets are taken as the strings are added, pointers to the
+    * rest would move as the pool grows */
+   {
+      playlist_cache_entry_t src;
+      uint32_t default_core_path =
+         playlist_cache_pool_add(&pool, playlist->default_core_path);
+      uint32_t default_core_name =
+         playlist_cache_pool_add(&pool, playlist->default_core_name);
+
+      for (i = 0; i < playlist->size; i++)
+      {
+         size_t j;
+         const struct playlist_entry *entry = &playlist->entries[i];
+
+         src.path               = playlist_cache_pool_add(&pool, entry->path);
+         src.label              = playlist_cache_pool_add(&pool, entry->label);
+         src.core_path          = playlist_cache_pool_add(&pool, entry->core_path);
+         src.core_name          = playlist_cache_pool_add(&pool, entry->core_name);
+         src.db_name            = playlist_cache_pool_add(&pool, entry->db_name);
+         src.crc32              = playlist_cache_pool_add(&pool, entry->crc32);
+         src.subsystem_ident    = playlist_cache_pool_add(&pool, entry->subsystem_ident);
+         src.subsystem_name     = playlist_cache_pool_add(&pool, entry->subsystem_name);
+         src.first_rom          = (uint32_t)rom;
+         src.num_roms           = entry->subsystem_roms
+            ? (uint32_t)entry->subsystem_roms->size : 0;
+         src.runtime_hours      = entry->runtime_hours;
+         src.runtime_minutes    = entry->runtime_minutes;
+         src.runtime_seconds    = entry->runtime_seconds;
+         src.last_played_year   = entry->last_played_year;
+         src.last_played_month  = entry->last_played_month;
+         src.last_played_day    = entry->last_played_day;
+         src.last_played_hour   = entry->last_played_hour;
+         src.last_played_minute = entry->last_played_minute;
+         src.last_played_second = entry->last_played_second;
+
+         for (j = 0; j < src.num_roms; j++, rom++)
+         {
+            uint32_t offset = playlist_cache_pool_add(&pool,
+                  entry->subsystem_roms->elems[j].data);
+            memcpy(pool.buf + sizeof(*header)
+                  + playlist->size * sizeof(*entries)
+                  + rom * sizeof(*roms), &offset, sizeof(offset));
+         }
+
+         memcpy(pool.buf + sizeof(*header) + i * sizeof(*entries),
+               &src, sizeof(src));
+      }
+
+      /* Offsets past 4 GB can't be kept */
+      if (pool.error || pool.size > UINT32_MAX)
+      {
+         free(pool.buf);
+         return;
+      }
+
+      header                       = (playlist_cache_header_t*)pool.buf;
+      header->magic                = PLAYLIST_CACHE_MAGIC;
+      header->version              = PLAYLIST_CACHE_VERSION;
+      header->json_size            = json_size;
+      header->json_mtime           = json_mtime;
+      header->size                 = pool.size;
+      header->count                = (uint32_t)playlist->size;
+      header->num_roms             = (uint32_t)num_roms;
+      header->label_display_mode   = playlist->label_display_mode;
+      header->right_thumbnail_mode = playlist->right_thumbnail_mode;
+      header->left_thumbnail_mode  = playlist->left_thumbnail_mode;
+      header->default_core_path    = default_core_path;
+      header->default_core_name    = default_core_name;
+      header->padding              = 0;
+   }
+
+   /* A string at the very end is NUL terminated there already,
+    * an empty playlist needs the NUL the reader checks for */
+   if (pool.buf[pool.size - 1] != '\0')
+   {
+      free(pool.buf);
+      return;
+   }
+
+   if (!filestream_write_file(cache_path, pool.buf, pool.size))
+   {
+      RARCH_WARN("Failed to write playlist cache: %s\n", cache_path);
+      filestream_delete(cache_path);
+   }
+
+   free(pool.buf);
+}
+#endif
+
+#ifdef HAVE_PLAYLIST_JOURNAL
+/* Log of the pushes and updates made since the playlist was last
+ * written, appended to instead of writing the whole playlist again,
+ * and replayed on top of it when it's read. It's only valid for the
+ * size and mtime of the playlist it was started for.
+ *
+ * In host byte order:
+ *    playlist_journal_header_t,
+ *    for each record, playlist_journal_record_t followed by the
+ *    PLAYLIST_JOURNAL_STRINGS strings and then the subsystem ROMs,
+ *    each as its uint32_t length with the NUL, 0 for none, followed
+ *    by its bytes. */
+
+#define PLAYLIST_JOURNAL_MAGIC   0x5241504A /* "RAPJ" */
+#define PLAYLIST_JOURNAL_VERSION 1
+/* The playlist is written out in full after this many records */
+#define PLAYLIST_JOURNAL_MAX     64
+#define PLAYLIST_JOURNAL_STRINGS 8
+
+enum playlist_journal_type
+{
+   PLAYLIST_JOURNAL_PUSH = 0,
+   PLAYLIST_JOURNAL_UPDATE
+};
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   int64_t json_size;
+   int64_t json_mtime;
+} playlist_journal_header_t;
+
+typedef struct
+{
+   /* Of the rest of the record */
+   uint32_t size;
+   uint8_t type;
+   uint8_t fuzzy_archive_match;
+   uint16_t num_roms;
+   uint32_t idx;
+} playlist_journal_record_t;
+
+static bool playlist_journal_enable = false;
+
+static void playlist_journal_get_path(const playlist_t *playlist,
+      char *journal_path, size_t len)
+{
+   strlcpy(journal_path, playlist->conf_path, len);
+   strlcat(journal_path, ".log", len);
+}
+
+static bool playlist_journal_add_str(char **buf, size_t *size,
+      size_t *cap, const char *str)
+{
+   uint32_t len = str ? (uint32_t)strlen(str) + 1 : 0;
+
+   if (*size + sizeof(len) + len > *cap)
+   {
+      size_t new_cap = *cap * 2 + sizeof(len) + len;
+      char *new_buf  = (char*)realloc(*buf, new_cap);
+      if (!new_buf)
+         return false;
+      *buf           = new_buf;
+      *cap           = new_cap;
+   }
+
+   memcpy(*buf + *size, &len, sizeof(len));
+   if (len)
+      memcpy(*buf + *size + sizeof(len), str, len);
+   *size += sizeof(len) + len;
+   return true;
+}
+
+static void playlist_journal_delete(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+
+   if (!playlist->journal_count)
+      return;
+
+   playlist_journal_get_path(playlist, journal_path, sizeof(journal_path));
+   filestream_delete(journal_path);
+   playlist->journal_count = 0;
+}
+
+/* Appends a record of the push or update of @entry, which must be
+ * all that changed since the playlist and its journal were last in
+ * sync. Returns false if the playlist has to be written in full. */
+static bool playlist_journal_append(playlist_t *playlist,
+      enum playlist_journal_type type, size_t idx,
+      const struct playlist_entry *entry, bool fuzzy_archive_match)
+{
+   size_t i;
+   char journal_path[PATH_MAX_LENGTH];
+   playlist_journal_header_t header;
+   playlist_journal_record_t *record = NULL;
+   const char *strs[PLAYLIST_JOURNAL_STRINGS];
+   RFILE *file                       = NULL;
+   char *buf                         = NULL;
+   size_t size                       = sizeof(*record);
+   size_t cap                        = 1024;
+   size_t num_roms                   = 0;
+   bool ok                           = true;
+   int64_t json_size;
+   int64_t json_mtime;
+
+   if (!playlist_journal_enable
+         || playlist->journal_count >= PLAYLIST_JOURNAL_MAX
+         || !playlist_cache_stat(playlist->conf_path,
+            &json_size, &json_mtime))
+      return false;
+
+   if (entry->subsystem_roms)
+      num_roms = entry->subsystem_roms->size;
+   if (num_roms > UINT16_MAX)
+      return false;
+
+   strs[0] = entry->path;
+   strs[1] = entry->label;
+   strs[2] = entry->core_path;
+   strs[3] = entry->core_name;
+   strs[4] = entry->db_name;
+   strs[5] = entry->crc32;
+   strs[6] = entry->subsystem_ident;
+   strs[7] = entry->subsystem_name;
+
+   playlist_journal_get_path(playlist, journal_path, sizeof(journal_path));
+
+   if (!(buf = (char*)malloc(cap)))
+      return false;
+
+   for (i = 0; ok && i < PLAYLIST_JOURNAL_STRINGS; i++)
+      ok = playlist_journal_add_str(&buf, &size, &cap, strs[i]);
+   for (i = 0; ok && i < num_roms; i++)
+      ok = playlist_journal_add_str(&buf, &size, &cap,
+            entry->subsystem_roms->elems[i].data);
+
+   if (!ok || size > UINT32_MAX)
+      goto error;
+
+   record                      = (playlist_journal_record_t*)buf;
+   record->size                = (uint32_t)(size - sizeof(*record));
+   record->type                = (uint8_t)type;
+   record->fuzzy_archive_match = fuzzy_archive_match ? 1 : 0;
+   record->num_roms            = (uint16_t)num_roms;
+   record->idx                 = (uint32_t)idx;
+
+   if (!playlist->journal_count)
+   {
+      header.magic      = PLAYLIST_JOURNAL_MAGIC;
+      header.version    = PLAYLIST_JOURNAL_VERSION;
+      header.json_size  = json_size;
+      header.json_mtime = json_mtime;
+
+      if (!(file = filestream_open(journal_path,
+                  RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto error;
+
+      if (filestream_write(file, &header, sizeof(header)) != sizeof(header))
+         goto error;
+   }
+   else
+   {
+      /* Someone else may have written the playlist since */
+      if (!(file = filestream_open(journal_path,
+                  RETRO_VFS_FILE_ACCESS_READ_WRITE
+                  | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto error;
+
+      if (     filestream_read(file, &header, sizeof(header)) != sizeof(header)
+            || header.magic      != PLAYLIST_JOURNAL_MAGIC
+            || header.version    != PLAYLIST_JOURNAL_VERSION
+            || header.json_size  != json_size
+            || header.json_mtime != json_mtime
+            || filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END) != 0)
+         goto error;
+   }
+
+   if (filestream_write(file, buf, size) != (int64_t)size)
+      goto error;
+
+   filestream_close(file);
+   free(buf);
+
+   playlist->journal_count++;
+   playlist->modified = false;
+   return true;
+
+error:
+   if (file)
+      filestream_close(file);
+   free(buf);
+   /* The full write that has to follow has all of it */
+   RARCH_WARN("Failed to append to playlist journal: %s\n", journal_path);
+   filestream_delete(journal_path);
+   playlist->journal_count = 0;
+   return false;
+}
+
+static const char *playlist_journal_read_str(const char **pos,
+      const char *end, bool *ok)
+{
+   const char *str;
+   uint32_t len;
+
+   if ((size_t)(end - *pos) < sizeof(len))
+   {
+      *ok = false;
+      return NULL;
+   }
+
+   memcpy(&len, *pos, sizeof(len));
+   *pos += sizeof(len);
+   if (!len)
+      return NULL;
+
+   if ((size_t)(end - *pos) < len || (*pos)[len - 1] != '\0')
+   {
+      *ok = false;
+      return NULL;
+   }
+
+   str   = *pos;
+   *pos += len;
+   return str;
+}
+
+/* Applies the journal of the playlist just read, or deletes it if
+ * it was started for another version of the playlist. */
+static void playlist_journal_replay(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   playlist_journal_header_t header;
+   void *data         = NULL;
+   int64_t len        = 0;
+   const char *pos    = NULL;
+   const char *end    = NULL;
+   unsigned count     = 0;
+   int64_t json_size  = 0;
+   int64_t json_mtime = 0;
+
+   playlist_journal_get_path(playlist, journal_path, sizeof(journal_path));
+
+   if (!path_is_valid(journal_path))
+      return;
+
+   if (     !filestream_read_file(journal_path, &data, &len)
+         || len < (int64_t)sizeof(header))
+      goto stale;
+
+   memcpy(&header, data, sizeof(header));
+   if (     header.magic   != PLAYLIST_JOURNAL_MAGIC
+         || header.version != PLAYLIST_JOURNAL_VERSION
+         || !playlist_cache_stat(playlist->conf_path,
+            &json_size, &json_mtime)
+         || header.json_size  != json_size
+         || header.json_mtime != json_mtime)
+      goto stale;
+
+   pos = (const char*)data + sizeof(header);
+   end = (const char*)data + len;
+
+   /* A record cut short by a crash is where the journal ends */
+   while ((size_t)(end - pos) >= sizeof(playlist_journal_record_t))
+   {
+      size_t i;
+      playlist_journal_record_t record;
+      struct playlist_entry entry        = {0};
+      union string_list_elem_attr attr   = {0};
+      const char *strs[PLAYLIST_JOURNAL_STRINGS];
+      const char *record_end             = NULL;
+      bool ok                            = true;
+
+      memcpy(&record, pos, sizeof(record));
+      pos += sizeof(record);
+      if ((size_t)(end - pos) < record.size)
+         break;
+      record_end = pos + record.size;
+
+      for (i = 0; i < PLAYLIST_JOURNAL_STRINGS; i++)
+         strs[i] = playlist_journal_read_str(&pos, record_end, &ok);
+
+      if (record.num_roms)
+         entry.subsystem_roms = string_list_new();
+      for (i = 0; ok && entry.subsystem_roms && i < record.num_roms; i++)
+      {
+         const char *rom = playlist_journal_read_str(&pos, record_end, &ok);
+         if (rom)
+            string_list_append(entry.subsystem_roms, rom, attr);
+      }
+
+      if (!ok)
+      {
+         string_list_free(entry.subsystem_roms);
+         break;
+      }
+
+      entry.path            = (char*)strs[0];
+      entry.label           = (char*)strs[1];
+      entry.core_path       = (char*)strs[2];
+      entry.core_name       = (char*)strs[3];
+      entry.db_name         = (char*)strs[4];
+      entry.crc32           = (char*)strs[5];
+      entry.subsystem_ident = (char*)strs[6];
+      entry.subsystem_name  = (char*)strs[7];
+
+      if (record.type == PLAYLIST_JOURNAL_PUSH)
+         playlist_push(playlist, &entry, record.fuzzy_archive_match != 0);
+      else if (record.type == PLAYLIST_JOURNAL_UPDATE
+            && record.idx < playlist->size)
+         playlist_update(playlist, record.idx, &entry);
+
+      string_list_free(entry.subsystem_roms);
+      pos = record_end;
+      count++;
+   }
+
+   free(data);
+
+   if (!count)
+   {
+      filestream_delete(journal_path);
+      return;
+   }
+
+   /* In sync with the playlist and its journal again, the next
+    * full write drops the journal */
+   playlist->journal_count = count;
+   playlist->modified      = false;
+   return;
+
+stale:
+   free(data);
+   RARCH_WARN("Discarding out of date playlist journal: %s\n", journal_path);
+   filestream_delete(journal_path);
+}
+#endif
+
 static JSON_Writer_HandlerResult JSONOutputHandler(JSON_Writer writer, const char *pBytes, size_t length)
 {
    JSONContext *context = (JSONContext*)JSON_Writer_GetUserData(writer);
@@ -1216,6 +2144,14 @@ void playlist_write_runtime_file(playlist_t *playlist)
    RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
 end:
    filestream_close(file);
+#ifdef HAVE_PLAYLIST_JOURNAL
+   if (!playlist->modified)
+      playlist_journal_delete(playlist);
+#endif
+#ifdef HAVE_PLAYLIST_CACHE
+   if (!playlist->modified)
+      playlist_cache_write(playlist, playlist->conf_path);
+#endif
 }
 
 void playlist_write_file(playlist_t *playlist, bool use_old_format)
@@ -1555,6 +2491,14 @@ void playlist_write_file(playlist_t *playlist, bool use_old_format)
    RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
 end:
    filestream_close(file);
+#ifdef HAVE_PLAYLIST_JOURNAL
+   if (!playlist->modified)
+      playlist_journal_delete(playlist);
+#endif
+#ifdef HAVE_PLAYLIST_CACHE
+   if (!playlist->modified)
+      playlist_cache_write(playlist, playlist->conf_path);
+#endif
 }
 
 /**
@@ -1587,12 +2531,24 @@ void playlist_free(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
 
-   free(playlist->entries);
+   memory_usage_free(MEMORY_USAGE_PLAYLISTS, playlist->entries);
    playlist->entries = NULL;
 
+   if (playlist->pool)
+      memory_usage_add(MEMORY_USAGE_PLAYLISTS,
+            -(int64_t)playlist->pool_size);
+   free(playlist->pool);
+   playlist->pool    = NULL;
+
+   free(playlist->real_paths);
+   playlist->real_paths = NULL;
+
+   string_pool_free(playlist->strings);
+   playlist->strings = NULL;
+
    free(playlist);
 }
 
@@ -1613,7 +2569,7 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
    playlist->size = 0;
 }
@@ -1773,9 +2729,21 @@ static JSON_Parser_HandlerResult JSONStringHandler(JSON_Parser parser, char *pVa
       {
          if (pCtx->current_entry_val && length && !string_is_empty(pValue))
          {
-            if (*pCtx->current_entry_val)
-               free(*pCtx->current_entry_val);
-            *pCtx->current_entry_val = strdup(pValue);
+            playlist_t *playlist         = pCtx->playlist;
+            struct playlist_entry *entry = pCtx->current_entry;
+            char **val                   = pCtx->current_entry_val;
+
+            if (*val)
+               playlist_free_str(playlist, *val);
+
+            if (     val == &entry->core_path
+                  || val == &entry->core_name
+                  || val == &entry->db_name
+                  || val == &entry->subsystem_ident
+                  || val == &entry->subsystem_name)
+               *val = playlist_intern(playlist, pValue);
+            else
+               *val = playlist_pool_strdup(playlist, pValue);
          }
          else
          {
@@ -1996,6 +2964,39 @@ static void get_old_format_metadata_value(
    strlcpy(value, start, len);
 }
 
+/**
+ * playlist_set_cache_dir:
+ * @dir                 : Directory to keep binary copies of the
+ *                        playlists in, or NULL not to.
+ *
+ * Playlists read while their JSON is unchanged since it was last read
+ * or written are read from their copy, without parsing the JSON.
+ **/
+void playlist_set_cache_dir(const char *dir)
+{
+#ifdef HAVE_PLAYLIST_CACHE
+   if (string_is_empty(dir))
+      playlist_cache_dir[0] = '\0';
+   else
+      strlcpy(playlist_cache_dir, dir, sizeof(playlist_cache_dir));
+#endif
+}
+
+/**
+ * playlist_set_journal_enable:
+ * @enable              : Whether to journal.
+ *
+ * Sets whether pushes and updates made with command_playlist_push_write()
+ * and command_playlist_update_write() are appended to a journal next to
+ * the playlist, instead of writing all of it each time.
+ **/
+void playlist_set_journal_enable(bool enable)
+{
+#ifdef HAVE_PLAYLIST_JOURNAL
+   playlist_journal_enable = enable;
+#endif
+}
+
 static bool playlist_read_file(
       playlist_t *playlist, const char *path)
 {
@@ -2010,6 +3011,14 @@ static bool playlist_read_file(
    if (!file)
       return true;
 
+#ifdef HAVE_PLAYLIST_CACHE
+   if (playlist_cache_read(playlist, path))
+   {
+      filestream_close(file);
+      return true;
+   }
+#endif
+
    /* Detect format of playlist */
    {
       int test_char;
@@ -2288,22 +3297,25 @@ json_cleanup:
             continue;
 
          if (*buf[0])
-            entry->path      = strdup(buf[0]);
+            entry->path      = playlist_pool_strdup(playlist, buf[0]);
          if (*buf[1])
-            entry->label     = strdup(buf[1]);
+            entry->label     = playlist_pool_strdup(playlist, buf[1]);
 
-         entry->core_path    = strdup(buf[2]);
-         entry->core_name    = strdup(buf[3]);
+         entry->core_path    = playlist_intern(playlist, buf[2]);
+         entry->core_name    = playlist_intern(playlist, buf[3]);
          if (*buf[4])
-            entry->crc32     = strdup(buf[4]);
+            entry->crc32     = playlist_pool_strdup(playlist, buf[4]);
          if (*buf[5])
-            entry->db_name   = strdup(buf[5]);
+            entry->db_name   = playlist_intern(playlist, buf[5]);
          playlist->size++;
       }
    }
 
 end:
    filestream_close(file);
+#ifdef HAVE_PLAYLIST_CACHE
+   playlist_cache_write(playlist, path);
+#endif
    return true;
 }
 
@@ -2346,7 +3358,8 @@ playlist_t *playlist_init(const char *path, size_t size)
    if (!playlist)
       return NULL;
 
-   entries = (struct playlist_entry*)calloc(size, sizeof(*entries));
+   entries = (struct playlist_entry*)memory_usage_calloc(
+         MEMORY_USAGE_PLAYLISTS, size, sizeof(*entries));
    if (!entries)
    {
       free(playlist);
@@ -2360,11 +3373,21 @@ playlist_t *playlist_init(const char *path, size_t size)
    playlist->default_core_name    = NULL;
    playlist->default_core_path    = NULL;
    playlist->entries              = entries;
+   playlist->pool                 = NULL;
+   playlist->pool_size            = 0;
+   playlist->strings              = NULL;
+   playlist->journal_count        = 0;
+   playlist->real_paths           = NULL;
+   playlist->real_paths_cap       = 0;
+   playlist->real_paths_count     = 0;
    playlist->label_display_mode   = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode  = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
 
    playlist_read_file(playlist, path);
+#ifdef HAVE_PLAYLIST_JOURNAL
+   playlist_journal_replay(playlist);
+#endif
 
    return playlist;
 }
@@ -2459,11 +3482,23 @@ void command_playlist_push_write(
       bool fuzzy_archive_match,
       bool use_old_format)
 {
+   bool modified;
+
    if (!playlist)
       return;
 
-   if (playlist_push(playlist, entry, fuzzy_archive_match))
-      playlist_write_file(playlist, use_old_format);
+   modified = playlist->modified;
+
+   if (!playlist_push(playlist, entry, fuzzy_archive_match))
+      return;
+
+#ifdef HAVE_PLAYLIST_JOURNAL
+   if (!modified && playlist_journal_append(playlist,
+            PLAYLIST_JOURNAL_PUSH, 0, entry, fuzzy_archive_match))
+      return;
+#endif
+
+   playlist_write_file(playlist, use_old_format);
 }
 
 void command_playlist_update_write(
@@ -2473,15 +3508,24 @@ void command_playlist_update_write(
       bool use_old_format)
 {
    playlist_t *playlist = plist ? plist : playlist_get_cached();
+   bool modified;
 
    if (!playlist)
       return;
 
+   modified = playlist->modified;
+
    playlist_update(
          playlist,
          idx,
          entry);
 
+#ifdef HAVE_PLAYLIST_JOURNAL
+   if (!modified && playlist->modified && playlist_journal_append(playlist,
+            PLAYLIST_JOURNAL_UPDATE, idx, entry, false))
+      return;
+#endif
+
    playlist_write_file(playlist, use_old_format);
 }
 
@@ -2526,7 +3570,7 @@ bool playlist_entries_are_equal(
       path_resolve_realpath(real_path_a, sizeof(real_path_a), true);
    }
 
-   if (!playlist_path_equal(
+   if (!playlist_path_equal(NULL,
          real_path_a, entry_b->path, fuzzy_archive_match))
       return false;
 
@@ -2538,7 +3582,8 @@ bool playlist_entries_are_equal(
          path_resolve_realpath(real_core_path_a, sizeof(real_core_path_a), true);
    }
 
-   return playlist_core_path_equal(real_core_path_a, entry_b->core_path);
+   return playlist_core_path_equal(NULL,
+         real_core_path_a, entry_b->core_path);
 }
 
 void playlist_get_crc32(playlist_t *playlist, size_t idx,
@@ -231,6 +231,16 @@ void playlist_qsort(playlist_t *playlist);
 
 void playlist_free_cached(void);
 
+/* Directory to keep binary copies of the playlists read in, to read
+ * instead of their JSON while it's unchanged. NULL or empty not to. */
+void playlist_set_cache_dir(const char *dir);
+
+/* Append the pushes and updates of command_playlist_push_write() and
+ * command_playlist_update_write() to a journal next to the playlist,
+ * written in full only every so often. Journals are replayed when
+ * playlists are read either way. */
+void playlist_set_journal_enable(bool enable);
+
 playlist_t *playlist_get_cached(void);
 
 bool playlist_init_cached(const char *path, size_t size);
@@ -166,9 +166,11 @@ check_lib '' THREAD_STORAGE "$PTHREADLIB" pthread_key_create
 
 if [ "$OS" = 'Linux' ]; then
    check_header '' CDROM sys/ioctl.h scsi/sg.h
+   check_header '' IO_URING linux/io_uring.h
 fi
 
 check_platform 'Linux Win32' CDROM 'CD-ROM is' user
+check_platform Linux IO_URING 'io_uring is' true
 
 if [ "$OS" = 'Win32' ]; then
    add_opt DYLIB yes
@@ -408,8 +410,11 @@ check_enabled 'OPENGL OPENGLES OPENGLES3' GLSL GLSL \
    'OpenGL and OpenGLES are' false
 
 check_enabled ZLIB BUILTINZLIB 'builtin zlib' 'zlib is' true
+check_enabled BUILTINZLIB BUILTINZLIB_FAST 'fast builtin zlib' 'builtin zlib is' true
 
 check_val '' ZLIB '-lz' '' zlib '' '' false
+check_val '' ZSTD '-lzstd' '' libzstd '' '' false
+check_val '' LZ4 '-llz4' '' liblz4 '' '' false
 check_val '' MPV -lmpv '' mpv '' '' false
 
 check_header '' DRMINGW exchndl.h
@@ -92,7 +92,10 @@ HAVE_VG=auto               # OpenVG support
 HAVE_CG=auto               # Cg shader support
 HAVE_HLSL=no               # HLSL9 shader support (for Direct3D9)
 HAVE_BUILTINZLIB=auto      # Bake in zlib
+HAVE_BUILTINZLIB_FAST=yes  # Chunked inflate and SIMD checksums in the builtin zlib
 HAVE_ZLIB=auto             # zlib support (ZIP extract, PNG decoding/encoding)
+HAVE_ZSTD=auto             # zstd compression support (netplay, streams)
+HAVE_LZ4=auto              # LZ4 compression support (streams)
 HAVE_ALSA=auto             # ALSA support
 C89_ALSA=no
 HAVE_RPILED=auto           # RPI led support
@@ -157,6 +160,7 @@ HAVE_VIDEOCORE=auto        # Broadcom Videocore 4 support
 HAVE_DRMINGW=no            # DrMingw exception handler
 HAVE_GONG=no               # Gong core embedded
 HAVE_CDROM=auto            # CD-ROM support
+HAVE_IO_URING=auto         # io_uring file loading support
 HAVE_GLSL=yes              # GLSL shaders support
 HAVE_SLANG=auto            # slang support
 C89_SLANG=no
@@ -20,11 +20,12 @@
 #include <stdlib.h>
 
 #include <retro_assert.h>
+#include <retro_math.h>
 #include <compat/msvc.h>
 #include <compat/strl.h>
 
 #include <boolean.h>
-#include <queues/fifo_queue.h>
+#include <features/features_cpu.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
@@ -66,6 +67,7 @@ extern "C" {
 #endif
 
 #include "../../configuration.h"
+#include "../../performance_counters.h"
 #include "../../retroarch.h"
 #include "../../verbosity.h"
 
@@ -113,6 +115,10 @@ extern "C" {
 #define PIX_FMT_RGBA AV_PIX_FMT_RGBA
 #endif
 
+#ifndef PIX_FMT_NV12
+#define PIX_FMT_NV12 AV_PIX_FMT_NV12
+#endif
+
 #ifndef PIX_FMT_NONE
 #define PIX_FMT_NONE AV_PIX_FMT_NONE
 #endif
@@ -202,6 +208,14 @@ struct ff_muxer_info
    AVStream *vstream;
 };
 
+struct ff_video_slot
+{
+   struct record_video_data attr;
+   /* Counts frames dropped before this one, to keep in sync */
+   int64_t pts;
+   retro_time_t pushed;
+};
+
 struct ff_config_param
 {
    config_file_t *conf;
@@ -223,6 +237,14 @@ struct ff_config_param
    int video_global_quality;
    int video_bit_rate;
 
+   /* Try the hardware H.264 encoders first */
+   bool hw_encoder;
+   /* Streamed over UDP or RTP, tuned for latency over quality */
+   bool low_latency;
+   /* Target for rate control by bit rate, used by the hardware
+    * encoders, which don't take a CRF, and by low latency streams */
+   float bits_per_pixel;
+
    AVDictionary *video_opts;
    AVDictionary *audio_opts;
 };
@@ -236,16 +258,45 @@ typedef struct ffmpeg
 
    struct record_params params;
 
+   /* Frames and audio are handed to the encoder thread through
+    * single producer, single consumer rings with free-running
+    * counters, each written by one side only. */
+   struct ff_video_slot *video_slots;
+   uint8_t *video_slot_buf;
+   size_t video_slot_size;
+   unsigned video_read;
+   unsigned video_write;
+   int64_t video_pts;
+
+   uint8_t *audio_ring;
+   size_t audio_ring_mask;
+   size_t audio_read;
+   size_t audio_write;
+
+   /* What didn't fit in the rings, counted by the producer. */
+   unsigned video_dropped;
+   size_t audio_dropped;
+
+   /* Low latency streaming, the rest only touched by the encoder
+    * thread: the bit rate backs off while it falls behind, and
+    * creeps back up to the target once it keeps up again. */
+   struct
+   {
+      int64_t target_bit_rate;
+      int64_t bit_rate;
+      retro_time_t frame_pushed;
+      retro_time_t window_start;
+      retro_time_t write_time;
+      unsigned window_frames;
+      unsigned dropped;
+      unsigned calm_windows;
+   } stream;
+
    scond_t *cond;
    slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
    sthread_t *thread;
 
    volatile bool alive;
-   volatile bool can_sleep;
 } ffmpeg_t;
 
 AVFormatContext *ctx;
@@ -421,6 +472,93 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
    return true;
 }
 
+/* Hardware H.264 encoders, tried in order. Both take frames in
+ * memory, which they copy to the encoder's buffers. */
+/* Capture to the last packet of the frame being sent */
+static rarch_histogram_t ffmpeg_stream_latency;
+
+/* Slices are sent as each is done, before the whole frame is */
+#define FFMPEG_STREAM_SLICES 4
+
+static const char *ffmpeg_hw_h264_encoders[] = {
+   "h264_rkmpp",
+   "h264_v4l2m2m",
+   NULL
+};
+
+static bool ffmpeg_open_video(ffmpeg_t *handle, AVCodec *codec,
+      AVDictionary **opts, bool hw)
+{
+   struct ff_config_param *params  = &handle->config;
+   struct ff_video_info *video     = &handle->video;
+   struct record_params *param     = &handle->params;
+
+   video->codec = avcodec_alloc_context3(codec);
+   if (!video->codec)
+      return false;
+
+   video->codec->codec_type          = AVMEDIA_TYPE_VIDEO;
+   video->codec->width               = param->out_width;
+   video->codec->height              = param->out_height;
+   video->codec->time_base           = av_d2q((double)
+         params->frame_drop_ratio /param->fps, 1000000); /* Arbitrary big number. */
+   video->codec->sample_aspect_ratio = av_d2q(
+         param->aspect_ratio * param->out_height / param->out_width, 255);
+   video->codec->pix_fmt             = video->pix_fmt;
+
+   if (hw)
+   {
+      /* A keyframe a second and no B-frames,
+       * for streams to be joined quickly */
+      video->codec->bit_rate     = params->bits_per_pixel
+         * param->out_width * param->out_height
+         * param->fps / params->frame_drop_ratio;
+      video->codec->gop_size     = param->fps;
+      video->codec->max_b_frames = 0;
+   }
+   else
+   {
+      video->codec->thread_count = params->threads;
+
+      if (params->video_qscale)
+      {
+         video->codec->flags |= AV_CODEC_FLAG_QSCALE;
+         video->codec->global_quality = params->video_global_quality;
+      }
+      else if (params->video_bit_rate)
+         video->codec->bit_rate = params->video_bit_rate;
+   }
+
+   if (params->low_latency)
+   {
+      /* A frame's worth of VBV, so that no frame takes longer than
+       * a frame to send, in slices and with no B-frames. x264 puts
+       * intra refresh in place of the keyframes. */
+      video->codec->flags          &= ~AV_CODEC_FLAG_QSCALE;
+      video->codec->flags          |= AV_CODEC_FLAG_LOW_DELAY;
+      video->codec->bit_rate        = handle->stream.bit_rate;
+      video->codec->rc_max_rate     = handle->stream.bit_rate;
+      video->codec->rc_buffer_size  = handle->stream.bit_rate
+         * params->frame_drop_ratio / param->fps;
+      video->codec->gop_size        = param->fps;
+      video->codec->max_b_frames    = 0;
+      video->codec->slices          = FFMPEG_STREAM_SLICES;
+   }
+
+   if (handle->muxer.ctx->oformat->flags & AVFMT_GLOBALHEADER)
+      video->codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+   if (avcodec_open2(video->codec, codec, opts) != 0)
+   {
+      av_free(video->codec);
+      video->codec = NULL;
+      return false;
+   }
+
+   video->encoder = codec;
+   return true;
+}
+
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
    size_t size;
@@ -445,8 +583,6 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
       return false;
    }
 
-   video->encoder = codec;
-
    /* Don't use swscaler unless format is not something "in-house" scaler
     * supports.
     *
@@ -500,42 +636,49 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
          video->pix_size      = 4;
          break;
 
+      case FFEMU_PIX_NV12:
+         /* Already YUV, left to libswscale */
+         video->in_pix_fmt    = PIX_FMT_NV12;
+         video->pix_size      = 1;
+         video->use_sws       = true;
+         break;
+
       default:
          return false;
    }
 
-   video->codec = avcodec_alloc_context3(codec);
-
    /* Useful to set scale_factor to 2 for chroma subsampled formats to
     * maintain full chroma resolution. (Or just use 4:4:4 or RGB ...)
     */
    param->out_width  = (float)param->out_width  * params->scale_factor;
    param->out_height = (float)param->out_height * params->scale_factor;
 
-   video->codec->codec_type          = AVMEDIA_TYPE_VIDEO;
-   video->codec->width               = param->out_width;
-   video->codec->height              = param->out_height;
-   video->codec->time_base           = av_d2q((double)
-         params->frame_drop_ratio /param->fps, 1000000); /* Arbitrary big number. */
-   video->codec->sample_aspect_ratio = av_d2q(
-         param->aspect_ratio * param->out_height / param->out_width, 255);
-   video->codec->pix_fmt             = video->pix_fmt;
+   if (params->hw_encoder)
+   {
+      unsigned i;
+
+      for (i = 0; ffmpeg_hw_h264_encoders[i]; i++)
+      {
+         AVCodec *hw_codec = avcodec_find_encoder_by_name(
+               ffmpeg_hw_h264_encoders[i]);
 
-   video->codec->thread_count = params->threads;
+         if (!hw_codec)
+            continue;
 
-   if (params->video_qscale)
-   {
-      video->codec->flags |= AV_CODEC_FLAG_QSCALE;
-      video->codec->global_quality = params->video_global_quality;
-   }
-   else if (params->video_bit_rate)
-      video->codec->bit_rate = params->video_bit_rate;
+         if (ffmpeg_open_video(handle, hw_codec, NULL, true))
+         {
+            RARCH_LOG("[FFmpeg]: Encoding video with %s.\n",
+                  ffmpeg_hw_h264_encoders[i]);
+            break;
+         }
 
-   if (handle->muxer.ctx->oformat->flags & AVFMT_GLOBALHEADER)
-      video->codec->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+         RARCH_WARN("[FFmpeg]: Cannot open vcodec %s.\n",
+               ffmpeg_hw_h264_encoders[i]);
+      }
+   }
 
-   if (avcodec_open2(video->codec, codec, params->video_opts ?
-            &params->video_opts : NULL) != 0)
+   if (!video->codec && !ffmpeg_open_video(handle, codec,
+            params->video_opts ? &params->video_opts : NULL, false))
       return false;
 
    /* Allocate a big buffer. ffmpeg API doesn't seem to give us some
@@ -580,6 +723,7 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
          av_dict_set(&params->video_opts, "preset", "ultrafast", 0);
          av_dict_set(&params->video_opts, "tune", "film", 0);
          av_dict_set(&params->video_opts, "crf", "35", 0);
+         params->bits_per_pixel       = 0.05f;
          av_dict_set(&params->audio_opts, "audio_global_quality", "75", 0);
          break;
       case RECORD_CONFIG_TYPE_RECORDING_MED_QUALITY:
@@ -596,6 +740,7 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
          av_dict_set(&params->video_opts, "preset", "superfast", 0);
          av_dict_set(&params->video_opts, "tune", "film", 0);
          av_dict_set(&params->video_opts, "crf", "25", 0);
+         params->bits_per_pixel       = 0.1f;
          av_dict_set(&params->audio_opts, "audio_global_quality", "75", 0);
          break;
       case RECORD_CONFIG_TYPE_RECORDING_HIGH_QUALITY:
@@ -612,6 +757,7 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
          av_dict_set(&params->video_opts, "preset", "superfast", 0);
          av_dict_set(&params->video_opts, "tune", "film", 0);
          av_dict_set(&params->video_opts, "crf", "15", 0);
+         params->bits_per_pixel       = 0.2f;
          av_dict_set(&params->audio_opts, "audio_global_quality", "100", 0);
          break;
       case RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY:
@@ -694,25 +840,16 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
          av_dict_set(&params->video_opts, "preset", "ultrafast", 0);
          av_dict_set(&params->video_opts, "tune", "zerolatency", 0);
          av_dict_set(&params->video_opts, "crf", "20", 0);
+         params->bits_per_pixel       = 0.1f;
          av_dict_set(&params->audio_opts, "audio_global_quality", "50", 0);
-
-         /* TO-DO: detect if hwaccel is available and use it instead of the preset above
-         strlcpy(params->vcodec, "h264_nvenc", sizeof(params->vcodec));
-         strlcpy(params->acodec, "aac", sizeof(params->acodec));
-
-         av_dict_set(&params->video_opts, "preset", "llhp", 0);
-         av_dict_set(&params->video_opts, "tune", "zerolatency", 0);
-         av_dict_set(&params->video_opts, "zerolatency", "1", 0);
-         av_dict_set(&params->video_opts, "-rc-lookahead", "0", 0);
-         av_dict_set(&params->video_opts, "x264-params", "threads=0:intra-refresh=1:b-frames=0", 0);
-         av_dict_set(&params->audio_opts, "audio_global_quality", "100", 0);
-         */
-
          break;
       default:
          break;
    }
 
+   params->hw_encoder = settings->bools.video_record_hw_encoder
+      && string_is_equal(params->vcodec, "libx264");
+
    if (preset <= RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY)
    {
       if (!settings->bools.video_gpu_record)
@@ -763,6 +900,19 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
       strlcpy(params->format, "mpegts", sizeof(params->format));
    }
 
+   /* Local and custom streams, not the ones to Twitch or YouTube,
+    * which buffer several seconds on their end anyway */
+   params->low_latency = settings->bools.video_stream_low_latency
+      && preset >= RECORD_CONFIG_TYPE_STREAMING_LOW_QUALITY
+      && string_is_equal(params->format, "mpegts");
+
+   if (params->low_latency && string_is_equal(params->vcodec, "libx264"))
+   {
+      av_dict_set(&params->video_opts, "crf", NULL, 0);
+      av_dict_set(&params->video_opts, "tune", "zerolatency", 0);
+      av_dict_set(&params->video_opts, "intra-refresh", "1", 0);
+   }
+
    return true;
 }
 
@@ -866,18 +1016,48 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
 
 static bool ffmpeg_init_muxer_pre(ffmpeg_t *handle)
 {
+   AVDictionary *opts = NULL;
+   int ret;
+
    ctx = avformat_alloc_context();
    av_strlcpy(ctx->filename, handle->params.filename, sizeof(ctx->filename));
 
-   if (*handle->config.format)
-      ctx->oformat = av_guess_format(handle->config.format, NULL, NULL);
-   else
-      ctx->oformat = av_guess_format(NULL, ctx->filename, NULL);
+   /* MPEG-TS in RTP, for receivers that reorder and drop late packets */
+   if (     handle->config.low_latency
+         && !strncmp(ctx->filename, "rtp://", STRLEN_CONST("rtp://")))
+      ctx->oformat = av_guess_format("rtp_mpegts", NULL, NULL);
+
+   if (!ctx->oformat)
+   {
+      if (*handle->config.format)
+         ctx->oformat = av_guess_format(handle->config.format, NULL, NULL);
+      else
+         ctx->oformat = av_guess_format(NULL, ctx->filename, NULL);
+   }
 
    if (!ctx->oformat)
       return false;
 
-   if (avio_open(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE) < 0)
+   if (handle->config.low_latency)
+   {
+      char bit_rate[32];
+
+      /* Seven TS packets to a datagram, paced at twice the target
+       * so that a frame goes out in about half a frame's time,
+       * rather than in a burst the network has to queue */
+      snprintf(bit_rate, sizeof(bit_rate), "%u",
+            (unsigned)(handle->stream.target_bit_rate * 2));
+      av_dict_set(&opts, "pkt_size", "1316", 0);
+      av_dict_set(&opts, "bitrate", bit_rate, 0);
+
+      ctx->max_delay  = 0;
+      ctx->flags     |= AVFMT_FLAG_FLUSH_PACKETS;
+   }
+
+   ret = avio_open2(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE, NULL, &opts);
+   av_dict_free(&opts);
+
+   if (ret < 0)
    {
       av_free(ctx);
       return false;
@@ -910,31 +1090,66 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
    av_dict_set(&handle->muxer.ctx->metadata, "title",
          "RetroArch Video Dump", 0);
 
-   return avformat_write_header(handle->muxer.ctx, NULL) >= 0;
+   if (avformat_write_header(handle->muxer.ctx, NULL) < 0)
+      return false;
+
+   if (handle->config.low_latency)
+   {
+      rarch_histogram_register(&ffmpeg_stream_latency,
+            "Stream: capture to send");
+      rarch_histogram_reset(&ffmpeg_stream_latency);
+   }
+
+   return true;
 }
 
 #define MAX_FRAMES 32
 
+/* Upper bound for how long the encoder thread sleeps, as the
+ * producer signals without taking the lock. */
+#define FFMPEG_THREAD_WAIT_US 10000
+
+#define FFMPEG_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define FFMPEG_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
 static void ffmpeg_thread(void *data);
 
+/* Rows of a frame in memory, the chroma of NV12 follows its luma */
+static unsigned ffmpeg_frame_rows(const ffmpeg_t *handle, unsigned height)
+{
+   if (handle->params.pix_fmt == FFEMU_PIX_NV12)
+      return height + height / 2;
+   return height;
+}
+
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
-         handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
-
-   handle->alive = true;
-   handle->can_sleep = true;
+   /* Half a second of audio, rounded up for the mask */
+   size_t audio_size = (size_t)(handle->params.samplerate / 2)
+      * handle->params.channels * sizeof(int16_t);
+
+   handle->cond_lock       = slock_new();
+   handle->cond            = scond_new();
+
+   handle->audio_ring_mask = next_pow2((uint32_t)audio_size) - 1;
+   handle->audio_ring      = (uint8_t*)malloc(handle->audio_ring_mask + 1);
+
+   handle->video_slot_size = (size_t)handle->params.fb_width *
+      ffmpeg_frame_rows(handle, handle->params.fb_height) *
+      handle->video.pix_size;
+   handle->video_slots     = (struct ff_video_slot*)calloc(MAX_FRAMES,
+         sizeof(*handle->video_slots));
+   /* For some reason, FFmpeg has a tendency to crash
+    * if we don't overallocate a bit. */
+   handle->video_slot_buf  = (uint8_t*)av_malloc(
+         handle->video_slot_size * (MAX_FRAMES + 1));
+
+   handle->alive  = true;
    handle->thread = sthread_create(ffmpeg_thread, handle);
 
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   retro_assert(handle->cond_lock && handle->cond &&
+      handle->audio_ring && handle->video_slots &&
+      handle->video_slot_buf && handle->thread);
 
    return true;
 }
@@ -946,13 +1161,11 @@ static void deinit_thread(ffmpeg_t *handle)
 
    slock_lock(handle->cond_lock);
    handle->alive = false;
-   handle->can_sleep = false;
    slock_unlock(handle->cond_lock);
 
    scond_signal(handle->cond);
    sthread_join(handle->thread);
 
-   slock_free(handle->lock);
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
@@ -961,23 +1174,51 @@ static void deinit_thread(ffmpeg_t *handle)
 
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
-   if (handle->audio_fifo)
-   {
-      fifo_free(handle->audio_fifo);
-      handle->audio_fifo = NULL;
-   }
+   free(handle->audio_ring);
+   handle->audio_ring = NULL;
 
-   if (handle->attr_fifo)
-   {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
-   }
+   free(handle->video_slots);
+   handle->video_slots = NULL;
 
-   if (handle->video_fifo)
-   {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
-   }
+   av_free(handle->video_slot_buf);
+   handle->video_slot_buf = NULL;
+}
+
+static size_t ffmpeg_audio_read_avail(ffmpeg_t *handle)
+{
+   return FFMPEG_ATOMIC_LOAD(&handle->audio_write) - handle->audio_read;
+}
+
+static void ffmpeg_audio_read(ffmpeg_t *handle, void *buf, size_t size)
+{
+   size_t pos   = handle->audio_read & handle->audio_ring_mask;
+   size_t first = MIN(size, handle->audio_ring_mask + 1 - pos);
+
+   memcpy(buf, handle->audio_ring + pos, first);
+   memcpy((uint8_t*)buf + first, handle->audio_ring, size - first);
+
+   FFMPEG_ATOMIC_STORE(&handle->audio_read, handle->audio_read + size);
+}
+
+/* Returns the oldest frame queued, to be released with
+ * ffmpeg_video_release() once encoded, or NULL. */
+static struct ff_video_slot *ffmpeg_video_peek(ffmpeg_t *handle)
+{
+   struct ff_video_slot *slot;
+   unsigned idx;
+
+   if (FFMPEG_ATOMIC_LOAD(&handle->video_write) == handle->video_read)
+      return NULL;
+
+   idx             = handle->video_read % MAX_FRAMES;
+   slot            = &handle->video_slots[idx];
+   slot->attr.data = handle->video_slot_buf + idx * handle->video_slot_size;
+   return slot;
+}
+
+static void ffmpeg_video_release(ffmpeg_t *handle)
+{
+   FFMPEG_ATOMIC_STORE(&handle->video_read, handle->video_read + 1);
 }
 
 static void ffmpeg_free(void *data)
@@ -1051,6 +1292,16 @@ static void *ffmpeg_new(const struct record_params *params)
    else
       ffmpeg_init_config_common(&handle->config, params->preset);
 
+   if (handle->config.low_latency)
+   {
+      float scale = handle->config.scale_factor;
+
+      handle->stream.target_bit_rate = handle->config.bits_per_pixel
+         * params->out_width * scale * params->out_height * scale
+         * params->fps / handle->config.frame_drop_ratio;
+      handle->stream.bit_rate        = handle->stream.target_bit_rate;
+   }
+
    if (!ffmpeg_init_muxer_pre(handle))
       goto error;
 
@@ -1076,9 +1327,11 @@ error:
 static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
-   unsigned y;
+   unsigned y, idx, rows;
    bool drop_frame;
-   struct record_video_data attr_data;
+   int64_t pts;
+   uint8_t *dst;
+   struct ff_video_slot *slot;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    int       offset = 0;
 
@@ -1093,51 +1346,51 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
-
-      if (!handle->alive)
-         return false;
-
-      if (avail >= sizeof(*vid))
-         break;
+   if (!handle->alive)
+      return false;
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
+   pts = handle->video_pts++;
 
-      slock_unlock(handle->cond_lock);
+   /* Never wait on the encoder, what it can't keep up with is
+    * dropped and the next frame shown for longer. */
+   if (handle->video_write - FFMPEG_ATOMIC_LOAD(&handle->video_read)
+         >= MAX_FRAMES)
+   {
+      FFMPEG_ATOMIC_STORE(&handle->video_dropped,
+            handle->video_dropped + 1);
+      return true;
    }
 
-   slock_lock(handle->lock);
+   idx  = handle->video_write % MAX_FRAMES;
+   slot = &handle->video_slots[idx];
+   dst  = handle->video_slot_buf + idx * handle->video_slot_size;
 
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
-   attr_data = *vid;
+   slot->attr   = *vid;
+   slot->pts    = pts;
+   slot->pushed = cpu_features_get_time_usec();
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
+   if (slot->attr.is_dupe)
+      slot->attr.width = slot->attr.height = slot->attr.pitch = 0;
    else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+      slot->attr.pitch = slot->attr.width * handle->video.pix_size;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   rows = ffmpeg_frame_rows(handle, slot->attr.height);
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+   if ((size_t)slot->attr.pitch * rows > handle->video_slot_size)
+   {
+      FFMPEG_ATOMIC_STORE(&handle->video_dropped,
+            handle->video_dropped + 1);
+      return true;
+   }
+
+   for (y = 0; y < rows; y++, offset += vid->pitch)
+      memcpy(dst + y * slot->attr.pitch,
+            (const uint8_t*)vid->data + offset, slot->attr.pitch);
 
-   slock_unlock(handle->lock);
+   FFMPEG_ATOMIC_STORE(&handle->video_write, handle->video_write + 1);
    scond_signal(handle->cond);
 
    return true;
@@ -1146,6 +1399,7 @@ static bool ffmpeg_push_video(void *data,
 static bool ffmpeg_push_audio(void *data,
       const struct record_audio_data *audio_data)
 {
+   size_t size, pos, first;
    ffmpeg_t *handle = (ffmpeg_t*)data;
 
    if (!handle || !audio_data)
@@ -1154,46 +1408,46 @@ static bool ffmpeg_push_audio(void *data,
    if (!handle->config.audio_enable)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->audio_fifo);
-      slock_unlock(handle->lock);
+   if (!handle->alive)
+      return false;
 
-      if (!handle->alive)
-         return false;
+   size = audio_data->frames * handle->params.channels * sizeof(int16_t);
 
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
-         break;
+   if (handle->audio_ring_mask + 1 -
+         (handle->audio_write - FFMPEG_ATOMIC_LOAD(&handle->audio_read))
+         < size)
+   {
+      handle->audio_dropped += audio_data->frames;
+      return true;
+   }
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
+   pos   = handle->audio_write & handle->audio_ring_mask;
+   first = MIN(size, handle->audio_ring_mask + 1 - pos);
 
-      slock_unlock(handle->cond_lock);
-   }
+   memcpy(handle->audio_ring + pos, audio_data->data, first);
+   memcpy(handle->audio_ring,
+         (const uint8_t*)audio_data->data + first, size - first);
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
-         audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
+   FFMPEG_ATOMIC_STORE(&handle->audio_write, handle->audio_write + size);
    scond_signal(handle->cond);
 
    return true;
 }
 
+static int ffmpeg_write_packet(ffmpeg_t *handle, AVPacket *pkt)
+{
+   /* Interleaving holds packets back until the
+    * other stream catches up */
+   if (handle->config.low_latency)
+      return av_write_frame(handle->muxer.ctx, pkt);
+   return av_interleaved_write_frame(handle->muxer.ctx, pkt);
+}
+
 static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
 {
    AVPacket pkt;
    int ret;
+   retro_time_t write_start = 0;
 
    av_init_packet(&pkt);
    pkt.data = handle->video.outbuf;
@@ -1234,7 +1488,10 @@ static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
       
       pkt.stream_index = handle->muxer.vstream->index;
 
-      ret = av_interleaved_write_frame(handle->muxer.ctx, &pkt);
+      if (handle->config.low_latency)
+         write_start = cpu_features_get_time_usec();
+
+      ret = ffmpeg_write_packet(handle, &pkt);
       if (ret < 0)
       {
 #ifdef __cplusplus
@@ -1244,6 +1501,16 @@ static bool encode_video(ffmpeg_t *handle, AVFrame *frame)
 #endif
          return false;
       }
+
+      if (handle->config.low_latency)
+      {
+         retro_time_t now = cpu_features_get_time_usec();
+
+         handle->stream.write_time += now - write_start;
+         if (handle->stream.frame_pushed)
+            rarch_histogram_add(&ffmpeg_stream_latency,
+                  now - handle->stream.frame_pushed);
+      }
    }
    return true;
 }
@@ -1257,7 +1524,20 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
 
    if (handle->video.use_sws)
    {
-      int linesize = vid->pitch;
+      const uint8_t *planes[2];
+      int linesize[2];
+
+      planes[0]   = (const uint8_t*)vid->data;
+      linesize[0] = vid->pitch;
+      planes[1]   = NULL;
+      linesize[1] = 0;
+
+      /* Interleaved chroma right below the luma */
+      if (handle->video.in_pix_fmt == PIX_FMT_NV12)
+      {
+         planes[1]   = planes[0] + vid->pitch * vid->height;
+         linesize[1] = vid->pitch;
+      }
 
       handle->video.sws = sws_getCachedContext(handle->video.sws,
             vid->width, vid->height, handle->video.in_pix_fmt,
@@ -1265,8 +1545,8 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
             handle->video.pix_fmt,
             shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
 
-      sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
-            &linesize, 0, vid->height, handle->video.conv_frame->data,
+      sws_scale(handle->video.sws, planes,
+            linesize, 0, vid->height, handle->video.conv_frame->data,
             handle->video.conv_frame->linesize);
    }
    else
@@ -1419,7 +1699,7 @@ static bool encode_audio(ffmpeg_t *handle, bool dry)
 
       pkt.stream_index = handle->muxer.astream->index;
 
-      ret = av_interleaved_write_frame(handle->muxer.ctx, &pkt);
+      ret = ffmpeg_write_packet(handle, &pkt);
       if (ret < 0)
       {
          av_frame_free(&frame);
@@ -1544,13 +1824,13 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
       size_t audio_buf_size)
 {
-   size_t avail = fifo_read_avail(handle->audio_fifo);
+   size_t avail = ffmpeg_audio_read_avail(handle);
 
    if (avail)
    {
       struct record_audio_data aud = {0};
 
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      ffmpeg_audio_read(handle, audio_buf, avail);
 
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
       aud.data = audio_buf;
@@ -1570,8 +1850,6 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    bool did_work;
-   void *video_buf = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ?
       (handle->audio.codec->frame_size *
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1584,17 +1862,17 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
    do
    {
-      struct record_video_data attr_buf;
+      struct ff_video_slot *slot;
 
       did_work = false;
 
       if (handle->config.audio_enable)
       {
-         if (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
+         if (ffmpeg_audio_read_avail(handle) >= audio_buf_size)
          {
             struct record_audio_data aud = {0};
 
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+            ffmpeg_audio_read(handle, audio_buf, audio_buf_size);
             aud.frames = handle->audio.codec->frame_size;
             aud.data = audio_buf;
             ffmpeg_push_audio_thread(handle, &aud, true);
@@ -1603,13 +1881,11 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
+      if ((slot = ffmpeg_video_peek(handle)))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+         handle->video.frame_cnt = slot->pts;
+         ffmpeg_push_video_thread(handle, &slot->attr);
+         ffmpeg_video_release(handle);
 
          did_work = true;
       }
@@ -1622,7 +1898,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1634,6 +1909,11 @@ static bool ffmpeg_finalize(void *data)
 
    deinit_thread(handle);
 
+   if (handle->video_dropped || handle->audio_dropped)
+      RARCH_WARN("[FFmpeg]: Encoder fell behind, dropped %u frames"
+            " and %u audio frames.\n", handle->video_dropped,
+            (unsigned)handle->audio_dropped);
+
    /* Flush out data still in buffers (internal, and FFmpeg internal). */
    ffmpeg_flush_buffers(handle);
 
@@ -1647,17 +1927,77 @@ static bool ffmpeg_finalize(void *data)
    return true;
 }
 
+/* How often the stream bit rate is looked at, how many
+ * windows it has to keep up for before it goes back up */
+#define FFMPEG_STREAM_WINDOW_US   1000000
+#define FFMPEG_STREAM_CALM_WINDOWS 3
+
+static void ffmpeg_stream_adapt(ffmpeg_t *handle)
+{
+   unsigned dropped, backlog;
+   retro_time_t frame_time;
+   retro_time_t now = cpu_features_get_time_usec();
+   int64_t bit_rate = handle->stream.bit_rate;
+   int64_t target   = handle->stream.target_bit_rate;
+
+   if (!handle->stream.window_start)
+   {
+      handle->stream.window_start = now;
+      handle->stream.dropped      = FFMPEG_ATOMIC_LOAD(&handle->video_dropped);
+      return;
+   }
+
+   handle->stream.window_frames++;
+
+   if (now - handle->stream.window_start < FFMPEG_STREAM_WINDOW_US)
+      return;
+
+   dropped    = FFMPEG_ATOMIC_LOAD(&handle->video_dropped);
+   backlog    = FFMPEG_ATOMIC_LOAD(&handle->video_write) - handle->video_read;
+   frame_time = 1000000 * handle->config.frame_drop_ratio / handle->params.fps;
+
+   /* Frames dropped or queued up for the encoder, or packets
+    * taking over half a frame to go out, mean the network or the
+    * encoder can't keep up with this bit rate */
+   if (     dropped != handle->stream.dropped
+         || backlog > 2
+         || handle->stream.write_time >
+            handle->stream.window_frames * frame_time / 2)
+   {
+      bit_rate                    = MAX(bit_rate * 3 / 4, target / 4);
+      handle->stream.calm_windows = 0;
+   }
+   else if (++handle->stream.calm_windows >= FFMPEG_STREAM_CALM_WINDOWS)
+   {
+      bit_rate                    = MIN(bit_rate * 11 / 10, target);
+      handle->stream.calm_windows = 0;
+   }
+
+   if (bit_rate != handle->stream.bit_rate)
+   {
+      AVCodecContext *codec = handle->video.codec;
+
+      RARCH_LOG("[FFmpeg]: Streaming at %u kbit/s.\n",
+            (unsigned)(bit_rate / 1000));
+
+      /* libx264 reconfigures on the fly when these change */
+      codec->bit_rate        = bit_rate;
+      codec->rc_max_rate     = bit_rate;
+      codec->rc_buffer_size  = bit_rate * frame_time / 1000000;
+      handle->stream.bit_rate = bit_rate;
+   }
+
+   handle->stream.window_start  = now;
+   handle->stream.window_frames = 0;
+   handle->stream.write_time    = 0;
+   handle->stream.dropped       = dropped;
+}
+
 static void ffmpeg_thread(void *data)
 {
    size_t audio_buf_size;
    void *audio_buf = NULL;
    ffmpeg_t *ff    = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
-
-   retro_assert(video_buf);
 
    audio_buf_size = ff->config.audio_enable ?
       (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
@@ -1665,56 +2005,38 @@ static void ffmpeg_thread(void *data)
 
    while (ff->alive)
    {
-      struct record_video_data attr_buf;
-
-      bool avail_video = false;
-      bool avail_audio = false;
-
-      slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
+      struct ff_video_slot *slot = ffmpeg_video_peek(ff);
+      bool avail_audio           = audio_buf
+         && ffmpeg_audio_read_avail(ff) >= audio_buf_size;
 
-      if (ff->config.audio_enable)
-         if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
-            avail_audio = true;
-      slock_unlock(ff->lock);
-
-      if (!avail_video && !avail_audio)
+      if (!slot && !avail_audio)
       {
          slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
-
+         if (ff->alive)
+            scond_wait_timeout(ff->cond, ff->cond_lock,
+                  FFMPEG_THREAD_WAIT_US);
          slock_unlock(ff->cond_lock);
+         continue;
       }
 
-      if (avail_video && video_buf)
+      /* Scaling and conversion happen here too,
+       * the producer only copies the frame. */
+      if (slot)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
+         ff->video.frame_cnt     = slot->pts;
+         ff->stream.frame_pushed = slot->pushed;
+         ffmpeg_push_video_thread(ff, &slot->attr);
+         ffmpeg_video_release(ff);
+
+         if (ff->config.low_latency)
+            ffmpeg_stream_adapt(ff);
       }
 
-      if (avail_audio && audio_buf)
+      if (avail_audio)
       {
          struct record_audio_data aud = {0};
 
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+         ffmpeg_audio_read(ff, audio_buf, audio_buf_size);
 
          aud.frames = ff->audio.codec->frame_size;
          aud.data = audio_buf;
@@ -1723,7 +2045,6 @@ static void ffmpeg_thread(void *data)
       }
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
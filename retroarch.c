@@ -54,6 +54,7 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <string.h>
+#include <limits.h>
 #include <ctype.h>
 #include <errno.h>
 #include <setjmp.h>
@@ -66,10 +67,13 @@
 #include <streams/stdin_stream.h>
 #include <dynamic/dylib.h>
 #include <file/config_file.h>
+#include <file/archive_file.h>
 #include <lists/string_list.h>
 #include <retro_math.h>
 #include <retro_timers.h>
+#include <memmap.h>
 #include <encodings/utf.h>
+#include <encodings/crc32.h>
 
 #include <gfx/scaler/pixconv.h>
 #include <gfx/scaler/scaler.h>
@@ -124,12 +128,24 @@
 #include "config.h"
 #endif
 
+#if defined(HAVE_DYNAMIC) && defined(HAVE_RUNAHEAD)
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_SECONDARY_CORE_STAT
+#endif
+#ifdef __linux__
+#include <dlfcn.h>
+#endif
+#endif
+
 #ifdef HAVE_NETWORKING
 #include <net/net_compat.h>
 #include <net/net_socket.h>
 #endif
 
 #include <audio/audio_resampler.h>
+#include <audio/audio_resampler_s16.h>
 
 #ifdef HAVE_MENU
 #include "menu/menu_driver.h"
@@ -202,6 +218,7 @@
 #endif
 #include "gfx/video_display_server.h"
 #include "gfx/video_crt_switch.h"
+#include "gfx/video_image_cache.h"
 #include "wifi/wifi_driver.h"
 #include "led/led_driver.h"
 #include "midi/midi_driver.h"
@@ -211,12 +228,16 @@
 #include "managers/core_option_manager.h"
 #include "managers/cheat_manager.h"
 #include "managers/state_manager.h"
+#include "managers/state_pool.h"
 #ifdef HAVE_AUDIOMIXER
 #include "tasks/task_audio_mixer.h"
 #endif
 #include "tasks/task_content.h"
 #include "tasks/tasks_internal.h"
 #include "performance_counters.h"
+#include "latency_test.h"
+#include "benchmark.h"
+#include "memory_usage.h"
 
 #include "version.h"
 #include "version_git.h"
@@ -502,6 +523,9 @@ static const video_driver_t *video_drivers[] = {
 #ifdef HAVE_PLAIN_DRM
    &video_drm,
 #endif
+#ifdef HAVE_KMS
+   &video_go2,
+#endif
 #ifdef HAVE_XSHM
    &video_xshm,
 #endif
@@ -1028,6 +1052,10 @@ enum
    RA_OPT_MAX_FRAMES,
    RA_OPT_MAX_FRAMES_SCREENSHOT,
    RA_OPT_MAX_FRAMES_SCREENSHOT_PATH,
+   RA_OPT_RUNAHEAD_BENCHMARK,
+   RA_OPT_BENCHMARK,
+   RA_OPT_BENCHMARK_OUT,
+   RA_OPT_BENCHMARK_FRAMES,
    RA_OPT_SET_SHADER,
    RA_OPT_ACCESSIBILITY
 };
@@ -1081,6 +1109,7 @@ static retro_bits_t has_set_libretro_device;
 
 static rarch_system_info_t runloop_system;
 static struct retro_frame_time_callback runloop_frame_time;
+static struct retro_audio_buffer_status_callback runloop_audio_buffer_status;
 static retro_keyboard_event_t runloop_key_event                 = NULL;
 static retro_keyboard_event_t runloop_frontend_key_event        = NULL;
 static core_option_manager_t *runloop_core_options              = NULL;
@@ -1096,6 +1125,30 @@ static retro_time_t frame_limit_last_time                       = 0.0;
 static retro_time_t libretro_core_runtime_last                  = 0;
 static retro_time_t libretro_core_runtime_usec                  = 0;
 
+/* Peak per-frame work (core_run minus waiting for the
+ * page flip), used by frame delay auto-tuning. */
+static retro_time_t frame_delay_auto_peak                       = 0;
+
+/* Per-frame timing of the content, kept with its runtime
+ * log as a performance profile (content_perf_profile) */
+typedef struct runloop_perf_track
+{
+   rarch_histogram_t hist;
+   uint64_t total;
+   uint64_t p95_total;
+   unsigned p95_windows;
+   unsigned frames;
+} runloop_perf_track_t;
+
+static bool runloop_perf_enable                                 = false;
+static runloop_perf_track_t runloop_perf_core;
+static runloop_perf_track_t runloop_perf_video;
+static unsigned runloop_perf_run_ahead_frames                   = 0;
+/* Limits from the profile loaded with the content,
+ * applied on top of the settings */
+static unsigned runloop_perf_frame_delay_max                    = UINT_MAX;
+static unsigned runloop_perf_run_ahead_max                      = UINT_MAX;
+
 static bool has_set_core                                        = false;
 #ifdef HAVE_DISCORD
 bool discord_is_inited                                          = false;
@@ -1129,6 +1182,7 @@ static bool runloop_missing_bios                                = false;
 static bool runloop_force_nonblock                              = false;
 static bool runloop_paused                                      = false;
 static bool runloop_idle                                        = false;
+static bool runloop_input_held                                  = false;
 static bool runloop_slowmotion                                  = false;
 static bool runloop_fastmotion                                  = false;
 static bool runloop_shutdown_initiated                          = false;
@@ -1159,6 +1213,9 @@ static char runtime_shader_preset[PATH_MAX_LENGTH]              = {0};
 static rarch_timer_t shader_delay_timer                         = {0};
 #endif
 static char runloop_max_frames_screenshot_path[PATH_MAX_LENGTH] = {0};
+static char runloop_benchmark_script[PATH_MAX_LENGTH]          = {0};
+static char runloop_benchmark_out[PATH_MAX_LENGTH]             = {0};
+static unsigned runloop_benchmark_frames                        = 0;
 static char runtime_content_path[PATH_MAX_LENGTH]               = {0};
 static char runtime_core_path[PATH_MAX_LENGTH]                  = {0};
 static char launch_arguments[4096]                              = {0};
@@ -1223,6 +1280,12 @@ static bool midi_driver_set_all_sounds_off(void);
 static const void *midi_driver_find_handle(int index);
 static bool midi_driver_flush(void);
 
+static void runloop_perf_profile_init(settings_t *settings);
+
+static retro_time_t video_driver_frame_pacing_begin(void);
+static void video_driver_frame_pacing_add(enum frame_pacing_stage stage,
+      retro_time_t start);
+
 static void retroarch_deinit_core_options(void);
 static void retroarch_init_core_variables(const struct retro_variable *vars);
 static void rarch_init_core_options(
@@ -2798,6 +2861,10 @@ static unsigned recording_width                                 = 0;
 static unsigned recording_height                                = 0;
 static size_t recording_gpu_width                               = 0;
 static size_t recording_gpu_height                              = 0;
+/* Size of the NV12 frames the video driver scales to, 0 if it reads
+ * back the viewport as it is */
+static unsigned recording_gpu_nv12_width                        = 0;
+static unsigned recording_gpu_nv12_height                       = 0;
 static bool recording_enable                                    = false;
 static bool streaming_enable                                    = false;
 
@@ -3072,12 +3139,40 @@ static const void *frame_cache_data                      = NULL;
 static unsigned frame_cache_width                        = 0;
 static unsigned frame_cache_height                       = 0;
 static size_t frame_cache_pitch                          = 0;
+
+/* Copy of the last software frame, to detect identical ones,
+ * and for drivers to find the regions that changed. */
+static uint8_t *frame_dupe_data                          = NULL;
+static size_t frame_dupe_size                            = 0;
+static unsigned frame_dupe_width                         = 0;
+static unsigned frame_dupe_height                        = 0;
+static size_t frame_dupe_row                             = 0;
+static bool frame_dupe_valid                             = false;
+/* First row of the frame being shown that differs from the copy */
+static unsigned frame_dupe_changed_row                   = 0;
+/* Counts the frames copied, see video_driver_get_prev_frame */
+static uint64_t frame_dupe_serial                        = 0;
+/* The frame being shown, to copy once the driver is done with it */
+static const void *frame_dupe_next                       = NULL;
+/* Whether the driver got frame_dupe_next as is */
+static bool frame_dupe_direct                            = false;
+/* Whether the driver asked for the copy in the last frame */
+static bool frame_dupe_wanted                            = false;
+/* Set while the last frame showed a message, or one was pushed since. */
+static bool video_driver_msg_pending                     = false;
 static bool   video_driver_threaded                      = false;
 
 static float video_driver_core_hz                        = 0.0f;
 static float video_driver_aspect_ratio                   = 0.0f;
 static unsigned video_driver_width                       = 0;
 static unsigned video_driver_height                      = 0;
+static unsigned video_driver_surface_rotation            = 0;
+static retro_time_t video_driver_present_wait            = -1;
+
+/* Stage times of the frame so far, while frame pacing is kept */
+static bool video_driver_frame_pacing_enable             = false;
+static retro_time_t video_driver_frame_pacing_stages[FRAME_PACING_STAGE_LAST];
+static frame_pacing_t video_driver_frame_pacing;
 
 static enum rarch_display_type video_driver_display_type = RARCH_DISPLAY_NONE;
 static char video_driver_title_buf[64]                   = {0};
@@ -3085,6 +3180,8 @@ static char video_driver_window_title[512]               = {0};
 static bool video_driver_window_title_update             = true;
 
 static retro_time_t video_driver_frame_time_samples[MEASURE_FRAME_TIME_SAMPLES_COUNT];
+/* Same samples, for percentiles */
+static rarch_histogram_t video_driver_frame_time_histogram;
 static uint64_t video_driver_frame_time_count            = 0;
 static uint64_t video_driver_frame_count                 = 0;
 
@@ -3154,6 +3251,14 @@ static struct retro_system_av_info video_driver_av_info;
 /* AUDIO GLOBAL VARIABLES */
 #define AUDIO_BUFFER_FREE_SAMPLES_COUNT (8 * 1024)
 
+/* Gains of the rate control loop, on the error in halves
+ * of the driver's buffer; the integral one is per second. */
+#define AUDIO_RATE_CONTROL_KP           1.0
+#define AUDIO_RATE_CONTROL_KI           0.5
+/* Time constant the queued audio is smoothed with, as
+ * write_avail only moves by the driver's period size. */
+#define AUDIO_RATE_CONTROL_SMOOTH_USEC  40000.0
+
 #define MENU_SOUND_FORMATS "ogg|mod|xm|s3m|mp3|flac"
 
 /**
@@ -3185,10 +3290,48 @@ static size_t audio_driver_rewind_size                   = 0;
 
 static int16_t *audio_driver_rewind_buf                  = NULL;
 static int16_t *audio_driver_output_samples_conv_buf     = NULL;
+/* Where audio_driver_flush converts to s16. Same as the
+ * above unless the audio worker is running, as the core
+ * fills that one in audio_driver_sample meanwhile. */
+static int16_t *audio_driver_output_samples_flush_buf    = NULL;
 
 static unsigned audio_driver_free_samples_buf[AUDIO_BUFFER_FREE_SAMPLES_COUNT];
+static float audio_driver_ratio_adjust_buf[AUDIO_BUFFER_FREE_SAMPLES_COUNT];
 static uint64_t audio_driver_free_samples_count          = 0;
 
+/* Time spent in each stage of audio_driver_flush. */
+enum audio_driver_stage
+{
+   AUDIO_DRIVER_STAGE_CONVERT = 0,
+   AUDIO_DRIVER_STAGE_DSP,
+   AUDIO_DRIVER_STAGE_RESAMPLE,
+   AUDIO_DRIVER_STAGE_MIX,
+   AUDIO_DRIVER_STAGE_WRITE,
+   AUDIO_DRIVER_STAGE_LAST
+};
+
+static rarch_histogram_t audio_driver_stage_histograms[AUDIO_DRIVER_STAGE_LAST];
+
+static const char *audio_driver_stage_names[AUDIO_DRIVER_STAGE_LAST] = {
+   "Audio convert",
+   "Audio DSP",
+   "Audio resample",
+   "Audio mix",
+   "Audio write",
+};
+
+/* Reported by the driver after each write. */
+static rarch_histogram_t audio_driver_latency_histogram;
+static unsigned audio_driver_underruns                   = 0;
+static unsigned audio_driver_overruns                    = 0;
+static int64_t audio_driver_latency                      = -1;
+static retro_time_t audio_driver_latency_time            = 0;
+
+/* State of the rate control loop, see audio_driver_update_ratio. */
+static double audio_driver_control_queued                = -1.0;
+static double audio_driver_control_integral              = 0.0;
+static retro_time_t audio_driver_control_time            = 0;
+
 static size_t audio_driver_buffer_size                   = 0;
 static size_t audio_driver_data_ptr                      = 0;
 
@@ -3204,6 +3347,12 @@ static float audio_driver_volume_gain                    = 0.0f;
 static float *audio_driver_input_data                    = NULL;
 static float *audio_driver_output_samples_buf            = NULL;
 
+/* Fixed-point path, only set up when audio_fixed_point is enabled. */
+static audio_resampler_s16_t *audio_driver_resampler_s16 = NULL;
+static int16_t *audio_driver_output_samples_s16_buf      = NULL;
+/* Samples the output buffers hold, they are hot memory */
+static size_t audio_driver_output_samples_max           = 0;
+
 static double audio_source_ratio_original                = 0.0f;
 static double audio_source_ratio_current                 = 0.0f;
 
@@ -3220,6 +3369,41 @@ static void *audio_driver_context_audio_data             = NULL;
 static bool audio_suspended                              = false;
 static bool audio_is_threaded                            = false;
 
+/* Optional worker thread that takes the raw audio of the
+ * core through a single producer, single consumer queue
+ * and does the rest of audio_driver_flush on its own. */
+#if defined(HAVE_THREADS) && (defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#define HAVE_AUDIO_WORKER
+#define AUDIO_WORKER_ATOMIC_LOAD(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define AUDIO_WORKER_ATOMIC_STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+/* While the worker flushes one chunk, the core may queue
+ * one more, which bounds the added latency to a batch. */
+#define AUDIO_WORKER_CHUNKS        2
+#define AUDIO_WORKER_CHUNK_SAMPLES (AUDIO_CHUNK_SIZE_NONBLOCKING * 2)
+
+typedef struct audio_worker
+{
+   int16_t *data[AUDIO_WORKER_CHUNKS];
+   int16_t *conv_buf;
+   size_t samples[AUDIO_WORKER_CHUNKS];
+   bool is_slowmotion[AUDIO_WORKER_CHUNKS];
+   unsigned read;
+   unsigned write;
+
+   sthread_t *thread;
+   /* Held while a chunk is flushed, so that the main thread
+    * can safely touch the driver, DSP filter and mixer. */
+   slock_t *flush_lock;
+   slock_t *cond_lock;
+   scond_t *cond;
+   bool quit;
+} audio_worker_t;
+
+static audio_worker_t audio_worker                       = {{0}};
+#endif
+
 /* RUNAHEAD GLOBAL VARIABLES */
 
 typedef struct input_list_element_t
@@ -3228,6 +3412,8 @@ typedef struct input_list_element_t
    unsigned device;
    unsigned index;
    int16_t *state;
+   /* One bit per id the core has queried */
+   uint32_t *used;
    unsigned int state_size;
 } input_list_element;
 
@@ -3259,6 +3445,31 @@ static bool runahead_available                  = true;
 static bool runahead_secondary_core_available   = true;
 static bool runahead_force_input_dirty          = true;
 static uint64_t runahead_last_frame_count       = 0;
+
+/* Savestate ring used when reusing frames run ahead:
+ * the slot holding the real state, how many frames
+ * the core currently is ahead of it, and whether the
+ * input changed in the previous frame. */
+static unsigned runahead_ring_base              = 0;
+static unsigned runahead_ring_ahead             = 0;
+static bool runahead_ring_input_changed         = false;
+/* Set when the core asked for input it had not asked
+ * for before while frames were being reused */
+static bool runahead_ring_input_missed          = false;
+/* Frames run through the ring, and the ones among them
+ * where the frames run ahead had to be redone. */
+static unsigned runahead_ring_frames            = 0;
+static unsigned runahead_ring_rollbacks         = 0;
+/* States handed over to the second instance, and the
+ * time it took to save and load them. */
+static unsigned runahead_secondary_syncs        = 0;
+static retro_time_t runahead_secondary_sync_time = 0;
+static retro_time_t runahead_secondary_sync_peak = 0;
+
+#define RUNAHEAD_BENCHMARK_FRAMES 600
+
+/* Frames to run the benchmark for once content runs, 0 if none */
+static unsigned runahead_benchmark_frames       = 0;
 #endif
 
 /* INPUT REMOTE GLOBAL VARIABLES */
@@ -3323,9 +3534,16 @@ struct input_overlay
    bool enable;
    bool blocked;
    bool alive;
+   /* Alpha of the images is not what set_alpha_mod gave them */
+   bool alpha_dirty;
+   /* Pressed descs had their alpha changed last frame */
+   bool alpha_pressed;
 
    unsigned next_index;
 
+   /* Last set by set_alpha_mod */
+   float alpha_mod;
+
    size_t index;
    size_t size;
 
@@ -3516,6 +3734,12 @@ static bool input_driver_flushing_input           = false;
 static float input_driver_axis_threshold          = 0.0f;
 static unsigned input_driver_max_users            = 0;
 
+/* Joypad buttons of each port as the core sees them, remapped
+ * and with turbo applied, taken once per poll and port on the
+ * first query. See input_state_joypad_buttons(). */
+static int16_t input_driver_joypad_buttons[MAX_USERS];
+static uint32_t input_driver_joypad_buttons_valid = 0;
+
 #ifdef HAVE_HID
 static const void *hid_data                       = NULL;
 #endif
@@ -3576,6 +3800,9 @@ static void retro_run_null(void);
 static void retro_input_poll_null(void);
 
 static void uninit_libretro_symbols(struct retro_core_t *current_core);
+#ifdef HAVE_DYNAMIC
+static void libretro_free_warm_core(void);
+#endif
 static bool init_libretro_symbols(enum rarch_core_type type,
       struct retro_core_t *current_core);
 
@@ -3583,6 +3810,14 @@ static void ui_companion_driver_deinit(void);
 
 static bool audio_driver_stop(void);
 static bool audio_driver_start(bool is_shutdown);
+static bool audio_driver_worker_init(size_t outsamples_max);
+static void audio_driver_worker_deinit(void);
+static void audio_driver_worker_sync(void);
+#ifdef HAVE_AUDIO_WORKER
+static size_t audio_driver_worker_pending(void);
+#endif
+static void audio_driver_control_reset(void);
+static bool audio_compute_buffer_statistics(audio_statistics_t *stats);
 
 static bool recording_init(void);
 static bool recording_deinit(void);
@@ -3756,6 +3991,14 @@ static enum cmd_source_t lastcmd_source;
 static int lastcmd_net_fd;
 static struct sockaddr_storage lastcmd_net_source;
 static socklen_t lastcmd_net_source_len;
+
+/* Subscriber to SUBSCRIBE_METRICS, sent metrics
+ * every interval (usec) */
+static int command_metrics_fd                        = -1;
+static struct sockaddr_storage command_metrics_addr;
+static socklen_t command_metrics_addr_len            = 0;
+static retro_time_t command_metrics_interval         = 0;
+static retro_time_t command_metrics_next             = 0;
 #endif
 
 #if defined(HAVE_CHEEVOS) && (defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD))
@@ -3830,6 +4073,275 @@ static bool command_get_status(const char* arg)
 }
 
 
+static bool command_get_audio_stats(const char* arg)
+{
+   unsigned i;
+   rarch_histogram_stats_t hist;
+   char reply[1024]               = {0};
+   audio_statistics_t audio_stats = {0.0f};
+   size_t pos                     = 0;
+
+   if (!audio_compute_buffer_statistics(&audio_stats))
+   {
+      snprintf(reply, sizeof(reply), "GET_AUDIO_STATS NONE\n");
+      command_reply(reply, strlen(reply));
+      return true;
+   }
+
+   pos += snprintf(reply, sizeof(reply),
+         "GET_AUDIO_STATS saturation=%.2f,deviation=%.2f,"
+         "near_underrun=%.2f,near_blocking=%.2f,samples=%u,"
+         "ratio_avg=%.4f,ratio_min=%.4f,ratio_max=%.4f,"
+         "underruns=%u,overruns=%u",
+         audio_stats.average_buffer_saturation,
+         audio_stats.std_deviation_percentage,
+         audio_stats.close_to_underrun,
+         audio_stats.close_to_blocking,
+         audio_stats.samples,
+         audio_stats.ratio_adjust_avg,
+         audio_stats.ratio_adjust_min,
+         audio_stats.ratio_adjust_max,
+         audio_stats.underruns,
+         audio_stats.overruns);
+
+   /* Times are in usec. */
+   if (pos < sizeof(reply) && rarch_histogram_get_stats(
+            &audio_driver_latency_histogram, &hist))
+      pos += snprintf(reply + pos, sizeof(reply) - pos,
+            ",latency_min=%" PRId64 ",latency_avg=%" PRId64
+            ",latency_p99=%" PRId64,
+            (int64_t)hist.min, (int64_t)hist.avg, (int64_t)hist.p99);
+
+   for (i = 0; i < AUDIO_DRIVER_STAGE_LAST && pos < sizeof(reply); i++)
+   {
+      /* "Audio resample" -> "resample" */
+      const char *name = audio_driver_stage_names[i] + STRLEN_CONST("Audio ");
+
+      if (!rarch_histogram_get_stats(
+               &audio_driver_stage_histograms[i], &hist))
+         continue;
+
+      pos += snprintf(reply + pos, sizeof(reply) - pos,
+            ",%s_avg=%" PRId64 ",%s_p99=%" PRId64,
+            name, (int64_t)hist.avg, name, (int64_t)hist.p99);
+   }
+
+   if (pos < sizeof(reply))
+      snprintf(reply + pos, sizeof(reply) - pos, "\n");
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+static bool command_get_netplay_stats(const char* arg)
+{
+   char reply[1024] = {0};
+   size_t pos       = 0;
+#ifdef HAVE_NETWORKING
+   unsigned i;
+   netplay_stats_t stats;
+
+   memset(&stats, 0, sizeof(stats));
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_GET_STATS, &stats))
+   {
+      pos += snprintf(reply, sizeof(reply),
+            "GET_NETPLAY_STATS input_latency=%d,rollbacks=%u,"
+            "rollback_max=%u,replayed_per_second=%.2f,crc_mismatches=%u,"
+            "bytes_sent=%" PRIu64 ",bytes_received=%" PRIu64,
+            stats.input_latency_frames, stats.rollbacks, stats.rollback_max,
+            stats.replayed_per_second, stats.crc_mismatches,
+            stats.bytes_sent, stats.bytes_received);
+
+      /* The last one counts everything deeper too */
+      for (i = 0; i < NETPLAY_STATS_DEPTHS && pos < sizeof(reply); i++)
+         pos += snprintf(reply + pos, sizeof(reply) - pos,
+               ",rollback_depth_%u=%u", i + 1, stats.rollback_depths[i]);
+
+      /* Times are in usec, -1 if unknown. */
+      for (i = 0; i < stats.peer_count && i < NETPLAY_STATS_MAX_PEERS
+            && pos < sizeof(reply); i++)
+      {
+         const netplay_peer_stats_t *peer = &stats.peers[i];
+
+         pos += snprintf(reply + pos, sizeof(reply) - pos,
+               ",peer%u_rtt=%" PRId64 ",peer%u_jitter=%" PRId64
+               ",peer%u_bytes_sent=%" PRIu64 ",peer%u_bytes_received=%" PRIu64,
+               i, peer->rtt, i, peer->jitter,
+               i, peer->bytes_sent, i, peer->bytes_received);
+      }
+   }
+#endif
+
+   if (!pos)
+      pos = snprintf(reply, sizeof(reply), "GET_NETPLAY_STATS NONE");
+
+   if (pos < sizeof(reply))
+      snprintf(reply + pos, sizeof(reply) - pos, "\n");
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+static bool command_get_perf_counters(const char* arg)
+{
+   unsigned i;
+   rarch_perf_frame_stats_t top[16];
+   char reply[2048]  = {0};
+   size_t pos        = 0;
+   unsigned count    = runloop_perfcnt_enable
+      ? rarch_perf_get_top(top, ARRAY_SIZE(top)) : 0;
+
+   /* Ticks and calls per frame, costliest first. Core
+    * counters are prefixed with "core:". */
+   if (count)
+   {
+      pos = strlcpy(reply, "GET_PERF_COUNTERS ", sizeof(reply));
+
+      for (i = 0; i < count && pos < sizeof(reply); i++)
+         pos += snprintf(reply + pos, sizeof(reply) - pos,
+               "%s%s%s=%" PRIu64 "/%.2f",
+               i ? "," : "",
+               top[i].libretro ? "core:" : "",
+               top[i].ident, (uint64_t)top[i].ticks, top[i].calls);
+   }
+   else
+      pos = snprintf(reply, sizeof(reply), "GET_PERF_COUNTERS NONE");
+
+   if (pos < sizeof(reply))
+      snprintf(reply + pos, sizeof(reply) - pos, "\n");
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+/* Bytes in use per subsystem, e.g.
+ * GET_MEMORY_USAGE Rewind=0,Run-Ahead=2097152,... */
+static bool command_get_memory_usage(const char* arg)
+{
+   char reply[1024];
+   size_t pos = strlcpy(reply, "GET_MEMORY_USAGE ", sizeof(reply));
+
+   retroarch_memory_usage_update();
+
+   pos += memory_usage_print(reply + pos, sizeof(reply) - pos, ",");
+
+   if (pos < sizeof(reply) - 1)
+      strlcpy(reply + pos, "\n", sizeof(reply) - pos);
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+#ifdef HAVE_NETWORK_CMD
+/* Least time between metrics, in msec */
+#define COMMAND_METRICS_MIN_INTERVAL 100
+
+/* SUBSCRIBE_METRICS <msec>: the sender gets a line of JSON with
+ * the current metrics every interval, until 0 is given or
+ * someone else subscribes. */
+static bool command_subscribe_metrics(const char* arg)
+{
+   char reply[64];
+   unsigned interval = (unsigned)strtoul(arg, NULL, 10);
+
+   if (lastcmd_source != CMD_NETWORK)
+      return false;
+
+   if (!interval)
+   {
+      command_metrics_fd       = -1;
+      command_metrics_interval = 0;
+      strlcpy(reply, "SUBSCRIBE_METRICS OFF\n", sizeof(reply));
+   }
+   else
+   {
+      if (interval < COMMAND_METRICS_MIN_INTERVAL)
+         interval = COMMAND_METRICS_MIN_INTERVAL;
+
+      memcpy(&command_metrics_addr, &lastcmd_net_source,
+            sizeof(command_metrics_addr));
+      command_metrics_addr_len = lastcmd_net_source_len;
+      command_metrics_fd       = lastcmd_net_fd;
+      command_metrics_interval = (retro_time_t)interval * 1000;
+      command_metrics_next     = 0;
+      snprintf(reply, sizeof(reply), "SUBSCRIBE_METRICS %u\n", interval);
+   }
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+/* Times are in usec, clocks in kHz, temperature
+ * in millidegrees Celsius and memory in bytes. */
+static void command_metrics_send(void)
+{
+   rarch_histogram_stats_t frame_time;
+   audio_statistics_t audio_stats = {0.0f};
+   frontend_sensors_t sensors;
+#ifdef HAVE_NETWORKING
+   netplay_stats_t netplay_stats;
+#endif
+   char msg[1024];
+   size_t pos;
+   retro_time_t now               = cpu_features_get_time_usec();
+
+   if (command_metrics_fd < 0 || now < command_metrics_next)
+      return;
+
+   command_metrics_next = now + command_metrics_interval;
+
+   pos = snprintf(msg, sizeof(msg),
+         "{\"time\":%" PRId64 ",\"frame\":%" PRIu64,
+         (int64_t)now, video_driver_frame_count);
+
+   if (pos < sizeof(msg) && rarch_histogram_get_stats(
+            &video_driver_frame_time_histogram, &frame_time))
+      pos += snprintf(msg + pos, sizeof(msg) - pos,
+            ",\"frame_time\":{\"avg\":%" PRId64 ",\"p50\":%" PRId64
+            ",\"p95\":%" PRId64 ",\"p99\":%" PRId64
+            ",\"max\":%" PRId64 "}",
+            (int64_t)frame_time.avg, (int64_t)frame_time.p50,
+            (int64_t)frame_time.p95, (int64_t)frame_time.p99,
+            (int64_t)frame_time.max);
+
+   if (pos < sizeof(msg) && audio_compute_buffer_statistics(&audio_stats))
+      pos += snprintf(msg + pos, sizeof(msg) - pos,
+            ",\"audio\":{\"saturation\":%.2f,\"near_underrun\":%.2f,"
+            "\"underruns\":%u,\"overruns\":%u}",
+            audio_stats.average_buffer_saturation,
+            audio_stats.close_to_underrun,
+            audio_stats.underruns, audio_stats.overruns);
+
+#ifdef HAVE_NETWORKING
+   memset(&netplay_stats, 0, sizeof(netplay_stats));
+   if (pos < sizeof(msg)
+         && netplay_driver_ctl(RARCH_NETPLAY_CTL_GET_STATS, &netplay_stats))
+      pos += snprintf(msg + pos, sizeof(msg) - pos,
+            ",\"netplay\":{\"input_latency\":%d,\"rollbacks\":%u,"
+            "\"rollback_max\":%u,\"crc_mismatches\":%u}",
+            netplay_stats.input_latency_frames, netplay_stats.rollbacks,
+            netplay_stats.rollback_max, netplay_stats.crc_mismatches);
+#endif
+
+   if (pos < sizeof(msg) && frontend_driver_get_sensors(&sensors))
+      pos += snprintf(msg + pos, sizeof(msg) - pos,
+            ",\"cpu_freq\":%d,\"gpu_freq\":%d,\"temperature\":%d",
+            sensors.cpu_freq, sensors.gpu_freq, sensors.temperature);
+
+   if (pos < sizeof(msg))
+      pos += snprintf(msg + pos, sizeof(msg) - pos,
+            ",\"memory_total\":%" PRIu64 ",\"memory_free\":%" PRIu64 "}\n",
+            frontend_driver_get_total_memory(),
+            frontend_driver_get_free_memory());
+
+   if (pos >= sizeof(msg))
+      return;
+
+   sendto(command_metrics_fd, msg, pos, 0,
+         (struct sockaddr*)&command_metrics_addr, command_metrics_addr_len);
+}
+#endif
+
 static bool command_show_osd_msg(const char* arg)
 {
     runloop_msg_queue_push(arg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
@@ -3881,6 +4393,13 @@ static const struct cmd_action_map action_map[] = {
    { "VERSION",          command_version,          "No argument"},
    { "GET_STATUS",       command_get_status,       "No argument" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
+   { "GET_AUDIO_STATS",  command_get_audio_stats,  "No argument" },
+   { "GET_NETPLAY_STATS", command_get_netplay_stats, "No argument" },
+   { "GET_PERF_COUNTERS", command_get_perf_counters, "No argument" },
+   { "GET_MEMORY_USAGE", command_get_memory_usage, "No argument" },
+#ifdef HAVE_NETWORK_CMD
+   { "SUBSCRIBE_METRICS", command_subscribe_metrics, "<interval in msec, 0 to stop>" },
+#endif
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
 #if defined(HAVE_CHEEVOS)
    { "READ_CORE_RAM",   command_read_ram,    "<address> <number of bytes>" },
@@ -3957,6 +4476,10 @@ bool retroarch_apply_shader(enum rarch_shader_type type, const char *preset_path
    if (current_video->set_shader)
       ret = current_video->set_shader(video_driver_data, type, preset_path);
 
+   /* Show the next frame through the new shader, even if
+    * it's the same */
+   video_driver_frame_dupe_reset();
+
    if (ret)
    {
       configuration_set_bool(settings, settings->bools.video_shader_enable, true);
@@ -4290,6 +4813,8 @@ static void command_network_poll(command_t *handle)
    if (handle->net_fd < 0)
       return;
 
+   command_metrics_send();
+
    FD_ZERO(&fds);
    FD_SET(handle->net_fd, &fds);
 
@@ -4328,6 +4853,9 @@ static bool command_free(command_t *handle)
 #ifdef HAVE_NETWORK_CMD
    if (handle && handle->net_fd >= 0)
       socket_close(handle->net_fd);
+
+   command_metrics_fd       = -1;
+   command_metrics_interval = 0;
 #endif
 
    free(handle);
@@ -5545,6 +6073,7 @@ static void command_event_deinit_core(bool reinit)
 
    RARCH_LOG("Unloading game..\n");
    core_unload_game();
+   state_pool_set_size(0);
 
    RARCH_LOG("Unloading core..\n");
 
@@ -5739,6 +6268,12 @@ static bool event_init_content(void)
 
    command_event_set_savestate_auto_index();
 
+   {
+      retro_ctx_size_info_t info;
+      core_serialize_size(&info);
+      state_pool_set_size(info.size);
+   }
+
    if (event_load_save_files(rarch_is_sram_load_disabled))
       RARCH_LOG("%s.\n",
             msg_hash_to_str(MSG_SKIPPING_SRAM_LOAD));
@@ -5768,6 +6303,55 @@ static bool event_init_content(void)
    return true;
 }
 
+/* Sessions shorter than this do not replace a profile */
+#define RUNLOOP_PERF_MIN_FRAMES 1800
+
+static void runloop_perf_add(runloop_perf_track_t *track,
+      retro_time_t sample)
+{
+   if (sample < 0)
+      sample = 0;
+
+   rarch_histogram_add(&track->hist, sample);
+   track->total += sample;
+
+   /* The p95 is averaged over whole windows of the
+    * histogram, so one bad scene does not make it */
+   if ((++track->frames & (HISTOGRAM_SAMPLES - 1)) == 0)
+   {
+      rarch_histogram_stats_t stats;
+
+      if (rarch_histogram_get_stats(&track->hist, &stats))
+      {
+         track->p95_total += stats.p95;
+         track->p95_windows++;
+      }
+   }
+}
+
+static void runloop_perf_get(rtl_perf_t *perf)
+{
+   memset(perf, 0, sizeof(*perf));
+
+   if (!runloop_perf_core.p95_windows)
+      return;
+
+   perf->frames           = runloop_perf_core.frames;
+   perf->core_run_avg     = (unsigned)(runloop_perf_core.total
+         / runloop_perf_core.frames);
+   perf->core_run_p95     = (unsigned)(runloop_perf_core.p95_total
+         / runloop_perf_core.p95_windows);
+   if (runloop_perf_video.p95_windows)
+   {
+      perf->video_avg     = (unsigned)(runloop_perf_video.total
+            / runloop_perf_video.frames);
+      perf->video_p95     = (unsigned)(runloop_perf_video.p95_total
+            / runloop_perf_video.p95_windows);
+   }
+   perf->underruns        = audio_driver_underruns;
+   perf->run_ahead_frames = runloop_perf_run_ahead_frames;
+}
+
 static void update_runtime_log(bool log_per_core)
 {
    settings_t *settings = configuration_settings;
@@ -5789,6 +6373,16 @@ static void update_runtime_log(bool log_per_core)
    /* Update 'last played' entry */
    runtime_log_set_last_played_now(runtime_log);
 
+   /* Update performance profile, if measured long enough */
+   if (log_per_core && runloop_perf_enable
+         && runloop_perf_core.frames >= RUNLOOP_PERF_MIN_FRAMES)
+   {
+      rtl_perf_t perf;
+
+      runloop_perf_get(&perf);
+      runtime_log_set_perf(runtime_log, &perf);
+   }
+
    /* Save runtime log file */
    runtime_log_save(runtime_log);
 
@@ -5834,6 +6428,10 @@ static void command_event_runtime_log_deinit(void)
    libretro_core_runtime_usec = 0;
    memset(runtime_content_path, 0, sizeof(runtime_content_path));
    memset(runtime_core_path, 0, sizeof(runtime_core_path));
+
+   runloop_perf_enable          = false;
+   runloop_perf_frame_delay_max = UINT_MAX;
+   runloop_perf_run_ahead_max   = UINT_MAX;
 }
 
 static void command_event_runtime_log_init(void)
@@ -5863,6 +6461,8 @@ static void command_event_runtime_log_init(void)
 
    if (!string_is_empty(core_path))
       strlcpy(runtime_core_path, core_path, sizeof(runtime_core_path));
+
+   runloop_perf_profile_init(configuration_settings);
 }
 
 static void retroarch_set_frame_limit(float fastforward_ratio_orig)
@@ -5952,6 +6552,7 @@ static bool command_event_init_core(enum rarch_core_type type)
 
    /* Verify that initial disk index was set correctly */
    disk_control_verify_initial_index(&runloop_system.disk_control);
+   disk_control_preload_next(&runloop_system.disk_control);
 
    if (!core_load(settings->uints.input_poll_type_behavior))
       return false;
@@ -6409,6 +7010,7 @@ static void retroarch_frame_time_free(void)
          sizeof(struct retro_frame_time_callback));
    runloop_frame_time_last           = 0;
    runloop_max_frames                = 0;
+   runloop_audio_buffer_status.callback = NULL;
 }
 
 static void retroarch_system_info_free(void)
@@ -6477,6 +7079,9 @@ bool command_event(enum event_command cmd, void *data)
 {
    bool boolean               = false;
 
+   /* Commands are how most settings change outside the menu */
+   video_driver_info_invalidate();
+
    switch (cmd)
    {
       case CMD_EVENT_SAVE_FILES:
@@ -6569,6 +7174,15 @@ bool command_event(enum event_command cmd, void *data)
          else
             command_event(CMD_EVENT_RECORD_INIT, NULL);
          break;
+      case CMD_EVENT_RUNAHEAD_BENCHMARK:
+#ifdef HAVE_RUNAHEAD
+         if (!rarch_ctl(RARCH_CTL_IS_DUMMY_CORE, NULL))
+         {
+            runahead_benchmark_frames = RUNAHEAD_BENCHMARK_FRAMES;
+            command_event(CMD_EVENT_RESUME, NULL);
+         }
+#endif
+         break;
       case CMD_EVENT_OSK_TOGGLE:
          if (input_driver_keyboard_linefeed_enable)
             input_driver_keyboard_linefeed_enable = false;
@@ -6841,7 +7455,11 @@ TODO: Add a setting for these tweaks */
                if (!netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL))
 #endif
                {
-                  state_manager_event_init((unsigned)settings->sizes.rewind_buffer_size);
+                  state_manager_event_init(
+                        (unsigned)settings->sizes.rewind_buffer_size,
+                        settings->bools.rewind_worker_thread,
+                        settings->uints.rewind_levels,
+                        settings->uints.rewind_level_stride);
                }
             }
          }
@@ -6931,6 +7549,7 @@ TODO: Add a setting for these tweaks */
       case CMD_EVENT_DSP_FILTER_INIT:
          {
             settings_t *settings      = configuration_settings;
+            audio_driver_worker_sync();
             audio_driver_dsp_filter_free();
             if (string_is_empty(settings->paths.path_audio_dsp_plugin))
                break;
@@ -7002,9 +7621,33 @@ TODO: Add a setting for these tweaks */
          {
             settings_t *settings          = configuration_settings;
             unsigned content_history_size = settings->uints.content_history_size;
+            startup_history_t *history    = (startup_history_t*)
+               startup_stage_take(STARTUP_STAGE_HISTORY);
 
             command_event(CMD_EVENT_HISTORY_DEINIT, NULL);
 
+            /* Loaded during startup */
+            if (history)
+            {
+               g_defaults.content_history = history->content;
+               g_defaults.music_history   = history->music;
+#if defined(HAVE_FFMPEG) || defined(HAVE_MPV)
+               g_defaults.video_history   = history->video;
+#endif
+#ifdef HAVE_IMAGEVIEWER
+               g_defaults.image_history   = history->image;
+#endif
+               free(history);
+               break;
+            }
+
+            /* Not while the favorites use them */
+            startup_stage_wait(STARTUP_STAGE_FAVORITES);
+
+            playlist_set_cache_dir(settings->bools.playlist_binary_cache
+                  ? settings->paths.directory_cache : NULL);
+            playlist_set_journal_enable(settings->bools.playlist_journal);
+
             if (!settings->bools.history_list_enable)
                return false;
 
@@ -7049,6 +7692,8 @@ TODO: Add a setting for these tweaks */
          {
             char ext_name[255];
             settings_t *settings      = configuration_settings;
+            core_info_list_t *list    = (core_info_list_t*)
+               startup_stage_take(STARTUP_STAGE_CORE_INFO);
 
             ext_name[0]               = '\0';
 
@@ -7057,6 +7702,16 @@ TODO: Add a setting for these tweaks */
             if (!frontend_driver_get_core_extension(ext_name, sizeof(ext_name)))
                return false;
 
+            core_info_set_cache_dir(settings->bools.core_info_cache
+                  ? settings->paths.directory_cache : NULL);
+
+            /* Read during startup */
+            if (list)
+            {
+               core_info_set_list(list);
+               break;
+            }
+
             if (!string_is_empty(settings->paths.directory_libretro))
                core_info_init_list(settings->paths.path_libretro_info,
                      settings->paths.directory_libretro,
@@ -7255,10 +7910,15 @@ TODO: Add a setting for these tweaks */
       case CMD_EVENT_SHADERS_APPLY_CHANGES:
 #ifdef HAVE_MENU
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
-         menu_shader_manager_apply_changes(menu_shader_get(),
-               configuration_settings->paths.directory_video_shader,
-               configuration_settings->paths.directory_menu_config
-               );
+         {
+            /* Set when the shader files changed on disk */
+            bool *reload = (bool*)data;
+
+            menu_shader_manager_apply_changes(menu_shader_get(),
+                  configuration_settings->paths.directory_video_shader,
+                  configuration_settings->paths.directory_menu_config,
+                  reload && *reload);
+         }
 #endif
 #endif
          ui_companion_event_command(cmd);
@@ -8017,6 +8677,27 @@ void main_exit(void *args)
 
    rarch_perf_log();
 
+   {
+      char trace_path[PATH_MAX_LENGTH];
+      trace_path[0] = '\0';
+      fill_pathname_join(trace_path, settings->paths.log_dir,
+            "retroarch_trace.json", sizeof(trace_path));
+      rarch_trace_deinit(trace_path);
+   }
+
+   /* Quit before the end of its script */
+   benchmark_deinit();
+
+   latency_test_deinit();
+
+#ifdef HAVE_COMPRESSION
+   file_archive_cache_deinit();
+#endif
+
+#ifdef HAVE_DYNAMIC
+   libretro_free_warm_core();
+#endif
+
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
 #endif
@@ -8041,6 +8722,7 @@ void main_exit(void *args)
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free();
    task_queue_deinit();
+   video_image_cache_deinit();
 
    if (configuration_settings)
       free(configuration_settings);
@@ -8134,12 +8816,20 @@ int rarch_main(int argc, char *argv[], void *data)
    {
       int ret;
       bool app_exit     = false;
+      retro_time_t trace_start;
+      retro_time_t pacing_start;
 #ifdef HAVE_QT
       ui_companion_qt.application->process_events();
 #endif
+      trace_start = rarch_trace_begin();
       ret = runloop_iterate();
+      rarch_trace_end("runloop_iterate", trace_start);
 
+      trace_start = rarch_trace_begin();
+      pacing_start = video_driver_frame_pacing_begin();
       task_queue_check();
+      video_driver_frame_pacing_add(FRAME_PACING_TASKS, pacing_start);
+      rarch_trace_end("Task queue", trace_start);
 
 #ifdef HAVE_QT
       app_exit = ui_companion_qt.application->exiting;
@@ -8368,10 +9058,95 @@ static void core_option_manager_free(core_option_manager_t *opt)
 
    if (opt->conf)
       config_file_free(opt->conf);
+   free(opt->map);
    free(opt->opts);
    free(opt);
 }
 
+/**
+ * core_option_manager_init_map:
+ * @opt              : options manager handle
+ *
+ * Indexes the options by key, for GET_VARIABLE and the
+ * other lookups by key to take a hash and a compare.
+ **/
+static bool core_option_manager_init_map(core_option_manager_t *opt)
+{
+   size_t i;
+   size_t map_size = 16;
+
+   /* At most half full */
+   while (map_size < opt->size * 2)
+      map_size <<= 1;
+
+   if (!(opt->map = (size_t*)calloc(map_size, sizeof(*opt->map))))
+      return false;
+
+   opt->map_size = map_size;
+
+   for (i = 0; i < opt->size; i++)
+   {
+      size_t slot;
+      struct core_option *option = &opt->opts[i];
+
+      if (string_is_empty(option->key))
+         continue;
+
+      option->key_hash = msg_hash_calculate(option->key);
+      slot             = option->key_hash & (map_size - 1);
+
+      /* The first of options of the same key wins,
+       * as with a linear search */
+      while (opt->map[slot])
+      {
+         if (string_is_equal(opt->opts[opt->map[slot] - 1].key, option->key))
+            break;
+         slot = (slot + 1) & (map_size - 1);
+      }
+
+      if (!opt->map[slot])
+         opt->map[slot] = i + 1;
+   }
+
+   return true;
+}
+
+/**
+ * core_option_manager_find:
+ * @opt              : options manager handle
+ * @key              : key of the option
+ * @idx              : index of the option, if found
+ *
+ * Returns: true if an option of @key exists.
+ **/
+static bool core_option_manager_find(core_option_manager_t *opt,
+      const char *key, size_t *idx)
+{
+   size_t slot;
+   uint32_t hash;
+
+   if (!opt->map || string_is_empty(key))
+      return false;
+
+   hash = msg_hash_calculate(key);
+   slot = hash & (opt->map_size - 1);
+
+   while (opt->map[slot])
+   {
+      const struct core_option *option = &opt->opts[opt->map[slot] - 1];
+
+      if (option->key_hash == hash && string_is_equal(option->key, key))
+      {
+         *idx = opt->map[slot] - 1;
+         return true;
+      }
+
+      slot = (slot + 1) & (opt->map_size - 1);
+   }
+
+   return false;
+}
+
 /**
  * core_option_manager_new_vars:
  * @conf_path        : Filesystem path to write core option config file to.
@@ -8426,6 +9201,9 @@ static core_option_manager_t *core_option_manager_new_vars(
          goto error;
    }
 
+   if (!core_option_manager_init_map(opt))
+      goto error;
+
    if (config_src)
       config_file_free(config_src);
 
@@ -8497,6 +9275,9 @@ static core_option_manager_t *core_option_manager_new(
          goto error;
    }
 
+   if (!core_option_manager_init_map(opt))
+      goto error;
+
    if (config_src)
       config_file_free(config_src);
 
@@ -8804,17 +9585,8 @@ static void core_option_manager_set_display(core_option_manager_t *opt,
    if (!opt || string_is_empty(key))
       return;
 
-   for (i = 0; i < opt->size; i++)
-   {
-      if (string_is_empty(opt->opts[i].key))
-         continue;
-
-      if (string_is_equal(opt->opts[i].key, key))
-      {
-         opt->opts[i].visible = visible;
-         return;
-      }
-   }
+   if (core_option_manager_find(opt, key, &i))
+      opt->opts[i].visible = visible;
 }
 
 /* DYNAMIC LIBRETRO CORE  */
@@ -8827,6 +9599,11 @@ static void core_option_manager_set_display(core_option_manager_t *opt,
 } while (0)
 
 static dylib_t lib_handle;
+static char lib_handle_path[PATH_MAX_LENGTH];
+/* The last core unloaded, left open with core_warm_start for the
+ * next load of it to skip dlopen and the relocations */
+static dylib_t lib_handle_warm;
+static char lib_handle_warm_path[PATH_MAX_LENGTH];
 #else
 #define SYMBOL(x) current_core->x = x
 #endif
@@ -9410,16 +10187,12 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
 
                runloop_core_options->updated = false;
 
-               for (i = 0; i < runloop_core_options->size; i++)
-               {
-                  if (!string_is_empty(runloop_core_options->opts[i].key))
-                     if (string_is_equal(runloop_core_options->opts[i].key, var->key))
-                     {
-                        var->value = runloop_core_options->opts[i].vals->elems[
-                           runloop_core_options->opts[i].index].data;
-                        break;
-                     }
-               }
+               /* The value strings live as long as the options,
+                * so the one of the current index is handed out */
+               if (core_option_manager_find(runloop_core_options,
+                        var->key, &i))
+                  var->value = runloop_core_options->opts[i].vals->elems[
+                     runloop_core_options->opts[i].index].data;
             }
 
             if (log_level == RETRO_LOG_DEBUG)
@@ -9890,6 +10663,20 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
          break;
       }
 
+      case RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK:
+      {
+         const struct retro_audio_buffer_status_callback *info =
+            (const struct retro_audio_buffer_status_callback*)data;
+
+         RARCH_LOG("[Environ]: SET_AUDIO_BUFFER_STATUS_CALLBACK.\n");
+
+         if (info)
+            runloop_audio_buffer_status = *info;
+         else
+            runloop_audio_buffer_status.callback = NULL;
+         break;
+      }
+
       case RETRO_ENVIRONMENT_GET_RUMBLE_INTERFACE:
       {
          struct retro_rumble_interface *iface =
@@ -10349,6 +11136,8 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
             vfs_iface_info->required_interface_version = supported_vfs_version;
             vfs_iface_info->iface                      = &vfs_iface;
             system->supports_vfs = true;
+
+            retro_vfs_file_set_prefetch(settings->bools.vfs_prefetch_enable);
          }
          else
          {
@@ -10368,6 +11157,17 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
       }
       break;
 
+      case RETRO_ENVIRONMENT_GET_HOT_MEMORY_INTERFACE:
+      {
+         struct retro_hot_memory_interface *hot =
+            (struct retro_hot_memory_interface *)data;
+         if (!hot)
+            return false;
+         hot->alloc = memmap_alloc_hot;
+         hot->free  = memmap_free_hot;
+      }
+      break;
+
       case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE:
       {
          int result = 0;
@@ -10533,11 +11333,37 @@ static bool load_dynamic_core(const char *path, char *buf, size_t size)
     * saved to content history, and a relative path would
     * break in that scenario. */
    path_resolve_realpath(buf, size, true);
+
+   if (lib_handle_warm)
+   {
+      if (string_is_equal(lib_handle_warm_path, path))
+      {
+         RARCH_LOG("[Core]: Warm start, core was still loaded.\n");
+         lib_handle      = lib_handle_warm;
+         lib_handle_warm = NULL;
+         strlcpy(lib_handle_path, path, sizeof(lib_handle_path));
+         return true;
+      }
+
+      dylib_close(lib_handle_warm);
+      lib_handle_warm = NULL;
+   }
+
    if ((lib_handle = dylib_load(path)))
+   {
+      strlcpy(lib_handle_path, path, sizeof(lib_handle_path));
       return true;
+   }
    return false;
 }
 
+static void libretro_free_warm_core(void)
+{
+   if (lib_handle_warm)
+      dylib_close(lib_handle_warm);
+   lib_handle_warm = NULL;
+}
+
 static dylib_t libretro_get_system_info_lib(const char *path,
       struct retro_system_info *info, bool *load_no_content)
 {
@@ -10718,11 +11544,14 @@ static bool init_libretro_symbols_custom(enum rarch_core_type type,
                 * primary library loaded, so we can skip
                 * some checks and just load the library */
                retro_assert(lib_path != NULL && lib_handle_p != NULL);
-               lib_handle_local = dylib_load(lib_path);
+               /* Unless it's loaded already */
+               if (!*lib_handle_p)
+                  *lib_handle_p = dylib_load(lib_path);
+
+               lib_handle_local = *lib_handle_p;
 
                if (!lib_handle_local)
                   return false;
-               *lib_handle_p = lib_handle_local;
             }
 #endif
 #endif
@@ -10811,7 +11640,21 @@ static void uninit_libretro_symbols(struct retro_core_t *current_core)
 {
 #ifdef HAVE_DYNAMIC
    if (lib_handle)
-      dylib_close(lib_handle);
+   {
+      settings_t *settings = configuration_settings;
+
+      /* Its static data isn't reinitialized, so this is only for
+       * cores whose retro_init sets everything up again */
+      if (settings && settings->bools.core_warm_start)
+      {
+         libretro_free_warm_core();
+         lib_handle_warm = lib_handle;
+         strlcpy(lib_handle_warm_path, lib_handle_path,
+               sizeof(lib_handle_warm_path));
+      }
+      else
+         dylib_close(lib_handle);
+   }
    lib_handle = NULL;
 #endif
 
@@ -10950,7 +11793,7 @@ static void secondary_core_destroy(void)
 
    dylib_close(secondary_module);
    secondary_module = NULL;
-   filestream_delete(secondary_library_path);
+   /* The copy is kept for next time */
    if (secondary_library_path)
       free(secondary_library_path);
    secondary_library_path = NULL;
@@ -11079,16 +11922,53 @@ static bool write_file_with_random_name(char **temp_dll_path,
    return okay;
 }
 
+/* Deletes the copies of other builds of the core named @name */
+static void delete_stale_core_copies(const char *retroarch_temp_path,
+      const char *name, const char *keep_path)
+{
+   size_t i;
+   size_t name_len           = strlen(name);
+   struct string_list *files = dir_list_new(retroarch_temp_path,
+         NULL, false, false, false, false);
+
+   if (!files)
+      return;
+
+   for (i = 0; i < files->size; i++)
+   {
+      const char *file_path = files->elems[i].data;
+      const char *base_name = path_basename(file_path);
+
+      if (     !string_is_equal(file_path, keep_path)
+            && !strncmp(base_name, name, name_len)
+            && base_name[name_len] == '.')
+         filestream_delete(file_path);
+   }
+
+   string_list_free(files);
+}
+
+/* A library can't be loaded twice from the same path, so the
+ * secondary core is a copy. The copy is named after the core's
+ * size and modification time (its CRC32 where there's no stat()),
+ * made once per build of the core and reused after. */
 static char *copy_core_to_temp_file(void)
 {
+   char key[64];
+   char name[PATH_MAX_LENGTH];
    bool failed                = false;
    char *temp_directory       = NULL;
    char *retroarch_temp_path  = NULL;
    char *temp_dll_path        = NULL;
+   char *new_dll_path         = NULL;
    void *dll_file_data        = NULL;
    int64_t dll_file_size      = 0;
    const char *core_path      = path_get(RARCH_PATH_CORE);
    const char *core_base_name = path_basename(core_path);
+   const char *ext            = NULL;
+#ifdef HAVE_SECONDARY_CORE_STAT
+   struct stat st;
+#endif
 
    if (strlen(core_base_name) == 0)
       return NULL;
@@ -11109,28 +11989,77 @@ static char *copy_core_to_temp_file(void)
       goto end;
    }
 
+#ifdef HAVE_SECONDARY_CORE_STAT
+   if (stat(core_path, &st) != 0)
+   {
+      failed = true;
+      goto end;
+   }
+
+   snprintf(key, sizeof(key), "%lx-%lx",
+         (unsigned long)st.st_size, (unsigned long)st.st_mtime);
+#else
    if (!filestream_read_file(core_path, &dll_file_data, &dll_file_size))
    {
       failed = true;
       goto end;
    }
 
+   snprintf(key, sizeof(key), "%08lx", (unsigned long)encoding_crc32(0,
+            (const uint8_t*)dll_file_data, (size_t)dll_file_size));
+#endif
+
+   strlcpy(name, core_base_name, sizeof(name));
+   path_remove_extension(name);
+   ext = path_get_extension(core_base_name);
+
    strcat_alloc(&temp_dll_path, retroarch_temp_path);
-   strcat_alloc(&temp_dll_path, core_base_name);
+   strcat_alloc(&temp_dll_path, name);
+   strcat_alloc(&temp_dll_path, ".");
+   strcat_alloc(&temp_dll_path, key);
+   if (!string_is_empty(ext))
+   {
+      strcat_alloc(&temp_dll_path, ".");
+      strcat_alloc(&temp_dll_path, ext);
+   }
+
+   if (filestream_exists(temp_dll_path))
+      goto end;
+
+   if (!dll_file_data &&
+         !filestream_read_file(core_path, &dll_file_data, &dll_file_size))
+   {
+      failed = true;
+      goto end;
+   }
+
+   /* Written under another name first, so that a copy cut short
+    * is never taken for a whole one */
+   new_dll_path = strcpy_alloc_force(temp_dll_path);
+
+   if (!write_file_with_random_name(&new_dll_path,
+            retroarch_temp_path, dll_file_data, dll_file_size))
+   {
+      failed = true;
+      goto end;
+   }
 
-   if (!filestream_write_file(temp_dll_path, dll_file_data, dll_file_size))
+   if (filestream_rename(new_dll_path, temp_dll_path) != 0)
    {
-      /* try other file names */
-      if (!write_file_with_random_name(&temp_dll_path,
-               retroarch_temp_path, dll_file_data, dll_file_size))
-         failed = true;
+      filestream_delete(new_dll_path);
+      failed = true;
+      goto end;
    }
 
+   delete_stale_core_copies(retroarch_temp_path, name, temp_dll_path);
+
 end:
    if (temp_directory)
       free(temp_directory);
    if (retroarch_temp_path)
       free(retroarch_temp_path);
+   if (new_dll_path)
+      free(new_dll_path);
    if (dll_file_data)
       free(dll_file_data);
 
@@ -11149,6 +12078,21 @@ end:
    return NULL;
 }
 
+/* Loads the core a second time without a copy where the dynamic
+ * linker can: into a link map namespace of its own, the same
+ * file gets globals of its own. NULL if it can't. */
+static dylib_t secondary_core_load_namespace(void)
+{
+#if defined(__GLIBC__) && defined(LM_ID_NEWLM)
+   const char *core_path = path_get(RARCH_PATH_CORE);
+
+   if (!string_is_empty(core_path))
+      return (dylib_t)dlmopen(LM_ID_NEWLM, core_path,
+            RTLD_LAZY | RTLD_LOCAL);
+#endif
+   return NULL;
+}
+
 static bool rarch_environment_secondary_core_hook(unsigned cmd, void *data)
 {
    bool result = rarch_environment_cb(cmd, data);
@@ -11181,7 +12125,14 @@ static bool secondary_core_create(void)
    if (secondary_library_path)
       free(secondary_library_path);
    secondary_library_path = NULL;
-   secondary_library_path = copy_core_to_temp_file();
+
+   /* Else, or once the linker is out of namespaces, a copy */
+   secondary_module       = secondary_core_load_namespace();
+
+   if (secondary_module)
+      secondary_library_path = strcpy_alloc_force(path_get(RARCH_PATH_CORE));
+   else
+      secondary_library_path = copy_core_to_temp_file();
 
    if (!secondary_library_path)
       return false;
@@ -11748,6 +12699,8 @@ static void recording_driver_free_state(void)
    /* TODO/FIXME - this is not being called anywhere */
    recording_gpu_width      = 0;
    recording_gpu_height     = 0;
+   recording_gpu_nv12_width  = 0;
+   recording_gpu_nv12_height = 0;
    recording_width          = 0;
    recording_height         = 0;
 }
@@ -11831,6 +12784,21 @@ static void recording_dump_frame(const void *data, unsigned width,
          return;
       }
 
+      /* Scaled and converted by the GPU, a third of the size */
+      if (recording_gpu_nv12_width)
+      {
+         if (!video_driver_read_viewport_nv12(video_driver_record_gpu_buffer))
+            return;
+
+         ffemu_data.pitch  = (int)recording_gpu_nv12_width;
+         ffemu_data.width  = recording_gpu_nv12_width;
+         ffemu_data.height = recording_gpu_nv12_height;
+         ffemu_data.data   = video_driver_record_gpu_buffer;
+
+         recording_driver->push_video(recording_data, &ffemu_data);
+         return;
+      }
+
       /* Big bottleneck.
        * Since we might need to do read-backs asynchronously,
        * it might take 3-4 times before this returns true. */
@@ -11894,10 +12862,36 @@ static bool video_driver_gpu_record_init(unsigned size)
 
 static void video_driver_gpu_record_deinit(void)
 {
+   if (recording_gpu_nv12_width)
+      video_driver_set_record_nv12(0, 0);
+   recording_gpu_nv12_width  = 0;
+   recording_gpu_nv12_height = 0;
+
    free(video_driver_record_gpu_buffer);
    video_driver_record_gpu_buffer = NULL;
 }
 
+static bool recording_preset_is_yuv420(enum record_config_type preset)
+{
+   switch (preset)
+   {
+      case RECORD_CONFIG_TYPE_RECORDING_LOW_QUALITY:
+      case RECORD_CONFIG_TYPE_RECORDING_MED_QUALITY:
+      case RECORD_CONFIG_TYPE_RECORDING_HIGH_QUALITY:
+      case RECORD_CONFIG_TYPE_RECORDING_WEBM_FAST:
+      case RECORD_CONFIG_TYPE_RECORDING_WEBM_HIGH_QUALITY:
+      case RECORD_CONFIG_TYPE_STREAMING_LOW_QUALITY:
+      case RECORD_CONFIG_TYPE_STREAMING_MED_QUALITY:
+      case RECORD_CONFIG_TYPE_STREAMING_HIGH_QUALITY:
+      case RECORD_CONFIG_TYPE_STREAMING_NETPLAY:
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+
 /**
  * recording_init:
  *
@@ -12053,6 +13047,43 @@ static bool recording_init(void)
             vp.width, vp.height);
 
       gpu_size = vp.width * vp.height * 3;
+
+      /* Presets that encode to YUV 4:2:0 can have the GPU scale and
+       * convert the output, reading back a third of the data. */
+      if (recording_preset_is_yuv420(params.preset))
+      {
+         unsigned width  = vp.width;
+         unsigned height = vp.height;
+
+         /* Only ever scaled down, to the size asked for */
+         if (recording_width && recording_height
+               && recording_width  <= vp.width
+               && recording_height <= vp.height)
+         {
+            width  = recording_width;
+            height = recording_height;
+         }
+
+         width  &= ~3;
+         height &= ~1;
+
+         if (width && height && video_driver_set_record_nv12(width, height))
+         {
+            recording_gpu_nv12_width  = width;
+            recording_gpu_nv12_height = height;
+
+            params.out_width  = width;
+            params.out_height = height;
+            params.fb_width   = width;
+            params.fb_height  = height;
+            params.pix_fmt    = FFEMU_PIX_NV12;
+            gpu_size          = width * height * 3 / 2;
+
+            RARCH_LOG("[recording] Reading back NV12 scaled by the GPU to %u x %u.\n",
+                  width, height);
+         }
+      }
+
       if (!video_driver_gpu_record_init(gpu_size))
          return false;
    }
@@ -12727,6 +13758,7 @@ static void input_overlay_set_vertex_geom(input_overlay_t *ol)
 
          ol->iface->vertex_geom(ol->iface_data, desc->image_index,
                desc->mod_x, desc->mod_y, desc->mod_w, desc->mod_h);
+         desc->moved = false;
       }
 }
 
@@ -12766,6 +13798,9 @@ void input_overlay_free_overlay(struct overlay *overlay)
    if (overlay->descs)
       free(overlay->descs);
    overlay->descs       = NULL;
+   if (overlay->grid)
+      free(overlay->grid);
+   overlay->grid        = NULL;
    image_texture_free(&overlay->image);
 
    if (overlay_ptr)
@@ -12823,6 +13858,10 @@ static void input_overlay_set_alpha_mod(input_overlay_t *ol, float mod)
       else
           ol->iface->set_alpha(ol->iface_data, i, mod);
    }
+
+   ol->alpha_mod     = mod;
+   ol->alpha_dirty   = false;
+   ol->alpha_pressed = false;
 }
 
 
@@ -12972,7 +14011,8 @@ static void input_overlay_poll(
       input_overlay_state_t *out,
       int16_t norm_x, int16_t norm_y)
 {
-   size_t i;
+   size_t i, first, last;
+   const unsigned *grid      = NULL;
 
    /* norm_x and norm_y is in [-0x7fff, 0x7fff] range,
     * like RETRO_DEVICE_POINTER. */
@@ -12984,10 +14024,22 @@ static void input_overlay_poll(
    x /= ol->active->mod_w;
    y /= ol->active->mod_h;
 
-   for (i = 0; i < ol->active->size; i++)
+   /* Only the descs of the cell pressed can be hit */
+   first = 0;
+   last  = ol->active->size;
+   if (ol->active->grid)
+   {
+      unsigned c = OVERLAY_GRID_CELL(y) * OVERLAY_GRID_SIZE
+         + OVERLAY_GRID_CELL(x);
+      grid      = ol->active->grid;
+      first     = ol->active->grid_offsets[c];
+      last      = ol->active->grid_offsets[c + 1];
+   }
+
+   for (i = first; i < last; i++)
    {
       float x_dist, y_dist;
-      struct overlay_desc *desc = &ol->active->descs[i];
+      struct overlay_desc *desc = &ol->active->descs[grid ? grid[i] : i];
 
       if (!inside_hitbox(desc, x, y))
          continue;
@@ -13059,11 +14111,16 @@ static void input_overlay_update_desc_geom(input_overlay_t *ol,
    if (!desc->image.pixels || !desc->movable)
       return;
 
+   /* Still where it was drawn */
+   if (!desc->moved && !desc->delta_x && !desc->delta_y)
+      return;
+
    if (ol->iface->vertex_geom)
       ol->iface->vertex_geom(ol->iface_data, desc->image_index,
             desc->mod_x + desc->delta_x, desc->mod_y + desc->delta_y,
             desc->mod_w, desc->mod_h);
 
+   desc->moved   = desc->delta_x || desc->delta_y;
    desc->delta_x = 0.0f;
    desc->delta_y = 0.0f;
 }
@@ -13078,8 +14135,22 @@ static void input_overlay_update_desc_geom(input_overlay_t *ol,
 static void input_overlay_post_poll(input_overlay_t *ol, float opacity)
 {
    size_t i;
+   bool pressed = false;
 
-   input_overlay_set_alpha_mod(ol, opacity);
+   for (i = 0; i < ol->active->size; i++)
+   {
+      if (ol->active->descs[i].updated && ol->active->descs[i].image.pixels)
+      {
+         pressed = true;
+         break;
+      }
+   }
+
+   /* Only go over the alpha of every image if a press changed it */
+   if (pressed || ol->alpha_pressed || ol->alpha_dirty
+         || opacity != ol->alpha_mod)
+      input_overlay_set_alpha_mod(ol, opacity);
+   ol->alpha_pressed = pressed;
 
    for (i = 0; i < ol->active->size; i++)
    {
@@ -13120,7 +14191,8 @@ static void input_overlay_poll_clear(input_overlay_t *ol, float opacity)
 
    ol->blocked = false;
 
-   input_overlay_set_alpha_mod(ol, opacity);
+   if (ol->alpha_pressed || ol->alpha_dirty || opacity != ol->alpha_mod)
+      input_overlay_set_alpha_mod(ol, opacity);
 
    for (i = 0; i < ol->active->size; i++)
    {
@@ -13248,6 +14320,7 @@ void input_overlay_set_visibility(int overlay_idx,
 
     if (!ol)
        return;
+    ol->alpha_dirty = true;
     if (vis == OVERLAY_VISIBILITY_HIDDEN)
       ol->iface->set_alpha(ol->iface_data, overlay_idx, 0.0);
 }
@@ -13680,22 +14753,22 @@ float input_sensor_get_input(unsigned port, unsigned id)
    return 0.0f;
 }
 
-/**
- * input_poll:
- *
- * Input polling callback function.
- **/
-static void input_driver_poll(void)
+/* Reads the devices again without starting a new frame,
+ * for cores polling more than once in the frame. */
+static void input_driver_repoll(void)
 {
    size_t i;
    rarch_joypad_info_t joypad_info[MAX_USERS];
    settings_t *settings           = configuration_settings;
    uint8_t max_users              = (uint8_t)input_driver_max_users;
    input_bits_t current_inputs[MAX_USERS];
+   retro_time_t trace_start       = rarch_trace_begin();
 
    current_input->poll(current_input_data);
+   input_driver_joypad_buttons_valid = 0;
 
-   input_driver_turbo_btns.count++;
+   rarch_trace_end("Input poll", trace_start);
+   latency_test_poll();
 
    for (i = 0; i < max_users; i++)
       input_driver_turbo_btns.frame_enable[i] = 0;
@@ -13730,10 +14803,16 @@ static void input_driver_poll(void)
 #endif
    if (settings->bools.input_remap_binds_enable && input_driver_mapper)
    {
+      input_mapper_update(input_driver_mapper, settings, max_users);
+
       for (i = 0; i < max_users; i++)
       {
          unsigned device = settings->uints.input_libretro_device[i] & RETRO_DEVICE_MASK;
 
+         /* The mapper has nothing to do with this port's input */
+         if (!input_mapper_port_remapped(input_driver_mapper, i))
+            continue;
+
          switch (device)
          {
             case RETRO_DEVICE_KEYBOARD:
@@ -13864,6 +14943,21 @@ static void input_driver_poll(void)
 #endif
 }
 
+/**
+ * input_poll:
+ *
+ * Input polling callback function.
+ **/
+static void input_driver_poll(void)
+{
+   retro_time_t pacing_start = video_driver_frame_pacing_begin();
+
+   input_driver_turbo_btns.count++;
+   input_driver_repoll();
+
+   video_driver_frame_pacing_add(FRAME_PACING_INPUT, pacing_start);
+}
+
 static int16_t input_state_device(
       int16_t ret,
       unsigned port, unsigned device,
@@ -14229,6 +15323,43 @@ static int16_t input_state_device(
    return res;
 }
 
+/**
+ * input_state_joypad_buttons:
+ * @joypad_info          : joypad of the user.
+ * @port                 : user number.
+ *
+ * Asks the input driver for all joypad buttons of @port at
+ * once the first time after a poll and runs them through
+ * remapping and turbo. Every other query of the poll, be it
+ * for the mask or a single button, is served from that.
+ *
+ * Returns: the buttons of @port, as RETRO_DEVICE_ID_JOYPAD_MASK.
+ **/
+static int16_t input_state_joypad_buttons(
+      rarch_joypad_info_t joypad_info, unsigned port)
+{
+   unsigned i;
+   int16_t ret;
+   int16_t buttons = 0;
+
+   if (input_driver_joypad_buttons_valid & (1 << port))
+      return input_driver_joypad_buttons[port];
+
+   ret = current_input->input_state(
+         current_input_data, joypad_info,
+         libretro_input_binds, port, RETRO_DEVICE_JOYPAD, 0,
+         RETRO_DEVICE_ID_JOYPAD_MASK);
+
+   for (i = 0; i < RARCH_FIRST_CUSTOM_BIND; i++)
+      if (input_state_device(ret, port, RETRO_DEVICE_JOYPAD, 0, i, true))
+         buttons |= (1 << i);
+
+   input_driver_joypad_buttons[port]  = buttons;
+   input_driver_joypad_buttons_valid |= (1 << port);
+
+   return buttons;
+}
+
 /**
  * input_state:
  * @port                 : user number.
@@ -14260,25 +15391,30 @@ static int16_t input_state(unsigned port, unsigned device,
    }
 
    device &= RETRO_DEVICE_MASK;
-   ret     = current_input->input_state(
-         current_input_data, joypad_info,
-         libretro_input_binds, port, device, idx, id);
 
-   if (     !input_driver_flushing_input
-         && !input_driver_block_libretro_input)
+   if (     (device == RETRO_DEVICE_JOYPAD)
+         && (id == RETRO_DEVICE_ID_JOYPAD_MASK || id < RARCH_FIRST_CUSTOM_BIND)
+         && port < MAX_USERS)
    {
-      if (  (device == RETRO_DEVICE_JOYPAD) &&
-            (id == RETRO_DEVICE_ID_JOYPAD_MASK))
+      if (     !input_driver_flushing_input
+            && !input_driver_block_libretro_input)
       {
-         unsigned i;
+         int16_t buttons = input_state_joypad_buttons(joypad_info, port);
 
-         {
-            for (i = 0; i < RARCH_FIRST_CUSTOM_BIND; i++)
-               if (input_state_device(ret, port, device, idx, i, true))
-                  result |= (1 << i);
-         }
+         if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+            result = buttons;
+         else
+            result = (buttons >> id) & 1;
       }
-      else
+   }
+   else
+   {
+      ret = current_input->input_state(
+            current_input_data, joypad_info,
+            libretro_input_binds, port, device, idx, id);
+
+      if (     !input_driver_flushing_input
+            && !input_driver_block_libretro_input)
          result = input_state_device(ret, port, device, idx, id, false);
    }
 
@@ -14291,6 +15427,65 @@ static int16_t input_state(unsigned port, unsigned device,
    return result;
 }
 
+/**
+ * input_keys_pressed_hotkeys:
+ * @joypad_info                    : Joypad of the user.
+ * @binds                          : Binds of all users.
+ * @port                           : User whose hotkeys to check.
+ * @p_new_state                    : Set to the held hotkeys.
+ *
+ * Checks the hotkeys of a user. Most of them are bound to nothing
+ * and are skipped, and the ones bound only to a joypad button are
+ * asked of the joypad driver directly. Only the rest need the input
+ * driver, which looks at the keyboard, mouse and axes too.
+ **/
+static void input_keys_pressed_hotkeys(rarch_joypad_info_t joypad_info,
+      const struct retro_keybind **binds, unsigned port,
+      input_bits_t *p_new_state)
+{
+   unsigned i;
+   const input_device_driver_t *joypad = input_driver_get_joypad_driver();
+
+   /* With two joypad drivers, buttons can be on either */
+   if (input_driver_get_sec_joypad_driver())
+      joypad                           = NULL;
+
+   for (i = RARCH_FIRST_META_KEY; i < RARCH_BIND_LIST_END; i++)
+   {
+      uint16_t joykey;
+      uint32_t joyaxis;
+      const struct retro_keybind *bind = &binds[port][i];
+
+      if (!bind->valid)
+         continue;
+
+      /* Auto-binds are per joypad, not per user. */
+      joykey  = (bind->joykey != NO_BTN)
+         ? bind->joykey  : joypad_info.auto_binds[i].joykey;
+      joyaxis = (bind->joyaxis != AXIS_NONE)
+         ? bind->joyaxis : joypad_info.auto_binds[i].joyaxis;
+
+      if (     bind->key     == RETROK_UNKNOWN
+            && bind->mbutton == NO_BTN
+            && joyaxis       == AXIS_NONE)
+      {
+         if (joykey == NO_BTN)
+            continue;
+
+         if (joypad)
+         {
+            if (joypad->button(joypad_info.joy_idx, joykey))
+               BIT256_SET_PTR(p_new_state, i);
+            continue;
+         }
+      }
+
+      if (current_input->input_state(current_input_data, joypad_info,
+               binds, port, RETRO_DEVICE_JOYPAD, 0, i))
+         BIT256_SET_PTR(p_new_state, i);
+   }
+}
+
 static INLINE bool input_keys_pressed_other_sources(unsigned i,
       input_bits_t* p_new_state)
 {
@@ -15870,31 +17065,21 @@ static void input_menu_keys_pressed(input_bits_t *p_new_state,
       }
 
       /* Check the hotkeys */
-      for (i = RARCH_FIRST_META_KEY; i < RARCH_BIND_LIST_END; i++)
+      if (!input_driver_block_hotkey)
       {
-         bool bit_pressed    = false;
-
-         if (!input_driver_block_hotkey)
+         for (port = 0; port < port_max; port++)
          {
-            for (port = 0; port < port_max; port++)
-            {
-               const struct retro_keybind *mtkey = &input_config_binds[port][i];
-               if (!mtkey->valid)
-                  continue;
-               joypad_info.joy_idx               = settings->uints.input_joypad_map[port];
-               joypad_info.auto_binds            = input_autoconf_binds[joypad_info.joy_idx];
-               joypad_info.axis_threshold        = input_driver_axis_threshold;
+            joypad_info.joy_idx            = settings->uints.input_joypad_map[port];
+            joypad_info.auto_binds         = input_autoconf_binds[joypad_info.joy_idx];
+            joypad_info.axis_threshold     = input_driver_axis_threshold;
 
-               if (current_input->input_state(current_input_data, joypad_info,
-                  &binds[0], port, RETRO_DEVICE_JOYPAD, 0, i))
-               {
-                  bit_pressed = true;
-                  break;
-               }
-            }
+            input_keys_pressed_hotkeys(joypad_info, &binds[0], port, p_new_state);
          }
+      }
 
-         if (bit_pressed || BIT64_GET(lifecycle_state, i) || input_keys_pressed_other_sources(i, p_new_state))
+      for (i = RARCH_FIRST_META_KEY; i < RARCH_BIND_LIST_END; i++)
+      {
+         if (BIT64_GET(lifecycle_state, i) || input_keys_pressed_other_sources(i, p_new_state))
          {
             BIT256_SET_PTR(p_new_state, i);
          }
@@ -16036,13 +17221,12 @@ static void input_keys_pressed(input_bits_t *p_new_state)
    }
 
    /* Check the hotkeys */
+   if (!input_driver_block_hotkey)
+      input_keys_pressed_hotkeys(joypad_info, &binds, 0, p_new_state);
+
    for (i = RARCH_FIRST_META_KEY; i < RARCH_BIND_LIST_END; i++)
    {
-      bool bit_pressed = !input_driver_block_hotkey && binds[i].valid
-         && current_input->input_state(current_input_data, joypad_info,
-               &binds, 0, RETRO_DEVICE_JOYPAD, 0, i);
-      if (     bit_pressed
-            || BIT64_GET(lifecycle_state, i)
+      if (     BIT64_GET(lifecycle_state, i)
             || input_keys_pressed_other_sources(i, p_new_state))
       {
          BIT256_SET_PTR(p_new_state, i);
@@ -18499,6 +19683,8 @@ static void audio_mixer_play_stop_cb(
       audio_mixer_sound_t *sound, unsigned reason);
 static void audio_mixer_menu_stop_cb(
       audio_mixer_sound_t *sound, unsigned reason);
+static void audio_driver_mixer_play_stream_internal(
+      unsigned i, unsigned type);
 #endif
 
 static enum resampler_quality audio_driver_get_resampler_quality(void)
@@ -18528,6 +19714,32 @@ const char *audio_driver_mixer_get_stream_name(unsigned i)
    return "N/A";
 }
 
+/* audio_mixer_active stays set once a stream was ever
+ * played, this tells whether one is playing right now. */
+static bool audio_driver_mixer_playing(void)
+{
+   unsigned i;
+
+   if (!audio_mixer_active)
+      return false;
+
+   for (i = 0; i < AUDIO_MIXER_MAX_SYSTEM_STREAMS; i++)
+   {
+      switch (audio_mixer_streams[i].state)
+      {
+         case AUDIO_STREAM_STATE_PLAYING:
+         case AUDIO_STREAM_STATE_PLAYING_LOOPED:
+         case AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL:
+            return true;
+         case AUDIO_STREAM_STATE_STOPPED:
+         case AUDIO_STREAM_STATE_NONE:
+            break;
+      }
+   }
+
+   return false;
+}
+
 static void audio_driver_mixer_deinit(void)
 {
    unsigned i;
@@ -18611,6 +19823,27 @@ static bool audio_compute_buffer_statistics(audio_statistics_t *stats)
    stats->close_to_underrun      = (100.0 * low_water_count)  / (samples - 1);
    stats->close_to_blocking      = (100.0 * high_water_count) / (samples - 1);
 
+   {
+      float adjust_accum = 0.0f;
+      float adjust_min   = audio_driver_ratio_adjust_buf[1];
+      float adjust_max   = audio_driver_ratio_adjust_buf[1];
+
+      for (i = 1; i < samples; i++)
+      {
+         float adjust  = audio_driver_ratio_adjust_buf[i];
+         adjust_accum += adjust;
+         adjust_min    = MIN(adjust_min, adjust);
+         adjust_max    = MAX(adjust_max, adjust);
+      }
+
+      stats->ratio_adjust_avg    = 100.0f * adjust_accum / (samples - 1);
+      stats->ratio_adjust_min    = 100.0f * adjust_min;
+      stats->ratio_adjust_max    = 100.0f * adjust_max;
+   }
+
+   stats->underruns              = audio_driver_underruns;
+   stats->overruns               = audio_driver_overruns;
+
    return true;
 }
 
@@ -18624,11 +19857,18 @@ static void report_audio_buffer_statistics(void)
    RARCH_LOG("[Audio]: Average audio buffer saturation: %.2f %%,"
          " standard deviation (percentage points): %.2f %%.\n"
          "[Audio]: Amount of time spent close to underrun: %.2f %%."
-         " Close to blocking: %.2f %%.\n",
+         " Close to blocking: %.2f %%.\n"
+         "[Audio]: Rate adjustment: %+.3f %% (%+.3f %% .. %+.3f %%)."
+         " Underruns: %u, overruns: %u.\n",
          audio_stats.average_buffer_saturation,
          audio_stats.std_deviation_percentage,
          audio_stats.close_to_underrun,
-         audio_stats.close_to_blocking);
+         audio_stats.close_to_blocking,
+         audio_stats.ratio_adjust_avg,
+         audio_stats.ratio_adjust_min,
+         audio_stats.ratio_adjust_max,
+         audio_stats.underruns,
+         audio_stats.overruns);
 #endif
 }
 
@@ -18680,13 +19920,15 @@ static bool audio_driver_deinit_internal(void)
    }
 
    if (audio_driver_output_samples_conv_buf)
-      free(audio_driver_output_samples_conv_buf);
-   audio_driver_output_samples_conv_buf = NULL;
+      memory_usage_free(MEMORY_USAGE_AUDIO,
+            audio_driver_output_samples_conv_buf);
+   audio_driver_output_samples_conv_buf  = NULL;
+   audio_driver_output_samples_flush_buf = NULL;
 
    audio_driver_data_ptr                = 0;
 
    if (audio_driver_rewind_buf)
-      free(audio_driver_rewind_buf);
+      memory_usage_free(MEMORY_USAGE_AUDIO, audio_driver_rewind_buf);
    audio_driver_rewind_buf   = NULL;
 
    audio_driver_rewind_size  = 0;
@@ -18700,13 +19942,26 @@ static bool audio_driver_deinit_internal(void)
    audio_driver_deinit_resampler();
 
    if (audio_driver_input_data)
-      free(audio_driver_input_data);
+      memory_usage_free(MEMORY_USAGE_AUDIO, audio_driver_input_data);
    audio_driver_input_data = NULL;
 
    if (audio_driver_output_samples_buf)
-      free(audio_driver_output_samples_buf);
+      memory_usage_add(MEMORY_USAGE_AUDIO,
+            -(int64_t)(audio_driver_output_samples_max * sizeof(float)));
+   memmap_free_hot(audio_driver_output_samples_buf,
+         audio_driver_output_samples_max * sizeof(float));
    audio_driver_output_samples_buf = NULL;
 
+   audio_resampler_s16_free(audio_driver_resampler_s16);
+   audio_driver_resampler_s16 = NULL;
+
+   if (audio_driver_output_samples_s16_buf)
+      memory_usage_add(MEMORY_USAGE_AUDIO,
+            -(int64_t)(audio_driver_output_samples_max * sizeof(int16_t)));
+   memmap_free_hot(audio_driver_output_samples_s16_buf,
+         audio_driver_output_samples_max * sizeof(int16_t));
+   audio_driver_output_samples_s16_buf = NULL;
+
    audio_driver_dsp_filter_free();
    report_audio_buffer_statistics();
 
@@ -18726,6 +19981,7 @@ static bool audio_driver_free_devices_list(void)
 
 static bool audio_driver_deinit(void)
 {
+   audio_driver_worker_deinit();
 #ifdef HAVE_AUDIOMIXER
    audio_driver_mixer_deinit();
 #endif
@@ -18775,6 +20031,7 @@ static bool audio_driver_find_driver(void)
 
 static bool audio_driver_init_internal(bool audio_cb_inited)
 {
+   unsigned i;
    unsigned new_rate     = 0;
    float   *aud_inp_data = NULL;
    float  *samples_buf   = NULL;
@@ -18784,8 +20041,8 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
    /* Accomodate rewind since at some point we might have two full buffers. */
    size_t outsamples_max = AUDIO_CHUNK_SIZE_NONBLOCKING * 2 * AUDIO_MAX_RATIO *
       settings->floats.slowmotion_ratio;
-   int16_t *conv_buf     = (int16_t*)malloc(outsamples_max
-         * sizeof(int16_t));
+   int16_t *conv_buf     = (int16_t*)memory_usage_malloc(
+         MEMORY_USAGE_AUDIO, outsamples_max * sizeof(int16_t));
 
    convert_s16_to_float_init_simd();
    convert_float_to_s16_init_simd();
@@ -18796,14 +20053,16 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
    if (!conv_buf)
       goto error;
 
-   audio_driver_output_samples_conv_buf = conv_buf;
+   audio_driver_output_samples_conv_buf  = conv_buf;
+   audio_driver_output_samples_flush_buf = conv_buf;
    audio_driver_chunk_block_size        = AUDIO_CHUNK_SIZE_BLOCKING;
    audio_driver_chunk_nonblock_size     = AUDIO_CHUNK_SIZE_NONBLOCKING;
    audio_driver_chunk_size              = audio_driver_chunk_block_size;
 
    /* Needs to be able to hold full content of a full max_bufsamples
     * in addition to its own. */
-   rewind_buf = (int16_t*)malloc(max_bufsamples * sizeof(int16_t));
+   rewind_buf = (int16_t*)memory_usage_malloc(MEMORY_USAGE_AUDIO,
+         max_bufsamples * sizeof(int16_t));
    retro_assert(rewind_buf != NULL);
 
    if (!rewind_buf)
@@ -18882,6 +20141,7 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
 
    audio_source_ratio_original   = audio_source_ratio_current =
       (double)settings->uints.audio_out_rate / audio_driver_input;
+   audio_driver_control_reset();
 
    if (!retro_resampler_realloc(
             &audio_driver_resampler_data,
@@ -18895,7 +20155,8 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
       audio_driver_active = false;
    }
 
-   aud_inp_data = (float*)malloc(max_bufsamples * sizeof(float));
+   aud_inp_data = (float*)memory_usage_malloc(MEMORY_USAGE_AUDIO,
+         max_bufsamples * sizeof(float));
    retro_assert(aud_inp_data != NULL);
 
    if (!aud_inp_data)
@@ -18907,16 +20168,38 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
    retro_assert(settings->uints.audio_out_rate <
          audio_driver_input * AUDIO_MAX_RATIO);
 
-   samples_buf = (float*)malloc(outsamples_max * sizeof(float));
+   audio_driver_output_samples_max = outsamples_max;
+   samples_buf = (float*)memmap_alloc_hot(outsamples_max * sizeof(float));
 
    retro_assert(samples_buf != NULL);
 
    if (!samples_buf)
       goto error;
 
+   memory_usage_add(MEMORY_USAGE_AUDIO,
+         (int64_t)(outsamples_max * sizeof(float)));
    audio_driver_output_samples_buf = (float*)samples_buf;
    audio_driver_control            = false;
 
+   if (     audio_driver_active
+         && settings->bools.audio_fixed_point
+         && !audio_driver_use_float)
+   {
+      audio_driver_resampler_s16          = audio_resampler_s16_new(
+            audio_source_ratio_original);
+      audio_driver_output_samples_s16_buf = (int16_t*)memmap_alloc_hot(
+            outsamples_max * sizeof(int16_t));
+
+      if (audio_driver_output_samples_s16_buf)
+         memory_usage_add(MEMORY_USAGE_AUDIO,
+               (int64_t)(outsamples_max * sizeof(int16_t)));
+
+      if (!audio_driver_resampler_s16 || !audio_driver_output_samples_s16_buf)
+         goto error;
+
+      RARCH_LOG("[Audio]: Using the fixed-point audio path.\n");
+   }
+
    if (
          !audio_cb_inited
          && audio_driver_active
@@ -18938,11 +20221,28 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
    command_event(CMD_EVENT_DSP_FILTER_INIT, NULL);
 
    audio_driver_free_samples_count = 0;
+   audio_driver_underruns          = 0;
+   audio_driver_overruns           = 0;
+
+   for (i = 0; i < AUDIO_DRIVER_STAGE_LAST; i++)
+   {
+      rarch_histogram_register(&audio_driver_stage_histograms[i],
+            audio_driver_stage_names[i]);
+      rarch_histogram_reset(&audio_driver_stage_histograms[i]);
+   }
+   rarch_histogram_reset(&audio_driver_latency_histogram);
 
 #ifdef HAVE_AUDIOMIXER
    audio_mixer_init(settings->uints.audio_out_rate);
 #endif
 
+   if (
+         !audio_cb_inited
+         && audio_driver_active
+         && settings->bools.audio_worker_thread
+         )
+      audio_driver_worker_init(outsamples_max);
+
    /* Threaded driver is initially stopped. */
    if (
          audio_driver_active
@@ -18956,6 +20256,251 @@ error:
    return audio_driver_deinit();
 }
 
+/**
+ * audio_driver_get_occupancy:
+ * @occupancy            : How full the audio buffer is, in percent.
+ *
+ * Returns: false if it can't be told, which takes audio
+ * rate control.
+ **/
+static bool audio_driver_get_occupancy(unsigned *occupancy)
+{
+   int avail;
+
+   if (     !audio_driver_active
+         || audio_suspended
+         || !audio_driver_control
+         || !audio_driver_buffer_size)
+      return false;
+
+   avail = (int)current_audio->write_avail(audio_driver_context_audio_data);
+
+#ifdef HAVE_AUDIO_WORKER
+   if (audio_worker.thread)
+      avail -= (int)audio_driver_worker_pending();
+#endif
+
+   if (avail < 0)
+      avail = 0;
+   if ((size_t)avail > audio_driver_buffer_size)
+      avail = (int)audio_driver_buffer_size;
+
+   *occupancy = 100 - (unsigned)(((size_t)avail * 100)
+         / audio_driver_buffer_size);
+   return true;
+}
+
+static void audio_driver_control_reset(void)
+{
+   audio_driver_latency          = -1;
+   audio_driver_latency_time     = 0;
+   audio_driver_control_queued   = -1.0;
+   audio_driver_control_integral = 0.0;
+   audio_driver_control_time     = 0;
+}
+
+/**
+ * audio_driver_control_queued_usec:
+ * @now                  : current time.
+ * @avail                : writable bytes of the driver's buffer.
+ * @pending              : bytes not written to the driver yet.
+ * @bytes_per_usec       : of the driver's output.
+ *
+ * Returns: the time until audio written now would be played,
+ * from the delay the driver measured after the last write where
+ * it reports one, else from the fill level of its buffer.
+ **/
+static double audio_driver_control_queued_usec(retro_time_t now,
+      int avail, int pending, double bytes_per_usec)
+{
+   double queued;
+
+   if (audio_driver_latency >= 0)
+   {
+      /* The device has played on since */
+      queued = (double)audio_driver_latency
+         - (double)(now - audio_driver_latency_time);
+      if (queued < 0.0)
+         queued = 0.0;
+   }
+   else
+      queued = ((double)audio_driver_buffer_size - avail) / bytes_per_usec;
+
+   return queued + pending / bytes_per_usec;
+}
+
+/**
+ * audio_driver_update_ratio:
+ * @is_slowmotion        : whether slow motion is active.
+ *
+ * Readjusts the resampling ratio if rate control is enabled.
+ * A PI controller steers the audio queued in the driver to
+ * audio_rate_control_target: the proportional term takes out
+ * quick deviations, the integral one the steady drift between
+ * the content's and the device's clocks, which a proportional
+ * term alone only balances with the queue off target.
+ *
+ * Returns: the resampling ratio to use for this batch.
+ **/
+static double audio_driver_update_ratio(bool is_slowmotion)
+{
+   double ratio;
+
+   if (audio_driver_control)
+   {
+      settings_t *settings = configuration_settings;
+      int      avail       =
+         (int)current_audio->write_avail(audio_driver_context_audio_data);
+      int      pending     = 0;
+      int      device_avail = avail;
+      double   max_delta   = audio_driver_rate_control_delta;
+      double   limit       = 1.0 / AUDIO_RATE_CONTROL_KI;
+      double   bytes_per_usec = (double)settings->uints.audio_out_rate * 2
+         * (audio_driver_use_float ? sizeof(float) : sizeof(int16_t))
+         / 1000000.0;
+      double   buffer_usec = audio_driver_buffer_size / bytes_per_usec;
+      retro_time_t now     = cpu_features_get_time_usec();
+      double   queued, target, error, adjust, dt;
+      unsigned write_idx   = audio_driver_free_samples_count++ &
+         (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
+
+#ifdef HAVE_AUDIO_WORKER
+      /* Audio still queued for the worker is as good
+       * as written to the driver. */
+      if (audio_worker.thread)
+      {
+         pending   = (int)audio_driver_worker_pending();
+         avail    -= pending;
+         if (avail < 0)
+            avail  = 0;
+      }
+#endif
+
+      target      = settings->uints.audio_rate_control_target
+         ? settings->uints.audio_rate_control_target * 1000.0
+         : buffer_usec / 2.0;
+      if (target > buffer_usec)
+         target   = buffer_usec;
+
+      queued      = audio_driver_control_queued_usec(now,
+            device_avail, pending, bytes_per_usec);
+
+      /* After a pause or the first time, start over */
+      dt          = audio_driver_control_time
+         ? (double)(now - audio_driver_control_time) : 0.0;
+      if (dt > 250000.0 || audio_driver_control_queued < 0.0)
+      {
+         audio_driver_control_queued = queued;
+         dt                          = 0.0;
+      }
+      else
+         audio_driver_control_queued += (dt
+               / (dt + AUDIO_RATE_CONTROL_SMOOTH_USEC))
+            * (queued - audio_driver_control_queued);
+      audio_driver_control_time = now;
+
+      /* Too much queued: fewer output frames for a while */
+      error = buffer_usec > 0.0
+         ? (target - audio_driver_control_queued) / (buffer_usec / 2.0)
+         : 0.0;
+
+      /* Anti-windup: the integral term alone never
+       * asks for more than the full delta */
+      audio_driver_control_integral += error * dt / 1000000.0;
+      if (audio_driver_control_integral > limit)
+         audio_driver_control_integral = limit;
+      else if (audio_driver_control_integral < -limit)
+         audio_driver_control_integral = -limit;
+
+      adjust = max_delta * (AUDIO_RATE_CONTROL_KP * error
+            + AUDIO_RATE_CONTROL_KI * audio_driver_control_integral);
+      if (adjust > max_delta)
+         adjust = max_delta;
+      else if (adjust < -max_delta)
+         adjust = -max_delta;
+
+      audio_driver_free_samples_buf
+         [write_idx]               = avail;
+      audio_driver_ratio_adjust_buf
+         [write_idx]               = (float)adjust;
+      audio_source_ratio_current   =
+         audio_source_ratio_original * (1.0 + adjust);
+   }
+
+   ratio       = audio_source_ratio_current;
+
+   if (is_slowmotion)
+      ratio   *= configuration_settings->floats.slowmotion_ratio;
+
+   return ratio;
+}
+
+/* Accounts the time since *start to the stage and
+ * restarts the clock for the next one. */
+static void audio_driver_stage_end(enum audio_driver_stage stage,
+      retro_time_t *start)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+   rarch_histogram_add(&audio_driver_stage_histograms[stage], now - *start);
+   *start           = now;
+}
+
+static void audio_driver_update_stats(void)
+{
+   audio_driver_stats_t stats;
+
+   if (!current_audio->get_stats
+         || !current_audio->get_stats(
+            audio_driver_context_audio_data, &stats))
+      return;
+
+   audio_driver_underruns    = stats.underruns;
+   audio_driver_overruns     = stats.overruns;
+   audio_driver_latency      = stats.latency;
+   audio_driver_latency_time = cpu_features_get_time_usec();
+   if (stats.latency >= 0)
+      rarch_histogram_add(&audio_driver_latency_histogram, stats.latency);
+}
+
+/**
+ * audio_driver_flush_s16:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ * @is_slowmotion        : whether slow motion is active.
+ * @volume_gain          : volume to apply.
+ *
+ * Integer counterpart of audio_driver_flush, for when
+ * there is neither a DSP filter nor the mixer to feed.
+ **/
+static void audio_driver_flush_s16(const int16_t *data, size_t samples,
+      bool is_slowmotion, float volume_gain)
+{
+   size_t output_frames;
+   double ratio             = audio_driver_update_ratio(is_slowmotion);
+   retro_time_t stage_start = cpu_features_get_time_usec();
+   retro_time_t trace_stage = rarch_trace_begin();
+
+   output_frames            = audio_resampler_s16_process(
+         audio_driver_resampler_s16,
+         audio_driver_output_samples_s16_buf,
+         data, samples >> 1, ratio);
+   rarch_trace_end("Resampler", trace_stage);
+
+   audio_resampler_s16_gain(audio_driver_output_samples_s16_buf,
+         output_frames * 2, volume_gain);
+   audio_driver_stage_end(AUDIO_DRIVER_STAGE_RESAMPLE, &stage_start);
+
+   trace_stage = rarch_trace_begin();
+   if (current_audio->write(audio_driver_context_audio_data,
+            audio_driver_output_samples_s16_buf,
+            output_frames * 2 * sizeof(int16_t)) < 0)
+      audio_driver_active = false;
+   rarch_trace_end("Audio write", trace_stage);
+   audio_driver_stage_end(AUDIO_DRIVER_STAGE_WRITE, &stage_start);
+
+   audio_driver_update_stats();
+}
+
 /**
  * audio_driver_flush:
  * @data                 : pointer to audio buffer.
@@ -18970,12 +20515,30 @@ static void audio_driver_flush(const int16_t *data, size_t samples,
    struct resampler_data src_data;
    float audio_volume_gain           = !audio_driver_mute_enable ?
       audio_driver_volume_gain : 0.0f;
+   retro_time_t trace_start          = rarch_trace_begin();
+   retro_time_t trace_stage          = 0;
+   retro_time_t stage_start          = 0;
 
    src_data.data_out                 = NULL;
    src_data.output_frames            = 0;
 
+   if (     audio_driver_resampler_s16
+         && !audio_driver_dsp
+#ifdef HAVE_AUDIOMIXER
+         && !audio_driver_mixer_playing()
+#endif
+      )
+   {
+      audio_driver_flush_s16(data, samples, is_slowmotion,
+            audio_volume_gain);
+      rarch_trace_end("Audio flush", trace_start);
+      return;
+   }
+
+   stage_start                       = cpu_features_get_time_usec();
    convert_s16_to_float(audio_driver_input_data, data, samples,
          audio_volume_gain);
+   audio_driver_stage_end(AUDIO_DRIVER_STAGE_CONVERT, &stage_start);
 
    src_data.data_in                  = audio_driver_input_data;
    src_data.input_frames             = samples >> 1;
@@ -18994,6 +20557,7 @@ static void audio_driver_flush(const int16_t *data, size_t samples,
       dsp_data.input_frames          = (unsigned)(samples >> 1);
 
       retro_dsp_filter_process(audio_driver_dsp, &dsp_data);
+      audio_driver_stage_end(AUDIO_DRIVER_STAGE_DSP, &stage_start);
 
       if (dsp_data.output)
       {
@@ -19004,41 +20568,13 @@ static void audio_driver_flush(const int16_t *data, size_t samples,
 
    src_data.data_out                 = audio_driver_output_samples_buf;
 
-   if (audio_driver_control)
-   {
-      /* Readjust the audio input rate. */
-      int      half_size   = (int)(audio_driver_buffer_size / 2);
-      int      avail       =
-         (int)current_audio->write_avail(audio_driver_context_audio_data);
-      int      delta_mid   = avail - half_size;
-      double   direction   = (double)delta_mid / half_size;
-      double   adjust      = 1.0 + audio_driver_rate_control_delta * direction;
-      unsigned write_idx   = audio_driver_free_samples_count++ &
-         (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
-
-      audio_driver_free_samples_buf
-         [write_idx]               = avail;
-      audio_source_ratio_current   =
-         audio_source_ratio_original * adjust;
-
-#if 0
-      if (verbosity_is_enabled())
-      {
-         RARCH_LOG_OUTPUT("[Audio]: Audio buffer is %u%% full\n",
-               (unsigned)(100 - (avail * 100) / audio_driver_buffer_size));
-         RARCH_LOG_OUTPUT("[Audio]: New rate: %lf, Orig rate: %lf\n",
-               audio_source_ratio_current,
-               audio_source_ratio_original);
-      }
-#endif
-   }
-
-   src_data.ratio           = audio_source_ratio_current;
-
-   if (is_slowmotion)
-      src_data.ratio       *= configuration_settings->floats.slowmotion_ratio;
+   src_data.ratio                    = audio_driver_update_ratio(is_slowmotion);
 
+   trace_stage = rarch_trace_begin();
+   stage_start = cpu_features_get_time_usec();
    audio_driver_resampler->process(audio_driver_resampler_data, &src_data);
+   audio_driver_stage_end(AUDIO_DRIVER_STAGE_RESAMPLE, &stage_start);
+   rarch_trace_end("Resampler", trace_stage);
 
 #ifdef HAVE_AUDIOMIXER
    /* TODO/FIXME - provide an int16_t codepath for audio_mixer_mix too 
@@ -19051,6 +20587,7 @@ static void audio_driver_flush(const int16_t *data, size_t samples,
          audio_driver_mixer_volume_gain : 0.0f;
       audio_mixer_mix(audio_driver_output_samples_buf,
             src_data.output_frames, mixer_gain, override);
+      audio_driver_stage_end(AUDIO_DRIVER_STAGE_MIX, &stage_start);
    }
 #endif
 
@@ -19062,17 +20599,253 @@ static void audio_driver_flush(const int16_t *data, size_t samples,
          output_frames  *= sizeof(float);
       else
       {
-         convert_float_to_s16(audio_driver_output_samples_conv_buf,
+         convert_float_to_s16(audio_driver_output_samples_flush_buf,
                (const float*)output_data, output_frames * 2);
 
-         output_data     = audio_driver_output_samples_conv_buf;
+         output_data     = audio_driver_output_samples_flush_buf;
          output_frames  *= sizeof(int16_t);
       }
 
+      trace_stage = rarch_trace_begin();
       if (current_audio->write(audio_driver_context_audio_data,
                output_data, output_frames * 2) < 0)
          audio_driver_active = false;
+      rarch_trace_end("Audio write", trace_stage);
+      /* Includes the conversion to the format of the driver. */
+      audio_driver_stage_end(AUDIO_DRIVER_STAGE_WRITE, &stage_start);
+   }
+
+   audio_driver_update_stats();
+
+   rarch_trace_end("Audio flush", trace_start);
+}
+
+#ifdef HAVE_AUDIO_WORKER
+static void audio_driver_worker_thread(void *data)
+{
+   audio_worker_t *worker = (audio_worker_t*)data;
+
+   for (;;)
+   {
+      unsigned idx;
+      unsigned read = worker->read;
+
+      if (AUDIO_WORKER_ATOMIC_LOAD(&worker->write) == read)
+      {
+         bool quit;
+
+         slock_lock(worker->cond_lock);
+         while (!worker->quit
+               && AUDIO_WORKER_ATOMIC_LOAD(&worker->write) == read)
+            scond_wait(worker->cond, worker->cond_lock);
+         quit = worker->quit;
+         slock_unlock(worker->cond_lock);
+
+         if (quit)
+            break;
+      }
+
+      idx = read & (AUDIO_WORKER_CHUNKS - 1);
+
+      if (audio_driver_active)
+         audio_driver_flush(worker->data[idx], worker->samples[idx],
+               worker->is_slowmotion[idx]);
+
+      AUDIO_WORKER_ATOMIC_STORE(&worker->read, read + 1);
+
+      slock_lock(worker->cond_lock);
+      scond_signal(worker->cond);
+      slock_unlock(worker->cond_lock);
+   }
+}
+
+/* Queues audio of the core for the worker. Like a blocking
+ * audio driver, waits while the queue is full, unless audio
+ * is nonblocking, in which case the audio is dropped. */
+static void audio_driver_worker_push(const int16_t *data, size_t samples,
+      bool is_slowmotion)
+{
+   audio_worker_t *worker = &audio_worker;
+
+   while (samples)
+   {
+      unsigned idx;
+      unsigned write = worker->write;
+      size_t size    = MIN(samples, AUDIO_WORKER_CHUNK_SAMPLES);
+
+      if (write - AUDIO_WORKER_ATOMIC_LOAD(&worker->read)
+            == AUDIO_WORKER_CHUNKS)
+      {
+         if (audio_driver_chunk_size == audio_driver_chunk_nonblock_size)
+            return;
+
+         slock_lock(worker->cond_lock);
+         while (write - AUDIO_WORKER_ATOMIC_LOAD(&worker->read)
+               == AUDIO_WORKER_CHUNKS)
+            scond_wait(worker->cond, worker->cond_lock);
+         slock_unlock(worker->cond_lock);
+      }
+
+      idx                        = write & (AUDIO_WORKER_CHUNKS - 1);
+      memcpy(worker->data[idx], data, size * sizeof(int16_t));
+      worker->samples[idx]       = size;
+      worker->is_slowmotion[idx] = is_slowmotion;
+
+      AUDIO_WORKER_ATOMIC_STORE(&worker->write, write + 1);
+
+      slock_lock(worker->cond_lock);
+      scond_signal(worker->cond);
+      slock_unlock(worker->cond_lock);
+
+      data    += size;
+      samples -= size;
+   }
+}
+
+/* Amount of bytes the audio queued behind the chunk being
+ * flushed will take up in the driver. Must only be called
+ * from the worker. */
+static size_t audio_driver_worker_pending(void)
+{
+   unsigned i;
+   size_t samples = 0;
+   unsigned write = AUDIO_WORKER_ATOMIC_LOAD(&audio_worker.write);
+
+   for (i = audio_worker.read + 1; (int)(write - i) > 0; i++)
+      samples += audio_worker.samples[i & (AUDIO_WORKER_CHUNKS - 1)];
+
+   return (size_t)(samples * audio_source_ratio_original) *
+      (audio_driver_use_float ? sizeof(float) : sizeof(int16_t));
+}
+#endif
+
+static bool audio_driver_worker_init(size_t outsamples_max)
+{
+#ifdef HAVE_AUDIO_WORKER
+   unsigned i;
+
+   audio_worker.conv_buf = (int16_t*)malloc(outsamples_max * sizeof(int16_t));
+   if (!audio_worker.conv_buf)
+      goto error;
+
+   for (i = 0; i < AUDIO_WORKER_CHUNKS; i++)
+   {
+      audio_worker.data[i] = (int16_t*)malloc(
+            AUDIO_WORKER_CHUNK_SAMPLES * sizeof(int16_t));
+      if (!audio_worker.data[i])
+         goto error;
+   }
+
+   audio_worker.read      = 0;
+   audio_worker.write     = 0;
+   audio_worker.quit      = false;
+   audio_worker.cond_lock = slock_new();
+   audio_worker.cond      = scond_new();
+
+   if (!audio_worker.cond_lock || !audio_worker.cond)
+      goto error;
+
+   audio_worker.thread    = sthread_create(
+         audio_driver_worker_thread, &audio_worker);
+
+   if (!audio_worker.thread)
+      goto error;
+
+   audio_driver_output_samples_flush_buf = audio_worker.conv_buf;
+
+   RARCH_LOG("[Audio]: Processing audio on a worker thread.\n");
+   return true;
+
+error:
+   RARCH_WARN("[Audio]: Failed to start the audio worker thread.\n");
+   audio_driver_worker_deinit();
+#endif
+   return false;
+}
+
+static void audio_driver_worker_deinit(void)
+{
+#ifdef HAVE_AUDIO_WORKER
+   unsigned i;
+
+   if (audio_worker.thread)
+   {
+      slock_lock(audio_worker.cond_lock);
+      audio_worker.quit = true;
+      scond_signal(audio_worker.cond);
+      slock_unlock(audio_worker.cond_lock);
+
+      sthread_join(audio_worker.thread);
    }
+   audio_worker.thread = NULL;
+
+   audio_driver_output_samples_flush_buf = audio_driver_output_samples_conv_buf;
+
+   if (audio_worker.conv_buf)
+      free(audio_worker.conv_buf);
+   audio_worker.conv_buf = NULL;
+
+   if (audio_worker.cond)
+      scond_free(audio_worker.cond);
+   audio_worker.cond = NULL;
+
+   if (audio_worker.cond_lock)
+      slock_free(audio_worker.cond_lock);
+   audio_worker.cond_lock = NULL;
+
+   for (i = 0; i < AUDIO_WORKER_CHUNKS; i++)
+   {
+      if (audio_worker.data[i])
+         free(audio_worker.data[i]);
+      audio_worker.data[i] = NULL;
+   }
+#endif
+}
+
+/**
+ * audio_driver_worker_sync:
+ *
+ * Waits for the audio worker to flush everything queued so
+ * far. Until more audio is queued, the caller can then touch
+ * the audio driver, the DSP filter and the mixer. Must not be
+ * called from the worker itself, i.e. from mixer callbacks.
+ **/
+static void audio_driver_worker_sync(void)
+{
+#ifdef HAVE_AUDIO_WORKER
+   if (!audio_worker.thread)
+      return;
+
+   slock_lock(audio_worker.cond_lock);
+   while (AUDIO_WORKER_ATOMIC_LOAD(&audio_worker.read)
+         != audio_worker.write)
+      scond_wait(audio_worker.cond, audio_worker.cond_lock);
+   slock_unlock(audio_worker.cond_lock);
+#endif
+}
+
+/**
+ * audio_driver_queue:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ * @is_slowmotion        : whether slow motion is active.
+ *
+ * Hands audio samples to the audio worker if there is one,
+ * or flushes them right away.
+ **/
+static void audio_driver_queue(const int16_t *data, size_t samples,
+      bool is_slowmotion)
+{
+   retro_time_t pacing_start = video_driver_frame_pacing_begin();
+
+#ifdef HAVE_AUDIO_WORKER
+   if (audio_worker.thread)
+      audio_driver_worker_push(data, samples, is_slowmotion);
+   else
+#endif
+      audio_driver_flush(data, samples, is_slowmotion);
+
+   video_driver_frame_pacing_add(FRAME_PACING_AUDIO, pacing_start);
 }
 
 /**
@@ -19107,7 +20880,7 @@ static void audio_driver_sample(int16_t left, int16_t right)
 		   !audio_driver_active     ||
 		   !audio_driver_input_data ||
 		   !audio_driver_output_samples_buf))
-      audio_driver_flush(audio_driver_output_samples_conv_buf,
+      audio_driver_queue(audio_driver_output_samples_conv_buf,
             audio_driver_data_ptr, runloop_slowmotion);
 
    audio_driver_data_ptr = 0;
@@ -19139,7 +20912,7 @@ static void audio_driver_menu_sample(void)
          recording_driver->push_audio(recording_data, &ffemu_data);
       }
       if (check_flush)
-         audio_driver_flush(samples_buf, 1024, runloop_slowmotion);
+         audio_driver_queue(samples_buf, 1024, runloop_slowmotion);
       sample_count -= 1024;
    }
    if (recording_data && recording_driver && recording_driver->push_audio)
@@ -19152,7 +20925,7 @@ static void audio_driver_menu_sample(void)
       recording_driver->push_audio(recording_data, &ffemu_data);
    }
    if (check_flush)
-      audio_driver_flush(samples_buf, sample_count, runloop_slowmotion);
+      audio_driver_queue(samples_buf, sample_count, runloop_slowmotion);
 }
 #endif
 
@@ -19189,7 +20962,7 @@ static size_t audio_driver_sample_batch(const int16_t *data, size_t frames)
          !audio_driver_active     ||
          !audio_driver_input_data ||
          !audio_driver_output_samples_buf))
-      audio_driver_flush(data, frames << 1, runloop_slowmotion);
+      audio_driver_queue(data, frames << 1, runloop_slowmotion);
 
    return frames;
 }
@@ -19482,7 +21255,12 @@ static void audio_mixer_play_stop_sequential_cb(
             {
                if (audio_mixer_streams[i].state == AUDIO_STREAM_STATE_STOPPED)
                {
-                  audio_driver_mixer_play_stream_sequential(i);
+                  /* This may run on the audio worker, which
+                   * must not wait for itself. */
+                  audio_mixer_streams[i].stop_cb =
+                     audio_mixer_play_stop_sequential_cb;
+                  audio_driver_mixer_play_stream_internal(i,
+                        AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
                   break;
                }
             }
@@ -19539,6 +21317,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
    if (params->state == AUDIO_STREAM_STATE_NONE)
       return false;
 
+   audio_driver_worker_sync();
+
    buf = malloc(params->bufsize);
 
    if (!buf)
@@ -19752,30 +21532,35 @@ end:
 
 void audio_driver_mixer_play_stream(unsigned i)
 {
+   audio_driver_worker_sync();
    audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING);
 }
 
 void audio_driver_mixer_play_menu_sound_looped(unsigned i)
 {
+   audio_driver_worker_sync();
    audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
 }
 
 void audio_driver_mixer_play_menu_sound(unsigned i)
 {
+   audio_driver_worker_sync();
    audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING);
 }
 
 void audio_driver_mixer_play_stream_looped(unsigned i)
 {
+   audio_driver_worker_sync();
    audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
 }
 
 void audio_driver_mixer_play_stream_sequential(unsigned i)
 {
+   audio_driver_worker_sync();
    audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_sequential_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
 }
@@ -19826,6 +21611,8 @@ void audio_driver_mixer_stop_stream(unsigned i)
    {
       audio_mixer_voice_t *voice     = audio_mixer_streams[i].voice;
 
+      audio_driver_worker_sync();
+
       if (voice)
          audio_mixer_stop(voice);
       audio_mixer_streams[i].state   = AUDIO_STREAM_STATE_STOPPED;
@@ -19858,6 +21645,9 @@ void audio_driver_mixer_remove_stream(unsigned i)
    if (destroy)
    {
       audio_mixer_sound_t *handle = audio_mixer_streams[i].handle;
+
+      audio_driver_worker_sync();
+
       if (handle)
          audio_mixer_destroy(handle);
 
@@ -19902,6 +21692,7 @@ static void audio_driver_monitor_set_rate(void)
 
    audio_source_ratio_original = new_src_ratio;
    audio_source_ratio_current  = new_src_ratio;
+   audio_driver_control_reset();
 }
 
 bool audio_driver_callback(void)
@@ -19941,6 +21732,8 @@ static INLINE bool audio_driver_alive(void)
 
 static bool audio_driver_start(bool is_shutdown)
 {
+   audio_driver_worker_sync();
+
    if (!current_audio || !current_audio->start
          || !audio_driver_context_audio_data)
       goto error;
@@ -19958,6 +21751,8 @@ error:
 
 static bool audio_driver_stop(void)
 {
+   audio_driver_worker_sync();
+
    if (!current_audio || !current_audio->stop
          || !audio_driver_context_audio_data)
       return false;
@@ -19984,7 +21779,7 @@ void audio_driver_frame_is_reverse(void)
          !audio_driver_active     ||
          !audio_driver_input_data ||
          !audio_driver_output_samples_buf))
-      audio_driver_flush(
+      audio_driver_queue(
             audio_driver_rewind_buf + audio_driver_rewind_ptr,
             audio_driver_rewind_size - audio_driver_rewind_ptr,
             runloop_slowmotion);
@@ -20204,6 +21999,8 @@ void video_context_driver_destroy(void)
    current_video_context.bind_hw_render             = NULL;
    current_video_context.get_context_data           = NULL;
    current_video_context.make_current               = NULL;
+   current_video_context.ui_layer_begin             = NULL;
+   current_video_context.ui_layer_end               = NULL;
 }
 
 /**
@@ -20249,6 +22046,125 @@ static void video_driver_filter_free(void)
    video_driver_state_out_rgb32 = false;
 }
 
+static void video_driver_frame_dupe_free(void)
+{
+   free(frame_dupe_data);
+   frame_dupe_data   = NULL;
+   frame_dupe_size   = 0;
+   frame_dupe_valid  = false;
+   frame_dupe_next   = NULL;
+   frame_dupe_direct = false;
+   frame_dupe_wanted = false;
+}
+
+/* Compares a software frame with the copy of the previous
+ * one, up to the first row that differs. */
+static bool video_driver_frame_is_dupe(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   unsigned y;
+   const uint8_t *src = (const uint8_t*)data;
+   const uint8_t *dst = frame_dupe_data;
+   size_t row         = width *
+      (video_driver_pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2);
+
+   frame_dupe_changed_row = 0;
+
+   if (     !frame_dupe_valid
+         || frame_dupe_width  != width
+         || frame_dupe_height != height
+         || frame_dupe_row    != row
+         || pitch < row)
+      return false;
+
+   for (y = 0; y < height; y++, src += pitch, dst += row)
+   {
+      if (memcmp(dst, src, row))
+         break;
+   }
+
+   frame_dupe_changed_row = y;
+   return y == height;
+}
+
+/* Brings the copy up to date with a frame compared by
+ * video_driver_frame_is_dupe; rows before the first
+ * change are the same already. */
+static void video_driver_frame_dupe_store(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   unsigned y;
+   const uint8_t *src = (const uint8_t*)data;
+   uint8_t *dst       = NULL;
+   size_t row         = width *
+      (video_driver_pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2);
+   size_t size        = row * height;
+
+   if (!data || !width || !height || pitch < row)
+   {
+      frame_dupe_valid = false;
+      return;
+   }
+
+   if (size > frame_dupe_size)
+   {
+      uint8_t *buf = (uint8_t*)realloc(frame_dupe_data, size);
+      if (!buf)
+      {
+         video_driver_frame_dupe_free();
+         return;
+      }
+      frame_dupe_data        = buf;
+      frame_dupe_size        = size;
+      frame_dupe_changed_row = 0;
+   }
+
+   if (     !frame_dupe_valid
+         || frame_dupe_width  != width
+         || frame_dupe_height != height
+         || frame_dupe_row    != row)
+      frame_dupe_changed_row = 0;
+
+   y   = frame_dupe_changed_row;
+   src = src + y * pitch;
+   dst = frame_dupe_data + y * row;
+
+   for (; y < height; y++, src += pitch, dst += row)
+      memcpy(dst, src, row);
+
+   frame_dupe_width  = width;
+   frame_dupe_height = height;
+   frame_dupe_row    = row;
+   frame_dupe_valid  = true;
+   frame_dupe_serial++;
+}
+
+void video_driver_frame_dupe_reset(void)
+{
+   frame_dupe_valid = false;
+}
+
+const void *video_driver_get_prev_frame(unsigned width, unsigned height,
+      uint64_t *serial)
+{
+   bool match = frame_dupe_valid
+      && frame_dupe_width  == width
+      && frame_dupe_height == height
+      && *serial           == frame_dupe_serial;
+
+   frame_dupe_wanted = true;
+
+   if (!frame_dupe_direct)
+   {
+      *serial = 0;
+      return NULL;
+   }
+
+   /* What the frame being shown is going to be copied as */
+   *serial = frame_dupe_serial + 1;
+   return match ? frame_dupe_data : NULL;
+}
+
 static void video_driver_init_filter(enum retro_pixel_format colfmt_int)
 {
    unsigned pow2_x, pow2_y, maxsize;
@@ -20262,6 +22178,9 @@ static void video_driver_init_filter(enum retro_pixel_format colfmt_int)
       (colfmt_int == RETRO_PIXEL_FORMAT_0RGB1555) ?
       RETRO_PIXEL_FORMAT_RGB565 : colfmt_int;
 
+   /* The driver has to see the next frame through the new filter. */
+   video_driver_frame_dupe_reset();
+
    if (video_driver_is_hw_context())
    {
       RARCH_WARN("Cannot use CPU filters when hardware rendering is used.\n");
@@ -20427,6 +22346,7 @@ static void video_driver_free_internal(void)
    if (video_driver_scaler_ptr)
       video_driver_pixel_converter_free();
    video_driver_filter_free();
+   video_driver_frame_dupe_free();
    dir_free_shader();
 
 #ifdef HAVE_THREADS
@@ -20574,6 +22494,8 @@ static bool video_driver_init_internal(bool *video_is_threaded)
    settings_t *settings                   = configuration_settings;
    struct retro_game_geometry *geom       = &video_driver_av_info.geometry;
 
+   video_driver_info_invalidate();
+
    if (!string_is_empty(settings->paths.path_softfilter_plugin))
       video_driver_init_filter(video_driver_pix_fmt);
 
@@ -20932,6 +22854,205 @@ void video_driver_set_size(unsigned width, unsigned height)
 #endif
 }
 
+/* Set by context drivers whose physical surface is rotated
+ * relative to the reported video size, and which expect the
+ * video driver to render pre-rotated (in degrees). */
+void video_driver_set_surface_rotation(unsigned rotation)
+{
+   video_driver_surface_rotation = rotation % 360;
+}
+
+unsigned video_driver_get_surface_rotation(void)
+{
+   return video_driver_surface_rotation;
+}
+
+/* Set by context drivers whose present blocks on the page
+ * flip, to how long the last present waited for it (in usec).
+ * Negative if unknown. */
+void video_driver_set_present_wait(retro_time_t usec)
+{
+   video_driver_present_wait = usec;
+}
+
+retro_time_t video_driver_get_present_wait(void)
+{
+   return video_driver_present_wait;
+}
+
+/* Returns the time, or 0 if frame pacing isn't kept */
+static retro_time_t video_driver_frame_pacing_begin(void)
+{
+   if (!video_driver_frame_pacing_enable)
+      return 0;
+   return cpu_features_get_time_usec();
+}
+
+static void video_driver_frame_pacing_add(enum frame_pacing_stage stage,
+      retro_time_t start)
+{
+   if (start && video_driver_frame_pacing_enable)
+      video_driver_frame_pacing_stages[stage] +=
+         cpu_features_get_time_usec() - start;
+}
+
+/* Ends the frame that took @frame_time */
+static void video_driver_frame_pacing_end(retro_time_t frame_time,
+      float refresh_rate)
+{
+   unsigned i;
+   frame_pacing_t *pacing       = &video_driver_frame_pacing;
+   unsigned idx                 = pacing->count++
+      & (FRAME_PACING_SAMPLES - 1);
+   enum frame_pacing_stage worst = FRAME_PACING_STAGE_LAST;
+   retro_time_t worst_overrun   = 0;
+
+   pacing->deadline             = refresh_rate > 0.0f
+      ? (retro_time_t)(1000000.0f / refresh_rate) : 0;
+   pacing->frame_time[idx]      = frame_time;
+
+   if (pacing->deadline && 2 * frame_time > 3 * pacing->deadline)
+   {
+      for (i = 0; i < FRAME_PACING_STAGE_LAST; i++)
+      {
+         retro_time_t overrun = video_driver_frame_pacing_stages[i]
+            - pacing->average[i];
+
+         if (worst == FRAME_PACING_STAGE_LAST || overrun > worst_overrun)
+         {
+            worst         = (enum frame_pacing_stage)i;
+            worst_overrun = overrun;
+         }
+      }
+
+      pacing->misses[worst]++;
+      pacing->last_overrun = worst_overrun;
+   }
+
+   pacing->culprit[idx]         = (uint8_t)worst;
+
+   /* Averages of the last 16 frames or so */
+   for (i = 0; i < FRAME_PACING_STAGE_LAST; i++)
+   {
+      pacing->average[i] += (video_driver_frame_pacing_stages[i]
+            - pacing->average[i]) / 16;
+      video_driver_frame_pacing_stages[i] = 0;
+   }
+}
+
+/**
+ * video_driver_frame_pacing_next:
+ * @enable             : Whether frame pacing is kept.
+ * @refresh_rate       : Of the display, for the deadline.
+ *
+ * Called as each iteration of the runloop starts; the time
+ * between two of them is the frame time.
+ **/
+static void video_driver_frame_pacing_next(bool enable, float refresh_rate)
+{
+   static retro_time_t last = 0;
+   retro_time_t now;
+
+   if (!enable)
+   {
+      video_driver_frame_pacing_enable = false;
+      last                             = 0;
+      return;
+   }
+
+   now = cpu_features_get_time_usec();
+
+   if (!video_driver_frame_pacing_enable)
+   {
+      memset(&video_driver_frame_pacing, 0,
+            sizeof(video_driver_frame_pacing));
+      memset(video_driver_frame_pacing_stages, 0,
+            sizeof(video_driver_frame_pacing_stages));
+      video_driver_frame_pacing_enable = true;
+   }
+   else if (last)
+      video_driver_frame_pacing_end(now - last, refresh_rate);
+
+   last = now;
+}
+
+const frame_pacing_t *video_driver_get_frame_pacing(void)
+{
+   if (!video_driver_frame_pacing_enable)
+      return NULL;
+   return &video_driver_frame_pacing;
+}
+
+static const char *video_driver_frame_pacing_stage_name(
+      enum frame_pacing_stage stage)
+{
+   switch (stage)
+   {
+      case FRAME_PACING_INPUT:
+         return "Input";
+      case FRAME_PACING_CORE:
+         return "Core";
+      case FRAME_PACING_AUDIO:
+         return "Audio";
+      case FRAME_PACING_UPLOAD:
+         return "Upload";
+      case FRAME_PACING_SHADER:
+         return "Shader";
+      case FRAME_PACING_PRESENT:
+         return "Present";
+      case FRAME_PACING_TASKS:
+         return "Tasks";
+      default:
+         break;
+   }
+
+   return "N/A";
+}
+
+/* Prints the deadline misses into s. Returns the amount of
+ * bytes written. */
+static size_t video_driver_frame_pacing_print(char *s, size_t len)
+{
+   unsigned i;
+   unsigned misses              = 0;
+   int pos                      = 0;
+   const frame_pacing_t *pacing = &video_driver_frame_pacing;
+   enum frame_pacing_stage last = FRAME_PACING_STAGE_LAST;
+
+   for (i = 0; i < FRAME_PACING_STAGE_LAST; i++)
+      misses += pacing->misses[i];
+
+   /* The last miss, if it's still on the graph */
+   for (i = 0; i < FRAME_PACING_SAMPLES && i < pacing->count; i++)
+   {
+      last = (enum frame_pacing_stage)pacing->culprit[
+         (pacing->count - 1 - i) & (FRAME_PACING_SAMPLES - 1)];
+      if (last != FRAME_PACING_STAGE_LAST)
+         break;
+   }
+
+   pos = snprintf(s, len,
+         "Frame Pacing:\n -Deadline: %.2f ms\n -Missed: %u (%.2f %%)\n",
+         pacing->deadline / 1000.0, misses,
+         pacing->count ? 100.0 * misses / pacing->count : 0.0);
+
+   if (last != FRAME_PACING_STAGE_LAST && pos > 0 && (size_t)pos < len)
+      pos += snprintf(s + pos, len - pos,
+            " -Last miss: %s, %+.2f ms over average\n",
+            video_driver_frame_pacing_stage_name(last),
+            pacing->last_overrun / 1000.0);
+
+   for (i = 0; i < FRAME_PACING_STAGE_LAST
+         && pos > 0 && (size_t)pos < len; i++)
+      if (pacing->misses[i])
+         pos += snprintf(s + pos, len - pos, " -%s: %u\n",
+               video_driver_frame_pacing_stage_name(
+                  (enum frame_pacing_stage)i),
+               pacing->misses[i]);
+
+   return pos > 0 ? (size_t)pos : 0;
+}
+
 /**
  * video_monitor_set_refresh_rate:
  * @hz                 : New refresh rate for monitor.
@@ -21173,6 +23294,8 @@ void video_driver_reset_custom_viewport(void)
    custom_vp->height = 0;
    custom_vp->x      = 0;
    custom_vp->y      = 0;
+
+   video_driver_info_invalidate();
 }
 
 void video_driver_set_rgba(void)
@@ -21462,6 +23585,24 @@ bool video_driver_read_viewport(uint8_t *buffer, bool is_idle)
    return false;
 }
 
+bool video_driver_set_record_nv12(unsigned width, unsigned height)
+{
+   if (     video_driver_poke
+         && video_driver_poke->set_record_nv12)
+      return video_driver_poke->set_record_nv12(
+            video_driver_data, width, height);
+   return false;
+}
+
+bool video_driver_read_viewport_nv12(uint8_t *buffer)
+{
+   if (     video_driver_poke
+         && video_driver_poke->read_viewport_nv12)
+      return video_driver_poke->read_viewport_nv12(
+            video_driver_data, buffer);
+   return false;
+}
+
 void video_driver_default_settings(void)
 {
    global_t *global    = &g_extern;
@@ -21566,6 +23707,7 @@ void video_driver_reinit(int flags)
       video_driver_cache_context = false;
 
    video_driver_cache_context_ack = false;
+   video_driver_frame_dupe_reset();
    video_driver_reinit_context(flags);
    video_driver_cache_context = false;
 }
@@ -21705,6 +23847,50 @@ unsigned video_pixel_get_alignment(unsigned pitch)
    return 8;
 }
 
+#ifdef HAVE_NETWORKING
+/* The Netplay section of the statistics overlay. */
+static void video_driver_netplay_statistics(char *s, size_t len)
+{
+   unsigned i;
+   netplay_stats_t stats;
+   size_t pos = 0;
+
+   memset(&stats, 0, sizeof(stats));
+   if (!netplay_driver_ctl(RARCH_NETPLAY_CTL_GET_STATS, &stats))
+      return;
+
+   pos += snprintf(s, len,
+         "Netplay:\n -Input latency: %d frames\n"
+         " -Rollbacks: %u (deepest %u frames)\n -Rollback depths:",
+         stats.input_latency_frames,
+         stats.rollbacks, stats.rollback_max);
+
+   for (i = 0; i < NETPLAY_STATS_DEPTHS && pos < len; i++)
+      pos += snprintf(s + pos, len - pos, " %u", stats.rollback_depths[i]);
+
+   if (pos < len)
+      pos += snprintf(s + pos, len - pos,
+            "\n -Frames replayed: %.2f / s\n -CRC mismatches: %u\n"
+            " -Sent / received: %.1f / %.1f KiB\n",
+            stats.replayed_per_second, stats.crc_mismatches,
+            stats.bytes_sent / 1024.0, stats.bytes_received / 1024.0);
+
+   for (i = 0; i < stats.peer_count && i < NETPLAY_STATS_MAX_PEERS
+         && pos < len; i++)
+   {
+      const netplay_peer_stats_t *peer = &stats.peers[i];
+
+      if (peer->rtt < 0)
+         pos += snprintf(s + pos, len - pos, " -%s: RTT unknown\n",
+               peer->nick);
+      else
+         pos += snprintf(s + pos, len - pos,
+               " -%s: RTT %.2f ms, jitter %.2f ms\n",
+               peer->nick, peer->rtt / 1000.0, peer->jitter / 1000.0);
+   }
+}
+#endif
+
 /**
  * video_driver_frame:
  * @data                 : pointer to data of the video frame.
@@ -21724,16 +23910,42 @@ static void video_driver_frame(const void *data, unsigned width,
    static float last_fps, frame_time;
    retro_time_t        new_time                      =
       cpu_features_get_time_usec();
+   retro_time_t trace_start                          = 0;
 
    if (!video_driver_active)
       return;
 
+   trace_start = rarch_trace_begin();
+
    if (data)
       frame_cache_data = data;
    frame_cache_width   = width;
    frame_cache_height  = height;
    frame_cache_pitch   = pitch;
-   
+
+   /* Identical frames are turned into dupes, which drivers
+    * present again without uploading or filtering them.
+    * The copy compared with is also kept while the driver
+    * uses it to upload only what changed. */
+   frame_dupe_next   = NULL;
+   frame_dupe_direct = false;
+
+   if (data && data != RETRO_HW_FRAME_BUFFER_VALID)
+   {
+      settings_t *settings = configuration_settings;
+      bool detect          = settings->bools.video_frame_dupe_detect;
+
+      if (!detect && !frame_dupe_wanted)
+         frame_dupe_valid = false;
+      else if (video_driver_frame_is_dupe(data, width, height, pitch)
+            && detect)
+         data = NULL;
+      else
+         frame_dupe_next = data;
+   }
+
+   frame_dupe_wanted = false;
+
    if (
          video_driver_scaler_ptr
          && data
@@ -21762,6 +23974,8 @@ static void video_driver_frame(const void *data, unsigned width,
       video_driver_frame_time_samples[write_index] = frame_time;
       fps_time                                     = new_time;
 
+      rarch_histogram_add(&video_driver_frame_time_histogram, frame_time);
+
       if (video_info.fps_show)
          buf_pos = snprintf(
                video_info.fps_text, sizeof(video_info.fps_text),
@@ -21876,7 +24090,8 @@ static void video_driver_frame(const void *data, unsigned width,
       pitch  = output_pitch;
    }
 
-   video_driver_msg[0] = '\0';
+   video_driver_msg[0]      = '\0';
+   video_driver_msg_pending = false;
 
    if (video_info.font_enable)
    {
@@ -21884,14 +24099,24 @@ static void video_driver_frame(const void *data, unsigned width,
       runloop_msg_queue_lock();
       msg = msg_queue_pull(runloop_msg_queue);
       if (msg)
+      {
          strlcpy(video_driver_msg, msg, sizeof(video_driver_msg));
+         video_driver_msg_pending = true;
+      }
       runloop_msg_queue_unlock();
    }
 
+   if (runloop_perfcnt_enable)
+      rarch_perf_frame();
+
    if (video_info.statistics_show)
    {
       audio_statistics_t audio_stats         = {0.0f};
+      char audio_latency[128]                = {0};
+      char run_ahead[128]                    = {0};
+      char netplay[512]                      = {0};
       double stddev                          = 0.0;
+      int stat_pos                           = 0;
       struct retro_system_av_info *av_info   = &video_driver_av_info;
       unsigned red                           = 255;
       unsigned green                         = 255;
@@ -21913,12 +24138,44 @@ static void video_driver_frame(const void *data, unsigned width,
 
       audio_compute_buffer_statistics(&audio_stats);
 
-      snprintf(video_info.stat_text,
+      {
+         rarch_histogram_stats_t latency;
+
+         if (rarch_histogram_get_stats(
+                  &audio_driver_latency_histogram, &latency))
+            snprintf(audio_latency, sizeof(audio_latency),
+                  " -Output latency (min / avg / p99): %.2f / %.2f / %.2f ms\n",
+                  latency.min / 1000.0, latency.avg / 1000.0,
+                  latency.p99 / 1000.0);
+      }
+
+#ifdef HAVE_RUNAHEAD
+      if (runahead_ring_frames)
+         snprintf(run_ahead, sizeof(run_ahead),
+               "Run-Ahead:\n -Frames redone: %.2f %% (%u / %u)\n",
+               100.0 * runahead_ring_rollbacks / runahead_ring_frames,
+               runahead_ring_rollbacks, runahead_ring_frames);
+      else if (runahead_secondary_syncs)
+         snprintf(run_ahead, sizeof(run_ahead),
+               "Run-Ahead:\n -Second instance syncs: %u\n"
+               " -Sync time (avg / peak): %.2f / %.2f ms\n",
+               runahead_secondary_syncs,
+               runahead_secondary_sync_time
+               / 1000.0 / runahead_secondary_syncs,
+               runahead_secondary_sync_peak / 1000.0);
+#endif
+
+#ifdef HAVE_NETWORKING
+      video_driver_netplay_statistics(netplay, sizeof(netplay));
+#endif
+
+      stat_pos = snprintf(video_info.stat_text,
             sizeof(video_info.stat_text),
             "Video Statistics:\n -Frame rate: %6.2f fps\n -Frame time: %6.2f ms\n -Frame time deviation: %.3f %%\n"
             " -Frame count: %" PRIu64"\n -Viewport: %d x %d x %3.2f\n"
             "Audio Statistics:\n -Average buffer saturation: %.2f %%\n -Standard deviation: %.2f %%\n -Time spent close to underrun: %.2f %%\n -Time spent close to blocking: %.2f %%\n -Sample count: %d\n"
-            "Core Geometry:\n -Size: %u x %u\n -Max Size: %u x %u\n -Aspect: %3.2f\nCore Timing:\n -FPS: %3.2f\n -Sample Rate: %6.2f\n",
+            " -Rate adjustment: %+.3f %% (%+.3f .. %+.3f)\n -Underruns: %u\n -Overruns: %u\n%s"
+            "Core Geometry:\n -Size: %u x %u\n -Max Size: %u x %u\n -Aspect: %3.2f\nCore Timing:\n -FPS: %3.2f\n -Sample Rate: %6.2f\n%s%s",
             video_info.frame_rate,
             video_info.frame_time,
             100.0 * stddev,
@@ -21931,13 +24188,59 @@ static void video_driver_frame(const void *data, unsigned width,
             audio_stats.close_to_underrun,
             audio_stats.close_to_blocking,
             audio_stats.samples,
+            audio_stats.ratio_adjust_avg,
+            audio_stats.ratio_adjust_min,
+            audio_stats.ratio_adjust_max,
+            audio_stats.underruns,
+            audio_stats.overruns,
+            audio_latency,
             av_info->geometry.base_width,
             av_info->geometry.base_height,
             av_info->geometry.max_width,
             av_info->geometry.max_height,
             av_info->geometry.aspect_ratio,
             av_info->timing.fps,
-            av_info->timing.sample_rate);
+            av_info->timing.sample_rate,
+            run_ahead,
+            netplay);
+
+      /* Stage timings registered by drivers (min / avg / p99). */
+      if (stat_pos > 0 && (size_t)stat_pos < sizeof(video_info.stat_text))
+      {
+         char histograms[1024];
+
+         if (rarch_histogram_print(histograms, sizeof(histograms)))
+            stat_pos += snprintf(video_info.stat_text + stat_pos,
+                  sizeof(video_info.stat_text) - stat_pos,
+                  "Stage Timing (min / avg / p99):\n%s", histograms);
+      }
+
+      if (stat_pos > 0 && (size_t)stat_pos < sizeof(video_info.stat_text))
+         stat_pos += (int)video_driver_frame_pacing_print(
+               video_info.stat_text + stat_pos,
+               sizeof(video_info.stat_text) - stat_pos);
+
+      /* The costliest performance counters, core ones included */
+      if (runloop_perfcnt_enable && stat_pos > 0
+            && (size_t)stat_pos < sizeof(video_info.stat_text))
+      {
+         unsigned i;
+         rarch_perf_frame_stats_t top[5];
+         unsigned count = rarch_perf_get_top(top, ARRAY_SIZE(top));
+
+         if (count)
+            stat_pos += snprintf(video_info.stat_text + stat_pos,
+                  sizeof(video_info.stat_text) - stat_pos,
+                  "Performance Counters (ticks / frame):\n");
+
+         for (i = 0; i < count
+               && (size_t)stat_pos < sizeof(video_info.stat_text); i++)
+            stat_pos += snprintf(video_info.stat_text + stat_pos,
+                  sizeof(video_info.stat_text) - stat_pos,
+                  " -%s%s: %" PRIu64 " (%.1f calls)\n",
+                  top[i].libretro ? "Core: " : "",
+                  top[i].ident, (uint64_t)top[i].ticks, top[i].calls);
+      }
 
       /* TODO/FIXME - add OSD chat text here */
 #if 0
@@ -21947,10 +24250,69 @@ static void video_driver_frame(const void *data, unsigned width,
    }
 
    if (current_video && current_video->frame)
+   {
+      retro_time_t trace_driver = rarch_trace_begin();
+      retro_time_t pacing_start = 0;
+      retro_time_t perf_start   = 0;
+
+      /* Only a frame of our own can be flashed, HW rendered
+       * ones are still followed */
+      if (data)
+      {
+         size_t flash_pitch = 0;
+         const void *flash  = latency_test_flash_frame(width, height,
+               &flash_pitch,
+               video_driver_pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2);
+
+         if (flash && data != RETRO_HW_FRAME_BUFFER_VALID)
+         {
+            data  = flash;
+            pitch = flash_pitch;
+         }
+      }
+
+      video_driver_frame_pacing_add(FRAME_PACING_UPLOAD, new_time);
+      pacing_start = video_driver_frame_pacing_begin();
+      if (runloop_perf_enable && !input_driver_nonblock_state)
+         perf_start = cpu_features_get_time_usec();
+
+      /* A threaded driver uploads after this returns */
+      frame_dupe_direct = frame_dupe_next && data == frame_dupe_next
+         && !video_driver_is_threaded_internal();
+
       video_driver_active = current_video->frame(
             video_driver_data, data, width, height,
             video_driver_frame_count,
             (unsigned)pitch, video_driver_msg, &video_info);
+      rarch_trace_end("Video driver frame", trace_driver);
+
+      frame_dupe_direct = false;
+
+      if (perf_start)
+         runloop_perf_add(&runloop_perf_video,
+               cpu_features_get_time_usec() - perf_start
+               - (video_driver_present_wait > 0
+                  ? video_driver_present_wait : 0));
+
+      /* Waiting for the flip is the present, the rest is
+       * mostly shading */
+      if (pacing_start)
+      {
+         retro_time_t wait = video_driver_present_wait > 0
+            ? video_driver_present_wait : 0;
+
+         video_driver_frame_pacing_add(FRAME_PACING_SHADER,
+               pacing_start + wait);
+         video_driver_frame_pacing_stages[FRAME_PACING_PRESENT] += wait;
+      }
+      latency_test_rendered();
+   }
+
+   if (frame_dupe_next)
+   {
+      video_driver_frame_dupe_store(frame_dupe_next, width, height, pitch);
+      frame_dupe_next = NULL;
+   }
 
    video_driver_frame_count++;
 
@@ -21995,6 +24357,8 @@ static void video_driver_frame(const void *data, unsigned width,
    }
    else if (!video_info.crt_switch_resolution)
       video_driver_crt_switching_active = false;
+
+   rarch_trace_end("video_driver_frame", trace_start);
 }
 
 void crt_switch_driver_reinit(void)
@@ -22084,17 +24448,22 @@ bool video_driver_texture_unload(uintptr_t *id)
    return true;
 }
 
-void video_driver_build_info(video_frame_info_t *video_info)
+/* What video_driver_build_info() takes from the settings. Built
+ * again after video_driver_info_invalidate(), and every frame
+ * the menu is up, as the menu changes settings in place */
+static video_frame_info_t video_driver_info_cache;
+static bool video_driver_info_cache_valid = false;
+
+void video_driver_info_invalidate(void)
 {
-   video_viewport_t *custom_vp       = NULL;
-   struct retro_hw_render_callback *hwr =
-      video_driver_get_hw_context_internal();
-   settings_t *settings              = configuration_settings;
-#ifdef HAVE_THREADS
-   bool is_threaded                  = video_driver_is_threaded_internal();
-   video_driver_threaded_lock(is_threaded);
-#endif
-   custom_vp                         = &settings->video_viewport_custom;
+   video_driver_info_cache_valid = false;
+}
+
+static void video_driver_info_cache_update(settings_t *settings)
+{
+   video_frame_info_t *video_info    = &video_driver_info_cache;
+   video_viewport_t *custom_vp       = &settings->video_viewport_custom;
+
    video_info->refresh_rate          = settings->floats.video_refresh_rate;
    video_info->crt_switch_resolution = settings->uints.crt_switch_resolution;
    video_info->crt_switch_resolution_super = settings->uints.crt_switch_resolution_super;
@@ -22108,18 +24477,16 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->statistics_show       = settings->bools.video_statistics_show;
    video_info->framecount_show       = settings->bools.video_framecount_show;
    video_info->scale_integer         = settings->bools.video_scale_integer;
+   video_info->shader_adaptive       = settings->bools.video_shader_adaptive;
    video_info->aspect_ratio_idx      = settings->uints.video_aspect_ratio_idx;
    video_info->post_filter_record    = settings->bools.video_post_filter_record;
    video_info->input_menu_swap_ok_cancel_buttons    = settings->bools.input_menu_swap_ok_cancel_buttons;
    video_info->max_swapchain_images  = settings->uints.video_max_swapchain_images;
    video_info->windowed_fullscreen   = settings->bools.video_windowed_fullscreen;
-   video_info->fullscreen            = settings->bools.video_fullscreen || retroarch_is_forced_fullscreen();
+   video_info->fullscreen            = settings->bools.video_fullscreen;
    video_info->monitor_index         = settings->uints.video_monitor_index;
    video_info->shared_context        = settings->bools.video_shared_context;
 
-   if (core_set_shared_context && hwr && hwr->context_type != RETRO_HW_CONTEXT_NONE)
-      video_info->shared_context     = true;
-
    video_info->font_enable           = settings->bools.video_font_enable;
    video_info->font_msg_pos_x        = settings->floats.video_msg_pos_x;
    video_info->font_msg_pos_y        = settings->floats.video_msg_pos_y;
@@ -22133,35 +24500,20 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->custom_vp_full_width  = custom_vp->full_width;
    video_info->custom_vp_full_height = custom_vp->full_height;
 
-   video_info->fps_text[0]           = '\0';
-
-#ifdef HAVE_MENU_WIDGETS
-   video_info->widgets_inited             = menu_widgets_inited;
-   video_info->widgets_is_paused          = menu_widgets_paused;
-   video_info->widgets_is_fast_forwarding = menu_widgets_fast_forward;
-   video_info->widgets_is_rewinding       = menu_widgets_rewinding;
-#else
-   video_info->widgets_inited             = false;
-   video_info->widgets_is_paused          = false;
-   video_info->widgets_is_fast_forwarding = false;
-   video_info->widgets_is_rewinding       = false;
-#endif
-
-   video_info->width                 = video_driver_width;
-   video_info->height                = video_driver_height;
-
-   video_info->use_rgba              = video_driver_use_rgba;
-
-   video_info->libretro_running       = false;
    video_info->msg_bgcolor_enable     = settings->bools.video_msg_bgcolor_enable;
 
 #ifdef HAVE_MENU
-   video_info->menu_is_alive          = menu_driver_alive;
    video_info->menu_footer_opacity    = settings->floats.menu_footer_opacity;
    video_info->menu_header_opacity    = settings->floats.menu_header_opacity;
    video_info->materialui_color_theme = settings->uints.menu_materialui_color_theme;
    video_info->ozone_color_theme      = settings->uints.menu_ozone_color_theme;
    video_info->menu_shader_pipeline   = settings->uints.menu_xmb_shader_pipeline;
+   video_info->menu_shader_pipeline_scale     =
+      settings->uints.menu_xmb_shader_pipeline_scale;
+   video_info->menu_shader_pipeline_idle_fps  =
+      settings->uints.menu_xmb_shader_pipeline_idle_fps;
+   video_info->menu_shader_pipeline_freeze    =
+      settings->bools.menu_xmb_shader_pipeline_freeze;
    video_info->xmb_theme              = settings->uints.menu_xmb_theme;
    video_info->xmb_color_theme        = settings->uints.menu_xmb_color_theme;
    video_info->timedate_enable        = settings->bools.menu_timedate_enable;
@@ -22174,14 +24526,14 @@ void video_driver_build_info(video_frame_info_t *video_info)
       settings->floats.menu_wallpaper_opacity;
    video_info->menu_framebuffer_opacity    =
       settings->floats.menu_framebuffer_opacity;
-
-   video_info->libretro_running            = current_core.game_loaded;
 #else
-   video_info->menu_is_alive               = false;
    video_info->menu_footer_opacity         = 0.0f;
    video_info->menu_header_opacity         = 0.0f;
    video_info->materialui_color_theme      = 0;
    video_info->menu_shader_pipeline        = 0;
+   video_info->menu_shader_pipeline_scale     = 100;
+   video_info->menu_shader_pipeline_idle_fps  = 0;
+   video_info->menu_shader_pipeline_freeze    = false;
    video_info->xmb_color_theme             = 0;
    video_info->xmb_theme                   = 0;
    video_info->timedate_enable             = false;
@@ -22191,6 +24543,62 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->menu_framebuffer_opacity    = 0.0f;
    video_info->menu_wallpaper_opacity      = 0.0f;
 #endif
+}
+
+void video_driver_build_info(video_frame_info_t *video_info)
+{
+   struct retro_hw_render_callback *hwr =
+      video_driver_get_hw_context_internal();
+#ifdef HAVE_MENU
+   bool menu_is_alive                = menu_driver_alive;
+#else
+   bool menu_is_alive                = false;
+#endif
+#ifdef HAVE_THREADS
+   bool is_threaded                  = video_driver_is_threaded_internal();
+   video_driver_threaded_lock(is_threaded);
+#endif
+
+   if (!video_driver_info_cache_valid || menu_is_alive)
+      video_driver_info_cache_update(configuration_settings);
+   /* Once more after the menu closes */
+   video_driver_info_cache_valid     = !menu_is_alive;
+
+   /* Everything up to the text; the rest is set below */
+   memcpy(video_info, &video_driver_info_cache,
+         offsetof(video_frame_info_t, fps_text));
+
+   if (retroarch_is_forced_fullscreen())
+      video_info->fullscreen         = true;
+
+   if (core_set_shared_context && hwr && hwr->context_type != RETRO_HW_CONTEXT_NONE)
+      video_info->shared_context     = true;
+
+   video_info->fps_text[0]           = '\0';
+
+#ifdef HAVE_MENU_WIDGETS
+   video_info->widgets_inited             = menu_widgets_inited;
+   video_info->widgets_is_paused          = menu_widgets_paused;
+   video_info->widgets_is_fast_forwarding = menu_widgets_fast_forward;
+   video_info->widgets_is_rewinding       = menu_widgets_rewinding;
+#else
+   video_info->widgets_inited             = false;
+   video_info->widgets_is_paused          = false;
+   video_info->widgets_is_fast_forwarding = false;
+   video_info->widgets_is_rewinding       = false;
+#endif
+
+   video_info->width                 = video_driver_width;
+   video_info->height                = video_driver_height;
+
+   video_info->use_rgba              = video_driver_use_rgba;
+
+   video_info->menu_is_alive               = menu_is_alive;
+#ifdef HAVE_MENU
+   video_info->libretro_running            = current_core.game_loaded;
+#else
+   video_info->libretro_running            = false;
+#endif
 
    video_info->is_perfcnt_enable           = runloop_perfcnt_enable;
    video_info->runloop_is_paused           = runloop_paused;
@@ -22720,6 +25128,98 @@ bool video_shader_driver_get_current_shader(video_shader_ctx_t *shader)
    return true;
 }
 
+static bool video_shader_pass_fbo_equal(const struct video_shader_pass *a,
+      const struct video_shader_pass *b)
+{
+   return a->fbo.valid    == b->fbo.valid
+       && a->fbo.type_x   == b->fbo.type_x
+       && a->fbo.type_y   == b->fbo.type_y
+       && a->fbo.scale_x  == b->fbo.scale_x
+       && a->fbo.scale_y  == b->fbo.scale_y
+       && a->fbo.abs_x    == b->fbo.abs_x
+       && a->fbo.abs_y    == b->fbo.abs_y
+       && a->fbo.fp_fbo   == b->fbo.fp_fbo
+       && a->fbo.srgb_fbo == b->fbo.srgb_fbo
+       && a->wrap         == b->wrap
+       && a->mipmap       == b->mipmap
+       && a->filter       == b->filter;
+}
+
+bool video_shader_driver_update_current(const struct video_shader *shader)
+{
+   unsigned i;
+   bool fbo_changed                         = false;
+   struct video_shader *current             = NULL;
+   void *video_driver                       = video_driver_get_ptr_internal(true);
+   const video_poke_interface_t *video_poke = video_driver_poke;
+
+   if (!shader || !video_poke || !video_driver
+         || !video_poke->get_current_shader)
+      return false;
+
+   current = video_poke->get_current_shader(video_driver);
+
+   /* Same passes, same kind of shader */
+   if (     !current
+         || current->passes         != shader->passes
+         || current->luts           != shader->luts
+         || current->num_parameters != shader->num_parameters
+         || current->feedback_pass  != shader->feedback_pass
+         || current->history_size   != shader->history_size)
+      return false;
+
+   for (i = 0; i < shader->passes; i++)
+   {
+      const struct video_shader_pass *pass = &shader->pass[i];
+
+      if (     !string_is_equal(current->pass[i].source.path,
+               pass->source.path)
+            || !string_is_equal(current->pass[i].alias, pass->alias)
+            || current->pass[i].frame_count_mod != pass->frame_count_mod
+            || current->pass[i].feedback        != pass->feedback)
+         return false;
+
+      if (!video_shader_pass_fbo_equal(&current->pass[i], pass))
+         fbo_changed = true;
+   }
+
+   for (i = 0; i < shader->luts; i++)
+   {
+      const struct video_shader_lut *lut = &shader->lut[i];
+
+      if (     !string_is_equal(current->lut[i].id, lut->id)
+            || !string_is_equal(current->lut[i].path, lut->path)
+            || current->lut[i].wrap   != lut->wrap
+            || current->lut[i].mipmap != lut->mipmap
+            || current->lut[i].filter != lut->filter)
+         return false;
+   }
+
+   for (i = 0; i < shader->num_parameters; i++)
+      if (!string_is_equal(current->parameters[i].id,
+               shader->parameters[i].id))
+         return false;
+
+   if (fbo_changed && !video_poke->reinit_shader_fbo)
+      return false;
+
+   for (i = 0; i < shader->num_parameters; i++)
+      current->parameters[i].current = shader->parameters[i].current;
+
+   if (!fbo_changed)
+      return true;
+
+   for (i = 0; i < shader->passes; i++)
+   {
+      current->pass[i].fbo    = shader->pass[i].fbo;
+      current->pass[i].wrap   = shader->pass[i].wrap;
+      current->pass[i].mipmap = shader->pass[i].mipmap;
+      current->pass[i].filter = shader->pass[i].filter;
+   }
+
+   return video_poke->reinit_shader_fbo(video_driver);
+}
+
 float video_driver_get_refresh_rate(void)
 {
    if (video_driver_poke && video_driver_poke->get_refresh_rate)
@@ -23321,6 +25821,7 @@ void driver_set_nonblock_state(void)
       }
    }
 
+   audio_driver_worker_sync();
    if (audio_driver_active && audio_driver_context_audio_data)
       current_audio->set_nonblock_state(audio_driver_context_audio_data,
             settings->bools.audio_sync ? enable : true);
@@ -23357,6 +25858,7 @@ static void drivers_init(int flags)
 
       video_driver_frame_time_count = 0;
 
+      startup_stage_begin(STARTUP_STAGE_VIDEO);
       video_driver_lock_new();
       video_driver_filter_free();
       video_driver_set_cached_frame_ptr(NULL);
@@ -23367,6 +25869,8 @@ static void drivers_init(int flags)
          hwr->context_reset();
       video_driver_cache_context_ack = false;
       runloop_frame_time_last        = 0;
+      /* Menu icons are decoded meanwhile */
+      startup_stage_end(STARTUP_STAGE_VIDEO);
    }
 
    /* Initialize audio driver */
@@ -23704,6 +26208,8 @@ static void *input_list_element_constructor(void)
    element->state_size                = 256;
    element->state                     = (int16_t*)calloc(
          element->state_size, sizeof(int16_t));
+   element->used                      = (uint32_t*)calloc(
+         (element->state_size + 31) / 32, sizeof(uint32_t));
 
    return ptr;
 }
@@ -23718,6 +26224,11 @@ static void input_list_element_realloc(
             new_size * sizeof(int16_t));
       memset(&element->state[element->state_size], 0,
             (new_size - element->state_size) * sizeof(int16_t));
+      element->used  = (uint32_t*)realloc(element->used,
+            ((new_size + 31) / 32) * sizeof(uint32_t));
+      memset(&element->used[(element->state_size + 31) / 32], 0,
+            ((new_size + 31) / 32 - (element->state_size + 31) / 32)
+            * sizeof(uint32_t));
       element->state_size = new_size;
    }
 }
@@ -23740,6 +26251,7 @@ static void input_list_element_destructor(void* element_ptr)
       return;
 
    free(element->state);
+   free(element->used);
    free(element_ptr);
 }
 
@@ -23765,7 +26277,8 @@ static void input_state_set_last(unsigned port, unsigned device,
       {
          if (id >= element->state_size)
             input_list_element_expand(element, id);
-         element->state[id] = value;
+         element->state[id]     = value;
+         element->used[id / 32] |= 1u << (id % 32);
          return;
       }
    }
@@ -23777,7 +26290,8 @@ static void input_state_set_last(unsigned port, unsigned device,
    element->index     = index;
    if (id >= element->state_size)
       input_list_element_expand(element, id);
-   element->state[id] = value;
+   element->state[id]     = value;
+   element->used[id / 32] |= 1u << (id % 32);
 }
 
 static int16_t input_state_get_last(unsigned port,
@@ -23806,6 +26320,50 @@ static int16_t input_state_get_last(unsigned port,
    return 0;
 }
 
+/* Returns true if the core asked for this input before. */
+static bool input_state_is_known(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   unsigned i;
+
+   if (!input_state_list)
+      return false;
+
+   for (i = 0; i < (unsigned)input_state_list->size; i++)
+   {
+      input_list_element *element =
+         (input_list_element*)input_state_list->data[i];
+
+      if (  (element->port   == port)   &&
+            (element->device == device) &&
+            (element->index  == index))
+         return id < element->state_size
+            && (element->used[id / 32] & (1u << (id % 32)));
+   }
+   return false;
+}
+
+/* As input_state_get_last, but input the core did not ask
+ * for before is read live and recorded. Since the frames
+ * run ahead read it as 0, that is flagged so they get redone. */
+static int16_t input_state_get_last_or_live(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   if (     input_state_callback_original
+         && id < 65536
+         && !input_state_is_known(port, device, index, id))
+   {
+      int16_t result = input_state_callback_original(
+            port, device, index, id);
+
+      input_state_set_last(port, device, index, id, result);
+      runahead_ring_input_missed = true;
+      return result;
+   }
+
+   return input_state_get_last(port, device, index, id);
+}
+
 static int16_t input_state_with_logging(unsigned port,
       unsigned device, unsigned index, unsigned id)
 {
@@ -23826,6 +26384,48 @@ static int16_t input_state_with_logging(unsigned port,
    return 0;
 }
 
+/* Queries every input the core has asked for so far again
+ * and returns true if any of it differs from the last frame. */
+static bool input_state_refresh(void)
+{
+   unsigned i, j;
+   bool changed = false;
+
+   if (!input_state_list || !input_state_callback_original)
+      return false;
+
+   for (i = 0; i < (unsigned)input_state_list->size; i++)
+   {
+      input_list_element *element =
+         (input_list_element*)input_state_list->data[i];
+
+      for (j = 0; j < (element->state_size + 31) / 32; j++)
+      {
+         uint32_t used = element->used[j];
+         unsigned id   = j * 32;
+
+         for (; used; used >>= 1, id++)
+         {
+            int16_t result;
+
+            if (!(used & 1))
+               continue;
+
+            result = input_state_callback_original(
+                  element->port, element->device, element->index, id);
+
+            if (result != element->state[id])
+            {
+               element->state[id] = result;
+               changed            = true;
+            }
+         }
+      }
+   }
+
+   return changed;
+}
+
 static void reset_hook(void)
 {
    input_is_dirty = true;
@@ -23900,7 +26500,8 @@ static void *runahead_save_state_alloc(void)
 
    if (runahead_save_state_size > 0 && runahead_save_state_size_known)
    {
-      savestate->data       = malloc(runahead_save_state_size);
+      savestate->data       = state_pool_get_tagged(
+            runahead_save_state_size, MEMORY_USAGE_RUNAHEAD);
       savestate->data_const = savestate->data;
       savestate->size       = runahead_save_state_size;
    }
@@ -23913,7 +26514,7 @@ static void runahead_save_state_free(void *data)
    retro_ctx_serialize_info_t *savestate = (retro_ctx_serialize_info_t*)data;
    if (!savestate)
       return;
-   free(savestate->data);
+   state_pool_put(savestate->data);
    free(savestate);
 }
 
@@ -23952,6 +26553,14 @@ static void runahead_clear_variables(void)
    runahead_secondary_core_available = true;
    runahead_force_input_dirty        = true;
    runahead_last_frame_count         = 0;
+   runahead_ring_base                = 0;
+   runahead_ring_ahead               = 0;
+   runahead_ring_input_changed       = false;
+   runahead_ring_frames              = 0;
+   runahead_ring_rollbacks           = 0;
+   runahead_secondary_syncs          = 0;
+   runahead_secondary_sync_time      = 0;
+   runahead_secondary_sync_peak      = 0;
 }
 
 static void runahead_destroy(void)
@@ -24002,6 +26611,8 @@ static void runahead_error(void)
 {
    runahead_available             = false;
    mylist_destroy(&runahead_save_state_list);
+   runahead_ring_base             = 0;
+   runahead_ring_ahead            = 0;
    runahead_remove_hooks();
    runahead_save_state_size       = 0;
    runahead_save_state_size_known = true;
@@ -24030,20 +26641,23 @@ static bool runahead_create(void)
    return true;
 }
 
-static bool runahead_save_state(void)
+static bool runahead_save_state_to(unsigned slot)
 {
    retro_ctx_serialize_info_t *serialize_info;
+   retro_time_t trace_start;
    bool okay                                  = false;
 
    if (!runahead_save_state_list)
       return false;
 
    serialize_info         =
-      (retro_ctx_serialize_info_t*)runahead_save_state_list->data[0];
+      (retro_ctx_serialize_info_t*)runahead_save_state_list->data[slot];
 
+   trace_start            = rarch_trace_begin();
    request_fast_savestate = true;
    okay                   = core_serialize(serialize_info);
    request_fast_savestate = false;
+   rarch_trace_end("Runahead save", trace_start);
 
    if (okay)
       return true;
@@ -24052,12 +26666,18 @@ static bool runahead_save_state(void)
    return false;
 }
 
-static bool runahead_load_state(void)
+static bool runahead_save_state(void)
+{
+   return runahead_save_state_to(0);
+}
+
+static bool runahead_load_state_from(unsigned slot)
 {
    bool okay                                  = false;
    retro_ctx_serialize_info_t *serialize_info = (retro_ctx_serialize_info_t*)
-      runahead_save_state_list->data[0];
+      runahead_save_state_list->data[slot];
    bool last_dirty                            = input_is_dirty;
+   retro_time_t trace_start                   = rarch_trace_begin();
 
    request_fast_savestate                     = true;
    /* calling core_unserialize has side effects with
@@ -24067,6 +26687,7 @@ static bool runahead_load_state(void)
          serialize_info->data_const, serialize_info->size);
 
    request_fast_savestate = false;
+   rarch_trace_end("Runahead load", trace_start);
    input_is_dirty         = last_dirty;
 
    if (!okay)
@@ -24075,17 +26696,24 @@ static bool runahead_load_state(void)
    return okay;
 }
 
+static bool runahead_load_state(void)
+{
+   return runahead_load_state_from(0);
+}
+
 #if HAVE_DYNAMIC
 static bool runahead_load_state_secondary(void)
 {
    bool okay                                  = false;
    retro_ctx_serialize_info_t *serialize_info =
       (retro_ctx_serialize_info_t*)runahead_save_state_list->data[0];
+   retro_time_t trace_start                   = rarch_trace_begin();
 
    request_fast_savestate                     = true;
    okay                                       = secondary_core_deserialize(
          serialize_info->data_const, (int)serialize_info->size);
    request_fast_savestate = false;
+   rarch_trace_end("Runahead load (secondary)", trace_start);
 
    if (!okay)
    {
@@ -24109,13 +26737,14 @@ static bool runahead_load_state_secondary(void)
    else \
       video_driver_active = false
 
-static bool runahead_core_run_use_last_input(void)
+/* Runs a frame without polling, with input read from state_cb. */
+static bool runahead_core_run_with_input(retro_input_state_t state_cb)
 {
    retro_input_poll_t old_poll_function   = retro_ctx.poll_cb;
    retro_input_state_t old_input_function = retro_ctx.state_cb;
 
    retro_ctx.poll_cb                      = retro_input_poll_null;
-   retro_ctx.state_cb                     = input_state_get_last;
+   retro_ctx.state_cb                     = state_cb;
 
    current_core.retro_set_input_poll(retro_ctx.poll_cb);
    current_core.retro_set_input_state(retro_ctx.state_cb);
@@ -24131,11 +26760,150 @@ static bool runahead_core_run_use_last_input(void)
    return true;
 }
 
+static bool runahead_core_run_use_last_input(void)
+{
+   return runahead_core_run_with_input(input_state_get_last);
+}
+
+/* Puts the core back to the real state if it was left ahead. */
+static bool runahead_ring_leave(void)
+{
+   if (!runahead_ring_ahead)
+      return true;
+
+   runahead_ring_ahead = 0;
+   return runahead_load_state_from(runahead_ring_base);
+}
+
+/* Single instance Run Ahead that leaves the core runahead_count
+ * frames ahead of the real state, with a savestate for each of
+ * those frames. While the input stays the same every frame only
+ * runs and saves one more frame. Once it changes, the real state
+ * is loaded and the frames run ahead are redone from there.
+ *
+ * Input is polled once at the start of the frame, which is also
+ * what decides whether the frames run ahead are still valid. */
+static void do_runahead_ring(int runahead_count)
+{
+   int frame_number;
+   unsigned slots = runahead_count + 1;
+   bool changed   = false;
+   bool keep      = false;
+   bool shown     = false;
+
+   if (runahead_save_state_list->size != (int)slots)
+   {
+      if (!runahead_ring_leave())
+      {
+         runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return;
+      }
+      mylist_resize(runahead_save_state_list, slots, true);
+      runahead_ring_base = 0;
+   }
+
+   /* The core was reset or had a state loaded since the last
+    * frame, whatever it holds now is the real state. */
+   if (input_is_dirty)
+      runahead_ring_ahead = 0;
+
+   input_driver_poll();
+   changed = input_state_refresh() || runahead_force_input_dirty;
+   runahead_ring_frames++;
+
+   if (!changed && runahead_ring_ahead == (unsigned)runahead_count)
+   {
+      /* The frames run ahead still hold, only add one more.
+       * Its state takes the slot of the real state, which
+       * moves up a frame. */
+      runahead_ring_input_missed = false;
+      runahead_core_run_with_input(input_state_get_last_or_live);
+
+      if (!runahead_ring_input_missed)
+      {
+         if (!runahead_save_state_to(runahead_ring_base))
+         {
+            runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+            return;
+         }
+
+         runahead_ring_base          = (runahead_ring_base + 1) % slots;
+         runahead_ring_input_changed = false;
+         input_is_dirty              = false;
+         return;
+      }
+
+      /* The core asked for input that the frames run ahead
+       * read as 0. Redo them all from the real state, which
+       * is still in its slot; this frame was already shown
+       * and heard, so none of them are. */
+      changed = true;
+      shown   = true;
+   }
+
+   if (runahead_ring_ahead && !runahead_ring_leave())
+   {
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return;
+   }
+
+   runahead_ring_rollbacks++;
+
+   /* Saving every frame run ahead only pays off if the input
+    * then stays the same for a while, so don't while it keeps
+    * changing (e.g. an analog stick being moved). Once it
+    * settles, save them right away so the next frame can
+    * already reuse them. */
+   keep = shown || !(changed && runahead_ring_input_changed);
+
+   for (frame_number = 0; frame_number <= runahead_count; frame_number++)
+   {
+      bool suspended_frame = shown || frame_number != runahead_count;
+
+      if (suspended_frame)
+      {
+         audio_suspended     = true;
+         video_driver_active = false;
+      }
+
+      if (frame_number == 0)
+         runahead_core_run_with_input(retro_ctx.state_cb);
+      else
+         runahead_core_run_use_last_input();
+
+      if (suspended_frame)
+      {
+         runahead_resume_video();
+         audio_suspended = false;
+      }
+
+      if (frame_number == 0 || keep)
+      {
+         if (!runahead_save_state_to(
+                  (runahead_ring_base + 1 + frame_number) % slots))
+         {
+            runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+            return;
+         }
+      }
+   }
+
+   runahead_ring_base          = (runahead_ring_base + 1) % slots;
+   runahead_ring_input_changed = changed;
+   input_is_dirty              = false;
+
+   if (keep)
+      runahead_ring_ahead      = runahead_count;
+   else if (!runahead_load_state_from(runahead_ring_base))
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+}
+
 static void do_runahead(int runahead_count, bool use_secondary)
 {
    int frame_number        = 0;
    bool last_frame         = false;
    bool suspended_frame    = false;
+   bool use_ring           = false;
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
    const bool have_dynamic = true;
 #else
@@ -24160,14 +26928,31 @@ static void do_runahead(int runahead_count, bool use_secondary)
    /* Check for GUI */
    /* Hack: If we were in the GUI, force a resync. */
    if (frame_count != runahead_last_frame_count + 1)
+   {
       runahead_force_input_dirty = true;
+      /* The core might have been run without Run Ahead in the
+       * meantime, so continue from whatever state it is in. */
+      runahead_ring_ahead        = 0;
+   }
 
    runahead_last_frame_count = frame_count;
 
-   if (!use_secondary || !have_dynamic || !runahead_secondary_core_available)
+   use_ring = (!use_secondary || !have_dynamic
+         || !runahead_secondary_core_available)
+      && configuration_settings->bools.run_ahead_reuse_frames
+      /* Querying the input again would end up in the movie */
+      && !bsv_movie_state_handle;
+
+   if (!use_ring && !runahead_ring_leave())
+   {
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return;
+   }
+
+   if (use_ring)
+      do_runahead_ring(runahead_count);
+   else if (!use_secondary || !have_dynamic || !runahead_secondary_core_available)
    {
-      /* TODO: multiple savestates for higher performance
-       * when not using secondary core */
       for (frame_number = 0; frame_number <= runahead_count; frame_number++)
       {
          last_frame      = frame_number == runahead_count;
@@ -24227,6 +27012,9 @@ static void do_runahead(int runahead_count, bool use_secondary)
 
       if (input_is_dirty || runahead_force_input_dirty)
       {
+         retro_time_t sync_start = cpu_features_get_time_usec();
+         retro_time_t sync_time;
+
          input_is_dirty       = false;
 
          if (!runahead_save_state())
@@ -24235,36 +27023,240 @@ static void do_runahead(int runahead_count, bool use_secondary)
             return;
          }
 
-         if (!runahead_load_state_secondary())
-         {
-            runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-            return;
-         }
+         if (!runahead_load_state_secondary())
+         {
+            runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+            return;
+         }
+
+         sync_time                     = cpu_features_get_time_usec()
+            - sync_start;
+         runahead_secondary_syncs++;
+         runahead_secondary_sync_time += sync_time;
+         if (sync_time > runahead_secondary_sync_peak)
+            runahead_secondary_sync_peak = sync_time;
+
+         for (frame_number = 0; frame_number < runahead_count - 1; frame_number++)
+         {
+            video_driver_active = false;
+            audio_suspended     = true;
+            hard_disable_audio  = true;
+            runahead_run_secondary();
+            hard_disable_audio  = false;
+            audio_suspended     = false;
+            runahead_resume_video();
+         }
+      }
+      audio_suspended    = true;
+      hard_disable_audio = true;
+      runahead_run_secondary();
+      hard_disable_audio = false;
+      audio_suspended    = false;
+#endif
+   }
+   runahead_force_input_dirty = false;
+   return;
+
+force_input_dirty:
+   core_run();
+   runahead_force_input_dirty = true;
+}
+
+/* Part of a frame Run-Ahead may take up, the rest is left
+ * to the video and audio drivers. */
+#define RUNAHEAD_BENCHMARK_BUDGET 0.8
+
+/* Frames that can be run ahead when each frame costs fixed
+ * usec plus per_frame usec for the real and every extra frame. */
+static int runahead_benchmark_limit(double budget,
+      double fixed, double per_frame)
+{
+   int frames;
+
+   if (per_frame <= 0.0 || budget <= fixed)
+      return 0;
+
+   frames = (int)((budget - fixed) / per_frame) - 1;
+   return frames > 0 ? frames : 0;
+}
+
+/* Runs the core for a number of frames from its current state,
+ * saving and loading a state after each, then puts the state
+ * back. Reports the average cost of each step and how many
+ * frames the different Run-Ahead modes could keep up with. */
+static void runahead_benchmark(unsigned frames)
+{
+   unsigned i;
+   retro_ctx_size_info_t info;
+   char msg[256];
+   double run, save, load, secondary_load, budget;
+   int single, reuse, second;
+   retro_time_t secondary_load_time = 0;
+   unsigned secondary_loads = 0;
+   retro_time_t run_time    = 0;
+   retro_time_t save_time   = 0;
+   retro_time_t load_time   = 0;
+   retro_time_t run_peak    = 0;
+   retro_time_t save_peak   = 0;
+   retro_time_t load_peak   = 0;
+   void *start              = NULL;
+   void *state              = NULL;
+   bool video_active        = video_driver_active;
+   bool okay                = true;
+   double fps               = video_driver_av_info.timing.fps;
+
+   msg[0]                   = '\0';
+
+   if (bsv_movie_state_handle
+#ifdef HAVE_NETWORKING
+         || netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL)
+#endif
+#ifdef HAVE_CHEEVOS
+         || rcheevos_hardcore_active
+#endif
+      )
+   {
+      RARCH_WARN("[Run-Ahead]: Benchmark is not available while "
+            "recording a movie, in netplay or in hardcore mode.\n");
+      return;
+   }
+
+   /* Start from the real state, not from frames run ahead */
+   runahead_ring_leave();
+
+   request_fast_savestate = true;
+   core_serialize_size(&info);
+
+   if (info.size == 0 || fps <= 0.0)
+   {
+      request_fast_savestate = false;
+      RARCH_WARN("[Run-Ahead]: Benchmark needs a core that supports savestates.\n");
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_CORE_DOES_NOT_SUPPORT_SAVESTATES), 0, 2 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return;
+   }
+
+   start = state_pool_get(info.size);
+   state = state_pool_get(info.size);
+
+   if (!start || !state || !current_core.retro_serialize(start, info.size))
+   {
+      okay = false;
+      goto end;
+   }
+
+   RARCH_LOG("[Run-Ahead]: Benchmarking %u frames...\n", frames);
+
+   audio_suspended     = true;
+   video_driver_active = false;
+
+   for (i = 0; i < frames; i++)
+   {
+      retro_time_t ran, saved, loaded;
+      retro_time_t begin = cpu_features_get_time_usec();
+
+      core_run();
+      ran = cpu_features_get_time_usec();
+
+      if (!current_core.retro_serialize(state, info.size))
+      {
+         okay = false;
+         break;
+      }
+      saved = cpu_features_get_time_usec();
+
+      if (!current_core.retro_unserialize(state, info.size))
+      {
+         okay = false;
+         break;
+      }
+      loaded     = cpu_features_get_time_usec();
+
+      run_time  += ran    - begin;
+      save_time += saved  - ran;
+      load_time += loaded - saved;
+      if (ran - begin > run_peak)
+         run_peak  = ran - begin;
+      if (saved - ran > save_peak)
+         save_peak = saved - ran;
+      if (loaded - saved > load_peak)
+         load_peak = loaded - saved;
+   }
+
+   audio_suspended     = false;
+   video_driver_active = video_active;
 
-         for (frame_number = 0; frame_number < runahead_count - 1; frame_number++)
-         {
-            video_driver_active = false;
-            audio_suspended     = true;
-            hard_disable_audio  = true;
-            runahead_run_secondary();
-            hard_disable_audio  = false;
-            audio_suspended     = false;
-            runahead_resume_video();
-         }
+#if HAVE_DYNAMIC
+   /* A second instance loads the state into another copy of
+    * the core, which may not cost what loading it back does */
+   if (     okay && i > 0
+         && configuration_settings->bools.run_ahead_secondary_instance
+         && runahead_secondary_core_available
+         && secondary_core_ensure_exists())
+   {
+      for (secondary_loads = 0; secondary_loads < i; secondary_loads++)
+      {
+         retro_time_t begin = cpu_features_get_time_usec();
+
+         if (!secondary_core.retro_unserialize(state, info.size))
+            break;
+
+         secondary_load_time += cpu_features_get_time_usec() - begin;
       }
-      audio_suspended    = true;
-      hard_disable_audio = true;
-      runahead_run_secondary();
-      hard_disable_audio = false;
-      audio_suspended    = false;
-#endif
    }
-   runahead_force_input_dirty = false;
-   return;
+#endif
 
-force_input_dirty:
-   core_run();
+   if (!current_core.retro_unserialize(start, info.size))
+      okay = false;
+
+   if (!okay || i == 0)
+      goto end;
+
+   run    = (double)run_time  / i;
+   save   = (double)save_time / i;
+   load   = (double)load_time / i;
+   secondary_load = secondary_loads
+      ? (double)secondary_load_time / secondary_loads : load;
+   budget = RUNAHEAD_BENCHMARK_BUDGET * 1000000.0 / fps;
+
+   /* A single instance loads, runs the real frame, saves it and
+    * runs the frames ahead. Reusing frames also saves each frame
+    * whenever it has to redo them. A second instance saves the
+    * real frame, loads it into the other instance and runs the
+    * frames ahead there. */
+   single = runahead_benchmark_limit(budget, load + save, run);
+   reuse  = runahead_benchmark_limit(budget, load, run + save);
+   second = runahead_benchmark_limit(budget, secondary_load + save, run);
+
+   RARCH_LOG("[Run-Ahead]: Savestate size: %u bytes.\n", (unsigned)info.size);
+   RARCH_LOG("[Run-Ahead]: Run: %.3f ms (peak %.3f ms).\n",
+         run / 1000.0, run_peak / 1000.0);
+   RARCH_LOG("[Run-Ahead]: Serialize: %.3f ms (peak %.3f ms).\n",
+         save / 1000.0, save_peak / 1000.0);
+   RARCH_LOG("[Run-Ahead]: Unserialize: %.3f ms (peak %.3f ms).\n",
+         load / 1000.0, load_peak / 1000.0);
+   if (secondary_loads)
+      RARCH_LOG("[Run-Ahead]: Unserialize (second instance): %.3f ms.\n",
+            secondary_load / 1000.0);
+   RARCH_LOG("[Run-Ahead]: Frames within %.3f ms: %d single instance, "
+         "%d reusing frames, %d second instance.\n",
+         budget / 1000.0, single, reuse, second);
+
+   snprintf(msg, sizeof(msg),
+         msg_hash_to_str(MSG_RUNAHEAD_BENCHMARK_RESULT),
+         single, reuse, second);
+   runloop_msg_queue_push(msg, 1, 5 * 60, true, NULL,
+         MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+
+end:
+   request_fast_savestate     = false;
    runahead_force_input_dirty = true;
+   input_is_dirty             = true;
+
+   if (!okay)
+      RARCH_ERR("[Run-Ahead]: Benchmark failed to save or load a state.\n");
+
+   state_pool_put(start);
+   state_pool_put(state);
 }
 #endif
 
@@ -24541,6 +27533,20 @@ static void retroarch_print_help(const char *arg0)
             "                        Takes a screenshot at the end of max-frames.\n", sizeof(buf));
       strlcat(buf, "      --max-frames-ss-path=FILE\n"
             "                        Path to save the screenshot to at the end of max-frames.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark=FILE  Replays the button presses of a benchmark script,\n"
+            "                        timing each of its steps, then exits.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark-out=FILE\n"
+            "                        Path to write the benchmark results to, as JSON.\n", sizeof(buf));
+      strlcat(buf, "      --benchmark-frames=NUMBER\n"
+            "                        Without a script, runs the content as fast as it goes\n"
+            "                        for the specified number of frames, then exits.\n"
+            "                        Use with --play to replay a movie's input, and with\n"
+            "                        the null video and audio drivers to run headless.\n", sizeof(buf));
+#ifdef HAVE_RUNAHEAD
+      strlcat(buf, "      --runahead-benchmark=NUMBER\n"
+            "                        Measures the cost of Run-Ahead over the specified\n"
+            "                        number of frames once content is running.\n", sizeof(buf));
+#endif
       puts(buf);
    }
    printf("      --accessibility\n"
@@ -24631,6 +27637,12 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
       { "max-frames",         1, NULL, RA_OPT_MAX_FRAMES },
       { "max-frames-ss",      0, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT },
       { "max-frames-ss-path", 1, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT_PATH },
+      { "benchmark",          1, NULL, RA_OPT_BENCHMARK },
+      { "benchmark-out",      1, NULL, RA_OPT_BENCHMARK_OUT },
+      { "benchmark-frames",   1, NULL, RA_OPT_BENCHMARK_FRAMES },
+#ifdef HAVE_RUNAHEAD
+      { "runahead-benchmark", 1, NULL, RA_OPT_RUNAHEAD_BENCHMARK },
+#endif
       { "eof-exit",           0, NULL, RA_OPT_EOF_EXIT },
       { "version",            0, NULL, RA_OPT_VERSION },
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
@@ -25107,6 +28119,24 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
                strlcpy(runloop_max_frames_screenshot_path, optarg, sizeof(runloop_max_frames_screenshot_path));
                break;
 
+            case RA_OPT_BENCHMARK:
+               strlcpy(runloop_benchmark_script, optarg, sizeof(runloop_benchmark_script));
+               break;
+
+            case RA_OPT_BENCHMARK_OUT:
+               strlcpy(runloop_benchmark_out, optarg, sizeof(runloop_benchmark_out));
+               break;
+
+            case RA_OPT_BENCHMARK_FRAMES:
+               runloop_benchmark_frames = (unsigned)strtoul(optarg, NULL, 10);
+               break;
+
+#ifdef HAVE_RUNAHEAD
+            case RA_OPT_RUNAHEAD_BENCHMARK:
+               runahead_benchmark_frames = (unsigned)strtoul(optarg, NULL, 10);
+               break;
+#endif
+
             case RA_OPT_SUBSYSTEM:
                path_set(RARCH_PATH_SUBSYSTEM, optarg);
                break;
@@ -25351,8 +28381,23 @@ bool retroarch_main_init(int argc, char *argv[])
    /* Have to initialise non-file logging once at the start... */
    retro_main_log_file_init(NULL, false);
 
+   startup_stage_begin(STARTUP_STAGE_CONFIG);
    retroarch_parse_input_and_config(argc, argv);
 
+   /* Keeps running through the content loads of the script */
+   if (!string_is_empty(runloop_benchmark_script) || runloop_benchmark_frames)
+   {
+      if (string_is_empty(runloop_benchmark_out))
+         fill_pathname_join(runloop_benchmark_out,
+               configuration_settings->paths.log_dir,
+               "retroarch_benchmark.json", sizeof(runloop_benchmark_out));
+      benchmark_init(runloop_benchmark_script,
+            runloop_benchmark_frames, runloop_benchmark_out);
+      runloop_benchmark_script[0] = '\0';
+      runloop_benchmark_out[0]    = '\0';
+      runloop_benchmark_frames    = 0;
+   }
+
 #ifdef HAVE_ACCESSIBILITY
    if (is_accessibility_enabled())
       accessibility_startup_message();
@@ -25413,6 +28458,17 @@ bool retroarch_main_init(int argc, char *argv[])
 
    retroarch_validate_cpu_features();
    retroarch_init_task_queue();
+   startup_stage_end(STARTUP_STAGE_CONFIG);
+
+   if (configuration_settings->bools.trace_enable)
+      rarch_trace_init();
+
+   if (configuration_settings->bools.latency_test_enable)
+      latency_test_init(configuration_settings->paths.latency_test_sensor);
+
+#ifdef HAVE_COMPRESSION
+   file_archive_cache_init();
+#endif
 
    {
       const char    *fullpath  = path_get(RARCH_PATH_CONTENT);
@@ -25479,6 +28535,7 @@ bool retroarch_main_init(int argc, char *argv[])
 #endif
 
    /* Attempt to initialize core */
+   startup_stage_begin(STARTUP_STAGE_CORE);
    if (has_set_core)
    {
       has_set_core = false;
@@ -25512,7 +28569,11 @@ bool retroarch_main_init(int argc, char *argv[])
 
    cheat_manager_state_free();
    command_event_init_cheats();
+   startup_stage_end(STARTUP_STAGE_CORE);
+
+   startup_stage_begin(STARTUP_STAGE_DRIVERS);
    drivers_init(DRIVERS_CMD_ALL);
+   startup_stage_end(STARTUP_STAGE_DRIVERS);
    input_driver_deinit_command();
    input_driver_init_command();
    input_driver_deinit_remote();
@@ -25913,6 +28974,8 @@ void retroarch_init_task_queue(void)
 #endif
    task_queue_deinit();
    task_queue_init(threaded_enable, runloop_task_msg_queue_push);
+   /* Shared by the image tasks */
+   video_image_cache_init();
 }
 
 bool rarch_ctl(enum rarch_ctl_state state, void *data)
@@ -25971,6 +29034,7 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          command_event(CMD_EVENT_CORE_DEINIT, NULL);
 
          content_deinit();
+         state_pool_deinit();
 
          path_deinit_subsystem();
          path_deinit_savefile();
@@ -26435,6 +29499,14 @@ const char* retroarch_get_shader_preset(void)
    return NULL;
 }
 
+/* set the runtime shader preset, NULL or empty to unset it */
+void retroarch_set_shader_preset(const char *preset_path)
+{
+#if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
+   retroarch_set_runtime_shader_preset(preset_path);
+#endif
+}
+
 bool retroarch_override_setting_is_set(enum rarch_override_setting enum_idx, void *data)
 {
    switch (enum_idx)
@@ -26670,6 +29742,8 @@ void runloop_msg_queue_push(const char *msg,
          msg_queue_push(runloop_msg_queue, msg,
                prio, duration,
                title, icon, category);
+
+      video_driver_msg_pending = true;
    }
 
    ui_companion_driver_msg_queue_push(msg,
@@ -26863,6 +29937,80 @@ static bool menu_display_libretro(void)
    video_driver_cached_frame();
    return true;
 }
+
+static bool menu_task_finder_any(retro_task_t *task, void *user_data)
+{
+   return true;
+}
+
+/* Menu drivers with a static frame (frame_is_static)
+ * still draw all of it each frame. When
+ * nothing that shows in it has changed since the last
+ * frames drawn, the previous frame is left on screen
+ * instead. A few frames are drawn after each change,
+ * so that every buffer of the swap chain is up to date,
+ * and one each second keeps the clock and battery
+ * level current. */
+#define MENU_IDLE_REDRAW_FRAMES   3
+#define MENU_IDLE_REDRAW_INTERVAL 1000000
+
+static bool menu_driver_frame_is_idle(enum menu_action action,
+      const input_bits_t *current_bits, const input_bits_t *old_input,
+      bool display_kb)
+{
+   static unsigned redraw_frames      = 0;
+   static retro_time_t last_redraw    = 0;
+   static int16_t last_pointer_x      = 0;
+   static int16_t last_pointer_y      = 0;
+   static unsigned last_width         = 0;
+   static unsigned last_height        = 0;
+   settings_t *settings               = configuration_settings;
+   menu_input_pointer_hw_state_t *ptr = &menu_input_pointer_hw_state;
+   retro_time_t now                   = cpu_features_get_time_usec();
+   task_finder_data_t find_data;
+
+   if (!settings->bools.menu_skip_idle_frames)
+      return false;
+
+   if (!menu_driver_frame_is_static())
+      return false;
+
+   find_data.func     = menu_task_finder_any;
+   find_data.userdata = NULL;
+
+   if (     action != MENU_ACTION_NOOP
+         || memcmp(current_bits, old_input, sizeof(*current_bits))
+         || display_kb
+         || menu_driver_is_binding
+         || menu_animation_is_active()
+         || menu_entries_ctl(MENU_ENTRIES_CTL_NEEDS_REFRESH, NULL)
+         || menu_display_libretro_running()
+         || video_driver_msg_pending
+         || settings->bools.video_fps_show
+         || settings->bools.video_statistics_show
+         || settings->bools.video_framecount_show
+         || settings->bools.video_memory_show
+         || ptr->active
+         || ptr->x != last_pointer_x
+         || ptr->y != last_pointer_y
+         || video_driver_width  != last_width
+         || video_driver_height != last_height
+         || now - last_redraw >= MENU_IDLE_REDRAW_INTERVAL
+         || task_queue_find(&find_data))
+      redraw_frames = MENU_IDLE_REDRAW_FRAMES;
+
+   last_pointer_x = ptr->x;
+   last_pointer_y = ptr->y;
+   last_width     = video_driver_width;
+   last_height    = video_driver_height;
+
+   if (!redraw_frames)
+      return true;
+
+   redraw_frames--;
+   last_redraw = now;
+   return false;
+}
 #endif
 
 static void update_savestate_slot(void)
@@ -26958,6 +30106,9 @@ static enum runloop_state runloop_check_state(void)
 #endif
       input_keys_pressed(&current_bits);
 
+   if (!benchmark_frame(&current_bits))
+      runloop_shutdown_initiated = true;
+
 #ifdef HAVE_MENU
    last_input                       = current_bits;
    if (
@@ -26967,6 +30118,9 @@ static enum runloop_state runloop_check_state(void)
       BIT256_SET(current_bits, RARCH_MENU_TOGGLE);
 #endif
 
+   runloop_input_held = bits_any_set(current_bits.data,
+         ARRAY_SIZE(current_bits.data));
+
    if (input_driver_flushing_input)
    {
       input_driver_flushing_input = false;
@@ -27231,6 +30385,19 @@ static enum runloop_state runloop_check_state(void)
       if (!menu_driver_iterate(&iter))
          retroarch_menu_running_finished(false);
 
+      if (menu_driver_frame_is_idle(action, &current_bits, &old_input,
+               display_kb))
+      {
+         /* Menu audio still needs its samples */
+         if (     (focused || !runloop_idle)
+               && settings->bools.audio_enable_menu)
+            audio_driver_menu_sample();
+
+         old_input  = current_bits;
+         old_action = action;
+         return RUNLOOP_STATE_POLLED_AND_SLEEP;
+      }
+
       if (focused || !runloop_idle)
       {
          bool libretro_running    = menu_display_libretro_running();
@@ -27655,9 +30822,10 @@ static enum runloop_state runloop_check_state(void)
 
          if (!timer.timer_end && rarch_timer_has_expired(&timer))
          {
+            bool reload   = true;
             rarch_timer_end(&timer);
             need_to_apply = false;
-            command_event(CMD_EVENT_SHADERS_APPLY_CHANGES, NULL);
+            command_event(CMD_EVENT_SHADERS_APPLY_CHANGES, &reload);
          }
       }
    }
@@ -27687,6 +30855,295 @@ static enum runloop_state runloop_check_state(void)
    return RUNLOOP_STATE_ITERATE;
 }
 
+/* Headroom left between the end of a frame and the flip. */
+#define FRAME_DELAY_AUTO_MARGIN_USEC 2000
+
+/* How fast the peak estimate recovers after a heavy frame,
+ * per frame. Slow enough to ride out scene-to-scene spikes. */
+#define FRAME_DELAY_AUTO_DECAY_USEC  50
+
+/**
+ * runloop_frame_delay_auto:
+ *
+ * Picks the frame delay that starts core_run as late as
+ * possible while still finishing the frame before the next
+ * page flip, based on the recent peak frame work.
+ *
+ * Returns: frame delay in milliseconds.
+ **/
+static unsigned runloop_frame_delay_auto(settings_t *settings)
+{
+   retro_time_t delay;
+   float refresh_rate      = settings->floats.video_refresh_rate;
+   unsigned swap_interval  = settings->uints.video_swap_interval;
+
+   if (refresh_rate <= 0.0f)
+      return 0;
+
+   if (swap_interval < 1)
+      swap_interval = 1;
+
+   delay = (retro_time_t)(1000000.0f * swap_interval / refresh_rate)
+      - frame_delay_auto_peak - FRAME_DELAY_AUTO_MARGIN_USEC;
+
+   if (delay <= 0)
+      return 0;
+   if (delay > 15000)
+      return 15;
+   return (unsigned)(delay / 1000);
+}
+
+/**
+ * runloop_perf_profile_init:
+ *
+ * Starts measuring the content just loaded and, from the
+ * performance profile in its runtime log, limits frame delay
+ * and Run-Ahead to what fits in a frame on this device.
+ * The limits only ever lower the settings and are not saved.
+ **/
+static void runloop_perf_profile_init(settings_t *settings)
+{
+   rtl_perf_t perf;
+   double budget;
+   runtime_log_t *runtime_log = NULL;
+   float refresh_rate         = settings->floats.video_refresh_rate;
+   unsigned swap_interval     = settings->uints.video_swap_interval;
+
+   memset(&runloop_perf_core,  0, sizeof(runloop_perf_core));
+   memset(&runloop_perf_video, 0, sizeof(runloop_perf_video));
+   runloop_perf_run_ahead_frames = 0;
+   runloop_perf_frame_delay_max  = UINT_MAX;
+   runloop_perf_run_ahead_max    = UINT_MAX;
+   runloop_perf_enable           = settings->bools.content_perf_profile
+      && settings->bools.content_runtime_log;
+
+   if (!runloop_perf_enable || refresh_rate <= 0.0f)
+      return;
+
+   runtime_log = runtime_log_init(
+         runtime_content_path,
+         runtime_core_path,
+         settings->paths.directory_runtime_log,
+         settings->paths.directory_playlist,
+         true);
+
+   if (!runtime_log)
+      return;
+
+   perf = runtime_log->perf;
+   free(runtime_log);
+
+   if (!perf.frames)
+      return;
+
+   if (swap_interval < 1)
+      swap_interval = 1;
+
+   budget = 1000000.0 * swap_interval / refresh_rate;
+   /* It crackled last time, leave more room */
+   if (perf.underruns)
+      budget *= 0.9;
+
+   {
+      double delay = (budget - perf.core_run_p95
+            - FRAME_DELAY_AUTO_MARGIN_USEC) / 1000.0;
+
+      if (delay <= 0.0)
+         runloop_perf_frame_delay_max = 0;
+      else if (delay >= 15.0)
+         runloop_perf_frame_delay_max = 15;
+      else
+         runloop_perf_frame_delay_max = (unsigned)delay;
+
+      /* Auto frame delay starts from the known peak
+       * rather than from nothing */
+      if (frame_delay_auto_peak < perf.core_run_p95)
+         frame_delay_auto_peak = perf.core_run_p95;
+   }
+
+#ifdef HAVE_RUNAHEAD
+   {
+      /* The core frame, without the video driver, was run
+       * once per Run-Ahead frame plus the real one */
+      double per_frame = ((double)perf.core_run_p95 - perf.video_p95)
+         / (perf.run_ahead_frames + 1);
+
+      if (per_frame < 1.0)
+         per_frame = 1.0;
+
+      runloop_perf_run_ahead_max = (unsigned)runahead_benchmark_limit(
+            budget * RUNAHEAD_BENCHMARK_BUDGET, perf.video_p95, per_frame);
+   }
+#endif
+
+   RARCH_LOG("[Perf]: Profile of %u frames, core p95 %u usec, video p95 %u usec:"
+         " frame delay up to %u ms, Run-Ahead up to %u frames.\n",
+         perf.frames, perf.core_run_p95, perf.video_p95,
+         runloop_perf_frame_delay_max,
+         runloop_perf_run_ahead_max == UINT_MAX
+         ? 0 : runloop_perf_run_ahead_max);
+}
+
+/* Frames in a row auto frameskip may drop, so something
+ * still gets shown when the core is hopelessly slow */
+#define FRAMESKIP_AUTO_MAX 3
+
+/**
+ * runloop_audio_buffer_status_update:
+ *
+ * Tells the core how full the audio buffer is, if it asked.
+ **/
+static void runloop_audio_buffer_status_update(settings_t *settings)
+{
+   unsigned occupancy = 0;
+   bool active        = audio_driver_get_occupancy(&occupancy);
+
+   runloop_audio_buffer_status.callback(active, occupancy,
+         active && occupancy < settings->uints.video_frameskip_auto_threshold);
+}
+
+/**
+ * runloop_frameskip_auto:
+ *
+ * Decides whether the video output of the next frame is to be
+ * dropped: while the audio buffer runs low, or without audio
+ * rate control, while frames come slower than the refresh rate.
+ *
+ * Returns: true to drop it.
+ **/
+static bool runloop_frameskip_auto(settings_t *settings)
+{
+   static unsigned skipped      = 0;
+   static retro_time_t last     = 0;
+   unsigned occupancy           = 0;
+   bool skip                    = false;
+   retro_time_t now             = cpu_features_get_time_usec();
+   retro_time_t interval        = last ? now - last : 0;
+   float refresh_rate           = settings->floats.video_refresh_rate;
+
+   last                         = now;
+
+   /* Not when the core skips frames itself, when frames
+    * are meant to be fast, or all of them are needed */
+   if (     !settings->bools.video_frameskip_auto
+         || !video_driver_active
+         || runloop_audio_buffer_status.callback
+         || input_driver_nonblock_state
+         || recording_data
+         || runloop_slowmotion
+#ifdef HAVE_NETWORKING
+         || netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL)
+#endif
+         )
+   {
+      skipped = 0;
+      return false;
+   }
+
+   if (audio_driver_get_occupancy(&occupancy))
+      skip = occupancy < settings->uints.video_frameskip_auto_threshold;
+   else if (refresh_rate > 0.0f)
+   {
+      retro_time_t period = (retro_time_t)(1000000.0f / refresh_rate);
+      skip                = interval > period + period / 8;
+   }
+
+   if (skip && skipped < FRAMESKIP_AUTO_MAX)
+   {
+      skipped++;
+      return true;
+   }
+
+   skipped = 0;
+   return false;
+}
+
+/**
+ * runloop_fastforward_skip:
+ *
+ * While fast forwarding, frames are shown at most at the
+ * refresh rate; there's no point drawing the others.
+ *
+ * Returns: true to drop the video of the next frame.
+ **/
+static bool runloop_fastforward_skip(settings_t *settings)
+{
+   static retro_time_t last_shown = 0;
+   retro_time_t now;
+   retro_time_t period;
+   float refresh_rate             = settings->floats.video_refresh_rate;
+
+   /* The benchmark times every frame */
+   if (     !input_driver_nonblock_state
+         || !settings->bools.fastforward_frameskip
+         || benchmark_is_active()
+         || !video_driver_active
+         || recording_data
+         || refresh_rate <= 0.0f)
+   {
+      last_shown = 0;
+      return false;
+   }
+
+   now    = cpu_features_get_time_usec();
+   period = (retro_time_t)(1000000.0f / refresh_rate);
+
+   if (last_shown && now - last_shown < period)
+      return true;
+
+   last_shown = now;
+   return false;
+}
+
+/* Longest an idle runloop waits for input, for what doesn't
+ * come through it: messages, network commands. Finished tasks
+ * end the wait through task_queue_wakeup_fd on Linux. */
+#define RUNLOOP_IDLE_WAIT_MS 100
+
+/* Sleeps until there is input, or coarsely when the input driver
+ * can't tell. Held buttons keep the short sleep, menu repeat
+ * and hotkey timing go by the clock, not by events. */
+static void runloop_idle_sleep(void)
+{
+   if (     runloop_input_held
+         || !current_input
+         || !current_input->wait
+         || !current_input->wait(current_input_data, RUNLOOP_IDLE_WAIT_MS))
+      retro_sleep(10);
+}
+
+/* Left to spinning before a frame limit deadline, of what
+ * sleeping would likely oversleep */
+#if defined(__linux__) && defined(TIMER_ABSTIME)
+#define RUNLOOP_FRAME_LIMIT_SPIN_USEC 200
+#else
+#define RUNLOOP_FRAME_LIMIT_SPIN_USEC 2000
+#endif
+
+/* Waits until @deadline, as told by cpu_features_get_time_usec() */
+static void runloop_frame_limit_wait(retro_time_t deadline)
+{
+   retro_time_t wake = deadline - RUNLOOP_FRAME_LIMIT_SPIN_USEC;
+
+#if defined(__linux__) && defined(TIMER_ABSTIME)
+   /* Same clock as cpu_features_get_time_usec(); an absolute
+    * deadline doesn't drift with how long the call took */
+   struct timespec ts;
+
+   ts.tv_sec  = (time_t)(wake / 1000000);
+   ts.tv_nsec = (long)(wake % 1000000) * 1000;
+
+   while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+   retro_time_t now = cpu_features_get_time_usec();
+
+   if (wake - now >= 1000)
+      retro_sleep((unsigned)((wake - now) / 1000));
+#endif
+
+   while (cpu_features_get_time_usec() < deadline);
+}
+
 /**
  * runloop_iterate:
  *
@@ -27702,8 +31159,21 @@ int runloop_iterate(void)
    settings_t *settings                         = configuration_settings;
    float fastforward_ratio                      = settings->floats.fastforward_ratio;
    unsigned video_frame_delay                   = settings->uints.video_frame_delay;
+   bool core_run_timed                          = video_driver_get_present_wait() >= 0
+      && !video_driver_is_threaded_internal();
+   bool video_frame_delay_auto                  = settings->bools.video_frame_delay_auto
+      && core_run_timed;
+   float video_refresh_rate                     = settings->floats.video_refresh_rate;
+   retro_time_t core_run_start                  = 0;
+   retro_time_t core_run_work                   = -1;
+   retro_time_t pacing_start                    = 0;
+   retro_time_t pacing_nested                   = 0;
    bool vrr_runloop_enable                      = settings->bools.vrr_runloop_enable;
    unsigned max_users                           = input_driver_max_users;
+   enum runloop_state state;
+
+   video_driver_frame_pacing_next(settings->bools.video_statistics_show,
+         video_refresh_rate);
 
 #ifdef HAVE_DISCORD
    if (discord_is_inited)
@@ -27737,7 +31207,11 @@ int runloop_iterate(void)
       runloop_frame_time.callback(delta);
    }
 
-   switch ((enum runloop_state)runloop_check_state())
+   pacing_start = video_driver_frame_pacing_begin();
+   state        = runloop_check_state();
+   video_driver_frame_pacing_add(FRAME_PACING_INPUT, pacing_start);
+
+   switch (state)
    {
       case RUNLOOP_STATE_QUIT:
          frame_limit_last_time = 0.0;
@@ -27752,7 +31226,8 @@ int runloop_iterate(void)
 #if defined(HAVE_COCOATOUCH)
          if (!main_ui_companion_is_on_foreground)
 #endif
-            retro_sleep(10);
+            runloop_idle_sleep();
+         frontend_driver_update_frame_timing(0, 0, 0, true);
          return 1;
       case RUNLOOP_STATE_END:
 #ifdef HAVE_NETWORKING
@@ -27762,12 +31237,14 @@ int runloop_iterate(void)
             )
             netplay_driver_ctl(RARCH_NETPLAY_CTL_PAUSE, NULL);
 #endif
+         frontend_driver_update_frame_timing(0, 0, 0, true);
          goto end;
       case RUNLOOP_STATE_MENU_ITERATE:
 #ifdef HAVE_NETWORKING
          /* FIXME: This is an ugly way to tell Netplay this... */
          netplay_driver_ctl(RARCH_NETPLAY_CTL_PAUSE, NULL);
 #endif
+         frontend_driver_update_frame_timing(0, 0, 0, true);
          return 0;
       case RUNLOOP_STATE_ITERATE:
          runloop_core_running = true;
@@ -27803,25 +31280,102 @@ int runloop_iterate(void)
       }
    }
 
+   if (video_frame_delay_auto)
+      video_frame_delay = runloop_frame_delay_auto(settings);
+
+   if (video_frame_delay > runloop_perf_frame_delay_max)
+      video_frame_delay = runloop_perf_frame_delay_max;
+
    if ((video_frame_delay > 0) && !input_driver_nonblock_state)
       retro_sleep(video_frame_delay);
 
+   core_run_start = cpu_features_get_time_usec();
+
+   if (runloop_audio_buffer_status.callback)
+      runloop_audio_buffer_status_update(settings);
+
+   /* The core's own time is what's left of core_run once
+    * the stages it calls back into are taken out */
+   if ((pacing_start = video_driver_frame_pacing_begin()))
+      for (i = 0; i < FRAME_PACING_STAGE_LAST; i++)
+         if (i != FRAME_PACING_CORE)
+            pacing_nested += video_driver_frame_pacing_stages[i];
+
    {
 #ifdef HAVE_RUNAHEAD
-      unsigned run_ahead_num_frames = settings->uints.run_ahead_frames;
+      unsigned run_ahead_num_frames = MIN(settings->uints.run_ahead_frames,
+            runloop_perf_run_ahead_max);
       /* Run Ahead Feature replaces the call to core_run in this loop */
       bool want_runahead            = settings->bools.run_ahead_enabled && run_ahead_num_frames > 0;
 #ifdef HAVE_NETWORKING
       want_runahead                 = want_runahead && !netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_ENABLED, NULL);
 #endif
 
+      runloop_perf_run_ahead_frames = want_runahead ? run_ahead_num_frames : 0;
+
+      if (runahead_benchmark_frames)
+      {
+         runahead_benchmark(runahead_benchmark_frames);
+         runahead_benchmark_frames = 0;
+      }
+
       if (want_runahead)
          do_runahead(run_ahead_num_frames, settings->bools.run_ahead_secondary_instance);
       else
 #endif
+      {
+         /* Without video, cores asking through
+          * GET_AUDIO_VIDEO_ENABLE don't render either */
+         bool frameskip = runloop_frameskip_auto(settings)
+            || runloop_fastforward_skip(settings);
+
+         if (frameskip)
+            video_driver_active = false;
          core_run();
+         if (frameskip)
+            video_driver_active = true;
+      }
+   }
+
+   /* Only the time not spent waiting for the flip counts,
+    * otherwise the delay would cancel itself out. */
+   if (core_run_timed)
+      core_run_work = cpu_features_get_time_usec() - core_run_start
+         - video_driver_get_present_wait();
+
+   if (pacing_start)
+   {
+      video_driver_frame_pacing_add(FRAME_PACING_CORE, pacing_start);
+      for (i = 0; i < FRAME_PACING_STAGE_LAST; i++)
+         if (i != FRAME_PACING_CORE)
+            video_driver_frame_pacing_stages[FRAME_PACING_CORE] -=
+               video_driver_frame_pacing_stages[i];
+      video_driver_frame_pacing_stages[FRAME_PACING_CORE] += pacing_nested;
+   }
+
+   if (benchmark_is_active())
+      benchmark_core_run(core_run_timed ? core_run_work
+            : cpu_features_get_time_usec() - core_run_start);
+
+   if (runloop_perf_enable && !input_driver_nonblock_state)
+      runloop_perf_add(&runloop_perf_core, core_run_timed ? core_run_work
+            : cpu_features_get_time_usec() - core_run_start);
+
+   if (video_frame_delay_auto)
+   {
+      if (core_run_work > frame_delay_auto_peak)
+         frame_delay_auto_peak = core_run_work;
+      else if (frame_delay_auto_peak > FRAME_DELAY_AUTO_DECAY_USEC)
+         frame_delay_auto_peak -= FRAME_DELAY_AUTO_DECAY_USEC;
    }
 
+   frontend_driver_update_frame_timing(core_run_work,
+         video_driver_frame_time_samples[(video_driver_frame_time_count - 1)
+         & (MEASURE_FRAME_TIME_SAMPLES_COUNT - 1)],
+         video_refresh_rate > 0.0f
+         ? (retro_time_t)(1000000.0f / video_refresh_rate) : 0,
+         false);
+
    /* Increment runtime tick counter after each call to
     * core_run() or run_ahead() */
    libretro_core_runtime_usec += rarch_core_runtime_tick();
@@ -27885,6 +31439,7 @@ end:
          if (fastforward_after_frames == 1)
          {
             /* Nonblocking audio */
+            audio_driver_worker_sync();
             if (audio_driver_active && audio_driver_context_audio_data)
                current_audio->set_nonblock_state(audio_driver_context_audio_data, true);
             audio_driver_chunk_size = audio_driver_chunk_nonblock_size;
@@ -27895,6 +31450,7 @@ end:
          if (fastforward_after_frames == 6)
          {
             /* Blocking audio */
+            audio_driver_worker_sync();
             if (audio_driver_active && audio_driver_context_audio_data)
                current_audio->set_nonblock_state(
                      audio_driver_context_audio_data,
@@ -27914,25 +31470,26 @@ end:
    }
 
    {
-      retro_time_t to_sleep_ms  = (
-            (frame_limit_last_time + frame_limit_minimum_time)
-            - cpu_features_get_time_usec()) / 1000;
+      retro_time_t deadline = frame_limit_last_time + frame_limit_minimum_time;
+      retro_time_t now      = cpu_features_get_time_usec();
 
-      if (to_sleep_ms > 0)
+      if (now < deadline)
       {
-         unsigned sleep_ms = (unsigned)to_sleep_ms;
-         /* Combat jitter a bit. */
-         frame_limit_last_time += frame_limit_minimum_time;
-         if (sleep_ms > 0)
+         frame_limit_last_time = deadline;
 #if defined(HAVE_COCOATOUCH)
-            if (!main_ui_companion_is_on_foreground)
+         if (!main_ui_companion_is_on_foreground)
 #endif
-               retro_sleep(sleep_ms);
+            runloop_frame_limit_wait(deadline);
          return 1;
       }
-   }
 
-   frame_limit_last_time  = cpu_features_get_time_usec();
+      /* Late by less than a frame, the next frames catch up;
+       * else starts over from now */
+      if (now - deadline < frame_limit_minimum_time)
+         frame_limit_last_time = deadline;
+      else
+         frame_limit_last_time = now;
+   }
 
    return 0;
 }
@@ -28041,11 +31598,20 @@ enum retro_language rarch_get_language_from_iso(const char *iso639)
 void rarch_favorites_init(void)
 {
    settings_t *settings      = configuration_settings;
+   playlist_t *favorites     = NULL;
    unsigned content_favorites_size;
 
    if (!settings)
       return;
 
+   /* Loaded during startup */
+   if ((favorites = (playlist_t*)startup_stage_take(STARTUP_STAGE_FAVORITES)))
+   {
+      rarch_favorites_deinit();
+      g_defaults.content_favorites = favorites;
+      return;
+   }
+
    if (settings->ints.content_favorites_size < 0)
       content_favorites_size = COLLECTION_SIZE;
    else
@@ -28088,7 +31654,12 @@ static int16_t core_input_state_poll_late(unsigned port,
       unsigned device, unsigned idx, unsigned id)
 {
    if (!current_core.input_polled)
-      input_driver_poll();
+   {
+      if (current_core.input_repoll)
+         input_driver_repoll();
+      else
+         input_driver_poll();
+   }
 
    current_core.input_polled = true;
    return input_state(port, device, idx, id);
@@ -28111,6 +31682,14 @@ static void core_input_state_poll_maybe(void)
       : current_core.poll_type;
    if (new_poll_type == POLL_TYPE_NORMAL)
       input_driver_poll();
+   else if (new_poll_type == POLL_TYPE_LATE && current_core.input_polled)
+   {
+      /* Polled again after reading input, the devices get read
+       * again at the next read so the core sees the state of
+       * that moment rather than the start of the frame. */
+      current_core.input_polled = false;
+      current_core.input_repoll = true;
+   }
 }
 
 /**
@@ -28264,6 +31843,22 @@ bool core_get_memory(retro_ctx_memory_info_t *info)
    return true;
 }
 
+void retroarch_memory_usage_update(void)
+{
+   uint64_t bytes = 0;
+
+   /* Only what the core lets us see of its memory */
+   if (current_core.inited && current_core.game_loaded)
+   {
+      bytes += current_core.retro_get_memory_size(RETRO_MEMORY_SAVE_RAM);
+      bytes += current_core.retro_get_memory_size(RETRO_MEMORY_RTC);
+      bytes += current_core.retro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM);
+      bytes += current_core.retro_get_memory_size(RETRO_MEMORY_VIDEO_RAM);
+   }
+
+   memory_usage_set(MEMORY_USAGE_CORE, bytes);
+}
+
 bool core_load_game(retro_ctx_load_content_info_t *load_info)
 {
    bool contentless = false;
@@ -28365,6 +31960,7 @@ bool core_run(void)
       : current_core.poll_type;
    bool early_polling     = new_poll_type == POLL_TYPE_EARLY;
    bool late_polling      = new_poll_type == POLL_TYPE_LATE;
+   retro_time_t trace_start;
 #ifdef HAVE_NETWORKING
    bool netplay_preframe = netplay_driver_ctl(
          RARCH_NETPLAY_CTL_PRE_FRAME, NULL);
@@ -28382,9 +31978,15 @@ bool core_run(void)
    if (early_polling)
       input_driver_poll();
    else if (late_polling)
+   {
       current_core.input_polled = false;
+      current_core.input_repoll = false;
+   }
 
+   trace_start            = rarch_trace_begin();
    current_core.retro_run();
+   rarch_trace_end("core_run", trace_start);
+   latency_test_core_run();
 
    if (late_polling && !current_core.input_polled)
       input_driver_poll();
@@ -78,6 +78,26 @@ RETRO_BEGIN_DECLS
                                             * 3 - Late
                                             */
 
+#define RETRO_ENVIRONMENT_GET_HOT_MEMORY_INTERFACE (5 | RETRO_ENVIRONMENT_RETROARCH_START_BLOCK)
+                                            /* struct retro_hot_memory_interface * --
+                                            * Gets an interface to allocate large buffers the core
+                                            * touches every frame, such as emulated RAM exposed
+                                            * through RETRO_ENVIRONMENT_SET_MEMORY_MAPS. The frontend
+                                            * may back them with huge pages or keep them out of swap.
+                                            * Memory from it is zeroed, page aligned, and must be
+                                            * freed through it before retro_deinit returns.
+                                            */
+
+/* Returns NULL on failure. */
+typedef void *(RETRO_CALLCONV *retro_hot_memory_alloc_t)(size_t size);
+/* Takes the size that was given to alloc. */
+typedef void (RETRO_CALLCONV *retro_hot_memory_free_t)(void *ptr, size_t size);
+struct retro_hot_memory_interface
+{
+    retro_hot_memory_alloc_t alloc;
+    retro_hot_memory_free_t free;
+};
+
 enum rarch_ctl_state
 {
    RARCH_CTL_NONE = 0,
@@ -313,6 +333,10 @@ bool retroarch_apply_shader(enum rarch_shader_type type, const char *preset_path
 
 const char* retroarch_get_shader_preset(void);
 
+/* Preset the running shader was set from, applied again when
+ * the video driver is reinitialized */
+void retroarch_set_shader_preset(const char *preset_path);
+
 bool retroarch_is_switching_display_mode(void);
 
 /**
@@ -337,6 +361,9 @@ bool retroarch_main_init(int argc, char *argv[]);
 
 bool retroarch_main_quit(void);
 
+/* Refreshes the memory the core reports, for memory_usage_get() */
+void retroarch_memory_usage_update(void);
+
 global_t *global_get_ptr(void);
 
 /**
@@ -489,6 +516,10 @@ typedef struct audio_driver
    size_t (*write_avail)(void *data);
 
    size_t (*buffer_size)(void *data);
+
+   /* Optional. Reports the counters of the device.
+    * Called from the thread writing audio. */
+   bool (*get_stats)(void *data, audio_driver_stats_t *stats);
 } audio_driver_t;
 
 bool audio_driver_enable_callback(void);
@@ -596,7 +627,9 @@ enum ffemu_pix_format
 {
    FFEMU_PIX_RGB565 = 0,
    FFEMU_PIX_BGR24,
-   FFEMU_PIX_ARGB8888
+   FFEMU_PIX_ARGB8888,
+   /* Luma plane, then interleaved chroma at half the height */
+   FFEMU_PIX_NV12
 };
 
 enum streaming_mode
@@ -732,6 +765,8 @@ void recording_driver_update_streaming_url(void);
 #define VIDEO_SHADER_MENU_4      (GFX_MAX_SHADERS - 5)
 #define VIDEO_SHADER_MENU_5      (GFX_MAX_SHADERS - 6)
 #define VIDEO_SHADER_MENU_6      (GFX_MAX_SHADERS - 7)
+#define VIDEO_SHADER_FONT_SDF    (GFX_MAX_SHADERS - 8)
+#define VIDEO_SHADER_RECORD_NV12 (GFX_MAX_SHADERS - 9)
 
 #if defined(_XBOX360)
 #define DEFAULT_SHADER_TYPE RARCH_SHADER_HLSL
@@ -806,7 +841,11 @@ enum display_flags
    GFX_CTX_FLAGS_SHADERS_CG,
    GFX_CTX_FLAGS_SHADERS_HLSL,
    GFX_CTX_FLAGS_SHADERS_SLANG,
-   GFX_CTX_FLAGS_SCREENSHOTS_SUPPORTED
+   GFX_CTX_FLAGS_SCREENSHOTS_SUPPORTED,
+   /* VIDEO_SHADER_FONT_SDF can be used */
+   GFX_CTX_FLAGS_FONT_DISTANCE_FIELD,
+   /* VIDEO_SHADER_RECORD_NV12 can be used */
+   GFX_CTX_FLAGS_RECORD_NV12
 };
 
 enum shader_uniform_type
@@ -922,6 +961,11 @@ typedef struct shader_backend
    bool (*get_feedback_pass)(void *data, unsigned *pass);
    bool (*mipmap_input)(void *data, unsigned index);
 
+   /* Returns true if the output of pass 'index' can change
+    * even though its inputs did not (frame count, history,
+    * feedback). */
+   bool (*is_time_dependent)(void *data, unsigned index);
+
    struct video_shader *(*get_current_shader)(void *data);
 
    void (*get_flags)(uint32_t*);
@@ -1097,6 +1141,7 @@ typedef struct video_frame_info
    bool statistics_show;
    bool framecount_show;
    bool scale_integer;
+   bool shader_adaptive;
    bool post_filter_record;
    bool windowed_fullscreen;
    bool fullscreen;
@@ -1104,6 +1149,7 @@ typedef struct video_frame_info
    bool use_rgba;
    bool libretro_running;
    bool xmb_shadows_enable;
+   bool menu_shader_pipeline_freeze;
    bool battery_level_enable;
    bool timedate_enable;
    bool runloop_is_slowmotion;
@@ -1129,6 +1175,8 @@ typedef struct video_frame_info
    unsigned xmb_theme;
    unsigned xmb_color_theme;
    unsigned menu_shader_pipeline;
+   unsigned menu_shader_pipeline_scale;
+   unsigned menu_shader_pipeline_idle_fps;
    unsigned materialui_color_theme;
    unsigned ozone_color_theme;
    unsigned custom_vp_width;
@@ -1149,7 +1197,7 @@ typedef struct video_frame_info
    float xmb_alpha_factor;
 
    char fps_text[128];
-   char stat_text[512];
+   char stat_text[4096];
    char chat_text[256];
 
    uint64_t frame_count;
@@ -1299,6 +1347,17 @@ typedef struct gfx_ctx_driver
    /* Optional. Makes driver context (only GLX right now)
     * active for this thread. */
    void (*make_current)(bool release);
+
+   /* Optional. Binds a framebuffer of the same size as the
+    * window, shown on a plane of its own above it, for UI
+    * that is only drawn again when it changes. It is scanned
+    * out top row first. Returns false if there is none, the
+    * UI is then drawn over the frame. */
+   bool (*ui_layer_begin)(void *data);
+
+   /* Optional. Shows what was drawn since ui_layer_begin,
+    * or hides the UI plane if visible is false. */
+   void (*ui_layer_end)(void *data, bool visible);
 } gfx_ctx_driver_t;
 
 typedef struct gfx_ctx_size
@@ -1401,6 +1460,17 @@ typedef struct video_poke_interface
          struct retro_framebuffer *framebuffer);
    bool (*get_hw_render_interface)(void *data,
          const struct retro_hw_render_interface **iface);
+
+   /* GPU recording as NV12, scaled to width x height on the GPU.
+    * Returns false if the driver can't, 0 x 0 stops it. */
+   bool (*set_record_nv12)(void *data, unsigned width, unsigned height);
+   /* Like read_viewport, width * height * 3 / 2 bytes top down */
+   bool (*read_viewport_nv12)(void *data, uint8_t *buffer);
+
+   /* Rebuilds the framebuffers of the shader passes after their
+    * scale, filter, wrap mode or mipmapping changed in the current
+    * shader, without recompiling it */
+   bool (*reinit_shader_fbo)(void *data);
 } video_poke_interface_t;
 
 /* msg is for showing a message on the screen
@@ -1542,6 +1612,10 @@ void video_driver_apply_state_changes(void);
 
 bool video_driver_read_viewport(uint8_t *buffer, bool is_idle);
 
+bool video_driver_set_record_nv12(unsigned width, unsigned height);
+
+bool video_driver_read_viewport_nv12(uint8_t *buffer);
+
 void video_driver_cached_frame(void);
 
 void video_driver_default_settings(void);
@@ -1616,6 +1690,76 @@ void video_driver_get_size(unsigned *width, unsigned *height);
 
 void video_driver_set_size(unsigned width, unsigned height);
 
+void video_driver_set_surface_rotation(unsigned rotation);
+
+unsigned video_driver_get_surface_rotation(void);
+
+void video_driver_set_present_wait(retro_time_t usec);
+
+retro_time_t video_driver_get_present_wait(void);
+
+/* Makes the next software frame count as changed. */
+void video_driver_frame_dupe_reset(void);
+
+/**
+ * video_driver_get_prev_frame:
+ * @width              : Width of the frame being uploaded.
+ * @height             : Height of the frame being uploaded.
+ * @serial             : In: what this returned for the frame the
+ *                       driver uploaded last. Out: the same for the
+ *                       frame being uploaded now, 0 if none.
+ *
+ * For drivers that upload only the regions of a software frame
+ * which changed, from within their frame callback. Asking keeps
+ * the frontend copying frames, from the next one on.
+ *
+ * Returns: the previous frame, packed, if the driver uploaded
+ * it last and gets the frame being shown as the core gave it.
+ * NULL otherwise.
+ **/
+const void *video_driver_get_prev_frame(unsigned width, unsigned height,
+      uint64_t *serial);
+
+/* Frames the frame pacing graph spans. Must be a power of two. */
+#define FRAME_PACING_SAMPLES 128
+
+/* Where the time between two frames goes */
+enum frame_pacing_stage
+{
+   FRAME_PACING_INPUT = 0,
+   FRAME_PACING_CORE,
+   FRAME_PACING_AUDIO,
+   /* The frontend's side of a frame, before the video driver */
+   FRAME_PACING_UPLOAD,
+   /* The video driver's, but for waiting for the flip */
+   FRAME_PACING_SHADER,
+   FRAME_PACING_PRESENT,
+   FRAME_PACING_TASKS,
+   FRAME_PACING_STAGE_LAST
+};
+
+/* Kept while the statistics are shown. A frame that took over
+ * one and a half refresh periods missed its vsync deadline;
+ * it's blamed on the stage that took the most over its
+ * average. */
+typedef struct frame_pacing
+{
+   /* A refresh period, in usec */
+   retro_time_t deadline;
+   retro_time_t frame_time[FRAME_PACING_SAMPLES];
+   /* Stage blamed, FRAME_PACING_STAGE_LAST if on time */
+   uint8_t culprit[FRAME_PACING_SAMPLES];
+   /* The newest frame is at (count - 1) */
+   unsigned count;
+   unsigned misses[FRAME_PACING_STAGE_LAST];
+   /* Of the last miss, how much the stage overran */
+   retro_time_t last_overrun;
+   retro_time_t average[FRAME_PACING_STAGE_LAST];
+} frame_pacing_t;
+
+/* NULL unless the statistics are shown */
+const frame_pacing_t *video_driver_get_frame_pacing(void);
+
 float video_driver_get_aspect_ratio(void);
 
 void video_driver_set_aspect_ratio_value(float value);
@@ -1730,6 +1874,9 @@ bool video_driver_texture_unload(uintptr_t *id);
 
 void video_driver_build_info(video_frame_info_t *video_info);
 
+/* Has video_driver_build_info() read the settings again */
+void video_driver_info_invalidate(void);
+
 void video_driver_reinit(int flags);
 
 void video_driver_get_window_title(char *buf, unsigned len);
@@ -1795,6 +1942,19 @@ void video_context_driver_free(void);
 
 bool video_shader_driver_get_current_shader(video_shader_ctx_t *shader);
 
+/**
+ * video_shader_driver_update_current:
+ * @shader             : Shader the running one is to become.
+ *
+ * Changes the running shader in place when only its parameters,
+ * framebuffer scales, filters, wrap modes or mipmapping differ
+ * from @shader: parameters take effect on the next frame, the
+ * framebuffers are rebuilt by the driver, nothing is recompiled.
+ *
+ * Returns: false if @shader has to be applied from scratch.
+ **/
+bool video_shader_driver_update_current(const struct video_shader *shader);
+
 float video_driver_get_refresh_rate(void);
 
 bool video_driver_started_fullscreen(void);
@@ -1865,6 +2025,7 @@ extern video_driver_t video_exynos;
 extern video_driver_t video_dispmanx;
 extern video_driver_t video_sunxi;
 extern video_driver_t video_drm;
+extern video_driver_t video_go2;
 extern video_driver_t video_xshm;
 extern video_driver_t video_caca;
 extern video_driver_t video_gdi;
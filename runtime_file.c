@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
@@ -53,10 +54,27 @@ typedef struct
    JSON_Writer writer;
    RFILE *file;
    char **current_entry_val;
+   unsigned *current_perf_val;
    char *runtime_string;
    char *last_played_string;
+   rtl_perf_t perf;
 } RtlJSONContext;
 
+/* Members of the performance profile, all numbers */
+static const struct
+{
+   const char *name;
+   size_t offset;
+} rtl_perf_members[] = {
+   { "perf_frames",           offsetof(rtl_perf_t, frames)           },
+   { "perf_core_run_avg",     offsetof(rtl_perf_t, core_run_avg)     },
+   { "perf_core_run_p95",     offsetof(rtl_perf_t, core_run_p95)     },
+   { "perf_video_avg",        offsetof(rtl_perf_t, video_avg)        },
+   { "perf_video_p95",        offsetof(rtl_perf_t, video_p95)        },
+   { "perf_underruns",        offsetof(rtl_perf_t, underruns)        },
+   { "perf_run_ahead_frames", offsetof(rtl_perf_t, run_ahead_frames) },
+};
+
 static JSON_Parser_HandlerResult RtlJSONObjectMemberHandler(JSON_Parser parser, char *pValue, size_t length, JSON_StringAttributes attributes)
 {
    RtlJSONContext *pCtx = (RtlJSONContext*)JSON_Parser_GetUserData(parser);
@@ -69,12 +87,23 @@ static JSON_Parser_HandlerResult RtlJSONObjectMemberHandler(JSON_Parser parser,
       return JSON_Parser_Abort;
    }
    
+   pCtx->current_perf_val = NULL;
+   
    if (length)
    {
       if (string_is_equal(pValue, "runtime"))
          pCtx->current_entry_val = &pCtx->runtime_string;
       else if (string_is_equal(pValue, "last_played"))
          pCtx->current_entry_val = &pCtx->last_played_string;
+      else
+      {
+         unsigned i;
+         
+         for (i = 0; i < ARRAY_SIZE(rtl_perf_members); i++)
+            if (string_is_equal(pValue, rtl_perf_members[i].name))
+               pCtx->current_perf_val = (unsigned*)
+                  ((uint8_t*)&pCtx->perf + rtl_perf_members[i].offset);
+      }
       /* ignore unknown members */
    }
    
@@ -100,6 +129,20 @@ static JSON_Parser_HandlerResult RtlJSONStringHandler(JSON_Parser parser, char *
    return JSON_Parser_Continue;
 }
 
+static JSON_Parser_HandlerResult RtlJSONNumberHandler(JSON_Parser parser, char *pValue, size_t length, JSON_NumberAttributes attributes)
+{
+   RtlJSONContext *pCtx = (RtlJSONContext*)JSON_Parser_GetUserData(parser);
+   (void)attributes; /* unused */
+   
+   if (pCtx->current_perf_val && length && !string_is_empty(pValue))
+      *pCtx->current_perf_val = (unsigned)strtoul(pValue, NULL, 10);
+   /* ignore unknown members */
+   
+   pCtx->current_perf_val = NULL;
+   
+   return JSON_Parser_Continue;
+}
+
 static JSON_Writer_HandlerResult RtlJSONOutputHandler(JSON_Writer writer, const char *pBytes, size_t length)
 {
    RtlJSONContext *context = (RtlJSONContext*)JSON_Writer_GetUserData(writer);
@@ -171,6 +214,7 @@ static void runtime_log_read_file(runtime_log_t *runtime_log)
    /* Configure parser */
    JSON_Parser_SetAllowBOM(context.parser, JSON_True);
    JSON_Parser_SetStringHandler(context.parser, &RtlJSONStringHandler);
+   JSON_Parser_SetNumberHandler(context.parser, &RtlJSONNumberHandler);
    JSON_Parser_SetObjectMemberHandler(context.parser, &RtlJSONObjectMemberHandler);
    JSON_Parser_SetUserData(context.parser, &context);
    
@@ -249,6 +293,8 @@ static void runtime_log_read_file(runtime_log_t *runtime_log)
    runtime_log->last_played.minute = last_played_minute;
    runtime_log->last_played.second = last_played_second;
    
+   runtime_log->perf               = context.perf;
+   
 end:
    
    /* Clean up leftover strings */
@@ -443,6 +489,15 @@ runtime_log_t *runtime_log_init(
 
 /* Setters */
 
+/* Set performance profile */
+void runtime_log_set_perf(runtime_log_t *runtime_log, const rtl_perf_t *perf)
+{
+   if (!runtime_log || !perf)
+      return;
+   
+   runtime_log->perf = *perf;
+}
+
 /* Set runtime to specified hours, minutes, seconds value */
 void runtime_log_set_runtime_hms(runtime_log_t *runtime_log, unsigned hours, unsigned minutes, unsigned seconds)
 {
@@ -900,6 +955,32 @@ void runtime_log_save(runtime_log_t *runtime_log)
    JSON_Writer_WriteSpace(context.writer, 1);
    JSON_Writer_WriteString(context.writer, value_string,
          strlen(value_string), JSON_UTF8);
+   
+   /* > Performance profile entries, if measured */
+   if (runtime_log->perf.frames)
+   {
+      unsigned i;
+      
+      for (i = 0; i < ARRAY_SIZE(rtl_perf_members); i++)
+      {
+         const unsigned *val = (const unsigned*)
+            ((const uint8_t*)&runtime_log->perf + rtl_perf_members[i].offset);
+         
+         value_string[0] = '\0';
+         snprintf(value_string, sizeof(value_string), "%u", *val);
+         
+         JSON_Writer_WriteComma(context.writer);
+         JSON_Writer_WriteNewLine(context.writer);
+         JSON_Writer_WriteSpace(context.writer, 2);
+         JSON_Writer_WriteString(context.writer, rtl_perf_members[i].name,
+               strlen(rtl_perf_members[i].name), JSON_UTF8);
+         JSON_Writer_WriteColon(context.writer);
+         JSON_Writer_WriteSpace(context.writer, 1);
+         JSON_Writer_WriteNumber(context.writer, value_string,
+               strlen(value_string), JSON_UTF8);
+      }
+   }
+   
    JSON_Writer_WriteNewLine(context.writer);
    
    /* > Finalise */
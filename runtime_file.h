@@ -51,10 +51,27 @@ typedef struct
    unsigned second;
 } rtl_last_played_t;
 
+/* How the content performed on this device when last
+ * measured long enough, in usec per frame */
+typedef struct
+{
+   unsigned frames; /* 0 if there is no profile */
+   unsigned core_run_avg;
+   unsigned core_run_p95;
+   /* Of the video driver, but for waiting for the
+    * flip: mostly shaders */
+   unsigned video_avg;
+   unsigned video_p95;
+   unsigned underruns;
+   /* Run-Ahead frames in use while measured */
+   unsigned run_ahead_frames;
+} rtl_perf_t;
+
 typedef struct
 {
    rtl_runtime_t runtime;
    rtl_last_played_t last_played;
+   rtl_perf_t perf;
    char path[PATH_MAX_LENGTH];
 } runtime_log_t;
 
@@ -78,6 +95,9 @@ void runtime_log_set_runtime_hms(runtime_log_t *runtime_log, unsigned hours, uns
 /* Set runtime to specified microseconds value */
 void runtime_log_set_runtime_usec(runtime_log_t *runtime_log, retro_time_t usec);
 
+/* Set performance profile */
+void runtime_log_set_perf(runtime_log_t *runtime_log, const rtl_perf_t *perf);
+
 /* Adds specified hours, minutes, seconds value to current runtime */
 void runtime_log_add_runtime_hms(runtime_log_t *runtime_log, unsigned hours, unsigned minutes, unsigned seconds);
 
@@ -20,14 +20,22 @@
 #include <stdlib.h>
 #include <ctype.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_AUTOCONFIG_DB_MTIME
+#endif
+
 #include <compat/strl.h>
 #include <file/file_path.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 
 #include "../configuration.h"
 #include "../file_path_special.h"
 #include "../list_special.h"
 #include "../retroarch.h"
+#include "../verbosity.h"
 
 #include "tasks_internal.h"
 #ifdef HAVE_BLISSBOX
@@ -42,6 +50,34 @@ struct autoconfig_disconnect
    char *msg;
 };
 
+/* What matching needs of each autoconfig file of a directory, so
+ * a hotplug only has to read the file that matches. Kept in memory
+ * and in a cache file, both checked against the directory listing
+ * and its mtime before use. Only ever used by the task running
+ * autoconfiguration, one at a time. */
+typedef struct autoconfig_db_entry
+{
+   char *name;
+   char *ident;
+   int vid;
+   int pid;
+   bool valid;
+} autoconfig_db_entry_t;
+
+typedef struct autoconfig_db
+{
+   autoconfig_db_entry_t *entries;
+   size_t size;
+   int64_t mtime;
+   char dir[PATH_MAX_LENGTH];
+} autoconfig_db_t;
+
+#define AUTOCONFIG_DB_MAGIC   0x52414144 /* "RAAD" */
+#define AUTOCONFIG_DB_VERSION 1
+#define AUTOCONFIG_DB_FILE    "autoconfig.idx"
+
+static autoconfig_db_t autoconfig_db;
+
 static bool input_autoconfigured[MAX_USERS];
 static unsigned input_device_name_index[MAX_INPUT_DEVICES];
 static bool input_autoconfigure_swap_override;
@@ -93,28 +129,12 @@ void input_autoconfigure_joypad_reindex_devices(void)
    }
 }
 
-static int input_autoconfigure_joypad_try_from_conf(config_file_t *conf,
-      autoconfig_params_t *params)
+static int input_autoconfigure_joypad_score(const char *ident,
+      int input_vid, int input_pid, autoconfig_params_t *params)
 {
-   char ident[256];
-   char input_driver[32];
-   int tmp_int                = 0;
-   int              input_vid = 0;
-   int              input_pid = 0;
    int                  score = 0;
    bool check_pid             = false;
 
-   ident[0] = input_driver[0] = '\0';
-
-   config_get_array(conf, "input_device", ident, sizeof(ident));
-   config_get_array(conf, "input_driver", input_driver, sizeof(input_driver));
-
-   if (config_get_int  (conf, "input_vendor_id", &tmp_int))
-      input_vid = tmp_int;
-
-   if (config_get_int  (conf, "input_product_id", &tmp_int))
-      input_pid = tmp_int;
-
 #ifdef HAVE_BLISSBOX
    if (params->vid == BLISSBOX_VID)
       input_pid = BLISSBOX_PID;
@@ -146,6 +166,28 @@ static int input_autoconfigure_joypad_try_from_conf(config_file_t *conf,
    return score;
 }
 
+static int input_autoconfigure_joypad_try_from_conf(config_file_t *conf,
+      autoconfig_params_t *params)
+{
+   char ident[256];
+   int tmp_int                = 0;
+   int              input_vid = 0;
+   int              input_pid = 0;
+
+   ident[0] = '\0';
+
+   config_get_array(conf, "input_device", ident, sizeof(ident));
+
+   if (config_get_int  (conf, "input_vendor_id", &tmp_int))
+      input_vid = tmp_int;
+
+   if (config_get_int  (conf, "input_product_id", &tmp_int))
+      input_pid = tmp_int;
+
+   return input_autoconfigure_joypad_score(ident,
+         input_vid, input_pid, params);
+}
+
 static void input_autoconfigure_joypad_add(config_file_t *conf,
       autoconfig_params_t *params, retro_task_t *task)
 {
@@ -248,19 +290,273 @@ static int input_autoconfigure_joypad_from_conf(
    return ret;
 }
 
+static int64_t autoconfig_db_dir_mtime(const char *dir)
+{
+#ifdef HAVE_AUTOCONFIG_DB_MTIME
+   struct stat st;
+   if (stat(dir, &st) == 0)
+      return (int64_t)st.st_mtime;
+#endif
+   return 0;
+}
+
+static void autoconfig_db_free(autoconfig_db_t *db)
+{
+   size_t i;
+
+   for (i = 0; i < db->size; i++)
+   {
+      free(db->entries[i].name);
+      free(db->entries[i].ident);
+   }
+   free(db->entries);
+
+   db->entries = NULL;
+   db->size    = 0;
+   db->mtime   = 0;
+   db->dir[0]  = '\0';
+}
+
+/* Whether the database describes the files listed */
+static bool autoconfig_db_matches(const autoconfig_db_t *db,
+      const char *dir, int64_t mtime, const struct string_list *list)
+{
+   size_t i;
+
+   if (     db->size != list->size
+         || db->mtime != mtime
+         || !string_is_equal(db->dir, dir))
+      return false;
+
+   for (i = 0; i < list->size; i++)
+      if (!string_is_equal(db->entries[i].name,
+               path_basename(list->elems[i].data)))
+         return false;
+
+   return true;
+}
+
+static bool autoconfig_db_build(autoconfig_db_t *db,
+      const char *dir, int64_t mtime, const struct string_list *list)
+{
+   size_t i;
+
+   db->entries = (autoconfig_db_entry_t*)calloc(list->size,
+         sizeof(*db->entries));
+   if (!db->entries)
+      return false;
+
+   db->size  = list->size;
+   db->mtime = mtime;
+   strlcpy(db->dir, dir, sizeof(db->dir));
+
+   for (i = 0; i < list->size; i++)
+   {
+      char ident[256];
+      int tmp_int                  = 0;
+      autoconfig_db_entry_t *entry = &db->entries[i];
+      config_file_t *conf          = config_file_new_from_path_to_string(
+            list->elems[i].data);
+
+      entry->name   = strdup(path_basename(list->elems[i].data));
+
+      if (!conf)
+         continue;
+
+      ident[0]      = '\0';
+      config_get_array(conf, "input_device", ident, sizeof(ident));
+      if (config_get_int(conf, "input_vendor_id", &tmp_int))
+         entry->vid = tmp_int;
+      if (config_get_int(conf, "input_product_id", &tmp_int))
+         entry->pid = tmp_int;
+
+      entry->ident  = strdup(ident);
+      entry->valid  = true;
+
+      config_file_free(conf);
+   }
+
+   return true;
+}
+
+static bool autoconfig_db_write_string(RFILE *file, const char *str)
+{
+   uint16_t len = str ? (uint16_t)strlen(str) : 0;
+   return filestream_write(file, &len, sizeof(len)) == sizeof(len)
+      && filestream_write(file, str, len) == len;
+}
+
+static char *autoconfig_db_read_string(RFILE *file)
+{
+   uint16_t len;
+   char *str = NULL;
+
+   if (filestream_read(file, &len, sizeof(len)) != sizeof(len))
+      return NULL;
+
+   str = (char*)malloc(len + 1);
+   if (!str)
+      return NULL;
+
+   if (filestream_read(file, str, len) != len)
+   {
+      free(str);
+      return NULL;
+   }
+
+   str[len] = '\0';
+   return str;
+}
+
+/* Cache file layout, in host byte order:
+ *    magic, version, size, mtime, directory,
+ *    then for each file: valid, vid, pid, name, ident */
+static void autoconfig_db_save(const autoconfig_db_t *db, const char *path)
+{
+   size_t i;
+   uint32_t header[3];
+   bool ok      = true;
+   RFILE *file  = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return;
+
+   header[0] = AUTOCONFIG_DB_MAGIC;
+   header[1] = AUTOCONFIG_DB_VERSION;
+   header[2] = (uint32_t)db->size;
+
+   ok = filestream_write(file, header, sizeof(header)) == sizeof(header)
+      && filestream_write(file, &db->mtime, sizeof(db->mtime)) == sizeof(db->mtime)
+      && autoconfig_db_write_string(file, db->dir);
+
+   for (i = 0; ok && i < db->size; i++)
+   {
+      const autoconfig_db_entry_t *entry = &db->entries[i];
+      int32_t values[3];
+
+      values[0] = entry->valid;
+      values[1] = entry->vid;
+      values[2] = entry->pid;
+
+      ok = filestream_write(file, values, sizeof(values)) == sizeof(values)
+         && autoconfig_db_write_string(file, entry->name)
+         && autoconfig_db_write_string(file, entry->ident);
+   }
+
+   filestream_close(file);
+
+   if (!ok)
+   {
+      RARCH_WARN("[Autoconf]: Failed to write \"%s\".\n", path);
+      filestream_delete(path);
+   }
+}
+
+static bool autoconfig_db_load(autoconfig_db_t *db, const char *path)
+{
+   size_t i;
+   uint32_t header[3];
+   RFILE *file  = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   char *dir    = NULL;
+
+   if (!file)
+      return false;
+
+   if (     filestream_read(file, header, sizeof(header)) != sizeof(header)
+         || header[0] != AUTOCONFIG_DB_MAGIC
+         || header[1] != AUTOCONFIG_DB_VERSION
+         || filestream_read(file, &db->mtime, sizeof(db->mtime)) != sizeof(db->mtime)
+         || !(dir = autoconfig_db_read_string(file)))
+      goto error;
+
+   strlcpy(db->dir, dir, sizeof(db->dir));
+   free(dir);
+
+   db->entries = (autoconfig_db_entry_t*)calloc(header[2],
+         sizeof(*db->entries));
+   if (!db->entries && header[2])
+      goto error;
+   db->size    = header[2];
+
+   for (i = 0; i < db->size; i++)
+   {
+      autoconfig_db_entry_t *entry = &db->entries[i];
+      int32_t values[3];
+
+      if (     filestream_read(file, values, sizeof(values)) != sizeof(values)
+            || !(entry->name  = autoconfig_db_read_string(file))
+            || !(entry->ident = autoconfig_db_read_string(file)))
+         goto error;
+
+      entry->valid = values[0] != 0;
+      entry->vid   = values[1];
+      entry->pid   = values[2];
+   }
+
+   filestream_close(file);
+   return true;
+
+error:
+   filestream_close(file);
+   autoconfig_db_free(db);
+   return false;
+}
+
+/* Makes autoconfig_db describe the files listed, from memory, the
+ * cache file, or by reading all of them as a last resort. */
+static bool autoconfig_db_update(const char *dir,
+      const struct string_list *list, const char *cache_dir)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   int64_t mtime = autoconfig_db_dir_mtime(dir);
+
+   if (autoconfig_db_matches(&autoconfig_db, dir, mtime, list))
+      return true;
+
+   autoconfig_db_free(&autoconfig_db);
+
+   cache_path[0] = '\0';
+   if (!string_is_empty(cache_dir))
+      fill_pathname_join(cache_path, cache_dir, AUTOCONFIG_DB_FILE,
+            sizeof(cache_path));
+
+   if (!string_is_empty(cache_path)
+         && autoconfig_db_load(&autoconfig_db, cache_path))
+   {
+      if (autoconfig_db_matches(&autoconfig_db, dir, mtime, list))
+         return true;
+      autoconfig_db_free(&autoconfig_db);
+   }
+
+   if (!autoconfig_db_build(&autoconfig_db, dir, mtime, list))
+   {
+      autoconfig_db_free(&autoconfig_db);
+      return false;
+   }
+
+   RARCH_LOG("[Autoconf]: Indexed %u files of \"%s\".\n",
+         (unsigned)autoconfig_db.size, dir);
+
+   if (!string_is_empty(cache_path))
+      autoconfig_db_save(&autoconfig_db, cache_path);
+
+   return true;
+}
+
 static bool input_autoconfigure_joypad_from_conf_dir(
       autoconfig_params_t *params, retro_task_t *task)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
-   char best_path[PATH_MAX_LENGTH];
    int ret                    = 0;
    int index                  = -1;
    int current_best           = 0;
+   const char *dir            = path;
    config_file_t *best_conf   = NULL;
    struct string_list *list   = NULL;
 
-   best_path[0]               = '\0';
    path[0]                    = '\0';
 
    fill_pathname_application_special(path, sizeof(path),
@@ -276,46 +572,52 @@ static bool input_autoconfigure_joypad_from_conf_dir(
          list = NULL;
       }
       if (!string_is_empty(params->autoconfig_directory))
+      {
+         dir  = params->autoconfig_directory;
          list = dir_list_new_special(params->autoconfig_directory,
                DIR_LIST_AUTOCONFIG, "cfg");
+      }
    }
 
    if (!list)
       return false;
 
-   for (i = 0; i < list->size; i++)
+   if (!autoconfig_db_update(dir, list, params->cache_directory))
+   {
+      string_list_free(list);
+      return false;
+   }
+
+   for (i = 0; i < autoconfig_db.size; i++)
    {
       int res;
-      config_file_t *conf = config_file_new_from_path_to_string(list->elems[i].data);
-      
-      if (!conf)
+      const autoconfig_db_entry_t *entry = &autoconfig_db.entries[i];
+
+      if (!entry->valid)
          continue;
 
-      res  = input_autoconfigure_joypad_try_from_conf(conf, params);
+      res = input_autoconfigure_joypad_score(entry->ident,
+            entry->vid, entry->pid, params);
 
       if (res >= current_best)
       {
          index        = (int)i;
          current_best = res;
-         if (best_conf)
-            config_file_free(best_conf);
-         strlcpy(best_path, list->elems[i].data, sizeof(best_path));
-         best_conf    = NULL;
-         best_conf    = conf;
       }
-      else
-         config_file_free(conf);
    }
 
-   if (index >= 0 && current_best > 0 && best_conf)
+   /* Only the best match is read again, for its binds */
+   if (index >= 0 && current_best > 0)
+      best_conf = config_file_new_from_path_to_string(
+            list->elems[index].data);
+
+   if (best_conf)
    {
       input_autoconfigure_joypad_add(best_conf, params, task);
+      config_file_free(best_conf);
       ret = 1;
    }
 
-   if (best_conf)
-      config_file_free(best_conf);
-
    string_list_free(list);
 
    if (ret == 0)
@@ -350,8 +652,11 @@ static void input_autoconfigure_params_free(autoconfig_params_t *params)
       free(params->name);
    if (!string_is_empty(params->autoconfig_directory))
       free(params->autoconfig_directory);
+   if (!string_is_empty(params->cache_directory))
+      free(params->cache_directory);
    params->name                 = NULL;
    params->autoconfig_directory = NULL;
+   params->cache_directory      = NULL;
 }
 
 static void input_autoconfigure_connect_handler(retro_task_t *task)
@@ -496,6 +801,7 @@ void input_autoconfigure_connect(
    autoconfig_params_t *state = (autoconfig_params_t*)calloc(1, sizeof(*state));
    settings_t       *settings = config_get_ptr();
    const char *dir_autoconf   = settings ? settings->paths.directory_autoconfig : NULL;
+   const char *dir_cache      = settings ? settings->paths.directory_cache : NULL;
    bool autodetect_enable     = settings ? settings->bools.input_autodetect_enable : false;
 
    if (!task || !state || !autodetect_enable)
@@ -518,6 +824,9 @@ void input_autoconfigure_connect(
    if (!string_is_empty(dir_autoconf))
       state->autoconfig_directory = strdup(dir_autoconf);
 
+   if (!string_is_empty(dir_cache))
+      state->cache_directory      = strdup(dir_cache);
+
    state->idx                     = idx;
    state->vid                     = vid;
    state->pid                     = pid;
@@ -49,6 +49,14 @@
 #include "../config.h"
 #endif
 
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_CONTENT_MMAP
+#endif
+
 #include <boolean.h>
 
 #include <encodings/crc32.h>
@@ -178,6 +186,7 @@ struct content_information_ctx
    bool patch_is_blocked;
    bool bios_is_missing;
    bool check_firmware_before_loading;
+   bool mmap_enable;
 
    struct string_list *temporary_content;
 };
@@ -604,6 +613,7 @@ static bool content_load(content_ctx_info_t *info)
 
    if (!retroarch_main_init(wrap_args->argc, wrap_args->argv))
    {
+      startup_finish();
       for (i = 0; i < ARRAY_SIZE(argv_copy); i++)
          free(argv_copy[i]);
       free(wrap_args);
@@ -622,6 +632,7 @@ static bool content_load(content_ctx_info_t *info)
 
    command_event(CMD_EVENT_HISTORY_INIT, NULL);
    rarch_favorites_init();
+   startup_finish();
    command_event(CMD_EVENT_RESUME, NULL);
    command_event(CMD_EVENT_VIDEO_SET_ASPECT_RATIO, NULL);
 
@@ -636,11 +647,100 @@ static bool content_load(content_ctx_info_t *info)
    return true;
 }
 
+#ifdef HAVE_CONTENT_MMAP
+/* Patching replaces the buffer, which has to be read then */
+static bool content_file_has_patch(content_information_ctx_t *content_ctx)
+{
+   if (content_ctx->patch_is_blocked)
+      return false;
+
+   return (!string_is_empty(content_ctx->name_ips)
+            && path_is_valid(content_ctx->name_ips))
+      ||  (!string_is_empty(content_ctx->name_bps)
+            && path_is_valid(content_ctx->name_bps))
+      ||  (!string_is_empty(content_ctx->name_ups)
+            && path_is_valid(content_ctx->name_ups));
+}
+
+/* Text content, parsed as a string and so read to get the
+ * terminator filestream_read_file() adds */
+static const char *content_file_text_exts[] = {
+   "cue", "m3u", "m3u8", "gdi", "ccd", "toc", "txt", "xml", "json", "ini"
+};
+
+/**
+ * content_file_map:
+ * @path         : path of the content file.
+ * @buf          : mapping of the content file.
+ * @length       : size of the content file.
+ *
+ * Maps the content file read-only instead of reading it, so that
+ * it is only read as the core goes through it and takes no memory
+ * of its own.
+ *
+ * Unlike a buffer read by filestream_read_file(), a mapping carries
+ * no terminator of its own. The rest of its last page is zero, which
+ * serves as one, so files that fill their last page whole are read
+ * instead, as is text content.
+ *
+ * Returns: true if mapped, false if it has to be read.
+ **/
+static bool content_file_map(const char *path, void **buf, int64_t *length)
+{
+   unsigned i;
+   struct stat st;
+   void *map;
+   int fd;
+   long page_size  = sysconf(_SC_PAGESIZE);
+   const char *ext = path_get_extension(path);
+
+   for (i = 0; i < ARRAY_SIZE(content_file_text_exts); i++)
+      if (string_is_equal_noncase(ext, content_file_text_exts[i]))
+         return false;
+
+   if (page_size <= 0)
+      return false;
+
+   fd = open(path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (     fstat(fd, &st) < 0
+         || !S_ISREG(st.st_mode)
+         || st.st_size <= 0
+         || st.st_size % page_size == 0)
+   {
+      close(fd);
+      return false;
+   }
+
+   map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (map == MAP_FAILED)
+      return false;
+
+   /* Cores mostly copy it out start to end, read ahead of them */
+#ifdef MADV_SEQUENTIAL
+   madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+   madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+
+   *buf    = map;
+   *length = st.st_size;
+   return true;
+}
+#endif
+
 /**
  * load_content_into_memory:
  * @path         : buffer of the content file.
  * @buf          : size   of the content file.
  * @length       : size of the content file that has been read from.
+ * @mapped       : set if @buf is a mapping rather than allocated.
  *
  * Read the content file. If read into memory, also performs soft patching
  * (see patch_content function) in case soft patching has not been
@@ -651,14 +751,25 @@ static bool content_load(content_ctx_info_t *info)
 static bool load_content_into_memory(
       content_information_ctx_t *content_ctx,
       unsigned i, const char *path, void **buf,
-      int64_t *length)
+      int64_t *length, bool *mapped)
 {
    uint8_t *ret_buf          = NULL;
 
    RARCH_LOG("%s: %s.\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), path);
 
-   if (!content_file_read(path, (void**) &ret_buf, length))
+   *mapped = false;
+
+#ifdef HAVE_CONTENT_MMAP
+   if (     content_ctx->mmap_enable
+#ifdef HAVE_COMPRESSION
+         && !path_contains_compressed_file(path)
+#endif
+         && (i != 0 || !content_file_has_patch(content_ctx)))
+      *mapped = content_file_map(path, (void**)&ret_buf, length);
+#endif
+
+   if (!*mapped && !content_file_read(path, (void**) &ret_buf, length))
       return false;
 
    if (*length < 0)
@@ -800,6 +911,7 @@ static bool content_file_init_extract(
    for (i = 0; i < content->size; i++)
    {
       bool block_extract                 = content->elems[i].attr.i & 1;
+      bool need_fullpath                 = content->elems[i].attr.i & 2;
       const char *path                   = content->elems[i].data;
       bool contains_compressed           = path_contains_compressed_file(path);
 
@@ -811,6 +923,40 @@ static bool content_file_init_extract(
       if (!contains_compressed && !path_is_compressed_file(path))
          continue;
 
+      /* Going into memory anyway, load_content_into_memory
+       * inflates it there without a trip through the disk */
+      if (!need_fullpath)
+      {
+         const char *valid_ext    = special ?
+            special->roms[i].valid_extensions :
+            content_ctx->valid_extensions;
+
+         if (contains_compressed)
+            continue;
+
+         if (valid_ext)
+         {
+            struct string_list *list = file_archive_get_file_list(
+                  path, valid_ext);
+
+            if (list && list->size > 0)
+            {
+               size_t member_path_size = PATH_MAX_LENGTH * sizeof(char);
+               char *member_path       = (char*)malloc(member_path_size);
+
+               snprintf(member_path, member_path_size, "%s#%s",
+                     path, list->elems[0].data);
+               string_list_set(content, i, member_path);
+
+               free(member_path);
+               string_list_free(list);
+               continue;
+            }
+
+            string_list_free(list);
+         }
+      }
+
       {
          size_t temp_content_size = PATH_MAX_LENGTH * sizeof(char);
          size_t new_path_size     = PATH_MAX_LENGTH * sizeof(char);
@@ -882,6 +1028,7 @@ static bool content_file_init_extract(
  **/
 static bool content_file_load(
       struct retro_game_info *info,
+      bool *mapped,
       const struct string_list *content,
       content_information_ctx_t *content_ctx,
       char **error_string,
@@ -923,7 +1070,7 @@ static bool content_file_load(
 
          if (!load_content_into_memory(
                   content_ctx,
-                  i, path, (void**)&info[i].data, &len))
+                  i, path, (void**)&info[i].data, &len, &mapped[i]))
          {
             size_t msg_size = 1024 * sizeof(char);
             char *msg       = (char*)malloc(msg_size);
@@ -1073,7 +1220,7 @@ static bool content_file_load(
       rcheevos_set_cheats();
 
       if (type == RARCH_CONTENT_NONE && !string_is_empty(content_path))
-         rcheevos_load(info);
+         rcheevos_load(info, mapped);
       else
          rcheevos_hardcore_paused = true;
    }
@@ -1211,6 +1358,7 @@ static bool content_file_init(
 {
    union string_list_elem_attr attr;
    struct retro_game_info               *info = NULL;
+   bool                               *mapped = NULL;
    bool subsystem_path_is_empty               = path_is_empty(RARCH_PATH_SUBSYSTEM);
    bool ret                                   = subsystem_path_is_empty;
    const struct retro_subsystem_info *special =
@@ -1227,22 +1375,30 @@ static bool content_file_init(
 #endif
 
    if (content->size > 0)
+   {
       info                   = (struct retro_game_info*)
          calloc(content->size, sizeof(*info));
+      mapped                 = (bool*)calloc(content->size, sizeof(*mapped));
+   }
 
-   if (info)
+   if (info && mapped)
    {
       unsigned i;
       struct string_list *additional_path_allocs = string_list_new();
 
-      ret = content_file_load(info, content, content_ctx, error_string,
-            special, additional_path_allocs);
+      ret = content_file_load(info, mapped, content, content_ctx,
+            error_string, special, additional_path_allocs);
       string_list_free(additional_path_allocs);
 
       for (i = 0; i < content->size; i++)
-         free((void*)info[i].data);
-
-      free(info);
+      {
+#ifdef HAVE_CONTENT_MMAP
+         if (mapped[i])
+            munmap((void*)info[i].data, info[i].size);
+         else
+#endif
+            free((void*)info[i].data);
+      }
    }
    else if (!special)
    {
@@ -1250,6 +1406,14 @@ static bool content_file_init(
       ret = false;
    }
 
+   free(info);
+   free(mapped);
+
+#ifdef HAVE_COMPRESSION
+   /* Only the archive's index is worth keeping while the core runs */
+   file_archive_cache_trim();
+#endif
+
    return ret;
 }
 
@@ -1541,6 +1705,7 @@ bool task_push_start_dummy_core(content_ctx_info_t *content_info)
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
+   content_ctx.mmap_enable                    = settings->bools.content_mmap_enable;
    content_ctx.bios_is_missing                = rarch_ctl(RARCH_CTL_IS_MISSING_BIOS, NULL);
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
@@ -1631,6 +1796,7 @@ bool task_push_load_content_from_playlist_from_menu(
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
+   content_ctx.mmap_enable                    = settings->bools.content_mmap_enable;
    content_ctx.bios_is_missing                = rarch_ctl(RARCH_CTL_IS_MISSING_BIOS, NULL);
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
@@ -1732,6 +1898,7 @@ bool task_push_start_current_core(content_ctx_info_t *content_info)
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
+   content_ctx.mmap_enable                    = settings->bools.content_mmap_enable;
    content_ctx.bios_is_missing                = rarch_ctl(RARCH_CTL_IS_MISSING_BIOS, NULL);
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
@@ -1856,6 +2023,7 @@ bool task_push_load_content_with_new_core_from_menu(
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
+   content_ctx.mmap_enable                    = settings->bools.content_mmap_enable;
    content_ctx.bios_is_missing                = rarch_ctl(RARCH_CTL_IS_MISSING_BIOS, NULL);
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
@@ -1958,6 +2126,7 @@ static bool task_load_content_callback(content_ctx_info_t *content_info,
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
+   content_ctx.mmap_enable                    = settings->bools.content_mmap_enable;
    content_ctx.bios_is_missing                = rarch_ctl(RARCH_CTL_IS_MISSING_BIOS, NULL);
    content_ctx.directory_system               = NULL;
    content_ctx.directory_cache                = NULL;
@@ -2431,6 +2600,7 @@ bool content_init(void)
 
    content_ctx.check_firmware_before_loading  = settings->bools.check_firmware_before_loading;
    content_ctx.patch_is_blocked               = rarch_ctl(RARCH_CTL_IS_PATCH_BLOCKED, NULL);
+   content_ctx.mmap_enable                    = settings->bools.content_mmap_enable;
    content_ctx.is_ips_pref                    = rarch_ctl(RARCH_CTL_IS_IPS_PREF, NULL);
    content_ctx.is_bps_pref                    = rarch_ctl(RARCH_CTL_IS_BPS_PREF, NULL);
    content_ctx.is_ups_pref                    = rarch_ctl(RARCH_CTL_IS_UPS_PREF, NULL);
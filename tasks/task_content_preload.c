@@ -0,0 +1,312 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/posix_string.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <queues/task_queue.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "../verbosity.h"
+
+#include "tasks_internal.h"
+
+/* Read into the page cache, so that loading the content and its core
+ * right after doesn't wait for the storage. Each file is read up to
+ * a maximum, a chunk each time the task runs, then its last
+ * CONTENT_PRELOAD_TAIL: where archives keep their directory and
+ * CHDs their hunk map and metadata. */
+
+#define CONTENT_PRELOAD_CHUNK     (256 * 1024)
+#define CONTENT_PRELOAD_MAX       (128 * 1024 * 1024)
+#define CONTENT_PRELOAD_TAIL      (4 * 1024 * 1024)
+/* Discs are preloaded while the content runs, so only what a
+ * core reads when the disc is inserted: the start of it */
+#define CONTENT_PRELOAD_DISK_MAX  (32 * 1024 * 1024)
+/* Content, or a disc with its track files, and the core */
+#define CONTENT_PRELOAD_MAX_FILES 8
+
+typedef struct content_preload
+{
+   RFILE *file;
+   uint8_t *buf;
+   int64_t read;
+   int64_t max;
+   unsigned generation;
+   unsigned current;
+   unsigned count;
+   bool tail;
+   char paths[CONTENT_PRELOAD_MAX_FILES][PATH_MAX_LENGTH];
+} content_preload_t;
+
+/* Bumped for a preload to stop when another one is pushed */
+static unsigned content_preload_generation = 0;
+static char content_preload_last[PATH_MAX_LENGTH];
+
+static void content_preload_free(content_preload_t *preload)
+{
+   if (!preload)
+      return;
+
+   if (preload->file)
+      filestream_close(preload->file);
+   free(preload->buf);
+   free(preload);
+}
+
+static void task_content_preload_handler(retro_task_t *task)
+{
+   content_preload_t *preload = (content_preload_t*)task->state;
+   int64_t ret;
+
+   if (     task_get_cancelled(task)
+         || preload->generation != content_preload_generation)
+      goto done;
+
+   while (!preload->file)
+   {
+      const char *path;
+
+      if (preload->current >= preload->count)
+         goto done;
+
+      path = preload->paths[preload->current];
+      if (!string_is_empty(path))
+         preload->file = filestream_open(path,
+               RETRO_VFS_FILE_ACCESS_READ,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      preload->read = 0;
+      preload->tail = false;
+      if (!preload->file)
+         preload->current++;
+   }
+
+   ret = filestream_read(preload->file, preload->buf, CONTENT_PRELOAD_CHUNK);
+   if (ret > 0)
+      preload->read += ret;
+
+   if (ret < CONTENT_PRELOAD_CHUNK)
+   {
+      filestream_close(preload->file);
+      preload->file = NULL;
+      preload->current++;
+   }
+   else if (!preload->tail && preload->read >= preload->max)
+   {
+      int64_t size  = filestream_get_size(preload->file);
+
+      preload->tail = true;
+      if (size - CONTENT_PRELOAD_TAIL > preload->read)
+         filestream_seek(preload->file, size - CONTENT_PRELOAD_TAIL,
+               RETRO_VFS_SEEK_POSITION_START);
+   }
+
+   return;
+
+done:
+   task_set_finished(task, true);
+}
+
+static void task_content_preload_cleanup(retro_task_t *task)
+{
+   content_preload_free((content_preload_t*)task->state);
+   task->state = NULL;
+}
+
+static void content_preload_start(content_preload_t *preload,
+      const char *path, int64_t max)
+{
+   retro_task_t *task  = task_init();
+
+   if (!task)
+   {
+      content_preload_free(preload);
+      return;
+   }
+
+   preload->generation = content_preload_generation;
+   preload->current    = 0;
+   preload->max        = max;
+
+   task->type          = TASK_TYPE_NONE;
+   task->state         = preload;
+   task->handler       = task_content_preload_handler;
+   task->cleanup       = task_content_preload_cleanup;
+   task->mute          = true;
+
+   strlcpy(content_preload_last, path, sizeof(content_preload_last));
+
+   task_queue_push(task);
+}
+
+/* Adds @path, without the file wanted within archives:
+ * they are read whole, that file could be anywhere */
+static void content_preload_add(content_preload_t *preload,
+      const char *path)
+{
+   char *delim = NULL;
+
+   if (preload->count >= CONTENT_PRELOAD_MAX_FILES)
+      return;
+
+   strlcpy(preload->paths[preload->count], path,
+         sizeof(preload->paths[preload->count]));
+   delim = (char*)path_get_archive_delim(preload->paths[preload->count]);
+   if (delim)
+      *delim = '\0';
+
+   preload->count++;
+}
+
+/* Adds the track files the FILE lines of a cue sheet name */
+static void content_preload_add_cue_files(content_preload_t *preload,
+      const char *cue_path)
+{
+   void *buf   = NULL;
+   int64_t len = 0;
+   char *line  = NULL;
+   char *save  = NULL;
+
+   if (!filestream_read_file(cue_path, &buf, &len) || !buf)
+      return;
+
+   for (line = strtok_r((char*)buf, "\r\n", &save); line;
+         line = strtok_r(NULL, "\r\n", &save))
+   {
+      char track_path[PATH_MAX_LENGTH];
+      char keyword[5];
+      char *name = NULL;
+      char *end  = NULL;
+
+      while (*line == ' ' || *line == '\t')
+         line++;
+
+      strlcpy(keyword, line, sizeof(keyword));
+      if (     !string_is_equal_noncase(keyword, "FILE")
+            || (line[4] != ' ' && line[4] != '\t'))
+         continue;
+
+      name = line + 5;
+      while (*name == ' ' || *name == '\t')
+         name++;
+
+      if (*name == '"')
+         end = strchr(++name, '"');
+      else
+         end = strpbrk(name, " \t");
+      if (end)
+         *end = '\0';
+
+      if (string_is_empty(name))
+         continue;
+
+      track_path[0] = '\0';
+      fill_pathname_resolve_relative(track_path, cue_path, name,
+            sizeof(track_path));
+      content_preload_add(preload, track_path);
+   }
+
+   free(buf);
+}
+
+/**
+ * task_push_content_preload:
+ * @content_path          : content to read, can be in an archive.
+ * @core_path             : core to read, or NULL.
+ *
+ * Reads the content and its core in the background, stopping
+ * the last preload if it's still going. Content already preloaded
+ * last isn't read again.
+ *
+ * Returns: true if the preload was started.
+ **/
+bool task_push_content_preload(const char *content_path,
+      const char *core_path)
+{
+   content_preload_t *preload = NULL;
+
+   if (string_is_empty(content_path)
+         || string_is_equal(content_preload_last, content_path))
+      return false;
+
+   content_preload_generation++;
+
+   preload = (content_preload_t*)calloc(1, sizeof(*preload));
+   if (!preload)
+      return false;
+
+   preload->buf = (uint8_t*)malloc(CONTENT_PRELOAD_CHUNK);
+   if (!preload->buf)
+      goto error;
+
+   content_preload_add(preload, content_path);
+
+   if (!string_is_empty(core_path) && path_is_valid(core_path))
+      content_preload_add(preload, core_path);
+
+   content_preload_start(preload, content_path, CONTENT_PRELOAD_MAX);
+   return true;
+
+error:
+   content_preload_free(preload);
+   return false;
+}
+
+/**
+ * task_push_disk_preload:
+ * @image_path            : disc image to read, can be in an archive.
+ *
+ * As task_push_content_preload(), for a disc the core will likely
+ * be given next, so swapping to it doesn't stall on the storage.
+ * The track files of cue sheets are read along.
+ *
+ * Returns: true if the preload was started.
+ **/
+bool task_push_disk_preload(const char *image_path)
+{
+   content_preload_t *preload = NULL;
+
+   if (string_is_empty(image_path)
+         || string_is_equal(content_preload_last, image_path))
+      return false;
+
+   content_preload_generation++;
+
+   preload = (content_preload_t*)calloc(1, sizeof(*preload));
+   if (!preload)
+      return false;
+
+   preload->buf = (uint8_t*)malloc(CONTENT_PRELOAD_CHUNK);
+   if (!preload->buf)
+   {
+      content_preload_free(preload);
+      return false;
+   }
+
+   if (string_is_equal_noncase(path_get_extension(image_path), "cue"))
+      content_preload_add_cue_files(preload, image_path);
+   else
+      content_preload_add(preload, image_path);
+
+   RARCH_LOG("[Disk]: Preloading \"%s\".\n", image_path);
+
+   content_preload_start(preload, image_path, CONTENT_PRELOAD_DISK_MAX);
+   return true;
+}
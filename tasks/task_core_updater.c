@@ -65,6 +65,7 @@ typedef struct core_updater_list_handle
 enum core_updater_download_status
 {
    CORE_UPDATER_DOWNLOAD_BEGIN = 0,
+   CORE_UPDATER_DOWNLOAD_WAIT_DELTA,
    CORE_UPDATER_DOWNLOAD_WAIT_TRANSFER,
    CORE_UPDATER_DOWNLOAD_WAIT_DECOMPRESS,
    CORE_UPDATER_DOWNLOAD_END
@@ -79,8 +80,12 @@ typedef struct core_updater_download_handle
    char *local_core_path;
    char *display_name;
    uint32_t remote_crc;
+   uint32_t local_crc;
    bool check_crc;
    bool crc_match;
+   retro_task_t *delta_task;
+   bool delta_task_complete;
+   http_transfer_data_t *delta_data;
    retro_task_t *http_task;
    bool http_task_finished;
    bool http_task_complete;
@@ -118,14 +123,15 @@ typedef struct update_installed_cores_handle
 /* Utility functions */
 /*********************/
 
-/* Returns true if local core has the same crc
- * value as core on buildbot */
-static bool local_core_matches_remote_crc(
-      const char *local_core_path, uint32_t remote_crc)
+/* Returns crc value of local core,
+ * 0 if it isn't installed */
+static uint32_t local_core_get_crc(const char *local_core_path)
 {
+   uint32_t crc = 0;
+
    /* Sanity check */
-   if (string_is_empty(local_core_path) || (remote_crc == 0))
-      return false;
+   if (string_is_empty(local_core_path))
+      return 0;
 
    if (path_is_valid(local_core_path))
    {
@@ -135,20 +141,97 @@ static bool local_core_matches_remote_crc(
       if (filestream_read_file(
             local_core_path, (void**)&ret_buf, &length))
       {
-         uint32_t crc = 0;
-
          if (length >= 0)
             crc = encoding_crc32(0, ret_buf, length);
 
          if (ret_buf)
             free(ret_buf);
+      }
+   }
+
+   return crc;
+}
+
+/* Gets the path of the patch from local core to
+ * core on buildbot, next to the core on buildbot:
+ *   .../latest/foo_libretro.so.zip
+ *   .../latest/foo_libretro.so.<local crc>-<remote crc>.bps */
+static void core_updater_get_delta_path(
+      char *s, size_t len, const char *remote_core_path,
+      uint32_t local_crc, uint32_t remote_crc)
+{
+   char crcs[32];
+
+   strlcpy(s, remote_core_path, len);
+
+   if (path_is_compressed_file(s))
+      path_remove_extension(s);
+
+   snprintf(crcs, sizeof(crcs), ".%08x-%08x.bps",
+         (unsigned)local_crc, (unsigned)remote_crc);
+   strlcat(s, crcs, len);
+}
+
+/* Patches local core with the delta download. The patched
+ * core must have the crc value of the core on buildbot, and
+ * replaces the local core in one rename. */
+static bool local_core_apply_delta(
+      const char *local_core_path, uint32_t remote_crc,
+      const http_transfer_data_t *delta)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   int64_t length   = 0;
+   uint64_t size    = 0;
+   uint8_t *buf     = NULL;
+   bool success     = false;
+
+   tmp_path[0]      = '\0';
+
+   if (!delta || !delta->data || !delta->len)
+      return false;
+
+   if (!filestream_read_file(local_core_path, (void**)&buf, &length)
+         || length < 0)
+      goto end;
+
+   size = (uint64_t)length;
+
+   if (!patch_bps_buffer((const uint8_t*)delta->data, delta->len,
+            &buf, &size))
+      goto end;
+
+   if (encoding_crc32(0, buf, (size_t)size) != remote_crc)
+   {
+      RARCH_ERR("[core updater] Patched core does not match buildbot: %s\n",
+            local_core_path);
+      goto end;
+   }
+
+   strlcpy(tmp_path, local_core_path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (!filestream_write_file(tmp_path, buf, (int64_t)size))
+      goto end;
 
-         if ((crc != 0) && (crc == remote_crc))
-            return true;
+   /* Where rename doesn't replace, the old core goes first */
+   if (filestream_rename(tmp_path, local_core_path) != 0)
+   {
+      filestream_delete(local_core_path);
+      if (filestream_rename(tmp_path, local_core_path) != 0)
+      {
+         filestream_delete(tmp_path);
+         goto end;
       }
    }
 
-   return false;
+   RARCH_LOG("[core updater] Updated core with a %u byte patch: %s\n",
+         (unsigned)delta->len, local_core_path);
+   success = true;
+
+end:
+   if (buf)
+      free(buf);
+   return success;
 }
 
 /*************************/
@@ -392,6 +475,7 @@ void *task_push_get_core_updater_list(
 
    /* Configure task */
    task->handler          = task_core_updater_get_list_handler;
+   task->priority         = TASK_PRIORITY_DOWNLOAD;
    task->state            = list_handle;
    task->mute             = mute;
    task->title            = strdup(msg_hash_to_str(MSG_FETCHING_CORE_LIST));
@@ -453,6 +537,31 @@ static void cb_decompress_task_core_updater_download(
       RARCH_ERR("%s", err);
 }
 
+static void cb_http_task_core_updater_delta(
+      retro_task_t *task, void *task_data,
+      void *user_data, const char *err)
+{
+   http_transfer_data_t *data                      = (http_transfer_data_t*)task_data;
+   core_updater_download_handle_t *download_handle =
+         (core_updater_download_handle_t*)user_data;
+
+   if (!download_handle)
+   {
+      if (data)
+      {
+         if (data->data)
+            free(data->data);
+         free(data);
+      }
+      return;
+   }
+
+   /* No patch on buildbot is no error,
+    * the whole core is downloaded instead */
+   download_handle->delta_data          = data;
+   download_handle->delta_task_complete = true;
+}
+
 void cb_http_task_core_updater_download(
       retro_task_t *task, void *task_data,
       void *user_data, const char *err)
@@ -583,10 +692,42 @@ static void free_core_updater_download_handle(core_updater_download_handle_t *do
    if (download_handle->display_name)
       free(download_handle->display_name);
 
+   if (download_handle->delta_data)
+   {
+      if (download_handle->delta_data->data)
+         free(download_handle->delta_data->data);
+      free(download_handle->delta_data);
+   }
+
    free(download_handle);
    download_handle = NULL;
 }
 
+static bool task_core_updater_download_push_transfer(
+      core_updater_download_handle_t *download_handle)
+{
+   /* Configure file transfer object */
+   file_transfer_t *transf = (file_transfer_t*)calloc(1, sizeof(file_transfer_t));
+
+   if (!transf)
+      return false;
+
+   strlcpy(
+         transf->path, download_handle->local_download_path,
+         sizeof(transf->path));
+
+   transf->user_data = (void*)download_handle;
+
+   /* Push HTTP transfer task */
+   download_handle->http_task = (retro_task_t*)task_push_http_transfer_file(
+         download_handle->remote_core_path, true, NULL,
+         cb_http_task_core_updater_download, transf);
+
+   /* Start waiting for HTTP transfer to complete */
+   download_handle->status = CORE_UPDATER_DOWNLOAD_WAIT_TRANSFER;
+   return true;
+}
+
 static void task_core_updater_download_handler(retro_task_t *task)
 {
    core_updater_download_handle_t *download_handle = NULL;
@@ -605,41 +746,87 @@ static void task_core_updater_download_handler(retro_task_t *task)
    switch (download_handle->status)
    {
       case CORE_UPDATER_DOWNLOAD_BEGIN:
+         /* Check CRC of existing core, if required */
+         if (download_handle->check_crc)
          {
-            file_transfer_t *transf = NULL;
+            download_handle->local_crc = local_core_get_crc(
+                  download_handle->local_core_path);
+            download_handle->crc_match =
+                     (download_handle->local_crc != 0)
+                  && (download_handle->local_crc == download_handle->remote_crc);
+         }
 
-            /* Check CRC of existing core, if required */
-            if (download_handle->check_crc)
-               download_handle->crc_match = local_core_matches_remote_crc(
-                     download_handle->local_core_path,
-                     download_handle->remote_crc);
+         /* If CRC matches, end task immediately */
+         if (download_handle->crc_match)
+         {
+            download_handle->status = CORE_UPDATER_DOWNLOAD_END;
+            break;
+         }
 
-            /* If CRC matches, end task immediately */
-            if (download_handle->crc_match)
-            {
-               download_handle->status = CORE_UPDATER_DOWNLOAD_END;
-               break;
-            }
+         /* An installed core of known version is
+          * updated with a patch, if buildbot has one */
+         if (download_handle->local_crc && download_handle->remote_crc)
+         {
+            char delta_path[PATH_MAX_LENGTH];
 
-            /* Configure file transfer object */
-            transf = (file_transfer_t*)calloc(1, sizeof(file_transfer_t));
+            delta_path[0] = '\0';
 
-            if (!transf)
-               goto task_finished;
+            core_updater_get_delta_path(delta_path, sizeof(delta_path),
+                  download_handle->remote_core_path,
+                  download_handle->local_crc, download_handle->remote_crc);
+
+            download_handle->delta_task = (retro_task_t*)task_push_http_transfer(
+                  delta_path, true, NULL,
+                  cb_http_task_core_updater_delta, download_handle);
+
+            download_handle->status = CORE_UPDATER_DOWNLOAD_WAIT_DELTA;
+            break;
+         }
+
+         if (!task_core_updater_download_push_transfer(download_handle))
+            goto task_finished;
+         break;
+      case CORE_UPDATER_DOWNLOAD_WAIT_DELTA:
+         {
+            char task_title[PATH_MAX_LENGTH];
+
+            task_title[0] = '\0';
+
+            /* Update task title */
+            task_free_title(task);
 
             strlcpy(
-                  transf->path, download_handle->local_download_path,
-                  sizeof(transf->path));
+                  task_title, msg_hash_to_str(MSG_DOWNLOADING_CORE),
+                  sizeof(task_title));
+            strlcat(task_title, download_handle->display_name, sizeof(task_title));
 
-            transf->user_data = (void*)download_handle;
+            task_set_title(task, strdup(task_title));
 
-            /* Push HTTP transfer task */
-            download_handle->http_task = (retro_task_t*)task_push_http_transfer_file(
-                  download_handle->remote_core_path, true, NULL,
-                  cb_http_task_core_updater_download, transf);
+            /* If HTTP task is NULL, then it either finished
+             * or an error occurred */
+            if (!download_handle->delta_task)
+               download_handle->delta_task_complete = true;
+            else if (!download_handle->delta_task_complete)
+               task_set_progress(task,
+                     task_get_progress(download_handle->delta_task) >> 1);
+
+            /* Wait for task_push_http_transfer()
+             * callback to trigger */
+            if (!download_handle->delta_task_complete)
+               break;
 
-            /* Start waiting for HTTP transfer to complete */
-            download_handle->status = CORE_UPDATER_DOWNLOAD_WAIT_TRANSFER;
+            if (local_core_apply_delta(
+                     download_handle->local_core_path,
+                     download_handle->remote_crc,
+                     download_handle->delta_data))
+            {
+               download_handle->status = CORE_UPDATER_DOWNLOAD_END;
+               break;
+            }
+
+            /* No usable patch, download the whole core */
+            if (!task_core_updater_download_push_transfer(download_handle))
+               goto task_finished;
          }
          break;
       case CORE_UPDATER_DOWNLOAD_WAIT_TRANSFER:
@@ -841,8 +1028,12 @@ void *task_push_core_updater_download(
    download_handle->local_core_path          = strdup(list_entry->local_core_path);
    download_handle->display_name             = strdup(list_entry->display_name);
    download_handle->remote_crc               = list_entry->crc;
+   download_handle->local_crc                = 0;
    download_handle->check_crc                = check_crc;
    download_handle->crc_match                = false;
+   download_handle->delta_task               = NULL;
+   download_handle->delta_task_complete      = false;
+   download_handle->delta_data               = NULL;
    download_handle->http_task                = NULL;
    download_handle->http_task_finished       = false;
    download_handle->http_task_complete       = false;
@@ -871,6 +1062,7 @@ void *task_push_core_updater_download(
    strlcat(task_title, download_handle->display_name, sizeof(task_title));
 
    task->handler          = task_core_updater_download_handler;
+   task->priority         = TASK_PRIORITY_DOWNLOAD;
    task->state            = download_handle;
    task->mute             = mute;
    task->title            = strdup(task_title);
@@ -1050,9 +1242,8 @@ static void task_update_installed_cores_handler(retro_task_t *task)
             }
 
             /* Check CRC of existing core */
-            crc_match = local_core_matches_remote_crc(
-                  list_entry->local_core_path,
-                  list_entry->crc);
+            crc_match = (list_entry->crc != 0) && (list_entry->crc ==
+                  local_core_get_crc(list_entry->local_core_path));
 
             /* If CRC matches, then core is already the most
              * recent version - just return to
@@ -1064,12 +1255,13 @@ static void task_update_installed_cores_handler(retro_task_t *task)
             }
 
             /* Existing core is not the most recent version
-             * > Request download */
+             * > Request download (checking the CRC again gets
+             *   the local version, for a patch from it) */
             update_installed_handle->download_task = (retro_task_t*)
                   task_push_core_updater_download(
                         update_installed_handle->core_list,
                         list_entry->remote_filename,
-                        true, false,
+                        true, true,
                         update_installed_handle->path_dir_libretro);
 
             /* Again, if an error occurred, just return to
@@ -27,6 +27,11 @@
 #include <streams/file_stream.h>
 #include <streams/chd_stream.h>
 #include <streams/interface_stream.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_DATABASE_CACHE
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -43,6 +48,76 @@
 #endif
 #include "../verbosity.h"
 
+#ifdef HAVE_DATABASE_CACHE
+/* What a scan found of each file, kept from one scan to the next for
+ * files whose size and mtime haven't changed since. The entries
+ * loaded don't change during a scan, workers look them up without
+ * locking, the task adds the new ones on the side. */
+typedef struct database_cache_entry
+{
+   char *path;
+   char *serial;
+   /* Where it was found, or NULL */
+   char *db_name;
+   char *label;
+   int64_t size;
+   int64_t mtime;
+   uint32_t type;
+   uint32_t crc;
+   uint32_t archive_crc;
+   uint32_t match_crc;
+   bool replaced;
+} database_cache_entry_t;
+
+typedef struct database_cache
+{
+   database_cache_entry_t *entries;
+   size_t size;
+   /* Indices + 1 into entries, by path hash */
+   size_t *table;
+   size_t table_size;
+   database_cache_entry_t *added;
+   size_t added_size;
+   size_t added_cap;
+   char path[PATH_MAX_LENGTH];
+} database_cache_t;
+
+#define DATABASE_CACHE_MAGIC   0x52414443 /* "RADC" */
+#define DATABASE_CACHE_VERSION 1
+#define DATABASE_CACHE_FILE    "database_scan.idx"
+#endif
+
+/* What reading a file tells about it, before it's looked up */
+typedef struct database_probe
+{
+   enum database_type type;
+   int ret;
+   uint32_t crc;
+   uint32_t archive_crc;
+#ifdef HAVE_DATABASE_CACHE
+   int64_t size;
+   int64_t mtime;
+   const database_cache_entry_t *cached;
+#endif
+   char serial[4096];
+} database_probe_t;
+
+#ifdef HAVE_THREADS
+/* Files are read ahead of the lookups on the task queue's pool, up
+ * to DATABASE_SCAN_AHEAD files past the one being looked up. The
+ * lookups and the playlist writes stay on the task, in order. */
+#define DATABASE_SCAN_AHEAD 8
+
+typedef struct database_scan
+{
+   task_read_ahead_t *ahead;
+   /* Read with the read ahead lock held, the task appends
+    * to it with the lock held */
+   struct string_list *list;
+   const struct database_cache *cache;
+} database_scan_t;
+#endif
+
 typedef struct database_state_handle
 {
    uint32_t crc;
@@ -54,6 +129,18 @@ typedef struct database_state_handle
    char serial[4096];
    database_info_list_t *info;
    struct string_list *list;
+#ifdef HAVE_THREADS
+   database_scan_t *scan;
+#endif
+   /* The file being looked up */
+   database_probe_t *probe;
+#ifdef HAVE_DATABASE_CACHE
+   database_cache_t *cache;
+   /* Where it was found */
+   char *match_db;
+   char *match_label;
+   uint32_t match_crc;
+#endif
 } database_state_handle_t;
 
 typedef struct db_handle
@@ -68,6 +155,9 @@ typedef struct db_handle
    char *playlist_directory;
    char *content_database_path;
    char *fullpath;
+#ifdef HAVE_DATABASE_CACHE
+   char *cache_path;
+#endif
    database_info_handle_t *handle;
    database_state_handle_t state;
 } db_handle_t;
@@ -168,6 +258,405 @@ static int task_database_iterate_start(retro_task_t *task,
    return 0;
 }
 
+#ifdef HAVE_DATABASE_CACHE
+static uint32_t database_cache_hash(const char *path)
+{
+   uint32_t hash = 5381;
+
+   while (*path)
+      hash = (hash << 5) + hash + (uint8_t)*path++;
+
+   return hash;
+}
+
+/* Archive members go by the archive's */
+static bool database_cache_stat(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+   struct stat st;
+   char archive[PATH_MAX_LENGTH];
+   const char *delim = path_get_archive_delim(path);
+
+   if (delim)
+   {
+      size_t len = delim - path;
+
+      if (len >= sizeof(archive))
+         return false;
+      memcpy(archive, path, len);
+      archive[len] = '\0';
+      path         = archive;
+   }
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   *size  = (int64_t)st.st_size;
+   *mtime = (int64_t)st.st_mtime;
+   return true;
+}
+
+static void database_cache_entry_free(database_cache_entry_t *entry)
+{
+   free(entry->path);
+   free(entry->serial);
+   free(entry->db_name);
+   free(entry->label);
+}
+
+static void database_cache_free(database_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache)
+      return;
+
+   for (i = 0; i < cache->size; i++)
+      database_cache_entry_free(&cache->entries[i]);
+   for (i = 0; i < cache->added_size; i++)
+      database_cache_entry_free(&cache->added[i]);
+
+   free(cache->entries);
+   free(cache->added);
+   free(cache->table);
+   free(cache);
+}
+
+static database_cache_entry_t *database_cache_find(
+      const database_cache_t *cache, const char *path)
+{
+   size_t i;
+
+   if (!cache->table_size)
+      return NULL;
+
+   for (i = database_cache_hash(path) & (cache->table_size - 1);
+         cache->table[i]; i = (i + 1) & (cache->table_size - 1))
+   {
+      database_cache_entry_t *entry = &cache->entries[cache->table[i] - 1];
+      if (string_is_equal(entry->path, path))
+         return entry;
+   }
+
+   return NULL;
+}
+
+static bool database_cache_write_string(RFILE *file, const char *str)
+{
+   uint16_t len = str ? (uint16_t)strlen(str) : 0;
+   return filestream_write(file, &len, sizeof(len)) == sizeof(len)
+      && filestream_write(file, str, len) == len;
+}
+
+static char *database_cache_read_string(RFILE *file)
+{
+   uint16_t len;
+   char *str = NULL;
+
+   if (filestream_read(file, &len, sizeof(len)) != sizeof(len))
+      return NULL;
+
+   str = (char*)malloc(len + 1);
+   if (!str)
+      return NULL;
+
+   if (filestream_read(file, str, len) != len)
+   {
+      free(str);
+      return NULL;
+   }
+
+   str[len] = '\0';
+   return str;
+}
+
+static bool database_cache_write_entry(RFILE *file,
+      const database_cache_entry_t *entry)
+{
+   int64_t times[2];
+   uint32_t values[4];
+
+   times[0]  = entry->size;
+   times[1]  = entry->mtime;
+   values[0] = entry->type;
+   values[1] = entry->crc;
+   values[2] = entry->archive_crc;
+   values[3] = entry->match_crc;
+
+   return filestream_write(file, times, sizeof(times)) == sizeof(times)
+      && filestream_write(file, values, sizeof(values)) == sizeof(values)
+      && database_cache_write_string(file, entry->path)
+      && database_cache_write_string(file, entry->serial)
+      && database_cache_write_string(file, entry->db_name)
+      && database_cache_write_string(file, entry->label);
+}
+
+/* Loads the cache file, or starts an empty cache.
+ *
+ * Layout, in host byte order:
+ *    magic, version, count,
+ *    then for each file: size, mtime, type, crc, archive crc,
+ *    match crc, path, serial, database, label */
+static database_cache_t *database_cache_load(const char *path)
+{
+   size_t i;
+   uint32_t header[3];
+   RFILE *file             = NULL;
+   database_cache_t *cache = (database_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   strlcpy(cache->path, path, sizeof(cache->path));
+
+   file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      return cache;
+
+   if (     filestream_read(file, header, sizeof(header)) != sizeof(header)
+         || header[0] != DATABASE_CACHE_MAGIC
+         || header[1] != DATABASE_CACHE_VERSION)
+      goto error;
+
+   cache->entries = (database_cache_entry_t*)calloc(header[2],
+         sizeof(*cache->entries));
+   if (!cache->entries && header[2])
+      goto error;
+
+   for (i = 0; i < header[2]; i++)
+   {
+      database_cache_entry_t *entry = &cache->entries[i];
+      int64_t times[2];
+      uint32_t values[4];
+
+      cache->size = i + 1;
+
+      if (     filestream_read(file, times, sizeof(times)) != sizeof(times)
+            || filestream_read(file, values, sizeof(values)) != sizeof(values)
+            || !(entry->path    = database_cache_read_string(file))
+            || !(entry->serial  = database_cache_read_string(file))
+            || !(entry->db_name = database_cache_read_string(file))
+            || !(entry->label   = database_cache_read_string(file)))
+         goto error;
+
+      entry->size        = times[0];
+      entry->mtime       = times[1];
+      entry->type        = values[0];
+      entry->crc         = values[1];
+      entry->archive_crc = values[2];
+      entry->match_crc   = values[3];
+
+      if (!*entry->db_name)
+      {
+         free(entry->db_name);
+         entry->db_name = NULL;
+      }
+   }
+
+   filestream_close(file);
+
+   /* At most half full */
+   cache->table_size = 16;
+   while (cache->table_size < cache->size * 2)
+      cache->table_size <<= 1;
+   cache->table = (size_t*)calloc(cache->table_size, sizeof(*cache->table));
+   if (!cache->table)
+   {
+      cache->table_size = 0;
+      return cache;
+   }
+
+   for (i = 0; i < cache->size; i++)
+   {
+      size_t j = database_cache_hash(cache->entries[i].path)
+         & (cache->table_size - 1);
+
+      while (cache->table[j])
+         j = (j + 1) & (cache->table_size - 1);
+      cache->table[j] = i + 1;
+   }
+
+   RARCH_LOG("[Database]: Loaded %u files scanned before.\n",
+         (unsigned)cache->size);
+   return cache;
+
+error:
+   RARCH_WARN("[Database]: Ignoring \"%s\".\n", path);
+   filestream_close(file);
+   for (i = 0; i < cache->size; i++)
+      database_cache_entry_free(&cache->entries[i]);
+   free(cache->entries);
+   cache->entries = NULL;
+   cache->size    = 0;
+   return cache;
+}
+
+/* Writes what was found this time, and what was found before of
+ * the files still there unchanged */
+static void database_cache_save(database_cache_t *cache)
+{
+   size_t i;
+   uint32_t header[3];
+   uint32_t count = (uint32_t)cache->added_size;
+   bool ok        = true;
+   RFILE *file    = NULL;
+
+   if (!cache->added_size)
+      return;
+
+   for (i = 0; i < cache->size; i++)
+   {
+      database_cache_entry_t *entry = &cache->entries[i];
+      int64_t size, mtime;
+
+      /* Out of date ones are dropped */
+      if (!entry->replaced && (!database_cache_stat(entry->path, &size, &mtime)
+            || size != entry->size || mtime != entry->mtime))
+         entry->replaced = true;
+
+      if (!entry->replaced)
+         count++;
+   }
+
+   file = filestream_open(cache->path, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      return;
+
+   header[0] = DATABASE_CACHE_MAGIC;
+   header[1] = DATABASE_CACHE_VERSION;
+   header[2] = count;
+
+   ok = filestream_write(file, header, sizeof(header)) == sizeof(header);
+
+   for (i = 0; ok && i < cache->size; i++)
+      if (!cache->entries[i].replaced)
+         ok = database_cache_write_entry(file, &cache->entries[i]);
+   for (i = 0; ok && i < cache->added_size; i++)
+      ok = database_cache_write_entry(file, &cache->added[i]);
+
+   filestream_close(file);
+
+   if (!ok)
+   {
+      RARCH_WARN("[Database]: Failed to write \"%s\".\n", cache->path);
+      filestream_delete(cache->path);
+   }
+}
+
+/* Keeps what was found of the file just looked up */
+static void database_cache_add(database_cache_t *cache,
+      const char *path, const database_probe_t *probe,
+      const char *db_name, const char *label, uint32_t match_crc)
+{
+   database_cache_entry_t *entry = NULL;
+   database_cache_entry_t *old   = database_cache_find(cache, path);
+
+   /* Nothing new */
+   if (     old && old == probe->cached
+         && string_is_equal(old->db_name ? old->db_name : "",
+            db_name ? db_name : ""))
+      return;
+
+   if (cache->added_size == cache->added_cap)
+   {
+      size_t cap                    = cache->added_cap
+         ? cache->added_cap * 2 : 64;
+      database_cache_entry_t *added = (database_cache_entry_t*)
+         realloc(cache->added, cap * sizeof(*added));
+
+      if (!added)
+         return;
+      cache->added     = added;
+      cache->added_cap = cap;
+   }
+
+   entry              = &cache->added[cache->added_size];
+   entry->path        = strdup(path);
+   entry->serial      = strdup(probe->serial);
+   entry->db_name     = db_name ? strdup(db_name) : NULL;
+   entry->label       = strdup(label ? label : "");
+   entry->size        = probe->size;
+   entry->mtime       = probe->mtime;
+   entry->type        = probe->type;
+   entry->crc         = probe->crc;
+   entry->archive_crc = probe->archive_crc;
+   entry->match_crc   = match_crc;
+   entry->replaced    = false;
+
+   if (!entry->path || !entry->serial || !entry->label)
+   {
+      database_cache_entry_free(entry);
+      return;
+   }
+
+   cache->added_size++;
+   if (old)
+      old->replaced = true;
+}
+
+/* Gets what the cache has of the file if it's unchanged */
+static bool database_cache_probe(const database_cache_t *cache,
+      const char *name, database_probe_t *probe)
+{
+   const database_cache_entry_t *entry;
+
+   probe->cached = NULL;
+
+   if (!database_cache_stat(name, &probe->size, &probe->mtime))
+   {
+      probe->size = -1;
+      return false;
+   }
+
+   entry = database_cache_find(cache, name);
+   if (     !entry
+         || entry->size  != probe->size
+         || entry->mtime != probe->mtime)
+      return false;
+
+   probe->type        = (enum database_type)entry->type;
+   probe->ret         = 1;
+   probe->crc         = entry->crc;
+   probe->archive_crc = entry->archive_crc;
+   probe->cached      = entry;
+   strlcpy(probe->serial, entry->serial, sizeof(probe->serial));
+   return true;
+}
+
+static void database_state_set_match(database_state_handle_t *db_state,
+      const char *db_name, const char *label, uint32_t crc)
+{
+   free(db_state->match_db);
+   free(db_state->match_label);
+   db_state->match_db    = strdup(db_name);
+   db_state->match_label = label ? strdup(label) : NULL;
+   db_state->match_crc   = crc;
+}
+
+/* The current file is done with, its probe and match go in the cache */
+static void database_state_cache_current(database_state_handle_t *db_state,
+      database_info_handle_t *db)
+{
+   const char *name = NULL;
+
+   if (db_state->cache && db_state->probe && db_state->probe->size >= 0
+         && db->list_ptr < db->list->size
+         && (name = db->list->elems[db->list_ptr].data))
+      database_cache_add(db_state->cache, name, db_state->probe,
+            db_state->match_db, db_state->match_label, db_state->match_crc);
+
+   free(db_state->match_db);
+   free(db_state->match_label);
+   db_state->match_db    = NULL;
+   db_state->match_label = NULL;
+   db_state->match_crc   = 0;
+   if (db_state->probe)
+      db_state->probe->size = -1;
+}
+#endif
+
 static int intfstream_get_serial(intfstream_t *fd, char *serial)
 {
   const char *system_name = NULL;
@@ -347,16 +836,16 @@ static int task_database_chd_get_serial(const char *name, char* serial)
    return result;
 }
 
+static int64_t intfstream_crc_read(void *data, void *buf, uint64_t len)
+{
+   return intfstream_read((intfstream_t*)data, buf, len);
+}
+
 static int intfstream_get_crc(intfstream_t *fd, uint32_t *crc)
 {
-   int64_t read = 0;
    uint32_t acc = 0;
-   uint8_t buffer[4096];
 
-   while ((read = intfstream_read(fd, buffer, sizeof(buffer))) > 0)
-      acc = encoding_crc32(acc, buffer, (size_t)read);
-
-   if (read < 0)
+   if (!encoding_crc32_read(&acc, intfstream_crc_read, fd, UINT64_MAX))
       return 0;
 
    *crc = acc;
@@ -512,7 +1001,7 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
 }
 
 static void task_database_cue_prune(database_info_handle_t *db,
-      const char *name)
+      size_t start, const char *name)
 {
    size_t i;
    char       *path = (char *)malloc(PATH_MAX_LENGTH + 1);
@@ -524,7 +1013,7 @@ static void task_database_cue_prune(database_info_handle_t *db,
 
    while (cue_next_file(fd, name, path, PATH_MAX_LENGTH))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -545,7 +1034,8 @@ end:
    free(path);
 }
 
-static void gdi_prune(database_info_handle_t *db, const char *name)
+static void gdi_prune(database_info_handle_t *db,
+      size_t start, const char *name)
 {
    size_t i;
    char       *path = (char *)malloc(PATH_MAX_LENGTH + 1);
@@ -557,7 +1047,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
 
    while (gdi_next_file(fd, name, path, PATH_MAX_LENGTH))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -618,166 +1108,179 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/* Only reads the file, the workers run this too */
+/* Reads what's needed of a file to look it up, unless @cache has it */
+static void task_database_probe(const struct database_cache *cache,
+      const char *name, database_probe_t *probe)
 {
+#ifdef HAVE_DATABASE_CACHE
+   probe->size        = -1;
+   if (cache && database_cache_probe(cache, name, probe))
+      return;
+#endif
+
+   probe->type        = DATABASE_TYPE_CRC_LOOKUP;
+   probe->ret         = 1;
+   probe->crc         = 0;
+   probe->archive_crc = 0;
+   probe->serial[0]   = '\0';
+
+   if (path_contains_compressed_file(name))
+   {
+      probe->type = DATABASE_TYPE_ITERATE_ARCHIVE;
+#ifdef HAVE_COMPRESSION
+      probe->crc  = file_archive_get_file_crc32(name);
+#endif
+      return;
+   }
+
    switch (extension_to_file_type(path_get_extension(name)))
    {
-      case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
+      case FILE_TYPE_COMPRESSED:
          /* first check crc of archive itself */
-         return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
-#else
+         probe->ret  = intfstream_file_get_crc(name,
+               0, SIZE_MAX, &probe->archive_crc);
          break;
 #endif
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (task_database_cue_get_serial(name, probe->serial))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
-         {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_cue_get_crc(name, &db_state->crc);
-         }
+            probe->ret  = task_database_cue_get_crc(name, &probe->crc);
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
          /* There are no serial databases, so don't bother with
             serials at the moment */
-         if (0 && task_database_gdi_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (0 && task_database_gdi_get_serial(name, probe->serial))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
-         {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_gdi_get_crc(name, &db_state->crc);
-         }
+            probe->ret  = task_database_gdi_get_crc(name, &probe->crc);
          break;
       /* Consider Wii WBFS files similar to ISO files. */
       case FILE_TYPE_WBFS:
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, SIZE_MAX, db_state->serial);
-         database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         intfstream_file_get_serial(name, 0, SIZE_MAX, probe->serial);
+         probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (task_database_chd_get_serial(name, probe->serial))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
-         {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_chd_get_crc(name, &db_state->crc);
-         }
+            probe->ret  = task_database_chd_get_crc(name, &probe->crc);
          break;
       case FILE_TYPE_LUTRO:
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_LUTRO);
+         probe->type = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         probe->ret  = intfstream_file_get_crc(name, 0, SIZE_MAX, &probe->crc);
+         break;
    }
-
-   return 1;
 }
 
-static int database_info_list_iterate_end_no_match(
-      database_info_handle_t *db,
-      database_state_handle_t *db_state,
-      const char *path)
+/* Files referenced by a cue or gdi sheet are scanned through it, they
+ * are taken out of the list before anything is read */
+static void task_database_prune_list(database_info_handle_t *db)
 {
-   /* Reached end of database list,
-    * CRC match probably didn't succeed. */
+   size_t i;
 
-   /* If this was a compressed file and no match in the database
-    * list was found then expand the search list to include the
-    * archive's contents. */
-   if (path_is_compressed_file(path) && !path_contains_compressed_file(path))
+   for (i = 0; i < db->list->size; i++)
    {
-      struct string_list *archive_list =
-         file_archive_get_file_list(path, NULL);
+      const char *name = db->list->elems[i].data;
 
-      if (archive_list && archive_list->size > 0)
-      {
-         unsigned i;
+      if (!name || path_contains_compressed_file(name))
+         continue;
 
-         for (i = 0; i < archive_list->size; i++)
-         {
-            char *new_path   = (char*)malloc(
-               PATH_MAX_LENGTH * sizeof(char));
-            size_t path_size = PATH_MAX_LENGTH * sizeof(char);
-            size_t path_len  = strlen(path);
-
-            new_path[0] = '\0';
-
-            strlcpy(new_path, path, path_size);
-
-            if (path_len + strlen(archive_list->elems[i].data)
-                     + 1 < PATH_MAX_LENGTH)
-            {
-               new_path[path_len] = '#';
-               strlcpy(new_path + path_len + 1,
-                  archive_list->elems[i].data,
-                  path_size - path_len);
-            }
-
-            string_list_append(db->list, new_path,
-               archive_list->elems[i].attr);
-
-            free(new_path);
-         }
-
-         string_list_free(archive_list);
+      switch (extension_to_file_type(path_get_extension(name)))
+      {
+         case FILE_TYPE_CUE:
+            task_database_cue_prune(db, i, name);
+            break;
+         case FILE_TYPE_GDI:
+            gdi_prune(db, i, name);
+            break;
+         default:
+            break;
       }
    }
+}
 
-   db_state->list_index  = 0;
-   db_state->entry_index = 0;
+#ifdef HAVE_THREADS
+static void database_scan_read(void *data, size_t index, void *result)
+{
+   database_scan_t *scan    = (database_scan_t*)data;
+   database_probe_t *probe  = (database_probe_t*)result;
+   char *name               = NULL;
 
-   if (db_state->crc != 0)
-      db_state->crc = 0;
+   task_read_ahead_lock(scan->ahead);
+   if (scan->list->elems[index].data)
+      name = strdup(scan->list->elems[index].data);
+   task_read_ahead_unlock(scan->ahead);
 
-   if (db_state->archive_crc != 0)
-      db_state->archive_crc = 0;
+   /* Pruned */
+   if (!name)
+   {
+      memset(probe, 0, sizeof(*probe));
+      return;
+   }
 
-   return 0;
+   task_database_probe(scan->cache, name, probe);
+   free(name);
 }
 
-static int task_database_iterate_next(database_info_handle_t *db)
+static void database_scan_free(database_scan_t *scan)
 {
-   db->list_ptr++;
+   if (!scan)
+      return;
 
-   if (db->list_ptr < db->list->size)
-      return 0;
-   return -1;
+   task_read_ahead_free(scan->ahead);
+   free(scan);
 }
 
-static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+static database_scan_t *database_scan_new(struct string_list *list,
+      const struct database_cache *cache)
 {
-   const char *new_database = database_info_get_current_name(db_state);
+   database_scan_t *scan = (database_scan_t*)calloc(1, sizeof(*scan));
 
-#ifndef RARCH_INTERNAL
-   fprintf(stderr, "Check database [%d/%d] : %s\n", (unsigned)db_state->list_index,
-         (unsigned)db_state->list->size, new_database);
+   if (!scan)
+      return NULL;
+
+   scan->list  = list;
+   scan->cache = cache;
+   scan->ahead = task_read_ahead_new(list->size, DATABASE_SCAN_AHEAD,
+         sizeof(database_probe_t), database_scan_read, scan);
+
+   if (!scan->ahead)
+   {
+      free(scan);
+      return NULL;
+   }
+
+   return scan;
+}
 #endif
-   if (db_state->info)
+
+/* The list is freed with free() on the userdata */
+static void database_state_free_indices(database_state_handle_t *db_state)
+{
+   size_t i;
+
+   for (i = 0; i < db_state->list->size; i++)
    {
-      database_info_list_free(db_state->info);
-      free(db_state->info);
+      database_info_index_free(
+            (database_info_index_t*)db_state->list->elems[i].userdata);
+      db_state->list->elems[i].userdata = NULL;
    }
-   db_state->info = database_info_list_new(new_database, query);
-   return 0;
 }
 
-static int database_info_list_iterate_found_match(
+/* Adds the current file to the playlist of the database it was
+ * found in, as @name */
+static void task_database_add_to_playlist(
       db_handle_t *_db,
-      database_state_handle_t *db_state,
       database_info_handle_t *db,
+      const char *db_path,
+      const char *name,
+      uint32_t crc32,
       const char *archive_name
       )
 {
@@ -786,12 +1289,8 @@ static int database_info_list_iterate_found_match(
    char *db_playlist_path         = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
    char *entry_path_str           = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
    playlist_t   *playlist         = NULL;
-   const char         *db_path    =
-      database_info_get_current_name(db_state);
    const char         *entry_path =
       database_info_get_current_element_name(db);
-   database_info_t *db_info_entry =
-      &db_state->info->list[db_state->entry_index];
    char *hash;
 
    db_crc[0]                      = '\0';
@@ -813,7 +1312,7 @@ static int database_info_list_iterate_found_match(
    playlist = playlist_init(db_playlist_path, COLLECTION_SIZE);
 
    snprintf(db_crc, PATH_MAX_LENGTH * sizeof(char),
-         "%08X|crc", db_info_entry->crc32);
+         "%08X|crc", crc32);
 
    if (entry_path)
       strlcpy(entry_path_str, entry_path, PATH_MAX_LENGTH * sizeof(char));
@@ -823,8 +1322,7 @@ static int database_info_list_iterate_found_match(
             entry_path_str, archive_name,
             '#', PATH_MAX_LENGTH * sizeof(char));
 
-   if (core_info_database_match_archive_member(
-         db_state->list->elems[db_state->list_index].data) &&
+   if (core_info_database_match_archive_member(db_path) &&
        (hash = strchr(entry_path_str, '#')))
        *hash = '\0';
 
@@ -859,7 +1357,7 @@ static int database_info_list_iterate_found_match(
 
       /* the push function reads our entry as const, so these casts are safe */
       entry.path              = entry_path_str;
-      entry.label             = db_info_entry->name;
+      entry.label             = (char*)name;
       entry.core_path         = (char*)"DETECT";
       entry.core_name         = (char*)"DETECT";
       entry.db_name           = db_playlist_base_str;
@@ -883,20 +1381,17 @@ static int database_info_list_iterate_found_match(
    playlist_write_file(playlist, _db->pl_use_old_format);
    playlist_free(playlist);
 
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-
-   db_state->info        = NULL;
-   db_state->crc         = 0;
-   db_state->archive_crc = 0;
-
    free(entry_path_str);
    free(db_playlist_path);
    free(db_playlist_base_str);
    free(db_crc);
+}
 
-   /* Move database to start since we are likely to match against it
-      again */
+/* Move database to start since we are likely to match against it
+   again */
+static void database_state_prioritize_current(
+      database_state_handle_t *db_state)
+{
    if (db_state->list_index != 0)
    {
       struct string_list_elem entry = db_state->list->elems[db_state->list_index];
@@ -905,6 +1400,259 @@ static int database_info_list_iterate_found_match(
               sizeof(entry) * db_state->list_index);
       db_state->list->elems[0] = entry;
    }
+}
+
+#ifdef HAVE_DATABASE_CACHE
+/* Adds a file found before to the playlist of the same database
+ * again, without looking it up. Returns false if that database
+ * isn't scanned this time or can't have the file anymore. */
+static bool task_database_iterate_cached(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   size_t i;
+   const database_cache_entry_t *cached = db_state->probe->cached;
+
+   if (!db_state->list)
+      return false;
+
+   for (i = 0; i < db_state->list->size; i++)
+   {
+      const char *db_path = db_state->list->elems[i].data;
+
+      if (!string_is_equal(path_basename(db_path), cached->db_name))
+         continue;
+
+      if (!_db->scan_without_core_match)
+      {
+         if (!core_info_database_supports_content_path(db_path, name))
+            return false;
+
+         if (     !path_contains_compressed_file(name)
+               && core_info_database_match_archive_member(db_path))
+            return false;
+      }
+
+      task_database_add_to_playlist(_db, db, db_path,
+            cached->label, cached->match_crc, NULL);
+      database_state_set_match(db_state, cached->db_name,
+            cached->label, cached->match_crc);
+
+      db_state->list_index = i;
+      database_state_prioritize_current(db_state);
+      return true;
+   }
+
+   return false;
+}
+#endif
+
+static void task_database_get_probe(database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name,
+      database_probe_t *probe)
+{
+#ifdef HAVE_THREADS
+   if (db_state->scan && task_read_ahead_take(db_state->scan->ahead,
+            db->list_ptr, db->list->size, probe))
+      return;
+#endif
+#ifdef HAVE_DATABASE_CACHE
+   task_database_probe(db_state->cache, name, probe);
+#else
+   task_database_probe(NULL, name, probe);
+#endif
+}
+
+static int task_database_iterate_playlist(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   database_probe_t *probe = db_state->probe;
+
+   if (!probe)
+   {
+      probe = (database_probe_t*)malloc(sizeof(*probe));
+      if (!probe)
+         return 0;
+      db_state->probe = probe;
+   }
+
+   task_database_get_probe(db_state, db, name, probe);
+
+#ifdef HAVE_DATABASE_CACHE
+   if (     probe->cached && probe->cached->db_name
+         && task_database_iterate_cached(_db, db_state, db, name))
+      return 0;
+#endif
+
+   database_info_set_type(db, probe->type);
+   strlcpy(db_state->serial, probe->serial, sizeof(db_state->serial));
+   if (probe->crc)
+      db_state->crc         = probe->crc;
+   if (probe->archive_crc)
+      db_state->archive_crc = probe->archive_crc;
+
+   return probe->ret;
+}
+
+static int database_info_list_iterate_end_no_match(
+      database_info_handle_t *db,
+      database_state_handle_t *db_state,
+      const char *path)
+{
+   /* Reached end of database list,
+    * CRC match probably didn't succeed. */
+
+   /* If this was a compressed file and no match in the database
+    * list was found then expand the search list to include the
+    * archive's contents. */
+   if (path_is_compressed_file(path) && !path_contains_compressed_file(path))
+   {
+      struct string_list *archive_list =
+         file_archive_get_file_list(path, NULL);
+
+      if (archive_list && archive_list->size > 0)
+      {
+         unsigned i;
+
+         for (i = 0; i < archive_list->size; i++)
+         {
+            char *new_path   = (char*)malloc(
+               PATH_MAX_LENGTH * sizeof(char));
+            size_t path_size = PATH_MAX_LENGTH * sizeof(char);
+            size_t path_len  = strlen(path);
+
+            new_path[0] = '\0';
+
+            strlcpy(new_path, path, path_size);
+
+            if (path_len + strlen(archive_list->elems[i].data)
+                     + 1 < PATH_MAX_LENGTH)
+            {
+               new_path[path_len] = '#';
+               strlcpy(new_path + path_len + 1,
+                  archive_list->elems[i].data,
+                  path_size - path_len);
+            }
+
+#ifdef HAVE_THREADS
+            if (db_state->scan)
+               task_read_ahead_lock(db_state->scan->ahead);
+#endif
+            string_list_append(db->list, new_path,
+               archive_list->elems[i].attr);
+#ifdef HAVE_THREADS
+            if (db_state->scan)
+               task_read_ahead_unlock(db_state->scan->ahead);
+#endif
+
+            free(new_path);
+         }
+
+         string_list_free(archive_list);
+      }
+   }
+
+   db_state->list_index  = 0;
+   db_state->entry_index = 0;
+
+   if (db_state->crc != 0)
+      db_state->crc = 0;
+
+   if (db_state->archive_crc != 0)
+      db_state->archive_crc = 0;
+
+   return 0;
+}
+
+static int task_database_iterate_next(database_info_handle_t *db)
+{
+   db->list_ptr++;
+
+   if (db->list_ptr < db->list->size)
+      return 0;
+   return -1;
+}
+
+static int database_info_list_iterate_new(database_state_handle_t *db_state,
+      const char *query)
+{
+   const char *new_database = database_info_get_current_name(db_state);
+
+#ifndef RARCH_INTERNAL
+   fprintf(stderr, "Check database [%d/%d] : %s\n", (unsigned)db_state->list_index,
+         (unsigned)db_state->list->size, new_database);
+#endif
+   if (db_state->info)
+   {
+      database_info_list_free(db_state->info);
+      free(db_state->info);
+   }
+   db_state->info = database_info_list_new(new_database, query);
+   return 0;
+}
+
+/* Looks up the entries of the current database by @field, through an
+ * index of it kept until the scan is over. Falls back to @query if
+ * the database can't be indexed. */
+static int database_info_list_iterate_find(database_state_handle_t *db_state,
+      const char *field, const void *keys, unsigned num_keys,
+      uint32_t key_len, const char *query)
+{
+   database_info_list_t *info    = NULL;
+   struct string_list_elem *elem =
+      &db_state->list->elems[db_state->list_index];
+
+   if (!elem->userdata)
+      elem->userdata = database_info_index_new(elem->data);
+
+   if (elem->userdata)
+      info = database_info_index_find(
+            (database_info_index_t*)elem->userdata,
+            field, keys, num_keys, key_len);
+
+   if (!info)
+      return database_info_list_iterate_new(db_state, query);
+
+   if (db_state->info)
+   {
+      database_info_list_free(db_state->info);
+      free(db_state->info);
+   }
+   db_state->info = info;
+   return 0;
+}
+
+static int database_info_list_iterate_found_match(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db,
+      const char *archive_name
+      )
+{
+   const char         *db_path    =
+      database_info_get_current_name(db_state);
+   database_info_t *db_info_entry =
+      &db_state->info->list[db_state->entry_index];
+
+   task_database_add_to_playlist(_db, db, db_path,
+         db_info_entry->name, db_info_entry->crc32, archive_name);
+
+#ifdef HAVE_DATABASE_CACHE
+   database_state_set_match(db_state, path_basename(db_path),
+         db_info_entry->name, db_info_entry->crc32);
+#endif
+
+   database_info_list_free(db_state->info);
+   free(db_state->info);
+
+   db_state->info        = NULL;
+   db_state->crc         = 0;
+   db_state->archive_crc = 0;
+
+   database_state_prioritize_current(db_state);
 
    return 0;
 }
@@ -949,6 +1697,8 @@ static int task_database_iterate_crc_lookup(
    if (db_state->entry_index == 0)
    {
       char query[50];
+      uint8_t keys[8];
+      unsigned num_keys = 1;
 
       query[0] = '\0';
 
@@ -975,7 +1725,20 @@ static int task_database_iterate_crc_lookup(
             "{crc:or(b\"%08X\",b\"%08X\")}",
             db_state->crc, db_state->archive_crc);
 
-      database_info_list_iterate_new(db_state, query);
+      /* Stored big endian */
+      keys[0] = (uint8_t)(db_state->crc >> 24);
+      keys[1] = (uint8_t)(db_state->crc >> 16);
+      keys[2] = (uint8_t)(db_state->crc >>  8);
+      keys[3] = (uint8_t)(db_state->crc);
+      keys[4] = (uint8_t)(db_state->archive_crc >> 24);
+      keys[5] = (uint8_t)(db_state->archive_crc >> 16);
+      keys[6] = (uint8_t)(db_state->archive_crc >>  8);
+      keys[7] = (uint8_t)(db_state->archive_crc);
+      if (db_state->archive_crc != db_state->crc)
+         num_keys = 2;
+
+      database_info_list_iterate_find(db_state, "crc",
+            keys, num_keys, 4, query);
    }
 
    if (db_state->info)
@@ -1118,7 +1881,8 @@ static int task_database_iterate_serial_lookup(
       query[0] = '\0';
 
       snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
-      database_info_list_iterate_new(db_state, query);
+      database_info_list_iterate_find(db_state, "serial",
+            db_state->serial, 1, (uint32_t)strlen(db_state->serial), query);
 
       free(serial_buf);
    }
@@ -1170,13 +1934,16 @@ static int task_database_iterate(
       return 0;
 
    if (database_info_get_type(db) == DATABASE_TYPE_ITERATE)
-      if (path_contains_compressed_file(name))
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_ARCHIVE);
+   {
+      int ret = task_database_iterate_playlist(_db, db_state, db, name);
+
+      /* An archive member is looked up right away */
+      if (database_info_get_type(db) != DATABASE_TYPE_ITERATE_ARCHIVE)
+         return ret;
+   }
 
    switch (database_info_get_type(db))
    {
-      case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
       case DATABASE_TYPE_ITERATE_ARCHIVE:
          return task_database_iterate_playlist_archive(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_LUTRO:
@@ -1293,6 +2060,19 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+
+         task_database_prune_list(dbinfo);
+#ifdef HAVE_DATABASE_CACHE
+         if (!dbstate->cache && !string_is_empty(db->cache_path))
+            dbstate->cache = database_cache_load(db->cache_path);
+#endif
+#ifdef HAVE_THREADS
+#ifdef HAVE_DATABASE_CACHE
+         dbstate->scan  = database_scan_new(dbinfo->list, dbstate->cache);
+#else
+         dbstate->scan  = database_scan_new(dbinfo->list, NULL);
+#endif
+#endif
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
@@ -1305,6 +2085,9 @@ static void task_database_handler(retro_task_t *task)
       case DATABASE_STATUS_ITERATE:
          if (task_database_iterate(db, dbstate, dbinfo) == 0)
          {
+#ifdef HAVE_DATABASE_CACHE
+            database_state_cache_current(dbstate, dbinfo);
+#endif
             dbinfo->status = DATABASE_STATUS_ITERATE_NEXT;
             dbinfo->type   = DATABASE_TYPE_ITERATE;
          }
@@ -1346,8 +2129,26 @@ task_finished:
 
    if (dbstate)
    {
+#ifdef HAVE_THREADS
+      database_scan_free(dbstate->scan);
+      dbstate->scan = NULL;
+#endif
+#ifdef HAVE_DATABASE_CACHE
+      /* Whatever was scanned before a cancel is kept too */
+      if (dbstate->cache)
+         database_cache_save(dbstate->cache);
+      database_cache_free(dbstate->cache);
+      dbstate->cache = NULL;
+      free(dbstate->match_db);
+      free(dbstate->match_label);
+#endif
+      free(dbstate->probe);
+      dbstate->probe = NULL;
       if (dbstate->list)
+      {
+         database_state_free_indices(dbstate);
          dir_list_free(dbstate->list);
+      }
    }
 
    if (db)
@@ -1358,6 +2159,9 @@ task_finished:
          free(db->content_database_path);
       if (!string_is_empty(db->fullpath))
          free(db->fullpath);
+#ifdef HAVE_DATABASE_CACHE
+      free(db->cache_path);
+#endif
       if (db->state.buf)
          free(db->state.buf);
 
@@ -1397,6 +2201,7 @@ bool task_push_dbscan(
       goto error;
 
    t->handler                  = task_database_handler;
+   t->priority                 = TASK_PRIORITY_SCAN;
    t->state                    = db;
    t->callback                 = cb;
    t->title                    = strdup(msg_hash_to_str(MSG_PREPARING_FOR_CONTENT_SCAN));
@@ -1418,6 +2223,25 @@ bool task_push_dbscan(
    db->playlist_directory      = strdup(playlist_directory);
    db->content_database_path   = strdup(content_database);
 
+#ifdef HAVE_DATABASE_CACHE
+   {
+      char cache_path[PATH_MAX_LENGTH];
+      const char *cache_dir = playlist_directory;
+
+      cache_path[0]         = '\0';
+#ifdef RARCH_INTERNAL
+      if (!string_is_empty(settings->paths.directory_cache))
+         cache_dir          = settings->paths.directory_cache;
+#endif
+      if (!string_is_empty(cache_dir))
+      {
+         fill_pathname_join(cache_path, cache_dir,
+               DATABASE_CACHE_FILE, sizeof(cache_path));
+         db->cache_path     = strdup(cache_path);
+      }
+   }
+#endif
+
    task_queue_push(t);
 
    return true;
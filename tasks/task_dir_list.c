@@ -0,0 +1,132 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <lists/dir_list.h>
+#include <queues/task_queue.h>
+#include <string/stdstring.h>
+
+#include "../verbosity.h"
+
+#include "tasks_internal.h"
+
+/* Entries read each time the task runs */
+#define DIR_LIST_TASK_BATCH 256
+
+typedef struct dir_list_handle
+{
+   struct dir_list_reader *reader;
+   unsigned generation;
+   char path[PATH_MAX_LENGTH];
+} dir_list_handle_t;
+
+/* Bumped for a listing to stop when another one is pushed */
+static unsigned dir_list_generation = 0;
+
+static void task_dir_list_handler(retro_task_t *task)
+{
+   dir_list_handle_t *handle = (dir_list_handle_t*)task->state;
+
+   if (     task_get_cancelled(task)
+         || handle->generation != dir_list_generation)
+      goto done;
+
+   switch (dir_list_reader_read(handle->reader, DIR_LIST_TASK_BATCH))
+   {
+      case 1:
+         return;
+      case 0:
+         task_set_data(task, dir_list_reader_take(handle->reader));
+         handle->reader = NULL;
+         break;
+      default:
+         RARCH_ERR("[Dir List]: Failed to list \"%s\".\n", handle->path);
+         task_set_error(task, strdup("Failed to list the directory"));
+         break;
+   }
+
+done:
+   task_set_finished(task, true);
+}
+
+static void task_dir_list_cleanup(retro_task_t *task)
+{
+   dir_list_handle_t *handle = (dir_list_handle_t*)task->state;
+
+   if (!handle)
+      return;
+
+   dir_list_reader_free(handle->reader);
+   free(handle);
+   task->state = NULL;
+}
+
+/**
+ * task_push_dir_list:
+ * @reader                : directory being listed, owned by the task.
+ * @path                  : its path, for the log.
+ * @cb                    : called with the listing, NULL if it
+ *                          failed or was stopped.
+ * @user_data             : passed on to the callback.
+ *
+ * Finishes listing a directory in the background, stopping the last
+ * listing if it's still going.
+ *
+ * Returns: true if the task was pushed, else the reader is freed.
+ **/
+bool task_push_dir_list(struct dir_list_reader *reader, const char *path,
+      retro_task_callback_t cb, void *user_data)
+{
+   retro_task_t *task        = NULL;
+   dir_list_handle_t *handle = NULL;
+
+   dir_list_generation++;
+
+   if (!reader || string_is_empty(path))
+      goto error;
+
+   handle = (dir_list_handle_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      goto error;
+
+   handle->reader     = reader;
+   handle->generation = dir_list_generation;
+   strlcpy(handle->path, path, sizeof(handle->path));
+
+   task = task_init();
+   if (!task)
+      goto error;
+
+   task->type      = TASK_TYPE_NONE;
+   task->state     = handle;
+   task->handler   = task_dir_list_handler;
+   task->cleanup   = task_dir_list_cleanup;
+   task->callback  = cb;
+   task->user_data = user_data;
+   task->mute      = true;
+
+   task_queue_push(task);
+
+   return true;
+
+error:
+   if (handle)
+      free(handle);
+   dir_list_reader_free(reader);
+   return false;
+}
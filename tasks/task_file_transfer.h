@@ -76,6 +76,9 @@ typedef struct
    enum msg_hash_enums enum_idx;
    char path[PATH_MAX_LENGTH];
    void *user_data;
+   /* Set by the HTTP task: the status of the response,
+    * or -1 if none arrived */
+   int http_status;
 } file_transfer_t;
 
 void* task_push_http_transfer_file(const char* url, bool mute, const char* type,
@@ -20,6 +20,7 @@
 #include <compat/strl.h>
 #include <file/file_path.h>
 #include <net/net_compat.h>
+#include <net/net_socket.h>
 #include <retro_timers.h>
 
 #ifdef RARCH_INTERNAL
@@ -54,6 +55,8 @@ struct http_handle
    } connection;
    struct http_t *handle;
    transfer_cb_t  cb;
+   /* Told the HTTP status of the response, if non-NULL */
+   file_transfer_t *transf;
    unsigned status;
    bool error;
 };
@@ -120,9 +123,25 @@ static int task_http_iterate_transfer(retro_task_t *task)
    http_handle_t *http  = (http_handle_t*)task->state;
    size_t pos  = 0, tot = 0;
 
-   /* FIXME: This wouldn't be needed if we could wait for a timeout */
+   /* Wait up to 1 ms for data, rather than sleeping that long */
    if (task_queue_is_threaded())
-      retro_sleep(1);
+   {
+      int fd = net_http_fd(http->handle);
+
+      if (fd >= 0)
+      {
+         fd_set fds;
+         struct timeval tv;
+
+         FD_ZERO(&fds);
+         FD_SET(fd, &fds);
+         tv.tv_sec  = 0;
+         tv.tv_usec = 1000;
+         socket_select(fd + 1, &fds, NULL, NULL, &tv);
+      }
+      else
+         retro_sleep(1);
+   }
 
    if (!net_http_update(http->handle, &pos, &tot))
    {
@@ -180,6 +199,9 @@ task_finished:
       size_t len = 0;
       char  *tmp = (char*)net_http_data(http->handle, &len, false);
 
+      if (http->transf)
+         http->transf->http_status = net_http_status(http->handle);
+
       if (tmp && http->cb)
          http->cb(tmp, len);
 
@@ -254,6 +276,7 @@ static void http_transfer_progress_cb(retro_task_t *task)
 static void* task_push_http_transfer_generic(
       struct http_connection_t *conn,
       const char *url, bool mute, const char *type,
+      file_transfer_t *transf,
       retro_task_callback_t cb, void *user_data)
 {
    task_finder_data_t find_data;
@@ -282,6 +305,7 @@ static void* task_push_http_transfer_generic(
 
    http->connection.handle = conn;
    http->connection.cb     = &cb_http_conn_default;
+   http->transf            = transf;
 
    if (type)
       strlcpy(http->connection.elem1, type, sizeof(http->connection.elem1));
@@ -295,6 +319,9 @@ static void* task_push_http_transfer_generic(
       goto error;
 
    t->handler              = task_http_transfer_handler;
+   t->priority             = TASK_PRIORITY_DOWNLOAD;
+   /* one connection per task */
+   t->affinity             = t;
    t->state                = http;
    t->mute                 = mute;
    t->callback             = cb;
@@ -324,7 +351,7 @@ void* task_push_http_transfer(const char *url, bool mute,
 
    return task_push_http_transfer_generic(
          net_http_connection_new(url, "GET", NULL),
-         url, mute, type, cb, user_data);
+         url, mute, type, NULL, cb, user_data);
 }
 
 void* task_push_http_transfer_file(const char* url, bool mute,
@@ -338,9 +365,12 @@ void* task_push_http_transfer_file(const char* url, bool mute,
    if (string_is_empty(url))
       return NULL;
 
+   if (transfer_data)
+      transfer_data->http_status = -1;
+
    t = (retro_task_t*)task_push_http_transfer_generic(
          net_http_connection_new(url, "GET", NULL),
-         url, mute, type, cb, transfer_data);
+         url, mute, type, transfer_data, cb, transfer_data);
 
    if (!t)
       return NULL;
@@ -379,7 +409,8 @@ void* task_push_http_transfer_with_user_agent(const char *url, bool mute,
       net_http_connection_set_user_agent(conn, user_agent);
 
    /* assert: task_push_http_transfer_generic will free conn on failure */
-   return task_push_http_transfer_generic(conn, url, mute, type, cb, user_data);
+   return task_push_http_transfer_generic(conn, url, mute, type,
+         NULL, cb, user_data);
 }
 
 void* task_push_http_post_transfer(const char *url,
@@ -390,7 +421,7 @@ void* task_push_http_post_transfer(const char *url,
       return NULL;
    return task_push_http_transfer_generic(
          net_http_connection_new(url, "POST", post_data),
-         url, mute, type, cb, user_data);
+         url, mute, type, NULL, cb, user_data);
 }
 
 task_retriever_info_t *http_task_get_transfer_list(void)
@@ -19,8 +19,11 @@
 #include <errno.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 #include <features/features_cpu.h>
@@ -29,6 +32,13 @@
 #include "tasks_internal.h"
 
 #include "../configuration.h"
+#include "../gfx/video_image_cache.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#define HAVE_IMAGE_CACHE
+#endif
 
 enum image_status_enum
 {
@@ -50,11 +60,345 @@ struct nbio_image_handle
    unsigned frame_duration;
    size_t size;
    unsigned upscale_threshold;
+   /* Where the decoded copy of the image is kept, or NULL */
+   char *cache_path;
+   /* Missed in the shared image cache, which waits
+    * for video_image_cache_end() */
+   bool shared_pending;
    void *handle;
    transfer_cb_t  cb;
    struct texture_image ti;
 };
 
+static void task_image_shared_end(struct nbio_image_handle *image,
+      const char *path, const struct texture_image *img)
+{
+   if (!image->shared_pending)
+      return;
+
+   video_image_cache_end(img, path, image->ti.supports_rgba,
+         image->upscale_threshold);
+   image->shared_pending = false;
+}
+
+#ifdef HAVE_IMAGE_CACHE
+/* Decoded copies of menu images, read instead of decoding the images
+ * again while they are unchanged. One file for each image, in host
+ * byte order:
+ *    image_cache_header_t,
+ *    the pixels, as RGB565 if the image is opaque, else as uploaded,
+ *    the path of the image, not terminated. */
+
+#define IMAGE_CACHE_MAGIC   0x52415443 /* "RATC" */
+#define IMAGE_CACHE_VERSION 1
+
+/* Bigger images, e.g. wallpapers, aren't kept */
+#define IMAGE_CACHE_MAX_PIXELS (1024 * 1024)
+
+enum image_cache_format
+{
+   IMAGE_CACHE_ARGB8888 = 0,
+   IMAGE_CACHE_RGB565
+};
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   /* Of the image the copy was made from */
+   int64_t src_size;
+   int64_t src_mtime;
+   uint32_t width;
+   uint32_t height;
+   uint32_t format;
+   uint32_t upscale_threshold;
+   uint32_t supports_rgba;
+   uint32_t path_len;
+} image_cache_header_t;
+
+static bool image_cache_stat(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+   struct stat st;
+
+   if (stat(path, &st) != 0)
+      return false;
+
+   *size  = (int64_t)st.st_size;
+   *mtime = (int64_t)st.st_mtime;
+   return true;
+}
+
+/* Returns NULL if images aren't kept */
+static char *image_cache_get_path(const char *path)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   char name[16];
+   settings_t *settings = config_get_ptr();
+
+   cache_path[0] = '\0';
+
+   if (     !settings
+         || !settings->bools.menu_thumbnail_cache
+         || string_is_empty(settings->paths.directory_cache))
+      return NULL;
+
+   snprintf(name, sizeof(name), "%08x.tex",
+         encoding_crc32(0, (const uint8_t*)path, strlen(path)));
+
+   fill_pathname_join(cache_path, settings->paths.directory_cache,
+         "thumbnails", sizeof(cache_path));
+   fill_pathname_join(cache_path, cache_path, name, sizeof(cache_path));
+
+   return strdup(cache_path);
+}
+
+/* Returns NULL if there's no copy to read, or it's out of date */
+static struct texture_image *image_cache_read(
+      const struct nbio_image_handle *image, const char *path)
+{
+   unsigned r_shift, g_shift, b_shift, a_shift;
+   size_t i, count, pixels_size;
+   int64_t src_size, src_mtime;
+   struct texture_image ti;
+   const image_cache_header_t *header = NULL;
+   struct texture_image *img          = NULL;
+   uint8_t *data                      = NULL;
+   int64_t len                        = 0;
+   size_t path_len                    = strlen(path);
+
+   if (     !path_is_valid(image->cache_path)
+         || !image_cache_stat(path, &src_size, &src_mtime)
+         || !filestream_read_file(image->cache_path, (void**)&data, &len))
+      return NULL;
+
+   header = (const image_cache_header_t*)data;
+
+   if (     len < (int64_t)sizeof(*header)
+         || header->magic             != IMAGE_CACHE_MAGIC
+         || header->version           != IMAGE_CACHE_VERSION
+         || header->src_size          != src_size
+         || header->src_mtime         != src_mtime
+         || header->upscale_threshold != image->upscale_threshold
+         || header->supports_rgba     != (uint32_t)image->ti.supports_rgba
+         || header->path_len          != path_len
+         || header->format            >  IMAGE_CACHE_RGB565
+         || !header->width
+         || !header->height
+         || (uint64_t)header->width * header->height
+            > IMAGE_CACHE_MAX_PIXELS)
+      goto error;
+
+   count       = (size_t)header->width * header->height;
+   pixels_size = count * ((header->format == IMAGE_CACHE_RGB565)
+         ? sizeof(uint16_t) : sizeof(uint32_t));
+
+   if (     (uint64_t)len != sizeof(*header) + pixels_size + path_len
+         || memcmp(data + sizeof(*header) + pixels_size, path, path_len))
+      goto error;
+
+   ti.width         = header->width;
+   ti.height        = header->height;
+   ti.supports_rgba = image->ti.supports_rgba;
+   ti.pixels        = NULL;
+
+   if (header->format == IMAGE_CACHE_RGB565)
+   {
+      const uint16_t *src = (const uint16_t*)(data + sizeof(*header));
+
+      ti.pixels = (uint32_t*)malloc(count * sizeof(uint32_t));
+      if (!ti.pixels)
+         goto error;
+
+      image_texture_set_color_shifts(&r_shift, &g_shift, &b_shift,
+            &a_shift, &ti);
+
+      for (i = 0; i < count; i++)
+      {
+         uint32_t r = (src[i] >> 11) & 0x1f;
+         uint32_t g = (src[i] >>  5) & 0x3f;
+         uint32_t b =  src[i]        & 0x1f;
+
+         ti.pixels[i] = (UINT32_C(0xff)       << a_shift)
+                      | (((r << 3) | (r >> 2)) << r_shift)
+                      | (((g << 2) | (g >> 4)) << g_shift)
+                      | (((b << 3) | (b >> 2)) << b_shift);
+      }
+
+      free(data);
+   }
+   else
+   {
+      /* Used in place, the header is dropped */
+      memmove(data, data + sizeof(*header), pixels_size);
+      ti.pixels = (uint32_t*)data;
+   }
+
+   img = (struct texture_image*)malloc(sizeof(*img));
+   if (!img)
+   {
+      free(ti.pixels);
+      return NULL;
+   }
+
+   *img = ti;
+   return img;
+
+error:
+   free(data);
+   return NULL;
+}
+
+/* Keeps a copy of the image as it's handed over to be uploaded */
+static void image_cache_write(const struct nbio_image_handle *image,
+      const char *path)
+{
+   unsigned r_shift, g_shift, b_shift, a_shift;
+   size_t i, count, pixels_size, size;
+   char dir[PATH_MAX_LENGTH];
+   struct texture_image ti           = image->ti;
+   image_cache_header_t *header      = NULL;
+   uint8_t *data                     = NULL;
+   size_t path_len                   = strlen(path);
+   bool opaque                       = true;
+   int64_t src_size;
+   int64_t src_mtime;
+
+   dir[0] = '\0';
+
+   if (     !ti.pixels || !ti.width || !ti.height
+         || (uint64_t)ti.width * ti.height > IMAGE_CACHE_MAX_PIXELS
+         || !image_cache_stat(path, &src_size, &src_mtime))
+      return;
+
+   count = (size_t)ti.width * ti.height;
+
+   image_texture_set_color_shifts(&r_shift, &g_shift, &b_shift,
+         &a_shift, &ti);
+
+   for (i = 0; i < count && opaque; i++)
+      opaque = ((ti.pixels[i] >> a_shift) & 0xff) == 0xff;
+
+   pixels_size = count * (opaque ? sizeof(uint16_t) : sizeof(uint32_t));
+   size        = sizeof(*header) + pixels_size + path_len;
+   data        = (uint8_t*)malloc(size);
+
+   if (!data)
+      return;
+
+   header                    = (image_cache_header_t*)data;
+   header->magic             = IMAGE_CACHE_MAGIC;
+   header->version           = IMAGE_CACHE_VERSION;
+   header->src_size          = src_size;
+   header->src_mtime         = src_mtime;
+   header->width             = ti.width;
+   header->height            = ti.height;
+   header->format            = opaque
+      ? IMAGE_CACHE_RGB565 : IMAGE_CACHE_ARGB8888;
+   header->upscale_threshold = image->upscale_threshold;
+   header->supports_rgba     = ti.supports_rgba;
+   header->path_len          = (uint32_t)path_len;
+
+   if (opaque)
+   {
+      uint16_t *dst = (uint16_t*)(data + sizeof(*header));
+
+      for (i = 0; i < count; i++)
+      {
+         uint32_t px = ti.pixels[i];
+
+         dst[i] = (uint16_t)(
+                 ((((px >> r_shift) & 0xff) >> 3) << 11)
+               | ((((px >> g_shift) & 0xff) >> 2) <<  5)
+               |  (((px >> b_shift) & 0xff) >> 3));
+      }
+   }
+   else
+      memcpy(data + sizeof(*header), ti.pixels, pixels_size);
+
+   memcpy(data + sizeof(*header) + pixels_size, path, path_len);
+
+   fill_pathname_basedir(dir, image->cache_path, sizeof(dir));
+   if (!path_is_directory(dir))
+      path_mkdir(dir);
+
+   if (!filestream_write_file(image->cache_path, data, (int64_t)size))
+      filestream_delete(image->cache_path);
+
+   free(data);
+}
+
+/* Reads the copy of the image first, if there's one, else goes on
+ * to decode it */
+static void task_image_cache_load_handler(retro_task_t *task)
+{
+   nbio_handle_t *nbio             = (nbio_handle_t*)task->state;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+   struct texture_image *img       = image_cache_read(image, nbio->path);
+
+   if (img)
+   {
+      task_image_shared_end(image, nbio->path, img);
+      task_set_data(task, img);
+      task_set_finished(task, true);
+      return;
+   }
+
+   task->handler = task_file_load_handler;
+   task_file_load_handler(task);
+}
+#endif
+
+/* Copies the image from the shared cache if it's there, waits
+ * while another task decodes it, else goes on to load it */
+static void task_image_shared_load_handler(retro_task_t *task)
+{
+   struct texture_image *img       = NULL;
+   nbio_handle_t *nbio             = (nbio_handle_t*)task->state;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+   struct texture_image ti         = image->ti;
+
+   if (task_get_cancelled(task))
+   {
+      task_set_finished(task, true);
+      return;
+   }
+
+   switch (video_image_cache_begin(&ti, nbio->path,
+            image->upscale_threshold))
+   {
+      case VIDEO_IMAGE_CACHE_BUSY:
+         return;
+      case VIDEO_IMAGE_CACHE_HIT:
+         img = (struct texture_image*)malloc(sizeof(*img));
+         if (img)
+         {
+            *img = ti;
+            task_set_data(task, img);
+            task_set_finished(task, true);
+            return;
+         }
+         image_texture_free(&ti);
+         break;
+      case VIDEO_IMAGE_CACHE_MISS:
+      default:
+         image->shared_pending = true;
+         break;
+   }
+
+#ifdef HAVE_IMAGE_CACHE
+   if (image->cache_path)
+   {
+      task->handler = task_image_cache_load_handler;
+      task_image_cache_load_handler(task);
+      return;
+   }
+#endif
+
+   task->handler = task_file_load_handler;
+   task_file_load_handler(task);
+}
+
 static int cb_image_upload_generic(void *data, size_t len)
 {
    unsigned r_shift, g_shift, b_shift, a_shift;
@@ -160,10 +504,15 @@ static void task_image_cleanup(nbio_handle_t *nbio)
 
    if (image)
    {
+      task_image_shared_end(image, nbio->path, NULL);
+
       image_transfer_free(image->handle, image->type);
 
       image->handle                 = NULL;
       image->cb                     = NULL;
+
+      free(image->cache_path);
+      image->cache_path             = NULL;
    }
    if (!string_is_empty(nbio->path))
       free(nbio->path);
@@ -366,6 +715,12 @@ bool task_image_load_handler(retro_task_t *task)
             }
          }
 
+#ifdef HAVE_IMAGE_CACHE
+         if (image->cache_path)
+            image_cache_write(image, nbio->path);
+#endif
+         task_image_shared_end(image, nbio->path, &image->ti);
+
          img->width         = image->ti.width;
          img->height        = image->ti.height;
          img->pixels        = image->ti.pixels;
@@ -380,8 +735,9 @@ bool task_image_load_handler(retro_task_t *task)
    return true;
 }
 
-bool task_push_image_load(const char *fullpath, 
+void *task_push_image_load_priority(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
+      enum task_priority priority,
       retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
@@ -389,14 +745,14 @@ bool task_push_image_load(const char *fullpath,
    retro_task_t                   *t = task_init();
 
    if (!t)
-      return false;
+      return NULL;
 
    nbio                = (nbio_handle_t*)malloc(sizeof(*nbio));
 
    if (!nbio)
    {
       free(t);
-      return false;
+      return NULL;
    }
 
    nbio->type          = NBIO_TYPE_NONE;
@@ -417,7 +773,7 @@ bool task_push_image_load(const char *fullpath,
    {
       free(nbio);
       free(t);
-      return false;
+      return NULL;
    }
 
    nbio->path                        = strdup(fullpath);
@@ -431,6 +787,8 @@ bool task_push_image_load(const char *fullpath,
    image->frame_duration             = 0;
    image->size                       = 0;
    image->upscale_threshold          = upscale_threshold;
+   image->cache_path                 = NULL;
+   image->shared_pending             = false;
    image->handle                     = NULL;
 
    image->ti.width                   = 0;
@@ -465,11 +823,33 @@ bool task_push_image_load(const char *fullpath,
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->priority        = priority;
+   /* decoders keep their state in the handle */
+   t->affinity        = t;
+
+#ifdef HAVE_IMAGE_CACHE
+   if (image->type != IMAGE_TYPE_NONE)
+      image->cache_path = image_cache_get_path(fullpath);
+   if (image->cache_path)
+      t->handler      = task_image_cache_load_handler;
+#endif
+   /* Background loads don't displace what's on screen
+    * from the shared cache */
+   if (priority == TASK_PRIORITY_INTERACTIVE && image->type != IMAGE_TYPE_NONE)
+      t->handler      = task_image_shared_load_handler;
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
 
    task_queue_push(t);
 
-   return true;
+   return t;
+}
+
+void *task_push_image_load(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_priority(fullpath, supports_rgba,
+         upscale_threshold, TASK_PRIORITY_INTERACTIVE, cb, user_data);
 }
@@ -26,6 +26,7 @@
 #include <lists/string_list.h>
 #include <file/file_path.h>
 #include <formats/logiqx_dat.h>
+#include <features/features_cpu.h>
 
 #include "tasks_internal.h"
 
@@ -48,6 +49,25 @@ enum manual_scan_status
    MANUAL_SCAN_END
 };
 
+/* Files are added to the playlist until this much time, in usec,
+ * has gone by in one run of the task */
+#define MANUAL_SCAN_BUDGET 4000
+
+/* What a file adds to the playlist */
+typedef struct manual_scan_entry
+{
+   bool valid;
+   char path[PATH_MAX_LENGTH];
+   char label[PATH_MAX_LENGTH];
+} manual_scan_entry_t;
+
+#ifdef HAVE_THREADS
+/* Files are read ahead of the playlist on the task queue's pool, up
+ * to MANUAL_SCAN_AHEAD files past the one being added. Adding them
+ * to the playlist stays on the task, in order. */
+#define MANUAL_SCAN_AHEAD 16
+#endif
+
 typedef struct manual_scan_handle
 {
    manual_content_scan_task_config_t *task_config;
@@ -57,16 +77,54 @@ typedef struct manual_scan_handle
    size_t list_size;
    size_t list_index;
    enum manual_scan_status status;
+#ifdef HAVE_THREADS
+   task_read_ahead_t *ahead;
+#endif
    bool fuzzy_archive_match;
    bool use_old_format;
 } manual_scan_handle_t;
 
+/* Only reads, the pool runs this too */
+static void manual_scan_get_entry(
+      manual_content_scan_task_config_t *task_config,
+      struct string_list *content_list, size_t index,
+      logiqx_dat_t *dat_file, manual_scan_entry_t *entry)
+{
+   const char *content_path = content_list->elems[index].data;
+   int content_type         = content_list->elems[index].attr.i;
+
+   entry->path[0]  = '\0';
+   entry->label[0] = '\0';
+   entry->valid    = !string_is_empty(content_path) &&
+         manual_content_scan_get_playlist_entry(
+               task_config, content_path, content_type, dat_file,
+               entry->path, sizeof(entry->path),
+               entry->label, sizeof(entry->label));
+}
+
+#ifdef HAVE_THREADS
+static void manual_scan_read_ahead(void *data, size_t index, void *result)
+{
+   manual_scan_handle_t *manual_scan = (manual_scan_handle_t*)data;
+
+   manual_scan_get_entry(manual_scan->task_config,
+         manual_scan->content_list, index, manual_scan->dat_file,
+         (manual_scan_entry_t*)result);
+}
+#endif
+
 /* Frees task handle + all constituent objects */
 static void free_manual_content_scan_handle(manual_scan_handle_t *manual_scan)
 {
    if (!manual_scan)
       return;
 
+#ifdef HAVE_THREADS
+   /* Before anything they read is freed */
+   task_read_ahead_free(manual_scan->ahead);
+   manual_scan->ahead = NULL;
+#endif
+
    if (manual_scan->task_config)
    {
       free(manual_scan->task_config);
@@ -165,48 +223,78 @@ static void task_manual_content_scan_handler(retro_task_t *task)
                      manual_scan->playlist, manual_scan->task_config->core_name);
             }
 
+#ifdef HAVE_THREADS
+            manual_scan->ahead = task_read_ahead_new(
+                  manual_scan->list_size, MANUAL_SCAN_AHEAD,
+                  sizeof(manual_scan_entry_t),
+                  manual_scan_read_ahead, manual_scan);
+#endif
+
             /* All good - can start iterating */
             manual_scan->status = MANUAL_SCAN_ITERATE_CONTENT;
          }
          break;
       case MANUAL_SCAN_ITERATE_CONTENT:
          {
-            const char *content_path =
-                  manual_scan->content_list->elems[manual_scan->list_index].data;
-            int content_type         =
-                  manual_scan->content_list->elems[manual_scan->list_index].attr.i;
+            /* A file each run would take a frame each
+             * when the task queue isn't threaded */
+            manual_scan_entry_t entry;
+            retro_time_t start = cpu_features_get_time_usec();
 
-            if (!string_is_empty(content_path))
+            do
             {
-               const char *content_file = path_basename(content_path);
-               char task_title[PATH_MAX_LENGTH];
+               size_t index             = manual_scan->list_index;
+               const char *content_path =
+                     manual_scan->content_list->elems[index].data;
+
+#ifdef HAVE_THREADS
+               if (!manual_scan->ahead
+                     || !task_read_ahead_take(manual_scan->ahead,
+                           index, manual_scan->list_size, &entry))
+#endif
+                  manual_scan_get_entry(manual_scan->task_config,
+                        manual_scan->content_list, index,
+                        manual_scan->dat_file, &entry);
 
-               task_title[0] = '\0';
+               /* Add content to playlist */
+               if (entry.valid)
+                  manual_content_scan_push_playlist_entry(
+                        manual_scan->task_config, manual_scan->playlist,
+                        entry.path, entry.label,
+                        manual_scan->fuzzy_archive_match);
+
+               /* Increment content index */
+               manual_scan->list_index++;
+               if (manual_scan->list_index >= manual_scan->list_size)
+               {
+                  manual_scan->status = MANUAL_SCAN_END;
+                  break;
+               }
 
-               /* Update progress display */
-               task_free_title(task);
+               /* Update progress display with the last file done */
+               if (cpu_features_get_time_usec() - start >= MANUAL_SCAN_BUDGET)
+               {
+                  const char *content_file = string_is_empty(content_path)
+                        ? NULL : path_basename(content_path);
+                  char task_title[PATH_MAX_LENGTH];
 
-               strlcpy(
-                     task_title, msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_IN_PROGRESS),
-                     sizeof(task_title));
+                  task_title[0] = '\0';
 
-               if (!string_is_empty(content_file))
-                  strlcat(task_title, content_file, sizeof(task_title));
+                  task_free_title(task);
 
-               task_set_title(task, strdup(task_title));
-               task_set_progress(task, (manual_scan->list_index * 100) / manual_scan->list_size);
+                  strlcpy(
+                        task_title, msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_IN_PROGRESS),
+                        sizeof(task_title));
 
-               /* Add content to playlist */
-               manual_content_scan_add_content_to_playlist(
-                     manual_scan->task_config, manual_scan->playlist,
-                     content_path, content_type, manual_scan->dat_file,
-                     manual_scan->fuzzy_archive_match);
-            }
+                  if (!string_is_empty(content_file))
+                     strlcat(task_title, content_file, sizeof(task_title));
 
-            /* Increment content index */
-            manual_scan->list_index++;
-            if (manual_scan->list_index >= manual_scan->list_size)
-               manual_scan->status = MANUAL_SCAN_END;
+                  task_set_title(task, strdup(task_title));
+                  task_set_progress(task,
+                        (manual_scan->list_index * 100) / manual_scan->list_size);
+                  break;
+               }
+            } while (!task_get_cancelled(task));
          }
          break;
       case MANUAL_SCAN_END:
@@ -318,6 +406,9 @@ bool task_push_manual_content_scan(void)
    manual_scan->dat_file            = NULL;
    manual_scan->list_size           = 0;
    manual_scan->list_index          = 0;
+#ifdef HAVE_THREADS
+   manual_scan->ahead               = NULL;
+#endif
    manual_scan->status              = MANUAL_SCAN_BEGIN;
    manual_scan->fuzzy_archive_match = settings->bools.playlist_fuzzy_archive_match;
    manual_scan->use_old_format      = settings->bools.playlist_use_old_format;
@@ -364,6 +455,7 @@ bool task_push_manual_content_scan(void)
 
    /* > Configure task */
    task->handler                 = task_manual_content_scan_handler;
+   task->priority                = TASK_PRIORITY_SCAN;
    task->state                   = manual_scan;
    task->title                   = strdup(task_title);
    task->alternative_look        = true;
@@ -14,6 +14,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 #include <compat/strl.h>
 #include <compat/posix_string.h>
@@ -23,16 +25,34 @@
 #include <lists/string_list.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
 #include <rhash.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
+
 #include "tasks_internal.h"
 
 #include "../input/input_overlay.h"
+#include "../gfx/video_image_cache.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
 
 typedef struct overlay_loader overlay_loader_t;
 
+/* An image of the overlay config, decoded on the thread pool
+ * before the overlays are set up */
+typedef struct overlay_image_job
+{
+   char *path;
+   unsigned ol_idx;
+   /* -1 for the image of the overlay itself */
+   int desc_idx;
+   bool loaded;
+   struct texture_image image;
+} overlay_image_job_t;
+
 struct overlay_loader
 {
    enum overlay_status state;
@@ -50,8 +70,148 @@ struct overlay_loader
    float overlay_opacity;
    float overlay_scale;
    bool driver_rgba_support;
+   overlay_image_job_t *jobs;
+   size_t jobs_size;
+   size_t jobs_pos;
 };
 
+static void task_overlay_decode_image(overlay_image_job_t *job,
+      bool supports_rgba)
+{
+   job->image.supports_rgba  = supports_rgba;
+   job->image.pixels         = NULL;
+   job->image.width          = 0;
+   job->image.height         = 0;
+
+   /* Reloading an overlay, e.g. when it's hidden while the
+    * menu is up, copies the images instead of decoding them */
+   job->loaded               = video_image_cache_load(&job->image, job->path);
+}
+
+static void task_overlay_decode_range(void *arg, size_t begin, size_t end)
+{
+   size_t i;
+   overlay_loader_t *loader = (overlay_loader_t*)arg;
+
+   for (i = begin; i < end; i++)
+      task_overlay_decode_image(&loader->jobs[i],
+            loader->driver_rgba_support);
+}
+
+static void task_overlay_add_job(overlay_loader_t *loader,
+      const char *image_path, unsigned ol_idx, int desc_idx)
+{
+   char path[PATH_MAX_LENGTH];
+   overlay_image_job_t *job = &loader->jobs[loader->jobs_size++];
+
+   path[0] = '\0';
+
+   fill_pathname_resolve_relative(path, loader->overlay_path,
+         image_path, sizeof(path));
+
+   job->path     = strdup(path);
+   job->ol_idx   = ol_idx;
+   job->desc_idx = desc_idx;
+   job->loaded   = false;
+}
+
+/* Lists the images of all overlays, in the order they are
+ * set up, and decodes them at once on a thread pool */
+static bool task_overlay_decode_images(overlay_loader_t *loader)
+{
+   unsigned i, j;
+   size_t count = 0;
+#ifdef HAVE_THREADS
+   tpool_t *tp  = NULL;
+   unsigned threads;
+#endif
+
+   for (i = 0; i < loader->size; i++)
+      count += 1 + loader->overlays[i].size;
+
+   loader->jobs = (overlay_image_job_t*)calloc(count, sizeof(*loader->jobs));
+
+   if (!loader->jobs)
+      return false;
+
+   for (i = 0; i < loader->size; i++)
+   {
+      struct overlay *overlay = &loader->overlays[i];
+
+      if (!string_is_empty(overlay->config.paths.path))
+         task_overlay_add_job(loader, overlay->config.paths.path, i, -1);
+
+      for (j = 0; j < overlay->size; j++)
+      {
+         char overlay_desc_image_key[64];
+         char image_path[PATH_MAX_LENGTH];
+
+         overlay_desc_image_key[0] = '\0';
+         image_path[0]             = '\0';
+
+         snprintf(overlay_desc_image_key, sizeof(overlay_desc_image_key),
+               "overlay%u_desc%u_overlay", i, j);
+
+         if (config_get_path(loader->conf, overlay_desc_image_key,
+                  image_path, sizeof(image_path)))
+            task_overlay_add_job(loader, image_path, i, (int)j);
+      }
+   }
+
+#ifdef HAVE_THREADS
+   /* The calling thread decodes too */
+   threads = cpu_features_get_core_amount();
+   if (threads > 1 && loader->jobs_size > 1)
+      tp   = tpool_create_with_role(threads - 1, STHREAD_ROLE_TASK);
+
+   tpool_parallel_for(tp, loader->jobs_size, 1,
+         task_overlay_decode_range, loader);
+
+   if (tp)
+      tpool_destroy(tp);
+#else
+   task_overlay_decode_range(loader, 0, loader->jobs_size);
+#endif
+
+   return true;
+}
+
+/* Returns the decoded image for an overlay (@desc_idx -1) or one
+ * of its descs, or NULL if there is none. Images are taken in the
+ * order task_overlay_decode_images listed them. */
+static overlay_image_job_t *task_overlay_take_image(
+      overlay_loader_t *loader, unsigned ol_idx, int desc_idx)
+{
+   overlay_image_job_t *job = NULL;
+
+   if (loader->jobs_pos >= loader->jobs_size)
+      return NULL;
+
+   job = &loader->jobs[loader->jobs_pos];
+
+   if (job->ol_idx != ol_idx || job->desc_idx != desc_idx)
+      return NULL;
+
+   loader->jobs_pos++;
+   return job;
+}
+
+static void task_overlay_free_jobs(overlay_loader_t *loader)
+{
+   size_t i;
+
+   for (i = 0; i < loader->jobs_size; i++)
+   {
+      free(loader->jobs[i].path);
+      image_texture_free(&loader->jobs[i].image);
+   }
+
+   free(loader->jobs);
+   loader->jobs      = NULL;
+   loader->jobs_size = 0;
+   loader->jobs_pos  = 0;
+}
+
 static void task_overlay_image_done(struct overlay *overlay)
 {
    overlay->pos           = 0;
@@ -66,35 +226,16 @@ static void task_overlay_load_desc_image(
       struct overlay *input_overlay,
       unsigned ol_idx, unsigned desc_idx)
 {
-   char overlay_desc_image_key[64];
-   char image_path[PATH_MAX_LENGTH];
-   config_file_t              *conf = loader->conf;
+   overlay_image_job_t *job = task_overlay_take_image(loader,
+         ol_idx, (int)desc_idx);
 
-   overlay_desc_image_key[0]        = '\0';
-   image_path[0]                    = '\0';
-
-   snprintf(overlay_desc_image_key, sizeof(overlay_desc_image_key),
-         "overlay%u_desc%u_overlay", ol_idx, desc_idx);
-
-   if (config_get_path(conf, overlay_desc_image_key,
-            image_path, sizeof(image_path)))
+   if (job && job->loaded)
    {
-      struct texture_image image_tex;
-      char path[PATH_MAX_LENGTH];
-
-      path[0] = '\0';
-
-      fill_pathname_resolve_relative(path, loader->overlay_path,
-            image_path, sizeof(path));
-
-      image_tex.supports_rgba = loader->driver_rgba_support;
-
-      if (image_texture_load(&image_tex, path))
-      {
-         input_overlay->load_images[input_overlay->load_images_size++] = image_tex;
-         desc->image       = image_tex;
-         desc->image_index = input_overlay->load_images_size - 1;
-      }
+      input_overlay->load_images[input_overlay->load_images_size++] = job->image;
+      desc->image       = job->image;
+      desc->image_index = input_overlay->load_images_size - 1;
+      /* Owned by the overlay now */
+      job->image.pixels = NULL;
    }
 
    input_overlay->pos ++;
@@ -384,6 +525,65 @@ static void task_overlay_resolve_iterate(retro_task_t *task)
    loader->resolve_pos += 1;
 }
 
+/* Sorts the descs into the cells they can be hit in, as far as
+ * a press stretches their hitbox. */
+static void task_overlay_build_grid(struct overlay *overlay)
+{
+   size_t i;
+   unsigned c, x, y;
+   unsigned counts[OVERLAY_GRID_SIZE * OVERLAY_GRID_SIZE];
+   unsigned pass;
+
+   free(overlay->grid);
+   overlay->grid = NULL;
+
+   if (!overlay->size)
+      return;
+
+   memset(counts, 0, sizeof(counts));
+
+   /* Count the descs of each cell, then fill them in */
+   for (pass = 0; pass < 2; pass++)
+   {
+      for (i = 0; i < overlay->size; i++)
+      {
+         const struct overlay_desc *desc = &overlay->descs[i];
+         float range_mod = desc->range_mod > 1.0f ? desc->range_mod : 1.0f;
+         float range_x   = fabs(desc->range_x) * range_mod;
+         float range_y   = fabs(desc->range_y) * range_mod;
+         unsigned x0     = OVERLAY_GRID_CELL(desc->x - range_x);
+         unsigned x1     = OVERLAY_GRID_CELL(desc->x + range_x);
+         unsigned y0     = OVERLAY_GRID_CELL(desc->y - range_y);
+         unsigned y1     = OVERLAY_GRID_CELL(desc->y + range_y);
+
+         for (y = y0; y <= y1; y++)
+            for (x = x0; x <= x1; x++)
+            {
+               c = y * OVERLAY_GRID_SIZE + x;
+               if (pass)
+                  overlay->grid[overlay->grid_offsets[c] + counts[c]] = (unsigned)i;
+               counts[c]++;
+            }
+      }
+
+      if (pass)
+         break;
+
+      overlay->grid_offsets[0] = 0;
+      for (c = 0; c < OVERLAY_GRID_SIZE * OVERLAY_GRID_SIZE; c++)
+      {
+         overlay->grid_offsets[c + 1] = overlay->grid_offsets[c] + counts[c];
+         counts[c]                    = 0;
+      }
+
+      overlay->grid = (unsigned*)malloc(
+            overlay->grid_offsets[c] * sizeof(*overlay->grid));
+      /* Hit-tested against every desc then */
+      if (!overlay->grid)
+         return;
+   }
+}
+
 static void task_overlay_deferred_loading(retro_task_t *task)
 {
    size_t i                  = 0;
@@ -406,6 +606,27 @@ static void task_overlay_deferred_loading(retro_task_t *task)
          break;
 #endif
       case OVERLAY_IMAGE_TRANSFER_DONE:
+         {
+            overlay_image_job_t *job = task_overlay_take_image(loader,
+                  loader->pos, -1);
+
+            if (job)
+            {
+               if (!job->loaded)
+               {
+                  RARCH_ERR("[Overlay]: Failed to load image: %s.\n",
+                        job->path);
+                  task_set_cancelled(task, true);
+                  loader->state   = OVERLAY_STATUS_DEFERRED_ERROR;
+                  break;
+               }
+
+               overlay->load_images[overlay->load_images_size++] = job->image;
+               overlay->image    = job->image;
+               job->image.pixels = NULL;
+            }
+         }
+
          task_overlay_image_done(&loader->overlays[loader->pos]);
          loader->loading_status = OVERLAY_IMAGE_TRANSFER_DESC_IMAGE_ITERATE;
          loader->overlays[loader->pos].pos = 0;
@@ -456,6 +677,8 @@ static void task_overlay_deferred_loading(retro_task_t *task)
          }
          break;
       case OVERLAY_IMAGE_TRANSFER_DESC_DONE:
+         task_overlay_build_grid(overlay);
+
          if (loader->pos == 0)
             task_overlay_resolve_iterate(task);
 
@@ -490,7 +713,7 @@ static void task_overlay_deferred_load(retro_task_t *task)
       if (!to_cont)
       {
          loader->pos   = 0;
-         loader->state = OVERLAY_STATUS_DEFERRED_LOADING;
+         loader->state = OVERLAY_STATUS_DEFERRED_LOADING_IMAGE;
          break;
       }
 
@@ -565,30 +788,8 @@ static void task_overlay_deferred_load(retro_task_t *task)
          strlcpy(overlay->config.paths.path,
                tmp_str, sizeof(overlay->config.paths.path));
 
-      if (!string_is_empty(overlay->config.paths.path))
-      {
-         struct texture_image image_tex;
-         char overlay_resolved_path[PATH_MAX_LENGTH];
-
-         overlay_resolved_path[0] = '\0';
-
-         fill_pathname_resolve_relative(overlay_resolved_path,
-               loader->overlay_path,
-               overlay->config.paths.path, sizeof(overlay_resolved_path));
-
-         image_tex.supports_rgba = loader->driver_rgba_support;
-
-         if (!image_texture_load(&image_tex, overlay_resolved_path))
-         {
-            RARCH_ERR("[Overlay]: Failed to load image: %s.\n",
-                  overlay_resolved_path);
-            loader->loading_status = OVERLAY_IMAGE_TRANSFER_ERROR;
-            goto error;
-         }
-
-         overlay->load_images[overlay->load_images_size++] = image_tex;
-         overlay->image = image_tex;
-      }
+      /* The image itself is decoded with the desc images,
+       * see task_overlay_decode_images */
 
       snprintf(overlay->config.names.key, sizeof(overlay->config.names.key),
             "overlay%u_name", loader->pos);
@@ -646,6 +847,8 @@ static void task_overlay_free(retro_task_t *task)
    if (loader->overlay_path)
       free(loader->overlay_path);
 
+   task_overlay_free_jobs(loader);
+
    if (task_get_cancelled(task))
    {
       for (i = 0; i < overlay->load_images_size; i++)
@@ -678,6 +881,16 @@ static void task_overlay_handler(retro_task_t *task)
       case OVERLAY_STATUS_DEFERRED_LOAD:
          task_overlay_deferred_load(task);
          break;
+      case OVERLAY_STATUS_DEFERRED_LOADING_IMAGE:
+         if (task_overlay_decode_images(loader))
+            loader->state = OVERLAY_STATUS_DEFERRED_LOADING;
+         else
+         {
+            RARCH_ERR("[Overlay]: Failed to allocate images.\n");
+            task_set_cancelled(task, true);
+            loader->state = OVERLAY_STATUS_DEFERRED_ERROR;
+         }
+         break;
       case OVERLAY_STATUS_DEFERRED_LOADING_RESOLVE:
          task_overlay_resolve_iterate(task);
          break;
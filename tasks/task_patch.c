@@ -20,6 +20,7 @@
 /* TODO/FIXME - turn this into actual task */
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <boolean.h>
@@ -69,9 +70,6 @@ struct bps_data
    size_t modify_offset;
    size_t source_offset;
    size_t target_offset;
-   uint32_t modify_checksum;
-   uint32_t source_checksum;
-   uint32_t target_checksum;
    size_t source_relative_offset;
    size_t target_relative_offset;
    size_t output_offset;
@@ -80,28 +78,50 @@ struct bps_data
 struct ups_data
 {
    const uint8_t *patch_data;
-   const uint8_t *source_data;
-   uint8_t *target_data;
-   unsigned patch_length;
-   unsigned source_length;
-   unsigned target_length;
-   unsigned patch_offset;
-   unsigned source_offset;
-   unsigned target_offset;
-   unsigned patch_checksum;
-   unsigned source_checksum;
-   unsigned target_checksum;
+   size_t patch_length;
+   size_t patch_offset;
 };
 
+/* The content is patched in place in *buf where the format allows,
+ * else *buf is replaced with the patched content. It's left as it
+ * was on failure. */
 typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
-      const uint8_t*, uint64_t, uint8_t**, uint64_t*);
+      uint8_t**, uint64_t*);
+
+/* Reads a little endian checksum at the end of a patch */
+static uint32_t patch_read_checksum(const uint8_t *data)
+{
+   return (uint32_t)data[0]
+      | ((uint32_t)data[1] << 8)
+      | ((uint32_t)data[2] << 16)
+      | ((uint32_t)data[3] << 24);
+}
+
+/* Grows content being patched in place, the bytes past its end
+ * read as zeros. Keeps the NUL terminator filestream_read_file
+ * puts after it. */
+static bool patch_grow_buffer(uint8_t **buf,
+      uint64_t size, uint64_t new_size)
+{
+   uint8_t *prov;
+
+   if (new_size <= size)
+      return true;
+
+   prov = (uint8_t*)realloc(*buf, (size_t)new_size + 1);
+   if (!prov)
+      return false;
+
+   memset(prov + size, 0, (size_t)(new_size - size) + 1);
+   *buf = prov;
+   return true;
+}
 
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data         = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+   return 0x00;
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
@@ -124,39 +144,34 @@ static uint64_t bps_decode(struct bps_data *bps)
 static void bps_write(struct bps_data *bps, uint8_t data)
 {
    bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = ~(encoding_crc32(~bps->target_checksum, &data, 1));
 }
 
+/* Copies from the source or the target can be from anywhere before,
+ * so BPS always needs a buffer of its own for the target. */
 static enum patch_error bps_apply_patch(
       const uint8_t *modify_data, uint64_t modify_length,
-      const uint8_t *source_data, uint64_t source_length,
-      uint8_t **target_data, uint64_t *target_length)
+      uint8_t **buf, uint64_t *length)
 {
    size_t i;
    struct bps_data bps;
-   uint32_t checksum               = 0;
+   enum patch_error err            = PATCH_SUCCESS;
+   uint32_t target_checksum        = 0;
    size_t modify_source_size       = 0;
    size_t modify_target_size       = 0;
    size_t modify_markup_size       = 0;
-   uint32_t modify_source_checksum = 0;
-   uint32_t modify_target_checksum = 0;
-   uint32_t modify_modify_checksum = 0;
 
    if (modify_length < 19)
       return PATCH_PATCH_TOO_SMALL;
 
    bps.modify_data            = modify_data;
-   bps.source_data            = source_data;
-   bps.target_data            = *target_data;
+   bps.source_data            = *buf;
+   bps.target_data            = NULL;
    bps.modify_length          = modify_length;
-   bps.source_length          = source_length;
-   bps.target_length          = *target_length;
+   bps.source_length          = *length;
+   bps.target_length          = 0;
    bps.modify_offset          = 0;
    bps.source_offset          = 0;
    bps.target_offset          = 0;
-   bps.modify_checksum        = ~0;
-   bps.source_checksum        = 0;
-   bps.target_checksum        = ~0;
    bps.source_relative_offset = 0;
    bps.target_relative_offset = 0;
    bps.output_offset          = 0;
@@ -167,6 +182,11 @@ static enum patch_error bps_apply_patch(
          (bps_read(&bps) != '1'))
       return PATCH_PATCH_INVALID_HEADER;
 
+   /* The checksums are checked before anything is written */
+   if (encoding_crc32(0, modify_data, bps.modify_length - 4)
+         != patch_read_checksum(modify_data + bps.modify_length - 4))
+      return PATCH_PATCH_CHECKSUM_INVALID;
+
    modify_source_size  = bps_decode(&bps);
    modify_target_size  = bps_decode(&bps);
    modify_markup_size  = bps_decode(&bps);
@@ -177,18 +197,16 @@ static enum patch_error bps_apply_patch(
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
 
-   if (modify_target_size > bps.target_length)
-   {
-      uint8_t *prov=(uint8_t*)malloc((size_t)modify_target_size);
-
-      if (!prov)
-         return PATCH_TARGET_ALLOC_FAILED;
+   if (encoding_crc32(0, bps.source_data, bps.source_length)
+         != patch_read_checksum(modify_data + bps.modify_length - 12))
+      return PATCH_SOURCE_CHECKSUM_INVALID;
 
-      free(*target_data);
-      bps.target_data   = prov;
-      *target_data      = prov;
-      bps.target_length = modify_target_size;
-   }
+   /* One more byte, for the NUL terminator content buffers have */
+   bps.target_data = (uint8_t*)malloc(modify_target_size + 1);
+   if (!bps.target_data)
+      return PATCH_TARGET_ALLOC_FAILED;
+   bps.target_length                   = modify_target_size;
+   bps.target_data[modify_target_size] = '\0';
 
    while (bps.modify_offset < bps.modify_length - 12)
    {
@@ -197,9 +215,21 @@ static enum patch_error bps_apply_patch(
 
       length = (length >> 2) + 1;
 
+      if (length > bps.target_length - bps.output_offset)
+      {
+         err = PATCH_TARGET_INVALID;
+         goto end;
+      }
+
       switch (mode)
       {
          case SOURCE_READ:
+            if (     bps.output_offset > bps.source_length
+                  || length > bps.source_length - bps.output_offset)
+            {
+               err = PATCH_PATCH_INVALID;
+               goto end;
+            }
             while (length--)
                bps_write(&bps, bps.source_data[bps.output_offset]);
             break;
@@ -223,12 +253,24 @@ static enum patch_error bps_apply_patch(
             if (mode == SOURCE_COPY)
             {
                bps.source_offset += offset;
+               if (     bps.source_offset > bps.source_length
+                     || length > bps.source_length - bps.source_offset)
+               {
+                  err = PATCH_PATCH_INVALID;
+                  goto end;
+               }
                while (length--)
                   bps_write(&bps, bps.source_data[bps.source_offset++]);
             }
             else
             {
                bps.target_offset += offset;
+               /* Only what's already been written can be copied */
+               if (bps.target_offset >= bps.output_offset)
+               {
+                  err = PATCH_PATCH_INVALID;
+                  goto end;
+               }
                while (length--)
                   bps_write(&bps, bps.target_data[bps.target_offset++]);
                break;
@@ -238,71 +280,34 @@ static enum patch_error bps_apply_patch(
       }
    }
 
-   for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
-   for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
-
-   checksum = ~bps.modify_checksum;
-   for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
-
-   bps.source_checksum = encoding_crc32(0,
-         bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
-
-   if (bps.source_checksum != modify_source_checksum)
-      return PATCH_SOURCE_CHECKSUM_INVALID;
+   target_checksum = encoding_crc32(0, bps.target_data, bps.target_length);
 
-   if (bps.target_checksum != modify_target_checksum)
-      return PATCH_TARGET_CHECKSUM_INVALID;
+   if (     bps.output_offset != bps.target_length
+         || target_checksum != patch_read_checksum(
+            modify_data + bps.modify_length - 8))
+      err = PATCH_TARGET_CHECKSUM_INVALID;
 
-   if (checksum != modify_modify_checksum)
-      return PATCH_PATCH_CHECKSUM_INVALID;
+end:
+   if (err != PATCH_SUCCESS)
+   {
+      free(bps.target_data);
+      return err;
+   }
 
-   *target_length = modify_target_size;
+   free(*buf);
+   *buf    = bps.target_data;
+   *length = bps.target_length;
 
    return PATCH_SUCCESS;
 }
 
 static uint8_t ups_patch_read(struct ups_data *data)
 {
-   if (data && data->patch_offset < data->patch_length)
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum =
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
+   if (data->patch_offset < data->patch_length)
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
-static uint8_t ups_source_read(struct ups_data *data)
-{
-   if (data && data->source_offset < data->source_length)
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
-   }
-   return 0x00;
-}
-
-static void ups_target_write(struct ups_data *data, uint8_t n)
-{
-
-   if (data && data->target_offset < data->target_length)
-   {
-      data->target_data[data->target_offset] = n;
-      data->target_checksum =
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
-
-   if (data)
-      data->target_offset++;
-}
-
 static uint64_t ups_decode(struct ups_data *data)
 {
    uint64_t offset = 0, shift = 1;
@@ -320,32 +325,50 @@ static uint64_t ups_decode(struct ups_data *data)
    return offset;
 }
 
+/* XORs the patch into the content. Doing it again undoes it. */
+static void ups_apply_xor(struct ups_data *data, size_t start,
+      uint8_t *target, size_t target_length)
+{
+   size_t offset      = 0;
+
+   data->patch_offset = start;
+
+   while (data->patch_offset < data->patch_length - 12)
+   {
+      offset += (size_t)ups_decode(data);
+
+      for (;;)
+      {
+         uint8_t patch_xor = ups_patch_read(data);
+         if (offset < target_length)
+            target[offset] ^= patch_xor;
+         offset++;
+         if (patch_xor == 0)
+            break;
+      }
+   }
+}
+
+/* UPS patches are XORed byte for byte with the source, in place,
+ * either way round. */
 static enum patch_error ups_apply_patch(
       const uint8_t *patchdata, uint64_t patchlength,
-      const uint8_t *sourcedata, uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint8_t **buf, uint64_t *length)
 {
-   size_t i;
    struct ups_data data;
-   unsigned source_read_length;
-   unsigned target_read_length;
-   uint32_t patch_result_checksum;
-   uint32_t patch_read_checksum  = 0;
-   uint32_t source_read_checksum = 0;
-   uint32_t target_read_checksum = 0;
+   size_t start;
+   uint64_t source_read_length;
+   uint64_t target_read_length;
+   uint64_t target_length;
+   uint32_t source_checksum;
+   uint32_t source_read_checksum;
+   uint32_t target_read_checksum;
+   uint32_t target_checksum;
+   uint64_t source_length = *length;
 
    data.patch_data      = patchdata;
-   data.source_data     = sourcedata;
-   data.target_data     = *targetdata;
-   data.patch_length    = (unsigned)patchlength;
-   data.source_length   = (unsigned)sourcelength;
-   data.target_length   = (unsigned)*targetlength;
+   data.patch_length    = (size_t)patchlength;
    data.patch_offset    = 0;
-   data.source_offset   = 0;
-   data.target_offset   = 0;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
 
    if (data.patch_length < 18)
       return PATCH_PATCH_INVALID;
@@ -358,91 +381,67 @@ static enum patch_error ups_apply_patch(
       )
       return PATCH_PATCH_INVALID;
 
-   source_read_length = (unsigned)ups_decode(&data);
-   target_read_length = (unsigned)ups_decode(&data);
+   if (encoding_crc32(0, patchdata, data.patch_length - 4)
+         != patch_read_checksum(patchdata + data.patch_length - 4))
+      return PATCH_PATCH_INVALID;
 
-   if (     (data.source_length != source_read_length)
-         && (data.source_length != target_read_length))
-      return PATCH_SOURCE_INVALID;
+   source_read_length   = ups_decode(&data);
+   target_read_length   = ups_decode(&data);
+   start                = data.patch_offset;
+   source_read_checksum = patch_read_checksum(
+         patchdata + data.patch_length - 12);
+   target_read_checksum = patch_read_checksum(
+         patchdata + data.patch_length - 8);
 
-   *targetlength = (data.source_length == source_read_length ?
-         target_read_length : source_read_length);
+   /* The source is checked before it's patched over */
+   source_checksum      = encoding_crc32(0, *buf, (size_t)source_length);
 
-   if (data.target_length < *targetlength)
+   if (     source_length   == source_read_length
+         && source_checksum == source_read_checksum)
    {
-      uint8_t *prov=(uint8_t*)malloc((size_t)*targetlength);
-      if (!prov)
-         return PATCH_TARGET_ALLOC_FAILED;
-      free(*targetdata);
-      *targetdata      = prov;
-      data.target_data = prov;
+      target_length   = target_read_length;
+      target_checksum = target_read_checksum;
    }
-
-   data.target_length = (unsigned)*targetlength;
-   
-   while (data.patch_offset < data.patch_length - 12)
+   else if (source_length   == target_read_length
+         && source_checksum == target_read_checksum)
    {
-      unsigned length = (unsigned)ups_decode(&data);
-      while (length--)
-         ups_target_write(&data, ups_source_read(&data));
-
-      for (;;)
-      {
-         uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
-         if (patch_xor == 0)
-            break;
-      }
+      target_length   = source_read_length;
+      target_checksum = source_read_checksum;
    }
+   else
+      return PATCH_SOURCE_INVALID;
 
-   while (data.source_offset < data.source_length)
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length)
-      ups_target_write(&data, ups_source_read(&data));
-
-   for (i = 0; i < 4; i++)
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
-   for (i = 0; i < 4; i++)
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
-
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   if (!patch_grow_buffer(buf, source_length, target_length))
+      return PATCH_TARGET_ALLOC_FAILED;
 
-   for (i = 0; i < 4; i++)
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
+   ups_apply_xor(&data, start, *buf, (size_t)target_length);
 
-   if (patch_result_checksum != patch_read_checksum)
-      return PATCH_PATCH_INVALID;
-
-   if (     data.source_checksum == source_read_checksum
-         && data.source_length   == source_read_length)
+   if (encoding_crc32(0, *buf, (size_t)target_length) != target_checksum)
    {
-      if (     data.target_checksum == target_read_checksum
-            && data.target_length   == target_read_length)
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
-   }
-   else if (data.source_checksum == target_read_checksum
-         && data.source_length   == target_read_length)
-   {
-      if (     data.target_checksum == source_read_checksum
-            && data.target_length   == source_read_length)
-         return PATCH_SUCCESS;
+      ups_apply_xor(&data, start, *buf, (size_t)target_length);
+      if (target_length > source_length)
+         memset(*buf + source_length, 0,
+               (size_t)(target_length - source_length) + 1);
       return PATCH_TARGET_INVALID;
    }
 
-   return PATCH_SOURCE_INVALID;
+   if (target_length < source_length)
+      (*buf)[target_length] = '\0';
+   *length = target_length;
+
+   return PATCH_SUCCESS;
 }
 
-static enum patch_error ips_alloc_targetdata(
+/* Goes through the patch once to check it, and to get the size
+ * of the target and how far into it the patch writes. */
+static enum patch_error ips_get_target_length(
       const uint8_t *patchdata, uint64_t patchlen,
       uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint64_t *targetlength, uint64_t *writelength)
 {
-   uint8_t *prov_alloc;
    uint32_t offset = 5;
    *targetlength   = sourcelength;
+   *writelength    = sourcelength;
 
    for (;;)
    {
@@ -459,26 +458,13 @@ static enum patch_error ips_alloc_targetdata(
       if (address == 0x454f46) /* EOF */
       {
          if (offset == patchlen)
-         {
-            prov_alloc     = (uint8_t*)malloc((size_t)*targetlength);
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
             return PATCH_SUCCESS;
-         }
          else if (offset == patchlen - 3)
          {
             uint32_t size  = patchdata[offset++] << 16;
             size          |= patchdata[offset++] << 8;
             size          |= patchdata[offset++] << 0;
             *targetlength  = size;
-            prov_alloc     = (uint8_t*)malloc((size_t)*targetlength);
-
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
             return PATCH_SUCCESS;
          }
       }
@@ -494,11 +480,8 @@ static enum patch_error ips_alloc_targetdata(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-         {
-            address++;
-            offset++;
-         }
+         address += length;
+         offset  += length;
       }
       else /* RLE */
       {
@@ -511,24 +494,27 @@ static enum patch_error ips_alloc_targetdata(
          if (length == 0) /* Illegal */
             break;
 
-         while (length--)
-            address++;
-
+         address += length;
          offset++;
       }
 
       if (address > *targetlength)
          *targetlength = address;
+      if (address > *writelength)
+         *writelength  = address;
    }
 
    return PATCH_PATCH_INVALID;
 }
 
+/* IPS records overwrite the source where they say, in place. */
 static enum patch_error ips_apply_patch(
       const uint8_t *patchdata, uint64_t patchlen,
-      const uint8_t *sourcedata, uint64_t sourcelength,
-      uint8_t **targetdata, uint64_t *targetlength)
+      uint8_t **buf, uint64_t *length)
 {
+   uint8_t *targetdata;
+   uint64_t targetlength;
+   uint64_t writelength;
    uint32_t offset = 5;
    enum patch_error error_patch = PATCH_UNKNOWN;
    if (  patchlen      < 8   ||
@@ -538,73 +524,77 @@ static enum patch_error ips_apply_patch(
          patchdata[3] != 'C' ||
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
-   
-   if ((error_patch = ips_alloc_targetdata(
-               patchdata, patchlen, sourcelength,
-               targetdata, targetlength)) != PATCH_SUCCESS)
+
+   if ((error_patch = ips_get_target_length(
+               patchdata, patchlen, *length,
+               &targetlength, &writelength)) != PATCH_SUCCESS)
       return error_patch;
 
-   memcpy(*targetdata, sourcedata, (size_t)sourcelength);
+   if (targetlength > writelength)
+      writelength = targetlength;
 
+   if (!patch_grow_buffer(buf, *length, writelength))
+      return PATCH_TARGET_ALLOC_FAILED;
+   targetdata = *buf;
+
+   /* Checked whole above, this can't fail along the way */
    for (;;)
    {
       uint32_t address;
       unsigned length;
 
-      if (offset > patchlen - 3)
-         break;
-
       address  = patchdata[offset++] << 16;
       address |= patchdata[offset++] << 8;
       address |= patchdata[offset++] << 0;
 
       if (address == 0x454f46) /* EOF */
       {
-         if (offset == patchlen)
-            return PATCH_SUCCESS;
-
-         if (offset == patchlen - 3)
-         {
-            uint32_t size  = patchdata[offset++] << 16;
-            size          |= patchdata[offset++] << 8;
-            size          |= patchdata[offset++] << 0;
-            return PATCH_SUCCESS;
-         }
+         if (offset == patchlen || offset == patchlen - 3)
+            break;
       }
 
-      if (offset > patchlen - 2)
-         break;
-
       length  = patchdata[offset++] << 8;
       length |= patchdata[offset++] << 0;
 
       if (length) /* Copy */
       {
-         if (offset > patchlen - length)
-            break;
-
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset++];
+         memcpy(targetdata + address, patchdata + offset, length);
+         offset += length;
       }
       else /* RLE */
       {
-         if (offset > patchlen - 3)
-            break;
-
          length  = patchdata[offset++] << 8;
          length |= patchdata[offset++] << 0;
 
-         if (length == 0) /* Illegal */
-            break;
-
-         while (length--)
-            (*targetdata)[address++] = patchdata[offset];
-
+         memset(targetdata + address, patchdata[offset], length);
          offset++;
       }
    }
 
-   return PATCH_PATCH_INVALID;
+   if (targetlength < writelength)
+      targetdata[targetlength] = '\0';
+   *length = targetlength;
+
+   return PATCH_SUCCESS;
+}
+
+/* For patches that aren't content, see task_core_updater.c.
+ * The source and target checksums of the patch are verified. */
+bool patch_bps_buffer(const uint8_t *patch, uint64_t patch_size,
+      uint8_t **buf, uint64_t *size)
+{
+   enum patch_error err = bps_apply_patch(patch, patch_size, buf, size);
+
+   if (err != PATCH_SUCCESS)
+   {
+      RARCH_ERR("%s BPS: %s #%u\n",
+            msg_hash_to_str(MSG_FAILED_TO_PATCH),
+            msg_hash_to_str(MSG_ERROR),
+            (unsigned)err);
+      return false;
+   }
+
+   return true;
 }
 
 static bool apply_patch_content(uint8_t **buf,
@@ -612,21 +602,14 @@ static bool apply_patch_content(uint8_t **buf,
       patch_func_t func, void *patch_data, int64_t patch_size)
 {
    enum patch_error err     = PATCH_UNKNOWN;
-   ssize_t ret_size         = *size;
-   uint8_t *ret_buf         = *buf;
-   uint64_t target_size     = 0;
-   uint8_t *patched_content = NULL;
+   uint64_t target_size     = *size;
 
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n",
          patch_desc, patch_path);
 
-   if ((err = func((const uint8_t*)patch_data, patch_size, ret_buf,
-         ret_size, &patched_content, &target_size)) == PATCH_SUCCESS)
-   {
-      free(ret_buf);
-      *buf  = patched_content;
+   if ((err = func((const uint8_t*)patch_data, patch_size,
+         buf, &target_size)) == PATCH_SUCCESS)
       *size = target_size;
-   }
    else
       RARCH_ERR("%s %s: %s #%u\n",
             msg_hash_to_str(MSG_FAILED_TO_PATCH),
@@ -19,11 +19,19 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <string/stdstring.h>
 #include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
 #include <net/net_http.h>
 #include <streams/file_stream.h>
+#include <formats/image.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "tasks_internal.h"
 #include "task_file_transfer.h"
@@ -31,6 +39,7 @@
 #include "../configuration.h"
 #include "../file_path_special.h"
 #include "../playlist.h"
+#include "../retroarch.h"
 #include "../verbosity.h"
 
 #ifdef RARCH_INTERNAL
@@ -49,6 +58,37 @@ enum pl_thumb_status
    PL_THUMB_END
 };
 
+/* Transfers running at once for each task; the HTTP tasks
+ * share the pool of kept-alive connections */
+#define PL_THUMB_MAX_TRANSFERS 4
+
+/* Lists the thumbnails the server answered 404 for, so that
+ * they aren't asked for on every run. The first line is the
+ * time the list was started, it's dropped when older than
+ * PL_THUMB_MISSING_MAX_AGE seconds */
+#define PL_THUMB_MISSING_FILE    "missing_thumbnails.lst"
+#define PL_THUMB_MISSING_MAX_AGE (30 * 24 * 60 * 60)
+
+struct pl_thumb_handle;
+
+typedef struct pl_thumb_transfer
+{
+   struct pl_thumb_handle *pl_thumb;
+   char *url;
+   int http_status;
+   /* Owned by the task handler */
+   bool active;
+   /* Set by the HTTP callback, under transfer_lock */
+   bool complete;
+} pl_thumb_transfer_t;
+
+/* The files of one thumbnail directory, sorted */
+typedef struct pl_thumb_dir
+{
+   char *path;
+   struct string_list *files;
+} pl_thumb_dir_t;
+
 typedef struct pl_thumb_handle
 {
    char *system;
@@ -56,8 +96,18 @@ typedef struct pl_thumb_handle
    char *dir_thumbnails;
    playlist_t *playlist;
    menu_thumbnail_path_data_t *thumbnail_path_data;
-   retro_task_t *http_task;
-   bool http_task_complete;
+   pl_thumb_transfer_t transfers[PL_THUMB_MAX_TRANSFERS];
+#ifdef HAVE_THREADS
+   slock_t *transfer_lock;
+#endif
+   /* Whole playlist downloads only: directory listings
+    * used instead of checking each file, and the 404 list */
+   pl_thumb_dir_t *dirs;
+   size_t num_dirs;
+   struct string_list *missing;
+   struct string_list *missing_new;
+   time_t missing_time;
+   bool batch;
    size_t list_size;
    size_t list_index;
    unsigned type_idx;
@@ -165,15 +215,273 @@ static bool get_thumbnail_paths(
    return true;
 }
 
+static void pl_thumb_lock(pl_thumb_handle_t *pl_thumb)
+{
+#ifdef HAVE_THREADS
+   if (pl_thumb->transfer_lock)
+      slock_lock(pl_thumb->transfer_lock);
+#endif
+}
+
+static void pl_thumb_unlock(pl_thumb_handle_t *pl_thumb)
+{
+#ifdef HAVE_THREADS
+   if (pl_thumb->transfer_lock)
+      slock_unlock(pl_thumb->transfer_lock);
+#endif
+}
+
+/* Retires finished transfers, noting the thumbnails the
+ * server doesn't have. Returns the number still running,
+ * and a free transfer slot (or NULL) in @free_slot */
+static unsigned pl_thumb_poll_transfers(pl_thumb_handle_t *pl_thumb,
+      pl_thumb_transfer_t **free_slot)
+{
+   unsigned i;
+   unsigned running = 0;
+
+   *free_slot = NULL;
+
+   pl_thumb_lock(pl_thumb);
+
+   for (i = 0; i < PL_THUMB_MAX_TRANSFERS; i++)
+   {
+      pl_thumb_transfer_t *transfer = &pl_thumb->transfers[i];
+
+      if (transfer->active && !transfer->complete)
+      {
+         running++;
+         continue;
+      }
+
+      if (transfer->active)
+      {
+         if (transfer->http_status == 404 && pl_thumb->missing_new)
+         {
+            union string_list_elem_attr attr;
+            attr.i = 0;
+            string_list_append(pl_thumb->missing_new, transfer->url, attr);
+         }
+
+         free(transfer->url);
+         transfer->url      = NULL;
+         transfer->active   = false;
+         transfer->complete = false;
+      }
+
+      if (!*free_slot)
+         *free_slot = transfer;
+   }
+
+   pl_thumb_unlock(pl_thumb);
+
+   return running;
+}
+
+static int pl_thumb_elem_cmp(const void *a, const void *b)
+{
+   return strcmp(((const struct string_list_elem*)a)->data,
+         ((const struct string_list_elem*)b)->data);
+}
+
+static bool pl_thumb_list_has(const struct string_list_elem *elems,
+      size_t count, const char *str)
+{
+   struct string_list_elem key;
+
+   if (!elems || !count)
+      return false;
+
+   key.data = (char*)str;
+
+   return bsearch(&key, elems, count,
+         sizeof(*elems), pl_thumb_elem_cmp) != NULL;
+}
+
+/* Checks whether a thumbnail exists. Whole playlist downloads
+ * list each thumbnail directory once and search the listing,
+ * instead of asking the file system for every entry */
+static bool pl_thumb_file_exists(pl_thumb_handle_t *pl_thumb,
+      const char *path)
+{
+   size_t i;
+   char dir[PATH_MAX_LENGTH];
+   pl_thumb_dir_t *entry = NULL;
+
+   if (!pl_thumb->batch)
+      return path_is_valid(path);
+
+   dir[0] = '\0';
+   fill_pathname_basedir(dir, path, sizeof(dir));
+
+   for (i = 0; i < pl_thumb->num_dirs; i++)
+   {
+      if (string_is_equal(pl_thumb->dirs[i].path, dir))
+      {
+         entry = &pl_thumb->dirs[i];
+         break;
+      }
+   }
+
+   if (!entry)
+   {
+      pl_thumb_dir_t *dirs = (pl_thumb_dir_t*)realloc(pl_thumb->dirs,
+            (pl_thumb->num_dirs + 1) * sizeof(*dirs));
+
+      if (!dirs)
+         return path_is_valid(path);
+
+      pl_thumb->dirs = dirs;
+      entry          = &dirs[pl_thumb->num_dirs++];
+      entry->path    = strdup(dir);
+      entry->files   = dir_list_new(dir, NULL, false, true, false, false);
+
+      if (entry->files)
+         qsort(entry->files->elems, entry->files->size,
+               sizeof(*entry->files->elems), pl_thumb_elem_cmp);
+   }
+
+   /* No directory yet, so no thumbnails */
+   if (!entry->files)
+      return false;
+
+   return pl_thumb_list_has(entry->files->elems,
+         entry->files->size, path);
+}
+
+static bool pl_thumb_is_missing(pl_thumb_handle_t *pl_thumb,
+      const char *url)
+{
+   /* Element 0 is the time the list was started */
+   if (!pl_thumb->missing || pl_thumb->missing->size < 2)
+      return false;
+
+   return pl_thumb_list_has(pl_thumb->missing->elems + 1,
+         pl_thumb->missing->size - 1, url);
+}
+
+static void pl_thumb_missing_load(pl_thumb_handle_t *pl_thumb)
+{
+   char path[PATH_MAX_LENGTH];
+   void *buf                 = NULL;
+   int64_t len               = 0;
+   struct string_list *list  = NULL;
+   time_t now                = time(NULL);
+
+   path[0] = '\0';
+
+   pl_thumb->missing_new  = string_list_new();
+   pl_thumb->missing_time = now;
+
+   fill_pathname_join(path, pl_thumb->dir_thumbnails,
+         PL_THUMB_MISSING_FILE, sizeof(path));
+
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &buf, &len))
+      return;
+
+   list = string_split((const char*)buf, "\n");
+   free(buf);
+
+   if (!list)
+      return;
+
+   if (list->size > 0)
+   {
+      time_t started = (time_t)strtoul(list->elems[0].data, NULL, 10);
+
+      if (started <= now && now - started < PL_THUMB_MISSING_MAX_AGE)
+      {
+         qsort(list->elems + 1, list->size - 1,
+               sizeof(*list->elems), pl_thumb_elem_cmp);
+         pl_thumb->missing      = list;
+         pl_thumb->missing_time = started;
+         return;
+      }
+   }
+
+   /* Too old - ask the server again */
+   string_list_free(list);
+   filestream_delete(path);
+}
+
+static void pl_thumb_missing_save(pl_thumb_handle_t *pl_thumb)
+{
+   size_t i;
+   char path[PATH_MAX_LENGTH];
+   RFILE *file = NULL;
+
+   path[0] = '\0';
+
+   if (!pl_thumb->missing_new || pl_thumb->missing_new->size < 1)
+      return;
+
+   if (!path_is_directory(pl_thumb->dir_thumbnails) &&
+       !path_mkdir(pl_thumb->dir_thumbnails))
+      return;
+
+   fill_pathname_join(path, pl_thumb->dir_thumbnails,
+         PL_THUMB_MISSING_FILE, sizeof(path));
+
+   file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return;
+
+   filestream_printf(file, "%lu\n",
+         (unsigned long)pl_thumb->missing_time);
+
+   if (pl_thumb->missing)
+      for (i = 1; i < pl_thumb->missing->size; i++)
+         filestream_printf(file, "%s\n", pl_thumb->missing->elems[i].data);
+
+   for (i = 0; i < pl_thumb->missing_new->size; i++)
+      filestream_printf(file, "%s\n", pl_thumb->missing_new->elems[i].data);
+
+   filestream_close(file);
+}
+
+#if defined(RARCH_INTERNAL) && defined(HAVE_MENU)
+static void cb_pl_thumb_cache_image(
+      retro_task_t *task, void *task_data,
+      void *user_data, const char *err)
+{
+   struct texture_image *img = (struct texture_image*)task_data;
+
+   if (!img)
+      return;
+
+   image_texture_free(img);
+   free(img);
+}
+
+/* Decodes a new thumbnail once, so that the menu finds the
+ * pre-scaled copy the image task keeps in the cache */
+static void pl_thumb_cache_image(const char *path)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (!settings || !settings->bools.menu_thumbnail_cache)
+      return;
+
+   task_push_image_load_priority(path, video_driver_supports_rgba(),
+         settings->uints.menu_thumbnail_upscale_threshold,
+         TASK_PRIORITY_DOWNLOAD, cb_pl_thumb_cache_image, NULL);
+}
+#endif
+
 /* Thumbnail download http task callback function
  * > Writes thumbnail file to disk */
 void cb_http_task_download_pl_thumbnail(
       retro_task_t *task, void *task_data,
       void *user_data, const char *err)
 {
-   http_transfer_data_t *data  = (http_transfer_data_t*)task_data;
-   file_transfer_t *transf     = (file_transfer_t*)user_data;
-   pl_thumb_handle_t *pl_thumb = NULL;
+   http_transfer_data_t *data          = (http_transfer_data_t*)task_data;
+   file_transfer_t *transf             = (file_transfer_t*)user_data;
+   pl_thumb_transfer_t *transfer       = NULL;
+   bool batch                          = false;
    char output_dir[PATH_MAX_LENGTH];
 
    output_dir[0] = '\0';
@@ -184,12 +492,17 @@ void cb_http_task_download_pl_thumbnail(
    if (!transf)
       goto finish;
 
-   pl_thumb = (pl_thumb_handle_t*)transf->user_data;
+   transfer = (pl_thumb_transfer_t*)transf->user_data;
 
-   if (!pl_thumb)
+   if (!transfer)
       goto finish;
 
-   pl_thumb->http_task_complete = true;
+   batch = transfer->pl_thumb->batch;
+
+   pl_thumb_lock(transfer->pl_thumb);
+   transfer->http_status = transf->http_status;
+   transfer->complete    = true;
+   pl_thumb_unlock(transfer->pl_thumb);
 
    /* Remaining sanity checks... */
    if (!data)
@@ -215,6 +528,13 @@ void cb_http_task_download_pl_thumbnail(
       goto finish;
    }
 
+#if defined(RARCH_INTERNAL) && defined(HAVE_MENU)
+   /* On demand downloads are shown, and so decoded,
+    * by the menu right away */
+   if (batch)
+      pl_thumb_cache_image(transf->path);
+#endif
+
 finish:
 
    /* Log any error messages */
@@ -236,8 +556,9 @@ finish:
 }
 
 /* Download thumbnail of the current type for the current
- * playlist entry */
-static void download_pl_thumbnail(pl_thumb_handle_t *pl_thumb)
+ * playlist entry, using the free transfer slot @transfer */
+static void download_pl_thumbnail(pl_thumb_handle_t *pl_thumb,
+      pl_thumb_transfer_t *transfer)
 {
    char path[PATH_MAX_LENGTH];
    char url[2048];
@@ -252,36 +573,47 @@ static void download_pl_thumbnail(pl_thumb_handle_t *pl_thumb)
    /* Check if paths are valid */
    if (get_thumbnail_paths(pl_thumb, path, sizeof(path), url, sizeof(url)))
    {
-      /* Only download missing thumbnails */
-      if (!path_is_valid(path) || pl_thumb->overwrite)
+      /* Only download missing thumbnails, which
+       * the server didn't say it doesn't have */
+      if ((!pl_thumb_file_exists(pl_thumb, path) &&
+           !pl_thumb_is_missing(pl_thumb, url)) || pl_thumb->overwrite)
       {
          file_transfer_t *transf = (file_transfer_t*)calloc(1, sizeof(file_transfer_t));
          if (!transf)
             return; /* If this happens then everything is broken anyway... */
 
-         /* Initialise http task status */
-         pl_thumb->http_task_complete = false;
+         /* Initialise transfer status */
+         transfer->pl_thumb    = pl_thumb;
+         transfer->url         = strdup(url);
+         transfer->http_status = -1;
+         transfer->complete    = false;
+         transfer->active      = true;
 
          /* Initialise file transfer */
-         transf->user_data = (void*)pl_thumb;
+         transf->user_data = (void*)transfer;
          strlcpy(transf->path, path, sizeof(transf->path));
 
          /* Note: We don't actually care if this fails since that
           * just means the file is missing from the server, so it's
           * not something we can handle here... */
-         pl_thumb->http_task = (retro_task_t*)task_push_http_transfer_file(
-               url, true, NULL, cb_http_task_download_pl_thumbnail, transf);
-
-         /* ...if it does fail, however, we can immediately
-          * signal that the task is 'complete' */
-         if (!pl_thumb->http_task)
-            pl_thumb->http_task_complete = true;
+         if (!task_push_http_transfer_file(
+               url, true, NULL, cb_http_task_download_pl_thumbnail, transf))
+         {
+            /* ...if it does fail, however, the slot
+             * is free again */
+            free(transfer->url);
+            transfer->url    = NULL;
+            transfer->active = false;
+            free(transf);
+         }
       }
    }
 }
 
 static void free_pl_thumb_handle(pl_thumb_handle_t *pl_thumb, bool free_playlist)
 {
+   size_t i;
+
    if (!pl_thumb)
       return;
 
@@ -315,6 +647,34 @@ static void free_pl_thumb_handle(pl_thumb_handle_t *pl_thumb, bool free_playlist
       pl_thumb->thumbnail_path_data = NULL;
    }
 
+   for (i = 0; i < PL_THUMB_MAX_TRANSFERS; i++)
+      free(pl_thumb->transfers[i].url);
+
+   if (pl_thumb->dirs)
+   {
+
+      for (i = 0; i < pl_thumb->num_dirs; i++)
+      {
+         free(pl_thumb->dirs[i].path);
+         if (pl_thumb->dirs[i].files)
+            string_list_free(pl_thumb->dirs[i].files);
+      }
+
+      free(pl_thumb->dirs);
+      pl_thumb->dirs = NULL;
+   }
+
+   if (pl_thumb->missing)
+      string_list_free(pl_thumb->missing);
+
+   if (pl_thumb->missing_new)
+      string_list_free(pl_thumb->missing_new);
+
+#ifdef HAVE_THREADS
+   if (pl_thumb->transfer_lock)
+      slock_free(pl_thumb->transfer_lock);
+#endif
+
    free(pl_thumb);
    pl_thumb = NULL;
 }
@@ -335,8 +695,10 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
    if (!pl_thumb)
       goto task_finished;
    
+   /* Running transfers report to the handle,
+    * so wait for them before finishing */
    if (task_get_cancelled(task))
-      goto task_finished;
+      pl_thumb->status = PL_THUMB_END;
    
    switch (pl_thumb->status)
    {
@@ -366,6 +728,9 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
                   pl_thumb->thumbnail_path_data, pl_thumb->system, pl_thumb->playlist))
                goto task_finished;
             
+            /* Skip what the server didn't have last time */
+            pl_thumb_missing_load(pl_thumb);
+            
             /* All good - can start iterating */
             pl_thumb->status = PL_THUMB_ITERATE_ENTRY;
          }
@@ -402,21 +767,7 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
          break;
       case PL_THUMB_ITERATE_TYPE:
          {
-            /* Ensure that we only enqueue one transfer
-             * at a time... */
-            
-            /* > If HTTP task is NULL, then it either finished
-             *   or an error occurred - in either case,
-             *   current task is 'complete' */
-            if (!pl_thumb->http_task)
-               pl_thumb->http_task_complete = true;
-            
-            /* > Wait for task_push_http_transfer_file()
-             *   callback to trigger */
-            if (pl_thumb->http_task_complete)
-               pl_thumb->http_task = NULL;
-            else
-               break;
+            pl_thumb_transfer_t *transfer = NULL;
             
             /* Check whether all thumbnail types have been processed */
             if (pl_thumb->type_idx > 3)
@@ -430,8 +781,14 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
                break;
             }
             
+            /* Keep up to PL_THUMB_MAX_TRANSFERS transfers
+             * going - wait for one to finish if all are busy */
+            pl_thumb_poll_transfers(pl_thumb, &transfer);
+            if (!transfer)
+               break;
+            
             /* Download current thumbnail */
-            download_pl_thumbnail(pl_thumb);
+            download_pl_thumbnail(pl_thumb, transfer);
             
             /* Increment thumbnail type */
             pl_thumb->type_idx++;
@@ -439,6 +796,13 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
          break;
       case PL_THUMB_END:
       default:
+         {
+            pl_thumb_transfer_t *transfer = NULL;
+            
+            if (pl_thumb_poll_transfers(pl_thumb, &transfer) > 0)
+               break;
+         }
+         pl_thumb_missing_save(pl_thumb);
          task_set_progress(task, 100);
          goto task_finished;
    }
@@ -510,6 +874,7 @@ bool task_push_pl_thumbnail_download(
    
    /* Configure task */
    task->handler                 = task_pl_thumbnail_download_handler;
+   task->priority                = TASK_PRIORITY_DOWNLOAD;
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->alternative_look        = true;
@@ -521,8 +886,10 @@ bool task_push_pl_thumbnail_download(
    pl_thumb->dir_thumbnails      = strdup(dir_thumbnails);
    pl_thumb->playlist            = NULL;
    pl_thumb->thumbnail_path_data = NULL;
-   pl_thumb->http_task           = NULL;
-   pl_thumb->http_task_complete  = false;
+#ifdef HAVE_THREADS
+   pl_thumb->transfer_lock       = slock_new();
+#endif
+   pl_thumb->batch               = true;
    pl_thumb->list_size           = 0;
    pl_thumb->list_index          = 0;
    pl_thumb->type_idx            = 1;
@@ -657,8 +1024,10 @@ static void task_pl_entry_thumbnail_download_handler(retro_task_t *task)
    if (!pl_thumb)
       goto task_finished;
    
+   /* Running transfers report to the handle,
+    * so wait for them before finishing */
    if (task_get_cancelled(task))
-      goto task_finished;
+      pl_thumb->status = PL_THUMB_END;
    
    switch (pl_thumb->status)
    {
@@ -719,21 +1088,7 @@ static void task_pl_entry_thumbnail_download_handler(retro_task_t *task)
          break;
       case PL_THUMB_ITERATE_TYPE:
          {
-            /* Ensure that we only enqueue one transfer
-             * at a time... */
-            
-            /* > If HTTP task is NULL, then it either finished
-             *   or an error occurred - in either case,
-             *   current task is 'complete' */
-            if (!pl_thumb->http_task)
-               pl_thumb->http_task_complete = true;
-            
-            /* > Wait for task_push_http_transfer_file()
-             *   callback to trigger */
-            if (pl_thumb->http_task_complete)
-               pl_thumb->http_task = NULL;
-            else
-               break;
+            pl_thumb_transfer_t *transfer = NULL;
             
             /* Check whether all thumbnail types have been processed */
             if (pl_thumb->type_idx > 3)
@@ -742,11 +1097,16 @@ static void task_pl_entry_thumbnail_download_handler(retro_task_t *task)
                break;
             }
             
+            /* All types are fetched at once */
+            pl_thumb_poll_transfers(pl_thumb, &transfer);
+            if (!transfer)
+               break;
+            
             /* Update progress */
             task_set_progress(task, ((pl_thumb->type_idx - 1) * 100) / 3);
             
             /* Download current thumbnail */
-            download_pl_thumbnail(pl_thumb);
+            download_pl_thumbnail(pl_thumb, transfer);
             
             /* Increment thumbnail type */
             pl_thumb->type_idx++;
@@ -754,6 +1114,12 @@ static void task_pl_entry_thumbnail_download_handler(retro_task_t *task)
          break;
       case PL_THUMB_END:
       default:
+         {
+            pl_thumb_transfer_t *transfer = NULL;
+            
+            if (pl_thumb_poll_transfers(pl_thumb, &transfer) > 0)
+               break;
+         }
          task_set_progress(task, 100);
          goto task_finished;
    }
@@ -841,6 +1207,7 @@ bool task_push_pl_entry_thumbnail_download(
    
    /* Configure task */
    task->handler                 = task_pl_entry_thumbnail_download_handler;
+   task->priority                = TASK_PRIORITY_DOWNLOAD;
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->alternative_look        = true;
@@ -855,8 +1222,10 @@ bool task_push_pl_entry_thumbnail_download(
    pl_thumb->dir_thumbnails      = strdup(settings->paths.directory_thumbnails);
    pl_thumb->playlist            = playlist;
    pl_thumb->thumbnail_path_data = NULL;
-   pl_thumb->http_task           = NULL;
-   pl_thumb->http_task_complete  = false;
+#ifdef HAVE_THREADS
+   pl_thumb->transfer_lock       = slock_new();
+#endif
+   pl_thumb->batch               = false;
    pl_thumb->list_size           = playlist_size(playlist);
    pl_thumb->list_index          = idx;
    pl_thumb->type_idx            = 1;
@@ -0,0 +1,190 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2020 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <queues/task_queue.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+
+#include "tasks_internal.h"
+
+enum task_read_ahead_state
+{
+   TASK_READ_AHEAD_EMPTY = 0,
+   TASK_READ_AHEAD_BUSY,
+   TASK_READ_AHEAD_READY
+};
+
+typedef struct task_read_ahead_slot
+{
+   task_read_ahead_t *ahead;
+   void *result;
+   size_t index;
+   enum task_read_ahead_state state;
+} task_read_ahead_slot_t;
+
+struct task_read_ahead
+{
+   slock_t *lock;
+   /* Signalled whenever a slot gets ready */
+   scond_t *cond;
+   task_read_ahead_func_t func;
+   void *userdata;
+   task_read_ahead_slot_t *slots;
+   uint8_t *results;
+   size_t num_slots;
+   size_t result_size;
+   /* Lowest index not handed to the pool yet */
+   size_t next;
+   /* What was handed to the pool, touched by the pool only */
+   tpool_waitgroup_t group;
+};
+
+static void task_read_ahead_work(void *data)
+{
+   task_read_ahead_slot_t *slot = (task_read_ahead_slot_t*)data;
+   task_read_ahead_t *ahead     = slot->ahead;
+
+   /* Nothing else touches a busy slot */
+   ahead->func(ahead->userdata, slot->index, slot->result);
+
+   slock_lock(ahead->lock);
+   slot->state = TASK_READ_AHEAD_READY;
+   scond_broadcast(ahead->cond);
+   slock_unlock(ahead->lock);
+}
+
+task_read_ahead_t *task_read_ahead_new(size_t count, size_t num_slots,
+      size_t result_size, task_read_ahead_func_t func, void *userdata)
+{
+   size_t i;
+   task_read_ahead_t *ahead = NULL;
+
+   /* One item, or no pool, there's nothing to read ahead with */
+   if (count < 2 || num_slots < 1 || !task_queue_get_pool())
+      return NULL;
+
+   ahead = (task_read_ahead_t*)calloc(1, sizeof(*ahead));
+   if (!ahead)
+      return NULL;
+
+   ahead->func        = func;
+   ahead->userdata    = userdata;
+   ahead->num_slots   = num_slots;
+   ahead->result_size = result_size;
+   ahead->lock        = slock_new();
+   ahead->cond        = scond_new();
+   ahead->slots       = (task_read_ahead_slot_t*)
+      calloc(num_slots, sizeof(*ahead->slots));
+   ahead->results     = (uint8_t*)calloc(num_slots, result_size);
+   tpool_waitgroup_init(&ahead->group);
+
+   if (!ahead->lock || !ahead->cond || !ahead->slots || !ahead->results)
+   {
+      task_read_ahead_free(ahead);
+      return NULL;
+   }
+
+   for (i = 0; i < num_slots; i++)
+   {
+      ahead->slots[i].ahead  = ahead;
+      ahead->slots[i].result = ahead->results + i * result_size;
+   }
+
+   return ahead;
+}
+
+void task_read_ahead_free(task_read_ahead_t *ahead)
+{
+   if (!ahead)
+      return;
+
+   /* If the pool went away, it finished the work first */
+   tpool_wait_group(task_queue_get_pool(), &ahead->group);
+
+   if (ahead->cond)
+      scond_free(ahead->cond);
+   if (ahead->lock)
+      slock_free(ahead->lock);
+   free(ahead->slots);
+   free(ahead->results);
+   free(ahead);
+}
+
+void task_read_ahead_lock(task_read_ahead_t *ahead)
+{
+   slock_lock(ahead->lock);
+}
+
+void task_read_ahead_unlock(task_read_ahead_t *ahead)
+{
+   slock_unlock(ahead->lock);
+}
+
+bool task_read_ahead_take(task_read_ahead_t *ahead,
+      size_t index, size_t count, void *result)
+{
+   bool taken                   = false;
+   tpool_t *pool                = task_queue_get_pool();
+   task_read_ahead_slot_t *slot = &ahead->slots[index % ahead->num_slots];
+
+   slock_lock(ahead->lock);
+
+   while (slot->index == index && slot->state == TASK_READ_AHEAD_BUSY)
+      scond_wait(ahead->cond, ahead->lock);
+
+   if (slot->index == index && slot->state == TASK_READ_AHEAD_READY)
+   {
+      memcpy(result, slot->result, ahead->result_size);
+      slot->state = TASK_READ_AHEAD_EMPTY;
+      taken       = true;
+   }
+
+   /* The caller does @index itself if it wasn't read, the
+    * pool gets the ones after it */
+   if (ahead->next <= index)
+      ahead->next = index + 1;
+
+   while (pool
+         && ahead->next < count
+         && ahead->next < index + ahead->num_slots)
+   {
+      task_read_ahead_slot_t *next =
+         &ahead->slots[ahead->next % ahead->num_slots];
+
+      /* Still reading one that was skipped */
+      if (next->state == TASK_READ_AHEAD_BUSY)
+         break;
+
+      next->index = ahead->next;
+      next->state = TASK_READ_AHEAD_BUSY;
+
+      if (!tpool_add_work_group(pool, &ahead->group,
+               task_read_ahead_work, next))
+      {
+         next->state = TASK_READ_AHEAD_EMPTY;
+         break;
+      }
+
+      ahead->next++;
+   }
+
+   slock_unlock(ahead->lock);
+
+   return taken;
+}
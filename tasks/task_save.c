@@ -26,13 +26,24 @@
 #endif
 #include <errno.h>
 
+#if defined(HAVE_THREADS) && !defined(_WIN32) \
+   && (defined(__unix__) || defined(__APPLE__))
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_AUTOSAVE_MMAP
+#endif
+
 #include <compat/strl.h>
 #include <retro_assert.h>
 #include <lists/string_list.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
+#include <streams/trans_stream.h>
+#include <encodings/crc32.h>
 #include <rthreads/rthreads.h>
 #include <file/file_path.h>
+#include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <string/stdstring.h>
 
@@ -53,6 +64,7 @@
 #include "../verbosity.h"
 #include "tasks_internal.h"
 #include "../managers/cheat_manager.h"
+#include "../managers/state_pool.h"
 
 #ifdef HAVE_LIBNX
 #define SAVE_STATE_CHUNK 4096 * 10
@@ -60,6 +72,53 @@
 #define SAVE_STATE_CHUNK 4096
 #endif
 
+#ifdef HAVE_ZLIB
+#define HAVE_SAVE_STATE_COMPRESSION
+#endif
+
+/* Compressed states start with a magic, a version and the
+ * uncompressed size, both little endian, followed by a zlib
+ * stream of the state. */
+#define SAVE_STATE_COMPRESSED_MAGIC       "RASZ"
+#define SAVE_STATE_COMPRESSED_VERSION     1
+#define SAVE_STATE_COMPRESSED_HEADER_SIZE 16
+/* Compressing is slower than writing, so it is done in bigger
+ * chunks to keep the per iteration overhead down. */
+#define SAVE_STATE_COMPRESS_CHUNK         (128 * 1024)
+#define SAVE_STATE_COMPRESS_BUFFER        (64 * 1024)
+
+/* Incremental saves append the blocks that changed since the last
+ * save of a state to <state>.patch, until the patches would take
+ * more than half the size of the state or there are too many of
+ * them. The full state is written again then, which drops the
+ * patches.
+ *
+ * The patch file starts with a magic, a version, the state size
+ * and the CRC32 of the state it applies to. Each patch is a magic,
+ * the number of runs and the size of the runs, then the runs as
+ * offset, length and data, then the CRC32 of the runs. Numbers
+ * are 32-bit little endian. */
+#define SAVE_STATE_PATCH_EXTENSION        ".patch"
+#define SAVE_STATE_PATCH_MAGIC            "RASP"
+#define SAVE_STATE_PATCH_RECORD_MAGIC     "RASR"
+#define SAVE_STATE_PATCH_VERSION          1
+#define SAVE_STATE_PATCH_HEADER_SIZE      16
+#define SAVE_STATE_PATCH_RECORD_SIZE      16
+#define SAVE_STATE_PATCH_BLOCK            256
+#define SAVE_STATE_PATCH_MAX              32
+
+/* With autosave_mmap, the blocks an autosave changes are first
+ * written to <save>.journal and synced, then copied into the
+ * mapped save file, which is synced in turn before the journal is
+ * removed. The journal is a magic, a version, the save size and
+ * the number of runs, then the runs as offset, length and data,
+ * then the CRC32 of the runs, all 32-bit little endian. A journal
+ * left behind by a crash is applied when the save is loaded. */
+#define AUTOSAVE_JOURNAL_EXTENSION        ".journal"
+#define AUTOSAVE_JOURNAL_MAGIC            "RASJ"
+#define AUTOSAVE_JOURNAL_VERSION          1
+#define AUTOSAVE_JOURNAL_HEADER_SIZE      16
+
 static bool save_state_in_background = false;
 static struct string_list *task_save_files = NULL;
 
@@ -89,6 +148,8 @@ typedef struct
    char path[PATH_MAX_LENGTH];
    void *data;
    void *undo_data;
+   void *stream;
+   uint8_t *stream_buf;
    ssize_t size;
    ssize_t undo_size;
    ssize_t written;
@@ -97,6 +158,9 @@ typedef struct
    bool autoload;
    bool autosave;
    bool undo_save;
+   bool compress;
+   bool incremental;
+   bool patched;
    bool mute;
    int state_slot;
    bool thumbnail_enable;
@@ -113,7 +177,41 @@ static struct save_state_buf undo_save_buf;
  * Can be restored with undo_load_state(). */
 static struct save_state_buf undo_load_buf;
 
+/* The state as last saved to or loaded from a file, which
+ * incremental saves are diffed against. Only the save and
+ * load tasks use it, and being blocking they never run at
+ * the same time. */
+struct save_state_base
+{
+   uint8_t *data;
+   size_t size;
+   size_t patch_size;
+   unsigned patches;
+   uint32_t crc;
+   char path[PATH_MAX_LENGTH];
+};
+
+static struct save_state_base save_state_base;
+
+static INLINE void task_save_write_le32(uint8_t *out, uint32_t val)
+{
+   out[0] = (uint8_t)(val);
+   out[1] = (uint8_t)(val >> 8);
+   out[2] = (uint8_t)(val >> 16);
+   out[3] = (uint8_t)(val >> 24);
+}
+
+static INLINE uint32_t task_save_read_le32(const uint8_t *in)
+{
+   return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+      ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
 #ifdef HAVE_THREADS
+/* SRAM is compared and written back in blocks of this size, so
+ * a few changed bytes don't mean copying and rewriting all of it. */
+#define AUTOSAVE_BLOCK_SIZE 4096
+
 typedef struct autosave autosave_t;
 
 /* Autosave support. */
@@ -129,8 +227,19 @@ struct autosave
    size_t bufsize;
    unsigned interval;
    void *buffer;
+   /* One flag per block changed since the last write */
+   uint8_t *dirty;
    const void *retro_buffer;
    const char *path;
+#ifdef HAVE_AUTOSAVE_MMAP
+   /* The save file, mapped. NULL if it's written to instead */
+   uint8_t *map;
+   int fd;
+   /* Blocks differ from the file without the core having
+    * changed them since */
+   bool unsynced;
+   char journal_path[PATH_MAX_LENGTH];
+#endif
    slock_t *lock;
    slock_t *cond_lock;
    scond_t *cond;
@@ -139,6 +248,271 @@ struct autosave
 
 static struct autosave_st autosave_state;
 
+/**
+ * autosave_write:
+ * @save            : pointer to autosave object
+ *
+ * Write the dirty blocks of the buffer to the save file, all of
+ * it if the file doesn't hold a whole save yet. Only the autosave
+ * thread touches the buffer, so this runs without the lock.
+ **/
+static void autosave_write(autosave_t *save)
+{
+   size_t block;
+   size_t blocks = (save->bufsize + AUTOSAVE_BLOCK_SIZE - 1)
+      / AUTOSAVE_BLOCK_SIZE;
+   RFILE *file   = filestream_open(save->path,
+         RETRO_VFS_FILE_ACCESS_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (file && filestream_get_size(file) != (int64_t)save->bufsize)
+   {
+      filestream_close(file);
+      file = NULL;
+   }
+
+   if (!file)
+   {
+      file = filestream_open(save->path,
+            RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      if (!file)
+         return;
+
+      filestream_write(file, save->buffer, save->bufsize);
+      memset(save->dirty, 0, blocks);
+   }
+
+   for (block = 0; block < blocks; )
+   {
+      size_t start, end;
+
+      if (!save->dirty[block])
+      {
+         block++;
+         continue;
+      }
+
+      /* Write runs of dirty blocks in one go */
+      for (start = block; block < blocks && save->dirty[block]; block++)
+         save->dirty[block] = 0;
+
+      start *= AUTOSAVE_BLOCK_SIZE;
+      end    = MIN(block * AUTOSAVE_BLOCK_SIZE, save->bufsize);
+
+      filestream_seek(file, start, RETRO_VFS_SEEK_POSITION_START);
+      filestream_write(file, (const uint8_t*)save->buffer + start,
+            end - start);
+   }
+
+   /* A single flush for all of the blocks */
+   filestream_flush(file);
+   filestream_close(file);
+}
+
+#ifdef HAVE_AUTOSAVE_MMAP
+/* Finds the next run of dirty blocks, from *block on */
+static bool autosave_next_run(const autosave_t *save, size_t blocks,
+      size_t *block, size_t *start, size_t *end)
+{
+   while (*block < blocks && !save->dirty[*block])
+      (*block)++;
+
+   if (*block >= blocks)
+      return false;
+
+   *start = *block * AUTOSAVE_BLOCK_SIZE;
+
+   while (*block < blocks && save->dirty[*block])
+      (*block)++;
+
+   *end   = MIN(*block * AUTOSAVE_BLOCK_SIZE, save->bufsize);
+   return true;
+}
+
+/**
+ * autosave_journal_write:
+ * @save            : pointer to autosave object
+ *
+ * Writes the dirty blocks of the buffer to the journal and syncs
+ * it to disk.
+ *
+ * Returns: true if the journal is on disk.
+ **/
+static bool autosave_journal_write(autosave_t *save)
+{
+   size_t start, end, pos;
+   size_t blocks   = (save->bufsize + AUTOSAVE_BLOCK_SIZE - 1)
+      / AUTOSAVE_BLOCK_SIZE;
+   size_t block    = 0;
+   size_t payload  = 0;
+   unsigned runs   = 0;
+   uint8_t *buf    = NULL;
+   bool ret        = false;
+   int fd;
+
+   while (autosave_next_run(save, blocks, &block, &start, &end))
+   {
+      payload += 8 + end - start;
+      runs++;
+   }
+
+   buf = (uint8_t*)malloc(AUTOSAVE_JOURNAL_HEADER_SIZE + payload + 4);
+   if (!buf)
+      return false;
+
+   memcpy(buf, AUTOSAVE_JOURNAL_MAGIC, 4);
+   task_save_write_le32(buf + 4,  AUTOSAVE_JOURNAL_VERSION);
+   task_save_write_le32(buf + 8,  (uint32_t)save->bufsize);
+   task_save_write_le32(buf + 12, runs);
+
+   pos   = AUTOSAVE_JOURNAL_HEADER_SIZE;
+   block = 0;
+
+   while (autosave_next_run(save, blocks, &block, &start, &end))
+   {
+      task_save_write_le32(buf + pos,     (uint32_t)start);
+      task_save_write_le32(buf + pos + 4, (uint32_t)(end - start));
+      memcpy(buf + pos + 8, (const uint8_t*)save->buffer + start,
+            end - start);
+      pos += 8 + end - start;
+   }
+
+   task_save_write_le32(buf + pos, encoding_crc32(0,
+            buf + AUTOSAVE_JOURNAL_HEADER_SIZE, payload));
+   pos += 4;
+
+   fd = open(save->journal_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+   if (fd >= 0)
+   {
+      size_t written = 0;
+
+      while (written < pos)
+      {
+         ssize_t rc = write(fd, buf + written, pos - written);
+
+         if (rc < 0 && errno == EINTR)
+            continue;
+         if (rc <= 0)
+            break;
+         written += (size_t)rc;
+      }
+
+      ret = written == pos && fsync(fd) == 0;
+      close(fd);
+   }
+
+   free(buf);
+   return ret;
+}
+
+/**
+ * autosave_write_mapped:
+ * @save            : pointer to autosave object
+ *
+ * Journals the dirty blocks of the buffer, then copies them into
+ * the mapped save file and syncs it.
+ **/
+static void autosave_write_mapped(autosave_t *save)
+{
+   size_t start, end;
+   size_t blocks   = (save->bufsize + AUTOSAVE_BLOCK_SIZE - 1)
+      / AUTOSAVE_BLOCK_SIZE;
+   size_t block    = 0;
+   size_t page     = (size_t)sysconf(_SC_PAGESIZE);
+   bool journaled  = autosave_journal_write(save);
+
+   /* Still better saved than not */
+   if (!journaled)
+      RARCH_WARN("[Autosave]: Couldn't write \"%s\".\n",
+            save->journal_path);
+
+   while (autosave_next_run(save, blocks, &block, &start, &end))
+   {
+      size_t sync_start = page ? start - start % page : start;
+
+      memcpy(save->map + start, (const uint8_t*)save->buffer + start,
+            end - start);
+      msync(save->map + sync_start, end - sync_start, MS_SYNC);
+   }
+
+   memset(save->dirty, 0, blocks);
+
+   if (journaled)
+      unlink(save->journal_path);
+}
+
+/**
+ * autosave_map_init:
+ * @save            : pointer to autosave object
+ *
+ * Maps the save file, resized to the SRAM if need be.
+ *
+ * Returns: true if the save file is mapped.
+ **/
+static bool autosave_map_init(autosave_t *save)
+{
+   struct stat st;
+   size_t offset;
+   void *map = NULL;
+   int fd    = open(save->path, O_RDWR | O_CREAT, 0644);
+
+   if (fd < 0)
+      return false;
+
+   if (     fstat(fd, &st) != 0
+         || (  (size_t)st.st_size != save->bufsize
+            && ftruncate(fd, (off_t)save->bufsize) != 0))
+   {
+      close(fd);
+      return false;
+   }
+
+   map = mmap(NULL, save->bufsize, PROT_READ | PROT_WRITE,
+         MAP_SHARED, fd, 0);
+
+   if (map == MAP_FAILED)
+   {
+      close(fd);
+      return false;
+   }
+
+   save->fd  = fd;
+   save->map = (uint8_t*)map;
+
+   strlcpy(save->journal_path, save->path, sizeof(save->journal_path));
+   strlcat(save->journal_path, AUTOSAVE_JOURNAL_EXTENSION,
+         sizeof(save->journal_path));
+
+   /* What differs from the file, e.g. from a journal applied
+    * when loading, goes out with the first autosave */
+   for (offset = 0; offset < save->bufsize; offset += AUTOSAVE_BLOCK_SIZE)
+   {
+      size_t len = MIN(save->bufsize - offset, AUTOSAVE_BLOCK_SIZE);
+
+      if (memcmp(save->map + offset,
+               (const uint8_t*)save->buffer + offset, len))
+      {
+         save->dirty[offset / AUTOSAVE_BLOCK_SIZE] = 1;
+         save->unsynced = true;
+      }
+   }
+
+   return true;
+}
+
+static void autosave_map_deinit(autosave_t *save)
+{
+   if (!save->map)
+      return;
+
+   munmap(save->map, save->bufsize);
+   close(save->fd);
+   save->map = NULL;
+   save->fd  = -1;
+}
+#endif
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -151,28 +525,41 @@ static void autosave_thread(void *data)
 
    while (!save->quit)
    {
-      bool differ;
+      size_t offset;
+      bool differ           = false;
+      uint8_t *buffer       = (uint8_t*)save->buffer;
+      const uint8_t *retro  = (const uint8_t*)save->retro_buffer;
 
+      /* Only the blocks that changed get copied, which keeps
+       * the time the core is held up short for big SRAM. */
       slock_lock(save->lock);
-      differ = string_is_not_equal_fast(save->buffer, save->retro_buffer,
-            save->bufsize);
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
+      for (offset = 0; offset < save->bufsize;
+            offset += AUTOSAVE_BLOCK_SIZE)
+      {
+         size_t len = MIN(save->bufsize - offset, AUTOSAVE_BLOCK_SIZE);
+
+         if (memcmp(buffer + offset, retro + offset, len))
+         {
+            memcpy(buffer + offset, retro + offset, len);
+            save->dirty[offset / AUTOSAVE_BLOCK_SIZE] = 1;
+            differ = true;
+         }
+      }
       slock_unlock(save->lock);
 
-      if (differ)
+#ifdef HAVE_AUTOSAVE_MMAP
+      if (save->map)
       {
-         /* Should probably deal with this more elegantly. */
-         RFILE *file = filestream_open(save->path,
-               RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
-
-         if (file)
+         if (differ || save->unsynced)
          {
-            filestream_write(file, save->buffer, save->bufsize);
-            filestream_flush(file);
-            filestream_close(file);
+            save->unsynced = false;
+            autosave_write_mapped(save);
          }
       }
+      else
+#endif
+      if (differ)
+         autosave_write(save);
 
       slock_lock(save->cond_lock);
 
@@ -217,11 +604,20 @@ static autosave_t *autosave_new(const char *path,
    handle->interval              = interval;
    handle->retro_buffer          = data;
    handle->path                  = path;
+#ifdef HAVE_AUTOSAVE_MMAP
+   handle->map                   = NULL;
+   handle->fd                    = -1;
+   handle->unsynced              = false;
+#endif
 
    buf                           = malloc(size);
+   handle->dirty                 = (uint8_t*)calloc(
+         (size + AUTOSAVE_BLOCK_SIZE - 1) / AUTOSAVE_BLOCK_SIZE, 1);
 
-   if (!buf)
+   if (!buf || !handle->dirty)
    {
+      free(buf);
+      free(handle->dirty);
       free(handle);
       return NULL;
    }
@@ -230,6 +626,13 @@ static autosave_t *autosave_new(const char *path,
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
 
+#ifdef HAVE_AUTOSAVE_MMAP
+   if (     config_get_ptr()->bools.autosave_mmap
+         && !autosave_map_init(handle))
+      RARCH_WARN("[Autosave]: Couldn't map \"%s\", writing it instead.\n",
+            path);
+#endif
+
    handle->lock                  = slock_new();
    handle->cond_lock             = slock_new();
    handle->cond                  = scond_new();
@@ -256,9 +659,15 @@ static void autosave_free(autosave_t *handle)
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
+#ifdef HAVE_AUTOSAVE_MMAP
+   autosave_map_deinit(handle);
+#endif
+
    if (handle->buffer)
       free(handle->buffer);
    handle->buffer = NULL;
+   free(handle->dirty);
+   handle->dirty  = NULL;
 }
 
 bool autosave_init(void)
@@ -531,6 +940,14 @@ static void task_save_handler_finished(retro_task_t *task,
    intfstream_close(state->file);
    free(state->file);
 
+#ifdef HAVE_SAVE_STATE_COMPRESSION
+   if (state->stream)
+      trans_stream_get_zlib_deflate_backend()->stream_free(state->stream);
+   free(state->stream_buf);
+   state->stream     = NULL;
+   state->stream_buf = NULL;
+#endif
+
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
 
@@ -543,7 +960,7 @@ static void task_save_handler_finished(retro_task_t *task,
    {
       if (state->undo_save && state->data == undo_save_buf.data)
          undo_save_buf.data = NULL;
-      free(state->data);
+      state_pool_put(state->data);
       state->data = NULL;
    }
 
@@ -559,7 +976,7 @@ static void *get_serialized_data(const char *path, size_t serial_size)
    if (!serial_size)
       return NULL;
 
-   data = malloc(serial_size);
+   data = state_pool_get(serial_size);
 
    if (!data)
       return NULL;
@@ -575,13 +992,468 @@ static void *get_serialized_data(const char *path, size_t serial_size)
 
    if (!ret)
    {
-      free(data);
+      state_pool_put(data);
       return NULL;
    }
 
    return data;
 }
 
+#ifdef HAVE_SAVE_STATE_COMPRESSION
+/**
+ * task_save_compress:
+ * @state : the state being saved
+ * @len   : amount of data to compress
+ *
+ * Compress the next len bytes of the state and write them
+ * out. The header goes out with the first chunk, the end of
+ * the stream with the last one.
+ *
+ * Returns: true if successful, false otherwise.
+ **/
+static bool task_save_compress(save_task_state_t *state, size_t len)
+{
+   uint32_t rd, wn;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+   const struct trans_stream_backend *backend =
+      trans_stream_get_zlib_deflate_backend();
+   bool flush = state->written + (ssize_t)len == state->size;
+
+   if (!state->stream)
+   {
+      unsigned i;
+      uint8_t header[SAVE_STATE_COMPRESSED_HEADER_SIZE] = {0};
+      uint64_t size     = state->size;
+
+      state->stream     = backend->stream_new();
+      state->stream_buf = (uint8_t*)malloc(SAVE_STATE_COMPRESS_BUFFER);
+
+      if (!state->stream || !state->stream_buf)
+         return false;
+
+      /* Z_BEST_SPEED, states are large and the rest
+       * of the levels barely do better on them. */
+      backend->define(state->stream, "level", 1);
+
+      memcpy(header, SAVE_STATE_COMPRESSED_MAGIC, 4);
+      header[4] = SAVE_STATE_COMPRESSED_VERSION;
+      for (i = 0; i < 8; i++)
+         header[8 + i] = (uint8_t)(size >> (8 * i));
+
+      if (intfstream_write(state->file, header, sizeof(header))
+            != sizeof(header))
+         return false;
+   }
+
+   backend->set_in(state->stream,
+         (const uint8_t*)state->data + state->written, (uint32_t)len);
+
+   do
+   {
+      backend->set_out(state->stream,
+            state->stream_buf, SAVE_STATE_COMPRESS_BUFFER);
+
+      if (!backend->trans(state->stream, flush, &rd, &wn, &err)
+            && err != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return false;
+
+      if (wn && intfstream_write(state->file, state->stream_buf, wn)
+            != (int64_t)wn)
+         return false;
+   } while (err == TRANS_STREAM_ERROR_BUFFER_FULL
+         || (flush && err == TRANS_STREAM_ERROR_AGAIN));
+
+   return true;
+}
+
+/**
+ * task_load_decompress:
+ * @state : the state that was loaded
+ *
+ * Replace the data of a compressed state with the state itself,
+ * uncompressed states are left alone.
+ *
+ * Returns: false if the state is compressed but could not be
+ * decompressed, true otherwise.
+ **/
+static bool task_load_decompress(save_task_state_t *state)
+{
+   unsigned i;
+   void *stream               = NULL;
+   uint8_t *data              = NULL;
+   uint64_t size              = 0;
+   const uint8_t *header      = (const uint8_t*)state->data;
+   const struct trans_stream_backend *backend = NULL;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+   bool ret                   = false;
+
+   if (     state->size < SAVE_STATE_COMPRESSED_HEADER_SIZE
+         || memcmp(header, SAVE_STATE_COMPRESSED_MAGIC, 4))
+      return true;
+
+   if (header[4] != SAVE_STATE_COMPRESSED_VERSION)
+      return false;
+
+   for (i = 0; i < 8; i++)
+      size |= (uint64_t)header[8 + i] << (8 * i);
+
+   if (!size || size > UINT32_MAX)
+      return false;
+
+   /* Whatever it was compressed with, if built in */
+   backend = trans_stream_get_decoder(
+         header + SAVE_STATE_COMPRESSED_HEADER_SIZE,
+         (uint32_t)(state->size - SAVE_STATE_COMPRESSED_HEADER_SIZE));
+   if (!backend)
+      return false;
+
+   data = (uint8_t*)state_pool_get((size_t)size);
+   if (!data)
+      return false;
+
+   ret  = trans_stream_trans_full(
+         (struct trans_stream_backend*)backend,
+         &stream, header + SAVE_STATE_COMPRESSED_HEADER_SIZE,
+         (uint32_t)(state->size - SAVE_STATE_COMPRESSED_HEADER_SIZE),
+         data, (uint32_t)size, &err)
+      && err == TRANS_STREAM_ERROR_NONE;
+
+   if (stream)
+      backend->stream_free(stream);
+
+   if (!ret)
+   {
+      state_pool_put(data);
+      return false;
+   }
+
+   free(state->data);
+   state->data = data;
+   state->size = (ssize_t)size;
+   return true;
+}
+#endif
+
+static void task_save_base_free(void)
+{
+   state_pool_put(save_state_base.data);
+   memset(&save_state_base, 0, sizeof(save_state_base));
+}
+
+/* Remembers data as the current contents of the state at path,
+ * crc being the one of the full state in the file. */
+static void task_save_base_set(const char *path, const void *data,
+      size_t size, uint32_t crc, size_t patch_size, unsigned patches)
+{
+   if (save_state_base.data && save_state_base.size != size)
+      task_save_base_free();
+
+   if (!save_state_base.data)
+      save_state_base.data = (uint8_t*)state_pool_get(size);
+
+   if (!save_state_base.data)
+   {
+      task_save_base_free();
+      return;
+   }
+
+   memcpy(save_state_base.data, data, size);
+   save_state_base.size       = size;
+   save_state_base.crc        = crc;
+   save_state_base.patch_size = patch_size;
+   save_state_base.patches    = patches;
+   strlcpy(save_state_base.path, path, sizeof(save_state_base.path));
+}
+
+/* Finds the next run of blocks differing between a and b,
+ * starting at *offset. Returns its length, 0 if there is none. */
+static size_t task_save_patch_next_run(const uint8_t *a, const uint8_t *b,
+      size_t size, size_t *offset)
+{
+   size_t start = *offset;
+   size_t end;
+
+   while (start < size)
+   {
+      size_t len = MIN(size - start, SAVE_STATE_PATCH_BLOCK);
+      if (memcmp(a + start, b + start, len))
+         break;
+      start += len;
+   }
+
+   if (start >= size)
+      return 0;
+
+   end = start;
+   while (end < size)
+   {
+      size_t len = MIN(size - end, SAVE_STATE_PATCH_BLOCK);
+      if (!memcmp(a + end, b + end, len))
+         break;
+      end += len;
+   }
+
+   *offset = start;
+   return end - start;
+}
+
+/**
+ * task_save_patch:
+ * @state : the state being saved
+ *
+ * Append the blocks that differ from the last save of the same
+ * file to its patch file, instead of writing the full state.
+ *
+ * Returns: true if the state was saved that way, false if it has
+ * to be written in full.
+ **/
+static bool task_save_patch(save_task_state_t *state)
+{
+   char patch_path[PATH_MAX_LENGTH];
+   uint8_t record[SAVE_STATE_PATCH_RECORD_SIZE];
+   size_t offset, len;
+   size_t payload             = 0;
+   unsigned runs              = 0;
+   uint32_t crc               = 0;
+   RFILE *file                = NULL;
+   const uint8_t *data        = (const uint8_t*)state->data;
+   struct save_state_base *base = &save_state_base;
+   size_t record_size         = 0;
+
+   if (     !base->data
+         || base->size != (size_t)state->size
+         || base->patches >= SAVE_STATE_PATCH_MAX
+         || !string_is_equal(base->path, state->path)
+         || !path_is_valid(state->path))
+      return false;
+
+   for (offset = 0; (len = task_save_patch_next_run(
+               base->data, data, base->size, &offset)); offset += len)
+   {
+      payload += 8 + len;
+      runs++;
+   }
+
+   if (!runs)
+      return true;
+
+   record_size = SAVE_STATE_PATCH_RECORD_SIZE - 4 + payload + 4;
+   if (!base->patch_size)
+      record_size += SAVE_STATE_PATCH_HEADER_SIZE;
+
+   if (base->patch_size + record_size > base->size / 2)
+      return false;
+
+   strlcpy(patch_path, state->path, sizeof(patch_path));
+   strlcat(patch_path, SAVE_STATE_PATCH_EXTENSION, sizeof(patch_path));
+
+   if (!base->patch_size)
+   {
+      uint8_t header[SAVE_STATE_PATCH_HEADER_SIZE];
+
+      file = filestream_open(patch_path, RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      if (!file)
+         return false;
+
+      memcpy(header, SAVE_STATE_PATCH_MAGIC, 4);
+      task_save_write_le32(header + 4,  SAVE_STATE_PATCH_VERSION);
+      task_save_write_le32(header + 8,  (uint32_t)base->size);
+      task_save_write_le32(header + 12, base->crc);
+
+      if (filestream_write(file, header, sizeof(header)) != sizeof(header))
+         goto error;
+   }
+   else
+   {
+      /* Whatever follows the last good patch, e.g. one cut off
+       * by a crash while writing, is written over. */
+      file = filestream_open(patch_path,
+            RETRO_VFS_FILE_ACCESS_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      if (!file)
+         return false;
+
+      if (filestream_seek(file, base->patch_size,
+               RETRO_VFS_SEEK_POSITION_START) != 0)
+         goto error;
+   }
+
+   memcpy(record, SAVE_STATE_PATCH_RECORD_MAGIC, 4);
+   task_save_write_le32(record + 4, runs);
+   task_save_write_le32(record + 8, (uint32_t)payload);
+   if (filestream_write(file, record, 12) != 12)
+      goto error;
+
+   for (offset = 0; (len = task_save_patch_next_run(
+               base->data, data, base->size, &offset)); offset += len)
+   {
+      uint8_t run[8];
+
+      task_save_write_le32(run,     (uint32_t)offset);
+      task_save_write_le32(run + 4, (uint32_t)len);
+      crc = encoding_crc32(crc, run, sizeof(run));
+      crc = encoding_crc32(crc, data + offset, len);
+
+      if (     filestream_write(file, run, sizeof(run)) != sizeof(run)
+            || filestream_write(file, data + offset, len) != (int64_t)len)
+         goto error;
+
+      memcpy(base->data + offset, data + offset, len);
+   }
+
+   task_save_write_le32(record, crc);
+   if (filestream_write(file, record, 4) != 4)
+      goto error;
+
+   filestream_close(file);
+
+   base->patch_size += record_size;
+   base->patches++;
+
+   RARCH_LOG("[State]: Saved %u bytes of changes to \"%s\".\n",
+         (unsigned)payload, patch_path);
+   return true;
+
+error:
+   filestream_close(file);
+   /* The base is no longer the state on disk */
+   base->patches = SAVE_STATE_PATCH_MAX;
+   return false;
+}
+
+/* Called once a state was written out in full, which makes
+ * any patches to it stale. */
+static void task_save_full_written(save_task_state_t *state)
+{
+   char patch_path[PATH_MAX_LENGTH];
+
+   strlcpy(patch_path, state->path, sizeof(patch_path));
+   strlcat(patch_path, SAVE_STATE_PATCH_EXTENSION, sizeof(patch_path));
+
+   if (path_is_valid(patch_path))
+      filestream_delete(patch_path);
+
+   if (state->incremental)
+      task_save_base_set(state->path, state->data, state->size,
+            encoding_crc32(0, (const uint8_t*)state->data, state->size),
+            0, 0);
+   else if (string_is_equal(save_state_base.path, state->path))
+      task_save_base_free();
+}
+
+/**
+ * task_load_patch:
+ * @state : the state that was loaded
+ *
+ * Apply the patches saved for the state, stopping at the first
+ * one that is damaged. Patches to a different state, e.g. one
+ * written by something unaware of them, are ignored.
+ **/
+static void task_load_patch(save_task_state_t *state)
+{
+   char patch_path[PATH_MAX_LENGTH];
+   int64_t patch_len          = 0;
+   void *patch_buf            = NULL;
+   size_t pos                 = 0;
+   size_t patch_size          = 0;
+   unsigned patches           = 0;
+   uint32_t crc               = 0;
+   uint8_t *data              = (uint8_t*)state->data;
+   size_t size                = (size_t)state->size;
+   bool have_patch            = false;
+
+   strlcpy(patch_path, state->path, sizeof(patch_path));
+   strlcat(patch_path, SAVE_STATE_PATCH_EXTENSION, sizeof(patch_path));
+
+   have_patch = path_is_valid(patch_path);
+
+   if (!have_patch && !state->incremental)
+      return;
+
+   crc = encoding_crc32(0, data, size);
+
+   if (have_patch && filestream_read_file(patch_path, &patch_buf, &patch_len)
+         && patch_len >= SAVE_STATE_PATCH_HEADER_SIZE)
+   {
+      const uint8_t *patch = (const uint8_t*)patch_buf;
+
+      if (     !memcmp(patch, SAVE_STATE_PATCH_MAGIC, 4)
+            && task_save_read_le32(patch + 4)  == SAVE_STATE_PATCH_VERSION
+            && task_save_read_le32(patch + 8)  == (uint32_t)size
+            && task_save_read_le32(patch + 12) == crc)
+      {
+         pos        = SAVE_STATE_PATCH_HEADER_SIZE;
+         patch_size = pos;
+
+         while (pos + SAVE_STATE_PATCH_RECORD_SIZE <= (size_t)patch_len
+               && !memcmp(patch + pos, SAVE_STATE_PATCH_RECORD_MAGIC, 4))
+         {
+            unsigned i;
+            size_t run_pos;
+            unsigned runs    = task_save_read_le32(patch + pos + 4);
+            size_t payload   = task_save_read_le32(patch + pos + 8);
+            const uint8_t *p = patch + pos + 12;
+            bool valid       = true;
+
+            if (payload > (size_t)patch_len - pos - SAVE_STATE_PATCH_RECORD_SIZE
+                  || task_save_read_le32(p + payload)
+                  != encoding_crc32(0, p, payload))
+               break;
+
+            /* Check every run before touching the state */
+            for (i = 0, run_pos = 0; i < runs && valid; i++)
+            {
+               size_t offset, len;
+
+               if (run_pos + 8 > payload)
+               {
+                  valid = false;
+                  break;
+               }
+
+               offset   = task_save_read_le32(p + run_pos);
+               len      = task_save_read_le32(p + run_pos + 4);
+               run_pos += 8;
+               valid    = offset <= size && len <= size - offset
+                  && len <= payload - run_pos;
+               run_pos += len;
+            }
+
+            if (!valid)
+               break;
+
+            for (i = 0, run_pos = 0; i < runs; i++)
+            {
+               size_t offset = task_save_read_le32(p + run_pos);
+               size_t len    = task_save_read_le32(p + run_pos + 4);
+               memcpy(data + offset, p + run_pos + 8, len);
+               run_pos      += 8 + len;
+            }
+
+            pos        += SAVE_STATE_PATCH_RECORD_SIZE + payload;
+            patch_size  = pos;
+            patches++;
+         }
+
+         RARCH_LOG("[State]: Applied %u patches from \"%s\".\n",
+               patches, patch_path);
+      }
+      else
+      {
+         RARCH_WARN("[State]: Ignoring \"%s\", it belongs to a different state.\n",
+               patch_path);
+         /* Get rid of it with the next save */
+         patches = SAVE_STATE_PATCH_MAX;
+      }
+   }
+
+   free(patch_buf);
+
+   if (state->incremental)
+      task_save_base_set(state->path, data, size, crc, patch_size, patches);
+}
+
 /**
  * task_save_handler:
  * @task : the task being worked on
@@ -594,7 +1466,19 @@ static void task_save_handler(retro_task_t *task)
    ssize_t remaining;
    save_task_state_t *state = (save_task_state_t*)task->state;
 
-   if (!state->file)
+   if (!state->file && !state->patched && state->incremental)
+   {
+      if (!state->data)
+         state->data  = get_serialized_data(state->path, state->size);
+
+      if (state->data && task_save_patch(state))
+      {
+         state->patched = true;
+         state->written = state->size;
+      }
+   }
+
+   if (!state->file && !state->patched)
    {
       state->file   = intfstream_open_file(
             state->path, RETRO_VFS_FILE_ACCESS_WRITE,
@@ -607,13 +1491,27 @@ static void task_save_handler(retro_task_t *task)
    if (!state->data)
       state->data  = get_serialized_data(state->path, state->size);
 
-   remaining       = MIN(state->size - state->written, SAVE_STATE_CHUNK);
-
-   if (state->data)
-      written      = (int)intfstream_write(state->file,
-         (uint8_t*)state->data + state->written, remaining);
+   if (state->patched)
+      remaining    = written = 0;
+#ifdef HAVE_SAVE_STATE_COMPRESSION
+   else if (state->compress && state->data)
+   {
+      remaining    = MIN(state->size - state->written,
+            SAVE_STATE_COMPRESS_CHUNK);
+      written      = task_save_compress(state, remaining)
+         ? (int)remaining : 0;
+   }
+#endif
    else
-      written      = 0;
+   {
+      remaining    = MIN(state->size - state->written, SAVE_STATE_CHUNK);
+
+      if (state->data)
+         written   = (int)intfstream_write(state->file,
+            (uint8_t*)state->data + state->written, remaining);
+      else
+         written   = 0;
+   }
 
    state->written += written;
 
@@ -649,6 +1547,9 @@ static void task_save_handler(retro_task_t *task)
    {
       char       *msg      = NULL;
 
+      if (!state->patched)
+         task_save_full_written(state);
+
       task_free_title(task);
 
       if (state->undo_save)
@@ -701,12 +1602,15 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    state->data                   = data;
    state->size                   = size;
    state->undo_save              = true;
+   state->compress               = settings->bools.savestate_file_compression;
+   state->incremental            = settings->bools.savestate_file_incremental;
    state->state_slot             = settings->ints.state_slot;
    state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
 
    task->type                    = TASK_TYPE_BLOCKING;
    task->state                   = state;
    task->handler                 = task_save_handler;
+   task->priority                = TASK_PRIORITY_SAVE;
    task->callback                = undo_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_UNDOING_SAVE_STATE));
 
@@ -846,7 +1750,23 @@ static void task_load_handler(retro_task_t *task)
    if (state->bytes_read == state->size)
    {
       size_t sizeof_msg = 8192;
-      char         *msg = (char*)malloc(sizeof_msg * sizeof(char));
+      char         *msg = NULL;
+
+#ifdef HAVE_SAVE_STATE_COMPRESSION
+      if (!task_load_decompress(state))
+      {
+         RARCH_ERR("[State]: Failed to decompress \"%s\".\n", state->path);
+         task_set_error(task, strdup(msg_hash_to_str(MSG_FAILED_TO_LOAD_STATE)));
+         free(state->data);
+         state->data = NULL;
+         task_load_handler_finished(task, state);
+         return;
+      }
+#endif
+
+      task_load_patch(state);
+
+      msg               = (char*)malloc(sizeof_msg * sizeof(char));
 
       msg[0]            = '\0';
 
@@ -936,7 +1856,7 @@ static void content_load_state_cb(retro_task_t *task,
       undo_save_buf.size = size;
       strlcpy(undo_save_buf.path, load_data->path, sizeof(undo_save_buf.path));
 
-      free(buf);
+      state_pool_put(buf);
       free(load_data);
       return;
    }
@@ -1022,7 +1942,7 @@ static void content_load_state_cb(retro_task_t *task,
    if (!ret)
       goto error;
 
-   free(buf);
+   state_pool_put(buf);
    free(load_data);
 
    return;
@@ -1032,7 +1952,7 @@ error:
          msg_hash_to_str(MSG_FAILED_TO_LOAD_STATE),
          load_data->path);
    if (buf)
-      free(buf);
+      state_pool_put(buf);
    free(load_data);
 }
 
@@ -1080,12 +2000,15 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    state->autosave         = autosave;
    state->mute             = autosave; /* don't show OSD messages if we are auto-saving */
    state->thumbnail_enable = settings->bools.savestate_thumbnail_enable;
+   state->compress         = settings->bools.savestate_file_compression;
+   state->incremental      = settings->bools.savestate_file_incremental;
    state->state_slot       = settings->ints.state_slot;
    state->has_valid_framebuffer  = video_driver_cached_frame_has_valid_framebuffer();
 
    task->type              = TASK_TYPE_BLOCKING;
    task->state             = state;
    task->handler           = task_save_handler;
+   task->priority          = TASK_PRIORITY_SAVE;
    task->callback          = save_state_cb;
    task->title             = strdup(msg_hash_to_str(MSG_SAVING_STATE));
    task->mute              = state->mute;
@@ -1094,7 +2017,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    {
       /* Another blocking task is already active. */
       if (data)
-         free(data);
+         state_pool_put(data);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1105,7 +2028,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
 
 error:
    if (data)
-      free(data);
+      state_pool_put(data);
    if (state)
       free(state);
    if (task)
@@ -1175,6 +2098,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    state->undo_size  = size;
    state->undo_data  = data;
    state->autosave   = autosave;
+   state->incremental = settings->bools.savestate_file_incremental;
    state->mute       = autosave; /* don't show OSD messages if we 
                                     are auto-saving */
    if (load_to_backup_buffer)
@@ -1186,6 +2110,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    task->state       = state;
    task->type        = TASK_TYPE_BLOCKING;
    task->handler     = task_load_handler;
+   task->priority    = TASK_PRIORITY_SAVE;
    task->callback    = content_load_and_save_state_cb;
    task->title       = strdup(msg_hash_to_str(MSG_LOADING_STATE));
    task->mute        = state->mute;
@@ -1194,7 +2119,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    {
       /* Another blocking task is already active. */
       if (data)
-         free(data);
+         state_pool_put(data);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1282,12 +2207,12 @@ bool content_save_state(const char *path, bool save_to_disk, bool autosave)
       undo_load_buf.data = malloc(info.size);
       if (!undo_load_buf.data)
       {
-         free(data);
+         state_pool_put(data);
          return false;
       }
 
       memcpy(undo_load_buf.data, data, info.size);
-      free(data);
+      state_pool_put(data);
       undo_load_buf.size = info.size;
       strlcpy(undo_load_buf.path, path, sizeof(undo_load_buf.path));
    }
@@ -1318,6 +2243,7 @@ bool content_load_state(const char *path,
    strlcpy(state->path, path, sizeof(state->path));
    state->load_to_backup_buffer = load_to_backup_buffer;
    state->autoload              = autoload;
+   state->incremental           = settings->bools.savestate_file_incremental;
    state->state_slot            = settings->ints.state_slot;
    state->has_valid_framebuffer = 
       video_driver_cached_frame_has_valid_framebuffer();
@@ -1325,6 +2251,7 @@ bool content_load_state(const char *path,
    task->type                   = TASK_TYPE_BLOCKING;
    task->state                  = state;
    task->handler                = task_load_handler;
+   task->priority               = TASK_PRIORITY_SAVE;
    task->callback               = content_load_state_cb;
    task->title                  = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -1381,6 +2308,8 @@ bool content_reset_savestate_backups(void)
    undo_load_buf.path[0] = '\0';
    undo_load_buf.size    = 0;
 
+   task_save_base_free();
+
    return true;
 }
 
@@ -1417,6 +2346,84 @@ static bool content_get_memory(retro_ctx_memory_info_t *mem_info,
  *
  * Load a RAM state from disk to memory.
  */
+/**
+ * content_load_ram_journal:
+ * @path             : path of the save file.
+ * @data             : loaded SRAM.
+ * @size             : size of @data.
+ *
+ * Applies the journal of an autosave which didn't make it to
+ * the save file, if any.
+ **/
+static void content_load_ram_journal(const char *path,
+      uint8_t *data, size_t size)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   int64_t len             = 0;
+   void *buf               = NULL;
+   const uint8_t *journal  = NULL;
+
+   strlcpy(journal_path, path, sizeof(journal_path));
+   strlcat(journal_path, AUTOSAVE_JOURNAL_EXTENSION, sizeof(journal_path));
+
+   if (     !path_is_valid(journal_path)
+         || !filestream_read_file(journal_path, &buf, &len))
+      return;
+
+   journal = (const uint8_t*)buf;
+
+   if (     len >= AUTOSAVE_JOURNAL_HEADER_SIZE + 4
+         && !memcmp(journal, AUTOSAVE_JOURNAL_MAGIC, 4)
+         && task_save_read_le32(journal + 4) == AUTOSAVE_JOURNAL_VERSION
+         && task_save_read_le32(journal + 8) == (uint32_t)size)
+   {
+      unsigned i;
+      size_t pos;
+      unsigned runs    = task_save_read_le32(journal + 12);
+      size_t payload   = (size_t)len - AUTOSAVE_JOURNAL_HEADER_SIZE - 4;
+      const uint8_t *p = journal + AUTOSAVE_JOURNAL_HEADER_SIZE;
+      bool valid       = task_save_read_le32(p + payload)
+         == encoding_crc32(0, p, payload);
+
+      /* Check every run before touching the SRAM */
+      for (i = 0, pos = 0; i < runs && valid; i++)
+      {
+         size_t offset, run_len;
+
+         if (pos + 8 > payload)
+         {
+            valid = false;
+            break;
+         }
+
+         offset  = task_save_read_le32(p + pos);
+         run_len = task_save_read_le32(p + pos + 4);
+         pos    += 8;
+         valid   = offset <= size && run_len <= size - offset
+            && run_len <= payload - pos;
+         pos    += run_len;
+      }
+
+      if (valid)
+      {
+         for (i = 0, pos = 0; i < runs; i++)
+         {
+            size_t offset  = task_save_read_le32(p + pos);
+            size_t run_len = task_save_read_le32(p + pos + 4);
+            memcpy(data + offset, p + pos + 8, run_len);
+            pos           += 8 + run_len;
+         }
+
+         RARCH_LOG("[Autosave]: Applied \"%s\".\n", journal_path);
+      }
+      else
+         RARCH_WARN("[Autosave]: Ignoring \"%s\", it's incomplete.\n",
+               journal_path);
+   }
+
+   free(buf);
+}
+
 bool content_load_ram_file(unsigned slot)
 {
    int64_t rc;
@@ -1443,6 +2450,10 @@ bool content_load_ram_file(unsigned slot)
          rc = mem_info.size;
       }
       memcpy(mem_info.data, buf, (size_t)rc);
+
+      if (rc == (ssize_t)mem_info.size)
+         content_load_ram_journal(ram.path,
+               (uint8_t*)mem_info.data, mem_info.size);
    }
 
    if (buf)
@@ -1546,6 +2557,18 @@ bool content_save_ram_file(unsigned slot)
       return false;
    }
 
+   /* Anything it held is in the save file now */
+   {
+      char journal_path[PATH_MAX_LENGTH];
+
+      strlcpy(journal_path, ram.path, sizeof(journal_path));
+      strlcat(journal_path, AUTOSAVE_JOURNAL_EXTENSION,
+            sizeof(journal_path));
+
+      if (path_is_valid(journal_path))
+         filestream_delete(journal_path);
+   }
+
    RARCH_LOG("%s \"%s\".\n",
          msg_hash_to_str(MSG_SAVED_SUCCESSFULLY_TO),
          ram.path);
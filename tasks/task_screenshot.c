@@ -31,6 +31,8 @@
 #include <string/stdstring.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
 
 #ifdef HAVE_RBMP
 #include <formats/rbmp.h>
@@ -81,36 +83,63 @@ struct screenshot_task_state
    struct scaler_ctx scaler;
 };
 
+#if defined(HAVE_RPNG)
+/* Fast deflate rather than the smallest files, so that the
+ * encode doesn't compete with the core for the CPU for long. */
+#define SCREENSHOT_PNG_LEVEL   1
+#define SCREENSHOT_PNG_THREADS 2
+
+/* Leaves a core to the main thread. */
+static unsigned screenshot_png_threads(void)
+{
+   unsigned cores = cpu_features_get_core_amount();
+
+   if (cores <= 2)
+      return cores == 2 ? 1 : 0;
+   return MIN(cores - 2, SCREENSHOT_PNG_THREADS);
+}
+#endif
+
 static bool screenshot_dump_direct(screenshot_task_state_t *state)
 {
    struct scaler_ctx *scaler      = (struct scaler_ctx*)&state->scaler;
    bool ret                       = false;
 
 #if defined(HAVE_RPNG)
-   if (state->bgr24)
-      scaler->in_fmt              = SCALER_FMT_BGR24;
-   else if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
-      scaler->in_fmt              = SCALER_FMT_ARGB8888;
-   else
-      scaler->in_fmt              = SCALER_FMT_RGB565;
-
-   video_frame_convert_to_bgr24(
-         scaler,
-         state->out_buffer,
-         (const uint8_t*)state->frame + ((int)state->height - 1)
-         * state->pitch,
-         state->width, state->height,
-         -state->pitch);
-
-   scaler_ctx_gen_reset(&state->scaler);
-
-   ret = rpng_save_image_bgr24(
+   const uint8_t *data            = (const uint8_t*)state->frame
+      + ((int)state->height - 1) * state->pitch;
+   int pitch                      = -state->pitch;
+
+   /* Viewport reads already are BGR24, so these get
+    * encoded as they are instead of being copied over. */
+   if (!state->bgr24)
+   {
+      if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
+         scaler->in_fmt           = SCALER_FMT_ARGB8888;
+      else
+         scaler->in_fmt           = SCALER_FMT_RGB565;
+
+      video_frame_convert_to_bgr24(
+            scaler,
+            state->out_buffer,
+            data,
+            state->width, state->height,
+            pitch);
+
+      scaler_ctx_gen_reset(&state->scaler);
+
+      data                        = state->out_buffer;
+      pitch                       = state->width * 3;
+   }
+
+   ret = rpng_save_image_bgr24_ex(
          state->filename,
-         state->out_buffer,
+         data,
          state->width,
          state->height,
-         state->width * 3
-         );
+         pitch,
+         SCREENSHOT_PNG_LEVEL,
+         screenshot_png_threads());
 
    free(state->out_buffer);
 #elif defined(HAVE_RBMP)
@@ -317,13 +346,16 @@ static bool screenshot_dump(
    }
 
 #if defined(HAVE_RPNG)
-   buf = (uint8_t*)malloc(width * height * 3);
-   if (!buf)
+   if (!bgr24)
    {
-      free(state);
-      return false;
+      buf = (uint8_t*)malloc(width * height * 3);
+      if (!buf)
+      {
+         free(state);
+         return false;
+      }
+      state->out_buffer = buf;
    }
-   state->out_buffer = buf;
 #endif
 
    if (use_thread)
@@ -333,6 +365,7 @@ static bool screenshot_dump(
       task->type        = TASK_TYPE_BLOCKING;
       task->state       = state;
       task->handler     = task_screenshot_handler;
+      task->priority    = TASK_PRIORITY_SAVE;
 #ifdef HAVE_MENU_WIDGETS
       task->callback    = task_screenshot_callback;
 #endif
@@ -0,0 +1,737 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <string/stdstring.h>
+#include <features/features_cpu.h>
+#include <formats/image.h>
+#include <queues/task_queue.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
+#include "tasks_internal.h"
+
+#include "../configuration.h"
+#include "../core_info.h"
+#include "../file_path_special.h"
+#include "../msg_hash.h"
+#include "../playlist.h"
+#include "../retroarch.h"
+#include "../verbosity.h"
+#include "../frontend/frontend_driver.h"
+#include "../gfx/video_image_cache.h"
+
+/* Startup stages. The main thread's stages are only timed. The
+ * others are tasks, pushed once the main thread's stages they
+ * depend on are done, and their results are taken by whoever
+ * needs them. A stage that hasn't started yet when it's taken
+ * runs on the taker's thread instead, which is also what happens
+ * to all of them when the task queue isn't threaded. */
+
+#define STARTUP_STAGE_BIT(stage) (1 << (stage))
+
+enum startup_state
+{
+   STARTUP_STATE_IDLE = 0,
+   STARTUP_STATE_PUSHED,
+   STARTUP_STATE_RUNNING,
+   STARTUP_STATE_DONE
+};
+
+typedef struct startup_core_info_args
+{
+   char path_info[PATH_MAX_LENGTH];
+   char dir_cores[PATH_MAX_LENGTH];
+   char dir_cache[PATH_MAX_LENGTH];
+   char exts[255];
+   bool show_hidden_files;
+} startup_core_info_args_t;
+
+typedef struct startup_history_args
+{
+   char path_content[PATH_MAX_LENGTH];
+   char path_music[PATH_MAX_LENGTH];
+   char path_video[PATH_MAX_LENGTH];
+   char path_image[PATH_MAX_LENGTH];
+   char dir_cache[PATH_MAX_LENGTH];
+   unsigned size;
+   bool journal;
+} startup_history_args_t;
+
+typedef struct startup_favorites_args
+{
+   char path[PATH_MAX_LENGTH];
+   unsigned size;
+   bool sort;
+} startup_favorites_args_t;
+
+typedef struct startup_menu_icons_args
+{
+   char dir[PATH_MAX_LENGTH];
+   bool supports_rgba;
+} startup_menu_icons_args_t;
+
+/* Zeroed before they're filled in, to be compared as a whole */
+typedef union startup_args
+{
+   startup_core_info_args_t core_info;
+   startup_history_args_t history;
+   startup_favorites_args_t favorites;
+   startup_menu_icons_args_t menu_icons;
+} startup_args_t;
+
+typedef struct startup_stage_info
+{
+   const char *name;
+   /* STARTUP_STAGE_BIT()s of the main thread's stages */
+   unsigned deps;
+   /* On the main thread, from the settings. False if there's
+    * nothing to do */
+   bool (*get_args)(startup_args_t *args);
+   /* On the main thread, before the stage is pushed */
+   void (*setup)(const startup_args_t *args);
+   void *(*run)(const startup_args_t *args);
+   void (*free_result)(void *result);
+} startup_stage_info_t;
+
+typedef struct startup_stage_state
+{
+   enum startup_state state;
+   startup_args_t args;
+   void *result;
+   retro_time_t begin;
+   retro_time_t end;
+   /* Spent by the main thread waiting on it */
+   retro_time_t wait;
+   bool ran_inline;
+} startup_stage_state_t;
+
+static bool startup_active                                   = false;
+static bool startup_cancel                                   = false;
+static retro_time_t startup_time                             = 0;
+static startup_stage_state_t startup_stages[STARTUP_STAGE_LAST];
+#ifdef HAVE_THREADS
+static slock_t *startup_lock                                 = NULL;
+static scond_t *startup_cond                                 = NULL;
+#endif
+
+static void startup_lock_acquire(void)
+{
+#ifdef HAVE_THREADS
+   slock_lock(startup_lock);
+#endif
+}
+
+static void startup_lock_release(void)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(startup_lock);
+#endif
+}
+
+static bool startup_core_info_get_args(startup_args_t *args)
+{
+   settings_t *settings           = config_get_ptr();
+   startup_core_info_args_t *info = &args->core_info;
+
+   if (string_is_empty(settings->paths.directory_libretro))
+      return false;
+   if (!frontend_driver_get_core_extension(info->exts, sizeof(info->exts)))
+      return false;
+
+   strlcpy(info->path_info, settings->paths.path_libretro_info,
+         sizeof(info->path_info));
+   strlcpy(info->dir_cores, settings->paths.directory_libretro,
+         sizeof(info->dir_cores));
+   if (settings->bools.core_info_cache)
+      strlcpy(info->dir_cache, settings->paths.directory_cache,
+            sizeof(info->dir_cache));
+   info->show_hidden_files = settings->bools.show_hidden_files;
+
+   return true;
+}
+
+static void startup_core_info_setup(const startup_args_t *args)
+{
+   core_info_set_cache_dir(args->core_info.dir_cache);
+}
+
+static void *startup_core_info_run(const startup_args_t *args)
+{
+   const startup_core_info_args_t *info = &args->core_info;
+
+   return core_info_list_load(info->path_info, info->dir_cores,
+         info->exts, info->show_hidden_files);
+}
+
+static void startup_core_info_free(void *result)
+{
+   core_info_list_free((core_info_list_t*)result);
+}
+
+static bool startup_history_get_args(startup_args_t *args)
+{
+   settings_t *settings            = config_get_ptr();
+   startup_history_args_t *history = &args->history;
+
+   if (!settings->bools.history_list_enable)
+      return false;
+
+   strlcpy(history->path_content, settings->paths.path_content_history,
+         sizeof(history->path_content));
+   strlcpy(history->path_music, settings->paths.path_content_music_history,
+         sizeof(history->path_music));
+#if defined(HAVE_FFMPEG) || defined(HAVE_MPV)
+   strlcpy(history->path_video, settings->paths.path_content_video_history,
+         sizeof(history->path_video));
+#endif
+#ifdef HAVE_IMAGEVIEWER
+   strlcpy(history->path_image, settings->paths.path_content_image_history,
+         sizeof(history->path_image));
+#endif
+   if (settings->bools.playlist_binary_cache)
+      strlcpy(history->dir_cache, settings->paths.directory_cache,
+            sizeof(history->dir_cache));
+   history->size    = settings->uints.content_history_size;
+   history->journal = settings->bools.playlist_journal;
+
+   return true;
+}
+
+static void startup_history_setup(const startup_args_t *args)
+{
+   playlist_set_cache_dir(args->history.dir_cache);
+   playlist_set_journal_enable(args->history.journal);
+}
+
+static playlist_t *startup_history_load(const char *path, unsigned size)
+{
+   if (string_is_empty(path))
+      return NULL;
+
+   RARCH_LOG("%s: [%s].\n",
+         msg_hash_to_str(MSG_LOADING_HISTORY_FILE), path);
+   return playlist_init(path, size);
+}
+
+static void *startup_history_run(const startup_args_t *args)
+{
+   const startup_history_args_t *history_args = &args->history;
+   startup_history_t *history                 = (startup_history_t*)
+      calloc(1, sizeof(*history));
+
+   if (!history)
+      return NULL;
+
+   history->content = startup_history_load(
+         history_args->path_content, history_args->size);
+   history->music   = startup_history_load(
+         history_args->path_music, history_args->size);
+   history->video   = startup_history_load(
+         history_args->path_video, history_args->size);
+   history->image   = startup_history_load(
+         history_args->path_image, history_args->size);
+
+   return history;
+}
+
+static void startup_history_free(void *result)
+{
+   startup_history_t *history = (startup_history_t*)result;
+
+   if (!history)
+      return;
+
+   if (history->content)
+      playlist_free(history->content);
+   if (history->music)
+      playlist_free(history->music);
+   if (history->video)
+      playlist_free(history->video);
+   if (history->image)
+      playlist_free(history->image);
+   free(history);
+}
+
+static bool startup_favorites_get_args(startup_args_t *args)
+{
+   settings_t *settings                = config_get_ptr();
+   startup_favorites_args_t *favorites = &args->favorites;
+
+   strlcpy(favorites->path, settings->paths.path_content_favorites,
+         sizeof(favorites->path));
+   if (settings->ints.content_favorites_size < 0)
+      favorites->size = COLLECTION_SIZE;
+   else
+      favorites->size = (unsigned)settings->ints.content_favorites_size;
+   favorites->sort    = settings->bools.playlist_sort_alphabetical;
+
+   return true;
+}
+
+static void *startup_favorites_run(const startup_args_t *args)
+{
+   const startup_favorites_args_t *favorites_args = &args->favorites;
+   playlist_t *favorites                          = NULL;
+
+   RARCH_LOG("%s: [%s].\n",
+         msg_hash_to_str(MSG_LOADING_FAVORITES_FILE),
+         favorites_args->path);
+   favorites = playlist_init(favorites_args->path, favorites_args->size);
+
+   if (favorites && favorites_args->sort)
+      playlist_qsort(favorites);
+
+   return favorites;
+}
+
+static void startup_favorites_free(void *result)
+{
+   if (result)
+      playlist_free((playlist_t*)result);
+}
+
+static bool startup_menu_icons_get_args(startup_args_t *args)
+{
+#ifdef HAVE_MENU
+   settings_t *settings                  = config_get_ptr();
+   startup_menu_icons_args_t *menu_icons = &args->menu_icons;
+   const char *menu_driver               = settings->arrays.menu_driver;
+
+   /* Where the menu driver takes most of its icons from */
+   if (     string_is_equal(menu_driver, "xmb")
+         || string_is_equal(menu_driver, "stripes"))
+      fill_pathname_application_special(menu_icons->dir,
+            sizeof(menu_icons->dir),
+            APPLICATION_SPECIAL_DIRECTORY_ASSETS_XMB_ICONS);
+   else if (string_is_equal(menu_driver, "glui"))
+      fill_pathname_application_special(menu_icons->dir,
+            sizeof(menu_icons->dir),
+            APPLICATION_SPECIAL_DIRECTORY_ASSETS_MATERIALUI_ICONS);
+   else if (string_is_equal(menu_driver, "ozone"))
+   {
+      char dir_xmb[PATH_MAX_LENGTH];
+
+      dir_xmb[0] = '\0';
+
+      fill_pathname_join(dir_xmb, settings->paths.directory_assets,
+            "xmb", sizeof(dir_xmb));
+      fill_pathname_join(dir_xmb, dir_xmb, "monochrome", sizeof(dir_xmb));
+      fill_pathname_join(menu_icons->dir, dir_xmb, "png",
+            sizeof(menu_icons->dir));
+   }
+
+   if (string_is_empty(menu_icons->dir))
+      return false;
+
+   menu_icons->supports_rgba = video_driver_supports_rgba();
+
+   return true;
+#else
+   return false;
+#endif
+}
+
+typedef struct startup_menu_icons_job
+{
+   const startup_menu_icons_args_t *args;
+   struct string_list *list;
+   /* Of pixels, decoded so far */
+   size_t size;
+} startup_menu_icons_job_t;
+
+/* Decodes the icons into the shared image cache, for the menu
+ * driver to find there as it loads them on the main thread. */
+static void startup_menu_icons_decode(void *data, size_t begin, size_t end)
+{
+   size_t i;
+   startup_menu_icons_job_t *job = (startup_menu_icons_job_t*)data;
+
+   for (i = begin; i < end; i++)
+   {
+      struct texture_image ti;
+      bool full;
+
+      startup_lock_acquire();
+      /* Warming icons the cache would drop again is wasted */
+      full = startup_cancel || job->size > VIDEO_IMAGE_CACHE_MAX_SIZE / 2;
+      startup_lock_release();
+
+      if (full)
+         break;
+
+      ti.width         = 0;
+      ti.height        = 0;
+      ti.pixels        = NULL;
+      ti.supports_rgba = job->args->supports_rgba;
+
+      if (!video_image_cache_load(&ti, job->list->elems[i].data))
+         continue;
+
+      startup_lock_acquire();
+      job->size += (size_t)ti.width * ti.height * sizeof(uint32_t);
+      startup_lock_release();
+
+      image_texture_free(&ti);
+   }
+}
+
+static void *startup_menu_icons_run(const startup_args_t *args)
+{
+   startup_menu_icons_job_t job;
+#ifdef HAVE_THREADS
+   struct tpool *tp = NULL;
+   unsigned threads = 0;
+#endif
+
+   job.args = &args->menu_icons;
+   job.size = 0;
+   job.list = dir_list_new(args->menu_icons.dir, "png",
+         false, false, false, false);
+
+   if (!job.list)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   /* The calling thread decodes too */
+   threads = cpu_features_get_core_amount();
+   if (threads > 1 && job.list->size > 1)
+      tp   = tpool_create_with_role(threads - 1, STHREAD_ROLE_TASK);
+
+   tpool_parallel_for(tp, job.list->size, 1,
+         startup_menu_icons_decode, &job);
+
+   if (tp)
+      tpool_destroy(tp);
+#else
+   startup_menu_icons_decode(&job, 0, job.list->size);
+#endif
+
+   dir_list_free(job.list);
+
+   return NULL;
+}
+
+static const startup_stage_info_t startup_stage_infos[STARTUP_STAGE_LAST] = {
+   { "config",     0, NULL, NULL, NULL, NULL },
+   { "core",       0, NULL, NULL, NULL, NULL },
+   { "video",      0, NULL, NULL, NULL, NULL },
+   { "drivers",    0, NULL, NULL, NULL, NULL },
+   {
+      "core info",
+      STARTUP_STAGE_BIT(STARTUP_STAGE_CONFIG),
+      startup_core_info_get_args,
+      startup_core_info_setup,
+      startup_core_info_run,
+      startup_core_info_free
+   },
+   {
+      "history",
+      STARTUP_STAGE_BIT(STARTUP_STAGE_CONFIG),
+      startup_history_get_args,
+      startup_history_setup,
+      startup_history_run,
+      startup_history_free
+   },
+   {
+      "favorites",
+      STARTUP_STAGE_BIT(STARTUP_STAGE_CONFIG),
+      startup_favorites_get_args,
+      NULL,
+      startup_favorites_run,
+      startup_favorites_free
+   },
+   {
+      "menu icons",
+      STARTUP_STAGE_BIT(STARTUP_STAGE_VIDEO),
+      startup_menu_icons_get_args,
+      NULL,
+      startup_menu_icons_run,
+      NULL
+   }
+};
+
+/* Runs a stage claimed by the caller, with the lock held */
+static void startup_stage_run(enum startup_stage stage)
+{
+   startup_stage_state_t *s       = &startup_stages[stage];
+   const startup_stage_info_t *in = &startup_stage_infos[stage];
+   void *result                   = NULL;
+
+   s->state                       = STARTUP_STATE_RUNNING;
+   s->begin                       = cpu_features_get_time_usec();
+   startup_lock_release();
+
+   result                         = in->run(&s->args);
+
+   startup_lock_acquire();
+   s->result                      = result;
+   s->end                         = cpu_features_get_time_usec();
+   s->state                       = STARTUP_STATE_DONE;
+#ifdef HAVE_THREADS
+   scond_broadcast(startup_cond);
+#endif
+}
+
+static void task_startup_handler(retro_task_t *task)
+{
+   enum startup_stage stage = (enum startup_stage)(uintptr_t)task->state;
+
+   startup_lock_acquire();
+   /* Unless the main thread took it meanwhile */
+   if (startup_stages[stage].state == STARTUP_STATE_PUSHED)
+      startup_stage_run(stage);
+   startup_lock_release();
+
+   task_set_finished(task, true);
+}
+
+static void startup_stage_push(enum startup_stage stage)
+{
+   startup_stage_state_t *s       = &startup_stages[stage];
+   const startup_stage_info_t *in = &startup_stage_infos[stage];
+   retro_task_t *task             = NULL;
+
+   memset(&s->args, 0, sizeof(s->args));
+
+   if (!in->get_args(&s->args))
+   {
+      s->state = STARTUP_STATE_DONE;
+      return;
+   }
+
+   if (in->setup)
+      in->setup(&s->args);
+
+   if (!(task = task_init()))
+   {
+      s->state = STARTUP_STATE_DONE;
+      return;
+   }
+
+   s->state       = STARTUP_STATE_PUSHED;
+
+   task->type     = TASK_TYPE_NONE;
+   task->state    = (void*)(uintptr_t)stage;
+   task->handler  = task_startup_handler;
+   task->mute     = true;
+
+   task_queue_push(task);
+}
+
+/* Pushes the stages that are ready. On the main thread, as it
+ * reads the settings. */
+static void startup_stage_push_ready(void)
+{
+   unsigned i;
+   unsigned done = 0;
+
+   for (i = 0; i < STARTUP_STAGE_LAST; i++)
+      if (startup_stages[i].state == STARTUP_STATE_DONE)
+         done |= STARTUP_STAGE_BIT(i);
+
+   for (i = 0; i < STARTUP_STAGE_LAST; i++)
+   {
+      const startup_stage_info_t *in = &startup_stage_infos[i];
+
+      if (     in->run
+            && startup_stages[i].state == STARTUP_STATE_IDLE
+            && (in->deps & done) == in->deps)
+         startup_stage_push((enum startup_stage)i);
+   }
+}
+
+void startup_stage_begin(enum startup_stage stage)
+{
+   unsigned i;
+
+   if (stage == STARTUP_STAGE_CONFIG)
+   {
+#ifdef HAVE_THREADS
+      if (!startup_lock)
+         startup_lock = slock_new();
+      if (!startup_cond)
+         startup_cond = scond_new();
+      if (!startup_lock || !startup_cond)
+         return;
+#endif
+      /* Anything left of the last startup is finished by now */
+      for (i = 0; i < STARTUP_STAGE_LAST; i++)
+      {
+         startup_stages[i].state      = STARTUP_STATE_IDLE;
+         startup_stages[i].begin      = 0;
+         startup_stages[i].end        = 0;
+         startup_stages[i].wait       = 0;
+         startup_stages[i].ran_inline = false;
+      }
+
+      startup_active = true;
+      startup_cancel = false;
+      startup_time   = cpu_features_get_time_usec();
+   }
+
+   if (!startup_active)
+      return;
+
+   startup_stages[stage].begin = cpu_features_get_time_usec();
+}
+
+void startup_stage_end(enum startup_stage stage)
+{
+   if (!startup_active)
+      return;
+
+   startup_lock_acquire();
+   startup_stages[stage].end   = cpu_features_get_time_usec();
+   startup_stages[stage].state = STARTUP_STATE_DONE;
+   startup_lock_release();
+
+   startup_stage_push_ready();
+}
+
+void startup_stage_wait(enum startup_stage stage)
+{
+   startup_stage_state_t *s = &startup_stages[stage];
+   retro_time_t begin       = 0;
+
+   if (!startup_active)
+      return;
+
+   begin = cpu_features_get_time_usec();
+
+   startup_lock_acquire();
+
+   if (s->state == STARTUP_STATE_PUSHED)
+   {
+      /* Not started yet, quicker to run it here */
+      s->ran_inline = true;
+      startup_stage_run(stage);
+   }
+#ifdef HAVE_THREADS
+   else
+      while (s->state == STARTUP_STATE_RUNNING)
+         scond_wait(startup_cond, startup_lock);
+#endif
+
+   s->wait += cpu_features_get_time_usec() - begin;
+
+   startup_lock_release();
+}
+
+void *startup_stage_take(enum startup_stage stage)
+{
+   startup_args_t args;
+   startup_stage_state_t *s       = &startup_stages[stage];
+   const startup_stage_info_t *in = &startup_stage_infos[stage];
+   void *result                   = NULL;
+
+   if (!startup_active)
+      return NULL;
+
+   startup_stage_wait(stage);
+
+   startup_lock_acquire();
+   result    = s->result;
+   s->result = NULL;
+   startup_lock_release();
+
+   if (!result)
+      return NULL;
+
+   /* Only good for the settings it was made with */
+   memset(&args, 0, sizeof(args));
+   if (     !in->get_args(&args)
+         || memcmp(&args, &s->args, sizeof(args)))
+   {
+      if (in->free_result)
+         in->free_result(result);
+      return NULL;
+   }
+
+   return result;
+}
+
+void startup_finish(void)
+{
+   unsigned i;
+   retro_time_t now;
+
+   if (!startup_active)
+      return;
+
+   startup_lock_acquire();
+   startup_cancel = true;
+   startup_lock_release();
+
+   for (i = 0; i < STARTUP_STAGE_LAST; i++)
+   {
+      startup_stage_state_t *s       = &startup_stages[i];
+      const startup_stage_info_t *in = &startup_stage_infos[i];
+
+      if (!in->run)
+         continue;
+
+      startup_lock_acquire();
+      /* Nobody took it, it's too late to start it */
+      if (s->state == STARTUP_STATE_PUSHED)
+         s->state = STARTUP_STATE_IDLE;
+      startup_lock_release();
+
+      startup_stage_wait((enum startup_stage)i);
+
+      if (s->result && in->free_result)
+         in->free_result(s->result);
+      s->result = NULL;
+   }
+
+   now = cpu_features_get_time_usec();
+
+   RARCH_LOG("[Startup]: Ready after %.1f ms.\n",
+         (now - startup_time) / 1000.0);
+
+   for (i = 0; i < STARTUP_STAGE_LAST; i++)
+   {
+      char waited[64];
+      startup_stage_state_t *s = &startup_stages[i];
+
+      /* Skipped */
+      if (s->state != STARTUP_STATE_DONE || !s->end)
+         continue;
+
+      waited[0] = '\0';
+
+      if (s->wait)
+         snprintf(waited, sizeof(waited), ", waited on for %.1f ms",
+               s->wait / 1000.0);
+
+      RARCH_LOG("[Startup]: %-10s %8.1f ms, from %8.1f ms%s%s.\n",
+            startup_stage_infos[i].name,
+            (s->end - s->begin) / 1000.0,
+            (s->begin - startup_time) / 1000.0,
+            s->ran_inline ? ", on the main thread" : "",
+            waited);
+   }
+
+   startup_active = false;
+}
@@ -56,6 +56,7 @@ struct autoconfig_params
    uint32_t max_users;
    char  *name;
    char  *autoconfig_directory;
+   char  *cache_directory;
 };
 
 
@@ -114,10 +115,28 @@ bool task_push_pl_entry_thumbnail_download(
 bool task_push_pl_manager_reset_cores(const char *playlist_path);
 bool task_push_pl_manager_clean_playlist(const char *playlist_path);
 
-bool task_push_image_load(const char *fullpath,
+bool task_push_content_preload(const char *content_path,
+      const char *core_path);
+
+bool task_push_disk_preload(const char *image_path);
+
+struct dir_list_reader;
+
+bool task_push_dir_list(struct dir_list_reader *reader, const char *path,
+      retro_task_callback_t cb, void *user_data);
+
+/* Returns the task, which may be cancelled until its callback runs */
+void *task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
 
+/* As task_push_image_load(), run with @priority. Only interactive
+ * loads are shared through the decoded image cache. */
+void *task_push_image_load_priority(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      enum task_priority priority,
+      retro_task_callback_t cb, void *userdata);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -129,6 +148,37 @@ bool task_push_dbscan(
 
 bool task_push_manual_content_scan(void);
 
+#ifdef HAVE_THREADS
+/* Reads items of a list ahead of a task that goes through it in
+ * order, on the task queue's pool, a few past the one the task is
+ * at. Item @index is read by calling func(userdata, index, result),
+ * result pointing to @result_size bytes. */
+typedef struct task_read_ahead task_read_ahead_t;
+
+typedef void (*task_read_ahead_func_t)(void *userdata,
+      size_t index, void *result);
+
+/* Reads up to @num_slots items ahead. NULL when there's nothing
+ * to read ahead with, the task then reads each item itself. */
+task_read_ahead_t *task_read_ahead_new(size_t count, size_t num_slots,
+      size_t result_size, task_read_ahead_func_t func, void *userdata);
+
+/* Waits for the reads left, before anything they use is freed */
+void task_read_ahead_free(task_read_ahead_t *ahead);
+
+/* Copies what was read of item @index to @result, waiting for it
+ * if it's being read, and has the items after it read up to
+ * @count. Returns false if it wasn't read, the task reads it
+ * itself then. */
+bool task_read_ahead_take(task_read_ahead_t *ahead,
+      size_t index, size_t count, void *result);
+
+/* Held by func around reads of anything the task changes, and by
+ * the task around the changes */
+void task_read_ahead_lock(task_read_ahead_t *ahead);
+void task_read_ahead_unlock(task_read_ahead_t *ahead);
+#endif
+
 #ifdef HAVE_OVERLAY
 bool task_push_overlay_load_default(
       retro_task_callback_t cb,
@@ -150,6 +200,11 @@ bool patch_content(
       uint8_t **buf,
       void *data);
 
+/* Applies a BPS patch to *buf, which is replaced
+ * with the target. Left as it was on failure. */
+bool patch_bps_buffer(const uint8_t *patch, uint64_t patch_size,
+      uint8_t **buf, uint64_t *size);
+
 bool task_check_decompress(const char *source_file);
 
 void *task_push_decompress(
@@ -208,6 +263,59 @@ void set_save_state_in_background(bool state);
 void task_push_cdrom_dump(const char *drive);
 #endif
 
+enum startup_stage
+{
+   /* On the main thread, in this order */
+   STARTUP_STAGE_CONFIG = 0,
+   STARTUP_STAGE_CORE,
+   STARTUP_STAGE_VIDEO,
+   STARTUP_STAGE_DRIVERS,
+   /* Tasks, pushed once the above they depend on are done */
+   STARTUP_STAGE_CORE_INFO,
+   STARTUP_STAGE_HISTORY,
+   STARTUP_STAGE_FAVORITES,
+   /* Decodes them into the shared image cache, no result */
+   STARTUP_STAGE_MENU_ICONS,
+   STARTUP_STAGE_LAST
+};
+
+/* Result of STARTUP_STAGE_HISTORY */
+typedef struct startup_history
+{
+   struct content_playlist *content;
+   struct content_playlist *music;
+   struct content_playlist *video;
+   struct content_playlist *image;
+} startup_history_t;
+
+/* Times a stage of the main thread. Beginning STARTUP_STAGE_CONFIG
+ * starts over; does nothing else outside of a startup. */
+void startup_stage_begin(enum startup_stage stage);
+
+/* Also pushes the stages depending on @stage */
+void startup_stage_end(enum startup_stage stage);
+
+/* Waits for a task stage, or runs it right away if it's still
+ * queued. */
+void startup_stage_wait(enum startup_stage stage);
+
+/**
+ * startup_stage_take:
+ * @stage              : A task stage.
+ *
+ * Waits for @stage and hands its result over: a core_info_list_t
+ * for STARTUP_STAGE_CORE_INFO, a startup_history_t for
+ * STARTUP_STAGE_HISTORY, a playlist_t for STARTUP_STAGE_FAVORITES.
+ *
+ * Returns: the result, or NULL if there's none, or if the
+ * settings it was made from changed since.
+ **/
+void *startup_stage_take(enum startup_stage stage);
+
+/* Ends the startup: waits for or drops the stages left, logs how
+ * long each took. */
+void startup_finish(void);
+
 extern const char* const input_builtin_autoconfs[];
 
 RETRO_END_DECLS
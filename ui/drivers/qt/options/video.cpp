@@ -297,6 +297,7 @@ void CrtSwitchresPage::onCrtSuperResolutionComboIndexChanged(int index)
 {
    Q_UNUSED(index)
    config_get_ptr()->uints.crt_switch_resolution_super = m_crtSuperResolutionCombo->currentData().value<unsigned>();
+   video_driver_info_invalidate();
 }
 
 AspectRatioRadioButton::AspectRatioRadioButton(unsigned min, unsigned max, QWidget *parent) :
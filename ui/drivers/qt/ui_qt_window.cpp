@@ -1410,7 +1410,7 @@ QVector<QHash<QString, QString> > MainWindow::getCoreInfo()
       }
    }
 
-   if (currentCore["core_path"].isEmpty() || !core_info || !core_info->config_data)
+   if (currentCore["core_path"].isEmpty() || !core_info || !core_info->has_info)
    {
       QHash<QString, QString> hash;
 
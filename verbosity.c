@@ -76,6 +76,27 @@
 #define FILE_PATH_PROGRAM_NAME "RetroArch"
 #endif
 
+/* Where messages go to a FILE, a thread writes them; whoever logs
+ * only formats the message and copies it to a ring */
+#if defined(HAVE_THREADS) && defined(RARCH_INTERNAL) && !defined(IS_SALAMANDER) && !defined(HAVE_LOGGER)
+#if !defined(HAVE_QT) && !defined(__WINRT__) && !defined(ANDROID) && !defined(_XBOX1) && !defined(HAVE_LIBNX)
+#if !defined(__MACH__) || !TARGET_OS_IPHONE
+#define HAVE_LOG_WRITER
+#endif
+#endif
+#endif
+
+#ifdef HAVE_LOG_WRITER
+#include <stdlib.h>
+#include <string.h>
+#include <rthreads/rthreads.h>
+
+/* Messages beyond are dropped, and counted */
+#define LOG_WRITER_RING_SIZE (256 * 1024)
+/* Longer messages are cut */
+#define LOG_WRITER_MSG_SIZE  2048
+#endif
+
 /* If this is non-NULL. RARCH_LOG and friends
  * will write to this file. */
 static FILE *log_file_fp                            = NULL;
@@ -87,6 +108,30 @@ static bool log_file_initialized                    = false;
 static bool log_file_override_active                = false;
 static char log_file_override_path[PATH_MAX_LENGTH] = {0};
 
+#ifdef HAVE_LOG_WRITER
+static sthread_t *log_writer_thread                 = NULL;
+static slock_t *log_writer_lock                     = NULL;
+/* Signalled when there's something to write, and when
+ * it was written */
+static scond_t *log_writer_cond                     = NULL;
+static scond_t *log_writer_done_cond                = NULL;
+static char *log_writer_ring                        = NULL;
+/* Bytes queued and written so far, modulo the ring size
+ * is where */
+static size_t log_writer_head                       = 0;
+static size_t log_writer_tail                       = 0;
+static unsigned log_writer_dropped                  = 0;
+static bool log_writer_quit                         = false;
+/* Cleared under the lock once stopping, from then on
+ * messages are written directly */
+static bool log_writer_running                      = false;
+static FILE *log_writer_fp                          = NULL;
+/* The last message, only counted while it repeats */
+static char log_writer_last[LOG_WRITER_MSG_SIZE];
+static size_t log_writer_last_len                   = 0;
+static unsigned log_writer_repeats                  = 0;
+#endif
+
 #ifdef HAVE_LIBNX
 static Mutex logging_mtx;
 #ifdef NXLINK
@@ -132,6 +177,251 @@ bool *verbosity_get_ptr(void)
    return &main_verbosity;
 }
 
+#ifdef HAVE_LOG_WRITER
+static void log_writer_loop(void *data)
+{
+   FILE *fp = (FILE*)data;
+
+   slock_lock(log_writer_lock);
+
+   for (;;)
+   {
+      size_t start, len;
+
+      while (log_writer_head == log_writer_tail && !log_writer_quit)
+         scond_wait(log_writer_cond, log_writer_lock);
+
+      if (log_writer_head == log_writer_tail)
+         break;
+
+      /* Up to the end of the ring, the rest next time around */
+      start              = log_writer_tail % LOG_WRITER_RING_SIZE;
+      len                = log_writer_head - log_writer_tail;
+      if (len > LOG_WRITER_RING_SIZE - start)
+         len             = LOG_WRITER_RING_SIZE - start;
+
+      /* Nobody writes to what's queued */
+      slock_unlock(log_writer_lock);
+
+      fwrite(log_writer_ring + start, 1, len, fp);
+      fflush(fp);
+
+      slock_lock(log_writer_lock);
+      log_writer_tail   += len;
+      scond_broadcast(log_writer_done_cond);
+   }
+
+   slock_unlock(log_writer_lock);
+}
+
+/* The push functions are called with the lock held */
+static size_t log_writer_space(void)
+{
+   return LOG_WRITER_RING_SIZE - (log_writer_head - log_writer_tail);
+}
+
+static void log_writer_push_raw(const char *msg, size_t len)
+{
+   size_t start = log_writer_head % LOG_WRITER_RING_SIZE;
+   size_t first = len < LOG_WRITER_RING_SIZE - start
+      ? len : LOG_WRITER_RING_SIZE - start;
+
+   memcpy(log_writer_ring + start, msg, first);
+   memcpy(log_writer_ring, msg + first, len - first);
+   log_writer_head += len;
+}
+
+static void log_writer_push(const char *msg, size_t len)
+{
+   char notice[128];
+   int notice_len = 0;
+
+   if (log_writer_dropped)
+   {
+      notice_len = snprintf(notice, sizeof(notice),
+            "%s %u log messages dropped\n",
+            FILE_PATH_LOG_WARN, log_writer_dropped);
+      if (notice_len < 0 || (size_t)notice_len >= sizeof(notice))
+         notice_len = 0;
+   }
+
+   if (len + (size_t)notice_len > log_writer_space())
+   {
+      log_writer_dropped++;
+      return;
+   }
+
+   if (notice_len)
+   {
+      log_writer_push_raw(notice, (size_t)notice_len);
+      log_writer_dropped = 0;
+   }
+
+   log_writer_push_raw(msg, len);
+}
+
+static void log_writer_push_repeats(void)
+{
+   char msg[128];
+   int len;
+
+   if (!log_writer_repeats)
+      return;
+
+   len = snprintf(msg, sizeof(msg), "%s Last message repeated %u times\n",
+         FILE_PATH_LOG_INFO, log_writer_repeats);
+   log_writer_repeats = 0;
+
+   if (len > 0)
+      log_writer_push(msg, (size_t)len < sizeof(msg)
+            ? (size_t)len : sizeof(msg) - 1);
+}
+
+/* Returns false, without touching ap, if the writer isn't
+ * running, for the message to be written directly */
+static bool log_writer_send(const char *tag, const char *fmt, va_list ap)
+{
+   char msg[LOG_WRITER_MSG_SIZE];
+   size_t len   = 0;
+   bool running = false;
+   int ret;
+
+   if (!log_writer_lock)
+      return false;
+
+   slock_lock(log_writer_lock);
+   running      = log_writer_running;
+   slock_unlock(log_writer_lock);
+
+   if (!running)
+      return false;
+
+   ret        = snprintf(msg, sizeof(msg), "%s ", tag);
+
+   if (ret > 0)
+      len     = (size_t)ret < sizeof(msg) ? (size_t)ret : sizeof(msg) - 1;
+
+   ret        = vsnprintf(msg + len, sizeof(msg) - len, fmt, ap);
+
+   if (ret > 0)
+      len    += (size_t)ret < sizeof(msg) - len
+         ? (size_t)ret : sizeof(msg) - len - 1;
+
+   /* Cut, but still a line of its own */
+   if (len == sizeof(msg) - 1)
+      msg[len - 1] = '\n';
+
+   slock_lock(log_writer_lock);
+
+   /* Stopped while this was formatted */
+   if (!log_writer_running)
+   {
+      slock_unlock(log_writer_lock);
+      fwrite(msg, 1, len, log_writer_fp);
+      fflush(log_writer_fp);
+      return true;
+   }
+
+   if (     len == log_writer_last_len
+         && !memcmp(msg, log_writer_last, len))
+      log_writer_repeats++;
+   else
+   {
+      bool is_error = string_is_equal(tag, FILE_PATH_LOG_ERROR);
+
+      /* Errors aren't dropped, and are on the file before going
+       * on, in case what comes next is a crash */
+      if (is_error)
+         while (     log_writer_space() < LOG_WRITER_RING_SIZE / 2
+                  && log_writer_running)
+            scond_wait(log_writer_done_cond, log_writer_lock);
+
+      log_writer_push_repeats();
+      log_writer_push(msg, len);
+
+      memcpy(log_writer_last, msg, len);
+      log_writer_last_len = len;
+
+      scond_signal(log_writer_cond);
+
+      if (is_error)
+      {
+         size_t end = log_writer_head;
+
+         while (log_writer_tail < end && log_writer_running)
+            scond_wait(log_writer_done_cond, log_writer_lock);
+      }
+   }
+
+   slock_unlock(log_writer_lock);
+   return true;
+}
+
+static void log_writer_stop(void)
+{
+   if (!log_writer_thread)
+      return;
+
+   /* What's queued is still written, senders waiting on
+    * it are let go */
+   slock_lock(log_writer_lock);
+   log_writer_push_repeats();
+   log_writer_last_len = 0;
+   log_writer_quit     = true;
+   log_writer_running  = false;
+   scond_signal(log_writer_cond);
+   scond_broadcast(log_writer_done_cond);
+   slock_unlock(log_writer_lock);
+
+   sthread_join(log_writer_thread);
+   log_writer_thread   = NULL;
+
+   slock_lock(log_writer_lock);
+   log_writer_quit     = false;
+   slock_unlock(log_writer_lock);
+}
+
+static void log_writer_start(FILE *fp)
+{
+   static bool registered = false;
+
+   if (log_writer_thread || !fp)
+      return;
+
+   if (!log_writer_lock)
+   {
+      log_writer_lock      = slock_new();
+      log_writer_cond      = scond_new();
+      log_writer_done_cond = scond_new();
+      log_writer_ring      = (char*)malloc(LOG_WRITER_RING_SIZE);
+   }
+
+   if (     !log_writer_lock
+         || !log_writer_cond
+         || !log_writer_done_cond
+         || !log_writer_ring)
+      return;
+
+   slock_lock(log_writer_lock);
+   log_writer_fp      = fp;
+   log_writer_running = true;
+   slock_unlock(log_writer_lock);
+
+   log_writer_thread  = sthread_create(log_writer_loop, fp);
+
+   if (!log_writer_thread)
+   {
+      slock_lock(log_writer_lock);
+      log_writer_running = false;
+      slock_unlock(log_writer_lock);
+   }
+
+   /* What's queued at exit is written */
+   if (log_writer_thread && !registered)
+      registered = atexit(log_writer_stop) == 0;
+}
+#endif
+
 void retro_main_log_file_init(const char *path, bool append)
 {
    if (log_file_initialized)
@@ -143,13 +433,21 @@ void retro_main_log_file_init(const char *path, bool append)
 
    log_file_fp          = stderr;
    if (!path)
+   {
+#ifdef HAVE_LOG_WRITER
+      log_writer_start(log_file_fp);
+#endif
       return;
+   }
 
    log_file_fp          = (FILE*)fopen_utf8(path, append ? "ab" : "wb");
 
    if (!log_file_fp)
    {
       log_file_fp       = stderr;
+#ifdef HAVE_LOG_WRITER
+      log_writer_start(log_file_fp);
+#endif
       RARCH_ERR("Failed to open system event log file: %s\n", path);
       return;
    }
@@ -161,10 +459,18 @@ void retro_main_log_file_init(const char *path, bool append)
    log_file_buf = calloc(1, 0x4000);
    setvbuf(log_file_fp, (char*)log_file_buf, _IOFBF, 0x4000);
 #endif
+
+#ifdef HAVE_LOG_WRITER
+   log_writer_start(log_file_fp);
+#endif
 }
 
 void retro_main_log_file_deinit(void)
 {
+#ifdef HAVE_LOG_WRITER
+   log_writer_stop();
+#endif
+
    if (log_file_fp && log_file_initialized)
    {
       fclose(log_file_fp);
@@ -180,11 +486,16 @@ void retro_main_log_file_deinit(void)
 #if !defined(HAVE_LOGGER)
 void RARCH_LOG_V(const char *tag, const char *fmt, va_list ap)
 {
-   if (verbosity_log_level > 1)
+   const char *tag_v = tag ? tag : FILE_PATH_LOG_INFO;
+
+   /* RARCH_WARN_V and RARCH_ERR_V end up here too; filtered
+    * by the level of their tag, before anything is formatted */
+   if (     !string_is_equal(tag_v, FILE_PATH_LOG_ERROR)
+         && verbosity_log_level >
+            (string_is_equal(tag_v, FILE_PATH_LOG_WARN) ? 2u : 1u))
       return;
 
    {
-      const char *tag_v = tag ? tag : FILE_PATH_LOG_INFO;
 #if TARGET_OS_IPHONE
 #if TARGET_IPHONE_SIMULATOR
       vprintf(fmt, ap);
@@ -270,6 +581,10 @@ void RARCH_LOG_V(const char *tag, const char *fmt, va_list ap)
       OutputDebugStringA(buffer);
 #endif
 #else
+#ifdef HAVE_LOG_WRITER
+      if (log_writer_send(tag_v, fmt, ap))
+         return;
+#endif
 #if defined(HAVE_LIBNX)
       mutexLock(&logging_mtx);
 #endif